@@ -29,13 +29,19 @@
 #include <signal.h>
 #include <time.h>
 
+#include <algorithm>
+#include <memory>
+
 #include <cutils/atomic.h>
 #include <cutils/properties.h>
 
 #include <androidfw/AssetManager.h>
 #include <binder/IPCThreadState.h>
+#include <utils/Condition.h>
 #include <utils/Errors.h>
+#include <utils/KeyedVector.h>
 #include <utils/Log.h>
+#include <utils/Mutex.h>
 #include <utils/SystemClock.h>
 
 #include <android-base/properties.h>
@@ -98,6 +104,251 @@ static const int TEXT_MISSING_VALUE = INT_MIN;
 static const char EXIT_PROP_NAME[] = "service.bootanim.exit";
 static const int ANIM_ENTRY_NAME_MAX = 256;
 static constexpr size_t TEXT_POS_LEN_MAX = 16;
+// The threads decoding the frames of a part ahead of the GL thread, and how many decoded
+// frames they may hold before the GL thread takes them.
+static constexpr size_t FRAME_DECODE_THREADS = 2;
+static constexpr size_t FRAME_DECODE_AHEAD = 4;
+
+// Headers of the pre-compressed frame formats, see FORMAT.md.
+static constexpr size_t PKM_HEADER_SIZE = 16;
+static const char PKM_MAGIC[] = "PKM ";
+static const char PKM_EXTENSION[] = ".pkm";
+static constexpr size_t ASTC_HEADER_SIZE = 16;
+static constexpr uint32_t ASTC_MAGIC = 0x5CA1AB13;
+static const char ASTC_EXTENSION[] = ".astc";
+
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+#ifndef GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2
+#define GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2 0x9276
+#endif
+#ifndef GL_COMPRESSED_RGBA8_ETC2_EAC
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#endif
+
+// The 2D ASTC block sizes, GL_COMPRESSED_RGBA_ASTC_4x4_KHR and following.
+static const struct {
+    uint8_t blockWidth;
+    uint8_t blockHeight;
+    GLenum format;
+} ASTC_FORMATS[] = {
+    { 4, 4, 0x93B0 }, { 5, 4, 0x93B1 }, { 5, 5, 0x93B2 }, { 6, 5, 0x93B3 },
+    { 6, 6, 0x93B4 }, { 8, 5, 0x93B5 }, { 8, 6, 0x93B6 }, { 8, 8, 0x93B7 },
+    { 10, 5, 0x93B8 }, { 10, 6, 0x93B9 }, { 10, 8, 0x93BA }, { 10, 10, 0x93BB },
+    { 12, 10, 0x93BC }, { 12, 12, 0x93BD },
+};
+
+// ---------------------------------------------------------------------------
+
+// ---------------------------------------------------------------------------
+
+struct BootAnimation::DecodedFrame {
+    DecodedFrame() : map(nullptr), format(0), width(0), height(0), textureWidth(0),
+            textureHeight(0), data(nullptr), size(0) {}
+
+    // The pixels of a PNG frame.
+    SkBitmap bitmap;
+
+    // A pre-compressed frame is uploaded as is from its zip entry, which is kept until then.
+    FileMap* map;
+    GLenum format;
+    int width;
+    int height;
+    int textureWidth;
+    int textureHeight;
+    const void* data;
+    size_t size;
+};
+
+/*
+ * Decodes the frames of a part on worker threads ahead of playAnimation(), so reading and
+ * inflating a frame from slow storage overlaps with showing the previous ones. At most
+ * FRAME_DECODE_AHEAD frames are decoded and not yet taken.
+ */
+class BootAnimation::FrameDecoder {
+public:
+    explicit FrameDecoder(const Animation::Part& part);
+    ~FrameDecoder();
+
+    // Waits for the frame at index to be decoded, frames are taken in order.
+    void take(size_t index, DecodedFrame* outFrame);
+
+private:
+    class Worker : public Thread {
+    public:
+        explicit Worker(FrameDecoder* decoder) : Thread(false), mDecoder(decoder) {}
+    private:
+        virtual bool threadLoop() { return mDecoder->decodeNext(); }
+        FrameDecoder* mDecoder;
+    };
+
+    bool decodeNext();
+    static void decode(const Animation::Frame& frame, DecodedFrame* outFrame);
+    static bool parseCompressed(const Animation::Frame& frame, DecodedFrame* outFrame);
+
+    const Animation::Part& mPart;
+    Mutex mLock;
+    Condition mCondition;
+    size_t mNextDecode;
+    size_t mNextTake;
+    bool mExiting;
+    KeyedVector<size_t, DecodedFrame> mDecoded;
+    Vector<sp<Worker>> mWorkers;
+};
+
+BootAnimation::FrameDecoder::FrameDecoder(const Animation::Part& part)
+        : mPart(part), mNextDecode(0), mNextTake(0), mExiting(false) {
+    size_t threads = std::min(FRAME_DECODE_THREADS, part.frames.size());
+    for (size_t i = 0; i < threads; i++) {
+        sp<Worker> worker = new Worker(this);
+        if (worker->run("BootAnimation::FrameDecoder", PRIORITY_DISPLAY) == NO_ERROR) {
+            mWorkers.add(worker);
+        }
+    }
+}
+
+BootAnimation::FrameDecoder::~FrameDecoder() {
+    {
+        Mutex::Autolock _l(mLock);
+        mExiting = true;
+        mCondition.broadcast();
+    }
+    for (const sp<Worker>& worker : mWorkers) {
+        worker->requestExitAndWait();
+    }
+    // Compressed frames that were never taken still hold their zip entry.
+    for (size_t i = 0; i < mDecoded.size(); i++) {
+        delete mDecoded.valueAt(i).map;
+    }
+}
+
+void BootAnimation::FrameDecoder::take(size_t index, DecodedFrame* outFrame) {
+    if (mWorkers.isEmpty()) {
+        // No thread could be started, decode on the caller's thread.
+        decode(mPart.frames[index], outFrame);
+        return;
+    }
+    Mutex::Autolock _l(mLock);
+    ssize_t i;
+    while ((i = mDecoded.indexOfKey(index)) < 0) {
+        mCondition.wait(mLock);
+    }
+    *outFrame = mDecoded.valueAt(i);
+    mDecoded.removeItemsAt(i);
+    mNextTake = index + 1;
+    mCondition.broadcast();
+}
+
+bool BootAnimation::FrameDecoder::decodeNext() {
+    size_t index;
+    {
+        Mutex::Autolock _l(mLock);
+        while (!mExiting && mNextDecode < mPart.frames.size()
+                && mNextDecode >= mNextTake + FRAME_DECODE_AHEAD) {
+            mCondition.wait(mLock);
+        }
+        if (mExiting || mNextDecode >= mPart.frames.size()) {
+            return false;
+        }
+        index = mNextDecode++;
+    }
+
+    DecodedFrame frame;
+    decode(mPart.frames[index], &frame);
+
+    Mutex::Autolock _l(mLock);
+    mDecoded.add(index, frame);
+    mCondition.broadcast();
+    return true;
+}
+
+void BootAnimation::FrameDecoder::decode(const Animation::Frame& frame, DecodedFrame* outFrame) {
+    if (parseCompressed(frame, outFrame)) {
+        // Kept until the frame is uploaded, or released if it can't be.
+        outFrame->map = frame.map;
+        return;
+    }
+    sk_sp<SkData> data = SkData::MakeWithoutCopy(frame.map->getDataPtr(),
+            frame.map->getDataLength());
+    sk_sp<SkImage> image = SkImage::MakeFromEncoded(data);
+    if (image != nullptr) {
+        image->asLegacyBitmap(&outFrame->bitmap, SkImage::kRO_LegacyBitmapMode);
+    } else {
+        ALOGE("Failed to decode frame %s", frame.name.string());
+    }
+    // The packed frame is no longer needed once decoded.
+    delete frame.map;
+}
+
+bool BootAnimation::FrameDecoder::parseCompressed(const Animation::Frame& frame,
+        DecodedFrame* outFrame) {
+    const String8 extension(frame.name.getPathExtension());
+    const uint8_t* data = static_cast<const uint8_t*>(frame.map->getDataPtr());
+    const size_t length = frame.map->getDataLength();
+
+    if (extension == PKM_EXTENSION) {
+        if (length < PKM_HEADER_SIZE || memcmp(data, PKM_MAGIC, 4) != 0) {
+            ALOGE("Invalid PKM header in frame %s", frame.name.string());
+            return true;
+        }
+        // The sizes and type are big endian, the data is padded to whole 4x4 blocks.
+        const int type = (data[6] << 8) | data[7];
+        outFrame->textureWidth = (data[8] << 8) | data[9];
+        outFrame->textureHeight = (data[10] << 8) | data[11];
+        outFrame->width = (data[12] << 8) | data[13];
+        outFrame->height = (data[14] << 8) | data[15];
+        size_t blockSize = 8;
+        switch (type) {
+            case 0: outFrame->format = GL_ETC1_RGB8_OES; break;
+            case 1: outFrame->format = GL_COMPRESSED_RGB8_ETC2; break;
+            case 3: outFrame->format = GL_COMPRESSED_RGBA8_ETC2_EAC; blockSize = 16; break;
+            case 4: outFrame->format = GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2; break;
+            default:
+                ALOGE("Unsupported PKM type %d in frame %s", type, frame.name.string());
+                return true;
+        }
+        outFrame->size = (outFrame->textureWidth / 4) * (outFrame->textureHeight / 4) * blockSize;
+        outFrame->data = data + PKM_HEADER_SIZE;
+    } else if (extension == ASTC_EXTENSION) {
+        if (length < ASTC_HEADER_SIZE) {
+            ALOGE("Invalid ASTC header in frame %s", frame.name.string());
+            return true;
+        }
+        uint32_t magic = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t) data[3] << 24);
+        if (magic != ASTC_MAGIC) {
+            ALOGE("Invalid ASTC header in frame %s", frame.name.string());
+            return true;
+        }
+        const int blockWidth = data[4];
+        const int blockHeight = data[5];
+        // The sizes are 24 bit little endian.
+        outFrame->width = outFrame->textureWidth = data[7] | (data[8] << 8) | (data[9] << 16);
+        outFrame->height = outFrame->textureHeight = data[10] | (data[11] << 8) | (data[12] << 16);
+        for (const auto& astcFormat : ASTC_FORMATS) {
+            if (astcFormat.blockWidth == blockWidth && astcFormat.blockHeight == blockHeight) {
+                outFrame->format = astcFormat.format;
+            }
+        }
+        if (outFrame->format == 0 || data[6] != 1) {
+            ALOGE("Unsupported %dx%dx%d ASTC blocks in frame %s", blockWidth, blockHeight,
+                    data[6], frame.name.string());
+            return true;
+        }
+        outFrame->size = ((outFrame->width + blockWidth - 1) / blockWidth)
+                * ((outFrame->height + blockHeight - 1) / blockHeight) * 16;
+        outFrame->data = data + ASTC_HEADER_SIZE;
+    } else {
+        return false;
+    }
+
+    if (outFrame->size > length - (outFrame->data - data)) {
+        ALOGE("Truncated compressed frame %s", frame.name.string());
+        outFrame->format = 0;
+        return true;
+    }
+    return true;
+}
 
 // ---------------------------------------------------------------------------
 
@@ -205,6 +456,11 @@ status_t BootAnimation::initTexture(FileMap* map, int* width, int* height)
     // the packed resource can be released.
     delete map;
 
+    return initTexture(bitmap, width, height);
+}
+
+status_t BootAnimation::initTexture(const SkBitmap& bitmap, int* width, int* height)
+{
     const int w = bitmap.width();
     const int h = bitmap.height();
     const void* p = bitmap.getPixels();
@@ -251,6 +507,42 @@ status_t BootAnimation::initTexture(FileMap* map, int* width, int* height)
     return NO_ERROR;
 }
 
+status_t BootAnimation::initTexture(const DecodedFrame& frame, int* width, int* height)
+{
+    if (frame.map == nullptr) {
+        if (frame.bitmap.isNull()) {
+            return NO_INIT;
+        }
+        return initTexture(frame.bitmap, width, height);
+    }
+
+    status_t status = NO_ERROR;
+    if (frame.format == 0 || !isCompressedFormatSupported(frame.format)) {
+        ALOGE("Compressed texture format 0x%x is not supported", frame.format);
+        status = NO_INIT;
+    } else {
+        // The rows are stored top to bottom like the decoded frames, so use the same crop.
+        GLint crop[4] = { 0, frame.height, frame.width, -frame.height };
+        glCompressedTexImage2D(GL_TEXTURE_2D, 0, frame.format, frame.textureWidth,
+                frame.textureHeight, 0, frame.size, frame.data);
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_CROP_RECT_OES, crop);
+        *width = frame.width;
+        *height = frame.height;
+    }
+    delete frame.map;
+    return status;
+}
+
+bool BootAnimation::isCompressedFormatSupported(GLenum format) const
+{
+    for (GLint supported : mCompressedTextureFormats) {
+        if (static_cast<GLenum>(supported) == format) {
+            return true;
+        }
+    }
+    return false;
+}
+
 status_t BootAnimation::readyToRun() {
     mAssets.addDefaultAssets();
 
@@ -828,6 +1120,15 @@ bool BootAnimation::movie()
         }
     }
 
+    // Query the compressed formats frames may be stored in
+    GLint numCompressedFormats = 0;
+    glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &numCompressedFormats);
+    mCompressedTextureFormats.clear();
+    if (numCompressedFormats > 0) {
+        mCompressedTextureFormats.insertAt(0, 0, numCompressedFormats);
+        glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, mCompressedTextureFormats.editArray());
+    }
+
     // Blend required to draw time on top of animation frames.
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glShadeModel(GL_FLAT);
@@ -906,21 +1207,25 @@ bool BootAnimation::playAnimation(const Animation& animation)
                     part.backgroundColor[2],
                     1.0f);
 
+            // The first play decodes the frames ahead, later plays of a looping part
+            // reuse the textures.
+            std::unique_ptr<FrameDecoder> decoder;
+            if (r == 0 && fcount > 0) {
+                decoder.reset(new FrameDecoder(part));
+            }
+            // The frame whose texture was uploaded while the previous one was shown.
+            size_t uploadedFrame = fcount;
+
             for (size_t j=0 ; j<fcount && (!exitPending() || part.playUntilComplete) ; j++) {
                 const Animation::Frame& frame(part.frames[j]);
                 nsecs_t lastFrame = systemTime();
 
                 if (r > 0) {
                     glBindTexture(GL_TEXTURE_2D, frame.tid);
+                } else if (uploadedFrame == j) {
+                    glBindTexture(GL_TEXTURE_2D, part.count != 1 ? frame.tid : 0);
                 } else {
-                    if (part.count != 1) {
-                        glGenTextures(1, &frame.tid);
-                        glBindTexture(GL_TEXTURE_2D, frame.tid);
-                        glTexParameterx(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                        glTexParameterx(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                    }
-                    int w, h;
-                    initTexture(frame.map, &w, &h);
+                    uploadFrameTexture(part, j, decoder.get());
                 }
 
                 const int xc = animationX + frame.trimX;
@@ -954,6 +1259,12 @@ bool BootAnimation::playAnimation(const Animation& animation)
                 //ALOGD("%lld, %lld", ns2ms(now - lastFrame), ns2ms(delay));
                 lastFrame = now;
 
+                // Upload the next frame while this one is shown, within the frame delay.
+                if (decoder != nullptr && j + 1 < fcount) {
+                    uploadFrameTexture(part, j + 1, decoder.get());
+                    uploadedFrame = j + 1;
+                }
+
                 if (delay > 0) {
                     struct timespec spec;
                     spec.tv_sec  = (now + delay) / 1000000000;
@@ -990,6 +1301,24 @@ bool BootAnimation::playAnimation(const Animation& animation)
     return true;
 }
 
+void BootAnimation::uploadFrameTexture(const Animation::Part& part, size_t index,
+        FrameDecoder* decoder) {
+    const Animation::Frame& frame(part.frames[index]);
+    if (part.count != 1) {
+        glGenTextures(1, &frame.tid);
+        glBindTexture(GL_TEXTURE_2D, frame.tid);
+        glTexParameterx(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameterx(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    } else {
+        // The clock may have bound its font texture since the last frame.
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    DecodedFrame decoded;
+    decoder->take(index, &decoded);
+    int w, h;
+    initTexture(decoded, &w, &h);
+}
+
 void BootAnimation::handleViewport(nsecs_t timestep) {
     if (mShuttingDown || !mFlingerSurfaceControl || mTargetInset == 0) {
         return;
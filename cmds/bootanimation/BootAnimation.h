@@ -141,8 +141,15 @@ private:
         BootAnimation* mBootAnimation;
     };
 
+    // A frame decoded ahead of being shown, see FrameDecoder.
+    struct DecodedFrame;
+    class FrameDecoder;
+
     status_t initTexture(Texture* texture, AssetManager& asset, const char* name);
     status_t initTexture(FileMap* map, int* width, int* height);
+    status_t initTexture(const SkBitmap& bitmap, int* width, int* height);
+    status_t initTexture(const DecodedFrame& frame, int* width, int* height);
+    bool isCompressedFormatSupported(GLenum format) const;
     status_t initFont(Font* font, const char* fallback);
     bool android();
     bool movie();
@@ -151,6 +158,7 @@ private:
     bool validClock(const Animation::Part& part);
     Animation* loadAnimation(const String8&);
     bool playAnimation(const Animation&);
+    void uploadFrameTexture(const Animation::Part& part, size_t index, FrameDecoder* decoder);
     void releaseAnimation(Animation*) const;
     bool parseAnimationDesc(Animation&);
     bool preloadZip(Animation &animation);
@@ -167,6 +175,7 @@ private:
     int         mCurrentInset;
     int         mTargetInset;
     bool        mUseNpotTextures = false;
+    Vector<GLint> mCompressedTextureFormats;
     EGLDisplay  mDisplay;
     EGLDisplay  mContext;
     EGLDisplay  mSurface;
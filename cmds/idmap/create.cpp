@@ -13,6 +13,119 @@
 using namespace android;
 
 namespace {
+    // A stamp file next to an idmap records the files the idmap was last found to be up to
+    // date with, so it can be validated again without opening either package.
+    static const uint32_t IDMAP_STAMP_MAGIC = 0x534d4449; // "IDMS"
+    static const uint32_t IDMAP_STAMP_VERSION = 1;
+    static const size_t IDMAP_STAMP_PATH_MAX = 256;
+
+    struct file_stamp {
+        int64_t mtime_ns;
+        int64_t size;
+        uint64_t ino;
+
+        bool operator==(const file_stamp& rhs) const
+        {
+            return mtime_ns == rhs.mtime_ns && size == rhs.size && ino == rhs.ino;
+        }
+    };
+
+    struct idmap_stamp {
+        uint32_t magic;
+        uint32_t version;
+        file_stamp target;
+        file_stamp overlay;
+        file_stamp idmap;
+        char target_path[IDMAP_STAMP_PATH_MAX];
+        char overlay_path[IDMAP_STAMP_PATH_MAX];
+    };
+
+    String8 stamp_path_for(const char *idmap_path)
+    {
+        String8 path(idmap_path);
+        path.append(".stamp");
+        return path;
+    }
+
+    bool get_file_stamp(const char *path, file_stamp *stamp)
+    {
+        struct stat st;
+        if (stat(path, &st) == -1) {
+            return false;
+        }
+        stamp->mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL +
+                st.st_mtim.tv_nsec;
+        stamp->size = st.st_size;
+        stamp->ino = st.st_ino;
+        return true;
+    }
+
+    bool make_idmap_stamp(const char *target_apk_path, const char *overlay_apk_path,
+            const char *idmap_path, idmap_stamp *stamp)
+    {
+        if (strlen(target_apk_path) >= IDMAP_STAMP_PATH_MAX ||
+                strlen(overlay_apk_path) >= IDMAP_STAMP_PATH_MAX) {
+            return false;
+        }
+        memset(stamp, 0, sizeof(*stamp));
+        stamp->magic = IDMAP_STAMP_MAGIC;
+        stamp->version = IDMAP_STAMP_VERSION;
+        strcpy(stamp->target_path, target_apk_path);
+        strcpy(stamp->overlay_path, overlay_apk_path);
+        return get_file_stamp(target_apk_path, &stamp->target) &&
+                get_file_stamp(overlay_apk_path, &stamp->overlay) &&
+                get_file_stamp(idmap_path, &stamp->idmap);
+    }
+
+    // Whether the stamp shows that nothing changed since the idmap was last validated.
+    bool is_idmap_stamp_current(const char *target_apk_path, const char *overlay_apk_path,
+            const char *idmap_path)
+    {
+        idmap_stamp expected;
+        if (!make_idmap_stamp(target_apk_path, overlay_apk_path, idmap_path, &expected)) {
+            return false;
+        }
+        int fd = TEMP_FAILURE_RETRY(open(stamp_path_for(idmap_path).string(), O_RDONLY));
+        if (fd == -1) {
+            return false;
+        }
+        idmap_stamp stored;
+        ssize_t r = TEMP_FAILURE_RETRY(read(fd, &stored, sizeof(stored)));
+        close(fd);
+        return r == static_cast<ssize_t>(sizeof(stored)) &&
+                stored.magic == expected.magic && stored.version == expected.version &&
+                stored.target == expected.target && stored.overlay == expected.overlay &&
+                stored.idmap == expected.idmap &&
+                strcmp(stored.target_path, expected.target_path) == 0 &&
+                strcmp(stored.overlay_path, expected.overlay_path) == 0;
+    }
+
+    void write_idmap_stamp(const char *target_apk_path, const char *overlay_apk_path,
+            const char *idmap_path)
+    {
+        String8 stamp_path = stamp_path_for(idmap_path);
+        idmap_stamp stamp;
+        if (!make_idmap_stamp(target_apk_path, overlay_apk_path, idmap_path, &stamp)) {
+            unlink(stamp_path.string());
+            return;
+        }
+        // written next to the stamp and renamed, a reader never sees a partial stamp
+        String8 tmp_path(stamp_path);
+        tmp_path.append(".tmp");
+        int fd = TEMP_FAILURE_RETRY(open(tmp_path.string(), O_WRONLY | O_CREAT | O_TRUNC, 0600));
+        if (fd == -1) {
+            ALOGD("error: open %s: %s\n", tmp_path.string(), strerror(errno));
+            return;
+        }
+        ssize_t w = TEMP_FAILURE_RETRY(write(fd, &stamp, sizeof(stamp)));
+        close(fd);
+        if (w != static_cast<ssize_t>(sizeof(stamp)) ||
+                rename(tmp_path.string(), stamp_path.string()) != 0) {
+            ALOGD("error: write %s: %s\n", stamp_path.string(), strerror(errno));
+            unlink(tmp_path.string());
+        }
+    }
+
     int get_zip_entry_crc(const char *zip_path, const char *entry_name, uint32_t *crc)
     {
         std::unique_ptr<ZipFileRO> zip(ZipFileRO::open(zip_path));
@@ -202,8 +315,14 @@ fail:
 int idmap_create_path(const char *target_apk_path, const char *overlay_apk_path,
         const char *idmap_path)
 {
+    if (is_idmap_stamp_current(target_apk_path, overlay_apk_path, idmap_path)) {
+        // neither package nor the idmap changed since it was last validated
+        return EXIT_SUCCESS;
+    }
+
     if (!is_idmap_stale_path(target_apk_path, overlay_apk_path, idmap_path)) {
         // already up to date -- nothing to do
+        write_idmap_stamp(target_apk_path, overlay_apk_path, idmap_path);
         return EXIT_SUCCESS;
     }
 
@@ -216,6 +335,9 @@ int idmap_create_path(const char *target_apk_path, const char *overlay_apk_path,
     close(fd);
     if (r != 0) {
         unlink(idmap_path);
+        unlink(stamp_path_for(idmap_path).string());
+    } else {
+        write_idmap_stamp(target_apk_path, overlay_apk_path, idmap_path);
     }
     return r == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
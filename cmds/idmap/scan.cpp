@@ -5,7 +5,11 @@
 
 #include "idmap.h"
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <thread>
+#include <vector>
 #include <androidfw/ResourceTypes.h>
 #include <androidfw/StreamingZipInflater.h>
 #include <androidfw/ZipFileRO.h>
@@ -18,6 +22,9 @@
 
 #define NO_OVERLAY_TAG (-1000)
 
+// the most threads processing overlays at the same time
+#define MAX_SCAN_THREADS 4
+
 using namespace android;
 
 namespace {
@@ -230,53 +237,103 @@ namespace {
     }
 }
 
+namespace {
+    struct ScanResult {
+        ScanResult() : priority(-1) {}
+
+        String8 idmap_path;
+        int priority;
+    };
+
+    void process_overlay(const char *target_package_name, const char *target_apk_path,
+            const char *idmap_dir, const String8& overlay_apk_path, ScanResult *result)
+    {
+        struct stat st;
+        if (stat(overlay_apk_path.string(), &st) < 0 || !S_ISREG(st.st_mode)) {
+            return;
+        }
+
+        int priority = parse_apk(overlay_apk_path.string(), target_package_name);
+        if (priority < 0) {
+            return;
+        }
+
+        String8 idmap_path(idmap_dir);
+        idmap_path.appendPath(flatten_path(overlay_apk_path.string() + 1));
+        idmap_path.append("@idmap");
+
+        if (idmap_create_path(target_apk_path, overlay_apk_path.string(),
+                    idmap_path.string()) != 0) {
+            ALOGE("error: failed to create idmap for target=%s overlay=%s idmap=%s\n",
+                    target_apk_path, overlay_apk_path.string(), idmap_path.string());
+            return;
+        }
+
+        result->idmap_path = idmap_path;
+        result->priority = priority;
+    }
+}
+
 int idmap_scan(const char *target_package_name, const char *target_apk_path,
         const char *idmap_dir, const android::Vector<const char *> *overlay_dirs)
 {
     String8 filename = String8(idmap_dir);
     filename.appendPath("overlays.list");
 
-    SortedVector<Overlay> overlayVector;
+    // Each overlay is parsed and gets its idmap independently, so the overlays are
+    // processed in parallel and then added in directory order as before.
+    std::vector<String8> overlay_apk_paths;
+    bool dir_error = false;
     const size_t N = overlay_dirs->size();
-    for (size_t i = 0; i < N; ++i) {
+    for (size_t i = 0; i < N && !dir_error; ++i) {
         const char *overlay_dir = overlay_dirs->itemAt(i);
         DIR *dir = opendir(overlay_dir);
         if (dir == NULL) {
-            return EXIT_FAILURE;
+            dir_error = true;
+            break;
         }
 
         struct dirent *dirent;
         while ((dirent = readdir(dir)) != NULL) {
-            struct stat st;
             char overlay_apk_path[PATH_MAX + 1];
             snprintf(overlay_apk_path, PATH_MAX, "%s/%s", overlay_dir, dirent->d_name);
-            if (stat(overlay_apk_path, &st) < 0) {
-                continue;
-            }
-            if (!S_ISREG(st.st_mode)) {
-                continue;
-            }
+            overlay_apk_paths.push_back(String8(overlay_apk_path));
+        }
 
-            int priority = parse_apk(overlay_apk_path, target_package_name);
-            if (priority < 0) {
-                continue;
-            }
+        closedir(dir);
+    }
 
-            String8 idmap_path(idmap_dir);
-            idmap_path.appendPath(flatten_path(overlay_apk_path + 1));
-            idmap_path.append("@idmap");
+    std::vector<ScanResult> results(overlay_apk_paths.size());
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        size_t index;
+        while ((index = next++) < overlay_apk_paths.size()) {
+            process_overlay(target_package_name, target_apk_path, idmap_dir,
+                    overlay_apk_paths[index], &results[index]);
+        }
+    };
+    size_t num_threads = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u),
+            MAX_SCAN_THREADS);
+    num_threads = std::min(num_threads, overlay_apk_paths.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < num_threads; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
 
-            if (idmap_create_path(target_apk_path, overlay_apk_path, idmap_path.string()) != 0) {
-                ALOGE("error: failed to create idmap for target=%s overlay=%s idmap=%s\n",
-                        target_apk_path, overlay_apk_path, idmap_path.string());
-                continue;
-            }
+    if (dir_error) {
+        return EXIT_FAILURE;
+    }
 
-            Overlay overlay(String8(overlay_apk_path), idmap_path, priority);
-            overlayVector.add(overlay);
+    SortedVector<Overlay> overlayVector;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i].priority >= 0) {
+            overlayVector.add(Overlay(overlay_apk_paths[i], results[i].idmap_path,
+                        results[i].priority));
         }
-
-        closedir(dir);
     }
 
     if (!writePackagesList(filename.string(), overlayVector)) {
@@ -285,4 +342,3 @@ int idmap_scan(const char *target_package_name, const char *target_apk_path,
 
     return EXIT_SUCCESS;
 }
-
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <fcntl.h>
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <android-base/strings.h>
+#include <android-base/test_utils.h>
+#include "benchmark/benchmark.h"
+
+#include "CpuInfoParser.h"
+#include "ProcrankParser.h"
+#include "PsParser.h"
+
+using namespace android::base;
+using std::string;
+using std::vector;
+
+// As many as on a busy device.
+static const int kProcessCount = 1500;
+
+// Grows a capture from the test data to kProcessCount rows by repeating its rows, which follow
+// the first line with "PID" and end at an empty or "---" line, and writes it to file.
+static bool CreateCapture(const char* name, const TemporaryFile& file) {
+    string content;
+    if (!ReadFileToString(GetExecutableDirectory() + "/testdata/" + name, &content)) {
+        return false;
+    }
+    vector<string> lines = Split(content, "\n");
+    size_t rowsStart = 0;
+    while (rowsStart < lines.size() && lines[rowsStart].find("PID") == string::npos) {
+        rowsStart++;
+    }
+    rowsStart++;
+    size_t rowsEnd = rowsStart;
+    while (rowsEnd < lines.size() && !lines[rowsEnd].empty() &&
+           lines[rowsEnd].find("---") == string::npos) {
+        rowsEnd++;
+    }
+    if (rowsEnd == rowsStart) {
+        return false;
+    }
+
+    string capture;
+    for (size_t i = 0; i < rowsStart; i++) {
+        capture += lines[i] + "\n";
+    }
+    for (int i = 0; i < kProcessCount; i++) {
+        capture += lines[rowsStart + i % (rowsEnd - rowsStart)] + "\n";
+    }
+    for (size_t i = rowsEnd; i < lines.size(); i++) {
+        capture += lines[i] + "\n";
+    }
+    return WriteStringToFile(capture, file.path);
+}
+
+static void RunParser(benchmark::State& state, const TextParserBase& parser, const char* name) {
+    TemporaryFile capture;
+    if (!CreateCapture(name, capture)) {
+        state.SkipWithError("Couldn't read the test data");
+        return;
+    }
+    int out = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    while (state.KeepRunning()) {
+        // The parser closes its input.
+        parser.Parse(open(capture.path, O_RDONLY | O_CLOEXEC), out);
+    }
+    close(out);
+}
+
+static void BM_PsParser(benchmark::State& state) {
+    PsParser parser;
+    RunParser(state, parser, "ps.txt");
+}
+BENCHMARK(BM_PsParser);
+
+// The output of top.
+static void BM_CpuInfoParser(benchmark::State& state) {
+    CpuInfoParser parser;
+    RunParser(state, parser, "cpuinfo.txt");
+}
+BENCHMARK(BM_CpuInfoParser);
+
+static void BM_ProcrankParser(benchmark::State& state) {
+    ProcrankParser parser;
+    RunParser(state, parser, "procrank.txt");
+}
+BENCHMARK(BM_ProcrankParser);
@@ -20,6 +20,8 @@
 
 #include <algorithm>
 #include <sstream>
+#include <string.h>
+#include <strings.h>
 #include <unistd.h>
 
 bool isValidChar(char c) {
@@ -52,12 +54,45 @@ static inline std::string trimHeader(const std::string& s) {
     return toLowerStr(trimDefault(s));
 }
 
-static inline bool isNumber(const std::string& s) {
-    std::string::const_iterator it = s.begin();
+static inline std::string_view trimView(std::string_view s, const std::string& charset) {
+    const auto head = s.find_first_not_of(charset);
+    if (head == std::string_view::npos) return s.substr(0, 0);
+
+    const auto tail = s.find_last_not_of(charset);
+    return s.substr(head, tail - head + 1);
+}
+
+static inline bool isNumber(std::string_view s) {
+    std::string_view::const_iterator it = s.begin();
     while (it != s.end() && std::isdigit(*it)) ++it;
     return !s.empty() && it == s.end();
 }
 
+static inline bool equalsIgnoreCase(std::string_view s, const char* word) {
+    return s.size() == strlen(word) && strncasecmp(s.data(), word, s.size()) == 0;
+}
+
+// Same as atoll, but the value doesn't need to be NUL terminated.
+static long long viewToLongLong(std::string_view s) {
+    size_t i = 0;
+    while (i < s.size() && isspace((unsigned char)s[i])) i++;
+    bool negative = false;
+    if (i < s.size() && (s[i] == '-' || s[i] == '+')) negative = s[i++] == '-';
+    long long value = 0;
+    for (; i < s.size() && isdigit((unsigned char)s[i]); i++) {
+        value = value * 10 + (s[i] - '0');
+    }
+    return negative ? -value : value;
+}
+
+static double viewToDouble(std::string_view s) {
+    char buf[64];
+    if (s.size() >= sizeof(buf)) return toDouble(std::string(s));
+    memcpy(buf, s.data(), s.size());
+    buf[s.size()] = '\0';
+    return atof(buf);
+}
+
 // This is similiar to Split in android-base/file.h, but it won't add empty string
 static void split(const std::string& line, std::vector<std::string>& words,
         const trans_func& func, const std::string& delimiters) {
@@ -86,10 +121,27 @@ header_t parseHeader(const std::string& line, const std::string& delimiters) {
 }
 
 record_t parseRecord(const std::string& line, const std::string& delimiters) {
-    record_t record;
-    trans_func f = &trimDefault;
-    split(line, record, f, delimiters);
-    return record;
+    fields_t fields;
+    splitRecord(line, &fields, delimiters);
+    return record_t(fields.begin(), fields.end());
+}
+
+void splitRecord(std::string_view line, fields_t* fields, const std::string& delimiters) {
+    fields->clear();
+
+    size_t base = 0;
+    size_t found;
+    while (true) {
+        found = line.find_first_of(delimiters, base);
+        if (found != base) {
+            std::string_view word = trimView(line.substr(base, found - base), DEFAULT_WHITESPACE);
+            if (!word.empty()) {
+                fields->push_back(word);
+            }
+        }
+        if (found == line.npos) break;
+        base = found + 1;
+    }
 }
 
 bool getColumnIndices(std::vector<int>& indices, const char** headerNames, const std::string& line) {
@@ -113,7 +165,14 @@ bool getColumnIndices(std::vector<int>& indices, const char** headerNames, const
 }
 
 record_t parseRecordByColumns(const std::string& line, const std::vector<int>& indices, const std::string& delimiters) {
-    record_t record;
+    fields_t fields;
+    splitRecordByColumns(line, indices, &fields, delimiters);
+    return record_t(fields.begin(), fields.end());
+}
+
+void splitRecordByColumns(std::string_view line, const std::vector<int>& indices, fields_t* fields,
+        const std::string& delimiters) {
+    fields->clear();
     int lastIndex = 0;
     int lastBeginning = 0;
     int lineSize = (int)line.size();
@@ -132,25 +191,24 @@ record_t parseRecordByColumns(const std::string& line, const std::vector<int>& i
             }
             // If we're past the end of the line AND we've already saved everything up to the end.
             fprintf(stderr, "index wrong: lastIndex: %d, idx: %d, lineSize: %d\n", lastIndex, idx, lineSize);
-            record.clear(); // The indices are wrong, return empty.
-            return record;
+            fields->clear(); // The indices are wrong, return empty.
+            return;
         }
         while (idx < lineSize && delimiters.find(line[idx++]) == std::string::npos);
-        record.push_back(trimDefault(line.substr(lastIndex, idx - lastIndex)));
+        fields->push_back(trimView(line.substr(lastIndex, idx - lastIndex), DEFAULT_WHITESPACE));
         lastBeginning = lastIndex;
         lastIndex = idx;
     }
     if (lineSize - lastIndex > 0) {
         int beginning = lastIndex;
-        if (record.size() == indices.size()) {
+        if (fields->size() == indices.size()) {
             // We've already encountered all of the columns...put whatever is
             // left in the last column.
-            record.pop_back();
+            fields->pop_back();
             beginning = lastBeginning;
         }
-        record.push_back(trimDefault(line.substr(beginning, lineSize - beginning)));
+        fields->push_back(trimView(line.substr(beginning, lineSize - beginning), DEFAULT_WHITESPACE));
     }
-    return record;
 }
 
 void printRecord(const record_t& record) {
@@ -166,6 +224,19 @@ void printRecord(const record_t& record) {
     fprintf(stderr, "\" }\n");
 }
 
+void printRecord(const fields_t& record) {
+    fprintf(stderr, "Record: { ");
+    if (record.size() == 0) {
+        fprintf(stderr, "}\n");
+        return;
+    }
+    for(size_t i = 0; i < record.size(); ++i) {
+        if(i != 0) fprintf(stderr, "\", ");
+        fprintf(stderr, "\"%.*s", (int)record[i].size(), record[i].data());
+    }
+    fprintf(stderr, "\" }\n");
+}
+
 bool stripPrefix(std::string* line, const char* key, bool endAtDelimiter) {
     const auto head = line->find_first_not_of(DEFAULT_WHITESPACE);
     if (head == std::string::npos) return false;
@@ -235,6 +306,8 @@ double toDouble(const std::string& s) {
 
 // ==============================================================================
 Reader::Reader(const int fd)
+        :mBuffer(NULL),
+         mBufferSize(0)
 {
     mFile = fdopen(fd, "r");
     mStatus = mFile == NULL ? "Invalid fd " + std::to_string(fd) : "";
@@ -243,21 +316,21 @@ Reader::Reader(const int fd)
 Reader::~Reader()
 {
     if (mFile != NULL) fclose(mFile);
+    free(mBuffer);
 }
 
 bool Reader::readLine(std::string* line) {
     if (mFile == NULL) return false;
 
-    char* buf = NULL;
-    size_t len = 0;
-    ssize_t read = getline(&buf, &len, mFile);
+    ssize_t read = getline(&mBuffer, &mBufferSize, mFile);
     if (read != -1) {
-        std::string s(buf);
-        line->assign(trim(s, DEFAULT_NEWLINE));
+        // Stops at a NUL like the string it used to be copied into.
+        std::string_view s(mBuffer, strnlen(mBuffer, read));
+        s = trimView(s, DEFAULT_NEWLINE);
+        line->assign(s.data(), s.size());
     } else if (errno == EINVAL) {
         mStatus = "Bad Argument";
     }
-    free(buf);
     return read != -1;
 }
 
@@ -290,7 +363,7 @@ Table::addEnumTypeMap(const char* field, const char* enumNames[], const int enum
         return;
     }
 
-    std::map<std::string, int> enu;
+    std::map<std::string, int, std::less<>> enu;
     for (int i = 0; i < enumSize; i++) {
         enu[enumNames[i]] = enumValues[i];
     }
@@ -306,48 +379,79 @@ Table::addEnumNameToValue(const char* enumName, const int enumValue)
 bool
 Table::insertField(ProtoOutputStream* proto, const std::string& name, const std::string& value)
 {
-    if (mFields.find(name) == mFields.end()) return false;
+    return insertField(proto, getColumn(name), value);
+}
+
+Table::Column
+Table::getColumn(const std::string& name) const
+{
+    Column column = {0, NULL};
+    auto field = mFields.find(name);
+    if (field == mFields.end()) return column;
+
+    column.fieldId = field->second;
+    auto enums = mEnums.find(name);
+    if (enums != mEnums.end()) column.enumValues = &enums->second;
+    return column;
+}
+
+std::vector<Table::Column>
+Table::getColumns(const header_t& header) const
+{
+    std::vector<Column> columns;
+    for (const std::string& name : header) {
+        columns.push_back(getColumn(name));
+    }
+    return columns;
+}
+
+bool
+Table::insertField(ProtoOutputStream* proto, const Column& column, std::string_view value)
+{
+    const uint64_t found = column.fieldId;
+    if (found == 0) return false;
 
-    uint64_t found = mFields[name];
-    record_t repeats; // used for repeated fields
+    fields_t repeats; // used for repeated fields
     switch ((found & FIELD_COUNT_MASK) | (found & FIELD_TYPE_MASK)) {
         case FIELD_COUNT_SINGLE | FIELD_TYPE_DOUBLE:
         case FIELD_COUNT_SINGLE | FIELD_TYPE_FLOAT:
-            proto->write(found, toDouble(value));
+            proto->write(found, viewToDouble(value));
             break;
         case FIELD_COUNT_SINGLE | FIELD_TYPE_STRING:
         case FIELD_COUNT_SINGLE | FIELD_TYPE_BYTES:
-            proto->write(found, value);
+            // An empty view may have no data, but it's still an empty string.
+            proto->write(found, value.empty() ? "" : value.data(), value.size());
             break;
         case FIELD_COUNT_SINGLE | FIELD_TYPE_INT64:
         case FIELD_COUNT_SINGLE | FIELD_TYPE_SINT64:
         case FIELD_COUNT_SINGLE | FIELD_TYPE_UINT64:
         case FIELD_COUNT_SINGLE | FIELD_TYPE_FIXED64:
         case FIELD_COUNT_SINGLE | FIELD_TYPE_SFIXED64:
-            proto->write(found, toLongLong(value));
+            proto->write(found, viewToLongLong(value));
             break;
         case FIELD_COUNT_SINGLE | FIELD_TYPE_BOOL:
-            if (strcmp(toLowerStr(value).c_str(), "true") == 0 || strcmp(value.c_str(), "1") == 0) {
+            if (equalsIgnoreCase(value, "true") || value == "1") {
                 proto->write(found, true);
                 break;
             }
-            if (strcmp(toLowerStr(value).c_str(), "false") == 0 || strcmp(value.c_str(), "0") == 0) {
+            if (equalsIgnoreCase(value, "false") || value == "0") {
                 proto->write(found, false);
                 break;
             }
             return false;
         case FIELD_COUNT_SINGLE | FIELD_TYPE_ENUM:
             // if the field has its own enum mapping, use this, otherwise use general name to value mapping.
-            if (mEnums.find(name) != mEnums.end()) {
-                if (mEnums[name].find(value) != mEnums[name].end()) {
-                    proto->write(found, mEnums[name][value]);
+            if (column.enumValues != NULL) {
+                auto it = column.enumValues->find(value);
+                if (it != column.enumValues->end()) {
+                    proto->write(found, it->second);
                 } else {
                     proto->write(found, 0); // TODO: should get the default enum value (Unknown)
                 }
             } else if (mEnumValuesByName.find(value) != mEnumValuesByName.end()) {
-                proto->write(found, mEnumValuesByName[value]);
+                proto->write(found, mEnumValuesByName.find(value)->second);
             } else if (isNumber(value)) {
-                proto->write(found, toInt(value));
+                proto->write(found, (int)viewToLongLong(value));
             } else {
                 return false;
             }
@@ -357,19 +461,19 @@ Table::insertField(ProtoOutputStream* proto, const std::string& name, const std:
         case FIELD_COUNT_SINGLE | FIELD_TYPE_UINT32:
         case FIELD_COUNT_SINGLE | FIELD_TYPE_FIXED32:
         case FIELD_COUNT_SINGLE | FIELD_TYPE_SFIXED32:
-            proto->write(found, toInt(value));
+            proto->write(found, (int)viewToLongLong(value));
             break;
         // REPEATED TYPE below:
         case FIELD_COUNT_REPEATED | FIELD_TYPE_INT32:
-            repeats = parseRecord(value, COMMA_DELIMITER);
+            splitRecord(value, &repeats, COMMA_DELIMITER);
             for (size_t i=0; i<repeats.size(); i++) {
-                proto->write(found, toInt(repeats[i]));
+                proto->write(found, (int)viewToLongLong(repeats[i]));
             }
             break;
         case FIELD_COUNT_REPEATED | FIELD_TYPE_STRING:
-            repeats = parseRecord(value, COMMA_DELIMITER);
+            splitRecord(value, &repeats, COMMA_DELIMITER);
             for (size_t i=0; i<repeats.size(); i++) {
-                proto->write(found, repeats[i]);
+                proto->write(found, repeats[i].data(), repeats[i].size());
             }
             break;
         default:
@@ -20,6 +20,7 @@
 #include <map>
 #include <stack>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <android/util/ProtoOutputStream.h>
@@ -28,6 +29,7 @@ using namespace android::util;
 
 typedef std::vector<std::string> header_t;
 typedef std::vector<std::string> record_t;
+typedef std::vector<std::string_view> fields_t;
 typedef std::string (*trans_func) (const std::string&);
 
 const std::string DEFAULT_WHITESPACE = " \t";
@@ -72,8 +74,18 @@ bool getColumnIndices(std::vector<int>& indices, const char* headerNames[], cons
  */
 record_t parseRecordByColumns(const std::string& line, const std::vector<int>& indices, const std::string& delimiters = DEFAULT_WHITESPACE);
 
+/**
+ * Same as parseRecord and parseRecordByColumns, but the fields point into the line instead of
+ * being copied, and the fields vector is reused, so a table is parsed without allocating once
+ * the vector has grown. The fields are only valid as long as the line.
+ */
+void splitRecord(std::string_view line, fields_t* fields, const std::string& delimiters = DEFAULT_WHITESPACE);
+void splitRecordByColumns(std::string_view line, const std::vector<int>& indices, fields_t* fields,
+        const std::string& delimiters = DEFAULT_WHITESPACE);
+
 /** Prints record_t to stderr */
 void printRecord(const record_t& record);
+void printRecord(const fields_t& record);
 
 /**
  * When the line starts/ends with the given key, the function returns true
@@ -104,7 +116,7 @@ double toDouble(const std::string& s);
 
 /**
  * Reader class reads data from given fd in streaming fashion.
- * The buffer size is controlled by capacity parameter.
+ * The line buffer is reused, and so is the string the lines are read into.
  */
 class Reader
 {
@@ -118,6 +130,8 @@ public:
 private:
     FILE* mFile;
     std::string mStatus;
+    char* mBuffer;
+    size_t mBufferSize;
 };
 
 /**
@@ -136,6 +150,15 @@ class Table
 {
 friend class Message;
 public:
+    /**
+     * A column of the text resolved once to its field, usually from the header, so that its
+     * values are inserted without looking up the name. fieldId is 0 if it has no field.
+     */
+    struct Column {
+        uint64_t fieldId;
+        const std::map<std::string, int, std::less<>>* enumValues;  // NULL if the field has none
+    };
+
     Table(const char* names[], const uint64_t ids[], const int count);
     ~Table();
 
@@ -149,10 +172,18 @@ public:
     // Based on given name, find the right field id, parse the text value and insert to proto.
     // Return false if the given name can't be found.
     bool insertField(ProtoOutputStream* proto, const std::string& name, const std::string& value);
+
+    // Resolves the column of each name of the header, the enum maps must be added before.
+    Column getColumn(const std::string& name) const;
+    std::vector<Column> getColumns(const header_t& header) const;
+
+    // Parses the text value and inserts it to the column's field.
+    // Return false if the column has no field or the value is bad.
+    bool insertField(ProtoOutputStream* proto, const Column& column, std::string_view value);
 private:
     std::map<std::string, uint64_t> mFields;
-    std::map<std::string, std::map<std::string, int>> mEnums;
-    std::map<std::string, int> mEnumValuesByName;
+    std::map<std::string, std::map<std::string, int, std::less<>>> mEnums;
+    std::map<std::string, int, std::less<>> mEnumValuesByName;
 };
 
 /**
@@ -47,7 +47,8 @@ CpuInfoParser::Parse(const int in, const int out) const
     string line;
     header_t header;
     vector<int> columnIndices; // task table can't be split by purely delimiter, needs column positions.
-    record_t record;
+    vector<Table::Column> columns;  // the field of each column of the header
+    fields_t record;
     int nline = 0;
     int diff = 0;
     bool nextToSwap = false;
@@ -106,6 +107,7 @@ CpuInfoParser::Parse(const int in, const int out) const
             // After parsing, header = { PID, TID, USER, PR, NI, CPU, S, VIRT, RES, PCY, CMD, NAME }
             // And columnIndices will contain end index of each word.
             header = parseHeader(line, "[ %]");
+            columns = table.getColumns(header);
             nextToUsage = false;
 
             // NAME is not in the list since we need to modify the end of the CMD index.
@@ -126,7 +128,7 @@ CpuInfoParser::Parse(const int in, const int out) const
             continue;
         }
 
-        record = parseRecordByColumns(line, columnIndices);
+        splitRecordByColumns(line, columnIndices, &record);
         diff = record.size() - header.size();
         if (diff < 0) {
             fprintf(stderr, "[%s]Line %d has %d missing fields\n%s\n", this->name.string(), nline, -diff, line.c_str());
@@ -140,9 +142,10 @@ CpuInfoParser::Parse(const int in, const int out) const
 
         uint64_t token = proto.start(CpuInfoProto::TASKS);
         for (int i=0; i<(int)record.size(); i++) {
-            if (!table.insertField(&proto, header[i], record[i])) {
-                fprintf(stderr, "[%s]Line %d fails to insert field %s with value %s\n",
-                        this->name.string(), nline, header[i].c_str(), record[i].c_str());
+            if (!table.insertField(&proto, columns[i], record[i])) {
+                fprintf(stderr, "[%s]Line %d fails to insert field %s with value %.*s\n",
+                        this->name.string(), nline, header[i].c_str(), (int)record[i].size(),
+                        record[i].data());
             }
         }
         proto.end(token);
@@ -29,7 +29,8 @@ ProcrankParser::Parse(const int in, const int out) const
     Reader reader(in);
     string line;
     header_t header;  // the header of /d/wakeup_sources
-    record_t record;  // retain each record
+    vector<Table::Column> columns;  // the field of each column of the header
+    fields_t record;  // retain each record
     int nline = 0;
 
     ProtoOutputStream proto;
@@ -43,6 +44,7 @@ ProcrankParser::Parse(const int in, const int out) const
         // parse head line
         if (nline++ == 0) {
             header = parseHeader(line);
+            columns = table.getColumns(header);
             continue;
         }
 
@@ -55,7 +57,7 @@ ProcrankParser::Parse(const int in, const int out) const
             continue;
         }
 
-        record = parseRecord(line);
+        splitRecord(line, &record);
         if (record.size() != header.size()) {
             if (record[record.size() - 1] == "TOTAL") { // TOTAL record
                 total = line;
@@ -68,9 +70,10 @@ ProcrankParser::Parse(const int in, const int out) const
 
         uint64_t token = proto.start(ProcrankProto::PROCESSES);
         for (int i=0; i<(int)record.size(); i++) {
-            if (!table.insertField(&proto, header[i], record[i])) {
-                fprintf(stderr, "[%s]Line %d has bad value %s of %s\n",
-                        this->name.string(), nline, header[i].c_str(), record[i].c_str());
+            if (!table.insertField(&proto, columns[i], record[i])) {
+                fprintf(stderr, "[%s]Line %d has bad value %s of %.*s\n",
+                        this->name.string(), nline, header[i].c_str(), (int)record[i].size(),
+                        record[i].data());
             }
         }
         proto.end(token);
@@ -79,10 +82,10 @@ ProcrankParser::Parse(const int in, const int out) const
     // add summary
     uint64_t token = proto.start(ProcrankProto::SUMMARY);
     if (!total.empty()) {
-        record = parseRecord(total);
+        splitRecord(total, &record);
         uint64_t token = proto.start(ProcrankProto::Summary::TOTAL);
         for (int i=(int)record.size(); i>0; i--) {
-            table.insertField(&proto, header[header.size() - i].c_str(), record[record.size() - i].c_str());
+            table.insertField(&proto, columns[columns.size() - i], record[record.size() - i]);
         }
         proto.end(token);
     }
@@ -28,7 +28,8 @@ status_t PsParser::Parse(const int in, const int out) const {
     string line;
     header_t header;  // the header of /d/wakeup_sources
     vector<int> columnIndices; // task table can't be split by purely delimiter, needs column positions.
-    record_t record;  // retain each record
+    vector<Table::Column> columns;  // the field of each column of the header
+    fields_t record;  // retain each record
     int nline = 0;
     int diff = 0;
 
@@ -47,6 +48,7 @@ status_t PsParser::Parse(const int in, const int out) const {
 
         if (nline++ == 0) {
             header = parseHeader(line, DEFAULT_WHITESPACE);
+            columns = table.getColumns(header);
 
             const char* headerNames[] = { "LABEL", "USER", "PID", "TID", "PPID", "VSZ", "RSS", "WCHAN", "ADDR", "S", "PRI", "NI", "RTPRIO", "SCH", "PCY", "TIME", "CMD", NULL };
             if (!getColumnIndices(columnIndices, headerNames, line)) {
@@ -56,7 +58,7 @@ status_t PsParser::Parse(const int in, const int out) const {
             continue;
         }
 
-        record = parseRecordByColumns(line, columnIndices);
+        splitRecordByColumns(line, columnIndices, &record);
 
         diff = record.size() - header.size();
         if (diff < 0) {
@@ -73,9 +75,10 @@ status_t PsParser::Parse(const int in, const int out) const {
 
         uint64_t token = proto.start(PsProto::PROCESSES);
         for (int i=0; i<(int)record.size(); i++) {
-            if (!table.insertField(&proto, header[i], record[i])) {
-                fprintf(stderr, "[%s]Line %d has bad value %s of %s\n",
-                        this->name.string(), nline, header[i].c_str(), record[i].c_str());
+            if (!table.insertField(&proto, columns[i], record[i])) {
+                fprintf(stderr, "[%s]Line %d has bad value %s of %.*s\n",
+                        this->name.string(), nline, header[i].c_str(), (int)record[i].size(),
+                        record[i].data());
             }
         }
         proto.end(token);
@@ -100,6 +100,28 @@ TEST(IhUtilTest, ParseRecordByColumns) {
     EXPECT_EQ(expected, result);
 }
 
+TEST(IhUtilTest, SplitRecord) {
+    fields_t result, expected;
+    std::string line = " \t 100 00\toooh \t wqrw";
+    splitRecord(line, &result);
+    expected = { "100", "00", "oooh", "wqrw" };
+    EXPECT_EQ(expected, result);
+    // The fields point into the line.
+    EXPECT_EQ(line.data() + 3, result[0].data());
+
+    // The fields are replaced, not appended.
+    splitRecord("123,456", &result, ",");
+    expected = { "123", "456" };
+    EXPECT_EQ(expected, result);
+
+    splitRecordByColumns("abc \t2345  6789 ", { 3, 10 }, &result);
+    expected = { "abc", "2345  6789" };
+    EXPECT_EQ(expected, result);
+
+    splitRecordByColumns("12345", { 3, 10 }, &result);
+    EXPECT_TRUE(result.empty());
+}
+
 TEST(IhUtilTest, stripPrefix) {
     string data1 = "Swap: abc ";
     EXPECT_TRUE(stripPrefix(&data1, "Swap:"));
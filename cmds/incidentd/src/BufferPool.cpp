@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define DEBUG false
+#include "Log.h"
+
+#include "BufferPool.h"
+
+#include <stdlib.h>
+#include <chrono>
+
+namespace android {
+namespace os {
+namespace incidentd {
+
+BufferPool::BufferPool(size_t chunkSize, size_t maxChunks, size_t maxIdleChunks,
+                       int64_t waitTimeoutMs)
+    : mChunkSize(chunkSize),
+      mMaxChunks(maxChunks),
+      mMaxIdleChunks(maxIdleChunks),
+      mWaitTimeoutMs(waitTimeoutMs),
+      mIdleChunks(),
+      mUsedChunks(0) {}
+
+BufferPool::~BufferPool() {
+    for (uint8_t* chunk : mIdleChunks) {
+        free(chunk);
+    }
+}
+
+uint8_t* BufferPool::allocate(size_t chunkSize) {
+    if (chunkSize != mChunkSize) {
+        return (uint8_t*)malloc(chunkSize);
+    }
+
+    std::unique_lock<std::mutex> lock(mLock);
+    auto available = [this] {
+        return !mIdleChunks.empty() || mUsedChunks + mIdleChunks.size() < mMaxChunks;
+    };
+    if (!mReleased.wait_for(lock, std::chrono::milliseconds(mWaitTimeoutMs), available)) {
+        ALOGW("No buffer chunk released in %lld ms, %zu chunks are used",
+              (long long)mWaitTimeoutMs, mUsedChunks);
+        return NULL;
+    }
+
+    uint8_t* chunk;
+    if (!mIdleChunks.empty()) {
+        chunk = mIdleChunks.back();
+        mIdleChunks.pop_back();
+    } else {
+        chunk = (uint8_t*)malloc(mChunkSize);
+        if (chunk == NULL) return NULL;
+    }
+    mUsedChunks++;
+    return chunk;
+}
+
+void BufferPool::release(uint8_t* chunk, size_t chunkSize) {
+    if (chunkSize != mChunkSize) {
+        free(chunk);
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mLock);
+        mUsedChunks--;
+        if (mIdleChunks.size() < mMaxIdleChunks) {
+            mIdleChunks.push_back(chunk);
+            chunk = NULL;
+        }
+    }
+    free(chunk);
+    mReleased.notify_one();
+}
+
+size_t BufferPool::usedChunks() {
+    std::unique_lock<std::mutex> lock(mLock);
+    return mUsedChunks;
+}
+
+}  // namespace incidentd
+}  // namespace os
+}  // namespace android
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <android/util/EncodedBuffer.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace android {
+namespace os {
+namespace incidentd {
+
+using namespace android::util;
+
+/**
+ * Fixed-size chunks shared by many EncodedBuffers. The released chunks are kept for the next
+ * buffers instead of going back to the allocator, and there are never more than maxChunks.
+ * When they're all taken, allocate() waits for one to be released, up to waitTimeoutMs, and
+ * then returns NULL, so the buffers slow down instead of overrunning the memory.
+ */
+class BufferPool : public EncodedBuffer::Allocator {
+public:
+    BufferPool(size_t chunkSize, size_t maxChunks, size_t maxIdleChunks, int64_t waitTimeoutMs);
+    virtual ~BufferPool();
+
+    // Chunks of other sizes than the pool's come straight from malloc.
+    virtual uint8_t* allocate(size_t chunkSize);
+    virtual void release(uint8_t* chunk, size_t chunkSize);
+
+    // The number of chunks given to the buffers.
+    size_t usedChunks();
+
+private:
+    const size_t mChunkSize;
+    const size_t mMaxChunks;
+    const size_t mMaxIdleChunks;
+    const int64_t mWaitTimeoutMs;
+
+    // Lock protects the fields below, the sections fill their buffers in parallel.
+    std::mutex mLock;
+    std::condition_variable mReleased;
+    std::vector<uint8_t*> mIdleChunks;
+    size_t mUsedChunks;
+};
+
+}  // namespace incidentd
+}  // namespace os
+}  // namespace android
+
+#endif  // BUFFER_POOL_H
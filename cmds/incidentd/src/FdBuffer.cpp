@@ -17,6 +17,7 @@
 #include "Log.h"
 
 #include "FdBuffer.h"
+#include "BufferPool.h"
 
 #include <cutils/log.h>
 #include <utils/SystemClock.h>
@@ -33,8 +34,25 @@ namespace incidentd {
 const ssize_t BUFFER_SIZE = 16 * 1024;  // 16 KB
 const ssize_t MAX_BUFFER_COUNT = 256;   // 4 MB max
 
+// All the sections share the chunks of one pool, so running them in parallel stays within a
+// fixed amount of memory. A section waits that long for a chunk before truncating its data.
+const size_t POOL_MAX_CHUNKS = 2048;       // 32 MB max
+const size_t POOL_MAX_IDLE_CHUNKS = 64;    // 1 MB kept for the next sections
+const int64_t POOL_WAIT_TIMEOUT_MS = 5000;  // 5 seconds
+
+static BufferPool* section_buffer_pool() {
+    // Never destroyed, the buffers may be released at exit.
+    static BufferPool* pool = new BufferPool(BUFFER_SIZE, POOL_MAX_CHUNKS, POOL_MAX_IDLE_CHUNKS,
+                                             POOL_WAIT_TIMEOUT_MS);
+    return pool;
+}
+
 FdBuffer::FdBuffer()
-    : mBuffer(BUFFER_SIZE), mStartTime(-1), mFinishTime(-1), mTimedOut(false), mTruncated(false) {}
+    : mBuffer(BUFFER_SIZE, section_buffer_pool()),
+      mStartTime(-1),
+      mFinishTime(-1),
+      mTimedOut(false),
+      mTruncated(false) {}
 
 FdBuffer::~FdBuffer() {}
 
@@ -49,7 +67,11 @@ status_t FdBuffer::read(int fd, int64_t timeout) {
             mTruncated = true;
             break;
         }
-        if (mBuffer.writeBuffer() == NULL) return NO_MEMORY;
+        if (mBuffer.writeBuffer() == NULL) {
+            // The pool stayed exhausted, keeps what was read like when the data is too big.
+            mTruncated = true;
+            break;
+        }
 
         int64_t remainingTime = (mStartTime + timeout) - uptimeMillis();
         if (remainingTime <= 0) {
@@ -101,7 +123,11 @@ status_t FdBuffer::readFully(int fd) {
             VLOG("Truncating data");
             break;
         }
-        if (mBuffer.writeBuffer() == NULL) return NO_MEMORY;
+        if (mBuffer.writeBuffer() == NULL) {
+            // The pool stayed exhausted, keeps what was read like when the data is too big.
+            mTruncated = true;
+            break;
+        }
 
         ssize_t amt =
                 TEMP_FAILURE_RETRY(::read(fd, mBuffer.writeBuffer(), mBuffer.currentToWrite()));
@@ -135,6 +161,10 @@ status_t FdBuffer::readProcessedDataInStream(int fd, unique_fd toFd, unique_fd f
     fcntl(toFd.get(), F_SETFL, fcntl(toFd.get(), F_GETFL, 0) | O_NONBLOCK);
     fcntl(fromFd.get(), F_SETFL, fcntl(fromFd.get(), F_GETFL, 0) | O_NONBLOCK);
 
+    // Moves the data from fd to the parsing process in the kernel, without copying it here. Not
+    // all files can be spliced, e.g. some in sysfs, then falls back to copying it.
+    bool useSplice = true;
+
     // A circular buffer holds data read from fd and writes to parsing process
     uint8_t cirBuf[BUFFER_SIZE];
     size_t cirSize = 0;
@@ -146,7 +176,11 @@ status_t FdBuffer::readProcessedDataInStream(int fd, unique_fd toFd, unique_fd f
             mTruncated = true;
             break;
         }
-        if (mBuffer.writeBuffer() == NULL) return NO_MEMORY;
+        if (mBuffer.writeBuffer() == NULL) {
+            // The pool stayed exhausted, keeps what was read like when the data is too big.
+            mTruncated = true;
+            break;
+        }
 
         int64_t remainingTime = (mStartTime + timeoutMs) - uptimeMillis();
         if (remainingTime <= 0) {
@@ -178,8 +212,25 @@ status_t FdBuffer::readProcessedDataInStream(int fd, unique_fd toFd, unique_fd f
             }
         }
 
+        // splice from fd to parsing process
+        if (useSplice && pfds[0].fd != -1) {
+            ssize_t amt = splice(fd, NULL, toFd.get(), NULL, BUFFER_SIZE, SPLICE_F_NONBLOCK);
+            if (amt < 0) {
+                if (errno == EINVAL || errno == ENOSYS) {
+                    VLOG("Can't splice fd %d, copying it instead", fd);
+                    useSplice = false;
+                } else if (!(errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    VLOG("Fail to splice fd %d: %s", fd, strerror(errno));
+                    return -errno;
+                }  // otherwise just continue
+            } else if (amt == 0) {
+                VLOG("Reached EOF of input file %d", fd);
+                pfds[0].fd = -1;  // reach EOF so don't have to poll pfds[0].
+            }
+        }
+
         // read from fd
-        if (cirSize != BUFFER_SIZE && pfds[0].fd != -1) {
+        if (!useSplice && cirSize != BUFFER_SIZE && pfds[0].fd != -1) {
             ssize_t amt;
             if (rpos >= wpos) {
                 amt = ::read(fd, cirBuf + rpos, BUFFER_SIZE - rpos);
@@ -55,7 +55,8 @@ public:
      * The parsing process provides IO fds which are 'toFd' and 'fromFd'. The function
      * reads original data in 'fd' and writes to parsing process through 'toFd', then it reads
      * and stores the processed data from 'fromFd' in memory for later usage.
-     * This function behaves in a streaming fashion in order to save memory usage.
+     * This function behaves in a streaming fashion in order to save memory usage. The original
+     * data is spliced to 'toFd' when the kernel supports it for 'fd', and copied otherwise.
      * Returns NO_ERROR if there were no errors or if we timed out.
      *
      * Poll will return POLLERR if fd is from sysfs, handle this edge case.
@@ -74,7 +75,8 @@ public:
      * anyway because they could be cut off for a lot of reasons and it's best
      * to get as much useful information out of the system as possible. If this
      * happens, truncated() will return true so it can be marked. If the data is
-     * exactly 4 MB, truncated is still set. Sorry.
+     * exactly 4 MB, truncated is still set. Sorry. The data is also truncated when the
+     * sections together use all the memory of their buffers for too long.
      */
     bool truncated() const { return mTruncated; }
 
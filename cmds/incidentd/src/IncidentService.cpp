@@ -24,6 +24,7 @@
 #include "incidentd_util.h"
 #include "section_list.h"
 
+#include <android/util/ScopeTimer.h>
 #include <binder/IPCThreadState.h>
 #include <binder/IResultReceiver.h>
 #include <binder/IServiceManager.h>
@@ -34,12 +35,14 @@
 
 #include <unistd.h>
 
-enum { WHAT_RUN_REPORT = 1, WHAT_SEND_BACKLOG_TO_DROPBOX = 2 };
+enum { WHAT_RUN_REPORT = 1, WHAT_SEND_BACKLOG_TO_DROPBOX = 2, WHAT_EVICT_SECTION_CACHE = 3 };
 
 #define DEFAULT_BACKLOG_DELAY_NS (1000000000LL)
 
 #define DEFAULT_BYTES_SIZE_LIMIT (20 * 1024 * 1024)        // 20MB
 #define DEFAULT_REFACTORY_PERIOD_MS (24 * 60 * 60 * 1000)  // 1 Day
+#define DEFAULT_SECTION_CACHE_TTL_MS (10 * 1000)           // 10 seconds
+#define DEFAULT_SECTION_CACHE_SIZE_LIMIT (16 * 1024 * 1024)  // 16MB
 
 namespace android {
 namespace os {
@@ -118,11 +121,13 @@ sp<ReportRequest> ReportRequestQueue::getNextRequest() {
 
 // ================================================================================
 ReportHandler::ReportHandler(const sp<Looper>& handlerLooper, const sp<ReportRequestQueue>& queue,
-                             const sp<Throttler>& throttler)
+                             const sp<Throttler>& throttler,
+                             const sp<SectionCache>& sectionCache)
     : mBacklogDelay(DEFAULT_BACKLOG_DELAY_NS),
       mHandlerLooper(handlerLooper),
       mQueue(queue),
-      mThrottler(throttler) {}
+      mThrottler(throttler),
+      mSectionCache(sectionCache) {}
 
 ReportHandler::~ReportHandler() {}
 
@@ -134,6 +139,9 @@ void ReportHandler::handleMessage(const Message& message) {
         case WHAT_SEND_BACKLOG_TO_DROPBOX:
             send_backlog_to_dropbox();
             break;
+        case WHAT_EVICT_SECTION_CACHE:
+            mSectionCache->evictExpired();
+            break;
     }
 }
 
@@ -167,10 +175,14 @@ void ReportHandler::run_report() {
         reporter->batch.add(request);
     }
 
-    if (mThrottler->shouldThrottle()) {
+    // Over the budget, only the sections that were asked for specifically are taken.
+    if (mThrottler->shouldThrottle() && !reporter->batch.hasRequestedSections()) {
         ALOGW("RunReport got throttled.");
         return;
     }
+    reporter->setThrottler(mThrottler);
+    // Reports taken close together share the sections' captures.
+    reporter->batch.setSectionCache(mSectionCache);
 
     // Take the report, which might take a while. More requests might queue
     // up while we're doing this, and we'll handle them in their next batch.
@@ -178,6 +190,12 @@ void ReportHandler::run_report() {
     size_t reportByteSize = 0;
     Reporter::run_report_status_t reportStatus = reporter->runReport(&reportByteSize);
     mThrottler->addReportSize(reportByteSize);
+
+    // The captures of this batch would stay in memory until the next report otherwise.
+    mHandlerLooper->removeMessages(this, WHAT_EVICT_SECTION_CACHE);
+    mHandlerLooper->sendMessageDelayed(ms2ns(mSectionCache->ttlMs() + 1), this,
+                                       Message(WHAT_EVICT_SECTION_CACHE));
+
     if (reportStatus == Reporter::REPORT_NEEDS_DROPBOX) {
         unique_lock<mutex> lock(mLock);
         schedule_send_backlog_to_dropbox_locked();
@@ -200,8 +218,10 @@ void ReportHandler::send_backlog_to_dropbox() {
 // ================================================================================
 IncidentService::IncidentService(const sp<Looper>& handlerLooper)
     : mQueue(new ReportRequestQueue()),
-      mThrottler(new Throttler(DEFAULT_BYTES_SIZE_LIMIT, DEFAULT_REFACTORY_PERIOD_MS)) {
-    mHandler = new ReportHandler(handlerLooper, mQueue, mThrottler);
+      mThrottler(new Throttler(DEFAULT_BYTES_SIZE_LIMIT, DEFAULT_REFACTORY_PERIOD_MS)),
+      mSectionCache(
+              new SectionCache(DEFAULT_SECTION_CACHE_TTL_MS, DEFAULT_SECTION_CACHE_SIZE_LIMIT)) {
+    mHandler = new ReportHandler(handlerLooper, mQueue, mThrottler, mSectionCache);
 }
 
 IncidentService::~IncidentService() {}
@@ -314,6 +334,14 @@ status_t IncidentService::command(FILE* in, FILE* out, FILE* err, Vector<String8
             mThrottler->dump(out);
             return NO_ERROR;
         }
+        if (!args[0].compare(String8("section_cache"))) {
+            mSectionCache->dump(out);
+            return NO_ERROR;
+        }
+        if (!args[0].compare(String8("scope_timers"))) {
+            android::util::ScopeTimer::dump(out);
+            return NO_ERROR;
+        }
     }
     return cmd_help(out);
 }
@@ -325,6 +353,12 @@ status_t IncidentService::cmd_help(FILE* out) {
     fprintf(out, "\n");
     fprintf(out, "usage: adb shell cmd incident throttler\n");
     fprintf(out, "    Prints the current throttler state\n");
+    fprintf(out, "\n");
+    fprintf(out, "usage: adb shell cmd incident section_cache\n");
+    fprintf(out, "    Prints the section captures kept for the next reports\n");
+    fprintf(out, "\n");
+    fprintf(out, "usage: adb shell cmd incident scope_timers\n");
+    fprintf(out, "    Prints the time spent in the timed scopes of incidentd\n");
     return NO_ERROR;
 }
 
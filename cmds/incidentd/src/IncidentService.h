@@ -26,6 +26,7 @@
 #include <deque>
 #include <mutex>
 
+#include "SectionCache.h"
 #include "Throttler.h"
 
 namespace android {
@@ -55,7 +56,7 @@ private:
 class ReportHandler : public MessageHandler {
 public:
     ReportHandler(const sp<Looper>& handlerLooper, const sp<ReportRequestQueue>& queue,
-                  const sp<Throttler>& throttler);
+                  const sp<Throttler>& throttler, const sp<SectionCache>& sectionCache);
     virtual ~ReportHandler();
 
     virtual void handleMessage(const Message& message);
@@ -77,6 +78,7 @@ private:
     sp<Looper> mHandlerLooper;
     sp<ReportRequestQueue> mQueue;
     sp<Throttler> mThrottler;
+    sp<SectionCache> mSectionCache;
 
     /**
      * Runs all of the reports that have been queued.
@@ -117,6 +119,7 @@ private:
     sp<ReportRequestQueue> mQueue;
     sp<ReportHandler> mHandler;
     sp<Throttler> mThrottler;
+    sp<SectionCache> mSectionCache;
 
     /**
      * Commands print out help.
@@ -28,10 +28,10 @@ namespace os {
 namespace incidentd {
 
 /**
- * Write the field to buf based on the wire type, iterator will point to next field.
- * If skip is set to true, no data will be written to buf. Return number of bytes written.
+ * Write the field to the outputs in mWriters based on the wire type, iterator will point to next
+ * field. If mWriters is empty, the field is skipped.
  */
-void PrivacyBuffer::writeFieldOrSkip(uint32_t fieldTag, bool skip) {
+void PrivacyBuffer::writeField(uint32_t fieldTag) {
     uint8_t wireType = read_wire_type(fieldTag);
     size_t bytesToWrite = 0;
     uint64_t varint = 0;
@@ -39,41 +39,45 @@ void PrivacyBuffer::writeFieldOrSkip(uint32_t fieldTag, bool skip) {
     switch (wireType) {
         case WIRE_TYPE_VARINT:
             varint = mData.readRawVarint();
-            if (!skip) {
-                mProto.writeRawVarint(fieldTag);
-                mProto.writeRawVarint(varint);
+            for (auto proto : mWriters) {
+                proto->writeRawVarint(fieldTag);
+                proto->writeRawVarint(varint);
             }
             return;
         case WIRE_TYPE_FIXED64:
-            if (!skip) mProto.writeRawVarint(fieldTag);
+            for (auto proto : mWriters) proto->writeRawVarint(fieldTag);
             bytesToWrite = 8;
             break;
         case WIRE_TYPE_LENGTH_DELIMITED:
             bytesToWrite = mData.readRawVarint();
-            if (!skip) mProto.writeLengthDelimitedHeader(read_field_id(fieldTag), bytesToWrite);
+            for (auto proto : mWriters) {
+                proto->writeLengthDelimitedHeader(read_field_id(fieldTag), bytesToWrite);
+            }
             break;
         case WIRE_TYPE_FIXED32:
-            if (!skip) mProto.writeRawVarint(fieldTag);
+            for (auto proto : mWriters) proto->writeRawVarint(fieldTag);
             bytesToWrite = 4;
             break;
     }
-    if (skip) {
+    if (mWriters.empty()) {
         mData.rp()->move(bytesToWrite);
     } else {
         for (size_t i = 0; i < bytesToWrite; i++) {
-            mProto.writeRawByte(mData.next());
+            uint8_t byte = mData.next();
+            for (auto proto : mWriters) proto->writeRawByte(byte);
         }
     }
 }
 
 /**
- * Strip next field based on its private policy and request spec, then stores data in buf.
- * Return NO_ERROR if succeeds, otherwise BAD_VALUE is returned to indicate bad data in FdBuffer.
+ * Strip next field based on its private policy and the specs of mStripped, then stores data in
+ * their buffers. Return NO_ERROR if succeeds, otherwise BAD_VALUE is returned to indicate bad data
+ * in FdBuffer.
  *
  * The iterator must point to the head of a protobuf formatted field for successful operation.
  * After exit with NO_ERROR, iterator points to the next protobuf field's head.
  */
-status_t PrivacyBuffer::stripField(const Privacy* parentPolicy, const PrivacySpec& spec,
+status_t PrivacyBuffer::stripField(const Privacy* parentPolicy,
                                    int depth /* use as a counter for this recusive method. */) {
     if (!mData.hasNext() || parentPolicy == NULL) return BAD_VALUE;
     uint32_t fieldTag = mData.readRawVarint();
@@ -82,59 +86,106 @@ status_t PrivacyBuffer::stripField(const Privacy* parentPolicy, const PrivacySpe
 
     VLOG("[Depth %2d]Try to strip id %d, wiretype %d", depth, fieldId, read_wire_type(fieldTag));
     if (policy == NULL || policy->children == NULL) {
-        bool skip = !spec.CheckPremission(policy, parentPolicy->dest);
+        mWriters.clear();
+        for (auto output : mStripped) {
+            if (output->spec.CheckPremission(policy, parentPolicy->dest)) {
+                mWriters.push_back(&output->proto);
+            }
+        }
         // iterator will point to head of next field
         size_t currentAt = mData.rp()->pos();
-        writeFieldOrSkip(fieldTag, skip);
-        VLOG("[Depth %2d]Field %d %ss %d bytes", depth, fieldId, skip ? "skip" : "write",
-             (int)(get_varint_size(fieldTag) + mData.rp()->pos() - currentAt));
+        writeField(fieldTag);
+        VLOG("[Depth %2d]Field %d written to %zu outputs, %d bytes", depth, fieldId,
+             mWriters.size(), (int)(get_varint_size(fieldTag) + mData.rp()->pos() - currentAt));
         return NO_ERROR;
     }
     // current field is message type and its sub-fields have extra privacy policies
     uint32_t msgSize = mData.readRawVarint();
     size_t start = mData.rp()->pos();
-    uint64_t token = mProto.start(encode_field_id(policy));
+    std::vector<uint64_t> tokens;
+    for (auto output : mStripped) {
+        tokens.push_back(output->proto.start(encode_field_id(policy)));
+    }
     while (mData.rp()->pos() - start != msgSize) {
-        status_t err = stripField(policy, spec, depth + 1);
+        status_t err = stripField(policy, depth + 1);
         if (err != NO_ERROR) return err;
     }
-    mProto.end(token);
+    for (size_t i = 0; i < mStripped.size(); i++) {
+        mStripped[i]->proto.end(tokens[i]);
+    }
     return NO_ERROR;
 }
 
 // ================================================================================
 PrivacyBuffer::PrivacyBuffer(const Privacy* policy, EncodedBuffer::iterator data)
-    : mPolicy(policy), mData(data), mProto(), mSize(0) {}
+    : mPolicy(policy), mData(data), mOutputs(), mStripped(), mWriters() {}
 
 PrivacyBuffer::~PrivacyBuffer() {}
 
 status_t PrivacyBuffer::strip(const PrivacySpec& spec) {
-    VLOG("Strip with spec %d", spec.dest);
-    // optimization when no strip happens
-    if (mPolicy == NULL || mPolicy->children == NULL || spec.RequireAll()) {
-        if (spec.CheckPremission(mPolicy)) mSize = mData.size();
-        return NO_ERROR;
+    return strip(std::vector<PrivacySpec>{spec});
+}
+
+status_t PrivacyBuffer::strip(const std::vector<PrivacySpec>& specs) {
+    clear();
+    for (const PrivacySpec& spec : specs) {
+        VLOG("Strip with spec %d", spec.dest);
+        mOutputs.emplace_back(new Output(spec));
+        Output* output = mOutputs.back().get();
+        // optimization when no strip happens
+        if (mPolicy == NULL || mPolicy->children == NULL || spec.RequireAll()) {
+            if (spec.CheckPremission(mPolicy)) output->size = mData.size();
+        } else {
+            output->stripped = true;
+            mStripped.push_back(output);
+        }
     }
+    if (mStripped.empty()) return NO_ERROR;
+
+    // One pass over the data writes all the outputs that need stripping.
     while (mData.hasNext()) {
-        status_t err = stripField(mPolicy, spec, 0);
+        status_t err = stripField(mPolicy, 0);
         if (err != NO_ERROR) return err;
     }
     if (mData.bytesRead() != mData.size()) return BAD_VALUE;
-    mSize = mProto.size();
+    for (auto output : mStripped) {
+        output->size = output->proto.size();
+    }
     mData.rp()->rewind();  // rewind the read pointer back to beginning after the strip.
     return NO_ERROR;
 }
 
 void PrivacyBuffer::clear() {
-    mSize = 0;
-    mProto.clear();
+    mOutputs.clear();
+    mStripped.clear();
 }
 
-size_t PrivacyBuffer::size() const { return mSize; }
+PrivacyBuffer::Output* PrivacyBuffer::findOutput(const PrivacySpec& spec) const {
+    for (const auto& output : mOutputs) {
+        if (output->spec.dest == spec.dest) return output.get();
+    }
+    return NULL;
+}
+
+size_t PrivacyBuffer::size() const { return mOutputs.empty() ? 0 : mOutputs[0]->size; }
+
+size_t PrivacyBuffer::size(const PrivacySpec& spec) const {
+    Output* output = findOutput(spec);
+    return output == NULL ? 0 : output->size;
+}
 
 status_t PrivacyBuffer::flush(int fd) {
+    return flush(mOutputs.empty() ? NULL : mOutputs[0].get(), fd);
+}
+
+status_t PrivacyBuffer::flush(const PrivacySpec& spec, int fd) {
+    return flush(findOutput(spec), fd);
+}
+
+status_t PrivacyBuffer::flush(Output* output, int fd) {
+    if (output == NULL || output->size == 0) return NO_ERROR;
     status_t err = NO_ERROR;
-    EncodedBuffer::iterator iter = size() == mData.size() ? mData : mProto.data();
+    EncodedBuffer::iterator iter = output->stripped ? output->proto.data() : mData;
     while (iter.readBuffer() != NULL) {
         err = WriteFully(fd, iter.readBuffer(), iter.currentToRead()) ? NO_ERROR : -errno;
         iter.rp()->move(iter.currentToRead());
@@ -25,6 +25,9 @@
 #include <stdint.h>
 #include <utils/Errors.h>
 
+#include <memory>
+#include <vector>
+
 namespace android {
 namespace os {
 namespace incidentd {
@@ -47,29 +50,63 @@ public:
     status_t strip(const PrivacySpec& spec);
 
     /**
-     * Clear encoded buffer so it can be reused by another request.
+     * Strip for all the specs in a single pass over the data, each result is held in its own
+     * buffer. Return NO_ERROR if strip succeeds.
+     */
+    status_t strip(const std::vector<PrivacySpec>& specs);
+
+    /**
+     * Clear encoded buffers so they can be reused by other requests.
      */
     void clear();
 
     /**
-     * Return the size of the stripped data.
+     * Return the size of the stripped data, for the first spec.
      */
     size_t size() const;
 
     /**
-     * Flush buffer to the given fd. NO_ERROR is returned if the flush succeeds.
+     * Return the size of the data stripped for the spec, which must have been given to strip.
+     */
+    size_t size(const PrivacySpec& spec) const;
+
+    /**
+     * Flush buffer to the given fd, for the first spec. NO_ERROR is returned if the flush
+     * succeeds.
      */
     status_t flush(int fd);
 
+    /**
+     * Flush the data stripped for the spec to the given fd. NO_ERROR is returned if the flush
+     * succeeds.
+     */
+    status_t flush(const PrivacySpec& spec, int fd);
+
 private:
+    // The data stripped for one spec.
+    struct Output {
+        explicit Output(const PrivacySpec& spec) : spec(spec), stripped(false), size(0) {}
+
+        const PrivacySpec spec;
+        // False if the spec keeps all the data or none of it, then proto is unused.
+        bool stripped;
+        ProtoOutputStream proto;
+        size_t size;
+    };
+
     const Privacy* mPolicy;
     EncodedBuffer::iterator mData;
 
-    ProtoOutputStream mProto;
-    size_t mSize;
+    std::vector<std::unique_ptr<Output>> mOutputs;
+    // The outputs that are being stripped.
+    std::vector<Output*> mStripped;
+    // The outputs that keep the current field, reused for every field.
+    std::vector<ProtoOutputStream*> mWriters;
 
-    status_t stripField(const Privacy* parentPolicy, const PrivacySpec& spec, int depth);
-    void writeFieldOrSkip(uint32_t fieldTag, bool skip);
+    Output* findOutput(const PrivacySpec& spec) const;
+    status_t flush(Output* output, int fd);
+    status_t stripField(const Privacy* parentPolicy, int depth);
+    void writeField(uint32_t fieldTag);
 };
 
 }  // namespace incidentd
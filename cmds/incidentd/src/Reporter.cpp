@@ -32,13 +32,20 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <algorithm>
 #include <string>
+#include <thread>
 
 /**
  * The directory where the incident reports are stored.
  */
 static const char* INCIDENT_DIRECTORY = "/data/misc/incidents/";
 
+/**
+ * The number of sections waiting on the same kind of resource that run at the same time.
+ */
+static const size_t SECTION_THREADS_PER_RESOURCE = 2;
+
 namespace android {
 namespace os {
 namespace incidentd {
@@ -59,7 +66,14 @@ bool ReportRequest::ok() { return fd >= 0 && err == NO_ERROR; }
 
 // ================================================================================
 ReportRequestSet::ReportRequestSet()
-    : mRequests(), mSections(), mMainFd(-1), mMainDest(-1), mMetadata(), mSectionStats() {}
+    : mRequests(),
+      mSections(),
+      mMainFd(-1),
+      mMainDest(-1),
+      mMetadata(),
+      mSectionStats(),
+      mNextSection(0),
+      mStopped(false) {}
 
 ReportRequestSet::~ReportRequestSet() {}
 
@@ -93,17 +107,99 @@ void ReportRequestSet::setMainDest(int dest) {
 
 bool ReportRequestSet::containsSection(int id) { return mSections.containsSection(id); }
 
+bool ReportRequestSet::requestedSection(int id) {
+    for (const sp<ReportRequest>& request : mRequests) {
+        if (!request->args.all() && request->args.containsSection(id)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ReportRequestSet::hasRequestedSections() {
+    for (const sp<ReportRequest>& request : mRequests) {
+        if (!request->args.all() && !request->args.sections().empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
 IncidentMetadata::SectionStats* ReportRequestSet::sectionStats(int id) {
-    if (mSectionStats.find(id) == mSectionStats.end()) {
+    // Only looks up the stats once they exist, the sections running in parallel read them.
+    auto it = mSectionStats.find(id);
+    if (it == mSectionStats.end()) {
         IncidentMetadata::SectionStats stats;
         stats.set_id(id);
-        mSectionStats[id] = stats;
+        it = mSectionStats.emplace(id, stats).first;
+    }
+    return &it->second;
+}
+
+void ReportRequestSet::setSectionOrder(const vector<int>& ids) {
+    unique_lock<mutex> lock(mTurnLock);
+    mSectionPositions.clear();
+    for (size_t i = 0; i < ids.size(); i++) {
+        mSectionPositions[ids[i]] = i;
+    }
+    mSectionFinished.assign(ids.size(), false);
+    mNextSection = 0;
+    mStopped = false;
+}
+
+bool ReportRequestSet::waitForTurn(int id) {
+    unique_lock<mutex> lock(mTurnLock);
+    auto it = mSectionPositions.find(id);
+    if (it == mSectionPositions.end()) {
+        // Not part of a report, e.g. a section executed on its own.
+        return !mStopped;
     }
-    return &mSectionStats[id];
+    const size_t position = it->second;
+    mTurnChanged.wait(lock, [&] { return mStopped || mNextSection >= position; });
+    return !mStopped;
+}
+
+void ReportRequestSet::finishSection(int id, bool failed) {
+    unique_lock<mutex> lock(mTurnLock);
+    auto it = mSectionPositions.find(id);
+    if (it == mSectionPositions.end()) {
+        return;
+    }
+    const size_t position = it->second;
+    if (failed) {
+        // Only stops the report once the sections before this one have written.
+        mTurnChanged.wait(lock, [&] { return mStopped || mNextSection >= position; });
+        mStopped = true;
+    }
+    mSectionFinished[position] = true;
+    while (mNextSection < mSectionFinished.size() && mSectionFinished[mNextSection]) {
+        mNextSection++;
+    }
+    mTurnChanged.notify_all();
+}
+
+bool ReportRequestSet::stopped() {
+    unique_lock<mutex> lock(mTurnLock);
+    return mStopped;
 }
 
 // ================================================================================
-Reporter::Reporter() : Reporter(INCIDENT_DIRECTORY) { isTest = false; };
+// zlib's default, most of the size gain of level 9 at a fraction of the cost.
+static const int REPORT_COMPRESSION_LEVEL = 6;
+
+static const char* GZIP_SUFFIX = ".gz";
+
+static bool is_gzipped(const String8& filename) {
+    return filename.length() > strlen(GZIP_SUFFIX) &&
+           strcmp(filename.string() + filename.length() - strlen(GZIP_SUFFIX), GZIP_SUFFIX) == 0;
+}
+
+Reporter::Reporter() : Reporter(INCIDENT_DIRECTORY) {
+    isTest = false;
+    // The tests read the reports back, so only the real ones are compressed.
+    mCompress = true;
+    mFilename += GZIP_SUFFIX;
+};
 
 Reporter::Reporter(const char* directory) : batch() {
     char buf[100];
@@ -129,8 +225,10 @@ Reporter::run_report_status_t Reporter::runReport(size_t* reportByteSize) {
     bool needMainFd = false;
     int mainFd = -1;
     int mainDest = -1;
+    ReportCompressor compressor(REPORT_COMPRESSION_LEVEL);
     HeaderSection headers;
     MetadataSection metadataSection;
+    vector<const Section*> sections;
     std::string buildType = android::base::GetProperty("ro.build.type", "");
     const bool isUserdebugOrEng = buildType == "userdebug" || buildType == "eng";
 
@@ -160,8 +258,16 @@ Reporter::run_report_status_t Reporter::runReport(size_t* reportByteSize) {
             goto DONE;
         }
 
+        // Compress the sections as they're written, so the file is never stored raw.
+        if (mCompress) {
+            err = compressor.start(mainFd);
+            if (err != NO_ERROR) {
+                goto DONE;
+            }
+        }
+
         // Add to the set
-        batch.setMainFd(mainFd);
+        batch.setMainFd(mCompress ? compressor.fd() : mainFd);
         batch.setMainDest(mainDest);
     }
 
@@ -185,43 +291,22 @@ Reporter::run_report_status_t Reporter::runReport(size_t* reportByteSize) {
             continue;
         }
         if (this->batch.containsSection(id)) {
-            ALOGD("Taking incident report section %d '%s'", id, (*section)->name.string());
-            for (ReportRequestSet::iterator it = batch.begin(); it != batch.end(); it++) {
-                if ((*it)->listener != NULL && (*it)->args.containsSection(id)) {
-                    (*it)->listener->onReportSectionStatus(
-                            id, IIncidentReportStatusListener::STATUS_STARTING);
-                }
-            }
-
-            // Execute - go get the data and write it into the file descriptors.
-            IncidentMetadata::SectionStats* stats = batch.sectionStats(id);
-            int64_t startTime = uptimeMillis();
-            err = (*section)->Execute(&batch);
-            int64_t endTime = uptimeMillis();
-            stats->set_success(err == NO_ERROR);
-            stats->set_exec_duration_ms(endTime - startTime);
-            if (err != NO_ERROR) {
-                ALOGW("Incident section %s (%d) failed: %s. Stopping report.",
-                      (*section)->name.string(), id, strerror(-err));
-                goto DONE;
-            }
-            (*reportByteSize) += stats->report_size_bytes();
-
-            // Notify listener of starting
-            for (ReportRequestSet::iterator it = batch.begin(); it != batch.end(); it++) {
-                if ((*it)->listener != NULL && (*it)->args.containsSection(id)) {
-                    (*it)->listener->onReportSectionStatus(
-                            id, IIncidentReportStatusListener::STATUS_FINISHED);
-                }
-            }
-            ALOGD("Finish incident report section %d '%s'", id, (*section)->name.string());
+            sections.push_back(*section);
         }
     }
+    if (mThrottler != NULL) {
+        skip_throttled_sections(&sections);
+    }
+    err = run_sections(sections, reportByteSize);
 
 DONE:
     // Reports the metdadata when taking the incident report.
     if (!isTest) metadataSection.Execute(&batch);
 
+    // Flush the compressed report before closing the file.
+    status_t compressErr = compressor.finish();
+    if (err == NO_ERROR) err = compressErr;
+
     // Close the file.
     if (mainFd >= 0) {
         close(mainFd);
@@ -240,22 +325,154 @@ DONE:
 
     // Put the report into dropbox.
     if (needMainFd && err == NO_ERROR) {
+        // Indexed before dropbox takes it, so that it's rotated if incidentd dies in between.
+        if (!isTest) add_to_index(mIncidentDirectory, mFilename.c_str());
         sp<DropBoxManager> dropbox = new DropBoxManager();
-        Status status = dropbox->addFile(String16("incident"), mFilename, 0);
+        Status status = dropbox->addFile(String16("incident"), mFilename,
+                                         mCompress ? DropBoxManager::IS_GZIPPED : 0);
         ALOGD("Incident report done. dropbox status=%s\n", status.toString8().string());
         if (!status.isOk()) {
+            // It's left for upload_backlog().
             return REPORT_NEEDS_DROPBOX;
         }
 
         // If the status was ok, delete the file. If not, leave it around until the next
         // boot or the next checkin. If the directory gets too big older files will
         // be rotated out.
-        if (!isTest) unlink(mFilename.c_str());
+        if (!isTest) {
+            unlink(mFilename.c_str());
+            remove_from_index(mIncidentDirectory, mFilename.c_str());
+        }
     }
 
     return REPORT_FINISHED;
 }
 
+void Reporter::skip_throttled_sections(vector<const Section*>* sections) {
+    vector<int> required;
+    vector<int> optional;
+    for (const Section* section : *sections) {
+        if (batch.requestedSection(section->id)) {
+            required.push_back(section->id);
+        } else {
+            optional.push_back(section->id);
+        }
+    }
+    set<int> skipped = mThrottler->sectionsToSkip(required, optional);
+    if (skipped.empty()) {
+        return;
+    }
+    sections->erase(remove_if(sections->begin(), sections->end(),
+                              [&skipped](const Section* section) {
+                                  if (skipped.find(section->id) == skipped.end()) {
+                                      return false;
+                                  }
+                                  ALOGW("Skipping incident report section %d '%s' to stay "
+                                        "within the throttling budget",
+                                        section->id, section->name.string());
+                                  return true;
+                              }),
+                    sections->end());
+}
+
+status_t Reporter::run_sections(const vector<const Section*>& sections,
+                                size_t* reportByteSize) {
+    vector<int> ids;
+    // The sections of each resource, in order.
+    vector<size_t> queues[RESOURCE_COUNT];
+    for (size_t i = 0; i < sections.size(); i++) {
+        ids.push_back(sections[i]->id);
+        queues[sections[i]->resource()].push_back(i);
+        // Created up front, the sections running in parallel only fill them in.
+        batch.sectionStats(sections[i]->id);
+    }
+    batch.setSectionOrder(ids);
+
+    vector<status_t> errors(sections.size(), NO_ERROR);
+    mutex queueLock;
+    size_t next[RESOURCE_COUNT] = {};
+    mutex listenerLock;
+    // Each thread takes the next section of its resource. As they're taken in order, the first
+    // section that hasn't finished is always running, so waiting for turns can't deadlock.
+    auto runQueue = [&](int resource) {
+        while (true) {
+            size_t index;
+            {
+                unique_lock<mutex> lock(queueLock);
+                if (next[resource] >= queues[resource].size() || batch.stopped()) {
+                    return;
+                }
+                index = queues[resource][next[resource]++];
+            }
+            errors[index] = run_section(sections[index], &listenerLock);
+        }
+    };
+    vector<thread> threads;
+    for (int resource = 0; resource < RESOURCE_COUNT; resource++) {
+        size_t threadCount = min(SECTION_THREADS_PER_RESOURCE, queues[resource].size());
+        for (size_t i = 0; i < threadCount; i++) {
+            threads.emplace_back(runQueue, resource);
+        }
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (size_t i = 0; i < sections.size(); i++) {
+        if (errors[i] != NO_ERROR) {
+            ALOGW("Incident section %s (%d) failed: %s. Stopping report.",
+                  sections[i]->name.string(), sections[i]->id, strerror(-errors[i]));
+            return errors[i];
+        }
+        const IncidentMetadata::SectionStats* stats = batch.sectionStats(sections[i]->id);
+        (*reportByteSize) += stats->report_size_bytes();
+        if (mThrottler != NULL) {
+            mThrottler->addSectionCost(sections[i]->id, stats->report_size_bytes(),
+                                       stats->exec_duration_ms());
+        }
+    }
+    return NO_ERROR;
+}
+
+status_t Reporter::run_section(const Section* section, mutex* listenerLock) {
+    const int id = section->id;
+    ALOGD("Taking incident report section %d '%s'", id, section->name.string());
+    {
+        unique_lock<mutex> lock(*listenerLock);
+        for (ReportRequestSet::iterator it = batch.begin(); it != batch.end(); it++) {
+            if ((*it)->listener != NULL && (*it)->args.containsSection(id)) {
+                (*it)->listener->onReportSectionStatus(
+                        id, IIncidentReportStatusListener::STATUS_STARTING);
+            }
+        }
+    }
+
+    // Execute - go get the data and write it into the file descriptors.
+    IncidentMetadata::SectionStats* stats = batch.sectionStats(id);
+    int64_t startTime = uptimeMillis();
+    status_t err = section->Execute(&batch);
+    int64_t endTime = uptimeMillis();
+    batch.finishSection(id, err != NO_ERROR);
+    stats->set_success(err == NO_ERROR);
+    stats->set_exec_duration_ms(endTime - startTime);
+    if (err != NO_ERROR) {
+        return err;
+    }
+
+    // Notify listener of finishing
+    {
+        unique_lock<mutex> lock(*listenerLock);
+        for (ReportRequestSet::iterator it = batch.begin(); it != batch.end(); it++) {
+            if ((*it)->listener != NULL && (*it)->args.containsSection(id)) {
+                (*it)->listener->onReportSectionStatus(
+                        id, IIncidentReportStatusListener::STATUS_FINISHED);
+            }
+        }
+    }
+    ALOGD("Finish incident report section %d '%s'", id, section->name.string());
+    return NO_ERROR;
+}
+
 /**
  * Create our output file and set the access permissions to -rw-rw----
  */
@@ -315,7 +532,8 @@ Reporter::run_report_status_t Reporter::upload_backlog() {
             continue;
         }
 
-        Status status = dropbox->addFile(String16("incident"), filename.string(), 0);
+        Status status = dropbox->addFile(String16("incident"), filename.string(),
+                                         is_gzipped(filename) ? DropBoxManager::IS_GZIPPED : 0);
         ALOGD("Incident report done. dropbox status=%s\n", status.toString8().string());
         if (!status.isOk()) {
             return REPORT_NEEDS_DROPBOX;
@@ -325,6 +543,7 @@ Reporter::run_report_status_t Reporter::upload_backlog() {
         // boot or the next checkin. If the directory gets too big older files will
         // be rotated out.
         unlink(filename.string());
+        remove_from_index(INCIDENT_DIRECTORY, filename.string());
         count++;
     }
     ALOGD("Successfully uploaded %d files to Dropbox.", count);
@@ -21,12 +21,16 @@
 #include <android/os/IIncidentReportStatusListener.h>
 #include <android/os/IncidentReportArgs.h>
 
+#include <condition_variable>
 #include <map>
+#include <mutex>
+#include <set>
 #include <string>
 #include <vector>
 
 #include <time.h>
 
+#include "SectionCache.h"
 #include "Throttler.h"
 #include "frameworks/base/libs/incident/proto/android/os/metadata.pb.h"
 
@@ -34,6 +38,8 @@ namespace android {
 namespace os {
 namespace incidentd {
 
+class Section;
+
 // ================================================================================
 struct ReportRequest : public virtual RefBase {
     IncidentReportArgs args;
@@ -69,8 +75,31 @@ public:
     map<int, IncidentMetadata::SectionStats>& allSectionStats() { return mSectionStats; }
 
     bool containsSection(int id);
+
+    // The captures shared with other reports, NULL if the sections aren't shared.
+    void setSectionCache(const sp<SectionCache>& cache) { mSectionCache = cache; }
+    const sp<SectionCache>& sectionCache() { return mSectionCache; }
+
+    // Whether a request asked for the section itself, rather than for all of them.
+    bool requestedSection(int id);
+
+    // Whether a request asked for specific sections.
+    bool hasRequestedSections();
     IncidentMetadata::SectionStats* sectionStats(int id);
 
+    // Sections run in parallel but write to the requests one at a time, in the given order.
+    void setSectionOrder(const vector<int>& ids);
+
+    // Blocks until all the sections before id in the order have finished. Returns false if the
+    // report was stopped by one of them, then the section must not write anything.
+    bool waitForTurn(int id);
+
+    // Lets the next sections write. If the section failed, the report stops after it.
+    void finishSection(int id, bool failed);
+
+    // Whether a section failed and the report stopped.
+    bool stopped();
+
 private:
     vector<sp<ReportRequest>> mRequests;
     IncidentReportArgs mSections;
@@ -79,6 +108,15 @@ private:
 
     IncidentMetadata mMetadata;
     map<int, IncidentMetadata::SectionStats> mSectionStats;
+    sp<SectionCache> mSectionCache;
+
+    // Lock protects the fields below, which order the sections' writes.
+    mutex mTurnLock;
+    condition_variable mTurnChanged;
+    map<int, size_t> mSectionPositions;
+    vector<bool> mSectionFinished;
+    size_t mNextSection;  // all the sections before it have finished.
+    bool mStopped;
 };
 
 // ================================================================================
@@ -92,6 +130,10 @@ public:
     Reporter(const char* directory);  // For testing purpose only.
     virtual ~Reporter();
 
+    // When the throttler is set, the optional sections it picks are left out of the report and
+    // it's told what the others cost.
+    void setThrottler(const sp<Throttler>& throttler) { mThrottler = throttler; }
+
     // Run the report as described in the batch and args parameters.
     run_report_status_t runReport(size_t* reportByteSize);
 
@@ -104,10 +146,21 @@ private:
     off_t mMaxSize;
     size_t mMaxCount;
     time_t mStartTime;
+    sp<Throttler> mThrottler;
 
     status_t create_file(int* fd);
 
-    bool isTest = true;  // default to true for testing
+    // Runs the sections, in parallel on a few threads per resource they wait on, and writes
+    // their output in order. Stops at the first section, in order, that fails.
+    status_t run_sections(const vector<const Section*>& sections, size_t* reportByteSize);
+
+    status_t run_section(const Section* section, mutex* listenerLock);
+
+    // Leaves out the sections the throttler picks because the budget is tight.
+    void skip_throttled_sections(vector<const Section*>* sections);
+
+    bool isTest = true;      // default to true for testing
+    bool mCompress = false;  // the report file is gzipped
 };
 
 }  // namespace incidentd
@@ -26,6 +26,7 @@
 
 #include <android-base/file.h>
 #include <android-base/stringprintf.h>
+#include <android/util/ScopeTimer.h>
 #include <android/util/protobuf.h>
 #include <binder/IServiceManager.h>
 #include <debuggerd/client.h>
@@ -80,6 +81,12 @@ static void write_section_stats(IncidentMetadata::SectionStats* stats, const FdB
 // Reads data from FdBuffer and writes it to the requests file descriptor.
 static status_t write_report_requests(const int id, const FdBuffer& buffer,
                                       ReportRequestSet* requests) {
+    // Sections run in parallel, wait until the ones before this one have written.
+    if (!requests->waitForTurn(id)) {
+        VLOG("Section %d not written, the report stopped", id);
+        return NO_ERROR;
+    }
+
     status_t err = -EBADF;
     EncodedBuffer::iterator data = buffer.data();
     PrivacyBuffer privacyBuffer(get_privacy_of_section(id), data);
@@ -96,53 +103,63 @@ static status_t write_report_requests(const int id, const FdBuffer& buffer,
         requestsBySpec[spec].push_back(request);
     }
 
+    // Strips the data for all the specs, including the dropbox one, in a single pass.
+    vector<PrivacySpec> specs;
     for (auto mit = requestsBySpec.begin(); mit != requestsBySpec.end(); mit++) {
-        PrivacySpec spec = mit->first;
-        err = privacyBuffer.strip(spec);
+        specs.push_back(mit->first);
+    }
+    PrivacySpec mainSpec = PrivacySpec::new_spec(requests->mainDest());
+    if (requests->mainFd() >= 0 && requestsBySpec.find(mainSpec) == requestsBySpec.end()) {
+        specs.push_back(mainSpec);
+    }
+    if (!specs.empty()) {
+        err = privacyBuffer.strip(specs);
         if (err != NO_ERROR) return err;  // it means the privacyBuffer data is corrupted.
-        if (privacyBuffer.size() == 0) continue;
+    }
+
+    for (auto mit = requestsBySpec.begin(); mit != requestsBySpec.end(); mit++) {
+        PrivacySpec spec = mit->first;
+        size_t size = privacyBuffer.size(spec);
+        if (size == 0) continue;
 
         for (auto it = mit->second.begin(); it != mit->second.end(); it++) {
             sp<ReportRequest> request = *it;
-            err = write_section_header(request->fd, id, privacyBuffer.size());
+            err = write_section_header(request->fd, id, size);
             if (err != NO_ERROR) {
                 request->err = err;
                 continue;
             }
-            err = privacyBuffer.flush(request->fd);
+            err = privacyBuffer.flush(spec, request->fd);
             if (err != NO_ERROR) {
                 request->err = err;
                 continue;
             }
             writeable++;
-            VLOG("Section %d flushed %zu bytes to fd %d with spec %d", id, privacyBuffer.size(),
-                 request->fd, spec.dest);
+            VLOG("Section %d flushed %zu bytes to fd %d with spec %d", id, size, request->fd,
+                 spec.dest);
         }
-        privacyBuffer.clear();
     }
 
     // The dropbox file
     if (requests->mainFd() >= 0) {
-        PrivacySpec spec = PrivacySpec::new_spec(requests->mainDest());
-        err = privacyBuffer.strip(spec);
-        if (err != NO_ERROR) return err;  // the buffer data is corrupted.
-        if (privacyBuffer.size() == 0) goto DONE;
+        size_t size = privacyBuffer.size(mainSpec);
+        if (size == 0) goto DONE;
 
-        err = write_section_header(requests->mainFd(), id, privacyBuffer.size());
+        err = write_section_header(requests->mainFd(), id, size);
         if (err != NO_ERROR) {
             requests->setMainFd(-1);
             goto DONE;
         }
-        err = privacyBuffer.flush(requests->mainFd());
+        err = privacyBuffer.flush(mainSpec, requests->mainFd());
         if (err != NO_ERROR) {
             requests->setMainFd(-1);
             goto DONE;
         }
         writeable++;
-        VLOG("Section %d flushed %zu bytes to dropbox %d with spec %d", id, privacyBuffer.size(),
-             requests->mainFd(), spec.dest);
+        VLOG("Section %d flushed %zu bytes to dropbox %d with spec %d", id, size,
+             requests->mainFd(), mainSpec.dest);
         // Reports bytes of the section uploaded via dropbox after filtering.
-        requests->sectionStats(id)->set_report_size_bytes(privacyBuffer.size());
+        requests->sectionStats(id)->set_report_size_bytes(size);
     }
 
 DONE:
@@ -150,6 +167,25 @@ DONE:
     return writeable > 0 ? NO_ERROR : err;
 }
 
+// Looks up a recent capture of the section that other reports took, NULL if there's none.
+static sp<SectionCapture> get_shared_capture(const int id, ReportRequestSet* requests) {
+    if (requests->sectionCache() == NULL) return NULL;
+    sp<SectionCapture> capture = requests->sectionCache()->get(id);
+    if (capture != NULL) {
+        VLOG("Section %d reuses a capture of %zu bytes", id, capture->buffer.size());
+        write_section_stats(requests->sectionStats(id), capture->buffer);
+    }
+    return capture;
+}
+
+// Shares a successful capture of the section with the next reports.
+static void share_capture(const int id, const sp<SectionCapture>& capture,
+                          ReportRequestSet* requests) {
+    if (requests->sectionCache() != NULL) {
+        requests->sectionCache()->put(id, capture);
+    }
+}
+
 // ================================================================================
 Section::Section(int i, int64_t timeoutMs, bool userdebugAndEngOnly, bool deviceSpecific)
     : id(i),
@@ -250,6 +286,11 @@ FileSection::FileSection(int id, const char* filename, const bool deviceSpecific
 FileSection::~FileSection() {}
 
 status_t FileSection::Execute(ReportRequestSet* requests) const {
+    sp<SectionCapture> shared = get_shared_capture(this->id, requests);
+    if (shared != NULL) {
+        return write_report_requests(this->id, shared->buffer, requests);
+    }
+
     // read from mFilename first, make sure the file is available
     // add O_CLOEXEC to make sure it is closed when exec incident helper
     unique_fd fd(open(mFilename, O_RDONLY | O_CLOEXEC));
@@ -258,7 +299,8 @@ status_t FileSection::Execute(ReportRequestSet* requests) const {
         return this->deviceSpecific ? NO_ERROR : -errno;
     }
 
-    FdBuffer buffer;
+    sp<SectionCapture> capture = new SectionCapture();
+    FdBuffer& buffer = capture->buffer;
     Fpipe p2cPipe;
     Fpipe c2pPipe;
     // initiate pipes to pass data to/from incident_helper
@@ -294,6 +336,7 @@ status_t FileSection::Execute(ReportRequestSet* requests) const {
 
     VLOG("FileSection '%s' wrote %zd bytes in %d ms", this->name.string(), buffer.size(),
          (int)buffer.durationMs());
+    share_capture(this->id, capture, requests);
     status_t err = write_report_requests(this->id, buffer, requests);
     if (err != NO_ERROR) {
         ALOGW("FileSection '%s' failed writing: %s", this->name.string(), strerror(-err));
@@ -427,7 +470,11 @@ WorkerThreadSection::~WorkerThreadSection() {}
 
 static void* worker_thread_func(void* cookie) {
     WorkerThreadData* data = (WorkerThreadData*)cookie;
-    status_t err = data->section->BlockingCall(data->pipe.writeFd().get());
+    status_t err;
+    {
+        SCOPE_TIMER("incidentd.WorkerThreadSection.BlockingCall");
+        err = data->section->BlockingCall(data->pipe.writeFd().get());
+    }
 
     {
         unique_lock<mutex> lock(data->lock);
@@ -442,11 +489,19 @@ static void* worker_thread_func(void* cookie) {
 }
 
 status_t WorkerThreadSection::Execute(ReportRequestSet* requests) const {
+    if (shareCapture()) {
+        sp<SectionCapture> shared = get_shared_capture(this->id, requests);
+        if (shared != NULL) {
+            return write_report_requests(this->id, shared->buffer, requests);
+        }
+    }
+
     status_t err = NO_ERROR;
     pthread_t thread;
     pthread_attr_t attr;
     bool timedOut = false;
-    FdBuffer buffer;
+    sp<SectionCapture> capture = new SectionCapture();
+    FdBuffer& buffer = capture->buffer;
 
     // Data shared between this thread and the worker thread.
     sp<WorkerThreadData> data = new WorkerThreadData(this);
@@ -527,6 +582,9 @@ status_t WorkerThreadSection::Execute(ReportRequestSet* requests) const {
     // Write the data that was collected
     VLOG("WorkerThreadSection '%s' wrote %zd bytes in %d ms", name.string(), buffer.size(),
          (int)buffer.durationMs());
+    if (shareCapture()) {
+        share_capture(this->id, capture, requests);
+    }
     err = write_report_requests(this->id, buffer, requests);
     if (err != NO_ERROR) {
         ALOGW("WorkerThreadSection '%s' failed writing: '%s'", this->name.string(), strerror(-err));
@@ -662,6 +720,7 @@ status_t DumpsysSection::BlockingCall(int pipeWriteFd) const {
 // ================================================================================
 // initialization only once in Section.cpp.
 map<log_id_t, log_time> LogSection::gLastLogsRetrieved;
+mutex LogSection::gLastLogsRetrievedLock;
 
 LogSection::LogSection(int id, log_id_t logID) : WorkerThreadSection(id), mLogID(logID) {
     name += "logcat ";
@@ -696,12 +755,22 @@ static inline int32_t get4LE(uint8_t const* src) {
 }
 
 status_t LogSection::BlockingCall(int pipeWriteFd) const {
+    bool hasLastRetrieved;
+    log_time lastRetrieved(0);
+    {
+        unique_lock<mutex> lock(gLastLogsRetrievedLock);
+        auto it = gLastLogsRetrieved.find(mLogID);
+        hasLastRetrieved = it != gLastLogsRetrieved.end();
+        if (hasLastRetrieved) {
+            lastRetrieved = it->second;
+        }
+    }
     // Open log buffer and getting logs since last retrieved time if any.
     unique_ptr<logger_list, void (*)(logger_list*)> loggers(
-            gLastLogsRetrieved.find(mLogID) == gLastLogsRetrieved.end()
+            !hasLastRetrieved
                     ? android_logger_list_alloc(ANDROID_LOG_RDONLY | ANDROID_LOG_NONBLOCK, 0, 0)
                     : android_logger_list_alloc_time(ANDROID_LOG_RDONLY | ANDROID_LOG_NONBLOCK,
-                                                     gLastLogsRetrieved[mLogID], 0),
+                                                     lastRetrieved, 0),
             android_logger_list_free);
 
     if (android_logger_open(loggers.get(), mLogID) == NULL) {
@@ -812,7 +881,10 @@ status_t LogSection::BlockingCall(int pipeWriteFd) const {
             proto.end(token);
         }
     }
-    gLastLogsRetrieved[mLogID] = lastTimestamp;
+    {
+        unique_lock<mutex> lock(gLastLogsRetrievedLock);
+        gLastLogsRetrieved[mLogID] = lastTimestamp;
+    }
     proto.flush(pipeWriteFd);
     return NO_ERROR;
 }
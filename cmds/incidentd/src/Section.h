@@ -22,6 +22,7 @@
 
 #include <stdarg.h>
 #include <map>
+#include <mutex>
 
 #include <utils/String16.h>
 #include <utils/String8.h>
@@ -33,6 +34,17 @@ namespace incidentd {
 
 const int64_t REMOTE_CALL_TIMEOUT_MS = 30 * 1000;  // 30 seconds
 
+/**
+ * What a section mostly waits on. The Reporter runs sections of different resources in parallel,
+ * and only a few of the same resource at a time.
+ */
+enum SectionResource {
+    RESOURCE_FILE = 0,  // reads files or sockets.
+    RESOURCE_BINDER,    // calls other processes through binder.
+    RESOURCE_COMMAND,   // forks a command.
+    RESOURCE_COUNT
+};
+
 /**
  * Base class for sections
  */
@@ -49,6 +61,8 @@ public:
     virtual ~Section();
 
     virtual status_t Execute(ReportRequestSet* requests) const = 0;
+
+    virtual SectionResource resource() const { return RESOURCE_FILE; }
 };
 
 /**
@@ -99,6 +113,8 @@ public:
 
     virtual status_t Execute(ReportRequestSet* requests) const;
 
+    virtual SectionResource resource() const { return RESOURCE_COMMAND; }
+
 private:
     // It looks up the content from multiple files and stops when the first one is available.
     const char** mFilenames;
@@ -116,6 +132,11 @@ public:
     virtual status_t Execute(ReportRequestSet* requests) const;
 
     virtual status_t BlockingCall(int pipeWriteFd) const = 0;
+
+    virtual SectionResource resource() const { return RESOURCE_BINDER; }
+
+    // Whether the reports taken close together can share what the section read.
+    virtual bool shareCapture() const { return false; }
 };
 
 /**
@@ -131,6 +152,8 @@ public:
 
     virtual status_t Execute(ReportRequestSet* requests) const;
 
+    virtual SectionResource resource() const { return RESOURCE_COMMAND; }
+
 private:
     const char** mCommand;
 };
@@ -145,6 +168,8 @@ public:
 
     virtual status_t BlockingCall(int pipeWriteFd) const;
 
+    virtual bool shareCapture() const { return true; }
+
 private:
     String16 mService;
     Vector<String16> mArgs;
@@ -156,6 +181,8 @@ private:
 class LogSection : public WorkerThreadSection {
     // global last log retrieved timestamp for each log_id_t.
     static map<log_id_t, log_time> gLastLogsRetrieved;
+    // Log sections can run in parallel.
+    static mutex gLastLogsRetrievedLock;
 
 public:
     LogSection(int id, log_id_t logID);
@@ -163,6 +190,8 @@ public:
 
     virtual status_t BlockingCall(int pipeWriteFd) const;
 
+    virtual SectionResource resource() const { return RESOURCE_FILE; }
+
 private:
     log_id_t mLogID;
     bool mBinary;
@@ -178,6 +207,8 @@ public:
 
     virtual status_t BlockingCall(int pipeWriteFd) const;
 
+    virtual SectionResource resource() const { return RESOURCE_COMMAND; }
+
 private:
     std::string mType;
 };
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define DEBUG false
+#include "Log.h"
+
+#include "SectionCache.h"
+
+#include <utils/SystemClock.h>
+
+namespace android {
+namespace os {
+namespace incidentd {
+
+SectionCache::SectionCache(int64_t ttlMs, size_t sizeLimit)
+    : mTtlMs(ttlMs), mSizeLimit(sizeLimit), mCaptures(), mSize(0) {}
+
+SectionCache::~SectionCache() {}
+
+void SectionCache::evictExpiredLocked(int64_t now) {
+    for (auto it = mCaptures.begin(); it != mCaptures.end();) {
+        if (now - it->second->timeMs > mTtlMs) {
+            mSize -= it->second->buffer.size();
+            it = mCaptures.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+sp<SectionCapture> SectionCache::get(int id) {
+    std::lock_guard<std::mutex> lock(mLock);
+    evictExpiredLocked(android::elapsedRealtime());
+    auto it = mCaptures.find(id);
+    return it == mCaptures.end() ? NULL : it->second;
+}
+
+void SectionCache::put(int id, const sp<SectionCapture>& capture) {
+    std::lock_guard<std::mutex> lock(mLock);
+    int64_t now = android::elapsedRealtime();
+    evictExpiredLocked(now);
+    auto it = mCaptures.find(id);
+    if (it != mCaptures.end()) {
+        mSize -= it->second->buffer.size();
+        mCaptures.erase(it);
+    }
+    if (mSize + capture->buffer.size() > mSizeLimit) {
+        VLOG("Section %d capture of %zu bytes not cached, %zu bytes are", id,
+             capture->buffer.size(), mSize);
+        return;
+    }
+    capture->timeMs = now;
+    mCaptures[id] = capture;
+    mSize += capture->buffer.size();
+}
+
+void SectionCache::evictExpired() {
+    std::lock_guard<std::mutex> lock(mLock);
+    evictExpiredLocked(android::elapsedRealtime());
+}
+
+void SectionCache::dump(FILE* out) {
+    std::lock_guard<std::mutex> lock(mLock);
+    fprintf(out, "mTtlMs=%d\n", (int)mTtlMs);
+    fprintf(out, "mSizeLimit=%d\n", (int)mSizeLimit);
+    fprintf(out, "mSize=%d\n", (int)mSize);
+    for (const auto& it : mCaptures) {
+        fprintf(out, "section %d: sizeBytes=%d timeMs=%lld\n", it.first,
+                (int)it.second->buffer.size(), (long long)it.second->timeMs);
+    }
+}
+
+}  // namespace incidentd
+}  // namespace os
+}  // namespace android
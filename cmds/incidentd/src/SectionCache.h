@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#ifndef SECTION_CACHE_H
+#define SECTION_CACHE_H
+
+#include "FdBuffer.h"
+
+#include <utils/RefBase.h>
+
+#include <map>
+#include <mutex>
+
+namespace android {
+namespace os {
+namespace incidentd {
+
+/**
+ * The data a section read, before any privacy filtering.
+ */
+struct SectionCapture : public virtual RefBase {
+    FdBuffer buffer;
+    int64_t timeMs;  // when it was put in the cache.
+
+    SectionCapture() : buffer(), timeMs(0) {}
+};
+
+/**
+ * Keeps the sections' captures for a short while, so that the reports taken close together
+ * share them instead of running the sections again. The captures are filtered by each report.
+ */
+class SectionCache : public virtual RefBase {
+public:
+    SectionCache(int64_t ttlMs, size_t sizeLimit);
+    ~SectionCache();
+
+    /**
+     * The capture of the section that's younger than the ttl, NULL if there's none.
+     */
+    sp<SectionCapture> get(int id);
+
+    /**
+     * Keeps the capture, unless the cache would go over its size limit.
+     */
+    void put(int id, const sp<SectionCapture>& capture);
+
+    /**
+     * Frees the captures older than the ttl. They're otherwise only freed by the next get() or
+     * put(), which may not come until the next report.
+     */
+    void evictExpired();
+
+    int64_t ttlMs() const { return mTtlMs; }
+
+    void dump(FILE* out);
+
+private:
+    const int64_t mTtlMs;
+    const size_t mSizeLimit;
+
+    // Lock protects the fields below, sections run in parallel.
+    std::mutex mLock;
+    std::map<int, sp<SectionCapture>> mCaptures;
+    size_t mSize;
+
+    void evictExpiredLocked(int64_t now);
+};
+
+}  // namespace incidentd
+}  // namespace os
+}  // namespace android
+
+#endif  // SECTION_CACHE_H
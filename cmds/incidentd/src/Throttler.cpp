@@ -20,6 +20,8 @@
 
 #include <utils/SystemClock.h>
 
+#include <algorithm>
+
 namespace android {
 namespace os {
 namespace incidentd {
@@ -32,25 +34,105 @@ Throttler::Throttler(size_t limit, int64_t refractoryPeriodMs)
 
 Throttler::~Throttler() {}
 
-bool Throttler::shouldThrottle() {
+// How much of the average the last report of a section counts for.
+static const int COST_AVERAGE_WEIGHT = 4;
+
+// A section left out of this many reports in a row is taken in the next one.
+static const int SAMPLE_SKIPPED_SECTION_EVERY = 4;
+
+void Throttler::refreshRefractoryPeriodLocked() {
     int64_t now = android::elapsedRealtime();
     if (now > mRefractoryPeriodMs + mLastRefractoryMs) {
         mLastRefractoryMs = now;
         mAccumulatedSize = 0;
     }
+}
+
+bool Throttler::shouldThrottle() {
+    std::lock_guard<std::mutex> lock(mLock);
+    refreshRefractoryPeriodLocked();
     return mAccumulatedSize > mSizeLimit;
 }
 
 void Throttler::addReportSize(size_t reportByteSize) {
     VLOG("The current request took %d bytes to dropbox", (int)reportByteSize);
+    std::lock_guard<std::mutex> lock(mLock);
     mAccumulatedSize += reportByteSize;
 }
 
+void Throttler::addSectionCost(int id, size_t sizeBytes, int64_t durationMs) {
+    std::lock_guard<std::mutex> lock(mLock);
+    auto it = mSectionCosts.find(id);
+    if (it == mSectionCosts.end()) {
+        mSectionCosts[id] = {sizeBytes, durationMs, 0};
+        return;
+    }
+    SectionCost& cost = it->second;
+    cost.sizeBytes = (cost.sizeBytes * (COST_AVERAGE_WEIGHT - 1) + sizeBytes) / COST_AVERAGE_WEIGHT;
+    cost.durationMs =
+            (cost.durationMs * (COST_AVERAGE_WEIGHT - 1) + durationMs) / COST_AVERAGE_WEIGHT;
+    cost.skipped = 0;
+}
+
+std::set<int> Throttler::sectionsToSkip(const std::vector<int>& requiredSections,
+                                        const std::vector<int>& optionalSections) {
+    std::lock_guard<std::mutex> lock(mLock);
+    refreshRefractoryPeriodLocked();
+    size_t budget = mAccumulatedSize < mSizeLimit ? mSizeLimit - mAccumulatedSize : 0;
+    for (int id : requiredSections) {
+        auto it = mSectionCosts.find(id);
+        if (it != mSectionCosts.end()) {
+            budget -= std::min(budget, it->second.sizeBytes);
+        }
+    }
+    // Nothing left, sampling or taking the unknown sections wouldn't bound the cost.
+    if (budget == 0) {
+        return std::set<int>(optionalSections.begin(), optionalSections.end());
+    }
+
+    size_t optionalSize = 0;
+    std::vector<int> candidateIds;
+    for (int id : optionalSections) {
+        auto it = mSectionCosts.find(id);
+        if (it != mSectionCosts.end()) {
+            optionalSize += it->second.sizeBytes;
+            candidateIds.push_back(id);
+        }
+    }
+    // The biggest first, then the slowest.
+    std::sort(candidateIds.begin(), candidateIds.end(), [this](int a, int b) {
+        const SectionCost& costA = mSectionCosts[a];
+        const SectionCost& costB = mSectionCosts[b];
+        if (costA.sizeBytes != costB.sizeBytes) return costA.sizeBytes > costB.sizeBytes;
+        return costA.durationMs > costB.durationMs;
+    });
+
+    std::set<int> skipped;
+    for (int id : candidateIds) {
+        if (optionalSize <= budget) {
+            break;
+        }
+        SectionCost& cost = mSectionCosts[id];
+        if (cost.skipped >= SAMPLE_SKIPPED_SECTION_EVERY) {
+            continue;
+        }
+        cost.skipped++;
+        optionalSize -= cost.sizeBytes;
+        skipped.insert(id);
+    }
+    return skipped;
+}
+
 void Throttler::dump(FILE* out) {
+    std::lock_guard<std::mutex> lock(mLock);
     fprintf(out, "mSizeLimit=%d\n", (int)mSizeLimit);
     fprintf(out, "mAccumulatedSize=%d\n", (int)mAccumulatedSize);
     fprintf(out, "mRefractoryPeriodMs=%d\n", (int)mRefractoryPeriodMs);
     fprintf(out, "mLastRefractoryMs=%d\n", (int)mLastRefractoryMs);
+    for (const auto& it : mSectionCosts) {
+        fprintf(out, "section %d: sizeBytes=%d durationMs=%d skipped=%d\n", it.first,
+                (int)it.second.sizeBytes, (int)it.second.durationMs, it.second.skipped);
+    }
 }
 
 }  // namespace incidentd
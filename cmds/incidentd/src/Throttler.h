@@ -20,12 +20,19 @@
 #include <utils/RefBase.h>
 
 #include <unistd.h>
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
 
 namespace android {
 namespace os {
 namespace incidentd {
 /**
  * This is a size-based throttler which prevents incidentd to take more data.
+ *
+ * It also keeps the average size and duration of each section, so that when the budget is
+ * tight the most expensive optional sections can be left out instead of the whole report.
  */
 class Throttler : public virtual android::RefBase {
 public:
@@ -39,14 +46,42 @@ public:
 
     void addReportSize(size_t reportByteSize);
 
+    /**
+     * Records what a section took in a report.
+     */
+    void addSectionCost(int id, size_t sizeBytes, int64_t durationMs);
+
+    /**
+     * Picks the optional sections to leave out so that the report fits in what's left of the
+     * budget, the biggest first. requiredSections are always taken and count against it. A
+     * section that was left out of the last SAMPLE_SKIPPED_SECTION_EVERY reports is taken
+     * anyway, so there's still some of its data. Sections with no history are never left out.
+     * Once the budget is used up, all the optional sections are left out.
+     */
+    std::set<int> sectionsToSkip(const std::vector<int>& requiredSections,
+                                 const std::vector<int>& optionalSections);
+
     void dump(FILE* out);
 
 private:
+    struct SectionCost {
+        // Moving averages over the reports that took the section.
+        size_t sizeBytes;
+        int64_t durationMs;
+        // The number of reports in a row that left it out.
+        int skipped;
+    };
+
     const size_t mSizeLimit;
     const int64_t mRefractoryPeriodMs;
 
+    // Lock protects the fields below, the report thread updates them while they're dumped.
+    std::mutex mLock;
     size_t mAccumulatedSize;
     int64_t mLastRefractoryMs;
+    std::map<int, SectionCost> mSectionCosts;
+
+    void refreshRefractoryPeriodLocked();
 };
 
 }  // namespace incidentd
@@ -18,15 +18,26 @@
 
 #include "report_directory.h"
 
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
 #include <private/android_filesystem_config.h>
 #include <utils/String8.h>
+#include <zlib.h>
 
 #include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <libgen.h>
+#include <stdio.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <set>
+#include <string>
 #include <vector>
 
 namespace android {
@@ -90,29 +101,80 @@ done:
     return err;
 }
 
+// The index file, hidden so that it's not taken for a report.
+static const char* INDEX_FILENAME = ".index";
+
+// windowBits for deflateInit2, 16 makes it write a gzip header, which dropbox understands.
+static const int GZIP_WINDOW_BITS = 15 + 16;
+static const size_t COMPRESS_BUFFER_SIZE = 16 * 1024;
+
+typedef std::vector<std::pair<String8, struct stat>> file_list_t;
+
 static bool stat_mtime_cmp(const std::pair<String8, struct stat>& a,
                            const std::pair<String8, struct stat>& b) {
     return a.second.st_mtime < b.second.st_mtime;
 }
 
-void clean_directory(const char* directory, off_t maxSize, size_t maxCount) {
+static String8 directory_base(const char* directory) {
+    String8 dirbase(directory);
+    if (directory[dirbase.size() - 1] != '/') dirbase += "/";
+    return dirbase;
+}
+
+static const char* file_basename(const char* filename) {
+    const char* slash = strrchr(filename, '/');
+    return slash == NULL ? filename : slash + 1;
+}
+
+// Reads the file names, sizes and times of the index. Returns false if there is none.
+static bool read_index(const String8& dirbase, file_list_t* files) {
+    std::string content;
+    if (!android::base::ReadFileToString((dirbase + INDEX_FILENAME).string(), &content)) {
+        return false;
+    }
+    for (const std::string& line : android::base::Split(content, "\n")) {
+        char name[256];
+        long long size;
+        long long mtime;
+        if (sscanf(line.c_str(), "%255s %lld %lld", name, &size, &mtime) != 3) {
+            continue;
+        }
+        struct stat st = {};
+        st.st_size = size;
+        st.st_mtime = mtime;
+        files->push_back(std::make_pair(dirbase + name, st));
+    }
+    return true;
+}
+
+// Replaces the index with the given files.
+static void write_index(const String8& dirbase, const file_list_t& files) {
+    std::string content;
+    for (const auto& file : files) {
+        content += android::base::StringPrintf("%s %lld %lld\n", file_basename(file.first.string()),
+                                               (long long)file.second.st_size,
+                                               (long long)file.second.st_mtime);
+    }
+    String8 tmpFilename = dirbase + INDEX_FILENAME + ".tmp";
+    if (!android::base::WriteStringToFile(content, tmpFilename.string()) ||
+        rename(tmpFilename.string(), (dirbase + INDEX_FILENAME).string()) != 0) {
+        ALOGE("Couldn't write incident report index in %s: %s", dirbase.string(),
+              strerror(errno));
+        unlink(tmpFilename.string());
+    }
+}
+
+// Lists the reports by stat-ing every file in the directory.
+static void scan_directory(const char* directory, const String8& dirbase, file_list_t* files) {
     DIR* dir;
     struct dirent* entry;
     struct stat st;
 
-    std::vector<std::pair<String8, struct stat>> files;
-
     if ((dir = opendir(directory)) == NULL) {
         ALOGE("Couldn't open incident directory: %s", directory);
         return;
     }
 
-    String8 dirbase(directory);
-    if (directory[dirbase.size() - 1] != '/') dirbase += "/";
-
-    off_t totalSize = 0;
-    size_t totalCount = 0;
-
     // Enumerate, count and add up size
     while ((entry = readdir(dir)) != NULL) {
         if (entry->d_name[0] == '.') {
@@ -126,16 +188,62 @@ void clean_directory(const char* directory, off_t maxSize, size_t maxCount) {
         if (!S_ISREG(st.st_mode)) {
             continue;
         }
-        files.push_back(std::pair<String8, struct stat>(filename, st));
+        files->push_back(std::pair<String8, struct stat>(filename, st));
+    }
 
-        totalSize += st.st_size;
-        totalCount++;
+    closedir(dir);
+}
+
+// Whether the index lists exactly the reports in the directory. Only reads the names, which is
+// much cheaper than the stat of every file the index saves.
+static bool index_matches_directory(const char* directory, const file_list_t& files) {
+    std::set<std::string> indexed;
+    for (const auto& file : files) {
+        indexed.insert(file_basename(file.first.string()));
     }
 
+    DIR* dir;
+    struct dirent* entry;
+    if ((dir = opendir(directory)) == NULL) {
+        ALOGE("Couldn't open incident directory: %s", directory);
+        return true;
+    }
+    size_t count = 0;
+    bool matches = true;
+    while (matches && (entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.' || (entry->d_type != DT_REG && entry->d_type != DT_UNKNOWN)) {
+            continue;
+        }
+        matches = indexed.count(entry->d_name) != 0;
+        count++;
+    }
     closedir(dir);
+    return matches && count == indexed.size();
+}
+
+void clean_directory(const char* directory, off_t maxSize, size_t maxCount) {
+    file_list_t files;
+    String8 dirbase = directory_base(directory);
+    bool hasIndex = read_index(dirbase, &files);
+    if (hasIndex && !index_matches_directory(directory, files)) {
+        // Reports written before the index, or left behind by a crash, would never be rotated
+        ALOGD("Incident report index out of date in %s, rebuilding it", directory);
+        files.clear();
+        hasIndex = false;
+    }
+    if (!hasIndex) {
+        scan_directory(directory, dirbase, &files);
+    }
+
+    off_t totalSize = 0;
+    size_t totalCount = files.size();
+    for (const auto& file : files) {
+        totalSize += file.second.st_size;
+    }
 
     // Count or size is less than max, then we're done.
     if (totalSize < maxSize && totalCount < maxCount) {
+        if (!hasIndex) write_index(dirbase, files);
         return;
     }
 
@@ -143,12 +251,126 @@ void clean_directory(const char* directory, off_t maxSize, size_t maxCount) {
     sort(files.begin(), files.end(), stat_mtime_cmp);
 
     // Remove files until we're under our limits.
-    for (std::vector<std::pair<String8, struct stat>>::iterator it = files.begin();
-         it != files.end() && totalSize >= maxSize && totalCount >= maxCount; it++) {
+    file_list_t::iterator it = files.begin();
+    for (; it != files.end() && totalSize >= maxSize && totalCount >= maxCount; it++) {
         remove(it->first.string());
         totalSize -= it->second.st_size;
         totalCount--;
     }
+    write_index(dirbase, file_list_t(it, files.end()));
+}
+
+void add_to_index(const char* directory, const char* filename) {
+    struct stat st;
+    if (stat(filename, &st) != 0) {
+        ALOGE("Unable to stat file %s", filename);
+        return;
+    }
+    file_list_t files;
+    String8 dirbase = directory_base(directory);
+    if (!read_index(dirbase, &files)) {
+        // Also picks up the new file.
+        scan_directory(directory, dirbase, &files);
+        write_index(dirbase, files);
+        return;
+    }
+    // The file may be indexed already, with its size and time when it was
+    const char* name = file_basename(filename);
+    files.erase(std::remove_if(files.begin(), files.end(),
+                               [name](const std::pair<String8, struct stat>& file) {
+                                   return strcmp(file_basename(file.first.string()), name) == 0;
+                               }),
+                files.end());
+    files.push_back(std::make_pair(String8(filename), st));
+    write_index(dirbase, files);
+}
+
+void remove_from_index(const char* directory, const char* filename) {
+    file_list_t files;
+    String8 dirbase = directory_base(directory);
+    if (!read_index(dirbase, &files)) {
+        return;
+    }
+    const char* name = file_basename(filename);
+    files.erase(std::remove_if(files.begin(), files.end(),
+                               [name](const std::pair<String8, struct stat>& file) {
+                                   return strcmp(file_basename(file.first.string()), name) == 0;
+                               }),
+                files.end());
+    write_index(dirbase, files);
+}
+
+// ================================================================================
+ReportCompressor::ReportCompressor(int level)
+    : mLevel(level), mPipe(), mOutFd(-1), mThread(), mErr(NO_ERROR) {}
+
+ReportCompressor::~ReportCompressor() { finish(); }
+
+status_t ReportCompressor::start(int outFd) {
+    if (!mPipe.init()) {
+        return -errno;
+    }
+    mOutFd = outFd;
+    mThread = std::thread(&ReportCompressor::compress, this);
+    return NO_ERROR;
+}
+
+int ReportCompressor::fd() { return mPipe.writeFd().get(); }
+
+status_t ReportCompressor::finish() {
+    if (!mThread.joinable()) {
+        return mErr;
+    }
+    mPipe.writeFd().reset();
+    mThread.join();
+    return mErr;
+}
+
+void ReportCompressor::compress() {
+    uint8_t in[COMPRESS_BUFFER_SIZE];
+    uint8_t out[COMPRESS_BUFFER_SIZE];
+    z_stream stream = {};
+    bool ok = deflateInit2(&stream, mLevel, Z_DEFLATED, GZIP_WINDOW_BITS, 8,
+                           Z_DEFAULT_STRATEGY) == Z_OK;
+    const bool initialized = ok;
+    if (!ok) {
+        ALOGE("Couldn't start compressing the incident report");
+        mErr = NO_MEMORY;
+    }
+
+    // Keeps reading until the writer is done even after an error, so that it never blocks.
+    while (true) {
+        ssize_t amt = TEMP_FAILURE_RETRY(read(mPipe.readFd().get(), in, sizeof(in)));
+        if (amt < 0) {
+            ALOGE("Couldn't read the incident report to compress: %s", strerror(errno));
+            mErr = -errno;
+            break;
+        }
+        if (ok) {
+            stream.next_in = in;
+            stream.avail_in = amt;
+            const int flush = amt == 0 ? Z_FINISH : Z_NO_FLUSH;
+            do {
+                stream.next_out = out;
+                stream.avail_out = sizeof(out);
+                deflate(&stream, flush);
+                size_t size = sizeof(out) - stream.avail_out;
+                if (size > 0 && !WriteFully(mOutFd, out, size)) {
+                    ALOGE("Couldn't write the compressed incident report: %s", strerror(errno));
+                    mErr = -errno;
+                    ok = false;
+                    break;
+                }
+            } while (stream.avail_out == 0);
+        }
+        if (amt == 0) {
+            break;
+        }
+    }
+    if (initialized) {
+        deflateEnd(&stream);
+    }
+    mPipe.readFd().reset();
 }
 
 }  // namespace incidentd
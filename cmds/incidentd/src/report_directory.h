@@ -21,6 +21,10 @@
 #include <sys/types.h>
 #include <utils/Errors.h>
 
+#include <thread>
+
+#include "incidentd_util.h"
+
 namespace android {
 namespace os {
 namespace incidentd {
@@ -28,6 +32,44 @@ namespace incidentd {
 android::status_t create_directory(const char* directory);
 void clean_directory(const char* directory, off_t maxSize, size_t maxCount);
 
+/**
+ * The reports kept in a directory are listed in its index with their size and time, so that
+ * cleaning the directory doesn't stat every file. The index is rebuilt from the files if it's
+ * missing, or if it doesn't list the same reports as the directory. The filename is the path of
+ * the report.
+ */
+void add_to_index(const char* directory, const char* filename);
+void remove_from_index(const char* directory, const char* filename);
+
+/**
+ * Gzips everything written to fd() into a report file on a background thread, so the sections
+ * are compressed as they're written instead of the report being stored raw.
+ */
+class ReportCompressor {
+public:
+    // The zlib compression level, from 1 (fastest) to 9 (smallest).
+    explicit ReportCompressor(int level);
+    ~ReportCompressor();
+
+    // Starts compressing into outFd, which must stay open until finish() returns.
+    android::status_t start(int outFd);
+
+    // Where the report is written, -1 until started.
+    int fd();
+
+    // Closes fd() and waits until all the data written to it is in the file.
+    android::status_t finish();
+
+private:
+    const int mLevel;
+    Fpipe mPipe;
+    int mOutFd;
+    std::thread mThread;
+    android::status_t mErr;
+
+    void compress();
+};
+
 }  // namespace incidentd
 }  // namespace os
 }  // namespace android
@@ -0,0 +1,73 @@
+// Copyright (C) 2018 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#define DEBUG false
+#include "Log.h"
+
+#include "BufferPool.h"
+
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace android::os::incidentd;
+
+TEST(BufferPoolTest, ReuseChunks) {
+    BufferPool pool(16, 2, 1, 0);
+    uint8_t* chunk1 = pool.allocate(16);
+    ASSERT_NE(nullptr, chunk1);
+    pool.release(chunk1, 16);
+    EXPECT_EQ(0UL, pool.usedChunks());
+    EXPECT_EQ(chunk1, pool.allocate(16));
+    EXPECT_EQ(1UL, pool.usedChunks());
+}
+
+TEST(BufferPoolTest, Exhausted) {
+    BufferPool pool(16, 2, 2, 100);
+    uint8_t* chunk1 = pool.allocate(16);
+    uint8_t* chunk2 = pool.allocate(16);
+    ASSERT_NE(nullptr, chunk1);
+    ASSERT_NE(nullptr, chunk2);
+    EXPECT_EQ(nullptr, pool.allocate(16));
+
+    // Only the pool's chunk size is limited.
+    uint8_t* other = pool.allocate(32);
+    ASSERT_NE(nullptr, other);
+    pool.release(other, 32);
+    EXPECT_EQ(2UL, pool.usedChunks());
+}
+
+TEST(BufferPoolTest, WaitForRelease) {
+    BufferPool pool(16, 1, 0, 10000);
+    uint8_t* chunk = pool.allocate(16);
+    ASSERT_NE(nullptr, chunk);
+    std::thread releaser([&pool, chunk] {
+        usleep(100000);
+        pool.release(chunk, 16);
+    });
+    chunk = pool.allocate(16);
+    EXPECT_NE(nullptr, chunk);
+    releaser.join();
+    pool.release(chunk, 16);
+    EXPECT_EQ(0UL, pool.usedChunks());
+}
+
+TEST(BufferPoolTest, EncodedBuffer) {
+    BufferPool pool(4, 2, 2, 0);
+    {
+        EncodedBuffer buffer(4, &pool);
+        buffer.writeRawFixed64(0);
+        EXPECT_EQ(2UL, pool.usedChunks());
+        EXPECT_EQ(nullptr, buffer.writeBuffer());
+    }
+    EXPECT_EQ(0UL, pool.usedChunks());
+}
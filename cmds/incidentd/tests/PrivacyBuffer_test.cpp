@@ -249,6 +249,28 @@ TEST_F(PrivacyBufferTest, ClearAndStrip) {
     assertBuffer(privacyBuf, data);
 }
 
+TEST_F(PrivacyBufferTest, StripForAllSpecsAtOnce) {
+    string data = STRING_FIELD_0 + VARINT_FIELD_1 + FIX64_FIELD_3;
+    writeToFdBuffer(data);
+    Privacy* list[] = {create_privacy(1, OTHER_TYPE, DEST_LOCAL),
+                       create_privacy(3, OTHER_TYPE, DEST_AUTOMATIC), NULL};
+    EncodedBuffer::iterator bufData = buffer.data();
+    PrivacyBuffer privacyBuf(create_message_privacy(300, list), bufData);
+    PrivacySpec automatic = PrivacySpec::new_spec(DEST_AUTOMATIC);
+    PrivacySpec explicitSpec = PrivacySpec::new_spec(DEST_EXPLICIT);
+    PrivacySpec local = PrivacySpec::new_spec(DEST_LOCAL);
+
+    ASSERT_EQ(privacyBuf.strip({automatic, explicitSpec, local}), NO_ERROR);
+    std::string expected[] = {FIX64_FIELD_3, STRING_FIELD_0 + FIX64_FIELD_3, data};
+    PrivacySpec* specs[] = {&automatic, &explicitSpec, &local};
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(privacyBuf.size(*specs[i]), expected[i].size());
+        CaptureStdout();
+        ASSERT_EQ(privacyBuf.flush(*specs[i], STDOUT_FILENO), NO_ERROR);
+        ASSERT_THAT(GetCapturedStdout(), StrEq(expected[i]));
+    }
+}
+
 TEST_F(PrivacyBufferTest, BadDataInFdBuffer) {
     writeToFdBuffer("iambaddata");
     Privacy* list[] = {create_privacy(4, OTHER_TYPE, DEST_AUTOMATIC), NULL};
@@ -25,6 +25,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <string.h>
+#include <thread>
 
 using namespace android;
 using namespace android::base;
@@ -127,6 +128,27 @@ TEST_F(ReporterTest, ReportRequestSetEmpty) {
     ASSERT_EQ(requests.mainFd(), STDOUT_FILENO);
 }
 
+TEST_F(ReporterTest, ReportRequestSetSectionOrder) {
+    requests.setSectionOrder({1, 2, 3});
+    vector<int> written;
+    mutex writtenLock;
+    auto write = [&](int id) {
+        if (requests.waitForTurn(id)) {
+            unique_lock<mutex> lock(writtenLock);
+            written.push_back(id);
+        }
+        requests.finishSection(id, id == 2);
+    };
+    // Started in reverse order, the sections still write in order, and 2 stops the report.
+    thread t3(write, 3);
+    thread t2(write, 2);
+    write(1);
+    t2.join();
+    t3.join();
+    EXPECT_THAT(written, ::testing::ElementsAre(1, 2));
+    EXPECT_TRUE(requests.stopped());
+}
+
 TEST_F(ReporterTest, RunReportEmpty) {
     ASSERT_EQ(Reporter::REPORT_FINISHED, reporter->runReport(&size));
     EXPECT_EQ(l->startInvoked, 0);
@@ -0,0 +1,79 @@
+// Copyright (C) 2018 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#define DEBUG false
+#include "Log.h"
+
+#include "SectionCache.h"
+
+#include <android-base/file.h>
+#include <android-base/test_utils.h>
+#include <gtest/gtest.h>
+
+using namespace android;
+using namespace android::base;
+using namespace android::os::incidentd;
+
+static sp<SectionCapture> make_capture(const std::string& content) {
+    TemporaryFile tf;
+    sp<SectionCapture> capture = new SectionCapture();
+    if (!WriteStringToFile(content, tf.path) ||
+        capture->buffer.readFully(tf.fd) != NO_ERROR) {
+        return NULL;
+    }
+    return capture;
+}
+
+TEST(SectionCacheTest, ShareCapture) {
+    SectionCache cache(100000, 1000);
+    EXPECT_EQ(nullptr, cache.get(1).get());
+
+    sp<SectionCapture> capture = make_capture("data");
+    ASSERT_NE(nullptr, capture.get());
+    cache.put(1, capture);
+    EXPECT_EQ(capture.get(), cache.get(1).get());
+    EXPECT_EQ(nullptr, cache.get(2).get());
+
+    // A new capture replaces the old one.
+    sp<SectionCapture> newCapture = make_capture("new data");
+    cache.put(1, newCapture);
+    EXPECT_EQ(newCapture.get(), cache.get(1).get());
+}
+
+TEST(SectionCacheTest, SizeLimit) {
+    SectionCache cache(100000, 10);
+    cache.put(1, make_capture("123456"));
+    cache.put(2, make_capture("123456"));
+    EXPECT_NE(nullptr, cache.get(1).get());
+    EXPECT_EQ(nullptr, cache.get(2).get());
+}
+
+TEST(SectionCacheTest, Expire) {
+    SectionCache cache(500, 1000);
+    cache.put(1, make_capture("data"));
+    EXPECT_NE(nullptr, cache.get(1).get());
+    sleep(1);  // sleep for 1 second to make sure the capture expires
+    EXPECT_EQ(nullptr, cache.get(1).get());
+}
+
+TEST(SectionCacheTest, EvictExpired) {
+    SectionCache cache(500, 1000);
+    sp<SectionCapture> capture = make_capture("data");
+    ASSERT_NE(nullptr, capture.get());
+    cache.put(1, capture);
+    cache.evictExpired();
+    EXPECT_EQ(2, capture->getStrongCount());
+    sleep(1);  // sleep for 1 second to make sure the capture expires
+    cache.evictExpired();
+    EXPECT_EQ(1, capture->getStrongCount());
+}
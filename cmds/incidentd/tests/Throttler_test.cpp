@@ -21,6 +21,7 @@
 #include <gtest/gtest.h>
 
 using namespace android::os::incidentd;
+using ::testing::ElementsAre;
 
 TEST(ThrottlerTest, DataSizeExceeded) {
     Throttler t(100, 100000);
@@ -37,3 +38,52 @@ TEST(ThrottlerTest, TimeReset) {
     sleep(1);  // sleep for 1 second to make sure throttler resets
     EXPECT_FALSE(t.shouldThrottle());
 }
+
+TEST(ThrottlerTest, SkipBiggestOptionalSections) {
+    Throttler t(1000, 100000);
+    t.addSectionCost(1, 300, 10);
+    t.addSectionCost(2, 600, 5);
+    t.addSectionCost(3, 200, 50);
+    t.addSectionCost(4, 200, 20);
+    t.addSectionCost(6, 150, 0);
+
+    // Everything fits.
+    EXPECT_TRUE(t.sectionsToSkip({1}, {3, 4}).empty());
+
+    // The required section and the history-less one are always taken.
+    t.addReportSize(300);
+    EXPECT_THAT(t.sectionsToSkip({1}, {2, 5}), ElementsAre(2));
+
+    // Ties go to the slowest.
+    EXPECT_THAT(t.sectionsToSkip({1}, {3, 4, 6}), ElementsAre(3));
+}
+
+TEST(ThrottlerTest, SkipAllOptionalSectionsOverBudget) {
+    Throttler t(1000, 100000);
+    t.addSectionCost(1, 300, 10);
+    t.addSectionCost(2, 100, 10);
+    t.addReportSize(1000);
+
+    // Neither sampled nor taken for lack of history.
+    for (int i = 0; i < 5; i++) {
+        EXPECT_THAT(t.sectionsToSkip({}, {2, 5}), ElementsAre(2, 5));
+    }
+
+    // The required sections use up the budget too.
+    Throttler t2(300, 100000);
+    t2.addSectionCost(1, 300, 10);
+    EXPECT_THAT(t2.sectionsToSkip({1}, {5}), ElementsAre(5));
+}
+
+TEST(ThrottlerTest, SampleSkippedSections) {
+    Throttler t(100, 100000);
+    t.addSectionCost(1, 500, 10);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_THAT(t.sectionsToSkip({}, {1}), ElementsAre(1));
+    }
+    EXPECT_TRUE(t.sectionsToSkip({}, {1}).empty());
+
+    // Taking it starts over.
+    t.addSectionCost(1, 500, 10);
+    EXPECT_THAT(t.sectionsToSkip({}, {1}), ElementsAre(1));
+}
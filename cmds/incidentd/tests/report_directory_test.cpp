@@ -0,0 +1,143 @@
+// Copyright (C) 2018 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#define DEBUG false
+#include "Log.h"
+
+#include "report_directory.h"
+
+#include <android-base/file.h>
+#include <android-base/test_utils.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+using namespace android;
+using namespace android::base;
+using namespace android::os::incidentd;
+using namespace std;
+
+static string inflate_file(const char* path) {
+    string compressed;
+    if (!ReadFileToString(path, &compressed)) return "";
+    z_stream stream = {};
+    // 16 reads the gzip header.
+    if (inflateInit2(&stream, 15 + 16) != Z_OK) return "";
+    string content;
+    char buf[1024];
+    stream.next_in = (Bytef*)compressed.data();
+    stream.avail_in = compressed.size();
+    int ret;
+    do {
+        stream.next_out = (Bytef*)buf;
+        stream.avail_out = sizeof(buf);
+        ret = inflate(&stream, Z_NO_FLUSH);
+        content.append(buf, sizeof(buf) - stream.avail_out);
+    } while (ret == Z_OK);
+    inflateEnd(&stream);
+    return ret == Z_STREAM_END ? content : "";
+}
+
+static void write_report(const string& path, const string& content, time_t mtime) {
+    ASSERT_TRUE(WriteStringToFile(content, path));
+    struct timespec times[2] = {{mtime, 0}, {mtime, 0}};
+    ASSERT_EQ(0, utimensat(AT_FDCWD, path.c_str(), times, 0));
+}
+
+TEST(ReportDirectoryTest, CompressReport) {
+    TemporaryFile tf;
+    ReportCompressor compressor(6);
+    EXPECT_EQ(-1, compressor.fd());
+    ASSERT_EQ(NO_ERROR, compressor.start(tf.fd));
+
+    // Bigger than the compressor's buffers and the pipe.
+    string expected;
+    for (int i = 0; i < 100000; i++) {
+        expected += to_string(i);
+    }
+    ASSERT_TRUE(WriteFully(compressor.fd(), expected.data(), expected.size()));
+    EXPECT_EQ(NO_ERROR, compressor.finish());
+
+    struct stat st;
+    ASSERT_EQ(0, fstat(tf.fd, &st));
+    EXPECT_LT(st.st_size, (off_t)expected.size());
+    EXPECT_EQ(expected, inflate_file(tf.path));
+}
+
+TEST(ReportDirectoryTest, CompressEmptyReport) {
+    TemporaryFile tf;
+    ReportCompressor compressor(6);
+    ASSERT_EQ(NO_ERROR, compressor.start(tf.fd));
+    EXPECT_EQ(NO_ERROR, compressor.finish());
+    EXPECT_EQ(NO_ERROR, compressor.finish());
+    EXPECT_EQ("", inflate_file(tf.path));
+}
+
+TEST(ReportDirectoryTest, CleanDirectoryRemovesOldestFiles) {
+    TemporaryDir td;
+    string dir = string(td.path) + "/";
+    write_report(dir + "a", "aaaa", 100);
+    write_report(dir + "b", "bbbb", 300);
+    write_report(dir + "c", "cccc", 200);
+
+    // No index yet, it's built from the files.
+    clean_directory(td.path, 10, 3);
+    EXPECT_EQ(-1, access((dir + "a").c_str(), F_OK));
+    EXPECT_EQ(0, access((dir + "b").c_str(), F_OK));
+    EXPECT_EQ(0, access((dir + "c").c_str(), F_OK));
+
+    string index;
+    ASSERT_TRUE(ReadFileToString(dir + ".index", &index));
+    EXPECT_EQ("c 4 200\nb 4 300\n", index);
+}
+
+TEST(ReportDirectoryTest, CleanDirectoryUsesIndex) {
+    TemporaryDir td;
+    string dir = string(td.path) + "/";
+    write_report(dir + "a", "aaaa", 100);
+    clean_directory(td.path, 100, 100);
+
+    // Files that are added to the index are considered.
+    write_report(dir + "b", "bbbb", 200);
+    add_to_index(td.path, (dir + "b").c_str());
+    add_to_index(td.path, (dir + "b").c_str());
+    clean_directory(td.path, 6, 2);
+    EXPECT_EQ(-1, access((dir + "a").c_str(), F_OK));
+    EXPECT_EQ(0, access((dir + "b").c_str(), F_OK));
+
+    remove_from_index(td.path, (dir + "b").c_str());
+    string index;
+    ASSERT_TRUE(ReadFileToString(dir + ".index", &index));
+    EXPECT_EQ("", index);
+}
+
+TEST(ReportDirectoryTest, CleanDirectoryRebuildsOutOfDateIndex) {
+    TemporaryDir td;
+    string dir = string(td.path) + "/";
+    write_report(dir + "a", "aaaa", 100);
+    write_report(dir + "b", "bbbb", 200);
+    clean_directory(td.path, 100, 100);
+
+    // Not in the index, the directory is scanned again.
+    write_report(dir + "untracked", "uuuu", 50);
+    clean_directory(td.path, 6, 2);
+    EXPECT_EQ(-1, access((dir + "untracked").c_str(), F_OK));
+    EXPECT_EQ(-1, access((dir + "a").c_str(), F_OK));
+    EXPECT_EQ(0, access((dir + "b").c_str(), F_OK));
+
+    string index;
+    ASSERT_TRUE(ReadFileToString(dir + ".index", &index));
+    EXPECT_EQ("b 4 200\n", index);
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Sums the memory of processes per mapping name, to find which structures
+ * preloaded by the zygote get copied on write after the fork: the private
+ * dirty pages of a freshly forked app in a mapping the zygote preloaded,
+ * such as "[anon:resource TypeSpecs]", are pages the app lost the sharing of.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+struct Usage {
+    uint64_t rss = 0;
+    uint64_t pss = 0;
+    uint64_t sharedDirty = 0;
+    uint64_t privateDirty = 0;
+};
+
+static int usage(const char* cmd)
+{
+    fprintf(stderr, "usage: %s [-n COUNT] PID...\n"
+                    "  Prints the memory of the processes summed per mapping name, in kB,\n"
+                    "  the COUNT (default 30) mappings with most private dirty pages first.\n",
+            cmd);
+    return 1;
+}
+
+static bool readSmaps(int pid, std::map<std::string, Usage>* usages)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/smaps", pid);
+    FILE* f = fopen(path, "re");
+    if (f == NULL) {
+        fprintf(stderr, "can't open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    char line[1024];
+    Usage* current = NULL;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        unsigned long start, end;
+        int nameOffset = 0;
+        // Mapping lines are "start-end perms offset dev inode [name]"
+        if (sscanf(line, "%lx-%lx %*s %*x %*s %*u %n", &start, &end, &nameOffset) == 2
+                && nameOffset > 0) {
+            std::string name(line + nameOffset);
+            while (!name.empty() && (name.back() == '\n' || name.back() == ' ')) {
+                name.pop_back();
+            }
+            if (name.empty()) {
+                name = "[anon]";
+            }
+            current = &(*usages)[name];
+            continue;
+        }
+        if (current == NULL) {
+            continue;
+        }
+
+        uint64_t kb;
+        if (sscanf(line, "Rss: %" SCNu64 " kB", &kb) == 1) {
+            current->rss += kb;
+        } else if (sscanf(line, "Pss: %" SCNu64 " kB", &kb) == 1) {
+            current->pss += kb;
+        } else if (sscanf(line, "Shared_Dirty: %" SCNu64 " kB", &kb) == 1) {
+            current->sharedDirty += kb;
+        } else if (sscanf(line, "Private_Dirty: %" SCNu64 " kB", &kb) == 1) {
+            current->privateDirty += kb;
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = 30;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt != 'n') {
+            return usage(argv[0]);
+        }
+        count = strtoul(optarg, NULL, 10);
+    }
+    if (optind == argc) {
+        return usage(argv[0]);
+    }
+
+    for (int i = optind; i < argc; i++) {
+        int pid = atoi(argv[i]);
+        std::map<std::string, Usage> usages;
+        if (pid <= 0 || !readSmaps(pid, &usages)) {
+            return 1;
+        }
+
+        std::vector<std::pair<std::string, Usage>> sorted(usages.begin(), usages.end());
+        std::sort(sorted.begin(), sorted.end(),
+                [](const std::pair<std::string, Usage>& a, const std::pair<std::string, Usage>& b) {
+                    return a.second.privateDirty > b.second.privateDirty;
+                });
+        Usage total;
+        for (const auto& entry : sorted) {
+            total.rss += entry.second.rss;
+            total.pss += entry.second.pss;
+            total.sharedDirty += entry.second.sharedDirty;
+            total.privateDirty += entry.second.privateDirty;
+        }
+
+        printf("pid %d\n", pid);
+        printf("%10s %10s %10s %10s  %s\n", "Priv_Dirty", "Shrd_Dirty", "Pss", "Rss", "Name");
+        for (size_t j = 0; j < sorted.size() && j < count; j++) {
+            const Usage& u = sorted[j].second;
+            printf("%10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "  %s\n",
+                    u.privateDirty, u.sharedDirty, u.pss, u.rss, sorted[j].first.c_str());
+        }
+        printf("%10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "  TOTAL\n",
+                total.privateDirty, total.sharedDirty, total.pss, total.rss);
+    }
+    return 0;
+}
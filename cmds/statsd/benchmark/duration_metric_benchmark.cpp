@@ -315,6 +315,73 @@ static void BM_DurationMetricLink(benchmark::State& state) {
 
 BENCHMARK(BM_DurationMetricLink);
 
+static const int kWakelockUidCount = 10000;
+
+// Duration of wakelocks held by many uids at once, with an alert setting an anomaly alarm for
+// each of them.
+static void BM_DurationMetricManyDimensionsWithAlarms(benchmark::State& state) {
+    ConfigKey cfgKey;
+    StatsdConfig config;
+    config.add_allowed_log_source("AID_ROOT");  // LogEvent defaults to UID of root.
+    *config.add_atom_matcher() = CreateAcquireWakelockAtomMatcher();
+    *config.add_atom_matcher() = CreateReleaseWakelockAtomMatcher();
+
+    auto holdingWakelockPredicate = CreateHoldingWakelockPredicate();
+    *holdingWakelockPredicate.mutable_simple_predicate()->mutable_dimensions() =
+            CreateAttributionUidDimensions(android::util::WAKELOCK_STATE_CHANGED,
+                                           {Position::FIRST});
+    *config.add_predicate() = holdingWakelockPredicate;
+
+    auto durationMetric = config.add_duration_metric();
+    durationMetric->set_id(StringToId("WakelockDuration"));
+    durationMetric->set_what(holdingWakelockPredicate.id());
+    durationMetric->set_aggregation_type(DurationMetric::SUM);
+    *durationMetric->mutable_dimensions_in_what() =
+            CreateAttributionUidDimensions(android::util::WAKELOCK_STATE_CHANGED,
+                                           {Position::FIRST});
+    durationMetric->set_bucket(FIVE_MINUTES);
+
+    auto alert = config.add_alert();
+    alert->set_id(StringToId("alert"));
+    alert->set_metric_id(durationMetric->id());
+    alert->set_num_buckets(1);
+    alert->set_refractory_period_secs(2);
+    alert->set_trigger_if_sum_gt(60 * (int64_t)NS_PER_SEC);
+
+    int64_t bucketStartTimeNs = 10000000000;
+
+    std::vector<std::unique_ptr<LogEvent>> events;
+    for (int i = 0; i < kWakelockUidCount; i++) {
+        events.push_back(CreateAcquireWakelockEvent({CreateAttribution(10000 + i, "")}, "wl",
+                                                    bucketStartTimeNs + i + 1));
+    }
+    // Releasing and acquiring again move every alarm.
+    for (int i = 0; i < kWakelockUidCount; i++) {
+        int64_t releaseTimeNs = bucketStartTimeNs + (int64_t)NS_PER_SEC + i;
+        events.push_back(CreateReleaseWakelockEvent({CreateAttribution(10000 + i, "")}, "wl",
+                                                    releaseTimeNs));
+        events.push_back(CreateAcquireWakelockEvent({CreateAttribution(10000 + i, "")}, "wl",
+                                                    releaseTimeNs + NS_PER_SEC));
+    }
+
+    sp<UidMap> uidMap = new UidMap();
+    sp<AlarmMonitor> anomalyAlarmMonitor =
+            new AlarmMonitor(1, [](const sp<IStatsCompanionService>&, int64_t) {},
+                             [](const sp<IStatsCompanionService>&) {});
+    sp<AlarmMonitor> periodicAlarmMonitor;
+    while (state.KeepRunning()) {
+        sp<StatsLogProcessor> processor = new StatsLogProcessor(
+                uidMap, anomalyAlarmMonitor, periodicAlarmMonitor, bucketStartTimeNs,
+                [](const ConfigKey&) { return true; });
+        processor->OnConfigUpdated(bucketStartTimeNs, cfgKey, config);
+        for (const auto& event : events) {
+            processor->OnLogEvent(event.get());
+        }
+    }
+}
+
+BENCHMARK(BM_DurationMetricManyDimensionsWithAlarms);
+
 }  //  namespace statsd
 }  //  namespace os
 }  //  namespace android
@@ -26,18 +26,20 @@ namespace statsd {
 
 using std::vector;
 
-static void createLogEventAndMatcher(LogEvent* event, FieldMatcher *field_matcher) {
+static void writeEvent(LogEvent* event, int chainLength) {
     AttributionNodeInternal node;
     node.set_uid(100);
     node.set_tag("LOCATION");
 
-    std::vector<AttributionNodeInternal> nodes = {node, node};
+    std::vector<AttributionNodeInternal> nodes(chainLength, node);
     event->write(nodes);
     event->write(3.2f);
     event->write("LOCATION");
     event->write((int64_t)990);
     event->init();
+}
 
+static void createFirstUidMatcher(FieldMatcher* field_matcher) {
     field_matcher->set_field(1);
     auto child = field_matcher->add_child();
     child->set_field(1);
@@ -45,6 +47,11 @@ static void createLogEventAndMatcher(LogEvent* event, FieldMatcher *field_matche
     child->add_child()->set_field(1);
 }
 
+static void createLogEventAndMatcher(LogEvent* event, FieldMatcher *field_matcher) {
+    writeEvent(event, 2);
+    createFirstUidMatcher(field_matcher);
+}
+
 static void BM_FilterValue(benchmark::State& state) {
     LogEvent event(1, 100000);
     FieldMatcher field_matcher;
@@ -61,6 +68,35 @@ static void BM_FilterValue(benchmark::State& state) {
 
 BENCHMARK(BM_FilterValue);
 
+// Events with long attribution chains, like wakelocks and jobs, that are dropped by their tag id.
+// Their values are never decoded.
+static void BM_LogEventLongChainDroppedByTag(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        LogEvent event(1, 100000);
+        writeEvent(&event, state.range(0));
+        benchmark::DoNotOptimize(event.GetTagId());
+    }
+}
+
+BENCHMARK(BM_LogEventLongChainDroppedByTag)->Arg(2)->Arg(10);
+
+// The same events with a dimension on the first uid, their values are decoded when filtered.
+static void BM_LogEventLongChainFilterFirstUid(benchmark::State& state) {
+    FieldMatcher field_matcher;
+    createFirstUidMatcher(&field_matcher);
+    std::vector<Matcher> matchers;
+    translateFieldMatcher(field_matcher, &matchers);
+
+    while (state.KeepRunning()) {
+        LogEvent event(1, 100000);
+        writeEvent(&event, state.range(0));
+        HashableDimensionKey output;
+        filterValues(matchers, event.getValues(), &output);
+    }
+}
+
+BENCHMARK(BM_LogEventLongChainFilterFirstUid)->Arg(2)->Arg(10);
+
 }  //  namespace statsd
 }  //  namespace os
 }  //  namespace android
@@ -69,6 +69,17 @@ static void BM_LogEventCreation(benchmark::State& state) {
 }
 BENCHMARK(BM_LogEventCreation);
 
+static void BM_LogEventReset(benchmark::State& state) {
+    log_msg msg;
+    getSimpleLogMsgData(&msg);
+    LogEvent event(msg);
+    while (state.KeepRunning()) {
+        event.reset(msg);
+        benchmark::DoNotOptimize(event.getValues().data());
+    }
+}
+BENCHMARK(BM_LogEventReset);
+
 }  //  namespace statsd
 }  //  namespace os
 }  //  namespace android
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "logd/LogEvent.h"
+#include "metric_util.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::vector;
+
+static const int kConfigCount = 20;
+static const int kMatchersPerConfig = 300;
+static const int kCountMetricsPerConfig = 30;
+
+// A config with many simple matchers spread over many atoms, as installed by many clients, with
+// count metrics on some of them.
+static StatsdConfig CreateManyMatchersConfig(int configIndex) {
+    StatsdConfig config;
+    config.add_allowed_log_source("AID_ROOT");  // LogEvent defaults to UID of root.
+    for (int i = 0; i < kMatchersPerConfig; i++) {
+        // Atom ids 200 to 349, two matchers each, none of the events below has them.
+        *config.add_atom_matcher() = CreateSimpleAtomMatcher(
+                "Config" + std::to_string(configIndex) + "Matcher" + std::to_string(i),
+                i % 150 + 200);
+    }
+    *config.add_atom_matcher() = CreateScreenTurnedOnAtomMatcher();
+    *config.add_atom_matcher() = CreateAcquireWakelockAtomMatcher();
+
+    for (int i = 0; i < kCountMetricsPerConfig; i++) {
+        CountMetric* metric = config.add_count_metric();
+        metric->set_id(StringToId("Config" + std::to_string(configIndex) + "Metric" +
+                                  std::to_string(i)));
+        metric->set_what(config.atom_matcher(i * kMatchersPerConfig / kCountMetricsPerConfig).id());
+        metric->set_bucket(FIVE_MINUTES);
+    }
+    CountMetric* screenMetric = config.add_count_metric();
+    screenMetric->set_id(StringToId("ScreenTurnedOn"));
+    screenMetric->set_what(StringToId("ScreenTurnedOn"));
+    screenMetric->set_bucket(FIVE_MINUTES);
+    CountMetric* wakelockMetric = config.add_count_metric();
+    wakelockMetric->set_id(StringToId("AcquireWakelock"));
+    wakelockMetric->set_what(StringToId("AcquireWakelock"));
+    wakelockMetric->set_bucket(FIVE_MINUTES);
+    return config;
+}
+
+static void BM_MetricsManagerManyConfigsManyMatchers(benchmark::State& state) {
+    int64_t bucketStartTimeNs = 10000000000;
+
+    sp<UidMap> uidMap = new UidMap();
+    sp<AlarmMonitor> anomalyAlarmMonitor;
+    sp<AlarmMonitor> periodicAlarmMonitor;
+    sp<StatsLogProcessor> processor = new StatsLogProcessor(
+            uidMap, anomalyAlarmMonitor, periodicAlarmMonitor, bucketStartTimeNs,
+            [](const ConfigKey&) { return true; });
+    for (int i = 0; i < kConfigCount; i++) {
+        processor->OnConfigUpdated(bucketStartTimeNs, ConfigKey(1000, i),
+                                   CreateManyMatchersConfig(i));
+    }
+
+    std::vector<AttributionNodeInternal> attributions = {CreateAttribution(111, "App1")};
+    std::vector<std::unique_ptr<LogEvent>> events;
+    for (int i = 0; i < 50; i++) {
+        events.push_back(CreateScreenStateChangedEvent(android::view::DISPLAY_STATE_ON,
+                                                       bucketStartTimeNs + 10 * i + 1));
+        events.push_back(CreateAcquireWakelockEvent(attributions, "wl1",
+                                                    bucketStartTimeNs + 10 * i + 2));
+        // No matcher cares about this one.
+        events.push_back(CreateAppCrashEvent(111, bucketStartTimeNs + 10 * i + 3));
+    }
+
+    while (state.KeepRunning()) {
+        for (const auto& event : events) {
+            processor->OnLogEvent(event.get());
+        }
+    }
+}
+
+BENCHMARK(BM_MetricsManagerManyConfigsManyMatchers);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
@@ -298,6 +298,17 @@ struct Value {
         type = LONG;
     }
 
+    void setFloat(float v) {
+        float_value = v;
+        type = FLOAT;
+    }
+
+    // Reuses the buffer of str_value when it is large enough.
+    void setString(const char* v, size_t len) {
+        str_value.assign(v, len);
+        type = STRING;
+    }
+
     union {
         int32_t int_value;
         int64_t long_value;
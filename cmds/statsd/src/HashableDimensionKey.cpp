@@ -28,9 +28,9 @@ namespace statsd {
 using std::string;
 using std::vector;
 
-android::hash_t hashDimension(const HashableDimensionKey& value) {
+static android::hash_t hashValues(const vector<FieldValue>& values) {
     android::hash_t hash = 0;
-    for (const auto& fieldValue : value.getValues()) {
+    for (const auto& fieldValue : values) {
         hash = android::JenkinsHashMix(hash, android::hash_type((int)fieldValue.mField.getField()));
         hash = android::JenkinsHashMix(hash, android::hash_type((int)fieldValue.mField.getTag()));
         hash = android::JenkinsHashMix(hash, android::hash_type((int)fieldValue.mValue.getType()));
@@ -59,6 +59,20 @@ android::hash_t hashDimension(const HashableDimensionKey& value) {
     return JenkinsHashWhiten(hash);
 }
 
+android::hash_t HashableDimensionKey::getHash() const {
+    uint64_t hash = mHash.load(std::memory_order_relaxed);
+    if (hash == 0) {
+        // Racing threads compute the same value.
+        hash = kHashComputed | hashValues(mValues);
+        mHash.store(hash, std::memory_order_relaxed);
+    }
+    return static_cast<android::hash_t>(hash);
+}
+
+android::hash_t hashDimension(const HashableDimensionKey& value) {
+    return value.getHash();
+}
+
 bool filterValues(const vector<Matcher>& matcherFields, const vector<FieldValue>& values,
                   HashableDimensionKey* output) {
     size_t num_matches = 0;
@@ -128,6 +142,12 @@ bool HashableDimensionKey::operator==(const HashableDimensionKey& that) const {
     if (mValues.size() != that.getValues().size()) {
         return false;
     }
+    // Keys found in a map have their hash, so different hashes reject them without comparing.
+    const uint64_t hash = mHash.load(std::memory_order_relaxed);
+    const uint64_t thatHash = that.mHash.load(std::memory_order_relaxed);
+    if (hash != 0 && thatHash != 0 && hash != thatHash) {
+        return false;
+    }
     size_t count = mValues.size();
     for (size_t i = 0; i < count; i++) {
         if (mValues[i] != (that.getValues())[i]) {
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <utils/JenkinsHash.h>
+#include <atomic>
 #include <vector>
 #include "FieldValue.h"
 #include "android-base/stringprintf.h"
@@ -42,10 +43,32 @@ public:
 
     HashableDimensionKey() {};
 
-    HashableDimensionKey(const HashableDimensionKey& that) : mValues(that.getValues()){};
+    HashableDimensionKey(const HashableDimensionKey& that)
+        : mValues(that.getValues()), mHash(that.mHash.load(std::memory_order_relaxed)){};
+
+    HashableDimensionKey(HashableDimensionKey&& that)
+        : mValues(std::move(that.mValues)), mHash(that.mHash.load(std::memory_order_relaxed)) {
+        that.mValues.clear();
+        that.mHash.store(0, std::memory_order_relaxed);
+    };
+
+    HashableDimensionKey& operator=(const HashableDimensionKey& that) {
+        mValues = that.mValues;
+        mHash.store(that.mHash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return *this;
+    }
+
+    HashableDimensionKey& operator=(HashableDimensionKey&& that) {
+        mValues = std::move(that.mValues);
+        mHash.store(that.mHash.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        that.mValues.clear();
+        that.mHash.store(0, std::memory_order_relaxed);
+        return *this;
+    }
 
     inline void addValue(const FieldValue& value) {
         mValues.push_back(value);
+        mHash.store(0, std::memory_order_relaxed);
     }
 
     inline const std::vector<FieldValue>& getValues() const {
@@ -53,16 +76,21 @@ public:
     }
 
     inline std::vector<FieldValue>* mutableValues() {
+        mHash.store(0, std::memory_order_relaxed);
         return &mValues;
     }
 
     inline FieldValue* mutableValue(size_t i) {
         if (i >= 0 && i < mValues.size()) {
+            mHash.store(0, std::memory_order_relaxed);
             return &(mValues[i]);
         }
         return nullptr;
     }
 
+    // Computed on first use and kept until the values are modified.
+    android::hash_t getHash() const;
+
     std::string toString() const;
 
     bool operator==(const HashableDimensionKey& that) const;
@@ -73,6 +101,11 @@ public:
 
 private:
     std::vector<FieldValue> mValues;
+
+    // The hash of mValues with kHashComputed set, or 0 if it isn't computed. Keys are hashed at
+    // every lookup in the dimension maps of the producers, and copied with their hash into them.
+    static const uint64_t kHashComputed = 1ULL << 32;
+    mutable std::atomic<uint64_t> mHash{0};
 };
 
 class MetricDimensionKey {
@@ -88,8 +121,12 @@ class MetricDimensionKey {
         : mDimensionKeyInWhat(that.getDimensionKeyInWhat()),
           mDimensionKeyInCondition(that.getDimensionKeyInCondition()) {};
 
+    MetricDimensionKey(MetricDimensionKey&& that) = default;
+
     MetricDimensionKey& operator=(const MetricDimensionKey& from) = default;
 
+    MetricDimensionKey& operator=(MetricDimensionKey&& from) = default;
+
     std::string toString() const;
 
     inline const HashableDimensionKey& getDimensionKeyInWhat() const {
@@ -29,6 +29,7 @@
 #include "stats_util.h"
 #include "storage/StorageManager.h"
 
+#include <android/util/ScopeTimer.h>
 #include <log/log_event_list.h>
 #include <utils/Errors.h>
 #include <utils/SystemClock.h>
@@ -69,8 +70,6 @@ const int FIELD_ID_STRINGS = 9;
 
 #define NS_PER_HOUR 3600 * NS_PER_SEC
 
-#define STATS_DATA_DIR "/data/misc/stats-data"
-
 // Cool down period for writing data to disk to avoid overwriting files.
 #define WRITE_DATA_COOL_DOWN_SEC 5
 
@@ -97,6 +96,8 @@ void StatsLogProcessor::onAnomalyAlarmFired(
         unordered_set<sp<const InternalAlarm>, SpHash<InternalAlarm>> alarmSet) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
     for (const auto& itr : mMetricsManagers) {
+        // Anomaly trackers are also updated when a report flushes the buckets of its metrics.
+        std::lock_guard<std::mutex> reportLock(itr.second->getReportMutex());
         itr.second->onAnomalyAlarmFired(timestampNs, alarmSet);
     }
 }
@@ -180,8 +181,19 @@ void StatsLogProcessor::resetConfigsLocked(const int64_t timestampNs) {
 }
 
 void StatsLogProcessor::OnLogEvent(LogEvent* event, bool reconnected) {
+    SCOPE_TIMER("statsd.OnLogEvent");
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    OnLogEventLocked(event, reconnected);
+}
 
+void StatsLogProcessor::OnLogEvents(const vector<LogEvent*>& events) {
+    std::lock_guard<std::mutex> lock(mMetricsMutex);
+    for (LogEvent* event : events) {
+        OnLogEventLocked(event, false);
+    }
+}
+
+void StatsLogProcessor::OnLogEventLocked(LogEvent* event, bool reconnected) {
 #ifdef VERY_VERBOSE_PRINTING
     if (mPrintAllLogs) {
         ALOGI("%s", event->ToString().c_str());
@@ -246,9 +258,15 @@ void StatsLogProcessor::OnLogEvent(LogEvent* event, bool reconnected) {
     }
 
 
+    // Map the isolated uid to host uid if necessary. Only done when a config wants the atom,
+    // otherwise the values of the event, which are parsed on first read, are never read.
     if (event->GetTagId() != android::util::ISOLATED_UID_CHANGED) {
-        // Map the isolated uid to host uid if necessary.
-        mapIsolatedUidToHostUidIfNecessaryLocked(event);
+        for (const auto& pair : mMetricsManagers) {
+            if (pair.second->isInterestedInAtom(event->GetTagId())) {
+                mapIsolatedUidToHostUidIfNecessaryLocked(event);
+                break;
+            }
+        }
     }
 
     // pass the event to metrics managers.
@@ -261,8 +279,25 @@ void StatsLogProcessor::OnLogEvent(LogEvent* event, bool reconnected) {
 void StatsLogProcessor::OnConfigUpdated(const int64_t timestampNs, const ConfigKey& key,
                                         const StatsdConfig& config) {
     std::lock_guard<std::mutex> lock(mMetricsMutex);
+    auto it = mMetricsManagers.find(key);
+    if (it == mMetricsManagers.end()) {
+        OnConfigUpdatedLocked(timestampNs, key, config);
+        return;
+    }
+
+    VLOG("Updated configuration for key %s", key.ToString().c_str());
+    sp<MetricsManager> oldMetricsManager = it->second;
+    sp<MetricsManager> newMetricsManager =
+        new MetricsManager(key, config, mTimeBaseNs, timestampNs, mUidMap,
+                           mAnomalyAlarmMonitor, mPeriodicAlarmMonitor);
+    // The metrics that didn't change keep their state and their current bucket, the data of the
+    // others is written to disk before they're dropped.
+    const std::set<int64_t> keptMetricIds =
+            newMetricsManager->getUnchangedMetricIds(*oldMetricsManager);
+    oldMetricsManager->setMetricsKeptByUpdate(keptMetricIds);
     WriteDataToDiskLocked(key, timestampNs, CONFIG_UPDATED);
-    OnConfigUpdatedLocked(timestampNs, key, config);
+    newMetricsManager->inheritMetrics(*oldMetricsManager, keptMetricIds, timestampNs);
+    installMetricsManagerLocked(timestampNs, key, newMetricsManager);
 }
 
 void StatsLogProcessor::OnConfigUpdatedLocked(
@@ -271,6 +306,12 @@ void StatsLogProcessor::OnConfigUpdatedLocked(
     sp<MetricsManager> newMetricsManager =
         new MetricsManager(key, config, mTimeBaseNs, timestampNs, mUidMap,
                            mAnomalyAlarmMonitor, mPeriodicAlarmMonitor);
+    installMetricsManagerLocked(timestampNs, key, newMetricsManager);
+}
+
+void StatsLogProcessor::installMetricsManagerLocked(const int64_t timestampNs,
+                                                    const ConfigKey& key,
+                                                    const sp<MetricsManager>& newMetricsManager) {
     if (newMetricsManager->isConfigValid()) {
         mUidMap->OnConfigUpdated(key);
         if (newMetricsManager->shouldAddUidMapListener()) {
@@ -305,6 +346,47 @@ void StatsLogProcessor::dumpStates(FILE* out, bool verbose) {
     }
 }
 
+sp<MetricsManager> StatsLogProcessor::getMetricsManagerForDump(const ConfigKey& key) {
+    // Only finding the config needs the lock, the reports on disk are read and the report is
+    // written without it, so that events keep being processed during large dumps.
+    std::lock_guard<std::mutex> lock(mMetricsMutex);
+    auto it = mMetricsManagers.find(key);
+    if (it == mMetricsManagers.end()) {
+        return nullptr;
+    }
+    // This allows another broadcast to be sent within the rate-limit period if we get
+    // close to filling the buffer again soon.
+    mLastBroadcastTimes.erase(key);
+    return it->second;
+}
+
+void StatsLogProcessor::writeConfigKey(const ConfigKey& key, ProtoOutputStream* proto) {
+    // Start of ConfigKey.
+    uint64_t configKeyToken = proto->start(FIELD_TYPE_MESSAGE | FIELD_ID_CONFIG_KEY);
+    proto->write(FIELD_TYPE_INT32 | FIELD_ID_UID, key.GetUid());
+    proto->write(FIELD_TYPE_INT64 | FIELD_ID_ID, (long long)key.GetId());
+    proto->end(configKeyToken);
+    // End of ConfigKey.
+}
+
+/*
+ * Writes the tag and the size of a length delimited field to fd, for a message whose bytes are
+ * written right after it. Adds the number of bytes written to outSize.
+ */
+static bool writeLengthDelimitedHeader(int fd, uint32_t fieldId, size_t size, size_t* outSize) {
+    uint8_t header[16];
+    size_t pos = 0;
+    for (uint64_t value : {(uint64_t)(fieldId << 3 | 2 /* length delimited */), (uint64_t)size}) {
+        while (value >= 0x80) {
+            header[pos++] = (uint8_t)(value | 0x80);
+            value >>= 7;
+        }
+        header[pos++] = (uint8_t)value;
+    }
+    *outSize += pos;
+    return android::base::WriteFully(fd, header, pos);
+}
+
 /*
  * onDumpReport dumps serialized ConfigMetricsReportList into outData.
  */
@@ -312,32 +394,21 @@ void StatsLogProcessor::onDumpReport(const ConfigKey& key, const int64_t dumpTim
                                      const bool include_current_partial_bucket,
                                      const DumpReportReason dumpReportReason,
                                      vector<uint8_t>* outData) {
-    std::lock_guard<std::mutex> lock(mMetricsMutex);
+    sp<MetricsManager> metricsManager = getMetricsManagerForDump(key);
 
     ProtoOutputStream proto;
-
-    // Start of ConfigKey.
-    uint64_t configKeyToken = proto.start(FIELD_TYPE_MESSAGE | FIELD_ID_CONFIG_KEY);
-    proto.write(FIELD_TYPE_INT32 | FIELD_ID_UID, key.GetUid());
-    proto.write(FIELD_TYPE_INT64 | FIELD_ID_ID, (long long)key.GetId());
-    proto.end(configKeyToken);
-    // End of ConfigKey.
+    writeConfigKey(key, &proto);
 
     // Then, check stats-data directory to see there's any file containing
     // ConfigMetricsReport from previous shutdowns to concatenate to reports.
     StorageManager::appendConfigMetricsReport(key, &proto);
 
-    auto it = mMetricsManagers.find(key);
-    if (it != mMetricsManagers.end()) {
-        // This allows another broadcast to be sent within the rate-limit period if we get close to
-        // filling the buffer again soon.
-        mLastBroadcastTimes.erase(key);
-
+    if (metricsManager != nullptr) {
         // Start of ConfigMetricsReport (reports).
         uint64_t reportsToken =
                 proto.start(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_REPORTS);
-        onConfigMetricsReportLocked(key, dumpTimeStampNs, include_current_partial_bucket,
-                                    dumpReportReason, &proto);
+        onConfigMetricsReport(key, *metricsManager, dumpTimeStampNs,
+                              include_current_partial_bucket, dumpReportReason, &proto);
         proto.end(reportsToken);
         // End of ConfigMetricsReport (reports).
     } else {
@@ -361,34 +432,75 @@ void StatsLogProcessor::onDumpReport(const ConfigKey& key, const int64_t dumpTim
 }
 
 /*
- * onConfigMetricsReportLocked dumps serialized ConfigMetricsReport into outData.
+ * onDumpReport streams serialized ConfigMetricsReportList into outFd.
  */
-void StatsLogProcessor::onConfigMetricsReportLocked(const ConfigKey& key,
-                                                    const int64_t dumpTimeStampNs,
-                                                    const bool include_current_partial_bucket,
-                                                    const DumpReportReason dumpReportReason,
-                                                    ProtoOutputStream* proto) {
-    // We already checked whether key exists in mMetricsManagers in
-    // WriteDataToDisk.
-    auto it = mMetricsManagers.find(key);
-    if (it == mMetricsManagers.end()) {
-        return;
+bool StatsLogProcessor::onDumpReport(const ConfigKey& key, const int64_t dumpTimeStampNs,
+                                     const bool include_current_partial_bucket,
+                                     const DumpReportReason dumpReportReason, int outFd) {
+    sp<MetricsManager> metricsManager = getMetricsManagerForDump(key);
+
+    size_t reportSize = 0;
+    {
+        ProtoOutputStream proto;
+        writeConfigKey(key, &proto);
+        reportSize += proto.size();
+        if (!proto.flush(outFd)) {
+            ALOGE("Failed to write the config key of %s", key.ToString().c_str());
+            return false;
+        }
     }
-    int64_t lastReportTimeNs = it->second->getLastReportTimeNs();
-    int64_t lastReportWallClockNs = it->second->getLastReportWallClockNs();
+    // The reports on disk are already serialized, they're copied without being parsed.
+    if (!StorageManager::writeConfigMetricsReports(key, outFd, &reportSize)) {
+        ALOGE("Failed to write the stored reports of %s", key.ToString().c_str());
+        return false;
+    }
+
+    if (metricsManager != nullptr) {
+        // The size of the report comes before it, so it's completed before being written. The
+        // metric producers clear their buckets as they write them, the memory only moves from
+        // the buckets to the report.
+        ProtoOutputStream proto;
+        onConfigMetricsReport(key, *metricsManager, dumpTimeStampNs,
+                              include_current_partial_bucket, dumpReportReason, &proto);
+        if (!writeLengthDelimitedHeader(outFd, FIELD_ID_REPORTS, proto.size(), &reportSize) ||
+            !proto.flush(outFd)) {
+            ALOGE("Failed to write the report of %s", key.ToString().c_str());
+            return false;
+        }
+        reportSize += proto.size();
+    } else {
+        ALOGW("Config source %s does not exist", key.ToString().c_str());
+    }
+
+    StatsdStats::getInstance().noteMetricsReportSent(key, reportSize);
+    return true;
+}
+
+/*
+ * onConfigMetricsReport dumps serialized ConfigMetricsReport into outData.
+ */
+void StatsLogProcessor::onConfigMetricsReport(const ConfigKey& key,
+                                              MetricsManager& metricsManager,
+                                              const int64_t dumpTimeStampNs,
+                                              const bool include_current_partial_bucket,
+                                              const DumpReportReason dumpReportReason,
+                                              ProtoOutputStream* proto) {
+    std::lock_guard<std::mutex> reportLock(metricsManager.getReportMutex());
+    int64_t lastReportTimeNs = metricsManager.getLastReportTimeNs();
+    int64_t lastReportWallClockNs = metricsManager.getLastReportWallClockNs();
 
     std::set<string> str_set;
 
     // First, fill in ConfigMetricsReport using current data on memory, which
     // starts from filling in StatsLogReport's.
-    it->second->onDumpReport(dumpTimeStampNs, include_current_partial_bucket,
-                             &str_set, proto);
+    metricsManager.onDumpReport(dumpTimeStampNs, include_current_partial_bucket,
+                                &str_set, proto);
 
     // Fill in UidMap if there is at least one metric to report.
     // This skips the uid map if it's an empty config.
-    if (it->second->getNumMetrics() > 0) {
+    if (metricsManager.getNumMetrics() > 0) {
         uint64_t uidMapToken = proto->start(FIELD_TYPE_MESSAGE | FIELD_ID_UID_MAP);
-        if (it->second->hashStringInReport()) {
+        if (metricsManager.hashStringInReport()) {
             mUidMap->appendUidMap(dumpTimeStampNs, key, &str_set, proto);
         } else {
             mUidMap->appendUidMap(dumpTimeStampNs, key, nullptr, proto);
@@ -478,10 +590,11 @@ void StatsLogProcessor::flushIfNecessaryLocked(
         metricsManager.dropData(timestampNs);
         StatsdStats::getInstance().noteDataDropped(key);
         VLOG("StatsD had to toss out metrics for %s", key.ToString().c_str());
-    } else if ((totalBytes > StatsdStats::kBytesPerConfigTriggerGetData) ||
+    } else if ((totalBytes + metricsManager.spilledByteSize() >
+                StatsdStats::kBytesPerConfigTriggerGetData) ||
                (mOnDiskDataConfigs.find(key) != mOnDiskDataConfigs.end())) {
         // Request to send a broadcast if:
-        // 1. in memory data > threshold   OR
+        // 1. in memory and spilled data > threshold   OR
         // 2. config has old data report on disk.
         requestDump = true;
     }
@@ -504,29 +617,30 @@ void StatsLogProcessor::flushIfNecessaryLocked(
     }
 }
 
-void StatsLogProcessor::WriteDataToDiskLocked(const ConfigKey& key,
-                                              const int64_t timestampNs,
-                                              const DumpReportReason dumpReportReason) {
-    if (mMetricsManagers.find(key) == mMetricsManagers.end() ||
-        !mMetricsManagers.find(key)->second->shouldWriteToDisk()) {
+void StatsLogProcessor::appendReportToDiskLocked(const ConfigKey& key,
+                                                 const int64_t timestampNs,
+                                                 const DumpReportReason dumpReportReason) {
+    auto it = mMetricsManagers.find(key);
+    if (it == mMetricsManagers.end() || !it->second->shouldWriteToDisk()) {
         return;
     }
     ProtoOutputStream proto;
-    onConfigMetricsReportLocked(key, timestampNs, true /* include_current_partial_bucket*/,
-                                dumpReportReason, &proto);
-    string file_name = StringPrintf("%s/%ld_%d_%lld", STATS_DATA_DIR,
-         (long)getWallClockSec(), key.GetUid(), (long long)key.GetId());
-    android::base::unique_fd fd(open(file_name.c_str(),
-                                O_WRONLY | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR));
-    if (fd == -1) {
-        ALOGE("Attempt to write %s but failed", file_name.c_str());
+    onConfigMetricsReport(key, *it->second, timestampNs, true /* include_current_partial_bucket*/,
+                          dumpReportReason, &proto);
+    if (!StorageManager::appendToReportLog(key, &proto)) {
         return;
     }
-    proto.flush(fd.get());
     // We were able to write the ConfigMetricsReport to disk, so we should trigger collection ASAP.
     mOnDiskDataConfigs.insert(key);
 }
 
+void StatsLogProcessor::WriteDataToDiskLocked(const ConfigKey& key,
+                                              const int64_t timestampNs,
+                                              const DumpReportReason dumpReportReason) {
+    appendReportToDiskLocked(key, timestampNs, dumpReportReason);
+    StorageManager::flushReportLogs();
+}
+
 void StatsLogProcessor::WriteDataToDiskLocked(const DumpReportReason dumpReportReason) {
     const int64_t timeNs = getElapsedRealtimeNs();
     // Do not write to disk if we already have in the last few seconds.
@@ -540,8 +654,10 @@ void StatsLogProcessor::WriteDataToDiskLocked(const DumpReportReason dumpReportR
     }
     mLastWriteTimeNs = timeNs;
     for (auto& pair : mMetricsManagers) {
-        WriteDataToDiskLocked(pair.first, timeNs, dumpReportReason);
+        appendReportToDiskLocked(pair.first, timeNs, dumpReportReason);
     }
+    // Synced once for all the configs.
+    StorageManager::flushReportLogs();
 }
 
 void StatsLogProcessor::WriteDataToDisk(const DumpReportReason dumpReportReason) {
@@ -559,6 +675,8 @@ int64_t StatsLogProcessor::getLastReportTimeNs(const ConfigKey& key) {
     if (it == mMetricsManagers.end()) {
         return 0;
     } else {
+        // Written by the reports, which only hold the report mutex.
+        std::lock_guard<std::mutex> reportLock(it->second->getReportMutex());
         return it->second->getLastReportTimeNs();
     }
 }
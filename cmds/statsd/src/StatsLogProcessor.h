@@ -54,6 +54,9 @@ public:
 
     void OnLogEvent(LogEvent* event, bool reconnectionStarts);
 
+    // Processes the events in order, holding the lock once for all of them.
+    void OnLogEvents(const std::vector<LogEvent*>& events);
+
     // for testing only.
     void OnLogEvent(LogEvent* event);
 
@@ -67,6 +70,13 @@ public:
                       const bool include_current_partial_bucket,
                       const DumpReportReason dumpReportReason, vector<uint8_t>* outData);
 
+    // Same as above, but streams the ConfigMetricsReportList to outFd. The reports stored on disk
+    // are written before the current one is built, and nothing is copied into a second buffer,
+    // so only the largest report is held in memory at a time. Returns false if writing failed.
+    bool onDumpReport(const ConfigKey& key, const int64_t dumpTimeNs,
+                      const bool include_current_partial_bucket,
+                      const DumpReportReason dumpReportReason, int outFd);
+
     /* Tells MetricsManager that the alarms in alarmSet have fired. Modifies anomaly alarmSet. */
     void onAnomalyAlarmFired(
             const int64_t& timestampNs,
@@ -138,20 +148,38 @@ private:
     void OnConfigUpdatedLocked(
         const int64_t currentTimestampNs, const ConfigKey& key, const StatsdConfig& config);
 
+    // Replaces the MetricsManager of key if the new one is valid.
+    void installMetricsManagerLocked(const int64_t timestampNs, const ConfigKey& key,
+                                     const sp<MetricsManager>& newMetricsManager);
+
     void WriteDataToDiskLocked(const DumpReportReason dumpReportReason);
     void WriteDataToDiskLocked(const ConfigKey& key, const int64_t timestampNs,
                                const DumpReportReason dumpReportReason);
+    // Same as WriteDataToDiskLocked() without syncing the report logs.
+    void appendReportToDiskLocked(const ConfigKey& key, const int64_t timestampNs,
+                                  const DumpReportReason dumpReportReason);
 
-    void onConfigMetricsReportLocked(const ConfigKey& key, const int64_t dumpTimeStampNs,
-                                     const bool include_current_partial_bucket,
-                                     const DumpReportReason dumpReportReason,
-                                     util::ProtoOutputStream* proto);
+    // Finds the MetricsManager of key, or returns nullptr, and allows another broadcast for it.
+    sp<MetricsManager> getMetricsManagerForDump(const ConfigKey& key);
+
+    // Writes the ConfigKey of the report list.
+    void writeConfigKey(const ConfigKey& key, util::ProtoOutputStream* proto);
+
+    // Only needs the report lock of metricsManager, the metric producers lock themselves so the
+    // report can be written while events are processed.
+    void onConfigMetricsReport(const ConfigKey& key, MetricsManager& metricsManager,
+                               const int64_t dumpTimeStampNs,
+                               const bool include_current_partial_bucket,
+                               const DumpReportReason dumpReportReason,
+                               util::ProtoOutputStream* proto);
 
     /* Check if we should send a broadcast if approaching memory limits and if we're over, we
      * actually delete the data. */
     void flushIfNecessaryLocked(int64_t timestampNs, const ConfigKey& key,
                                 MetricsManager& metricsManager);
 
+    void OnLogEventLocked(LogEvent* event, bool reconnectionStarts);
+
     // Maps the isolated uid in the log event to host uid if the log event contains uid fields.
     void mapIsolatedUidToHostUidIfNecessaryLocked(LogEvent* event) const;
 
@@ -195,6 +223,7 @@ private:
     FRIEND_TEST(StatsLogProcessorTest, TestRateLimitByteSize);
     FRIEND_TEST(StatsLogProcessorTest, TestRateLimitBroadcast);
     FRIEND_TEST(StatsLogProcessorTest, TestDropWhenByteSizeTooLarge);
+    FRIEND_TEST(StatsLogProcessorTest, TestConfigUpdateKeepsUnchangedMetrics);
     FRIEND_TEST(WakelockDurationE2eTest, TestAggregatedPredicateDimensionsForSumDuration1);
     FRIEND_TEST(WakelockDurationE2eTest, TestAggregatedPredicateDimensionsForSumDuration2);
     FRIEND_TEST(WakelockDurationE2eTest, TestAggregatedPredicateDimensionsForSumDuration3);
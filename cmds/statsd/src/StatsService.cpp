@@ -28,6 +28,7 @@
 
 #include <android-base/file.h>
 #include <android-base/stringprintf.h>
+#include <android/util/ScopeTimer.h>
 #include <binder/IPCThreadState.h>
 #include <binder/IServiceManager.h>
 #include <binder/PermissionController.h>
@@ -283,6 +284,7 @@ void StatsService::dump_impl(FILE* out, bool verbose, bool proto) {
     } else {
         StatsdStats::getInstance().dumpStats(out);
         mProcessor->dumpStates(out, verbose);
+        android::util::ScopeTimer::dump(out);
     }
 }
 
@@ -341,6 +343,10 @@ status_t StatsService::command(FILE* in, FILE* out, FILE* err, Vector<String8>&
         if (!args[0].compare(String8("print-logs"))) {
             return cmd_print_logs(out, args);
         }
+
+        if (!args[0].compare(String8("profile"))) {
+            return cmd_profile(out, args);
+        }
     }
 
     print_cmd_help(out);
@@ -429,6 +435,11 @@ void StatsService::print_cmd_help(FILE* out) {
     fprintf(out, "\n");
     fprintf(out, "usage: adb shell cmd stats print-logs\n");
     fprintf(out, "      Only works on eng build\n");
+    fprintf(out, "\n");
+    fprintf(out, "usage: adb shell cmd stats profile [RATE]\n");
+    fprintf(out, "  Times the matchers, conditions and metrics of every config on one event in\n");
+    fprintf(out, "  RATE. The times are in print-stats. A RATE of 0 turns it off.\n");
+    fprintf(out, "  RATE          Defaults to 100.\n");
 }
 
 status_t StatsService::cmd_trigger_broadcast(FILE* out, Vector<String8>& args) {
@@ -600,15 +611,17 @@ status_t StatsService::cmd_dump_report(FILE* out, FILE* err, const Vector<String
             }
         }
         if (good) {
-            vector<uint8_t> data;
-            mProcessor->onDumpReport(ConfigKey(uid, StrToInt64(name)), getElapsedRealtimeNs(),
-                                     false /* include_current_bucket*/, ADB_DUMP, &data);
             // TODO: print the returned StatsLogReport to file instead of printing to logcat.
             if (proto) {
-                for (size_t i = 0; i < data.size(); i ++) {
-                    fprintf(out, "%c", data[i]);
-                }
+                // Streamed to the shell, reports can be much larger than the usual output.
+                fflush(out);
+                mProcessor->onDumpReport(ConfigKey(uid, StrToInt64(name)), getElapsedRealtimeNs(),
+                                         false /* include_current_bucket*/, ADB_DUMP,
+                                         fileno(out));
             } else {
+                vector<uint8_t> data;
+                mProcessor->onDumpReport(ConfigKey(uid, StrToInt64(name)), getElapsedRealtimeNs(),
+                                         false /* include_current_bucket*/, ADB_DUMP, &data);
                 fprintf(out, "Dump report for Config [%d,%s]\n", uid, name.c_str());
                 fprintf(out, "See the StatsLogReport in logcat...\n");
             }
@@ -763,6 +776,27 @@ status_t StatsService::cmd_print_logs(FILE* out, const Vector<String8>& args) {
     }
 }
 
+status_t StatsService::cmd_profile(FILE* out, const Vector<String8>& args) {
+    IPCThreadState* ipc = IPCThreadState::self();
+    VLOG("StatsService::cmd_profile with Pid %i, Uid %i", ipc->getCallingPid(),
+         ipc->getCallingUid());
+    if (checkCallingPermission(String16(kPermissionDump))) {
+        int sampleRate = 100;
+        if (args.size() >= 2) {
+            sampleRate = atoi(args[1].c_str());
+        }
+        StatsdStats::getInstance().setProfilingSampleRate(sampleRate);
+        if (sampleRate > 0) {
+            fprintf(out, "Profiling one event in %d\n", sampleRate);
+        } else {
+            fprintf(out, "Profiling is off\n");
+        }
+        return NO_ERROR;
+    } else {
+        return PERMISSION_DENIED;
+    }
+}
+
 Status StatsService::informAllUidData(const vector<int32_t>& uid, const vector<int64_t>& version,
                                       const vector<String16>& app) {
     ENFORCE_UID(AID_SYSTEM);
@@ -878,6 +912,7 @@ Status StatsService::statsCompanionReady() {
 }
 
 void StatsService::Startup() {
+    StorageManager::deleteSpillFiles();
     mConfigManager->Startup();
 }
 
@@ -892,6 +927,10 @@ void StatsService::OnLogEvent(LogEvent* event, bool reconnectionStarts) {
     mProcessor->OnLogEvent(event, reconnectionStarts);
 }
 
+void StatsService::OnLogEvents(const vector<LogEvent*>& events) {
+    mProcessor->OnLogEvents(events);
+}
+
 Status StatsService::getData(int64_t key, const String16& packageName, vector<uint8_t>* output) {
     ENFORCE_DUMP_AND_USAGE_STATS(packageName);
 
@@ -83,6 +83,11 @@ public:
      */
     virtual void OnLogEvent(LogEvent* event, bool reconnectionStarts);
 
+    /**
+     * Called by StatsSocketListener with the events of a batch of datagrams.
+     */
+    virtual void OnLogEvents(const vector<LogEvent*>& events);
+
     /**
      * Binder call for clients to request data for this configuration key.
      */
@@ -235,6 +240,11 @@ private:
      */
     status_t cmd_print_logs(FILE* out, const Vector<String8>& args);
 
+    /**
+     * Sets the rate at which the events are profiled.
+     */
+    status_t cmd_profile(FILE* out, const Vector<String8>& args);
+
     /**
      * Adds a configuration after checking permissions and obtaining UID from binder call.
      */
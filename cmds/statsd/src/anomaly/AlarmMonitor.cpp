@@ -90,6 +90,35 @@ void AlarmMonitor::remove(sp<const InternalAlarm> alarm) {
     }
 }
 
+void AlarmMonitor::replace(sp<const InternalAlarm> oldAlarm, sp<const InternalAlarm> newAlarm) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (oldAlarm != nullptr) {
+        mPq.remove(oldAlarm);
+    }
+    if (newAlarm == nullptr) {
+        ALOGW("Asked to add a null alarm.");
+    } else if (newAlarm->timestampSec < 1) {
+        ALOGW("Asked to add a 0-time alarm.");
+    } else {
+        VLOG("Replacing alarm with time %u", newAlarm->timestampSec);
+        mPq.push(newAlarm);
+    }
+    if (mPq.empty()) {
+        if (mRegisteredAlarmTimeSec > 0) {
+            VLOG("Queue is empty. Cancel any alarm.");
+            cancelRegisteredAlarmTime_l();
+        }
+        return;
+    }
+    // The rules of add() for a sooner alarm, and of remove() for a later one.
+    uint32_t soonestAlarmTimeSec = mPq.top()->timestampSec;
+    if (mRegisteredAlarmTimeSec < 1 ||
+        soonestAlarmTimeSec + mMinUpdateTimeSec < mRegisteredAlarmTimeSec ||
+        soonestAlarmTimeSec > mRegisteredAlarmTimeSec + mMinUpdateTimeSec) {
+        updateRegisteredAlarmTime_l(soonestAlarmTimeSec);
+    }
+}
+
 // More efficient than repeatedly calling remove(mPq.top()) since it batches the
 // updates to the registered alarm.
 unordered_set<sp<const InternalAlarm>, SpHash<InternalAlarm>> AlarmMonitor::popSoonerThan(
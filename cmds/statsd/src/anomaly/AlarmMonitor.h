@@ -90,6 +90,13 @@ public:
      */
     void remove(sp<const InternalAlarm> alarm);
 
+    /**
+     * Removes oldAlarm, if not nullptr, and adds newAlarm. Same as remove() then add(), but
+     * takes the lock once and updates the registered alarm at most once, which matters to
+     * duration metrics that move the alarms of many dimensions.
+     */
+    void replace(sp<const InternalAlarm> oldAlarm, sp<const InternalAlarm> newAlarm);
+
     /**
      * Returns and removes all alarms whose timestamp <= the given timestampSec.
      * Always updates the registered alarm if return is non-empty.
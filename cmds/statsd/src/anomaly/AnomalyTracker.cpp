@@ -51,10 +51,10 @@ AnomalyTracker::~AnomalyTracker() {
 
 void AnomalyTracker::resetStorage() {
     VLOG("resetStorage() called.");
-    mPastBuckets.clear();
+    mPastValues.clear();
+    mBucketDimensions.clear();
     // Excludes the current bucket.
-    mPastBuckets.resize(mNumOfPastBuckets);
-    mSumOverPastBuckets.clear();
+    mBucketDimensions.resize(mNumOfPastBuckets);
 }
 
 size_t AnomalyTracker::index(int64_t bucketNum) const {
@@ -81,11 +81,9 @@ void AnomalyTracker::advanceMostRecentBucketTo(const int64_t& bucketNum) {
         return;
     }
 
-    // Clear out space by emptying out old mPastBuckets[i] values and update mSumOverPastBuckets.
+    // Clear out space by emptying out the old buckets.
     for (int64_t i = mMostRecentBucketNum + 1; i <= bucketNum; i++) {
-        const int idx = index(i);
-        subtractBucketFromSum(mPastBuckets[idx]);
-        mPastBuckets[idx] = nullptr;  // release (but not clear) the old bucket.
+        clearPastBucket(index(i));
     }
     mMostRecentBucketNum = bucketNum;
 }
@@ -99,25 +97,12 @@ void AnomalyTracker::addPastBucket(const MetricDimensionKey& key,
         return;
     }
 
-    const int bucketIndex = index(bucketNum);
-    if (bucketNum <= mMostRecentBucketNum && (mPastBuckets[bucketIndex] != nullptr)) {
-        // We need to insert into an already existing past bucket.
-        std::shared_ptr<DimToValMap>& bucket = mPastBuckets[bucketIndex];
-        auto itr = bucket->find(key);
-        if (itr != bucket->end()) {
-            // Old entry already exists; update it.
-            subtractValueFromSum(key, itr->second);
-            itr->second = bucketValue;
-        } else {
-            bucket->insert({key, bucketValue});
-        }
-        mSumOverPastBuckets[key] += bucketValue;
-    } else {
-        // Bucket does not exist yet (in future or was never made), so we must make it.
-        std::shared_ptr<DimToValMap> bucket = std::make_shared<DimToValMap>();
-        bucket->insert({key, bucketValue});
-        addPastBucket(bucket, bucketNum);
+    if (bucketNum > mMostRecentBucketNum) {
+        // Clear space for the new bucket to be at bucketNum.
+        advanceMostRecentBucketTo(bucketNum);
     }
+    // Inserts into the bucket, or replaces the old entry of key.
+    setPastValue(index(bucketNum), key, bucketValue);
 }
 
 void AnomalyTracker::addPastBucket(std::shared_ptr<DimToValMap> bucket,
@@ -128,46 +113,72 @@ void AnomalyTracker::addPastBucket(std::shared_ptr<DimToValMap> bucket,
         return;
     }
 
+    const size_t bucketIndex = index(bucketNum);
     if (bucketNum <= mMostRecentBucketNum) {
         // We are updating an old bucket, not adding a new one.
-        subtractBucketFromSum(mPastBuckets[index(bucketNum)]);
+        clearPastBucket(bucketIndex);
     } else {
         // Clear space for the new bucket to be at bucketNum.
         advanceMostRecentBucketTo(bucketNum);
     }
-    mPastBuckets[index(bucketNum)] = bucket;
-    addBucketToSum(bucket);
-}
-
-void AnomalyTracker::subtractBucketFromSum(const shared_ptr<DimToValMap>& bucket) {
     if (bucket == nullptr) {
         return;
     }
+    mBucketDimensions[bucketIndex].reserve(bucket->size());
     for (const auto& keyValuePair : *bucket) {
-        subtractValueFromSum(keyValuePair.first, keyValuePair.second);
+        setPastValue(bucketIndex, keyValuePair.first, keyValuePair.second);
     }
 }
 
-
-void AnomalyTracker::subtractValueFromSum(const MetricDimensionKey& key,
-                                          const int64_t& bucketValue) {
-    auto itr = mSumOverPastBuckets.find(key);
-    if (itr == mSumOverPastBuckets.end()) {
-        return;
+void AnomalyTracker::setPastValue(const size_t bucketIndex, const MetricDimensionKey& key,
+                                  const int64_t& bucketValue) {
+    auto it = mPastValues.find(key);
+    if (it == mPastValues.end()) {
+        if (bucketValue == 0) {
+            return;
+        }
+        it = mPastValues.emplace(key, PastValues(mNumOfPastBuckets)).first;
     }
-    itr->second -= bucketValue;
-    if (itr->second == 0) {
-        mSumOverPastBuckets.erase(itr);
+    PastValuesMap::value_type* entry = &*it;
+    PastValues& pastValues = entry->second;
+    const int64_t oldValue = pastValues.values[bucketIndex];
+    pastValues.values[bucketIndex] = bucketValue;
+    pastValues.sum += bucketValue - oldValue;
+    if (oldValue == 0 && bucketValue != 0) {
+        mBucketDimensions[bucketIndex].push_back(entry);
+        pastValues.bucketCount++;
+    } else if (oldValue != 0 && bucketValue == 0) {
+        // Rare, the values of a bucket are usually only replaced by larger ones.
+        auto& dimensions = mBucketDimensions[bucketIndex];
+        for (size_t i = 0; i < dimensions.size(); i++) {
+            if (dimensions[i] == entry) {
+                dimensions[i] = dimensions.back();
+                dimensions.pop_back();
+                break;
+            }
+        }
+        pastValues.bucketCount--;
+        erasePastValuesIfEmpty(entry);
     }
 }
 
-void AnomalyTracker::addBucketToSum(const shared_ptr<DimToValMap>& bucket) {
-    if (bucket == nullptr) {
-        return;
+void AnomalyTracker::clearPastBucket(const size_t bucketIndex) {
+    auto& dimensions = mBucketDimensions[bucketIndex];
+    for (auto entry : dimensions) {
+        PastValues& pastValues = entry->second;
+        pastValues.sum -= pastValues.values[bucketIndex];
+        pastValues.values[bucketIndex] = 0;
+        pastValues.bucketCount--;
+        erasePastValuesIfEmpty(entry);
     }
-    // For each dimension present in the bucket, add its value to its corresponding sum.
-    for (const auto& keyValuePair : *bucket) {
-        mSumOverPastBuckets[keyValuePair.first] += keyValuePair.second;
+    // Keeps the capacity for the next bucket at this index.
+    dimensions.clear();
+}
+
+void AnomalyTracker::erasePastValuesIfEmpty(PastValuesMap::value_type* entry) {
+    if (entry->second.bucketCount == 0) {
+        // Erases through an iterator, the key must not be read from the node being erased.
+        mPastValues.erase(mPastValues.find(entry->first));
     }
 }
 
@@ -179,18 +190,14 @@ int64_t AnomalyTracker::getPastBucketValue(const MetricDimensionKey& key,
         return 0;
     }
 
-    const auto& bucket = mPastBuckets[index(bucketNum)];
-    if (bucket == nullptr) {
-        return 0;
-    }
-    const auto& itr = bucket->find(key);
-    return itr == bucket->end() ? 0 : itr->second;
+    const auto& itr = mPastValues.find(key);
+    return itr == mPastValues.end() ? 0 : itr->second.values[index(bucketNum)];
 }
 
 int64_t AnomalyTracker::getSumOverPastBuckets(const MetricDimensionKey& key) const {
-    const auto& itr = mSumOverPastBuckets.find(key);
-    if (itr != mSumOverPastBuckets.end()) {
-        return itr->second;
+    const auto& itr = mPastValues.find(key);
+    if (itr != mPastValues.end()) {
+        return itr->second.sum;
     }
     return 0;
 }
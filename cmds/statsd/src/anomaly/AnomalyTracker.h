@@ -17,6 +17,7 @@
 #pragma once
 
 #include <memory>  // unique_ptr
+#include <vector>
 
 #include <stdlib.h>
 
@@ -133,13 +134,31 @@ protected:
     // for the anomaly detection (since the current bucket is not in the past).
     const int mNumOfPastBuckets;
 
-    // Values for each of the past mNumOfPastBuckets buckets. Always of size mNumOfPastBuckets.
-    // mPastBuckets[i] can be null, meaning that no data is present in that bucket.
-    std::vector<shared_ptr<DimToValMap>> mPastBuckets;
+    // The values of a dimension in the past buckets, and their sum.
+    struct PastValues {
+        explicit PastValues(int numOfPastBuckets) : values(numOfPastBuckets, 0) {
+        }
 
-    // Cached sum over all existing buckets in mPastBuckets.
-    // Its buckets never contain entries of 0.
-    DimToValMap mSumOverPastBuckets;
+        // The value in each past bucket, at index(bucketNum). 0 if the bucket has no value.
+        std::vector<int64_t> values;
+
+        int64_t sum = 0;
+
+        // The number of past buckets with a value.
+        int bucketCount = 0;
+    };
+
+    typedef unordered_map<MetricDimensionKey, PastValues> PastValuesMap;
+
+    // The dimensions that have a value in at least one of the past mNumOfPastBuckets buckets.
+    // Each dimension is stored once, with a circular array of its values and their running sum,
+    // so getting the sum is a single lookup.
+    PastValuesMap mPastValues;
+
+    // The dimensions with a value in each past bucket, at index(bucketNum). Always of size
+    // mNumOfPastBuckets. Dropping a bucket only touches the dimensions that have a value in it.
+    // Points to the entries of mPastValues, which unlike its iterators survive a rehash.
+    std::vector<std::vector<PastValuesMap::value_type*>> mBucketDimensions;
 
     // The bucket number of the last added bucket.
     int64_t mMostRecentBucketNum = -1;
@@ -155,15 +174,16 @@ protected:
     //   [mMostRecentBucketNum - mNumOfPastBuckets + 1, bucketNum - mNumOfPastBuckets].
     void advanceMostRecentBucketTo(const int64_t& bucketNum);
 
-    // Add the information in the given bucket to mSumOverPastBuckets.
-    void addBucketToSum(const shared_ptr<DimToValMap>& bucket);
+    // Sets the value of key in the past bucket at bucketIndex, and updates its sum.
+    void setPastValue(const size_t bucketIndex, const MetricDimensionKey& key,
+                      const int64_t& bucketValue);
 
-    // Subtract the information in the given bucket from mSumOverPastBuckets
-    // and remove any items with value 0.
-    void subtractBucketFromSum(const shared_ptr<DimToValMap>& bucket);
+    // Removes all the values of the past bucket at bucketIndex from the sums, and the dimensions
+    // that have no value left.
+    void clearPastBucket(const size_t bucketIndex);
 
-    // From mSumOverPastBuckets[key], subtracts bucketValue, removing it if it is now 0.
-    void subtractValueFromSum(const MetricDimensionKey& key, const int64_t& bucketValue);
+    // Removes the dimension of entry if it has no value left in any past bucket.
+    void erasePastValuesIfEmpty(PastValuesMap::value_type* entry);
 
     // Returns true if in the refractory period, else false.
     bool isInRefractoryPeriod(const int64_t& timestampNs, const MetricDimensionKey& key) const;
@@ -180,6 +200,7 @@ protected:
 
     FRIEND_TEST(AnomalyTrackerTest, TestConsecutiveBuckets);
     FRIEND_TEST(AnomalyTrackerTest, TestSparseBuckets);
+    FRIEND_TEST(AnomalyTrackerTest, TestReplacedPastValues);
     FRIEND_TEST(GaugeMetricProducerTest, TestAnomalyDetection);
     FRIEND_TEST(CountMetricProducerTest, TestAnomalyDetectionUnSliced);
     FRIEND_TEST(AnomalyDetectionE2eTest, TestDurationMetric_SUM_single_bucket);
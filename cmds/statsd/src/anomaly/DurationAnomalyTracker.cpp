@@ -44,15 +44,16 @@ void DurationAnomalyTracker::startAlarm(const MetricDimensionKey& dimensionKey,
         return;
     }
 
-    auto itr = mAlarms.find(dimensionKey);
-    if (itr != mAlarms.end() && mAlarmMonitor != nullptr) {
-        mAlarmMonitor->remove(itr->second);
+    sp<const InternalAlarm>& alarm = mAlarms[dimensionKey];
+    if (alarm != nullptr && alarm->timestampSec == timestampSec) {
+        // Durations are re-predicted on every start, stop and condition change, the alarm time
+        // often stays the same.
+        return;
     }
-
-    sp<const InternalAlarm> alarm = new InternalAlarm{timestampSec};
-    mAlarms[dimensionKey] = alarm;
+    sp<const InternalAlarm> oldAlarm = alarm;
+    alarm = new InternalAlarm{timestampSec};
     if (mAlarmMonitor != nullptr) {
-        mAlarmMonitor->add(alarm);
+        mAlarmMonitor->replace(oldAlarm, alarm);
     }
 }
 
@@ -164,14 +164,27 @@ void CombinationConditionTracker::evaluateCondition(
         mUnSlicedPart = evaluateCombinationCondition(
             mUnSlicedChildren, mLogicalOperation, nonSlicedConditionCache);
 
-        for (const int childIndex : mChildren) {
-            // If any of the sliced condition in children condition changes, the combination
-            // condition may be changed too.
+        bool unSlicedChildChanged = false;
+        for (const int childIndex : mUnSlicedChildren) {
             if (conditionChangedCache[childIndex]) {
-                conditionChangedCache[mIndex] = true;
+                unSlicedChildChanged = true;
                 break;
             }
         }
+        if (unSlicedChildChanged) {
+            conditionChangedCache[mIndex] = true;
+        } else if (!isCombinationDecidedBy(mUnSlicedChildren, mLogicalOperation,
+                                           nonSlicedConditionCache)) {
+            // If any of the sliced condition in children condition changes, the combination
+            // condition may be changed too. Unless the unsliced children, which didn't change,
+            // decide it for every dimension, then the metrics don't need to re-query anything.
+            for (const int childIndex : mSlicedChildren) {
+                if (conditionChangedCache[childIndex]) {
+                    conditionChangedCache[mIndex] = true;
+                    break;
+                }
+            }
+        }
         nonSlicedConditionCache[mIndex] = newCondition;
         VLOG("CombinationPredicate %lld sliced may changed? %d", (long long)mConditionId,
             conditionChangedCache[mIndex] == true);
@@ -127,6 +127,85 @@ void SimpleConditionTracker::dumpState() {
     }
 }
 
+// Returns the values of key in the given fields, in that order, or false if it lacks one of them.
+static bool projectKey(const HashableDimensionKey& key, const vector<Field>& fields,
+                       HashableDimensionKey* output) {
+    for (const auto& field : fields) {
+        bool found = false;
+        for (const auto& value : key.getValues()) {
+            if (value.mField == field) {
+                output->addValue(value);
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const SimpleConditionTracker::PartialLinkIndex& SimpleConditionTracker::getPartialLinkIndex(
+        const HashableDimensionKey& key) const {
+    for (const auto& index : mPartialLinkIndexes) {
+        if (index.fields.size() != key.getValues().size()) {
+            continue;
+        }
+        bool sameFields = true;
+        for (size_t i = 0; i < index.fields.size(); i++) {
+            if (!(index.fields[i] == key.getValues()[i].mField)) {
+                sameFields = false;
+                break;
+            }
+        }
+        if (sameFields) {
+            return index;
+        }
+    }
+
+    mPartialLinkIndexes.emplace_back();
+    PartialLinkIndex& index = mPartialLinkIndexes.back();
+    for (const auto& value : key.getValues()) {
+        index.fields.push_back(value.mField);
+    }
+    for (auto it = mSlicedConditionState.begin(); it != mSlicedConditionState.end(); ++it) {
+        HashableDimensionKey projection;
+        if (projectKey(it->first, index.fields, &projection)) {
+            index.slices.emplace(projection, it);
+        }
+    }
+    return index;
+}
+
+void SimpleConditionTracker::addSlice(
+        const std::map<HashableDimensionKey, int>::const_iterator& slice) {
+    for (auto& index : mPartialLinkIndexes) {
+        HashableDimensionKey projection;
+        if (projectKey(slice->first, index.fields, &projection)) {
+            index.slices.emplace(projection, slice);
+        }
+    }
+}
+
+void SimpleConditionTracker::removeSlice(
+        const std::map<HashableDimensionKey, int>::iterator& slice) {
+    for (auto& index : mPartialLinkIndexes) {
+        HashableDimensionKey projection;
+        if (!projectKey(slice->first, index.fields, &projection)) {
+            continue;
+        }
+        auto range = index.slices.equal_range(projection);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == slice) {
+                index.slices.erase(it);
+                break;
+            }
+        }
+    }
+    mSlicedConditionState.erase(slice);
+}
+
 void SimpleConditionTracker::handleStopAll(std::vector<ConditionState>& conditionCache,
                                            std::vector<bool>& conditionChangedCache) {
     // Unless the default condition is false, and there was nothing started, otherwise we have
@@ -144,6 +223,9 @@ void SimpleConditionTracker::handleStopAll(std::vector<ConditionState>& conditio
     // After StopAll, we know everything has stopped. From now on, default condition is false.
     mInitialValue = ConditionState::kFalse;
     mSlicedConditionState.clear();
+    for (auto& index : mPartialLinkIndexes) {
+        index.slices.clear();
+    }
     conditionCache[mIndex] = ConditionState::kFalse;
     if (!mSliced) {
         mUnSlicedPart = ConditionState::kFalse;
@@ -185,13 +267,13 @@ void SimpleConditionTracker::handleConditionEvent(const HashableDimensionKey& ou
         // We get a new output key.
         newCondition = matchStart ? ConditionState::kTrue : ConditionState::kFalse;
         if (matchStart && mInitialValue != ConditionState::kTrue) {
-            mSlicedConditionState[outputKey] = 1;
+            addSlice(mSlicedConditionState.emplace(outputKey, 1).first);
             changed = true;
             mLastChangedToTrueDimensions.insert(outputKey);
         } else if (mInitialValue != ConditionState::kFalse) {
             // it's a stop and we don't have history about it.
             // If the default condition is not false, it means this stop is valuable to us.
-            mSlicedConditionState[outputKey] = 0;
+            addSlice(mSlicedConditionState.emplace(outputKey, 0).first);
             mLastChangedToFalseDimensions.insert(outputKey);
             changed = true;
         }
@@ -233,7 +315,7 @@ void SimpleConditionTracker::handleConditionEvent(const HashableDimensionKey& ou
 
             // if default condition is false, it means we don't need to keep the false values.
             if (mInitialValue == ConditionState::kFalse && startedCount == 0) {
-                mSlicedConditionState.erase(outputIt);
+                removeSlice(outputIt);
                 VLOG("erase key %s", outputKey.toString().c_str());
             }
         }
@@ -384,19 +466,19 @@ void SimpleConditionTracker::isConditionMet(
         // For unseen key, check whether the require dimensions are subset of sliced condition
         // output.
         conditionState = conditionState | mInitialValue;
-        for (const auto& slice : mSlicedConditionState) {
+        auto range = getPartialLinkIndex(key).slices.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it) {
+            const auto& slice = *it->second;
             ConditionState sliceState =
                 slice.second > 0 ? ConditionState::kTrue : ConditionState::kFalse;
-            if (slice.first.contains(key)) {
-                conditionState = conditionState | sliceState;
-                if (sliceState == ConditionState::kTrue && dimensionFields.size() > 0) {
-                    if (isSubOutputDimensionFields) {
-                        HashableDimensionKey dimensionKey;
-                        filterValues(dimensionFields, slice.first.getValues(), &dimensionKey);
-                        dimensionsKeySet.insert(dimensionKey);
-                    } else {
-                        dimensionsKeySet.insert(slice.first);
-                    }
+            conditionState = conditionState | sliceState;
+            if (sliceState == ConditionState::kTrue && dimensionFields.size() > 0) {
+                if (isSubOutputDimensionFields) {
+                    HashableDimensionKey dimensionKey;
+                    filterValues(dimensionFields, slice.first.getValues(), &dimensionKey);
+                    dimensionsKeySet.insert(dimensionKey);
+                } else {
+                    dimensionsKeySet.insert(slice.first);
                 }
             }
         }
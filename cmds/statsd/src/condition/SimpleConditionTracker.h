@@ -125,6 +125,26 @@ private:
 
     std::map<HashableDimensionKey, int> mSlicedConditionState;
 
+    // An index of mSlicedConditionState for partial links, which only give some of the output
+    // dimensions. It maps the values of those fields to the slices that contain them, so a query
+    // with a partial key is a hash lookup instead of a scan of all the slices.
+    struct PartialLinkIndex {
+        std::vector<Field> fields;
+        std::unordered_multimap<HashableDimensionKey,
+                                std::map<HashableDimensionKey, int>::const_iterator>
+                slices;
+    };
+
+    // Built on the first query with a set of fields, one per link, and kept up to date when
+    // slices are added and removed.
+    mutable std::vector<PartialLinkIndex> mPartialLinkIndexes;
+
+    const PartialLinkIndex& getPartialLinkIndex(const HashableDimensionKey& key) const;
+
+    void addSlice(const std::map<HashableDimensionKey, int>::const_iterator& slice);
+
+    void removeSlice(const std::map<HashableDimensionKey, int>::iterator& slice);
+
     void handleStopAll(std::vector<ConditionState>& conditionCache,
                        std::vector<bool>& changedCache);
 
@@ -138,6 +158,7 @@ private:
     FRIEND_TEST(SimpleConditionTrackerTest, TestSlicedCondition);
     FRIEND_TEST(SimpleConditionTrackerTest, TestSlicedWithNoOutputDim);
     FRIEND_TEST(SimpleConditionTrackerTest, TestStopAll);
+    FRIEND_TEST(SimpleConditionTrackerTest, TestPartialLinkIndex);
 };
 
 }  // namespace statsd
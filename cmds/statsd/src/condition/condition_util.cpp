@@ -93,6 +93,31 @@ ConditionState evaluateCombinationCondition(const std::vector<int>& children,
     return newCondition;
 }
 
+bool isCombinationDecidedBy(const std::vector<int>& children, const LogicalOperation& operation,
+                            const std::vector<ConditionState>& conditionCache) {
+    ConditionState decidingState;
+    switch (operation) {
+        case LogicalOperation::AND:
+        case LogicalOperation::NAND:
+            decidingState = ConditionState::kFalse;
+            break;
+        case LogicalOperation::OR:
+        case LogicalOperation::NOR:
+            decidingState = ConditionState::kTrue;
+            break;
+        default:
+            return false;
+    }
+    for (auto childIndex : children) {
+        // An unknown child makes the whole combination unknown.
+        if (conditionCache[childIndex] == decidingState ||
+            conditionCache[childIndex] == ConditionState::kUnknown) {
+            return true;
+        }
+    }
+    return false;
+}
+
 ConditionState operator|(ConditionState l, ConditionState r) {
     return l >= r ? l : r;
 }
@@ -37,6 +37,11 @@ ConditionState operator|(ConditionState l, ConditionState r);
 ConditionState evaluateCombinationCondition(const std::vector<int>& children,
                                             const LogicalOperation& operation,
                                             const std::vector<ConditionState>& conditionCache);
+
+// Returns true if the states of children alone decide the result of the operation, whatever the
+// states of its other children are. e.g. a false child of an AND, or an unknown child.
+bool isCombinationDecidedBy(const std::vector<int>& children, const LogicalOperation& operation,
+                            const std::vector<ConditionState>& conditionCache);
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
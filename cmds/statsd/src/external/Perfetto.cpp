@@ -17,6 +17,8 @@
 #define DEBUG false  // STOPSHIP if true
 #include "config/ConfigKey.h"
 #include "Log.h"
+#include "Perfetto.h"
+#include "stats_log_util.h"
 
 #include "frameworks/base/cmds/statsd/src/statsd_config.pb.h"  // Alert
 
@@ -28,19 +30,31 @@
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
 
 namespace {
 const char kDropboxTag[] = "perfetto";
+
+// Triggers of the same config within this window of the last trace it started are dropped,
+// an alert firing again and again would otherwise start a trace each time.
+const int64_t kTriggerCoalescingWindowNs = 60 * NS_PER_SEC;
+// The most traces waiting to be started, the triggers over it are dropped.
+const size_t kMaxPendingTraces = 8;
 }
 
 namespace android {
 namespace os {
 namespace statsd {
 
-bool CollectPerfettoTraceAndUploadToDropbox(const PerfettoDetails& config,
-                                            int64_t alert_id,
-                                            const ConfigKey& configKey) {
+// Forks and execs the perfetto client with |config|, waiting until it has read it.
+static bool LaunchPerfetto(const PerfettoDetails& config, int64_t alert_id,
+                           const ConfigKey& configKey) {
     VLOG("Starting trace collection through perfetto");
 
     if (!config.has_trace_config()) {
@@ -131,10 +145,94 @@ bool CollectPerfettoTraceAndUploadToDropbox(const PerfettoDetails& config,
         return false;
     }
 
-    VLOG("CollectPerfettoTraceAndUploadToDropbox() succeeded");
+    VLOG("LaunchPerfetto() succeeded");
     return true;
 }
 
+namespace {
+
+// Starts the traces on a thread of its own, so that the alert path doesn't wait for the fork
+// and exec, with a single trace in flight per config.
+class PerfettoLauncher {
+public:
+    static PerfettoLauncher& getInstance() {
+        static PerfettoLauncher* launcher = new PerfettoLauncher();
+        return *launcher;
+    }
+
+    // Returns false if the trigger is dropped.
+    bool trigger(const PerfettoDetails& config, int64_t alertId, const ConfigKey& configKey) {
+        const int64_t nowNs = getElapsedRealtimeNs();
+        std::lock_guard<std::mutex> lock(mLock);
+        auto it = mBusyUntilNs.find(configKey);
+        if (it != mBusyUntilNs.end() && nowNs < it->second) {
+            VLOG("Perfetto trace for config %s already in flight, coalescing alert %lld",
+                 configKey.ToString().c_str(), (long long)alertId);
+            return true;
+        }
+        if (mPending.size() >= kMaxPendingTraces) {
+            ALOGW("Too many perfetto traces pending, dropping alert %lld", (long long)alertId);
+            return false;
+        }
+
+        // The config is busy until the trace it starts is over, or at least for the window.
+        int64_t busyNs = (int64_t)config.trace_config().duration_ms() * 1000000LL;
+        mBusyUntilNs[configKey] = nowNs + std::max(busyNs, kTriggerCoalescingWindowNs);
+        mPending.push_back(Request{config, alertId, configKey});
+        if (!mThreadStarted) {
+            mThreadStarted = true;
+            std::thread([this]() { run(); }).detach();
+        }
+        mCondition.notify_one();
+        return true;
+    }
+
+private:
+    struct Request {
+        PerfettoDetails config;
+        int64_t alertId;
+        ConfigKey configKey;
+    };
+
+    PerfettoLauncher() = default;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mLock);
+        while (true) {
+            mCondition.wait(lock, [this] { return !mPending.empty(); });
+            Request request = std::move(mPending.front());
+            mPending.pop_front();
+
+            lock.unlock();
+            bool success = LaunchPerfetto(request.config, request.alertId, request.configKey);
+            lock.lock();
+            if (!success) {
+                ALOGW("Failed to start perfetto for alert %lld", (long long)request.alertId);
+                // let the next alert of the config try again
+                mBusyUntilNs.erase(request.configKey);
+            }
+        }
+    }
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::deque<Request> mPending;
+    std::map<ConfigKey, int64_t> mBusyUntilNs;
+    bool mThreadStarted = false;
+};
+
+}  // namespace
+
+bool CollectPerfettoTraceAndUploadToDropbox(const PerfettoDetails& config,
+                                            int64_t alert_id,
+                                            const ConfigKey& configKey) {
+    if (!config.has_trace_config()) {
+        ALOGE("The perfetto trace config is empty, aborting");
+        return false;
+    }
+    return PerfettoLauncher::getInstance().trigger(config, alert_id, configKey);
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
@@ -29,8 +29,10 @@ class PerfettoDetails;  // Declared in statsd_config.pb.h
 
 // Starts the collection of a Perfetto trace with the given |config|.
 // The trace is uploaded to Dropbox by the perfetto cmdline util once done.
-// This method returns immediately after passing the config and does NOT wait
-// for the full duration of the trace.
+// The perfetto cmdline util is started asynchronously, this method returns
+// right away. Only one trace is in flight per |configKey|: the triggers that
+// come while it runs, or within a minute of its start, are coalesced into it.
+// Returns false if the trigger is dropped.
 bool CollectPerfettoTraceAndUploadToDropbox(const PerfettoDetails& config,
                                             int64_t alert_id,
                                             const ConfigKey& configKey);
@@ -19,6 +19,7 @@
 
 #include <android/hardware/health/2.0/IHealth.h>
 #include <healthhalutils/HealthHalUtils.h>
+#include <mutex>
 #include "external/ResourceHealthManagerPuller.h"
 #include "external/StatsPuller.h"
 
@@ -43,8 +44,11 @@ namespace os {
 namespace statsd {
 
 sp<android::hardware::health::V2_0::IHealth> gHealthHal = nullptr;
+// Pulls of the health atoms may run concurrently, they share gHealthHal.
+std::mutex gHealthHalMutex;
 
-bool getHealthHal() {
+// The caller must be holding gHealthHalMutex.
+bool getHealthHalLocked() {
     if (gHealthHal == nullptr) {
         gHealthHal = get_health_service();
     }
@@ -56,7 +60,8 @@ ResourceHealthManagerPuller::ResourceHealthManagerPuller(int tagId) : StatsPulle
 
 // TODO: add other health atoms (eg. Temperature).
 bool ResourceHealthManagerPuller::PullInternal(vector<shared_ptr<LogEvent>>* data) {
-    if (!getHealthHal()) {
+    std::lock_guard<std::mutex> lock(gHealthHalMutex);
+    if (!getHealthHalLocked()) {
         ALOGE("Health Hal not loaded");
         return false;
     }
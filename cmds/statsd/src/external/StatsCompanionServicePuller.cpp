@@ -18,8 +18,10 @@
 #include "Log.h"
 
 #include <android/os/IStatsCompanionService.h>
+#include <android/os/StatsLogEventWrapper.h>
 #include <binder/IPCThreadState.h>
 #include <private/android_filesystem_config.h>
+#include <string.h>
 #include "../stats_log_util.h"
 #include "../statscompanion_util.h"
 #include "StatsCompanionServicePuller.h"
@@ -60,6 +62,15 @@ bool StatsCompanionServicePuller::PullInternal(vector<shared_ptr<LogEvent> >* da
             return false;
         }
         data->clear();
+        if (returned_value.size() == 1 && returned_value[0].isColumnarPull()) {
+            if (!ParseColumnarPull(mTagId, returned_value[0].bytes, data)) {
+                ALOGW("malformed columnar pull for %d", mTagId);
+                data->clear();
+                return false;
+            }
+            VLOG("StatsCompanionServicePuller::pull succeeded for %d", mTagId);
+            return true;
+        }
         int32_t timestampSec = getWallClockSec();
         for (const StatsLogEventWrapper& it : returned_value) {
             log_msg tmp;
@@ -79,6 +90,144 @@ bool StatsCompanionServicePuller::PullInternal(vector<shared_ptr<LogEvent> >* da
     }
 }
 
+namespace {
+
+// Reads the little endian values of a columnar pull, with bounds checks.
+class ColumnReader {
+public:
+    explicit ColumnReader(const vector<uint8_t>& bytes) : mBytes(bytes), mPos(0) {
+    }
+
+    template <typename T>
+    bool read(T* value) {
+        if (mBytes.size() - mPos < sizeof(T)) {
+            return false;
+        }
+        memcpy(value, mBytes.data() + mPos, sizeof(T));
+        mPos += sizeof(T);
+        return true;
+    }
+
+    bool readString(std::string* value, size_t length) {
+        if (mBytes.size() - mPos < length) {
+            return false;
+        }
+        value->assign(reinterpret_cast<const char*>(mBytes.data() + mPos), length);
+        mPos += length;
+        return true;
+    }
+
+    // Skips count values of size bytes, returning where they start, or nullptr if they are
+    // not all there.
+    const uint8_t* skipValues(size_t count, size_t size) {
+        if ((mBytes.size() - mPos) / size < count) {
+            return nullptr;
+        }
+        const uint8_t* values = mBytes.data() + mPos;
+        mPos += count * size;
+        return values;
+    }
+
+private:
+    const vector<uint8_t>& mBytes;
+    size_t mPos;
+};
+
+struct Column {
+    int32_t type;
+    const uint8_t* values;
+};
+
+template <typename T>
+T columnValue(const Column& column, size_t row) {
+    T value;
+    memcpy(&value, column.values + row * sizeof(T), sizeof(T));
+    return value;
+}
+
+}  // namespace
+
+bool StatsCompanionServicePuller::ParseColumnarPull(int tagId, const vector<uint8_t>& bytes,
+                                                    vector<shared_ptr<LogEvent>>* data) {
+    ColumnReader reader(bytes);
+    int32_t magic, version, rowCount, fieldCount, stringCount;
+    if (!reader.read(&magic) || magic != kColumnarPullMagic || !reader.read(&version) ||
+        version != kColumnarPullVersion || !reader.read(&rowCount) || rowCount < 0 ||
+        !reader.read(&fieldCount) || fieldCount < 0 || !reader.read(&stringCount) ||
+        stringCount < 0) {
+        return false;
+    }
+    // Otherwise the row count isn't bounded by the size of the columns.
+    if (fieldCount == 0 && rowCount != 0) {
+        return false;
+    }
+
+    vector<std::string> strings;
+    for (int32_t i = 0; i < stringCount; i++) {
+        int32_t length;
+        std::string string;
+        if (!reader.read(&length) || length < 0 || !reader.readString(&string, length)) {
+            return false;
+        }
+        strings.push_back(std::move(string));
+    }
+
+    // The columns are only located here, and validated, the values are read row by row below.
+    vector<Column> columns(fieldCount);
+    for (auto& column : columns) {
+        if (!reader.read(&column.type)) {
+            return false;
+        }
+        const size_t size = column.type == COLUMN_TYPE_LONG ? sizeof(int64_t) : sizeof(int32_t);
+        column.values = reader.skipValues(rowCount, size);
+        if (column.values == nullptr) {
+            return false;
+        }
+        switch (column.type) {
+            case COLUMN_TYPE_INT:
+            case COLUMN_TYPE_LONG:
+            case COLUMN_TYPE_FLOAT:
+                break;
+            case COLUMN_TYPE_STRING:
+                for (int32_t row = 0; row < rowCount; row++) {
+                    int32_t index = columnValue<int32_t>(column, row);
+                    if (index < 0 || index >= stringCount) {
+                        return false;
+                    }
+                }
+                break;
+            default:
+                return false;
+        }
+    }
+
+    // Each event is written and initialized in turn, so that only one writer buffer is alive at
+    // a time. The pull time is set by StatsPuller once the pull returns.
+    data->reserve(data->size() + rowCount);
+    for (int32_t row = 0; row < rowCount; row++) {
+        shared_ptr<LogEvent> event = make_shared<LogEvent>(tagId, 0);
+        for (const auto& column : columns) {
+            switch (column.type) {
+                case COLUMN_TYPE_INT:
+                    event->write(columnValue<int32_t>(column, row));
+                    break;
+                case COLUMN_TYPE_LONG:
+                    event->write(columnValue<int64_t>(column, row));
+                    break;
+                case COLUMN_TYPE_FLOAT:
+                    event->write(columnValue<float>(column, row));
+                    break;
+                case COLUMN_TYPE_STRING:
+                    event->write(strings[columnValue<int32_t>(column, row)]);
+                    break;
+            }
+        }
+        event->init();
+        data->push_back(event);
+    }
+    return true;
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
@@ -30,6 +30,11 @@ public:
 
     void SetStatsCompanionService(sp<IStatsCompanionService> statsCompanionService) override;
 
+    // Builds the events of a pull sent by column (see StatsLogEventWrapper), straight from the
+    // columns. Returns false if the bytes are malformed.
+    static bool ParseColumnarPull(int tagId, const std::vector<uint8_t>& bytes,
+                                  vector<std::shared_ptr<LogEvent>>* data);
+
 private:
     Mutex mStatsCompanionServiceLock;
     sp<IStatsCompanionService> mStatsCompanionService = nullptr;
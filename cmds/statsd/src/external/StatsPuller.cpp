@@ -23,12 +23,26 @@
 #include "stats_log_util.h"
 #include "StatsPullerManagerImpl.h"
 
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+
 namespace android {
 namespace os {
 namespace statsd {
 
 using std::lock_guard;
 
+// The result of a PullInternal running on its own thread. It's shared with the thread, so that it
+// outlives a pull that timed out.
+struct StatsPuller::PendingPull {
+    std::mutex lock;
+    std::condition_variable doneCondition;
+    bool done = false;
+    bool success = false;
+    std::vector<std::shared_ptr<LogEvent>> data;
+};
+
 sp<UidMap> StatsPuller::mUidMap = nullptr;
 void StatsPuller::SetUidMap(const sp<UidMap>& uidMap) { mUidMap = uidMap; }
 
@@ -36,6 +50,7 @@ void StatsPuller::SetUidMap(const sp<UidMap>& uidMap) { mUidMap = uidMap; }
 StatsPuller::StatsPuller(const int tagId)
     : mTagId(tagId) {
     mCoolDownNs = StatsPullerManagerImpl::kAllPullAtomInfo.find(tagId)->second.coolDownNs;
+    mPullTimeoutNs = StatsPullerManagerImpl::kAllPullAtomInfo.find(tagId)->second.pullTimeoutNs;
     VLOG("Puller for tag %d created. Cooldown set to %lld", mTagId, (long long)mCoolDownNs);
 }
 
@@ -55,18 +70,59 @@ bool StatsPuller::Pull(const int64_t elapsedTimeNs, std::vector<std::shared_ptr<
     }
     mCachedData.clear();
     mLastPullTimeNs = elapsedTimeNs;
-    bool ret = PullInternal(&mCachedData);
+    const int64_t pullStartNs = getElapsedRealtimeNs();
+    bool ret = PullWithTimeout(&mCachedData);
+    StatsdStats::getInstance().notePullTime(mTagId, getElapsedRealtimeNs() - pullStartNs);
     for (const shared_ptr<LogEvent>& data : mCachedData) {
         data->setElapsedTimestampNs(elapsedTimeNs);
         data->setLogdWallClockTimestampNs(wallClockTimeNs);
     }
     if (ret && mCachedData.size() > 0) {
       mergeIsolatedUidsToHostUid(mCachedData, mUidMap, mTagId);
+      // The cached events are shared by every metric pulling the atom until the cool down ends
+      for (const shared_ptr<LogEvent>& event : mCachedData) {
+          event->prepareForSharing();
+      }
       (*data) = mCachedData;
     }
     return ret;
 }
 
+bool StatsPuller::PullWithTimeout(std::vector<std::shared_ptr<LogEvent>>* data) {
+    if (mTimedOutPull != nullptr) {
+        lock_guard<std::mutex> lock(mTimedOutPull->lock);
+        if (!mTimedOutPull->done) {
+            VLOG("Puller for tag %d is still running a timed out pull", mTagId);
+            return false;
+        }
+    }
+    mTimedOutPull = nullptr;
+
+    // The thread holds the puller and the result, so either can outlive this call.
+    std::shared_ptr<PendingPull> pending = std::make_shared<PendingPull>();
+    sp<StatsPuller> self = this;
+    std::thread([self, pending]() {
+        std::vector<std::shared_ptr<LogEvent>> pulledData;
+        bool success = self->PullInternal(&pulledData);
+        lock_guard<std::mutex> lock(pending->lock);
+        pending->success = success;
+        pending->data.swap(pulledData);
+        pending->done = true;
+        pending->doneCondition.notify_all();
+    }).detach();
+
+    std::unique_lock<std::mutex> lock(pending->lock);
+    if (!pending->doneCondition.wait_for(lock, std::chrono::nanoseconds(mPullTimeoutNs),
+                                         [&pending] { return pending->done; })) {
+        ALOGW("Pull for tag %d timed out after %lld ns", mTagId, (long long)mPullTimeoutNs);
+        StatsdStats::getInstance().notePullTimeout(mTagId);
+        mTimedOutPull = pending;
+        return false;
+    }
+    data->swap(pending->data);
+    return pending->success;
+}
+
 int StatsPuller::ForceClearCache() {
     return clearCache();
 }
@@ -60,11 +60,21 @@ private:
     // will be returned.
     // The actual value should be determined by individual pullers.
     int64_t mCoolDownNs;
+    // How long Pull waits for PullInternal.
+    int64_t mPullTimeoutNs;
+
+    struct PendingPull;
+    // The last pull that timed out. Pulls fail until its PullInternal returns, so that a puller
+    // never runs twice at the same time.
+    std::shared_ptr<PendingPull> mTimedOutPull;
     // For puller stats
     int64_t mMinPullIntervalNs = LONG_MAX;
 
     virtual bool PullInternal(std::vector<std::shared_ptr<LogEvent>>* data) = 0;
 
+    // Runs PullInternal on another thread, waiting for mPullTimeoutNs at most.
+    bool PullWithTimeout(std::vector<std::shared_ptr<LogEvent>>* data);
+
     // Cache of data from last pull. If next request comes before cool down finishes,
     // cached data will be returned.
     std::vector<std::shared_ptr<LogEvent>> mCachedData;
@@ -34,6 +34,7 @@
 #include "statslog.h"
 
 #include <iostream>
+#include <thread>
 
 using std::make_shared;
 using std::map;
@@ -173,6 +174,10 @@ const std::map<int, PullAtomInfo> StatsPullerManagerImpl::kAllPullAtomInfo = {
         // temperature
         {android::util::TEMPERATURE, {{}, {}, 1, new ResourceThermalManagerPuller()}}};
 
+// Atoms are pulled from different services and HALs, so the pulls of an alarm run concurrently,
+// a few at a time, rather than adding up their binder latencies.
+static const size_t kMaxConcurrentPulls = 4;
+
 StatsPullerManagerImpl::StatsPullerManagerImpl() : mNextPullTimeNs(NO_ALARM_UPDATE) {
 }
 
@@ -303,9 +308,30 @@ void StatsPullerManagerImpl::OnAlarmFired(const int64_t currentTimeNs) {
         }
     }
 
-    for (const auto& pullInfo : needToPull) {
-        vector<shared_ptr<LogEvent>> data;
-        if (Pull(pullInfo.first, currentTimeNs, &data)) {
+    // Each atom is pulled once for all its receivers, which are then called back on this thread,
+    // in the order of the atoms. Pullers lock themselves, different atoms can be pulled in
+    // parallel.
+    vector<vector<shared_ptr<LogEvent>>> pulledData(needToPull.size());
+    vector<char> pullSucceeded(needToPull.size(), false);
+    for (size_t first = 0; first < needToPull.size(); first += kMaxConcurrentPulls) {
+        const size_t end = std::min(needToPull.size(), first + kMaxConcurrentPulls);
+        vector<std::thread> pullThreads;
+        for (size_t i = first + 1; i < end; i++) {
+            pullThreads.emplace_back([this, i, currentTimeNs, &needToPull, &pulledData,
+                                      &pullSucceeded]() {
+                pullSucceeded[i] = Pull(needToPull[i].first, currentTimeNs, &pulledData[i]);
+            });
+        }
+        pullSucceeded[first] = Pull(needToPull[first].first, currentTimeNs, &pulledData[first]);
+        for (std::thread& pullThread : pullThreads) {
+            pullThread.join();
+        }
+    }
+
+    for (size_t i = 0; i < needToPull.size(); i++) {
+        const auto& pullInfo = needToPull[i];
+        const vector<shared_ptr<LogEvent>>& data = pulledData[i];
+        if (pullSucceeded[i]) {
             for (const auto& receiverInfo : pullInfo.second) {
                 sp<PullDataReceiver> receiverPtr = receiverInfo->receiver.promote();
                 if (receiverPtr != nullptr) {
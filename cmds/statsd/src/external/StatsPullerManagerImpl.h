@@ -42,6 +42,9 @@ typedef struct {
   // How long should the puller wait before doing an actual pull again. Default
   // 1 sec. Set this to 0 if this is handled elsewhere.
   int64_t coolDownNs = 1 * NS_PER_SEC;
+  // How long a pull can take before it is abandoned and fails. The pull keeps running in the
+  // background, but statsd stops waiting for it.
+  int64_t pullTimeoutNs = 10 * NS_PER_SEC;
   // The actual puller
   sp<StatsPuller> puller;
 } PullAtomInfo;
@@ -84,6 +84,9 @@ const int FIELD_ID_CONFIG_STATS_METRIC_DIMENSION_IN_CONDITION_STATS = 17;
 const int FIELD_ID_CONFIG_STATS_ANNOTATION = 18;
 const int FIELD_ID_CONFIG_STATS_ANNOTATION_INT64 = 1;
 const int FIELD_ID_CONFIG_STATS_ANNOTATION_INT32 = 2;
+const int FIELD_ID_CONFIG_STATS_MATCHER_TIME_STATS = 21;
+const int FIELD_ID_CONFIG_STATS_CONDITION_TIME_STATS = 22;
+const int FIELD_ID_CONFIG_STATS_METRIC_TIME_STATS = 23;
 
 const int FIELD_ID_MATCHER_STATS_ID = 1;
 const int FIELD_ID_MATCHER_STATS_COUNT = 2;
@@ -93,6 +96,10 @@ const int FIELD_ID_METRIC_STATS_ID = 1;
 const int FIELD_ID_METRIC_STATS_COUNT = 2;
 const int FIELD_ID_ALERT_STATS_ID = 1;
 const int FIELD_ID_ALERT_STATS_COUNT = 2;
+const int FIELD_ID_PROCESSING_TIME_STATS_ID = 1;
+const int FIELD_ID_PROCESSING_TIME_STATS_SAMPLE_COUNT = 2;
+const int FIELD_ID_PROCESSING_TIME_STATS_TOTAL_TIME = 3;
+const int FIELD_ID_PROCESSING_TIME_STATS_MAX_TIME = 4;
 
 const int FIELD_ID_UID_MAP_CHANGES = 1;
 const int FIELD_ID_UID_MAP_BYTES_USED = 2;
@@ -104,7 +111,7 @@ const std::map<int, std::pair<size_t, size_t>> StatsdStats::kAtomDimensionKeySiz
 };
 
 // TODO: add stats for pulled atoms.
-StatsdStats::StatsdStats() {
+StatsdStats::StatsdStats() : mProfilingSampleRate(0) {
     mPushedAtomStats.resize(android::util::kMaxPushedAtomId + 1);
     mStartTimeSec = getWallClockSec();
 }
@@ -311,6 +318,48 @@ void StatsdStats::noteMatcherMatched(const ConfigKey& key, const int64_t& id) {
     statsIt->second->matcher_stats[id]++;
 }
 
+void StatsdStats::setProfilingSampleRate(int sampleRate) {
+    mProfilingSampleRate.store(sampleRate < 0 ? 0 : sampleRate, std::memory_order_relaxed);
+}
+
+static void noteProcessingTime(ProcessingTimeStats& stats, int64_t timeNs) {
+    stats.sample_count++;
+    stats.total_time_ns += timeNs;
+    if (timeNs > stats.max_time_ns) {
+        stats.max_time_ns = timeNs;
+    }
+}
+
+void StatsdStats::noteMatcherProcessingTime(const ConfigKey& key, const int64_t& id,
+                                            int64_t timeNs) {
+    lock_guard<std::mutex> lock(mLock);
+    auto statsIt = mConfigStats.find(key);
+    if (statsIt == mConfigStats.end()) {
+        return;
+    }
+    noteProcessingTime(statsIt->second->matcher_time_stats[id], timeNs);
+}
+
+void StatsdStats::noteConditionProcessingTime(const ConfigKey& key, const int64_t& id,
+                                              int64_t timeNs) {
+    lock_guard<std::mutex> lock(mLock);
+    auto statsIt = mConfigStats.find(key);
+    if (statsIt == mConfigStats.end()) {
+        return;
+    }
+    noteProcessingTime(statsIt->second->condition_time_stats[id], timeNs);
+}
+
+void StatsdStats::noteMetricProcessingTime(const ConfigKey& key, const int64_t& id,
+                                           int64_t timeNs) {
+    lock_guard<std::mutex> lock(mLock);
+    auto statsIt = mConfigStats.find(key);
+    if (statsIt == mConfigStats.end()) {
+        return;
+    }
+    noteProcessingTime(statsIt->second->metric_time_stats[id], timeNs);
+}
+
 void StatsdStats::noteAnomalyDeclared(const ConfigKey& key, const int64_t& id) {
     lock_guard<std::mutex> lock(mLock);
     auto statsIt = mConfigStats.find(key);
@@ -340,6 +389,22 @@ void StatsdStats::notePull(int pullAtomId) {
     mPulledAtomStats[pullAtomId].totalPull++;
 }
 
+void StatsdStats::notePullTime(int pullAtomId, int64_t pullTimeNs) {
+    lock_guard<std::mutex> lock(mLock);
+    auto& pullStats = mPulledAtomStats[pullAtomId];
+    pullStats.totalPullTime++;
+    pullStats.avgPullTimeNs +=
+            (pullTimeNs - pullStats.avgPullTimeNs) / (int64_t)pullStats.totalPullTime;
+    if (pullTimeNs > pullStats.maxPullTimeNs) {
+        pullStats.maxPullTimeNs = pullTimeNs;
+    }
+}
+
+void StatsdStats::notePullTimeout(int pullAtomId) {
+    lock_guard<std::mutex> lock(mLock);
+    mPulledAtomStats[pullAtomId].pullTimeout++;
+}
+
 void StatsdStats::notePullFromCache(int pullAtomId) {
     lock_guard<std::mutex> lock(mLock);
     mPulledAtomStats[pullAtomId].totalPullFromCache++;
@@ -399,6 +464,9 @@ void StatsdStats::resetInternalLocked() {
         config.second->metric_stats.clear();
         config.second->metric_dimension_in_condition_stats.clear();
         config.second->alert_stats.clear();
+        config.second->matcher_time_stats.clear();
+        config.second->condition_time_stats.clear();
+        config.second->metric_time_stats.clear();
     }
 }
 
@@ -484,6 +552,24 @@ void StatsdStats::dumpStats(FILE* out) const {
         for (const auto& stats : pair.second->alert_stats) {
             fprintf(out, "alert %lld declared %d times\n", (long long)stats.first, stats.second);
         }
+
+        for (const auto& stats : pair.second->matcher_time_stats) {
+            fprintf(out, "matcher %lld took %lld ns in %lld samples, max %lld ns\n",
+                    (long long)stats.first, (long long)stats.second.total_time_ns,
+                    (long long)stats.second.sample_count, (long long)stats.second.max_time_ns);
+        }
+
+        for (const auto& stats : pair.second->condition_time_stats) {
+            fprintf(out, "condition %lld took %lld ns in %lld samples, max %lld ns\n",
+                    (long long)stats.first, (long long)stats.second.total_time_ns,
+                    (long long)stats.second.sample_count, (long long)stats.second.max_time_ns);
+        }
+
+        for (const auto& stats : pair.second->metric_time_stats) {
+            fprintf(out, "metric %lld took %lld ns in %lld samples, max %lld ns\n",
+                    (long long)stats.first, (long long)stats.second.total_time_ns,
+                    (long long)stats.second.sample_count, (long long)stats.second.max_time_ns);
+        }
     }
     fprintf(out, "********Disk Usage stats***********\n");
     StorageManager::printStats(out);
@@ -497,8 +583,10 @@ void StatsdStats::dumpStats(FILE* out) const {
 
     fprintf(out, "********Pulled Atom stats***********\n");
     for (const auto& pair : mPulledAtomStats) {
-        fprintf(out, "Atom %d->%ld, %ld, %ld\n", (int)pair.first, (long)pair.second.totalPull,
-                (long)pair.second.totalPullFromCache, (long)pair.second.minPullIntervalSec);
+        fprintf(out, "Atom %d->%ld, %ld, %ld, avg %lld ns, max %lld ns, %ld timeouts\n",
+                (int)pair.first, (long)pair.second.totalPull, (long)pair.second.totalPullFromCache,
+                (long)pair.second.minPullIntervalSec, (long long)pair.second.avgPullTimeNs,
+                (long long)pair.second.maxPullTimeNs, (long)pair.second.pullTimeout);
     }
 
     if (mAnomalyAlarmRegisteredStats > 0) {
@@ -533,6 +621,22 @@ void StatsdStats::dumpStats(FILE* out) const {
     }
 }
 
+static void writeProcessingTimeStatsToProto(
+        const std::map<const int64_t, ProcessingTimeStats>& timeStats, int fieldId,
+        ProtoOutputStream* proto) {
+    for (const auto& pair : timeStats) {
+        uint64_t tmpToken = proto->start(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | fieldId);
+        proto->write(FIELD_TYPE_INT64 | FIELD_ID_PROCESSING_TIME_STATS_ID, (long long)pair.first);
+        proto->write(FIELD_TYPE_INT64 | FIELD_ID_PROCESSING_TIME_STATS_SAMPLE_COUNT,
+                     (long long)pair.second.sample_count);
+        proto->write(FIELD_TYPE_INT64 | FIELD_ID_PROCESSING_TIME_STATS_TOTAL_TIME,
+                     (long long)pair.second.total_time_ns);
+        proto->write(FIELD_TYPE_INT64 | FIELD_ID_PROCESSING_TIME_STATS_MAX_TIME,
+                     (long long)pair.second.max_time_ns);
+        proto->end(tmpToken);
+    }
+}
+
 void addConfigStatsToProto(const ConfigStats& configStats, ProtoOutputStream* proto) {
     uint64_t token =
             proto->start(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_CONFIG_STATS);
@@ -623,6 +727,13 @@ void addConfigStatsToProto(const ConfigStats& configStats, ProtoOutputStream* pr
         proto->end(tmpToken);
     }
 
+    writeProcessingTimeStatsToProto(configStats.matcher_time_stats,
+                                    FIELD_ID_CONFIG_STATS_MATCHER_TIME_STATS, proto);
+    writeProcessingTimeStatsToProto(configStats.condition_time_stats,
+                                    FIELD_ID_CONFIG_STATS_CONDITION_TIME_STATS, proto);
+    writeProcessingTimeStatsToProto(configStats.metric_time_stats,
+                                    FIELD_ID_CONFIG_STATS_METRIC_TIME_STATS, proto);
+
     proto->end(token);
 }
 
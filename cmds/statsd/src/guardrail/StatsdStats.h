@@ -20,6 +20,7 @@
 
 #include <gtest/gtest_prod.h>
 #include <log/log_time.h>
+#include <atomic>
 #include <list>
 #include <mutex>
 #include <string>
@@ -29,6 +30,13 @@ namespace android {
 namespace os {
 namespace statsd {
 
+// The time taken by a matcher, condition tracker or metric producer on the sampled events.
+struct ProcessingTimeStats {
+    int64_t sample_count = 0;
+    int64_t total_time_ns = 0;
+    int64_t max_time_ns = 0;
+};
+
 struct ConfigStats {
     int32_t uid;
     int64_t id;
@@ -70,6 +78,12 @@ struct ConfigStats {
 
     // Stores the config ID for each sub-config used.
     std::list<std::pair<const int64_t, const int32_t>> annotations;
+
+    // Stores the time spent on the events sampled while profiling is on, by matcher, condition
+    // tracker and metric producer id. The map sizes are capped by their numbers in the config.
+    std::map<const int64_t, ProcessingTimeStats> matcher_time_stats;
+    std::map<const int64_t, ProcessingTimeStats> condition_time_stats;
+    std::map<const int64_t, ProcessingTimeStats> metric_time_stats;
 };
 
 struct UidMapStats {
@@ -224,6 +238,31 @@ public:
      */
     void noteMatcherMatched(const ConfigKey& key, const int64_t& id);
 
+    /**
+     * Sets how often the metrics managers profile the events they process: one event in
+     * [sampleRate] is timed. 0 turns profiling off, which is the default.
+     */
+    void setProfilingSampleRate(int sampleRate);
+
+    /**
+     * Returns the rate set by setProfilingSampleRate(). Doesn't take the lock, it's read for
+     * every event.
+     */
+    int getProfilingSampleRate() const {
+        return mProfilingSampleRate.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Report the time a matcher, condition tracker or metric producer took on a profiled event.
+     *
+     * [key]: The config key that it belongs to.
+     * [id]: The id of the matcher, condition or metric.
+     * [timeNs]: The time it took.
+     */
+    void noteMatcherProcessingTime(const ConfigKey& key, const int64_t& id, int64_t timeNs);
+    void noteConditionProcessingTime(const ConfigKey& key, const int64_t& id, int64_t timeNs);
+    void noteMetricProcessingTime(const ConfigKey& key, const int64_t& id, int64_t timeNs);
+
     /**
      * Report that an anomaly detection alert has been declared.
      *
@@ -272,6 +311,12 @@ public:
     // Notify pull request for an atom served from cached data
     void notePullFromCache(int pullAtomId);
 
+    // Notify how long an actual pull of an atom took, including pulls that timed out
+    void notePullTime(int pullAtomId, int64_t pullTimeNs);
+
+    // Notify that a pull of an atom timed out
+    void notePullTimeout(int pullAtomId);
+
     /**
      * Records statsd met an error while reading from logd.
      */
@@ -310,6 +355,10 @@ public:
         long totalPull;
         long totalPullFromCache;
         long minPullIntervalSec;
+        long totalPullTime;
+        int64_t avgPullTimeNs;
+        int64_t maxPullTimeNs;
+        long pullTimeout;
     } PulledAtomStats;
 
 private:
@@ -317,6 +366,8 @@ private:
 
     mutable std::mutex mLock;
 
+    std::atomic<int> mProfilingSampleRate;
+
     int32_t mStartTimeSec;
 
     // Track the number of dropped entries used by the uid map.
@@ -29,15 +29,16 @@ using std::string;
 using std::vector;
 
 LogEvent::LogEvent(log_msg& msg) {
-    mContext =
-            create_android_log_parser(msg.msg() + sizeof(uint32_t), msg.len() - sizeof(uint32_t));
+    reset(msg);
+}
+
+void LogEvent::reset(log_msg& msg) {
+    // The log_msg is reused by the reader, keep a copy of the payload to parse it later.
+    const char* payload = msg.msg() + sizeof(uint32_t);
+    mBuffer.assign(payload, payload + msg.len() - sizeof(uint32_t));
     mLogdTimestampNs = msg.entry_v1.sec * NS_PER_SEC + msg.entry_v1.nsec;
     mLogUid = msg.entry_v4.uid;
-    init(mContext);
-    if (mContext) {
-        // android_log_destroy will set mContext to NULL
-        android_log_destroy(&mContext);
-    }
+    initFromBuffer();
 }
 
 LogEvent::LogEvent(int32_t tagId, int64_t wallClockTimestampNs, int64_t elapsedTimestampNs) {
@@ -66,15 +67,12 @@ void LogEvent::init() {
     if (mContext) {
         const char* buffer;
         size_t len = android_log_write_list_buffer(mContext, &buffer);
-        // turns to reader mode
-        android_log_context contextForRead = create_android_log_parser(buffer, len);
-        if (contextForRead) {
-            init(contextForRead);
-            // destroy the context to save memory.
-            // android_log_destroy will set mContext to NULL
-            android_log_destroy(&contextForRead);
-        }
+        mBuffer.assign(buffer, buffer + len);
+        // destroy the context to save memory.
+        // android_log_destroy will set mContext to NULL
         android_log_destroy(&mContext);
+        // turns to reader mode
+        initFromBuffer();
     }
 }
 
@@ -84,6 +82,10 @@ LogEvent::~LogEvent() {
         // but init() isn't called.
         android_log_destroy(&mContext);
     }
+    if (mReadContext) {
+        // The values were never read.
+        android_log_destroy(&mReadContext);
+    }
 }
 
 bool LogEvent::write(int32_t value) {
@@ -170,39 +172,90 @@ bool LogEvent::write(const AttributionNodeInternal& node) {
  * The goal is to do as little preprocessing as possible, because we read a tiny fraction
  * of the elements that are written to the log.
  *
- * The idea here is to read through the log items once, we get as much information we need for
- * matching as possible. Because this log will be matched against lots of matchers.
+ * Only the timestamp and the tag id are read here. Most events are dropped by their tag id, so
+ * the values, with the attribution chains that make up most of them, are only read by
+ * parseValues() when the event is matched. They're read once, and we get as much information we
+ * need for matching as possible, because the event is matched against lots of matchers.
  */
-void LogEvent::init(android_log_context context) {
+void LogEvent::initFromBuffer() {
+    mValuesSnapshot.reset();
+    if (mReadContext) {
+        // The values of the previous event were never read.
+        android_log_destroy(&mReadContext);
+    }
+    mReadContext = create_android_log_parser(mBuffer.data(), mBuffer.size());
+    if (!mReadContext) {
+        mValues.clear();
+        return;
+    }
+    // elem at [0] is EVENT_TYPE_LIST, [1] is the timestamp, [2] is tag id.
+    android_log_list_element elem = android_log_read_next(mReadContext);
+    bool valid = elem.type == EVENT_TYPE_LIST && !elem.complete;
+    if (valid) {
+        elem = android_log_read_next(mReadContext);
+        if (elem.type == EVENT_TYPE_LONG) {
+            mElapsedTimestampNs = elem.data.int64;
+        }
+        valid = elem.type != EVENT_TYPE_UNKNOWN && !elem.complete;
+    }
+    if (valid) {
+        elem = android_log_read_next(mReadContext);
+        if (elem.type == EVENT_TYPE_INT) {
+            mTagId = elem.data.int32;
+        }
+        valid = elem.type != EVENT_TYPE_UNKNOWN && !elem.complete;
+    }
+    if (!valid) {
+        // Nothing after the tag id.
+        mValues.clear();
+        android_log_destroy(&mReadContext);
+    }
+}
+
+FieldValue& LogEvent::nextValue(size_t* valueCount) const {
+    if (*valueCount == mValues.size()) {
+        mValues.emplace_back();
+    }
+    return mValues[(*valueCount)++];
+}
+
+void LogEvent::parseValues() const {
+    // The values of a reused event are overwritten in place, their strings keep their buffers.
+    size_t valueCount = 0;
+    readValues(mReadContext, &valueCount);
+    mValues.resize(valueCount);
+    // android_log_destroy will set mReadContext to NULL
+    android_log_destroy(&mReadContext);
+}
+
+void LogEvent::readValues(android_log_context context, size_t* valueCount) const {
     android_log_list_element elem;
-    int i = 0;
-    int depth = -1;
+    // The list of the event was read with the tag id.
+    int depth = 0;
     int pos[] = {1, 1, 1};
     do {
         elem = android_log_read_next(context);
         switch ((int)elem.type) {
-            case EVENT_TYPE_INT:
-                // elem at [0] is EVENT_TYPE_LIST, [1] is the timestamp, [2] is tag id.
-                if (i == 2) {
-                    mTagId = elem.data.int32;
-                } else {
-                    if (depth < 0 || depth > 2) {
-                        return;
-                    }
+            case EVENT_TYPE_INT: {
+                if (depth < 0 || depth > 2) {
+                    return;
+                }
 
-                    mValues.push_back(
-                            FieldValue(Field(mTagId, pos, depth), Value((int32_t)elem.data.int32)));
+                FieldValue& value = nextValue(valueCount);
+                value.mField = Field(mTagId, pos, depth);
+                value.mValue.setInt((int32_t)elem.data.int32);
 
-                    pos[depth]++;
-                }
-                break;
+                pos[depth]++;
+            } break;
             case EVENT_TYPE_FLOAT: {
                 if (depth < 0 || depth > 2) {
                     ALOGE("Depth > 2. Not supported!");
                     return;
                 }
 
-                mValues.push_back(FieldValue(Field(mTagId, pos, depth), Value(elem.data.float32)));
+                FieldValue& value = nextValue(valueCount);
+                value.mField = Field(mTagId, pos, depth);
+                value.mValue.setFloat(elem.data.float32);
 
                 pos[depth]++;
 
@@ -213,25 +266,23 @@ void LogEvent::init(android_log_context context) {
                     return;
                 }
 
-                mValues.push_back(FieldValue(Field(mTagId, pos, depth),
-                                             Value(string(elem.data.string, elem.len))));
+                FieldValue& value = nextValue(valueCount);
+                value.mField = Field(mTagId, pos, depth);
+                value.mValue.setString(elem.data.string, elem.len);
 
                 pos[depth]++;
 
             } break;
             case EVENT_TYPE_LONG: {
-                if (i == 1) {
-                    mElapsedTimestampNs = elem.data.int64;
-                } else {
-                    if (depth < 0 || depth > 2) {
-                        ALOGE("Depth > 2. Not supported!");
-                        return;
-                    }
-                    mValues.push_back(
-                            FieldValue(Field(mTagId, pos, depth), Value((int64_t)elem.data.int64)));
-
-                    pos[depth]++;
+                if (depth < 0 || depth > 2) {
+                    ALOGE("Depth > 2. Not supported!");
+                    return;
                 }
+                FieldValue& value = nextValue(valueCount);
+                value.mField = Field(mTagId, pos, depth);
+                value.mValue.setLong((int64_t)elem.data.int64);
+
+                pos[depth]++;
             } break;
             case EVENT_TYPE_LIST:
                 depth++;
@@ -250,10 +301,10 @@ void LogEvent::init(android_log_context context) {
                     // So that we can later easily match them with Position=Last matchers.
                     pos[prevDepth]--;
                     int path = getEncodedField(pos, prevDepth, false);
-                    for (auto it = mValues.rbegin(); it != mValues.rend(); ++it) {
-                        if (it->mField.getDepth() >= prevDepth &&
-                            it->mField.getPath(prevDepth) == path) {
-                            it->mField.decorateLastPos(prevDepth);
+                    for (size_t j = *valueCount; j-- > 0;) {
+                        Field& field = mValues[j].mField;
+                        if (field.getDepth() >= prevDepth && field.getPath(prevDepth) == path) {
+                            field.decorateLastPos(prevDepth);
                         } else {
                             // Safe to break, because the items are in DFS order.
                             break;
@@ -268,14 +319,13 @@ void LogEvent::init(android_log_context context) {
             default:
                 break;
         }
-        i++;
     } while ((elem.type != EVENT_TYPE_UNKNOWN) && !elem.complete);
 }
 
 int64_t LogEvent::GetLong(size_t key, status_t* err) const {
     // TODO: encapsulate the magical operations all in Field struct as a static function.
     int field = getSimpleField(key);
-    for (const auto& value : mValues) {
+    for (const auto& value : getValues()) {
         if (value.mField.getField() == field) {
             if (value.mValue.getType() == LONG) {
                 return value.mValue.long_value;
@@ -297,7 +347,7 @@ int64_t LogEvent::GetLong(size_t key, status_t* err) const {
 
 int LogEvent::GetInt(size_t key, status_t* err) const {
     int field = getSimpleField(key);
-    for (const auto& value : mValues) {
+    for (const auto& value : getValues()) {
         if (value.mField.getField() == field) {
             if (value.mValue.getType() == INT) {
                 return value.mValue.int_value;
@@ -317,7 +367,7 @@ int LogEvent::GetInt(size_t key, status_t* err) const {
 
 const char* LogEvent::GetString(size_t key, status_t* err) const {
     int field = getSimpleField(key);
-    for (const auto& value : mValues) {
+    for (const auto& value : getValues()) {
         if (value.mField.getField() == field) {
             if (value.mValue.getType() == STRING) {
                 return value.mValue.str_value.c_str();
@@ -337,7 +387,7 @@ const char* LogEvent::GetString(size_t key, status_t* err) const {
 
 bool LogEvent::GetBool(size_t key, status_t* err) const {
     int field = getSimpleField(key);
-    for (const auto& value : mValues) {
+    for (const auto& value : getValues()) {
         if (value.mField.getField() == field) {
             if (value.mValue.getType() == INT) {
                 return value.mValue.int_value != 0;
@@ -359,7 +409,7 @@ bool LogEvent::GetBool(size_t key, status_t* err) const {
 
 float LogEvent::GetFloat(size_t key, status_t* err) const {
     int field = getSimpleField(key);
-    for (const auto& value : mValues) {
+    for (const auto& value : getValues()) {
         if (value.mField.getField() == field) {
             if (value.mValue.getType() == FLOAT) {
                 return value.mValue.float_value;
@@ -381,7 +431,7 @@ string LogEvent::ToString() const {
     string result;
     result += StringPrintf("{ %lld %lld (%d)", (long long)mLogdTimestampNs,
                            (long long)mElapsedTimestampNs, mTagId);
-    for (const auto& value : mValues) {
+    for (const auto& value : getValues()) {
         result +=
                 StringPrintf("%#x", value.mField.getField()) + "->" + value.mValue.toString() + " ";
     }
@@ -24,6 +24,7 @@
 #include <private/android_logger.h>
 #include <utils/Errors.h>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -61,6 +62,13 @@ public:
      */
     explicit LogEvent(log_msg& msg);
 
+    /**
+     * Read the LogEvent from another log_msg, reusing the storage of the current values, so that
+     * a reader can parse all its messages into a single LogEvent without allocating for each.
+     * Nothing may keep a reference to the previous values.
+     */
+    void reset(log_msg& msg);
+
     /**
      * Constructs a LogEvent with synthetic data for testing. Must call init() before reading.
      */
@@ -142,17 +150,46 @@ public:
     }
 
     inline int size() const {
-        return mValues.size();
+        return getValues().size();
     }
 
+    // The values are only decoded on the first call, most events are dropped by the tag id.
     const std::vector<FieldValue>& getValues() const {
+        if (mReadContext) {
+            parseValues();
+        }
         return mValues;
     }
 
     std::vector<FieldValue>* getMutableValues() {
+        if (mReadContext) {
+            parseValues();
+        }
+        // Snapshots already taken keep the old values.
+        mValuesSnapshot.reset();
         return &mValues;
     }
 
+    /**
+     * An immutable copy of the values, made on the first call and shared by all the callers that
+     * keep the values after the event is gone, e.g. every gauge metric sampling a pulled atom.
+     */
+    std::shared_ptr<const std::vector<FieldValue>> getValuesSnapshot() const {
+        if (mValuesSnapshot == nullptr) {
+            mValuesSnapshot = std::make_shared<const std::vector<FieldValue>>(getValues());
+        }
+        return mValuesSnapshot;
+    }
+
+    /**
+     * Decodes the values and makes their snapshot now. The const accessors above fill them in
+     * lazily otherwise, so this must be called before the event is read by several threads, e.g.
+     * once a pulled event is cached.
+     */
+    void prepareForSharing() {
+        getValuesSnapshot();
+    }
+
 private:
     /**
      * Don't copy, it's slower. If we really need this we can add it but let's try to
@@ -161,13 +198,35 @@ private:
     explicit LogEvent(const LogEvent&);
 
     /**
-     * Parses a log_msg into a LogEvent object.
+     * Reads the timestamp and tag id from mBuffer, and leaves mReadContext after them so that
+     * the values can be parsed later.
      */
-    void init(android_log_context context);
+    void initFromBuffer();
+
+    /**
+     * Parses the rest of mBuffer into mValues and destroys mReadContext.
+     */
+    void parseValues() const;
+
+    /**
+     * Reads the values into mValues, overwriting the first *valueCount ones before appending.
+     */
+    void readValues(android_log_context context, size_t* valueCount) const;
+
+    FieldValue& nextValue(size_t* valueCount) const;
 
     // The items are naturally sorted in DFS order as we read them. this allows us to do fast
-    // matching.
-    std::vector<FieldValue> mValues;
+    // matching. Filled by parseValues() when first read.
+    mutable std::vector<FieldValue> mValues;
+
+    // Made by getValuesSnapshot(), dropped when the values change.
+    mutable std::shared_ptr<const std::vector<FieldValue>> mValuesSnapshot;
+
+    // The encoded event, kept until its values are parsed. Reused by reset().
+    std::vector<char> mBuffer;
+
+    // Reads mBuffer, positioned after the tag id. NULL once the values are parsed.
+    mutable android_log_context mReadContext = NULL;
 
     // This field is used when statsD wants to create log event object and write fields to it. After
     // calling init() function, this object would be destroyed to save memory usage.
@@ -36,6 +36,12 @@ LogListener::LogListener() {
 LogListener::~LogListener() {
 }
 
+void LogListener::OnLogEvents(const vector<LogEvent*>& events) {
+    for (LogEvent* event : events) {
+        OnLogEvent(event, false);
+    }
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
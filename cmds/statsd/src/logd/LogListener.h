@@ -34,6 +34,12 @@ public:
     virtual ~LogListener();
 
     virtual void OnLogEvent(LogEvent* msg, bool reconnectionStarts) = 0;
+
+    /**
+     * Called with the events read together, in order, none of them starts a reconnection.
+     * Listeners that take a lock per event can override it to take it once for all of them.
+     */
+    virtual void OnLogEvents(const std::vector<LogEvent*>& events);
 };
 
 }  // namespace statsd
@@ -48,7 +48,7 @@ public:
                     std::vector<MatchingState>& matcherResults) override;
 
 private:
-    const SimpleAtomMatcher mMatcher;
+    const CompiledAtomMatcher mMatcher;
     const UidMap& mUidMap;
 };
 
@@ -82,30 +82,137 @@ bool combinationMatch(const vector<int>& children, const LogicalOperation& opera
     return matched;
 }
 
-bool tryMatchString(const UidMap& uidMap, const Field& field, const Value& value,
-                    const string& str_match) {
-    if (isAttributionUidField(field, value)) {
-        int uid = value.int_value;
-        auto aidIt = UidMap::sAidToUidMapping.find(str_match);
-        if (aidIt != UidMap::sAidToUidMapping.end()) {
-            return ((int)aidIt->second) == uid;
-        }
-        std::set<string> packageNames = uidMap.getAppNamesFromUid(uid, true /* normalize*/);
-        return packageNames.find(str_match) != packageNames.end();
-    } else if (value.getType() == STRING) {
-        return value.str_value == str_match;
+void CompiledAtomMatcher::StringOperands::add(const string& str) {
+    strings.insert(str);
+    auto aidIt = UidMap::sAidToUidMapping.find(str);
+    if (aidIt != UidMap::sAidToUidMapping.end()) {
+        aidUids.insert((int32_t)aidIt->second);
+    } else {
+        packageNames.insert(str);
     }
-    return false;
 }
 
-bool matchesSimple(const UidMap& uidMap, const FieldValueMatcher& matcher,
-                   const vector<FieldValue>& values, int start, int end, int depth) {
+CompiledAtomMatcher::CompiledAtomMatcher(const SimpleAtomMatcher& matcher)
+    : mAtomId(matcher.atom_id()) {
+    int32_t first;
+    compileChildren(matcher.field_value_matcher(), 0, &first, &mRootCount);
+}
+
+void CompiledAtomMatcher::compileChildren(
+        const google::protobuf::RepeatedPtrField<FieldValueMatcher>& matchers, int32_t depth,
+        int32_t* outFirst, int32_t* outCount) {
+    *outFirst = mNodes.size();
+    *outCount = matchers.size();
+    mNodes.resize(mNodes.size() + matchers.size());
+    for (int i = 0; i < matchers.size(); i++) {
+        compileNode(matchers.Get(i), depth, *outFirst + i);
+    }
+}
+
+void CompiledAtomMatcher::compileNode(const FieldValueMatcher& matcher, int32_t depth,
+                                      int32_t index) {
+    // mNodes grows while the children of a tuple are compiled, the node is only stored at the end.
+    Node node = {};
+    node.field = matcher.field();
+    node.position = matcher.position();
+    node.hasPosition = matcher.has_position();
+    node.depth = depth;
+    node.op = kNever;
+
     if (depth > 2) {
         ALOGE("Depth > 3 not supported");
-        return false;
+        mNodes[index] = node;
+        return;
     }
+    // Repeated fields position is stored as a node in the path.
+    const int32_t valueDepth = node.hasPosition ? depth + 1 : depth;
+    if (valueDepth > 2) {
+        mNodes[index] = node;
+        return;
+    }
+    if (node.hasPosition && node.position == Position::ALL) {
+        ALOGE("Not supported: field matcher with ALL position.");
+    }
+
+    switch (matcher.value_matcher_case()) {
+        case FieldValueMatcher::kMatchesTuple:
+            node.op = kTuple;
+            compileChildren(matcher.matches_tuple().field_value_matcher(), valueDepth + 1,
+                            &node.firstChild, &node.childCount);
+            break;
+        case FieldValueMatcher::ValueMatcherCase::kEqBool:
+            node.op = kEqBool;
+            node.boolOperand = matcher.eq_bool();
+            break;
+        case FieldValueMatcher::ValueMatcherCase::kEqString:
+            node.op = kEqAnyString;
+            node.stringOperands = mStringOperands.size();
+            mStringOperands.emplace_back();
+            mStringOperands.back().add(matcher.eq_string());
+            break;
+        case FieldValueMatcher::ValueMatcherCase::kNeqAnyString:
+        case FieldValueMatcher::ValueMatcherCase::kEqAnyString: {
+            const bool eq = matcher.value_matcher_case() == FieldValueMatcher::kEqAnyString;
+            node.op = eq ? kEqAnyString : kNeqAnyString;
+            node.stringOperands = mStringOperands.size();
+            mStringOperands.emplace_back();
+            const auto& strList = eq ? matcher.eq_any_string() : matcher.neq_any_string();
+            for (const auto& str : strList.str_value()) {
+                mStringOperands.back().add(str);
+            }
+            break;
+        }
+        case FieldValueMatcher::ValueMatcherCase::kEqInt:
+            node.op = kEqInt;
+            node.intOperand = matcher.eq_int();
+            break;
+        case FieldValueMatcher::ValueMatcherCase::kLtInt:
+            node.op = kLtInt;
+            node.intOperand = matcher.lt_int();
+            break;
+        case FieldValueMatcher::ValueMatcherCase::kGtInt:
+            node.op = kGtInt;
+            node.intOperand = matcher.gt_int();
+            break;
+        case FieldValueMatcher::ValueMatcherCase::kLteInt:
+            node.op = kLteInt;
+            node.intOperand = matcher.lte_int();
+            break;
+        case FieldValueMatcher::ValueMatcherCase::kGteInt:
+            node.op = kGteInt;
+            node.intOperand = matcher.gte_int();
+            break;
+        case FieldValueMatcher::ValueMatcherCase::kLtFloat:
+            node.op = kLtFloat;
+            node.floatOperand = matcher.lt_float();
+            break;
+        case FieldValueMatcher::ValueMatcherCase::kGtFloat:
+            node.op = kGtFloat;
+            node.floatOperand = matcher.gt_float();
+            break;
+        default:
+            break;
+    }
+    mNodes[index] = node;
+}
+
+bool CompiledAtomMatcher::matches(const UidMap& uidMap, const LogEvent& event) const {
+    if (mRootCount == 0) {
+        return event.GetTagId() == mAtomId;
+    }
+    const vector<FieldValue>& values = event.getValues();
+    for (int32_t i = 0; i < mRootCount; i++) {
+        if (!matchesNode(uidMap, mNodes[i], values, 0, values.size())) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    if (start >= end) {
+bool CompiledAtomMatcher::matchesNode(const UidMap& uidMap, const Node& node,
+                                      const vector<FieldValue>& values, int start,
+                                      int end) const {
+    if (node.op == kNever || start >= end) {
         return false;
     }
 
@@ -115,258 +222,192 @@ bool matchesSimple(const UidMap& uidMap, const FieldValueMatcher& matcher,
     // because the fields are naturally sorted in the DFS order. we can safely
     // break when pos is larger than the one we are searching for.
     for (int i = start; i < end; i++) {
-        int pos = values[i].mField.getPosAtDepth(depth);
-        if (pos == matcher.field()) {
+        int pos = values[i].mField.getPosAtDepth(node.depth);
+        if (pos == node.field) {
             if (newStart == -1) {
                 newStart = i;
             }
             newEnd = i + 1;
-        } else if (pos > matcher.field()) {
+        } else if (pos > node.field) {
             break;
         }
     }
-
-    // Now we have zoomed in to a new range
-    start = newStart;
-    end = newEnd;
-
-    if (start == -1) {
+    if (newStart == -1) {
         // No such field found.
         return false;
     }
+    // Now we have zoomed in to a new range
+    start = newStart;
+    end = newEnd;
 
-    vector<pair<int, int>> ranges; // the ranges are for matching ANY position
-    if (matcher.has_position()) {
-        // Repeated fields position is stored as a node in the path.
-        depth++;
-        if (depth > 2) {
-            return false;
-        }
-        switch (matcher.position()) {
-            case Position::FIRST: {
-                for (int i = start; i < end; i++) {
-                    int pos = values[i].mField.getPosAtDepth(depth);
-                    if (pos != 1) {
-                        // Again, the log elements are stored in sorted order. so
-                        // once the position is > 1, we break;
-                        end = i;
-                        break;
-                    }
-                }
-                ranges.push_back(std::make_pair(start, end));
-                break;
-            }
-            case Position::LAST: {
-                // move the starting index to the first LAST field at the depth.
-                for (int i = start; i < end; i++) {
-                    if (values[i].mField.isLastPos(depth)) {
-                        start = i;
-                        break;
-                    }
-                }
-                ranges.push_back(std::make_pair(start, end));
-                break;
-            }
-            case Position::ANY: {
-                // ANY means all the children matchers match in any of the sub trees, it's a match
-                newStart = start;
-                newEnd = end;
-                // Here start is guaranteed to be a valid index.
-                int currentPos = values[start].mField.getPosAtDepth(depth);
-                // Now find all sub trees ranges.
-                for (int i = start; i < end; i++) {
-                    int newPos = values[i].mField.getPosAtDepth(depth);
-                    if (newPos != currentPos) {
-                        ranges.push_back(std::make_pair(newStart, i));
-                        newStart = i;
-                        currentPos = newPos;
-                    }
-                }
-                ranges.push_back(std::make_pair(newStart, end));
-                break;
-            }
-            case Position::ALL:
-                ALOGE("Not supported: field matcher with ALL position.");
-                break;
-            case Position::POSITION_UNKNOWN:
-                break;
-        }
-    } else {
-        // No position
-        ranges.push_back(std::make_pair(start, end));
+    if (!node.hasPosition) {
+        return matchesRange(uidMap, node, values, start, end);
     }
-    // start and end are still pointing to the matched range.
-    switch (matcher.value_matcher_case()) {
-        case FieldValueMatcher::kMatchesTuple: {
-            ++depth;
-            // If any range matches all matchers, good.
-            for (const auto& range : ranges) {
-                bool matched = true;
-                for (const auto& subMatcher : matcher.matches_tuple().field_value_matcher()) {
-                    if (!matchesSimple(uidMap, subMatcher, values, range.first, range.second,
-                                       depth)) {
-                        matched = false;
-                        break;
-                    }
-                }
-                if (matched) return true;
-            }
-            return false;
-        }
-        // Finally, we get to the point of real value matching.
-        // If the field matcher ends with ANY, then we have [start, end) range > 1.
-        // In the following, we should return true, when ANY of the values matches.
-        case FieldValueMatcher::ValueMatcherCase::kEqBool: {
+    const int32_t depth = node.depth + 1;
+    switch (node.position) {
+        case Position::FIRST: {
             for (int i = start; i < end; i++) {
-                if ((values[i].mValue.getType() == INT &&
-                     (values[i].mValue.int_value != 0) == matcher.eq_bool()) ||
-                    (values[i].mValue.getType() == LONG &&
-                     (values[i].mValue.long_value != 0) == matcher.eq_bool())) {
-                    return true;
+                if (values[i].mField.getPosAtDepth(depth) != 1) {
+                    // Again, the log elements are stored in sorted order. so
+                    // once the position is > 1, we break;
+                    end = i;
+                    break;
                 }
             }
-            return false;
+            return matchesRange(uidMap, node, values, start, end);
         }
-        case FieldValueMatcher::ValueMatcherCase::kEqString: {
+        case Position::LAST: {
+            // move the starting index to the first LAST field at the depth.
             for (int i = start; i < end; i++) {
-                if (tryMatchString(uidMap, values[i].mField, values[i].mValue,
-                                   matcher.eq_string())) {
-                    return true;
+                if (values[i].mField.isLastPos(depth)) {
+                    start = i;
+                    break;
                 }
             }
-            return false;
+            return matchesRange(uidMap, node, values, start, end);
         }
-        case FieldValueMatcher::ValueMatcherCase::kNeqAnyString: {
-            const auto& str_list = matcher.neq_any_string();
-            for (int i = start; i < end; i++) {
-                bool notEqAll = true;
-                for (const auto& str : str_list.str_value()) {
-                    if (tryMatchString(uidMap, values[i].mField, values[i].mValue, str)) {
-                        notEqAll = false;
-                        break;
-                    }
-                }
-                if (notEqAll) {
-                    return true;
-                }
+        case Position::ANY: {
+            // The values match if any of them does, whichever sub tree it is in.
+            if (node.op != kTuple) {
+                return matchesRange(uidMap, node, values, start, end);
             }
-            return false;
-        }
-        case FieldValueMatcher::ValueMatcherCase::kEqAnyString: {
-            const auto& str_list = matcher.eq_any_string();
+            // ANY means all the children matchers match in any of the sub trees, it's a match
+            int rangeStart = start;
+            int currentPos = values[start].mField.getPosAtDepth(depth);
             for (int i = start; i < end; i++) {
-                for (const auto& str : str_list.str_value()) {
-                    if (tryMatchString(uidMap, values[i].mField, values[i].mValue, str)) {
+                int newPos = values[i].mField.getPosAtDepth(depth);
+                if (newPos != currentPos) {
+                    if (matchesRange(uidMap, node, values, rangeStart, i)) {
                         return true;
                     }
+                    rangeStart = i;
+                    currentPos = newPos;
                 }
             }
-            return false;
+            return matchesRange(uidMap, node, values, rangeStart, end);
         }
-        case FieldValueMatcher::ValueMatcherCase::kEqInt: {
-            for (int i = start; i < end; i++) {
-                if (values[i].mValue.getType() == INT &&
-                    (matcher.eq_int() == values[i].mValue.int_value)) {
-                    return true;
-                }
-                // eq_int covers both int and long.
-                if (values[i].mValue.getType() == LONG &&
-                    (matcher.eq_int() == values[i].mValue.long_value)) {
-                    return true;
-                }
+        default:
+            // ALL and unknown positions have no sub tree for tuples, values are matched over the
+            // whole field.
+            return node.op != kTuple && matchesRange(uidMap, node, values, start, end);
+    }
+}
+
+// The int matchers cover both int and long values.
+static bool getIntValue(const Value& value, int64_t* outValue) {
+    if (value.getType() == INT) {
+        *outValue = value.int_value;
+        return true;
+    }
+    if (value.getType() == LONG) {
+        *outValue = value.long_value;
+        return true;
+    }
+    return false;
+}
+
+bool CompiledAtomMatcher::matchesRange(const UidMap& uidMap, const Node& node,
+                                       const vector<FieldValue>& values, int start,
+                                       int end) const {
+    if (node.op == kTuple) {
+        for (int32_t i = 0; i < node.childCount; i++) {
+            if (!matchesNode(uidMap, mNodes[node.firstChild + i], values, start, end)) {
+                return false;
             }
-            return false;
         }
-        case FieldValueMatcher::ValueMatcherCase::kLtInt: {
-            for (int i = start; i < end; i++) {
-                if (values[i].mValue.getType() == INT &&
-                    (values[i].mValue.int_value < matcher.lt_int())) {
+        return true;
+    }
+
+    // If the field matcher ends with ANY, then we have [start, end) range > 1.
+    // In the following, we should return true, when ANY of the values matches.
+    for (int i = start; i < end; i++) {
+        const Value& value = values[i].mValue;
+        int64_t intValue;
+        switch (node.op) {
+            case kEqBool:
+                if (getIntValue(value, &intValue) && (intValue != 0) == node.boolOperand) {
                     return true;
                 }
-                // lt_int covers both int and long.
-                if (values[i].mValue.getType() == LONG &&
-                    (values[i].mValue.long_value < matcher.lt_int())) {
+                break;
+            case kEqAnyString:
+                if (matchesAnyString(uidMap, mStringOperands[node.stringOperands], values[i])) {
                     return true;
                 }
-            }
-            return false;
-        }
-        case FieldValueMatcher::ValueMatcherCase::kGtInt: {
-            for (int i = start; i < end; i++) {
-                if (values[i].mValue.getType() == INT &&
-                    (values[i].mValue.int_value > matcher.gt_int())) {
+                break;
+            case kNeqAnyString:
+                if (!matchesAnyString(uidMap, mStringOperands[node.stringOperands], values[i])) {
                     return true;
                 }
-                // gt_int covers both int and long.
-                if (values[i].mValue.getType() == LONG &&
-                    (values[i].mValue.long_value > matcher.gt_int())) {
+                break;
+            case kEqInt:
+                if (getIntValue(value, &intValue) && intValue == node.intOperand) {
                     return true;
                 }
-            }
-            return false;
-        }
-        case FieldValueMatcher::ValueMatcherCase::kLtFloat: {
-            for (int i = start; i < end; i++) {
-                if (values[i].mValue.getType() == FLOAT &&
-                    (values[i].mValue.float_value < matcher.lt_float())) {
+                break;
+            case kLtInt:
+                if (getIntValue(value, &intValue) && intValue < node.intOperand) {
                     return true;
                 }
-            }
-            return false;
-        }
-        case FieldValueMatcher::ValueMatcherCase::kGtFloat: {
-            for (int i = start; i < end; i++) {
-                if (values[i].mValue.getType() == FLOAT &&
-                    (values[i].mValue.float_value > matcher.gt_float())) {
+                break;
+            case kGtInt:
+                if (getIntValue(value, &intValue) && intValue > node.intOperand) {
                     return true;
                 }
-            }
-            return false;
-        }
-        case FieldValueMatcher::ValueMatcherCase::kLteInt: {
-            for (int i = start; i < end; i++) {
-                if (values[i].mValue.getType() == INT &&
-                    (values[i].mValue.int_value <= matcher.lte_int())) {
+                break;
+            case kLteInt:
+                if (getIntValue(value, &intValue) && intValue <= node.intOperand) {
                     return true;
                 }
-                // lte_int covers both int and long.
-                if (values[i].mValue.getType() == LONG &&
-                    (values[i].mValue.long_value <= matcher.lte_int())) {
+                break;
+            case kGteInt:
+                if (getIntValue(value, &intValue) && intValue >= node.intOperand) {
                     return true;
                 }
-            }
-            return false;
-        }
-        case FieldValueMatcher::ValueMatcherCase::kGteInt: {
-            for (int i = start; i < end; i++) {
-                if (values[i].mValue.getType() == INT &&
-                    (values[i].mValue.int_value >= matcher.gte_int())) {
+                break;
+            case kLtFloat:
+                if (value.getType() == FLOAT && value.float_value < node.floatOperand) {
                     return true;
                 }
-                // gte_int covers both int and long.
-                if (values[i].mValue.getType() == LONG &&
-                    (values[i].mValue.long_value >= matcher.gte_int())) {
+                break;
+            case kGtFloat:
+                if (value.getType() == FLOAT && value.float_value > node.floatOperand) {
                     return true;
                 }
-            }
-            return false;
+                break;
+            default:
+                return false;
         }
-        default:
-            return false;
     }
+    return false;
 }
 
-bool matchesSimple(const UidMap& uidMap, const SimpleAtomMatcher& simpleMatcher,
-                   const LogEvent& event) {
-    if (simpleMatcher.field_value_matcher_size() <= 0) {
-        return event.GetTagId() == simpleMatcher.atom_id();
-    }
-    for (const auto& matcher : simpleMatcher.field_value_matcher()) {
-        if (!matchesSimple(uidMap, matcher, event.getValues(), 0, event.getValues().size(), 0)) {
+bool CompiledAtomMatcher::matchesAnyString(const UidMap& uidMap, const StringOperands& operands,
+                                           const FieldValue& value) const {
+    if (isAttributionUidField(value)) {
+        const int32_t uid = value.mValue.int_value;
+        if (operands.aidUids.find(uid) != operands.aidUids.end()) {
+            return true;
+        }
+        if (operands.packageNames.empty()) {
             return false;
         }
+        // Looked up once for all the strings, the names of a uid change with installs.
+        for (const string& name : uidMap.getAppNamesFromUid(uid, true /* normalize*/)) {
+            if (operands.packageNames.find(name) != operands.packageNames.end()) {
+                return true;
+            }
+        }
+        return false;
+    } else if (value.mValue.getType() == STRING) {
+        return operands.strings.find(value.mValue.str_value) != operands.strings.end();
     }
-    return true;
+    return false;
+}
+
+bool matchesSimple(const UidMap& uidMap, const SimpleAtomMatcher& simpleMatcher,
+                   const LogEvent& event) {
+    // Trackers keep their CompiledAtomMatcher, this compiles it for a single event.
+    return CompiledAtomMatcher(simpleMatcher).matches(uidMap, event);
 }
 
 }  // namespace statsd
@@ -23,6 +23,7 @@
 #include <set>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include "frameworks/base/cmds/statsd/src/statsd_config.pb.h"
 #include "packages/UidMap.h"
@@ -41,6 +42,89 @@ enum MatchingState {
 bool combinationMatch(const std::vector<int>& children, const LogicalOperation& operation,
                       const std::vector<MatchingState>& matcherResults);
 
+/**
+ * A SimpleAtomMatcher flattened into typed predicates when the config is loaded, so that matching
+ * an event doesn't walk the proto or convert its operands. String operands are kept in hash sets
+ * and AID names are resolved to uids up front. Package names are looked up in the UidMap when
+ * matching, because apps can be installed or removed after the config is loaded.
+ */
+class CompiledAtomMatcher {
+public:
+    explicit CompiledAtomMatcher(const SimpleAtomMatcher& matcher);
+
+    bool matches(const UidMap& uidMap, const LogEvent& event) const;
+
+private:
+    enum Op {
+        kNever,
+        kTuple,
+        kEqBool,
+        kEqAnyString,
+        kNeqAnyString,
+        kEqInt,
+        kLtInt,
+        kGtInt,
+        kLteInt,
+        kGteInt,
+        kLtFloat,
+        kGtFloat,
+    };
+
+    struct StringOperands {
+        // All the strings, compared against string fields.
+        std::unordered_set<std::string> strings;
+        // The strings that are AID names, compared against attribution uids.
+        std::set<int32_t> aidUids;
+        // The other strings, compared against the package names of attribution uids.
+        std::unordered_set<std::string> packageNames;
+
+        void add(const std::string& str);
+    };
+
+    struct Node {
+        int32_t field;
+        // POSITION_UNKNOWN if the matcher has no position.
+        Position position;
+        bool hasPosition;
+        Op op;
+        // Depth of the field in the event, the position is at the next depth.
+        int32_t depth;
+        union {
+            bool boolOperand;
+            int64_t intOperand;
+            float floatOperand;
+            // Index in mStringOperands.
+            int32_t stringOperands;
+        };
+        // Children of a tuple are contiguous in mNodes.
+        int32_t firstChild;
+        int32_t childCount;
+    };
+
+    void compileChildren(const google::protobuf::RepeatedPtrField<FieldValueMatcher>& matchers,
+                         int32_t depth, int32_t* outFirst, int32_t* outCount);
+
+    void compileNode(const FieldValueMatcher& matcher, int32_t depth, int32_t index);
+
+    bool matchesNode(const UidMap& uidMap, const Node& node, const std::vector<FieldValue>& values,
+                     int start, int end) const;
+
+    bool matchesRange(const UidMap& uidMap, const Node& node,
+                      const std::vector<FieldValue>& values, int start, int end) const;
+
+    bool matchesAnyString(const UidMap& uidMap, const StringOperands& operands,
+                          const FieldValue& value) const;
+
+    const int32_t mAtomId;
+
+    std::vector<Node> mNodes;
+
+    // The top level matchers are mNodes[0, mRootCount), all of them have to match.
+    int32_t mRootCount;
+
+    std::vector<StringOperands> mStringOperands;
+};
+
 bool matchesSimple(const UidMap& uidMap,
     const SimpleAtomMatcher& simpleMatcher, const LogEvent& wrapper);
 
@@ -318,17 +318,12 @@ void CountMetricProducer::flushIfNeededLocked(const int64_t& eventTimeNs) {
 
 void CountMetricProducer::flushCurrentBucketLocked(const int64_t& eventTimeNs) {
     int64_t fullBucketEndTimeNs = getCurrentBucketEndTimeNs();
-    CountBucket info;
-    info.mBucketStartNs = mCurrentBucketStartTimeNs;
+    int64_t bucketEndNs = fullBucketEndTimeNs;
     if (eventTimeNs < fullBucketEndTimeNs) {
-        info.mBucketEndNs = eventTimeNs;
-    } else {
-        info.mBucketEndNs = fullBucketEndTimeNs;
+        bucketEndNs = eventTimeNs;
     }
     for (const auto& counter : *mCurrentSlicedCounter) {
-        info.mCount = counter.second;
-        auto& bucketList = mPastBuckets[counter.first];
-        bucketList.push_back(info);
+        mPastBuckets.add(counter.first, mCurrentBucketStartTimeNs, bucketEndNs, counter.second);
         VLOG("metric %lld, dump key value: %s -> %lld", (long long)mMetricId,
              counter.first.toString().c_str(),
              (long long)counter.second);
@@ -367,11 +362,7 @@ void CountMetricProducer::flushCurrentBucketLocked(const int64_t& eventTimeNs) {
 // greater than actual data size as it contains each dimension of
 // CountMetricData is  duplicated.
 size_t CountMetricProducer::byteSizeLocked() const {
-    size_t totalSize = 0;
-    for (const auto& pair : mPastBuckets) {
-        totalSize += pair.second.size() * kBucketSize;
-    }
-    return totalSize;
+    return mPastBuckets.byteSize();
 }
 
 }  // namespace statsd
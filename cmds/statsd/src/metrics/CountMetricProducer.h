@@ -25,6 +25,7 @@
 #include "../condition/ConditionTracker.h"
 #include "../matchers/matcher_util.h"
 #include "MetricProducer.h"
+#include "PastBuckets.h"
 #include "frameworks/base/cmds/statsd/src/statsd_config.pb.h"
 #include "stats_util.h"
 
@@ -81,7 +82,7 @@ private:
     void flushCurrentBucketLocked(const int64_t& eventTimeNs) override;
 
     // TODO: Add a lock to mPastBuckets.
-    std::unordered_map<MetricDimensionKey, std::vector<CountBucket>> mPastBuckets;
+    PastBuckets<CountBucket, &CountBucket::mCount> mPastBuckets;
 
     // The current bucket (may be a partial bucket).
     std::shared_ptr<DimToValMap> mCurrentSlicedCounter = std::make_shared<DimToValMap>();
@@ -90,8 +91,6 @@ private:
     // partial bucket). This is only updated while flushing the current bucket.
     std::shared_ptr<DimToValMap> mCurrentFullCounters = std::make_shared<DimToValMap>();
 
-    static const size_t kBucketSize = sizeof(CountBucket{});
-
     bool hitGuardRailLocked(const MetricDimensionKey& newKey);
 
     FRIEND_TEST(CountMetricProducerTest, TestNonDimensionalEvents);
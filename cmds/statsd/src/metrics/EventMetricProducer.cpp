@@ -18,11 +18,14 @@
 #include "Log.h"
 
 #include "EventMetricProducer.h"
+#include "guardrail/StatsdStats.h"
 #include "stats_util.h"
 #include "stats_log_util.h"
+#include "storage/StorageManager.h"
 
 #include <limits.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 using android::util::FIELD_COUNT_REPEATED;
 using android::util::FIELD_TYPE_BOOL;
@@ -55,7 +58,9 @@ EventMetricProducer::EventMetricProducer(const ConfigKey& key, const EventMetric
                                          const int conditionIndex,
                                          const sp<ConditionWizard>& wizard,
                                          const int64_t startTimeNs)
-    : MetricProducer(metric.id(), key, startTimeNs, conditionIndex, wizard) {
+    : MetricProducer(metric.id(), key, startTimeNs, conditionIndex, wizard),
+      mSpillFile(StorageManager::getSpillFilePath(key, metric.id())),
+      mSpilledBytes(0) {
     if (metric.links().size() > 0) {
         for (const auto& link : metric.links()) {
             Metric2Condition mc;
@@ -67,16 +72,41 @@ EventMetricProducer::EventMetricProducer(const ConfigKey& key, const EventMetric
         mConditionSliced = true;
     }
     mProto = std::make_unique<ProtoOutputStream>();
+    // Left by a metric with the same id, which was removed or replaced.
+    deleteSpillFileLocked();
     VLOG("metric %lld created. bucket size %lld start_time: %lld", (long long)metric.id(),
          (long long)mBucketSizeNs, (long long)mTimeBaseNs);
 }
 
 EventMetricProducer::~EventMetricProducer() {
     VLOG("~EventMetricProducer() called");
+    deleteSpillFileLocked();
 }
 
 void EventMetricProducer::dropDataLocked(const int64_t dropTimeNs) {
     mProto->clear();
+    deleteSpillFileLocked();
+}
+
+void EventMetricProducer::spillLocked() {
+    // bytesWritten() is a bit more than size(), which can't be called unless the events are
+    // moved, since mProto can't be written after it.
+    if (mSpilledBytes + mProto->bytesWritten() > kMaxSpilledBytes) {
+        return;
+    }
+    size_t size = mProto->size();
+    if (StorageManager::appendToFile(mSpillFile.c_str(), mProto.get())) {
+        VLOG("metric %lld spilled %zu bytes", (long long)mMetricId, size);
+        mSpilledBytes += size;
+    } else {
+        StatsdStats::getInstance().noteDataDropped(mConfigKey);
+    }
+    mProto->clear();
+}
+
+void EventMetricProducer::deleteSpillFileLocked() {
+    unlink(mSpillFile.c_str());
+    mSpilledBytes = 0;
 }
 
 void EventMetricProducer::onSlicedConditionMayChangeLocked(bool overallCondition,
@@ -102,24 +132,32 @@ std::unique_ptr<std::vector<uint8_t>> serializeProtoLocked(ProtoOutputStream& pr
 
 void EventMetricProducer::clearPastBucketsLocked(const int64_t dumpTimeNs) {
     mProto->clear();
+    deleteSpillFileLocked();
 }
 
 void EventMetricProducer::onDumpReportLocked(const int64_t dumpTimeNs,
                                              const bool include_current_partial_bucket,
                                              std::set<string> *str_set,
                                              ProtoOutputStream* protoOutput) {
-    if (mProto->size() <= 0) {
+    // The spilled events come first, they're older.
+    string data;
+    if (mSpilledBytes > 0 && !StorageManager::readFileToString(mSpillFile.c_str(), &data)) {
+        ALOGE("metric %lld failed to read its spilled events", (long long)mMetricId);
+        data.clear();
+    }
+    deleteSpillFileLocked();
+    if (mProto->size() <= 0 && data.empty()) {
         return;
     }
     protoOutput->write(FIELD_TYPE_INT64 | FIELD_ID_ID, (long long)mMetricId);
 
     size_t bufferSize = mProto->size();
-    VLOG("metric %lld dump report now... proto size: %zu ",
-        (long long)mMetricId, bufferSize);
+    VLOG("metric %lld dump report now... proto size: %zu spilled: %zu",
+        (long long)mMetricId, bufferSize, data.size());
     std::unique_ptr<std::vector<uint8_t>> buffer = serializeProtoLocked(*mProto);
+    data.append(reinterpret_cast<char*>(buffer->data()), buffer->size());
 
-    protoOutput->write(FIELD_TYPE_MESSAGE | FIELD_ID_EVENT_METRICS,
-                       reinterpret_cast<char*>(buffer.get()->data()), buffer.get()->size());
+    protoOutput->write(FIELD_TYPE_MESSAGE | FIELD_ID_EVENT_METRICS, data.data(), data.size());
 
     mProto->clear();
 }
@@ -159,6 +197,10 @@ void EventMetricProducer::onMatchedLogEventInternalLocked(
     event.ToProto(*mProto);
     mProto->end(eventToken);
     mProto->end(wrapperToken);
+
+    if (mProto->bytesWritten() >= kSpillThresholdBytes) {
+        spillLocked();
+    }
 }
 
 size_t EventMetricProducer::byteSizeLocked() const {
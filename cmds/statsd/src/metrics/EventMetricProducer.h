@@ -20,6 +20,7 @@
 #include <unordered_map>
 
 #include <android/util/ProtoOutputStream.h>
+#include <gtest/gtest_prod.h>
 
 #include "../condition/ConditionTracker.h"
 #include "../matchers/matcher_util.h"
@@ -63,11 +64,33 @@ private:
     // Internal function to calculate the current used bytes.
     size_t byteSizeLocked() const override;
 
+    size_t spilledByteSizeLocked() const override {
+        return mSpilledBytes;
+    }
+
+    // Moves the events in mProto to the spill file, if it has room for them.
+    void spillLocked();
+
+    void deleteSpillFileLocked();
+
     void dumpStatesLocked(FILE* out, bool verbose) const override{};
 
     // Maps to a EventMetricDataWrapper. Storing atom events in ProtoOutputStream
     // is more space efficient than storing LogEvent.
     std::unique_ptr<android::util::ProtoOutputStream> mProto;
+
+    // The events that were moved out of mProto, older than the ones in it, in the same format.
+    // Appending EventMetricDataWrappers just adds their data to the first one.
+    const string mSpillFile;
+    size_t mSpilledBytes;
+
+    // The events are moved to the spill file once mProto holds this many bytes of them, which
+    // keeps a burst of them under the memory guardrail.
+    static const size_t kSpillThresholdBytes = 32 * 1024;
+    // Past this, events stay in memory and the guardrail applies as usual.
+    static const size_t kMaxSpilledBytes = 2 * 1024 * 1024;
+
+    FRIEND_TEST(EventMetricProducerTest, TestSpillToDisk);
 };
 
 }  // namespace statsd
@@ -22,6 +22,7 @@
 #include "../stats_log_util.h"
 
 #include <cutils/log.h>
+#include <algorithm>
 
 using android::util::FIELD_COUNT_REPEATED;
 using android::util::FIELD_TYPE_BOOL;
@@ -224,6 +225,8 @@ void GaugeMetricProducer::onDumpReportLocked(const int64_t dumpTimeNs,
     }
     mSkippedBuckets.clear();
 
+    // Reused to trim the fields of each atom.
+    vector<FieldValue> gaugeFields;
     for (const auto& pair : mPastBuckets) {
         const MetricDimensionKey& dimensionKey = pair.first;
 
@@ -275,7 +278,12 @@ void GaugeMetricProducer::onDumpReportLocked(const int64_t dumpTimeNs,
                     uint64_t atomsToken =
                         protoOutput->start(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED |
                                            FIELD_ID_ATOM);
-                    writeFieldValueTreeToStream(mTagId, *(atom.mFields), protoOutput);
+                    if (mFieldMatchers.empty() || atom.mTrimmed) {
+                        writeFieldValueTreeToStream(mTagId, *(atom.mFields), protoOutput);
+                    } else {
+                        getGaugeFields(*(atom.mFields), &gaugeFields);
+                        writeFieldValueTreeToStream(mTagId, gaugeFields, protoOutput);
+                    }
                     protoOutput->end(atomsToken);
                 }
                 const bool truncateTimestamp =
@@ -370,16 +378,33 @@ void GaugeMetricProducer::onSlicedConditionMayChangeLocked(bool overallCondition
     }  // else: Push mode. No need to proactively pull the gauge data.
 }
 
-std::shared_ptr<vector<FieldValue>> GaugeMetricProducer::getGaugeFields(const LogEvent& event) {
+void GaugeMetricProducer::getGaugeFields(const vector<FieldValue>& fields,
+                                         vector<FieldValue>* gaugeFields) const {
     if (mFieldMatchers.size() > 0) {
-        std::shared_ptr<vector<FieldValue>> gaugeFields = std::make_shared<vector<FieldValue>>();
-        filterGaugeValues(mFieldMatchers, event.getValues(), gaugeFields.get());
-        return gaugeFields;
+        gaugeFields->clear();
+        filterGaugeValues(mFieldMatchers, fields, gaugeFields);
     } else {
-        return std::make_shared<vector<FieldValue>>(event.getValues());
+        *gaugeFields = fields;
     }
 }
 
+bool GaugeMetricProducer::getGaugeValueForAnomaly(const GaugeAtom& atom,
+                                                  int64_t* gaugeValue) const {
+    vector<FieldValue> gaugeFields;
+    getGaugeFields(*atom.mFields, &gaugeFields);
+    if (gaugeFields.size() != 1) {
+        return false;
+    }
+    const Value& value = gaugeFields.front().mValue;
+    *gaugeValue = 0;
+    if (value.getType() == INT) {
+        *gaugeValue = value.int_value;
+    } else if (value.getType() == LONG) {
+        *gaugeValue = value.long_value;
+    }
+    return true;
+}
+
 void GaugeMetricProducer::onDataPulled(const std::vector<std::shared_ptr<LogEvent>>& allData) {
     std::lock_guard<std::mutex> lock(mMutex);
     if (allData.size() == 0) {
@@ -437,19 +462,15 @@ void GaugeMetricProducer::onMatchedLogEventInternalLocked(
     if ((*mCurrentSlicedBucket)[eventKey].size() >= mGaugeAtomsPerDimensionLimit) {
         return;
     }
-    GaugeAtom gaugeAtom(getGaugeFields(event), eventTimeNs, getWallClockNs());
+    // The fields are shared with the other metrics sampling the same event, and trimmed to
+    // mFieldMatchers when they're read.
+    GaugeAtom gaugeAtom(event.getValuesSnapshot(), eventTimeNs, getWallClockNs());
     (*mCurrentSlicedBucket)[eventKey].push_back(gaugeAtom);
     // Anomaly detection on gauge metric only works when there is one numeric
     // field specified.
     if (mAnomalyTrackers.size() > 0) {
-        if (gaugeAtom.mFields->size() == 1) {
-            const Value& value = gaugeAtom.mFields->begin()->mValue;
-            long gaugeVal = 0;
-            if (value.getType() == INT) {
-                gaugeVal = (long)value.int_value;
-            } else if (value.getType() == LONG) {
-                gaugeVal = value.long_value;
-            }
+        int64_t gaugeVal;
+        if (getGaugeValueForAnomaly(gaugeAtom, &gaugeVal)) {
             for (auto& tracker : mAnomalyTrackers) {
                 tracker->detectAndDeclareAnomaly(eventTimeNs, mCurrentBucketNum, eventKey,
                                                  gaugeVal);
@@ -460,16 +481,10 @@ void GaugeMetricProducer::onMatchedLogEventInternalLocked(
 
 void GaugeMetricProducer::updateCurrentSlicedBucketForAnomaly() {
     for (const auto& slice : *mCurrentSlicedBucket) {
-        if (slice.second.empty()) {
+        int64_t gaugeVal;
+        if (slice.second.empty() || !getGaugeValueForAnomaly(slice.second.front(), &gaugeVal)) {
             continue;
         }
-        const Value& value = slice.second.front().mFields->front().mValue;
-        long gaugeVal = 0;
-        if (value.getType() == INT) {
-            gaugeVal = (long)value.int_value;
-        } else if (value.getType() == LONG) {
-            gaugeVal = value.long_value;
-        }
         (*mCurrentSlicedBucketForAnomaly)[slice.first] = gaugeVal;
     }
 }
@@ -540,6 +555,27 @@ void GaugeMetricProducer::flushCurrentBucketLocked(const int64_t& eventTimeNs) {
     }
 
     mCurrentSlicedBucket = std::make_shared<DimToGaugeAtomsMap>();
+    trimUnsharedFieldsLocked();
+}
+
+void GaugeMetricProducer::trimUnsharedFieldsLocked() {
+    if (mFieldMatchers.empty()) {
+        return;
+    }
+    for (auto& pair : mPastBuckets) {
+        for (auto& bucket : pair.second) {
+            for (auto& atom : bucket.mGaugeAtoms) {
+                // Nobody else can get a reference to fields only this atom holds.
+                if (atom.mTrimmed || atom.mFields == nullptr || atom.mFields.use_count() != 1) {
+                    continue;
+                }
+                auto trimmed = std::make_shared<vector<FieldValue>>();
+                getGaugeFields(*atom.mFields, trimmed.get());
+                atom.mFields = std::move(trimmed);
+                atom.mTrimmed = true;
+            }
+        }
+    }
 }
 
 size_t GaugeMetricProducer::byteSizeLocked() const {
@@ -548,6 +584,8 @@ size_t GaugeMetricProducer::byteSizeLocked() const {
         for (const auto& bucket : pair.second) {
             totalSize += bucket.mGaugeAtoms.size() * sizeof(GaugeAtom);
             for (const auto& atom : bucket.mGaugeAtoms) {
+                // Shared fields are counted in full by every metric keeping them alive, so that
+                // the guardrail holds whatever the other metrics drop.
                 if (atom.mFields != nullptr) {
                     totalSize += atom.mFields->size() * sizeof(FieldValue);
                 }
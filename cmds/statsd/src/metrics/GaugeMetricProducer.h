@@ -33,12 +33,18 @@ namespace os {
 namespace statsd {
 
 struct GaugeAtom {
-    GaugeAtom(std::shared_ptr<vector<FieldValue>> fields, int64_t elapsedTimeNs, int wallClockNs)
+    GaugeAtom(std::shared_ptr<const vector<FieldValue>> fields, int64_t elapsedTimeNs,
+              int wallClockNs)
         : mFields(fields), mElapsedTimestamps(elapsedTimeNs), mWallClockTimestampNs(wallClockNs) {
     }
-    std::shared_ptr<vector<FieldValue>> mFields;
+    // All the fields of the atom, shared with the other metrics that sampled the same event.
+    // Never modified, the gauge_fields_filter of the metric is applied when reading them. Once
+    // this atom is the only owner, they're replaced by the filtered fields, see mTrimmed.
+    std::shared_ptr<const vector<FieldValue>> mFields;
     int64_t mElapsedTimestamps;
     int64_t mWallClockTimestampNs;
+    // Whether mFields only holds the fields passing the gauge_fields_filter.
+    bool mTrimmed = false;
 };
 
 struct GaugeBucket {
@@ -152,8 +158,15 @@ private:
 
     GaugeMetric::SamplingType mSamplingType;
 
-    // apply a whitelist on the original input
-    std::shared_ptr<vector<FieldValue>> getGaugeFields(const LogEvent& event);
+    // Applies the whitelist to the fields of an atom.
+    void getGaugeFields(const vector<FieldValue>& fields, vector<FieldValue>* gaugeFields) const;
+
+    // Replaces the fields that no other metric or event shares with the filtered ones.
+    void trimUnsharedFieldsLocked();
+
+    // The value of the only gauge field of an atom, for anomaly detection. False if the atom
+    // has more than one gauge field.
+    bool getGaugeValueForAnomaly(const GaugeAtom& atom, int64_t* gaugeValue) const;
 
     // Util function to check whether the specified dimension hits the guardrail.
     bool hitGuardRailLocked(const MetricDimensionKey& newKey);
@@ -172,6 +185,7 @@ private:
     FRIEND_TEST(GaugeMetricProducerTest, TestPushedEventsWithUpgrade);
     FRIEND_TEST(GaugeMetricProducerTest, TestPulledWithUpgrade);
     FRIEND_TEST(GaugeMetricProducerTest, TestAnomalyDetection);
+    FRIEND_TEST(GaugeMetricProducerTest, TestPulledAtomsShareFields);
 };
 
 }  // namespace statsd
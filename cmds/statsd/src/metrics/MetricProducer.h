@@ -111,6 +111,13 @@ public:
         return mConditionSliced;
     };
 
+    // Used when the condition trackers of the metric are replaced by the ones of a previous
+    // config, see MetricsManager::inheritMetrics.
+    void setConditionWizard(const sp<ConditionWizard>& wizard) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mWizard = wizard;
+    }
+
     // Output the metrics data to [protoOutput]. All metrics reports end with the same timestamp.
     // This method clears all the past buckets.
     void onDumpReport(const int64_t dumpTimeNs,
@@ -138,6 +145,13 @@ public:
         return byteSizeLocked();
     }
 
+    // Returns the bytes of this metric's data that were moved to disk to save memory. Does not
+    // change state.
+    size_t spilledByteSize() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return spilledByteSizeLocked();
+    }
+
     /* If alert is valid, adds an AnomalyTracker and returns it. If invalid, returns nullptr. */
     virtual sp<AnomalyTracker> addAnomalyTracker(const Alert &alert,
                                                  const sp<AlarmMonitor>& anomalyAlarmMonitor) {
@@ -187,6 +201,9 @@ protected:
                                     android::util::ProtoOutputStream* protoOutput) = 0;
     virtual void clearPastBucketsLocked(const int64_t dumpTimeNs) = 0;
     virtual size_t byteSizeLocked() const = 0;
+    virtual size_t spilledByteSizeLocked() const {
+        return 0;
+    }
     virtual void dumpStatesLocked(FILE* out, bool verbose) const = 0;
 
     /**
@@ -74,6 +74,9 @@ MetricsManager::MetricsManager(const ConfigKey& key, const StatsdConfig& config,
                              mAllPeriodicAlarmTrackers, mConditionToMetricMap, mTrackerToMetricMap,
                              mTrackerToConditionMap, mNoReportMetricIds);
 
+    initTagIdToMatcherIndices();
+    initDefinitionHashes(config);
+
     mHashStringsInReport = config.hash_strings_in_metric_report();
 
     if (config.allowed_log_source_size() == 0) {
@@ -124,6 +127,117 @@ MetricsManager::~MetricsManager() {
     VLOG("~MetricsManager()");
 }
 
+template <typename Metric>
+static void addMetricDefinitionHashes(
+        const google::protobuf::RepeatedPtrField<Metric>& metrics, const char* metricType,
+        const set<int64_t>& alertedMetricIds, unordered_map<int64_t, size_t>* hashes) {
+    for (const auto& metric : metrics) {
+        if (alertedMetricIds.find(metric.id()) == alertedMetricIds.end()) {
+            (*hashes)[metric.id()] = std::hash<string>()(metricType + metric.SerializeAsString());
+        }
+    }
+}
+
+void MetricsManager::initDefinitionHashes(const StatsdConfig& config) {
+    if (!mConfigValid) {
+        return;
+    }
+    string matchersAndPredicates;
+    for (const auto& matcher : config.atom_matcher()) {
+        matchersAndPredicates += matcher.SerializeAsString();
+    }
+    for (const auto& predicate : config.predicate()) {
+        matchersAndPredicates += predicate.SerializeAsString();
+    }
+    mMatchersAndPredicatesHash = std::hash<string>()(matchersAndPredicates);
+
+    set<int64_t> alertedMetricIds;
+    for (const auto& alert : config.alert()) {
+        alertedMetricIds.insert(alert.metric_id());
+    }
+    addMetricDefinitionHashes(config.count_metric(), "count", alertedMetricIds,
+                              &mMetricDefinitionHashes);
+    addMetricDefinitionHashes(config.duration_metric(), "duration", alertedMetricIds,
+                              &mMetricDefinitionHashes);
+    addMetricDefinitionHashes(config.event_metric(), "event", alertedMetricIds,
+                              &mMetricDefinitionHashes);
+    addMetricDefinitionHashes(config.value_metric(), "value", alertedMetricIds,
+                              &mMetricDefinitionHashes);
+    addMetricDefinitionHashes(config.gauge_metric(), "gauge", alertedMetricIds,
+                              &mMetricDefinitionHashes);
+}
+
+set<int64_t> MetricsManager::getUnchangedMetricIds(const MetricsManager& oldManager) const {
+    set<int64_t> metricIds;
+    if (!mConfigValid || !oldManager.mConfigValid ||
+        mMatchersAndPredicatesHash != oldManager.mMatchersAndPredicatesHash ||
+        mAllConditionTrackers.size() != oldManager.mAllConditionTrackers.size()) {
+        return metricIds;
+    }
+    // The condition trackers only keep the dimensions the sliced metrics need.
+    for (size_t i = 0; i < mAllConditionTrackers.size(); i++) {
+        if (mAllConditionTrackers[i]->isSliced() !=
+            oldManager.mAllConditionTrackers[i]->isSliced()) {
+            return metricIds;
+        }
+    }
+    for (const auto& pair : mMetricDefinitionHashes) {
+        auto it = oldManager.mMetricDefinitionHashes.find(pair.first);
+        if (it != oldManager.mMetricDefinitionHashes.end() && it->second == pair.second) {
+            metricIds.insert(pair.first);
+        }
+    }
+    return metricIds;
+}
+
+void MetricsManager::setMetricsKeptByUpdate(const set<int64_t>& metricIds) {
+    // Read by onDumpReport(), which runs under the report mutex only.
+    std::lock_guard<std::mutex> reportLock(mReportMutex);
+    mMetricsKeptByUpdate = metricIds;
+}
+
+void MetricsManager::inheritMetrics(const MetricsManager& oldManager,
+                                    const set<int64_t>& metricIds, const int64_t timestampNs) {
+    if (metricIds.empty()) {
+        return;
+    }
+    // The kept metrics query the old condition trackers, which know the current conditions. The
+    // new metrics have to use them as well.
+    mAllConditionTrackers = oldManager.mAllConditionTrackers;
+    sp<ConditionWizard> wizard = new ConditionWizard(mAllConditionTrackers);
+
+    unordered_map<int64_t, sp<MetricProducer>> keptProducers;
+    for (const auto& producer : oldManager.mAllMetricProducers) {
+        if (metricIds.find(producer->getMetricId()) != metricIds.end()) {
+            keptProducers[producer->getMetricId()] = producer;
+        }
+    }
+    for (auto& producer : mAllMetricProducers) {
+        auto it = keptProducers.find(producer->getMetricId());
+        if (it != keptProducers.end()) {
+            producer = it->second;
+        } else {
+            producer->setConditionWizard(wizard);
+        }
+    }
+
+    // Otherwise the new metrics would wait for their condition to change to become true.
+    for (const auto& pair : mConditionToMetricMap) {
+        if (mAllConditionTrackers[pair.first]->isConditionMet() != ConditionState::kTrue) {
+            continue;
+        }
+        for (int metricIndex : pair.second) {
+            const sp<MetricProducer>& producer = mAllMetricProducers[metricIndex];
+            if (metricIds.find(producer->getMetricId()) == metricIds.end() &&
+                !producer->isConditionSliced()) {
+                producer->onConditionChanged(true, timestampNs);
+            }
+        }
+    }
+    VLOG("Config %s kept %lu metrics", mConfigKey.ToString().c_str(),
+         (unsigned long)metricIds.size());
+}
+
 void MetricsManager::initLogSourceWhiteList() {
     std::lock_guard<std::mutex> lock(mAllowedLogSourcesMutex);
     mAllowedLogSources.clear();
@@ -203,11 +317,16 @@ void MetricsManager::onDumpReport(const int64_t dumpTimeStampNs,
         if (mNoReportMetricIds.find(producer->getMetricId()) == mNoReportMetricIds.end()) {
             uint64_t token = protoOutput->start(
                     FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_METRICS);
+            // The current bucket of a metric kept by a config update is reported later.
+            const bool includeCurrentBucket =
+                    include_current_partial_bucket &&
+                    mMetricsKeptByUpdate.find(producer->getMetricId()) ==
+                            mMetricsKeptByUpdate.end();
             if (mHashStringsInReport) {
-                producer->onDumpReport(dumpTimeStampNs, include_current_partial_bucket, str_set,
+                producer->onDumpReport(dumpTimeStampNs, includeCurrentBucket, str_set,
                                        protoOutput);
             } else {
-                producer->onDumpReport(dumpTimeStampNs, include_current_partial_bucket, nullptr,
+                producer->onDumpReport(dumpTimeStampNs, includeCurrentBucket, nullptr,
                                        protoOutput);
             }
             protoOutput->end(token);
@@ -304,19 +423,41 @@ void MetricsManager::onLogEvent(const LogEvent& event) {
         return;
     }
 
+    const auto matchersIt = mTagIdToMatcherIndices.find(tagId);
+    if (matchersIt == mTagIdToMatcherIndices.end()) {
+        return;
+    }
+    // The other matchers don't care about this tag id, and stay kNotComputed.
+    const vector<int>& matcherIndices = matchersIt->second;
+
+    // Only one event in the sample rate is timed, and the others only pay for the check.
+    const int sampleRate = StatsdStats::getInstance().getProfilingSampleRate();
+    const bool profiled = sampleRate > 0 && ++mProfilingEventCount % sampleRate == 0;
+    int64_t startNs = 0;
+
     vector<MatchingState> matcherCache(mAllAtomMatchers.size(), MatchingState::kNotComputed);
 
-    for (auto& matcher : mAllAtomMatchers) {
-        matcher->onLogEvent(event, mAllAtomMatchers, matcherCache);
+    for (const int i : matcherIndices) {
+        if (profiled) {
+            startNs = getElapsedRealtimeNs();
+        }
+        mAllAtomMatchers[i]->onLogEvent(event, mAllAtomMatchers, matcherCache);
+        if (profiled) {
+            StatsdStats::getInstance().noteMatcherProcessingTime(
+                    mConfigKey, mAllAtomMatchers[i]->getId(), getElapsedRealtimeNs() - startNs);
+        }
     }
 
     // A bitmap to see which ConditionTracker needs to be re-evaluated.
     vector<bool> conditionToBeEvaluated(mAllConditionTrackers.size(), false);
 
-    for (const auto& pair : mTrackerToConditionMap) {
-        if (matcherCache[pair.first] == MatchingState::kMatched) {
-            const auto& conditionList = pair.second;
-            for (const int conditionIndex : conditionList) {
+    for (const int i : matcherIndices) {
+        if (matcherCache[i] != MatchingState::kMatched) {
+            continue;
+        }
+        auto pair = mTrackerToConditionMap.find(i);
+        if (pair != mTrackerToConditionMap.end()) {
+            for (const int conditionIndex : pair->second) {
                 conditionToBeEvaluated[conditionIndex] = true;
             }
         }
@@ -331,8 +472,15 @@ void MetricsManager::onLogEvent(const LogEvent& event) {
             continue;
         }
         sp<ConditionTracker>& condition = mAllConditionTrackers[i];
+        if (profiled) {
+            startNs = getElapsedRealtimeNs();
+        }
         condition->evaluateCondition(event, matcherCache, mAllConditionTrackers, conditionCache,
                                      changedCache);
+        if (profiled) {
+            StatsdStats::getInstance().noteConditionProcessingTime(
+                    mConfigKey, condition->getId(), getElapsedRealtimeNs() - startNs);
+        }
     }
 
     for (size_t i = 0; i < mAllConditionTrackers.size(); i++) {
@@ -343,6 +491,9 @@ void MetricsManager::onLogEvent(const LogEvent& event) {
         if (pair != mConditionToMetricMap.end()) {
             auto& metricList = pair->second;
             for (auto metricIndex : metricList) {
+                if (profiled) {
+                    startNs = getElapsedRealtimeNs();
+                }
                 // metric cares about non sliced condition, and it's changed.
                 // Push the new condition to it directly.
                 if (!mAllMetricProducers[metricIndex]->isConditionSliced()) {
@@ -355,12 +506,17 @@ void MetricsManager::onLogEvent(const LogEvent& event) {
                     mAllMetricProducers[metricIndex]->onSlicedConditionMayChange(conditionCache[i],
                                                                                  eventTime);
                 }
+                if (profiled) {
+                    StatsdStats::getInstance().noteMetricProcessingTime(
+                            mConfigKey, mAllMetricProducers[metricIndex]->getMetricId(),
+                            getElapsedRealtimeNs() - startNs);
+                }
             }
         }
     }
 
     // For matched AtomMatchers, tell relevant metrics that a matched event has come.
-    for (size_t i = 0; i < mAllAtomMatchers.size(); i++) {
+    for (const int i : matcherIndices) {
         if (matcherCache[i] == MatchingState::kMatched) {
             StatsdStats::getInstance().noteMatcherMatched(mConfigKey,
                                                           mAllAtomMatchers[i]->getId());
@@ -368,14 +524,31 @@ void MetricsManager::onLogEvent(const LogEvent& event) {
             if (pair != mTrackerToMetricMap.end()) {
                 auto& metricList = pair->second;
                 for (const int metricIndex : metricList) {
+                    if (profiled) {
+                        startNs = getElapsedRealtimeNs();
+                    }
                     // pushed metrics are never scheduled pulls
                     mAllMetricProducers[metricIndex]->onMatchedLogEvent(i, event);
+                    if (profiled) {
+                        StatsdStats::getInstance().noteMetricProcessingTime(
+                                mConfigKey, mAllMetricProducers[metricIndex]->getMetricId(),
+                                getElapsedRealtimeNs() - startNs);
+                    }
                 }
             }
         }
     }
 }
 
+void MetricsManager::initTagIdToMatcherIndices() {
+    mTagIdToMatcherIndices.clear();
+    for (size_t i = 0; i < mAllAtomMatchers.size(); i++) {
+        for (const int atomId : mAllAtomMatchers[i]->getAtomIds()) {
+            mTagIdToMatcherIndices[atomId].push_back(i);
+        }
+    }
+}
+
 void MetricsManager::onAnomalyAlarmFired(
         const int64_t& timestampNs,
         unordered_set<sp<const InternalAlarm>, SpHash<InternalAlarm>>& alarmSet) {
@@ -401,6 +574,14 @@ size_t MetricsManager::byteSize() {
     return totalSize;
 }
 
+size_t MetricsManager::spilledByteSize() {
+    size_t totalSize = 0;
+    for (auto metricProducer : mAllMetricProducers) {
+        totalSize += metricProducer->spilledByteSize();
+    }
+    return totalSize;
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
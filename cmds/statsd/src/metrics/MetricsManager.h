@@ -48,6 +48,11 @@ public:
 
     void onLogEvent(const LogEvent& event);
 
+    // Whether the config has a matcher on the atom, the other events are dropped by onLogEvent.
+    inline bool isInterestedInAtom(int tagId) const {
+        return mTagIds.find(tagId) != mTagIds.end();
+    }
+
     void onAnomalyAlarmFired(
         const int64_t& timestampNs,
         unordered_set<sp<const InternalAlarm>, SpHash<InternalAlarm>>& alarmSet);
@@ -89,6 +94,7 @@ public:
 
     // Returns the elapsed realtime when this metric manager last reported metrics. If this config
     // has not yet dumped any reports, this is the time the metricsmanager was initialized.
+    // Written by onDumpReport(), the report mutex must be held.
     inline int64_t getLastReportTimeNs() const {
         return mLastReportTimeNs;
     };
@@ -97,6 +103,12 @@ public:
         return mLastReportWallClockNs;
     };
 
+    // Serializes the reports of this config. Reports are written without StatsLogProcessor's lock,
+    // which is always taken first when both are held.
+    inline std::mutex& getReportMutex() const {
+        return mReportMutex;
+    }
+
     inline size_t getNumMetrics() const {
         return mAllMetricProducers.size();
     }
@@ -112,6 +124,23 @@ public:
     // Does not change the state.
     virtual size_t byteSize();
 
+    // Returns the bytes of data the metrics moved to disk, which byteSize() doesn't count.
+    size_t spilledByteSize();
+
+    // Returns the ids of the metrics of this new config that can keep their state from the
+    // metrics of oldManager. That needs the same matchers and predicates in both configs, and the
+    // same definition for the metric. Metrics with alerts are always rebuilt.
+    std::set<int64_t> getUnchangedMetricIds(const MetricsManager& oldManager) const;
+
+    // Makes the next reports of this old config leave the current bucket of the metrics kept by
+    // the new one alone, so that the bucket goes on in the new config.
+    void setMetricsKeptByUpdate(const std::set<int64_t>& metricIds);
+
+    // Replaces the producers of metricIds with those of oldManager, along with the condition
+    // trackers they depend on. Called once oldManager has written its data.
+    void inheritMetrics(const MetricsManager& oldManager, const std::set<int64_t>& metricIds,
+                        const int64_t timestampNs);
+
 private:
     // For test only.
     inline int64_t getTtlEndNs() const { return mTtlEndNs; }
@@ -146,6 +175,9 @@ private:
     // To guard access to mAllowedLogSources
     mutable std::mutex mAllowedLogSourcesMutex;
 
+    // Held while a report is written, see getReportMutex().
+    mutable std::mutex mReportMutex;
+
     // All event tags that are interesting to my metrics.
     std::set<int> mTagIds;
 
@@ -176,7 +208,8 @@ private:
 
     // 1st filter: check if the event tag id is in mTagIds.
     // 2nd filter: if it is, we parse the event because there is at least one member is interested.
-    //             then pass to all LogMatchingTrackers (itself also filter events by ids).
+    //             then pass to the LogMatchingTrackers interested in the tag id, found in
+    //             mTagIdToMatcherIndices.
     // 3nd filter: for LogMatchingTrackers that matched this event, we pass this event to the
     //             ConditionTrackers and MetricProducers that use this matcher.
     // 4th filter: for ConditionTrackers that changed value due to this event, we pass
@@ -193,11 +226,32 @@ private:
     // maps from ConditionTracker to MetricProducer
     std::unordered_map<int, std::vector<int>> mConditionToMetricMap;
 
+    // maps from the atom tag id to the indices of the LogMatchingTrackers that care about it,
+    // in increasing order. Built from the trackers' atom ids once they are initialized.
+    std::unordered_map<int, std::vector<int>> mTagIdToMatcherIndices;
+
+    void initTagIdToMatcherIndices();
+
+    // The number of events that got to the matchers, to pick the ones to profile.
+    uint64_t mProfilingEventCount = 0;
+
     void initLogSourceWhiteList();
 
     // The metrics that don't need to be uploaded or even reported.
     std::set<int64_t> mNoReportMetricIds;
 
+    void initDefinitionHashes(const StatsdConfig& config);
+
+    // The hash of all the matchers and predicates of the config, in order.
+    size_t mMatchersAndPredicatesHash = 0;
+
+    // The hash of the definition of each metric without alerts, by metric id.
+    std::unordered_map<int64_t, size_t> mMetricDefinitionHashes;
+
+    // The metrics whose current bucket goes on in the config that replaces this one.
+    std::set<int64_t> mMetricsKeptByUpdate;
+
+    FRIEND_TEST(StatsLogProcessorTest, TestConfigUpdateKeepsUnchangedMetrics);
     FRIEND_TEST(WakelockDurationE2eTest, TestAggregatedPredicateDimensions);
     FRIEND_TEST(MetricConditionLinkE2eTest, TestMultiplePredicatesAndLinks);
     FRIEND_TEST(AttributionE2eTest, TestAttributionMatchAndSliceByFirstUid);
@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "HashableDimensionKey.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+/**
+ * The past buckets of a metric with one int64 value per dimension and bucket, stored by column.
+ *
+ * The boundaries of a bucket are stored once for all the dimensions that have a value in it,
+ * and each dimension only keeps the indexes of its buckets and its values. That's 12 bytes per
+ * dimension and bucket instead of a whole Bucket of 24.
+ *
+ * Reading it looks like reading an unordered_map<MetricDimensionKey, vector<Bucket>>, the
+ * Bucket structs are built when they're read. Bucket needs mBucketStartNs, mBucketEndNs and the
+ * member holding the value, ValueField.
+ */
+template <typename Bucket, int64_t Bucket::*ValueField>
+class PastBuckets {
+private:
+    struct Column {
+        std::vector<uint32_t> bucketIndexes;
+        std::vector<int64_t> values;
+    };
+
+public:
+    // The buckets of one dimension, in the order they were added.
+    class Buckets {
+    public:
+        class const_iterator {
+        public:
+            const_iterator(const Buckets* buckets, size_t index)
+                : mBuckets(buckets), mIndex(index) {
+            }
+
+            Bucket operator*() const {
+                return (*mBuckets)[mIndex];
+            }
+
+            const_iterator& operator++() {
+                mIndex++;
+                return *this;
+            }
+
+            bool operator!=(const const_iterator& other) const {
+                return mIndex != other.mIndex;
+            }
+
+        private:
+            const Buckets* mBuckets;
+            size_t mIndex;
+        };
+
+        Buckets(const std::vector<std::pair<int64_t, int64_t>>* boundaries, const Column* column)
+            : mBoundaries(boundaries), mColumn(column) {
+        }
+
+        size_t size() const {
+            return mColumn->values.size();
+        }
+
+        bool empty() const {
+            return mColumn->values.empty();
+        }
+
+        Bucket operator[](size_t i) const {
+            Bucket bucket;
+            const auto& boundary = (*mBoundaries)[mColumn->bucketIndexes[i]];
+            bucket.mBucketStartNs = boundary.first;
+            bucket.mBucketEndNs = boundary.second;
+            bucket.*ValueField = mColumn->values[i];
+            return bucket;
+        }
+
+        Bucket back() const {
+            return (*this)[size() - 1];
+        }
+
+        const_iterator begin() const {
+            return const_iterator(this, 0);
+        }
+
+        const_iterator end() const {
+            return const_iterator(this, size());
+        }
+
+    private:
+        const std::vector<std::pair<int64_t, int64_t>>* mBoundaries;
+        const Column* mColumn;
+    };
+
+    struct Entry {
+        const MetricDimensionKey& first;
+        Buckets second;
+    };
+
+    class const_iterator {
+    public:
+        // Lets it->second work while the entries are only built on the fly.
+        struct Arrow {
+            Entry entry;
+            const Entry* operator->() const {
+                return &entry;
+            }
+        };
+
+        const_iterator(const PastBuckets* store,
+                       typename std::unordered_map<MetricDimensionKey, Column>::const_iterator it)
+            : mStore(store), mIt(it) {
+        }
+
+        Entry operator*() const {
+            return Entry{mIt->first, Buckets(&mStore->mBoundaries, &mIt->second)};
+        }
+
+        Arrow operator->() const {
+            return Arrow{**this};
+        }
+
+        const_iterator& operator++() {
+            ++mIt;
+            return *this;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return mIt == other.mIt;
+        }
+
+        bool operator!=(const const_iterator& other) const {
+            return mIt != other.mIt;
+        }
+
+    private:
+        const PastBuckets* mStore;
+        typename std::unordered_map<MetricDimensionKey, Column>::const_iterator mIt;
+    };
+
+    // Adds the value of key in the bucket [startNs, endNs). The buckets must be added in order.
+    void add(const MetricDimensionKey& key, int64_t startNs, int64_t endNs, int64_t value) {
+        if (mBoundaries.empty() || mBoundaries.back().first != startNs ||
+            mBoundaries.back().second != endNs) {
+            mBoundaries.emplace_back(startNs, endNs);
+        }
+        Column& column = mColumns[key];
+        column.bucketIndexes.push_back(mBoundaries.size() - 1);
+        column.values.push_back(value);
+        mValueCount++;
+    }
+
+    // The number of dimensions.
+    size_t size() const {
+        return mColumns.size();
+    }
+
+    bool empty() const {
+        return mColumns.empty();
+    }
+
+    void clear() {
+        mBoundaries.clear();
+        mColumns.clear();
+        mValueCount = 0;
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this, mColumns.begin());
+    }
+
+    const_iterator end() const {
+        return const_iterator(this, mColumns.end());
+    }
+
+    const_iterator find(const MetricDimensionKey& key) const {
+        return const_iterator(this, mColumns.find(key));
+    }
+
+    // Unlike a map, doesn't add the key, the buckets are empty if the key has none.
+    Buckets operator[](const MetricDimensionKey& key) const {
+        static const Column kEmptyColumn;
+        auto it = mColumns.find(key);
+        return Buckets(&mBoundaries, it == mColumns.end() ? &kEmptyColumn : &it->second);
+    }
+
+    // An estimate of the memory used by the buckets, excluding the dimension keys.
+    size_t byteSize() const {
+        return mBoundaries.size() * sizeof(mBoundaries[0]) +
+               mValueCount * (sizeof(uint32_t) + sizeof(int64_t));
+    }
+
+private:
+    // The [start, end) of every bucket that has a value, shared by all the dimensions.
+    std::vector<std::pair<int64_t, int64_t>> mBoundaries;
+
+    std::unordered_map<MetricDimensionKey, Column> mColumns;
+
+    // The number of values in all the columns.
+    size_t mValueCount = 0;
+};
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
@@ -24,6 +24,7 @@
 #include <cutils/log.h>
 #include <limits.h>
 #include <stdlib.h>
+#include <algorithm>
 
 using android::util::FIELD_COUNT_REPEATED;
 using android::util::FIELD_TYPE_BOOL;
@@ -308,6 +309,16 @@ void ValueMetricProducer::onDataPulled(const std::vector<std::shared_ptr<LogEven
         int64_t eventTime = mTimeBaseNs +
             ((realEventTime - mTimeBaseNs) / mBucketSizeNs) * mBucketSizeNs;
 
+        vector<PulledValue> values;
+        if (readPulledValuesLocked(allData, &values)) {
+            mCondition = false;
+            aggregatePulledValuesLocked(values, eventTime - 1);
+
+            mCondition = true;
+            aggregatePulledValuesLocked(values, eventTime);
+            return;
+        }
+
         mCondition = false;
         for (const auto& data : allData) {
             data->setElapsedTimestampNs(eventTime - 1);
@@ -322,6 +333,52 @@ void ValueMetricProducer::onDataPulled(const std::vector<std::shared_ptr<LogEven
     }
 }
 
+bool ValueMetricProducer::readPulledValuesLocked(const vector<shared_ptr<LogEvent>>& allData,
+                                                 vector<PulledValue>* values) {
+    if (mConditionSliced) {
+        return false;
+    }
+    // Without a sliced condition, every event is in the default condition dimension.
+    values->reserve(allData.size());
+    for (const auto& data : allData) {
+        int error = 0;
+        const int64_t value = data->GetLong(mField, &error);
+        if (error < 0) {
+            continue;
+        }
+        HashableDimensionKey dimensionInWhat;
+        filterValues(mDimensionsInWhat, data->getValues(), &dimensionInWhat);
+        values->emplace_back(MetricDimensionKey(dimensionInWhat, DEFAULT_DIMENSION_KEY), value);
+    }
+    return true;
+}
+
+void ValueMetricProducer::aggregatePulledValuesLocked(const vector<PulledValue>& values,
+                                                      const int64_t eventTimeNs) {
+    if (eventTimeNs < mTimeBaseNs || eventTimeNs < mCurrentBucketStartTimeNs) {
+        VLOG("Skip pulled data due to late arrival: %lld vs %lld", (long long)eventTimeNs,
+             (long long)mCurrentBucketStartTimeNs);
+        return;
+    }
+
+    flushIfNeededLocked(eventTimeNs);
+
+    // A new bucket is usually empty here, make room for all the dimensions at once.
+    if (mCurrentSlicedBucket.empty()) {
+        mCurrentSlicedBucket.reserve(std::min(values.size(), mDimensionHardLimit + 1));
+    }
+    for (const auto& pulledValue : values) {
+        auto it = mCurrentSlicedBucket.find(pulledValue.first);
+        if (it == mCurrentSlicedBucket.end()) {
+            if (hitGuardRailLocked(pulledValue.first)) {
+                continue;
+            }
+            it = mCurrentSlicedBucket.emplace(pulledValue.first, Interval()).first;
+        }
+        addValueLocked(it->first, &it->second, pulledValue.second, eventTimeNs);
+    }
+}
+
 void ValueMetricProducer::dumpStatesLocked(FILE* out, bool verbose) const {
     if (mCurrentSlicedBucket.size() == 0) {
         return;
@@ -383,51 +440,59 @@ void ValueMetricProducer::onMatchedLogEventInternalLocked(
         return;
     }
 
+    addValueLocked(eventKey, &interval, value, eventTimeNs);
+}
+
+void ValueMetricProducer::addValueLocked(const MetricDimensionKey& key, Interval* interval,
+                                         const int64_t value, const int64_t eventTimeNs) {
     if (mPullTagId != -1) { // for pulled events
         if (mCondition == true) {
-            if (!interval.startUpdated) {
-                interval.start = value;
-                interval.startUpdated = true;
+            if (!interval->startUpdated) {
+                interval->start = value;
+                interval->startUpdated = true;
             } else {
                 // skip it if there is already value recorded for the start
-                VLOG("Already recorded value for this dimension %s", eventKey.toString().c_str());
+                VLOG("Already recorded value for this dimension %s", key.toString().c_str());
             }
         } else {
             // Generally we expect value to be monotonically increasing.
             // If not, take absolute value or drop it, based on config.
-            if (interval.startUpdated) {
-                if (value >= interval.start) {
-                    interval.sum += (value - interval.start);
-                    interval.hasValue = true;
+            if (interval->startUpdated) {
+                if (value >= interval->start) {
+                    interval->sum += (value - interval->start);
+                    interval->hasValue = true;
                 } else {
                     if (mUseAbsoluteValueOnReset) {
-                        interval.sum += value;
-                        interval.hasValue = true;
+                        interval->sum += value;
+                        interval->hasValue = true;
                     } else {
                         VLOG("Dropping data for atom %d, prev: %lld, now: %lld", mPullTagId,
-                             (long long)interval.start, (long long)value);
+                             (long long)interval->start, (long long)value);
                     }
                 }
-                interval.startUpdated = false;
+                interval->startUpdated = false;
             } else {
                 VLOG("No start for matching end %lld", (long long)value);
-                interval.tainted += 1;
+                interval->tainted += 1;
             }
         }
     } else {    // for pushed events, only accumulate when condition is true
         if (mCondition == true || mConditionTrackerIndex < 0) {
-            interval.sum += value;
-            interval.hasValue = true;
+            interval->sum += value;
+            interval->hasValue = true;
         }
     }
 
-    long wholeBucketVal = interval.sum;
-    auto prev = mCurrentFullBucket.find(eventKey);
+    if (mAnomalyTrackers.empty()) {
+        return;
+    }
+    long wholeBucketVal = interval->sum;
+    auto prev = mCurrentFullBucket.find(key);
     if (prev != mCurrentFullBucket.end()) {
         wholeBucketVal += prev->second;
     }
     for (auto& tracker : mAnomalyTrackers) {
-        tracker->detectAndDeclareAnomaly(eventTimeNs, mCurrentBucketNum, eventKey, wholeBucketVal);
+        tracker->detectAndDeclareAnomaly(eventTimeNs, mCurrentBucketNum, key, wholeBucketVal);
     }
 }
 
@@ -473,10 +538,8 @@ void ValueMetricProducer::flushCurrentBucketLocked(const int64_t& eventTimeNs) {
             tainted += slice.second.tainted;
             tainted += slice.second.startUpdated;
             if (slice.second.hasValue) {
-                info.mValue = slice.second.sum;
-                // it will auto create new vector of ValuebucketInfo if the key is not found.
-                auto& bucketList = mPastBuckets[slice.first];
-                bucketList.push_back(info);
+                mPastBuckets.add(slice.first, info.mBucketStartNs, info.mBucketEndNs,
+                                 slice.second.sum);
             }
         }
         VLOG("%d tainted pairs in the bucket", tainted);
@@ -520,11 +583,7 @@ void ValueMetricProducer::flushCurrentBucketLocked(const int64_t& eventTimeNs) {
 }
 
 size_t ValueMetricProducer::byteSizeLocked() const {
-    size_t totalSize = 0;
-    for (const auto& pair : mPastBuckets) {
-        totalSize += pair.second.size() * kBucketSize;
-    }
-    return totalSize;
+    return mPastBuckets.byteSize();
 }
 
 }  // namespace statsd
@@ -24,6 +24,7 @@
 #include "../external/PullDataReceiver.h"
 #include "../external/StatsPullerManager.h"
 #include "MetricProducer.h"
+#include "PastBuckets.h"
 #include "frameworks/base/cmds/statsd/src/statsd_config.pb.h"
 
 namespace android {
@@ -146,11 +147,28 @@ private:
 
     std::unordered_map<MetricDimensionKey, Interval> mCurrentSlicedBucket;
 
+    // The dimension and value of a pulled event.
+    typedef std::pair<MetricDimensionKey, int64_t> PulledValue;
+
+    // Reads the dimension and value of each pulled event once, for both ends of a pull. Returns
+    // false if the condition is sliced, the events then go through onMatchedLogEventLocked.
+    bool readPulledValuesLocked(const std::vector<std::shared_ptr<LogEvent>>& allData,
+                                std::vector<PulledValue>* values);
+
+    // Adds the values of a pull at eventTimeNs in a single pass over the current intervals, as
+    // their start when the condition is true and as their end otherwise.
+    void aggregatePulledValuesLocked(const std::vector<PulledValue>& values,
+                                     const int64_t eventTimeNs);
+
+    // Adds a value of key to its interval and gives the bucket so far to the anomaly trackers.
+    void addValueLocked(const MetricDimensionKey& key, Interval* interval, const int64_t value,
+                        const int64_t eventTimeNs);
+
     std::unordered_map<MetricDimensionKey, int64_t> mCurrentFullBucket;
 
     // Save the past buckets and we can clear when the StatsLogReport is dumped.
     // TODO: Add a lock to mPastBuckets.
-    std::unordered_map<MetricDimensionKey, std::vector<ValueBucket>> mPastBuckets;
+    PastBuckets<ValueBucket, &ValueBucket::mValue> mPastBuckets;
 
     // Pairs of (elapsed start, elapsed end) denoting buckets that were skipped.
     std::list<std::pair<int64_t, int64_t>> mSkippedBuckets;
@@ -160,8 +178,6 @@ private:
     // Util function to check whether the specified dimension hits the guardrail.
     bool hitGuardRailLocked(const MetricDimensionKey& newKey);
 
-    static const size_t kBucketSize = sizeof(ValueBucket{});
-
     const size_t mDimensionSoftLimit;
 
     const size_t mDimensionHardLimit;
@@ -171,6 +187,7 @@ private:
     FRIEND_TEST(ValueMetricProducerTest, TestNonDimensionalEvents);
     FRIEND_TEST(ValueMetricProducerTest, TestPulledEventsTakeAbsoluteValueOnReset);
     FRIEND_TEST(ValueMetricProducerTest, TestPulledEventsTakeZeroOnReset);
+    FRIEND_TEST(ValueMetricProducerTest, TestPulledEventsWithDimensions);
     FRIEND_TEST(ValueMetricProducerTest, TestEventsWithNonSlicedCondition);
     FRIEND_TEST(ValueMetricProducerTest, TestPushedEventsWithUpgrade);
     FRIEND_TEST(ValueMetricProducerTest, TestPulledValueWithUpgrade);
@@ -84,15 +84,42 @@ std::set<string> UidMap::getAppNamesFromUid(const int32_t& uid, bool returnNorma
 }
 
 std::set<string> UidMap::getAppNamesFromUidLocked(const int32_t& uid, bool returnNormalized) const {
+    auto it = mUidToPackages.find(uid);
+    if (it == mUidToPackages.end()) {
+        return std::set<string>();
+    }
+    if (!returnNormalized) {
+        return it->second;
+    }
     std::set<string> names;
-    for (const auto& kv : mMap) {
-        if (kv.first.first == uid && !kv.second.deleted) {
-            names.insert(returnNormalized ? normalizeAppName(kv.first.second) : kv.first.second);
-        }
+    for (const string& name : it->second) {
+        names.insert(normalizeAppName(name));
     }
     return names;
 }
 
+void UidMap::addToIndexesLocked(int uid, const string& package) {
+    mUidToPackages[uid].insert(package);
+    mPackageToUids[package].insert(uid);
+}
+
+void UidMap::removeFromIndexesLocked(int uid, const string& package) {
+    auto uidIt = mUidToPackages.find(uid);
+    if (uidIt != mUidToPackages.end()) {
+        uidIt->second.erase(package);
+        if (uidIt->second.empty()) {
+            mUidToPackages.erase(uidIt);
+        }
+    }
+    auto packageIt = mPackageToUids.find(package);
+    if (packageIt != mPackageToUids.end()) {
+        packageIt->second.erase(uid);
+        if (packageIt->second.empty()) {
+            mPackageToUids.erase(packageIt);
+        }
+    }
+}
+
 int64_t UidMap::getAppVersion(int uid, const string& packageName) const {
     lock_guard<mutex> lock(mMutex);
 
@@ -132,6 +159,14 @@ void UidMap::updateMap(const int64_t& timestamp, const vector<int32_t>& uid,
             }
         }
 
+        mUidToPackages.clear();
+        mPackageToUids.clear();
+        for (const auto& kv : mMap) {
+            if (!kv.second.deleted) {
+                addToIndexesLocked(kv.first.first, kv.first.second);
+            }
+        }
+
         ensureBytesUsedBelowLimit();
         StatsdStats::getInstance().setCurrentUidMapMemory(mBytesUsed);
         getListenerListCopyLocked(&broadcastList);
@@ -164,6 +199,7 @@ void UidMap::updateApp(const int64_t& timestamp, const String16& app_16, const i
             it->second.versionCode = versionCode;
             it->second.deleted = false;
         }
+        addToIndexesLocked(uid, appName);
         if (!found) {
             // Otherwise, we need to add an app at this uid.
             mMap[std::make_pair(uid, appName)] = AppData(versionCode);
@@ -232,12 +268,15 @@ void UidMap::removeApp(const int64_t& timestamp, const String16& app_16, const i
             prevVersion = it->second.versionCode;
             it->second.deleted = true;
             mDeletedApps.push_back(key);
+            removeFromIndexesLocked(uid, app);
         }
         if (mDeletedApps.size() > StatsdStats::kMaxDeletedAppsInUidMap) {
             // Delete the oldest one.
             auto oldest = mDeletedApps.front();
             mDeletedApps.pop_front();
             mMap.erase(oldest);
+            // In case it was installed again since.
+            removeFromIndexesLocked(oldest.first, oldest.second);
             StatsdStats::getInstance().noteUidMapAppDeletionDropped();
         }
         mChanges.emplace_back(true, timestamp, app, uid, 0, prevVersion);
@@ -408,13 +447,8 @@ void UidMap::OnConfigRemoved(const ConfigKey& key) {
 set<int32_t> UidMap::getAppUid(const string& package) const {
     lock_guard<mutex> lock(mMutex);
 
-    set<int32_t> results;
-    for (const auto& kv : mMap) {
-        if (kv.first.second == package && !kv.second.deleted) {
-            results.insert(kv.first.first);
-        }
-    }
-    return results;
+    auto it = mPackageToUids.find(package);
+    return it == mPackageToUids.end() ? set<int32_t>() : it->second;
 }
 
 // Note not all the following AIDs are used as uids. Some are used only for gids.
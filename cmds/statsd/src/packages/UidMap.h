@@ -146,19 +146,27 @@ private:
 
     void getListenerListCopyLocked(std::vector<wp<PackageInfoListener>>* output);
 
+    // Keep the indexes of the installed apps up to date.
+    void addToIndexesLocked(int uid, const string& package);
+    void removeFromIndexesLocked(int uid, const string& package);
+
     // TODO: Use shared_mutex for improved read-locking if a library can be found in Android.
     mutable mutex mMutex;
     mutable mutex mIsolatedMutex;
 
     struct PairHash {
-        size_t operator()(std::pair<int, string> p) const noexcept {
-            std::hash<std::string> hash_fn;
-            return hash_fn(std::to_string(p.first) + p.second);
+        size_t operator()(const std::pair<int, string>& p) const noexcept {
+            return std::hash<std::string>()(p.second) * 31 + std::hash<int>()(p.first);
         }
     };
     // Maps uid and package name to application data.
     std::unordered_map<std::pair<int, string>, AppData, PairHash> mMap;
 
+    // The apps of mMap that aren't deleted, by uid and by package name. Events are matched
+    // against app names for every uid field, which can't scan hundreds of packages each time.
+    std::unordered_map<int, std::set<string>> mUidToPackages;
+    std::unordered_map<string, std::set<int32_t>> mPackageToUids;
+
     // Maps isolated uid to the parent uid. Any metrics for an isolated uid will instead contribute
     // to the parent uid.
     std::unordered_map<int, int> mIsolatedUidMap;
@@ -199,6 +207,7 @@ private:
     FRIEND_TEST(UidMapTest, TestOutputIncludesAtLeastOneSnapshot);
     FRIEND_TEST(UidMapTest, TestMemoryComputed);
     FRIEND_TEST(UidMapTest, TestMemoryGuardrail);
+    FRIEND_TEST(UidMapTest, TestIndexesFollowMap);
 };
 
 }  // namespace statsd
@@ -26,6 +26,7 @@
 #include <sys/un.h>
 #include <unistd.h>
 
+#include <android/util/ScopeTimer.h>
 #include <cutils/sockets.h>
 #include <private/android_filesystem_config.h>
 #include <private/android_logger.h>
@@ -41,29 +42,47 @@ namespace statsd {
 
 static const int kLogMsgHeaderSize = 28;
 
+// Datagrams read per wakeup. Events are queued faster than they're processed during storms, such
+// as boot or app installs, and each wakeup and processor lock costs more than parsing an event.
+static const int kMaxBatchSize = 16;
+
+struct StatsSocketListener::Datagram {
+    // + 1 to ensure null terminator if MAX_PAYLOAD buffer is received
+    char buffer[sizeof_log_id_t + sizeof(uint16_t) + sizeof(log_time) + LOGGER_ENTRY_MAX_PAYLOAD +
+                1];
+    alignas(4) char control[CMSG_SPACE(sizeof(struct ucred))];
+    struct iovec iov;
+};
+
 StatsSocketListener::StatsSocketListener(const sp<LogListener>& listener)
-    : SocketListener(getLogSocket(), false /*start listen*/), mListener(listener) {
+    : SocketListener(getLogSocket(), false /*start listen*/),
+      mListener(listener),
+      mDatagrams(new Datagram[kMaxBatchSize]),
+      mHeaders(new struct mmsghdr[kMaxBatchSize]),
+      mEvents(kMaxBatchSize) {
+    mBatch.reserve(kMaxBatchSize);
 }
 
 StatsSocketListener::~StatsSocketListener() {
 }
 
 bool StatsSocketListener::onDataAvailable(SocketClient* cli) {
+    SCOPE_TIMER("statsd.SocketListener.onDataAvailable");
     static bool name_set;
     if (!name_set) {
         prctl(PR_SET_NAME, "statsd.writer");
         name_set = true;
     }
 
-    // + 1 to ensure null terminator if MAX_PAYLOAD buffer is received
-    char buffer[sizeof_log_id_t + sizeof(uint16_t) + sizeof(log_time) + LOGGER_ENTRY_MAX_PAYLOAD +
-                1];
-    struct iovec iov = {buffer, sizeof(buffer) - 1};
-
-    alignas(4) char control[CMSG_SPACE(sizeof(struct ucred))];
-    struct msghdr hdr = {
-            NULL, 0, &iov, 1, control, sizeof(control), 0,
-    };
+    for (int i = 0; i < kMaxBatchSize; i++) {
+        Datagram& datagram = mDatagrams[i];
+        datagram.iov = {datagram.buffer, sizeof(datagram.buffer) - 1};
+        // The kernel updates the control length, it has to be reset for every read.
+        mHeaders[i].msg_hdr = {
+                NULL, 0, &datagram.iov, 1, datagram.control, sizeof(datagram.control), 0,
+        };
+        mHeaders[i].msg_len = 0;
+    }
 
     int socket = cli->getSocket();
 
@@ -71,47 +90,66 @@ bool StatsSocketListener::onDataAvailable(SocketClient* cli) {
     // overhead under logging load. We are safe because we check counts, but
     // still need to clear null terminator
     // memset(buffer, 0, sizeof(buffer));
-    ssize_t n = recvmsg(socket, &hdr, 0);
-    if (n <= (ssize_t)(sizeof(android_log_header_t))) {
+    // The socket is readable, so this returns at least one datagram, and then whatever else is
+    // already queued without waiting for more.
+    int count = recvmmsg(socket, mHeaders.get(), kMaxBatchSize, MSG_DONTWAIT, NULL);
+    if (count <= 0) {
         return false;
     }
 
-    buffer[n] = 0;
-
-    struct ucred* cred = NULL;
-
-    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
-    while (cmsg != NULL) {
-        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_CREDENTIALS) {
-            cred = (struct ucred*)CMSG_DATA(cmsg);
-            break;
+    log_msg msg;
+    mBatch.clear();
+    for (int i = 0; i < count; i++) {
+        ssize_t n = mHeaders[i].msg_len;
+        if (n <= (ssize_t)(sizeof(android_log_header_t))) {
+            continue;
         }
-        cmsg = CMSG_NXTHDR(&hdr, cmsg);
-    }
 
-    struct ucred fake_cred;
-    if (cred == NULL) {
-        cred = &fake_cred;
-        cred->pid = 0;
-        cred->uid = DEFAULT_OVERFLOWUID;
-    }
+        char* buffer = mDatagrams[i].buffer;
+        buffer[n] = 0;
 
-    char* ptr = ((char*)buffer) + sizeof(android_log_header_t);
-    n -= sizeof(android_log_header_t);
+        struct ucred* cred = NULL;
 
-    log_msg msg;
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&mHeaders[i].msg_hdr);
+        while (cmsg != NULL) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_CREDENTIALS) {
+                cred = (struct ucred*)CMSG_DATA(cmsg);
+                break;
+            }
+            cmsg = CMSG_NXTHDR(&mHeaders[i].msg_hdr, cmsg);
+        }
 
-    msg.entry.len = n;
-    msg.entry.hdr_size = kLogMsgHeaderSize;
-    msg.entry.sec = time(nullptr);
-    msg.entry.pid = cred->pid;
-    msg.entry.uid = cred->uid;
+        struct ucred fake_cred;
+        if (cred == NULL) {
+            cred = &fake_cred;
+            cred->pid = 0;
+            cred->uid = DEFAULT_OVERFLOWUID;
+        }
 
-    memcpy(msg.buf + kLogMsgHeaderSize, ptr, n + 1);
-    LogEvent event(msg);
+        char* ptr = ((char*)buffer) + sizeof(android_log_header_t);
+        n -= sizeof(android_log_header_t);
+
+        msg.entry.len = n;
+        msg.entry.hdr_size = kLogMsgHeaderSize;
+        msg.entry.sec = time(nullptr);
+        msg.entry.pid = cred->pid;
+        msg.entry.uid = cred->uid;
+
+        memcpy(msg.buf + kLogMsgHeaderSize, ptr, n + 1);
+        std::unique_ptr<LogEvent>& event = mEvents[mBatch.size()];
+        if (event == nullptr) {
+            event.reset(new LogEvent(msg));
+        } else {
+            event->reset(msg);
+        }
+        mBatch.push_back(event.get());
+    }
+    if (mBatch.empty()) {
+        return false;
+    }
 
     // Call the listener
-    mListener->OnLogEvent(&event, false /*reconnected, N/A in statsd socket*/);
+    mListener->OnLogEvents(mBatch);
 
     return true;
 }
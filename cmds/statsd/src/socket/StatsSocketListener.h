@@ -17,8 +17,14 @@
 
 #include <sysutils/SocketListener.h>
 #include <utils/RefBase.h>
+#include "logd/LogEvent.h"
 #include "logd/LogListener.h"
 
+#include <memory>
+#include <vector>
+
+struct mmsghdr;
+
 // DEFAULT_OVERFLOWUID is defined in linux/highuid.h, which is not part of
 // the uapi headers for userspace to use.  This value is filled in on the
 // out-of-band socket credentials if the OS fails to find one available.
@@ -43,11 +49,30 @@ protected:
     virtual bool onDataAvailable(SocketClient* cli);
 
 private:
+    struct Datagram;
+
     static int getLogSocket();
     /**
      * Who is going to get the events when they're read.
      */
     sp<LogListener> mListener;
+
+    /**
+     * Buffers for the datagrams read by one recvmmsg call, and their headers.
+     */
+    std::unique_ptr<Datagram[]> mDatagrams;
+    std::unique_ptr<struct mmsghdr[]> mHeaders;
+
+    /**
+     * The i-th datagram of a batch is parsed into the i-th event, so that their values and the
+     * strings are reused. The listener doesn't keep pushed events after OnLogEvents returns.
+     */
+    std::vector<std::unique_ptr<LogEvent>> mEvents;
+
+    /**
+     * The events of the current batch.
+     */
+    std::vector<LogEvent*> mBatch;
 };
 }  // namespace statsd
 }  // namespace os
@@ -23,10 +23,13 @@
 #include "stats_log_util.h"
 
 #include <android-base/file.h>
+#include <android-base/unique_fd.h>
 #include <dirent.h>
 #include <private/android_filesystem_config.h>
+#include <sys/stat.h>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 
 namespace android {
 namespace os {
@@ -43,8 +46,24 @@ using std::map;
 const int FIELD_ID_REPORTS = 2;
 
 using android::base::StringPrintf;
+using android::base::unique_fd;
 using std::unique_ptr;
 
+// A report log starts with these bytes, followed by the ConfigMetricsReports appended to it.
+// Each report is written as the reports field of a ConfigMetricsReportList, its tag and its
+// size as a varint, so the log can be copied as is into a ConfigMetricsReportList. Report
+// files that don't start with them hold a single ConfigMetricsReport, as written before the
+// logs.
+static const char kReportLogMagic[] = {'S', 'L', 'O', 'G'};
+static const int64_t kReportLogMagicSize = sizeof(kReportLogMagic);
+static const uint8_t kReportsTag = FIELD_ID_REPORTS << 3 | 2;  // Length delimited.
+// A tag and a 64 bits varint.
+static const size_t kMaxReportHeaderSize = 11;
+static const size_t kCopyBufferSize = 16 * 1024;
+
+// Guards the report logs, which are appended to, read and compacted from different threads.
+static std::mutex sReportLogMutex;
+
 // Returns array of int64_t which contains timestamp in seconds, uid, and
 // configID.
 static void parseFileName(char* name, int64_t* result) {
@@ -68,6 +87,109 @@ static string getFilePath(const char* path, int64_t timestamp, int64_t uid, int6
                         (long long)configID);
 }
 
+// Starts with a dot, like all the files of the directory that aren't reports.
+#define SPILL_FILE_PREFIX ".spill_"
+
+// Writes the header of a report of the given size to header, returns the size of the header.
+static size_t encodeReportHeader(uint64_t size, uint8_t* header) {
+    size_t pos = 0;
+    header[pos++] = kReportsTag;
+    while (size >= 0x80) {
+        header[pos++] = (uint8_t)(size | 0x80);
+        size >>= 7;
+    }
+    header[pos++] = (uint8_t)size;
+    return pos;
+}
+
+// Reads the header of the report at offset in a log of fileSize bytes. Returns false at the end
+// of the log, or if the rest of it isn't a whole report.
+static bool readReportHeader(int fd, int64_t offset, int64_t fileSize, size_t* headerSize,
+                             uint64_t* reportSize) {
+    uint8_t header[kMaxReportHeaderSize];
+    ssize_t read = pread(fd, header, sizeof(header), offset);
+    if (read < 2 || header[0] != kReportsTag) {
+        return false;
+    }
+    uint64_t size = 0;
+    for (ssize_t pos = 1; pos < read; pos++) {
+        size |= (uint64_t)(header[pos] & 0x7f) << (7 * (pos - 1));
+        if ((header[pos] & 0x80) == 0) {
+            *headerSize = pos + 1;
+            *reportSize = size;
+            return size <= (uint64_t)(fileSize - offset - *headerSize);
+        }
+    }
+    return false;
+}
+
+static bool isReportLog(int fd) {
+    char magic[kReportLogMagicSize];
+    return pread(fd, magic, sizeof(magic), 0) == kReportLogMagicSize &&
+           memcmp(magic, kReportLogMagic, sizeof(magic)) == 0;
+}
+
+// Returns the offset after the last whole report of the log. A report cut short by a crash
+// while it was written is ignored.
+static int64_t findReportLogEnd(int fd, int64_t fileSize) {
+    int64_t offset = kReportLogMagicSize;
+    size_t headerSize;
+    uint64_t reportSize;
+    while (readReportHeader(fd, offset, fileSize, &headerSize, &reportSize)) {
+        offset += headerSize + reportSize;
+    }
+    return offset;
+}
+
+static int64_t getFileSize(int fd) {
+    struct stat fileStat;
+    return fstat(fd, &fileStat) == 0 ? fileStat.st_size : -1;
+}
+
+// Copies size bytes of in at offset to out.
+static bool copyFileRange(int in, int64_t offset, int64_t size, int out) {
+    char buffer[kCopyBufferSize];
+    while (size > 0) {
+        ssize_t read = pread(in, buffer, std::min((int64_t)sizeof(buffer), size), offset);
+        if (read <= 0 || !android::base::WriteFully(out, buffer, read)) {
+            return false;
+        }
+        offset += read;
+        size -= read;
+    }
+    return true;
+}
+
+// Returns the paths of the report files of key, oldest first.
+static vector<string> getReportFiles(const ConfigKey& key) {
+    vector<string> files;
+    unique_ptr<DIR, decltype(&closedir)> dir(opendir(STATS_DATA_DIR), closedir);
+    if (dir == NULL) {
+        VLOG("Path %s does not exist", STATS_DATA_DIR);
+        return files;
+    }
+
+    string suffix = StringPrintf("%d_%lld", key.GetUid(), (long long)key.GetId());
+
+    dirent* de;
+    while ((de = readdir(dir.get()))) {
+        char* name = de->d_name;
+        if (name[0] == '.') continue;
+
+        size_t nameLen = strlen(name);
+        size_t suffixLen = suffix.length();
+        if (suffixLen <= nameLen &&
+            strncmp(name + nameLen - suffixLen, suffix.c_str(), suffixLen) == 0) {
+            int64_t result[3];
+            parseFileName(name, result);
+            if (result[0] == -1) continue;
+            files.push_back(getFilePath(STATS_DATA_DIR, result[0], result[1], result[2]));
+        }
+    }
+    sort(files.begin(), files.end());
+    return files;
+}
+
 void StorageManager::writeFile(const char* file, const void* buffer, int numBytes) {
     int fd = open(file, O_WRONLY | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
     if (fd == -1) {
@@ -189,47 +311,231 @@ bool StorageManager::hasConfigMetricsReport(const ConfigKey& key) {
 }
 
 void StorageManager::appendConfigMetricsReport(const ConfigKey& key, ProtoOutputStream* proto) {
+    std::lock_guard<std::mutex> lock(sReportLogMutex);
+    for (const string& file_name : getReportFiles(key)) {
+        int fd = open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd != -1) {
+            int64_t fileSize = getFileSize(fd);
+            if (isReportLog(fd)) {
+                // One report in memory at a time.
+                int64_t offset = kReportLogMagicSize;
+                size_t headerSize;
+                uint64_t reportSize;
+                string content;
+                while (readReportHeader(fd, offset, fileSize, &headerSize, &reportSize)) {
+                    content.resize(reportSize);
+                    if (pread(fd, &content[0], reportSize, offset + headerSize) !=
+                        (ssize_t)reportSize) {
+                        break;
+                    }
+                    proto->write(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_REPORTS,
+                                 content.c_str(), content.size());
+                    offset += headerSize + reportSize;
+                }
+            } else {
+                string content;
+                if (android::base::ReadFdToString(fd, &content)) {
+                    proto->write(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_REPORTS,
+                                 content.c_str(), content.size());
+                }
+            }
+            close(fd);
+        }
+
+        // Remove file from disk after reading.
+        remove(file_name.c_str());
+    }
+}
+
+bool StorageManager::writeConfigMetricsReports(const ConfigKey& key, int fd, size_t* outSize) {
+    std::lock_guard<std::mutex> lock(sReportLogMutex);
+    for (const string& file_name : getReportFiles(key)) {
+        unique_fd in(open(file_name.c_str(), O_RDONLY | O_CLOEXEC));
+        if (in == -1) {
+            continue;
+        }
+        int64_t fileSize = getFileSize(in.get());
+        bool written;
+        if (isReportLog(in.get())) {
+            // The reports are already written as the reports field, the log is copied as is.
+            int64_t end = findReportLogEnd(in.get(), fileSize);
+            written = copyFileRange(in.get(), kReportLogMagicSize, end - kReportLogMagicSize, fd);
+            *outSize += end - kReportLogMagicSize;
+        } else {
+            uint8_t header[kMaxReportHeaderSize];
+            size_t headerSize = encodeReportHeader(fileSize, header);
+            written = android::base::WriteFully(fd, header, headerSize) &&
+                      copyFileRange(in.get(), 0, fileSize, fd);
+            *outSize += headerSize + fileSize;
+        }
+        if (!written) {
+            // What was written is lost either way, the rest stays on disk for the next dump.
+            ALOGE("Failed to write the reports in %s", file_name.c_str());
+            return false;
+        }
+
+        // Remove file from disk after reading.
+        remove(file_name.c_str());
+    }
+    return true;
+}
+
+bool StorageManager::appendToReportLog(const ConfigKey& key, ProtoOutputStream* report) {
+    std::lock_guard<std::mutex> lock(sReportLogMutex);
+    // The log is named after the time of its last report, which trimToFit() uses to tell how old
+    // it is.
+    string file_name = getFilePath(STATS_DATA_DIR, getWallClockSec(), key.GetUid(), key.GetId());
+    for (const string& existing : getReportFiles(key)) {
+        unique_fd existingFd(open(existing.c_str(), O_RDONLY | O_CLOEXEC));
+        if (existingFd != -1 && isReportLog(existingFd.get())) {
+            if (existing != file_name && rename(existing.c_str(), file_name.c_str()) != 0) {
+                ALOGE("Failed to rename %s to %s", existing.c_str(), file_name.c_str());
+                return false;
+            }
+            break;
+        }
+    }
+
+    unique_fd fd(open(file_name.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR));
+    if (fd == -1) {
+        ALOGE("Attempt to write %s but failed", file_name.c_str());
+        return false;
+    }
+    int64_t end = getFileSize(fd.get());
+    if (end == 0) {
+        if (!android::base::WriteFully(fd.get(), kReportLogMagic, kReportLogMagicSize)) {
+            ALOGE("Failed to write %s", file_name.c_str());
+            return false;
+        }
+        end = kReportLogMagicSize;
+    } else if (end > 0 && isReportLog(fd.get())) {
+        int64_t fileSize = end;
+        end = findReportLogEnd(fd.get(), fileSize);
+        if (end != fileSize) {
+            ALOGW("Dropping %lld bytes of a torn report in %s", (long long)(fileSize - end),
+                  file_name.c_str());
+            ftruncate(fd.get(), end);
+        }
+    } else {
+        ALOGE("%s is not a report log", file_name.c_str());
+        return false;
+    }
+
+    uint8_t header[kMaxReportHeaderSize];
+    size_t headerSize = encodeReportHeader(report->size(), header);
+    if (lseek(fd.get(), end, SEEK_SET) != end ||
+        !android::base::WriteFully(fd.get(), header, headerSize) || !report->flush(fd.get())) {
+        ALOGE("Failed to append a report to %s", file_name.c_str());
+        ftruncate(fd.get(), end);
+        return false;
+    }
+    return true;
+}
+
+void StorageManager::flushReportLogs() {
+    trimToFit(STATS_DATA_DIR);
+
+    std::lock_guard<std::mutex> lock(sReportLogMutex);
     unique_ptr<DIR, decltype(&closedir)> dir(opendir(STATS_DATA_DIR), closedir);
     if (dir == NULL) {
         VLOG("Path %s does not exist", STATS_DATA_DIR);
         return;
     }
-
-    string suffix = StringPrintf("%d_%lld", key.GetUid(), (long long)key.GetId());
-
     dirent* de;
     while ((de = readdir(dir.get()))) {
         char* name = de->d_name;
         if (name[0] == '.') continue;
+        unique_fd fd(open(StringPrintf("%s/%s", STATS_DATA_DIR, name).c_str(),
+                          O_RDONLY | O_CLOEXEC));
+        // Files other than the logs are synced when they're written, and only the logs that
+        // were appended to have anything to sync.
+        if (fd != -1 && isReportLog(fd.get()) && fsync(fd.get()) != 0) {
+            ALOGE("Failed to sync %s", name);
+        }
+    }
+    // The logs that were created or renamed.
+    if (fsync(dirfd(dir.get())) != 0) {
+        ALOGE("Failed to sync %s", STATS_DATA_DIR);
+    }
+}
 
-        size_t nameLen = strlen(name);
-        size_t suffixLen = suffix.length();
-        if (suffixLen <= nameLen &&
-            strncmp(name + nameLen - suffixLen, suffix.c_str(), suffixLen) == 0) {
-            int64_t result[3];
-            parseFileName(name, result);
-            if (result[0] == -1) continue;
-            int64_t timestamp = result[0];
-            int64_t uid = result[1];
-            int64_t configID = result[2];
+string StorageManager::getSpillFilePath(const ConfigKey& key, int64_t metricId) {
+    return StringPrintf("%s/" SPILL_FILE_PREFIX "%d_%lld_%lld", STATS_DATA_DIR, key.GetUid(),
+                        (long long)key.GetId(), (long long)metricId);
+}
 
-            string file_name = getFilePath(STATS_DATA_DIR, timestamp, uid, configID);
-            int fd = open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
-            if (fd != -1) {
-                string content;
-                if (android::base::ReadFdToString(fd, &content)) {
-                    proto->write(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_REPORTS,
-                                content.c_str(), content.size());
-                }
-                close(fd);
-            }
+bool StorageManager::appendToFile(const char* file, ProtoOutputStream* proto) {
+    unique_fd fd(open(file, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR));
+    if (fd == -1) {
+        ALOGE("Attempt to write %s but failed", file);
+        return false;
+    }
+    int64_t end = getFileSize(fd.get());
+    if (!proto->flush(fd.get())) {
+        ALOGE("Failed to append to %s", file);
+        // Don't leave part of the data behind.
+        ftruncate(fd.get(), end);
+        return false;
+    }
+    return true;
+}
 
-            // Remove file from disk after reading.
-            remove(file_name.c_str());
+void StorageManager::deleteSpillFiles() {
+    unique_ptr<DIR, decltype(&closedir)> dir(opendir(STATS_DATA_DIR), closedir);
+    if (dir == NULL) {
+        VLOG("Path %s does not exist", STATS_DATA_DIR);
+        return;
+    }
+    dirent* de;
+    while ((de = readdir(dir.get()))) {
+        if (strncmp(de->d_name, SPILL_FILE_PREFIX, strlen(SPILL_FILE_PREFIX)) == 0) {
+            deleteFile(StringPrintf("%s/%s", STATS_DATA_DIR, de->d_name).c_str());
         }
     }
 }
 
+int64_t StorageManager::compactReportLog(const string& file, int64_t maxSize) {
+    unique_fd fd(open(file.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd == -1 || !isReportLog(fd.get())) {
+        return -1;
+    }
+    int64_t fileSize = getFileSize(fd.get());
+    vector<int64_t> reportOffsets;
+    int64_t end = kReportLogMagicSize;
+    size_t headerSize;
+    uint64_t reportSize;
+    while (readReportHeader(fd.get(), end, fileSize, &headerSize, &reportSize)) {
+        reportOffsets.push_back(end);
+        end += headerSize + reportSize;
+    }
+    // Keeps the newest reports that fit.
+    auto first = reportOffsets.begin();
+    while (first != reportOffsets.end() && kReportLogMagicSize + end - *first > maxSize) {
+        first++;
+    }
+    if (first == reportOffsets.end()) {
+        return -1;
+    }
+    if (first == reportOffsets.begin() && end == fileSize) {
+        return fileSize;
+    }
+
+    // Starts with a dot so that the other readers of the directory skip it.
+    string tmpName = file.substr(0, file.rfind('/') + 1) + ".compacting";
+    unique_fd tmp(open(tmpName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                       S_IRUSR | S_IWUSR));
+    if (tmp == -1 || !android::base::WriteFully(tmp.get(), kReportLogMagic, kReportLogMagicSize) ||
+        !copyFileRange(fd.get(), *first, end - *first, tmp.get()) || fsync(tmp.get()) != 0 ||
+        rename(tmpName.c_str(), file.c_str()) != 0) {
+        ALOGE("Failed to compact %s", file.c_str());
+        remove(tmpName.c_str());
+        return -1;
+    }
+    VLOG("Compacted %s from %lld to %lld bytes", file.c_str(), (long long)fileSize,
+         (long long)(kReportLogMagicSize + end - *first));
+    return kReportLogMagicSize + end - *first;
+}
+
 bool StorageManager::readFileToString(const char* file, string* content) {
     int fd = open(file, O_RDONLY | O_CLOEXEC);
     bool res = false;
@@ -332,6 +638,7 @@ bool StorageManager::hasIdenticalConfig(const ConfigKey& key,
 }
 
 void StorageManager::trimToFit(const char* path) {
+    std::lock_guard<std::mutex> lock(sReportLogMutex);
     unique_ptr<DIR, decltype(&closedir)> dir(opendir(path), closedir);
     if (dir == NULL) {
         VLOG("Path %s does not exist", path);
@@ -379,16 +686,26 @@ void StorageManager::trimToFit(const char* path) {
     while (fileNames.size() > 0 && (fileNames.size() > StatsdStats::kMaxFileNumber ||
                                     totalFileSize > StatsdStats::kMaxFileSize)) {
         string file_name = fileNames.at(fileNames.size() - 1);
+        int fileSize = 0;
         ifstream file(file_name.c_str(), ifstream::in | ifstream::binary);
         if (file.is_open()) {
             file.seekg(0, ios::end);
-            int fileSize = file.tellg();
+            fileSize = file.tellg();
             file.close();
-            totalFileSize -= fileSize;
         }
+        fileNames.pop_back();
 
+        // Only over the size limit, the newest reports of a log can be kept.
+        if (fileNames.size() < StatsdStats::kMaxFileNumber) {
+            int64_t excess = totalFileSize - StatsdStats::kMaxFileSize;
+            int64_t compactedSize = compactReportLog(file_name, fileSize - excess);
+            if (compactedSize >= 0) {
+                totalFileSize -= fileSize - compactedSize;
+                continue;
+            }
+        }
+        totalFileSize -= fileSize;
         deleteFile(file_name.c_str());
-        fileNames.pop_back();
     }
 }
 
@@ -18,6 +18,7 @@
 #define STORAGE_MANAGER_H
 
 #include <android/util/ProtoOutputStream.h>
+#include <gtest/gtest_prod.h>
 #include <utils/Log.h>
 #include <utils/RefBase.h>
 
@@ -73,6 +74,41 @@ public:
      */
     static void appendConfigMetricsReport(const ConfigKey& key, ProtoOutputStream* proto);
 
+    /**
+     * Writes the ConfigMetricsReports found on disk to fd, as the reports field of a
+     * ConfigMetricsReportList, and deletes them. Adds the number of bytes written to outSize.
+     * The reports are copied from the disk in chunks, without being read whole.
+     */
+    static bool writeConfigMetricsReports(const ConfigKey& key, int fd, size_t* outSize);
+
+    /**
+     * Appends a ConfigMetricsReport to the report log of the config, which is created if
+     * needed. The log isn't synced, call flushReportLogs() after a batch of reports.
+     */
+    static bool appendToReportLog(const ConfigKey& key, ProtoOutputStream* report);
+
+    /**
+     * Trims the report logs to fit the limits and syncs them to disk.
+     */
+    static void flushReportLogs();
+
+    /**
+     * Returns the path of the file a metric moves its data to when there's too much of it to
+     * keep in memory. These files are hidden from the reports in the same directory.
+     */
+    static string getSpillFilePath(const ConfigKey& key, int64_t metricId);
+
+    /**
+     * Appends the content of proto to a file, creating it if needed.
+     */
+    static bool appendToFile(const char* file, ProtoOutputStream* proto);
+
+    /**
+     * Deletes the spill files, whose metrics and the data they had in memory are gone once
+     * statsd restarts.
+     */
+    static void deleteSpillFiles();
+
     /**
      * Call to load the saved configs from disk.
      */
@@ -87,7 +123,8 @@ public:
 
     /**
      * Trims files in the provided directory to limit the total size, number of
-     * files, accumulation of outdated files.
+     * files, accumulation of outdated files. Report logs that are over the size
+     * limit lose their oldest reports before files are deleted.
      */
     static void trimToFit(const char* dir);
 
@@ -107,6 +144,14 @@ private:
      * Prints disk usage statistics about a directory related to statsd.
      */
     static void printDirStats(FILE* out, const char* path);
+
+    /**
+     * Drops the oldest reports of a report log so that it's at most maxSize bytes. Returns the
+     * new size, or -1 if the file isn't a report log or none of its reports fit.
+     */
+    static int64_t compactReportLog(const string& file, int64_t maxSize);
+
+    FRIEND_TEST(StorageManagerTest, TestCompactReportLog);
 };
 
 }  // namespace statsd
@@ -62,6 +62,40 @@ TEST(AlarmMonitor, popSoonerThan) {
     EXPECT_EQ(0u, set.size());
 }
 
+TEST(AlarmMonitor, replace) {
+    uint32_t registeredTimeSec = 0;
+    int updateCount = 0;
+    AlarmMonitor am(2,
+                    [&](const sp<IStatsCompanionService>&, int64_t timeMs) {
+                        registeredTimeSec = timeMs / 1000;
+                        updateCount++;
+                    },
+                    [&](const sp<IStatsCompanionService>&) { registeredTimeSec = 0; });
+
+    sp<const InternalAlarm> a = new InternalAlarm{10};
+    sp<const InternalAlarm> b = new InternalAlarm{20};
+    sp<const InternalAlarm> c = new InternalAlarm{11};
+    am.replace(nullptr, a);
+    EXPECT_EQ(10u, registeredTimeSec);
+    am.add(b);
+
+    // Within the minimum difference of the registered alarm, nothing is updated.
+    am.replace(a, c);
+    EXPECT_EQ(10u, registeredTimeSec);
+    EXPECT_EQ(1, updateCount);
+
+    sp<const InternalAlarm> d = new InternalAlarm{30};
+    am.replace(c, d);
+    EXPECT_EQ(20u, registeredTimeSec);
+    EXPECT_EQ(2, updateCount);
+
+    auto set = am.popSoonerThan(30);
+    EXPECT_EQ(2u, set.size());
+    EXPECT_EQ(1u, set.count(b));
+    EXPECT_EQ(1u, set.count(d));
+    EXPECT_EQ(0u, registeredTimeSec);
+}
+
 #else
 GTEST_LOG_(INFO) << "This test does nothing.\n";
 #endif
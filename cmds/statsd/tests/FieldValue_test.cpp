@@ -171,6 +171,38 @@ TEST(AtomMatcherTest, TestSubDimension) {
     EXPECT_TRUE(dim.contains(subDim4));
 }
 
+TEST(AtomMatcherTest, TestDimensionHashCache) {
+    int pos1[] = {1, 0, 0};
+    int pos2[] = {2, 0, 0};
+    Field field1(10, pos1, 0);
+    Field field2(10, pos2, 0);
+
+    HashableDimensionKey dim1;
+    dim1.addValue(FieldValue(field1, Value((int32_t)10025)));
+    dim1.addValue(FieldValue(field2, Value("tag")));
+    HashableDimensionKey dim2;
+    dim2.addValue(FieldValue(field1, Value((int32_t)10025)));
+    dim2.addValue(FieldValue(field2, Value("tag")));
+
+    const android::hash_t hash = hashDimension(dim1);
+    EXPECT_EQ(hash, hashDimension(dim2));
+    EXPECT_EQ(dim1, dim2);
+
+    // Copies keep the hash, modifications recompute it.
+    HashableDimensionKey copy(dim1);
+    EXPECT_EQ(hash, hashDimension(copy));
+    copy.mutableValue(0)->mValue.setInt(10026);
+    EXPECT_NE(hash, hashDimension(copy));
+    EXPECT_FALSE(copy == dim1);
+
+    HashableDimensionKey moved(std::move(dim2));
+    EXPECT_EQ(hash, hashDimension(moved));
+    EXPECT_EQ(dim1, moved);
+    EXPECT_EQ(0u, dim2.getValues().size());
+    dim2.addValue(FieldValue(field1, Value((int32_t)10025)));
+    EXPECT_FALSE(dim2 == dim1);
+}
+
 TEST(AtomMatcherTest, TestMetric2ConditionLink) {
     AttributionNodeInternal attribution_node1;
     attribution_node1.set_uid(1111);
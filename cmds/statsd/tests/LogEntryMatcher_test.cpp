@@ -446,6 +446,37 @@ TEST(AtomMatcherTest, TestEqAnyStringMatcher) {
     EXPECT_FALSE(matchesSimple(uidMap, *simpleMatcher, event));
 }
 
+TEST(AtomMatcherTest, TestCompiledMatcherSeesUidMapUpdates) {
+    UidMap uidMap;
+
+    AttributionNodeInternal attribution_node;
+    attribution_node.set_uid(1111);
+    attribution_node.set_tag("location1");
+    std::vector<AttributionNodeInternal> attribution_nodes = {attribution_node};
+
+    LogEvent event(TAG_ID, 0);
+    event.write(attribution_nodes);
+    event.init();
+
+    AtomMatcher matcher;
+    auto simpleMatcher = matcher.mutable_simple_atom_matcher();
+    simpleMatcher->set_atom_id(TAG_ID);
+    auto attributionMatcher = simpleMatcher->add_field_value_matcher();
+    attributionMatcher->set_field(FIELD_ID_1);
+    attributionMatcher->set_position(Position::FIRST);
+    auto uidMatcher = attributionMatcher->mutable_matches_tuple()->add_field_value_matcher();
+    uidMatcher->set_field(ATTRIBUTION_UID_FIELD_ID);
+    uidMatcher->set_eq_string("pkg1");
+
+    CompiledAtomMatcher compiled(*simpleMatcher);
+    EXPECT_FALSE(compiled.matches(uidMap, event));
+
+    // The package is installed after the matcher is compiled.
+    uidMap.updateMap(1, {1111} /* uid list */, {1} /* version list */,
+                     {android::String16("pkg1")} /* package name list */);
+    EXPECT_TRUE(compiled.matches(uidMap, event));
+}
+
 TEST(AtomMatcherTest, TestBoolMatcher) {
     UidMap uidMap;
     // Set up the matcher
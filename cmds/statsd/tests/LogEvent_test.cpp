@@ -16,6 +16,8 @@
 #include <log/log_event_list.h>
 #include "src/logd/LogEvent.h"
 
+#include <string.h>
+
 #ifdef __ANDROID__
 
 namespace android {
@@ -158,6 +160,83 @@ TEST(LogEventTest, TestLogParsing2) {
     EXPECT_EQ((float)1.1, item7.mValue.float_value);
 }
 
+// Fills msg like the statsd socket does, with an optional string field and an int field.
+static void makeLogMsg(int32_t tagId, const char* str, int32_t intValue, log_msg* msg) {
+    android_log_context context = create_android_logger(1937006964);
+    android_log_write_int64(context, 1000);
+    android_log_write_int32(context, tagId);
+    if (str != nullptr) {
+        android_log_write_string8(context, str);
+    }
+    android_log_write_int32(context, intValue);
+    const char* buffer;
+    size_t len = android_log_write_list_buffer(context, &buffer);
+
+    memset(msg, 0, sizeof(*msg));
+    const uint32_t eventTag = 1937006964;
+    msg->entry.hdr_size = 28;
+    msg->entry.len = sizeof(eventTag) + len;
+    memcpy(msg->buf + msg->entry.hdr_size, &eventTag, sizeof(eventTag));
+    memcpy(msg->buf + msg->entry.hdr_size + sizeof(eventTag), buffer, len);
+    android_log_destroy(&context);
+}
+
+TEST(LogEventTest, TestResetFromLogMsg) {
+    log_msg msg;
+    makeLogMsg(1, "hello", 10, &msg);
+    LogEvent event(msg);
+    EXPECT_EQ(1, event.GetTagId());
+    ASSERT_EQ((size_t)2, event.getValues().size());
+    EXPECT_EQ("hello", event.getValues()[0].mValue.str_value);
+
+    // Fewer values, and an int where the string was.
+    makeLogMsg(2, nullptr, 20, &msg);
+    event.reset(msg);
+    EXPECT_EQ(2, event.GetTagId());
+    ASSERT_EQ((size_t)1, event.getValues().size());
+    const FieldValue& item0 = event.getValues()[0];
+    EXPECT_EQ(0x10000, item0.mField.getField());
+    EXPECT_EQ(2, item0.mField.getTag());
+    EXPECT_EQ(Type::INT, item0.mValue.getType());
+    EXPECT_EQ(20, item0.mValue.int_value);
+
+    makeLogMsg(3, "world", 30, &msg);
+    event.reset(msg);
+    EXPECT_EQ(3, event.GetTagId());
+    ASSERT_EQ((size_t)2, event.getValues().size());
+    EXPECT_EQ(Type::STRING, event.getValues()[0].mValue.getType());
+    EXPECT_EQ("world", event.getValues()[0].mValue.str_value);
+    EXPECT_EQ(0x20000, event.getValues()[1].mField.getField());
+    EXPECT_EQ(30, event.getValues()[1].mValue.int_value);
+}
+
+TEST(LogEventTest, TestValuesParsedOnFirstRead) {
+    log_msg msg;
+    makeLogMsg(1, "hello", 10, &msg);
+    LogEvent event(msg);
+    EXPECT_EQ(1, event.GetTagId());
+
+    // The values of the first event are never read.
+    makeLogMsg(2, "world", 20, &msg);
+    event.reset(msg);
+    EXPECT_EQ(2, event.GetTagId());
+
+    // The payload was copied, the log_msg can be reused before the values are read.
+    makeLogMsg(3, nullptr, 30, &msg);
+    EXPECT_EQ(2, event.size());
+    EXPECT_EQ("world", event.getValues()[0].mValue.str_value);
+    EXPECT_EQ(2, event.getValues()[1].mField.getTag());
+    EXPECT_EQ(20, event.getValues()[1].mValue.int_value);
+
+    status_t err = NO_ERROR;
+    EXPECT_EQ(20, event.GetInt(2, &err));
+    EXPECT_EQ(NO_ERROR, err);
+
+    event.reset(msg);
+    EXPECT_EQ(3, event.GetTagId());
+    ASSERT_EQ((size_t)1, event.getValues().size());
+    EXPECT_EQ(30, event.getValues()[0].mValue.int_value);
+}
 
 }  // namespace statsd
 }  // namespace os
@@ -27,6 +27,7 @@
 #include "tests/statsd_test_util.h"
 
 #include <stdio.h>
+#include <unistd.h>
 
 using namespace android;
 using namespace testing;
@@ -217,6 +218,106 @@ TEST(StatsLogProcessorTest, TestReportIncludesSubConfig) {
     EXPECT_EQ(2, report.annotation(0).field_int32());
 }
 
+TEST(StatsLogProcessorTest, TestDumpReportToFd) {
+    sp<UidMap> m = new UidMap();
+    sp<AlarmMonitor> anomalyAlarmMonitor;
+    sp<AlarmMonitor> subscriberAlarmMonitor;
+    StatsLogProcessor p(m, anomalyAlarmMonitor, subscriberAlarmMonitor, 0,
+                        [](const ConfigKey& key) { return true; });
+    ConfigKey key(3, 4);
+    p.OnConfigUpdated(0, key, MakeConfig(true));
+    auto event = CreateAppCrashEvent(111, 2);
+    p.OnLogEvent(event.get());
+
+    FILE* file = tmpfile();
+    ASSERT_NE(nullptr, file);
+    EXPECT_TRUE(p.onDumpReport(key, 3, true, ADB_DUMP, fileno(file)));
+    off_t size = lseek(fileno(file), 0, SEEK_END);
+    ASSERT_GT(size, 0);
+    vector<uint8_t> bytes(size);
+    rewind(file);
+    ASSERT_EQ((size_t)size, fread(bytes.data(), 1, size, file));
+    fclose(file);
+
+    ConfigMetricsReportList output;
+    ASSERT_TRUE(output.ParseFromArray(bytes.data(), bytes.size()));
+    EXPECT_EQ(3, output.config_key().uid());
+    EXPECT_EQ(4, output.config_key().id());
+    ASSERT_EQ(1, output.reports_size());
+    ASSERT_EQ(1, output.reports(0).metrics_size());
+    ASSERT_EQ(1, output.reports(0).metrics(0).count_metrics().data_size());
+    EXPECT_EQ(3, output.reports(0).current_report_elapsed_nanos());
+}
+
+StatsdConfig MakeConfigUpdateTestConfig(TimeUnit crashBucket) {
+    StatsdConfig config;
+    config.add_allowed_log_source("AID_ROOT");  // LogEvent defaults to UID of root.
+    *config.add_atom_matcher() = CreateScreenTurnedOnAtomMatcher();
+    *config.add_atom_matcher() = CreateScreenTurnedOffAtomMatcher();
+    *config.add_atom_matcher() = CreateProcessCrashAtomMatcher();
+    *config.add_predicate() = CreateScreenIsOnPredicate();
+
+    CountMetric* screenOnCrashes = config.add_count_metric();
+    screenOnCrashes->set_id(StringToId("ScreenOnCrashes"));
+    screenOnCrashes->set_what(StringToId("Crashed"));
+    screenOnCrashes->set_condition(StringToId("ScreenIsOn"));
+    screenOnCrashes->set_bucket(FIVE_MINUTES);
+
+    CountMetric* crashes = config.add_count_metric();
+    crashes->set_id(StringToId("Crashes"));
+    crashes->set_what(StringToId("Crashed"));
+    crashes->set_bucket(crashBucket);
+    return config;
+}
+
+TEST(StatsLogProcessorTest, TestConfigUpdateKeepsUnchangedMetrics) {
+    sp<UidMap> m = new UidMap();
+    sp<AlarmMonitor> anomalyAlarmMonitor;
+    sp<AlarmMonitor> subscriberAlarmMonitor;
+    StatsLogProcessor p(m, anomalyAlarmMonitor, subscriberAlarmMonitor, 0,
+                        [](const ConfigKey& key) { return true; });
+    ConfigKey key(3, 4);
+    const int64_t bucketStartTimeNs = 10 * NS_PER_SEC;
+    p.OnConfigUpdated(bucketStartTimeNs, key, MakeConfigUpdateTestConfig(FIVE_MINUTES));
+    ASSERT_EQ(2UL, p.mMetricsManagers[key]->mAllMetricProducers.size());
+    sp<MetricProducer> screenOnCrashes = p.mMetricsManagers[key]->mAllMetricProducers[0];
+    sp<MetricProducer> crashes = p.mMetricsManagers[key]->mAllMetricProducers[1];
+
+    auto screenOn = CreateScreenStateChangedEvent(android::view::DISPLAY_STATE_ON,
+                                                  bucketStartTimeNs + 1);
+    p.OnLogEvent(screenOn.get());
+    auto crash = CreateAppCrashEvent(111, bucketStartTimeNs + 2);
+    p.OnLogEvent(crash.get());
+
+    // Only the bucket of the crash metric changes.
+    p.OnConfigUpdated(bucketStartTimeNs + 3, key, MakeConfigUpdateTestConfig(ONE_HOUR));
+    ASSERT_EQ(2UL, p.mMetricsManagers[key]->mAllMetricProducers.size());
+    EXPECT_EQ(screenOnCrashes, p.mMetricsManagers[key]->mAllMetricProducers[0]);
+    EXPECT_NE(crashes, p.mMetricsManagers[key]->mAllMetricProducers[1]);
+
+    crash = CreateAppCrashEvent(111, bucketStartTimeNs + 4);
+    p.OnLogEvent(crash.get());
+
+    vector<uint8_t> bytes;
+    p.onDumpReport(key, bucketStartTimeNs + 5, true, ADB_DUMP, &bytes);
+    ConfigMetricsReportList output;
+    ASSERT_TRUE(output.ParseFromArray(bytes.data(), bytes.size()));
+    ASSERT_EQ(1, output.reports_size());
+    ASSERT_EQ(2, output.reports(0).metrics_size());
+
+    // The kept metric has both crashes in a single bucket, the screen is still on for it.
+    const auto& screenOnCrashesReport = output.reports(0).metrics(0).count_metrics();
+    ASSERT_EQ(1, screenOnCrashesReport.data_size());
+    ASSERT_EQ(1, screenOnCrashesReport.data(0).bucket_info_size());
+    EXPECT_EQ(2, screenOnCrashesReport.data(0).bucket_info(0).count());
+
+    // The rebuilt metric only has the crash after the update.
+    const auto& crashesReport = output.reports(0).metrics(1).count_metrics();
+    ASSERT_EQ(1, crashesReport.data_size());
+    ASSERT_EQ(1, crashesReport.data(0).bucket_info_size());
+    EXPECT_EQ(1, crashesReport.data(0).bucket_info(0).count());
+}
+
 TEST(StatsLogProcessorTest, TestOutOfOrderLogs) {
     // Setup simple config key corresponding to empty config.
     sp<UidMap> m = new UidMap();
@@ -135,6 +135,37 @@ TEST(UidMapTest, TestAddAndRemove) {
     EXPECT_TRUE(name_set.empty());
 }
 
+TEST(UidMapTest, TestIndexesFollowMap) {
+    UidMap m;
+    vector<int32_t> uids = {1000, 1000, 2000};
+    vector<int64_t> versions = {4, 5, 6};
+    vector<String16> apps = {String16(kApp1.c_str()), String16(kApp2.c_str()),
+                             String16(kApp1.c_str())};
+    m.updateMap(1, uids, versions, apps);
+    EXPECT_EQ((std::set<int32_t>{1000, 2000}), m.getAppUid(kApp1));
+    EXPECT_EQ((std::set<int32_t>{1000}), m.getAppUid(kApp2));
+
+    m.removeApp(2, String16(kApp1.c_str()), 1000);
+    EXPECT_EQ((std::set<int32_t>{2000}), m.getAppUid(kApp1));
+    EXPECT_EQ((std::set<string>{kApp2}), m.getAppNamesFromUid(1000, false));
+
+    m.removeApp(3, String16(kApp2.c_str()), 1000);
+    EXPECT_TRUE(m.getAppUid(kApp2).empty());
+    EXPECT_TRUE(m.getAppNamesFromUid(1000, false).empty());
+    // Nothing is kept for the uids and packages that are gone.
+    EXPECT_EQ(1u, m.mUidToPackages.size());
+    EXPECT_EQ(1u, m.mPackageToUids.size());
+
+    m.updateApp(4, String16(kApp2.c_str()), 1000, 50);
+    EXPECT_EQ((std::set<int32_t>{1000}), m.getAppUid(kApp2));
+
+    // A new snapshot replaces the indexes.
+    m.updateMap(5, {3000}, {7}, {String16(kApp2.c_str())});
+    EXPECT_TRUE(m.getAppUid(kApp1).empty());
+    EXPECT_EQ((std::set<int32_t>{3000}), m.getAppUid(kApp2));
+    EXPECT_TRUE(m.getAppNamesFromUid(1000, false).empty());
+}
+
 TEST(UidMapTest, TestUpdateApp) {
     UidMap m;
     m.updateMap(1, {1000, 1000}, {4, 5}, {String16(kApp1.c_str()), String16(kApp2.c_str())});
@@ -155,6 +155,36 @@ TEST(ConditionTrackerTest, TestNorCondition) {
     EXPECT_FALSE(evaluateCombinationCondition(children, operation, conditionResults));
 }
 
+TEST(ConditionTrackerTest, TestCombinationDecidedBy) {
+    vector<int> children;
+    children.push_back(0);
+    children.push_back(1);
+
+    vector<ConditionState> conditionResults;
+    conditionResults.push_back(ConditionState::kTrue);
+    conditionResults.push_back(ConditionState::kFalse);
+
+    EXPECT_TRUE(isCombinationDecidedBy(children, LogicalOperation::AND, conditionResults));
+    EXPECT_TRUE(isCombinationDecidedBy(children, LogicalOperation::NAND, conditionResults));
+    EXPECT_TRUE(isCombinationDecidedBy(children, LogicalOperation::OR, conditionResults));
+    EXPECT_TRUE(isCombinationDecidedBy(children, LogicalOperation::NOR, conditionResults));
+
+    conditionResults[1] = ConditionState::kTrue;
+    EXPECT_FALSE(isCombinationDecidedBy(children, LogicalOperation::AND, conditionResults));
+    EXPECT_TRUE(isCombinationDecidedBy(children, LogicalOperation::OR, conditionResults));
+
+    conditionResults[0] = ConditionState::kFalse;
+    conditionResults[1] = ConditionState::kFalse;
+    EXPECT_TRUE(isCombinationDecidedBy(children, LogicalOperation::AND, conditionResults));
+    EXPECT_FALSE(isCombinationDecidedBy(children, LogicalOperation::OR, conditionResults));
+    EXPECT_FALSE(isCombinationDecidedBy(children, LogicalOperation::NOT, conditionResults));
+
+    conditionResults[1] = ConditionState::kUnknown;
+    EXPECT_TRUE(isCombinationDecidedBy(children, LogicalOperation::OR, conditionResults));
+
+    EXPECT_FALSE(isCombinationDecidedBy(vector<int>(), LogicalOperation::AND, conditionResults));
+}
+
 #else
 GTEST_LOG_(INFO) << "This test does nothing.\n";
 #endif
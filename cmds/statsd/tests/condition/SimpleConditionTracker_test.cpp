@@ -643,6 +643,67 @@ TEST(SimpleConditionTrackerTest, TestStopAll) {
     }
 }
 
+TEST(SimpleConditionTrackerTest, TestPartialLinkIndex) {
+    // Sliced by the first uid and the wake lock name, queried by uid only.
+    SimplePredicate simplePredicate = getWakeLockHeldCondition(
+            true /*nesting*/, true /*default to false*/, true /*output slice by uid*/,
+            Position::FIRST);
+    simplePredicate.mutable_dimensions()->add_child()->set_field(2);
+    string conditionName = "WL_HELD_BY_UID_AND_NAME";
+
+    unordered_map<int64_t, int> trackerNameIndexMap;
+    trackerNameIndexMap[StringToId("WAKE_LOCK_ACQUIRE")] = 0;
+    trackerNameIndexMap[StringToId("WAKE_LOCK_RELEASE")] = 1;
+    trackerNameIndexMap[StringToId("RELEASE_ALL")] = 2;
+
+    SimpleConditionTracker conditionTracker(kConfigKey, StringToId(conditionName),
+                                            0 /*condition tracker index*/, simplePredicate,
+                                            trackerNameIndexMap);
+    vector<sp<ConditionTracker>> allPredicates;
+    vector<ConditionState> conditionCache(1, ConditionState::kNotEvaluated);
+    vector<bool> changedCache(1, false);
+    vector<MatchingState> acquire = {MatchingState::kMatched, MatchingState::kNotMatched,
+                                     MatchingState::kNotMatched};
+    vector<MatchingState> release = {MatchingState::kNotMatched, MatchingState::kMatched,
+                                     MatchingState::kNotMatched};
+
+    auto logWakeLock = [&](int uid, const string& name, const vector<MatchingState>& state) {
+        LogEvent event(1 /*tagId*/, 0 /*timestamp*/);
+        makeWakeLockEvent(&event, {uid}, name, state == acquire);
+        conditionCache[0] = ConditionState::kNotEvaluated;
+        conditionTracker.evaluateCondition(event, state, allPredicates, conditionCache,
+                                           changedCache);
+    };
+    auto query = [&](int uid) {
+        vector<Matcher> dimensionInCondition;
+        std::unordered_set<HashableDimensionKey> dimensionKeys;
+        conditionCache[0] = ConditionState::kNotEvaluated;
+        conditionTracker.isConditionMet(getWakeLockQueryKey(Position::FIRST, {uid}, conditionName),
+                                        allPredicates, dimensionInCondition, false,
+                                        true /* partial link */, conditionCache, dimensionKeys);
+        return conditionCache[0];
+    };
+
+    logWakeLock(111, "wl1", acquire);
+    logWakeLock(111, "wl2", acquire);
+    EXPECT_EQ(2UL, conditionTracker.mSlicedConditionState.size());
+    EXPECT_EQ(ConditionState::kTrue, query(111));
+    EXPECT_EQ(ConditionState::kFalse, query(222));
+    ASSERT_EQ(1UL, conditionTracker.mPartialLinkIndexes.size());
+    EXPECT_EQ(2UL, conditionTracker.mPartialLinkIndexes[0].slices.size());
+
+    // The index is kept up to date once it's built.
+    logWakeLock(222, "wl1", acquire);
+    EXPECT_EQ(ConditionState::kTrue, query(222));
+    logWakeLock(111, "wl1", release);
+    EXPECT_EQ(ConditionState::kTrue, query(111));
+    logWakeLock(111, "wl2", release);
+    EXPECT_EQ(ConditionState::kFalse, query(111));
+    EXPECT_EQ(1UL, conditionTracker.mSlicedConditionState.size());
+    EXPECT_EQ(1UL, conditionTracker.mPartialLinkIndexes[0].slices.size());
+    EXPECT_EQ(1UL, conditionTracker.mPartialLinkIndexes.size());
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
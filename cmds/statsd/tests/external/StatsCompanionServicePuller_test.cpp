@@ -0,0 +1,110 @@
+// Copyright (C) 2018 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/external/StatsCompanionServicePuller.h"
+
+#include <android/os/StatsLogEventWrapper.h>
+#include <gtest/gtest.h>
+#include <string.h>
+#include <vector>
+
+#ifdef __ANDROID__
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+template <typename T>
+static void append(vector<uint8_t>* bytes, T value) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
+    bytes->insert(bytes->end(), p, p + sizeof(T));
+}
+
+static void appendString(vector<uint8_t>* bytes, const string& value) {
+    append<int32_t>(bytes, value.size());
+    bytes->insert(bytes->end(), value.begin(), value.end());
+}
+
+// Two rows of (int uid, string package, long bytes).
+static vector<uint8_t> makeColumnarPull() {
+    vector<uint8_t> bytes;
+    append<int32_t>(&bytes, kColumnarPullMagic);
+    append<int32_t>(&bytes, kColumnarPullVersion);
+    append<int32_t>(&bytes, 2);  // rows
+    append<int32_t>(&bytes, 3);  // fields
+    append<int32_t>(&bytes, 1);  // strings
+    appendString(&bytes, "com.android.app");
+    append<int32_t>(&bytes, COLUMN_TYPE_INT);
+    append<int32_t>(&bytes, 1000);
+    append<int32_t>(&bytes, 1001);
+    append<int32_t>(&bytes, COLUMN_TYPE_STRING);
+    append<int32_t>(&bytes, 0);
+    append<int32_t>(&bytes, 0);
+    append<int32_t>(&bytes, COLUMN_TYPE_LONG);
+    append<int64_t>(&bytes, 1LL << 40);
+    append<int64_t>(&bytes, 7);
+    return bytes;
+}
+
+TEST(StatsCompanionServicePullerTest, TestParseColumnarPull) {
+    StatsLogEventWrapper wrapper;
+    wrapper.bytes = makeColumnarPull();
+    EXPECT_TRUE(wrapper.isColumnarPull());
+
+    vector<shared_ptr<LogEvent>> data;
+    ASSERT_TRUE(StatsCompanionServicePuller::ParseColumnarPull(10000, wrapper.bytes, &data));
+    ASSERT_EQ(2UL, data.size());
+    status_t err = NO_ERROR;
+    EXPECT_EQ(10000, data[0]->GetTagId());
+    EXPECT_EQ(1000, data[0]->GetInt(1, &err));
+    EXPECT_EQ(string("com.android.app"), data[0]->GetString(2, &err));
+    EXPECT_EQ(1LL << 40, data[0]->GetLong(3, &err));
+    EXPECT_EQ(1001, data[1]->GetInt(1, &err));
+    EXPECT_EQ(string("com.android.app"), data[1]->GetString(2, &err));
+    EXPECT_EQ(7, data[1]->GetLong(3, &err));
+    EXPECT_EQ(NO_ERROR, err);
+}
+
+TEST(StatsCompanionServicePullerTest, TestParseMalformedColumnarPull) {
+    vector<uint8_t> bytes = makeColumnarPull();
+    vector<shared_ptr<LogEvent>> data;
+
+    // Truncated in the last column.
+    vector<uint8_t> truncated(bytes.begin(), bytes.end() - 1);
+    EXPECT_FALSE(StatsCompanionServicePuller::ParseColumnarPull(10000, truncated, &data));
+
+    // String index out of the table.
+    vector<uint8_t> badIndex = bytes;
+    const size_t stringColumn = 5 * sizeof(int32_t) + sizeof(int32_t) + strlen("com.android.app") +
+                                3 * sizeof(int32_t);
+    int32_t index = 1;
+    memcpy(&badIndex[stringColumn + sizeof(int32_t)], &index, sizeof(index));
+    EXPECT_FALSE(StatsCompanionServicePuller::ParseColumnarPull(10000, badIndex, &data));
+
+    // A single atom isn't a columnar pull.
+    StatsLogEventWrapper wrapper;
+    wrapper.bytes = {1, 2};
+    EXPECT_FALSE(wrapper.isColumnarPull());
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
+#else
+GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
@@ -243,6 +243,72 @@ TEST(StatsdStatsTest, TestAtomLog) {
 }
 
 
+TEST(StatsdStatsTest, TestPullTimeStats) {
+    StatsdStats stats;
+    stats.notePull(android::util::WIFI_BYTES_TRANSFER);
+    stats.notePullTime(android::util::WIFI_BYTES_TRANSFER, 1000);
+    stats.notePull(android::util::WIFI_BYTES_TRANSFER);
+    stats.notePullTime(android::util::WIFI_BYTES_TRANSFER, 3000);
+    stats.notePullTimeout(android::util::WIFI_BYTES_TRANSFER);
+
+    vector<uint8_t> output;
+    stats.dumpStats(&output, false);
+    StatsdStatsReport report;
+    bool good = report.ParseFromArray(&output[0], output.size());
+    EXPECT_TRUE(good);
+
+    ASSERT_EQ(1, report.pulled_atom_stats_size());
+    const auto& pullStats = report.pulled_atom_stats(0);
+    EXPECT_EQ(android::util::WIFI_BYTES_TRANSFER, pullStats.atom_id());
+    EXPECT_EQ(2, pullStats.total_pull());
+    EXPECT_EQ(2000, pullStats.avg_pull_time_nanos());
+    EXPECT_EQ(3000, pullStats.max_pull_time_nanos());
+    EXPECT_EQ(1, pullStats.pull_timeout());
+}
+
+TEST(StatsdStatsTest, TestProcessingTimeStats) {
+    StatsdStats stats;
+    ConfigKey key(0, 12345);
+    stats.noteConfigReceived(key, 2, 3, 4, 5, {}, true);
+    EXPECT_EQ(0, stats.getProfilingSampleRate());
+    stats.setProfilingSampleRate(10);
+    EXPECT_EQ(10, stats.getProfilingSampleRate());
+
+    stats.noteMatcherProcessingTime(key, StringToId("matcher1"), 100);
+    stats.noteMatcherProcessingTime(key, StringToId("matcher1"), 300);
+    stats.noteConditionProcessingTime(key, StringToId("condition1"), 50);
+    stats.noteMetricProcessingTime(key, StringToId("metric1"), 70);
+    // Not a config we know of.
+    stats.noteMetricProcessingTime(ConfigKey(0, 1), StringToId("metric1"), 70);
+
+    vector<uint8_t> output;
+    stats.dumpStats(&output, false);
+    StatsdStatsReport report;
+    bool good = report.ParseFromArray(&output[0], output.size());
+    EXPECT_TRUE(good);
+
+    ASSERT_EQ(1, report.config_stats_size());
+    const auto& configReport = report.config_stats(0);
+    ASSERT_EQ(1, configReport.matcher_time_stats_size());
+    EXPECT_EQ(StringToId("matcher1"), configReport.matcher_time_stats(0).id());
+    EXPECT_EQ(2, configReport.matcher_time_stats(0).sample_count());
+    EXPECT_EQ(400, configReport.matcher_time_stats(0).total_time_nanos());
+    EXPECT_EQ(300, configReport.matcher_time_stats(0).max_time_nanos());
+    ASSERT_EQ(1, configReport.condition_time_stats_size());
+    EXPECT_EQ(50, configReport.condition_time_stats(0).total_time_nanos());
+    ASSERT_EQ(1, configReport.metric_time_stats_size());
+    EXPECT_EQ(70, configReport.metric_time_stats(0).total_time_nanos());
+
+    // Reset with the other stats.
+    stats.dumpStats(&output, true);
+    vector<uint8_t> outputAfterReset;
+    stats.dumpStats(&outputAfterReset, false);
+    good = report.ParseFromArray(&outputAfterReset[0], outputAfterReset.size());
+    EXPECT_TRUE(good);
+    ASSERT_EQ(1, report.config_stats_size());
+    EXPECT_EQ(0, report.config_stats(0).matcher_time_stats_size());
+}
+
 TEST(StatsdStatsTest, TestAnomalyMonitor) {
     StatsdStats stats;
     stats.noteRegisteredAnomalyAlarmChanged();
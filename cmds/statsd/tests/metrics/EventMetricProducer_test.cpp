@@ -126,6 +126,49 @@ TEST(EventMetricProducerTest, TestEventsWithSlicedCondition) {
     // eventProducer.onDumpReport();
 }
 
+TEST(EventMetricProducerTest, TestSpillToDisk) {
+    int64_t bucketStartTimeNs = 10000000000;
+
+    EventMetric metric;
+    metric.set_id(1);
+
+    sp<MockConditionWizard> wizard = new NaggyMock<MockConditionWizard>();
+
+    EventMetricProducer eventProducer(kConfigKey, metric, -1 /*-1 meaning no condition*/, wizard,
+                                      bucketStartTimeNs);
+
+    const int kEventCount = 100;
+    // The timestamps are truncated to five minutes.
+    const int64_t kEventIntervalNs = 5 * 60 * NS_PER_SEC;
+    for (int i = 0; i < kEventCount; i++) {
+        LogEvent event(1 /*tag id*/, bucketStartTimeNs + i * kEventIntervalNs);
+        event.write(string(1000, 'a'));
+        event.init();
+        eventProducer.onMatchedLogEvent(1 /*matcher index*/, event);
+    }
+    EXPECT_GT(eventProducer.spilledByteSize(), 0u);
+    EXPECT_LT(eventProducer.byteSize(), EventMetricProducer::kSpillThresholdBytes);
+
+    ProtoOutputStream output;
+    eventProducer.onDumpReport(bucketStartTimeNs + kEventCount * kEventIntervalNs, true, nullptr,
+                               &output);
+    EXPECT_EQ(0u, eventProducer.spilledByteSize());
+
+    string bytes;
+    auto iter = output.data();
+    while (iter.readBuffer() != NULL) {
+        bytes.append(iter.readBuffer(), iter.currentToRead());
+        iter.rp()->move(iter.currentToRead());
+    }
+    StatsLogReport report;
+    ASSERT_TRUE(report.ParseFromString(bytes));
+    // The spilled events come first, in the order they were logged.
+    ASSERT_EQ(kEventCount, report.event_metrics().data_size());
+    for (int i = 0; i < kEventCount; i++) {
+        EXPECT_EQ(i * kEventIntervalNs, report.event_metrics().data(i).elapsed_timestamp_nanos());
+    }
+}
+
 }  // namespace statsd
 }  // namespace os
 }  // namespace android
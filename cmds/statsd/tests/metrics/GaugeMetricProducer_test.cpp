@@ -47,6 +47,16 @@ const int64_t bucket3StartTimeNs = bucketStartTimeNs + 2 * bucketSizeNs;
 const int64_t bucket4StartTimeNs = bucketStartTimeNs + 3 * bucketSizeNs;
 const int64_t eventUpgradeTimeNs = bucketStartTimeNs + 15 * NS_PER_SEC;
 
+// The fields of the atom as they're reported. Empty matchers mean all the fields.
+static vector<FieldValue> trimmedFields(const vector<Matcher>& matchers, const GaugeAtom& atom) {
+    if (matchers.empty()) {
+        return *atom.mFields;
+    }
+    vector<FieldValue> fields;
+    filterGaugeValues(matchers, *atom.mFields, &fields);
+    return fields;
+}
+
 TEST(GaugeMetricProducerTest, TestNoCondition) {
     GaugeMetric metric;
     metric.set_id(metricId);
@@ -81,7 +91,9 @@ TEST(GaugeMetricProducerTest, TestNoCondition) {
 
     gaugeProducer.onDataPulled(allData);
     EXPECT_EQ(1UL, gaugeProducer.mCurrentSlicedBucket->size());
-    auto it = gaugeProducer.mCurrentSlicedBucket->begin()->second.front().mFields->begin();
+    auto fields = trimmedFields(gaugeProducer.mFieldMatchers,
+                                gaugeProducer.mCurrentSlicedBucket->begin()->second.front());
+    auto it = fields.begin();
     EXPECT_EQ(INT, it->mValue.getType());
     EXPECT_EQ(10, it->mValue.int_value);
     it++;
@@ -98,7 +110,9 @@ TEST(GaugeMetricProducerTest, TestNoCondition) {
     allData.push_back(event2);
     gaugeProducer.onDataPulled(allData);
     EXPECT_EQ(1UL, gaugeProducer.mCurrentSlicedBucket->size());
-    it = gaugeProducer.mCurrentSlicedBucket->begin()->second.front().mFields->begin();
+    fields = trimmedFields(gaugeProducer.mFieldMatchers,
+                           gaugeProducer.mCurrentSlicedBucket->begin()->second.front());
+    it = fields.begin();
     EXPECT_EQ(INT, it->mValue.getType());
     EXPECT_EQ(24, it->mValue.int_value);
     it++;
@@ -107,7 +121,9 @@ TEST(GaugeMetricProducerTest, TestNoCondition) {
     // One dimension.
     EXPECT_EQ(1UL, gaugeProducer.mPastBuckets.size());
     EXPECT_EQ(1UL, gaugeProducer.mPastBuckets.begin()->second.size());
-    it = gaugeProducer.mPastBuckets.begin()->second.back().mGaugeAtoms.front().mFields->begin();
+    fields = trimmedFields(gaugeProducer.mFieldMatchers,
+                           gaugeProducer.mPastBuckets.begin()->second.back().mGaugeAtoms.front());
+    it = fields.begin();
     EXPECT_EQ(INT, it->mValue.getType());
     EXPECT_EQ(10L, it->mValue.int_value);
     it++;
@@ -119,7 +135,9 @@ TEST(GaugeMetricProducerTest, TestNoCondition) {
     // One dimension.
     EXPECT_EQ(1UL, gaugeProducer.mPastBuckets.size());
     EXPECT_EQ(2UL, gaugeProducer.mPastBuckets.begin()->second.size());
-    it = gaugeProducer.mPastBuckets.begin()->second.back().mGaugeAtoms.front().mFields->begin();
+    fields = trimmedFields(gaugeProducer.mFieldMatchers,
+                           gaugeProducer.mPastBuckets.begin()->second.back().mGaugeAtoms.front());
+    it = fields.begin();
     EXPECT_EQ(INT, it->mValue.getType());
     EXPECT_EQ(24L, it->mValue.int_value);
     it++;
@@ -127,6 +145,74 @@ TEST(GaugeMetricProducerTest, TestNoCondition) {
     EXPECT_EQ(25L, it->mValue.int_value);
 }
 
+TEST(GaugeMetricProducerTest, TestPulledAtomsShareFields) {
+    GaugeMetric allFieldsMetric;
+    allFieldsMetric.set_id(metricId);
+    allFieldsMetric.set_bucket(ONE_MINUTE);
+    allFieldsMetric.mutable_gauge_fields_filter()->set_include_all(true);
+    GaugeMetric oneFieldMetric = allFieldsMetric;
+    oneFieldMetric.set_id(metricId + 1);
+    oneFieldMetric.mutable_gauge_fields_filter()->set_include_all(false);
+    auto gaugeFieldMatcher = oneFieldMetric.mutable_gauge_fields_filter()->mutable_fields();
+    gaugeFieldMatcher->set_field(tagId);
+    gaugeFieldMatcher->add_child()->set_field(3);
+
+    sp<MockConditionWizard> wizard = new NaggyMock<MockConditionWizard>();
+    shared_ptr<MockStatsPullerManager> pullerManager =
+            make_shared<StrictMock<MockStatsPullerManager>>();
+    EXPECT_CALL(*pullerManager, RegisterReceiver(tagId, _, _, _)).WillRepeatedly(Return());
+    EXPECT_CALL(*pullerManager, UnRegisterReceiver(tagId, _)).WillRepeatedly(Return());
+
+    GaugeMetricProducer allFieldsProducer(kConfigKey, allFieldsMetric, -1, wizard, tagId,
+                                          bucketStartTimeNs, bucketStartTimeNs, pullerManager);
+    GaugeMetricProducer oneFieldProducer(kConfigKey, oneFieldMetric, -1, wizard, tagId,
+                                         bucketStartTimeNs, bucketStartTimeNs, pullerManager);
+
+    shared_ptr<LogEvent> event = make_shared<LogEvent>(tagId, bucketStartTimeNs + 1);
+    event->write(10);
+    event->write("some value");
+    event->write(11);
+    event->init();
+    allFieldsProducer.onDataPulled({event});
+    oneFieldProducer.onDataPulled({event});
+
+    // Both metrics keep the same copy of the fields.
+    const GaugeAtom& allFieldsAtom = allFieldsProducer.mCurrentSlicedBucket->begin()->second[0];
+    const GaugeAtom& oneFieldAtom = oneFieldProducer.mCurrentSlicedBucket->begin()->second[0];
+    EXPECT_EQ(allFieldsAtom.mFields.get(), oneFieldAtom.mFields.get());
+    EXPECT_EQ(3UL, allFieldsAtom.mFields->size());
+
+    // The whitelist is only applied when the fields are read.
+    EXPECT_EQ(3UL, trimmedFields(allFieldsProducer.mFieldMatchers, allFieldsAtom).size());
+    vector<FieldValue> fields = trimmedFields(oneFieldProducer.mFieldMatchers, oneFieldAtom);
+    ASSERT_EQ(1UL, fields.size());
+    EXPECT_EQ(11, fields[0].mValue.int_value);
+
+    // Each metric counts all the fields it keeps alive.
+    event.reset();
+    allFieldsProducer.flushIfNeededLocked(bucket2StartTimeNs + 1);
+    oneFieldProducer.flushIfNeededLocked(bucket2StartTimeNs + 1);
+    EXPECT_EQ(3 * sizeof(FieldValue) + sizeof(GaugeAtom), allFieldsProducer.byteSizeLocked());
+    EXPECT_EQ(3 * sizeof(FieldValue) + sizeof(GaugeAtom), oneFieldProducer.byteSizeLocked());
+
+    // Fields only one metric holds are trimmed to its whitelist when a bucket is flushed.
+    shared_ptr<LogEvent> event2 = make_shared<LogEvent>(tagId, bucket2StartTimeNs + 2);
+    event2->write(10);
+    event2->write("other value");
+    event2->write(12);
+    event2->init();
+    oneFieldProducer.onDataPulled({event2});
+    event2.reset();
+    oneFieldProducer.flushIfNeededLocked(bucket3StartTimeNs + 1);
+    EXPECT_EQ(4 * sizeof(FieldValue) + 2 * sizeof(GaugeAtom), oneFieldProducer.byteSizeLocked());
+    const GaugeAtom& trimmedAtom = oneFieldProducer.mPastBuckets.begin()->second.back()
+                                           .mGaugeAtoms[0];
+    EXPECT_TRUE(trimmedAtom.mTrimmed);
+    fields = trimmedFields(oneFieldProducer.mFieldMatchers, trimmedAtom);
+    ASSERT_EQ(1UL, fields.size());
+    EXPECT_EQ(12, fields[0].mValue.int_value);
+}
+
 TEST(GaugeMetricProducerTest, TestPushedEventsWithUpgrade) {
     sp<AlarmMonitor> alarmMonitor;
     GaugeMetric metric;
@@ -239,20 +325,20 @@ TEST(GaugeMetricProducerTest, TestPulledWithUpgrade) {
     allData.push_back(event);
     gaugeProducer.onDataPulled(allData);
     EXPECT_EQ(1UL, gaugeProducer.mCurrentSlicedBucket->size());
-    EXPECT_EQ(1, gaugeProducer.mCurrentSlicedBucket->begin()
-                         ->second.front()
-                         .mFields->begin()
-                         ->mValue.int_value);
+    EXPECT_EQ(1, trimmedFields(gaugeProducer.mFieldMatchers,
+                               gaugeProducer.mCurrentSlicedBucket->begin()->second.front())
+                     .begin()
+                     ->mValue.int_value);
 
     gaugeProducer.notifyAppUpgrade(eventUpgradeTimeNs, "ANY.APP", 1, 1);
     EXPECT_EQ(1UL, gaugeProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY].size());
     EXPECT_EQ(0L, gaugeProducer.mCurrentBucketNum);
     EXPECT_EQ((int64_t)eventUpgradeTimeNs, gaugeProducer.mCurrentBucketStartTimeNs);
     EXPECT_EQ(1UL, gaugeProducer.mCurrentSlicedBucket->size());
-    EXPECT_EQ(2, gaugeProducer.mCurrentSlicedBucket->begin()
-                         ->second.front()
-                         .mFields->begin()
-                         ->mValue.int_value);
+    EXPECT_EQ(2, trimmedFields(gaugeProducer.mFieldMatchers,
+                               gaugeProducer.mCurrentSlicedBucket->begin()->second.front())
+                     .begin()
+                     ->mValue.int_value);
 
     allData.clear();
     event = make_shared<LogEvent>(tagId, bucketStartTimeNs + bucketSizeNs + 1);
@@ -263,10 +349,10 @@ TEST(GaugeMetricProducerTest, TestPulledWithUpgrade) {
     gaugeProducer.onDataPulled(allData);
     EXPECT_EQ(2UL, gaugeProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY].size());
     EXPECT_EQ(1UL, gaugeProducer.mCurrentSlicedBucket->size());
-    EXPECT_EQ(3, gaugeProducer.mCurrentSlicedBucket->begin()
-                         ->second.front()
-                         .mFields->begin()
-                         ->mValue.int_value);
+    EXPECT_EQ(3, trimmedFields(gaugeProducer.mFieldMatchers,
+                               gaugeProducer.mCurrentSlicedBucket->begin()->second.front())
+                     .begin()
+                     ->mValue.int_value);
 }
 
 TEST(GaugeMetricProducerTest, TestWithCondition) {
@@ -302,10 +388,10 @@ TEST(GaugeMetricProducerTest, TestWithCondition) {
 
     gaugeProducer.onConditionChanged(true, bucketStartTimeNs + 8);
     EXPECT_EQ(1UL, gaugeProducer.mCurrentSlicedBucket->size());
-    EXPECT_EQ(100, gaugeProducer.mCurrentSlicedBucket->begin()
-                           ->second.front()
-                           .mFields->begin()
-                           ->mValue.int_value);
+    EXPECT_EQ(100, trimmedFields(gaugeProducer.mFieldMatchers,
+                                 gaugeProducer.mCurrentSlicedBucket->begin()->second.front())
+                       .begin()
+                       ->mValue.int_value);
     EXPECT_EQ(0UL, gaugeProducer.mPastBuckets.size());
 
     vector<shared_ptr<LogEvent>> allData;
@@ -318,26 +404,26 @@ TEST(GaugeMetricProducerTest, TestWithCondition) {
     gaugeProducer.onDataPulled(allData);
 
     EXPECT_EQ(1UL, gaugeProducer.mCurrentSlicedBucket->size());
-    EXPECT_EQ(110, gaugeProducer.mCurrentSlicedBucket->begin()
-                           ->second.front()
-                           .mFields->begin()
-                           ->mValue.int_value);
+    EXPECT_EQ(110, trimmedFields(gaugeProducer.mFieldMatchers,
+                                 gaugeProducer.mCurrentSlicedBucket->begin()->second.front())
+                       .begin()
+                       ->mValue.int_value);
     EXPECT_EQ(1UL, gaugeProducer.mPastBuckets.size());
-    EXPECT_EQ(100, gaugeProducer.mPastBuckets.begin()
-                           ->second.back()
-                           .mGaugeAtoms.front()
-                           .mFields->begin()
-                           ->mValue.int_value);
+    EXPECT_EQ(100, trimmedFields(gaugeProducer.mFieldMatchers,
+                                 gaugeProducer.mPastBuckets.begin()->second.back()
+                                         .mGaugeAtoms.front())
+                       .begin()
+                       ->mValue.int_value);
 
     gaugeProducer.onConditionChanged(false, bucket2StartTimeNs + 10);
     gaugeProducer.flushIfNeededLocked(bucket3StartTimeNs + 10);
     EXPECT_EQ(1UL, gaugeProducer.mPastBuckets.size());
     EXPECT_EQ(2UL, gaugeProducer.mPastBuckets.begin()->second.size());
-    EXPECT_EQ(110L, gaugeProducer.mPastBuckets.begin()
-                            ->second.back()
-                            .mGaugeAtoms.front()
-                            .mFields->begin()
-                            ->mValue.int_value);
+    EXPECT_EQ(110L, trimmedFields(gaugeProducer.mFieldMatchers,
+                                  gaugeProducer.mPastBuckets.begin()->second.back()
+                                          .mGaugeAtoms.front())
+                        .begin()
+                        ->mValue.int_value);
 }
 
 TEST(GaugeMetricProducerTest, TestWithSlicedCondition) {
@@ -453,10 +539,10 @@ TEST(GaugeMetricProducerTest, TestAnomalyDetection) {
 
     gaugeProducer.onDataPulled({event1});
     EXPECT_EQ(1UL, gaugeProducer.mCurrentSlicedBucket->size());
-    EXPECT_EQ(13L, gaugeProducer.mCurrentSlicedBucket->begin()
-                           ->second.front()
-                           .mFields->begin()
-                           ->mValue.int_value);
+    EXPECT_EQ(13L, trimmedFields(gaugeProducer.mFieldMatchers,
+                                 gaugeProducer.mCurrentSlicedBucket->begin()->second.front())
+                       .begin()
+                       ->mValue.int_value);
     EXPECT_EQ(anomalyTracker->getRefractoryPeriodEndsSec(DEFAULT_METRIC_DIMENSION_KEY), 0U);
 
     std::shared_ptr<LogEvent> event2 =
@@ -467,10 +553,10 @@ TEST(GaugeMetricProducerTest, TestAnomalyDetection) {
 
     gaugeProducer.onDataPulled({event2});
     EXPECT_EQ(1UL, gaugeProducer.mCurrentSlicedBucket->size());
-    EXPECT_EQ(15L, gaugeProducer.mCurrentSlicedBucket->begin()
-                           ->second.front()
-                           .mFields->begin()
-                           ->mValue.int_value);
+    EXPECT_EQ(15L, trimmedFields(gaugeProducer.mFieldMatchers,
+                                 gaugeProducer.mCurrentSlicedBucket->begin()->second.front())
+                       .begin()
+                       ->mValue.int_value);
     EXPECT_EQ(anomalyTracker->getRefractoryPeriodEndsSec(DEFAULT_METRIC_DIMENSION_KEY),
             std::ceil(1.0 * event2->GetElapsedTimestampNs() / NS_PER_SEC) + refPeriodSec);
 
@@ -482,10 +568,10 @@ TEST(GaugeMetricProducerTest, TestAnomalyDetection) {
 
     gaugeProducer.onDataPulled({event3});
     EXPECT_EQ(1UL, gaugeProducer.mCurrentSlicedBucket->size());
-    EXPECT_EQ(26L, gaugeProducer.mCurrentSlicedBucket->begin()
-                           ->second.front()
-                           .mFields->begin()
-                           ->mValue.int_value);
+    EXPECT_EQ(26L, trimmedFields(gaugeProducer.mFieldMatchers,
+                                 gaugeProducer.mCurrentSlicedBucket->begin()->second.front())
+                       .begin()
+                       ->mValue.int_value);
     EXPECT_EQ(anomalyTracker->getRefractoryPeriodEndsSec(DEFAULT_METRIC_DIMENSION_KEY),
             std::ceil(1.0 * event2->GetElapsedTimestampNs() / NS_PER_SEC + refPeriodSec));
 
@@ -496,7 +582,9 @@ TEST(GaugeMetricProducerTest, TestAnomalyDetection) {
     event4->init();
     gaugeProducer.onDataPulled({event4});
     EXPECT_EQ(1UL, gaugeProducer.mCurrentSlicedBucket->size());
-    EXPECT_TRUE(gaugeProducer.mCurrentSlicedBucket->begin()->second.front().mFields->empty());
+    EXPECT_TRUE(trimmedFields(gaugeProducer.mFieldMatchers,
+                              gaugeProducer.mCurrentSlicedBucket->begin()->second.front())
+                    .empty());
 }
 
 }  // namespace statsd
@@ -0,0 +1,75 @@
+// Copyright (C) 2018 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/metrics/CountMetricProducer.h"
+#include "src/metrics/PastBuckets.h"
+#include "metrics_test_helper.h"
+
+#include <gtest/gtest.h>
+
+#ifdef __ANDROID__
+
+namespace android {
+namespace os {
+namespace statsd {
+
+TEST(PastBucketsTest, TestBoundariesAreShared) {
+    PastBuckets<CountBucket, &CountBucket::mCount> buckets;
+    EXPECT_TRUE(buckets.empty());
+    MetricDimensionKey key1 = getMockedMetricDimensionKey(1, 1, "a");
+    MetricDimensionKey key2 = getMockedMetricDimensionKey(1, 1, "b");
+
+    buckets.add(key1, 10, 20, 1);
+    buckets.add(key2, 10, 20, 2);
+    buckets.add(key1, 20, 25, 3);
+
+    EXPECT_EQ(2UL, buckets.size());
+    // Two boundaries and three values.
+    EXPECT_EQ(2 * 16UL + 3 * 12UL, buckets.byteSize());
+
+    ASSERT_EQ(2UL, buckets[key1].size());
+    EXPECT_EQ(10, buckets[key1][0].mBucketStartNs);
+    EXPECT_EQ(20, buckets[key1][0].mBucketEndNs);
+    EXPECT_EQ(1, buckets[key1][0].mCount);
+    EXPECT_EQ(20, buckets[key1].back().mBucketStartNs);
+    EXPECT_EQ(25, buckets[key1].back().mBucketEndNs);
+    EXPECT_EQ(3, buckets[key1].back().mCount);
+    ASSERT_EQ(1UL, buckets[key2].size());
+    EXPECT_EQ(10, buckets[key2][0].mBucketStartNs);
+    EXPECT_EQ(2, buckets[key2][0].mCount);
+
+    int64_t total = 0;
+    for (const auto& pair : buckets) {
+        for (const auto& bucket : pair.second) {
+            total += bucket.mCount;
+        }
+    }
+    EXPECT_EQ(6, total);
+
+    // Reading a missing key doesn't add it.
+    EXPECT_TRUE(buckets[DEFAULT_METRIC_DIMENSION_KEY].empty());
+    EXPECT_TRUE(buckets.find(DEFAULT_METRIC_DIMENSION_KEY) == buckets.end());
+    EXPECT_EQ(2UL, buckets.size());
+
+    buckets.clear();
+    EXPECT_TRUE(buckets.empty());
+    EXPECT_EQ(0UL, buckets.byteSize());
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
+#else
+GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
@@ -278,6 +278,70 @@ TEST(ValueMetricProducerTest, TestPulledEventsTakeZeroOnReset) {
 /*
  * Test pulled event with non sliced condition.
  */
+/*
+ * Tests pulled atoms with many rows for each pull, diffed by dimension.
+ */
+TEST(ValueMetricProducerTest, TestPulledEventsWithDimensions) {
+    ValueMetric metric;
+    metric.set_id(metricId);
+    metric.set_bucket(ONE_MINUTE);
+    metric.mutable_value_field()->set_field(tagId);
+    metric.mutable_value_field()->add_child()->set_field(2);
+    metric.mutable_dimensions_in_what()->set_field(tagId);
+    metric.mutable_dimensions_in_what()->add_child()->set_field(1);
+
+    sp<MockConditionWizard> wizard = new NaggyMock<MockConditionWizard>();
+    shared_ptr<MockStatsPullerManager> pullerManager =
+            make_shared<StrictMock<MockStatsPullerManager>>();
+    EXPECT_CALL(*pullerManager, RegisterReceiver(tagId, _, _, _)).WillOnce(Return());
+    EXPECT_CALL(*pullerManager, UnRegisterReceiver(tagId, _)).WillOnce(Return());
+
+    ValueMetricProducer valueProducer(kConfigKey, metric, -1 /*-1 meaning no condition*/, wizard,
+                                      tagId, bucketStartTimeNs, bucketStartTimeNs, pullerManager);
+    valueProducer.setBucketSize(60 * NS_PER_SEC);
+
+    auto makeRow = [](int64_t timeNs, int uid, int64_t value) {
+        shared_ptr<LogEvent> event = make_shared<LogEvent>(tagId, timeNs);
+        event->write(uid);
+        event->write(value);
+        event->init();
+        return event;
+    };
+
+    vector<shared_ptr<LogEvent>> allData;
+    for (int uid = 1; uid <= 3; uid++) {
+        allData.push_back(makeRow(bucket2StartTimeNs + 1, uid, uid * 10));
+    }
+    valueProducer.onDataPulled(allData);
+    EXPECT_EQ(3UL, valueProducer.mCurrentSlicedBucket.size());
+    for (const auto& slice : valueProducer.mCurrentSlicedBucket) {
+        EXPECT_TRUE(slice.second.startUpdated);
+        EXPECT_EQ(0, slice.second.sum);
+    }
+
+    // Uid 1 goes away, uid 4 shows up and uid 3 goes backwards.
+    allData.clear();
+    allData.push_back(makeRow(bucket3StartTimeNs + 1, 4, 5));
+    allData.push_back(makeRow(bucket3StartTimeNs + 1, 3, 25));
+    allData.push_back(makeRow(bucket3StartTimeNs + 1, 2, 27));
+    valueProducer.onDataPulled(allData);
+    EXPECT_EQ(3UL, valueProducer.mCurrentSlicedBucket.size());
+    for (const auto& slice : valueProducer.mCurrentSlicedBucket) {
+        EXPECT_TRUE(slice.second.startUpdated);
+        EXPECT_EQ(0, slice.second.tainted);
+    }
+
+    // Only uid 2 has a value in the bucket, uid 3 was dropped.
+    ASSERT_EQ(1UL, valueProducer.mPastBuckets.size());
+    const auto& buckets = valueProducer.mPastBuckets.begin()->second;
+    EXPECT_EQ(2, valueProducer.mPastBuckets.begin()->first.getDimensionKeyInWhat()
+                         .getValues()[0].mValue.int_value);
+    ASSERT_EQ(1UL, buckets.size());
+    EXPECT_EQ(7, buckets.back().mValue);
+    EXPECT_EQ(bucket2StartTimeNs, buckets.back().mBucketStartNs);
+    EXPECT_EQ(bucket3StartTimeNs, buckets.back().mBucketEndNs);
+}
+
 TEST(ValueMetricProducerTest, TestEventsWithNonSlicedCondition) {
     ValueMetric metric;
     metric.set_id(metricId);
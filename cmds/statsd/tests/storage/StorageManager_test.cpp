@@ -0,0 +1,144 @@
+// Copyright (C) 2018 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/storage/StorageManager.h"
+#include "frameworks/base/cmds/statsd/src/stats_log.pb.h"
+
+#include <android-base/file.h>
+#include <dirent.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#ifdef __ANDROID__
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using android::util::FIELD_TYPE_INT64;
+using android::util::ProtoOutputStream;
+
+const int FIELD_ID_CURRENT_REPORT_ELAPSED_NANOS = 4;
+
+static const ConfigKey kConfigKey(12345, 678);
+
+static bool appendReport(int64_t elapsedNanos) {
+    ProtoOutputStream report;
+    report.write(FIELD_TYPE_INT64 | FIELD_ID_CURRENT_REPORT_ELAPSED_NANOS,
+                 (long long)elapsedNanos);
+    return StorageManager::appendToReportLog(kConfigKey, &report);
+}
+
+static ConfigMetricsReportList dumpReports() {
+    ProtoOutputStream proto;
+    StorageManager::appendConfigMetricsReport(kConfigKey, &proto);
+    string bytes;
+    auto iter = proto.data();
+    while (iter.readBuffer() != NULL) {
+        bytes.append(iter.readBuffer(), iter.currentToRead());
+        iter.rp()->move(iter.currentToRead());
+    }
+    ConfigMetricsReportList reports;
+    EXPECT_TRUE(reports.ParseFromString(bytes));
+    return reports;
+}
+
+// Returns the path of the report log of kConfigKey.
+static string findReportLog() {
+    string suffix = "_12345_678";
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir("/data/misc/stats-data"), closedir);
+    dirent* de;
+    while (dir != NULL && (de = readdir(dir.get()))) {
+        string name = de->d_name;
+        if (name.size() > suffix.size() &&
+            name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            return "/data/misc/stats-data/" + name;
+        }
+    }
+    return "";
+}
+
+TEST(StorageManagerTest, TestReportLog) {
+    dumpReports();
+    EXPECT_FALSE(StorageManager::hasConfigMetricsReport(kConfigKey));
+
+    EXPECT_TRUE(appendReport(1));
+    EXPECT_TRUE(appendReport(2));
+    EXPECT_TRUE(StorageManager::hasConfigMetricsReport(kConfigKey));
+
+    // A report torn by a crash is dropped by the next append.
+    string log = findReportLog();
+    ASSERT_FALSE(log.empty());
+    FILE* file = fopen(log.c_str(), "a");
+    ASSERT_NE(nullptr, file);
+    fwrite("\x12\x40\x20", 1, 3, file);
+    fclose(file);
+    EXPECT_TRUE(appendReport(3));
+
+    ConfigMetricsReportList reports = dumpReports();
+    ASSERT_EQ(3, reports.reports_size());
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(i + 1, reports.reports(i).current_report_elapsed_nanos());
+    }
+    EXPECT_FALSE(StorageManager::hasConfigMetricsReport(kConfigKey));
+}
+
+TEST(StorageManagerTest, TestWriteReportsToFd) {
+    dumpReports();
+    EXPECT_TRUE(appendReport(1));
+    EXPECT_TRUE(appendReport(2));
+
+    FILE* out = tmpfile();
+    ASSERT_NE(nullptr, out);
+    size_t size = 0;
+    EXPECT_TRUE(StorageManager::writeConfigMetricsReports(kConfigKey, fileno(out), &size));
+    EXPECT_FALSE(StorageManager::hasConfigMetricsReport(kConfigKey));
+
+    string bytes;
+    lseek(fileno(out), 0, SEEK_SET);
+    ASSERT_TRUE(android::base::ReadFdToString(fileno(out), &bytes));
+    fclose(out);
+    EXPECT_EQ(bytes.size(), size);
+    ConfigMetricsReportList reports;
+    ASSERT_TRUE(reports.ParseFromString(bytes));
+    ASSERT_EQ(2, reports.reports_size());
+    EXPECT_EQ(1, reports.reports(0).current_report_elapsed_nanos());
+    EXPECT_EQ(2, reports.reports(1).current_report_elapsed_nanos());
+}
+
+TEST(StorageManagerTest, TestCompactReportLog) {
+    dumpReports();
+    EXPECT_TRUE(appendReport(1));
+    EXPECT_TRUE(appendReport(2));
+    EXPECT_TRUE(appendReport(3));
+    string log = findReportLog();
+    ASSERT_FALSE(log.empty());
+
+    // The magic, then three reports of 2 bytes, each with a 2 bytes header.
+    EXPECT_EQ(16, StorageManager::compactReportLog(log, 16));
+    EXPECT_EQ(12, StorageManager::compactReportLog(log, 15));
+    EXPECT_EQ(-1, StorageManager::compactReportLog(log, 7));
+
+    ConfigMetricsReportList reports = dumpReports();
+    ASSERT_EQ(2, reports.reports_size());
+    EXPECT_EQ(2, reports.reports(0).current_report_elapsed_nanos());
+    EXPECT_EQ(3, reports.reports(1).current_report_elapsed_nanos());
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
+#else
+GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
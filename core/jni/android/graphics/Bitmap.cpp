@@ -32,8 +32,12 @@
 
 #include <jni.h>
 #include <string.h>
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #define DEBUG_PARCEL 0
 #define ASHMEM_BITMAP_MIN_SIZE (128 * (1 << 10))
@@ -891,36 +895,25 @@ enum JavaEncodeFormat {
     kWEBP_JavaEncodeFormat = 2
 };
 
-static jboolean Bitmap_compress(JNIEnv* env, jobject clazz, jlong bitmapHandle,
-                                jint format, jint quality,
-                                jobject jstream, jbyteArray jstorage) {
-    SkEncodedImageFormat fm;
+static bool toEncodedImageFormat(jint format, SkEncodedImageFormat* outFormat) {
     switch (format) {
     case kJPEG_JavaEncodeFormat:
-        fm = SkEncodedImageFormat::kJPEG;
-        break;
+        *outFormat = SkEncodedImageFormat::kJPEG;
+        return true;
     case kPNG_JavaEncodeFormat:
-        fm = SkEncodedImageFormat::kPNG;
-        break;
+        *outFormat = SkEncodedImageFormat::kPNG;
+        return true;
     case kWEBP_JavaEncodeFormat:
-        fm = SkEncodedImageFormat::kWEBP;
-        break;
+        *outFormat = SkEncodedImageFormat::kWEBP;
+        return true;
     default:
-        return JNI_FALSE;
-    }
-
-    LocalScopedBitmap bitmap(bitmapHandle);
-    if (!bitmap.valid()) {
-        return JNI_FALSE;
-    }
-
-    std::unique_ptr<SkWStream> strm(CreateJavaOutputStreamAdaptor(env, jstream, jstorage));
-    if (!strm.get()) {
-        return JNI_FALSE;
+        return false;
     }
+}
 
-    SkBitmap skbitmap;
-    bitmap->getSkBitmap(&skbitmap);
+// Doesn't touch the JNIEnv, so Bitmap_compressBatch encodes with it on several threads.
+static bool encodeBitmap(SkBitmap skbitmap, SkEncodedImageFormat fm, int quality,
+                         SkWStream* strm) {
     if (skbitmap.colorType() == kRGBA_F16_SkColorType) {
         // Convert to P3 before encoding. This matches SkAndroidCodec::computeOutputColorSpace
         // for wide gamuts.
@@ -930,20 +923,116 @@ static jboolean Bitmap_compress(JNIEnv* env, jobject clazz, jlong bitmapHandle,
                                    .makeColorSpace(std::move(cs));
         SkBitmap p3;
         if (!p3.tryAllocPixels(info)) {
-            return JNI_FALSE;
+            return false;
         }
         auto xform = SkColorSpaceXform::New(skbitmap.colorSpace(), info.colorSpace());
         if (!xform) {
-            return JNI_FALSE;
+            return false;
         }
         if (!xform->apply(SkColorSpaceXform::kRGBA_8888_ColorFormat, p3.getPixels(),
                           SkColorSpaceXform::kRGBA_F16_ColorFormat, skbitmap.getPixels(),
                           info.width() * info.height(), kUnpremul_SkAlphaType)) {
-            return JNI_FALSE;
+            return false;
         }
         skbitmap = p3;
     }
-    return SkEncodeImage(strm.get(), skbitmap, fm, quality) ? JNI_TRUE : JNI_FALSE;
+    return SkEncodeImage(strm, skbitmap, fm, quality);
+}
+
+static jboolean Bitmap_compress(JNIEnv* env, jobject clazz, jlong bitmapHandle,
+                                jint format, jint quality,
+                                jobject jstream, jbyteArray jstorage) {
+    SkEncodedImageFormat fm;
+    if (!toEncodedImageFormat(format, &fm)) {
+        return JNI_FALSE;
+    }
+
+    LocalScopedBitmap bitmap(bitmapHandle);
+    if (!bitmap.valid()) {
+        return JNI_FALSE;
+    }
+
+    std::unique_ptr<SkWStream> strm(CreateJavaOutputStreamAdaptor(env, jstream, jstorage));
+    if (!strm.get()) {
+        return JNI_FALSE;
+    }
+
+    SkBitmap skbitmap;
+    bitmap->getSkBitmap(&skbitmap);
+    return encodeBitmap(skbitmap, fm, quality, strm.get()) ? JNI_TRUE : JNI_FALSE;
+}
+
+// The most threads Bitmap_compressBatch encodes on, including the calling one.
+static constexpr size_t kMaxCompressThreads = 4;
+
+// Encodes a batch of bitmaps with the same format and quality, up to kMaxCompressThreads at
+// a time. Returns the encoded bytes of each bitmap, null for the ones that failed.
+static jobjectArray Bitmap_compressBatch(JNIEnv* env, jobject clazz, jlongArray bitmapHandles,
+                                         jint format, jint quality) {
+    SkEncodedImageFormat fm;
+    if (!toEncodedImageFormat(format, &fm)) {
+        doThrowIAE(env, "unknown compress format");
+        return NULL;
+    }
+
+    const jsize count = env->GetArrayLength(bitmapHandles);
+    std::vector<jlong> handles(count);
+    env->GetLongArrayRegion(bitmapHandles, 0, count, handles.data());
+
+    // The pixels are gotten on the calling thread, a hardware bitmap is read back here.
+    std::vector<SkBitmap> skbitmaps(count);
+    for (jsize i = 0; i < count; i++) {
+        LocalScopedBitmap bitmap(handles[i]);
+        if (bitmap.valid()) {
+            bitmap->getSkBitmap(&skbitmaps[i]);
+        }
+    }
+
+    std::vector<std::unique_ptr<SkDynamicMemoryWStream>> results(count);
+    std::atomic<jsize> next(0);
+    auto encode = [&]() {
+        for (jsize i = next++; i < count; i = next++) {
+            if (skbitmaps[i].isNull()) {
+                continue;
+            }
+            std::unique_ptr<SkDynamicMemoryWStream> strm(new SkDynamicMemoryWStream());
+            if (encodeBitmap(skbitmaps[i], fm, quality, strm.get())) {
+                results[i] = std::move(strm);
+            }
+        }
+    };
+
+    const size_t threadCount = std::min(static_cast<size_t>(count), kMaxCompressThreads);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threadCount; i++) {
+        workers.emplace_back(encode);
+    }
+    encode();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    jclass byteArrayClass = env->FindClass("[B");
+    jobjectArray encoded = env->NewObjectArray(count, byteArrayClass, NULL);
+    if (encoded == NULL) {
+        return NULL;
+    }
+    for (jsize i = 0; i < count; i++) {
+        if (!results[i]) {
+            continue;
+        }
+        const size_t size = results[i]->bytesWritten();
+        jbyteArray bytes = env->NewByteArray(size);
+        if (bytes == NULL) {
+            return NULL;
+        }
+        jbyte* data = env->GetByteArrayElements(bytes, NULL);
+        results[i]->copyTo(data);
+        env->ReleaseByteArrayElements(bytes, data, 0);
+        env->SetObjectArrayElement(encoded, i, bytes);
+        env->DeleteLocalRef(bytes);
+    }
+    return encoded;
 }
 
 static void Bitmap_erase(JNIEnv* env, jobject, jlong bitmapHandle, jint color) {
@@ -1587,6 +1676,7 @@ static const JNINativeMethod gBitmapMethods[] = {
     {   "nativeReconfigure",        "(JIIIZ)V", (void*)Bitmap_reconfigure },
     {   "nativeCompress",           "(JIILjava/io/OutputStream;[B)Z",
         (void*)Bitmap_compress },
+    {   "nativeCompressBatch",      "([JII)[[B", (void*)Bitmap_compressBatch },
     {   "nativeErase",              "(JI)V", (void*)Bitmap_erase },
     {   "nativeRowBytes",           "(J)I", (void*)Bitmap_rowBytes },
     {   "nativeConfig",             "(J)I", (void*)Bitmap_config },
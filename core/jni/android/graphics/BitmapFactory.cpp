@@ -372,11 +372,20 @@ static jobject doDecode(JNIEnv* env, std::unique_ptr<SkStreamRewindable> stream,
                 bitmapInfo.makeColorType(kAlpha_8_SkColorType).makeAlphaType(kPremul_SkAlphaType);
     }
     SkBitmap decodingBitmap;
-    if (!decodingBitmap.setInfo(bitmapInfo) ||
-            !decodingBitmap.tryAllocPixels(decodeAllocator)) {
+    if (!decodingBitmap.setInfo(bitmapInfo)) {
         // SkAndroidCodec should recommend a valid SkImageInfo, so setInfo()
         // should only only fail if the calculated value for rowBytes is too
         // large.
+        return nullptr;
+    }
+
+    // Unscaled hardware bitmaps are decoded straight into a locked GraphicBuffer when its
+    // format matches the decode, which saves the heap copy and the upload.
+    sk_sp<Bitmap> hardwareBitmap;
+    if (isHardware && !willScale && javaBitmap == nullptr) {
+        hardwareBitmap = Bitmap::allocateWritableHardwareBitmap(&decodingBitmap);
+    }
+    if (!hardwareBitmap && !decodingBitmap.tryAllocPixels(decodeAllocator)) {
         // tryAllocPixels() can fail due to OOM on the Java heap, OOM on the
         // native heap, or the recycled javaBitmap being too small to reuse.
         return nullptr;
@@ -500,8 +509,16 @@ static jobject doDecode(JNIEnv* env, std::unique_ptr<SkStreamRewindable> stream,
     if (isMutable) bitmapCreateFlags |= android::bitmap::kBitmapCreateFlag_Mutable;
     if (isPremultiplied) bitmapCreateFlags |= android::bitmap::kBitmapCreateFlag_Premultiplied;
 
+    if (hardwareBitmap) {
+        // outputBitmap points to the locked pixels, which are no longer valid once unlocked
+        outputBitmap.reset();
+        hardwareBitmap->unlockPixels();
+        return bitmap::createBitmap(env, hardwareBitmap.release(), bitmapCreateFlags,
+                ninePatchChunk, ninePatchInsets, -1);
+    }
+
     if (isHardware) {
-        sk_sp<Bitmap> hardwareBitmap = Bitmap::allocateHardwareBitmap(outputBitmap);
+        hardwareBitmap = Bitmap::allocateHardwareBitmap(outputBitmap);
         if (!hardwareBitmap.get()) {
             return nullObjectReturn("Failed to allocate a hardware bitmap");
         }
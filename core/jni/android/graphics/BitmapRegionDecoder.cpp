@@ -39,12 +39,126 @@
 #include <jni.h>
 #include <sys/stat.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 using namespace android;
 
+namespace android {
+
+/*
+ * The decoders of one image. SkBitmapRegionDecoder isn't thread-safe, so every decode takes a
+ * decoder for itself. The first one owns the encoded data, the others are created on demand,
+ * up to the limit set with nativeSetMaxDecoders, from the same data without copying it.
+ */
+class BitmapRegionDecoderPool {
+public:
+    BitmapRegionDecoderPool(std::unique_ptr<SkBitmapRegionDecoder> decoder, const void* data,
+            size_t length)
+            : mPrimary(decoder.get()), mData(data), mLength(length) {
+        mIdle.push_back(std::move(decoder));
+        mDecoders.push_back(mPrimary);
+    }
+
+    ~BitmapRegionDecoderPool() {
+        // The other decoders read the data of the primary one.
+        std::unique_ptr<SkBitmapRegionDecoder> primary;
+        for (auto& decoder : mIdle) {
+            if (decoder.get() == mPrimary) {
+                primary = std::move(decoder);
+            }
+        }
+        mIdle.clear();
+    }
+
+    // For the properties of the image, which are the same for all the decoders.
+    SkBitmapRegionDecoder* primary() const {
+        return mPrimary;
+    }
+
+    void setMaxDecoders(size_t maxDecoders) {
+        std::lock_guard<std::mutex> lock(mLock);
+        // Can't have more decoders than the one that owns the data if it isn't in memory.
+        mMaxDecoders = mData != nullptr ? std::max<size_t>(maxDecoders, 1) : 1;
+    }
+
+    // Makes the decodes that are waiting for a decoder, or started before this, give up.
+    void cancelPending() {
+        mGeneration++;
+    }
+
+    uint32_t generation() const {
+        return mGeneration;
+    }
+
+    // Returns an idle decoder, or creates one, or waits for one to become idle. Returns null if
+    // the decodes of the generation were cancelled in the meantime.
+    std::unique_ptr<SkBitmapRegionDecoder> acquire(uint32_t generation) {
+        std::unique_lock<std::mutex> lock(mLock);
+        for (;;) {
+            if (generation != mGeneration) {
+                return nullptr;
+            }
+            if (!mIdle.empty()) {
+                std::unique_ptr<SkBitmapRegionDecoder> decoder = std::move(mIdle.back());
+                mIdle.pop_back();
+                return decoder;
+            }
+            if (mDecoders.size() < mMaxDecoders) {
+                std::unique_ptr<SkBitmapRegionDecoder> decoder(SkBitmapRegionDecoder::Create(
+                        new SkMemoryStream(mData, mLength, false),
+                        SkBitmapRegionDecoder::kAndroidCodec_Strategy));
+                if (decoder) {
+                    mDecoders.push_back(decoder.get());
+                    return decoder;
+                }
+                // Shouldn't happen as the primary decoder could be created, don't retry.
+                mMaxDecoders = mDecoders.size();
+            }
+            // Wakes up now and then to notice cancellation.
+            mIdleCondition.wait_for(lock, std::chrono::milliseconds(50));
+        }
+    }
+
+    void release(std::unique_ptr<SkBitmapRegionDecoder> decoder) {
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mIdle.push_back(std::move(decoder));
+        }
+        mIdleCondition.notify_one();
+    }
+
+private:
+    SkBitmapRegionDecoder* const mPrimary;
+    // The encoded data, owned by the stream of the primary decoder, or null if it isn't in
+    // memory.
+    const void* const mData;
+    const size_t mLength;
+
+    std::mutex mLock;
+    std::condition_variable mIdleCondition;
+    std::vector<std::unique_ptr<SkBitmapRegionDecoder>> mIdle;
+    // All the decoders, idle or not.
+    std::vector<SkBitmapRegionDecoder*> mDecoders;
+    size_t mMaxDecoders = 1;
+    std::atomic<uint32_t> mGeneration{0};
+};
+
+}  // namespace android
+
+static BitmapRegionDecoderPool* toPool(jlong brdHandle) {
+    return reinterpret_cast<BitmapRegionDecoderPool*>(brdHandle);
+}
+
 static jobject createBitmapRegionDecoder(JNIEnv* env, std::unique_ptr<SkStreamRewindable> stream) {
-  std::unique_ptr<SkBitmapRegionDecoder> brd(
+    const void* data = stream->getMemoryBase();
+    const size_t length = stream->getLength();
+    std::unique_ptr<SkBitmapRegionDecoder> brd(
             SkBitmapRegionDecoder::Create(stream.release(),
                                           SkBitmapRegionDecoder::kAndroidCodec_Strategy));
     if (!brd) {
@@ -52,7 +166,8 @@ static jobject createBitmapRegionDecoder(JNIEnv* env, std::unique_ptr<SkStreamRe
         return nullObjectReturn("CreateBitmapRegionDecoder returned null");
     }
 
-    return GraphicsJNI::createBitmapRegionDecoder(env, brd.release());
+    return GraphicsJNI::createBitmapRegionDecoder(env,
+            new BitmapRegionDecoderPool(std::move(brd), data, length));
 }
 
 static jobject nativeNewInstanceFromByteArray(JNIEnv* env, jobject, jbyteArray byteArray,
@@ -166,7 +281,14 @@ static jobject nativeDecodeRegion(JNIEnv* env, jobject, jlong brdHandle, jint in
         recycledBytes = bitmap::getBitmapAllocationByteCount(env, javaBitmap);
     }
 
-    SkBitmapRegionDecoder* brd = reinterpret_cast<SkBitmapRegionDecoder*>(brdHandle);
+    // Taken before anything else, so cancelling also covers the decodes that just started.
+    BitmapRegionDecoderPool* pool = toPool(brdHandle);
+    const uint32_t generation = pool->generation();
+    std::unique_ptr<SkBitmapRegionDecoder> decoder = pool->acquire(generation);
+    if (!decoder) {
+        return nullObjectReturn("Region decode cancelled.");
+    }
+    SkBitmapRegionDecoder* brd = decoder.get();
     SkColorType decodeColorType = brd->computeOutputColorType(colorType);
 
     // Set up the pixel allocator
@@ -187,8 +309,11 @@ static jobject nativeDecodeRegion(JNIEnv* env, jobject, jlong brdHandle, jint in
     // Decode the region.
     SkIRect subset = SkIRect::MakeXYWH(inputX, inputY, inputWidth, inputHeight);
     SkBitmap bitmap;
-    if (!brd->decodeRegion(&bitmap, allocator, subset, sampleSize,
-            decodeColorType, requireUnpremul, decodeColorSpace)) {
+    const bool decoded = generation == pool->generation() && brd->decodeRegion(&bitmap, allocator,
+            subset, sampleSize, decodeColorType, requireUnpremul, decodeColorSpace);
+    const SkEncodedImageFormat format = (SkEncodedImageFormat) brd->getEncodedFormat();
+    pool->release(std::move(decoder));
+    if (!decoded) {
         return nullObjectReturn("Failed to decode region.");
     }
 
@@ -198,7 +323,7 @@ static jobject nativeDecodeRegion(JNIEnv* env, jobject, jlong brdHandle, jint in
         env->SetIntField(options, gOptions_heightFieldID, bitmap.height());
 
         env->SetObjectField(options, gOptions_mimeFieldID,
-                encodedFormatToString(env, (SkEncodedImageFormat)brd->getEncodedFormat()));
+                encodedFormatToString(env, format));
         if (env->ExceptionCheck()) {
             return nullObjectReturn("OOM in encodedFormatToString()");
         }
@@ -234,21 +359,25 @@ static jobject nativeDecodeRegion(JNIEnv* env, jobject, jlong brdHandle, jint in
 }
 
 static jint nativeGetHeight(JNIEnv* env, jobject, jlong brdHandle) {
-    SkBitmapRegionDecoder* brd =
-            reinterpret_cast<SkBitmapRegionDecoder*>(brdHandle);
-    return static_cast<jint>(brd->height());
+    return static_cast<jint>(toPool(brdHandle)->primary()->height());
 }
 
 static jint nativeGetWidth(JNIEnv* env, jobject, jlong brdHandle) {
-    SkBitmapRegionDecoder* brd =
-            reinterpret_cast<SkBitmapRegionDecoder*>(brdHandle);
-    return static_cast<jint>(brd->width());
+    return static_cast<jint>(toPool(brdHandle)->primary()->width());
 }
 
 static void nativeClean(JNIEnv* env, jobject, jlong brdHandle) {
-    SkBitmapRegionDecoder* brd =
-            reinterpret_cast<SkBitmapRegionDecoder*>(brdHandle);
-    delete brd;
+    delete toPool(brdHandle);
+}
+
+// Lets up to maxDecoders regions of the image decode at the same time.
+static void nativeSetMaxDecoders(JNIEnv* env, jobject, jlong brdHandle, jint maxDecoders) {
+    toPool(brdHandle)->setMaxDecoders(maxDecoders > 0 ? maxDecoders : 1);
+}
+
+// Makes the region decodes that haven't started decoding yet return null.
+static void nativeCancelPendingDecodes(JNIEnv* env, jobject, jlong brdHandle) {
+    toPool(brdHandle)->cancelPending();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -264,6 +393,10 @@ static const JNINativeMethod gBitmapRegionDecoderMethods[] = {
 
     {   "nativeClean", "(J)V", (void*)nativeClean},
 
+    {   "nativeSetMaxDecoders", "(JI)V", (void*)nativeSetMaxDecoders},
+
+    {   "nativeCancelPendingDecodes", "(J)V", (void*)nativeCancelPendingDecodes},
+
     {   "nativeNewInstance",
         "([BIIZ)Landroid/graphics/BitmapRegionDecoder;",
         (void*)nativeNewInstanceFromByteArray
@@ -410,13 +410,14 @@ SkRegion* GraphicsJNI::getNativeRegion(JNIEnv* env, jobject region)
 
 ///////////////////////////////////////////////////////////////////////////////////////////
 
-jobject GraphicsJNI::createBitmapRegionDecoder(JNIEnv* env, SkBitmapRegionDecoder* bitmap)
+jobject GraphicsJNI::createBitmapRegionDecoder(JNIEnv* env,
+        android::BitmapRegionDecoderPool* decoder)
 {
-    ALOG_ASSERT(bitmap != NULL);
+    ALOG_ASSERT(decoder != NULL);
 
     jobject obj = env->NewObject(gBitmapRegionDecoder_class,
             gBitmapRegionDecoder_constructorMethodID,
-            reinterpret_cast<jlong>(bitmap));
+            reinterpret_cast<jlong>(decoder));
     hasException(env); // For the side effect of logging.
     return obj;
 }
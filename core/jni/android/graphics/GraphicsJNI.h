@@ -15,10 +15,10 @@
 #include <hwui/Canvas.h>
 #include <hwui/Bitmap.h>
 
-class SkBitmapRegionDecoder;
 class SkCanvas;
 
 namespace android {
+class BitmapRegionDecoderPool;
 class Paint;
 struct Typeface;
 }
@@ -84,7 +84,8 @@ public:
 
     static jobject createRegion(JNIEnv* env, SkRegion* region);
 
-    static jobject createBitmapRegionDecoder(JNIEnv* env, SkBitmapRegionDecoder* bitmap);
+    static jobject createBitmapRegionDecoder(JNIEnv* env,
+            android::BitmapRegionDecoderPool* decoder);
 
     static android::Bitmap* mapAshmemBitmap(JNIEnv* env, SkBitmap* bitmap,
             int fd, void* addr, size_t size, bool readOnly);
@@ -271,13 +271,24 @@ static jobject ImageDecoder_nDecodeBitmap(JNIEnv* env, jobject /*clazz*/, jlong
     }
 
     sk_sp<Bitmap> nativeBitmap;
+    // An immutable result that is neither scaled, subset nor post-processed can be decoded
+    // straight into a locked GraphicBuffer, skipping the heap copy and the upload below.
+    const bool wantsHardware = allocator == ImageDecoder::kDefault_Allocator ||
+                               allocator == ImageDecoder::kHardware_Allocator;
+    if (wantsHardware && !requireMutable && !scale && !jsubset && !jpostProcess) {
+        nativeBitmap = Bitmap::allocateWritableHardwareBitmap(&bm);
+    }
+    const bool decodedToHardware = nativeBitmap != nullptr;
+
     // If we are going to scale or subset, we will create a new bitmap later on,
     // so use the heap for the temporary.
     // FIXME: Use scanline decoding on only a couple lines to save memory. b/70709380.
-    if (allocator == ImageDecoder::kSharedMemory_Allocator && !scale && !jsubset) {
-        nativeBitmap = Bitmap::allocateAshmemBitmap(&bm);
-    } else {
-        nativeBitmap = Bitmap::allocateHeapBitmap(&bm);
+    if (!decodedToHardware) {
+        if (allocator == ImageDecoder::kSharedMemory_Allocator && !scale && !jsubset) {
+            nativeBitmap = Bitmap::allocateAshmemBitmap(&bm);
+        } else {
+            nativeBitmap = Bitmap::allocateHeapBitmap(&bm);
+        }
     }
     if (!nativeBitmap) {
         SkString msg;
@@ -448,6 +459,12 @@ static jobject ImageDecoder_nDecodeBitmap(JNIEnv* env, jobject /*clazz*/, jlong
 
     if (requireMutable) {
         bitmapCreateFlags |= bitmap::kBitmapCreateFlag_Mutable;
+    } else if (decodedToHardware) {
+        // bm points to the locked pixels, which are no longer valid once unlocked
+        bm.reset();
+        nativeBitmap->unlockPixels();
+        return bitmap::createBitmap(env, nativeBitmap.release(), bitmapCreateFlags,
+                                    ninePatchChunk, ninePatchInsets);
     } else {
         if ((allocator == ImageDecoder::kDefault_Allocator ||
              allocator == ImageDecoder::kHardware_Allocator)
@@ -25,6 +25,8 @@
 #include <jni.h>
 #include <core_jni_helpers.h>
 
+#include <vector>
+
 namespace android {
 
 static jfieldID gRegion_nativeInstanceFieldID;
@@ -169,18 +171,40 @@ static void scale_rect(SkIRect* dst, const SkIRect& src, float scale) {
    dst->fBottom = (int)::roundf(src.fBottom * scale);
 }
 
+// Set dst to the union of the rects. Merging them pairwise keeps each op on regions of similar
+// size, rather than growing a single region one rect at a time, which is quadratic in the number
+// of rects.
+static void union_rects(SkRegion* dst, std::vector<SkRegion>* regions) {
+    size_t count = regions->size();
+    while (count > 1) {
+        size_t merged = 0;
+        for (size_t i = 0; i + 1 < count; i += 2) {
+            (*regions)[merged++].op((*regions)[i], (*regions)[i + 1], SkRegion::kUnion_Op);
+        }
+        if (count & 1) {
+            (*regions)[merged++].swap((*regions)[count - 1]);
+        }
+        count = merged;
+    }
+    if (count == 0) {
+        dst->setEmpty();
+    } else {
+        dst->swap((*regions)[0]);
+    }
+}
+
 // Scale the region by given scale and set the reuslt to the dst.
 // dest and src can be the same region instance.
 static void scale_rgn(SkRegion* dst, const SkRegion& src, float scale) {
-   SkRegion tmp;
+   std::vector<SkRegion> rects;
    SkRegion::Iterator iter(src);
 
    for (; !iter.done(); iter.next()) {
        SkIRect r;
        scale_rect(&r, iter.rect(), scale);
-       tmp.op(r, SkRegion::kUnion_Op);
+       rects.emplace_back(r);
    }
-   dst->swap(tmp);
+   union_rects(dst, &rects);
 }
 
 static void Region_scale(JNIEnv* env, jobject region, jfloat scale, jobject dst) {
@@ -204,6 +228,8 @@ static jstring Region_toString(JNIEnv* env, jobject clazz, jlong regionHandle) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Regions are parceled as an int32 vector of their rects, each as left, top, right and bottom.
+// The rects are read and written in place in the parcel rather than through a temporary vector.
 static jlong Region_createFromParcel(JNIEnv* env, jobject clazz, jobject parcel)
 {
     if (parcel == nullptr) {
@@ -212,18 +238,31 @@ static jlong Region_createFromParcel(JNIEnv* env, jobject clazz, jobject parcel)
 
     android::Parcel* p = android::parcelForJavaObject(env, parcel);
 
-    std::vector<int32_t> rects;
-    p->readInt32Vector(&rects);
-
-    if ((rects.size() % 4) != 0) {
+    int32_t size = p->readInt32();
+    if (size < 0) {
+        // a null vector
+        size = 0;
+    }
+    if ((size % 4) != 0 || static_cast<size_t>(size) > p->dataAvail() / sizeof(int32_t)) {
         return 0;
     }
 
-    SkRegion* region = new SkRegion;
-    for (size_t x = 0; x + 4 <= rects.size(); x += 4) {
-        region->op(rects[x], rects[x+1], rects[x+2], rects[x+3], SkRegion::kUnion_Op);
+    const int32_t* rects = nullptr;
+    if (size > 0) {
+        rects = reinterpret_cast<const int32_t*>(p->readInplace(size * sizeof(int32_t)));
+        if (rects == nullptr) {
+            return 0;
+        }
     }
 
+    std::vector<SkRegion> regions;
+    regions.reserve(size / 4);
+    for (int32_t x = 0; x + 4 <= size; x += 4) {
+        regions.emplace_back(SkIRect::MakeLTRB(rects[x], rects[x+1], rects[x+2], rects[x+3]));
+    }
+
+    SkRegion* region = new SkRegion;
+    union_rects(region, &regions);
     return reinterpret_cast<jlong>(region);
 }
 
@@ -236,18 +275,29 @@ static jboolean Region_writeToParcel(JNIEnv* env, jobject clazz, jlong regionHan
 
     android::Parcel* p = android::parcelForJavaObject(env, parcel);
 
-    std::vector<int32_t> rects;
-    SkRegion::Iterator it(*region);
-    while (!it.done()) {
-        const SkIRect& r = it.rect();
-        rects.push_back(r.fLeft);
-        rects.push_back(r.fTop);
-        rects.push_back(r.fRight);
-        rects.push_back(r.fBottom);
-        it.next();
+    size_t count = 0;
+    for (SkRegion::Iterator it(*region); !it.done(); it.next()) {
+        count++;
+    }
+
+    if (p->writeInt32(count * 4) != NO_ERROR) {
+        return JNI_FALSE;
+    }
+    if (count == 0) {
+        return JNI_TRUE;
     }
 
-    p->writeInt32Vector(rects);
+    int32_t* rects = reinterpret_cast<int32_t*>(p->writeInplace(count * 4 * sizeof(int32_t)));
+    if (rects == nullptr) {
+        return JNI_FALSE;
+    }
+    for (SkRegion::Iterator it(*region); !it.done(); it.next()) {
+        const SkIRect& r = it.rect();
+        *rects++ = r.fLeft;
+        *rects++ = r.fTop;
+        *rects++ = r.fRight;
+        *rects++ = r.fBottom;
+    }
     return JNI_TRUE;
 }
 
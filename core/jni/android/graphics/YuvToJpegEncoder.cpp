@@ -8,6 +8,47 @@
 
 #include <jni.h>
 
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Splits count interleaved vu pairs into the u and v rows.
+static void deinterleaveVuRow(const uint8_t* vu, uint8_t* uRow, uint8_t* vRow, int count) {
+    int i = 0;
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x2_t pairs = vld2q_u8(vu + 2 * i);
+        vst1q_u8(uRow + i, pairs.val[1]);
+        vst1q_u8(vRow + i, pairs.val[0]);
+    }
+#endif
+    for (; i < count; i++) {
+        uRow[i] = vu[2 * i + 1];
+        vRow[i] = vu[2 * i];
+    }
+}
+
+// Splits count yuyv groups, two pixels each, into the y, u and v rows.
+static void deinterleaveYuyvRow(const uint8_t* yuyv, uint8_t* yRow, uint8_t* uRow,
+        uint8_t* vRow, int count) {
+    int i = 0;
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x4_t groups = vld4q_u8(yuyv + 4 * i);
+        uint8x16x2_t y = {{ groups.val[0], groups.val[2] }};
+        vst2q_u8(yRow + 2 * i, y);
+        vst1q_u8(uRow + i, groups.val[1]);
+        vst1q_u8(vRow + i, groups.val[3]);
+    }
+#endif
+    for (; i < count; i++) {
+        yRow[2 * i] = yuyv[4 * i];
+        yRow[2 * i + 1] = yuyv[4 * i + 2];
+        uRow[i] = yuyv[4 * i + 1];
+        vRow[i] = yuyv[4 * i + 3];
+    }
+}
+
 YuvToJpegEncoder* YuvToJpegEncoder::create(int format, int* strides) {
     // Only ImageFormat.NV21 and ImageFormat.YUY2 are supported
     // for now.
@@ -87,7 +128,6 @@ Yuv420SpToJpegEncoder::Yuv420SpToJpegEncoder(int* strides) :
 
 void Yuv420SpToJpegEncoder::compress(jpeg_compress_struct* cinfo,
         uint8_t* yuv, int* offsets) {
-    SkDebugf("onFlyCompress");
     JSAMPROW y[16];
     JSAMPROW cb[8];
     JSAMPROW cr[8];
@@ -135,13 +175,8 @@ void Yuv420SpToJpegEncoder::deinterleave(uint8_t* vuPlanar, uint8_t* uRows,
     if (numRows > 8) numRows = 8;
     for (int row = 0; row < numRows; ++row) {
         int offset = ((rowIndex >> 1) + row) * fStrides[1];
-        uint8_t* vu = vuPlanar + offset;
-        for (int i = 0; i < (width >> 1); ++i) {
-            int index = row * (width >> 1) + i;
-            uRows[index] = vu[1];
-            vRows[index] = vu[0];
-            vu += 2;
-        }
+        int index = row * (width >> 1);
+        deinterleaveVuRow(vuPlanar + offset, uRows + index, vRows + index, width >> 1);
     }
 }
 
@@ -163,7 +198,6 @@ Yuv422IToJpegEncoder::Yuv422IToJpegEncoder(int* strides) :
 
 void Yuv422IToJpegEncoder::compress(jpeg_compress_struct* cinfo,
         uint8_t* yuv, int* offsets) {
-    SkDebugf("onFlyCompress_422");
     JSAMPROW y[16];
     JSAMPROW cb[16];
     JSAMPROW cr[16];
@@ -210,15 +244,9 @@ void Yuv422IToJpegEncoder::deinterleave(uint8_t* yuv, uint8_t* yRows, uint8_t* u
     if (numRows > 16) numRows = 16;
     for (int row = 0; row < numRows; ++row) {
         uint8_t* yuvSeg = yuv + (rowIndex + row) * fStrides[0];
-        for (int i = 0; i < (width >> 1); ++i) {
-            int indexY = row * width + (i << 1);
-            int indexU = row * (width >> 1) + i;
-            yRows[indexY] = yuvSeg[0];
-            yRows[indexY + 1] = yuvSeg[2];
-            uRows[indexU] = yuvSeg[1];
-            vRows[indexU] = yuvSeg[3];
-            yuvSeg += 4;
-        }
+        int indexU = row * (width >> 1);
+        deinterleaveYuyvRow(yuvSeg, yRows + row * width, uRows + indexU, vRows + indexU,
+                width >> 1);
     }
 }
 
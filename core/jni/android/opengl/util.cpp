@@ -770,7 +770,6 @@ static jint util_texSubImage2D(JNIEnv *env, jclass clazz,
 
 static jclass nioAccessClass;
 static jclass bufferClass;
-static jmethodID getBasePointerID;
 static jmethodID getBaseArrayID;
 static jmethodID getBaseArrayOffsetID;
 static jfieldID positionID;
@@ -784,8 +783,6 @@ nativeClassInitBuffer(JNIEnv *env)
 {
     jclass nioAccessClassLocal = FindClassOrDie(env, "java/nio/NIOAccess");
     nioAccessClass = MakeGlobalRefOrDie(env, nioAccessClassLocal);
-    getBasePointerID = GetStaticMethodIDOrDie(env, nioAccessClass,
-            "getBasePointer", "(Ljava/nio/Buffer;)J");
     getBaseArrayID = GetStaticMethodIDOrDie(env, nioAccessClass,
             "getBaseArray", "(Ljava/nio/Buffer;)Ljava/lang/Object;");
     getBaseArrayOffsetID = GetStaticMethodIDOrDie(env, nioAccessClass,
@@ -810,9 +807,10 @@ getPointer(JNIEnv *_env, jobject buffer, jint *remaining)
     limit = _env->GetIntField(buffer, limitID);
     elementSizeShift = _env->GetIntField(buffer, elementSizeShiftID);
     *remaining = (limit - position) << elementSizeShift;
-    pointer = _env->CallStaticLongMethod(nioAccessClass,
-            getBasePointerID, buffer);
+    // Reading the address of a direct buffer doesn't call up to NIOAccess.getBasePointer().
+    pointer = reinterpret_cast<jlong>(_env->GetDirectBufferAddress(buffer));
     if (pointer != 0L) {
+        pointer += position << elementSizeShift;
         return reinterpret_cast<void *>(pointer);
     }
     return NULL;
@@ -38,39 +38,100 @@ static struct {
     jfieldID salt;
 } gObbInfoClassInfo;
 
-static void android_content_res_ObbScanner_getObbInfo(JNIEnv* env, jobject clazz, jstring file,
-        jobject obbInfo)
+static bool fillObbInfo(JNIEnv* env, const sp<ObbFile>& obb, jobject obbInfo)
 {
-    const char* filePath = env->GetStringUTFChars(file, NULL);
-
-    sp<ObbFile> obb = new ObbFile();
-    if (!obb->readFrom(filePath)) {
-        env->ReleaseStringUTFChars(file, filePath);
-        jniThrowException(env, "java/io/IOException", "Could not read OBB file");
-        return;
-    }
-
-    env->ReleaseStringUTFChars(file, filePath);
-
     const char* packageNameStr = obb->getPackageName().string();
 
     jstring packageName = env->NewStringUTF(packageNameStr);
     if (packageName == NULL) {
-        jniThrowException(env, "java/io/IOException", "Could not read OBB file");
-        return;
+        return false;
     }
 
     env->SetObjectField(obbInfo, gObbInfoClassInfo.packageName, packageName);
     env->SetIntField(obbInfo, gObbInfoClassInfo.version, obb->getVersion());
     env->SetIntField(obbInfo, gObbInfoClassInfo.flags, obb->getFlags());
+    env->DeleteLocalRef(packageName);
 
     size_t saltLen;
     const unsigned char* salt = obb->getSalt(&saltLen);
     if (saltLen > 0) {
         jbyteArray saltArray = env->NewByteArray(saltLen);
+        if (saltArray == NULL) {
+            return false;
+        }
         env->SetByteArrayRegion(saltArray, 0, saltLen, (jbyte*)salt);
         env->SetObjectField(obbInfo, gObbInfoClassInfo.salt, saltArray);
+        env->DeleteLocalRef(saltArray);
+    }
+    return true;
+}
+
+static void android_content_res_ObbScanner_getObbInfo(JNIEnv* env, jobject clazz, jstring file,
+        jobject obbInfo)
+{
+    const char* filePath = env->GetStringUTFChars(file, NULL);
+    if (filePath == NULL) {
+        return;
+    }
+
+    sp<ObbFile> obb = ObbFile::readCached(filePath);
+    env->ReleaseStringUTFChars(file, filePath);
+    if (obb == NULL) {
+        jniThrowException(env, "java/io/IOException", "Could not read OBB file");
+        return;
+    }
+
+    if (!fillObbInfo(env, obb, obbInfo)) {
+        jniThrowException(env, "java/io/IOException", "Could not read OBB file");
+    }
+}
+
+/*
+ * Fills obbInfos[i] for each of files[i], returns whether each of the files
+ * could be read rather than throwing for the first unreadable one.
+ */
+static jbooleanArray android_content_res_ObbScanner_getObbInfos(JNIEnv* env, jobject clazz,
+        jobjectArray files, jobjectArray obbInfos)
+{
+    if (files == NULL || obbInfos == NULL) {
+        jniThrowNullPointerException(env, NULL);
+        return NULL;
+    }
+    const jsize count = env->GetArrayLength(files);
+    if (env->GetArrayLength(obbInfos) != count) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "files and obbInfos differ in length");
+        return NULL;
+    }
+
+    jbooleanArray result = env->NewBooleanArray(count);
+    if (result == NULL) {
+        return NULL;
+    }
+    for (jsize i = 0; i < count; i++) {
+        jstring file = (jstring) env->GetObjectArrayElement(files, i);
+        jobject obbInfo = env->GetObjectArrayElement(obbInfos, i);
+        jboolean read = JNI_FALSE;
+        if (file != NULL && obbInfo != NULL) {
+            const char* filePath = env->GetStringUTFChars(file, NULL);
+            if (filePath == NULL) {
+                return NULL;
+            }
+            sp<ObbFile> obb = ObbFile::readCached(filePath);
+            env->ReleaseStringUTFChars(file, filePath);
+            if (obb != NULL) {
+                if (!fillObbInfo(env, obb, obbInfo)) {
+                    // out of memory, the exception is pending
+                    return NULL;
+                }
+                read = JNI_TRUE;
+            }
+        }
+        env->SetBooleanArrayRegion(result, i, 1, &read);
+        env->DeleteLocalRef(file);
+        env->DeleteLocalRef(obbInfo);
     }
+    return result;
 }
 
 /*
@@ -80,6 +141,8 @@ static const JNINativeMethod gMethods[] = {
     /* name, signature, funcPtr */
     { "getObbInfo_native", "(Ljava/lang/String;Landroid/content/res/ObbInfo;)V",
             (void*) android_content_res_ObbScanner_getObbInfo },
+    { "getObbInfos_native", "([Ljava/lang/String;[Landroid/content/res/ObbInfo;)[Z",
+            (void*) android_content_res_ObbScanner_getObbInfos },
 };
 
 int register_android_content_res_ObbScanner(JNIEnv* env)
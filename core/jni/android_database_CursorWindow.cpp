@@ -23,6 +23,7 @@
 #include <nativehelper/JNIHelp.h>
 #include <android_runtime/AndroidRuntime.h>
 
+#include <cutils/properties.h>
 #include <utils/Log.h>
 #include <utils/String8.h>
 #include <utils/String16.h>
@@ -83,6 +84,13 @@ static int getFdCount() {
     return count;
 }
 
+// Windows grow up to this size when full so that queries are copied in one pass, instead of
+// refilling the window from the SQLite cursor. Windows don't grow if it's 0 or too small.
+static size_t getMaxCursorWindowSize() {
+    static const int64_t maxSize = property_get_int64("ro.cursor_window.max_size", 0);
+    return maxSize > 0 ? size_t(maxSize) : 0;
+}
+
 static jlong nativeCreate(JNIEnv* env, jclass clazz, jstring nameObj, jint cursorWindowSize) {
     String8 name;
     const char* nameStr = env->GetStringUTFChars(nameObj, NULL);
@@ -90,7 +98,8 @@ static jlong nativeCreate(JNIEnv* env, jclass clazz, jstring nameObj, jint curso
     env->ReleaseStringUTFChars(nameObj, nameStr);
 
     CursorWindow* window;
-    status_t status = CursorWindow::create(name, cursorWindowSize, &window);
+    status_t status = CursorWindow::create(name, cursorWindowSize, getMaxCursorWindowSize(),
+            &window);
     if (status || !window) {
         ALOGE("Could not allocate CursorWindow '%s' of size %d due to error %d.",
                 name.string(), cursorWindowSize, status);
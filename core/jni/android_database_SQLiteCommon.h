@@ -46,6 +46,9 @@ void throw_sqlite3_exception_errcode(JNIEnv* env, int errcode, const char* messa
 void throw_sqlite3_exception(JNIEnv* env, int errcode,
         const char* sqlite3Message, const char* message);
 
+/* get the number of rows and bytes copied into cursor windows so far, and the time spent */
+void getCursorWindowFillStats(uint64_t* outRows, uint64_t* outBytes, uint64_t* outTimeNs);
+
 }
 
 #endif // _ANDROID_DATABASE_SQLITE_COMMON_H
@@ -24,12 +24,17 @@
 #include <utils/Log.h>
 #include <utils/String8.h>
 #include <utils/String16.h>
+#include <utils/Timers.h>
+#include <utils/Vector.h>
 #include <cutils/ashmem.h>
 #include <sys/mman.h>
 
 #include <string.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <vector>
+
 #include <androidfw/CursorWindow.h>
 
 #include <sqlite3.h>
@@ -68,6 +73,13 @@ static struct {
     jclass clazz;
 } gStringClassInfo;
 
+static struct {
+    jclass longArrayClazz;
+    jclass doubleArrayClazz;
+    jclass stringArrayClazz;
+    jclass blobArrayClazz;
+} gBatchColumnClassInfo;
+
 struct SQLiteConnection {
     // Open flags.
     // Must be kept in sync with the constants defined in SQLiteDatabase.java.
@@ -467,6 +479,144 @@ static void nativeExecute(JNIEnv* env, jclass clazz, jlong connectionPtr,
     executeNonQuery(env, connection, statement);
 }
 
+// One column of the values nativeExecuteBatch binds, a long[], double[], String[] or byte[][].
+struct BatchColumn {
+    enum Type { LONG, DOUBLE, STRING, BLOB };
+
+    Type type;
+    jarray array;
+    // The elements of the primitive arrays.
+    jlong* longs;
+    jdouble* doubles;
+};
+
+static int bindBatchValue(JNIEnv* env, sqlite3_stmt* statement, int index,
+        const BatchColumn& column, jint row) {
+    switch (column.type) {
+        case BatchColumn::LONG:
+            return sqlite3_bind_int64(statement, index, column.longs[row]);
+        case BatchColumn::DOUBLE:
+            return sqlite3_bind_double(statement, index, column.doubles[row]);
+        case BatchColumn::STRING: {
+            jstring valueString = static_cast<jstring>(
+                    env->GetObjectArrayElement(static_cast<jobjectArray>(column.array), row));
+            if (!valueString) {
+                return sqlite3_bind_null(statement, index);
+            }
+            jsize valueLength = env->GetStringLength(valueString);
+            const jchar* value = env->GetStringCritical(valueString, NULL);
+            int err = sqlite3_bind_text16(statement, index, value, valueLength * sizeof(jchar),
+                    SQLITE_TRANSIENT);
+            env->ReleaseStringCritical(valueString, value);
+            env->DeleteLocalRef(valueString);
+            return err;
+        }
+        case BatchColumn::BLOB: {
+            jbyteArray valueArray = static_cast<jbyteArray>(
+                    env->GetObjectArrayElement(static_cast<jobjectArray>(column.array), row));
+            if (!valueArray) {
+                return sqlite3_bind_null(statement, index);
+            }
+            jsize valueLength = env->GetArrayLength(valueArray);
+            jbyte* value = static_cast<jbyte*>(env->GetPrimitiveArrayCritical(valueArray, NULL));
+            int err = sqlite3_bind_blob(statement, index, value, valueLength, SQLITE_TRANSIENT);
+            env->ReleasePrimitiveArrayCritical(valueArray, value, JNI_ABORT);
+            env->DeleteLocalRef(valueArray);
+            return err;
+        }
+    }
+    return SQLITE_MISUSE;
+}
+
+/* Executes the statement once per row of the columns, column i giving the values of the
+ * parameter i + 1, in a savepoint, so the rows are all inserted or none are, whether or not a
+ * transaction is open. Null strings and blobs are bound as NULL. Returns the number of rows
+ * changed. */
+static jint nativeExecuteBatch(JNIEnv* env, jclass clazz, jlong connectionPtr,
+        jlong statementPtr, jobjectArray columnArrays, jint rowCount) {
+    SQLiteConnection* connection = reinterpret_cast<SQLiteConnection*>(connectionPtr);
+    sqlite3_stmt* statement = reinterpret_cast<sqlite3_stmt*>(statementPtr);
+
+    const jsize columnCount = env->GetArrayLength(columnArrays);
+    if (columnCount != sqlite3_bind_parameter_count(statement) || rowCount < 0) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "There must be one column per statement parameter.");
+        return 0;
+    }
+
+    Vector<BatchColumn> columns;
+    bool valid = true;
+    for (jsize i = 0; i < columnCount && valid; i++) {
+        BatchColumn column;
+        column.array = static_cast<jarray>(env->GetObjectArrayElement(columnArrays, i));
+        column.longs = NULL;
+        column.doubles = NULL;
+        if (!column.array || env->GetArrayLength(column.array) < rowCount) {
+            valid = false;
+        } else if (env->IsInstanceOf(column.array, gBatchColumnClassInfo.longArrayClazz)) {
+            column.type = BatchColumn::LONG;
+            column.longs = env->GetLongArrayElements(static_cast<jlongArray>(column.array), NULL);
+        } else if (env->IsInstanceOf(column.array, gBatchColumnClassInfo.doubleArrayClazz)) {
+            column.type = BatchColumn::DOUBLE;
+            column.doubles = env->GetDoubleArrayElements(
+                    static_cast<jdoubleArray>(column.array), NULL);
+        } else if (env->IsInstanceOf(column.array, gBatchColumnClassInfo.stringArrayClazz)) {
+            column.type = BatchColumn::STRING;
+        } else if (env->IsInstanceOf(column.array, gBatchColumnClassInfo.blobArrayClazz)) {
+            column.type = BatchColumn::BLOB;
+        } else {
+            valid = false;
+        }
+        columns.add(column);
+    }
+
+    jint changes = 0;
+    if (!valid) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "Columns must be long[], double[], String[] or byte[][] with a value per row.");
+    } else if (sqlite3_exec(connection->db, "SAVEPOINT batch", NULL, NULL, NULL) != SQLITE_OK) {
+        throw_sqlite3_exception(env, connection->db, "Could not start the batch.");
+    } else {
+        bool failed = false;
+        for (jint row = 0; row < rowCount && !failed; row++) {
+            for (size_t i = 0; i < columns.size() && !failed; i++) {
+                if (bindBatchValue(env, statement, i + 1, columns[i], row) != SQLITE_OK) {
+                    throw_sqlite3_exception(env, connection->db, NULL);
+                    failed = true;
+                }
+            }
+            if (!failed) {
+                failed = executeNonQuery(env, connection, statement) != SQLITE_DONE;
+                changes += sqlite3_changes(connection->db);
+            }
+            sqlite3_reset(statement);
+        }
+        sqlite3_clear_bindings(statement);
+
+        if (failed) {
+            sqlite3_exec(connection->db, "ROLLBACK TO batch", NULL, NULL, NULL);
+            changes = 0;
+        }
+        if (sqlite3_exec(connection->db, "RELEASE batch", NULL, NULL, NULL) != SQLITE_OK
+                && !failed) {
+            throw_sqlite3_exception(env, connection->db, "Could not commit the batch.");
+        }
+    }
+
+    for (size_t i = 0; i < columns.size(); i++) {
+        const BatchColumn& column = columns[i];
+        if (column.longs) {
+            env->ReleaseLongArrayElements(static_cast<jlongArray>(column.array), column.longs,
+                    JNI_ABORT);
+        } else if (column.doubles) {
+            env->ReleaseDoubleArrayElements(static_cast<jdoubleArray>(column.array),
+                    column.doubles, JNI_ABORT);
+        }
+        env->DeleteLocalRef(column.array);
+    }
+    return changes;
+}
+
 static jint nativeExecuteForChangedRowCount(JNIEnv* env, jclass clazz,
         jlong connectionPtr, jlong statementPtr) {
     SQLiteConnection* connection = reinterpret_cast<SQLiteConnection*>(connectionPtr);
@@ -580,97 +730,71 @@ enum CopyRowResult {
     CPR_ERROR,
 };
 
-static CopyRowResult copyRow(JNIEnv* env, CursorWindow* window,
-        sqlite3_stmt* statement, int numColumns, int startPos, int addedRows) {
-    // Allocate a new field directory for the row.
-    status_t status = window->allocRow();
-    if (status) {
-        LOG_WINDOW("Failed allocating fieldDir at startPos %d row %d, error=%d",
-                startPos, addedRows, status);
-        return CPR_FULL;
-    }
+// Totals of the cursor window fills, reported through SQLiteDebug.
+static std::atomic<uint64_t> gWindowFillRows(0);
+static std::atomic<uint64_t> gWindowFillBytes(0);
+static std::atomic<uint64_t> gWindowFillTimeNs(0);
+
+void getCursorWindowFillStats(uint64_t* outRows, uint64_t* outBytes, uint64_t* outTimeNs) {
+    *outRows = gWindowFillRows.load(std::memory_order_relaxed);
+    *outBytes = gWindowFillBytes.load(std::memory_order_relaxed);
+    *outTimeNs = gWindowFillTimeNs.load(std::memory_order_relaxed);
+}
 
-    // Pack the row into the window.
-    CopyRowResult result = CPR_OK;
+/* Copies the current row of the statement into the window with a single putRow(). The TEXT
+ * and BLOB values point at sqlite's buffers, which stay valid until the statement is stepped,
+ * so they are only copied once, into the window. values holds numColumns entries. */
+static CopyRowResult copyRow(JNIEnv* env, CursorWindow* window,
+        sqlite3_stmt* statement, int numColumns, int startPos, int addedRows,
+        CursorWindow::FieldValue* values) {
     for (int i = 0; i < numColumns; i++) {
+        CursorWindow::FieldValue& value = values[i];
         int type = sqlite3_column_type(statement, i);
         if (type == SQLITE_TEXT) {
-            // TEXT data
-            const char* text = reinterpret_cast<const char*>(
-                    sqlite3_column_text(statement, i));
+            value.type = CursorWindow::FIELD_TYPE_STRING;
+            value.data.buffer.data = sqlite3_column_text(statement, i);
             // SQLite does not include the NULL terminator in size, but does
             // ensure all strings are NULL terminated, so increase size by
             // one to make sure we store the terminator.
-            size_t sizeIncludingNull = sqlite3_column_bytes(statement, i) + 1;
-            status = window->putString(addedRows, i, text, sizeIncludingNull);
-            if (status) {
-                LOG_WINDOW("Failed allocating %u bytes for text at %d,%d, error=%d",
-                        sizeIncludingNull, startPos + addedRows, i, status);
-                result = CPR_FULL;
-                break;
-            }
-            LOG_WINDOW("%d,%d is TEXT with %u bytes",
-                    startPos + addedRows, i, sizeIncludingNull);
+            value.data.buffer.size = sqlite3_column_bytes(statement, i) + 1;
+            LOG_WINDOW("%d,%d is TEXT with %zu bytes",
+                    startPos + addedRows, i, value.data.buffer.size);
         } else if (type == SQLITE_INTEGER) {
-            // INTEGER data
-            int64_t value = sqlite3_column_int64(statement, i);
-            status = window->putLong(addedRows, i, value);
-            if (status) {
-                LOG_WINDOW("Failed allocating space for a long in column %d, error=%d",
-                        i, status);
-                result = CPR_FULL;
-                break;
-            }
-            LOG_WINDOW("%d,%d is INTEGER 0x%016llx", startPos + addedRows, i, value);
+            value.type = CursorWindow::FIELD_TYPE_INTEGER;
+            value.data.l = sqlite3_column_int64(statement, i);
+            LOG_WINDOW("%d,%d is INTEGER 0x%016llx", startPos + addedRows, i, value.data.l);
         } else if (type == SQLITE_FLOAT) {
-            // FLOAT data
-            double value = sqlite3_column_double(statement, i);
-            status = window->putDouble(addedRows, i, value);
-            if (status) {
-                LOG_WINDOW("Failed allocating space for a double in column %d, error=%d",
-                        i, status);
-                result = CPR_FULL;
-                break;
-            }
-            LOG_WINDOW("%d,%d is FLOAT %lf", startPos + addedRows, i, value);
+            value.type = CursorWindow::FIELD_TYPE_FLOAT;
+            value.data.d = sqlite3_column_double(statement, i);
+            LOG_WINDOW("%d,%d is FLOAT %lf", startPos + addedRows, i, value.data.d);
         } else if (type == SQLITE_BLOB) {
-            // BLOB data
-            const void* blob = sqlite3_column_blob(statement, i);
-            size_t size = sqlite3_column_bytes(statement, i);
-            status = window->putBlob(addedRows, i, blob, size);
-            if (status) {
-                LOG_WINDOW("Failed allocating %u bytes for blob at %d,%d, error=%d",
-                        size, startPos + addedRows, i, status);
-                result = CPR_FULL;
-                break;
-            }
-            LOG_WINDOW("%d,%d is Blob with %u bytes",
-                    startPos + addedRows, i, size);
+            value.type = CursorWindow::FIELD_TYPE_BLOB;
+            value.data.buffer.data = sqlite3_column_blob(statement, i);
+            value.data.buffer.size = sqlite3_column_bytes(statement, i);
+            LOG_WINDOW("%d,%d is Blob with %zu bytes",
+                    startPos + addedRows, i, value.data.buffer.size);
         } else if (type == SQLITE_NULL) {
-            // NULL field
-            status = window->putNull(addedRows, i);
-            if (status) {
-                LOG_WINDOW("Failed allocating space for a null in column %d, error=%d",
-                        i, status);
-                result = CPR_FULL;
-                break;
-            }
-
+            value.type = CursorWindow::FIELD_TYPE_NULL;
             LOG_WINDOW("%d,%d is NULL", startPos + addedRows, i);
         } else {
             // Unknown data
             ALOGE("Unknown column type when filling database window");
             throw_sqlite3_exception(env, "Unknown column type when filling window");
-            result = CPR_ERROR;
-            break;
+            return CPR_ERROR;
         }
     }
 
-    // Free the last row if if was not successfully copied.
-    if (result != CPR_OK) {
-        window->freeLastRow();
+    const size_t usedSpace = window->size() - window->freeSpace();
+    status_t status = window->putRow(values);
+    if (status) {
+        LOG_WINDOW("Failed putting row at startPos %d row %d, error=%d",
+                startPos, addedRows, status);
+        return CPR_FULL;
     }
-    return result;
+    gWindowFillRows.fetch_add(1, std::memory_order_relaxed);
+    gWindowFillBytes.fetch_add(window->size() - window->freeSpace() - usedSpace,
+            std::memory_order_relaxed);
+    return CPR_OK;
 }
 
 static jlong nativeExecuteForCursorWindow(JNIEnv* env, jclass clazz,
@@ -698,6 +822,8 @@ static jlong nativeExecuteForCursorWindow(JNIEnv* env, jclass clazz,
         return 0;
     }
 
+    const nsecs_t fillStartTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    std::vector<CursorWindow::FieldValue> values(numColumns);
     int retryCount = 0;
     int totalRows = 0;
     int addedRows = 0;
@@ -715,7 +841,8 @@ static jlong nativeExecuteForCursorWindow(JNIEnv* env, jclass clazz,
                 continue;
             }
 
-            CopyRowResult cpr = copyRow(env, window, statement, numColumns, startPos, addedRows);
+            CopyRowResult cpr = copyRow(env, window, statement, numColumns, startPos, addedRows,
+                    values.data());
             if (cpr == CPR_FULL && addedRows && startPos + addedRows <= requiredPos) {
                 // We filled the window before we got to the one row that we really wanted.
                 // Clear the window and start filling it again from here.
@@ -724,7 +851,8 @@ static jlong nativeExecuteForCursorWindow(JNIEnv* env, jclass clazz,
                 window->setNumColumns(numColumns);
                 startPos += addedRows;
                 addedRows = 0;
-                cpr = copyRow(env, window, statement, numColumns, startPos, addedRows);
+                cpr = copyRow(env, window, statement, numColumns, startPos, addedRows,
+                        values.data());
             }
 
             if (cpr == CPR_OK) {
@@ -760,6 +888,8 @@ static jlong nativeExecuteForCursorWindow(JNIEnv* env, jclass clazz,
             "to the window in %d bytes",
             statement, totalRows, addedRows, window->size() - window->freeSpace());
     sqlite3_reset(statement);
+    gWindowFillTimeNs.fetch_add(systemTime(SYSTEM_TIME_MONOTONIC) - fillStartTime,
+            std::memory_order_relaxed);
 
     // Report the total number of rows on request.
     if (startPos > totalRows) {
@@ -848,6 +978,8 @@ static const JNINativeMethod sMethods[] =
             (void*)nativeExecuteForString },
     { "nativeExecuteForBlobFileDescriptor", "(JJ)I",
             (void*)nativeExecuteForBlobFileDescriptor },
+    { "nativeExecuteBatch", "(JJ[Ljava/lang/Object;I)I",
+            (void*)nativeExecuteBatch },
     { "nativeExecuteForChangedRowCount", "(JJ)I",
             (void*)nativeExecuteForChangedRowCount },
     { "nativeExecuteForLastInsertedRowId", "(JJ)J",
@@ -874,6 +1006,12 @@ int register_android_database_SQLiteConnection(JNIEnv *env)
     clazz = FindClassOrDie(env, "java/lang/String");
     gStringClassInfo.clazz = MakeGlobalRefOrDie(env, clazz);
 
+    gBatchColumnClassInfo.longArrayClazz = MakeGlobalRefOrDie(env, FindClassOrDie(env, "[J"));
+    gBatchColumnClassInfo.doubleArrayClazz = MakeGlobalRefOrDie(env, FindClassOrDie(env, "[D"));
+    gBatchColumnClassInfo.stringArrayClazz = MakeGlobalRefOrDie(env,
+            FindClassOrDie(env, "[Ljava/lang/String;"));
+    gBatchColumnClassInfo.blobArrayClazz = MakeGlobalRefOrDie(env, FindClassOrDie(env, "[[B"));
+
     return RegisterMethodsOrDie(env, "android/database/sqlite/SQLiteConnection", sMethods,
                                 NELEM(sMethods));
 }
@@ -28,6 +28,7 @@
 
 #include <sqlite3.h>
 
+#include "android_database_SQLiteCommon.h"
 #include "core_jni_helpers.h"
 
 namespace android {
@@ -54,6 +55,20 @@ static void nativeGetPagerStats(JNIEnv *env, jobject clazz, jobject statsObj)
     env->SetIntField(statsObj, gSQLiteDebugPagerStatsClassInfo.largestMemAlloc, largestMemAlloc);
 }
 
+/* Fills stats with the rows, bytes and nanoseconds spent filling cursor windows. */
+static void nativeGetCursorWindowFillStats(JNIEnv *env, jobject clazz, jlongArray statsArray)
+{
+    if (env->GetArrayLength(statsArray) < 3) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "The stats array must hold 3 values.");
+        return;
+    }
+    uint64_t rows, bytes, timeNs;
+    getCursorWindowFillStats(&rows, &bytes, &timeNs);
+    jlong stats[] = { jlong(rows), jlong(bytes), jlong(timeNs) };
+    env->SetLongArrayRegion(statsArray, 0, 3, stats);
+}
+
 /*
  * JNI registration.
  */
@@ -62,6 +77,8 @@ static const JNINativeMethod gMethods[] =
 {
     { "nativeGetPagerStats", "(Landroid/database/sqlite/SQLiteDebug$PagerStats;)V",
             (void*) nativeGetPagerStats },
+    { "nativeGetCursorWindowFillStats", "([J)V",
+            (void*) nativeGetCursorWindowFillStats },
 };
 
 int register_android_database_SQLiteDebug(JNIEnv *env)
@@ -47,6 +47,7 @@
 
 #include <jni.h>
 #include <nativehelper/JNIHelp.h>
+#include <nativehelper/ScopedLocalRef.h>
 
 using namespace android;
 using namespace img_utils;
@@ -107,6 +108,12 @@ static struct {
 
 static struct {
     jmethodID mGetMethod;
+    jmethodID mHasArrayMethod;
+    jmethodID mArrayMethod;
+    jmethodID mArrayOffsetMethod;
+    jmethodID mPositionMethod;
+    jmethodID mSetPositionMethod;
+    jmethodID mRemainingMethod;
 } gInputByteBufferClassInfo;
 
 enum {
@@ -321,7 +328,8 @@ public:
     status_t close();
 private:
     enum {
-        BYTE_ARRAY_LENGTH = 4096
+        // Large enough that writing a full RAW image only takes a few hundred upcalls.
+        BYTE_ARRAY_LENGTH = 65536
     };
     jobject mOutputStream;
     JNIEnv* mEnv;
@@ -695,7 +703,7 @@ protected:
     uint32_t mHeight;
     uint32_t mPixStride;
     uint32_t mRowStride;
-    uint16_t mOffset;
+    uint64_t mOffset;
     JNIEnv* mEnv;
     uint32_t mBytesPerSample;
     uint32_t mSamplesPerPixel;
@@ -1011,6 +1019,20 @@ static void DngCreator_nativeClassInit(JNIEnv* env, jclass clazz) {
     jclass inputBufferClazz = FindClassOrDie(env, "java/nio/ByteBuffer");
     gInputByteBufferClassInfo.mGetMethod = GetMethodIDOrDie(env,
             inputBufferClazz, "get", "([BII)Ljava/nio/ByteBuffer;");
+    gInputByteBufferClassInfo.mHasArrayMethod = GetMethodIDOrDie(env,
+            inputBufferClazz, "hasArray", "()Z");
+    gInputByteBufferClassInfo.mArrayMethod = GetMethodIDOrDie(env,
+            inputBufferClazz, "array", "()[B");
+    gInputByteBufferClassInfo.mArrayOffsetMethod = GetMethodIDOrDie(env,
+            inputBufferClazz, "arrayOffset", "()I");
+
+    jclass bufferClazz = FindClassOrDie(env, "java/nio/Buffer");
+    gInputByteBufferClassInfo.mPositionMethod = GetMethodIDOrDie(env,
+            bufferClazz, "position", "()I");
+    gInputByteBufferClassInfo.mSetPositionMethod = GetMethodIDOrDie(env,
+            bufferClazz, "position", "(I)Ljava/nio/Buffer;");
+    gInputByteBufferClassInfo.mRemainingMethod = GetMethodIDOrDie(env,
+            bufferClazz, "remaining", "()I");
 }
 
 static void DngCreator_init(JNIEnv* env, jobject thiz, jobject characteristicsPtr,
@@ -2276,6 +2298,53 @@ static void DngCreator_nativeWriteImage(JNIEnv* env, jobject thiz, jobject outSt
             }
             return;
         }
+    } else if (env->CallBooleanMethod(inBuffer, gInputByteBufferClassInfo.mHasArrayMethod)) {
+        // A heap buffer is written straight from its backing array rather than copied out
+        // of it through get() a few KB at a time.
+        size_t fullSize = rStride * uHeight;
+        jint position = env->CallIntMethod(inBuffer, gInputByteBufferClassInfo.mPositionMethod);
+        jint remaining = env->CallIntMethod(inBuffer, gInputByteBufferClassInfo.mRemainingMethod);
+        jint arrayOffset = env->CallIntMethod(inBuffer,
+                gInputByteBufferClassInfo.mArrayOffsetMethod);
+        ScopedLocalRef<jbyteArray> array(env, static_cast<jbyteArray>(
+                env->CallObjectMethod(inBuffer, gInputByteBufferClassInfo.mArrayMethod)));
+        if (env->ExceptionCheck()) {
+            return;
+        }
+        if (fullSize + uOffset > static_cast<uint64_t>(remaining)) {
+            jniThrowExceptionFmt(env, "java/lang/IllegalStateException",
+                    "Invalid size %d for Image, size given in metadata is %d at current stride",
+                    remaining, fullSize);
+            return;
+        }
+
+        jbyte* arrayBytes = env->GetByteArrayElements(array.get(), nullptr);
+        if (arrayBytes == nullptr) {
+            return;
+        }
+
+        ALOGV("%s: Using array-backed strip source.", __FUNCTION__);
+        DirectStripSource stripSource(env,
+                reinterpret_cast<uint8_t*>(arrayBytes) + arrayOffset + position, targetIfd,
+                uWidth, uHeight, pStride, rStride, uOffset, BYTES_PER_SAMPLE,
+                SAMPLES_PER_RAW_PIXEL);
+        sources.add(&stripSource);
+
+        status_t ret = writer->write(out.get(), sources.editArray(), sources.size());
+        env->ReleaseByteArrayElements(array.get(), arrayBytes, JNI_ABORT);
+        if (ret != OK) {
+            ALOGE("%s: write failed with error %d.", __FUNCTION__, ret);
+            if (!env->ExceptionCheck()) {
+                jniThrowExceptionFmt(env, "java/io/IOException",
+                        "Encountered error %d while writing file.", ret);
+            }
+            return;
+        }
+
+        // Consume the pixels, as reading them through get() does.
+        ScopedLocalRef<jobject> chainingBuf(env, env->CallObjectMethod(inBuffer,
+                gInputByteBufferClassInfo.mSetPositionMethod,
+                static_cast<jint>(position + uOffset + fullSize)));
     } else {
         inBuf = new JniInputByteBuffer(env, inBuffer);
 
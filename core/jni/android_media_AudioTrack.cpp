@@ -40,6 +40,10 @@
 #include "android_media_VolumeShaper.h"
 
 #include <cinttypes>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 // ----------------------------------------------------------------------------
 
@@ -81,6 +85,117 @@ struct audiotrack_callback_cookie {
 #define MODE_STATIC 0
 #define MODE_STREAM 1
 
+// ----------------------------------------------------------------------------
+// The write ring is a shared memory region Java writes PCM frames to directly,
+// without calling into JNI. It starts with a header of 32 bit words, the write
+// and read positions in frames on their own cache lines, then the waiting flag
+// and the capacity in frames. Positions wrap at 2^32, the capacity is a power
+// of two. The producer publishes the write position with a release store and
+// calls native_wake_write_ring when the waiting flag is set.
+#define WRITE_RING_HEADER_SIZE          128
+#define WRITE_RING_WRITE_POSITION       0
+#define WRITE_RING_READ_POSITION        16
+#define WRITE_RING_WAITING              17
+#define WRITE_RING_CAPACITY             18
+
+// how long the pump sleeps on an empty ring before it checks for exit
+#define WRITE_RING_IDLE_WAIT_NS         100000000LL
+
+static void futexWait(uint32_t* address, uint32_t value, int64_t timeoutNs) {
+    struct timespec ts;
+    ts.tv_sec = timeoutNs / 1000000000LL;
+    ts.tv_nsec = timeoutNs % 1000000000LL;
+    syscall(__NR_futex, address, FUTEX_WAIT, value, &ts, NULL, 0);
+}
+
+static void futexWake(uint32_t* address) {
+    syscall(__NR_futex, address, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+// Moves the frames Java writes to the ring into the track, so the producer
+// never takes the track lock nor waits for the server.
+class AudioTrackWritePump : public Thread {
+public:
+    AudioTrackWritePump(const sp<AudioTrack>& track, const sp<MemoryHeapBase>& heap,
+            uint32_t capacityInFrames)
+        : Thread(false /*canCallJava*/),
+          mTrack(track),
+          mHeap(heap),
+          mHeader((uint32_t *)heap->getBase()),
+          mData((uint8_t *)heap->getBase() + WRITE_RING_HEADER_SIZE),
+          mFrameSize(track->frameSize()),
+          mCapacity(capacityInFrames),
+          mReadPosition(0) {
+        mHeader[WRITE_RING_CAPACITY] = capacityInFrames;
+    }
+
+    void wake() {
+        futexWake(&mHeader[WRITE_RING_WRITE_POSITION]);
+    }
+
+    void stop() {
+        requestExit();
+        wake();
+        {
+            Mutex::Autolock l(mLock);
+            mCondition.signal();
+        }
+        join();
+    }
+
+private:
+    virtual bool threadLoop() {
+        uint32_t* writeWord = &mHeader[WRITE_RING_WRITE_POSITION];
+        uint32_t writePosition = __atomic_load_n(writeWord, __ATOMIC_ACQUIRE);
+        if (writePosition == mReadPosition) {
+            // the flag is set before the position is checked again, so a
+            // producer publishing meanwhile sees it and wakes the pump
+            __atomic_store_n(&mHeader[WRITE_RING_WAITING], 1, __ATOMIC_SEQ_CST);
+            writePosition = __atomic_load_n(writeWord, __ATOMIC_SEQ_CST);
+            if (writePosition == mReadPosition && !exitPending()) {
+                futexWait(writeWord, writePosition, WRITE_RING_IDLE_WAIT_NS);
+            }
+            __atomic_store_n(&mHeader[WRITE_RING_WAITING], 0, __ATOMIC_RELAXED);
+            return true;
+        }
+
+        uint32_t offset = mReadPosition & (mCapacity - 1);
+        uint32_t frames = writePosition - mReadPosition;
+        if (frames > mCapacity - offset) {
+            frames = mCapacity - offset;
+        }
+        ssize_t written = mTrack->write(mData + offset * mFrameSize, frames * mFrameSize,
+                false /*blocking*/);
+        if (written == (ssize_t)WOULD_BLOCK || written == 0) {
+            // the track buffer is full, give it a quarter of its duration to drain
+            int64_t waitNs = (int64_t)mTrack->getBufferSizeInFrames() * 1000000000LL
+                    / mTrack->getSampleRate() / 4;
+            Mutex::Autolock l(mLock);
+            if (!exitPending()) {
+                mCondition.waitRelative(mLock, waitNs);
+            }
+            return true;
+        }
+        if (written < 0) {
+            ALOGE("Error %zd writing the write ring to the AudioTrack", written);
+            return false;
+        }
+        mReadPosition += written / mFrameSize;
+        __atomic_store_n(&mHeader[WRITE_RING_READ_POSITION], mReadPosition, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    const sp<AudioTrack>        mTrack;
+    const sp<MemoryHeapBase>    mHeap;
+    uint32_t* const             mHeader;
+    uint8_t* const              mData;
+    const size_t                mFrameSize;
+    const uint32_t              mCapacity;
+    uint32_t                    mReadPosition;
+    Mutex                       mLock;
+    Condition                   mCondition;
+};
+
 // ----------------------------------------------------------------------------
 class AudioTrackJniStorage {
     public:
@@ -88,6 +203,7 @@ class AudioTrackJniStorage {
         sp<MemoryBase>             mMemBase;
         audiotrack_callback_cookie mCallbackData;
         sp<JNIDeviceCallback>      mDeviceCallback;
+        sp<AudioTrackWritePump>    mWritePump;
 
     AudioTrackJniStorage() {
         mCallbackData.audioTrack_class = 0;
@@ -96,10 +212,18 @@ class AudioTrackJniStorage {
     }
 
     ~AudioTrackJniStorage() {
+        stopWritePump();
         mMemBase.clear();
         mMemHeap.clear();
     }
 
+    void stopWritePump() {
+        if (mWritePump != 0) {
+            mWritePump->stop();
+            mWritePump.clear();
+        }
+    }
+
     bool allocSharedMem(int sizeInBytes) {
         mMemHeap = new MemoryHeapBase(sizeInBytes, 0, "AudioTrack Heap Base");
         if (mMemHeap->getHeapID() < 0) {
@@ -722,6 +846,68 @@ static jint android_media_AudioTrack_write_native_bytes(JNIEnv *env,  jobject th
     return written;
 }
 
+// ----------------------------------------------------------------------------
+// Maps a write ring of at least capacityInFrames frames, rounded up to a power
+// of two, and starts the thread moving its frames to the track.
+static jobject android_media_AudioTrack_create_write_ring(JNIEnv *env,  jobject thiz,
+        jint capacityInFrames) {
+    sp<AudioTrack> lpTrack = getAudioTrack(env, thiz);
+    AudioTrackJniStorage* pJniStorage = (AudioTrackJniStorage *)env->GetLongField(
+        thiz, javaAudioTrackFields.jniData);
+    if (lpTrack == NULL || pJniStorage == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException",
+            "Unable to retrieve AudioTrack pointer for createWriteRing()");
+        return NULL;
+    }
+    if (lpTrack->sharedBuffer() != 0 || !audio_has_proportional_frames(lpTrack->format())) {
+        jniThrowException(env, "java/lang/IllegalStateException",
+            "A write ring needs a PCM track in streaming mode");
+        return NULL;
+    }
+    if (capacityInFrames <= 0 || capacityInFrames > (1 << 24)) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+            "Invalid write ring capacity");
+        return NULL;
+    }
+    uint32_t capacity = 1;
+    while (capacity < (uint32_t)capacityInFrames) {
+        capacity <<= 1;
+    }
+
+    pJniStorage->stopWritePump();
+    size_t size = WRITE_RING_HEADER_SIZE + capacity * lpTrack->frameSize();
+    sp<MemoryHeapBase> heap = new MemoryHeapBase(size, 0, "AudioTrack Write Ring");
+    if (heap->getHeapID() < 0) {
+        jniThrowException(env, "java/lang/OutOfMemoryError", "Can't map the write ring");
+        return NULL;
+    }
+    memset(heap->getBase(), 0, WRITE_RING_HEADER_SIZE);
+
+    sp<AudioTrackWritePump> pump = new AudioTrackWritePump(lpTrack, heap, capacity);
+    status_t status = pump->run("AudioTrackWriteRing", ANDROID_PRIORITY_AUDIO);
+    if (status != NO_ERROR) {
+        jniThrowExceptionFmt(env, "java/lang/IllegalStateException",
+            "Can't start the write ring thread: %d", status);
+        return NULL;
+    }
+    // the buffer doesn't own the memory, the pump keeps it until the track is released
+    jobject buffer = env->NewDirectByteBuffer(heap->getBase(), size);
+    if (buffer == NULL) {
+        pump->stop();
+        return NULL;
+    }
+    pJniStorage->mWritePump = pump;
+    return buffer;
+}
+
+static void android_media_AudioTrack_wake_write_ring(JNIEnv *env,  jobject thiz) {
+    AudioTrackJniStorage* pJniStorage = (AudioTrackJniStorage *)env->GetLongField(
+        thiz, javaAudioTrackFields.jniData);
+    if (pJniStorage != NULL && pJniStorage->mWritePump != 0) {
+        pJniStorage->mWritePump->wake();
+    }
+}
+
 // ----------------------------------------------------------------------------
 static jint android_media_AudioTrack_get_buffer_size_frames(JNIEnv *env,  jobject thiz) {
     sp<AudioTrack> lpTrack = getAudioTrack(env, thiz);
@@ -1292,6 +1478,11 @@ static const JNINativeMethod gMethods[] = {
                                          (void *)android_media_AudioTrack_write_native_bytes},
     {"native_write_short",   "([SIIIZ)I",(void *)android_media_AudioTrack_writeArray<jshortArray>},
     {"native_write_float",   "([FIIIZ)I",(void *)android_media_AudioTrack_writeArray<jfloatArray>},
+    {"native_create_write_ring",
+                             "(I)Ljava/nio/ByteBuffer;",
+                                         (void *)android_media_AudioTrack_create_write_ring},
+    {"native_wake_write_ring",
+                             "()V",      (void *)android_media_AudioTrack_wake_write_ring},
     {"native_setVolume",     "(FF)V",    (void *)android_media_AudioTrack_set_volume},
     {"native_get_buffer_size_frames",
                              "()I",      (void *)android_media_AudioTrack_get_buffer_size_frames},
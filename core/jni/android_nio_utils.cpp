@@ -21,9 +21,11 @@
 struct NioJNIData {
     jclass nioAccessClass;
 
-    jmethodID getBasePointerID;
     jmethodID getBaseArrayID;
     jmethodID getBaseArrayOffsetID;
+
+    jfieldID positionID;
+    jfieldID elementSizeShiftID;
 };
 
 static NioJNIData gNioJNI;
@@ -35,9 +37,11 @@ void* android::nio_getPointer(JNIEnv *_env, jobject buffer, jarray *array) {
     jint offset;
     void *data;
 
-    pointer = _env->CallStaticLongMethod(gNioJNI.nioAccessClass,
-                                         gNioJNI.getBasePointerID, buffer);
+    // Reading the address of a direct buffer doesn't call up to NIOAccess.getBasePointer().
+    pointer = reinterpret_cast<jlong>(_env->GetDirectBufferAddress(buffer));
     if (pointer != 0L) {
+        pointer += _env->GetIntField(buffer, gNioJNI.positionID)
+                << _env->GetIntField(buffer, gNioJNI.elementSizeShiftID);
         *array = NULL;
         return reinterpret_cast<void *>(pointer);
     }
@@ -79,13 +83,15 @@ namespace android {
 
 int register_android_nio_utils(JNIEnv* env) {
     jclass localClass = FindClassOrDie(env, "java/nio/NIOAccess");
-    gNioJNI.getBasePointerID = GetStaticMethodIDOrDie(env, localClass, "getBasePointer",
-                                                      "(Ljava/nio/Buffer;)J");
     gNioJNI.getBaseArrayID = GetStaticMethodIDOrDie(env, localClass, "getBaseArray",
                                                     "(Ljava/nio/Buffer;)Ljava/lang/Object;");
     gNioJNI.getBaseArrayOffsetID = GetStaticMethodIDOrDie(env, localClass, "getBaseArrayOffset",
                                                           "(Ljava/nio/Buffer;)I");
 
+    jclass bufferClass = FindClassOrDie(env, "java/nio/Buffer");
+    gNioJNI.positionID = GetFieldIDOrDie(env, bufferClass, "position", "I");
+    gNioJNI.elementSizeShiftID = GetFieldIDOrDie(env, bufferClass, "_elementSizeShift", "I");
+
     // now record a permanent version of the class ID
     gNioJNI.nioAccessClass = MakeGlobalRefOrDie(env, localClass);
 
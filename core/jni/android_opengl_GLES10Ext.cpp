@@ -33,7 +33,6 @@ static int initialized = 0;
 
 static jclass nioAccessClass;
 static jclass bufferClass;
-static jmethodID getBasePointerID;
 static jmethodID getBaseArrayID;
 static jmethodID getBaseArrayOffsetID;
 static jfieldID positionID;
@@ -85,8 +84,6 @@ nativeClassInit(JNIEnv *_env, jclass glImplClass)
     jclass bufferClassLocal = _env->FindClass("java/nio/Buffer");
     bufferClass = (jclass) _env->NewGlobalRef(bufferClassLocal);
 
-    getBasePointerID = _env->GetStaticMethodID(nioAccessClass,
-            "getBasePointer", "(Ljava/nio/Buffer;)J");
     getBaseArrayID = _env->GetStaticMethodID(nioAccessClass,
             "getBaseArray", "(Ljava/nio/Buffer;)Ljava/lang/Object;");
     getBaseArrayOffsetID = _env->GetStaticMethodID(nioAccessClass,
@@ -110,9 +107,10 @@ getPointer(JNIEnv *_env, jobject buffer, jarray *array, jint *remaining, jint *o
     limit = _env->GetIntField(buffer, limitID);
     elementSizeShift = _env->GetIntField(buffer, elementSizeShiftID);
     *remaining = (limit - position) << elementSizeShift;
-    pointer = _env->CallStaticLongMethod(nioAccessClass,
-            getBasePointerID, buffer);
+    // Reading the address of a direct buffer doesn't call up to NIOAccess.getBasePointer().
+    pointer = reinterpret_cast<jlong>(_env->GetDirectBufferAddress(buffer));
     if (pointer != 0L) {
+        pointer += position << elementSizeShift;
         *array = NULL;
         return reinterpret_cast<void*>(pointer);
     }
@@ -35,6 +35,7 @@
 
 #include <android-base/stringprintf.h>
 #include <android-base/unique_fd.h>
+#include <androidfw/NativeMemoryStats.h>
 #include <debuggerd/client.h>
 #include <log/log.h>
 #include <utils/misc.h>
@@ -164,6 +165,10 @@ static std::atomic<pss_rollup_support> g_pss_rollup_support;
 
 #define BINDER_STATS "/proc/binder/stats"
 
+// The stdio buffer smaps is read through. The kernel formats smaps a read() at a time, so a big
+// process's smaps takes far fewer reads than with the default BUFSIZ.
+static const size_t SMAPS_BUFFER_SIZE = 64 * 1024;
+
 static jlong android_os_Debug_getNativeHeapSize(JNIEnv *env, jobject clazz)
 {
     struct mallinfo info = mallinfo();
@@ -182,6 +187,44 @@ static jlong android_os_Debug_getNativeHeapFreeSize(JNIEnv *env, jobject clazz)
     return (jlong) info.fordblks;
 }
 
+/*
+ * Fills out with the native heap size, allocated size and free size from a single mallinfo(),
+ * which walks the allocator's arenas, where the three getters above take one each.
+ */
+static void android_os_Debug_getNativeHeapInfo(JNIEnv *env, jobject clazz, jlongArray out)
+{
+    if (out == NULL || env->GetArrayLength(out) < 3) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "out must hold the heap size, allocated size and free size");
+        return;
+    }
+    struct mallinfo info = mallinfo();
+    jlong heapInfo[] = { (jlong) info.usmblks, (jlong) info.uordblks, (jlong) info.fordblks };
+    env->SetLongArrayRegion(out, 0, 3, heapInfo);
+}
+
+/*
+ * Fills out with the bytes and the object count of each NativeMemoryCategory, in pairs, so the
+ * native memory of the frameworks can be attributed by subsystem.
+ */
+static void android_os_Debug_getNativeMemoryStats(JNIEnv *env, jobject clazz, jlongArray out)
+{
+    const int count = static_cast<int>(NativeMemoryCategory::kCount);
+    if (out == NULL || env->GetArrayLength(out) < count * 2) {
+        jniThrowExceptionFmt(env, "java/lang/IllegalArgumentException",
+                "out must hold the bytes and objects of %d categories", count);
+        return;
+    }
+    jlong stats[count * 2];
+    for (int i = 0; i < count; i++) {
+        NativeMemoryStats::Usage usage =
+                NativeMemoryStats::Get(static_cast<NativeMemoryCategory>(i));
+        stats[i * 2] = usage.bytes;
+        stats[i * 2 + 1] = usage.objects;
+    }
+    env->SetLongArrayRegion(out, 0, count * 2, stats);
+}
+
 // Container used to retrieve graphics memory pss
 struct graphics_memory_pss
 {
@@ -483,6 +526,7 @@ static void load_maps(int pid, stats_t* stats, bool* foundSwapPss)
     std::string smaps_path = base::StringPrintf("/proc/%d/smaps", pid);
     UniqueFile fp = MakeUniqueFile(smaps_path.c_str(), "re");
     if (fp == nullptr) return;
+    setvbuf(fp.get(), NULL, _IOFBF, SMAPS_BUFFER_SIZE);
 
     read_mapinfo(fp.get(), stats, foundSwapPss);
 }
@@ -587,7 +631,11 @@ UniqueFile OpenSmapsOrRollup(int pid)
     }
 
     std::string smaps_path = base::StringPrintf("/proc/%d/smaps", pid);
-    return MakeUniqueFile(smaps_path.c_str(), "re");
+    UniqueFile fp = MakeUniqueFile(smaps_path.c_str(), "re");
+    if (fp != nullptr) {
+        setvbuf(fp.get(), NULL, _IOFBF, SMAPS_BUFFER_SIZE);
+    }
+    return fp;
 }
 
 static jlong android_os_Debug_getPssPid(JNIEnv *env, jobject clazz, jint pid,
@@ -1121,6 +1169,19 @@ static void android_os_Debug_dumpNativeHeap(JNIEnv* env, jobject,
     ALOGD("Native heap dump complete.\n");
 }
 
+/*
+ * Dump the native memory of each subsystem, for dumpsys meminfo.
+ */
+static void android_os_Debug_dumpNativeMemoryStats(JNIEnv* env, jobject,
+    jobject fileDescriptor)
+{
+    UniqueFile fp(nullptr, safeFclose);
+    if (!openFile(env, fileDescriptor, fp)) {
+        return;
+    }
+    NativeMemoryStats::Dump(fileno(fp.get()));
+}
+
 /*
  * Dump the native malloc info, writing xml output to the specified
  * file descriptor.
@@ -1184,6 +1245,10 @@ static const JNINativeMethod gMethods[] = {
             (void*) android_os_Debug_getNativeHeapAllocatedSize },
     { "getNativeHeapFreeSize",  "()J",
             (void*) android_os_Debug_getNativeHeapFreeSize },
+    { "getNativeHeapInfo",      "([J)V",
+            (void*) android_os_Debug_getNativeHeapInfo },
+    { "getNativeMemoryStats",   "([J)V",
+            (void*) android_os_Debug_getNativeMemoryStats },
     { "getMemoryInfo",          "(Landroid/os/Debug$MemoryInfo;)V",
             (void*) android_os_Debug_getDirtyPages },
     { "getMemoryInfo",          "(ILandroid/os/Debug$MemoryInfo;)V",
@@ -1198,6 +1263,8 @@ static const JNINativeMethod gMethods[] = {
             (void*) android_os_Debug_dumpNativeHeap },
     { "dumpNativeMallocInfo",   "(Ljava/io/FileDescriptor;)V",
             (void*) android_os_Debug_dumpNativeMallocInfo },
+    { "dumpNativeMemoryStats",  "(Ljava/io/FileDescriptor;)V",
+            (void*) android_os_Debug_dumpNativeMemoryStats },
     { "getBinderSentTransactions", "()I",
             (void*) android_os_Debug_getBinderSentTransactions },
     { "getBinderReceivedTransactions", "()I",
@@ -83,7 +83,8 @@ JHwBlob::JHwBlob(JNIEnv *env, jobject thiz, size_t size)
     : mBuffer(nullptr),
       mSize(size),
       mOwnsBuffer(true),
-      mHandle(0) {
+      mHandle(0),
+      mDirectBuffer(nullptr) {
     if (size > 0) {
         mBuffer = malloc(size);
     }
@@ -94,6 +95,11 @@ JHwBlob::~JHwBlob() {
         free(mBuffer);
         mBuffer = nullptr;
     }
+
+    if (mDirectBuffer != nullptr) {
+        AndroidRuntime::getJNIEnv()->DeleteGlobalRef(mDirectBuffer);
+        mDirectBuffer = nullptr;
+    }
 }
 
 void JHwBlob::setTo(const void *ptr, size_t handle) {
@@ -106,8 +112,19 @@ void JHwBlob::setTo(const void *ptr, size_t handle) {
     mHandle = handle;
 }
 
+void JHwBlob::setToDirectBuffer(
+        JNIEnv *env, jobject buffer, void *ptr, size_t size) {
+    CHECK_EQ(mSize, 0u);
+    CHECK(mBuffer == nullptr);
+
+    mBuffer = ptr;
+    mSize = size;
+    mOwnsBuffer = false;
+    mDirectBuffer = env->NewGlobalRef(buffer);
+}
+
 status_t JHwBlob::getHandle(size_t *handle) const {
-    if (mOwnsBuffer) {
+    if (mOwnsBuffer || mDirectBuffer != nullptr) {
         return INVALID_OPERATION;
     }
 
@@ -265,6 +282,23 @@ static void JHwBlob_native_setup(
     JHwBlob::SetNativeContext(env, thiz, context);
 }
 
+static void JHwBlob_native_setupWithDirectBuffer(
+        JNIEnv *env, jobject thiz, jobject buffer) {
+    void *ptr = env->GetDirectBufferAddress(buffer);
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+
+    if (ptr == nullptr || capacity < 0) {
+        jniThrowException(
+                env, "java/lang/IllegalArgumentException", "Not a direct ByteBuffer");
+        return;
+    }
+
+    sp<JHwBlob> context = new JHwBlob(env, thiz, 0 /* size */);
+    context->setToDirectBuffer(env, buffer, ptr, capacity);
+
+    JHwBlob::SetNativeContext(env, thiz, context);
+}
+
 #define DEFINE_BLOB_GETTER(Suffix,Type)                                        \
 static Type JHwBlob_native_get ## Suffix(                                      \
         JNIEnv *env, jobject thiz, jlong offset) {                             \
@@ -537,6 +571,8 @@ static jlong JHwBlob_native_handle(JNIEnv *env, jobject thiz) {
 static JNINativeMethod gMethods[] = {
     { "native_init", "()J", (void *)JHwBlob_native_init },
     { "native_setup", "(I)V", (void *)JHwBlob_native_setup },
+    { "native_setupWithDirectBuffer", "(Ljava/nio/ByteBuffer;)V",
+        (void *)JHwBlob_native_setupWithDirectBuffer },
 
     { "getBool", "(J)Z", (void *)JHwBlob_native_getBool },
     { "getInt8", "(J)B", (void *)JHwBlob_native_getInt8 },
@@ -41,6 +41,10 @@ struct JHwBlob : public RefBase {
 
     void setTo(const void *ptr, size_t handle);
 
+    // Makes the blob use the memory of a direct ByteBuffer, which is written to parcels in
+    // place rather than copied into a buffer of the blob. Keeps the ByteBuffer alive.
+    void setToDirectBuffer(JNIEnv *env, jobject buffer, void *ptr, size_t size);
+
     status_t getHandle(size_t *handle) const;
 
     status_t read(size_t offset, void *data, size_t size) const;
@@ -78,6 +82,9 @@ private:
 
     size_t mHandle;
 
+    // A global reference to the ByteBuffer that holds mBuffer, if any.
+    jobject mDirectBuffer;
+
     Vector<BlobInfo> mSubBlobs;
 
     DISALLOW_COPY_AND_ASSIGN(JHwBlob);
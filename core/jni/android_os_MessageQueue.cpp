@@ -25,11 +25,14 @@
 
 #include "core_jni_helpers.h"
 
+#include <vector>
+
 namespace android {
 
 static struct {
     jfieldID mPtr;   // native object attached to the DVM MessageQueue
     jmethodID dispatchEvents;
+    jmethodID dispatchEventsBatch;
 } gMessageQueueClassInfo;
 
 // Must be kept in sync with the constants in Looper.FileDescriptorCallback
@@ -48,13 +51,27 @@ public:
     void pollOnce(JNIEnv* env, jobject obj, int timeoutMillis);
     void wake();
     void setFileDescriptorEvents(int fd, int events);
+    void setBatchedDispatch(bool batched);
 
     virtual int handleEvent(int fd, int events, void* data);
 
 private:
+    struct PendingEvents {
+        int fd;
+        int events;
+        int watchedEvents;
+    };
+
     JNIEnv* mPollEnv;
     jobject mPollObj;
     jthrowable mExceptionObj;
+
+    // When batched, the fd events of a poll are collected here and dispatched to Java with
+    // a single upcall once the looper returns, rather than one upcall per fd.
+    bool mBatchedDispatch;
+    std::vector<PendingEvents> mPendingEvents;
+
+    void dispatchPendingEvents(JNIEnv* env);
 };
 
 
@@ -76,7 +93,7 @@ bool MessageQueue::raiseAndClearException(JNIEnv* env, const char* msg) {
 }
 
 NativeMessageQueue::NativeMessageQueue() :
-        mPollEnv(NULL), mPollObj(NULL), mExceptionObj(NULL) {
+        mPollEnv(NULL), mPollObj(NULL), mExceptionObj(NULL), mBatchedDispatch(false) {
     mLooper = Looper::getForThread();
     if (mLooper == NULL) {
         mLooper = new Looper(false);
@@ -108,6 +125,9 @@ void NativeMessageQueue::pollOnce(JNIEnv* env, jobject pollObj, int timeoutMilli
     mPollEnv = env;
     mPollObj = pollObj;
     mLooper->pollOnce(timeoutMillis);
+    if (!mPendingEvents.empty()) {
+        dispatchPendingEvents(env);
+    }
     mPollObj = NULL;
     mPollEnv = NULL;
 
@@ -138,6 +158,40 @@ void NativeMessageQueue::setFileDescriptorEvents(int fd, int events) {
     }
 }
 
+void NativeMessageQueue::setBatchedDispatch(bool batched) {
+    mBatchedDispatch = batched;
+}
+
+void NativeMessageQueue::dispatchPendingEvents(JNIEnv* env) {
+    // Pairs of fd and events, Java replaces the events with the ones it wants to watch next.
+    const size_t count = mPendingEvents.size();
+    jintArray eventsArray = env->NewIntArray(count * 2);
+    if (!eventsArray) {
+        mPendingEvents.clear();
+        raiseAndClearException(env, "dispatchEventsBatch");
+        return;
+    }
+    std::vector<jint> events(count * 2);
+    for (size_t i = 0; i < count; i++) {
+        events[i * 2] = mPendingEvents[i].fd;
+        events[i * 2 + 1] = mPendingEvents[i].events;
+    }
+    env->SetIntArrayRegion(eventsArray, 0, events.size(), events.data());
+
+    env->CallVoidMethod(mPollObj, gMessageQueueClassInfo.dispatchEventsBatch, eventsArray);
+    if (!raiseAndClearException(env, "dispatchEventsBatch")) {
+        env->GetIntArrayRegion(eventsArray, 0, events.size(), events.data());
+        for (size_t i = 0; i < count; i++) {
+            int newWatchedEvents = events[i * 2 + 1];
+            if (newWatchedEvents != mPendingEvents[i].watchedEvents) {
+                setFileDescriptorEvents(mPendingEvents[i].fd, newWatchedEvents);
+            }
+        }
+    }
+    env->DeleteLocalRef(eventsArray);
+    mPendingEvents.clear();
+}
+
 int NativeMessageQueue::handleEvent(int fd, int looperEvents, void* data) {
     int events = 0;
     if (looperEvents & Looper::EVENT_INPUT) {
@@ -150,6 +204,11 @@ int NativeMessageQueue::handleEvent(int fd, int looperEvents, void* data) {
         events |= CALLBACK_EVENT_ERROR;
     }
     int oldWatchedEvents = reinterpret_cast<intptr_t>(data);
+    if (mBatchedDispatch) {
+        // Kept registered until Java has seen the events, pollOnce() dispatches them.
+        mPendingEvents.push_back({fd, events, oldWatchedEvents});
+        return 1;
+    }
     int newWatchedEvents = mPollEnv->CallIntMethod(mPollObj,
             gMessageQueueClassInfo.dispatchEvents, fd, events);
     if (!newWatchedEvents) {
@@ -207,6 +266,12 @@ static void android_os_MessageQueue_nativeSetFileDescriptorEvents(JNIEnv* env, j
     nativeMessageQueue->setFileDescriptorEvents(fd, events);
 }
 
+static void android_os_MessageQueue_nativeSetBatchedFileDescriptorDispatch(JNIEnv* env,
+        jclass clazz, jlong ptr, jboolean batched) {
+    NativeMessageQueue* nativeMessageQueue = reinterpret_cast<NativeMessageQueue*>(ptr);
+    nativeMessageQueue->setBatchedDispatch(batched);
+}
+
 // ----------------------------------------------------------------------------
 
 static const JNINativeMethod gMessageQueueMethods[] = {
@@ -218,6 +283,8 @@ static const JNINativeMethod gMessageQueueMethods[] = {
     { "nativeIsPolling", "(J)Z", (void*)android_os_MessageQueue_nativeIsPolling },
     { "nativeSetFileDescriptorEvents", "(JII)V",
             (void*)android_os_MessageQueue_nativeSetFileDescriptorEvents },
+    { "nativeSetBatchedFileDescriptorDispatch", "(JZ)V",
+            (void*)android_os_MessageQueue_nativeSetBatchedFileDescriptorDispatch },
 };
 
 int register_android_os_MessageQueue(JNIEnv* env) {
@@ -228,6 +295,8 @@ int register_android_os_MessageQueue(JNIEnv* env) {
     gMessageQueueClassInfo.mPtr = GetFieldIDOrDie(env, clazz, "mPtr", "J");
     gMessageQueueClassInfo.dispatchEvents = GetMethodIDOrDie(env, clazz,
             "dispatchEvents", "(II)I");
+    gMessageQueueClassInfo.dispatchEventsBatch = GetMethodIDOrDie(env, clazz,
+            "dispatchEventsBatch", "([I)V");
 
     return res;
 }
@@ -24,12 +24,14 @@
 
 #include <fcntl.h>
 #include <stdio.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include <binder/IInterface.h>
 #include <binder/IPCThreadState.h>
+#include <cutils/ashmem.h>
 #include <cutils/atomic.h>
 #include <utils/Log.h>
 #include <utils/SystemClock.h>
@@ -68,6 +70,8 @@ static struct parcel_offsets_t
     jmethodID recycle;
 } gParcelOffsets;
 
+static jclass gStringClass;
+
 Parcel* parcelForJavaObject(JNIEnv* env, jobject obj)
 {
     if (obj) {
@@ -273,25 +277,114 @@ static void android_os_Parcel_writeDouble(JNIEnv* env, jclass clazz, jlong nativ
     }
 }
 
+static status_t writeJavaString(JNIEnv* env, Parcel* parcel, jstring val)
+{
+    status_t err = NO_MEMORY;
+    if (val) {
+        const jchar* str = env->GetStringCritical(val, 0);
+        if (str) {
+            err = parcel->writeString16(
+                reinterpret_cast<const char16_t*>(str),
+                env->GetStringLength(val));
+            env->ReleaseStringCritical(val, str);
+        }
+    } else {
+        err = parcel->writeString16(NULL, 0);
+    }
+    return err;
+}
+
 static void android_os_Parcel_writeString(JNIEnv* env, jclass clazz, jlong nativePtr, jstring val)
 {
     Parcel* parcel = reinterpret_cast<Parcel*>(nativePtr);
     if (parcel != NULL) {
-        status_t err = NO_MEMORY;
-        if (val) {
-            const jchar* str = env->GetStringCritical(val, 0);
-            if (str) {
-                err = parcel->writeString16(
-                    reinterpret_cast<const char16_t*>(str),
-                    env->GetStringLength(val));
-                env->ReleaseStringCritical(val, str);
-            }
-        } else {
-            err = parcel->writeString16(NULL, 0);
+        const status_t err = writeJavaString(env, parcel, val);
+        if (err != NO_ERROR) {
+            signalExceptionForError(env, clazz, err);
         }
+    }
+}
+
+// Writes the length of the array followed by its elements, in the same format as writing them
+// one at a time, but with a single copy. A null array is written as a length of -1.
+static void writePrimitiveArray(JNIEnv* env, jclass clazz, jlong nativePtr, jarray data,
+                                size_t elementSize)
+{
+    Parcel* parcel = reinterpret_cast<Parcel*>(nativePtr);
+    if (parcel == NULL) {
+        return;
+    }
+
+    if (data == NULL) {
+        const status_t err = parcel->writeInt32(-1);
         if (err != NO_ERROR) {
             signalExceptionForError(env, clazz, err);
         }
+        return;
+    }
+
+    const jsize length = env->GetArrayLength(data);
+    if ((size_t)length > INT32_MAX / elementSize) {
+        signalExceptionForError(env, clazz, BAD_VALUE);
+        return;
+    }
+
+    const status_t err = parcel->writeInt32(length);
+    if (err != NO_ERROR) {
+        signalExceptionForError(env, clazz, err);
+        return;
+    }
+    if (length == 0) {
+        return;
+    }
+
+    void* dest = parcel->writeInplace(length * elementSize);
+    if (dest == NULL) {
+        signalExceptionForError(env, clazz, NO_MEMORY);
+        return;
+    }
+
+    void* ar = env->GetPrimitiveArrayCritical(data, 0);
+    if (ar) {
+        memcpy(dest, ar, length * elementSize);
+        env->ReleasePrimitiveArrayCritical(data, ar, JNI_ABORT);
+    }
+}
+
+static void android_os_Parcel_writeIntArray(JNIEnv* env, jclass clazz, jlong nativePtr,
+                                            jintArray data)
+{
+    writePrimitiveArray(env, clazz, nativePtr, data, sizeof(jint));
+}
+
+static void android_os_Parcel_writeLongArray(JNIEnv* env, jclass clazz, jlong nativePtr,
+                                             jlongArray data)
+{
+    writePrimitiveArray(env, clazz, nativePtr, data, sizeof(jlong));
+}
+
+static void android_os_Parcel_writeFloatArray(JNIEnv* env, jclass clazz, jlong nativePtr,
+                                              jfloatArray data)
+{
+    writePrimitiveArray(env, clazz, nativePtr, data, sizeof(jfloat));
+}
+
+static void android_os_Parcel_writeStringArray(JNIEnv* env, jclass clazz, jlong nativePtr,
+                                               jobjectArray val)
+{
+    Parcel* parcel = reinterpret_cast<Parcel*>(nativePtr);
+    if (parcel == NULL) {
+        return;
+    }
+
+    const jsize length = val != NULL ? env->GetArrayLength(val) : -1;
+    status_t err = parcel->writeInt32(length);
+    for (jsize i = 0; err == NO_ERROR && i < length; i++) {
+        ScopedLocalRef<jstring> str(env, (jstring)env->GetObjectArrayElement(val, i));
+        err = writeJavaString(env, parcel, str.get());
+    }
+    if (err != NO_ERROR) {
+        signalExceptionForError(env, clazz, err);
     }
 }
 
@@ -346,6 +439,101 @@ static jbyteArray android_os_Parcel_createByteArray(JNIEnv* env, jclass clazz, j
     return ret;
 }
 
+// Reads the length of an array written by writePrimitiveArray and finds its elements in the
+// parcel. Returns false if the array is null or its length doesn't fit in the data left.
+static bool readPrimitiveArrayInplace(jlong nativePtr, size_t elementSize, int32_t* outLength,
+                                      const void** outData)
+{
+    Parcel* parcel = reinterpret_cast<Parcel*>(nativePtr);
+    if (parcel == NULL) {
+        return false;
+    }
+
+    const int32_t len = parcel->readInt32();
+    if (len < 0 || (size_t)len > parcel->dataAvail() / elementSize) {
+        return false;
+    }
+    *outLength = len;
+    *outData = len > 0 ? parcel->readInplace(len * elementSize) : NULL;
+    return len == 0 || *outData != NULL;
+}
+
+static jintArray android_os_Parcel_createIntArray(JNIEnv* env, jclass clazz, jlong nativePtr)
+{
+    int32_t len;
+    const void* data;
+    if (!readPrimitiveArrayInplace(nativePtr, sizeof(jint), &len, &data)) {
+        return NULL;
+    }
+    jintArray ret = env->NewIntArray(len);
+    if (ret != NULL && len > 0) {
+        env->SetIntArrayRegion(ret, 0, len, reinterpret_cast<const jint*>(data));
+    }
+    return ret;
+}
+
+static jlongArray android_os_Parcel_createLongArray(JNIEnv* env, jclass clazz, jlong nativePtr)
+{
+    int32_t len;
+    const void* data;
+    if (!readPrimitiveArrayInplace(nativePtr, sizeof(jlong), &len, &data)) {
+        return NULL;
+    }
+    jlongArray ret = env->NewLongArray(len);
+    if (ret != NULL && len > 0) {
+        env->SetLongArrayRegion(ret, 0, len, reinterpret_cast<const jlong*>(data));
+    }
+    return ret;
+}
+
+static jfloatArray android_os_Parcel_createFloatArray(JNIEnv* env, jclass clazz, jlong nativePtr)
+{
+    int32_t len;
+    const void* data;
+    if (!readPrimitiveArrayInplace(nativePtr, sizeof(jfloat), &len, &data)) {
+        return NULL;
+    }
+    jfloatArray ret = env->NewFloatArray(len);
+    if (ret != NULL && len > 0) {
+        env->SetFloatArrayRegion(ret, 0, len, reinterpret_cast<const jfloat*>(data));
+    }
+    return ret;
+}
+
+static jobjectArray android_os_Parcel_createStringArray(JNIEnv* env, jclass clazz,
+                                                        jlong nativePtr)
+{
+    Parcel* parcel = reinterpret_cast<Parcel*>(nativePtr);
+    if (parcel == NULL) {
+        return NULL;
+    }
+
+    // Every string takes at least its length.
+    const int32_t len = parcel->readInt32();
+    if (len < 0 || (size_t)len > parcel->dataAvail() / sizeof(int32_t)) {
+        return NULL;
+    }
+
+    jobjectArray ret = env->NewObjectArray(len, gStringClass, NULL);
+    if (ret == NULL) {
+        return NULL;
+    }
+    for (int32_t i = 0; i < len; i++) {
+        size_t strLen;
+        const char16_t* str = parcel->readString16Inplace(&strLen);
+        if (str == NULL) {
+            continue;
+        }
+        ScopedLocalRef<jstring> element(env,
+                env->NewString(reinterpret_cast<const jchar*>(str), strLen));
+        if (element.get() == NULL) {
+            return NULL;
+        }
+        env->SetObjectArrayElement(ret, i, element.get());
+    }
+    return ret;
+}
+
 static jboolean android_os_Parcel_readByteArray(JNIEnv* env, jclass clazz, jlong nativePtr,
                                                 jobject dest, jint destLen)
 {
@@ -398,6 +586,76 @@ static jbyteArray android_os_Parcel_readBlob(JNIEnv* env, jclass clazz, jlong na
     return ret;
 }
 
+// The type Parcel writes before the file descriptor of an immutable ashmem blob, which is
+// what writeBlob uses for large payloads and writeDupImmutableBlobFileDescriptor writes.
+static const int32_t kBlobAshmemImmutable = 1;
+
+// Writes a read-only SharedMemory region as a blob, in the same format as nativeWriteBlob, so the
+// payload is never copied: the receiver maps the region instead. The parcel holds its own dup of
+// the descriptor, the caller keeps ownership of the SharedMemory.
+static void android_os_Parcel_writeSharedMemoryBlob(JNIEnv* env, jclass clazz, jlong nativePtr,
+                                                    jobject fileDescriptor, jint length)
+{
+    Parcel* parcel = reinterpret_cast<Parcel*>(nativePtr);
+    if (parcel == NULL) {
+        return;
+    }
+
+    const int fd = jniGetFDFromFileDescriptor(env, fileDescriptor);
+    if (length < 0 || !ashmem_valid(fd) || ashmem_get_size_region(fd) < length) {
+        signalExceptionForError(env, clazz, BAD_VALUE);
+        return;
+    }
+
+    // The blob is sent as immutable, so no new writable mapping of the region may be created.
+    // Mappings that are already writable must have been unmapped by the caller, as with
+    // SharedMemory.setProtect().
+    if (ashmem_set_prot_region(fd, PROT_READ) < 0) {
+        signalExceptionForError(env, clazz, -errno);
+        return;
+    }
+
+    status_t err = parcel->writeInt32(length);
+    if (err == NO_ERROR) {
+        err = parcel->writeDupImmutableBlobFileDescriptor(fd);
+    }
+    if (err != NO_ERROR) {
+        signalExceptionForError(env, clazz, err);
+    }
+}
+
+// Reads a blob as the SharedMemory region holding it, so the receiver can map it instead of
+// copying it into an array. Returns NULL and leaves the parcel unchanged if the blob was written
+// inline, nativeReadBlob must be used for those.
+static jobject android_os_Parcel_readSharedMemoryBlob(JNIEnv* env, jclass clazz, jlong nativePtr)
+{
+    Parcel* parcel = reinterpret_cast<Parcel*>(nativePtr);
+    if (parcel == NULL) {
+        return NULL;
+    }
+
+    const size_t start = parcel->dataPosition();
+    const int32_t len = parcel->readInt32();
+    if (len < 0 || parcel->readInt32() != kBlobAshmemImmutable) {
+        parcel->setDataPosition(start);
+        return NULL;
+    }
+
+    // Don't trust an immutable blob whose region can still be mapped writable
+    int fd = parcel->readFileDescriptor();
+    if (fd < 0 || ashmem_get_size_region(fd) < len
+            || (ashmem_get_prot_region(fd) & PROT_WRITE) != 0) {
+        signalExceptionForError(env, clazz, BAD_VALUE);
+        return NULL;
+    }
+    fd = dup(fd);
+    if (fd < 0) {
+        signalExceptionForError(env, clazz, -errno);
+        return NULL;
+    }
+    return jniCreateFileDescriptor(env, fd);
+}
+
 static jint android_os_Parcel_readInt(jlong nativePtr)
 {
     Parcel* parcel = reinterpret_cast<Parcel*>(nativePtr);
@@ -769,6 +1027,7 @@ static const JNINativeMethod gParcelMethods[] = {
 
     {"nativeWriteByteArray",      "(J[BII)V", (void*)android_os_Parcel_writeByteArray},
     {"nativeWriteBlob",           "(J[BII)V", (void*)android_os_Parcel_writeBlob},
+    {"nativeWriteSharedMemoryBlob", "(JLjava/io/FileDescriptor;I)V", (void*)android_os_Parcel_writeSharedMemoryBlob},
     // @FastNative
     {"nativeWriteInt",            "(JI)V", (void*)android_os_Parcel_writeInt},
     // @FastNative
@@ -778,12 +1037,17 @@ static const JNINativeMethod gParcelMethods[] = {
     // @FastNative
     {"nativeWriteDouble",         "(JD)V", (void*)android_os_Parcel_writeDouble},
     {"nativeWriteString",         "(JLjava/lang/String;)V", (void*)android_os_Parcel_writeString},
+    {"nativeWriteIntArray",       "(J[I)V", (void*)android_os_Parcel_writeIntArray},
+    {"nativeWriteLongArray",      "(J[J)V", (void*)android_os_Parcel_writeLongArray},
+    {"nativeWriteFloatArray",     "(J[F)V", (void*)android_os_Parcel_writeFloatArray},
+    {"nativeWriteStringArray",    "(J[Ljava/lang/String;)V", (void*)android_os_Parcel_writeStringArray},
     {"nativeWriteStrongBinder",   "(JLandroid/os/IBinder;)V", (void*)android_os_Parcel_writeStrongBinder},
     {"nativeWriteFileDescriptor", "(JLjava/io/FileDescriptor;)J", (void*)android_os_Parcel_writeFileDescriptor},
 
     {"nativeCreateByteArray",     "(J)[B", (void*)android_os_Parcel_createByteArray},
     {"nativeReadByteArray",       "(J[BI)Z", (void*)android_os_Parcel_readByteArray},
     {"nativeReadBlob",            "(J)[B", (void*)android_os_Parcel_readBlob},
+    {"nativeReadSharedMemoryBlob", "(J)Ljava/io/FileDescriptor;", (void*)android_os_Parcel_readSharedMemoryBlob},
     // @CriticalNative
     {"nativeReadInt",             "(J)I", (void*)android_os_Parcel_readInt},
     // @CriticalNative
@@ -793,6 +1057,10 @@ static const JNINativeMethod gParcelMethods[] = {
     // @CriticalNative
     {"nativeReadDouble",          "(J)D", (void*)android_os_Parcel_readDouble},
     {"nativeReadString",          "(J)Ljava/lang/String;", (void*)android_os_Parcel_readString},
+    {"nativeCreateIntArray",      "(J)[I", (void*)android_os_Parcel_createIntArray},
+    {"nativeCreateLongArray",     "(J)[J", (void*)android_os_Parcel_createLongArray},
+    {"nativeCreateFloatArray",    "(J)[F", (void*)android_os_Parcel_createFloatArray},
+    {"nativeCreateStringArray",   "(J)[Ljava/lang/String;", (void*)android_os_Parcel_createStringArray},
     {"nativeReadStrongBinder",    "(J)Landroid/os/IBinder;", (void*)android_os_Parcel_readStrongBinder},
     {"nativeReadFileDescriptor",  "(J)Ljava/io/FileDescriptor;", (void*)android_os_Parcel_readFileDescriptor},
 
@@ -830,6 +1098,7 @@ int register_android_os_Parcel(JNIEnv* env)
     gParcelOffsets.mNativePtr = GetFieldIDOrDie(env, clazz, "mNativePtr", "J");
     gParcelOffsets.obtain = GetStaticMethodIDOrDie(env, clazz, "obtain", "()Landroid/os/Parcel;");
     gParcelOffsets.recycle = GetMethodIDOrDie(env, clazz, "recycle", "()V");
+    gStringClass = MakeGlobalRefOrDie(env, FindClassOrDie(env, "java/lang/String"));
 
     return RegisterMethodsOrDie(env, kParcelPathName, gParcelMethods, NELEM(gParcelMethods));
 }
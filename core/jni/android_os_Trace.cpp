@@ -41,12 +41,60 @@ static void sanitizeString(String8& utf8Chars) {
     utf8Chars.unlockBuffer();
 }
 
+// Most trace names are short ASCII strings, they are copied into a stack buffer of this size
+// rather than converted through a String8.
+static constexpr jsize kMaxAsciiNameLength = 256;
+
+/*
+ * The sanitized UTF-8 name of a trace event. An ASCII name that fits in the buffer is copied
+ * straight out of the Java string, other names go through String8.
+ */
+class TraceName {
+public:
+    TraceName(JNIEnv* env, jstring nameStr) {
+        jsize length = env->GetStringLength(nameStr);
+        // The modified UTF-8 length only equals the length if all the chars are in [1, 0x7f].
+        if (length < kMaxAsciiNameLength && env->GetStringUTFLength(nameStr) == length) {
+            env->GetStringUTFRegion(nameStr, 0, length, mAscii);
+            mAscii[length] = '\0';
+            for (jsize i = 0; i < length; i++) {
+                if (mAscii[i] == '\n' || mAscii[i] == '|') {
+                    mAscii[i] = ' ';
+                }
+            }
+            mName = mAscii;
+        } else {
+            ScopedStringChars jchars(env, nameStr);
+            mUtf8 = String8(reinterpret_cast<const char16_t*>(jchars.get()), jchars.size());
+            sanitizeString(mUtf8);
+            mName = mUtf8.string();
+        }
+    }
+
+    const char* c_str() const {
+        return mName;
+    }
+
+private:
+    char mAscii[kMaxAsciiNameLength];
+    String8 mUtf8;
+    const char* mName;
+};
+
+// @CriticalNative
+static jboolean android_os_Trace_nativeIsTagEnabled(jlong tag) {
+    return atrace_is_tag_enabled(tag) ? JNI_TRUE : JNI_FALSE;
+}
+
 static jlong android_os_Trace_nativeGetEnabledTags(JNIEnv* env, jclass clazz) {
     return atrace_get_enabled_tags();
 }
 
 static void android_os_Trace_nativeTraceCounter(JNIEnv* env, jclass clazz,
         jlong tag, jstring nameStr, jint value) {
+    if (!atrace_is_tag_enabled(tag)) {
+        return;
+    }
     ScopedUtfChars name(env, nameStr);
 
     ALOGV("%s: %" PRId64 " %s %d", __FUNCTION__, tag, name.c_str(), value);
@@ -55,12 +103,14 @@ static void android_os_Trace_nativeTraceCounter(JNIEnv* env, jclass clazz,
 
 static void android_os_Trace_nativeTraceBegin(JNIEnv* env, jclass clazz,
         jlong tag, jstring nameStr) {
-    ScopedStringChars jchars(env, nameStr);
-    String8 utf8Chars(reinterpret_cast<const char16_t*>(jchars.get()), jchars.size());
-    sanitizeString(utf8Chars);
+    // Don't convert the name of an event that isn't traced.
+    if (!atrace_is_tag_enabled(tag)) {
+        return;
+    }
+    TraceName name(env, nameStr);
 
-    ALOGV("%s: %" PRId64 " %s", __FUNCTION__, tag, utf8Chars.string());
-    atrace_begin(tag, utf8Chars.string());
+    ALOGV("%s: %" PRId64 " %s", __FUNCTION__, tag, name.c_str());
+    atrace_begin(tag, name.c_str());
 }
 
 static void android_os_Trace_nativeTraceEnd(JNIEnv* env, jclass clazz,
@@ -72,22 +122,24 @@ static void android_os_Trace_nativeTraceEnd(JNIEnv* env, jclass clazz,
 
 static void android_os_Trace_nativeAsyncTraceBegin(JNIEnv* env, jclass clazz,
         jlong tag, jstring nameStr, jint cookie) {
-    ScopedStringChars jchars(env, nameStr);
-    String8 utf8Chars(reinterpret_cast<const char16_t*>(jchars.get()), jchars.size());
-    sanitizeString(utf8Chars);
+    if (!atrace_is_tag_enabled(tag)) {
+        return;
+    }
+    TraceName name(env, nameStr);
 
-    ALOGV("%s: %" PRId64 " %s %d", __FUNCTION__, tag, utf8Chars.string(), cookie);
-    atrace_async_begin(tag, utf8Chars.string(), cookie);
+    ALOGV("%s: %" PRId64 " %s %d", __FUNCTION__, tag, name.c_str(), cookie);
+    atrace_async_begin(tag, name.c_str(), cookie);
 }
 
 static void android_os_Trace_nativeAsyncTraceEnd(JNIEnv* env, jclass clazz,
         jlong tag, jstring nameStr, jint cookie) {
-    ScopedStringChars jchars(env, nameStr);
-    String8 utf8Chars(reinterpret_cast<const char16_t*>(jchars.get()), jchars.size());
-    sanitizeString(utf8Chars);
+    if (!atrace_is_tag_enabled(tag)) {
+        return;
+    }
+    TraceName name(env, nameStr);
 
-    ALOGV("%s: %" PRId64 " %s %d", __FUNCTION__, tag, utf8Chars.string(), cookie);
-    atrace_async_end(tag, utf8Chars.string(), cookie);
+    ALOGV("%s: %" PRId64 " %s %d", __FUNCTION__, tag, name.c_str(), cookie);
+    atrace_async_end(tag, name.c_str(), cookie);
 }
 
 static void android_os_Trace_nativeSetAppTracingAllowed(JNIEnv* env,
@@ -133,6 +185,12 @@ static const JNINativeMethod gTraceMethods[] = {
     { "nativeAsyncTraceEnd",
             "(JLjava/lang/String;I)V",
             (void*)android_os_Trace_nativeAsyncTraceEnd },
+
+    // ----------- @CriticalNative  ----------------
+
+    { "nativeIsTagEnabled",
+            "(J)Z",
+            (void*)android_os_Trace_nativeIsTagEnabled },
 };
 
 int register_android_os_Trace(JNIEnv* env) {
@@ -25,8 +25,11 @@
 #include <nativehelper/ScopedStringChars.h>
 #include <nativehelper/ScopedPrimitiveArray.h>
 #include <nativehelper/JNIHelp.h>
+#include <nativehelper/ScopedLocalRef.h>
 #include "core_jni_helpers.h"
+#include <atomic>
 #include <cstdint>
+#include <thread>
 #include <vector>
 #include <list>
 #include <algorithm>
@@ -95,6 +98,61 @@ static jlong nBuildNativeMeasuredParagraph(JNIEnv* env, jclass /* unused */, jlo
                                                 computeLayout).release());
 }
 
+// The most threads nBuildNativeMeasuredParagraphs measures on, including the calling one.
+static constexpr size_t kMaxMeasureThreads = 4;
+
+// Regular JNI
+// Builds the paragraphs of a batch of builders, whose style runs hold the resolved typefaces and
+// paints already, on a few threads. Fills outPtrs with the built paragraphs, passing their
+// ownership to Java.
+static void nBuildNativeMeasuredParagraphs(JNIEnv* env, jclass /* unused */,
+                                           jlongArray javaBuilderPtrs, jobjectArray javaTexts,
+                                           jboolean computeHyphenation, jboolean computeLayout,
+                                           jlongArray javaOutPtrs) {
+    ScopedLongArrayRO builderPtrs(env, javaBuilderPtrs);
+    const size_t count = builderPtrs.size();
+    if (env->GetArrayLength(javaTexts) != static_cast<jsize>(count) ||
+            env->GetArrayLength(javaOutPtrs) != static_cast<jsize>(count)) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                          "builders, texts and results must have the same length");
+        return;
+    }
+
+    // The texts are copied so the workers don't touch Java arrays.
+    std::vector<std::vector<uint16_t>> texts(count);
+    for (size_t i = 0; i < count; i++) {
+        ScopedLocalRef<jcharArray> javaText(env,
+                static_cast<jcharArray>(env->GetObjectArrayElement(javaTexts, i)));
+        ScopedCharArrayRO text(env, javaText.get());
+        if (text.get() == nullptr) {
+            return;  // An exception is pending.
+        }
+        texts[i].assign(text.get(), text.get() + text.size());
+    }
+
+    std::vector<jlong> results(count);
+    std::atomic<size_t> next(0);
+    auto measure = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            const minikin::U16StringPiece textBuffer(texts[i].data(), texts[i].size());
+            results[i] = toJLong(toBuilder(builderPtrs[i])->build(textBuffer, computeHyphenation,
+                                                                  computeLayout).release());
+        }
+    };
+
+    const size_t threadCount = std::min(count, kMaxMeasureThreads);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threadCount; i++) {
+        workers.emplace_back(measure);
+    }
+    measure();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    env->SetLongArrayRegion(javaOutPtrs, 0, count, results.data());
+}
+
 // Regular JNI
 static void nFreeBuilder(JNIEnv* env, jclass /* unused */, jlong builderPtr) {
     delete toBuilder(builderPtr);
@@ -145,6 +203,7 @@ static const JNINativeMethod gMethods[] = {
     {"nAddStyleRun", "(JJIIZ)V", (void*) nAddStyleRun},
     {"nAddReplacementRun", "(JJIIF)V", (void*) nAddReplacementRun},
     {"nBuildNativeMeasuredParagraph", "(J[CZZ)J", (void*) nBuildNativeMeasuredParagraph},
+    {"nBuildNativeMeasuredParagraphs", "([J[[CZZ[J)V", (void*) nBuildNativeMeasuredParagraphs},
     {"nFreeBuilder", "(J)V", (void*) nFreeBuilder},
 
     // MeasuredParagraph native functions.
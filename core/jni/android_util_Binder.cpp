@@ -20,13 +20,17 @@
 #include "android_os_Parcel.h"
 #include "android_util_Binder.h"
 
+#include <algorithm>
 #include <atomic>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <mutex>
 #include <stdio.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <unordered_map>
+#include <vector>
 
 #include <android-base/stringprintf.h>
 #include <binder/IInterface.h>
@@ -37,11 +41,14 @@
 #include <binder/ProcessState.h>
 #include <cutils/atomic.h>
 #include <log/log.h>
+#include <utils/JenkinsHash.h>
 #include <utils/KeyedVector.h>
 #include <utils/List.h>
 #include <utils/Log.h>
+#include <utils/String16.h>
 #include <utils/String8.h>
 #include <utils/SystemClock.h>
+#include <utils/Timers.h>
 #include <utils/threads.h>
 
 #include <nativehelper/JNIHelp.h>
@@ -296,6 +303,166 @@ static void report_exception(JNIEnv* env, jthrowable excep, const char* msg)
     }
 }
 
+// ----------------------------------------------------------------------------
+// Opt-in latency histograms of the binder transactions, per interface, code and direction.
+// Every thread records into its own table and the tables are only merged when they're read,
+// so a transaction never waits on another one.
+
+// Bucket i counts the transactions that took less than 2^i microseconds, the last one the rest.
+static constexpr size_t kLatencyBuckets = 24;
+
+struct LatencyKey
+{
+    String16 interface;
+    // Outgoing transactions are keyed by their proxy instead of its interface, fetching the
+    // descriptor can be a transaction of its own. It is only resolved when the latencies are read.
+    wp<IBinder> proxy;
+    uint32_t code;
+    bool incoming;
+
+    bool operator==(const LatencyKey& other) const {
+        // The weak reference keeps the refs alive, so a new proxy never compares equal to an old one
+        return code == other.code && incoming == other.incoming
+                && proxy.get_refs() == other.proxy.get_refs() && interface == other.interface;
+    }
+};
+
+struct LatencyKeyHash
+{
+    size_t operator()(const LatencyKey& key) const {
+        uint32_t hash = JenkinsHashMix(key.code, key.incoming);
+        hash = JenkinsHashMix(hash, static_cast<uint32_t>(
+                reinterpret_cast<uintptr_t>(key.proxy.get_refs())));
+        hash = JenkinsHashMixShorts(hash, reinterpret_cast<const uint16_t*>(key.interface.string()),
+                key.interface.size());
+        return JenkinsHashWhiten(hash);
+    }
+};
+
+struct LatencyHistogram
+{
+    uint64_t counts[kLatencyBuckets] = {};
+    uint64_t count = 0;
+    uint64_t totalMicros = 0;
+
+    void add(int64_t micros) {
+        size_t bucket = 0;
+        while (bucket < kLatencyBuckets - 1 && micros >= (int64_t(1) << bucket)) {
+            bucket++;
+        }
+        counts[bucket]++;
+        count++;
+        totalMicros += micros;
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < kLatencyBuckets; i++) {
+            counts[i] += other.counts[i];
+        }
+        count += other.count;
+        totalMicros += other.totalMicros;
+    }
+
+    // The upper bound of the bucket holding the given percentile, in microseconds.
+    int64_t percentile(int percent) const {
+        const uint64_t rank = (count * percent + 99) / 100;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kLatencyBuckets - 1; i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return int64_t(1) << i;
+            }
+        }
+        return int64_t(1) << (kLatencyBuckets - 1);
+    }
+};
+
+typedef std::unordered_map<LatencyKey, LatencyHistogram, LatencyKeyHash> LatencyTable;
+
+static std::atomic<bool> gLatencyTrackingEnabled(false);
+
+struct ThreadLatencies;
+
+// Guards the list of the threads' tables and the latencies of the threads that exited.
+static std::mutex gLatencyThreadsLock;
+static std::vector<ThreadLatencies*> gLatencyThreads;
+static LatencyTable gExitedThreadLatencies;
+
+struct ThreadLatencies
+{
+    // Only ever contended by the reader.
+    std::mutex lock;
+    LatencyTable table;
+
+    ThreadLatencies() {
+        std::lock_guard<std::mutex> _l(gLatencyThreadsLock);
+        gLatencyThreads.push_back(this);
+    }
+
+    ~ThreadLatencies() {
+        std::lock_guard<std::mutex> _l(gLatencyThreadsLock);
+        gLatencyThreads.erase(std::find(gLatencyThreads.begin(), gLatencyThreads.end(), this));
+        for (const auto& entry : table) {
+            gExitedThreadLatencies[entry.first].merge(entry.second);
+        }
+    }
+};
+
+static void recordBinderLatency(const LatencyKey& key, nsecs_t startNs)
+{
+    const int64_t micros = (systemTime(SYSTEM_TIME_MONOTONIC) - startNs) / 1000;
+    thread_local ThreadLatencies latencies;
+    std::lock_guard<std::mutex> _l(latencies.lock);
+    latencies.table[key].add(micros);
+}
+
+namespace android {
+
+void setBinderLatencyTrackingEnabled(bool enabled)
+{
+    gLatencyTrackingEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void dumpBinderLatencies(int fd)
+{
+    LatencyTable merged;
+    {
+        std::lock_guard<std::mutex> _l(gLatencyThreadsLock);
+        merged = gExitedThreadLatencies;
+        for (ThreadLatencies* thread : gLatencyThreads) {
+            std::lock_guard<std::mutex> _tl(thread->lock);
+            for (const auto& entry : thread->table) {
+                merged[entry.first].merge(entry.second);
+            }
+        }
+    }
+
+    // Resolve the interfaces of the proxies, outside of the locks as it may take a transaction
+    LatencyTable byInterface;
+    for (const auto& entry : merged) {
+        LatencyKey key{entry.first.interface, nullptr, entry.first.code, entry.first.incoming};
+        if (entry.first.proxy != nullptr) {
+            sp<IBinder> proxy = entry.first.proxy.promote();
+            key.interface = proxy != nullptr ? proxy->getInterfaceDescriptor()
+                                             : String16("<dead proxy>");
+        }
+        byInterface[key].merge(entry.second);
+    }
+
+    dprintf(fd, "Binder transaction latencies (%s):\n",
+            gLatencyTrackingEnabled.load(std::memory_order_relaxed) ? "enabled" : "disabled");
+    for (const auto& entry : byInterface) {
+        const LatencyHistogram& histogram = entry.second;
+        dprintf(fd, "  %s %s code=%" PRIu32 " count=%" PRIu64 " avg=%" PRIu64 "us"
+                " p50<%" PRId64 "us p90<%" PRId64 "us p99<%" PRId64 "us\n",
+                entry.first.incoming ? "in " : "out", String8(entry.first.interface).string(),
+                entry.first.code, histogram.count, histogram.totalMicros / histogram.count,
+                histogram.percentile(50), histogram.percentile(90), histogram.percentile(99));
+    }
+}
+
+}
+
 class JavaBBinderHolder;
 
 class JavaBBinder : public BBinder
@@ -338,6 +505,9 @@ protected:
         IPCThreadState* thread_state = IPCThreadState::self();
         const int32_t strict_policy_before = thread_state->getStrictModePolicy();
 
+        const bool track_latency = gLatencyTrackingEnabled.load(std::memory_order_relaxed);
+        const nsecs_t start_ns = track_latency ? systemTime(SYSTEM_TIME_MONOTONIC) : 0;
+
         //printf("Transact from %p to Java code sending: ", this);
         //data.print();
         //printf("\n");
@@ -372,6 +542,11 @@ protected:
             BBinder::onTransact(code, data, reply, flags);
         }
 
+        if (track_latency) {
+            recordBinderLatency(LatencyKey{className(env), nullptr, code, true /*incoming*/},
+                    start_ns);
+        }
+
         //aout << "onTransact to Java code; result=" << res << endl
         //    << "Transact from " << this << " to Java code returning "
         //    << reply << ": " << *reply << endl;
@@ -384,8 +559,32 @@ protected:
     }
 
 private:
+    // The name of the Java Binder's class, which tells the interface apart for the latencies.
+    const String16& className(JNIEnv* env)
+    {
+        std::call_once(mClassNameOnce, [this, env]() {
+            ScopedLocalRef<jclass> objClassRef(env, env->GetObjectClass(mObject));
+            ScopedLocalRef<jstring> nameRef(env,
+                    (jstring) env->CallObjectMethod(objClassRef.get(), gClassOffsets.mGetName));
+            if (nameRef.get() == NULL) {
+                env->ExceptionClear();
+                return;
+            }
+            const jchar* name = env->GetStringChars(nameRef.get(), NULL);
+            if (name != NULL) {
+                mClassName.setTo(reinterpret_cast<const char16_t*>(name),
+                        env->GetStringLength(nameRef.get()));
+                env->ReleaseStringChars(nameRef.get(), name);
+            }
+        });
+        return mClassName;
+    }
+
     JavaVM* const   mVM;
     jobject const   mObject;  // GlobalRef to Java Binder
+
+    std::once_flag  mClassNameOnce;
+    String16        mClassName;
 };
 
 // ----------------------------------------------------------------------------
@@ -1061,6 +1260,23 @@ static void android_os_BinderInternal_setBinderProxyCountWatermarks(JNIEnv* env,
 
 // ----------------------------------------------------------------------------
 
+static void android_os_BinderInternal_setBinderLatencyTrackingEnabled(JNIEnv* env, jobject clazz,
+                                                                     jboolean enabled)
+{
+    setBinderLatencyTrackingEnabled((bool) enabled);
+}
+
+static void android_os_BinderInternal_dumpBinderLatencies(JNIEnv* env, jobject clazz,
+                                                         jobject fileDescriptor)
+{
+    const int fd = jniGetFDFromFileDescriptor(env, fileDescriptor);
+    if (fd < 0) {
+        jniThrowException(env, "java/lang/IllegalArgumentException", "invalid file descriptor");
+        return;
+    }
+    dumpBinderLatencies(fd);
+}
+
 static const JNINativeMethod gBinderInternalMethods[] = {
      /* name, signature, funcPtr */
     { "getContextObject", "()Landroid/os/IBinder;", (void*)android_os_BinderInternal_getContextObject },
@@ -1071,7 +1287,9 @@ static const JNINativeMethod gBinderInternalMethods[] = {
     { "nSetBinderProxyCountEnabled", "(Z)V", (void*)android_os_BinderInternal_setBinderProxyCountEnabled },
     { "nGetBinderProxyPerUidCounts", "()Landroid/util/SparseIntArray;", (void*)android_os_BinderInternal_getBinderProxyPerUidCounts },
     { "nGetBinderProxyCount", "(I)I", (void*)android_os_BinderInternal_getBinderProxyCount },
-    { "nSetBinderProxyCountWatermarks", "(II)V", (void*)android_os_BinderInternal_setBinderProxyCountWatermarks}
+    { "nSetBinderProxyCountWatermarks", "(II)V", (void*)android_os_BinderInternal_setBinderProxyCountWatermarks},
+    { "nSetBinderLatencyTrackingEnabled", "(Z)V", (void*)android_os_BinderInternal_setBinderLatencyTrackingEnabled },
+    { "nDumpBinderLatencies", "(Ljava/io/FileDescriptor;)V", (void*)android_os_BinderInternal_dumpBinderLatencies }
 };
 
 const char* const kBinderInternalPathName = "com/android/internal/os/BinderInternal";
@@ -1271,6 +1489,9 @@ static jboolean android_os_BinderProxy_transact(JNIEnv* env, jobject obj,
         }
     }
 
+    const bool track_latency = gLatencyTrackingEnabled.load(std::memory_order_relaxed);
+    const nsecs_t start_ns = track_latency ? systemTime(SYSTEM_TIME_MONOTONIC) : 0;
+
     //printf("Transact from Java code to %p sending: ", target); data->print();
     status_t err = target->transact(code, *data, reply, flags);
     //if (reply) printf("Transact from Java code to %p received: ", target); reply->print();
@@ -1281,6 +1502,10 @@ static jboolean android_os_BinderProxy_transact(JNIEnv* env, jobject obj,
         }
     }
 
+    if (track_latency) {
+        recordBinderLatency(LatencyKey{String16(), target, code, false /*incoming*/}, start_ns);
+    }
+
     if (err == NO_ERROR) {
         return JNI_TRUE;
     } else if (err == UNKNOWN_TRANSACTION) {
@@ -35,6 +35,12 @@ extern void set_dalvik_blockguard_policy(JNIEnv* env, jint strict_policy);
 extern void signalExceptionForError(JNIEnv* env, jobject obj, status_t err,
         bool canThrowRemoteException = false, int parcelSize = 0);
 
+// Starts or stops recording the latencies of the transactions of the Java binders and proxies.
+extern void setBinderLatencyTrackingEnabled(bool enabled);
+
+// Writes the latency histograms recorded so far, per interface and transaction code, to fd.
+extern void dumpBinderLatencies(int fd);
+
 }
 
 #endif
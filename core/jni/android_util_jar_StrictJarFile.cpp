@@ -17,10 +17,18 @@
 
 #define LOG_TAG "StrictJarFile"
 
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <log/log.h>
+#include <openssl/sha.h>
 
 #include <nativehelper/JNIHelp.h>
 #include <nativehelper/JniConstants.h>
@@ -152,6 +160,156 @@ static jobject StrictJarFile_nativeFindEntry(JNIEnv* env, jobject, jlong nativeH
   return newZipEntry(env, data, entryName);
 }
 
+// The algorithms of nativeDigestEntries, keep in sync with StrictJarFile.DIGEST_*.
+static const jint kDigestSha1 = 1;
+static const jint kDigestSha256 = 2;
+
+// Digesting an entry is bound by its inflation, so there is no point in more workers than this.
+static const size_t kMaxDigestThreads = 8;
+
+class EntryDigester {
+ public:
+  explicit EntryDigester(jint algorithm) : sha256_(algorithm == kDigestSha256) {
+    if (sha256_) {
+      SHA256_Init(&sha256Context_);
+    } else {
+      SHA1_Init(&sha1Context_);
+    }
+  }
+
+  static bool Update(const uint8_t* buf, size_t size, void* cookie) {
+    EntryDigester* digester = reinterpret_cast<EntryDigester*>(cookie);
+    if (digester->sha256_) {
+      SHA256_Update(&digester->sha256Context_, buf, size);
+    } else {
+      SHA1_Update(&digester->sha1Context_, buf, size);
+    }
+    return true;
+  }
+
+  std::vector<uint8_t> Final() {
+    std::vector<uint8_t> digest(sha256_ ? SHA256_DIGEST_LENGTH : SHA_DIGEST_LENGTH);
+    if (sha256_) {
+      SHA256_Final(digest.data(), &sha256Context_);
+    } else {
+      SHA1_Final(digest.data(), &sha1Context_);
+    }
+    return digest;
+  }
+
+ private:
+  const bool sha256_;
+  SHA_CTX sha1Context_;
+  SHA256_CTX sha256Context_;
+};
+
+// Digests a stored entry straight from a mapping of the archive, which saves copying it
+// through the read buffer of ProcessZipEntryContents().
+static bool DigestStoredEntry(int fd, const ZipEntry& entry, EntryDigester* digester) {
+  static const off64_t pageSize = sysconf(_SC_PAGESIZE);
+  const off64_t mapOffset = entry.offset & ~(pageSize - 1);
+  const size_t mapLength = entry.offset - mapOffset + entry.uncompressed_length;
+  void* map = mmap64(NULL, mapLength, PROT_READ, MAP_PRIVATE, fd, mapOffset);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  madvise(map, mapLength, MADV_SEQUENTIAL);
+  EntryDigester::Update(reinterpret_cast<const uint8_t*>(map) + (entry.offset - mapOffset),
+                        entry.uncompressed_length, digester);
+  munmap(map, mapLength);
+  return true;
+}
+
+/*
+ * Returns the digests of the uncompressed contents of the entries, null for the entries that
+ * aren't in the archive. The entries are read and inflated in parallel; the reads of an archive
+ * opened from a file descriptor are preads, so the handle can be shared by the workers.
+ */
+static jobjectArray StrictJarFile_nativeDigestEntries(JNIEnv* env, jobject, jlong nativeHandle,
+                                                      jobjectArray entryNames, jint algorithm) {
+  if (entryNames == NULL) {
+    jniThrowNullPointerException(env, "entryNames == null");
+    return NULL;
+  }
+  if (algorithm != kDigestSha1 && algorithm != kDigestSha256) {
+    jniThrowExceptionFmt(env, "java/lang/IllegalArgumentException",
+                         "unknown digest algorithm %d", algorithm);
+    return NULL;
+  }
+
+  const jsize count = env->GetArrayLength(entryNames);
+  std::vector<std::string> names(count);
+  for (jsize i = 0; i < count; i++) {
+    ScopedLocalRef<jstring> name(env,
+        reinterpret_cast<jstring>(env->GetObjectArrayElement(entryNames, i)));
+    ScopedUtfChars nameChars(env, name.get());
+    if (nameChars.c_str() == NULL) {
+      return NULL;
+    }
+    names[i] = nameChars.c_str();
+  }
+
+  ZipArchiveHandle handle = reinterpret_cast<ZipArchiveHandle>(nativeHandle);
+  const int fd = GetFileDescriptor(handle);
+  std::vector<std::vector<uint8_t>> digests(count);
+  std::vector<int32_t> errors(count, 0);
+  std::atomic<size_t> next(0);
+  auto digestEntries = [&]() {
+    for (size_t i = next++; i < names.size(); i = next++) {
+      ZipEntry entry;
+      // Missing entries are left without a digest
+      if (FindEntry(handle, ZipString(names[i].c_str()), &entry) != 0) {
+        continue;
+      }
+      EntryDigester digester(algorithm);
+      if (entry.method != kCompressStored || !DigestStoredEntry(fd, entry, &digester)) {
+        errors[i] = ProcessZipEntryContents(handle, &entry, EntryDigester::Update, &digester);
+        if (errors[i] != 0) {
+          continue;
+        }
+      }
+      digests[i] = digester.Final();
+    }
+  };
+
+  const size_t threadCount = std::min<size_t>(
+      {std::max(std::thread::hardware_concurrency(), 1u), kMaxDigestThreads, names.size()});
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < threadCount; i++) {
+    workers.emplace_back(digestEntries);
+  }
+  digestEntries();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  for (jsize i = 0; i < count; i++) {
+    if (errors[i] != 0) {
+      throwIoException(env, errors[i]);
+      return NULL;
+    }
+  }
+
+  ScopedLocalRef<jclass> byteArrayClass(env, env->FindClass("[B"));
+  jobjectArray result = env->NewObjectArray(count, byteArrayClass.get(), NULL);
+  if (result == NULL) {
+    return NULL;
+  }
+  for (jsize i = 0; i < count; i++) {
+    if (digests[i].empty()) {
+      continue;
+    }
+    ScopedLocalRef<jbyteArray> digest(env, env->NewByteArray(digests[i].size()));
+    if (digest.get() == NULL) {
+      return NULL;
+    }
+    env->SetByteArrayRegion(digest.get(), 0, digests[i].size(),
+                            reinterpret_cast<const jbyte*>(digests[i].data()));
+    env->SetObjectArrayElement(result, i, digest.get());
+  }
+  return result;
+}
+
 static void StrictJarFile_nativeClose(JNIEnv*, jobject, jlong nativeHandle) {
   CloseArchive(reinterpret_cast<ZipArchiveHandle>(nativeHandle));
 }
@@ -161,6 +319,7 @@ static JNINativeMethod gMethods[] = {
   NATIVE_METHOD(StrictJarFile, nativeStartIteration, "(JLjava/lang/String;)J"),
   NATIVE_METHOD(StrictJarFile, nativeNextEntry, "(J)Ljava/util/zip/ZipEntry;"),
   NATIVE_METHOD(StrictJarFile, nativeFindEntry, "(JLjava/lang/String;)Ljava/util/zip/ZipEntry;"),
+  NATIVE_METHOD(StrictJarFile, nativeDigestEntries, "(J[Ljava/lang/String;I)[[B"),
   NATIVE_METHOD(StrictJarFile, nativeClose, "(J)V"),
 };
 
@@ -29,6 +29,7 @@
 #include <utils/threads.h>
 #include <gui/DisplayEventReceiver.h>
 #include "android_os_MessageQueue.h"
+#include "android_view_InputEventReceiver.h"
 
 #include <nativehelper/ScopedLocalRef.h>
 
@@ -50,6 +51,7 @@ public:
             jobject receiverWeak, const sp<MessageQueue>& messageQueue, jint vsyncSource);
 
     void dispose();
+    void setFrameInputConsumer(const sp<FrameInputConsumer>& consumer);
 
 protected:
     virtual ~NativeDisplayEventReceiver();
@@ -58,6 +60,7 @@ private:
     jobject mReceiverWeakGlobal;
     sp<MessageQueue> mMessageQueue;
     DisplayEventReceiver mReceiver;
+    sp<FrameInputConsumer> mFrameInputConsumer;
 
     virtual void dispatchVsync(nsecs_t timestamp, int32_t id, uint32_t count);
     virtual void dispatchHotplug(nsecs_t timestamp, int32_t id, bool connected);
@@ -81,12 +84,29 @@ NativeDisplayEventReceiver::~NativeDisplayEventReceiver() {
 
 void NativeDisplayEventReceiver::dispose() {
     ALOGV("receiver %p ~ Disposing display event receiver.", this);
+    setFrameInputConsumer(NULL);
     DisplayEventDispatcher::dispose();
 }
 
+void NativeDisplayEventReceiver::setFrameInputConsumer(const sp<FrameInputConsumer>& consumer) {
+    if (mFrameInputConsumer != NULL) {
+        mFrameInputConsumer->setVsyncDispatcher(NULL);
+    }
+    mFrameInputConsumer = consumer;
+    if (mFrameInputConsumer != NULL) {
+        mFrameInputConsumer->setVsyncDispatcher(this);
+    }
+}
+
 void NativeDisplayEventReceiver::dispatchVsync(nsecs_t timestamp, int32_t id, uint32_t count) {
     JNIEnv* env = AndroidRuntime::getJNIEnv();
 
+    // Input goes first, as it would in the frame Choreographer schedules for the vsync.
+    if (mFrameInputConsumer != NULL && mFrameInputConsumer->hasPendingBatchedInput()) {
+        ALOGV("receiver %p ~ Consuming batched input.", this);
+        mFrameInputConsumer->consumeBatchedInput(env, timestamp);
+    }
+
     ScopedLocalRef<jobject> receiverObj(env, jniGetReferent(env, mReceiverWeakGlobal));
     if (receiverObj.get()) {
         ALOGV("receiver %p ~ Invoking vsync handler.", this);
@@ -153,6 +173,19 @@ static void nativeScheduleVsync(JNIEnv* env, jclass clazz, jlong receiverPtr) {
     }
 }
 
+// Has the display event receiver consume the batched input of the input event receiver with its
+// vsyncs. An inputReceiverPtr of 0 stops it.
+static void nativeSetInputEventReceiver(JNIEnv* env, jclass clazz, jlong receiverPtr,
+        jlong inputReceiverPtr) {
+    sp<NativeDisplayEventReceiver> receiver =
+            reinterpret_cast<NativeDisplayEventReceiver*>(receiverPtr);
+    sp<FrameInputConsumer> consumer;
+    if (inputReceiverPtr) {
+        consumer = android_view_InputEventReceiver_getFrameInputConsumer(inputReceiverPtr);
+    }
+    receiver->setFrameInputConsumer(consumer);
+}
+
 
 static const JNINativeMethod gMethods[] = {
     /* name, signature, funcPtr */
@@ -164,7 +197,9 @@ static const JNINativeMethod gMethods[] = {
             (void*)nativeDispose },
     // @FastNative
     { "nativeScheduleVsync", "(J)V",
-            (void*)nativeScheduleVsync }
+            (void*)nativeScheduleVsync },
+    { "nativeSetInputEventReceiver", "(JJ)V",
+            (void*)nativeSetInputEventReceiver }
 };
 
 int register_android_view_DisplayEventReceiver(JNIEnv* env) {
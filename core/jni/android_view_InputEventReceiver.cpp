@@ -30,6 +30,7 @@
 #include <input/InputTransport.h>
 #include "android_os_MessageQueue.h"
 #include "android_view_InputChannel.h"
+#include "android_view_InputEventReceiver.h"
 #include "android_view_KeyEvent.h"
 #include "android_view_MotionEvent.h"
 
@@ -50,7 +51,7 @@ static struct {
 } gInputEventReceiverClassInfo;
 
 
-class NativeInputEventReceiver : public LooperCallback {
+class NativeInputEventReceiver : public LooperCallback, public FrameInputConsumer {
 public:
     NativeInputEventReceiver(JNIEnv* env,
             jobject receiverWeak, const sp<InputChannel>& inputChannel,
@@ -62,6 +63,10 @@ public:
     status_t consumeEvents(JNIEnv* env, bool consumeBatches, nsecs_t frameTime,
             bool* outConsumedBatch);
 
+    virtual void setVsyncDispatcher(const wp<DisplayEventDispatcher>& dispatcher);
+    virtual bool hasPendingBatchedInput();
+    virtual status_t consumeBatchedInput(JNIEnv* env, nsecs_t frameTime);
+
 protected:
     virtual ~NativeInputEventReceiver();
 
@@ -80,6 +85,7 @@ private:
     Vector<Finish> mFinishQueue;
     int mLastMotionEventType = -1;
     int mLastTouchMoveNum = -1;
+    wp<DisplayEventDispatcher> mVsyncDispatcher;
 
     void setFdEvents(int events);
 
@@ -118,6 +124,22 @@ void NativeInputEventReceiver::dispose() {
     }
 
     setFdEvents(0);
+    mVsyncDispatcher.clear();
+    mBatchedInputEventPending = false;
+}
+
+void NativeInputEventReceiver::setVsyncDispatcher(const wp<DisplayEventDispatcher>& dispatcher) {
+    mVsyncDispatcher = dispatcher;
+}
+
+bool NativeInputEventReceiver::hasPendingBatchedInput() {
+    return mBatchedInputEventPending;
+}
+
+status_t NativeInputEventReceiver::consumeBatchedInput(JNIEnv* env, nsecs_t frameTime) {
+    status_t status = consumeEvents(env, true /*consumeBatches*/, frameTime, NULL);
+    mMessageQueue->raiseAndClearException(env, "consumeBatchedInput");
+    return status;
 }
 
 status_t NativeInputEventReceiver::finishInputEvent(uint32_t seq, bool handled) {
@@ -281,6 +303,13 @@ status_t NativeInputEventReceiver::consumeEvents(JNIEnv* env,
                     }
 
                     mBatchedInputEventPending = true;
+
+                    // The display event receiver consumes it along with the next vsync.
+                    sp<DisplayEventDispatcher> vsyncDispatcher = mVsyncDispatcher.promote();
+                    if (vsyncDispatcher != NULL && vsyncDispatcher->scheduleVsync() == OK) {
+                        return OK;
+                    }
+
                     if (kDebugDispatchCycle) {
                         ALOGD("channel '%s' ~ Dispatching batched input event pending notification.",
                                 getInputChannelName().c_str());
@@ -428,6 +457,12 @@ static jboolean nativeConsumeBatchedInputEvents(JNIEnv* env, jclass clazz, jlong
 }
 
 
+sp<FrameInputConsumer> android_view_InputEventReceiver_getFrameInputConsumer(
+        jlong receiverPtr) {
+    return reinterpret_cast<NativeInputEventReceiver*>(receiverPtr);
+}
+
+
 static const JNINativeMethod gMethods[] = {
     /* name, signature, funcPtr */
     { "nativeInit",
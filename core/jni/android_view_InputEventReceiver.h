@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ANDROID_VIEW_INPUTEVENTRECEIVER_H
+#define _ANDROID_VIEW_INPUTEVENTRECEIVER_H
+
+#include "jni.h"
+
+#include <androidfw/DisplayEventDispatcher.h>
+#include <utils/RefBase.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+/* The batched input of an input event receiver, consumed by a display event receiver right
+ * before it dispatches the vsync, so both are handled in the same looper callback instead of
+ * with a separate wake up and upcall for the pending batch. */
+class FrameInputConsumer : public virtual RefBase {
+public:
+    /* Once set, a pending batch schedules a vsync of the dispatcher instead of notifying the
+     * Java receiver, the dispatcher is then expected to consume it. */
+    virtual void setVsyncDispatcher(const wp<DisplayEventDispatcher>& dispatcher) = 0;
+
+    virtual bool hasPendingBatchedInput() = 0;
+
+    /* Dispatches the batched input events for the frame to the Java receiver. */
+    virtual status_t consumeBatchedInput(JNIEnv* env, nsecs_t frameTime) = 0;
+
+protected:
+    virtual ~FrameInputConsumer() { }
+};
+
+extern sp<FrameInputConsumer> android_view_InputEventReceiver_getFrameInputConsumer(
+        jlong receiverPtr);
+
+} // namespace android
+
+#endif // _ANDROID_VIEW_INPUTEVENTRECEIVER_H
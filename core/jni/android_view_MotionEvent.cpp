@@ -16,6 +16,8 @@
 
 #define LOG_TAG "MotionEvent-JNI"
 
+#include <algorithm>
+
 #include <nativehelper/JNIHelp.h>
 
 #include <SkMatrix.h>
@@ -570,6 +572,57 @@ static jfloat android_view_MotionEvent_nativeGetAxisValue(JNIEnv* env, jclass cl
     }
 }
 
+// Copies the x, y and pressure of every sample of a pointer, the historical ones first and the
+// current one last, to xyPressure as triplets and their event times to timesNanos. Stops when
+// either array is full and returns the number of samples the event has.
+static jint android_view_MotionEvent_nativeGetSamples(JNIEnv* env, jclass clazz,
+        jlong nativePtr, jint pointerIndex, jfloatArray xyPressureArray,
+        jlongArray timesNanosArray) {
+    MotionEvent* event = reinterpret_cast<MotionEvent*>(nativePtr);
+    size_t pointerCount = event->getPointerCount();
+    if (!validatePointerIndex(env, pointerIndex, pointerCount)) {
+        return 0;
+    }
+    if (!xyPressureArray || !timesNanosArray) {
+        jniThrowNullPointerException(env, "sample arrays must not be null");
+        return 0;
+    }
+
+    const size_t historySize = event->getHistorySize();
+    const size_t count = std::min(historySize + 1,
+            std::min(size_t(env->GetArrayLength(xyPressureArray)) / 3,
+                    size_t(env->GetArrayLength(timesNanosArray))));
+
+    jfloat* xyPressure = static_cast<jfloat*>(
+            env->GetPrimitiveArrayCritical(xyPressureArray, NULL));
+    if (!xyPressure) {
+        return 0;
+    }
+    jlong* timesNanos = static_cast<jlong*>(env->GetPrimitiveArrayCritical(timesNanosArray, NULL));
+    if (!timesNanos) {
+        env->ReleasePrimitiveArrayCritical(xyPressureArray, xyPressure, JNI_ABORT);
+        return 0;
+    }
+
+    for (size_t h = 0; h < count; h++) {
+        if (h < historySize) {
+            xyPressure[h * 3] = event->getHistoricalX(pointerIndex, h);
+            xyPressure[h * 3 + 1] = event->getHistoricalY(pointerIndex, h);
+            xyPressure[h * 3 + 2] = event->getHistoricalPressure(pointerIndex, h);
+            timesNanos[h] = event->getHistoricalEventTime(h);
+        } else {
+            xyPressure[h * 3] = event->getX(pointerIndex);
+            xyPressure[h * 3 + 1] = event->getY(pointerIndex);
+            xyPressure[h * 3 + 2] = event->getPressure(pointerIndex);
+            timesNanos[h] = event->getEventTime();
+        }
+    }
+
+    env->ReleasePrimitiveArrayCritical(timesNanosArray, timesNanos, 0);
+    env->ReleasePrimitiveArrayCritical(xyPressureArray, xyPressure, 0);
+    return jint(historySize + 1);
+}
+
 // ----------------- @CriticalNative ------------------------------
 
 static jlong android_view_MotionEvent_nativeCopy(jlong destNativePtr, jlong sourceNativePtr,
@@ -779,6 +832,9 @@ static const JNINativeMethod gMotionEventMethods[] = {
     { "nativeGetAxisValue",
             "(JIII)F",
             (void*)android_view_MotionEvent_nativeGetAxisValue },
+    { "nativeGetSamples",
+            "(JI[F[J)I",
+            (void*)android_view_MotionEvent_nativeGetSamples },
 
     // --------------- @CriticalNative ------------------
 
@@ -34,6 +34,7 @@
 #include <jni.h>
 #include <memory>
 #include <stdio.h>
+#include <string.h>
 #include <system/graphics.h>
 #include <ui/DisplayInfo.h>
 #include <ui/FrameStats.h>
@@ -864,6 +865,142 @@ static void nativeDestroyInTransaction(JNIEnv* env, jclass clazz,
     transaction->destroySurface(ctrl);
 }
 
+// The ops of a batch written by SurfaceControl.Transaction, keep in sync with its BATCH_OP_*
+// constants.
+enum BatchedOp : int32_t {
+    BATCH_OP_SET_LAYER = 1,                         // int z
+    BATCH_OP_SET_POSITION = 2,                      // float x, y
+    BATCH_OP_SET_SIZE = 3,                          // int w, h
+    BATCH_OP_SET_FLAGS = 4,                         // int flags, mask
+    BATCH_OP_SET_ALPHA = 5,                         // float alpha
+    BATCH_OP_SET_COLOR = 6,                         // float r, g, b
+    BATCH_OP_SET_MATRIX = 7,                        // float dsdx, dtdx, dtdy, dsdy
+    BATCH_OP_SET_WINDOW_CROP = 8,                   // int l, t, r, b
+    BATCH_OP_SET_FINAL_CROP = 9,                    // int l, t, r, b
+    BATCH_OP_SET_LAYER_STACK = 10,                  // int layerStack
+    BATCH_OP_SET_GEOMETRY_APPLIES_WITH_RESIZE = 11, // no arguments
+    BATCH_OP_SET_OVERRIDE_SCALING_MODE = 12,        // int scalingMode
+};
+
+// Every op starts with this header, followed by its arguments as 4 byte words in native order.
+struct BatchedOpHeader {
+    int32_t op;
+    int32_t argCount;
+    int64_t nativeObject;
+};
+
+// The argument count of each BatchedOp, -1 for the unknown ones.
+static int batchedOpArgCount(int32_t op) {
+    switch (op) {
+        case BATCH_OP_SET_GEOMETRY_APPLIES_WITH_RESIZE:
+            return 0;
+        case BATCH_OP_SET_LAYER:
+        case BATCH_OP_SET_ALPHA:
+        case BATCH_OP_SET_LAYER_STACK:
+        case BATCH_OP_SET_OVERRIDE_SCALING_MODE:
+            return 1;
+        case BATCH_OP_SET_POSITION:
+        case BATCH_OP_SET_SIZE:
+        case BATCH_OP_SET_FLAGS:
+            return 2;
+        case BATCH_OP_SET_COLOR:
+            return 3;
+        case BATCH_OP_SET_MATRIX:
+        case BATCH_OP_SET_WINDOW_CROP:
+        case BATCH_OP_SET_FINAL_CROP:
+            return 4;
+        default:
+            return -1;
+    }
+}
+
+/*
+ * Applies the ops of the first length bytes of a direct buffer to a transaction, in a single call
+ * instead of one JNI transition per op. Throws IllegalArgumentException at the first malformed
+ * op, the ops before it stay applied to the transaction.
+ */
+static void nativeApplyBatchedOps(JNIEnv* env, jclass clazz, jlong transactionObj,
+        jobject bufferObj, jint length) {
+    auto transaction = reinterpret_cast<SurfaceComposerClient::Transaction*>(transactionObj);
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(env->GetDirectBufferAddress(bufferObj));
+    if (data == NULL || length < 0 || length > env->GetDirectBufferCapacity(bufferObj)) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "ops must be in the length bytes of a direct buffer");
+        return;
+    }
+
+    const uint8_t* const end = data + length;
+    while (data < end) {
+        BatchedOpHeader header;
+        if (size_t(end - data) < sizeof(header)) {
+            jniThrowException(env, "java/lang/IllegalArgumentException", "truncated op header");
+            return;
+        }
+        memcpy(&header, data, sizeof(header));
+        data += sizeof(header);
+
+        // ints and floats are both 4 bytes, the words are reinterpreted per op
+        union {
+            int32_t i;
+            float f;
+        } args[4];
+        static_assert(sizeof(args[0]) == 4, "batched op arguments are 4 byte words");
+        if (header.argCount != batchedOpArgCount(header.op)) {
+            jniThrowExceptionFmt(env, "java/lang/IllegalArgumentException",
+                    "op %d with %d arguments", header.op, header.argCount);
+            return;
+        }
+        const size_t argBytes = header.argCount * sizeof(args[0]);
+        if (size_t(end - data) < argBytes) {
+            jniThrowExceptionFmt(env, "java/lang/IllegalArgumentException",
+                    "truncated arguments of op %d", header.op);
+            return;
+        }
+        memcpy(args, data, argBytes);
+        data += argBytes;
+
+        SurfaceControl* const ctrl = reinterpret_cast<SurfaceControl*>(header.nativeObject);
+        switch (header.op) {
+            case BATCH_OP_SET_LAYER:
+                transaction->setLayer(ctrl, args[0].i);
+                break;
+            case BATCH_OP_SET_POSITION:
+                transaction->setPosition(ctrl, args[0].f, args[1].f);
+                break;
+            case BATCH_OP_SET_SIZE:
+                transaction->setSize(ctrl, args[0].i, args[1].i);
+                break;
+            case BATCH_OP_SET_FLAGS:
+                transaction->setFlags(ctrl, args[0].i, args[1].i);
+                break;
+            case BATCH_OP_SET_ALPHA:
+                transaction->setAlpha(ctrl, args[0].f);
+                break;
+            case BATCH_OP_SET_COLOR:
+                transaction->setColor(ctrl, half3(args[0].f, args[1].f, args[2].f));
+                break;
+            case BATCH_OP_SET_MATRIX:
+                transaction->setMatrix(ctrl, args[0].f, args[1].f, args[2].f, args[3].f);
+                break;
+            case BATCH_OP_SET_WINDOW_CROP:
+                transaction->setCrop(ctrl, Rect(args[0].i, args[1].i, args[2].i, args[3].i));
+                break;
+            case BATCH_OP_SET_FINAL_CROP:
+                transaction->setFinalCrop(ctrl, Rect(args[0].i, args[1].i, args[2].i, args[3].i));
+                break;
+            case BATCH_OP_SET_LAYER_STACK:
+                transaction->setLayerStack(ctrl, args[0].i);
+                break;
+            case BATCH_OP_SET_GEOMETRY_APPLIES_WITH_RESIZE:
+                transaction->setGeometryAppliesWithResize(ctrl);
+                break;
+            case BATCH_OP_SET_OVERRIDE_SCALING_MODE:
+                transaction->setOverrideScalingMode(ctrl, args[0].i);
+                break;
+        }
+    }
+}
+
 static jobject nativeGetHandle(JNIEnv* env, jclass clazz, jlong nativeObject) {
     auto ctrl = reinterpret_cast<SurfaceControl *>(nativeObject);
     return javaObjectForIBinder(env, ctrl->getHandle());
@@ -1025,6 +1162,8 @@ static const JNINativeMethod sSurfaceControlMethods[] = {
             (void*)nativeDestroyInTransaction },
     {"nativeGetHandle", "(J)Landroid/os/IBinder;",
             (void*)nativeGetHandle },
+    {"nativeApplyBatchedOps", "(JLjava/nio/ByteBuffer;I)V",
+            (void*)nativeApplyBatchedOps },
     {"nativeScreenshotToBuffer",
      "(Landroid/os/IBinder;Landroid/graphics/Rect;IIIIZZI)Landroid/graphics/GraphicBuffer;",
      (void*)nativeScreenshotToBuffer },
@@ -19,6 +19,9 @@
 
 #include <algorithm>
 #include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
 #include <inttypes.h>
 
 #include "jni.h"
@@ -53,6 +56,7 @@
 #include <Properties.h>
 #include <PropertyValuesAnimatorSet.h>
 #include <RenderNode.h>
+#include <TessellationDiskCache.h>
 #include <renderthread/CanvasContext.h>
 #include <renderthread/RenderProxy.h>
 #include <renderthread/RenderTask.h>
@@ -69,6 +73,8 @@ struct {
     jfieldID timingDataBuffer;
     jfieldID messageQueue;
     jmethodID callback;
+    jmethodID renderNodeGpuTimesCallback;
+    jclass stringClass;
 } gFrameMetricsObserverClassInfo;
 
 struct {
@@ -537,9 +543,9 @@ public:
                 "unable to create frame stats observer reference");
 
         jlongArray buffer = get_metrics_buffer(env, observer);
+        // The Java buffer may predate the newer FrameInfo indices, copy the ones it knows about
         jsize bufferSize = env->GetArrayLength(reinterpret_cast<jarray>(buffer));
-        LOG_ALWAYS_FATAL_IF(bufferSize != kBufferSize,
-                "Mismatched Java/Native FrameMetrics data format.");
+        mSinkSize = std::min(static_cast<int>(bufferSize), kBufferSize);
 
         jobject messageQueueLocal = env->GetObjectField(
                 observer, gFrameMetricsObserverClassInfo.messageQueue);
@@ -564,7 +570,7 @@ public:
         FrameMetricsNotification& elem = mRingBuffer[mNextInQueue];
 
         if (elem.hasData.load()) {
-            env->SetLongArrayRegion(sink, 0, kBufferSize, elem.buffer);
+            env->SetLongArrayRegion(sink, 0, mSinkSize, elem.buffer);
             *dropCount = elem.dropCount;
             mNextInQueue = (mNextInQueue + 1) % kRingSize;
             elem.hasData = false;
@@ -593,9 +599,31 @@ public:
         }
     }
 
+    virtual void notifyRenderNodeGpuTimes(const std::vector<RenderNodeGpuTime>& times) {
+        std::lock_guard<std::mutex> lock(mGpuTimesLock);
+        bool wasEmpty = mGpuTimes.empty();
+        size_t count = std::min(times.size(), kMaxPendingGpuTimes - mGpuTimes.size());
+        mGpuTimes.insert(mGpuTimes.end(), times.begin(), times.begin() + count);
+        if (wasEmpty && !mGpuTimes.empty()) {
+            incStrong(nullptr);
+            mMessageQueue->getLooper()->sendMessage(mMessageHandler, mGpuTimesMessage);
+        }
+    }
+
+    std::vector<RenderNodeGpuTime> takeRenderNodeGpuTimes() {
+        std::lock_guard<std::mutex> lock(mGpuTimesLock);
+        std::vector<RenderNodeGpuTime> times;
+        times.swap(mGpuTimes);
+        return times;
+    }
+
+    static constexpr int kWhatRenderNodeGpuTimes = 1;
+
 private:
     static const int kBufferSize = static_cast<int>(FrameInfoIndex::NumIndexes);
     static constexpr int kRingSize = 3;
+    // The times of the frames past this, until the looper catches up, are dropped
+    static constexpr size_t kMaxPendingGpuTimes = 1024;
 
     class FrameMetricsNotification {
     public:
@@ -608,6 +636,8 @@ private:
 
     JavaVM* const mVm;
     jweak mObserverWeak;
+    // Number of the FrameInfo values copied to the Java buffer
+    int mSinkSize;
 
     sp<MessageQueue> mMessageQueue;
     sp<NotifyHandler> mMessageHandler;
@@ -618,19 +648,71 @@ private:
     FrameMetricsNotification mRingBuffer[kRingSize];
 
     int mDroppedReports = 0;
+
+    Message mGpuTimesMessage{kWhatRenderNodeGpuTimes};
+    std::mutex mGpuTimesLock;
+    std::vector<RenderNodeGpuTime> mGpuTimes;
 };
 
+// Calls FrameMetricsObserver#notifyRenderNodeGpuTimes with the times as parallel arrays
+static void deliverRenderNodeGpuTimes(JNIEnv* env, jobject target,
+        const std::vector<RenderNodeGpuTime>& times) {
+    jsize count = static_cast<jsize>(times.size());
+    jlongArray frameNumbers = env->NewLongArray(count);
+    jlongArray nodeIds = env->NewLongArray(count);
+    jlongArray durations = env->NewLongArray(count);
+    jobjectArray names = env->NewObjectArray(count,
+            gFrameMetricsObserverClassInfo.stringClass, nullptr);
+    if (frameNumbers != nullptr && nodeIds != nullptr && durations != nullptr &&
+            names != nullptr) {
+        std::vector<jlong> values(count);
+        for (jsize i = 0; i < count; i++) {
+            values[i] = times[i].frameNumber;
+        }
+        env->SetLongArrayRegion(frameNumbers, 0, count, values.data());
+        for (jsize i = 0; i < count; i++) {
+            values[i] = static_cast<jlong>(times[i].nodeId);
+        }
+        env->SetLongArrayRegion(nodeIds, 0, count, values.data());
+        for (jsize i = 0; i < count; i++) {
+            values[i] = times[i].durationNanos;
+        }
+        env->SetLongArrayRegion(durations, 0, count, values.data());
+        for (jsize i = 0; i < count; i++) {
+            jstring name = env->NewStringUTF(times[i].name.c_str());
+            env->SetObjectArrayElement(names, i, name);
+            env->DeleteLocalRef(name);
+        }
+        env->CallVoidMethod(target, gFrameMetricsObserverClassInfo.renderNodeGpuTimesCallback,
+                frameNumbers, nodeIds, names, durations);
+    } else {
+        ALOGW("OOM: unable to deliver RenderNode GPU times");
+        env->ExceptionClear();
+    }
+    env->DeleteLocalRef(frameNumbers);
+    env->DeleteLocalRef(nodeIds);
+    env->DeleteLocalRef(durations);
+    env->DeleteLocalRef(names);
+}
+
 void NotifyHandler::handleMessage(const Message& message) {
     JNIEnv* env = getenv(mVm);
 
     jobject target = env->NewLocalRef(mObserver->getObserverReference());
 
-    if (target != nullptr) {
+    if (message.what == ObserverProxy::kWhatRenderNodeGpuTimes) {
+        std::vector<RenderNodeGpuTime> times = mObserver->takeRenderNodeGpuTimes();
+        if (target != nullptr && !times.empty()) {
+            deliverRenderNodeGpuTimes(env, target, times);
+        }
+    } else if (target != nullptr) {
         jlongArray javaBuffer = get_metrics_buffer(env, target);
         int dropCount = 0;
         while (mObserver->getNextBuffer(env, javaBuffer, &dropCount)) {
             env->CallVoidMethod(target, gFrameMetricsObserverClassInfo.callback, dropCount);
         }
+    }
+    if (target != nullptr) {
         env->DeleteLocalRef(target);
     }
 
@@ -834,6 +916,7 @@ static void android_view_ThreadedRenderer_destroyHardwareResources(JNIEnv* env,
 static void android_view_ThreadedRenderer_trimMemory(JNIEnv* env, jobject clazz,
         jint level) {
     RenderProxy::trimMemory(level);
+    Bitmap::trimPixelBufferPool();
 }
 
 static void android_view_ThreadedRenderer_overrideProperty(JNIEnv* env, jobject clazz,
@@ -1108,6 +1191,13 @@ static void android_view_ThreadedRenderer_setupShadersDiskCache(JNIEnv* env, job
 
     const char* skiaCacheArray = env->GetStringUTFChars(skiaDiskCachePath, NULL);
     uirenderer::skiapipeline::ShaderCache::get().setFilename(skiaCacheArray);
+
+    // The tessellations are kept next to the shaders, in the same code cache directory
+    std::string tessellationCachePath(skiaCacheArray);
+    size_t slash = tessellationCachePath.rfind('/');
+    tessellationCachePath.erase(slash == std::string::npos ? 0 : slash + 1);
+    tessellationCachePath.append("com.android.hwui.tessellation");
+    uirenderer::TessellationDiskCache::get().setFilename(tessellationCachePath.c_str());
     env->ReleaseStringUTFChars(skiaDiskCachePath, skiaCacheArray);
 }
 
@@ -1206,6 +1296,10 @@ int register_android_view_ThreadedRenderer(JNIEnv* env) {
             env, observerClass, "mMessageQueue", "Landroid/os/MessageQueue;");
     gFrameMetricsObserverClassInfo.callback = GetMethodIDOrDie(
             env, observerClass, "notifyDataAvailable", "(I)V");
+    gFrameMetricsObserverClassInfo.renderNodeGpuTimesCallback = GetMethodIDOrDie(
+            env, observerClass, "notifyRenderNodeGpuTimes", "([J[J[Ljava/lang/String;[J)V");
+    gFrameMetricsObserverClassInfo.stringClass = MakeGlobalRefOrDie(
+            env, FindClassOrDie(env, "java/lang/String"));
 
     jclass metricsClass = FindClassOrDie(env, "android/view/FrameMetrics");
     gFrameMetricsObserverClassInfo.timingDataBuffer = GetFieldIDOrDie(
@@ -16,6 +16,8 @@
 
 #define LOG_TAG "VelocityTracker-JNI"
 
+#include <algorithm>
+
 #include <nativehelper/JNIHelp.h>
 
 #include <android_runtime/AndroidRuntime.h>
@@ -51,6 +53,7 @@ public:
     void addMovement(const MotionEvent* event);
     void computeCurrentVelocity(int32_t units, float maxVelocity);
     void getVelocity(int32_t id, float* outVx, float* outVy);
+    size_t getVelocities(int32_t* outIds, float* outVelocities, size_t maxCount);
     bool getEstimator(int32_t id, VelocityTracker::Estimator* outEstimator);
 
 private:
@@ -132,6 +135,20 @@ void VelocityTrackerState::getVelocity(int32_t id, float* outVx, float* outVy) {
     }
 }
 
+// Copies the ids of the pointers computeCurrentVelocity computed a velocity for and their vx, vy
+// pairs, up to maxCount of them, in id order. Returns the number of pointers copied.
+size_t VelocityTrackerState::getVelocities(int32_t* outIds, float* outVelocities,
+        size_t maxCount) {
+    BitSet32 idBits(mCalculatedIdBits);
+    size_t index = 0;
+    for (; index < maxCount && !idBits.isEmpty(); index++) {
+        outIds[index] = idBits.clearFirstMarkedBit();
+        outVelocities[index * 2] = mCalculatedVelocity[index].vx;
+        outVelocities[index * 2 + 1] = mCalculatedVelocity[index].vy;
+    }
+    return index;
+}
+
 bool VelocityTrackerState::getEstimator(int32_t id, VelocityTracker::Estimator* outEstimator) {
     return mVelocityTracker.getEstimator(id, outEstimator);
 }
@@ -176,6 +193,31 @@ static void android_view_VelocityTracker_nativeComputeCurrentVelocity(JNIEnv* en
     state->computeCurrentVelocity(units, maxVelocity);
 }
 
+// Computes the velocities of all the pointers like nativeComputeCurrentVelocity and returns them
+// in the same call: the pointer ids go to outIds and their vx, vy pairs to outVelocities.
+// Returns the number of pointers written, which is limited by the size of the arrays.
+static jint android_view_VelocityTracker_nativeComputeCurrentVelocities(JNIEnv* env,
+        jclass clazz, jlong ptr, jint units, jfloat maxVelocity, jintArray outIdsArray,
+        jfloatArray outVelocitiesArray) {
+    VelocityTrackerState* state = reinterpret_cast<VelocityTrackerState*>(ptr);
+    state->computeCurrentVelocity(units, maxVelocity);
+
+    if (!outIdsArray || !outVelocitiesArray) {
+        jniThrowNullPointerException(env, "output arrays must not be null");
+        return 0;
+    }
+    size_t maxCount = std::min(size_t(env->GetArrayLength(outIdsArray)),
+            size_t(env->GetArrayLength(outVelocitiesArray)) / 2);
+    maxCount = std::min(maxCount, size_t(MAX_POINTERS));
+
+    int32_t ids[MAX_POINTERS];
+    float velocities[MAX_POINTERS * 2];
+    const size_t count = state->getVelocities(ids, velocities, maxCount);
+    env->SetIntArrayRegion(outIdsArray, 0, count, ids);
+    env->SetFloatArrayRegion(outVelocitiesArray, 0, count * 2, velocities);
+    return count;
+}
+
 static jfloat android_view_VelocityTracker_nativeGetXVelocity(JNIEnv* env, jclass clazz,
         jlong ptr, jint id) {
     VelocityTrackerState* state = reinterpret_cast<VelocityTrackerState*>(ptr);
@@ -232,6 +274,9 @@ static const JNINativeMethod gVelocityTrackerMethods[] = {
     { "nativeComputeCurrentVelocity",
             "(JIF)V",
             (void*)android_view_VelocityTracker_nativeComputeCurrentVelocity },
+    { "nativeComputeCurrentVelocities",
+            "(JIF[I[F)I",
+            (void*)android_view_VelocityTracker_nativeComputeCurrentVelocities },
     { "nativeGetXVelocity",
             "(JI)F",
             (void*)android_view_VelocityTracker_nativeGetXVelocity },
@@ -17,6 +17,11 @@
 #include "androidfw/ApkAssets.h"
 
 #include <algorithm>
+#include <atomic>
+
+#ifndef _WIN32
+#include <thread>
+#endif
 
 #include "android-base/errors.h"
 #include "android-base/file.h"
@@ -25,6 +30,7 @@
 #include "android-base/utf8.h"
 #include "utils/Compat.h"
 #include "utils/FileMap.h"
+#include "utils/Trace.h"
 #include "ziparchive/zip_archive.h"
 
 #include "androidfw/Asset.h"
@@ -71,6 +77,48 @@ std::unique_ptr<const ApkAssets> ApkAssets::LoadOverlay(const std::string& idmap
                   std::move(loaded_idmap), system, false /*load_as_shared_library*/);
 }
 
+std::vector<std::unique_ptr<const ApkAssets>> ApkAssets::LoadAll(
+    const std::vector<LoadRequest>& requests, size_t max_threads) {
+  ATRACE_NAME("ApkAssets::LoadAll");
+  std::vector<std::unique_ptr<const ApkAssets>> results(requests.size());
+
+  // Each thread takes the next request until there are none left, so that a large split doesn't
+  // hold back the ones queued behind it.
+  std::atomic<size_t> next_request(0u);
+  auto load_requests = [&]() {
+    for (size_t i = next_request++; i < requests.size(); i = next_request++) {
+      const LoadRequest& request = requests[i];
+      switch (request.type) {
+        case LoadRequest::Type::kApk:
+          results[i] = Load(request.path, request.system);
+          break;
+        case LoadRequest::Type::kSharedLibrary:
+          results[i] = LoadAsSharedLibrary(request.path, request.system);
+          break;
+        case LoadRequest::Type::kOverlay:
+          results[i] = LoadOverlay(request.path, request.system);
+          break;
+      }
+    }
+  };
+
+#ifdef _WIN32
+  (void)max_threads;
+  load_requests();
+#else
+  const size_t thread_count = std::min(max_threads, requests.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 1u; i < thread_count; i++) {
+    threads.emplace_back(load_requests);
+  }
+  load_requests();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+#endif
+  return results;
+}
+
 std::unique_ptr<const ApkAssets> ApkAssets::LoadFromFd(unique_fd fd,
                                                        const std::string& friendly_name,
                                                        bool system, bool force_shared_lib) {
@@ -129,6 +177,10 @@ std::unique_ptr<const ApkAssets> ApkAssets::LoadImpl(
     return std::move(loaded_apk);
   }
 
+  // A compressed table is inflated up front anyway, so it might as well be verified up front.
+  // System tables are loaded by the zygote and verified there, so that the forked processes
+  // never write to the pages holding their verification state.
+  const bool verify_lazily = !system && entry.method != kCompressDeflated;
   if (entry.method == kCompressDeflated) {
     LOG(WARNING) << kResourcesArsc << " in APK '" << path << "' is compressed.";
   }
@@ -147,7 +199,7 @@ std::unique_ptr<const ApkAssets> ApkAssets::LoadImpl(
       reinterpret_cast<const char*>(loaded_apk->resources_asset_->getBuffer(true /*wordAligned*/)),
       loaded_apk->resources_asset_->getLength());
   loaded_apk->loaded_arsc_ =
-      LoadedArsc::Load(data, loaded_idmap.get(), system, load_as_shared_library);
+      LoadedArsc::Load(data, loaded_idmap.get(), system, load_as_shared_library, verify_lazily);
   if (loaded_apk->loaded_arsc_ == nullptr) {
     LOG(ERROR) << "Failed to load '" << kResourcesArsc << "' in APK '" << path << "'.";
     return {};
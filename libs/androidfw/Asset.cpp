@@ -671,6 +671,39 @@ const void* _FileAsset::getBuffer(bool wordAligned)
     }
 }
 
+/*
+ * Return a read-only pointer to the mapped data, without ever copying it.
+ *
+ * The mapping starts on a page boundary of the source file, so the data is
+ * aligned like its offset in the file: page aligned entries of a zip (see
+ * zipalign -p) can be used with any alignment up to the page size.
+ */
+const void* _FileAsset::getMappedBuffer(size_t alignment)
+{
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    if (mMap == NULL) {
+        if (mFp == NULL || mLength == 0)
+            return NULL;
+
+        FileMap* map = new FileMap;
+        if (!map->create(NULL, fileno(mFp), mStart, mLength, true)) {
+            delete map;
+            return NULL;
+        }
+        ALOGV(" getMappedBuffer: mapped\n");
+        mMap = map;
+    }
+
+    void* data = mMap->getDataPtr();
+    if ((((uintptr_t)data) & (alignment - 1)) != 0) {
+        ALOGV("FileAsset %p (%s) is not aligned on %zu bytes.", this,
+                getAssetSource(), alignment);
+        return NULL;
+    }
+    return data;
+}
+
 int _FileAsset::openFileDescriptor(off64_t* outStart, off64_t* outLength) const
 {
     if (mMap != NULL) {
@@ -844,6 +877,43 @@ ssize_t _CompressedAsset::read(void* buf, size_t count)
     return actual;
 }
 
+/*
+ * Read data from a chunk of compressed data, inflating it straight into the
+ * caller's buffer.
+ *
+ * Small assets are normally expanded into a buffer on the first read, here
+ * a streaming inflater is set up for them instead.
+ */
+ssize_t _CompressedAsset::readDirect(void* buf, size_t count)
+{
+    ssize_t actual;
+
+    assert(mOffset >= 0 && mOffset <= mUncompressedLen);
+
+    /* already expanded, nothing left to save */
+    if (mBuf != NULL)
+        return read(buf, count);
+
+    if (mZipInflater == NULL) {
+        if (mMap != NULL) {
+            mZipInflater = new StreamingZipInflater(mMap, mUncompressedLen);
+        } else {
+            assert(mFd >= 0);
+            mZipInflater = new StreamingZipInflater(mFd, mStart, mUncompressedLen,
+                    mCompressedLen);
+        }
+        if (mOffset > 0 && mZipInflater->seekAbsolute(mOffset) != mOffset)
+            return -1;
+    }
+
+    actual = mZipInflater->readDirect(buf, count);
+    if (actual < 0)
+        return -1;
+
+    mOffset += actual;
+    return actual;
+}
+
 /*
  * Handle a seek request.
  *
@@ -33,44 +33,33 @@
 #endif
 #endif
 
+#include "androidfw/NativeMemoryStats.h"
 #include "androidfw/ResourceUtils.h"
 
 namespace android {
 
-struct FindEntryResult {
-  // A pointer to the resource table entry for this resource.
-  // If the size of the entry is > sizeof(ResTable_entry), it can be cast to
-  // a ResTable_map_entry and processed as a bag/map.
-  const ResTable_entry* entry;
-
-  // The configuration for which the resulting entry was defined. This is already swapped to host
-  // endianness.
-  ResTable_config config;
-
-  // The bitmask of configuration axis with which the resource value varies.
-  uint32_t type_flags;
-
-  // The dynamic package ID map for the package from which this resource came from.
-  const DynamicRefTable* dynamic_ref_table;
-
-  // The string pool reference to the type's name. This uses a different string pool than
-  // the global string pool, but this is hidden from the caller.
-  StringPoolRef type_string_ref;
-
-  // The string pool reference to the entry's name. This uses a different string pool than
-  // the global string pool, but this is hidden from the caller.
-  StringPoolRef entry_string_ref;
-};
+// Returns the size of the block a bag of cached_bags_ was allocated with.
+static size_t GetBagSize(const ResolvedBag* bag) {
+  return sizeof(ResolvedBag) + (bag->entry_count * sizeof(ResolvedBag::Entry));
+}
 
 AssetManager2::AssetManager2() {
   memset(&configuration_, 0, sizeof(configuration_));
 }
 
+AssetManager2::~AssetManager2() {
+  // Accounts for the cached bags going away.
+  InvalidateCaches(static_cast<uint32_t>(-1));
+}
+
 bool AssetManager2::SetApkAssets(const std::vector<const ApkAssets*>& apk_assets,
                                  bool invalidate_caches) {
   apk_assets_ = apk_assets;
   BuildDynamicRefTable();
   RebuildFilterList();
+  // Cached entries point into the package groups that were just rebuilt.
+  cached_entries_.clear();
+  generation_++;
   if (invalidate_caches) {
     InvalidateCaches(static_cast<uint32_t>(-1));
   }
@@ -162,6 +151,10 @@ void AssetManager2::DumpToLog() const {
                                     package_group.dynamic_ref_table.mAssignedPackageId)
               << list;
   }
+
+  LOG(INFO) << base::StringPrintf("Entry cache: %zu entries, %zu hits, %zu misses",
+                                  cached_entries_.size(), entry_cache_stats_.hits,
+                                  entry_cache_stats_.misses);
 }
 
 const ResStringPool* AssetManager2::GetStringPoolForCookie(ApkAssetsCookie cookie) const {
@@ -201,6 +194,7 @@ void AssetManager2::SetConfiguration(const ResTable_config& configuration) {
   if (diff) {
     RebuildFilterList();
     InvalidateCaches(static_cast<uint32_t>(diff));
+    generation_++;
   }
 }
 
@@ -325,6 +319,17 @@ ApkAssetsCookie AssetManager2::FindEntry(uint32_t resid, uint16_t density_overri
     return kInvalidCookie;
   }
 
+  const bool use_entry_cache = desired_config == &configuration_;
+  if (use_entry_cache) {
+    const auto cached_iter = cached_entries_.find(resid);
+    if (cached_iter != cached_entries_.end()) {
+      entry_cache_stats_.hits++;
+      *out_entry = cached_iter->second.entry;
+      return cached_iter->second.cookie;
+    }
+    entry_cache_stats_.misses++;
+  }
+
   const uint32_t package_id = get_package_id(resid);
   const uint8_t type_idx = get_type_id(resid) - 1;
   const uint16_t entry_idx = get_entry_id(resid);
@@ -382,26 +387,26 @@ ApkAssetsCookie AssetManager2::FindEntry(uint32_t resid, uint16_t density_overri
       const std::vector<ResTable_config>& candidate_configs = filtered_group.configurations;
       const size_t type_count = candidate_configs.size();
       for (uint32_t i = 0; i < type_count; i++) {
-        const ResTable_config& this_config = candidate_configs[i];
-
         // We can skip calling ResTable_config::match() because we know that all candidate
-        // configurations that do NOT match have been filtered-out.
+        // configurations that do NOT match have been filtered-out. They are also sorted from the
+        // best match to the worst, so the first one defining the entry is this package's best.
+        const ResTable_type* type_chunk = filtered_group.types[i];
+        const uint32_t offset = LoadedPackage::GetEntryOffset(type_chunk, local_entry_idx);
+        if (offset == ResTable_type::NO_ENTRY) {
+          continue;
+        }
+
+        const ResTable_config& this_config = candidate_configs[i];
         if ((best_config == nullptr || this_config.isBetterThan(*best_config, desired_config)) ||
             (package_is_overlay && this_config.compare(*best_config) == 0)) {
-          // The configuration matches and is better than the previous selection.
-          // Find the entry value if it exists for this configuration.
-          const ResTable_type* type_chunk = filtered_group.types[i];
-          const uint32_t offset = LoadedPackage::GetEntryOffset(type_chunk, local_entry_idx);
-          if (offset == ResTable_type::NO_ENTRY) {
-            continue;
-          }
-
+          // The configuration is better than the selection from the previous packages.
           best_cookie = cookie;
           best_package = loaded_package;
           best_type = type_chunk;
           best_config = &this_config;
           best_offset = offset;
         }
+        break;
       }
     } else {
       // This is the slower path, which doesn't use the filtered list of configurations.
@@ -417,6 +422,9 @@ ApkAssetsCookie AssetManager2::FindEntry(uint32_t resid, uint16_t density_overri
         if (this_config.match(*desired_config)) {
           if ((best_config == nullptr || this_config.isBetterThan(*best_config, desired_config)) ||
               (package_is_overlay && this_config.compare(*best_config) == 0)) {
+            if (!type_spec->IsTypeValid(iter - type_spec->types)) {
+              continue;
+            }
             // The configuration matches and is better than the previous selection.
             // Find the entry value if it exists for this configuration.
             const uint32_t offset = LoadedPackage::GetEntryOffset(*iter, local_entry_idx);
@@ -452,6 +460,9 @@ ApkAssetsCookie AssetManager2::FindEntry(uint32_t resid, uint16_t density_overri
   out_entry->entry_string_ref =
       StringPoolRef(best_package->GetKeyStringPool(), best_entry->key.index);
   out_entry->dynamic_ref_table = &package_group.dynamic_ref_table;
+  if (use_entry_cache) {
+    cached_entries_.emplace(resid, CachedEntry{best_cookie, *out_entry});
+  }
   return best_cookie;
 }
 
@@ -642,6 +653,7 @@ const ResolvedBag* AssetManager2::GetBag(uint32_t resid, std::vector<uint32_t>&
     new_bag->type_spec_flags = entry.type_flags;
     new_bag->entry_count = static_cast<uint32_t>(entry_count);
     ResolvedBag* result = new_bag.get();
+    NativeMemoryStats::Add(NativeMemoryCategory::kResourceBags, GetBagSize(result));
     cached_bags_[resid] = std::move(new_bag);
     return result;
   }
@@ -752,6 +764,7 @@ const ResolvedBag* AssetManager2::GetBag(uint32_t resid, std::vector<uint32_t>&
   new_bag->type_spec_flags = entry.type_flags | parent_bag->type_spec_flags;
   new_bag->entry_count = static_cast<uint32_t>(actual_count);
   ResolvedBag* result = new_bag.get();
+  NativeMemoryStats::Add(NativeMemoryCategory::kResourceBags, GetBagSize(result));
   cached_bags_[resid] = std::move(new_bag);
   return result;
 }
@@ -835,16 +848,37 @@ void AssetManager2::RebuildFilterList() {
       new (&impl.filtered_configs_) ByteBucketArray<FilteredConfigGroup>();
 
       // Create the filters here.
+      std::vector<std::pair<ResTable_config, const ResTable_type*>> matching;
       impl.loaded_package_->ForEachTypeSpec([&](const TypeSpec* spec, uint8_t type_index) {
-        FilteredConfigGroup& group = impl.filtered_configs_.editItemAt(type_index);
+        matching.clear();
         const auto iter_end = spec->types + spec->type_count;
         for (auto iter = spec->types; iter != iter_end; ++iter) {
           ResTable_config this_config;
           this_config.copyFromDtoH((*iter)->config);
-          if (this_config.match(configuration_)) {
-            group.configurations.push_back(this_config);
-            group.types.push_back(*iter);
+          // Only the types that match are verified, the fast path of FindEntry() then trusts them.
+          if (this_config.match(configuration_) && spec->IsTypeValid(iter - spec->types)) {
+            matching.emplace_back(this_config, *iter);
+          }
+        }
+
+        // Rank the configurations once here, rather than comparing all of them on every lookup.
+        // isBetterThan() is not a strict weak ordering for every set of qualifiers, so it can't
+        // be handed to a sort. Instead each position takes the configuration a linear scan of
+        // the remaining ones would select, the first of equally good configurations winning.
+        // There are only a few matching configurations per type.
+        FilteredConfigGroup& group = impl.filtered_configs_.editItemAt(type_index);
+        group.configurations.reserve(matching.size());
+        group.types.reserve(matching.size());
+        while (!matching.empty()) {
+          auto best = matching.begin();
+          for (auto iter = best + 1; iter != matching.end(); ++iter) {
+            if (iter->first.isBetterThan(best->first, &configuration_)) {
+              best = iter;
+            }
           }
+          group.configurations.push_back(best->first);
+          group.types.push_back(best->second);
+          matching.erase(best);
         }
       });
     }
@@ -854,7 +888,11 @@ void AssetManager2::RebuildFilterList() {
 void AssetManager2::InvalidateCaches(uint32_t diff) {
   if (diff == 0xffffffffu) {
     // Everything must go.
+    for (const auto& bag : cached_bags_) {
+      NativeMemoryStats::Remove(NativeMemoryCategory::kResourceBags, GetBagSize(bag.second.get()));
+    }
     cached_bags_.clear();
+    cached_entries_.clear();
     return;
   }
 
@@ -862,11 +900,22 @@ void AssetManager2::InvalidateCaches(uint32_t diff) {
   // variations with respect to what changed (diff) should we remove it.
   for (auto iter = cached_bags_.cbegin(); iter != cached_bags_.cend();) {
     if (diff & iter->second->type_spec_flags) {
+      NativeMemoryStats::Remove(NativeMemoryCategory::kResourceBags,
+                                GetBagSize(iter->second.get()));
       iter = cached_bags_.erase(iter);
     } else {
       ++iter;
     }
   }
+
+  // Entries that don't vary with what changed would be selected again.
+  for (auto iter = cached_entries_.cbegin(); iter != cached_entries_.cend();) {
+    if (diff & iter->second.entry.type_flags) {
+      iter = cached_entries_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
 }
 
 std::unique_ptr<Theme> AssetManager2::NewTheme() {
@@ -911,6 +960,7 @@ bool Theme::ApplyStyle(uint32_t resid, bool force) {
 
   // Merge the flags from this style.
   type_spec_flags_ |= bag->type_spec_flags;
+  cached_attributes_.clear();
 
   int last_type_idx = -1;
   int last_package_idx = -1;
@@ -1033,22 +1083,74 @@ ApkAssetsCookie Theme::ResolveAttributeReference(ApkAssetsCookie cookie, Res_val
                                                  uint32_t* in_out_type_spec_flags,
                                                  uint32_t* out_last_ref) const {
   if (in_out_value->dataType == Res_value::TYPE_ATTRIBUTE) {
-    uint32_t new_flags;
-    cookie = GetAttribute(in_out_value->data, in_out_value, &new_flags);
-    if (cookie == kInvalidCookie) {
-      return kInvalidCookie;
-    }
-
-    if (in_out_type_spec_flags != nullptr) {
-      *in_out_type_spec_flags |= new_flags;
+    uint32_t last_ref = 0u;
+    cookie = ResolveAttribute(in_out_value->data, in_out_value, in_out_selected_config,
+                              in_out_type_spec_flags, &last_ref);
+    if (last_ref != 0u && out_last_ref != nullptr) {
+      *out_last_ref = last_ref;
     }
+    return cookie;
   }
   return asset_manager_->ResolveReference(cookie, in_out_value, in_out_selected_config,
                                           in_out_type_spec_flags, out_last_ref);
 }
 
+ApkAssetsCookie Theme::ResolveAttribute(uint32_t resid, Res_value* out_value,
+                                        ResTable_config* in_out_selected_config,
+                                        uint32_t* in_out_type_spec_flags,
+                                        uint32_t* out_last_ref) const {
+  if (cached_attributes_generation_ != asset_manager_->GetGeneration()) {
+    cached_attributes_.clear();
+    cached_attributes_generation_ = asset_manager_->GetGeneration();
+  }
+
+  const auto cached_iter = cached_attributes_.find(resid);
+  if (cached_iter != cached_attributes_.end()) {
+    const CachedAttribute& cached = cached_iter->second;
+    if (cached.cookie != kInvalidCookie) {
+      *out_value = cached.value;
+      if (cached.last_ref != 0u) {
+        *in_out_selected_config = cached.config;
+        *out_last_ref = cached.last_ref;
+      }
+      if (in_out_type_spec_flags != nullptr) {
+        *in_out_type_spec_flags |= cached.type_spec_flags;
+      }
+    }
+    return cached.cookie;
+  }
+
+  CachedAttribute cached = {};
+  cached.cookie = GetAttribute(resid, out_value, &cached.type_spec_flags);
+  if (cached.cookie == kInvalidCookie) {
+    cached_attributes_.emplace(resid, cached);
+    return kInvalidCookie;
+  }
+
+  cached.cookie = asset_manager_->ResolveReference(cached.cookie, out_value, in_out_selected_config,
+                                                   &cached.type_spec_flags, &cached.last_ref);
+  if (in_out_type_spec_flags != nullptr) {
+    *in_out_type_spec_flags |= cached.type_spec_flags;
+  }
+  if (cached.last_ref != 0u) {
+    *out_last_ref = cached.last_ref;
+  }
+
+  // A reference that failed to resolve is left for the caller to deal with, and isn't cached so
+  // that the partially resolved value isn't mistaken for a missing attribute.
+  if (cached.cookie != kInvalidCookie) {
+    cached.value = *out_value;
+    if (cached.last_ref != 0u) {
+      cached.config = *in_out_selected_config;
+    }
+    cached_attributes_.emplace(resid, cached);
+  }
+  return cached.cookie;
+}
+
 void Theme::Clear() {
   type_spec_flags_ = 0u;
+  cached_attributes_.clear();
   for (std::unique_ptr<Package>& package : packages_) {
     package.reset();
   }
@@ -1060,6 +1162,7 @@ bool Theme::SetTo(const Theme& o) {
   }
 
   type_spec_flags_ = o.type_spec_flags_;
+  cached_attributes_.clear();
 
   const bool copy_only_system = asset_manager_ != o.asset_manager_;
 
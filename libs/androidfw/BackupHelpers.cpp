@@ -29,6 +29,14 @@
 #include <unistd.h>
 #include <utime.h>
 #include <zlib.h>
+#if defined(__aarch64__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#endif
+
+#include <atomic>
+#include <thread>
+#include <vector>
 
 #include <log/log.h>
 #include <utils/ByteOrder.h>
@@ -303,6 +311,54 @@ write_update_file(BackupDataWriter* dataStream, const String8& key, char const*
     return err;
 }
 
+// The most threads computing the CRCs of the files to back up
+static const unsigned MAX_CRC_THREADS = 4;
+
+// How much of a file each CRC thread reads at a time
+static const size_t CRC_BUFFER_SIZE = 64*1024;
+
+#if defined(__aarch64__)
+// The ARMv8 CRC32 instructions use the same polynomial as zlib's crc32().
+__attribute__((target("crc")))
+static uLong
+crc32_armv8(uLong crc, const uint8_t* buf, size_t len)
+{
+    uint32_t c = ~(uint32_t)crc;
+    while (len > 0 && ((uintptr_t)buf & 7) != 0) {
+        c = __crc32b(c, *buf++);
+        len--;
+    }
+    for (; len >= 8; buf += 8, len -= 8) {
+        c = __crc32d(c, *(const uint64_t*)buf);
+    }
+    while (len > 0) {
+        c = __crc32b(c, *buf++);
+        len--;
+    }
+    return ~c;
+}
+
+static const bool kHasCrc32Instructions = (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#endif
+
+static uLong
+update_crc32(uLong crc, const uint8_t* buf, size_t len)
+{
+#if defined(__aarch64__)
+    if (kHasCrc32Instructions) {
+        return crc32_armv8(crc, buf, len);
+    }
+#endif
+    // zlib's length is a uInt
+    while (len > 0) {
+        uInt amt = len > (1u << 30) ? (1u << 30) : (uInt)len;
+        crc = crc32(crc, (const Bytef*)buf, amt);
+        buf += amt;
+        len -= amt;
+    }
+    return crc;
+}
+
 static int
 compute_crc32(const char* file, FileRec* out) {
     int fd = open(file, O_RDONLY);
@@ -310,25 +366,66 @@ compute_crc32(const char* file, FileRec* out) {
         return -1;
     }
 
-    const int bufsize = 4*1024;
-    int amt;
-
-    char* buf = (char*)malloc(bufsize);
-    int crc = crc32(0L, Z_NULL, 0);
-
-    lseek(fd, 0, SEEK_SET);
-
-    while ((amt = read(fd, buf, bufsize)) != 0) {
-        crc = crc32(crc, (Bytef*)buf, amt);
+    // Read rather than mmapped: the app may truncate the file meanwhile, which would raise
+    // SIGBUS on the mapping and kill the backup agent.
+    uLong crc = crc32(0L, Z_NULL, 0);
+    std::vector<uint8_t> buf(CRC_BUFFER_SIZE);
+    ssize_t amt;
+    while ((amt = TEMP_FAILURE_RETRY(read(fd, buf.data(), buf.size()))) > 0) {
+        crc = update_crc32(crc, buf.data(), amt);
     }
 
     close(fd);
-    free(buf);
 
     out->s.crc32 = crc;
     return NO_ERROR;
 }
 
+// Computes the CRCs of the snapshot's files on up to MAX_CRC_THREADS threads, the files are
+// independent reads so they don't have to wait for each other. The files that can't be read
+// are removed from the snapshot.
+static void
+compute_crc32s(KeyedVector<String8,FileRec>* snapshot)
+{
+    const size_t count = snapshot->size();
+    // the records don't move while the threads run
+    std::vector<FileRec*> records(count);
+    for (size_t i = 0; i < count; i++) {
+        records[i] = &snapshot->editValueAt(i);
+    }
+    std::vector<char> ok(count, 0);
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        size_t i;
+        while ((i = next++) < count) {
+            ok[i] = compute_crc32(records[i]->file.string(), records[i]) == NO_ERROR;
+        }
+    };
+
+    unsigned threadCount = std::thread::hardware_concurrency();
+    if (threadCount > MAX_CRC_THREADS) {
+        threadCount = MAX_CRC_THREADS;
+    }
+    if (threadCount > count) {
+        threadCount = count;
+    }
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < threadCount; t++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = count; i > 0; i--) {
+        if (!ok[i - 1]) {
+            ALOGW("Unable to open file %s", records[i - 1]->file.string());
+            snapshot->removeItemsAt(i - 1);
+        }
+    }
+}
+
 int
 back_up_files(int oldSnapshotFD, BackupDataWriter* dataStream, int newSnapshotFD,
         char const* const* files, char const* const* keys, int fileCount)
@@ -368,16 +465,13 @@ back_up_files(int oldSnapshotFD, BackupDataWriter* dataStream, int newSnapshotFD
                 LOGP("back_up_files key already in use '%s'", key.string());
                 return -1;
             }
-
-            // compute the CRC
-            if (compute_crc32(file, &r) != NO_ERROR) {
-                ALOGW("Unable to open file %s", file);
-                continue;
-            }
         }
         newSnapshot.add(key, r);
     }
 
+    // compute the CRCs
+    compute_crc32s(&newSnapshot);
+
     int n = 0;
     int N = oldSnapshot.size();
     int m = 0;
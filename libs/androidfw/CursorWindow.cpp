@@ -18,6 +18,7 @@
 #define LOG_TAG "CursorWindow"
 
 #include <androidfw/CursorWindow.h>
+#include <androidfw/NativeMemoryStats.h>
 #include <binder/Parcel.h>
 #include <utils/Log.h>
 
@@ -31,35 +32,46 @@
 namespace android {
 
 CursorWindow::CursorWindow(const String8& name, int ashmemFd,
-        void* data, size_t size, bool readOnly) :
-        mName(name), mAshmemFd(ashmemFd), mData(data), mSize(size), mReadOnly(readOnly) {
+        void* data, size_t size, size_t maxSize, bool readOnly) :
+        mName(name), mAshmemFd(ashmemFd), mData(data), mSize(size), mMaxSize(maxSize),
+        mReadOnly(readOnly) {
     mHeader = static_cast<Header*>(mData);
+    NativeMemoryStats::Add(NativeMemoryCategory::kCursorWindows, mSize);
 }
 
 CursorWindow::~CursorWindow() {
-    ::munmap(mData, mSize);
+    NativeMemoryStats::Remove(NativeMemoryCategory::kCursorWindows, mSize);
+    ::munmap(mData, mMaxSize);
     ::close(mAshmemFd);
 }
 
 status_t CursorWindow::create(const String8& name, size_t size, CursorWindow** outCursorWindow) {
+    return create(name, size, size, outCursorWindow);
+}
+
+status_t CursorWindow::create(const String8& name, size_t size, size_t maxSize,
+        CursorWindow** outCursorWindow) {
     String8 ashmemName("CursorWindow: ");
     ashmemName.append(name);
+    if (maxSize < size) {
+        maxSize = size;
+    }
 
     status_t result;
-    int ashmemFd = ashmem_create_region(ashmemName.string(), size);
+    int ashmemFd = ashmem_create_region(ashmemName.string(), maxSize);
     if (ashmemFd < 0) {
         result = -errno;
     } else {
         result = ashmem_set_prot_region(ashmemFd, PROT_READ | PROT_WRITE);
         if (result >= 0) {
-            void* data = ::mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, ashmemFd, 0);
+            void* data = ::mmap(NULL, maxSize, PROT_READ | PROT_WRITE, MAP_SHARED, ashmemFd, 0);
             if (data == MAP_FAILED) {
                 result = -errno;
             } else {
                 result = ashmem_set_prot_region(ashmemFd, PROT_READ);
                 if (result >= 0) {
                     CursorWindow* window = new CursorWindow(name, ashmemFd,
-                            data, size, false /*readOnly*/);
+                            data, size, maxSize, false /*readOnly*/);
                     result = window->clear();
                     if (!result) {
                         LOG_WINDOW("Created new CursorWindow: freeOffset=%d, "
@@ -74,7 +86,7 @@ status_t CursorWindow::create(const String8& name, size_t size, CursorWindow** o
                     delete window;
                 }
             }
-            ::munmap(data, size);
+            ::munmap(data, maxSize);
         }
         ::close(ashmemFd);
     }
@@ -108,7 +120,7 @@ status_t CursorWindow::createFromParcel(Parcel* parcel, CursorWindow** outCursor
                     result = BAD_VALUE;
                 } else {
                     CursorWindow* window = new CursorWindow(name, dupAshmemFd,
-                            data, size, true /*readOnly*/);
+                            data, size, size, true /*readOnly*/);
                     LOG_WINDOW("Created CursorWindow from parcel: freeOffset=%d, "
                             "numRows=%d, numColumns=%d, mSize=%d, mData=%p",
                             window->mHeader->freeOffset,
@@ -146,6 +158,7 @@ status_t CursorWindow::clear() {
 
     RowSlotChunk* firstChunk = static_cast<RowSlotChunk*>(offsetToPtr(mHeader->firstChunkOffset));
     firstChunk->nextChunkOffset = 0;
+    mChunkOffsets.clear();
     return OK;
 }
 
@@ -214,7 +227,7 @@ uint32_t CursorWindow::alloc(size_t size, bool aligned) {
 
     uint32_t offset = mHeader->freeOffset + padding;
     uint32_t nextFreeOffset = offset + size;
-    if (nextFreeOffset > mSize) {
+    if (nextFreeOffset > mSize && !grow(size_t(offset) + size)) {
         ALOGW("Window is full: requested allocation %zu bytes, "
                 "free space %zu bytes, window size %zu bytes",
                 size, freeSpace(), mSize);
@@ -225,38 +238,67 @@ uint32_t CursorWindow::alloc(size_t size, bool aligned) {
     return offset;
 }
 
+bool CursorWindow::grow(size_t requiredSize) {
+    if (mReadOnly || requiredSize > mMaxSize) {
+        return false;
+    }
+    size_t newSize = mSize;
+    while (newSize < requiredSize) {
+        newSize = newSize > mMaxSize / 2 ? mMaxSize : newSize * 2;
+    }
+    LOG_WINDOW("Growing window from %zu to %zu bytes, maximum %zu bytes",
+            mSize, newSize, mMaxSize);
+    NativeMemoryStats::Add(NativeMemoryCategory::kCursorWindows, newSize - mSize, 0);
+    mSize = newSize;
+    return true;
+}
+
+CursorWindow::RowSlotChunk* CursorWindow::getRowSlotChunk(uint32_t chunkIndex) {
+    if (mChunkOffsets.empty()) {
+        mChunkOffsets.push_back(mHeader->firstChunkOffset);
+    }
+    while (mChunkOffsets.size() <= chunkIndex) {
+        RowSlotChunk* lastChunk = static_cast<RowSlotChunk*>(
+                offsetToPtr(mChunkOffsets.back(), sizeof(RowSlotChunk)));
+        if (!lastChunk || !lastChunk->nextChunkOffset) {
+            return NULL;
+        }
+        mChunkOffsets.push_back(lastChunk->nextChunkOffset);
+    }
+    return static_cast<RowSlotChunk*>(
+            offsetToPtr(mChunkOffsets[chunkIndex], sizeof(RowSlotChunk)));
+}
+
 CursorWindow::RowSlot* CursorWindow::getRowSlot(uint32_t row) {
-    uint32_t chunkPos = row;
-    RowSlotChunk* chunk = static_cast<RowSlotChunk*>(
-            offsetToPtr(mHeader->firstChunkOffset));
-    while (chunkPos >= ROW_SLOT_CHUNK_NUM_ROWS) {
-        chunk = static_cast<RowSlotChunk*>(offsetToPtr(chunk->nextChunkOffset));
-        chunkPos -= ROW_SLOT_CHUNK_NUM_ROWS;
-    }
-    return &chunk->slots[chunkPos];
+    RowSlotChunk* chunk = getRowSlotChunk(row / ROW_SLOT_CHUNK_NUM_ROWS);
+    if (!chunk) {
+        return NULL;
+    }
+    return &chunk->slots[row % ROW_SLOT_CHUNK_NUM_ROWS];
 }
 
 CursorWindow::RowSlot* CursorWindow::allocRowSlot() {
-    uint32_t chunkPos = mHeader->numRows;
-    RowSlotChunk* chunk = static_cast<RowSlotChunk*>(
-            offsetToPtr(mHeader->firstChunkOffset));
-    while (chunkPos > ROW_SLOT_CHUNK_NUM_ROWS) {
-        chunk = static_cast<RowSlotChunk*>(offsetToPtr(chunk->nextChunkOffset));
-        chunkPos -= ROW_SLOT_CHUNK_NUM_ROWS;
-    }
-    if (chunkPos == ROW_SLOT_CHUNK_NUM_ROWS) {
-        if (!chunk->nextChunkOffset) {
-            chunk->nextChunkOffset = alloc(sizeof(RowSlotChunk), true /*aligned*/);
-            if (!chunk->nextChunkOffset) {
-                return NULL;
-            }
+    uint32_t chunkIndex = mHeader->numRows / ROW_SLOT_CHUNK_NUM_ROWS;
+    RowSlotChunk* chunk = getRowSlotChunk(chunkIndex);
+    if (!chunk && chunkIndex > 0) {
+        // The previous chunk is full, and the last one of the list.
+        RowSlotChunk* lastChunk = getRowSlotChunk(chunkIndex - 1);
+        if (!lastChunk) {
+            return NULL;
+        }
+        uint32_t chunkOffset = alloc(sizeof(RowSlotChunk), true /*aligned*/);
+        if (!chunkOffset) {
+            return NULL;
         }
-        chunk = static_cast<RowSlotChunk*>(offsetToPtr(chunk->nextChunkOffset));
+        lastChunk->nextChunkOffset = chunkOffset;
+        chunk = getRowSlotChunk(chunkIndex);
         chunk->nextChunkOffset = 0;
-        chunkPos = 0;
+    }
+    if (!chunk) {
+        return NULL;
     }
     mHeader->numRows += 1;
-    return &chunk->slots[chunkPos];
+    return &chunk->slots[(mHeader->numRows - 1) % ROW_SLOT_CHUNK_NUM_ROWS];
 }
 
 CursorWindow::FieldSlot* CursorWindow::getFieldSlot(uint32_t row, uint32_t column) {
@@ -275,6 +317,117 @@ CursorWindow::FieldSlot* CursorWindow::getFieldSlot(uint32_t row, uint32_t colum
     return &fieldDir[column];
 }
 
+CursorWindow::FieldSlot* CursorWindow::getRowFieldSlots(uint32_t row) {
+    if (row >= mHeader->numRows) {
+        ALOGE("Failed to read row %d from a CursorWindow which has %d rows.",
+                row, mHeader->numRows);
+        return NULL;
+    }
+    RowSlot* rowSlot = getRowSlot(row);
+    if (!rowSlot) {
+        ALOGE("Failed to find rowSlot for row %d.", row);
+        return NULL;
+    }
+    return static_cast<FieldSlot*>(offsetToPtr(rowSlot->offset,
+            mHeader->numColumns * sizeof(FieldSlot)));
+}
+
+status_t CursorWindow::getColumnFieldSlots(uint32_t column, uint32_t startRow, uint32_t numRows,
+        FieldSlot** outFieldSlots) {
+    if (column >= mHeader->numColumns || startRow > mHeader->numRows
+            || numRows > mHeader->numRows - startRow) {
+        ALOGE("Failed to read rows %d to %d, column %d from a CursorWindow which "
+                "has %d rows, %d columns.",
+                startRow, startRow + numRows, column, mHeader->numRows, mHeader->numColumns);
+        return BAD_VALUE;
+    }
+    const size_t fieldDirSize = mHeader->numColumns * sizeof(FieldSlot);
+    for (uint32_t i = 0; i < numRows; i++) {
+        RowSlot* rowSlot = getRowSlot(startRow + i);
+        if (!rowSlot) {
+            ALOGE("Failed to find rowSlot for row %d.", startRow + i);
+            return BAD_VALUE;
+        }
+        FieldSlot* fieldDir = static_cast<FieldSlot*>(offsetToPtr(rowSlot->offset, fieldDirSize));
+        if (!fieldDir) {
+            return BAD_VALUE;
+        }
+        outFieldSlots[i] = &fieldDir[column];
+    }
+    return OK;
+}
+
+status_t CursorWindow::putRow(const FieldValue* values) {
+    if (mReadOnly) {
+        return INVALID_OPERATION;
+    }
+
+    const uint32_t numColumns = mHeader->numColumns;
+    size_t dataSize = 0;
+    for (uint32_t i = 0; i < numColumns; i++) {
+        switch (values[i].type) {
+            case FIELD_TYPE_NULL:
+            case FIELD_TYPE_INTEGER:
+            case FIELD_TYPE_FLOAT:
+                break;
+            case FIELD_TYPE_STRING:
+            case FIELD_TYPE_BLOB:
+                if (values[i].data.buffer.size > mSize - dataSize) {
+                    return NO_MEMORY;
+                }
+                dataSize += values[i].data.buffer.size;
+                break;
+            default:
+                ALOGE("Unknown type %d for column %d", values[i].type, i);
+                return BAD_VALUE;
+        }
+    }
+
+    RowSlot* rowSlot = allocRowSlot();
+    if (rowSlot == NULL) {
+        return NO_MEMORY;
+    }
+
+    const size_t fieldDirSize = numColumns * sizeof(FieldSlot);
+    uint32_t fieldDirOffset = alloc(fieldDirSize + dataSize, true /*aligned*/);
+    if (!fieldDirOffset) {
+        mHeader->numRows--;
+        return NO_MEMORY;
+    }
+
+    FieldSlot* fieldDir = static_cast<FieldSlot*>(offsetToPtr(fieldDirOffset));
+    uint8_t* data = reinterpret_cast<uint8_t*>(fieldDir) + fieldDirSize;
+    for (uint32_t i = 0; i < numColumns; i++) {
+        const FieldValue& value = values[i];
+        FieldSlot& fieldSlot = fieldDir[i];
+        fieldSlot.type = value.type;
+        switch (value.type) {
+            case FIELD_TYPE_INTEGER:
+                fieldSlot.data.l = value.data.l;
+                break;
+            case FIELD_TYPE_FLOAT:
+                fieldSlot.data.d = value.data.d;
+                break;
+            case FIELD_TYPE_STRING:
+            case FIELD_TYPE_BLOB:
+                memcpy(data, value.data.buffer.data, value.data.buffer.size);
+                fieldSlot.data.buffer.offset = offsetFromPtr(data);
+                fieldSlot.data.buffer.size = value.data.buffer.size;
+                data += value.data.buffer.size;
+                break;
+            default:
+                fieldSlot.data.buffer.offset = 0;
+                fieldSlot.data.buffer.size = 0;
+                break;
+        }
+    }
+
+    LOG_WINDOW("Put row %u, %zu bytes at offset %u\n",
+            mHeader->numRows - 1, fieldDirSize + dataSize, fieldDirOffset);
+    rowSlot->offset = fieldDirOffset;
+    return OK;
+}
+
 status_t CursorWindow::putBlob(uint32_t row, uint32_t column, const void* value, size_t size) {
     return putBlobOrString(row, column, value, size, FIELD_TYPE_BLOB);
 }
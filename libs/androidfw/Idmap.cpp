@@ -179,12 +179,4 @@ uint8_t LoadedIdmap::TargetPackageId() const {
   return static_cast<uint8_t>(dtohs(header_->target_package_id));
 }
 
-const IdmapEntry_header* LoadedIdmap::GetEntryMapForType(uint8_t type_id) const {
-  auto iter = type_map_.find(type_id);
-  if (iter != type_map_.end()) {
-    return iter->second;
-  }
-  return nullptr;
-}
-
 }  // namespace android
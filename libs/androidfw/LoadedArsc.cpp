@@ -22,6 +22,14 @@
 #include <cstddef>
 #include <limits>
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __ANDROID__
+#include <sys/prctl.h>
+#endif
+#endif
+
 #include "android-base/logging.h"
 #include "android-base/stringprintf.h"
 #include "utils/ByteOrder.h"
@@ -35,6 +43,7 @@
 
 #include "androidfw/ByteBucketArray.h"
 #include "androidfw/Chunk.h"
+#include "androidfw/NativeMemoryStats.h"
 #include "androidfw/ResourceUtils.h"
 #include "androidfw/Util.h"
 
@@ -60,19 +69,26 @@ class TypeSpecPtrBuilder {
     types_.push_back(type);
   }
 
-  TypeSpecPtr Build() {
+  // `verified` is true if the types added were already checked with VerifyResTableType().
+  TypeSpecPtr Build(bool verified) {
     // Check for overflow.
     using ElementType = const ResTable_type*;
-    if ((std::numeric_limits<size_t>::max() - sizeof(TypeSpec)) / sizeof(ElementType) <
+    using StateType = std::atomic<uint8_t>;
+    if ((std::numeric_limits<size_t>::max() - sizeof(TypeSpec)) /
+            (sizeof(ElementType) + sizeof(StateType)) <
         types_.size()) {
       return {};
     }
-    TypeSpec* type_spec =
-        (TypeSpec*)::malloc(sizeof(TypeSpec) + (types_.size() * sizeof(ElementType)));
+    TypeSpec* type_spec = (TypeSpec*)::malloc(
+        sizeof(TypeSpec) + (types_.size() * (sizeof(ElementType) + sizeof(StateType))));
     type_spec->type_spec = header_;
     type_spec->idmap_entries = idmap_header_;
     type_spec->type_count = types_.size();
     memcpy(type_spec + 1, types_.data(), types_.size() * sizeof(ElementType));
+    StateType* states = type_spec->type_states();
+    for (size_t i = 0; i < types_.size(); i++) {
+      new (&states[i]) StateType(verified ? TypeSpec::kTypeValid : TypeSpec::kTypeUnverified);
+    }
     return TypeSpecPtr(type_spec);
   }
 
@@ -86,8 +102,87 @@ class TypeSpecPtrBuilder {
 
 }  // namespace
 
-LoadedPackage::LoadedPackage() = default;
-LoadedPackage::~LoadedPackage() = default;
+static size_t AlignUp(size_t size, size_t alignment) {
+  return (size + alignment - 1u) & ~(alignment - 1u);
+}
+
+// Returns the size of the block TypeSpecPtrBuilder::Build() allocated for `type_spec`.
+static size_t GetTypeSpecSize(const TypeSpec* type_spec) {
+  return sizeof(TypeSpec) +
+         type_spec->type_count * (sizeof(const ResTable_type*) + sizeof(std::atomic<uint8_t>));
+}
+
+LoadedPackage::LoadedPackage() {
+  NativeMemoryStats::Add(NativeMemoryCategory::kResourceTables, 0);
+}
+
+LoadedPackage::~LoadedPackage() {
+  NativeMemoryStats::Remove(NativeMemoryCategory::kResourceTables, type_specs_size_);
+#ifndef _WIN32
+  if (sealed_type_specs_ != nullptr) {
+    for (size_t i = 0; i < type_specs_.size(); i++) {
+      if (type_specs_[i] != nullptr) {
+        type_specs_.editItemAt(i).release();
+      }
+    }
+    munmap(sealed_type_specs_, sealed_type_specs_size_);
+  }
+#endif
+}
+
+void LoadedPackage::SealTypeSpecs() {
+#ifndef _WIN32
+  ATRACE_NAME("LoadedPackage::SealTypeSpecs");
+  constexpr size_t kAlignment = alignof(TypeSpec);
+  size_t total_size = 0u;
+  for (size_t i = 0; i < type_specs_.size(); i++) {
+    if (type_specs_[i] != nullptr) {
+      total_size += AlignUp(GetTypeSpecSize(type_specs_[i].get()), kAlignment);
+    }
+  }
+  if (total_size == 0u) {
+    return;
+  }
+
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  total_size = AlignUp(total_size, page_size);
+  void* region =
+      mmap(nullptr, total_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (region == MAP_FAILED) {
+    PLOG(WARNING) << "Failed to map " << total_size << " bytes for the TypeSpecs of "
+                  << package_name_;
+    return;
+  }
+
+#ifdef __ANDROID__
+  // Name the mapping so that its private dirty pages can be told apart in smaps after a fork.
+  prctl(PR_SET_VMA, PR_SET_VMA_ANON_NAME, region, total_size, "resource TypeSpecs");
+#endif
+#ifdef MADV_NOHUGEPAGE
+  // A copy-on-write fault on a huge page would copy all of it.
+  madvise(region, total_size, MADV_NOHUGEPAGE);
+#endif
+
+  uint8_t* cursor = reinterpret_cast<uint8_t*>(region);
+  for (size_t i = 0; i < type_specs_.size(); i++) {
+    if (type_specs_[i] == nullptr) {
+      continue;
+    }
+    TypeSpecPtr& type_spec = type_specs_.editItemAt(i);
+    const size_t size = GetTypeSpecSize(type_spec.get());
+    memcpy(cursor, type_spec.get(), size);
+    type_spec = TypeSpecPtr(reinterpret_cast<TypeSpec*>(cursor));
+    cursor += AlignUp(size, kAlignment);
+  }
+
+  // Verification states are only written for unverified types, which system packages don't have.
+  if (mprotect(region, total_size, PROT_READ) != 0) {
+    PLOG(WARNING) << "Failed to make the TypeSpecs of " << package_name_ << " read-only";
+  }
+  sealed_type_specs_ = region;
+  sealed_type_specs_size_ = total_size;
+#endif
+}
 
 // Precondition: The header passed in has already been verified, so reading any fields and trusting
 // the ResChunk_header is safe.
@@ -125,6 +220,19 @@ static bool VerifyResTableType(const ResTable_type* header) {
   return true;
 }
 
+bool TypeSpec::IsTypeValid(size_t type_index) const {
+  std::atomic<uint8_t>& state = type_states()[type_index];
+  const uint8_t current_state = state.load(std::memory_order_relaxed);
+  if (LIKELY(current_state != kTypeUnverified)) {
+    return current_state == kTypeValid;
+  }
+
+  // Verifying is idempotent, so racing threads at worst both do it.
+  const bool valid = VerifyResTableType(types[type_index]);
+  state.store(valid ? kTypeValid : kTypeInvalid, std::memory_order_relaxed);
+  return valid;
+}
+
 static bool VerifyResTableEntry(const ResTable_type* type, uint32_t entry_offset) {
   // Check that the offset is aligned.
   if (entry_offset & 0x03) {
@@ -330,31 +438,67 @@ uint32_t LoadedPackage::FindEntryByName(const std::u16string& type_name,
     return 0u;
   }
 
-  const TypeSpec* type_spec = type_specs_[type_idx].get();
-  if (type_spec == nullptr) {
+  if (type_specs_[type_idx] == nullptr) {
     return 0u;
   }
 
-  const auto iter_end = type_spec->types + type_spec->type_count;
-  for (auto iter = type_spec->types; iter != iter_end; ++iter) {
-    const ResTable_type* type = *iter;
-    size_t entry_count = dtohl(type->entryCount);
-    for (size_t entry_idx = 0; entry_idx < entry_count; entry_idx++) {
-      const uint32_t* entry_offsets = reinterpret_cast<const uint32_t*>(
-          reinterpret_cast<const uint8_t*>(type) + dtohs(type->header.headerSize));
-      const uint32_t offset = dtohl(entry_offsets[entry_idx]);
-      if (offset != ResTable_type::NO_ENTRY) {
-        const ResTable_entry* entry = reinterpret_cast<const ResTable_entry*>(
-            reinterpret_cast<const uint8_t*>(type) + dtohl(type->entriesStart) + offset);
-        if (dtohl(entry->key.index) == static_cast<uint32_t>(key_idx)) {
-          // The package ID will be overridden by the caller (due to runtime assignment of package
-          // IDs for shared libraries).
-          return make_resid(0x00, type_idx + type_id_offset_ + 1, entry_idx);
+  std::lock_guard<std::mutex> lock(entry_name_index_lock_);
+  const std::unordered_map<uint32_t, uint16_t>& name_index = GetEntryNameIndexLocked(type_idx);
+  const auto iter = name_index.find(static_cast<uint32_t>(key_idx));
+  if (iter == name_index.end()) {
+    return 0u;
+  }
+
+  // The package ID will be overridden by the caller (due to runtime assignment of package
+  // IDs for shared libraries).
+  return make_resid(0x00, type_idx + type_id_offset_ + 1, iter->second);
+}
+
+const std::unordered_map<uint32_t, uint16_t>& LoadedPackage::GetEntryNameIndexLocked(
+    size_t type_idx) const {
+  auto result = entry_name_indices_.emplace(type_idx, std::unordered_map<uint32_t, uint16_t>());
+  std::unordered_map<uint32_t, uint16_t>& name_index = result.first->second;
+  if (!result.second) {
+    return name_index;
+  }
+
+  ATRACE_NAME("LoadedPackage::GetEntryNameIndex");
+  const TypeSpec* type_spec = type_specs_[type_idx].get();
+  auto add_entry = [&](const ResTable_type* type, uint16_t entry_idx, uint32_t offset) {
+    const ResTable_entry* entry = GetEntryFromOffset(type, offset);
+    if (entry != nullptr) {
+      // Entries of all configurations share their name, the first one found is kept.
+      name_index.emplace(dtohl(entry->key.index), entry_idx);
+    }
+  };
+
+  for (size_t i = 0; i < type_spec->type_count; i++) {
+    if (!type_spec->IsTypeValid(i)) {
+      continue;
+    }
+    const ResTable_type* type = type_spec->types[i];
+    const size_t entry_count = dtohl(type->entryCount);
+    const uint8_t* offsets =
+        reinterpret_cast<const uint8_t*>(type) + dtohs(type->header.headerSize);
+    if (type->flags & ResTable_type::FLAG_SPARSE) {
+      const ResTable_sparseTypeEntry* sparse_indices =
+          reinterpret_cast<const ResTable_sparseTypeEntry*>(offsets);
+      for (size_t j = 0; j < entry_count; j++) {
+        // Offsets are stored divided by 4, see GetEntryOffset().
+        add_entry(type, dtohs(sparse_indices[j].idx),
+                  uint32_t{dtohs(sparse_indices[j].offset)} * 4u);
+      }
+    } else {
+      const uint32_t* entry_offsets = reinterpret_cast<const uint32_t*>(offsets);
+      for (size_t entry_idx = 0; entry_idx < entry_count; entry_idx++) {
+        const uint32_t offset = dtohl(entry_offsets[entry_idx]);
+        if (offset != ResTable_type::NO_ENTRY) {
+          add_entry(type, static_cast<uint16_t>(entry_idx), offset);
         }
       }
     }
   }
-  return 0u;
+  return name_index;
 }
 
 const LoadedPackage* LoadedArsc::GetPackageById(uint8_t package_id) const {
@@ -368,7 +512,8 @@ const LoadedPackage* LoadedArsc::GetPackageById(uint8_t package_id) const {
 
 std::unique_ptr<const LoadedPackage> LoadedPackage::Load(const Chunk& chunk,
                                                          const LoadedIdmap* loaded_idmap,
-                                                         bool system, bool load_as_shared_library) {
+                                                         bool system, bool load_as_shared_library,
+                                                         bool verify_lazily) {
   ATRACE_NAME("LoadedPackage::Load");
   std::unique_ptr<LoadedPackage> loaded_package(new LoadedPackage());
 
@@ -501,7 +646,13 @@ std::unique_ptr<const LoadedPackage> LoadedPackage::Load(const Chunk& chunk,
           return {};
         }
 
-        if (!VerifyResTableType(type)) {
+        if (verify_lazily) {
+          // The type ID is needed right away, the rest is checked by TypeSpec::IsTypeValid().
+          if (type->id == 0) {
+            LOG(ERROR) << "RES_TABLE_TYPE_TYPE has invalid ID 0.";
+            return {};
+          }
+        } else if (!VerifyResTableType(type)) {
           return {};
         }
 
@@ -568,7 +719,7 @@ std::unique_ptr<const LoadedPackage> LoadedPackage::Load(const Chunk& chunk,
   // Flatten and construct the TypeSpecs.
   for (auto& entry : type_builder_map) {
     uint8_t type_idx = static_cast<uint8_t>(entry.first);
-    TypeSpecPtr type_spec_ptr = entry.second->Build();
+    TypeSpecPtr type_spec_ptr = entry.second->Build(!verify_lazily);
     if (type_spec_ptr == nullptr) {
       LOG(ERROR) << "Too many type configurations, overflow detected.";
       return {};
@@ -585,11 +736,22 @@ std::unique_ptr<const LoadedPackage> LoadedPackage::Load(const Chunk& chunk,
     }
   }
 
+  for (size_t i = 0; i < loaded_package->type_specs_.size(); i++) {
+    if (loaded_package->type_specs_[i] != nullptr) {
+      loaded_package->type_specs_size_ += GetTypeSpecSize(loaded_package->type_specs_[i].get());
+    }
+  }
+  NativeMemoryStats::Add(NativeMemoryCategory::kResourceTables, loaded_package->type_specs_size_,
+                         0);
+
+  if (system && !verify_lazily) {
+    loaded_package->SealTypeSpecs();
+  }
   return std::move(loaded_package);
 }
 
 bool LoadedArsc::LoadTable(const Chunk& chunk, const LoadedIdmap* loaded_idmap,
-                           bool load_as_shared_library) {
+                           bool load_as_shared_library, bool verify_lazily) {
   const ResTable_header* header = chunk.header<ResTable_header>();
   if (header == nullptr) {
     LOG(ERROR) << "RES_TABLE_TYPE too small.";
@@ -628,7 +790,8 @@ bool LoadedArsc::LoadTable(const Chunk& chunk, const LoadedIdmap* loaded_idmap,
         packages_seen++;
 
         std::unique_ptr<const LoadedPackage> loaded_package =
-            LoadedPackage::Load(child_chunk, loaded_idmap, system_, load_as_shared_library);
+            LoadedPackage::Load(child_chunk, loaded_idmap, system_, load_as_shared_library,
+                                verify_lazily);
         if (!loaded_package) {
           return false;
         }
@@ -652,7 +815,8 @@ bool LoadedArsc::LoadTable(const Chunk& chunk, const LoadedIdmap* loaded_idmap,
 
 std::unique_ptr<const LoadedArsc> LoadedArsc::Load(const StringPiece& data,
                                                    const LoadedIdmap* loaded_idmap, bool system,
-                                                   bool load_as_shared_library) {
+                                                   bool load_as_shared_library,
+                                                   bool verify_lazily) {
   ATRACE_NAME("LoadedArsc::LoadTable");
 
   // Not using make_unique because the constructor is private.
@@ -664,7 +828,7 @@ std::unique_ptr<const LoadedArsc> LoadedArsc::Load(const StringPiece& data,
     const Chunk chunk = iter.Next();
     switch (chunk.type()) {
       case RES_TABLE_TYPE:
-        if (!loaded_arsc->LoadTable(chunk, loaded_idmap, load_as_shared_library)) {
+        if (!loaded_arsc->LoadTable(chunk, loaded_idmap, load_as_shared_library, verify_lazily)) {
           return {};
         }
         break;
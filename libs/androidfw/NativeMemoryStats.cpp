@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "androidfw/NativeMemoryStats.h"
+
+#include <atomic>
+#include <cinttypes>
+#include <string>
+
+#include "android-base/file.h"
+#include "android-base/stringprintf.h"
+
+namespace android {
+
+namespace {
+
+struct Counters {
+  std::atomic<int64_t> bytes{0};
+  std::atomic<int64_t> objects{0};
+};
+
+constexpr size_t kCategoryCount = static_cast<size_t>(NativeMemoryCategory::kCount);
+
+// Constant initialized, so the counters can be updated from static constructors.
+Counters gCounters[kCategoryCount];
+
+const char* const kCategoryNames[kCategoryCount] = {
+    "Bitmaps",
+    "HWUI texture cache",
+    "HWUI font cache",
+    "HWUI GPU resource cache",
+    "Resource tables",
+    "Resource bags",
+    "CursorWindows",
+};
+
+Counters& CountersOf(NativeMemoryCategory category) {
+  return gCounters[static_cast<size_t>(category)];
+}
+
+}  // namespace
+
+void NativeMemoryStats::Add(NativeMemoryCategory category, int64_t bytes, int64_t objects) {
+  Counters& counters = CountersOf(category);
+  counters.bytes.fetch_add(bytes, std::memory_order_relaxed);
+  counters.objects.fetch_add(objects, std::memory_order_relaxed);
+}
+
+void NativeMemoryStats::Remove(NativeMemoryCategory category, int64_t bytes, int64_t objects) {
+  Counters& counters = CountersOf(category);
+  counters.bytes.fetch_sub(bytes, std::memory_order_relaxed);
+  counters.objects.fetch_sub(objects, std::memory_order_relaxed);
+}
+
+void NativeMemoryStats::Set(NativeMemoryCategory category, int64_t bytes, int64_t objects) {
+  Counters& counters = CountersOf(category);
+  counters.bytes.store(bytes, std::memory_order_relaxed);
+  counters.objects.store(objects, std::memory_order_relaxed);
+}
+
+NativeMemoryStats::Usage NativeMemoryStats::Get(NativeMemoryCategory category) {
+  const Counters& counters = CountersOf(category);
+  return {counters.bytes.load(std::memory_order_relaxed),
+          counters.objects.load(std::memory_order_relaxed)};
+}
+
+const char* NativeMemoryStats::GetName(NativeMemoryCategory category) {
+  return kCategoryNames[static_cast<size_t>(category)];
+}
+
+void NativeMemoryStats::Dump(int fd) {
+  std::string out = base::StringPrintf(" Native memory by subsystem:\n%26s %10s %10s\n", "",
+                                       "Size (kB)", "Objects");
+  for (size_t i = 0; i < kCategoryCount; i++) {
+    const NativeMemoryCategory category = static_cast<NativeMemoryCategory>(i);
+    const Usage usage = Get(category);
+    base::StringAppendF(&out, "%26s %10" PRId64 " %10" PRId64 "\n", GetName(category),
+                        usage.bytes / 1024, usage.objects);
+  }
+  base::WriteStringToFd(out, fd);
+}
+
+}  // namespace android
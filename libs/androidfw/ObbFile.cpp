@@ -19,6 +19,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #define LOG_TAG "ObbFile"
@@ -26,6 +27,10 @@
 #include <androidfw/ObbFile.h>
 #include <utils/Compat.h>
 #include <utils/Log.h>
+#include <utils/threads.h>
+
+#include <list>
+#include <string>
 
 //#define DEBUG 1
 
@@ -43,6 +48,8 @@
 
 #define kMaxBufSize    32768 /* Maximum file read buffer */
 
+#define kTailReadSize  512 /* Bytes read from the end of the file at once */
+
 #define kSignature     0x01059983U /* ObbFile signature */
 
 #define kSigVersion    1 /* We only know about signature version 1 */
@@ -72,6 +79,46 @@
 
 namespace android {
 
+/* Reads count bytes at offset, without moving the file position where pread is available. */
+static ssize_t readAt(int fd, void* buf, size_t count, off64_t offset)
+{
+#ifdef _WIN32
+    if (lseek64(fd, offset, SEEK_SET) != offset) {
+        return -1;
+    }
+    return TEMP_FAILURE_RETRY(read(fd, buf, count));
+#else
+    return TEMP_FAILURE_RETRY(pread64(fd, buf, count, offset));
+#endif
+}
+
+/*
+ * The OBB files read through readCached(), most recently used first.  A
+ * launcher listing its titles asks for the same files over and over, an
+ * entry is reused as long as the file wasn't replaced or modified since.
+ */
+namespace {
+
+struct CachedObbFile {
+    std::string path;
+    dev_t dev;
+    ino_t ino;
+    off64_t size;
+    time_t modWhen;
+    sp<ObbFile> obb;
+};
+
+const size_t kMaxCachedObbFiles = 32;
+
+Mutex gObbCacheLock;
+
+std::list<CachedObbFile>& obbCache() {
+    static std::list<CachedObbFile>* cache = new std::list<CachedObbFile>();
+    return *cache;
+}
+
+} // namespace
+
 ObbFile::ObbFile()
         : mPackageName("")
         , mVersion(-1)
@@ -104,6 +151,54 @@ out:
     return success;
 }
 
+/* static */ sp<ObbFile> ObbFile::readCached(const char* filename)
+{
+    struct stat st;
+    if (stat(filename, &st) != 0) {
+        ALOGW("couldn't stat file %s: %s", filename, strerror(errno));
+        return NULL;
+    }
+
+    {
+        AutoMutex _l(gObbCacheLock);
+        std::list<CachedObbFile>& cache = obbCache();
+        for (auto iter = cache.begin(); iter != cache.end(); ++iter) {
+            if (iter->path != filename) {
+                continue;
+            }
+            if (iter->dev == st.st_dev && iter->ino == st.st_ino
+                    && iter->size == static_cast<off64_t>(st.st_size)
+                    && iter->modWhen == st.st_mtime) {
+                cache.splice(cache.begin(), cache, iter);
+                return iter->obb;
+            }
+            cache.erase(iter);
+            break;
+        }
+    }
+
+    sp<ObbFile> obb = new ObbFile();
+    if (!obb->readFrom(filename)) {
+        return NULL;
+    }
+
+    AutoMutex _l(gObbCacheLock);
+    std::list<CachedObbFile>& cache = obbCache();
+    // Another caller may have read the same file in the meantime
+    for (auto iter = cache.begin(); iter != cache.end(); ++iter) {
+        if (iter->path == filename) {
+            cache.erase(iter);
+            break;
+        }
+    }
+    cache.push_front(CachedObbFile{filename, st.st_dev, st.st_ino,
+            static_cast<off64_t>(st.st_size), st.st_mtime, obb});
+    if (cache.size() > kMaxCachedObbFiles) {
+        cache.pop_back();
+    }
+    return obb;
+}
+
 bool ObbFile::readFrom(int fd)
 {
     if (fd < 0) {
@@ -127,94 +222,98 @@ bool ObbFile::parseObbFile(int fd)
         return false;
     }
 
-    ssize_t actual;
-    size_t footerSize;
-
-    {
-        lseek64(fd, fileLength - kFooterTagSize, SEEK_SET);
-
-        char footer[kFooterTagSize];
-        actual = TEMP_FAILURE_RETRY(read(fd, footer, kFooterTagSize));
-        if (actual != kFooterTagSize) {
-            ALOGW("couldn't read footer signature: %s\n", strerror(errno));
-            return false;
-        }
-
-        unsigned int fileSig = get4LE((unsigned char*)footer + sizeof(int32_t));
-        if (fileSig != kSignature) {
-            ALOGW("footer didn't match magic string (expected 0x%08x; got 0x%08x)\n",
-                    kSignature, fileSig);
-            return false;
-        }
+    /*
+     * Footers are small, so a single read of the end of the file usually
+     * covers both the footer tag and the whole footer.
+     */
+    unsigned char tail[kTailReadSize];
+    size_t tailSize = fileLength < kTailReadSize ? (size_t)fileLength : kTailReadSize;
+    ssize_t actual = readAt(fd, tail, tailSize, fileLength - tailSize);
+    if (actual != (ssize_t)tailSize) {
+        ALOGW("couldn't read footer signature: %s\n", strerror(errno));
+        return false;
+    }
 
-        footerSize = get4LE((unsigned char*)footer);
-        if (footerSize > (size_t)fileLength - kFooterTagSize
-                || footerSize > kMaxBufSize) {
-            ALOGW("claimed footer size is too large (0x%08zx; file size is 0x%08lld)\n",
-                    footerSize, (long long int)fileLength);
-            return false;
-        }
+    const unsigned char* footer = tail + tailSize - kFooterTagSize;
+    unsigned int fileSig = get4LE(footer + sizeof(int32_t));
+    if (fileSig != kSignature) {
+        ALOGW("footer didn't match magic string (expected 0x%08x; got 0x%08x)\n",
+                kSignature, fileSig);
+        return false;
+    }
 
-        if (footerSize < (kFooterMinSize - kFooterTagSize)) {
-            ALOGW("claimed footer size is too small (0x%zx; minimum size is 0x%x)\n",
-                    footerSize, kFooterMinSize - kFooterTagSize);
-            return false;
-        }
+    size_t footerSize = get4LE(footer);
+    if (footerSize > (size_t)fileLength - kFooterTagSize
+            || footerSize > kMaxBufSize) {
+        ALOGW("claimed footer size is too large (0x%08zx; file size is 0x%08lld)\n",
+                footerSize, (long long int)fileLength);
+        return false;
     }
 
-    off64_t fileOffset = fileLength - footerSize - kFooterTagSize;
-    if (lseek64(fd, fileOffset, SEEK_SET) != fileOffset) {
-        ALOGW("seek %lld failed: %s\n", (long long int)fileOffset, strerror(errno));
+    if (footerSize < (kFooterMinSize - kFooterTagSize)) {
+        ALOGW("claimed footer size is too small (0x%zx; minimum size is 0x%x)\n",
+                footerSize, kFooterMinSize - kFooterTagSize);
         return false;
     }
 
+    off64_t fileOffset = fileLength - footerSize - kFooterTagSize;
     mFooterStart = fileOffset;
 
-    char* scanBuf = (char*)malloc(footerSize);
-    if (scanBuf == NULL) {
-        ALOGW("couldn't allocate scanBuf: %s\n", strerror(errno));
-        return false;
-    }
+    const unsigned char* scanBuf;
+    unsigned char* largeBuf = NULL;
+    if (footerSize + kFooterTagSize <= tailSize) {
+        scanBuf = footer - footerSize;
+    } else {
+        largeBuf = (unsigned char*)malloc(footerSize);
+        if (largeBuf == NULL) {
+            ALOGW("couldn't allocate scanBuf: %s\n", strerror(errno));
+            return false;
+        }
 
-    actual = TEMP_FAILURE_RETRY(read(fd, scanBuf, footerSize));
-    // readAmount is guaranteed to be less than kMaxBufSize
-    if (actual != (ssize_t)footerSize) {
-        ALOGI("couldn't read ObbFile footer: %s\n", strerror(errno));
-        free(scanBuf);
-        return false;
+        actual = readAt(fd, largeBuf, footerSize, fileOffset);
+        // readAmount is guaranteed to be less than kMaxBufSize
+        if (actual != (ssize_t)footerSize) {
+            ALOGI("couldn't read ObbFile footer: %s\n", strerror(errno));
+            free(largeBuf);
+            return false;
+        }
+        scanBuf = largeBuf;
     }
 
+    bool success = parseFooter(scanBuf, footerSize);
+    free(largeBuf);
+    return success;
+}
+
+bool ObbFile::parseFooter(const unsigned char* scanBuf, size_t footerSize)
+{
 #ifdef DEBUG
     for (int i = 0; i < footerSize; ++i) {
         ALOGI("char: 0x%02x\n", scanBuf[i]);
     }
 #endif
 
-    uint32_t sigVersion = get4LE((unsigned char*)scanBuf);
+    uint32_t sigVersion = get4LE(scanBuf);
     if (sigVersion != kSigVersion) {
         ALOGW("Unsupported ObbFile version %d\n", sigVersion);
-        free(scanBuf);
         return false;
     }
 
-    mVersion = (int32_t) get4LE((unsigned char*)scanBuf + kPackageVersionOffset);
-    mFlags = (int32_t) get4LE((unsigned char*)scanBuf + kFlagsOffset);
+    mVersion = (int32_t) get4LE(scanBuf + kPackageVersionOffset);
+    mFlags = (int32_t) get4LE(scanBuf + kFlagsOffset);
 
-    memcpy(&mSalt, (unsigned char*)scanBuf + kSaltOffset, sizeof(mSalt));
+    memcpy(&mSalt, scanBuf + kSaltOffset, sizeof(mSalt));
 
-    size_t packageNameLen = get4LE((unsigned char*)scanBuf + kPackageNameLenOffset);
+    size_t packageNameLen = get4LE(scanBuf + kPackageNameLenOffset);
     if (packageNameLen == 0
             || packageNameLen > (footerSize - kPackageNameOffset)) {
         ALOGW("bad ObbFile package name length (0x%04zx; 0x%04zx possible)\n",
                 packageNameLen, footerSize - kPackageNameOffset);
-        free(scanBuf);
         return false;
     }
 
-    char* packageName = reinterpret_cast<char*>(scanBuf + kPackageNameOffset);
-    mPackageName = String8(const_cast<char*>(packageName), packageNameLen);
-
-    free(scanBuf);
+    const char* packageName = reinterpret_cast<const char*>(scanBuf + kPackageNameOffset);
+    mPackageName = String8(packageName, packageNameLen);
 
 #ifdef DEBUG
     ALOGI("Obb scan succeeded: packageName=%s, version=%d\n", mPackageName.string(), mVersion);
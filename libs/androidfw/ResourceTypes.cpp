@@ -25,9 +25,11 @@
 #include <string.h>
 
 #include <algorithm>
+#include <atomic>
 #include <limits>
 #include <memory>
 #include <type_traits>
+#include <vector>
 
 #include <androidfw/ByteBucketArray.h>
 #include <androidfw/ResourceTypes.h>
@@ -651,15 +653,13 @@ status_t ResStringPool::getError() const
 void ResStringPool::uninit()
 {
     mError = NO_INIT;
-    if (mHeader != NULL && mCache != NULL) {
+    std::atomic<char16_t*>* cache = mCache.load(std::memory_order_relaxed);
+    if (mHeader != NULL && cache != NULL) {
         for (size_t x = 0; x < mHeader->stringCount; x++) {
-            if (mCache[x] != NULL) {
-                free(mCache[x]);
-                mCache[x] = NULL;
-            }
+            free(cache[x].load(std::memory_order_relaxed));
         }
-        free(mCache);
-        mCache = NULL;
+        free(cache);
+        mCache.store(NULL, std::memory_order_relaxed);
     }
     if (mOwnedData) {
         free(mOwnedData);
@@ -743,10 +743,20 @@ const char16_t* ResStringPool::stringAt(size_t idx, size_t* u16len) const
 
                 // encLen must be less than 0x7FFF due to encoding.
                 if ((uint32_t)(u8str+u8len-strings) < mStringPoolSize) {
+                    // Strings converted before are the common case, and don't need the lock.
+                    std::atomic<char16_t*>* cache = mCache.load(std::memory_order_acquire);
+                    if (cache != NULL) {
+                        char16_t* u16str = cache[idx].load(std::memory_order_acquire);
+                        if (u16str != NULL) {
+                            return u16str;
+                        }
+                    }
+
                     AutoMutex lock(mDecodeLock);
 
-                    if (mCache != NULL && mCache[idx] != NULL) {
-                        return mCache[idx];
+                    cache = mCache.load(std::memory_order_relaxed);
+                    if (cache != NULL && cache[idx].load(std::memory_order_relaxed) != NULL) {
+                        return cache[idx].load(std::memory_order_relaxed);
                     }
 
                     // Retrieve the actual length of the utf8 string if the
@@ -776,7 +786,7 @@ const char16_t* ResStringPool::stringAt(size_t idx, size_t* u16len) const
 
                     utf8_to_utf16(u8str, u8len, u16str, *u16len + 1);
 
-                    if (mCache == NULL) {
+                    if (cache == NULL) {
 #ifndef __ANDROID__
                         if (kDebugStringPoolNoisy) {
                             ALOGI("CREATING STRING CACHE OF %zu bytes",
@@ -787,19 +797,23 @@ const char16_t* ResStringPool::stringAt(size_t idx, size_t* u16len) const
                         ALOGW("CREATING STRING CACHE OF %zu bytes",
                                 static_cast<size_t>(mHeader->stringCount*sizeof(char16_t**)));
 #endif
-                        mCache = (char16_t**)calloc(mHeader->stringCount, sizeof(char16_t*));
-                        if (mCache == NULL) {
+                        // Zeroed memory holds null atomic pointers.
+                        cache = (std::atomic<char16_t*>*)calloc(mHeader->stringCount,
+                                                                 sizeof(std::atomic<char16_t*>));
+                        if (cache == NULL) {
                             ALOGW("No memory trying to allocate decode cache table of %d bytes\n",
                                   (int)(mHeader->stringCount*sizeof(char16_t**)));
+                            free(u16str);
                             return NULL;
                         }
+                        mCache.store(cache, std::memory_order_release);
                     }
 
                     if (kDebugStringPoolNoisy) {
                       ALOGI("Caching UTF8 string: %s", u8str);
                     }
 
-                    mCache[idx] = u16str;
+                    cache[idx].store(u16str, std::memory_order_release);
                     return u16str;
                 } else {
                     ALOGW("Bad string block: string #%lld extends to %lld, past end at %lld\n",
@@ -3501,6 +3515,18 @@ struct ResTable::Package
 // A group of objects describing a particular resource package.
 // The first in 'package' is always the root object (from the resource
 // table that defined the package); the ones after are skins on top of it.
+/**
+ * The configurations of the types of a package group that match the parameters of a ResTable,
+ * as computed by setParameters().
+ */
+struct FilteredConfigs
+{
+    ResTable_config params;
+
+    // Indexed by type index, then by the position of the Type in its TypeList.
+    std::vector<std::vector<Vector<const ResTable_type*>>> types;
+};
+
 struct ResTable::PackageGroup
 {
     PackageGroup(
@@ -3510,12 +3536,15 @@ struct ResTable::PackageGroup
         , name(_name)
         , id(_id)
         , largestTypeId(0)
+        , filteredConfigs(NULL)
+        , filteredConfigsReaders(0)
         , dynamicRefTable(static_cast<uint8_t>(_id), appAsLib)
         , isSystemAsset(_isSystemAsset)
         , isDynamic(_isDynamic)
     { }
 
     ~PackageGroup() {
+        delete filteredConfigs.load(std::memory_order_relaxed);
         clearBagCache();
         const size_t numTypes = types.size();
         for (size_t i = 0; i < numTypes; i++) {
@@ -3538,9 +3567,42 @@ struct ResTable::PackageGroup
         }
     }
 
+    /**
+     * Publishes the configurations matching new parameters. Lookups read them without a lock,
+     * so the ones they replace are kept until no lookup is reading any. Called with the
+     * ResTable's mLock.
+     */
+    void setFilteredConfigs(const FilteredConfigs* configs) {
+        const FilteredConfigs* old = filteredConfigs.exchange(configs);
+        if (old != NULL) {
+            retiredFilteredConfigs.emplace_back(old);
+        }
+        // A lookup that starts reading after this sees the new configurations, see
+        // FilteredConfigsReader.
+        if (filteredConfigsReaders.load() == 0) {
+            retiredFilteredConfigs.clear();
+        }
+    }
+
+    /**
+     * Keeps the configurations published by setFilteredConfigs() from being freed while a
+     * lookup reads them. Must be created before filteredConfigs is loaded.
+     */
+    class FilteredConfigsReader {
+    public:
+        explicit FilteredConfigsReader(const PackageGroup* group) : mGroup(group) {
+            mGroup->filteredConfigsReaders.fetch_add(1);
+        }
+        ~FilteredConfigsReader() {
+            mGroup->filteredConfigsReaders.fetch_sub(1);
+        }
+    private:
+        const PackageGroup* mGroup;
+    };
+
     /**
      * Clear all cache related data that depends on parameters/configuration.
-     * This includes the bag caches and filtered types.
+     * This includes the bag caches.
      */
     void clearBagCache() {
         for (size_t i = 0; i < typeCacheEntries.size(); i++) {
@@ -3551,9 +3613,6 @@ struct ResTable::PackageGroup
             if (!typeList.isEmpty()) {
                 TypeCacheEntry& cacheEntry = typeCacheEntries.editItemAt(i);
 
-                // Reset the filtered configurations.
-                cacheEntry.filteredConfigs.clear();
-
                 bag_set** typeBags = cacheEntry.cachedBags;
                 if (kDebugTableNoisy) {
                     printf("typeBags=%p\n", typeBags);
@@ -3606,6 +3665,12 @@ struct ResTable::PackageGroup
     // be shared by other ResTable's (framework resources are shared this way).
     ByteBucketArray<TypeCacheEntry> typeCacheEntries;
 
+    // The configurations matching the current parameters, see setFilteredConfigs().
+    std::atomic<const FilteredConfigs*> filteredConfigs;
+    std::vector<std::unique_ptr<const FilteredConfigs>> retiredFilteredConfigs;
+    // The number of lookups reading filteredConfigs, see FilteredConfigsReader.
+    mutable std::atomic<int32_t> filteredConfigsReaders;
+
     // The table mapping dynamic references to resolved references for
     // this package group.
     // TODO: We may be able to support dynamic references in overlays
@@ -4755,7 +4820,6 @@ ssize_t ResTable::getBagLocked(uint32_t resID, const bag_entry** outBag,
 void ResTable::setParameters(const ResTable_config* params)
 {
     AutoMutex _lock(mLock);
-    AutoMutex _lock2(mFilteredConfigLock);
 
     if (kDebugTableGetEntry) {
         ALOGI("Setting parameters: %s\n", params->toString().string());
@@ -4770,6 +4834,8 @@ void ResTable::setParameters(const ResTable_config* params)
 
         // Find which configurations match the set of parameters. This allows for a much
         // faster lookup in getEntry() if the set of values is narrowed down.
+        FilteredConfigs* filteredConfigs = new FilteredConfigs();
+        filteredConfigs->params = mParams;
         for (size_t t = 0; t < packageGroup->types.size(); t++) {
             if (packageGroup->types[t].isEmpty()) {
                 continue;
@@ -4777,32 +4843,31 @@ void ResTable::setParameters(const ResTable_config* params)
 
             TypeList& typeList = packageGroup->types.editItemAt(t);
 
-            // Retrieve the cache entry for this type.
-            TypeCacheEntry& cacheEntry = packageGroup->typeCacheEntries.editItemAt(t);
+            filteredConfigs->types.resize(t + 1);
+            std::vector<Vector<const ResTable_type*>>& typeConfigs = filteredConfigs->types[t];
+            typeConfigs.resize(typeList.size());
 
             for (size_t ts = 0; ts < typeList.size(); ts++) {
                 Type* type = typeList.editItemAt(ts);
 
-                std::shared_ptr<Vector<const ResTable_type*>> newFilteredConfigs =
-                        std::make_shared<Vector<const ResTable_type*>>();
+                Vector<const ResTable_type*>& newFilteredConfigs = typeConfigs[ts];
 
                 for (size_t ti = 0; ti < type->configs.size(); ti++) {
                     ResTable_config config;
                     config.copyFromDtoH(type->configs[ti]->config);
 
                     if (config.match(mParams)) {
-                        newFilteredConfigs->add(type->configs[ti]);
+                        newFilteredConfigs.add(type->configs[ti]);
                     }
                 }
 
                 if (kDebugTableNoisy) {
                     ALOGD("Updating pkg=%zu type=%zu with %zu filtered configs",
-                          p, t, newFilteredConfigs->size());
+                          p, t, newFilteredConfigs.size());
                 }
-
-                cacheEntry.filteredConfigs.add(newFilteredConfigs);
             }
         }
+        packageGroup->setFilteredConfigs(filteredConfigs);
     }
 }
 
@@ -6413,25 +6478,16 @@ status_t ResTable::getEntry(
 
         const Vector<const ResTable_type*>* candidateConfigs = &typeSpec->configs;
 
-        std::shared_ptr<Vector<const ResTable_type*>> filteredConfigs;
-        if (config && memcmp(&mParams, config, sizeof(mParams)) == 0) {
-            // Grab the lock first so we can safely get the current filtered list.
-            AutoMutex _lock(mFilteredConfigLock);
-
-            // This configuration is equal to the one we have previously cached for,
-            // so use the filtered configs.
-
-            const TypeCacheEntry& cacheEntry = packageGroup->typeCacheEntries[typeIndex];
-            if (i < cacheEntry.filteredConfigs.size()) {
-                if (cacheEntry.filteredConfigs[i]) {
-                    // Grab a reference to the shared_ptr so it doesn't get destroyed while
-                    // going through this list.
-                    filteredConfigs = cacheEntry.filteredConfigs[i];
-
-                    // Use this filtered list.
-                    candidateConfigs = filteredConfigs.get();
-                }
-            }
+        // If this configuration is equal to the one the published filtered configs were
+        // computed for, use them. They are not freed while the reader is alive, so they
+        // are read without a lock.
+        PackageGroup::FilteredConfigsReader filteredConfigsReader(packageGroup);
+        const FilteredConfigs* filteredConfigs = packageGroup->filteredConfigs.load();
+        if (config && filteredConfigs != NULL
+                && memcmp(&filteredConfigs->params, config, sizeof(*config)) == 0
+                && typeIndex < filteredConfigs->types.size()
+                && i < filteredConfigs->types[typeIndex].size()) {
+            candidateConfigs = &filteredConfigs->types[typeIndex][i];
         }
 
         const size_t numConfigs = candidateConfigs->size();
@@ -25,6 +25,7 @@
 #include <assert.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
 
 /*
  * TEMP_FAILURE_RETRY is defined by some, but not all, versions of
@@ -64,6 +65,13 @@ StreamingZipInflater::StreamingZipInflater(int fd, off64_t compDataStart,
     mOutBufSize = StreamingZipInflater::OUTPUT_CHUNK_SIZE;
     mOutBuf = new uint8_t[mOutBufSize];
 
+#if defined(__linux__)
+    // The compressed data is read sequentially, let the kernel read ahead of the inflater
+    // instead of blocking on every input chunk.
+    ::posix_fadvise(mFd, mInFileStart, mInTotalSize, POSIX_FADV_SEQUENTIAL);
+    ::posix_fadvise(mFd, mInFileStart, mInTotalSize, POSIX_FADV_WILLNEED);
+#endif
+
     initInflateState();
 }
 
@@ -82,6 +90,10 @@ StreamingZipInflater::StreamingZipInflater(FileMap* dataMap, size_t uncompSize)
     mOutBufSize = StreamingZipInflater::OUTPUT_CHUNK_SIZE;
     mOutBuf = new uint8_t[mOutBufSize];
 
+    // Same as above, page the mapping in ahead of the inflater rather than fault by fault.
+    dataMap->advise(FileMap::SEQUENTIAL);
+    dataMap->advise(FileMap::WILLNEED);
+
     initInflateState();
 }
 
@@ -133,7 +145,7 @@ void StreamingZipInflater::initInflateState() {
  *    b. point the output to the start of the output buffer and decode what we can
  *    c. deliver whatever output data we can
  */
-ssize_t StreamingZipInflater::read(void* outBuf, size_t count) {
+ssize_t StreamingZipInflater::read(void* outBuf, size_t count, size_t minDirectCount) {
     uint8_t* dest = (uint8_t*) outBuf;
     size_t bytesRead = 0;
     size_t toRead = min_of(count, size_t(mOutTotalSize - mOutCurPosition));
@@ -167,8 +179,18 @@ ssize_t StreamingZipInflater::read(void* outBuf, size_t count) {
             }
             // we know we've drained whatever is in the out buffer now, so just
             // start from scratch there, reading all the input we have at present.
-            mInflateState.next_out = (Bytef*) mOutBuf;
-            mInflateState.avail_out = mOutBufSize;
+            // Requests of at least minDirectCount bytes, a whole output chunk for plain
+            // reads, are inflated straight into the caller's buffer instead, which saves
+            // copying every byte of large assets.
+            const bool inflateToDest = (outBuf != NULL) && (toRead >= minDirectCount);
+            if (inflateToDest) {
+                mInflateState.next_out = (Bytef*) dest;
+                // avail_out is only 32 bits wide, larger reads take several passes.
+                mInflateState.avail_out = min_of(toRead, 1u << 30);
+            } else {
+                mInflateState.next_out = (Bytef*) mOutBuf;
+                mInflateState.avail_out = mOutBufSize;
+            }
 
             /*
             ALOGV("Inflating to outbuf: avail_in=%u avail_out=%u next_in=%p next_out=%p",
@@ -196,8 +218,17 @@ ssize_t StreamingZipInflater::read(void* outBuf, size_t count) {
                 }
 
                 // Note how much data we got, and off we go
-                mOutDeliverable = 0;
-                mOutLastDecoded = mOutBufSize - mInflateState.avail_out;
+                if (inflateToDest) {
+                    const size_t decoded = min_of(toRead, 1u << 30) - mInflateState.avail_out;
+                    mOutDeliverable = mOutLastDecoded = 0;
+                    mOutCurPosition += decoded;
+                    dest += decoded;
+                    bytesRead += decoded;
+                    toRead -= decoded;
+                } else {
+                    mOutDeliverable = 0;
+                    mOutLastDecoded = mOutBufSize - mInflateState.avail_out;
+                }
             }
         }
     }
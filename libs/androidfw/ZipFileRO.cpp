@@ -33,6 +33,10 @@
 #include <errno.h>
 #include <assert.h>
 #include <unistd.h>
+#include <sys/stat.h>
+
+#include <list>
+#include <string>
 
 using namespace android;
 
@@ -53,24 +57,138 @@ private:
     _ZipEntryRO& operator=(const _ZipEntryRO& other);
 };
 
+/*
+ * Archives opened by path are shared by the ZipFileRO instances that open
+ * the same, unchanged file, and the last few ones nobody uses anymore are
+ * kept open.  Reopening an APK then doesn't parse its central directory
+ * again, which dominates the open of APKs with tens of thousands of entries.
+ *
+ * All reads of a shared handle go through pread(), so concurrent users of
+ * the same handle don't interfere.
+ */
+namespace {
+
+struct SharedArchive {
+    std::string path;
+    dev_t dev;
+    ino_t ino;
+    off64_t size;
+    time_t modWhen;
+    ZipArchiveHandle handle;
+    int refs;
+    // Set once the file changed on disk, the handle is closed by its last user.
+    bool stale;
+};
+
+const size_t kMaxIdleArchives = 4;
+
+Mutex gSharedArchivesLock;
+
+// Most recently used first.
+std::list<SharedArchive>& sharedArchives() {
+    static std::list<SharedArchive>* archives = new std::list<SharedArchive>();
+    return *archives;
+}
+
+bool matches(const SharedArchive& archive, const struct stat& st) {
+    return archive.dev == st.st_dev && archive.ino == st.st_ino &&
+            archive.size == static_cast<off64_t>(st.st_size) &&
+            archive.modWhen == st.st_mtime;
+}
+
+/*
+ * Closes the idle archives beyond kMaxIdleArchives, along with the stale ones.
+ * Holding gSharedArchivesLock.
+ */
+void trimSharedArchivesLocked() {
+    std::list<SharedArchive>& archives = sharedArchives();
+    size_t idle = 0;
+    for (auto iter = archives.begin(); iter != archives.end();) {
+        if (iter->refs == 0 && (iter->stale || ++idle > kMaxIdleArchives)) {
+            CloseArchive(iter->handle);
+            iter = archives.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+/*
+ * Returns a handle on the archive at path, shared with the other users of the
+ * same file, or NULL if it can't be opened.  Must be released with
+ * releaseArchive().
+ */
+ZipArchiveHandle acquireArchive(const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        ALOGW("Error opening archive %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    AutoMutex _l(gSharedArchivesLock);
+    std::list<SharedArchive>& archives = sharedArchives();
+    for (auto iter = archives.begin(); iter != archives.end(); ++iter) {
+        if (iter->stale || iter->path != path) {
+            continue;
+        }
+        if (!matches(*iter, st)) {
+            iter->stale = true;
+            trimSharedArchivesLocked();
+            break;
+        }
+        iter->refs++;
+        archives.splice(archives.begin(), archives, iter);
+        return iter->handle;
+    }
+
+    ZipArchiveHandle handle;
+    const int32_t error = OpenArchive(path, &handle);
+    if (error) {
+        ALOGW("Error opening archive %s: %s", path, ErrorCodeString(error));
+        CloseArchive(handle);
+        return NULL;
+    }
+    archives.push_front(SharedArchive{path, st.st_dev, st.st_ino,
+            static_cast<off64_t>(st.st_size), st.st_mtime, handle, 1, false});
+    return handle;
+}
+
+/*
+ * Drops a reference on a handle returned by acquireArchive(), or closes any
+ * other handle.
+ */
+void releaseArchive(ZipArchiveHandle handle) {
+    AutoMutex _l(gSharedArchivesLock);
+    std::list<SharedArchive>& archives = sharedArchives();
+    for (auto iter = archives.begin(); iter != archives.end(); ++iter) {
+        if (iter->handle == handle) {
+            if (--iter->refs == 0) {
+                archives.splice(archives.begin(), archives, iter);
+                trimSharedArchivesLocked();
+            }
+            return;
+        }
+    }
+    CloseArchive(handle);
+}
+
+} // namespace
+
 ZipFileRO::~ZipFileRO() {
-    CloseArchive(mHandle);
+    releaseArchive(mHandle);
     if (mFileName != NULL) {
         free(mFileName);
     }
 }
 
 /*
- * Open the specified file read-only.  We memory-map the entire thing and
- * close the file before returning.
+ * Open the specified file read-only.  The archive is shared with the other
+ * instances that opened the same file, see acquireArchive().
  */
 /* static */ ZipFileRO* ZipFileRO::open(const char* zipFileName)
 {
-    ZipArchiveHandle handle;
-    const int32_t error = OpenArchive(zipFileName, &handle);
-    if (error) {
-        ALOGW("Error opening archive %s: %s", zipFileName, ErrorCodeString(error));
-        CloseArchive(handle);
+    ZipArchiveHandle handle = acquireArchive(zipFileName);
+    if (handle == NULL) {
         return NULL;
     }
 
@@ -19,6 +19,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "android-base/macros.h"
 #include "android-base/unique_fd.h"
@@ -62,6 +63,28 @@ class ApkAssets {
                                                      const std::string& friendly_name, bool system,
                                                      bool force_shared_lib);
 
+  // Describes one of the ApkAssets to load with LoadAll().
+  struct LoadRequest {
+    enum class Type {
+      kApk,
+      kSharedLibrary,
+      kOverlay,
+    };
+
+    // The path of the APK, or of the IDMAP for overlays.
+    std::string path;
+    Type type = Type::kApk;
+    bool system = false;
+  };
+
+  // Loads the ApkAssets of all `requests` concurrently on up to `max_threads` threads, including
+  // the calling one, and returns them in the order of the requests. The ApkAssets that failed to
+  // load are nullptr.
+  // Pass the result to a single call of AssetManager2::SetApkAssets(), so that the dynamic
+  // reference table is built once for all of them.
+  static std::vector<std::unique_ptr<const ApkAssets>> LoadAll(
+      const std::vector<LoadRequest>& requests, size_t max_threads = 4u);
+
   std::unique_ptr<Asset> Open(const std::string& path,
                               Asset::AccessMode mode = Asset::AccessMode::ACCESS_RANDOM) const;
 
@@ -89,6 +89,21 @@ public:
      */
     virtual const void* getBuffer(bool wordAligned) = 0;
 
+    /*
+     * Get a pointer to the entire contents of the file mapped straight from
+     * its source, if the data starts on an "alignment" byte boundary
+     * (a power of two).  Unlike getBuffer(), the data is never inflated or
+     * copied; NULL is returned instead, e.g. for compressed assets.
+     */
+    virtual const void* getMappedBuffer(size_t /* alignment */) { return NULL; }
+
+    /*
+     * Read data from the current offset like read(), but without staging it
+     * in any intermediate buffer: compressed data is inflated straight into
+     * "buf" whatever the size of the request.
+     */
+    virtual ssize_t readDirect(void* buf, size_t count) { return read(buf, count); }
+
     /*
      * Get the total amount of data that can be read.
      */
@@ -262,6 +277,7 @@ public:
     virtual off64_t seek(off64_t offset, int whence);
     virtual void close(void);
     virtual const void* getBuffer(bool wordAligned);
+    virtual const void* getMappedBuffer(size_t alignment);
     virtual off64_t getLength(void) const { return mLength; }
     virtual off64_t getRemainingLength(void) const { return mLength-mOffset; }
     virtual int openFileDescriptor(off64_t* outStart, off64_t* outLength) const;
@@ -318,6 +334,7 @@ public:
     virtual off64_t seek(off64_t offset, int whence);
     virtual void close(void);
     virtual const void* getBuffer(bool wordAligned);
+    virtual ssize_t readDirect(void* buf, size_t count);
     virtual off64_t getLength(void) const { return mUncompressedLen; }
     virtual off64_t getRemainingLength(void) const { return mUncompressedLen-mOffset; }
     virtual int openFileDescriptor(off64_t* /* outStart */, off64_t* /* outLength */) const { return -1; }
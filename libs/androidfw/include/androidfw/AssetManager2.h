@@ -69,7 +69,30 @@ struct ResolvedBag {
   Entry entries[0];
 };
 
-struct FindEntryResult;
+struct FindEntryResult {
+  // A pointer to the resource table entry for this resource.
+  // If the size of the entry is > sizeof(ResTable_entry), it can be cast to
+  // a ResTable_map_entry and processed as a bag/map.
+  const ResTable_entry* entry;
+
+  // The configuration for which the resulting entry was defined. This is already swapped to host
+  // endianness.
+  ResTable_config config;
+
+  // The bitmask of configuration axis with which the resource value varies.
+  uint32_t type_flags;
+
+  // The dynamic package ID map for the package from which this resource came from.
+  const DynamicRefTable* dynamic_ref_table;
+
+  // The string pool reference to the type's name. This uses a different string pool than
+  // the global string pool, but this is hidden from the caller.
+  StringPoolRef type_string_ref;
+
+  // The string pool reference to the entry's name. This uses a different string pool than
+  // the global string pool, but this is hidden from the caller.
+  StringPoolRef entry_string_ref;
+};
 
 // AssetManager2 is the main entry point for accessing assets and resources.
 // AssetManager2 provides caching of resources retrieved via the underlying ApkAssets.
@@ -89,6 +112,7 @@ class AssetManager2 {
   };
 
   AssetManager2();
+  ~AssetManager2();
 
   // Sets/resets the underlying ApkAssets for this AssetManager. The ApkAssets
   // are not owned by the AssetManager, and must have a longer lifetime.
@@ -118,10 +142,27 @@ class AssetManager2 {
   // caches that are related to the configuration change to be invalidated.
   void SetConfiguration(const ResTable_config& configuration);
 
+  // Counts the lookups of the resolved entry cache, which remembers the entry chosen for a
+  // resource ID in the current configuration.
+  struct EntryCacheStats {
+    size_t hits = 0u;
+    size_t misses = 0u;
+  };
+
+  inline const EntryCacheStats& GetEntryCacheStats() const {
+    return entry_cache_stats_;
+  }
+
   inline const ResTable_config& GetConfiguration() const {
     return configuration_;
   }
 
+  // Returns a counter that changes whenever the ApkAssets or the configuration change, so that
+  // values resolved against this AssetManager can tell when they have become stale.
+  inline uint32_t GetGeneration() const {
+    return generation_;
+  }
+
   // Returns all configurations for which there are resources defined. This includes resource
   // configurations in all the ApkAssets set for this AssetManager.
   // If `exclude_system` is set to true, resource configurations from system APKs
@@ -285,7 +326,7 @@ class AssetManager2 {
   std::vector<const ApkAssets*> apk_assets_;
 
   // A collection of configurations and their associated ResTable_type that match the current
-  // AssetManager configuration.
+  // AssetManager configuration, sorted from the best match to the worst.
   struct FilteredConfigGroup {
     std::vector<ResTable_config> configurations;
     std::vector<const ResTable_type*> types;
@@ -333,6 +374,17 @@ class AssetManager2 {
   // Cached set of bags. These are cached because they can inherit keys from parent bags,
   // which involves some calculation.
   std::unordered_map<uint32_t, util::unique_cptr<ResolvedBag>> cached_bags_;
+
+  // The entry FindEntry() selected for each resource ID looked up in the current configuration,
+  // without a density override. Entries are purged like bags, according to their type_flags.
+  struct CachedEntry {
+    ApkAssetsCookie cookie;
+    FindEntryResult entry;
+  };
+  mutable std::unordered_map<uint32_t, CachedEntry> cached_entries_;
+  mutable EntryCacheStats entry_cache_stats_;
+
+  uint32_t generation_ = 0u;
 };
 
 class Theme {
@@ -388,6 +440,17 @@ class Theme {
                                             uint32_t* in_out_type_spec_flags = nullptr,
                                             uint32_t* out_last_ref = nullptr) const;
 
+  // Retrieves the attribute `resid` in the theme and resolves references to its final value, as
+  // GetAttribute() followed by AssetManager2::ResolveReference() would. The results are cached
+  // until the theme or its AssetManager change, since inflation resolves the same theme
+  // attributes for every view.
+  //
+  // Returns kInvalidCookie if the attribute is not in the theme or a reference could not be
+  // resolved, in which case `out_value` holds the value resolved so far.
+  ApkAssetsCookie ResolveAttribute(uint32_t resid, Res_value* out_value,
+                                   ResTable_config* in_out_selected_config,
+                                   uint32_t* in_out_type_spec_flags, uint32_t* out_last_ref) const;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(Theme);
 
@@ -402,6 +465,19 @@ class Theme {
 
   constexpr static size_t kPackageCount = std::numeric_limits<uint8_t>::max() + 1;
   std::array<std::unique_ptr<Package>, kPackageCount> packages_;
+
+  // The results of ResolveAttribute() since the theme was last modified, keyed by attribute ID.
+  // Attributes that aren't in the theme are kept with a cookie of kInvalidCookie. `last_ref` is
+  // 0 if the value of the attribute wasn't a reference, `config` is unused then.
+  struct CachedAttribute {
+    ApkAssetsCookie cookie;
+    Res_value value;
+    ResTable_config config;
+    uint32_t type_spec_flags;
+    uint32_t last_ref;
+  };
+  mutable std::unordered_map<uint32_t, CachedAttribute> cached_attributes_;
+  mutable uint32_t cached_attributes_generation_ = 0u;
 };
 
 inline const ResolvedBag::Entry* begin(const ResolvedBag* bag) {
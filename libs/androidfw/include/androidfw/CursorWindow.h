@@ -21,6 +21,8 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <vector>
+
 #include <binder/Parcel.h>
 #include <log/log.h>
 #include <utils/String8.h>
@@ -48,10 +50,14 @@ namespace android {
  * Note that the data types come from sqlite3.h.
  *
  * Strings are stored in UTF-8.
+ *
+ * A window created with a maximum size larger than its size reserves an ashmem region of the
+ * maximum size, and grows in geometric steps within it when full. Ashmem pages are only
+ * committed once written, so a window only costs the memory its rows use.
  */
 class CursorWindow {
     CursorWindow(const String8& name, int ashmemFd,
-            void* data, size_t size, bool readOnly);
+            void* data, size_t size, size_t maxSize, bool readOnly);
 
 public:
     /* Field types. */
@@ -79,9 +85,28 @@ public:
         friend class CursorWindow;
     } __attribute((packed));
 
+    /* The value of one field of a row stored with putRow(). */
+    struct FieldValue {
+        int32_t type;
+        union {
+            double d;
+            int64_t l;
+            struct {
+                const void* data;
+                // Includes the null terminator for strings.
+                size_t size;
+            } buffer;
+        } data;
+    };
+
     ~CursorWindow();
 
     static status_t create(const String8& name, size_t size, CursorWindow** outCursorWindow);
+    /**
+     * Creates a window of the given size, which grows up to maxSize when full.
+     */
+    static status_t create(const String8& name, size_t size, size_t maxSize,
+            CursorWindow** outCursorWindow);
     static status_t createFromParcel(Parcel* parcel, CursorWindow** outCursorWindow);
 
     status_t writeToParcel(Parcel* parcel);
@@ -108,12 +133,32 @@ public:
     status_t putDouble(uint32_t row, uint32_t column, double value);
     status_t putNull(uint32_t row, uint32_t column);
 
+    /**
+     * Appends a row holding one value per column. The field directory of the row and the
+     * data of its strings and blobs are allocated at once, so the row is either stored
+     * entirely or not at all, and all of its data is adjacent.
+     */
+    status_t putRow(const FieldValue* values);
+
     /**
      * Gets the field slot at the specified row and column.
      * Returns null if the requested row or column is not in the window.
      */
     FieldSlot* getFieldSlot(uint32_t row, uint32_t column);
 
+    /**
+     * Gets the field slots of all of the columns of the specified row, which are adjacent.
+     * Returns null if the requested row is not in the window.
+     */
+    FieldSlot* getRowFieldSlots(uint32_t row);
+
+    /**
+     * Gets the field slots of the specified column for numRows rows starting at startRow.
+     * Returns BAD_VALUE if any of the requested fields is not in the window.
+     */
+    status_t getColumnFieldSlots(uint32_t column, uint32_t startRow, uint32_t numRows,
+            FieldSlot** outFieldSlots);
+
     inline int32_t getFieldSlotType(FieldSlot* fieldSlot) {
         return fieldSlot->type;
     }
@@ -164,10 +209,17 @@ private:
     String8 mName;
     int mAshmemFd;
     void* mData;
+    // The part of the mapping the window may use so far.
     size_t mSize;
+    // The size of the mapping.
+    size_t mMaxSize;
     bool mReadOnly;
     Header* mHeader;
 
+    // Offsets of the row slot chunks walked so far, so that finding the slot of a row doesn't
+    // walk the list of chunks from the first one.
+    std::vector<uint32_t> mChunkOffsets;
+
     inline void* offsetToPtr(uint32_t offset, uint32_t bufferSize = 0) {
         if (offset >= mSize) {
             ALOGE("Offset %" PRIu32 " out of bounds, max value %zu", offset, mSize);
@@ -192,6 +244,13 @@ private:
      */
     uint32_t alloc(size_t size, bool aligned = false);
 
+    /**
+     * Grows the window so that it holds at least requiredSize bytes. Returns false if
+     * that is more than the maximum size.
+     */
+    bool grow(size_t requiredSize);
+
+    RowSlotChunk* getRowSlotChunk(uint32_t chunkIndex);
     RowSlot* getRowSlot(uint32_t row);
     RowSlot* allocRowSlot();
 
@@ -17,9 +17,9 @@
 #ifndef IDMAP_H_
 #define IDMAP_H_
 
+#include <array>
 #include <memory>
 #include <string>
-#include <unordered_map>
 
 #include "android-base/macros.h"
 
@@ -55,7 +55,9 @@ class LoadedIdmap {
   }
 
   // Returns the mapping of target entry ID to overlay entry ID for the given target type.
-  const IdmapEntry_header* GetEntryMapForType(uint8_t type_id) const;
+  inline const IdmapEntry_header* GetEntryMapForType(uint8_t type_id) const {
+    return type_map_[type_id];
+  }
 
  protected:
   // Exposed as protected so that tests can subclass and mock this class out.
@@ -63,7 +65,9 @@ class LoadedIdmap {
 
   const Idmap_header* header_ = nullptr;
   std::string overlay_apk_path_;
-  std::unordered_map<uint8_t, const IdmapEntry_header*> type_map_;
+
+  // Indexed by type ID, nullptr for the types that the IDMAP doesn't map.
+  std::array<const IdmapEntry_header*, 256> type_map_ = {};
 
  private:
   DISALLOW_COPY_AND_ASSIGN(LoadedIdmap);
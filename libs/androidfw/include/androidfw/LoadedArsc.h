@@ -17,8 +17,11 @@
 #ifndef LOADEDARSC_H_
 #define LOADEDARSC_H_
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 #include "android-base/macros.h"
@@ -43,6 +46,7 @@ class DynamicPackageEntry {
 
 // TypeSpec is going to be immediately proceeded by
 // an array of Type structs, all in the same block of memory.
+// The array is followed by the verification state of each Type.
 struct TypeSpec {
   // Pointer to the mmapped data where flags are kept.
   // Flags denote whether the resource entry is public
@@ -69,6 +73,22 @@ struct TypeSpec {
     const uint32_t* flags = reinterpret_cast<const uint32_t*>(type_spec + 1);
     return flags[entry_index];
   }
+
+  // Returns true if the Type at `type_index` is well formed, so that its entry offsets can be
+  // read. Types of packages loaded with `verify_lazily` are checked the first time this is
+  // called for them, and the result is remembered. Thread safe.
+  bool IsTypeValid(size_t type_index) const;
+
+  enum : uint8_t {
+    kTypeUnverified = 0,
+    kTypeValid,
+    kTypeInvalid,
+  };
+
+  inline std::atomic<uint8_t>* type_states() const {
+    return reinterpret_cast<std::atomic<uint8_t>*>(
+        const_cast<const ResTable_type**>(types + type_count));
+  }
 };
 
 // TypeSpecPtr points to a block of memory that holds a TypeSpec struct, followed by an array of
@@ -80,7 +100,8 @@ class LoadedPackage {
  public:
   static std::unique_ptr<const LoadedPackage> Load(const Chunk& chunk,
                                                    const LoadedIdmap* loaded_idmap, bool system,
-                                                   bool load_as_shared_library);
+                                                   bool load_as_shared_library,
+                                                   bool verify_lazily = false);
 
   ~LoadedPackage();
 
@@ -172,6 +193,16 @@ class LoadedPackage {
 
   LoadedPackage();
 
+  // Moves the TypeSpecs of the package into a single mapping that is then made read-only. System
+  // packages are loaded once by the zygote, this keeps their TypeSpecs on pages that are never
+  // written, so that they stay shared with every forked process instead of being copied on
+  // writes to neighbouring heap allocations.
+  void SealTypeSpecs();
+
+  // Returns the index from key string index to entry index for the type at `type_idx`, building
+  // it on first use. Must be called with entry_name_index_lock_ held.
+  const std::unordered_map<uint32_t, uint16_t>& GetEntryNameIndexLocked(size_t type_idx) const;
+
   ResStringPool type_string_pool_;
   ResStringPool key_string_pool_;
   std::string package_name_;
@@ -183,6 +214,19 @@ class LoadedPackage {
 
   ByteBucketArray<TypeSpecPtr> type_specs_;
   std::vector<DynamicPackageEntry> dynamic_package_map_;
+
+  // The mapping the TypeSpecs were moved to by SealTypeSpecs(), if any. The TypeSpecPtrs then
+  // point into it, and must be released instead of freed.
+  void* sealed_type_specs_ = nullptr;
+  size_t sealed_type_specs_size_ = 0u;
+
+  // The bytes of the TypeSpecs accounted for in NativeMemoryStats.
+  size_t type_specs_size_ = 0u;
+
+  // Name lookups are rare enough that the index of a type is only built once one of its entries
+  // is looked up by name. LoadedPackages are shared between AssetManagers, hence the lock.
+  mutable std::mutex entry_name_index_lock_;
+  mutable std::unordered_map<size_t, std::unordered_map<uint32_t, uint16_t>> entry_name_indices_;
 };
 
 // Read-only view into a resource table. This class validates all data
@@ -195,10 +239,14 @@ class LoadedArsc {
   // If `load_as_shared_library` is set to true, the application package (0x7f) is treated
   // as a shared library (0x00). When loaded into an AssetManager, the package will be assigned an
   // ID.
+  // If `verify_lazily` is set to true, the layout of the Type chunks is only checked the first
+  // time they are used, see TypeSpec::IsTypeValid(). A malformed Type then makes its entries
+  // unavailable, instead of failing the whole load.
   static std::unique_ptr<const LoadedArsc> Load(const StringPiece& data,
                                                 const LoadedIdmap* loaded_idmap = nullptr,
                                                 bool system = false,
-                                                bool load_as_shared_library = false);
+                                                bool load_as_shared_library = false,
+                                                bool verify_lazily = false);
 
   // Create an empty LoadedArsc. This is used when an APK has no resources.arsc.
   static std::unique_ptr<const LoadedArsc> CreateEmpty();
@@ -227,7 +275,8 @@ class LoadedArsc {
   DISALLOW_COPY_AND_ASSIGN(LoadedArsc);
 
   LoadedArsc() = default;
-  bool LoadTable(const Chunk& chunk, const LoadedIdmap* loaded_idmap, bool load_as_shared_library);
+  bool LoadTable(const Chunk& chunk, const LoadedIdmap* loaded_idmap, bool load_as_shared_library,
+                 bool verify_lazily);
 
   ResStringPool global_string_pool_;
   std::vector<std::unique_ptr<const LoadedPackage>> packages_;
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROIDFW_NATIVE_MEMORY_STATS_H_
+#define ANDROIDFW_NATIVE_MEMORY_STATS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace android {
+
+// The subsystems native memory is attributed to. The order is the one of the values
+// reported through android.os.Debug, new categories are only ever appended.
+enum class NativeMemoryCategory : int {
+  kBitmaps = 0,
+  kHwuiTextureCache,
+  kHwuiFontCache,
+  kHwuiGpuResourceCache,
+  kResourceTables,
+  kResourceBags,
+  kCursorWindows,
+
+  kCount,
+};
+
+// Process wide counters of the bytes and objects each subsystem currently holds, so native
+// memory can be attributed without a heap profile. The counters are relaxed atomics, cheap
+// enough to be updated on every allocation; a snapshot is only consistent per category.
+class NativeMemoryStats {
+ public:
+  struct Usage {
+    int64_t bytes;
+    int64_t objects;
+  };
+
+  static void Add(NativeMemoryCategory category, int64_t bytes, int64_t objects = 1);
+  static void Remove(NativeMemoryCategory category, int64_t bytes, int64_t objects = 1);
+
+  // For the subsystems that only know their usage as a whole, like the caches owned by Skia.
+  static void Set(NativeMemoryCategory category, int64_t bytes, int64_t objects);
+
+  static Usage Get(NativeMemoryCategory category);
+  static const char* GetName(NativeMemoryCategory category);
+
+  // Writes a line with the usage of every category to `fd`.
+  static void Dump(int fd);
+
+ private:
+  NativeMemoryStats() = delete;
+};
+
+}  // namespace android
+
+#endif  // ANDROIDFW_NATIVE_MEMORY_STATS_H_
@@ -37,6 +37,12 @@ public:
     ObbFile();
 
     bool readFrom(const char* filename);
+    /*
+     * Returns the ObbFile read from filename, shared with the other callers
+     * that read the same unchanged file, or NULL if it can't be read.  The
+     * returned ObbFile must not be modified.
+     */
+    static sp<ObbFile> readCached(const char* filename);
     bool readFrom(int fd);
     bool writeTo(const char* filename);
     bool writeTo(int fd);
@@ -132,6 +138,7 @@ private:
     size_t mFooterStart;
 
     bool parseObbFile(int fd);
+    bool parseFooter(const unsigned char* scanBuf, size_t footerSize);
 };
 
 }
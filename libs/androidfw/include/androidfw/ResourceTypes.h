@@ -34,6 +34,7 @@
 
 #include <android/configuration.h>
 
+#include <atomic>
 #include <memory>
 
 namespace android {
@@ -534,7 +535,9 @@ private:
     const uint32_t*             mEntries;
     const uint32_t*             mEntryStyles;
     const void*                 mStrings;
-    char16_t mutable**          mCache;
+    // UTF-16 conversions of the strings of UTF-8 pools, filled under mDecodeLock. Conversions
+    // are only freed by uninit(), so they are read without taking the lock.
+    mutable std::atomic<std::atomic<char16_t*>*> mCache;
     uint32_t                    mStringPoolSize;    // number of uint16_t
     const uint32_t*             mStyles;
     uint32_t                    mStylePoolSize;    // number of uint32_t
@@ -2034,10 +2037,6 @@ private:
 
         // Computed attribute bags for this type.
         bag_set** cachedBags;
-
-        // Pre-filtered list of configurations (per asset path) that match the parameters set on this
-        // ResTable.
-        Vector<std::shared_ptr<Vector<const ResTable_type*>>> filteredConfigs;
     };
 
     status_t addInternal(const void* data, size_t size, const void* idmapData, size_t idmapDataSize,
@@ -2066,13 +2065,6 @@ private:
 
     mutable Mutex               mLock;
 
-    // Mutex that controls access to the list of pre-filtered configurations
-    // to check when looking up entries.
-    // When iterating over a bag, the mLock mutex is locked. While mLock is locked,
-    // we do resource lookups.
-    // Mutex is not reentrant, so we must use a different lock than mLock.
-    mutable Mutex               mFilteredConfigLock;
-
     status_t                    mError;
 
     ResTable_config             mParams;
@@ -39,8 +39,13 @@ public:
     ~StreamingZipInflater();
 
     // read 'count' bytes of uncompressed data from the current position.  outBuf may
-    // be NULL, in which case the data is consumed and discarded.
-    ssize_t read(void* outBuf, size_t count);
+    // be NULL, in which case the data is consumed and discarded.  Reads of at least
+    // OUTPUT_CHUNK_SIZE bytes are inflated directly into outBuf.
+    ssize_t read(void* outBuf, size_t count) { return read(outBuf, count, mOutBufSize); }
+
+    // like read(), but whatever the size of the request the data is inflated directly
+    // into outBuf, which must not be NULL, without going through the output chunk.
+    ssize_t readDirect(void* outBuf, size_t count) { return read(outBuf, count, 1); }
 
     // seeking backwards requires uncompressing fom the beginning, so is very
     // expensive.  seeking forwards only requires uncompressing from the current
@@ -48,6 +53,7 @@ public:
     off64_t seekAbsolute(off64_t absoluteInputPosition);
 
 private:
+    ssize_t read(void* outBuf, size_t count, size_t minDirectCount);
     void initInflateState();
     int readNextChunk();
 
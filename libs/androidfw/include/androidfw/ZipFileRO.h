@@ -75,7 +75,9 @@ public:
     };
 
     /*
-     * Open an archive.
+     * Open an archive.  Instances opening the same, unchanged file share
+     * its parsed central directory, which stays cached for a while after the
+     * last one is deleted so that reopening the archive is cheap.
      */
     static ZipFileRO* open(const char* zipFileName);
 
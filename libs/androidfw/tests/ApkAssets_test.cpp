@@ -28,6 +28,7 @@ using ::android::base::unique_fd;
 using ::com::android::basic::R;
 using ::testing::Eq;
 using ::testing::Ge;
+using ::testing::IsNull;
 using ::testing::NotNull;
 using ::testing::SizeIs;
 using ::testing::StrEq;
@@ -79,6 +80,32 @@ TEST(ApkAssetsTest, LoadApkAsSharedLibrary) {
   EXPECT_TRUE(loaded_arsc->GetPackages()[0]->IsDynamic());
 }
 
+TEST(ApkAssetsTest, LoadAll) {
+  using Type = ApkAssets::LoadRequest::Type;
+  std::vector<ApkAssets::LoadRequest> requests = {
+      {GetTestDataPath() + "/basic/basic.apk", Type::kApk, false /*system*/},
+      {GetTestDataPath() + "/appaslib/appaslib.apk", Type::kSharedLibrary, false /*system*/},
+      {GetTestDataPath() + "/does_not_exist.apk", Type::kApk, false /*system*/},
+      {GetTestDataPath() + "/system/system.apk", Type::kApk, true /*system*/},
+  };
+
+  std::vector<std::unique_ptr<const ApkAssets>> loaded_apks =
+      ApkAssets::LoadAll(requests, 2u /*max_threads*/);
+  ASSERT_THAT(loaded_apks, SizeIs(4u));
+
+  ASSERT_THAT(loaded_apks[0], NotNull());
+  EXPECT_THAT(loaded_apks[0]->GetPath(), StrEq(requests[0].path));
+
+  ASSERT_THAT(loaded_apks[1], NotNull());
+  ASSERT_THAT(loaded_apks[1]->GetLoadedArsc()->GetPackages(), SizeIs(1u));
+  EXPECT_TRUE(loaded_apks[1]->GetLoadedArsc()->GetPackages()[0]->IsDynamic());
+
+  EXPECT_THAT(loaded_apks[2], IsNull());
+
+  ASSERT_THAT(loaded_apks[3], NotNull());
+  EXPECT_TRUE(loaded_apks[3]->GetLoadedArsc()->IsSystem());
+}
+
 TEST(ApkAssetsTest, LoadApkWithIdmap) {
   std::string contents;
   ResTable target_table;
@@ -145,6 +145,120 @@ TEST_F(AssetManager2Test, FindsResourceFromMultipleApkAssets) {
   EXPECT_EQ(Res_value::TYPE_STRING, value.dataType);
 }
 
+TEST_F(AssetManager2Test, CachesSelectedEntryUntilConfigurationChanges) {
+  ResTable_config desired_config;
+  memset(&desired_config, 0, sizeof(desired_config));
+  desired_config.language[0] = 'd';
+  desired_config.language[1] = 'e';
+
+  AssetManager2 assetmanager;
+  assetmanager.SetConfiguration(desired_config);
+  assetmanager.SetApkAssets({basic_assets_.get(), basic_de_fr_assets_.get()});
+
+  Res_value value;
+  ResTable_config selected_config;
+  uint32_t flags;
+
+  ApkAssetsCookie cookie =
+      assetmanager.GetResource(basic::R::string::test1, false /*may_be_bag*/,
+                               0 /*density_override*/, &value, &selected_config, &flags);
+  ASSERT_EQ(1, cookie);
+  EXPECT_EQ(0u, assetmanager.GetEntryCacheStats().hits);
+  EXPECT_EQ(1u, assetmanager.GetEntryCacheStats().misses);
+
+  cookie = assetmanager.GetResource(basic::R::string::test1, false /*may_be_bag*/,
+                                    0 /*density_override*/, &value, &selected_config, &flags);
+  EXPECT_EQ(1, cookie);
+  EXPECT_EQ('d', selected_config.language[0]);
+  EXPECT_EQ(1u, assetmanager.GetEntryCacheStats().hits);
+
+  // A density override selects against another configuration, and isn't cached.
+  cookie = assetmanager.GetResource(basic::R::string::test1, false /*may_be_bag*/,
+                                    ResTable_config::DENSITY_XHIGH, &value, &selected_config,
+                                    &flags);
+  EXPECT_EQ(1, cookie);
+  EXPECT_EQ(1u, assetmanager.GetEntryCacheStats().hits);
+  EXPECT_EQ(2u, assetmanager.GetEntryCacheStats().misses);
+
+  // The string varies by locale, so changing it must select the entry again.
+  desired_config.language[0] = 'f';
+  desired_config.language[1] = 'r';
+  assetmanager.SetConfiguration(desired_config);
+
+  cookie = assetmanager.GetResource(basic::R::string::test1, false /*may_be_bag*/,
+                                    0 /*density_override*/, &value, &selected_config, &flags);
+  EXPECT_EQ(1, cookie);
+  EXPECT_EQ('f', selected_config.language[0]);
+  EXPECT_EQ('r', selected_config.language[1]);
+  EXPECT_EQ(1u, assetmanager.GetEntryCacheStats().hits);
+  EXPECT_EQ(3u, assetmanager.GetEntryCacheStats().misses);
+}
+
+TEST_F(AssetManager2Test, FilteredConfigurationsSelectLikeAFullScan) {
+  std::unique_ptr<const ApkAssets> hdpi_assets =
+      ApkAssets::Load(GetTestDataPath() + "/basic/basic_hdpi-v4.apk");
+  ASSERT_NE(nullptr, hdpi_assets);
+  std::unique_ptr<const ApkAssets> xhdpi_assets =
+      ApkAssets::Load(GetTestDataPath() + "/basic/basic_xhdpi-v4.apk");
+  ASSERT_NE(nullptr, xhdpi_assets);
+  std::unique_ptr<const ApkAssets> xxhdpi_assets =
+      ApkAssets::Load(GetTestDataPath() + "/basic/basic_xxhdpi-v4.apk");
+  ASSERT_NE(nullptr, xxhdpi_assets);
+  const std::vector<const ApkAssets*> apk_assets = {basic_assets_.get(), hdpi_assets.get(),
+                                                    xhdpi_assets.get(), xxhdpi_assets.get(),
+                                                    basic_de_fr_assets_.get()};
+  const uint32_t resids[] = {basic::R::string::test1, basic::R::string::test2,
+                             basic::R::string::density, basic::R::integer::number1,
+                             basic::R::integer::number2};
+
+  for (uint16_t density : {ResTable_config::DENSITY_MEDIUM, ResTable_config::DENSITY_HIGH,
+                           ResTable_config::DENSITY_XHIGH, ResTable_config::DENSITY_XXHIGH}) {
+    for (const char* language : {"", "de", "fr"}) {
+      ResTable_config desired_config;
+      memset(&desired_config, 0, sizeof(desired_config));
+      memcpy(desired_config.language, language, strlen(language));
+      desired_config.density = density;
+      desired_config.sdkVersion = 28;
+
+      // The filtered configurations are only used when selecting against the configuration
+      // they were built for. A density override makes the other manager scan every type.
+      ResTable_config other_config = desired_config;
+      other_config.density = ResTable_config::DENSITY_LOW;
+
+      AssetManager2 filtered;
+      filtered.SetConfiguration(desired_config);
+      filtered.SetApkAssets(apk_assets);
+      AssetManager2 scanned;
+      scanned.SetConfiguration(other_config);
+      scanned.SetApkAssets(apk_assets);
+
+      for (uint32_t resid : resids) {
+        Res_value filtered_value;
+        ResTable_config filtered_config;
+        uint32_t filtered_flags;
+        ApkAssetsCookie filtered_cookie =
+            filtered.GetResource(resid, false /*may_be_bag*/, 0 /*density_override*/,
+                                 &filtered_value, &filtered_config, &filtered_flags);
+
+        Res_value scanned_value;
+        ResTable_config scanned_config;
+        uint32_t scanned_flags;
+        ApkAssetsCookie scanned_cookie =
+            scanned.GetResource(resid, false /*may_be_bag*/, density, &scanned_value,
+                                &scanned_config, &scanned_flags);
+
+        ASSERT_EQ(scanned_cookie, filtered_cookie) << "density " << density << " language '"
+                                                   << language << "' resource " << resid;
+        if (filtered_cookie != kInvalidCookie) {
+          EXPECT_EQ(0, scanned_config.compare(filtered_config));
+          EXPECT_EQ(scanned_value.dataType, filtered_value.dataType);
+          EXPECT_EQ(scanned_value.data, filtered_value.data);
+        }
+      }
+    }
+  }
+}
+
 TEST_F(AssetManager2Test, FindsResourceFromSharedLibrary) {
   AssetManager2 assetmanager;
 
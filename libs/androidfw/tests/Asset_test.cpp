@@ -16,10 +16,46 @@
 
 #include "androidfw/Asset.h"
 
+#include <string>
+
+#include "android-base/file.h"
+#include "android-base/test_utils.h"
+#include "androidfw/Util.h"
 #include "gtest/gtest.h"
+#include "utils/FileMap.h"
+#include "zlib.h"
 
 namespace android {
 
+static std::string Deflate(const std::string& data) {
+  z_stream stream = {};
+  // Zip entries hold raw deflate data, without the zlib header.
+  if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) !=
+      Z_OK) {
+    return "";
+  }
+  std::string compressed(deflateBound(&stream, data.size()), '\0');
+  stream.next_in = (Bytef*)data.data();
+  stream.avail_in = data.size();
+  stream.next_out = (Bytef*)&compressed[0];
+  stream.avail_out = compressed.size();
+  int result = deflate(&stream, Z_FINISH);
+  compressed.resize(compressed.size() - stream.avail_out);
+  deflateEnd(&stream);
+  return result == Z_STREAM_END ? compressed : "";
+}
+
+static std::unique_ptr<FileMap> MapFile(TemporaryFile& tf, const std::string& data) {
+  if (!base::WriteFully(tf.fd, data.data(), data.size())) {
+    return {};
+  }
+  std::unique_ptr<FileMap> map = util::make_unique<FileMap>();
+  if (!map->create(nullptr, tf.fd, 0, data.size(), true)) {
+    return {};
+  }
+  return map;
+}
+
 TEST(AssetTest, FileAssetRegistersItself) {
   const int32_t count = Asset::getGlobalCount();
   Asset* asset = new _FileAsset();
@@ -36,4 +72,57 @@ TEST(AssetTest, CompressedAssetRegistersItself) {
   EXPECT_EQ(count, Asset::getGlobalCount());
 }
 
+TEST(AssetTest, CompressedAssetReadsDirectlyIntoBuffer) {
+  // Smaller than an inflater chunk, so read() would expand it into a buffer first.
+  std::string expected;
+  for (int i = 0; i < 2000; i++) {
+    expected += std::to_string(i);
+  }
+  std::string compressed = Deflate(expected);
+  ASSERT_FALSE(compressed.empty());
+
+  TemporaryFile tf;
+  std::unique_ptr<FileMap> map = MapFile(tf, compressed);
+  ASSERT_NE(nullptr, map);
+  std::unique_ptr<Asset> asset = Asset::createFromCompressedMap(std::move(map), expected.size(),
+                                                                Asset::ACCESS_STREAMING);
+  ASSERT_NE(nullptr, asset);
+  EXPECT_EQ(nullptr, asset->getMappedBuffer(1));
+
+  std::string actual(expected.size(), '\0');
+  size_t offset = 0;
+  ssize_t count;
+  while ((count = asset->readDirect(&actual[offset], 1000)) > 0) {
+    offset += count;
+  }
+  EXPECT_EQ(0, count);
+  EXPECT_EQ(expected.size(), offset);
+  EXPECT_EQ(expected, actual);
+  EXPECT_FALSE(asset->isAllocated());
+
+  // Seeking back rewinds the inflater.
+  char buf[4];
+  ASSERT_EQ(10, asset->seek(10, SEEK_SET));
+  ASSERT_EQ(4, asset->readDirect(buf, sizeof(buf)));
+  EXPECT_EQ(expected.substr(10, 4), std::string(buf, sizeof(buf)));
+}
+
+TEST(AssetTest, FileAssetMappedBufferIsAligned) {
+  std::string expected(10000, 'a');
+
+  TemporaryFile tf;
+  std::unique_ptr<FileMap> map = MapFile(tf, expected);
+  ASSERT_NE(nullptr, map);
+  std::unique_ptr<Asset> asset =
+      Asset::createFromUncompressedMap(std::move(map), Asset::ACCESS_RANDOM);
+  ASSERT_NE(nullptr, asset);
+
+  // The data starts at the beginning of the file, so it is page aligned.
+  const void* data = asset->getMappedBuffer(4096);
+  ASSERT_NE(nullptr, data);
+  EXPECT_EQ(0u, ((uintptr_t)data) & 4095);
+  EXPECT_EQ(expected, std::string((const char*)data, expected.size()));
+  EXPECT_FALSE(asset->isAllocated());
+}
+
 }  // nameapce android
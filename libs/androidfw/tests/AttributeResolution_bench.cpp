@@ -108,29 +108,8 @@ static void BM_ApplyStyleFramework(benchmark::State& state) {
   device_config.screenHeightDp = 1024;
   device_config.sdkVersion = 27;
 
-  Res_value value;
-  ResTable_config config;
-  uint32_t flags = 0u;
-  ApkAssetsCookie cookie =
-      assetmanager.GetResource(basic::R::layout::layoutt, false /*may_be_bag*/,
-                               0u /*density_override*/, &value, &config, &flags);
-  if (cookie == kInvalidCookie) {
-    state.SkipWithError("failed to find R.layout.layout");
-    return;
-  }
-
-  size_t len = 0u;
-  const char* layout_path =
-      assetmanager.GetStringPoolForCookie(cookie)->string8At(value.data, &len);
-  if (layout_path == nullptr || len == 0u) {
-    state.SkipWithError("failed to lookup layout path");
-    return;
-  }
-
-  std::unique_ptr<Asset> asset = assetmanager.OpenNonAsset(
-      StringPiece(layout_path, len).to_string(), cookie, Asset::ACCESS_BUFFER);
+  std::unique_ptr<Asset> asset = OpenLayout(assetmanager, basic::R::layout::layoutt, state);
   if (asset == nullptr) {
-    state.SkipWithError("failed to load layout");
     return;
   }
 
@@ -147,29 +126,67 @@ static void BM_ApplyStyleFramework(benchmark::State& state) {
   std::unique_ptr<Theme> theme = assetmanager.NewTheme();
   theme->ApplyStyle(Theme_Material_Light);
 
-  std::array<uint32_t, 92> attrs{
-      {0x0101000e, 0x01010034, 0x01010095, 0x01010096, 0x01010097, 0x01010098, 0x01010099,
-       0x0101009a, 0x0101009b, 0x010100ab, 0x010100af, 0x010100b0, 0x010100b1, 0x0101011f,
-       0x01010120, 0x0101013f, 0x01010140, 0x0101014e, 0x0101014f, 0x01010150, 0x01010151,
-       0x01010152, 0x01010153, 0x01010154, 0x01010155, 0x01010156, 0x01010157, 0x01010158,
-       0x01010159, 0x0101015a, 0x0101015b, 0x0101015c, 0x0101015d, 0x0101015e, 0x0101015f,
-       0x01010160, 0x01010161, 0x01010162, 0x01010163, 0x01010164, 0x01010165, 0x01010166,
-       0x01010167, 0x01010168, 0x01010169, 0x0101016a, 0x0101016b, 0x0101016c, 0x0101016d,
-       0x0101016e, 0x0101016f, 0x01010170, 0x01010171, 0x01010217, 0x01010218, 0x0101021d,
-       0x01010220, 0x01010223, 0x01010224, 0x01010264, 0x01010265, 0x01010266, 0x010102c5,
-       0x010102c6, 0x010102c7, 0x01010314, 0x01010315, 0x01010316, 0x0101035e, 0x0101035f,
-       0x01010362, 0x01010374, 0x0101038c, 0x01010392, 0x01010393, 0x010103ac, 0x0101045d,
-       0x010104b6, 0x010104b7, 0x010104d6, 0x010104d7, 0x010104dd, 0x010104de, 0x010104df,
-       0x01010535, 0x01010536, 0x01010537, 0x01010538, 0x01010546, 0x01010567, 0x011100c9,
-       0x011100ca}};
-
-  std::array<uint32_t, attrs.size() * STYLE_NUM_ENTRIES> values;
-  std::array<uint32_t, attrs.size() + 1> indices;
+  std::array<uint32_t, kTextViewAttrs.size() * STYLE_NUM_ENTRIES> values;
+  std::array<uint32_t, kTextViewAttrs.size() + 1> indices;
   while (state.KeepRunning()) {
     ApplyStyle(theme.get(), &xml_tree, 0x01010084u /*def_style_attr*/, 0u /*def_style_res*/,
-               attrs.data(), attrs.size(), values.data(), indices.data());
+               kTextViewAttrs.data(), kTextViewAttrs.size(), values.data(), indices.data());
   }
 }
 BENCHMARK(BM_ApplyStyleFramework);
 
+// Inflates the layout the way a list fills its rows in a new activity: a fresh Material theme,
+// then every view of the layout styled several times against it.
+static void BM_InflateLayoutFramework(benchmark::State& state) {
+  constexpr const static int kRowCount = 8;
+
+  std::unique_ptr<const ApkAssets> framework_apk = ApkAssets::Load(kFrameworkPath);
+  if (framework_apk == nullptr) {
+    state.SkipWithError("failed to load framework assets");
+    return;
+  }
+
+  std::unique_ptr<const ApkAssets> basic_apk =
+      ApkAssets::Load(GetTestDataPath() + "/basic/basic.apk");
+  if (basic_apk == nullptr) {
+    state.SkipWithError("failed to load assets");
+    return;
+  }
+
+  AssetManager2 assetmanager;
+  assetmanager.SetApkAssets({framework_apk.get(), basic_apk.get()});
+
+  std::unique_ptr<Asset> asset = OpenLayout(assetmanager, basic::R::layout::layoutt, state);
+  if (asset == nullptr) {
+    return;
+  }
+
+  ResXMLTree xml_tree;
+  if (xml_tree.setTo(asset->getBuffer(true), asset->getLength(), false /*copyData*/) != NO_ERROR) {
+    state.SkipWithError("corrupt xml layout");
+    return;
+  }
+
+  std::array<uint32_t, kTextViewAttrs.size() * STYLE_NUM_ENTRIES> values;
+  std::array<uint32_t, kTextViewAttrs.size() + 1> indices;
+  while (state.KeepRunning()) {
+    std::unique_ptr<Theme> theme = assetmanager.NewTheme();
+    theme->ApplyStyle(Theme_Material_Light);
+
+    for (int row = 0; row < kRowCount; row++) {
+      xml_tree.restart();
+      ResXMLParser::event_code_t code;
+      while ((code = xml_tree.next()) != ResXMLParser::END_DOCUMENT &&
+             code != ResXMLParser::BAD_DOCUMENT) {
+        if (code == ResXMLParser::START_TAG) {
+          ApplyStyle(theme.get(), &xml_tree, 0x01010084u /*def_style_attr*/,
+                     0u /*def_style_res*/, kTextViewAttrs.data(), kTextViewAttrs.size(),
+                     values.data(), indices.data());
+        }
+      }
+    }
+  }
+}
+BENCHMARK(BM_InflateLayoutFramework);
+
 }  // namespace android
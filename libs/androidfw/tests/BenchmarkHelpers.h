@@ -17,9 +17,12 @@
 #ifndef ANDROIDFW_TESTS_BENCHMARKHELPERS_H
 #define ANDROIDFW_TESTS_BENCHMARKHELPERS_H
 
+#include <array>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "androidfw/AssetManager2.h"
 #include "androidfw/ResourceTypes.h"
 #include "benchmark/benchmark.h"
 
@@ -33,6 +36,13 @@ void GetResourceBenchmarkOld(const std::vector<std::string>& paths, const ResTab
 void GetResourceBenchmark(const std::vector<std::string>& paths, const ResTable_config* config,
                           uint32_t resid, benchmark::State& state);
 
+// The attributes a TextView requests, from View down to TextView.
+extern const std::array<uint32_t, 92> kTextViewAttrs;
+
+// Opens the XML file of the layout `resid`, or skips the benchmark with an error.
+std::unique_ptr<Asset> OpenLayout(const AssetManager2& assetmanager, uint32_t resid,
+                                  benchmark::State& state);
+
 }  // namespace android
 
 #endif  // ANDROIDFW_TESTS_BENCHMARKHELPERS_H
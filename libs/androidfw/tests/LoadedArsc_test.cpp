@@ -24,6 +24,7 @@
 #include "data/libclient/R.h"
 #include "data/sparse/R.h"
 #include "data/styles/R.h"
+#include "data/system/R.h"
 
 namespace app = com::android::app;
 namespace basic = com::android::basic;
@@ -66,6 +67,47 @@ TEST(LoadedArscTest, LoadSinglePackageArsc) {
   ASSERT_THAT(LoadedPackage::GetEntry(type, entry_index), NotNull());
 }
 
+TEST(LoadedArscTest, VerifyTypesLazily) {
+  std::string contents;
+  ASSERT_TRUE(ReadFileFromZipToString(GetTestDataPath() + "/styles/styles.apk", "resources.arsc",
+                                      &contents));
+
+  std::unique_ptr<const LoadedArsc> loaded_arsc = LoadedArsc::Load(StringPiece(contents));
+  ASSERT_THAT(loaded_arsc, NotNull());
+  const TypeSpec* type_spec =
+      loaded_arsc->GetPackageById(get_package_id(app::R::string::string_one))
+          ->GetTypeSpecByTypeIndex(get_type_id(app::R::string::string_one) - 1);
+  ASSERT_THAT(type_spec, NotNull());
+  const size_t type_offset = reinterpret_cast<const char*>(type_spec->types[0]) - contents.data();
+
+  // Make the entries of the type start past its end.
+  std::string corrupt_contents = contents;
+  ResTable_type* corrupt_type = reinterpret_cast<ResTable_type*>(&corrupt_contents[type_offset]);
+  corrupt_type->entriesStart = htodl(dtohl(corrupt_type->header.size) + 4u);
+  EXPECT_THAT(LoadedArsc::Load(StringPiece(corrupt_contents)), IsNull());
+
+  loaded_arsc = LoadedArsc::Load(StringPiece(corrupt_contents), nullptr /*loaded_idmap*/,
+                                 false /*system*/, false /*load_as_shared_library*/,
+                                 true /*verify_lazily*/);
+  ASSERT_THAT(loaded_arsc, NotNull());
+  const LoadedPackage* package =
+      loaded_arsc->GetPackageById(get_package_id(app::R::string::string_one));
+  ASSERT_THAT(package, NotNull());
+  type_spec = package->GetTypeSpecByTypeIndex(get_type_id(app::R::string::string_one) - 1);
+  ASSERT_THAT(type_spec, NotNull());
+  EXPECT_FALSE(type_spec->IsTypeValid(0));
+  // The result is remembered.
+  EXPECT_THAT(type_spec->type_states()[0].load(), Eq(TypeSpec::kTypeInvalid));
+  EXPECT_FALSE(type_spec->IsTypeValid(0));
+
+  // Other types are still usable.
+  type_spec = package->GetTypeSpecByTypeIndex(get_type_id(app::R::style::StyleOne) - 1);
+  ASSERT_THAT(type_spec, NotNull());
+  EXPECT_THAT(type_spec->type_states()[0].load(), Eq(TypeSpec::kTypeUnverified));
+  EXPECT_TRUE(type_spec->IsTypeValid(0));
+  EXPECT_THAT(type_spec->type_states()[0].load(), Eq(TypeSpec::kTypeValid));
+}
+
 TEST(LoadedArscTest, LoadSparseEntryApp) {
   std::string contents;
   ASSERT_TRUE(ReadFileFromZipToString(GetTestDataPath() + "/sparse/sparse.apk", "resources.arsc",
@@ -90,6 +132,28 @@ TEST(LoadedArscTest, LoadSparseEntryApp) {
   ASSERT_THAT(LoadedPackage::GetEntry(type, entry_index), NotNull());
 }
 
+TEST(LoadedArscTest, FindSparseEntryByName) {
+  std::string contents;
+  ASSERT_TRUE(ReadFileFromZipToString(GetTestDataPath() + "/sparse/sparse.apk", "resources.arsc",
+                                      &contents));
+
+  std::unique_ptr<const LoadedArsc> loaded_arsc = LoadedArsc::Load(StringPiece(contents));
+  ASSERT_THAT(loaded_arsc, NotNull());
+
+  const LoadedPackage* package =
+      loaded_arsc->GetPackageById(get_package_id(sparse::R::string::foo_999));
+  ASSERT_THAT(package, NotNull());
+
+  // foo_999 is defined in the dense default configuration and the sparse v26 one.
+  const uint32_t resid = sparse::R::string::foo_999 & 0x00ffffffu;
+  EXPECT_THAT(package->FindEntryByName(u"string", u"foo_999"), Eq(resid));
+  EXPECT_THAT(package->FindEntryByName(u"string", u"foo_998"), Eq(resid - 1u));
+
+  // Looked up again through the index built by the first lookup.
+  EXPECT_THAT(package->FindEntryByName(u"string", u"foo_999"), Eq(resid));
+  EXPECT_THAT(package->FindEntryByName(u"string", u"bar"), Eq(0u));
+}
+
 TEST(LoadedArscTest, LoadSharedLibrary) {
   std::string contents;
   ASSERT_TRUE(ReadFileFromZipToString(GetTestDataPath() + "/lib_one/lib_one.apk", "resources.arsc",
@@ -151,6 +215,33 @@ TEST(LoadedArscTest, LoadAppAsSharedLibrary) {
   EXPECT_THAT(packages[0]->GetPackageId(), Eq(0x7f));
 }
 
+TEST(LoadedArscTest, LoadSystemTable) {
+  std::string contents;
+  ASSERT_TRUE(ReadFileFromZipToString(GetTestDataPath() + "/system/system.apk", "resources.arsc",
+                                      &contents));
+
+  // System tables have their TypeSpecs moved to a read-only mapping, which must still be usable
+  // and released cleanly.
+  std::unique_ptr<const LoadedArsc> loaded_arsc =
+      LoadedArsc::Load(StringPiece(contents), nullptr /*loaded_idmap*/, true /*system*/);
+  ASSERT_THAT(loaded_arsc, NotNull());
+
+  const LoadedPackage* package = loaded_arsc->GetPackageById(get_package_id(R::integer::number));
+  ASSERT_THAT(package, NotNull());
+  EXPECT_TRUE(package->IsSystem());
+
+  const TypeSpec* type_spec =
+      package->GetTypeSpecByTypeIndex(get_type_id(R::integer::number) - 1);
+  ASSERT_THAT(type_spec, NotNull());
+  ASSERT_THAT(type_spec->type_count, Ge(1u));
+  EXPECT_TRUE(type_spec->IsTypeValid(0));
+  EXPECT_THAT(LoadedPackage::GetEntry(type_spec->types[0], get_entry_id(R::integer::number)),
+              NotNull());
+
+  EXPECT_THAT(package->FindEntryByName(u"integer", u"number"),
+              Eq(R::integer::number & 0x00ffffffu));
+}
+
 TEST(LoadedArscTest, LoadFeatureSplit) {
   std::string contents;
   ASSERT_TRUE(ReadFileFromZipToString(GetTestDataPath() + "/feature/feature.apk", "resources.arsc",
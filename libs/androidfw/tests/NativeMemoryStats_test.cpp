@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "androidfw/NativeMemoryStats.h"
+
+#include "androidfw/ApkAssets.h"
+#include "androidfw/AssetManager2.h"
+
+#include "TestHelpers.h"
+#include "data/basic/R.h"
+
+namespace basic = com::android::basic;
+
+namespace android {
+
+TEST(NativeMemoryStatsTest, AddsAndRemovesUsage) {
+  const NativeMemoryStats::Usage before = NativeMemoryStats::Get(NativeMemoryCategory::kBitmaps);
+
+  NativeMemoryStats::Add(NativeMemoryCategory::kBitmaps, 100);
+  NativeMemoryStats::Add(NativeMemoryCategory::kBitmaps, 50);
+  NativeMemoryStats::Usage usage = NativeMemoryStats::Get(NativeMemoryCategory::kBitmaps);
+  EXPECT_EQ(before.bytes + 150, usage.bytes);
+  EXPECT_EQ(before.objects + 2, usage.objects);
+
+  NativeMemoryStats::Remove(NativeMemoryCategory::kBitmaps, 100);
+  NativeMemoryStats::Remove(NativeMemoryCategory::kBitmaps, 50);
+  usage = NativeMemoryStats::Get(NativeMemoryCategory::kBitmaps);
+  EXPECT_EQ(before.bytes, usage.bytes);
+  EXPECT_EQ(before.objects, usage.objects);
+}
+
+TEST(NativeMemoryStatsTest, NamesEveryCategory) {
+  for (int i = 0; i < static_cast<int>(NativeMemoryCategory::kCount); i++) {
+    EXPECT_NE(nullptr, NativeMemoryStats::GetName(static_cast<NativeMemoryCategory>(i)));
+  }
+}
+
+TEST(NativeMemoryStatsTest, AccountsForCachedBags) {
+  std::unique_ptr<const ApkAssets> basic_assets =
+      ApkAssets::Load(GetTestDataPath() + "/basic/basic.apk");
+  ASSERT_NE(nullptr, basic_assets);
+  const NativeMemoryStats::Usage before =
+      NativeMemoryStats::Get(NativeMemoryCategory::kResourceBags);
+
+  {
+    AssetManager2 assetmanager;
+    assetmanager.SetApkAssets({basic_assets.get()});
+    const ResolvedBag* bag = assetmanager.GetBag(basic::R::array::integerArray1);
+    ASSERT_NE(nullptr, bag);
+
+    const NativeMemoryStats::Usage usage =
+        NativeMemoryStats::Get(NativeMemoryCategory::kResourceBags);
+    EXPECT_EQ(before.objects + 1, usage.objects);
+    EXPECT_EQ(before.bytes + static_cast<int64_t>(sizeof(ResolvedBag) +
+                                                  bag->entry_count * sizeof(ResolvedBag::Entry)),
+              usage.bytes);
+  }
+
+  const NativeMemoryStats::Usage after =
+      NativeMemoryStats::Get(NativeMemoryCategory::kResourceBags);
+  EXPECT_EQ(before.bytes, after.bytes);
+  EXPECT_EQ(before.objects, after.objects);
+}
+
+}  // namespace android
@@ -97,4 +97,28 @@ TEST_F(ObbFileTest, WriteThenRead) {
             << "salts should be the same";
 }
 
+TEST_F(ObbFileTest, ReadCached) {
+    mObbFile->setPackageName(String8("com.example.obbfile"));
+    mObbFile->setVersion(1);
+    ASSERT_TRUE(mObbFile->writeTo(mFileName.string()));
+
+    sp<ObbFile> cached = ObbFile::readCached(mFileName.string());
+    ASSERT_TRUE(cached != NULL);
+    EXPECT_EQ(1, cached->getVersion());
+    EXPECT_EQ(cached, ObbFile::readCached(mFileName.string()))
+            << "unchanged file should come from the cache";
+
+    // A new footer changes the size of the file
+    ASSERT_TRUE(mObbFile->removeFrom(mFileName.string()));
+    mObbFile->setPackageName(String8("com.example.obbfile.other"));
+    mObbFile->setVersion(2);
+    ASSERT_TRUE(mObbFile->writeTo(mFileName.string()));
+
+    sp<ObbFile> updated = ObbFile::readCached(mFileName.string());
+    ASSERT_TRUE(updated != NULL);
+    EXPECT_NE(cached, updated);
+    EXPECT_EQ(2, updated->getVersion());
+    EXPECT_STREQ("com.example.obbfile.other", updated->getPackageName().string());
+}
+
 }
@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// End to end benchmarks of the resource lookups done while an app inflates its UI, with
+// framework-res.apk and an app APK loaded together, under several device configurations.
+// Each benchmark takes the index of a configuration in kConfigurations as its argument and is
+// labeled with its name. For machine-readable results, run with
+//   --benchmark_format=json or --benchmark_out=<file> --benchmark_out_format=json
+
+#include "benchmark/benchmark.h"
+
+#include "androidfw/ApkAssets.h"
+#include "androidfw/AssetManager.h"
+#include "androidfw/AssetManager2.h"
+#include "androidfw/AttributeResolution.h"
+#include "androidfw/ResourceTypes.h"
+
+#include "BenchmarkHelpers.h"
+#include "data/basic/R.h"
+
+namespace basic = com::android::basic;
+
+namespace android {
+
+constexpr const static char* kFrameworkPath = "/system/framework/framework-res.apk";
+constexpr const static uint32_t kStringOkId = 0x0104000au;  // android:string/ok
+constexpr const static uint32_t kTextViewStyleAttr = 0x01010084u;  // android:attr/textViewStyle
+
+// android:style/Theme.Material.Light
+constexpr const static uint32_t kThemeMaterialLight = 0x01030237u;
+
+struct NamedConfiguration {
+  const char* name;
+  ResTable_config config;
+};
+
+static std::vector<NamedConfiguration> MakeConfigurations() {
+  ResTable_config phone;
+  memset(&phone, 0, sizeof(phone));
+  memcpy(phone.language, "en", 2);
+  memcpy(phone.country, "US", 2);
+  phone.orientation = ResTable_config::ORIENTATION_PORT;
+  phone.density = ResTable_config::DENSITY_XXHIGH;
+  phone.smallestScreenWidthDp = 411;
+  phone.screenWidthDp = 411;
+  phone.screenHeightDp = 731;
+  phone.sdkVersion = 27;
+
+  ResTable_config tablet_land = phone;
+  memcpy(tablet_land.language, "fr", 2);
+  memcpy(tablet_land.country, "FR", 2);
+  tablet_land.orientation = ResTable_config::ORIENTATION_LAND;
+  tablet_land.density = ResTable_config::DENSITY_XHIGH;
+  tablet_land.smallestScreenWidthDp = 800;
+  tablet_land.screenWidthDp = 1280;
+  tablet_land.screenHeightDp = 800;
+
+  ResTable_config night_rtl = phone;
+  memcpy(night_rtl.language, "ar", 2);
+  memcpy(night_rtl.country, "EG", 2);
+  night_rtl.screenLayout = ResTable_config::LAYOUTDIR_RTL;
+  night_rtl.uiMode = ResTable_config::UI_MODE_NIGHT_YES;
+
+  ResTable_config empty;
+  memset(&empty, 0, sizeof(empty));
+  return {{"default", empty}, {"phone", phone}, {"tablet_land", tablet_land},
+          {"night_rtl", night_rtl}};
+}
+
+static const std::vector<NamedConfiguration> kConfigurations = MakeConfigurations();
+
+// Runs the benchmark once per configuration.
+static void ForEachConfiguration(benchmark::internal::Benchmark* b) {
+  b->DenseRange(0, static_cast<int>(kConfigurations.size()) - 1);
+}
+
+// An AssetManager2 holding framework-res.apk and the basic app, set to the configuration of the
+// benchmark.
+struct LookupAssets {
+  std::unique_ptr<const ApkAssets> framework;
+  std::unique_ptr<const ApkAssets> app;
+  AssetManager2 assetmanager;
+
+  bool Load(benchmark::State& state) {
+    framework = ApkAssets::Load(kFrameworkPath, true /*system*/);
+    app = ApkAssets::Load(GetTestDataPath() + "/basic/basic.apk");
+    if (framework == nullptr || app == nullptr) {
+      state.SkipWithError("Failed to load assets");
+      return false;
+    }
+    assetmanager.SetApkAssets({framework.get(), app.get()});
+
+    const NamedConfiguration& config = kConfigurations[state.range(0)];
+    assetmanager.SetConfiguration(config.config);
+    state.SetLabel(config.name);
+    return true;
+  }
+};
+
+// The same, for the legacy AssetManager and its ResTable.
+struct LookupAssetsOld {
+  AssetManager assetmanager;
+
+  const ResTable* Load(benchmark::State& state) {
+    if (!assetmanager.addAssetPath(String8(kFrameworkPath), nullptr /*cookie*/,
+                                   false /*appAsLib*/, true /*isSystemAsset*/) ||
+        !assetmanager.addAssetPath(String8((GetTestDataPath() + "/basic/basic.apk").data()),
+                                   nullptr /*cookie*/, false /*appAsLib*/,
+                                   false /*isSystemAsset*/)) {
+      state.SkipWithError("Failed to load assets");
+      return nullptr;
+    }
+
+    // Force creation of the ResTable first, or else the configuration doesn't get set.
+    const ResTable& table = assetmanager.getResources(true);
+    const NamedConfiguration& config = kConfigurations[state.range(0)];
+    assetmanager.setConfiguration(config.config);
+    state.SetLabel(config.name);
+    return &table;
+  }
+};
+
+static void BM_LookupGetResource(benchmark::State& state) {
+  LookupAssets assets;
+  if (!assets.Load(state)) {
+    return;
+  }
+
+  Res_value value;
+  ResTable_config selected_config;
+  uint32_t flags;
+  while (state.KeepRunning()) {
+    ApkAssetsCookie cookie = assets.assetmanager.GetResource(
+        kStringOkId, false /*may_be_bag*/, 0u /*density_override*/, &value, &selected_config,
+        &flags);
+    benchmark::DoNotOptimize(cookie);
+    cookie = assets.assetmanager.GetResource(basic::R::string::test1, false /*may_be_bag*/,
+                                             0u /*density_override*/, &value, &selected_config,
+                                             &flags);
+    benchmark::DoNotOptimize(cookie);
+  }
+}
+BENCHMARK(BM_LookupGetResource)->Apply(ForEachConfiguration);
+
+static void BM_LookupGetResourceOld(benchmark::State& state) {
+  LookupAssetsOld assets;
+  const ResTable* table = assets.Load(state);
+  if (table == nullptr) {
+    return;
+  }
+
+  Res_value value;
+  ResTable_config selected_config;
+  uint32_t flags;
+  while (state.KeepRunning()) {
+    ssize_t block = table->getResource(kStringOkId, &value, false /*may_be_bag*/, 0u /*density*/,
+                                       &flags, &selected_config);
+    benchmark::DoNotOptimize(block);
+    block = table->getResource(basic::R::string::test1, &value, false /*may_be_bag*/,
+                               0u /*density*/, &flags, &selected_config);
+    benchmark::DoNotOptimize(block);
+  }
+}
+BENCHMARK(BM_LookupGetResourceOld)->Apply(ForEachConfiguration);
+
+static void BM_LookupResolveReference(benchmark::State& state) {
+  LookupAssets assets;
+  if (!assets.Load(state)) {
+    return;
+  }
+
+  Res_value value;
+  ResTable_config selected_config;
+  uint32_t flags;
+  uint32_t last_id = 0u;
+  while (state.KeepRunning()) {
+    ApkAssetsCookie cookie = assets.assetmanager.GetResource(
+        basic::R::integer::deep_ref, false /*may_be_bag*/, 0u /*density_override*/, &value,
+        &selected_config, &flags);
+    cookie = assets.assetmanager.ResolveReference(cookie, &value, &selected_config, &flags,
+                                                  &last_id);
+    benchmark::DoNotOptimize(cookie);
+  }
+}
+BENCHMARK(BM_LookupResolveReference)->Apply(ForEachConfiguration);
+
+static void BM_LookupResolveReferenceOld(benchmark::State& state) {
+  LookupAssetsOld assets;
+  const ResTable* table = assets.Load(state);
+  if (table == nullptr) {
+    return;
+  }
+
+  Res_value value;
+  ResTable_config selected_config;
+  uint32_t flags;
+  uint32_t last_ref = 0u;
+  while (state.KeepRunning()) {
+    ssize_t block = table->getResource(basic::R::integer::deep_ref, &value, false /*may_be_bag*/,
+                                       0u /*density*/, &flags, &selected_config);
+    block = table->resolveReference(&value, block, &last_ref, &flags, &selected_config);
+    benchmark::DoNotOptimize(block);
+  }
+}
+BENCHMARK(BM_LookupResolveReferenceOld)->Apply(ForEachConfiguration);
+
+static void BM_LookupGetBag(benchmark::State& state) {
+  LookupAssets assets;
+  if (!assets.Load(state)) {
+    return;
+  }
+
+  while (state.KeepRunning()) {
+    const ResolvedBag* bag = assets.assetmanager.GetBag(kThemeMaterialLight);
+    const auto bag_end = end(bag);
+    for (auto iter = begin(bag); iter != bag_end; ++iter) {
+      uint32_t key = iter->key;
+      Res_value value = iter->value;
+      benchmark::DoNotOptimize(key);
+      benchmark::DoNotOptimize(value);
+    }
+  }
+}
+BENCHMARK(BM_LookupGetBag)->Apply(ForEachConfiguration);
+
+static void BM_LookupGetBagOld(benchmark::State& state) {
+  LookupAssetsOld assets;
+  const ResTable* table = assets.Load(state);
+  if (table == nullptr) {
+    return;
+  }
+
+  while (state.KeepRunning()) {
+    const ResTable::bag_entry* bag_begin;
+    const ssize_t N = table->lockBag(kThemeMaterialLight, &bag_begin);
+    const ResTable::bag_entry* const bag_end = bag_begin + N;
+    for (auto iter = bag_begin; iter != bag_end; ++iter) {
+      uint32_t key = iter->map.name.ident;
+      Res_value value = iter->map.value;
+      benchmark::DoNotOptimize(key);
+      benchmark::DoNotOptimize(value);
+    }
+    table->unlockBag(bag_begin);
+  }
+}
+BENCHMARK(BM_LookupGetBagOld)->Apply(ForEachConfiguration);
+
+static void BM_LookupThemeApplyStyle(benchmark::State& state) {
+  LookupAssets assets;
+  if (!assets.Load(state)) {
+    return;
+  }
+
+  while (state.KeepRunning()) {
+    std::unique_ptr<Theme> theme = assets.assetmanager.NewTheme();
+    theme->ApplyStyle(kThemeMaterialLight, false /*force*/);
+  }
+}
+BENCHMARK(BM_LookupThemeApplyStyle)->Apply(ForEachConfiguration);
+
+static void BM_LookupThemeApplyStyleOld(benchmark::State& state) {
+  LookupAssetsOld assets;
+  const ResTable* table = assets.Load(state);
+  if (table == nullptr) {
+    return;
+  }
+
+  while (state.KeepRunning()) {
+    std::unique_ptr<ResTable::Theme> theme{new ResTable::Theme(*table)};
+    theme->applyStyle(kThemeMaterialLight, false /*force*/);
+  }
+}
+BENCHMARK(BM_LookupThemeApplyStyleOld)->Apply(ForEachConfiguration);
+
+// Styles the first view of the app layout as a TextView against the Material theme.
+static void BM_LookupAttributeResolutionApplyStyle(benchmark::State& state) {
+  LookupAssets assets;
+  if (!assets.Load(state)) {
+    return;
+  }
+
+  std::unique_ptr<Asset> asset = OpenLayout(assets.assetmanager, basic::R::layout::layoutt, state);
+  if (asset == nullptr) {
+    return;
+  }
+
+  ResXMLTree xml_tree;
+  if (xml_tree.setTo(asset->getBuffer(true), asset->getLength(), false /*copyData*/) != NO_ERROR) {
+    state.SkipWithError("corrupt xml layout");
+    return;
+  }
+
+  // Skip to the first tag.
+  while (xml_tree.next() != ResXMLParser::START_TAG) {
+  }
+
+  std::unique_ptr<Theme> theme = assets.assetmanager.NewTheme();
+  theme->ApplyStyle(kThemeMaterialLight);
+
+  std::array<uint32_t, kTextViewAttrs.size() * STYLE_NUM_ENTRIES> values;
+  std::array<uint32_t, kTextViewAttrs.size() + 1> indices;
+  while (state.KeepRunning()) {
+    ApplyStyle(theme.get(), &xml_tree, kTextViewStyleAttr, 0u /*def_style_res*/,
+               kTextViewAttrs.data(), kTextViewAttrs.size(), values.data(), indices.data());
+  }
+}
+BENCHMARK(BM_LookupAttributeResolutionApplyStyle)->Apply(ForEachConfiguration);
+
+}  // namespace android
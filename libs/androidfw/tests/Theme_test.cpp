@@ -208,6 +208,48 @@ TEST_F(ThemeTest, MultipleThemesOverlaidForced) {
   EXPECT_EQ(static_cast<uint32_t>(ResTable_typeSpec::SPEC_PUBLIC), flags);
 }
 
+TEST_F(ThemeTest, ResolveAttributeUntilThemeChanges) {
+  AssetManager2 assetmanager;
+  assetmanager.SetApkAssets({style_assets_.get()});
+
+  std::unique_ptr<Theme> theme = assetmanager.NewTheme();
+  ASSERT_TRUE(theme->ApplyStyle(app::R::style::StyleTwo));
+
+  // attr_five is a reference to a string, resolving it twice must give the same results.
+  for (int i = 0; i < 2; i++) {
+    Res_value value;
+    ResTable_config config;
+    uint32_t flags = 0u;
+    uint32_t last_ref = 0u;
+    ApkAssetsCookie cookie =
+        theme->ResolveAttribute(app::R::attr::attr_five, &value, &config, &flags, &last_ref);
+    ASSERT_NE(kInvalidCookie, cookie);
+    EXPECT_EQ(Res_value::TYPE_STRING, value.dataType);
+    EXPECT_EQ(app::R::string::string_one, last_ref);
+    EXPECT_EQ(static_cast<uint32_t>(ResTable_typeSpec::SPEC_PUBLIC), flags);
+  }
+
+  Res_value value;
+  ResTable_config config;
+  uint32_t flags = 0u;
+  uint32_t last_ref = 0u;
+  EXPECT_EQ(kInvalidCookie,
+            theme->ResolveAttribute(app::R::attr::attr_six, &value, &config, &flags, &last_ref));
+
+  // Applying a style must drop what was resolved before.
+  ASSERT_TRUE(theme->ApplyStyle(app::R::style::StyleThree, true /* force */));
+
+  ASSERT_NE(kInvalidCookie,
+            theme->ResolveAttribute(app::R::attr::attr_five, &value, &config, &flags, &last_ref));
+  EXPECT_EQ(Res_value::TYPE_INT_DEC, value.dataType);
+  EXPECT_EQ(5u, value.data);
+
+  ASSERT_NE(kInvalidCookie,
+            theme->ResolveAttribute(app::R::attr::attr_six, &value, &config, &flags, &last_ref));
+  EXPECT_EQ(Res_value::TYPE_INT_DEC, value.dataType);
+  EXPECT_EQ(6u, value.data);
+}
+
 TEST_F(ThemeTest, ResolveDynamicAttributesAndReferencesToSharedLibrary) {
   AssetManager2 assetmanager;
   assetmanager.SetApkAssets(
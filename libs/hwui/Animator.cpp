@@ -255,6 +255,26 @@ bool BaseRenderNodeAnimator::animate(AnimationContext& context) {
     // is called.
     nsecs_t currentPlayTime = context.frameTimeMs() - mStartTime;
     bool finished = updatePlayTime(currentPlayTime);
+    return onFrameAnimated(context, finished);
+}
+
+bool BaseRenderNodeAnimator::prepareBatchedAnimate(AnimationContext& context, float* outFraction) {
+    // Finished and delayed animators are rare, leave them to animate()
+    nsecs_t currentPlayTime = context.frameTimeMs() - mStartTime;
+    if (!isRunning() || currentPlayTime < 0) {
+        return false;
+    }
+    return computeFraction(currentPlayTime, outFraction);
+}
+
+bool BaseRenderNodeAnimator::finishBatchedAnimate(AnimationContext& context,
+                                                  float interpolatedFraction) {
+    setValue(mTarget, mFromValue + (mDeltaValue * interpolatedFraction));
+    bool finished = context.frameTimeMs() - mStartTime >= mDuration;
+    return onFrameAnimated(context, finished);
+}
+
+bool BaseRenderNodeAnimator::onFrameAnimated(AnimationContext& context, bool finished) {
     if (finished && mPlayState != PlayState::Finished) {
         mPlayState = PlayState::Finished;
         callOnFinishedListener(context);
@@ -263,6 +283,18 @@ bool BaseRenderNodeAnimator::animate(AnimationContext& context) {
 }
 
 bool BaseRenderNodeAnimator::updatePlayTime(nsecs_t playTime) {
+    float fraction;
+    if (!computeFraction(playTime, &fraction)) {
+        return false;
+    }
+    fraction = mInterpolator->interpolate(fraction);
+    setValue(mTarget, mFromValue + (mDeltaValue * fraction));
+
+    return playTime >= mDuration;
+}
+
+// Returns false if the animation is still delayed, in which case the start value is set
+bool BaseRenderNodeAnimator::computeFraction(nsecs_t playTime, float* outFraction) {
     mPlayTime = mPlayState == PlayState::Reversing ? mDuration - playTime : playTime;
     onPlayTimeChanged(mPlayTime);
     // If BaseRenderNodeAnimator is handling the delay (not typical), then
@@ -278,12 +310,8 @@ bool BaseRenderNodeAnimator::updatePlayTime(nsecs_t playTime) {
     if ((mPlayState == PlayState::Running || mPlayState == PlayState::Reversing) && mDuration > 0) {
         fraction = mPlayTime / (float)mDuration;
     }
-    fraction = MathUtils::clamp(fraction, 0.0f, 1.0f);
-
-    fraction = mInterpolator->interpolate(fraction);
-    setValue(mTarget, mFromValue + (mDeltaValue * fraction));
-
-    return playTime >= mDuration;
+    *outFraction = MathUtils::clamp(fraction, 0.0f, 1.0f);
+    return true;
 }
 
 nsecs_t BaseRenderNodeAnimator::getRemainingPlayTime() {
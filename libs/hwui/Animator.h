@@ -80,6 +80,13 @@ public:
     ANDROID_API void pushStaging(AnimationContext& context);
     ANDROID_API bool animate(AnimationContext& context);
 
+    // Split animate() used by AnimatorManager to interpolate the fractions of many animators in
+    // one batch. If prepareBatchedAnimate returns false the animator must be animated with
+    // animate(), otherwise finishBatchedAnimate must be called with the interpolated fraction.
+    bool prepareBatchedAnimate(AnimationContext& context, float* outFraction);
+    bool finishBatchedAnimate(AnimationContext& context, float interpolatedFraction);
+    Interpolator* interpolator() { return mInterpolator.get(); }
+
     // Returns the remaining time in ms for the animation. Note this should only be called during
     // an animation on RenderThread.
     ANDROID_API nsecs_t getRemainingPlayTime();
@@ -173,6 +180,8 @@ private:
     virtual void transitionToRunning(AnimationContext& context);
     void doSetStartValue(float value);
     bool updatePlayTime(nsecs_t playTime);
+    bool computeFraction(nsecs_t playTime, float* outFraction);
+    bool onFrameAnimated(AnimationContext& context, bool finished);
     void resolveStagingRequest(Request request);
 
     std::vector<Request> mStagingRequests;
@@ -20,6 +20,7 @@
 #include "AnimationContext.h"
 #include "Animator.h"
 #include "DamageAccumulator.h"
+#include "Interpolator.h"
 #include "RenderNode.h"
 
 namespace android {
@@ -78,46 +79,45 @@ void AnimatorManager::pushStaging() {
         for (auto& anim : mNewAnimators) {
             if (anim->target() != &mParent) {
                 mAnimators.push_back(std::move(anim));
+                mBatchesDirty = true;
             }
         }
         mNewAnimators.clear();
     }
     for (auto& animator : mAnimators) {
+        // The default interpolator is set when the animator is started
+        Interpolator* interpolator = animator->interpolator();
         animator->pushStaging(mAnimationHandle->context());
+        if (interpolator != animator->interpolator()) {
+            mBatchesDirty = true;
+        }
     }
 }
 
 void AnimatorManager::onAnimatorTargetChanged(BaseRenderNodeAnimator* animator) {
     LOG_ALWAYS_FATAL_IF(animator->target() == &mParent, "Target has not been changed");
     mAnimators.erase(std::remove(mAnimators.begin(), mAnimators.end(), animator), mAnimators.end());
+    mBatchesDirty = true;
 }
 
-class AnimateFunctor {
-public:
-    AnimateFunctor(TreeInfo& info, AnimationContext& context, uint32_t* outDirtyMask)
-            : mInfo(info), mContext(context), mDirtyMask(outDirtyMask) {}
-
-    bool operator()(sp<BaseRenderNodeAnimator>& animator) {
-        *mDirtyMask |= animator->dirtyMask();
-        bool remove = animator->animate(mContext);
-        if (remove) {
-            animator->detach();
-        } else {
-            if (animator->isRunning()) {
-                mInfo.out.hasAnimations = true;
-            }
-            if (CC_UNLIKELY(!animator->mayRunAsync())) {
-                mInfo.out.requiresUiRedraw = true;
+void AnimatorManager::updateBatches() {
+    mBatchEnds.clear();
+    Interpolator* batchInterpolator = nullptr;
+    for (size_t i = 0; i < mAnimators.size(); i++) {
+        Interpolator* interpolator = mAnimators[i]->interpolator();
+        if (i == 0 || !interpolator || !batchInterpolator ||
+            !interpolator->isEquivalent(*batchInterpolator)) {
+            if (i > 0) {
+                mBatchEnds.push_back(i);
             }
+            batchInterpolator = interpolator;
         }
-        return remove;
     }
-
-private:
-    TreeInfo& mInfo;
-    AnimationContext& mContext;
-    uint32_t* mDirtyMask;
-};
+    if (!mAnimators.empty()) {
+        mBatchEnds.push_back(mAnimators.size());
+    }
+    mBatchesDirty = false;
+}
 
 uint32_t AnimatorManager::animate(TreeInfo& info) {
     if (!mAnimators.size()) return 0;
@@ -141,10 +141,56 @@ void AnimatorManager::animateNoDamage(TreeInfo& info) {
 }
 
 uint32_t AnimatorManager::animateCommon(TreeInfo& info) {
+    AnimationContext& context = mAnimationHandle->context();
+    if (mBatchesDirty) {
+        updateBatches();
+    }
+    const size_t count = mAnimators.size();
+    mFractions.resize(count);
+    mBatched.resize(count);
+
+    // Compute the fractions of all the running animators, then interpolate them batch by batch
+    for (size_t i = 0; i < count; i++) {
+        mBatched[i] = mAnimators[i]->prepareBatchedAnimate(context, &mFractions[i]);
+        if (!mBatched[i]) {
+            mFractions[i] = 0;
+        }
+    }
+    size_t batchStart = 0;
+    for (size_t batchEnd : mBatchEnds) {
+        Interpolator* interpolator = mAnimators[batchStart]->interpolator();
+        if (interpolator) {
+            interpolator->batchInterpolate(&mFractions[batchStart], batchEnd - batchStart);
+        }
+        batchStart = batchEnd;
+    }
+
     uint32_t dirtyMask = 0;
-    AnimateFunctor functor(info, mAnimationHandle->context(), &dirtyMask);
-    auto newEnd = std::remove_if(mAnimators.begin(), mAnimators.end(), functor);
-    mAnimators.erase(newEnd, mAnimators.end());
+    size_t keptCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        sp<BaseRenderNodeAnimator>& animator = mAnimators[i];
+        dirtyMask |= animator->dirtyMask();
+        bool remove = mBatched[i] ? animator->finishBatchedAnimate(context, mFractions[i])
+                                  : animator->animate(context);
+        if (remove) {
+            animator->detach();
+            continue;
+        }
+        if (animator->isRunning()) {
+            info.out.hasAnimations = true;
+        }
+        if (CC_UNLIKELY(!animator->mayRunAsync())) {
+            info.out.requiresUiRedraw = true;
+        }
+        if (keptCount != i) {
+            mAnimators[keptCount] = std::move(animator);
+        }
+        keptCount++;
+    }
+    if (keptCount != count) {
+        mAnimators.erase(mAnimators.begin() + keptCount, mAnimators.end());
+        mBatchesDirty = true;
+    }
     mAnimationHandle->notifyAnimationsRan();
     mParent.mProperties.updateMatrix();
     return dirtyMask;
@@ -181,6 +227,7 @@ void AnimatorManager::endAllActiveAnimators() {
     EndActiveAnimatorsFunctor functor(mAnimationHandle->context());
     for_each(mAnimators.begin(), mAnimators.end(), functor);
     mAnimators.clear();
+    mBatchesDirty = true;
     mAnimationHandle->release();
 }
 
@@ -64,6 +64,7 @@ public:
 
 private:
     uint32_t animateCommon(TreeInfo& info);
+    void updateBatches();
 
     RenderNode& mParent;
     AnimationHandle* mAnimationHandle;
@@ -71,6 +72,15 @@ private:
     // To improve the efficiency of resizing & removing from the vector
     std::vector<sp<BaseRenderNodeAnimator> > mNewAnimators;
     std::vector<sp<BaseRenderNodeAnimator> > mAnimators;
+
+    // Animators are run in batches of consecutive animators with equivalent interpolators, so
+    // that each batch is interpolated by a single call. "mBatchEnds" holds the end index of each
+    // batch, it is updated when the animators or their interpolators change. "mFractions" and
+    // "mBatched" are indexed like "mAnimators" and kept to avoid allocating on every frame.
+    std::vector<size_t> mBatchEnds;
+    std::vector<float> mFractions;
+    std::vector<uint8_t> mBatched;
+    bool mBatchesDirty = true;
 };
 
 } /* namespace uirenderer */
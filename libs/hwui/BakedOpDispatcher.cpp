@@ -397,16 +397,11 @@ void BakedOpDispatcher::onArcOp(BakedOpRenderer& renderer, const ArcOp& op,
                               *texture, *(op.paint));
         }
     } else {
-        SkRect rect = getBoundsOfFill(op);
-        SkPath path;
-        if (op.useCenter) {
-            path.moveTo(rect.centerX(), rect.centerY());
-        }
-        path.arcTo(rect, op.startAngle, op.sweepAngle, !op.useCenter);
-        if (op.useCenter) {
-            path.close();
-        }
-        renderConvexPath(renderer, state, path, *(op.paint));
+        const VertexBuffer* buffer = renderer.caches().tessellationCache.getArc(
+                state.computedState.transform, *(op.paint), op.unmappedBounds.getWidth(),
+                op.unmappedBounds.getHeight(), op.startAngle, op.sweepAngle);
+        renderVertexBuffer(renderer, state, *buffer, op.unmappedBounds.left, op.unmappedBounds.top,
+                           *(op.paint), 0);
     }
 }
 
@@ -565,17 +560,21 @@ void BakedOpDispatcher::onOvalOp(BakedOpRenderer& renderer, const OvalOp& op,
             renderPathTexture(renderer, state, op.unmappedBounds.left, op.unmappedBounds.top,
                               *texture, *(op.paint));
         }
-    } else {
+    } else if (state.computedState.localProjectionPathMask != nullptr) {
         SkPath path;
         SkRect rect = getBoundsOfFill(op);
         path.addOval(rect);
 
-        if (state.computedState.localProjectionPathMask != nullptr) {
-            // Mask the ripple path by the local space projection mask in local space.
-            // Note that this can create CCW paths.
-            Op(path, *state.computedState.localProjectionPathMask, kIntersect_SkPathOp, &path);
-        }
+        // Mask the ripple path by the local space projection mask in local space.
+        // Note that this can create CCW paths.
+        Op(path, *state.computedState.localProjectionPathMask, kIntersect_SkPathOp, &path);
         renderConvexPath(renderer, state, path, *(op.paint));
+    } else {
+        const VertexBuffer* buffer = renderer.caches().tessellationCache.getOval(
+                state.computedState.transform, *(op.paint), op.unmappedBounds.getWidth(),
+                op.unmappedBounds.getHeight());
+        renderVertexBuffer(renderer, state, *buffer, op.unmappedBounds.left, op.unmappedBounds.top,
+                           *(op.paint), 0);
     }
 }
 
@@ -632,6 +631,15 @@ void BakedOpDispatcher::onPointsOp(BakedOpRenderer& renderer, const PointsOp& op
 // See SkPaintDefaults.h
 #define SkPaintDefaults_MiterLimit SkIntToScalar(4)
 
+static void renderRectVertexBuffer(BakedOpRenderer& renderer, const RectOp& op,
+                                   const BakedOpState& state) {
+    const VertexBuffer* buffer = renderer.caches().tessellationCache.getRect(
+            state.computedState.transform, *(op.paint), op.unmappedBounds.getWidth(),
+            op.unmappedBounds.getHeight());
+    renderVertexBuffer(renderer, state, *buffer, op.unmappedBounds.left, op.unmappedBounds.top,
+                       *(op.paint), 0);
+}
+
 void BakedOpDispatcher::onRectOp(BakedOpRenderer& renderer, const RectOp& op,
                                  const BakedOpState& state) {
     if (op.paint->getStyle() != SkPaint::kFill_Style) {
@@ -648,15 +656,11 @@ void BakedOpDispatcher::onRectOp(BakedOpRenderer& renderer, const RectOp& op,
                                   *texture, *(op.paint));
             }
         } else {
-            SkPath path;
-            path.addRect(getBoundsOfFill(op));
-            renderConvexPath(renderer, state, path, *(op.paint));
+            renderRectVertexBuffer(renderer, op, state);
         }
     } else {
         if (op.paint->isAntiAlias() && !state.computedState.transform.isSimple()) {
-            SkPath path;
-            path.addRect(op.unmappedBounds.toSkRect());
-            renderConvexPath(renderer, state, path, *(op.paint));
+            renderRectVertexBuffer(renderer, op, state);
         } else {
             // render simple unit quad, no tessellation required
             Glop glop;
@@ -25,8 +25,10 @@
 #include "font/FontCacheHistoryTracker.h"
 #endif
 #include "utils/GLUtils.h"
+#include "utils/LinearAllocator.h"
 
 #include <cutils/properties.h>
+#include <inttypes.h>
 #include <utils/Log.h>
 #include <utils/String8.h>
 
@@ -113,6 +115,8 @@ void Caches::terminate() {
 
     patchCache.clear();
 
+    textureCache.destroyUploader();
+
     clearGarbage();
 
     delete mPixelBufferState;
@@ -190,12 +194,21 @@ void Caches::dumpMemoryUsage(String8& log) {
                      dropShadowCache.getMaxSize());
     log.appendFormat("  PatchCache           %8d / %8d\n", patchCache.getSize(),
                      patchCache.getMaxSize());
+    if (mRenderState) {
+        mRenderState->layerPool().dumpMemoryUsage(log);
+        total += mRenderState->layerPool().getSize();
+    }
 
     fontRenderer.dumpMemoryUsage(log);
 
     log.appendFormat("Other:\n");
     log.appendFormat("  FboCache             %8d / %8d\n", fboCache.getSize(),
                      fboCache.getMaxSize());
+    LinearAllocator::PagePoolStats pagePool = LinearAllocator::getPagePoolStats();
+    log.appendFormat("  RecordingPagePool    %8zu / %8zu (reused = %" PRIu64
+                     ", allocated = %" PRIu64 ")\n",
+                     pagePool.pooledBytes, pagePool.capacity, pagePool.reusedPages,
+                     pagePool.allocatedPages);
 
     total += textureCache.getSize();
     total += renderBufferCache.getSize();
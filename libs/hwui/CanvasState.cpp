@@ -69,6 +69,22 @@ void CanvasState::initializeSaveStack(int viewportWidth, int viewportHeight, flo
     mSaveCount = 1;
 }
 
+void CanvasState::initializeSaveStack(const CanvasState& source) {
+    if (mWidth != source.mWidth || mHeight != source.mHeight) {
+        mWidth = source.mWidth;
+        mHeight = source.mHeight;
+        mFirstSnapshot.initializeViewport(mWidth, mHeight);
+        mCanvas.onViewportInitialized();
+    }
+
+    freeAllSnapshots();
+    mSnapshot = allocSnapshot(source.mSnapshot, SaveFlags::MatrixClip);
+    // never restore into the source's stack
+    mSnapshot->previous = &mFirstSnapshot;
+    mSnapshot->fbo = mCanvas.getTargetFbo();
+    mSaveCount = 1;
+}
+
 Snapshot* CanvasState::allocSnapshot(Snapshot* previous, int savecount) {
     void* memory;
     if (mSnapshotPool) {
@@ -89,6 +89,12 @@ public:
     void initializeSaveStack(int viewportWidth, int viewportHeight, float clipLeft, float clipTop,
                              float clipRight, float clipBottom, const Vector3& lightCenter);
 
+    /**
+     * Initializes the first snapshot as a copy of the current snapshot of another
+     * CanvasState, so that content can be deferred from the same state elsewhere.
+     */
+    void initializeSaveStack(const CanvasState& source);
+
     bool hasRectToRectTransform() const { return CC_LIKELY(currentTransform()->rectToRect()); }
 
     // Save (layer)
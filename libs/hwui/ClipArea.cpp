@@ -41,6 +41,11 @@ Rect transformAndCalculateBounds(const Rect& r, const Matrix4& transform) {
     return transformedBounds;
 }
 
+// Rounds the edges to the pixel centers they cover, like scan converting the rect's path does
+static SkIRect roundedRect(const Rect& r) {
+    return r.toSkRect().round();
+}
+
 void ClipBase::dump() const {
     ALOGD("mode %d" RECT_STRING, mode, RECT_ARGS(rect));
 }
@@ -115,6 +120,20 @@ bool RectangleList::intersectWith(const Rect& bounds, const Matrix4& transform)
         }
     }
 
+    // An axis aligned rectangle maps exactly to device space, so it is intersected with an
+    // untransformed rectangle rather than taking a slot of its own
+    if (transform.rectToRect()) {
+        for (int i = 0; i < mTransformedRectanglesCount; i++) {
+            TransformedRectangle& tr(mTransformedRectangles[i]);
+            if (tr.getTransform().isIdentity()) {
+                Rect mapped(bounds);
+                transform.mapRect(mapped);
+                tr.intersectWith(TransformedRectangle(mapped, Matrix4::identity()));
+                return true;
+            }
+        }
+    }
+
     // Add it to the list if there is room
     if (index < kMaxTransformedRectangles) {
         mTransformedRectangles[index] = newRectangle;
@@ -153,13 +172,20 @@ SkRegion RectangleList::convertToRegion(const SkRegion& clip) const {
     SkRegion rectangleListAsRegion;
     for (int index = 0; index < mTransformedRectanglesCount; index++) {
         const TransformedRectangle& tr(mTransformedRectangles[index]);
-        SkPath rectPathTransformed =
-                pathFromTransformedRectangle(tr.getBounds(), tr.getTransform());
-        if (index == 0) {
-            rectangleListAsRegion.setPath(rectPathTransformed, clip);
+        SkRegion rectRegion;
+        if (tr.getTransform().rectToRect()) {
+            // simple transform, skip creating SkPath
+            Rect mapped(tr.getBounds());
+            tr.getTransform().mapRect(mapped);
+            rectRegion.op(clip, roundedRect(mapped), SkRegion::kIntersect_Op);
         } else {
-            SkRegion rectRegion;
+            SkPath rectPathTransformed =
+                    pathFromTransformedRectangle(tr.getBounds(), tr.getTransform());
             rectRegion.setPath(rectPathTransformed, clip);
+        }
+        if (index == 0) {
+            rectangleListAsRegion.swap(rectRegion);
+        } else {
             rectangleListAsRegion.op(rectRegion, SkRegion::kIntersect_Op);
         }
     }
@@ -318,6 +344,19 @@ void ClipArea::enterRegionMode() {
 
 void ClipArea::regionModeClipRectWithTransform(const Rect& r, const mat4* transform,
                                                SkRegion::Op op) {
+    if (transform->rectToRect()) {
+        // The region ops work on the rect directly, instead of on the scan conversion of its path
+        Rect transformed(r);
+        transform->mapRect(transformed);
+        SkIRect rect = roundedRect(transformed);
+        if (!rect.intersect(mViewportBounds.toSkIRect())) {
+            rect.setEmpty();
+        }
+        mClipRegion.op(rect, op);
+        onClipRegionUpdated();
+        return;
+    }
+
     SkPath transformedRect = pathFromTransformedRectangle(r, *transform);
     SkRegion transformedRectRegion;
     regionFromPath(transformedRect, transformedRectRegion);
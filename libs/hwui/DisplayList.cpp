@@ -19,6 +19,7 @@
 
 #include <utils/Trace.h>
 
+#include "ClipArea.h"
 #include "DamageAccumulator.h"
 #include "Debug.h"
 #include "DisplayList.h"
@@ -89,6 +90,155 @@ size_t DisplayList::addChild(NodeOpType* op) {
     return index;
 }
 
+static bool clipsEqual(const ClipBase* a, const ClipBase* b) {
+    if (a == b) return true;
+    if (!a || !b) return false;
+    // only rect clips are compared by value, others are rare enough to treat as changed
+    return a->mode == ClipMode::Rectangle && b->mode == ClipMode::Rectangle &&
+           a->intersectWithRoot == b->intersectWithRoot && a->rect == b->rect;
+}
+
+static bool paintsEqual(const SkPaint* a, const SkPaint* b) {
+    if (a == b) return true;
+    return a && b && *a == *b;
+}
+
+// mutable bitmaps may have been redrawn since the other list was recorded
+static bool bitmapsEqual(const Bitmap* a, const Bitmap* b) {
+    return a == b && a->isImmutable();
+}
+
+template <typename T>
+static bool arraysEqual(const T* a, const T* b, size_t count) {
+    return a == b || (a && b && !memcmp(a, b, count * sizeof(T)));
+}
+
+static bool opsEqual(const RecordedOp& a, const RecordedOp& b) {
+    if (a.opId != b.opId || !(a.unmappedBounds == b.unmappedBounds) ||
+        !(a.localMatrix == b.localMatrix) || !clipsEqual(a.localClip, b.localClip) ||
+        !paintsEqual(a.paint, b.paint)) {
+        return false;
+    }
+
+    switch (a.opId) {
+        case RecordedOpId::RectOp:
+        case RecordedOpId::OvalOp:
+        case RecordedOpId::EndLayerOp:
+        case RecordedOpId::EndUnclippedLayerOp:
+        case RecordedOpId::BeginLayerOp:
+        case RecordedOpId::BeginUnclippedLayerOp:
+            return true;
+        case RecordedOpId::RenderNodeOp:
+            return static_cast<const RenderNodeOp&>(a).renderNode ==
+                   static_cast<const RenderNodeOp&>(b).renderNode;
+        case RecordedOpId::ArcOp: {
+            auto& arcA = static_cast<const ArcOp&>(a);
+            auto& arcB = static_cast<const ArcOp&>(b);
+            return arcA.startAngle == arcB.startAngle && arcA.sweepAngle == arcB.sweepAngle &&
+                   arcA.useCenter == arcB.useCenter;
+        }
+        case RecordedOpId::BitmapOp:
+            return bitmapsEqual(static_cast<const BitmapOp&>(a).bitmap,
+                                static_cast<const BitmapOp&>(b).bitmap);
+        case RecordedOpId::BitmapRectOp: {
+            auto& bitmapA = static_cast<const BitmapRectOp&>(a);
+            auto& bitmapB = static_cast<const BitmapRectOp&>(b);
+            return bitmapsEqual(bitmapA.bitmap, bitmapB.bitmap) && bitmapA.src == bitmapB.src;
+        }
+        case RecordedOpId::PatchOp: {
+            auto& patchA = static_cast<const PatchOp&>(a);
+            auto& patchB = static_cast<const PatchOp&>(b);
+            return bitmapsEqual(patchA.bitmap, patchB.bitmap) && patchA.patch == patchB.patch;
+        }
+        case RecordedOpId::ColorOp: {
+            auto& colorA = static_cast<const ColorOp&>(a);
+            auto& colorB = static_cast<const ColorOp&>(b);
+            return colorA.color == colorB.color && colorA.mode == colorB.mode;
+        }
+        case RecordedOpId::RoundRectOp: {
+            auto& rrA = static_cast<const RoundRectOp&>(a);
+            auto& rrB = static_cast<const RoundRectOp&>(b);
+            return rrA.rx == rrB.rx && rrA.ry == rrB.ry;
+        }
+        case RecordedOpId::CirclePropsOp: {
+            // animated by the RenderThread, so the same properties draw the same content
+            auto& circleA = static_cast<const CirclePropsOp&>(a);
+            auto& circleB = static_cast<const CirclePropsOp&>(b);
+            return circleA.x == circleB.x && circleA.y == circleB.y &&
+                   circleA.radius == circleB.radius;
+        }
+        case RecordedOpId::RoundRectPropsOp: {
+            auto& rrA = static_cast<const RoundRectPropsOp&>(a);
+            auto& rrB = static_cast<const RoundRectPropsOp&>(b);
+            return rrA.left == rrB.left && rrA.top == rrB.top && rrA.right == rrB.right &&
+                   rrA.bottom == rrB.bottom && rrA.rx == rrB.rx && rrA.ry == rrB.ry;
+        }
+        case RecordedOpId::LinesOp: {
+            auto& linesA = static_cast<const LinesOp&>(a);
+            auto& linesB = static_cast<const LinesOp&>(b);
+            return linesA.floatCount == linesB.floatCount &&
+                   arraysEqual(linesA.points, linesB.points, linesA.floatCount);
+        }
+        case RecordedOpId::PointsOp: {
+            auto& pointsA = static_cast<const PointsOp&>(a);
+            auto& pointsB = static_cast<const PointsOp&>(b);
+            return pointsA.floatCount == pointsB.floatCount &&
+                   arraysEqual(pointsA.points, pointsB.points, pointsA.floatCount);
+        }
+        case RecordedOpId::PathOp: {
+            auto& pathA = static_cast<const PathOp&>(a);
+            auto& pathB = static_cast<const PathOp&>(b);
+            return pathA.path == pathB.path || *pathA.path == *pathB.path;
+        }
+        case RecordedOpId::SimpleRectsOp: {
+            auto& rectsA = static_cast<const SimpleRectsOp&>(a);
+            auto& rectsB = static_cast<const SimpleRectsOp&>(b);
+            return rectsA.vertexCount == rectsB.vertexCount &&
+                   arraysEqual(rectsA.vertices, rectsB.vertices, rectsA.vertexCount);
+        }
+        case RecordedOpId::TextOp: {
+            auto& textA = static_cast<const TextOp&>(a);
+            auto& textB = static_cast<const TextOp&>(b);
+            return textA.glyphCount == textB.glyphCount && textA.x == textB.x &&
+                   textA.y == textB.y &&
+                   arraysEqual(textA.glyphs, textB.glyphs, textA.glyphCount) &&
+                   arraysEqual(textA.positions, textB.positions, textA.glyphCount * 2);
+        }
+        default:
+            // functors, layers, meshes, ... are assumed to change on every recording
+            return false;
+    }
+}
+
+bool DisplayList::hasSameContent(const DisplayList& other) const {
+    if (other.isSkiaDL() || hasFunctor() || hasVectorDrawables() || other.hasFunctor() ||
+        other.hasVectorDrawables()) {
+        return false;
+    }
+    if (projectionReceiveIndex != other.projectionReceiveIndex ||
+        ops.size() != other.ops.size() || chunks.size() != other.chunks.size() ||
+        children.size() != other.children.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < chunks.size(); i++) {
+        const Chunk& a = chunks[i];
+        const Chunk& b = other.chunks[i];
+        if (a.beginOpIndex != b.beginOpIndex || a.endOpIndex != b.endOpIndex ||
+            a.beginChildIndex != b.beginChildIndex || a.endChildIndex != b.endChildIndex ||
+            a.reorderChildren != b.reorderChildren || !clipsEqual(a.reorderClip, b.reorderClip)) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < ops.size(); i++) {
+        if (!opsEqual(*ops[i], *other.ops[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void DisplayList::syncContents() {
     for (auto& iter : functors) {
         (*iter.functor)(DrawGlInfo::kModeSync, nullptr);
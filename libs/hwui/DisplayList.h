@@ -119,6 +119,13 @@ public:
         return false;
     }
 
+    /**
+     * Returns true if this list would draw exactly the same content as the other one, e.g.
+     * because the app re-recorded identical ops. Conservative: content that can't be compared
+     * cheaply, or that keeps per-list state (functors, VectorDrawables), never compares equal.
+     */
+    virtual bool hasSameContent(const DisplayList& other) const;
+
     virtual void syncContents();
     virtual void updateChildren(std::function<void(RenderNode*)> updateFn);
     virtual bool prepareListAndChildren(
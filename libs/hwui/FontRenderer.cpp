@@ -28,13 +28,18 @@
 #include "Rect.h"
 #include "font/Font.h"
 #include "renderstate/RenderState.h"
+#include "thread/Task.h"
+#include "thread/TaskProcessor.h"
 #include "utils/Blur.h"
 #include "utils/Timing.h"
 
 #include <RenderScript.h>
 #include <SkGlyph.h>
+#include <SkGlyphCache.h>
+#include <SkSurfaceProps.h>
 #include <SkUtils.h>
 #include <utils/Log.h>
+#include <utils/Trace.h>
 #include <algorithm>
 
 namespace android {
@@ -132,6 +137,11 @@ void clearCacheTextures(std::vector<CacheTexture*>& cacheTextures) {
 }
 
 FontRenderer::~FontRenderer() {
+    for (auto& task : mPendingGlyphRaster) {
+        task->getResult();
+    }
+    mPendingGlyphRaster.clear();
+
     clearCacheTextures(mACacheTextures);
     clearCacheTextures(mRGBACacheTextures);
 
@@ -142,30 +152,36 @@ FontRenderer::~FontRenderer() {
     mActiveFonts.clear();
 }
 
-void FontRenderer::flushAllAndInvalidate() {
+bool FontRenderer::evictRegionFor(std::vector<CacheTexture*>& cacheTextures,
+                                  const SkGlyph& glyph) {
+    CacheTexture* victim = nullptr;
+    int victimRegion = -1;
+    for (uint32_t i = 0; i < cacheTextures.size(); i++) {
+        int region = cacheTextures[i]->findEvictableRegion(glyph);
+        if (region >= 0 && (!victim || cacheTextures[i]->getRegion(region).mLastUsed <
+                                               victim->getRegion(victimRegion).mLastUsed)) {
+            victim = cacheTextures[i];
+            victimRegion = region;
+        }
+    }
+    if (!victim) {
+        return false;
+    }
+
+    // Pending quads may sample the region
     issueDrawCommand();
 
+    const CacheRegion& region = victim->getRegion(victimRegion);
     LruCache<Font::FontDescription, Font*>::Iterator it(mActiveFonts);
     while (it.next()) {
-        it.value()->invalidateTextureCache();
+        it.value()->invalidateTextureCache(victim, region.mX, region.mX + region.mWidth);
     }
-
-    for (uint32_t i = 0; i < mACacheTextures.size(); i++) {
-        mACacheTextures[i]->init();
+    victim->evictRegion(victimRegion);
 
 #ifdef BUGREPORT_FONT_CACHE_USAGE
-        mHistoryTracker.glyphsCleared(mACacheTextures[i]);
+    mHistoryTracker.glyphsCleared(victim);
 #endif
-    }
-
-    for (uint32_t i = 0; i < mRGBACacheTextures.size(); i++) {
-        mRGBACacheTextures[i]->init();
-#ifdef BUGREPORT_FONT_CACHE_USAGE
-        mHistoryTracker.glyphsCleared(mRGBACacheTextures[i]);
-#endif
-    }
-
-    mDrawn = false;
+    return true;
 }
 
 void FontRenderer::flushLargeCaches(std::vector<CacheTexture*>& cacheTextures) {
@@ -252,9 +268,13 @@ void FontRenderer::cacheBitmap(const SkGlyph& glyph, CachedGlyphInfo* cachedGlyp
     if (!cacheTexture) {
         if (!precaching) {
             // If the new glyph didn't fit and we are not just trying to precache it,
-            // clear out the cache and try again
-            flushAllAndInvalidate();
-            cacheTexture = cacheBitmapInTexture(*cacheTextures, glyph, &startX, &startY);
+            // make room in the least recently used region and try again
+            if (evictRegionFor(*cacheTextures, glyph)) {
+                cacheTexture = cacheBitmapInTexture(*cacheTextures, glyph, &startX, &startY);
+            } else {
+                ALOGE("Font size too large to fit in cache. width, height = %i, %i",
+                      (int)glyph.fWidth, (int)glyph.fHeight);
+            }
         }
 
         if (!cacheTexture) {
@@ -264,6 +284,7 @@ void FontRenderer::cacheBitmap(const SkGlyph& glyph, CachedGlyphInfo* cachedGlyp
     }
 
     cachedGlyph->mCacheTexture = cacheTexture;
+    cacheTexture->markUsed(startX, mUseClock);
 
     *retOriginX = startX;
     *retOriginY = startY;
@@ -622,6 +643,7 @@ FontRenderer::DropShadow FontRenderer::renderDropShadow(const SkPaint* paint, co
 void FontRenderer::initRender(const Rect* clip, Rect* bounds, TextDrawFunctor* functor) {
     checkInit();
 
+    mUseClock++;
     mDrawn = false;
     mBounds = bounds;
     mFunctor = functor;
@@ -637,14 +659,93 @@ void FontRenderer::finishRender() {
 
 void FontRenderer::precache(const SkPaint* paint, const glyph_t* glyphs, int numGlyphs,
                             const SkMatrix& matrix) {
+    mUseClock++;
     Font* font = Font::create(this, paint, matrix);
     font->precache(paint, glyphs, numGlyphs);
 }
 
 void FontRenderer::endPrecaching() {
+    finishGlyphRaster();
     checkTextureUpdate();
 }
 
+class FontRenderer::GlyphRasterTask : public Task<bool> {
+public:
+    GlyphRasterTask(Font* font, const SkPaint& paint, std::vector<glyph_t>&& glyphs)
+            : font(font)
+            , paint(paint)
+            , lookupTransform(font->getDescription().mLookupTransform)
+            , glyphs(std::move(glyphs)) {}
+
+    struct RasterizedGlyph {
+        SkGlyph glyph;
+        std::unique_ptr<uint8_t[]> image;
+    };
+
+    // Only read on the RenderThread, workers use the copies below
+    Font* const font;
+    const SkPaint paint;
+    const SkMatrix lookupTransform;
+    const std::vector<glyph_t> glyphs;
+    std::vector<RasterizedGlyph> results;
+};
+
+class FontRenderer::GlyphRasterProcessor : public TaskProcessor<bool> {
+public:
+    explicit GlyphRasterProcessor(TaskManager* taskManager) : TaskProcessor<bool>(taskManager) {}
+    ~GlyphRasterProcessor() {}
+
+    virtual void onProcess(const sp<Task<bool>>& task) override {
+        ATRACE_NAME("rasterize glyphs");
+        GlyphRasterTask* t = static_cast<GlyphRasterTask*>(task.get());
+        SkSurfaceProps surfaceProps(0, kUnknown_SkPixelGeometry);
+        SkAutoGlyphCacheNoGamma autoCache(t->paint, &surfaceProps, &t->lookupTransform);
+        t->results.resize(t->glyphs.size());
+        for (size_t i = 0; i < t->glyphs.size(); i++) {
+            const SkGlyph& skiaGlyph = GET_METRICS(autoCache.getCache(), t->glyphs[i]);
+            const void* image = autoCache.getCache()->findImage(skiaGlyph);
+
+            // Copy the image out, the glyph cache may purge it once it is unlocked
+            GlyphRasterTask::RasterizedGlyph& result = t->results[i];
+            result.glyph = skiaGlyph;
+            result.glyph.fPathData = nullptr;
+            result.glyph.fImage = nullptr;
+            if (image) {
+                const size_t size = skiaGlyph.computeImageSize();
+                result.image.reset(new uint8_t[size]);
+                memcpy(result.image.get(), image, size);
+                result.glyph.fImage = result.image.get();
+            }
+        }
+        t->setResult(true);
+    }
+};
+
+void FontRenderer::rasterizeGlyphsAsync(Font* font, const SkPaint& paint,
+                                        std::vector<glyph_t>&& glyphs) {
+    if (!mGlyphRasterProcessor.get()) {
+        TaskManager* taskManager = &Caches::getInstance().tasks;
+        mGlyphRasterProcessor =
+                new GlyphRasterProcessor(taskManager->canRunTasks() ? taskManager : nullptr);
+    }
+    sp<GlyphRasterTask> task = new GlyphRasterTask(font, paint, std::move(glyphs));
+    mGlyphRasterProcessor->add(task);
+    mPendingGlyphRaster.push_back(task);
+}
+
+void FontRenderer::finishGlyphRaster() {
+    if (mPendingGlyphRaster.empty()) return;
+
+    ATRACE_NAME("finish glyph raster");
+    for (auto& task : mPendingGlyphRaster) {
+        task->getResult();
+        for (size_t i = 0; i < task->glyphs.size(); i++) {
+            task->font->cacheRasterizedGlyph(task->glyphs[i], task->results[i].glyph);
+        }
+    }
+    mPendingGlyphRaster.clear();
+}
+
 bool FontRenderer::renderPosText(const SkPaint* paint, const Rect* clip, const glyph_t* glyphs,
                                  int numGlyphs, int x, int y, const float* positions, Rect* bounds,
                                  TextDrawFunctor* functor, bool forceFinish) {
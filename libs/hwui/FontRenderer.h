@@ -135,7 +135,16 @@ private:
     CacheTexture* cacheBitmapInTexture(std::vector<CacheTexture*>& cacheTextures,
                                        const SkGlyph& glyph, uint32_t* startX, uint32_t* startY);
 
-    void flushAllAndInvalidate();
+    // Evicts the least recently used region that can hold glyph, across cacheTextures
+    bool evictRegionFor(std::vector<CacheTexture*>& cacheTextures, const SkGlyph& glyph);
+
+    class GlyphRasterTask;
+    class GlyphRasterProcessor;
+
+    // Rasterizes glyphs of font on a worker thread, they are added to the cache textures by
+    // finishGlyphRaster().
+    void rasterizeGlyphsAsync(Font* font, const SkPaint& paint, std::vector<glyph_t>&& glyphs);
+    void finishGlyphRaster();
 
     void checkInit();
     void initRender(const Rect* clip, Rect* bounds, TextDrawFunctor* functor);
@@ -185,6 +194,12 @@ private:
 
     bool mLinearFiltering;
 
+    // Counts draw and precache calls, to find the least recently used cache regions
+    uint32_t mUseClock = 0;
+
+    sp<GlyphRasterProcessor> mGlyphRasterProcessor;
+    std::vector<sp<GlyphRasterTask>> mPendingGlyphRaster;
+
 #ifdef BUGREPORT_FONT_CACHE_USAGE
     FontCacheHistoryTracker mHistoryTracker;
 #endif
@@ -22,6 +22,8 @@
 #include "VectorDrawable.h"
 #include "hwui/Canvas.h"
 #include "renderstate/OffscreenBufferPool.h"
+#include "thread/Task.h"
+#include "thread/TaskProcessor.h"
 #include "utils/FatVector.h"
 #include "utils/PaintUtils.h"
 #include "utils/TraceUtils.h"
@@ -40,7 +42,8 @@ FrameBuilder::FrameBuilder(const SkRect& clip, uint32_t viewportWidth, uint32_t
         , mCanvasState(*this)
         , mCaches(caches)
         , mLightRadius(lightGeometry.radius)
-        , mDrawFbo0(true) {
+        , mDrawFbo0(true)
+        , mParallelDeferral(Properties::enableParallelDeferral && caches.tasks.canRunTasks()) {
     // Prepare to defer Fbo0
     auto fbo0 = mAllocator.create<LayerBuilder>(viewportWidth, viewportHeight, Rect(clip));
     mLayerBuilders.push_back(fbo0);
@@ -57,7 +60,8 @@ FrameBuilder::FrameBuilder(const LayerUpdateQueue& layers, const LightGeometry&
         , mCanvasState(*this)
         , mCaches(caches)
         , mLightRadius(lightGeometry.radius)
-        , mDrawFbo0(false) {
+        , mDrawFbo0(false)
+        , mParallelDeferral(Properties::enableParallelDeferral && caches.tasks.canRunTasks()) {
     // TODO: remove, with each layer on its own save stack
 
     // Prepare to defer Fbo0 (which will be empty)
@@ -69,6 +73,26 @@ FrameBuilder::FrameBuilder(const LayerUpdateQueue& layers, const LightGeometry&
     deferLayers(layers);
 }
 
+FrameBuilder::FrameBuilder(FrameBuilder& parent)
+        : mStdAllocator(mAllocator)
+        , mLayerBuilders(mStdAllocator)
+        , mLayerStack(mStdAllocator)
+        , mCanvasState(*this)
+        , mCaches(parent.mCaches)
+        , mLightRadius(parent.mLightRadius)
+        , mDrawFbo0(false)
+        , mParallelDeferral(false)
+        , mActiveCachesLock(&parent.mCachesLock) {
+    const LayerBuilder& parentLayer = parent.currentLayer();
+    auto layer = mAllocator.create<LayerBuilder>(parentLayer.width, parentLayer.height,
+                                                 parentLayer.repaintRect);
+    mLayerBuilders.push_back(layer);
+    mLayerStack.push_back(0);
+    mCanvasState.initializeSaveStack(parent.mCanvasState);
+}
+
+FrameBuilder::~FrameBuilder() {}
+
 void FrameBuilder::deferLayers(const LayerUpdateQueue& layers) {
     // Render all layers to be updated, in order. Defer in reverse order, so that they'll be
     // updated in the order they're passed in (mLayerBuilders are issued to Renderer in reverse)
@@ -439,10 +463,14 @@ void FrameBuilder::deferShadow(const ClipBase* reorderClip, const RenderNodeOp&
         node.applyViewPropertyTransforms(shadowMatrixXY, false);
         node.applyViewPropertyTransforms(shadowMatrixZ, true);
 
-        sp<TessellationCache::ShadowTask> task = mCaches.tessellationCache.getShadowTask(
-                mCanvasState.currentTransform(), mCanvasState.getLocalClipBounds(),
-                casterAlpha >= 1.0f, casterPath, &shadowMatrixXY, &shadowMatrixZ,
-                mCanvasState.currentSnapshot()->getRelativeLightCenter(), mLightRadius);
+        sp<TessellationCache::ShadowTask> task;
+        {
+            auto cachesLock = lockCaches();
+            task = mCaches.tessellationCache.getShadowTask(
+                    mCanvasState.currentTransform(), mCanvasState.getLocalClipBounds(),
+                    casterAlpha >= 1.0f, casterPath, &shadowMatrixXY, &shadowMatrixZ,
+                    mCanvasState.currentSnapshot()->getRelativeLightCenter(), mLightRadius);
+        }
         ShadowOp* shadowOp = mAllocator.create<ShadowOp>(task, casterAlpha);
         BakedOpState* bakedOpState = BakedOpState::tryShadowOpConstruct(
                 mAllocator, *mCanvasState.writableSnapshot(), shadowOp);
@@ -509,6 +537,15 @@ void FrameBuilder::deferNodeOps(const RenderNode& renderNode) {
 
         defer3dChildren(chunk.reorderClip, ChildrenSelectMode::Negative, zTranslatedNodes);
         for (size_t opIndex = chunk.beginOpIndex; opIndex < chunk.endOpIndex; opIndex++) {
+            if (CC_UNLIKELY(mParallelDeferral)) {
+                size_t deferredOps = deferSubtreeRun(renderNode, opIndex, chunk.endOpIndex);
+                if (deferredOps) {
+                    // runs never include the projection receiver, so nothing else to do
+                    opIndex += deferredOps - 1;
+                    continue;
+                }
+            }
+
             const RecordedOp* op = displayList.getOps()[opIndex];
             receivers[op->opId](*this, *op);
 
@@ -537,6 +574,173 @@ void FrameBuilder::deferRenderNodeOpImpl(const RenderNodeOp& op) {
     mCanvasState.restoreToCount(count);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Parallel subtree deferral
+///////////////////////////////////////////////////////////////////////////////
+
+// Below this many ops, handing a group of subtrees to a worker costs more than deferring it
+static constexpr size_t kMinOpsPerSubtreeTask = 64;
+
+// Bounds the scan of deep subtrees, which are deferred serially past this size anyway
+static constexpr int kMaxParallelSubtreeDepth = 32;
+
+class DeferSubtreesTask : public Task<bool> {
+public:
+    DeferSubtreesTask(FrameBuilder* builder, const RenderNodeOp* const* ops, size_t count)
+            : builder(builder), ops(ops), count(count) {}
+
+    FrameBuilder* builder;
+    const RenderNodeOp* const* ops;
+    const size_t count;
+};
+
+class SubtreeDeferralProcessor : public TaskProcessor<bool> {
+public:
+    explicit SubtreeDeferralProcessor(TaskManager* manager) : TaskProcessor<bool>(manager) {}
+
+    virtual void onProcess(const sp<Task<bool> >& task) override {
+        DeferSubtreesTask* t = static_cast<DeferSubtreesTask*>(task.get());
+        ATRACE_NAME("deferSubtrees");
+        for (size_t i = 0; i < t->count; i++) {
+            t->builder->deferRenderNodeOpImpl(*(t->ops[i]));
+        }
+        t->setResult(true);
+    }
+};
+
+static bool canDeferInParallelImpl(const RenderNode& node, int depth, size_t* outOpCount);
+
+bool FrameBuilder::canDeferInParallel(const RenderNode& node, size_t* outOpCount) {
+    return canDeferInParallelImpl(node, 0, outOpCount);
+}
+
+static bool canDeferInParallelImpl(const RenderNode& node, int depth, size_t* outOpCount) {
+    if (depth > kMaxParallelSubtreeDepth) return false;
+
+    const RenderProperties& properties = node.properties();
+    // projection reaches across subtrees
+    if (properties.getProjectBackwards() || node.hasProjectionReceiver()) return false;
+
+    // HW layers are drawn with a single op, their content was deferred separately
+    if (node.getLayer()) {
+        *outOpCount += 1;
+        return true;
+    }
+
+    // saveLayers for overlapping alpha would push a layer on the shared layer stack
+    if (properties.getAlpha() < 1 && properties.effectiveLayerType() == LayerType::None &&
+        properties.getHasOverlappingRendering()) {
+        return false;
+    }
+
+    const DisplayList* displayList = node.getDisplayList();
+    if (!displayList) return true;
+
+    for (const RecordedOp* op : displayList->getOps()) {
+        switch (op->opId) {
+            case RecordedOpId::BeginLayerOp:
+            case RecordedOpId::EndLayerOp:
+            case RecordedOpId::BeginUnclippedLayerOp:
+            case RecordedOpId::EndUnclippedLayerOp:
+            // updates the VectorDrawable's cached bitmap
+            case RecordedOpId::VectorDrawableOp:
+                return false;
+            default:
+                break;
+        }
+    }
+    *outOpCount += displayList->getOps().size();
+
+    for (const RenderNodeOp* childOp : displayList->getChildren()) {
+        if (!canDeferInParallelImpl(*childOp->renderNode, depth + 1, outOpCount)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t FrameBuilder::deferSubtreeRun(const RenderNode& renderNode, size_t opIndex,
+                                     size_t endOpIndex) {
+    const DisplayList& displayList = *(renderNode.getDisplayList());
+    const auto& ops = displayList.getOps();
+
+    // ops deferred in parallel can't observe unclipped save layer clears of the current layer
+    if (!currentLayer().activeUnclippedSaveLayers.empty()) return 0;
+
+    // gather the run of in-order sibling subtrees that can be deferred independently
+    FatVector<const RenderNodeOp*, 16> runOps;
+    FatVector<size_t, 16> runOpCounts;
+    size_t totalOpCount = 0;
+    for (size_t i = opIndex; i < endOpIndex; i++) {
+        if (static_cast<int>(i) == displayList.projectionReceiveIndex) break;
+        const RecordedOp* op = ops[i];
+        if (op->opId != RecordedOpId::RenderNodeOp) break;
+        const RenderNodeOp* childOp = static_cast<const RenderNodeOp*>(op);
+        size_t opCount = 0;
+        if (childOp->skipInOrderDraw || !canDeferInParallel(*childOp->renderNode, &opCount)) {
+            break;
+        }
+        runOps.push_back(childOp);
+        runOpCounts.push_back(opCount);
+        totalOpCount += opCount;
+    }
+    if (runOps.empty()) return 0;
+
+    if (runOps.size() < 2 || totalOpCount < 2 * kMinOpsPerSubtreeTask) {
+        for (const RenderNodeOp* childOp : runOps) {
+            deferRenderNodeOpImpl(*childOp);
+        }
+        return runOps.size();
+    }
+
+    ATRACE_FORMAT("deferSubtreeRun %zu nodes %zu ops", runOps.size(), totalOpCount);
+
+    // Split the run into contiguous groups of similar size. The first group is deferred on this
+    // thread directly into the current layer, the others into separate builders on workers.
+    const size_t maxGroups = std::min(runOps.size(), size_t(4));
+    const size_t opsPerGroup =
+            std::max(kMinOpsPerSubtreeTask, (totalOpCount + maxGroups - 1) / maxGroups);
+    FatVector<size_t, 5> groupStarts;
+    groupStarts.push_back(0);
+    size_t groupOpCount = 0;
+    for (size_t i = 0; i < runOps.size(); i++) {
+        if (groupOpCount >= opsPerGroup) {
+            groupStarts.push_back(i);
+            groupOpCount = 0;
+        }
+        groupOpCount += runOpCounts[i];
+    }
+    groupStarts.push_back(runOps.size());
+
+    if (!mSubtreeProcessor) {
+        mSubtreeProcessor = new SubtreeDeferralProcessor(&mCaches.tasks);
+    }
+
+    mActiveCachesLock = &mCachesLock;
+    std::vector<std::unique_ptr<FrameBuilder> > builders;
+    std::vector<sp<DeferSubtreesTask> > tasks;
+    for (size_t group = 1; group + 1 < groupStarts.size(); group++) {
+        builders.emplace_back(new FrameBuilder(*this));
+        tasks.emplace_back(new DeferSubtreesTask(builders.back().get(),
+                                                 &runOps[groupStarts[group]],
+                                                 groupStarts[group + 1] - groupStarts[group]));
+        mSubtreeProcessor->add(tasks.back());
+    }
+
+    for (size_t i = 0; i < groupStarts[1]; i++) {
+        deferRenderNodeOpImpl(*runOps[i]);
+    }
+
+    // merge in draw order
+    for (size_t i = 0; i < tasks.size(); i++) {
+        tasks[i]->getResult();
+        currentLayer().appendBatches(mAllocator, builders[i]->currentLayer());
+        mSubtreeBuilders.push_back(std::move(builders[i]));
+    }
+    mActiveCachesLock = nullptr;
+    return runOps.size();
+}
+
 void FrameBuilder::deferRenderNodeOp(const RenderNodeOp& op) {
     if (!op.skipInOrderDraw) {
         deferRenderNodeOpImpl(op);
@@ -580,7 +784,17 @@ void FrameBuilder::deferArcOp(const ArcOp& op) {
     // Pass true below since arcs have a tendency to draw outside their expected bounds within
     // their path textures. Passing true makes it more likely that we'll scissor, instead of
     // corrupting the frame by drawing outside of clip bounds.
-    deferStrokeableOp(op, tessBatchId(op), BakedOpState::StrokeBehavior::StyleDefined, true);
+    auto state = deferStrokeableOp(op, tessBatchId(op), BakedOpState::StrokeBehavior::StyleDefined,
+                                   true);
+    // Only stroked arcs without center are tessellated, see BakedOpDispatcher::onArcOp
+    if (CC_LIKELY(state && op.paint->getStyle() == SkPaint::kStroke_Style &&
+                  !op.paint->getPathEffect() && !op.useCenter)) {
+        auto cachesLock = lockCaches();
+        mCaches.tessellationCache.precacheArc(state->computedState.transform, *(op.paint),
+                                              op.unmappedBounds.getWidth(),
+                                              op.unmappedBounds.getHeight(), op.startAngle,
+                                              op.sweepAngle);
+    }
 }
 
 static bool hasMergeableClip(const BakedOpState& state) {
@@ -661,7 +875,14 @@ void FrameBuilder::deferLinesOp(const LinesOp& op) {
 }
 
 void FrameBuilder::deferOvalOp(const OvalOp& op) {
-    deferStrokeableOp(op, tessBatchId(op));
+    auto state = deferStrokeableOp(op, tessBatchId(op));
+    if (CC_LIKELY(state && !op.paint->getPathEffect() &&
+                  !state->computedState.localProjectionPathMask)) {
+        auto cachesLock = lockCaches();
+        mCaches.tessellationCache.precacheOval(state->computedState.transform, *(op.paint),
+                                               op.unmappedBounds.getWidth(),
+                                               op.unmappedBounds.getHeight());
+    }
 }
 
 void FrameBuilder::deferPatchOp(const PatchOp& op) {
@@ -684,6 +905,7 @@ void FrameBuilder::deferPatchOp(const PatchOp& op) {
 void FrameBuilder::deferPathOp(const PathOp& op) {
     auto state = deferStrokeableOp(op, OpBatchType::AlphaMaskTexture);
     if (CC_LIKELY(state)) {
+        auto cachesLock = lockCaches();
         mCaches.pathCache.precache(op.path, op.paint);
     }
 }
@@ -693,14 +915,32 @@ void FrameBuilder::deferPointsOp(const PointsOp& op) {
     deferStrokeableOp(op, batch, BakedOpState::StrokeBehavior::Forced);
 }
 
+// Whether BakedOpDispatcher::onRectOp draws the rect with a tessellated VertexBuffer, rather than
+// a path texture or a plain quad
+static bool isTessellatedRect(const RectOp& op, const BakedOpState& state) {
+    if (op.paint->getStyle() == SkPaint::kFill_Style) {
+        return op.paint->isAntiAlias() && !state.computedState.transform.isSimple();
+    }
+    // 4 is the default miter limit, see SkPaintDefaults.h
+    return !op.paint->getPathEffect() && op.paint->getStrokeJoin() == SkPaint::kMiter_Join &&
+           op.paint->getStrokeMiter() == SkIntToScalar(4);
+}
+
 void FrameBuilder::deferRectOp(const RectOp& op) {
-    deferStrokeableOp(op, tessBatchId(op));
+    auto state = deferStrokeableOp(op, tessBatchId(op));
+    if (CC_LIKELY(state) && isTessellatedRect(op, *state)) {
+        auto cachesLock = lockCaches();
+        mCaches.tessellationCache.precacheRect(state->computedState.transform, *(op.paint),
+                                               op.unmappedBounds.getWidth(),
+                                               op.unmappedBounds.getHeight());
+    }
 }
 
 void FrameBuilder::deferRoundRectOp(const RoundRectOp& op) {
     auto state = deferStrokeableOp(op, tessBatchId(op));
     if (CC_LIKELY(state && !op.paint->getPathEffect())) {
         // TODO: consider storing tessellation task in BakedOpState
+        auto cachesLock = lockCaches();
         mCaches.tessellationCache.precacheRoundRect(state->computedState.transform, *(op.paint),
                                                     op.unmappedBounds.getWidth(),
                                                     op.unmappedBounds.getHeight(), op.rx, op.ry);
@@ -743,6 +983,7 @@ void FrameBuilder::deferTextOp(const TextOp& op) {
         currentLayer().deferUnmergeableOp(mAllocator, bakedState, batchId);
     }
 
+    auto cachesLock = lockCaches();
     FontRenderer& fontRenderer = mCaches.fontRenderer.getFontRenderer();
     auto& totalTransform = bakedState->computedState.transform;
     if (totalTransform.isPureTranslate() || totalTransform.isPerspective()) {
@@ -762,6 +1003,7 @@ void FrameBuilder::deferTextOnPathOp(const TextOnPathOp& op) {
     if (!bakedState) return;  // quick rejected
     currentLayer().deferUnmergeableOp(mAllocator, bakedState, textBatchId(*(op.paint)));
 
+    auto cachesLock = lockCaches();
     mCaches.fontRenderer.getFontRenderer().precache(op.paint, op.glyphs, op.glyphCount,
                                                     SkMatrix::I());
 }
@@ -21,8 +21,11 @@
 #include "DisplayList.h"
 #include "LayerBuilder.h"
 #include "RecordedOp.h"
+#include "RenderNodeGpuProfiler.h"
 #include "utils/GLUtils.h"
 
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -35,6 +38,7 @@ class BakedOpState;
 class LayerUpdateQueue;
 class OffscreenBuffer;
 class Rect;
+class SubtreeDeferralProcessor;
 
 /**
  * Processes, optimizes, and stores rendering commands from RenderNodes and
@@ -75,7 +79,7 @@ public:
     void deferRenderNodeScene(const std::vector<sp<RenderNode> >& nodes,
                               const Rect& contentDrawBounds);
 
-    virtual ~FrameBuilder() {}
+    virtual ~FrameBuilder();
 
     /**
      * replayBakedOps() is templated based on what class will receive ops being replayed.
@@ -121,11 +125,17 @@ public:
             LayerBuilder& layer = *(mLayerBuilders[i]);
             if (layer.renderNode) {
                 // cached HW layer - can't skip layer if empty
+                // ops are merged across nodes, so only layers can be timed per node
+                RenderNodeGpuProfiler* gpuProfiler = RenderNodeGpuProfiler::active();
+                const bool gpuTimed = gpuProfiler && gpuProfiler->beginNode(*layer.renderNode);
                 renderer.startRepaintLayer(layer.offscreenBuffer, layer.repaintRect);
                 GL_CHECKPOINT(MODERATE);
                 layer.replayBakedOpsImpl((void*)&renderer, unmergedReceivers, mergedReceivers);
                 GL_CHECKPOINT(MODERATE);
                 renderer.endLayer();
+                if (CC_UNLIKELY(gpuTimed)) {
+                    gpuProfiler->endNode();
+                }
             } else if (!layer.empty()) {
                 // save layer - skip entire layer if empty (in which case, LayerOp has null layer).
                 layer.offscreenBuffer = renderer.startTemporaryLayer(layer.width, layer.height);
@@ -166,6 +176,15 @@ public:
     virtual GLuint getTargetFbo() const override { return 0; }
 
 private:
+    friend class SubtreeDeferralProcessor;
+
+    /**
+     * Creates a builder which defers a range of sibling RenderNode subtrees on a worker thread.
+     * It starts from the parent's current canvas state, and batches into a single layer sized
+     * like the parent's current layer, so that its batches can be merged back in draw order.
+     */
+    explicit FrameBuilder(FrameBuilder& parent);
+
     void finishDefer();
     enum class ChildrenSelectMode { Negative, Positive };
     void saveForLayer(uint32_t layerWidth, uint32_t layerHeight, float contentTranslateX,
@@ -198,6 +217,22 @@ private:
 
     void deferRenderNodeOpImpl(const RenderNodeOp& op);
 
+    /**
+     * Defers the run of sibling RenderNodeOps starting at opIndex that can be deferred
+     * independently of the rest of the frame, in parallel when there is enough work to split.
+     * Returns the number of ops consumed, which is 0 if the op at opIndex doesn't start a run.
+     */
+    size_t deferSubtreeRun(const RenderNode& renderNode, size_t opIndex, size_t endOpIndex);
+
+    // Returns true if the subtree only touches state private to the builder deferring it
+    static bool canDeferInParallel(const RenderNode& node, size_t* outOpCount);
+
+    // Caches aren't thread safe, so serialize access while subtrees are deferred in parallel
+    std::unique_lock<std::mutex> lockCaches() {
+        return mActiveCachesLock ? std::unique_lock<std::mutex>(*mActiveCachesLock)
+                                 : std::unique_lock<std::mutex>();
+    }
+
     void replayBakedOpsImpl(void* arg, BakedOpReceiver* receivers);
 
     SkPath* createFrameAllocatedPath() { return mAllocator.create<SkPath>(); }
@@ -245,6 +280,17 @@ private:
     float mLightRadius;
 
     const bool mDrawFbo0;
+
+    // Opt-in, see Properties::enableParallelDeferral. Never set for builders of subtrees.
+    const bool mParallelDeferral;
+
+    // Builders of subtrees deferred in parallel. They own the batches merged into our layers,
+    // so must live as long as this builder.
+    std::vector<std::unique_ptr<FrameBuilder> > mSubtreeBuilders;
+    sp<SubtreeDeferralProcessor> mSubtreeProcessor;
+
+    std::mutex mCachesLock;
+    std::mutex* mActiveCachesLock = nullptr;
 };
 
 };  // namespace uirenderer
@@ -51,6 +51,16 @@ enum class FrameInfoIndex {
     DequeueBufferDuration,
     QueueBufferDuration,
 
+    // Time the RenderThread spent blocked on the GPU or the swapchain before it could draw
+    GpuWaitDuration,
+    // Number of earlier frames still on the GPU when this frame started drawing
+    FramesInFlight,
+
+    // Time the AnimatedImageThread spent decoding frames since the previous frame
+    AnimatedImageDecodeDuration,
+    // Number of animated images whose next frame was due but not decoded yet
+    AnimatedImageLateFrames,
+
     // Must be the last value!
     // Also must be kept in sync with FrameMetrics.java#FRAME_STATS_COUNT
     NumIndexes
@@ -16,14 +16,24 @@
 
 #pragma once
 
+#include "RenderNodeGpuProfiler.h"
+
 #include <utils/RefBase.h>
 
+#include <vector>
+
 namespace android {
 namespace uirenderer {
 
 class FrameMetricsObserver : public VirtualLightRefBase {
 public:
     virtual void notify(const int64_t* buffer);
+
+    /**
+     * Called with the GPU time of the RenderNodes of earlier frames when
+     * debug.hwui.profile_render_node_gpu is set, see RenderNodeGpuProfiler.
+     */
+    virtual void notifyRenderNodeGpuTimes(const std::vector<RenderNodeGpuTime>& /*times*/) {}
 };
 
 };  // namespace uirenderer
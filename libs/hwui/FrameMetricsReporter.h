@@ -52,6 +52,12 @@ public:
         }
     }
 
+    void reportRenderNodeGpuTimes(const std::vector<RenderNodeGpuTime>& times) {
+        for (size_t i = 0; i < mObservers.size(); i++) {
+            mObservers[i]->notifyRenderNodeGpuTimes(times);
+        }
+    }
+
 private:
     std::vector<sp<FrameMetricsObserver> > mObservers;
 };
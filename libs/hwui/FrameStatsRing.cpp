@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameStatsRing.h"
+
+#include <cutils/ashmem.h>
+#include <log/log.h>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+
+namespace android {
+namespace uirenderer {
+
+static constexpr uint32_t kFieldCount = static_cast<uint32_t>(FrameInfoIndex::NumIndexes);
+
+void FrameStatsRing::freeData() {
+    if (mIsMapped) {
+        munmap(mHeader, mMappedSize);
+    }
+    mHeader = nullptr;
+    mSlots = nullptr;
+    mSlotCount = 0;
+    mFramesWritten = 0;
+    mMappedSize = 0;
+    mIsMapped = false;
+}
+
+bool FrameStatsRing::attach(void* region, size_t size) {
+    if (size < sizeof(FrameStatsRingHeader) + sizeof(FrameStatsRingSlot)) {
+        ALOGW("FrameStatsRing region is too small! Received %zu, required %zu", size,
+              sizeof(FrameStatsRingHeader) + sizeof(FrameStatsRingSlot));
+        return false;
+    }
+    freeData();
+
+    FrameStatsRingHeader* header = reinterpret_cast<FrameStatsRingHeader*>(region);
+    // Publish the layout before the magic so that readers never see a half initialized header
+    header->magic = 0;
+    header->version = FrameStatsRingHeader::kVersion;
+    header->headerSize = sizeof(FrameStatsRingHeader);
+    header->slotSize = sizeof(FrameStatsRingSlot);
+    header->slotCount = (size - sizeof(FrameStatsRingHeader)) / sizeof(FrameStatsRingSlot);
+    header->fieldCount = kFieldCount;
+    header->framesWritten.store(0, std::memory_order_relaxed);
+    mHeader = header;
+    mSlots = reinterpret_cast<FrameStatsRingSlot*>(header + 1);
+    mSlotCount = header->slotCount;
+    mFramesWritten = 0;
+    for (uint32_t i = 0; i < mSlotCount; i++) {
+        slotAt(i)->sequence.store(0, std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = FrameStatsRingHeader::kMagic;
+    mMappedSize = size;
+    return true;
+}
+
+void FrameStatsRing::switchStorageToAshmem(int ashmemfd) {
+    int regionSize = ashmem_get_size_region(ashmemfd);
+    if (regionSize < 0) {
+        int err = errno;
+        ALOGW("Failed to get ashmem region size from fd %d, err %d %s", ashmemfd, err,
+              strerror(err));
+        return;
+    }
+    void* region = mmap(NULL, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, ashmemfd, 0);
+    if (region == MAP_FAILED) {
+        int err = errno;
+        ALOGW("Failed to map frame stats ring from ashmem fd %d, error = %d", ashmemfd, err);
+        return;
+    }
+    if (!attach(region, regionSize)) {
+        munmap(region, regionSize);
+        return;
+    }
+    mIsMapped = true;
+}
+
+FrameStatsRingSlot* FrameStatsRing::slotAt(uint64_t frameNumber) const {
+    return mSlots + frameNumber % mSlotCount;
+}
+
+void FrameStatsRing::write(const FrameInfo& frame) {
+    if (!mHeader) return;
+
+    const uint64_t frameNumber = mFramesWritten++;
+    FrameStatsRingSlot* slot = slotAt(frameNumber);
+    slot->sequence.store(2 * frameNumber + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(slot->frameInfo, frame.data(), sizeof(slot->frameInfo));
+    slot->sequence.store(2 * (frameNumber + 1), std::memory_order_release);
+    mHeader->framesWritten.store(frameNumber + 1, std::memory_order_release);
+}
+
+bool FrameStatsRing::readFrame(const void* region, size_t regionSize, uint64_t frameNumber,
+                               int64_t* outFrameInfo, size_t outFieldCount) {
+    if (regionSize < sizeof(FrameStatsRingHeader)) return false;
+    const FrameStatsRingHeader* header = reinterpret_cast<const FrameStatsRingHeader*>(region);
+    if (header->magic != FrameStatsRingHeader::kMagic) return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // The writer may be another process, only trust a layout that fits in the region
+    const uint32_t headerSize = header->headerSize;
+    const uint32_t slotSize = header->slotSize;
+    const uint32_t slotCount = header->slotCount;
+    const uint32_t fieldCount = header->fieldCount;
+    if (header->version != FrameStatsRingHeader::kVersion || !slotCount ||
+        headerSize < sizeof(FrameStatsRingHeader) || headerSize > regionSize ||
+        slotSize < sizeof(std::atomic<uint64_t>) + fieldCount * sizeof(int64_t) ||
+        (regionSize - headerSize) / slotSize < slotCount) {
+        return false;
+    }
+
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(region) + headerSize;
+    const FrameStatsRingSlot* slot = reinterpret_cast<const FrameStatsRingSlot*>(
+            base + (frameNumber % slotCount) * slotSize);
+
+    const uint64_t expected = 2 * (frameNumber + 1);
+    if (slot->sequence.load(std::memory_order_acquire) != expected) return false;
+    const size_t copiedFieldCount = std::min<size_t>(fieldCount, outFieldCount);
+    memcpy(outFrameInfo, slot->frameInfo, copiedFieldCount * sizeof(int64_t));
+    std::fill(outFrameInfo + copiedFieldCount, outFrameInfo + outFieldCount, 0);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot->sequence.load(std::memory_order_relaxed) == expected;
+}
+
+} /* namespace uirenderer */
+} /* namespace android */
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "FrameInfo.h"
+#include "utils/Macros.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace android {
+namespace uirenderer {
+
+/**
+ * Shared memory layout of a FrameStatsRing, version 1.
+ *
+ * The region starts with a FrameStatsRingHeader, followed by slotCount
+ * FrameStatsRingSlots starting at offset headerSize, each slotSize bytes.
+ * Frame number n (counting from 0 since the ring was attached) is stored in
+ * slot n % slotCount. Readers must check magic and version, and should use
+ * headerSize/slotSize/fieldCount rather than sizeof() so that later versions
+ * can append fields.
+ *
+ * Every slot is guarded by a sequence number: it is odd while the RenderThread
+ * is writing the slot and 2 * (n + 1) once frame n has been fully written.
+ * A reader copies the slot between two loads of the sequence number and
+ * discards the copy if they differ or don't match the frame it asked for.
+ */
+struct FrameStatsRingHeader {
+    static constexpr uint32_t kMagic = 0x53465748;  // "HWFS"
+    static constexpr uint32_t kVersion = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t slotSize;
+    uint32_t slotCount;
+    // Number of int64_t values per slot, indexed by FrameInfoIndex
+    uint32_t fieldCount;
+    // Total number of frames written so far
+    std::atomic<uint64_t> framesWritten;
+};
+
+struct FrameStatsRingSlot {
+    std::atomic<uint64_t> sequence;
+    int64_t frameInfo[static_cast<int>(FrameInfoIndex::NumIndexes)];
+};
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+              "shared memory layout requires plain 64 bit atomics");
+
+/**
+ * Lock-free, single writer ring of FrameInfo records that can be placed in
+ * ashmem and read by another process or thread without any IPC.
+ */
+class FrameStatsRing {
+    PREVENT_COPY_AND_ASSIGN(FrameStatsRing);
+
+public:
+    FrameStatsRing() {}
+    ~FrameStatsRing() { freeData(); }
+
+    /**
+     * Maps the ashmem region and starts writing frames into it. Any previous
+     * region is released. The ring uses as many slots as fit in the region.
+     */
+    void switchStorageToAshmem(int ashmemfd);
+
+    /**
+     * Uses caller owned memory instead of ashmem, mostly for testing.
+     */
+    bool attach(void* region, size_t size);
+
+    void freeData();
+
+    bool isAttached() const { return mHeader != nullptr; }
+
+    /**
+     * Only to be called from the thread that owns the JankTracker.
+     */
+    void write(const FrameInfo& frame);
+
+    /**
+     * Copies frame number frameNumber out of a ring of regionSize bytes written
+     * by another thread or process. Returns false if the frame hasn't been
+     * written yet, has already been overwritten or is being written
+     * concurrently, or if the header doesn't describe a layout that fits in
+     * the region.
+     */
+    static bool readFrame(const void* region, size_t regionSize, uint64_t frameNumber,
+                          int64_t* outFrameInfo, size_t outFieldCount);
+
+private:
+    FrameStatsRingSlot* slotAt(uint64_t frameNumber) const;
+
+    FrameStatsRingHeader* mHeader = nullptr;
+    // The layout the ring was attached with. The header in the region can be
+    // written by other processes, so the writer never reads it back.
+    FrameStatsRingSlot* mSlots = nullptr;
+    uint32_t mSlotCount = 0;
+    uint64_t mFramesWritten = 0;
+    size_t mMappedSize = 0;
+    bool mIsMapped = false;
+};
+
+} /* namespace uirenderer */
+} /* namespace android */
@@ -16,6 +16,7 @@
 
 #include "Interpolator.h"
 
+#include <string.h>
 #include <algorithm>
 
 #include <log/log.h>
@@ -29,10 +30,22 @@ Interpolator* Interpolator::createDefaultInterpolator() {
     return new AccelerateDecelerateInterpolator();
 }
 
+void Interpolator::batchInterpolate(float* values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        values[i] = interpolate(values[i]);
+    }
+}
+
 float AccelerateDecelerateInterpolator::interpolate(float input) {
     return (float)(cosf((input + 1) * M_PI) / 2.0f) + 0.5f;
 }
 
+void AccelerateDecelerateInterpolator::batchInterpolate(float* values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        values[i] = AccelerateDecelerateInterpolator::interpolate(values[i]);
+    }
+}
+
 float AccelerateInterpolator::interpolate(float input) {
     if (mFactor == 1.0f) {
         return input * input;
@@ -41,6 +54,18 @@ float AccelerateInterpolator::interpolate(float input) {
     }
 }
 
+void AccelerateInterpolator::batchInterpolate(float* values, size_t count) {
+    if (mFactor == 1.0f) {
+        for (size_t i = 0; i < count; i++) {
+            values[i] = values[i] * values[i];
+        }
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            values[i] = pow(values[i], mDoubleFactor);
+        }
+    }
+}
+
 float AnticipateInterpolator::interpolate(float t) {
     return t * t * ((mTension + 1) * t - mTension);
 }
@@ -90,6 +115,18 @@ float DecelerateInterpolator::interpolate(float input) {
     return result;
 }
 
+void DecelerateInterpolator::batchInterpolate(float* values, size_t count) {
+    if (mFactor == 1.0f) {
+        for (size_t i = 0; i < count; i++) {
+            values[i] = 1.0f - (1.0f - values[i]) * (1.0f - values[i]);
+        }
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            values[i] = 1.0f - pow((1.0f - values[i]), 2 * mFactor);
+        }
+    }
+}
+
 float OvershootInterpolator::interpolate(float t) {
     t -= 1.0f;
     return t * t * ((mTension + 1) * t + mTension) + 1.0f;
@@ -127,6 +164,14 @@ float PathInterpolator::interpolate(float t) {
     return startY + (fraction * (endY - startY));
 }
 
+bool PathInterpolator::isEquivalent(const Interpolator& other) const {
+    if (other.kind() != kind()) {
+        return false;
+    }
+    const PathInterpolator& path = static_cast<const PathInterpolator&>(other);
+    return path.mX == mX && path.mY == mY;
+}
+
 LUTInterpolator::LUTInterpolator(float* values, size_t size) : mValues(values), mSize(size) {}
 
 LUTInterpolator::~LUTInterpolator() {}
@@ -156,5 +201,21 @@ float LUTInterpolator::interpolate(float input) {
     return MathUtils::lerp(v1, v2, weight);
 }
 
+void LUTInterpolator::batchInterpolate(float* values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        values[i] = LUTInterpolator::interpolate(values[i]);
+    }
+}
+
+bool LUTInterpolator::isEquivalent(const Interpolator& other) const {
+    if (other.kind() != kind()) {
+        return false;
+    }
+    const LUTInterpolator& lut = static_cast<const LUTInterpolator&>(other);
+    return lut.mSize == mSize &&
+           (lut.mValues == mValues ||
+            !memcmp(lut.mValues.get(), mValues.get(), mSize * sizeof(float)));
+}
+
 } /* namespace uirenderer */
 } /* namespace android */
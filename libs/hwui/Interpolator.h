@@ -27,10 +27,39 @@ namespace uirenderer {
 
 class Interpolator {
 public:
+    // Interpolators are built without RTTI, kind() lets isEquivalent check the type of "other"
+    enum class Kind {
+        AccelerateDecelerate,
+        Accelerate,
+        Anticipate,
+        AnticipateOvershoot,
+        Bounce,
+        Cycle,
+        Decelerate,
+        Linear,
+        Overshoot,
+        Path,
+        LUT,
+    };
+
     virtual ~Interpolator() {}
 
     virtual float interpolate(float input) = 0;
 
+    /**
+     * Interpolates "count" inputs in place. Subclasses override it with a loop the compiler can
+     * inline and vectorize, the default calls interpolate(float) for each input.
+     */
+    virtual void batchInterpolate(float* values, size_t count);
+
+    /**
+     * Returns true if "other" computes the same curve, in which case the inputs of both can be
+     * interpolated by a single batchInterpolate call of either one.
+     */
+    virtual bool isEquivalent(const Interpolator& other) const { return other.kind() == kind(); }
+
+    virtual Kind kind() const = 0;
+
     static Interpolator* createDefaultInterpolator();
 
 protected:
@@ -40,12 +69,20 @@ protected:
 class ANDROID_API AccelerateDecelerateInterpolator : public Interpolator {
 public:
     virtual float interpolate(float input) override;
+    virtual void batchInterpolate(float* values, size_t count) override;
+    virtual Kind kind() const override { return Kind::AccelerateDecelerate; }
 };
 
 class ANDROID_API AccelerateInterpolator : public Interpolator {
 public:
     explicit AccelerateInterpolator(float factor) : mFactor(factor), mDoubleFactor(factor * 2) {}
     virtual float interpolate(float input) override;
+    virtual void batchInterpolate(float* values, size_t count) override;
+    virtual bool isEquivalent(const Interpolator& other) const override {
+        return other.kind() == kind() &&
+               static_cast<const AccelerateInterpolator&>(other).mFactor == mFactor;
+    }
+    virtual Kind kind() const override { return Kind::Accelerate; }
 
 private:
     const float mFactor;
@@ -56,6 +93,11 @@ class ANDROID_API AnticipateInterpolator : public Interpolator {
 public:
     explicit AnticipateInterpolator(float tension) : mTension(tension) {}
     virtual float interpolate(float input) override;
+    virtual bool isEquivalent(const Interpolator& other) const override {
+        return other.kind() == kind() &&
+               static_cast<const AnticipateInterpolator&>(other).mTension == mTension;
+    }
+    virtual Kind kind() const override { return Kind::Anticipate; }
 
 private:
     const float mTension;
@@ -65,6 +107,11 @@ class ANDROID_API AnticipateOvershootInterpolator : public Interpolator {
 public:
     explicit AnticipateOvershootInterpolator(float tension) : mTension(tension) {}
     virtual float interpolate(float input) override;
+    virtual bool isEquivalent(const Interpolator& other) const override {
+        return other.kind() == kind() &&
+               static_cast<const AnticipateOvershootInterpolator&>(other).mTension == mTension;
+    }
+    virtual Kind kind() const override { return Kind::AnticipateOvershoot; }
 
 private:
     const float mTension;
@@ -73,12 +120,18 @@ private:
 class ANDROID_API BounceInterpolator : public Interpolator {
 public:
     virtual float interpolate(float input) override;
+    virtual Kind kind() const override { return Kind::Bounce; }
 };
 
 class ANDROID_API CycleInterpolator : public Interpolator {
 public:
     explicit CycleInterpolator(float cycles) : mCycles(cycles) {}
     virtual float interpolate(float input) override;
+    virtual bool isEquivalent(const Interpolator& other) const override {
+        return other.kind() == kind() &&
+               static_cast<const CycleInterpolator&>(other).mCycles == mCycles;
+    }
+    virtual Kind kind() const override { return Kind::Cycle; }
 
 private:
     const float mCycles;
@@ -88,6 +141,12 @@ class ANDROID_API DecelerateInterpolator : public Interpolator {
 public:
     explicit DecelerateInterpolator(float factor) : mFactor(factor) {}
     virtual float interpolate(float input) override;
+    virtual void batchInterpolate(float* values, size_t count) override;
+    virtual bool isEquivalent(const Interpolator& other) const override {
+        return other.kind() == kind() &&
+               static_cast<const DecelerateInterpolator&>(other).mFactor == mFactor;
+    }
+    virtual Kind kind() const override { return Kind::Decelerate; }
 
 private:
     const float mFactor;
@@ -96,12 +155,19 @@ private:
 class ANDROID_API LinearInterpolator : public Interpolator {
 public:
     virtual float interpolate(float input) override { return input; }
+    virtual void batchInterpolate(float* values, size_t count) override {}
+    virtual Kind kind() const override { return Kind::Linear; }
 };
 
 class ANDROID_API OvershootInterpolator : public Interpolator {
 public:
     explicit OvershootInterpolator(float tension) : mTension(tension) {}
     virtual float interpolate(float input) override;
+    virtual bool isEquivalent(const Interpolator& other) const override {
+        return other.kind() == kind() &&
+               static_cast<const OvershootInterpolator&>(other).mTension == mTension;
+    }
+    virtual Kind kind() const override { return Kind::Overshoot; }
 
 private:
     const float mTension;
@@ -111,6 +177,8 @@ class ANDROID_API PathInterpolator : public Interpolator {
 public:
     explicit PathInterpolator(std::vector<float>&& x, std::vector<float>&& y) : mX(x), mY(y) {}
     virtual float interpolate(float input) override;
+    virtual bool isEquivalent(const Interpolator& other) const override;
+    virtual Kind kind() const override { return Kind::Path; }
 
 private:
     std::vector<float> mX;
@@ -123,6 +191,9 @@ public:
     ~LUTInterpolator();
 
     virtual float interpolate(float input) override;
+    virtual void batchInterpolate(float* values, size_t count) override;
+    virtual bool isEquivalent(const Interpolator& other) const override;
+    virtual Kind kind() const override { return Kind::LUT; }
 
 private:
     std::unique_ptr<float[]> mValues;
@@ -17,6 +17,7 @@
 #define JANKTRACKER_H_
 
 #include "FrameInfo.h"
+#include "FrameStatsRing.h"
 #include "ProfileData.h"
 #include "ProfileDataContainer.h"
 #include "renderthread/TimeLord.h"
@@ -59,6 +60,10 @@ public:
     FrameInfo* startFrame() { return &mFrames.next(); }
     void finishFrame(const FrameInfo& frame);
 
+    // Mirrors every finished frame into the given ashmem region, see FrameStatsRing.h
+    // for the layout
+    void setFrameStatsRing(int ashmemfd) { mFrameStatsRing.switchStorageToAshmem(ashmemfd); }
+
     void dumpStats(int fd) { dumpData(fd, &mDescription, mData.get()); }
     void dumpFrames(int fd);
     void reset();
@@ -90,6 +95,8 @@ private:
 
     // Ring buffer large enough for 2 seconds worth of frames
     RingBuffer<FrameInfo, 120> mFrames;
+
+    FrameStatsRing mFrameStatsRing;
 };
 
 } /* namespace uirenderer */
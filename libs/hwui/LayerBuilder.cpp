@@ -246,6 +246,7 @@ void LayerBuilder::onDeferOp(LinearAllocator& allocator, const BakedOpState* bak
                         !Properties::debugOverdraw)) {
             // discard all deferred drawing ops, since new one will occlude them
             clear();
+            mOccludedPriorOps = true;
         }
     }
 }
@@ -281,6 +282,27 @@ void LayerBuilder::flushLayerClears(LinearAllocator& allocator) {
     }
 }
 
+void LayerBuilder::appendBatches(LinearAllocator& allocator, const LayerBuilder& other) {
+    flushLayerClears(allocator);
+    if (other.mOccludedPriorOps) {
+        // the other builder would have discarded our ops if it had deferred into us
+        clear();
+        mOccludedPriorOps = true;
+    }
+
+    mBatches.insert(mBatches.end(), other.mBatches.begin(), other.mBatches.end());
+
+    // appended batches are the most recent of their ids, later ops should target them
+    for (int i = 0; i < OpBatchType::Count; i++) {
+        if (other.mBatchLookup[i]) {
+            mBatchLookup[i] = other.mBatchLookup[i];
+        }
+        for (auto& entry : other.mMergingBatchLookup[i]) {
+            mMergingBatchLookup[i][entry.first] = entry.second;
+        }
+    }
+}
+
 void LayerBuilder::deferUnmergeableOp(LinearAllocator& allocator, BakedOpState* op,
                                       batchid_t batchId) {
     onDeferOp(allocator, op);
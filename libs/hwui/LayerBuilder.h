@@ -97,6 +97,12 @@ public:
 
     void deferLayerClear(const Rect& dstRect);
 
+    /**
+     * Appends all batches of another builder, whose ops were deferred separately but draw after
+     * everything already deferred here. Batch memory stays owned by the other builder's allocator.
+     */
+    void appendBatches(LinearAllocator& allocator, const LayerBuilder& other);
+
     bool empty() const { return mBatches.empty(); }
 
     void clear();
@@ -131,6 +137,9 @@ private:
     OpBatch* mBatchLookup[OpBatchType::Count] = {nullptr};
 
     std::vector<Rect> mClearRects;
+
+    // Set when an opaque op covering the repaint rect discarded previously deferred ops
+    bool mOccludedPriorOps = false;
 };
 
 };  // namespace uirenderer
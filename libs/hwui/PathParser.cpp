@@ -99,10 +99,99 @@ static void extract(int* outEndPosition, bool* outEndWithNegOrDot, const char* s
     *outEndPosition = currentIndex;
 }
 
+// Powers of ten that are exactly representable as doubles
+static const double kExactPowersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                           1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                           1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+static const int kMaxExactPowerOfTen = 22;
+// Mantissas with at most that many digits are exact doubles
+static const int kMaxExactDigits = 15;
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/**
+ * Parses the numbers found in path strings, an optional sign, digits with an optional fraction
+ * and an optional exponent, without the locale and errno handling of strtof. The mantissa and
+ * the power of ten are both exact as doubles, so the double result is correctly rounded, and
+ * rounding it to a float only differs from strtof within a double ulp of halfway between two
+ * floats.
+ *
+ * Returns false for anything else, including values that don't fit that fast path, which are
+ * left to strtof.
+ */
+static bool parseSimpleFloat(const char* s, const char* end, float* outValue) {
+    const char* p = s;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool hasDigits = false;
+    for (; p < end && isDigit(*p); p++) {
+        hasDigits = true;
+        if (mantissa || *p != '0') {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits++;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && isDigit(*p); p++) {
+            hasDigits = true;
+            if (mantissa || *p != '0') {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits++;
+            }
+            exponent--;
+        }
+    }
+    if (!hasDigits || digits > kMaxExactDigits) {
+        return false;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negativeExponent = *p == '-';
+            p++;
+        }
+        if (p == end || !isDigit(*p)) {
+            return false;
+        }
+        int explicitExponent = 0;
+        for (; p < end && isDigit(*p); p++) {
+            if (explicitExponent > kMaxExactPowerOfTen * 10) {
+                return false;
+            }
+            explicitExponent = explicitExponent * 10 + (*p - '0');
+        }
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+    if (exponent < -kMaxExactPowerOfTen || exponent > kMaxExactPowerOfTen) {
+        return false;
+    }
+    double value = mantissa;
+    if (exponent < 0) {
+        value /= kExactPowersOfTen[-exponent];
+    } else {
+        value *= kExactPowersOfTen[exponent];
+    }
+    *outValue = negative ? -value : value;
+    return true;
+}
+
 static float parseFloat(PathParser::ParseResult* result, const char* startPtr,
-                        size_t expectedLength) {
+                        const char* rangeEnd, size_t expectedLength) {
+    float currentValue;
+    if (parseSimpleFloat(startPtr, rangeEnd, &currentValue)) {
+        return currentValue;
+    }
     char* endPtr = NULL;
-    float currentValue = strtof(startPtr, &endPtr);
+    currentValue = strtof(startPtr, &endPtr);
     if ((currentValue == HUGE_VALF || currentValue == -HUGE_VALF) && errno == ERANGE) {
         result->failureOccurred = true;
         result->failureMessage = "Float out of range:  ";
@@ -118,7 +207,7 @@ static float parseFloat(PathParser::ParseResult* result, const char* startPtr,
 }
 
 /**
- * Parse the floats in the string.
+ * Parse the floats in the string, and append them to outPoints.
  *
  * @param s the string containing a command and list of floats
  * @return true on success
@@ -139,7 +228,8 @@ static void getFloats(std::vector<float>* outPoints, PathParser::ParseResult* re
         extract(&endPosition, &endWithNegOrDot, pathStr, startPosition, end);
 
         if (startPosition < endPosition) {
-            float currentValue = parseFloat(result, &pathStr[startPosition], end - startPosition);
+            float currentValue = parseFloat(result, &pathStr[startPosition], &pathStr[end],
+                                            end - startPosition);
             if (result->failureOccurred) {
                 return;
             }
@@ -235,20 +325,36 @@ void PathParser::getPathDataFromAsciiString(PathData* data, ParseResult* result,
     }
     size_t end = start + 1;
 
+    // Reserve for the whole path up front instead of growing for each verb. Consecutive numbers
+    // are separated by at least one character, unless the next one starts with its sign or dot,
+    // so there are at most (length + 1) / 2 of them.
+    const bool reserved = data->verbs.empty() && data->points.empty();
+    if (reserved) {
+        size_t verbCount = 0;
+        for (size_t i = nextStart(pathStr, strLen, start); i < strLen;
+             i = nextStart(pathStr, strLen, i + 1)) {
+            verbCount++;
+        }
+        data->verbs.reserve(verbCount);
+        data->verbSizes.reserve(verbCount);
+        data->points.reserve((strLen - start + 1) / 2);
+    }
+
     while (end < strLen) {
         end = nextStart(pathStr, strLen, end);
-        std::vector<float> points;
-        getFloats(&points, result, pathStr, start, end);
-        validateVerbAndPoints(pathStr[start], points.size(), result);
+        const size_t pointsStart = data->points.size();
+        getFloats(&data->points, result, pathStr, start, end);
+        const size_t pointCount = data->points.size() - pointsStart;
+        validateVerbAndPoints(pathStr[start], pointCount, result);
         if (result->failureOccurred) {
             // If either verb or points is not valid, return immediately.
+            data->points.resize(pointsStart);
             result->failureMessage += "Failure occurred at position " +
                                      std::to_string(start) + " of path: " + pathStr;
             return;
         }
         data->verbs.push_back(pathStr[start]);
-        data->verbSizes.push_back(points.size());
-        data->points.insert(data->points.end(), points.begin(), points.end());
+        data->verbSizes.push_back(pointCount);
         start = end;
         end++;
     }
@@ -264,6 +370,10 @@ void PathParser::getPathDataFromAsciiString(PathData* data, ParseResult* result,
         data->verbs.push_back(pathStr[start]);
         data->verbSizes.push_back(0);
     }
+    if (reserved) {
+        // the estimate is loose for paths with long numbers, PathData outlives the parse
+        data->points.shrink_to_fit();
+    }
 }
 
 void PathParser::dump(const PathData& data) {
@@ -36,6 +36,17 @@ bool Properties::showDirtyRegions = false;
 bool Properties::skipEmptyFrames = true;
 bool Properties::useBufferAge = true;
 bool Properties::enablePartialUpdates = true;
+bool Properties::enableParallelDeferral = false;
+bool Properties::enableDeferredRecording = false;
+bool Properties::enableShaderCacheWarmUp = true;
+int Properties::vulkanFramesInFlight = 2;
+bool Properties::enableAsyncGlyphRaster = false;
+bool Properties::enableAsyncTextureUpload = false;
+bool Properties::profileRenderNodeGpu = false;
+bool Properties::enableDeadlineScheduling = false;
+bool Properties::enableAdaptiveCacheBudget = false;
+bool Properties::compactRecordedOps = false;
+int Properties::animatedImagePrefetchFrames = 2;
 
 DebugLevel Properties::debugLevel = kDebugDisabled;
 OverdrawColorSet Properties::overdrawColorSet = OverdrawColorSet::Default;
@@ -135,6 +146,19 @@ bool Properties::load() {
     skipEmptyFrames = property_get_bool(PROPERTY_SKIP_EMPTY_DAMAGE, true);
     useBufferAge = property_get_bool(PROPERTY_USE_BUFFER_AGE, true);
     enablePartialUpdates = property_get_bool(PROPERTY_ENABLE_PARTIAL_UPDATES, true);
+    enableParallelDeferral = property_get_bool(PROPERTY_ENABLE_PARALLEL_DEFER, false);
+    enableDeferredRecording = property_get_bool(PROPERTY_ENABLE_DEFERRED_RECORDING, false);
+    enableShaderCacheWarmUp = property_get_bool(PROPERTY_SHADER_CACHE_WARM_UP, true);
+    vulkanFramesInFlight =
+            std::max(1, std::min(property_get_int(PROPERTY_VULKAN_FRAMES_IN_FLIGHT, 2), 3));
+    enableAsyncGlyphRaster = property_get_bool(PROPERTY_ASYNC_GLYPH_RASTER, false);
+    enableAsyncTextureUpload = property_get_bool(PROPERTY_ASYNC_TEXTURE_UPLOAD, false);
+    profileRenderNodeGpu = property_get_bool(PROPERTY_PROFILE_RENDER_NODE_GPU, false);
+    enableDeadlineScheduling = property_get_bool(PROPERTY_DEADLINE_SCHEDULING, false);
+    enableAdaptiveCacheBudget = property_get_bool(PROPERTY_ADAPTIVE_CACHE_BUDGET, false);
+    compactRecordedOps = property_get_bool(PROPERTY_COMPACT_RECORDED_OPS, false);
+    animatedImagePrefetchFrames = std::max(
+            1, std::min(property_get_int(PROPERTY_ANIMATED_IMAGE_PREFETCH_FRAMES, 2), 4));
 
     filterOutTestOverhead = property_get_bool(PROPERTY_FILTER_TEST_OVERHEAD, false);
 
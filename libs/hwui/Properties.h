@@ -136,6 +136,77 @@ enum DebugLevel {
  */
 #define PROPERTY_SKIP_EMPTY_DAMAGE "debug.hwui.skip_empty_damage"
 
+/**
+ * Setting this property to "true" lets the OpenGL pipeline defer independent sibling
+ * RenderNode subtrees on worker threads. Default is "false".
+ */
+#define PROPERTY_ENABLE_PARALLEL_DEFER "debug.hwui.parallel_defer"
+
+/**
+ * Setting this property to "true" lets the Skia OpenGL pipeline record frames without layers,
+ * functors or vector drawables on a worker thread while the RenderThread prepares the surface.
+ * Default is "false".
+ */
+#define PROPERTY_ENABLE_DEFERRED_RECORDING "debug.hwui.deferred_recording"
+
+/**
+ * Setting this property to "false" stops the Skia shader cache from staging its most used
+ * entries in memory on a background thread at startup. Default is "true".
+ */
+#define PROPERTY_SHADER_CACHE_WARM_UP "debug.hwui.shader_cache_warm_up"
+
+/**
+ * Number of frames the Vulkan pipeline lets the RenderThread record ahead of the GPU, between
+ * 1 and 3. Default is 2.
+ */
+#define PROPERTY_VULKAN_FRAMES_IN_FLIGHT "debug.hwui.vulkan_frames_in_flight"
+
+/**
+ * Setting this property to "true" makes the OpenGL pipeline rasterize the glyphs missing from
+ * the font cache on worker threads while the frame is being deferred. Default is "false".
+ */
+#define PROPERTY_ASYNC_GLYPH_RASTER "debug.hwui.async_glyph_raster"
+
+/**
+ * Setting this property to "true" makes the OpenGL pipeline upload large bitmaps on a separate
+ * thread. Bitmaps aren't drawn until their first upload is done. Default is "false".
+ */
+#define PROPERTY_ASYNC_TEXTURE_UPLOAD "debug.hwui.async_texture_upload"
+
+/**
+ * Setting this property to "true" times the GPU work of each RenderNode in the OpenGL and
+ * SkiaGL pipelines, and reports it to FrameMetricsObservers. Flushes the GPU work of each
+ * node separately, so frames take longer. Default is "false".
+ */
+#define PROPERTY_PROFILE_RENDER_NODE_GPU "debug.hwui.profile_render_node_gpu"
+
+/**
+ * Setting this property to "true" makes the RenderThread skip RenderThread animation frames that
+ * are expected to miss their deadline while recent frames already missed theirs, and postpone
+ * vector drawable atlas repacks until frames meet their deadline again. Default is "false".
+ */
+#define PROPERTY_DEADLINE_SCHEDULING "debug.hwui.deadline_scheduling"
+
+/**
+ * Setting this property to "true" lets the Skia pipelines grow the GPU resource cache budget, up
+ * to twice its screen size based default, when frames miss their deadline with a full cache, and
+ * shrink it when the app is asked to trim its memory. Default is "false".
+ */
+#define PROPERTY_ADAPTIVE_CACHE_BUDGET "debug.hwui.adaptive_cache_budget"
+
+/**
+ * Setting this property to "true" makes the RecordingCanvas of the OpenGL pipeline record
+ * consecutive filled, non antialiased rects that share their paint, transform and clip as a
+ * single op. Default is "false".
+ */
+#define PROPERTY_COMPACT_RECORDED_OPS "debug.hwui.compact_recorded_ops"
+
+/**
+ * Number of frames each AnimatedImageDrawable decodes ahead of the one it shows, from 1 to 4.
+ * Default is 2.
+ */
+#define PROPERTY_ANIMATED_IMAGE_PREFETCH_FRAMES "debug.hwui.animated_image_prefetch_frames"
+
 /**
  * Controls whether or not HWUI will use the EGL_EXT_buffer_age extension
  * to do partial invalidates. Setting this to "false" will fall back to
@@ -220,6 +291,17 @@ public:
     static bool skipEmptyFrames;
     static bool useBufferAge;
     static bool enablePartialUpdates;
+    static bool enableParallelDeferral;
+    static bool enableDeferredRecording;
+    static bool enableShaderCacheWarmUp;
+    static int vulkanFramesInFlight;
+    static bool enableAsyncGlyphRaster;
+    static bool enableAsyncTextureUpload;
+    static bool profileRenderNodeGpu;
+    static bool enableDeadlineScheduling;
+    static bool enableAdaptiveCacheBudget;
+    static bool compactRecordedOps;
+    static int animatedImagePrefetchFrames;
 
     // TODO: Move somewhere else?
     static constexpr float textGamma = 1.45f;
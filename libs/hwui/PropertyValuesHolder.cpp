@@ -51,6 +51,27 @@ void PathEvaluator::evaluate(PathData* out, const PathData& from, const PathData
     VectorDrawableUtils::interpolatePaths(out, from, to, fraction);
 }
 
+// Float keyframes are lerped inline rather than through the virtual FloatEvaluator, as the
+// group, path and root alpha holders evaluate them for every frame.
+template <>
+const float PropertyValuesHolderImpl<float>::getValueFromData(float fraction) const {
+    if (mDataSource.size() == 0) {
+        LOG_ALWAYS_FATAL("No data source is defined");
+        return 0;
+    }
+    if (fraction <= 0.0f) {
+        return mDataSource.front();
+    }
+    if (fraction >= 1.0f) {
+        return mDataSource.back();
+    }
+
+    fraction *= mDataSource.size() - 1;
+    int lowIndex = floor(fraction);
+    fraction -= lowIndex;
+    return lerp(mDataSource[lowIndex], mDataSource[lowIndex + 1], fraction);
+}
+
 template <typename T>
 const T PropertyValuesHolderImpl<T>::getValueFromData(float fraction) const {
     if (mDataSource.size() == 0) {
@@ -99,8 +120,40 @@ void FullPathPropertyValuesHolder::setFraction(float fraction) {
     mFullPath->mutateProperties()->setPropertyValue(mPropertyId, animatedValue);
 }
 
+PathDataPropertyValuesHolder::PathDataPropertyValuesHolder(VectorDrawable::Path* ptr,
+                                                           PathData* startValue,
+                                                           PathData* endValue)
+        : PropertyValuesHolderImpl(*startValue, *endValue), mPath(ptr), mPathData(*startValue) {
+    mEvaluator.reset(new PathEvaluator());
+    const std::vector<float>& from = mStartValue.points;
+    const std::vector<float>& to = mEndValue.points;
+    if (from.size() == to.size()) {
+        mPointDeltas.resize(from.size());
+        for (size_t i = 0; i < from.size(); i++) {
+            mPointDeltas[i] = to[i] - from[i];
+        }
+    }
+}
+
+void PathDataPropertyValuesHolder::interpolatePoints(float* __restrict__ out,
+                                                     const float* __restrict__ from,
+                                                     const float* __restrict__ delta, size_t count,
+                                                     float fraction) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = from[i] + delta[i] * fraction;
+    }
+}
+
 void PathDataPropertyValuesHolder::setFraction(float fraction) {
-    mEvaluator->evaluate(&mPathData, mStartValue, mEndValue, fraction);
+    if (mPointDeltas.size() != mStartValue.points.size()) {
+        mEvaluator->evaluate(&mPathData, mStartValue, mEndValue, fraction);
+    } else if (fraction <= 0.0f || fraction >= 1.0f) {
+        // Land exactly on the keyframes rather than on their rounded interpolation
+        mPathData.points = fraction <= 0.0f ? mStartValue.points : mEndValue.points;
+    } else {
+        interpolatePoints(mPathData.points.data(), mStartValue.points.data(),
+                          mPointDeltas.data(), mPointDeltas.size(), fraction);
+    }
     mPath->mutateProperties()->setData(mPathData);
 }
 
@@ -135,15 +135,20 @@ private:
 class ANDROID_API PathDataPropertyValuesHolder : public PropertyValuesHolderImpl<PathData> {
 public:
     PathDataPropertyValuesHolder(VectorDrawable::Path* ptr, PathData* startValue,
-                                 PathData* endValue)
-            : PropertyValuesHolderImpl(*startValue, *endValue), mPath(ptr) {
-        mEvaluator.reset(new PathEvaluator());
-    };
+                                 PathData* endValue);
     void setFraction(float fraction) override;
+    // Interpolates count points as from + delta * fraction, the loop is kept free of aliasing
+    // so that it gets vectorized.
+    static void interpolatePoints(float* out, const float* from, const float* delta, size_t count,
+                                  float fraction);
 
 private:
     VectorDrawable::Path* mPath;
+    // Holds the verbs of the start value from construction on, only its points change per frame.
     PathData mPathData;
+    // end - start for each point, precomputed so a frame is a single multiply-add per point.
+    // Empty if the two paths don't have the same number of points.
+    std::vector<float> mPointDeltas;
 };
 
 class ANDROID_API RootAlphaPropertyValuesHolder : public PropertyValuesHolderImpl<float> {
@@ -17,6 +17,7 @@
 #include "RecordingCanvas.h"
 
 #include "DeferredLayerUpdater.h"
+#include "Properties.h"
 #include "RecordedOp.h"
 #include "RenderNode.h"
 #include "VectorDrawable.h"
@@ -41,10 +42,12 @@ void RecordingCanvas::resetRecording(int width, int height, RenderNode* node) {
     mState.initializeRecordingSaveStack(width, height);
 
     mDeferredBarrierType = DeferredBarrierType::InOrder;
+    mPendingRects.clear();
 }
 
 DisplayList* RecordingCanvas::finishRecording() {
     restoreToCount(1);
+    flushPendingRects();
     mPaintMap.clear();
     mRegionMap.clear();
     mPathMap.clear();
@@ -55,6 +58,8 @@ DisplayList* RecordingCanvas::finishRecording() {
 }
 
 void RecordingCanvas::insertReorderBarrier(bool enableReorder) {
+    // rects drawn before the barrier belong to the current chunk
+    flushPendingRects();
     if (enableReorder) {
         mDeferredBarrierType = DeferredBarrierType::OutOfOrder;
         mDeferredBarrierClip = getRecordedClip();
@@ -278,14 +283,58 @@ void RecordingCanvas::drawRect(float left, float top, float right, float bottom,
                                const SkPaint& paint) {
     if (CC_UNLIKELY(paint.nothingToDraw())) return;
 
+    if (Properties::compactRecordedOps && paint.getStyle() == SkPaint::kFill_Style &&
+        !paint.isAntiAlias() && !paint.getPathEffect() && left < right && top < bottom) {
+        const SkPaint* recordedPaint = refPaint(&paint);
+        const ClipBase* recordedClip = getRecordedClip();
+        const Matrix4& transform = *(mState.currentSnapshot()->transform);
+        if (mPendingRects.empty() || recordedPaint != mPendingRectsPaint ||
+            recordedClip != mPendingRectsClip || transform != mPendingRectsTransform) {
+            flushPendingRects();
+            mPendingRectsPaint = recordedPaint;
+            mPendingRectsClip = recordedClip;
+            mPendingRectsTransform = transform;
+        }
+        mPendingRects.insert(mPendingRects.end(), {left, top, right, bottom});
+        return;
+    }
+
     addOp(alloc().create_trivial<RectOp>(Rect(left, top, right, bottom),
                                          *(mState.currentSnapshot()->transform), getRecordedClip(),
                                          refPaint(&paint)));
 }
 
+void RecordingCanvas::flushPendingRects() {
+    if (mPendingRects.empty()) return;
+
+    // cleared first, since addOp flushes pending rects
+    std::vector<float> rects;
+    rects.swap(mPendingRects);
+    if (rects.size() == 4) {
+        // a lone rect keeps its own op, so that it can still be used to avoid overdraw
+        addOp(alloc().create_trivial<RectOp>(Rect(rects[0], rects[1], rects[2], rects[3]),
+                                             mPendingRectsTransform, mPendingRectsClip,
+                                             mPendingRectsPaint));
+    } else {
+        addSimpleRectsOp(rects.data(), rects.size(), mPendingRectsTransform, mPendingRectsClip,
+                         mPendingRectsPaint);
+    }
+    // hand the storage back, so that long recordings don't reallocate it for every run
+    rects.clear();
+    mPendingRects.swap(rects);
+}
+
 void RecordingCanvas::drawSimpleRects(const float* rects, int vertexCount, const SkPaint* paint) {
     if (rects == nullptr) return;
 
+    addSimpleRectsOp(rects, vertexCount, *(mState.currentSnapshot()->transform),
+                     getRecordedClip(), refPaint(paint));
+}
+
+void RecordingCanvas::addSimpleRectsOp(const float* rects, int vertexCount,
+                                       const Matrix4& transform, const ClipBase* clip,
+                                       const SkPaint* paint) {
+
     Vertex* rectData = (Vertex*)mDisplayList->allocator.create_trivial_array<Vertex>(vertexCount);
     Vertex* vertex = rectData;
 
@@ -309,9 +358,8 @@ void RecordingCanvas::drawSimpleRects(const float* rects, int vertexCount, const
         right = std::max(right, r);
         bottom = std::max(bottom, b);
     }
-    addOp(alloc().create_trivial<SimpleRectsOp>(
-            Rect(left, top, right, bottom), *(mState.currentSnapshot()->transform),
-            getRecordedClip(), refPaint(paint), rectData, vertexCount));
+    addOp(alloc().create_trivial<SimpleRectsOp>(Rect(left, top, right, bottom), transform, clip,
+                                                paint, rectData, vertexCount));
 }
 
 void RecordingCanvas::drawRegion(const SkRegion& region, const SkPaint& paint) {
@@ -578,6 +626,9 @@ void RecordingCanvas::callDrawGLFunction(Functor* functor, GlFunctorLifecycleLis
 }
 
 int RecordingCanvas::addOp(RecordedOp* op) {
+    // pending rects were drawn first
+    flushPendingRects();
+
     // skip op with empty clip
     if (op->localClip && op->localClip->rect.isEmpty()) {
         // NOTE: this rejection happens after op construction/content ref-ing, so content ref'd
@@ -203,6 +203,14 @@ private:
 
     void drawBitmap(Bitmap& bitmap, const SkPaint* paint);
     void drawSimpleRects(const float* rects, int vertexCount, const SkPaint* paint);
+    void addSimpleRectsOp(const float* rects, int vertexCount, const Matrix4& transform,
+                          const ClipBase* clip, const SkPaint* paint);
+
+    /**
+     * Adds the run of rects compacted by drawRect as a single op, a SimpleRectsOp when there is
+     * more than one of them.
+     */
+    void flushPendingRects();
 
     int addOp(RecordedOp* op);
     // ----------------------------------------------------------------------------
@@ -312,6 +320,14 @@ private:
     const ClipBase* mDeferredBarrierClip = nullptr;
     DisplayList* mDisplayList = nullptr;
     sk_sp<SkDrawFilter> mDrawFilter;
+
+    // Consecutive filled rects drawn with the same paint, transform and clip, recorded as one
+    // op once the run ends. Those three are already recorded, the rects are left, top, right,
+    // bottom quadruples.
+    std::vector<float> mPendingRects;
+    Matrix4 mPendingRectsTransform;
+    const ClipBase* mPendingRectsClip = nullptr;
+    const SkPaint* mPendingRectsPaint = nullptr;
 };  // class RecordingCanvas
 
 };  // namespace uirenderer
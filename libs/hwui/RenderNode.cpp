@@ -358,11 +358,15 @@ void RenderNode::syncDisplayList(TreeObserver& observer, TreeInfo* info) {
 void RenderNode::pushStagingDisplayListChanges(TreeObserver& observer, TreeInfo& info) {
     if (mNeedsDisplayListSync) {
         mNeedsDisplayListSync = false;
+        // Views often re-record identical content, e.g. when invalidated by a parent. The new
+        // list is still swapped in, but there's no need to redraw the area it covers.
+        const bool contentChanged = !mDisplayList || !mStagingDisplayList ||
+                                    !mStagingDisplayList->hasSameContent(*mDisplayList);
         // Damage with the old display list first then the new one to catch any
         // changes in isRenderable or, in the future, bounds
-        damageSelf(info);
+        if (contentChanged) damageSelf(info);
         syncDisplayList(observer, &info);
-        damageSelf(info);
+        if (contentChanged) damageSelf(info);
     }
 }
 
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RenderNodeGpuProfiler.h"
+
+#include "RenderNode.h"
+
+#include <GLES2/gl2ext.h>
+#include <utils/Log.h>
+
+#include <string.h>
+
+namespace android {
+namespace uirenderer {
+
+RenderNodeGpuProfiler* RenderNodeGpuProfiler::sActive = nullptr;
+
+std::unique_ptr<RenderNodeGpuProfiler> RenderNodeGpuProfiler::create() {
+    EGLContext context = eglGetCurrentContext();
+    if (context == EGL_NO_CONTEXT) return nullptr;
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    if (!extensions || !strstr(extensions, "GL_EXT_disjoint_timer_query")) {
+        ALOGW("RenderNodeGpuProfiler: GL_EXT_disjoint_timer_query isn't supported");
+        return nullptr;
+    }
+    // The extension doesn't require timestamps, only elapsed time queries, which can't nest
+    GLint timestampBits = 0;
+    glGetQueryivEXT(GL_TIMESTAMP_EXT, GL_QUERY_COUNTER_BITS_EXT, &timestampBits);
+    if (!timestampBits) {
+        ALOGW("RenderNodeGpuProfiler: GPU timestamps aren't supported");
+        return nullptr;
+    }
+    return std::unique_ptr<RenderNodeGpuProfiler>(new RenderNodeGpuProfiler(context));
+}
+
+RenderNodeGpuProfiler::~RenderNodeGpuProfiler() {
+    if (sActive == this) sActive = nullptr;
+    // Queries of a destroyed context are gone with it
+    if (eglGetCurrentContext() != mContext) return;
+    for (auto& frame : mFrames) {
+        recycle(frame);
+    }
+    if (!mFreeQueries.empty()) {
+        glDeleteQueriesEXT(mFreeQueries.size(), mFreeQueries.data());
+    }
+}
+
+GLuint RenderNodeGpuProfiler::obtainQuery() {
+    GLuint query = 0;
+    if (mFreeQueries.empty()) {
+        glGenQueriesEXT(1, &query);
+    } else {
+        query = mFreeQueries.back();
+        mFreeQueries.pop_back();
+    }
+    return query;
+}
+
+void RenderNodeGpuProfiler::recycle(FrameQueries& frame) {
+    for (auto& node : frame.nodes) {
+        mFreeQueries.push_back(node.beginQuery);
+        mFreeQueries.push_back(node.endQuery);
+    }
+    frame.nodes.clear();
+}
+
+void RenderNodeGpuProfiler::beginFrame(int64_t frameNumber) {
+    LOG_ALWAYS_FATAL_IF(sActive, "Already profiling a frame");
+    if (eglGetCurrentContext() != mContext) return;
+    sActive = this;
+    mFrames.push_back({frameNumber, {}, 0});
+    mOpenNodes.clear();
+}
+
+void RenderNodeGpuProfiler::endFrame() {
+    if (sActive != this) return;
+    sActive = nullptr;
+    // Nodes that didn't end, if drawing was aborted, have no valid end timestamp
+    FrameQueries& frame = mFrames.back();
+    while (!mOpenNodes.empty()) {
+        NodeQuery& node = frame.nodes[mOpenNodes.back()];
+        glQueryCounterEXT(node.endQuery, GL_TIMESTAMP_EXT);
+        frame.lastQuery = node.endQuery;
+        node.nodeId = 0;
+        mOpenNodes.pop_back();
+    }
+    if (frame.nodes.empty()) {
+        mFrames.pop_back();
+    }
+    while (mFrames.size() > kMaxPendingFrames) {
+        recycle(mFrames.front());
+        mFrames.pop_front();
+    }
+}
+
+bool RenderNodeGpuProfiler::beginNode(const RenderNode& node) {
+    FrameQueries& frame = mFrames.back();
+    if (frame.nodes.size() >= kMaxNodesPerFrame) return false;
+    NodeQuery query = {reinterpret_cast<uint64_t>(&node), node.getName(), obtainQuery(),
+                       obtainQuery()};
+    glQueryCounterEXT(query.beginQuery, GL_TIMESTAMP_EXT);
+    mOpenNodes.push_back(frame.nodes.size());
+    frame.nodes.push_back(std::move(query));
+    return true;
+}
+
+void RenderNodeGpuProfiler::endNode() {
+    LOG_ALWAYS_FATAL_IF(mOpenNodes.empty(), "endNode() without beginNode()");
+    FrameQueries& frame = mFrames.back();
+    frame.lastQuery = frame.nodes[mOpenNodes.back()].endQuery;
+    glQueryCounterEXT(frame.lastQuery, GL_TIMESTAMP_EXT);
+    mOpenNodes.pop_back();
+}
+
+bool RenderNodeGpuProfiler::isResultAvailable(GLuint query) {
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuivEXT(query, GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+    return available;
+}
+
+void RenderNodeGpuProfiler::collectResults(std::vector<RenderNodeGpuTime>* outTimes) {
+    if (sActive == this || eglGetCurrentContext() != mContext) return;
+    // Reading the disjoint state resets it, so it covers all the frames read below
+    GLint disjoint = GL_FALSE;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    while (!mFrames.empty()) {
+        FrameQueries& frame = mFrames.front();
+        if (!isResultAvailable(frame.lastQuery)) break;
+        if (!disjoint) {
+            for (auto& node : frame.nodes) {
+                if (!node.nodeId) continue;
+                GLuint64 begin = 0;
+                GLuint64 end = 0;
+                glGetQueryObjectui64vEXT(node.beginQuery, GL_QUERY_RESULT_EXT, &begin);
+                glGetQueryObjectui64vEXT(node.endQuery, GL_QUERY_RESULT_EXT, &end);
+                outTimes->push_back({frame.frameNumber, node.nodeId, std::move(node.name),
+                                     static_cast<int64_t>(end - begin)});
+            }
+        }
+        recycle(frame);
+        mFrames.pop_front();
+    }
+}
+
+};  // namespace uirenderer
+};  // namespace android
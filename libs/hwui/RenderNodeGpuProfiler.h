@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "utils/Macros.h"
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace uirenderer {
+
+class RenderNode;
+
+struct RenderNodeGpuTime {
+    int64_t frameNumber;
+    // Identifies the node for as long as it is alive
+    uint64_t nodeId;
+    std::string name;
+    // Includes the GPU time of the node's children
+    int64_t durationNanos;
+};
+
+/**
+ * Measures the GPU time spent drawing each RenderNode with GL_EXT_disjoint_timer_query
+ * timestamps, so that GPU bound frames can be attributed to views. Enabled with
+ * debug.hwui.profile_render_node_gpu for contexts with a FrameMetricsObserver.
+ *
+ * Timestamps are written around each node's draw, so the GPU work issued for the node must be
+ * submitted before beginNode() and endNode(), which for Skia means flushing the GrContext.
+ * Results are read a few frames later, once the GPU is done with them, and frames during which
+ * the GPU timer was disjoint are dropped.
+ *
+ * Only the first kMaxNodesPerFrame nodes of a frame, in draw order, are timed.
+ */
+class RenderNodeGpuProfiler {
+    PREVENT_COPY_AND_ASSIGN(RenderNodeGpuProfiler);
+
+public:
+    /**
+     * Returns a profiler for the current GL context, or nullptr if the context can't write
+     * GPU timestamps.
+     */
+    static std::unique_ptr<RenderNodeGpuProfiler> create();
+
+    ~RenderNodeGpuProfiler();
+
+    /**
+     * Returns the profiler of the frame being drawn, nullptr if it isn't profiled.
+     * RenderThread only.
+     */
+    static RenderNodeGpuProfiler* active() { return sActive; }
+
+    void beginFrame(int64_t frameNumber);
+    void endFrame();
+
+    /**
+     * Returns false if the node isn't timed, in which case endNode() must not be called for it.
+     */
+    bool beginNode(const RenderNode& node);
+    void endNode();
+
+    /**
+     * Appends the times of the frames whose results are available.
+     */
+    void collectResults(std::vector<RenderNodeGpuTime>* outTimes);
+
+private:
+    static const size_t kMaxNodesPerFrame = 64;
+    // Frames whose results still aren't available by then are dropped
+    static const size_t kMaxPendingFrames = 5;
+
+    struct NodeQuery {
+        uint64_t nodeId;
+        std::string name;
+        GLuint beginQuery;
+        GLuint endQuery;
+    };
+
+    struct FrameQueries {
+        int64_t frameNumber;
+        std::vector<NodeQuery> nodes;
+        // The timestamp written last, once it is available all of them are
+        GLuint lastQuery;
+    };
+
+    explicit RenderNodeGpuProfiler(EGLContext context) : mContext(context) {}
+
+    GLuint obtainQuery();
+    void recycle(FrameQueries& frame);
+    bool isResultAvailable(GLuint query);
+
+    static RenderNodeGpuProfiler* sActive;
+
+    // Queries are only valid in the context they were created in
+    const EGLContext mContext;
+    // Oldest first, the back is the frame being drawn while active
+    std::deque<FrameQueries> mFrames;
+    // Indices in the current frame of the nodes that began and didn't end yet
+    std::vector<size_t> mOpenNodes;
+    std::vector<GLuint> mFreeQueries;
+};
+
+};  // namespace uirenderer
+};  // namespace android
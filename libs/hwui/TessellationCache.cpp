@@ -21,6 +21,7 @@
 #include "PathTessellator.h"
 #include "ShadowTessellator.h"
 #include "TessellationCache.h"
+#include "TessellationDiskCache.h"
 
 #include "thread/Signal.h"
 #include "thread/Task.h"
@@ -66,13 +67,8 @@ bool TessellationCache::Description::operator==(const TessellationCache::Descrip
     if (style != rhs.style) return false;
     if (strokeWidth != rhs.strokeWidth) return false;
     if (type == Type::None) return true;
-    const Shape::RoundRect& lRect = shape.roundRect;
-    const Shape::RoundRect& rRect = rhs.shape.roundRect;
-
-    if (lRect.width != rRect.width) return false;
-    if (lRect.height != rRect.height) return false;
-    if (lRect.rx != rRect.rx) return false;
-    return lRect.ry == rRect.ry;
+    // unused shape bits are zeroed, like for the hash
+    return !memcmp(&shape, &rhs.shape, sizeof(Shape));
 }
 
 hash_t TessellationCache::Description::hash() const {
@@ -139,7 +135,12 @@ public:
     virtual void onProcess(const sp<Task<VertexBuffer*> >& task) override {
         TessellationTask* t = static_cast<TessellationTask*>(task.get());
         ATRACE_NAME("shape tessellation");
-        VertexBuffer* buffer = t->tessellator(t->description);
+        TessellationDiskCache& diskCache = TessellationDiskCache::get();
+        VertexBuffer* buffer = diskCache.loadShape(t->description);
+        if (!buffer) {
+            buffer = t->tessellator(t->description);
+            diskCache.storeShape(t->description, *buffer);
+        }
         t->setResult(buffer);
     }
 };
@@ -266,9 +267,13 @@ public:
         TessellationCache::ShadowTask* t = static_cast<TessellationCache::ShadowTask*>(task.get());
         ATRACE_NAME("shadow tessellation");
 
-        tessellateShadows(&t->drawTransform, &t->localClip, t->opaque, &t->casterPerimeter,
-                          &t->transformXY, &t->transformZ, t->lightCenter, t->lightRadius,
-                          t->ambientBuffer, t->spotBuffer);
+        TessellationDiskCache& diskCache = TessellationDiskCache::get();
+        if (!diskCache.loadShadows(*t)) {
+            tessellateShadows(&t->drawTransform, &t->localClip, t->opaque, &t->casterPerimeter,
+                              &t->transformXY, &t->transformZ, t->lightCenter, t->lightRadius,
+                              t->ambientBuffer, t->spotBuffer);
+            diskCache.storeShadows(*t);
+        }
 
         t->setResult(TessellationCache::vertexBuffer_pair_t(&t->ambientBuffer, &t->spotBuffer));
     }
@@ -440,5 +445,82 @@ const VertexBuffer* TessellationCache::getRoundRect(const Matrix4& transform, co
     return getRoundRectBuffer(transform, paint, width, height, rx, ry)->getVertexBuffer();
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Rect, Oval and Arc
+///////////////////////////////////////////////////////////////////////////////
+
+static SkRect getBoundsOfFill(const TessellationCache::Description& description, float width,
+                              float height) {
+    SkRect rect = SkRect::MakeWH(width, height);
+    if (description.style == SkPaint::kStrokeAndFill_Style) {
+        float outset = description.strokeWidth / 2;
+        rect.outset(outset, outset);
+    }
+    return rect;
+}
+
+static VertexBuffer* tessellateRect(const TessellationCache::Description& description) {
+    const TessellationCache::Description::Shape::Size& size = description.shape.size;
+    SkPath path;
+    path.addRect(getBoundsOfFill(description, size.width, size.height));
+    return tessellatePath(description, path);
+}
+
+static VertexBuffer* tessellateOval(const TessellationCache::Description& description) {
+    const TessellationCache::Description::Shape::Size& size = description.shape.size;
+    SkPath path;
+    path.addOval(getBoundsOfFill(description, size.width, size.height));
+    return tessellatePath(description, path);
+}
+
+static VertexBuffer* tessellateArc(const TessellationCache::Description& description) {
+    const TessellationCache::Description::Shape::Arc& arc = description.shape.arc;
+    SkPath path;
+    path.arcTo(getBoundsOfFill(description, arc.width, arc.height), arc.startAngle, arc.sweepAngle,
+               true);
+    return tessellatePath(description, path);
+}
+
+TessellationCache::Buffer* TessellationCache::getSizedShapeBuffer(Description::Type type,
+                                                                  const Matrix4& transform,
+                                                                  const SkPaint& paint, float width,
+                                                                  float height) {
+    Description entry(type, transform, paint);
+    entry.shape.size.width = width;
+    entry.shape.size.height = height;
+    return getOrCreateBuffer(entry, type == Description::Type::Rect ? &tessellateRect
+                                                                    : &tessellateOval);
+}
+
+const VertexBuffer* TessellationCache::getRect(const Matrix4& transform, const SkPaint& paint,
+                                               float width, float height) {
+    return getSizedShapeBuffer(Description::Type::Rect, transform, paint, width, height)
+            ->getVertexBuffer();
+}
+
+const VertexBuffer* TessellationCache::getOval(const Matrix4& transform, const SkPaint& paint,
+                                               float width, float height) {
+    return getSizedShapeBuffer(Description::Type::Oval, transform, paint, width, height)
+            ->getVertexBuffer();
+}
+
+TessellationCache::Buffer* TessellationCache::getArcBuffer(const Matrix4& transform,
+                                                           const SkPaint& paint, float width,
+                                                           float height, float startAngle,
+                                                           float sweepAngle) {
+    Description entry(Description::Type::Arc, transform, paint);
+    entry.shape.arc.width = width;
+    entry.shape.arc.height = height;
+    entry.shape.arc.startAngle = startAngle;
+    entry.shape.arc.sweepAngle = sweepAngle;
+    return getOrCreateBuffer(entry, &tessellateArc);
+}
+
+const VertexBuffer* TessellationCache::getArc(const Matrix4& transform, const SkPaint& paint,
+                                              float width, float height, float startAngle,
+                                              float sweepAngle) {
+    return getArcBuffer(transform, paint, width, height, startAngle, sweepAngle)->getVertexBuffer();
+}
+
 };  // namespace uirenderer
 };  // namespace android
@@ -55,6 +55,9 @@ public:
         enum class Type {
             None,
             RoundRect,
+            Rect,
+            Oval,
+            Arc,
         };
 
         Type type;
@@ -71,6 +74,18 @@ public:
                 float rx;
                 float ry;
             } roundRect;
+            // Rect and Oval
+            struct Size {
+                float width;
+                float height;
+            } size;
+            // stroked arcs without center
+            struct Arc {
+                float width;
+                float height;
+                float startAngle;
+                float sweepAngle;
+            } arc;
         } shape;
 
         Description();
@@ -150,7 +165,7 @@ public:
      */
     void trim();
 
-    // TODO: precache/get for Oval, Lines, Points, etc.
+    // TODO: precache/get for Lines, Points, etc.
 
     void precacheRoundRect(const Matrix4& transform, const SkPaint& paint, float width,
                            float height, float rx, float ry) {
@@ -159,6 +174,30 @@ public:
     const VertexBuffer* getRoundRect(const Matrix4& transform, const SkPaint& paint, float width,
                                      float height, float rx, float ry);
 
+    /**
+     * Rects, ovals and arcs are tessellated at the origin, with their size outset for
+     * kStrokeAndFill_Style like getBoundsOfFill(), and drawn translated to their bounds.
+     * Shapes of the same size and paint thus share one buffer, wherever they are drawn.
+     */
+    void precacheRect(const Matrix4& transform, const SkPaint& paint, float width, float height) {
+        getSizedShapeBuffer(Description::Type::Rect, transform, paint, width, height);
+    }
+    const VertexBuffer* getRect(const Matrix4& transform, const SkPaint& paint, float width,
+                                float height);
+
+    void precacheOval(const Matrix4& transform, const SkPaint& paint, float width, float height) {
+        getSizedShapeBuffer(Description::Type::Oval, transform, paint, width, height);
+    }
+    const VertexBuffer* getOval(const Matrix4& transform, const SkPaint& paint, float width,
+                                float height);
+
+    void precacheArc(const Matrix4& transform, const SkPaint& paint, float width, float height,
+                     float startAngle, float sweepAngle) {
+        getArcBuffer(transform, paint, width, height, startAngle, sweepAngle);
+    }
+    const VertexBuffer* getArc(const Matrix4& transform, const SkPaint& paint, float width,
+                               float height, float startAngle, float sweepAngle);
+
     sp<ShadowTask> getShadowTask(const Matrix4* drawTransform, const Rect& localClip, bool opaque,
                                  const SkPath* casterPerimeter, const Matrix4* transformXY,
                                  const Matrix4* transformZ, const Vector3& lightCenter,
@@ -179,6 +218,10 @@ private:
                           float height);
     Buffer* getRoundRectBuffer(const Matrix4& transform, const SkPaint& paint, float width,
                                float height, float rx, float ry);
+    Buffer* getSizedShapeBuffer(Description::Type type, const Matrix4& transform,
+                                const SkPaint& paint, float width, float height);
+    Buffer* getArcBuffer(const Matrix4& transform, const SkPaint& paint, float width,
+                         float height, float startAngle, float sweepAngle);
 
     Buffer* getOrCreateBuffer(const Description& entry, Tessellator tessellator);
 
@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TessellationDiskCache.h"
+
+#include "Vertex.h"
+#include "VertexBuffer.h"
+#include "pipeline/skia/ShaderBlobStore.h"
+#include "utils/Trace.h"
+
+#include <log/log.h>
+
+#include <string.h>
+#include <unistd.h>
+
+#include <thread>
+
+namespace android {
+namespace uirenderer {
+
+// Bump whenever the key or value layout, or the output of the tessellators, changes
+static const uint32_t kFormatVersion = 2;
+
+static const uint8_t kShapeKey = 'T';
+static const uint8_t kShadowKey = 'S';
+
+// Caster paths are part of the shadow keys, shadows of very complex paths aren't worth storing
+static const size_t kMaxKeySize = 4 * 1024;
+static const size_t kMaxValueSize = 256 * 1024;
+static const size_t kMaxTotalSize = 1024 * 1024;
+
+struct VertexBufferHeader {
+    uint32_t meshFeatureFlags;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    float bounds[4];
+};
+
+template <typename T>
+static void append(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void appendMatrix(std::string& out, const Matrix4& matrix) {
+    out.append(reinterpret_cast<const char*>(matrix.data), sizeof(matrix.data));
+}
+
+static size_t vertexSize(uint32_t meshFeatureFlags) {
+    return meshFeatureFlags & VertexBuffer::kAlpha ? sizeof(AlphaVertex) : sizeof(Vertex);
+}
+
+static void appendVertexBuffer(std::string& out, const VertexBuffer& buffer) {
+    VertexBufferHeader header;
+    header.meshFeatureFlags = buffer.getMeshFeatureFlags();
+    header.vertexCount = buffer.getVertexCount();
+    header.indexCount = buffer.getIndices() ? buffer.getIndexCount() : 0;
+    const Rect& bounds = buffer.getBounds();
+    header.bounds[0] = bounds.left;
+    header.bounds[1] = bounds.top;
+    header.bounds[2] = bounds.right;
+    header.bounds[3] = bounds.bottom;
+    append(out, header);
+    out.append(reinterpret_cast<const char*>(buffer.getBuffer()),
+               header.vertexCount * vertexSize(header.meshFeatureFlags));
+    out.append(reinterpret_cast<const char*>(buffer.getIndices()),
+               header.indexCount * sizeof(uint16_t));
+}
+
+/**
+ * Reads the header of the buffer stored at offset, and advances offset past the buffer.
+ * Returns false if the data is too short to hold it.
+ */
+static bool readVertexBufferHeader(const SkData& data, size_t* offset,
+                                   VertexBufferHeader* outHeader) {
+    if (data.size() < *offset + sizeof(VertexBufferHeader)) return false;
+    memcpy(outHeader, data.bytes() + *offset, sizeof(VertexBufferHeader));
+    if (outHeader->vertexCount > kMaxValueSize || outHeader->indexCount > kMaxValueSize) {
+        return false;
+    }
+    const size_t payloadSize = outHeader->vertexCount * vertexSize(outHeader->meshFeatureFlags) +
+                               outHeader->indexCount * sizeof(uint16_t);
+    if (data.size() - *offset - sizeof(VertexBufferHeader) < payloadSize) return false;
+    *offset += sizeof(VertexBufferHeader) + payloadSize;
+    return true;
+}
+
+/**
+ * Fills buffer from the data at offset, which must have been checked by readVertexBufferHeader.
+ */
+static void readVertexBuffer(const SkData& data, size_t offset, VertexBuffer& buffer) {
+    VertexBufferHeader header;
+    memcpy(&header, data.bytes() + offset, sizeof(header));
+    const uint8_t* payload = data.bytes() + offset + sizeof(header);
+    if (header.vertexCount) {
+        const size_t vertexBytes = header.vertexCount * vertexSize(header.meshFeatureFlags);
+        if (header.meshFeatureFlags & VertexBuffer::kAlpha) {
+            memcpy(buffer.alloc<AlphaVertex>(header.vertexCount), payload, vertexBytes);
+        } else {
+            memcpy(buffer.alloc<Vertex>(header.vertexCount), payload, vertexBytes);
+        }
+        payload += vertexBytes;
+    }
+    if (header.indexCount) {
+        uint16_t* indices = buffer.allocIndices<uint16_t>(header.indexCount);
+        memcpy(indices, payload, header.indexCount * sizeof(uint16_t));
+    }
+    buffer.setMeshFeatureFlags(header.meshFeatureFlags);
+    buffer.setBounds(Rect(header.bounds[0], header.bounds[1], header.bounds[2], header.bounds[3]));
+}
+
+static std::string shapeKey(const TessellationCache::Description& description) {
+    // Fields are appended one by one, Description has padding that isn't initialized
+    std::string key;
+    append(key, kShapeKey);
+    append(key, kFormatVersion);
+    append(key, static_cast<int32_t>(description.type));
+    append(key, description.scaleX);
+    append(key, description.scaleY);
+    append(key, static_cast<uint8_t>(description.aa));
+    append(key, static_cast<int32_t>(description.cap));
+    append(key, static_cast<int32_t>(description.style));
+    append(key, description.strokeWidth);
+    // the shape union only holds floats, and its unused bits are zeroed
+    append(key, description.shape);
+    return key;
+}
+
+static std::string shadowKey(const TessellationCache::ShadowTask& task) {
+    std::string key;
+    append(key, kShadowKey);
+    append(key, kFormatVersion);
+    append(key, static_cast<uint8_t>(task.opaque));
+    append(key, task.localClip.left);
+    append(key, task.localClip.top);
+    append(key, task.localClip.right);
+    append(key, task.localClip.bottom);
+    appendMatrix(key, task.drawTransform);
+    appendMatrix(key, task.transformXY);
+    appendMatrix(key, task.transformZ);
+    append(key, task.lightCenter.x);
+    append(key, task.lightCenter.y);
+    append(key, task.lightCenter.z);
+    append(key, task.lightRadius);
+    const size_t pathSize = task.casterPerimeter.writeToMemory(nullptr);
+    if (key.size() + pathSize > kMaxKeySize) {
+        return std::string();
+    }
+    const size_t pathOffset = key.size();
+    key.resize(pathOffset + pathSize);
+    task.casterPerimeter.writeToMemory(&key[pathOffset]);
+    return key;
+}
+
+TessellationDiskCache& TessellationDiskCache::get() {
+    static TessellationDiskCache sCache;
+    return sCache;
+}
+
+TessellationDiskCache::TessellationDiskCache() {}
+
+TessellationDiskCache::~TessellationDiskCache() {}
+
+void TessellationDiskCache::setFilename(const char* filename) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFilename = filename;
+    mStore.reset();
+    mStoreDirty = false;
+}
+
+skiapipeline::ShaderBlobStore* TessellationDiskCache::getStoreLocked() {
+    if (!mStore && !mFilename.empty()) {
+        ATRACE_NAME("TessellationDiskCache::load");
+        mStore.reset(new skiapipeline::ShaderBlobStore(kMaxKeySize, kMaxValueSize, kMaxTotalSize,
+                                                       mFilename));
+    }
+    return mStore.get();
+}
+
+VertexBuffer* TessellationDiskCache::loadShape(const TessellationCache::Description& description) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    skiapipeline::ShaderBlobStore* store = getStoreLocked();
+    if (!store) return nullptr;
+
+    std::string key = shapeKey(description);
+    sk_sp<SkData> value = store->get(key.data(), key.size());
+    if (!value) return nullptr;
+    size_t offset = 0;
+    VertexBufferHeader header;
+    if (!readVertexBufferHeader(*value, &offset, &header)) {
+        ALOGW("TessellationDiskCache: ignoring malformed shape entry");
+        return nullptr;
+    }
+    VertexBuffer* buffer = new VertexBuffer();
+    readVertexBuffer(*value, 0, *buffer);
+    // hit counts are persisted, so that shapes used at every start are evicted last
+    mStoreDirty = true;
+    scheduleSaveLocked();
+    return buffer;
+}
+
+void TessellationDiskCache::storeShape(const TessellationCache::Description& description,
+                                       const VertexBuffer& buffer) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    skiapipeline::ShaderBlobStore* store = getStoreLocked();
+    if (!store) return;
+
+    std::string key = shapeKey(description);
+    std::string value;
+    appendVertexBuffer(value, buffer);
+    store->set(key.data(), key.size(), value.data(), value.size());
+    mStoreDirty = true;
+    scheduleSaveLocked();
+}
+
+bool TessellationDiskCache::loadShadows(TessellationCache::ShadowTask& task) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    skiapipeline::ShaderBlobStore* store = getStoreLocked();
+    if (!store) return false;
+
+    std::string key = shadowKey(task);
+    if (key.empty()) return false;
+    sk_sp<SkData> value = store->get(key.data(), key.size());
+    if (!value) return false;
+    size_t offset = 0;
+    VertexBufferHeader header;
+    bool valid = readVertexBufferHeader(*value, &offset, &header);
+    const size_t spotOffset = offset;
+    if (!valid || !readVertexBufferHeader(*value, &offset, &header)) {
+        ALOGW("TessellationDiskCache: ignoring malformed shadow entry");
+        return false;
+    }
+    readVertexBuffer(*value, 0, task.ambientBuffer);
+    readVertexBuffer(*value, spotOffset, task.spotBuffer);
+    mStoreDirty = true;
+    scheduleSaveLocked();
+    return true;
+}
+
+void TessellationDiskCache::storeShadows(const TessellationCache::ShadowTask& task) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    skiapipeline::ShaderBlobStore* store = getStoreLocked();
+    if (!store) return;
+
+    std::string key = shadowKey(task);
+    if (key.empty()) return;
+    std::string value;
+    appendVertexBuffer(value, task.ambientBuffer);
+    appendVertexBuffer(value, task.spotBuffer);
+    store->set(key.data(), key.size(), value.data(), value.size());
+    mStoreDirty = true;
+    scheduleSaveLocked();
+}
+
+void TessellationDiskCache::scheduleSaveLocked() {
+    if (!mSavePending && mDeferredSaveDelay > 0) {
+        mSavePending = true;
+        std::thread deferredSaveThread([this]() {
+            sleep(mDeferredSaveDelay);
+            std::lock_guard<std::mutex> lock(mMutex);
+            ATRACE_NAME("TessellationDiskCache::saveToDisk");
+            if (mStore && mStoreDirty) {
+                mStore->writeToFile();
+                mStoreDirty = false;
+            }
+            mSavePending = false;
+        });
+        deferredSaveThread.detach();
+    }
+}
+
+};  // namespace uirenderer
+};  // namespace android
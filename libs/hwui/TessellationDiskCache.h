@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "TessellationCache.h"
+#include "utils/Macros.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace android {
+namespace uirenderer {
+
+namespace skiapipeline {
+class ShaderBlobStore;
+}
+
+class VertexBuffer;
+
+/**
+ * TessellationDiskCache keeps the VertexBuffers computed by TessellationCache in a file, so that
+ * the shapes and shadows of the first frames after a process start don't need to be tessellated
+ * again. Shapes are keyed by their TessellationCache::Description, shadows by the content of
+ * all of the ShadowTask inputs, since the in memory shadow key is only valid for one frame.
+ *
+ * The file is a ShaderBlobStore, which ignores files written by another build and maps the
+ * file on first use, so the cache is only loaded once a worker looks up the first buffer.
+ *
+ * Thread safe, lookups and stores are done by the TessellationCache worker threads.
+ */
+class TessellationDiskCache {
+    PREVENT_COPY_AND_ASSIGN(TessellationDiskCache);
+
+public:
+    static TessellationDiskCache& get();
+
+    /**
+     * Sets the file the cache is loaded from and saved to. An empty filename, the default,
+     * disables the cache. Drops the entries loaded from any previous file.
+     */
+    void setFilename(const char* filename);
+
+    /**
+     * Returns a new VertexBuffer holding the tessellation of description, or nullptr if it
+     * isn't cached.
+     */
+    VertexBuffer* loadShape(const TessellationCache::Description& description);
+    void storeShape(const TessellationCache::Description& description, const VertexBuffer& buffer);
+
+    /**
+     * Fills the ambient and spot buffers of task if its shadows are cached. The buffers are
+     * left untouched otherwise.
+     */
+    bool loadShadows(TessellationCache::ShadowTask& task);
+    void storeShadows(const TessellationCache::ShadowTask& task);
+
+private:
+    TessellationDiskCache();
+    ~TessellationDiskCache();
+
+    skiapipeline::ShaderBlobStore* getStoreLocked();
+    void scheduleSaveLocked();
+
+    std::string mFilename;
+    std::unique_ptr<skiapipeline::ShaderBlobStore> mStore;
+
+    bool mSavePending = false;
+    bool mStoreDirty = false;
+
+    // The time in seconds to wait before saving new entries, 0 disables saving
+    unsigned int mDeferredSaveDelay = 4;
+
+    std::mutex mMutex;
+
+    friend class TessellationDiskCacheTestUtils;
+};
+
+};  // namespace uirenderer
+};  // namespace android
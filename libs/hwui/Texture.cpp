@@ -16,6 +16,7 @@
 
 #include "Texture.h"
 #include "Caches.h"
+#include "TextureUploader.h"
 #include "utils/GLUtils.h"
 #include "utils/MathUtils.h"
 #include "utils/TraceUtils.h"
@@ -82,6 +83,7 @@ void Texture::setFilterMinMag(GLenum min, GLenum mag, bool bindTexture, bool for
 }
 
 void Texture::deleteTexture() {
+    cancelUpload();
     mCaches.textureState().deleteTexture(mId);
     mId = 0;
     mTarget = GL_NONE;
@@ -271,25 +273,9 @@ bool Texture::hasUnsupportedColorType(const SkImageInfo& info, bool hasLinearBle
             Caches::getInstance().extensions().getMajorGlVersion() < 3);
 }
 
-void Texture::upload(Bitmap& bitmap) {
-    ATRACE_FORMAT("Upload %ux%u Texture", bitmap.width(), bitmap.height());
-
-    // We could also enable mipmapping if both bitmap dimensions are powers
-    // of 2 but we'd have to deal with size changes. Let's keep this simple
-    const bool canMipMap = mCaches.extensions().hasNPot();
-
-    // If the texture had mipmap enabled but not anymore,
-    // force a glTexImage2D to discard the mipmap levels
-    bool needsAlloc = canMipMap && mipMap && !bitmap.hasHardwareMipMap();
-    bool setDefaultParams = false;
-
-    if (!mId) {
-        glGenTextures(1, &mId);
-        needsAlloc = true;
-        setDefaultParams = true;
-    }
-
-    bool hasLinearBlending = mCaches.extensions().hasLinearBlending();
+Texture::UploadFormat Texture::chooseUploadFormat(Bitmap& bitmap) {
+    UploadFormat uploadFormat;
+    const bool hasLinearBlending = mCaches.extensions().hasLinearBlending();
     bool needSRGB = transferFunctionCloseToSRGB(bitmap.info().colorSpace());
 
     GLint internalFormat, format, type;
@@ -302,15 +288,11 @@ void Texture::upload(Bitmap& bitmap) {
             bitmap.colorType() == kRGBA_F16_SkColorType && internalFormat != GL_RGBA16F;
 
     // RGBA16F is always linear extended sRGB
-    if (internalFormat == GL_RGBA16F) {
-        mIsLinear = true;
-    }
-
-    mConnector.reset();
+    uploadFormat.isLinear = internalFormat == GL_RGBA16F;
 
     // Alpha masks don't have color profiles
     // If an RGBA16F bitmap needs conversion, we know the target will be sRGB
-    if (!mIsLinear && internalFormat != GL_ALPHA && !rgba16fNeedsConversion) {
+    if (!uploadFormat.isLinear && internalFormat != GL_ALPHA && !rgba16fNeedsConversion) {
         SkColorSpace* colorSpace = bitmap.info().colorSpace();
         // If the bitmap is sRGB we don't need conversion
         if (colorSpace != nullptr && !colorSpace->isSRGB()) {
@@ -328,7 +310,7 @@ void Texture::upload(Bitmap& bitmap) {
                     ColorSpace::TransferParameters p = {fn.fG, fn.fA, fn.fB, fn.fC,
                                                         fn.fD, fn.fE, fn.fF};
                     ColorSpace src("Unnamed", mat4f((const float*)&data[0]).upperLeft(), p);
-                    mConnector.reset(new ColorSpaceConnector(src, ColorSpace::sRGB()));
+                    uploadFormat.connector.reset(new ColorSpaceConnector(src, ColorSpace::sRGB()));
 
                     // A non-sRGB color space might have a transfer function close enough to sRGB
                     // that we can save shader instructions by using an sRGB sampler
@@ -342,18 +324,62 @@ void Texture::upload(Bitmap& bitmap) {
         }
     }
 
-    GLenum target = bitmap.isHardware() ? GL_TEXTURE_EXTERNAL_OES : GL_TEXTURE_2D;
-    needsAlloc |= updateLayout(bitmap.width(), bitmap.height(), internalFormat, format, target);
+    uploadFormat.width = bitmap.width();
+    uploadFormat.height = bitmap.height();
+    uploadFormat.target = bitmap.isHardware() ? GL_TEXTURE_EXTERNAL_OES : GL_TEXTURE_2D;
+    uploadFormat.blend = !bitmap.isOpaque();
+    uploadFormat.internalFormat = internalFormat;
+    uploadFormat.format = format;
+    uploadFormat.type = type;
+    // TODO: Handle sRGB gray bitmaps
+    uploadFormat.needsConversion = hasUnsupportedColorType(bitmap.info(), hasLinearBlending);
+    return uploadFormat;
+}
+
+bool Texture::applyUploadFormat(UploadFormat&& uploadFormat) {
+    mIsLinear = uploadFormat.isLinear;
+    mConnector = std::move(uploadFormat.connector);
+    blend = uploadFormat.blend;
+    return updateLayout(uploadFormat.width, uploadFormat.height, uploadFormat.internalFormat,
+                        uploadFormat.format, uploadFormat.target);
+}
+
+void Texture::upload(Bitmap& bitmap) {
+    ATRACE_FORMAT("Upload %ux%u Texture", bitmap.width(), bitmap.height());
+
+    // A synchronous upload supersedes any upload in flight
+    cancelUpload();
+
+    // We could also enable mipmapping if both bitmap dimensions are powers
+    // of 2 but we'd have to deal with size changes. Let's keep this simple
+    const bool canMipMap = mCaches.extensions().hasNPot();
+
+    // If the texture had mipmap enabled but not anymore,
+    // force a glTexImage2D to discard the mipmap levels
+    bool needsAlloc = canMipMap && mipMap && !bitmap.hasHardwareMipMap();
+    bool setDefaultParams = false;
+
+    if (!mId) {
+        glGenTextures(1, &mId);
+        needsAlloc = true;
+        setDefaultParams = true;
+    }
+
+    UploadFormat uploadFormat = chooseUploadFormat(bitmap);
+    const GLint internalFormat = uploadFormat.internalFormat;
+    const GLint format = uploadFormat.format;
+    const GLint type = uploadFormat.type;
+    const bool needsConversion = uploadFormat.needsConversion;
+    needsAlloc |= applyUploadFormat(std::move(uploadFormat));
 
-    blend = !bitmap.isOpaque();
     mCaches.textureState().bindTexture(mTarget, mId);
 
-    // TODO: Handle sRGB gray bitmaps
-    if (CC_UNLIKELY(hasUnsupportedColorType(bitmap.info(), hasLinearBlending))) {
+    if (CC_UNLIKELY(needsConversion)) {
         SkBitmap skBitmap;
         bitmap.getSkBitmap(&skBitmap);
         sk_sp<SkColorSpace> sRGB = SkColorSpace::MakeSRGB();
-        SkBitmap rgbaBitmap = uploadToN32(skBitmap, hasLinearBlending, std::move(sRGB));
+        SkBitmap rgbaBitmap = uploadToN32(skBitmap, mCaches.extensions().hasLinearBlending(),
+                                          std::move(sRGB));
         uploadToTexture(needsAlloc, internalFormat, format, type, rgbaBitmap.rowBytesAsPixels(),
                         rgbaBitmap.bytesPerPixel(), rgbaBitmap.width(), rgbaBitmap.height(),
                         rgbaBitmap.getPixels());
@@ -378,6 +404,53 @@ void Texture::upload(Bitmap& bitmap) {
     }
 }
 
+bool Texture::uploadAsync(Bitmap& bitmap, TextureUploader& uploader) {
+    // The upload thread neither imports hardware buffers nor generates mipmaps
+    if (bitmap.isHardware() || bitmap.hasHardwareMipMap()) return false;
+
+    cancelUpload();
+    UploadFormat uploadFormat = chooseUploadFormat(bitmap);
+    mPendingUpload = uploader.upload(bitmap, uploadFormat.internalFormat, uploadFormat.format,
+                                     uploadFormat.type, uploadFormat.needsConversion,
+                                     mCaches.extensions().hasLinearBlending());
+    if (!mPendingUpload) return false;
+    mPendingFormat = std::move(uploadFormat);
+    return true;
+}
+
+bool Texture::finishUpload() {
+    if (!mPendingUpload) return true;
+    if (!mPendingUpload->isDone()) return false;
+
+    GLuint id = mPendingUpload->adopt();
+    mPendingUpload.reset();
+    if (!id) {
+        // Keep the previous content, if any, and make TextureCache upload the bitmap again
+        generation = 0;
+        return mId != 0;
+    }
+
+    if (mId) {
+        mCaches.textureState().deleteTexture(mId);
+    }
+    mId = id;
+    applyUploadFormat(std::move(mPendingFormat));
+    // The parameters the upload thread set
+    mipMap = false;
+    mMinFilter = GL_NEAREST;
+    mMagFilter = GL_NEAREST;
+    mWrapS = GL_CLAMP_TO_EDGE;
+    mWrapT = GL_CLAMP_TO_EDGE;
+    return true;
+}
+
+void Texture::cancelUpload() {
+    if (mPendingUpload) {
+        mPendingUpload->cancel();
+        mPendingUpload.reset();
+    }
+}
+
 void Texture::wrap(GLuint id, uint32_t width, uint32_t height, GLint internalFormat, GLint format,
                    GLenum target) {
     mId = id;
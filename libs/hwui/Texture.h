@@ -40,6 +40,8 @@ class GraphicBuffer;
 namespace uirenderer {
 
 class Caches;
+class TextureUpload;
+class TextureUploader;
 class UvMapper;
 class Layer;
 
@@ -57,7 +59,7 @@ public:
 
     explicit Texture(Caches& caches) : GpuMemoryTracker(GpuObjectType::Texture), mCaches(caches) {}
 
-    virtual ~Texture() {}
+    virtual ~Texture() { cancelUpload(); }
 
     inline void setWrap(GLenum wrap, bool bindTexture = false, bool force = false) {
         setWrapST(wrap, wrap, bindTexture, force);
@@ -99,6 +101,21 @@ public:
      */
     void upload(Bitmap& source);
 
+    /**
+     * Like upload(Bitmap&), but the pixels are uploaded by uploader on its thread. The texture
+     * keeps its previous content, if any, until finishUpload() adopts the new one. Returns false
+     * if the bitmap must be uploaded synchronously instead.
+     */
+    bool uploadAsync(Bitmap& source, TextureUploader& uploader);
+
+    /**
+     * Adopts the result of uploadAsync() once the upload thread is done with it. Returns false
+     * while the upload is still in flight, or if it failed and there is no previous content.
+     */
+    bool finishUpload();
+
+    bool hasPendingUpload() const { return mPendingUpload != nullptr; }
+
     /**
      * Basically glTexImage2D/glTexSubImage2D.
      */
@@ -180,6 +197,26 @@ private:
     // Returns true if the texture layout (size, format, etc.) changed, false if it was the same
     bool updateLayout(uint32_t width, uint32_t height, GLint internalFormat, GLint format,
                       GLenum target);
+    // The formats and layout upload(Bitmap&) picks for a bitmap
+    struct UploadFormat {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        GLenum target = GL_TEXTURE_2D;
+        GLint internalFormat = 0;
+        GLint format = 0;
+        GLint type = 0;
+        bool blend = false;
+        bool isLinear = false;
+        // The bitmap must go through uploadToN32() first
+        bool needsConversion = false;
+        std::unique_ptr<ColorSpaceConnector> connector;
+    };
+
+    UploadFormat chooseUploadFormat(Bitmap& bitmap);
+    // Returns true if the texture layout changed
+    bool applyUploadFormat(UploadFormat&& uploadFormat);
+    void cancelUpload();
+
     void uploadHardwareBitmapToTexture(GraphicBuffer* buffer);
     void resetCachedParams();
 
@@ -207,6 +244,9 @@ private:
     Caches& mCaches;
 
     std::unique_ptr<ColorSpaceConnector> mConnector;
+
+    std::shared_ptr<TextureUpload> mPendingUpload;
+    UploadFormat mPendingFormat;
 };  // struct Texture
 
 class AutoTexture {
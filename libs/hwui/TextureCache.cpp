@@ -16,6 +16,8 @@
 
 #include <GLES2/gl2.h>
 
+#include <androidfw/NativeMemoryStats.h>
+
 #include <utils/Mutex.h>
 
 #include "Caches.h"
@@ -23,6 +25,7 @@
 #include "Properties.h"
 #include "Texture.h"
 #include "TextureCache.h"
+#include "TextureUploader.h"
 #include "hwui/Bitmap.h"
 #include "utils/TraceUtils.h"
 
@@ -67,6 +70,7 @@ void TextureCache::operator()(uint32_t&, Texture*& texture) {
     // This will be called already locked
     if (texture) {
         mSize -= texture->bitmapSize;
+        NativeMemoryStats::Remove(NativeMemoryCategory::kHwuiTextureCache, texture->bitmapSize);
         TEXTURE_LOGD("TextureCache::callback: name, removed size, mSize = %d, %d, %d", texture->id,
                      texture->bitmapSize, mSize);
         if (mDebugEnabled) {
@@ -99,11 +103,38 @@ bool TextureCache::canMakeTextureFromBitmap(Bitmap* bitmap) {
     return true;
 }
 
-Texture* TextureCache::createTexture(Bitmap* bitmap) {
+// Smaller bitmaps upload quickly enough that a frame without them costs more than the upload
+#define ASYNC_UPLOAD_MIN_SIZE (256 * 1024)
+
+TextureUploader* TextureCache::getUploader(Bitmap* bitmap) {
+    // The upload thread reads the pixels while the UI thread may still draw into a mutable
+    // bitmap, which would tear the texture
+    if (!Properties::enableAsyncTextureUpload || bitmap->isHardware() ||
+        !bitmap->isImmutable() || bitmap->rowBytes() * bitmap->height() < ASYNC_UPLOAD_MIN_SIZE) {
+        return nullptr;
+    }
+    if (!mUploader && !mUploaderFailed) {
+        // Pixel buffer objects and fence syncs require OpenGL ES 3
+        if (Caches::getInstance().extensions().getMajorGlVersion() >= 3) {
+            mUploader = TextureUploader::create();
+        }
+        mUploaderFailed = !mUploader;
+    }
+    return mUploader.get();
+}
+
+void TextureCache::uploadTexture(Texture* texture, Bitmap* bitmap, bool allowAsync) {
+    TextureUploader* uploader = allowAsync ? getUploader(bitmap) : nullptr;
+    if (!uploader || !texture->uploadAsync(*bitmap, *uploader)) {
+        texture->upload(*bitmap);
+    }
+    texture->generation = bitmap->getGenerationID();
+}
+
+Texture* TextureCache::createTexture(Bitmap* bitmap, bool allowAsync) {
     Texture* texture = new Texture(Caches::getInstance());
     texture->bitmapSize = bitmap->rowBytes() * bitmap->height();
-    texture->generation = bitmap->getGenerationID();
-    texture->upload(*bitmap);
+    uploadTexture(texture, bitmap, allowAsync);
     return texture;
 }
 
@@ -113,7 +144,7 @@ Texture* TextureCache::getCachedTexture(Bitmap* bitmap) {
     if (bitmap->isHardware()) {
         auto textureIterator = mHardwareTextures.find(bitmap->getStableID());
         if (textureIterator == mHardwareTextures.end()) {
-            Texture* texture = createTexture(bitmap);
+            Texture* texture = createTexture(bitmap, false);
             mHardwareTextures.insert(
                     std::make_pair(bitmap->getStableID(), std::unique_ptr<Texture>(texture)));
             if (mDebugEnabled) {
@@ -144,8 +175,9 @@ Texture* TextureCache::getCachedTexture(Bitmap* bitmap) {
         }
 
         if (canCache) {
-            texture = createTexture(bitmap);
+            texture = createTexture(bitmap, true);
             mSize += size;
+            NativeMemoryStats::Add(NativeMemoryCategory::kHwuiTextureCache, size);
             TEXTURE_LOGD("TextureCache::get: create texture(%p): name, size, mSize = %d, %d, %d",
                          bitmap, texture->id, size, mSize);
             if (mDebugEnabled) {
@@ -156,8 +188,7 @@ Texture* TextureCache::getCachedTexture(Bitmap* bitmap) {
     } else if (!texture->isInUse && bitmap->getGenerationID() != texture->generation) {
         // Texture was in the cache but is dirty, re-upload
         // TODO: Re-adjust the cache size if the bitmap's dimensions have changed
-        texture->upload(*bitmap);
-        texture->generation = bitmap->getGenerationID();
+        uploadTexture(texture, bitmap, true);
     }
 
     return texture;
@@ -182,8 +213,12 @@ Texture* TextureCache::get(Bitmap* bitmap) {
         if (!canMakeTextureFromBitmap(bitmap)) {
             return nullptr;
         }
-        texture = createTexture(bitmap);
+        // Deleted after this draw, so there would be nothing to wait for the upload
+        texture = createTexture(bitmap, false);
         texture->cleanup = true;
+    } else if (!texture->finishUpload() && !texture->id()) {
+        // Skip the draw until the first upload is done, later uploads draw the previous content
+        return nullptr;
     }
 
     return texture;
@@ -208,6 +243,12 @@ void TextureCache::clear() {
     TEXTURE_LOGD("TextureCache:clear(), mSize = %d", mSize);
 }
 
+void TextureCache::destroyUploader() {
+    // Uploads in flight are owned by their textures, which cancel them when deleted
+    mUploader.reset();
+    mUploaderFailed = false;
+}
+
 void TextureCache::flush() {
     if (mFlushRate >= 1.0f || mCache.size() == 0) return;
     if (mFlushRate <= 0.0f) {
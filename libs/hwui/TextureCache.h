@@ -36,6 +36,7 @@ class Bitmap;
 namespace uirenderer {
 
 class Texture;
+class TextureUploader;
 
 ///////////////////////////////////////////////////////////////////////////////
 // Defines
@@ -113,6 +114,12 @@ public:
      */
     uint32_t getSize();
 
+    /**
+     * Stops the upload thread and drops the uploads in flight. Must be called before the GL
+     * context is destroyed.
+     */
+    void destroyUploader();
+
     /**
      * Partially flushes the cache. The amount of memory freed by a flush
      * is defined by the flush rate.
@@ -123,7 +130,9 @@ private:
     bool canMakeTextureFromBitmap(Bitmap* bitmap);
 
     Texture* getCachedTexture(Bitmap* bitmap);
-    Texture* createTexture(Bitmap* bitmap);
+    Texture* createTexture(Bitmap* bitmap, bool allowAsync);
+    void uploadTexture(Texture* texture, Bitmap* bitmap, bool allowAsync);
+    TextureUploader* getUploader(Bitmap* bitmap);
 
     LruCache<uint32_t, Texture*> mCache;
 
@@ -136,6 +145,10 @@ private:
     bool mDebugEnabled;
 
     std::unordered_map<uint32_t, std::unique_ptr<Texture>> mHardwareTextures;
+
+    std::unique_ptr<TextureUploader> mUploader;
+    // Set once creating the uploader failed, so that it isn't retried every frame
+    bool mUploaderFailed = false;
 };  // class TextureCache
 
 };  // namespace uirenderer
@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TextureUploader.h"
+
+#include "Texture.h"
+#include "hwui/Bitmap.h"
+#include "thread/ThreadBase.h"
+#include "utils/TraceUtils.h"
+
+#include <SkBitmap.h>
+#include <SkColorSpace.h>
+#include <utils/Log.h>
+
+#include <string.h>
+
+namespace android {
+namespace uirenderer {
+
+bool TextureUpload::isDone() {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mState == State::Done;
+}
+
+GLuint TextureUpload::adopt() {
+    if (mFence) {
+        glWaitSync(mFence, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(mFence);
+        mFence = nullptr;
+    }
+    GLuint texture = mTexture;
+    mTexture = 0;
+    return texture;
+}
+
+void TextureUpload::cancel() {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (mState == State::Done) {
+        if (mFence) glDeleteSync(mFence);
+        if (mTexture) glDeleteTextures(1, &mTexture);
+        mFence = nullptr;
+        mTexture = 0;
+    }
+    mState = State::Cancelled;
+}
+
+class TextureUploader::UploadThread : public ThreadBase, public virtual RefBase {
+public:
+    UploadThread(EGLDisplay display, EGLSurface surface, EGLContext context)
+            : mDisplay(display), mSurface(surface), mContext(context) {}
+
+    void upload(TextureUpload& upload);
+
+protected:
+    bool threadLoop() override {
+        mCurrent = eglMakeCurrent(mDisplay, mSurface, mSurface, mContext);
+        if (mCurrent) {
+            // Rows are packed tightly in the pixel buffer
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glGenBuffers(1, &mPixelBuffer);
+        } else {
+            ALOGE("TextureUploader: failed to make the upload context current, error = %#x",
+                  eglGetError());
+        }
+        ThreadBase::threadLoop();
+        if (mCurrent) {
+            glDeleteBuffers(1, &mPixelBuffer);
+            eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        }
+        eglReleaseThread();
+        return false;
+    }
+
+private:
+    GLuint uploadPixels(const TextureUpload& upload);
+
+    const EGLDisplay mDisplay;
+    const EGLSurface mSurface;
+    const EGLContext mContext;
+    bool mCurrent = false;
+    GLuint mPixelBuffer = 0;
+};
+
+GLuint TextureUploader::UploadThread::uploadPixels(const TextureUpload& upload) {
+    SkBitmap bitmap;
+    upload.mBitmap->getSkBitmap(&bitmap);
+    if (upload.mNeedsConversion) {
+        bitmap = Texture::uploadToN32(bitmap, upload.mHasLinearBlending, SkColorSpace::MakeSRGB());
+    }
+    ATRACE_FORMAT("Upload %ux%u Texture (async)", bitmap.width(), bitmap.height());
+
+    const size_t rowBytes = bitmap.width() * bitmap.bytesPerPixel();
+    const size_t size = rowBytes * bitmap.height();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPixelBuffer);
+    // Orphans the storage of the previous upload instead of waiting for it to be consumed
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    uint8_t* dst = (uint8_t*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                              GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    const void* pixels = nullptr;
+    if (dst) {
+        const uint8_t* src = (const uint8_t*)bitmap.getPixels();
+        for (int y = 0; y < bitmap.height(); y++) {
+            memcpy(dst + y * rowBytes, src + y * bitmap.rowBytes(), rowBytes);
+        }
+        if (!glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+            // The buffer was corrupted, upload from the bitmap instead
+            dst = nullptr;
+        }
+    }
+    if (!dst) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, bitmap.rowBytesAsPixels());
+        pixels = bitmap.getPixels();
+    }
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    // pixels is an offset into the pixel buffer when one is bound
+    glTexImage2D(GL_TEXTURE_2D, 0, upload.mInternalFormat, bitmap.width(), bitmap.height(), 0,
+                 upload.mFormat, upload.mType, pixels);
+    // The defaults Texture::upload() sets on new textures
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (dst) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    } else {
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+
+    if (glGetError() != GL_NO_ERROR) {
+        ALOGW("TextureUploader: failed to upload %dx%d bitmap", bitmap.width(), bitmap.height());
+        glDeleteTextures(1, &texture);
+        return 0;
+    }
+    return texture;
+}
+
+void TextureUploader::UploadThread::upload(TextureUpload& upload) {
+    {
+        std::lock_guard<std::mutex> lock(upload.mLock);
+        if (upload.mState == TextureUpload::State::Cancelled) {
+            upload.mBitmap.reset();
+            return;
+        }
+    }
+
+    GLuint texture = 0;
+    GLsync fence = nullptr;
+    if (mCurrent) {
+        texture = uploadPixels(upload);
+        if (texture) {
+            fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            // The RenderThread can only wait on the fence once it is flushed
+            glFlush();
+        }
+    }
+    upload.mBitmap.reset();
+
+    std::lock_guard<std::mutex> lock(upload.mLock);
+    if (upload.mState == TextureUpload::State::Cancelled) {
+        if (fence) glDeleteSync(fence);
+        if (texture) glDeleteTextures(1, &texture);
+        return;
+    }
+    upload.mTexture = texture;
+    upload.mFence = fence;
+    upload.mState = TextureUpload::State::Done;
+}
+
+std::unique_ptr<TextureUploader> TextureUploader::create() {
+    EGLDisplay display = eglGetCurrentDisplay();
+    EGLContext sharedContext = eglGetCurrentContext();
+    EGLSurface currentSurface = eglGetCurrentSurface(EGL_DRAW);
+    if (display == EGL_NO_DISPLAY || sharedContext == EGL_NO_CONTEXT ||
+        currentSurface == EGL_NO_SURFACE) {
+        return nullptr;
+    }
+
+    // The context may have been created without a config, take the config of its surface
+    EGLint configId = 0;
+    EGLint clientVersion = 0;
+    eglQuerySurface(display, currentSurface, EGL_CONFIG_ID, &configId);
+    eglQueryContext(display, sharedContext, EGL_CONTEXT_CLIENT_VERSION, &clientVersion);
+    const EGLint configAttribs[] = {EGL_CONFIG_ID, configId, EGL_NONE};
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs != 1) {
+        ALOGW("TextureUploader: no config matching id %d, error = %#x", configId, eglGetError());
+        return nullptr;
+    }
+
+    const EGLint contextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, clientVersion, EGL_NONE};
+    EGLContext context = eglCreateContext(display, config, sharedContext, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        ALOGW("TextureUploader: failed to create the upload context, error = %#x",
+              eglGetError());
+        return nullptr;
+    }
+    const EGLint surfaceAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+    if (surface == EGL_NO_SURFACE) {
+        ALOGW("TextureUploader: failed to create the upload surface, error = %#x",
+              eglGetError());
+        eglDestroyContext(display, context);
+        return nullptr;
+    }
+    return std::unique_ptr<TextureUploader>(new TextureUploader(display, surface, context));
+}
+
+TextureUploader::TextureUploader(EGLDisplay display, EGLSurface surface, EGLContext context)
+        : mDisplay(display)
+        , mSurface(surface)
+        , mContext(context)
+        , mThread(new UploadThread(display, surface, context)) {
+    mThread->start("hwuiTextureUpload");
+}
+
+TextureUploader::~TextureUploader() {
+    mThread->requestExit();
+    mThread->join();
+    mThread.clear();
+    eglDestroySurface(mDisplay, mSurface);
+    eglDestroyContext(mDisplay, mContext);
+}
+
+std::shared_ptr<TextureUpload> TextureUploader::upload(Bitmap& bitmap, GLint internalFormat,
+                                                       GLint format, GLint type,
+                                                       bool needsConversion,
+                                                       bool hasLinearBlending) {
+    std::shared_ptr<TextureUpload> upload = std::make_shared<TextureUpload>();
+    upload->mBitmap = sk_ref_sp(&bitmap);
+    upload->mInternalFormat = internalFormat;
+    upload->mFormat = format;
+    upload->mType = type;
+    upload->mNeedsConversion = needsConversion;
+    upload->mHasLinearBlending = hasLinearBlending;
+    UploadThread* thread = mThread.get();
+    mThread->queue().post([thread, upload]() { thread->upload(*upload); });
+    return upload;
+}
+
+};  // namespace uirenderer
+};  // namespace android
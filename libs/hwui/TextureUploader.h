@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "utils/Macros.h"
+
+#include <EGL/egl.h>
+#include <GLES3/gl3.h>
+#include <SkRefCnt.h>
+#include <utils/StrongPointer.h>
+
+#include <memory>
+#include <mutex>
+
+namespace android {
+
+class Bitmap;
+
+namespace uirenderer {
+
+/**
+ * A bitmap upload handed to TextureUploader. The RenderThread polls it with isDone(), and then
+ * either adopts the uploaded texture or cancels the upload.
+ */
+class TextureUpload {
+    PREVENT_COPY_AND_ASSIGN(TextureUpload);
+
+public:
+    TextureUpload() {}
+
+    bool isDone();
+
+    /**
+     * Makes the RenderThread context wait on the GPU for the upload to complete, and returns the
+     * uploaded texture, now owned by the caller. Returns 0 if the upload failed. Must only be
+     * called once isDone() returned true.
+     */
+    GLuint adopt();
+
+    /**
+     * Deletes the uploaded texture, or makes the upload thread skip or delete it if it isn't
+     * done yet. Must be called on the RenderThread, with the GL context current.
+     */
+    void cancel();
+
+private:
+    friend class TextureUploader;
+
+    enum class State { Queued, Done, Cancelled };
+
+    std::mutex mLock;
+    State mState = State::Queued;
+
+    // Inputs, only read by the upload thread
+    sk_sp<Bitmap> mBitmap;
+    GLint mInternalFormat = 0;
+    GLint mFormat = 0;
+    GLint mType = 0;
+    bool mNeedsConversion = false;
+    bool mHasLinearBlending = false;
+
+    // Outputs, only valid once the upload is done
+    GLuint mTexture = 0;
+    GLsync mFence = nullptr;
+};
+
+/**
+ * Uploads bitmaps to textures on a separate thread, with its own GL context that shares objects
+ * with the RenderThread context. Pixels are streamed through a pixel buffer object, and each
+ * upload is followed by a fence that the RenderThread waits on, on the GPU, before sampling
+ * the texture. The bitmap is converted first if its color type can't be uploaded as is, like
+ * Texture::upload() does.
+ *
+ * Used by TextureCache for large immutable bitmaps, so that their uploads don't block the frame
+ * that first draws them. The pixels are read on the upload thread, so the bitmap must not change
+ * until the upload is done. Requires OpenGL ES 3.
+ */
+class TextureUploader {
+    PREVENT_COPY_AND_ASSIGN(TextureUploader);
+
+public:
+    /**
+     * Creates the upload context and thread. Must be called on the RenderThread, with the GL
+     * context current. Returns nullptr if the context can't be created.
+     */
+    static std::unique_ptr<TextureUploader> create();
+
+    ~TextureUploader();
+
+    /**
+     * Queues an upload of bitmap with the given formats, as picked by Texture.
+     */
+    std::shared_ptr<TextureUpload> upload(Bitmap& bitmap, GLint internalFormat, GLint format,
+                                          GLint type, bool needsConversion,
+                                          bool hasLinearBlending);
+
+private:
+    class UploadThread;
+
+    TextureUploader(EGLDisplay display, EGLSurface surface, EGLContext context);
+
+    EGLDisplay mDisplay;
+    EGLSurface mSurface;
+    EGLContext mContext;
+    sp<UploadThread> mThread;
+};
+
+};  // namespace uirenderer
+};  // namespace android
@@ -114,6 +114,9 @@ public:
         // This is used to post a message to redraw when it is time to draw the
         // next frame of an AnimatedImageDrawable.
         nsecs_t animatedImageDelay = kNoAnimatedImageDelay;
+        // Decode stats of the AnimatedImageDrawables, see FrameInfoIndex
+        nsecs_t animatedImageDecodeDuration = 0;
+        int animatedImageLateFrames = 0;
     } out;
 
     // This flag helps to disable projection for receiver nodes that do not have any backward
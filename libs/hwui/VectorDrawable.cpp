@@ -28,12 +28,99 @@
 #include <math.h>
 #include <string.h>
 
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
 namespace android {
 namespace uirenderer {
 namespace VectorDrawable {
 
 const int Tree::MAX_CACHED_BITMAP_SIZE = 2048;
 
+// FNV-1a
+static void hashBytes(uint64_t* hash, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        *hash = (*hash ^ bytes[i]) * 1099511628211ULL;
+    }
+}
+
+template <typename T>
+static void hashValue(uint64_t* hash, const T& value) {
+    hashBytes(hash, &value, sizeof(value));
+}
+
+/**
+ * The rasterized caches of the trees that don't animate, shared by the trees with the same
+ * content at the same size: the identical icons of a toolbar or a list are rasterized once.
+ * The bitmaps in it are never drawn into again.
+ */
+class SharedRasterCache {
+public:
+    static SharedRasterCache& get() {
+        static SharedRasterCache* sCache = new SharedRasterCache();
+        return *sCache;
+    }
+
+    sk_sp<Bitmap> find(uint64_t hash, int width, int height) {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto it = mIndex.find(Key{hash, width, height});
+        if (it == mIndex.end()) return nullptr;
+        // most recently used first
+        mEntries.splice(mEntries.begin(), mEntries, it->second);
+        return it->second->second;
+    }
+
+    // Returns false if the bitmap is too large to be shared.
+    bool put(uint64_t hash, const sk_sp<Bitmap>& bitmap) {
+        size_t bytes = entryBytes(bitmap);
+        if (bytes > kMaxEntryBytes) return false;
+        Key key{hash, bitmap->width(), bitmap->height()};
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mIndex.find(key) != mIndex.end()) return true;
+        mEntries.emplace_front(key, bitmap);
+        mIndex[key] = mEntries.begin();
+        mBytes += bytes;
+        while (mBytes > kMaxBytes) {
+            auto& last = mEntries.back();
+            mBytes -= entryBytes(last.second);
+            mIndex.erase(last.first);
+            mEntries.pop_back();
+        }
+        return true;
+    }
+
+private:
+    struct Key {
+        uint64_t hash;
+        int width;
+        int height;
+        bool operator==(const Key& other) const {
+            return hash == other.hash && width == other.width && height == other.height;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return key.hash ^ ((size_t)key.width * 31 + key.height);
+        }
+    };
+    typedef std::list<std::pair<Key, sk_sp<Bitmap>>> Entries;
+
+    static size_t entryBytes(const sk_sp<Bitmap>& bitmap) {
+        return bitmap->rowBytes() * bitmap->height();
+    }
+
+    static constexpr size_t kMaxBytes = 4 * 1024 * 1024;
+    // 256x256 pixels, an icon
+    static constexpr size_t kMaxEntryBytes = 256 * 1024;
+
+    std::mutex mLock;
+    Entries mEntries;
+    std::unordered_map<Key, Entries::iterator, KeyHash> mIndex;
+    size_t mBytes = 0;
+};
+
 void Path::dump() {
     ALOGD("Path: %s has %zu points", mName.c_str(), mProperties.getData().points.size());
 }
@@ -52,8 +139,13 @@ Path::Path(const Path& path) : Node(path) {
 
 const SkPath& Path::getUpdatedPath(bool useStagingData, SkPath* tempStagingPath) {
     if (useStagingData) {
-        tempStagingPath->reset();
-        VectorDrawableUtils::verbsToPath(tempStagingPath, mStagingProperties.getData());
+        if (mStagingSkPathDirty) {
+            mStagingSkPath.reset();
+            VectorDrawableUtils::verbsToPath(&mStagingSkPath, mStagingProperties.getData());
+            mStagingSkPathDirty = false;
+        }
+        // shares the path data, the caller may change the copy
+        *tempStagingPath = mStagingSkPath;
         return *tempStagingPath;
     } else {
         if (mSkPathDirty) {
@@ -65,6 +157,14 @@ const SkPath& Path::getUpdatedPath(bool useStagingData, SkPath* tempStagingPath)
     }
 }
 
+void Path::hashContent(uint64_t* hash, bool useStagingData) {
+    const Data& data = useStagingData ? mStagingProperties.getData() : mProperties.getData();
+    hashValue(hash, data.verbs.size());
+    hashBytes(hash, data.verbs.data(), data.verbs.size() * sizeof(char));
+    hashBytes(hash, data.verbSizes.data(), data.verbSizes.size() * sizeof(size_t));
+    hashBytes(hash, data.points.data(), data.points.size() * sizeof(float));
+}
+
 void Path::syncProperties() {
     if (mStagingPropertiesDirty) {
         mProperties.syncProperties(mStagingProperties);
@@ -135,6 +235,59 @@ const SkPath& FullPath::getUpdatedPath(bool useStagingData, SkPath* tempStagingP
     return *outPath;
 }
 
+// Mixes the gradient of shader into hash. Returns false if shader isn't a gradient, its address
+// is hashed instead: it only identifies the shader while it is alive.
+static bool hashShader(uint64_t* hash, SkShader* shader) {
+    hashValue(hash, shader != nullptr);
+    if (shader == nullptr) {
+        return true;
+    }
+    SkShader::GradientInfo info;
+    memset(&info, 0, sizeof(info));
+    SkShader::GradientType type = shader->asAGradient(&info);
+    if (type == SkShader::kNone_GradientType) {
+        hashValue(hash, shader);
+        return false;
+    }
+    std::vector<SkColor> colors(info.fColorCount);
+    std::vector<SkScalar> offsets(info.fColorCount);
+    info.fColors = colors.data();
+    info.fColorOffsets = offsets.data();
+    shader->asAGradient(&info);
+
+    hashValue(hash, type);
+    hashValue(hash, info.fColorCount);
+    hashBytes(hash, colors.data(), colors.size() * sizeof(SkColor));
+    hashBytes(hash, offsets.data(), offsets.size() * sizeof(SkScalar));
+    hashBytes(hash, info.fPoint, sizeof(info.fPoint));
+    hashBytes(hash, info.fRadius, sizeof(info.fRadius));
+    hashValue(hash, info.fTileMode);
+    hashValue(hash, info.fGradientFlags);
+    SkScalar matrix[9];
+    shader->getLocalMatrix().get9(matrix);
+    hashBytes(hash, matrix, sizeof(matrix));
+    return true;
+}
+
+void FullPath::hashContent(uint64_t* hash, bool useStagingData) {
+    hashValue(hash, 'F');
+    Path::hashContent(hash, useStagingData);
+    const FullPathProperties& properties = useStagingData ? mStagingProperties : mProperties;
+    // all 4 byte fields, no padding
+    hashValue(hash, properties.getPrimitiveFields());
+    // gradients by content, shader addresses are reused once the shaders are freed
+    hashShader(hash, properties.getFillGradient());
+    hashShader(hash, properties.getStrokeGradient());
+    hashValue(hash, mAntiAlias);
+}
+
+bool FullPath::hasContentHashedByAddress(bool useStagingData) {
+    const FullPathProperties& properties = useStagingData ? mStagingProperties : mProperties;
+    uint64_t unused = 0;
+    return !hashShader(&unused, properties.getFillGradient()) ||
+           !hashShader(&unused, properties.getStrokeGradient());
+}
+
 void FullPath::dump() {
     Path::dump();
     ALOGD("stroke width, color, alpha: %f, %d, %f, fill color, alpha: %d, %f",
@@ -267,6 +420,11 @@ void ClipPath::draw(SkCanvas* outCanvas, bool useStagingData) {
     outCanvas->clipPath(getUpdatedPath(useStagingData, &tempStagingPath));
 }
 
+void ClipPath::hashContent(uint64_t* hash, bool useStagingData) {
+    hashValue(hash, 'C');
+    Path::hashContent(hash, useStagingData);
+}
+
 Group::Group(const Group& group) : Node(group) {
     mStagingProperties.syncProperties(group.mStagingProperties);
 }
@@ -286,6 +444,25 @@ void Group::draw(SkCanvas* outCanvas, bool useStagingData) {
     // Restore the previous clip and matrix information.
 }
 
+void Group::hashContent(uint64_t* hash, bool useStagingData) {
+    const GroupProperties& prop = useStagingData ? mStagingProperties : mProperties;
+    hashValue(hash, 'G');
+    hashValue(hash, prop.mPrimitiveFields);
+    hashValue(hash, mChildren.size());
+    for (auto& child : mChildren) {
+        child->hashContent(hash, useStagingData);
+    }
+}
+
+bool Group::hasContentHashedByAddress(bool useStagingData) {
+    for (auto& child : mChildren) {
+        if (child->hasContentHashedByAddress(useStagingData)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void Group::dump() {
     ALOGD("Group %s has %zu children: ", mName.c_str(), mChildren.size());
     ALOGD("Group translateX, Y : %f, %f, scaleX, Y: %f, %f", mProperties.getTranslateX(),
@@ -450,13 +627,8 @@ int Tree::draw(Canvas* outCanvas, SkColorFilter* colorFilter, const SkRect& boun
 }
 
 void Tree::drawStaging(Canvas* outCanvas) {
-    bool redrawNeeded = allocateBitmapIfNeeded(mStagingCache, mStagingProperties.getScaledWidth(),
-                                               mStagingProperties.getScaledHeight());
     // draw bitmap cache
-    if (redrawNeeded || mStagingCache.dirty) {
-        updateBitmapCache(*mStagingCache.bitmap, true);
-        mStagingCache.dirty = false;
-    }
+    updateCacheIfNeeded(mStagingCache, mStagingProperties, true);
 
     SkPaint tmpPaint;
     SkPaint* paint = updatePaint(&tmpPaint, &mStagingProperties);
@@ -485,15 +657,58 @@ SkPaint* Tree::updatePaint(SkPaint* outPaint, TreeProperties* prop) {
 }
 
 Bitmap& Tree::getBitmapUpdateIfDirty() {
-    bool redrawNeeded = allocateBitmapIfNeeded(mCache, mProperties.getScaledWidth(),
-                                               mProperties.getScaledHeight());
-    if (redrawNeeded || mCache.dirty) {
-        updateBitmapCache(*mCache.bitmap, false);
-        mCache.dirty = false;
-    }
+    updateCacheIfNeeded(mCache, mProperties, false);
     return *mCache.bitmap;
 }
 
+uint64_t Tree::contentHash(const TreeProperties& prop, bool useStagingData) {
+    uint64_t hash = 14695981039346656037ULL;
+    hashValue(&hash, prop.getViewportWidth());
+    hashValue(&hash, prop.getViewportHeight());
+    mRootNode->hashContent(&hash, useStagingData);
+    return hash;
+}
+
+void Tree::updateCacheIfNeeded(Cache& cache, const TreeProperties& prop, bool useStagingData) {
+    int width = prop.getScaledWidth();
+    int height = prop.getScaledHeight();
+    bool canReuse = canReuseBitmap(cache.bitmap.get(), width, height);
+    if (canReuse && !cache.dirty) {
+        return;
+    }
+    cache.dirty = false;
+
+    // Syncing the properties marks the cache dirty even when nothing changed, so the tree is
+    // only drawn again if the content is different.
+    uint64_t hash = contentHash(prop, useStagingData);
+    if (canReuse && hash == cache.contentHash) {
+        return;
+    }
+    // A bigger bitmap is kept and drawn at its own size
+    if (canReuse) {
+        width = cache.bitmap->width();
+        height = cache.bitmap->height();
+    }
+    // The first content of the tree, or the same at another size: it doesn't animate
+    bool isStatic = cache.contentHash == 0 || cache.contentHash == hash;
+    // A hash holding an address is only meaningful to this tree
+    bool shareable = !mRootNode->hasContentHashedByAddress(useStagingData);
+
+    sk_sp<Bitmap> shared =
+            shareable ? SharedRasterCache::get().find(hash, width, height) : nullptr;
+    if (shared) {
+        cache.bitmap = std::move(shared);
+        cache.shared = true;
+        cache.contentHash = hash;
+        return;
+    }
+
+    allocateBitmapIfNeeded(cache, width, height);
+    updateBitmapCache(*cache.bitmap, useStagingData);
+    cache.contentHash = hash;
+    cache.shared = shareable && isStatic && SharedRasterCache::get().put(hash, cache.bitmap);
+}
+
 void Tree::updateCache(sp<skiapipeline::VectorDrawableAtlas>& atlas, GrContext* context) {
     SkRect dst;
     sk_sp<SkSurface> surface = mCache.getSurface(&dst);
@@ -596,7 +811,7 @@ void Tree::updateBitmapCache(Bitmap& bitmap, bool useStagingData) {
 }
 
 bool Tree::allocateBitmapIfNeeded(Cache& cache, int width, int height) {
-    if (!canReuseBitmap(cache.bitmap.get(), width, height)) {
+    if (cache.shared || !canReuseBitmap(cache.bitmap.get(), width, height)) {
 #ifndef ANDROID_ENABLE_LINEAR_BLENDING
         sk_sp<SkColorSpace> colorSpace = nullptr;
 #else
@@ -604,6 +819,7 @@ bool Tree::allocateBitmapIfNeeded(Cache& cache, int width, int height) {
 #endif
         SkImageInfo info = SkImageInfo::MakeN32(width, height, kPremul_SkAlphaType, colorSpace);
         cache.bitmap = Bitmap::allocateHeapBitmap(info);
+        cache.shared = false;
         return true;
     }
     return false;
@@ -116,6 +116,11 @@ public:
     Node(const Node& node) { mName = node.mName; }
     Node() {}
     virtual void draw(SkCanvas* outCanvas, bool useStagingData) = 0;
+    // Mixes the properties the rasterized node depends on into hash
+    virtual void hashContent(uint64_t* hash, bool useStagingData) = 0;
+    // Whether hashContent() had to identify some of the content by address rather than by value,
+    // in which case the raster can't be shared with other trees.
+    virtual bool hasContentHashedByAddress(bool useStagingData) { return false; }
     virtual void dump() = 0;
     void setName(const char* name) { mName = name; }
     virtual void setPropertyChangedListener(PropertyChangedListener* listener) {
@@ -138,7 +143,8 @@ public:
         std::vector<size_t> verbSizes;
         std::vector<float> points;
         bool operator==(const Data& data) const {
-            return verbs == data.verbs && verbSizes == data.verbSizes && points == data.points;
+            // Points first, as they are what differs from frame to frame of a path morph
+            return points == data.points && verbs == data.verbs && verbSizes == data.verbSizes;
         }
     };
 
@@ -171,10 +177,12 @@ public:
     Path() {}
 
     void dump() override;
+    void hashContent(uint64_t* hash, bool useStagingData) override;
     virtual void syncProperties() override;
     virtual void onPropertyChanged(Properties* prop) override {
         if (prop == &mStagingProperties) {
             mStagingPropertiesDirty = true;
+            mStagingSkPathDirty = true;
             if (mPropertyChangedListener) {
                 mPropertyChangedListener->onStagingPropertyChanged();
             }
@@ -198,6 +206,10 @@ protected:
     bool mSkPathDirty = true;
     SkPath mSkPath;
 
+    // The path of the staging data, UI thread only.
+    bool mStagingSkPathDirty = true;
+    SkPath mStagingSkPath;
+
 private:
     PathProperties mProperties = PathProperties(this);
     PathProperties mStagingProperties = PathProperties(this);
@@ -244,6 +256,7 @@ public:
                 onPropertyChanged();
             }
         }
+        const PrimitiveFields& getPrimitiveFields() const { return mPrimitiveFields; }
         SkShader* getFillGradient() const { return fillGradient; }
         SkShader* getStrokeGradient() const { return strokeGradient; }
         float getStrokeWidth() const { return mPrimitiveFields.strokeWidth; }
@@ -334,6 +347,8 @@ public:
     FullPath(const char* path, size_t strLength) : Path(path, strLength) {}
     FullPath() : Path() {}
     void draw(SkCanvas* outCanvas, bool useStagingData) override;
+    void hashContent(uint64_t* hash, bool useStagingData) override;
+    bool hasContentHashedByAddress(bool useStagingData) override;
     void dump() override;
     FullPathProperties* mutateStagingProperties() { return &mStagingProperties; }
     const FullPathProperties* stagingProperties() { return &mStagingProperties; }
@@ -377,6 +392,7 @@ public:
     ClipPath(const char* path, size_t strLength) : Path(path, strLength) {}
     ClipPath() : Path() {}
     void draw(SkCanvas* outCanvas, bool useStagingData) override;
+    void hashContent(uint64_t* hash, bool useStagingData) override;
     virtual void setAntiAlias(bool aa) {}
 };
 
@@ -464,6 +480,8 @@ public:
 
     // Methods below could be called from either UI thread or Render Thread.
     virtual void draw(SkCanvas* outCanvas, bool useStagingData) override;
+    void hashContent(uint64_t* hash, bool useStagingData) override;
+    bool hasContentHashedByAddress(bool useStagingData) override;
     void getLocalMatrix(SkMatrix* outMatrix, const GroupProperties& properties);
     void dump() override;
     static bool isValidProperty(int propertyId);
@@ -660,6 +678,10 @@ private:
         sk_sp<Bitmap> bitmap;  // used by HWUI pipeline and software
         // TODO: use surface instead of bitmap when drawing in software canvas
         bool dirty = true;
+        // The content hash of the tree rasterized in bitmap, 0 if none
+        uint64_t contentHash = 0;
+        // The bitmap is in the shared raster cache, it must not be drawn into
+        bool shared = false;
 
         // the rest of the code in Cache is used by Skia pipelines only
 
@@ -692,6 +714,10 @@ private:
     bool allocateBitmapIfNeeded(Cache& cache, int width, int height);
     bool canReuseBitmap(Bitmap*, int width, int height);
     void updateBitmapCache(Bitmap& outCache, bool useStagingData);
+    uint64_t contentHash(const TreeProperties& prop, bool useStagingData);
+    // Rasterizes the tree into the cache if it's dirty and its content changed, see
+    // SharedRasterCache
+    void updateCacheIfNeeded(Cache& cache, const TreeProperties& prop, bool useStagingData);
 
     // Cap the bitmap size, such that it won't hurt the performance too much
     // and it won't crash due to a very large scale.
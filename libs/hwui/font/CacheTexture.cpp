@@ -15,6 +15,7 @@
  */
 
 #include <SkGlyph.h>
+#include <androidfw/NativeMemoryStats.h>
 
 #include "../Caches.h"
 #include "../Debug.h"
@@ -26,85 +27,8 @@
 namespace android {
 namespace uirenderer {
 
-///////////////////////////////////////////////////////////////////////////////
-// CacheBlock
-///////////////////////////////////////////////////////////////////////////////
-
-/**
- * Insert new block into existing linked list of blocks. Blocks are sorted in increasing-width
- * order, except for the final block (the remainder space at the right, since we fill from the
- * left).
- */
-CacheBlock* CacheBlock::insertBlock(CacheBlock* head, CacheBlock* newBlock) {
-#if DEBUG_FONT_RENDERER
-    ALOGD("insertBlock: this, x, y, w, h = %p, %d, %d, %d, %d", newBlock, newBlock->mX,
-          newBlock->mY, newBlock->mWidth, newBlock->mHeight);
-#endif
-
-    CacheBlock* currBlock = head;
-    CacheBlock* prevBlock = nullptr;
-
-    while (currBlock && currBlock->mY != TEXTURE_BORDER_SIZE) {
-        if (newBlock->mWidth < currBlock->mWidth) {
-            newBlock->mNext = currBlock;
-            newBlock->mPrev = prevBlock;
-            currBlock->mPrev = newBlock;
-
-            if (prevBlock) {
-                prevBlock->mNext = newBlock;
-                return head;
-            } else {
-                return newBlock;
-            }
-        }
-
-        prevBlock = currBlock;
-        currBlock = currBlock->mNext;
-    }
-
-    // new block larger than all others - insert at end (but before the remainder space, if there)
-    newBlock->mNext = currBlock;
-    newBlock->mPrev = prevBlock;
-
-    if (currBlock) {
-        currBlock->mPrev = newBlock;
-    }
-
-    if (prevBlock) {
-        prevBlock->mNext = newBlock;
-        return head;
-    } else {
-        return newBlock;
-    }
-}
-
-CacheBlock* CacheBlock::removeBlock(CacheBlock* head, CacheBlock* blockToRemove) {
-#if DEBUG_FONT_RENDERER
-    ALOGD("removeBlock: this, x, y, w, h = %p, %d, %d, %d, %d", blockToRemove, blockToRemove->mX,
-          blockToRemove->mY, blockToRemove->mWidth, blockToRemove->mHeight);
-#endif
-
-    CacheBlock* newHead = head;
-    CacheBlock* nextBlock = blockToRemove->mNext;
-    CacheBlock* prevBlock = blockToRemove->mPrev;
-
-    if (prevBlock) {
-        // If this doesn't hold, we have a use-after-free below.
-        LOG_ALWAYS_FATAL_IF(head == blockToRemove,
-                            "removeBlock: head should not have a previous block");
-        prevBlock->mNext = nextBlock;
-    } else {
-        newHead = nextBlock;
-    }
-
-    if (nextBlock) {
-        nextBlock->mPrev = prevBlock;
-    }
-
-    delete blockToRemove;
-
-    return newHead;
-}
+// Regions are at least this wide, which bounds the width of the glyphs they can hold
+static constexpr uint16_t kMinRegionWidth = 512;
 
 ///////////////////////////////////////////////////////////////////////////////
 // CacheTexture
@@ -119,9 +43,15 @@ CacheTexture::CacheTexture(uint16_t width, uint16_t height, GLenum format, uint3
         , mCaches(Caches::getInstance()) {
     mTexture.blend = true;
 
-    mCacheBlocks =
-            new CacheBlock(TEXTURE_BORDER_SIZE, TEXTURE_BORDER_SIZE,
-                           getWidth() - TEXTURE_BORDER_SIZE, getHeight() - TEXTURE_BORDER_SIZE);
+    const int regionCount = std::max(1, width / kMinRegionWidth);
+    mRegionWidth = width / regionCount;
+    mRegions.resize(regionCount);
+    for (int i = 0; i < regionCount; i++) {
+        mRegions[i].mX = i * mRegionWidth;
+        // the last region gets the remainder
+        mRegions[i].mWidth = (i == regionCount - 1) ? width - mRegions[i].mX : mRegionWidth;
+        initRegion(mRegions[i]);
+    }
 
     // OpenGL ES 3.0+ lets us specify the row length for unpack operations such
     // as glTexSubImage2D(). This allows us to upload a sub-rectangle of a texture.
@@ -136,22 +66,28 @@ CacheTexture::~CacheTexture() {
 }
 
 void CacheTexture::reset() {
-    // Delete existing cache blocks
-    while (mCacheBlocks != nullptr) {
-        CacheBlock* tmpBlock = mCacheBlocks;
-        mCacheBlocks = mCacheBlocks->mNext;
-        delete tmpBlock;
+    for (auto& region : mRegions) {
+        region.mSkyline.clear();
+        region.mNumGlyphs = 0;
     }
     mNumGlyphs = 0;
     mCurrentQuad = 0;
 }
 
 void CacheTexture::init() {
-    // reset, then create a new remainder space to start again
+    // reset, then start every region over with an empty skyline
     reset();
-    mCacheBlocks =
-            new CacheBlock(TEXTURE_BORDER_SIZE, TEXTURE_BORDER_SIZE,
-                           getWidth() - TEXTURE_BORDER_SIZE, getHeight() - TEXTURE_BORDER_SIZE);
+    for (auto& region : mRegions) {
+        initRegion(region);
+    }
+}
+
+void CacheTexture::initRegion(CacheRegion& region) {
+    // The first column and row of every region hold the leading borders of its first glyphs
+    region.mSkyline.clear();
+    region.mSkyline.push_back(
+            {static_cast<uint16_t>(region.mX + TEXTURE_BORDER_SIZE), TEXTURE_BORDER_SIZE,
+             static_cast<uint16_t>(region.mWidth - TEXTURE_BORDER_SIZE)});
 }
 
 void CacheTexture::releaseMesh() {
@@ -160,6 +96,7 @@ void CacheTexture::releaseMesh() {
 
 void CacheTexture::releasePixelBuffer() {
     if (mPixelBuffer) {
+        NativeMemoryStats::Remove(NativeMemoryCategory::kHwuiFontCache, pixelBufferSize());
         delete mPixelBuffer;
         mPixelBuffer = nullptr;
     }
@@ -181,6 +118,7 @@ void CacheTexture::allocateMesh() {
 void CacheTexture::allocatePixelBuffer() {
     if (!mPixelBuffer) {
         mPixelBuffer = PixelBuffer::create(mFormat, getWidth(), getHeight());
+        NativeMemoryStats::Add(NativeMemoryCategory::kHwuiFontCache, pixelBufferSize());
     }
 
     GLint internalFormat = mFormat;
@@ -257,96 +195,136 @@ bool CacheTexture::fitBitmap(const SkGlyph& glyph, uint32_t* retOriginX, uint32_
         return false;
     }
 
+    // Every glyph owns its trailing border column and row, the leading ones are the trailing
+    // borders of its neighbours, or the first column and row of the region.
     uint16_t glyphW = glyph.fWidth + TEXTURE_BORDER_SIZE;
     uint16_t glyphH = glyph.fHeight + TEXTURE_BORDER_SIZE;
 
-    // roundedUpW equals glyphW to the next multiple of CACHE_BLOCK_ROUNDING_SIZE.
-    // This columns for glyphs that are close but not necessarily exactly the same size. It trades
-    // off the loss of a few pixels for some glyphs against the ability to store more glyphs
-    // of varying sizes in one block.
-    uint16_t roundedUpW = (glyphW + CACHE_BLOCK_ROUNDING_SIZE - 1) & -CACHE_BLOCK_ROUNDING_SIZE;
-
-    CacheBlock* cacheBlock = mCacheBlocks;
-    while (cacheBlock) {
-        // Store glyph in this block iff: it fits the block's remaining space and:
-        // it's the remainder space (mY == 0) or there's only enough height for this one glyph
-        // or it's within ROUNDING_SIZE of the block width
-        if (roundedUpW <= cacheBlock->mWidth && glyphH <= cacheBlock->mHeight &&
-            (cacheBlock->mY == TEXTURE_BORDER_SIZE ||
-             (cacheBlock->mWidth - roundedUpW < CACHE_BLOCK_ROUNDING_SIZE))) {
-            if (cacheBlock->mHeight - glyphH < glyphH) {
-                // Only enough space for this glyph - don't bother rounding up the width
-                roundedUpW = glyphW;
-            }
-
-            *retOriginX = cacheBlock->mX;
-            *retOriginY = cacheBlock->mY;
-
-            // If this is the remainder space, create a new cache block for this column. Otherwise,
-            // adjust the info about this column.
-            if (cacheBlock->mY == TEXTURE_BORDER_SIZE) {
-                uint16_t oldX = cacheBlock->mX;
-                // Adjust remainder space dimensions
-                cacheBlock->mWidth -= roundedUpW;
-                cacheBlock->mX += roundedUpW;
-
-                if (getHeight() - glyphH >= glyphH) {
-                    // There's enough height left over to create a new CacheBlock
-                    CacheBlock* newBlock =
-                            new CacheBlock(oldX, glyphH + TEXTURE_BORDER_SIZE, roundedUpW,
-                                           getHeight() - glyphH - TEXTURE_BORDER_SIZE);
-#if DEBUG_FONT_RENDERER
-                    ALOGD("fitBitmap: Created new block: this, x, y, w, h = %p, %d, %d, %d, %d",
-                          newBlock, newBlock->mX, newBlock->mY, newBlock->mWidth,
-                          newBlock->mHeight);
-#endif
-                    mCacheBlocks = CacheBlock::insertBlock(mCacheBlocks, newBlock);
-                }
-            } else {
-                // Insert into current column and adjust column dimensions
-                cacheBlock->mY += glyphH;
-                cacheBlock->mHeight -= glyphH;
+    int bestRegion = -1;
+    size_t bestNode = 0;
+    uint16_t bestY = 0;
+    for (size_t i = 0; i < mRegions.size(); i++) {
+        size_t node;
+        uint16_t y;
+        if (findPosition(mRegions[i], glyphW, glyphH, &node, &y) &&
+            (bestRegion < 0 || y < bestY)) {
+            bestRegion = i;
+            bestNode = node;
+            bestY = y;
+        }
+    }
+    if (bestRegion < 0) {
 #if DEBUG_FONT_RENDERER
-                ALOGD("fitBitmap: Added to existing block: this, x, y, w, h = %p, %d, %d, %d, %d",
-                      cacheBlock, cacheBlock->mX, cacheBlock->mY, cacheBlock->mWidth,
-                      cacheBlock->mHeight);
+        ALOGD("fitBitmap: returning false for glyph of size %d, %d", glyphW, glyphH);
 #endif
-            }
+        return false;
+    }
 
-            if (cacheBlock->mHeight < std::min(glyphH, glyphW)) {
-                // If remaining space in this block is too small to be useful, remove it
-                mCacheBlocks = CacheBlock::removeBlock(mCacheBlocks, cacheBlock);
-            }
+    CacheRegion& region = mRegions[bestRegion];
+    *retOriginX = region.mSkyline[bestNode].mX;
+    *retOriginY = bestY;
+    addSkylineLevel(region, bestNode, *retOriginX, bestY, glyphW, glyphH);
 
-            mDirty = true;
-            const Rect r(*retOriginX - TEXTURE_BORDER_SIZE, *retOriginY - TEXTURE_BORDER_SIZE,
-                         *retOriginX + glyphW, *retOriginY + glyphH);
-            mDirtyRect.unionWith(r);
-            mNumGlyphs++;
+    mDirty = true;
+    const Rect r(*retOriginX - TEXTURE_BORDER_SIZE, *retOriginY - TEXTURE_BORDER_SIZE,
+                 *retOriginX + glyphW, *retOriginY + glyphH);
+    mDirtyRect.unionWith(r);
+    region.mNumGlyphs++;
+    mNumGlyphs++;
 
 #if DEBUG_FONT_RENDERER
-            ALOGD("fitBitmap: current block list:");
-            mCacheBlocks->output();
+    ALOGD("fitBitmap: added glyph to region %d at %d, %d", bestRegion, *retOriginX, *retOriginY);
 #endif
+    return true;
+}
 
-            return true;
+// Finds the lowest position for a glyphW x glyphH rectangle whose left edge is at the start of a
+// skyline node. Ties go to the leftmost position.
+bool CacheTexture::findPosition(const CacheRegion& region, uint16_t glyphW, uint16_t glyphH,
+                                size_t* outNode, uint16_t* outY) const {
+    const uint32_t regionRight = region.mX + region.mWidth;
+    bool found = false;
+    for (size_t i = 0; i < region.mSkyline.size(); i++) {
+        const uint32_t left = region.mSkyline[i].mX;
+        if (left + glyphW > regionRight) break;
+
+        // the glyph rests on the highest node below its span
+        const uint32_t right = left + glyphW;
+        uint32_t y = 0;
+        for (size_t j = i; j < region.mSkyline.size() && region.mSkyline[j].mX < right; j++) {
+            y = std::max<uint32_t>(y, region.mSkyline[j].mY);
+        }
+        if (y + glyphH > getHeight()) continue;
+        if (!found || y < *outY) {
+            found = true;
+            *outNode = i;
+            *outY = y;
         }
-        cacheBlock = cacheBlock->mNext;
     }
-#if DEBUG_FONT_RENDERER
-    ALOGD("fitBitmap: returning false for glyph of size %d, %d", glyphW, glyphH);
-#endif
-    return false;
+    return found;
+}
+
+void CacheTexture::addSkylineLevel(CacheRegion& region, size_t node, uint16_t x, uint16_t y,
+                                   uint16_t glyphW, uint16_t glyphH) {
+    auto& skyline = region.mSkyline;
+    skyline.insert(skyline.begin() + node, {x, static_cast<uint16_t>(y + glyphH), glyphW});
+
+    // shrink or remove the nodes now covered by the new one
+    const uint32_t right = x + glyphW;
+    size_t i = node + 1;
+    while (i < skyline.size() && skyline[i].mX < right) {
+        const uint32_t nodeRight = skyline[i].mX + skyline[i].mWidth;
+        if (nodeRight <= right) {
+            skyline.erase(skyline.begin() + i);
+        } else {
+            skyline[i].mWidth = nodeRight - right;
+            skyline[i].mX = right;
+            break;
+        }
+    }
+
+    // merge neighbours at the same height
+    for (i = 0; i + 1 < skyline.size();) {
+        if (skyline[i].mY == skyline[i + 1].mY) {
+            skyline[i].mWidth += skyline[i + 1].mWidth;
+            skyline.erase(skyline.begin() + i + 1);
+        } else {
+            i++;
+        }
+    }
+}
+
+int CacheTexture::findEvictableRegion(const SkGlyph& glyph) const {
+    const uint32_t glyphW = glyph.fWidth + TEXTURE_BORDER_SIZE;
+    const uint32_t glyphH = glyph.fHeight + TEXTURE_BORDER_SIZE;
+    if (glyphH + TEXTURE_BORDER_SIZE > getHeight()) return -1;
+
+    int bestRegion = -1;
+    for (size_t i = 0; i < mRegions.size(); i++) {
+        const CacheRegion& region = mRegions[i];
+        if (glyphW + TEXTURE_BORDER_SIZE > region.mWidth) continue;
+        if (bestRegion < 0 || region.mLastUsed < mRegions[bestRegion].mLastUsed) {
+            bestRegion = i;
+        }
+    }
+    return bestRegion;
+}
+
+void CacheTexture::evictRegion(int regionIndex) {
+    CacheRegion& region = mRegions[regionIndex];
+    mNumGlyphs -= region.mNumGlyphs;
+    region.mNumGlyphs = 0;
+    initRegion(region);
 }
 
 uint32_t CacheTexture::calculateFreeMemory() const {
-    CacheBlock* cacheBlock = mCacheBlocks;
     uint32_t free = 0;
     // currently only two formats are supported: GL_ALPHA or GL_RGBA;
     uint32_t bpp = mFormat == GL_RGBA ? 4 : 1;
-    while (cacheBlock) {
-        free += bpp * cacheBlock->mWidth * cacheBlock->mHeight;
-        cacheBlock = cacheBlock->mNext;
+    for (auto& region : mRegions) {
+        for (auto& node : region.mSkyline) {
+            free += bpp * node.mWidth * (getHeight() - node.mY);
+        }
     }
     return free;
 }
@@ -26,46 +26,37 @@
 #include <SkGlyph.h>
 #include <utils/Log.h>
 
+#include <algorithm>
+#include <vector>
+
 namespace android {
 namespace uirenderer {
 
 class Caches;
 
 /**
- * CacheBlock is a node in a linked list of current free space areas in a CacheTexture.
- * Using CacheBlocks enables us to pack the cache from top to bottom as well as left to right.
- * When we add a glyph to the cache, we see if it fits within one of the existing columns that
- * have already been started (this is the case if the glyph fits vertically as well as
- * horizontally, and if its width is sufficiently close to the column width to avoid
- * sub-optimal packing of small glyphs into wide columns). If there is no column in which the
- * glyph fits, we check the final node, which is the remaining space in the cache, creating
- * a new column as appropriate.
+ * A CacheTexture is split into CacheRegions, vertical strips that are packed and evicted
+ * independently, so that running out of space only costs the glyphs of the least recently used
+ * region instead of the whole texture.
  *
- * As columns fill up, we remove their CacheBlock from the list to avoid having to check
- * small blocks in the future.
+ * Each region is packed with a skyline: the list of horizontal segments that make up the bottom
+ * edge of the space allocated so far, sorted left to right. A glyph goes to the position where
+ * the skyline under it is the lowest, which keeps glyphs of very different sizes from wasting
+ * the space left over by fixed width columns.
  */
-struct CacheBlock {
+struct CacheRegion {
+    struct SkylineNode {
+        uint16_t mX;
+        uint16_t mY;
+        uint16_t mWidth;
+    };
+
     uint16_t mX;
-    uint16_t mY;
     uint16_t mWidth;
-    uint16_t mHeight;
-    CacheBlock* mNext;
-    CacheBlock* mPrev;
-
-    CacheBlock(uint16_t x, uint16_t y, uint16_t width, uint16_t height)
-            : mX(x), mY(y), mWidth(width), mHeight(height), mNext(nullptr), mPrev(nullptr) {}
-
-    static CacheBlock* insertBlock(CacheBlock* head, CacheBlock* newBlock);
-    static CacheBlock* removeBlock(CacheBlock* head, CacheBlock* blockToRemove);
-
-    void output() {
-        CacheBlock* currBlock = this;
-        while (currBlock) {
-            ALOGD("Block: this, x, y, w, h = %p, %d, %d, %d, %d", currBlock, currBlock->mX,
-                  currBlock->mY, currBlock->mWidth, currBlock->mHeight);
-            currBlock = currBlock->mNext;
-        }
-    }
+    std::vector<SkylineNode> mSkyline;
+    uint16_t mNumGlyphs = 0;
+    // Last time, in FontRenderer draw calls, that a glyph in this region was used
+    uint32_t mLastUsed = 0;
 };
 
 class CacheTexture {
@@ -88,12 +79,40 @@ public:
 
     bool fitBitmap(const SkGlyph& glyph, uint32_t* retOriginX, uint32_t* retOriginY);
 
+    /**
+     * Returns the least recently used region that can hold glyph once emptied, or -1 if the
+     * glyph doesn't fit in any region of this texture.
+     */
+    int findEvictableRegion(const SkGlyph& glyph) const;
+
+    /**
+     * Forgets all glyphs in the region. The caller is responsible for invalidating them, and
+     * for drawing any pending quads that sample the region first.
+     */
+    void evictRegion(int region);
+
+    const CacheRegion& getRegion(int region) const { return mRegions[region]; }
+
+    int getRegionForX(uint32_t x) const {
+        return std::min<int>(x / mRegionWidth, mRegions.size() - 1);
+    }
+
+    int getRegionCount() const { return mRegions.size(); }
+
+    void markUsed(uint32_t x, uint32_t useClock) {
+        mRegions[getRegionForX(x)].mLastUsed = useClock;
+    }
+
     inline uint16_t getWidth() const { return mWidth; }
 
     inline uint16_t getHeight() const { return mHeight; }
 
     inline GLenum getFormat() const { return mFormat; }
 
+    inline size_t pixelBufferSize() const {
+        return getWidth() * getHeight() * PixelBuffer::formatSize(mFormat);
+    }
+
     inline uint32_t getOffset(uint16_t x, uint16_t y) const {
         return (y * getWidth() + x) * PixelBuffer::formatSize(mFormat);
     }
@@ -150,6 +169,11 @@ public:
 
 private:
     void setDirty(bool dirty);
+    void initRegion(CacheRegion& region);
+    bool findPosition(const CacheRegion& region, uint16_t glyphW, uint16_t glyphH,
+                      size_t* outNode, uint16_t* outY) const;
+    void addSkylineLevel(CacheRegion& region, size_t node, uint16_t x, uint16_t y,
+                         uint16_t glyphW, uint16_t glyphH);
 
     PixelBuffer* mPixelBuffer = nullptr;
     Texture mTexture;
@@ -162,7 +186,8 @@ private:
     uint32_t mCurrentQuad = 0;
     uint32_t mMaxQuadCount;
     Caches& mCaches;
-    CacheBlock* mCacheBlocks;
+    uint16_t mRegionWidth;
+    std::vector<CacheRegion> mRegions;
     bool mHasUnpackRowLength;
     Rect mDirtyRect;
 };
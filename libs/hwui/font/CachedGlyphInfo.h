@@ -25,6 +25,8 @@ class CacheTexture;
 struct CachedGlyphInfo {
     // Has the cache been invalidated?
     bool mIsValid;
+    // Is the glyph being rasterized on a worker thread?
+    bool mIsPending;
     // Location of the cached glyph in the bitmap
     // in case we need to resize the texture or
     // render to bitmap
@@ -132,6 +132,16 @@ void Font::invalidateTextureCache(CacheTexture* cacheTexture) {
     }
 }
 
+void Font::invalidateTextureCache(CacheTexture* cacheTexture, uint32_t left, uint32_t right) {
+    for (uint32_t i = 0; i < mCachedGlyphs.size(); i++) {
+        CachedGlyphInfo* cachedGlyph = mCachedGlyphs.valueAt(i);
+        if (cachedGlyph->mCacheTexture == cacheTexture && cachedGlyph->mStartX >= left &&
+            cachedGlyph->mStartX < right) {
+            cachedGlyph->mIsValid = false;
+        }
+    }
+}
+
 void Font::measureCachedGlyph(CachedGlyphInfo* glyph, int x, int y, uint8_t* bitmap,
                               uint32_t bitmapW, uint32_t bitmapH, Rect* bounds, const float* pos) {
     int width = (int)glyph->mBitmapWidth;
@@ -278,6 +288,8 @@ CachedGlyphInfo* Font::getCachedGlyph(const SkPaint* paint, glyph_t textUnit, bo
                                               &mDescription.mLookupTransform);
             const SkGlyph& skiaGlyph = GET_METRICS(autoCache.getCache(), textUnit);
             updateGlyphCache(paint, skiaGlyph, autoCache.getCache(), cachedGlyph, precaching);
+        } else if (cachedGlyph->mCacheTexture) {
+            cachedGlyph->mCacheTexture->markUsed(cachedGlyph->mStartX, mState->mUseClock);
         }
     } else {
         cachedGlyph = cacheGlyph(paint, textUnit, precaching);
@@ -354,6 +366,9 @@ void Font::precache(const SkPaint* paint, const glyph_t* glyphs, int numGlyphs)
         return;
     }
 
+    const bool async = Properties::enableAsyncGlyphRaster;
+    std::vector<glyph_t> misses;
+
     int glyphsCount = 0;
     while (glyphsCount < numGlyphs) {
         glyph_t glyph = *(glyphs++);
@@ -362,10 +377,52 @@ void Font::precache(const SkPaint* paint, const glyph_t* glyphs, int numGlyphs)
         if (IS_END_OF_STRING(glyph)) {
             break;
         }
-
-        getCachedGlyph(paint, glyph, true);
         glyphsCount++;
+
+        if (async) {
+            CachedGlyphInfo* cachedGlyph = mCachedGlyphs.valueFor(glyph);
+            if (cachedGlyph && cachedGlyph->mIsPending) {
+                continue;
+            }
+            if (cachedGlyph && cachedGlyph->mIsValid) {
+                getCachedGlyph(paint, glyph, true);
+                continue;
+            }
+            if (!cachedGlyph) {
+                // Placeholder until the raster task is done. If the glyph is drawn before
+                // then, getCachedGlyph() rasterizes it synchronously since it isn't valid.
+                cachedGlyph = new CachedGlyphInfo();
+                mCachedGlyphs.add(glyph, cachedGlyph);
+            }
+            cachedGlyph->mIsPending = true;
+            misses.push_back(glyph);
+        } else {
+            getCachedGlyph(paint, glyph, true);
+        }
+    }
+
+    if (!misses.empty()) {
+        mState->rasterizeGlyphsAsync(this, *paint, std::move(misses));
+    }
+}
+
+void Font::cacheRasterizedGlyph(glyph_t glyph, const SkGlyph& skiaGlyph) {
+    CachedGlyphInfo* cachedGlyph = mCachedGlyphs.valueFor(glyph);
+    if (!cachedGlyph || !cachedGlyph->mIsPending) {
+        return;
+    }
+    cachedGlyph->mIsPending = false;
+    if (cachedGlyph->mIsValid) {
+        // already drawn, and so rasterized, before the task finished
+        return;
+    }
+    bool empty = skiaGlyph.fWidth == 0 || skiaGlyph.fHeight == 0;
+    if (!empty && !skiaGlyph.fImage) {
+        // the glyph has no image, leave it to getCachedGlyph()
+        return;
     }
+    cachedGlyph->mGlyphIndex = skiaGlyph.fID;
+    updateGlyphCache(nullptr, skiaGlyph, nullptr, cachedGlyph, true);
 }
 
 void Font::render(const SkPaint* paint, const glyph_t* glyphs, int numGlyphs, int x, int y,
@@ -426,8 +483,8 @@ void Font::updateGlyphCache(const SkPaint* paint, const SkGlyph& skiaGlyph,
     uint32_t startX = 0;
     uint32_t startY = 0;
 
-    // Get the bitmap for the glyph
-    if (!skiaGlyph.fImage) {
+    // Get the bitmap for the glyph, unless it was rasterized ahead of time
+    if (!skiaGlyph.fImage && skiaGlyphCache) {
         skiaGlyphCache->findImage(skiaGlyph);
     }
     mState->cacheBitmap(skiaGlyph, glyph, &startX, &startY, precaching);
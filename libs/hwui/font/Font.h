@@ -114,6 +114,11 @@ private:
                  const float* positions);
 
     void invalidateTextureCache(CacheTexture* cacheTexture = nullptr);
+    // Invalidates the glyphs of cacheTexture whose left edge is in [left, right)
+    void invalidateTextureCache(CacheTexture* cacheTexture, uint32_t left, uint32_t right);
+
+    // Adds a glyph rasterized by FontRenderer::rasterizeGlyphsAsync to the cache textures
+    void cacheRasterizedGlyph(glyph_t glyph, const SkGlyph& skiaGlyph);
 
     CachedGlyphInfo* cacheGlyph(const SkPaint* paint, glyph_t glyph, bool precaching);
     void updateGlyphCache(const SkPaint* paint, const SkGlyph& skiaGlyph,
@@ -15,18 +15,27 @@
  */
 
 #include "AnimatedImageDrawable.h"
+#include "AnimatedImageFramePool.h"
 #include "AnimatedImageThread.h"
 
+#include "Properties.h"
 #include "utils/TraceUtils.h"
 
+#include <SkImagePriv.h>
 #include <SkPicture.h>
 #include <SkRefCnt.h>
 #include <SkTLazy.h>
 
+#include <log/log.h>
+
+#include <cmath>
+
 namespace android {
 
 AnimatedImageDrawable::AnimatedImageDrawable(sk_sp<SkAnimatedImage> animatedImage, size_t bytesUsed)
-        : mSkAnimatedImage(std::move(animatedImage)), mBytesUsed(bytesUsed) {
+        : mSkAnimatedImage(std::move(animatedImage))
+        , mBytesUsed(bytesUsed)
+        , mPrefetchFrames(uirenderer::Properties::animatedImagePrefetchFrames) {
     mTimeToShowNextSnapshot = ms2ns(mSkAnimatedImage->currentFrameDuration());
 }
 
@@ -56,8 +65,14 @@ bool AnimatedImageDrawable::isRunning() {
 }
 
 bool AnimatedImageDrawable::nextSnapshotReady() const {
-    return mNextSnapshot.valid() &&
-           mNextSnapshot.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    return !mNextSnapshots.empty() &&
+           mNextSnapshots.front().wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void AnimatedImageDrawable::takeDecodeStats(nsecs_t* outDecodeDuration, int* outLateFrames) {
+    *outDecodeDuration = mDecodeDuration.exchange(0);
+    *outLateFrames = mLateFrames;
+    mLateFrames = 0;
 }
 
 // Only called on the RenderThread while UI thread is locked.
@@ -74,7 +89,7 @@ bool AnimatedImageDrawable::isDirty(nsecs_t* outDelay) {
     std::unique_lock lock{mSwapLock};
     mCurrentTime += currentTime - lastWallTime;
 
-    if (!mNextSnapshot.valid()) {
+    if (mNextSnapshots.empty()) {
         // Need to trigger onDraw in order to start decoding the next frame.
         *outDelay = mTimeToShowNextSnapshot - mCurrentTime;
         return true;
@@ -94,6 +109,7 @@ bool AnimatedImageDrawable::isDirty(nsecs_t* outDelay) {
         // time to draw it. There's not a good way to know when decoding will
         // finish, so request an update immediately.
         *outDelay = 0;
+        mLateFrames++;
     }
 
     return false;
@@ -101,29 +117,55 @@ bool AnimatedImageDrawable::isDirty(nsecs_t* outDelay) {
 
 // Only called on the AnimatedImageThread.
 AnimatedImageDrawable::Snapshot AnimatedImageDrawable::decodeNextFrame() {
+    ATRACE_NAME("AnimatedImageDrawable::decodeNextFrame");
+    const nsecs_t start = systemTime(CLOCK_MONOTONIC);
     Snapshot snap;
     {
         std::unique_lock lock{mImageLock};
         snap.mDurationMS = mSkAnimatedImage->decodeNextFrame();
-        snap.mPic.reset(mSkAnimatedImage->newPictureSnapshot());
+        snapshotFrameLocked(&snap);
     }
+    mDecodeDuration += systemTime(CLOCK_MONOTONIC) - start;
 
     return snap;
 }
 
 // Only called on the AnimatedImageThread.
 AnimatedImageDrawable::Snapshot AnimatedImageDrawable::reset() {
+    const nsecs_t start = systemTime(CLOCK_MONOTONIC);
     Snapshot snap;
     {
         std::unique_lock lock{mImageLock};
         mSkAnimatedImage->reset();
-        snap.mPic.reset(mSkAnimatedImage->newPictureSnapshot());
+        snapshotFrameLocked(&snap);
         snap.mDurationMS = mSkAnimatedImage->currentFrameDuration();
     }
+    mDecodeDuration += systemTime(CLOCK_MONOTONIC) - start;
 
     return snap;
 }
 
+void AnimatedImageDrawable::snapshotFrameLocked(Snapshot* outSnapshot) {
+    const SkRect bounds = mSkAnimatedImage->getBounds();
+    const SkImageInfo info = SkImageInfo::MakeN32Premul(std::ceil(bounds.width()),
+                                                        std::ceil(bounds.height()));
+    SkBitmap buffer;
+    if (info.isEmpty() || !uirenderer::AnimatedImageFramePool::get().acquire(info, &buffer)) {
+        ALOGW("AnimatedImageDrawable: no frame buffer for %dx%d, recording a picture",
+              info.width(), info.height());
+        outSnapshot->mPic.reset(mSkAnimatedImage->newPictureSnapshot());
+        return;
+    }
+
+    SkCanvas canvas(buffer);
+    canvas.clear(SK_ColorTRANSPARENT);
+    canvas.translate(-bounds.fLeft, -bounds.fTop);
+    mSkAnimatedImage->draw(&canvas);
+    // the buffer may have held an earlier frame, which must not be mistaken for this one
+    buffer.notifyPixelsChanged();
+    outSnapshot->mImage = SkMakeImageFromRasterBitmap(buffer, kNever_SkCopyPixelsMode);
+}
+
 // Only called on the RenderThread.
 void AnimatedImageDrawable::onDraw(SkCanvas* canvas) {
     SkTLazy<SkPaint> lazyPaint;
@@ -143,7 +185,7 @@ void AnimatedImageDrawable::onDraw(SkCanvas* canvas) {
     const bool starting = mStarting;
     mStarting = false;
 
-    const bool drawDirectly = !mSnapshot.mPic;
+    const bool drawDirectly = !mSnapshot.hasFrame();
     if (drawDirectly) {
         // The image is not animating, and never was. Draw directly from
         // mSkAnimatedImage.
@@ -159,19 +201,23 @@ void AnimatedImageDrawable::onDraw(SkCanvas* canvas) {
     } else if (starting) {
         // The image has animated, and now is being reset. Queue up the first
         // frame, but keep showing the current frame until the first is ready.
+        // Frames decoded ahead are dropped, the thread resets after decoding them.
         auto& thread = uirenderer::AnimatedImageThread::getInstance();
-        mNextSnapshot = thread.reset(sk_ref_sp(this));
+        mNextSnapshots.clear();
+        mNextSnapshots.push_back(thread.reset(sk_ref_sp(this)));
     }
 
     bool finalFrame = false;
     if (mRunning && nextSnapshotReady()) {
         std::unique_lock lock{mSwapLock};
         if (mCurrentTime >= mTimeToShowNextSnapshot) {
-            mSnapshot = mNextSnapshot.get();
+            mSnapshot = mNextSnapshots.front().get();
+            mNextSnapshots.pop_front();
             const nsecs_t timeToShowCurrentSnap = mTimeToShowNextSnapshot;
             if (mSnapshot.mDurationMS == SkAnimatedImage::kFinished) {
                 finalFrame = true;
                 mRunning = false;
+                mNextSnapshots.clear();
             } else {
                 mTimeToShowNextSnapshot += ms2ns(mSnapshot.mDurationMS);
                 if (mCurrentTime >= mTimeToShowNextSnapshot) {
@@ -185,15 +231,28 @@ void AnimatedImageDrawable::onDraw(SkCanvas* canvas) {
         }
     }
 
-    if (mRunning && !mNextSnapshot.valid()) {
+    if (mRunning && mNextSnapshots.size() < mPrefetchFrames) {
+        // Keep the queue full, so that a slow frame has a few frame durations to decode.
         auto& thread = uirenderer::AnimatedImageThread::getInstance();
-        mNextSnapshot = thread.decodeNextFrame(sk_ref_sp(this));
+        while (mNextSnapshots.size() < mPrefetchFrames) {
+            mNextSnapshots.push_back(thread.decodeNextFrame(sk_ref_sp(this)));
+        }
     }
 
     if (!drawDirectly) {
         // No other thread will modify mCurrentSnap so this should be safe to
         // use without locking.
-        canvas->drawPicture(mSnapshot.mPic, nullptr, lazyPaint.getMaybeNull());
+        if (mSnapshot.mImage) {
+            SkPaint imagePaint;
+            if (lazyPaint.isValid()) {
+                imagePaint = *lazyPaint.get();
+            }
+            imagePaint.setFilterQuality(kLow_SkFilterQuality);
+            const SkRect bounds = mSkAnimatedImage->getBounds();
+            canvas->drawImage(mSnapshot.mImage, bounds.fLeft, bounds.fTop, &imagePaint);
+        } else {
+            canvas->drawPicture(mSnapshot.mPic, nullptr, lazyPaint.getMaybeNull());
+        }
     }
 
     if (finalFrame) {
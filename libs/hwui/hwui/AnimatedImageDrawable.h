@@ -25,8 +25,11 @@
 #include <SkCanvas.h>
 #include <SkColorFilter.h>
 #include <SkDrawable.h>
+#include <SkImage.h>
 #include <SkPicture.h>
 
+#include <atomic>
+#include <deque>
 #include <future>
 #include <mutex>
 
@@ -91,9 +94,14 @@ public:
     }
 
     struct Snapshot {
+        // The frame, in a buffer of the AnimatedImageFramePool. mPic is only used if there was
+        // no memory for one.
+        sk_sp<SkImage> mImage;
         sk_sp<SkPicture> mPic;
         int mDurationMS;
 
+        bool hasFrame() const { return mImage || mPic; }
+
         Snapshot() = default;
 
         Snapshot(Snapshot&&) = default;
@@ -110,24 +118,39 @@ public:
         return sizeof(this) + mBytesUsed;
     }
 
+    /**
+     * Returns the time the AnimatedImageThread spent decoding frames of this drawable, and the
+     * number of times isDirty found the next frame due but not decoded yet, since the previous
+     * call. Only called on the RenderThread.
+     */
+    void takeDecodeStats(nsecs_t* outDecodeDuration, int* outLateFrames);
+
 protected:
     virtual void onDraw(SkCanvas* canvas) override;
 
 private:
+    // Draws the current frame of mSkAnimatedImage into a pooled buffer. mImageLock must be held.
+    void snapshotFrameLocked(Snapshot* outSnapshot);
+
     sk_sp<SkAnimatedImage> mSkAnimatedImage;
     const size_t mBytesUsed;
 
+    // How many frames are decoded ahead, see Properties::animatedImagePrefetchFrames
+    const size_t mPrefetchFrames;
+
     bool mRunning = false;
     bool mStarting = false;
 
     // A snapshot of the current frame to draw.
     Snapshot mSnapshot;
 
-    std::future<Snapshot> mNextSnapshot;
+    // The frames queued on the AnimatedImageThread, in display order. Only used on the
+    // RenderThread.
+    std::deque<std::future<Snapshot>> mNextSnapshots;
 
     bool nextSnapshotReady() const;
 
-    // When to switch from mSnapshot to mNextSnapshot.
+    // When to switch from mSnapshot to the first of mNextSnapshots.
     nsecs_t mTimeToShowNextSnapshot = 0;
 
     // The current time for the drawable itself.
@@ -143,6 +166,10 @@ private:
     // Locked when mSkAnimatedImage is being updated or drawn.
     std::mutex mImageLock;
 
+    // Added to by the decoding thread, see takeDecodeStats
+    std::atomic<nsecs_t> mDecodeDuration{0};
+    int mLateFrames = 0;
+
     struct Properties {
         int mAlpha = SK_AlphaOPAQUE;
         sk_sp<SkColorFilter> mColorFilter;
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AnimatedImageFramePool.h"
+
+#include <SkPixelRef.h>
+
+namespace android {
+namespace uirenderer {
+
+// Buffers allocated past this are handed out without being pooled
+#define MAX_POOLED_BYTES (16 * 1024 * 1024)
+
+static bool isInUse(const SkBitmap& buffer) {
+    return !buffer.pixelRef()->unique();
+}
+
+AnimatedImageFramePool& AnimatedImageFramePool::get() {
+    static AnimatedImageFramePool sPool;
+    return sPool;
+}
+
+bool AnimatedImageFramePool::acquire(const SkImageInfo& info, SkBitmap* outBitmap) {
+    std::lock_guard<std::mutex> lock(mLock);
+    for (const SkBitmap& buffer : mBuffers) {
+        // handed out with the lock held, so that no other worker can take it too
+        if (buffer.info() == info && !isInUse(buffer)) {
+            *outBitmap = buffer;
+            return true;
+        }
+    }
+
+    const size_t bytes = info.computeMinByteSize();
+    if (mPooledBytes + bytes > MAX_POOLED_BYTES) {
+        // make room by dropping free buffers of other sizes
+        trimLocked(MAX_POOLED_BYTES - std::min(bytes, (size_t)MAX_POOLED_BYTES));
+    }
+    SkBitmap buffer;
+    if (!buffer.tryAllocPixels(info)) {
+        return false;
+    }
+    if (mPooledBytes + bytes <= MAX_POOLED_BYTES) {
+        mBuffers.push_back(buffer);
+        mPooledBytes += bytes;
+    }
+    *outBitmap = buffer;
+    return true;
+}
+
+void AnimatedImageFramePool::trim() {
+    std::lock_guard<std::mutex> lock(mLock);
+    trimLocked(0);
+}
+
+size_t AnimatedImageFramePool::pooledBytes() {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mPooledBytes;
+}
+
+void AnimatedImageFramePool::trimLocked(size_t targetBytes) {
+    for (auto it = mBuffers.begin(); it != mBuffers.end() && mPooledBytes > targetBytes;) {
+        if (isInUse(*it)) {
+            it++;
+        } else {
+            mPooledBytes -= it->info().computeMinByteSize();
+            it = mBuffers.erase(it);
+        }
+    }
+}
+
+};  // namespace uirenderer
+};  // namespace android
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "utils/Macros.h"
+
+#include <SkBitmap.h>
+#include <SkImageInfo.h>
+
+#include <mutex>
+#include <vector>
+
+namespace android {
+namespace uirenderer {
+
+/**
+ * Pool of the raster buffers the AnimatedImageThread workers decode animated image frames into.
+ * Buffers are shared by all of the drawables in the process, so stickers of the same size reuse
+ * each other's buffers instead of allocating one per decoded frame.
+ *
+ * A buffer is in use for as long as something other than the pool refers to its pixels, which
+ * includes the SkImages of the snapshots made from it.
+ */
+class AnimatedImageFramePool {
+    PREVENT_COPY_AND_ASSIGN(AnimatedImageFramePool);
+
+public:
+    static AnimatedImageFramePool& get();
+
+    /**
+     * Sets outBitmap to a buffer of the given info that isn't in use, allocating a new one if none
+     * of the pooled buffers is free. The content of the buffer is undefined. Returns false if the
+     * allocation failed.
+     */
+    bool acquire(const SkImageInfo& info, SkBitmap* outBitmap);
+
+    // Drops the buffers that aren't in use
+    void trim();
+
+    size_t pooledBytes();
+
+private:
+    AnimatedImageFramePool() {}
+
+    void trimLocked(size_t targetBytes);
+
+    std::mutex mLock;
+    std::vector<SkBitmap> mBuffers;
+    size_t mPooledBytes = 0;
+};
+
+};  // namespace uirenderer
+};  // namespace android
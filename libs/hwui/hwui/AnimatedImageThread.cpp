@@ -16,7 +16,12 @@
 
 #include "AnimatedImageThread.h"
 
+#include "utils/MathUtils.h"
+
+#include <utils/String8.h>
+
 #include <sys/resource.h>
+#include <unistd.h>
 
 namespace android {
 namespace uirenderer {
@@ -28,17 +33,38 @@ AnimatedImageThread& AnimatedImageThread::getInstance() {
 
 AnimatedImageThread::AnimatedImageThread() {
     setpriority(PRIO_PROCESS, 0, PRIORITY_NORMAL + PRIORITY_MORE_FAVORABLE);
-    start("AnimatedImageThread");
+
+    // A screen full of animated stickers keeps a single thread busy, but the decoders shouldn't
+    // compete with the RenderThread and the hwuiTask workers for all of the cores either.
+    int cpuCount = sysconf(_SC_NPROCESSORS_CONF);
+    int workerCount = cpuCount > 2 ? MathUtils::clamp(cpuCount / 4, 1, 3) : 1;
+    for (int i = 0; i < workerCount; i++) {
+        ThreadBase* worker = new ThreadBase();
+        if (i == 0) {
+            worker->start("AnimatedImageThread");
+        } else {
+            String8 name;
+            name.appendFormat("AnimatedImageThread%d", i + 1);
+            worker->start(name.string());
+        }
+        mWorkers.push_back(worker);
+    }
+}
+
+ThreadBase& AnimatedImageThread::workerFor(const AnimatedImageDrawable* drawable) {
+    // The low bits of the address are the same for every allocation
+    return *mWorkers[(reinterpret_cast<uintptr_t>(drawable) >> 4) % mWorkers.size()];
 }
 
 std::future<AnimatedImageDrawable::Snapshot> AnimatedImageThread::decodeNextFrame(
         const sk_sp<AnimatedImageDrawable>& drawable) {
-    return queue().async([drawable]() { return drawable->decodeNextFrame(); });
+    return workerFor(drawable.get()).queue().async(
+            [drawable]() { return drawable->decodeNextFrame(); });
 }
 
 std::future<AnimatedImageDrawable::Snapshot> AnimatedImageThread::reset(
         const sk_sp<AnimatedImageDrawable>& drawable) {
-    return queue().async([drawable]() { return drawable->reset(); });
+    return workerFor(drawable.get()).queue().async([drawable]() { return drawable->reset(); });
 }
 
 }  // namespace uirenderer
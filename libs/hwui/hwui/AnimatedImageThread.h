@@ -22,11 +22,18 @@
 
 #include <SkRefCnt.h>
 
+#include <vector>
+
 namespace android {
 
 namespace uirenderer {
 
-class AnimatedImageThread : private ThreadBase {
+/**
+ * Decodes the frames of AnimatedImageDrawables off of the RenderThread. Frames are decoded by a
+ * few worker threads, each drawable always uses the same one, so that its frames are decoded in
+ * the order they're requested while different drawables are decoded in parallel.
+ */
+class AnimatedImageThread {
     PREVENT_COPY_AND_ASSIGN(AnimatedImageThread);
 
 public:
@@ -38,6 +45,11 @@ public:
 
 private:
     AnimatedImageThread();
+
+    ThreadBase& workerFor(const AnimatedImageDrawable* drawable);
+
+    // Never destroyed, like the AnimatedImageThread itself
+    std::vector<ThreadBase*> mWorkers;
 };
 
 }  // namespace uirenderer
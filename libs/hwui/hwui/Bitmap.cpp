@@ -23,6 +23,11 @@
 
 #include <sys/mman.h>
 
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <androidfw/NativeMemoryStats.h>
 #include <cutils/ashmem.h>
 #include <log/log.h>
 
@@ -76,18 +81,152 @@ sk_sp<Bitmap> Bitmap::allocateAshmemBitmap(SkBitmap* bitmap) {
     return allocateBitmap(bitmap, &Bitmap::allocateAshmemBitmap);
 }
 
+/**
+ * Keeps the freed pixel buffers of large heap bitmaps to reuse them for the next allocations,
+ * so decoding many images doesn't keep mapping and unmapping large blocks. The buffers are
+ * binned by size class, four per power of two, and the pool holds kMaxBytes at most.
+ */
+class PixelBufferPool {
+public:
+    // Smaller buffers come from malloc's own bins.
+    static constexpr size_t kMinSize = 64 * 1024;
+    static constexpr size_t kMaxBytes = 16 * 1024 * 1024;
+
+    // Returns a zeroed buffer of at least size bytes, sets outSize to its usable size.
+    void* allocate(size_t size, size_t* outSize) {
+        if (size >= kMinSize && size <= kMaxBytes) {
+            const size_t classSize = sizeClassAbove(size);
+            void* buffer = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mLock);
+                auto it = mFree.find(classSize);
+                if (it != mFree.end()) {
+                    buffer = it->second.back();
+                    it->second.pop_back();
+                    if (it->second.empty()) {
+                        mFree.erase(it);
+                    }
+                    mBytes -= classSize;
+                }
+            }
+            if (buffer) {
+                memset(buffer, 0, classSize);
+            } else {
+                buffer = calloc(classSize, 1);
+            }
+            *outSize = classSize;
+            return buffer;
+        }
+        *outSize = size;
+        return calloc(size, 1);
+    }
+
+    // Takes a malloc()'d buffer of size bytes, keeps it or frees it.
+    void release(void* buffer, size_t size) {
+        if (size >= kMinSize) {
+            const size_t classSize = sizeClassBelow(size);
+            std::lock_guard<std::mutex> lock(mLock);
+            if (mBytes + classSize <= kMaxBytes) {
+                mFree[classSize].push_back(buffer);
+                mBytes += classSize;
+                return;
+            }
+        }
+        free(buffer);
+        mallopt(M_PURGE, 0);
+    }
+
+    void trim() {
+        std::map<size_t, std::vector<void*>> buffers;
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            buffers.swap(mFree);
+            mBytes = 0;
+        }
+        for (auto& sizeClass : buffers) {
+            for (void* buffer : sizeClass.second) {
+                free(buffer);
+            }
+        }
+        mallopt(M_PURGE, 0);
+    }
+
+private:
+    // The size classes are 4, 5, 6 and 7 times a power of two.
+    static size_t sizeClassAbove(size_t size) {
+        size_t step = size_t(1) << (31 - __builtin_clz(uint32_t(size)) - 2);
+        return (size + step - 1) / step * step;
+    }
+
+    static size_t sizeClassBelow(size_t size) {
+        size_t step = size_t(1) << (31 - __builtin_clz(uint32_t(size)) - 2);
+        return size / step * step;
+    }
+
+    std::mutex mLock;
+    std::map<size_t, std::vector<void*>> mFree;
+    size_t mBytes = 0;
+};
+
+static PixelBufferPool gPixelBufferPool;
+
 static sk_sp<Bitmap> allocateHeapBitmap(size_t size, const SkImageInfo& info, size_t rowBytes) {
-    void* addr = calloc(size, 1);
+    size_t allocSize;
+    void* addr = gPixelBufferPool.allocate(size, &allocSize);
     if (!addr) {
         return nullptr;
     }
-    return sk_sp<Bitmap>(new Bitmap(addr, size, info, rowBytes));
+    return sk_sp<Bitmap>(new Bitmap(addr, allocSize, info, rowBytes));
+}
+
+void Bitmap::trimPixelBufferPool() {
+    gPixelBufferPool.trim();
 }
 
 sk_sp<Bitmap> Bitmap::allocateHardwareBitmap(SkBitmap& bitmap) {
     return uirenderer::renderthread::RenderProxy::allocateHardwareBitmap(bitmap);
 }
 
+sk_sp<Bitmap> Bitmap::allocateWritableHardwareBitmap(SkBitmap* bitmap) {
+    const SkImageInfo& info = bitmap->info();
+    PixelFormat pixelFormat;
+    switch (info.colorType()) {
+        case kRGBA_8888_SkColorType:
+            pixelFormat = PIXEL_FORMAT_RGBA_8888;
+            break;
+        case kRGBA_F16_SkColorType:
+            pixelFormat = PIXEL_FORMAT_RGBA_FP16;
+            break;
+        default:
+            return nullptr;
+    }
+
+    sp<GraphicBuffer> buffer = new GraphicBuffer(
+            info.width(), info.height(), pixelFormat,
+            GraphicBuffer::USAGE_HW_TEXTURE | GraphicBuffer::USAGE_SW_WRITE_OFTEN |
+                    GraphicBuffer::USAGE_SW_READ_NEVER,
+            std::string("Bitmap::allocateWritableHardwareBitmap pid [") +
+                    std::to_string(getpid()) + "]");
+    if (buffer->initCheck() != OK) {
+        ALOGW("Bitmap::allocateWritableHardwareBitmap() failed in GraphicBuffer.create()");
+        return nullptr;
+    }
+
+    void* pixels = nullptr;
+    status_t error = buffer->lock(GraphicBuffer::USAGE_SW_WRITE_OFTEN, &pixels);
+    if (error != OK || !pixels) {
+        ALOGW("Bitmap::allocateWritableHardwareBitmap() failed to lock buffer, error %d", error);
+        return nullptr;
+    }
+    if (!bitmap->installPixels(info, pixels, bytesPerPixel(pixelFormat) * buffer->getStride())) {
+        buffer->unlock();
+        return nullptr;
+    }
+    sk_sp<Bitmap> hardwareBitmap(new Bitmap(buffer.get(), info));
+    hardwareBitmap->mPixelStorage.hardware.locked = true;
+    return hardwareBitmap;
+}
+
 sk_sp<Bitmap> Bitmap::allocateHeapBitmap(SkBitmap* bitmap) {
     return allocateBitmap(bitmap, &android::allocateHeapBitmap);
 }
@@ -176,6 +315,7 @@ Bitmap::Bitmap(void* address, size_t size, const SkImageInfo& info, size_t rowBy
         , mPixelStorageType(PixelStorageType::Heap) {
     mPixelStorage.heap.address = address;
     mPixelStorage.heap.size = size;
+    accountAllocation();
 }
 
 Bitmap::Bitmap(void* address, void* context, FreeFunc freeFunc, const SkImageInfo& info,
@@ -186,6 +326,7 @@ Bitmap::Bitmap(void* address, void* context, FreeFunc freeFunc, const SkImageInf
     mPixelStorage.external.address = address;
     mPixelStorage.external.context = context;
     mPixelStorage.external.freeFunc = freeFunc;
+    accountAllocation();
 }
 
 Bitmap::Bitmap(void* address, int fd, size_t mappedSize, const SkImageInfo& info, size_t rowBytes)
@@ -195,6 +336,7 @@ Bitmap::Bitmap(void* address, int fd, size_t mappedSize, const SkImageInfo& info
     mPixelStorage.ashmem.address = address;
     mPixelStorage.ashmem.fd = fd;
     mPixelStorage.ashmem.size = mappedSize;
+    accountAllocation();
 }
 
 Bitmap::Bitmap(GraphicBuffer* buffer, const SkImageInfo& info)
@@ -203,15 +345,23 @@ Bitmap::Bitmap(GraphicBuffer* buffer, const SkImageInfo& info)
         , mInfo(validateAlpha(info))
         , mPixelStorageType(PixelStorageType::Hardware) {
     mPixelStorage.hardware.buffer = buffer;
+    mPixelStorage.hardware.locked = false;
     buffer->incStrong(buffer);
     setImmutable();  // HW bitmaps are always immutable
     if (uirenderer::Properties::isSkiaEnabled()) {
         mImage = SkImage::MakeFromAHardwareBuffer(reinterpret_cast<AHardwareBuffer*>(buffer),
                                                   mInfo.alphaType(), mInfo.refColorSpace());
     }
+    accountAllocation();
+}
+
+void Bitmap::accountAllocation() {
+    mAccountedSize = getAllocationByteCount();
+    NativeMemoryStats::Add(NativeMemoryCategory::kBitmaps, mAccountedSize);
 }
 
 Bitmap::~Bitmap() {
+    NativeMemoryStats::Remove(NativeMemoryCategory::kBitmaps, mAccountedSize);
     switch (mPixelStorageType) {
         case PixelStorageType::External:
             mPixelStorage.external.freeFunc(mPixelStorage.external.address,
@@ -222,11 +372,13 @@ Bitmap::~Bitmap() {
             close(mPixelStorage.ashmem.fd);
             break;
         case PixelStorageType::Heap:
-            free(mPixelStorage.heap.address);
-            mallopt(M_PURGE, 0);
+            gPixelBufferPool.release(mPixelStorage.heap.address, mPixelStorage.heap.size);
             break;
         case PixelStorageType::Hardware:
             auto buffer = mPixelStorage.hardware.buffer;
+            if (mPixelStorage.hardware.locked) {
+                buffer->unlock();
+            }
             buffer->decStrong(buffer);
             mPixelStorage.hardware.buffer = nullptr;
             break;
@@ -319,6 +471,13 @@ GraphicBuffer* Bitmap::graphicBuffer() {
     return nullptr;
 }
 
+void Bitmap::unlockPixels() {
+    if (isHardware() && mPixelStorage.hardware.locked) {
+        mPixelStorage.hardware.buffer->unlock();
+        mPixelStorage.hardware.locked = false;
+    }
+}
+
 sk_sp<SkImage> Bitmap::makeImage(sk_sp<SkColorFilter>* outputColorFilter) {
     sk_sp<SkImage> image = mImage;
     if (!image) {
@@ -51,6 +51,23 @@ public:
 
     static sk_sp<Bitmap> allocateHardwareBitmap(SkBitmap& bitmap);
 
+    /**
+     * Frees the pixel buffers kept to be reused by the next heap bitmaps, for onTrimMemory().
+     */
+    static void trimPixelBufferPool();
+
+    /**
+     * Allocates a hardware bitmap for the info of bitmap whose GraphicBuffer is locked for CPU
+     * writes, and installs the locked pixels in bitmap. This lets decoders write straight into
+     * the buffer instead of into a heap bitmap that is uploaded afterwards. unlockPixels() must
+     * be called once the pixels are written, before the bitmap is drawn or shared.
+     *
+     * Only RGBA_8888 and RGBA_F16 are supported. Returns nullptr for other color types or if
+     * gralloc can't allocate a CPU writable buffer, callers should then decode into the heap
+     * and use allocateHardwareBitmap(SkBitmap&).
+     */
+    static sk_sp<Bitmap> allocateWritableHardwareBitmap(SkBitmap* bitmap);
+
     static sk_sp<Bitmap> allocateAshmemBitmap(SkBitmap* bitmap);
     static sk_sp<Bitmap> allocateAshmemBitmap(size_t allocSize, const SkImageInfo& info,
                                               size_t rowBytes);
@@ -92,6 +109,12 @@ public:
 
     GraphicBuffer* graphicBuffer();
 
+    /**
+     * Unlocks the buffer of a bitmap created by allocateWritableHardwareBitmap, the pixels
+     * installed in the SkBitmap passed to it are no longer valid afterwards.
+     */
+    void unlockPixels();
+
     /**
      * Creates or returns a cached SkImage and is safe to be invoked from either
      * the UI or RenderThread.
@@ -108,6 +131,7 @@ public:
 private:
     virtual ~Bitmap();
     void* getStorage() const;
+    void accountAllocation();
 
     SkImageInfo mInfo;
 
@@ -115,6 +139,9 @@ private:
 
     bool mHasHardwareMipMap = false;
 
+    // The size reported to NativeMemoryStats, reconfigure() doesn't change the allocation
+    size_t mAccountedSize = 0;
+
     union {
         struct {
             void* address;
@@ -132,6 +159,8 @@ private:
         } heap;
         struct {
             GraphicBuffer* buffer;
+            // true while the buffer is locked for CPU writes
+            bool locked;
         } hardware;
     } mPixelStorage;
 
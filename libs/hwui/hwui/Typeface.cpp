@@ -32,6 +32,9 @@
 #include <utils/Log.h>
 #include <utils/MathUtils.h>
 
+#include <map>
+#include <mutex>
+
 namespace android {
 
 static Typeface::Style computeAPIStyle(int weight, bool italic) {
@@ -122,10 +125,44 @@ Typeface* Typeface::createWithDifferentBaseWeight(Typeface* src, int weight) {
     return result;
 }
 
+// Returns the collection of the families, which is shared by all the typefaces created from the
+// same families while any of them is alive. The families are keyed by address: a collection
+// holds its families, so an address can't be reused while its entry is alive.
+static std::shared_ptr<minikin::FontCollection> getFontCollection(
+        const std::vector<std::shared_ptr<minikin::FontFamily>>& families) {
+    static std::mutex gLock;
+    static std::map<std::vector<const minikin::FontFamily*>,
+                    std::weak_ptr<minikin::FontCollection>> gCollections;
+
+    std::vector<const minikin::FontFamily*> key;
+    key.reserve(families.size());
+    for (const auto& family : families) {
+        key.push_back(family.get());
+    }
+
+    std::lock_guard<std::mutex> lock(gLock);
+    std::weak_ptr<minikin::FontCollection>& entry = gCollections[key];
+    std::shared_ptr<minikin::FontCollection> collection = entry.lock();
+    if (collection == nullptr) {
+        collection = std::make_shared<minikin::FontCollection>(families);
+        entry = collection;
+
+        // Drops the entries of the collections that were released.
+        for (auto it = gCollections.begin(); it != gCollections.end();) {
+            if (it->second.expired()) {
+                it = gCollections.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    return collection;
+}
+
 Typeface* Typeface::createFromFamilies(std::vector<std::shared_ptr<minikin::FontFamily>>&& families,
                                        int weight, int italic) {
     Typeface* result = new Typeface;
-    result->fFontCollection.reset(new minikin::FontCollection(families));
+    result->fFontCollection = getFontCollection(families);
 
     if (weight == RESOLVE_BY_FONT_TABLE || italic == RESOLVE_BY_FONT_TABLE) {
         int weightFromFont;
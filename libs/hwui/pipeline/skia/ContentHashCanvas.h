@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "SkiaDisplayList.h"
+
+#include <SkImage.h>
+#include <SkRRect.h>
+#include <SkRegion.h>
+#include <SkTextBlob.h>
+#include <SkTextBlobRunIterator.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace android {
+namespace uirenderer {
+namespace skiapipeline {
+
+/**
+ * ContentHashCanvas computes a 64 bit hash of the drawing ops of a SkiaDisplayList, including
+ * the matrix and clip state they are drawn with. Child render nodes are hashed by identity and
+ * not walked, since they are compared separately.
+ *
+ * Ops whose content can't be hashed cheaply (pictures, unknown drawables) mark the whole list
+ * as unhashable, in which case the hash must not be used.
+ */
+class ContentHashCanvas : public SkCanvas {
+public:
+    explicit ContentHashCanvas(const SkiaDisplayList& displayList) : mDisplayList(displayList) {}
+
+    uint64_t hash() const { return mHash; }
+    bool isHashable() const { return mHashable; }
+
+protected:
+    // matrices are captured with each op, but nesting also scopes clips
+    void willSave() override { mixOp(26); }
+
+    void willRestore() override { mixOp(27); }
+
+    void onClipRect(const SkRect& rect, SkClipOp op, ClipEdgeStyle style) override {
+        mixOp(1);
+        mix(rect);
+        mix(op);
+        mix(style);
+    }
+
+    void onClipRRect(const SkRRect& rrect, SkClipOp op, ClipEdgeStyle style) override {
+        mixOp(2);
+        mix(rrect);
+        mix(op);
+        mix(style);
+    }
+
+    void onClipPath(const SkPath& path, SkClipOp op, ClipEdgeStyle style) override {
+        mixOp(3);
+        mixPath(path);
+        mix(op);
+        mix(style);
+    }
+
+    void onClipRegion(const SkRegion& deviceRgn, SkClipOp op) override {
+        mixOp(4);
+        mixRegion(deviceRgn);
+        mix(op);
+    }
+
+    SaveLayerStrategy getSaveLayerStrategy(const SaveLayerRec& rec) override {
+        mixOp(5);
+        if (rec.fBounds) mix(*rec.fBounds);
+        mixPaint(rec.fPaint);
+        mix(rec.fSaveLayerFlags);
+        if (rec.fBackdrop) mHashable = false;
+        return kNoLayer_SaveLayerStrategy;
+    }
+
+    void onDrawPaint(const SkPaint& paint) override {
+        mixOp(6);
+        mixPaint(&paint);
+    }
+
+    void onDrawPath(const SkPath& path, const SkPaint& paint) override {
+        mixOp(7);
+        mixPath(path);
+        mixPaint(&paint);
+    }
+
+    void onDrawRect(const SkRect& rect, const SkPaint& paint) override {
+        mixOp(8);
+        mix(rect);
+        mixPaint(&paint);
+    }
+
+    void onDrawRegion(const SkRegion& region, const SkPaint& paint) override {
+        mixOp(9);
+        mixRegion(region);
+        mixPaint(&paint);
+    }
+
+    void onDrawOval(const SkRect& rect, const SkPaint& paint) override {
+        mixOp(10);
+        mix(rect);
+        mixPaint(&paint);
+    }
+
+    void onDrawArc(const SkRect& rect, SkScalar startAngle, SkScalar sweepAngle, bool useCenter,
+                   const SkPaint& paint) override {
+        mixOp(11);
+        mix(rect);
+        mix(startAngle);
+        mix(sweepAngle);
+        mix(useCenter);
+        mixPaint(&paint);
+    }
+
+    void onDrawRRect(const SkRRect& rrect, const SkPaint& paint) override {
+        mixOp(12);
+        mix(rrect);
+        mixPaint(&paint);
+    }
+
+    void onDrawDRRect(const SkRRect& outer, const SkRRect& inner, const SkPaint& paint) override {
+        mixOp(13);
+        mix(outer);
+        mix(inner);
+        mixPaint(&paint);
+    }
+
+    void onDrawText(const void* text, size_t byteLength, SkScalar x, SkScalar y,
+                    const SkPaint& paint) override {
+        mixOp(14);
+        mixBytes(text, byteLength);
+        mix(x);
+        mix(y);
+        mixPaint(&paint);
+    }
+
+    void onDrawPosText(const void* text, size_t byteLength, const SkPoint pos[],
+                       const SkPaint& paint) override {
+        mixOp(15);
+        mixBytes(text, byteLength);
+        mixBytes(pos, paint.countText(text, byteLength) * sizeof(SkPoint));
+        mixPaint(&paint);
+    }
+
+    void onDrawPosTextH(const void* text, size_t byteLength, const SkScalar xpos[],
+                        SkScalar constY, const SkPaint& paint) override {
+        mixOp(16);
+        mixBytes(text, byteLength);
+        mixBytes(xpos, paint.countText(text, byteLength) * sizeof(SkScalar));
+        mix(constY);
+        mixPaint(&paint);
+    }
+
+    void onDrawTextOnPath(const void* text, size_t byteLength, const SkPath& path,
+                          const SkMatrix* matrix, const SkPaint& paint) override {
+        mixOp(17);
+        mixBytes(text, byteLength);
+        mixPath(path);
+        if (matrix) mix(*matrix);
+        mixPaint(&paint);
+    }
+
+    void onDrawTextRSXform(const void* text, size_t byteLength, const SkRSXform xform[],
+                           const SkRect* cullRect, const SkPaint& paint) override {
+        mixOp(18);
+        mixBytes(text, byteLength);
+        mixBytes(xform, paint.countText(text, byteLength) * sizeof(SkRSXform));
+        mixPaint(&paint);
+    }
+
+    void onDrawTextBlob(const SkTextBlob* blob, SkScalar x, SkScalar y,
+                        const SkPaint& paint) override {
+        mixOp(19);
+        mix(blob->bounds());
+        for (SkTextBlobRunIterator it(blob); !it.done(); it.next()) {
+            SkPaint runPaint(paint);
+            it.applyFontToPaint(&runPaint);
+            mixPaint(&runPaint);
+            mix(it.offset());
+            mix(it.positioning());
+            mixBytes(it.glyphs(), it.glyphCount() * sizeof(uint16_t));
+            mixBytes(it.pos(), it.glyphCount() * it.positioning() * sizeof(SkScalar));
+        }
+        mix(x);
+        mix(y);
+    }
+
+    void onDrawImage(const SkImage* image, SkScalar dx, SkScalar dy,
+                     const SkPaint* paint) override {
+        mixOp(20);
+        mix(image->uniqueID());
+        mix(dx);
+        mix(dy);
+        mixPaint(paint);
+    }
+
+    void onDrawImageNine(const SkImage* image, const SkIRect& center, const SkRect& dst,
+                         const SkPaint* paint) override {
+        mixOp(21);
+        mix(image->uniqueID());
+        mix(center);
+        mix(dst);
+        mixPaint(paint);
+    }
+
+    void onDrawImageRect(const SkImage* image, const SkRect* src, const SkRect& dst,
+                         const SkPaint* paint, SrcRectConstraint constraint) override {
+        mixOp(22);
+        mix(image->uniqueID());
+        if (src) mix(*src);
+        mix(dst);
+        mixPaint(paint);
+        mix(constraint);
+    }
+
+    void onDrawImageLattice(const SkImage* image, const Lattice& lattice, const SkRect& dst,
+                            const SkPaint* paint) override {
+        mixOp(23);
+        mix(image->uniqueID());
+        mixBytes(lattice.fXDivs, lattice.fXCount * sizeof(int));
+        mixBytes(lattice.fYDivs, lattice.fYCount * sizeof(int));
+        if (lattice.fBounds) mix(*lattice.fBounds);
+        if (lattice.fRectTypes) {
+            const int rectCount = (lattice.fXCount + 1) * (lattice.fYCount + 1);
+            mixBytes(lattice.fRectTypes, rectCount * sizeof(lattice.fRectTypes[0]));
+            if (lattice.fColors) mixBytes(lattice.fColors, rectCount * sizeof(SkColor));
+        }
+        mix(dst);
+        mixPaint(paint);
+    }
+
+    void onDrawPoints(SkCanvas::PointMode mode, size_t count, const SkPoint pts[],
+                      const SkPaint& paint) override {
+        mixOp(24);
+        mix(mode);
+        mixBytes(pts, count * sizeof(SkPoint));
+        mixPaint(&paint);
+    }
+
+    void onDrawPicture(const SkPicture*, const SkMatrix*, const SkPaint*) override {
+        mHashable = false;
+    }
+
+    void onDrawDrawable(SkDrawable* drawable, const SkMatrix* matrix) override {
+        mixOp(25);
+        if (matrix) mix(*matrix);
+
+        size_t index = 0;
+        for (auto& child : mDisplayList.mChildNodes) {
+            if (drawable == &child) {
+                mix(index);
+                mix(child.getRenderNode());
+                return;
+            }
+            index++;
+        }
+        auto barrier = std::find(mDisplayList.mReorderBarriers.begin(),
+                                 mDisplayList.mReorderBarriers.end(), drawable);
+        if (barrier != mDisplayList.mReorderBarriers.end()) {
+            mix(barrier - mDisplayList.mReorderBarriers.begin());
+            return;
+        }
+        // functors, layers and animated shapes keep their own state
+        mHashable = false;
+    }
+
+private:
+    // FNV-1a
+    void mixBytes(const void* data, size_t size) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            mHash = (mHash ^ bytes[i]) * 1099511628211ULL;
+        }
+    }
+
+    template <typename T>
+    void mix(const T& value) {
+        mixBytes(&value, sizeof(T));
+    }
+
+    // Separates ops, and captures the matrix they are drawn with
+    void mixOp(int opType) {
+        mix(opType);
+        mix(getTotalMatrix());
+    }
+
+    void mixPath(const SkPath& path) {
+        mix(path.getFillType());
+        int pointCount = path.countPoints();
+        for (int i = 0; i < pointCount; i++) {
+            mix(path.getPoint(i));
+        }
+        std::vector<uint8_t> verbs(path.countVerbs());
+        path.getVerbs(verbs.data(), verbs.size());
+        mixBytes(verbs.data(), verbs.size());
+        // conic weights are not exposed, don't trust paths using them
+        if (path.getSegmentMasks() & SkPath::kConic_SegmentMask) mHashable = false;
+    }
+
+    void mixRegion(const SkRegion& region) {
+        for (SkRegion::Iterator it(region); !it.done(); it.next()) {
+            mix(it.rect());
+        }
+    }
+
+    void mixPaint(const SkPaint* paint) {
+        if (!paint) {
+            mix(0);
+            return;
+        }
+        mix(paint->getColor());
+        mix(paint->getFlags());
+        mix(paint->getStyle());
+        mix(paint->getStrokeWidth());
+        mix(paint->getStrokeMiter());
+        mix(paint->getStrokeCap());
+        mix(paint->getStrokeJoin());
+        mix(paint->getBlendMode());
+        mix(paint->getFilterQuality());
+        mix(paint->getTextSize());
+        mix(paint->getTextScaleX());
+        mix(paint->getTextSkewX());
+        mix(paint->getTextEncoding());
+        mix(paint->getHinting());
+        // effects are compared by identity, recording new ones counts as a change
+        mix(paint->getTypeface());
+        mix(paint->getShader());
+        mix(paint->getColorFilter());
+        mix(paint->getPathEffect());
+        mix(paint->getMaskFilter());
+        mix(paint->getImageFilter());
+        mix(paint->getLooper());
+    }
+
+    const SkiaDisplayList& mDisplayList;
+    uint64_t mHash = 14695981039346656037ULL;
+    bool mHashable = true;
+};
+
+};  // namespace skiapipeline
+};  // namespace uirenderer
+};  // namespace android
@@ -17,6 +17,7 @@
 #include "RenderNodeDrawable.h"
 #include <SkPaintFilterCanvas.h>
 #include "RenderNode.h"
+#include "RenderNodeGpuProfiler.h"
 #include "SkiaDisplayList.h"
 #include "SkiaPipeline.h"
 #include "utils/TraceUtils.h"
@@ -118,6 +119,14 @@ void RenderNodeDrawable::forceDraw(SkCanvas* canvas) {
     SkASSERT(renderNode->getDisplayList()->isSkiaDL());
     SkiaDisplayList* displayList = (SkiaDisplayList*)renderNode->getDisplayList();
 
+    // The GPU work of the node is bracketed by flushes, timestamps only see submitted work
+    RenderNodeGpuProfiler* gpuProfiler = RenderNodeGpuProfiler::active();
+    bool gpuTimed = false;
+    if (CC_UNLIKELY(gpuProfiler)) {
+        canvas->flush();
+        gpuTimed = gpuProfiler->beginNode(*renderNode);
+    }
+
     SkAutoCanvasRestore acr(canvas, true);
     const RenderProperties& properties = this->getNodeProperties();
     // pass this outline to the children that may clip backward projected nodes
@@ -138,6 +147,11 @@ void RenderNodeDrawable::forceDraw(SkCanvas* canvas) {
         }
     }
     displayList->mProjectedOutline = nullptr;
+
+    if (CC_UNLIKELY(gpuTimed)) {
+        canvas->flush();
+        gpuProfiler->endNode();
+    }
 }
 
 static bool layerNeedsPaint(const LayerProperties& properties, float alphaMultiplier,
@@ -0,0 +1,371 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ShaderBlobStore.h"
+
+#include <cutils/properties.h>
+#include <log/log.h>
+#include <utils/JenkinsHash.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace android {
+namespace uirenderer {
+namespace skiapipeline {
+
+// File layout, version 1: a FileHeader, followed by indexSize bytes of index and then the
+// values. The index holds one IndexRecord per entry, each followed by the key bytes padded to
+// 8 bytes. Values are stored at valueOffset, also 8 byte aligned.
+static const uint32_t kFileMagic = 0x42535748;  // "HWSB"
+static const uint32_t kFileVersion = 1;
+
+struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t indexChecksum;
+    uint64_t indexSize;
+    uint64_t useClock;
+    // Program binaries are only valid for the driver they were built with
+    char buildId[PROPERTY_VALUE_MAX];
+};
+
+struct IndexRecord {
+    uint32_t keySize;
+    uint32_t valueSize;
+    uint32_t hits;
+    uint32_t valueChecksum;
+    uint64_t lastUse;
+    uint64_t valueOffset;
+};
+
+static size_t align8(size_t size) {
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+static uint32_t checksum(const void* data, size_t size) {
+    return JenkinsHashWhiten(
+            JenkinsHashMixBytes(0, reinterpret_cast<const uint8_t*>(data), size));
+}
+
+static void getBuildId(char* buildId) {
+    memset(buildId, 0, PROPERTY_VALUE_MAX);
+    property_get("ro.build.fingerprint", buildId, "");
+}
+
+static void unmapFile(const void* ptr, void* context) {
+    munmap(const_cast<void*>(ptr), reinterpret_cast<size_t>(context));
+}
+
+ShaderBlobStore::ShaderBlobStore(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize,
+                                 const std::string& filename)
+        : mMaxKeySize(maxKeySize)
+        , mMaxValueSize(maxValueSize)
+        , mMaxTotalSize(maxTotalSize)
+        , mFilename(filename) {
+    loadFromFile();
+}
+
+void ShaderBlobStore::loadFromFile() {
+    int fd = open(mFilename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            ALOGW("ShaderBlobStore: could not open %s: %s", mFilename.c_str(), strerror(errno));
+        }
+        return;
+    }
+    struct stat st = {};
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+        close(fd);
+        return;
+    }
+    const size_t fileSize = st.st_size;
+    void* addr = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        ALOGW("ShaderBlobStore: could not map %s: %s", mFilename.c_str(), strerror(errno));
+        return;
+    }
+    sk_sp<SkData> file =
+            SkData::MakeWithProc(addr, fileSize, unmapFile, reinterpret_cast<void*>(fileSize));
+    const uint8_t* bytes = file->bytes();
+
+    FileHeader header;
+    memcpy(&header, bytes, sizeof(header));
+    char buildId[PROPERTY_VALUE_MAX];
+    getBuildId(buildId);
+    if (header.magic != kFileMagic || header.version != kFileVersion ||
+        memcmp(header.buildId, buildId, PROPERTY_VALUE_MAX) != 0) {
+        // written by another build, treat as empty
+        return;
+    }
+    if (header.indexSize > fileSize - sizeof(header) ||
+        checksum(bytes + sizeof(header), header.indexSize) != header.indexChecksum) {
+        ALOGW("ShaderBlobStore: %s is corrupt, ignoring it", mFilename.c_str());
+        return;
+    }
+
+    const uint8_t* index = bytes + sizeof(header);
+    size_t offset = 0;
+    for (uint32_t i = 0; i < header.entryCount; i++) {
+        IndexRecord record;
+        if (offset + sizeof(record) > header.indexSize) break;
+        memcpy(&record, index + offset, sizeof(record));
+        offset += sizeof(record);
+        if (!record.keySize || record.keySize > mMaxKeySize ||
+            record.valueSize > mMaxValueSize || offset + record.keySize > header.indexSize ||
+            record.valueOffset > fileSize || fileSize - record.valueOffset < record.valueSize) {
+            ALOGW("ShaderBlobStore: bad index entry in %s, ignoring the rest", mFilename.c_str());
+            break;
+        }
+        std::string key(reinterpret_cast<const char*>(index + offset), record.keySize);
+        offset += align8(record.keySize);
+
+        Entry& entry = mEntries[key];
+        entry.value = SkData::MakeSubset(file.get(), record.valueOffset, record.valueSize);
+        // age the counts, so entries that are no longer used make room eventually
+        entry.hits = (record.hits + 1) / 2;
+        entry.lastUse = record.lastUse;
+        entry.checksum = record.valueChecksum;
+        mTotalSize += key.size() + record.valueSize;
+    }
+    mUseClock = header.useClock;
+
+    if (mTotalSize > mMaxTotalSize) {
+        evict(mMaxTotalSize, std::string());
+    }
+}
+
+bool ShaderBlobStore::verify(Entry& entry) {
+    if (!entry.verified) {
+        if (checksum(entry.value->data(), entry.value->size()) != entry.checksum) {
+            return false;
+        }
+        entry.verified = true;
+    }
+    return true;
+}
+
+sk_sp<SkData> ShaderBlobStore::get(const void* key, size_t keySize) {
+    auto it = mEntries.find(std::string(reinterpret_cast<const char*>(key), keySize));
+    if (it == mEntries.end()) {
+        mStats.misses++;
+        return nullptr;
+    }
+    Entry& entry = it->second;
+    if (!verify(entry)) {
+        ALOGW("ShaderBlobStore: dropping corrupt entry from %s", mFilename.c_str());
+        mTotalSize -= it->first.size() + entry.value->size();
+        mEntries.erase(it);
+        mStats.misses++;
+        return nullptr;
+    }
+    entry.hits++;
+    entry.lastUse = ++mUseClock;
+    mStats.hits++;
+    return entry.value;
+}
+
+void ShaderBlobStore::set(const void* key, size_t keySize, const void* value, size_t valueSize) {
+    if (!keySize || keySize > mMaxKeySize || valueSize > mMaxValueSize ||
+        keySize + valueSize > mMaxTotalSize / 2) {
+        ALOGV("ShaderBlobStore: entry of %zu/%zu bytes doesn't fit", keySize, valueSize);
+        return;
+    }
+    std::string keyString(reinterpret_cast<const char*>(key), keySize);
+    auto it = mEntries.find(keyString);
+    if (it != mEntries.end()) {
+        mTotalSize -= keySize + it->second.value->size();
+    } else {
+        // storing means the program was just built, so it counts as used once
+        it = mEntries.emplace(keyString, Entry()).first;
+        it->second.hits = 1;
+    }
+    Entry& entry = it->second;
+    entry.value = SkData::MakeWithCopy(value, valueSize);
+    entry.lastUse = ++mUseClock;
+    entry.checksum = checksum(value, valueSize);
+    entry.verified = true;
+    entry.resident = true;
+    mTotalSize += keySize + valueSize;
+
+    if (mTotalSize > mMaxTotalSize) {
+        // make some room, so that every new program doesn't cause another eviction pass
+        evict(mMaxTotalSize * 3 / 4, keyString);
+    }
+}
+
+void ShaderBlobStore::evict(size_t targetSize, const std::string& keep) {
+    std::vector<EntryMap::iterator> candidates;
+    candidates.reserve(mEntries.size());
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        if (it->first != keep) candidates.push_back(it);
+    }
+    // fewest hits per byte first, then least recently used
+    auto hitDensity = [](EntryMap::iterator it) {
+        return it->second.hits / static_cast<double>(it->first.size() + it->second.value->size());
+    };
+    std::sort(candidates.begin(), candidates.end(), [&hitDensity](auto lhs, auto rhs) {
+        const double lhsDensity = hitDensity(lhs);
+        const double rhsDensity = hitDensity(rhs);
+        if (lhsDensity != rhsDensity) return lhsDensity < rhsDensity;
+        return lhs->second.lastUse < rhs->second.lastUse;
+    });
+    for (auto& it : candidates) {
+        if (mTotalSize <= targetSize) break;
+        const size_t entrySize = it->first.size() + it->second.value->size();
+        mTotalSize -= entrySize;
+        mStats.evictions++;
+        mStats.evictedBytes += entrySize;
+        mEntries.erase(it);
+    }
+}
+
+std::vector<std::string> ShaderBlobStore::mostUsedKeys(size_t maxCount) const {
+    std::vector<EntryMap::const_iterator> entries;
+    entries.reserve(mEntries.size());
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        entries.push_back(it);
+    }
+    std::sort(entries.begin(), entries.end(), [](const auto& lhs, const auto& rhs) {
+        if (lhs->second.hits != rhs->second.hits) return lhs->second.hits > rhs->second.hits;
+        return lhs->second.lastUse > rhs->second.lastUse;
+    });
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < entries.size() && i < maxCount; i++) {
+        keys.push_back(entries[i]->first);
+    }
+    return keys;
+}
+
+sk_sp<SkData> ShaderBlobStore::mappedValue(const std::string& key) const {
+    auto it = mEntries.find(key);
+    if (it == mEntries.end() || it->second.resident) {
+        return nullptr;
+    }
+    return it->second.value;
+}
+
+size_t ShaderBlobStore::makeResident(const std::string& key, const sk_sp<SkData>& mapped,
+                                     sk_sp<SkData> copy) {
+    auto it = mEntries.find(key);
+    // the entry may have been replaced or evicted while the copy was made
+    if (it == mEntries.end() || it->second.resident || it->second.value != mapped) {
+        return 0;
+    }
+    Entry& entry = it->second;
+    if (!entry.verified && checksum(copy->data(), copy->size()) != entry.checksum) {
+        mTotalSize -= it->first.size() + entry.value->size();
+        mEntries.erase(it);
+        return 0;
+    }
+    entry.value = std::move(copy);
+    entry.verified = true;
+    entry.resident = true;
+    return entry.value->size();
+}
+
+bool ShaderBlobStore::isResident(const std::string& key) const {
+    auto it = mEntries.find(key);
+    return it != mEntries.end() && it->second.resident;
+}
+
+void ShaderBlobStore::writeToFile() {
+    if (mFilename.empty()) {
+        return;
+    }
+
+    size_t indexSize = 0;
+    for (auto& entry : mEntries) {
+        indexSize += sizeof(IndexRecord) + align8(entry.first.size());
+    }
+    size_t valueOffset = align8(sizeof(FileHeader) + indexSize);
+    size_t fileSize = valueOffset;
+    for (auto& entry : mEntries) {
+        fileSize += align8(entry.second.value->size());
+    }
+
+    std::vector<uint8_t> buffer(fileSize, 0);
+    uint8_t* index = buffer.data() + sizeof(FileHeader);
+    size_t offset = 0;
+    for (auto& entry : mEntries) {
+        const SkData* value = entry.second.value.get();
+        IndexRecord record;
+        record.keySize = entry.first.size();
+        record.valueSize = value->size();
+        record.hits = entry.second.hits;
+        record.valueChecksum = entry.second.checksum;
+        record.lastUse = entry.second.lastUse;
+        record.valueOffset = valueOffset;
+        memcpy(index + offset, &record, sizeof(record));
+        offset += sizeof(record);
+        memcpy(index + offset, entry.first.data(), entry.first.size());
+        offset += align8(entry.first.size());
+
+        memcpy(buffer.data() + valueOffset, value->data(), value->size());
+        valueOffset += align8(value->size());
+    }
+
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = kFileMagic;
+    header.version = kFileVersion;
+    header.entryCount = mEntries.size();
+    header.indexSize = indexSize;
+    header.indexChecksum = checksum(index, indexSize);
+    header.useClock = mUseClock;
+    getBuildId(header.buildId);
+    memcpy(buffer.data(), &header, sizeof(header));
+
+    // Write next to the file and rename, so that a crash can't leave a truncated cache behind
+    // and live mappings of the old file stay valid.
+    std::string tmpFilename = mFilename + ".tmp";
+    int fd = open(tmpFilename.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        ALOGE("ShaderBlobStore: could not open %s: %s", tmpFilename.c_str(), strerror(errno));
+        return;
+    }
+    const uint8_t* data = buffer.data();
+    size_t remaining = buffer.size();
+    while (remaining > 0) {
+        ssize_t written = TEMP_FAILURE_RETRY(write(fd, data, remaining));
+        if (written <= 0) {
+            ALOGE("ShaderBlobStore: could not write %s: %s", tmpFilename.c_str(),
+                  strerror(errno));
+            close(fd);
+            unlink(tmpFilename.c_str());
+            return;
+        }
+        data += written;
+        remaining -= written;
+    }
+    close(fd);
+    if (rename(tmpFilename.c_str(), mFilename.c_str()) != 0) {
+        ALOGE("ShaderBlobStore: could not rename %s: %s", tmpFilename.c_str(), strerror(errno));
+        unlink(tmpFilename.c_str());
+    }
+}
+
+} /* namespace skiapipeline */
+} /* namespace uirenderer */
+} /* namespace android */
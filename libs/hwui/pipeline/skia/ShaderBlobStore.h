@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <SkData.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+namespace uirenderer {
+namespace skiapipeline {
+
+/**
+ * ShaderBlobStore is the key/value store behind ShaderCache. Unlike BlobCache, which evicts
+ * random entries, it keeps a hit count and a last use time per entry and, when full, evicts
+ * the entries with the fewest hits per byte first, oldest first among equals. That way a large,
+ * rarely used program can't push out many small programs that every run needs.
+ *
+ * Hit counts are persisted in the cache file and halved each time the file is loaded, so that
+ * entries that stop being used eventually age out.
+ *
+ * Entries loaded from the file point into a read-only mapping of it, and are only checked
+ * against their checksum when first read, so loading the cache doesn't touch every page.
+ *
+ * Not thread safe, ShaderCache serializes access.
+ */
+class ShaderBlobStore {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t evictedBytes = 0;
+    };
+
+    /**
+     * Loads the store from filename if it exists and was written by the same build.
+     */
+    ShaderBlobStore(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize,
+                    const std::string& filename);
+
+    /**
+     * Returns the value for key, or nullptr if there is none. Counts as a use of the entry.
+     */
+    sk_sp<SkData> get(const void* key, size_t keySize);
+
+    /**
+     * Inserts or replaces the value for key, evicting other entries if needed. Entries that
+     * exceed the size limits are ignored.
+     */
+    void set(const void* key, size_t keySize, const void* value, size_t valueSize);
+
+    /**
+     * Returns the keys of the most used entries, most used first.
+     */
+    std::vector<std::string> mostUsedKeys(size_t maxCount) const;
+
+    /**
+     * Returns the value for key while it still points into the file mapping, or nullptr.
+     * Reading it faults in pages of the file, so callers copy it without serializing access.
+     */
+    sk_sp<SkData> mappedValue(const std::string& key) const;
+
+    /**
+     * Replaces the value for key with copy, a copy of the value returned by mappedValue, so that
+     * reading it later doesn't fault in pages of the file. Drops the entry if the copy doesn't
+     * match its checksum. Returns the number of bytes made resident.
+     */
+    size_t makeResident(const std::string& key, const sk_sp<SkData>& mapped,
+                        sk_sp<SkData> copy);
+
+    bool isResident(const std::string& key) const;
+
+    void writeToFile();
+
+    size_t size() const { return mEntries.size(); }
+    size_t totalSize() const { return mTotalSize; }
+    size_t maxTotalSize() const { return mMaxTotalSize; }
+    const Stats& stats() const { return mStats; }
+
+private:
+    struct Entry {
+        sk_sp<SkData> value;
+        uint32_t hits = 0;
+        uint64_t lastUse = 0;
+        uint32_t checksum = 0;
+        // false while the value still points into the file and hasn't been checked yet
+        bool verified = false;
+        bool resident = false;
+    };
+
+    typedef std::unordered_map<std::string, Entry> EntryMap;
+
+    void loadFromFile();
+    bool verify(Entry& entry);
+    void evict(size_t targetSize, const std::string& keep);
+
+    const size_t mMaxKeySize;
+    const size_t mMaxValueSize;
+    const size_t mMaxTotalSize;
+    const std::string mFilename;
+
+    EntryMap mEntries;
+    size_t mTotalSize = 0;
+    uint64_t mUseClock = 0;
+    Stats mStats;
+};
+
+} /* namespace skiapipeline */
+} /* namespace uirenderer */
+} /* namespace android */
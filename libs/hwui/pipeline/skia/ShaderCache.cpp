@@ -16,10 +16,11 @@
 
 #include "ShaderCache.h"
 #include <algorithm>
+#include <inttypes.h>
 #include <log/log.h>
 #include <thread>
-#include "FileBlobCache.h"
 #include "Properties.h"
+#include "ShaderBlobStore.h"
 #include "utils/TraceUtils.h"
 
 namespace android {
@@ -31,8 +32,12 @@ static const size_t maxKeySize = 1024;
 static const size_t maxValueSize = 64 * 1024;
 static const size_t maxTotalSize = 512 * 1024;
 
+// Warm up limits, chosen to cover the programs of typical first frames.
+static const size_t maxWarmUpEntries = 32;
+static const size_t maxWarmUpBytes = 256 * 1024;
+
 ShaderCache::ShaderCache() {
-    // There is an "incomplete FileBlobCache type" compilation error, if ctor is moved to header.
+    // There is an "incomplete ShaderBlobStore type" compilation error, if ctor is moved to header.
 }
 
 ShaderCache ShaderCache::sCache;
@@ -49,8 +54,59 @@ void ShaderCache::initShaderDiskCache() {
     // or snapshot migration. Also, program binaries may not work well on some
     // desktop / laptop GPUs. Thus, disable the shader disk cache for emulator builds.
     if (!Properties::runningInEmulator && mFilename.length() > 0) {
-        mBlobCache.reset(new FileBlobCache(maxKeySize, maxValueSize, maxTotalSize, mFilename));
+        mBlobStore.reset(new ShaderBlobStore(maxKeySize, maxValueSize, maxTotalSize, mFilename));
         mInitialized = true;
+
+        mGeneration++;
+        mWarmUpPending = Properties::enableShaderCacheWarmUp && mBlobStore->size() > 0;
+        if (mWarmUpPending) {
+            std::thread warmUpThread(&ShaderCache::warmUp, this, mGeneration);
+            warmUpThread.detach();
+        }
+    }
+}
+
+void ShaderCache::warmUp(uint32_t generation) {
+    ATRACE_NAME("ShaderCache::warmUp");
+    std::vector<std::string> keys;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (generation != mGeneration || !mBlobStore) {
+            return;
+        }
+        keys = mBlobStore->mostUsedKeys(maxWarmUpEntries);
+    }
+
+    size_t warmBytes = 0;
+    for (auto& key : keys) {
+        if (warmBytes >= maxWarmUpBytes) {
+            break;
+        }
+        sk_sp<SkData> mapped;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (generation != mGeneration || !mBlobStore) {
+                return;
+            }
+            mapped = mBlobStore->mappedValue(key);
+        }
+        if (!mapped) {
+            continue;
+        }
+        // Read the value in from disk without the lock, so that loads on the RenderThread
+        // never wait for the warm up's I/O
+        sk_sp<SkData> copy = SkData::MakeWithCopy(mapped->data(), mapped->size());
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (generation != mGeneration || !mBlobStore) {
+            return;
+        }
+        warmBytes += mBlobStore->makeResident(key, mapped, std::move(copy));
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (generation == mGeneration) {
+        mWarmUpPending = false;
+        mWarmUpCondition.notify_all();
     }
 }
 
@@ -59,49 +115,25 @@ void ShaderCache::setFilename(const char* filename) {
     mFilename = filename;
 }
 
-BlobCache* ShaderCache::getBlobCacheLocked() {
+ShaderBlobStore* ShaderCache::getBlobStoreLocked() {
     LOG_ALWAYS_FATAL_IF(!mInitialized, "ShaderCache has not been initialized");
-    return mBlobCache.get();
+    return mBlobStore.get();
 }
 
 sk_sp<SkData> ShaderCache::load(const SkData& key) {
     ATRACE_NAME("ShaderCache::load");
-    size_t keySize = key.size();
     std::lock_guard<std::mutex> lock(mMutex);
     if (!mInitialized) {
         return nullptr;
     }
 
-    // mObservedBlobValueSize is reasonably big to avoid memory reallocation
-    // Allocate a buffer with malloc. SkData takes ownership of that allocation and will call free.
-    void* valueBuffer = malloc(mObservedBlobValueSize);
-    if (!valueBuffer) {
-        return nullptr;
-    }
-    BlobCache* bc = getBlobCacheLocked();
-    size_t valueSize = bc->get(key.data(), keySize, valueBuffer, mObservedBlobValueSize);
-    int maxTries = 3;
-    while (valueSize > mObservedBlobValueSize && maxTries > 0) {
-        mObservedBlobValueSize = std::min(valueSize, maxValueSize);
-        void *newValueBuffer = realloc(valueBuffer, mObservedBlobValueSize);
-        if (!newValueBuffer) {
-            free(valueBuffer);
-            return nullptr;
-        }
-        valueBuffer = newValueBuffer;
-        valueSize = bc->get(key.data(), keySize, valueBuffer, mObservedBlobValueSize);
-        maxTries--;
-    }
-    if (!valueSize) {
-        free(valueBuffer);
-        return nullptr;
-    }
-    if (valueSize > mObservedBlobValueSize) {
-        ALOGE("ShaderCache::load value size is too big %d", (int) valueSize);
-        free(valueBuffer);
-        return nullptr;
+    sk_sp<SkData> value = getBlobStoreLocked()->get(key.data(), key.size());
+    if (value) {
+        // hit counts are persisted, so that the next run can rank entries
+        mStoreDirty = true;
+        scheduleSaveLocked();
     }
-    return SkData::MakeFromMalloc(valueBuffer, valueSize);
+    return value;
 }
 
 void ShaderCache::store(const SkData& key, const SkData& data) {
@@ -119,19 +151,21 @@ void ShaderCache::store(const SkData& key, const SkData& data) {
         return;
     }
 
-    const void* value = data.data();
-
-    BlobCache* bc = getBlobCacheLocked();
-    bc->set(key.data(), keySize, value, valueSize);
+    getBlobStoreLocked()->set(key.data(), keySize, data.data(), valueSize);
+    mStoreDirty = true;
+    scheduleSaveLocked();
+}
 
+void ShaderCache::scheduleSaveLocked() {
     if (!mSavePending && mDeferredSaveDelay > 0) {
         mSavePending = true;
         std::thread deferredSaveThread([this]() {
             sleep(mDeferredSaveDelay);
             std::lock_guard<std::mutex> lock(mMutex);
             ATRACE_NAME("ShaderCache::saveToDisk");
-            if (mInitialized && mBlobCache) {
-                mBlobCache->writeToFile();
+            if (mInitialized && mBlobStore && mStoreDirty) {
+                mBlobStore->writeToFile();
+                mStoreDirty = false;
             }
             mSavePending = false;
         });
@@ -139,6 +173,22 @@ void ShaderCache::store(const SkData& key, const SkData& data) {
     }
 }
 
+void ShaderCache::dumpMemoryUsage(String8& log) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    log.appendFormat("Shader Cache:\n");
+    if (!mInitialized || !mBlobStore) {
+        log.appendFormat("  Disabled\n");
+        return;
+    }
+    const ShaderBlobStore::Stats& stats = mBlobStore->stats();
+    log.appendFormat("  Size: %.2f kB / %.2f kB (entries = %zu)\n",
+                     mBlobStore->totalSize() / 1024.0f, mBlobStore->maxTotalSize() / 1024.0f,
+                     mBlobStore->size());
+    log.appendFormat("  Hits: %" PRIu64 ", Misses: %" PRIu64 "\n", stats.hits, stats.misses);
+    log.appendFormat("  Evictions: %" PRIu64 " (%.2f kB)\n", stats.evictions,
+                     stats.evictedBytes / 1024.0f);
+}
+
 } /* namespace skiapipeline */
 } /* namespace uirenderer */
 } /* namespace android */
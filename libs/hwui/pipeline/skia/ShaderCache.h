@@ -17,20 +17,21 @@
 #pragma once
 
 #include <cutils/compiler.h>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
 #include <GrContextOptions.h>
+#include <SkData.h>
+#include <utils/String8.h>
 
 namespace android {
-
-class BlobCache;
-class FileBlobCache;
-
 namespace uirenderer {
 namespace skiapipeline {
 
+class ShaderBlobStore;
+
 class ShaderCache : public GrContextOptions::PersistentCache {
 public:
     /**
@@ -44,6 +45,10 @@ public:
      * into an initialized state, such that it is able to insert and retrieve entries from the
      * cache.  This should be called when HWUI pipeline is initialized.  When not in the initialized
      * state the load and store methods will return without performing any cache operations.
+     *
+     * Unless disabled with PROPERTY_SHADER_CACHE_WARM_UP, this also starts a background thread
+     * that reads the entries used by the most previous runs from the cache file ahead of the
+     * first frames, so that their loads don't fault the file in on the RenderThread.
      */
     virtual void initShaderDiskCache();
 
@@ -66,6 +71,11 @@ public:
      */
     void store(const SkData& key, const SkData& data) override;
 
+    /**
+     * "dumpMemoryUsage" appends the cache size and its hit, miss and eviction counts to log.
+     */
+    void dumpMemoryUsage(String8& log) const;
+
 private:
     // Creation and (the lack of) destruction is handled internally.
     ShaderCache();
@@ -75,12 +85,23 @@ private:
     void operator=(const ShaderCache&) = delete;
 
     /**
-     * "getBlobCacheLocked" returns the BlobCache object being used to store the
-     * key/value blob pairs.  If the BlobCache object has not yet been created,
-     * this will do so, loading the serialized cache contents from disk if
-     * possible.
+     * "getBlobStoreLocked" returns the ShaderBlobStore object being used to store the
+     * key/value blob pairs.
+     */
+    ShaderBlobStore* getBlobStoreLocked();
+
+    /**
+     * "scheduleSaveLocked" starts a deferred save of the cache and its hit counts if one is not
+     * already pending.
      */
-    BlobCache* getBlobCacheLocked();
+    void scheduleSaveLocked();
+
+    /**
+     * "warmUp" reads the most used cache entries from the cache file mapping into memory, so that
+     * their first load doesn't fault them in. It runs on a background thread, only takes mMutex
+     * between reads and gives up as soon as the cache is re-initialized.
+     */
+    void warmUp(uint32_t generation);
 
     /**
      * "mInitialized" indicates whether the ShaderCache is in the initialized
@@ -93,13 +114,12 @@ private:
     bool mInitialized = false;
 
     /**
-     * "mBlobCache" is the cache in which the key/value blob pairs are stored.  It
-     * is initially NULL, and will be initialized by getBlobCacheLocked the
-     * first time it's needed.
-     * The blob cache contains the Android build number. We treat version mismatches as an empty
-     * cache (logic implemented in BlobCache::unflatten).
+     * "mBlobStore" is the store in which the key/value blob pairs are stored, along with their
+     * hit counts. It is created by initShaderDiskCache, which loads it from mFilename.
+     * The file contains the Android build fingerprint. We treat version mismatches as an empty
+     * cache (logic implemented in ShaderBlobStore).
      */
-    std::unique_ptr<FileBlobCache> mBlobCache;
+    std::unique_ptr<ShaderBlobStore> mBlobStore;
 
     /**
      * "mFilename" is the name of the file for storing cache contents in between
@@ -110,6 +130,18 @@ private:
      */
     std::string mFilename;
 
+    /**
+     * "mGeneration" is incremented each time the cache is initialized, so that a warm up started
+     * for a previous cache stops touching the current one.
+     */
+    uint32_t mGeneration = 0;
+
+    /**
+     * "mWarmUpPending" is true while a warm up thread is running for the current generation.
+     */
+    bool mWarmUpPending = false;
+    std::condition_variable mWarmUpCondition;
+
     /**
      * "mSavePending" indicates whether or not a deferred save operation is
      * pending.  Each time a key/value pair is inserted into the cache via
@@ -120,9 +152,10 @@ private:
     bool mSavePending = false;
 
     /**
-     *  "mObservedBlobValueSize" is the maximum value size observed by the cache reading function.
+     * "mStoreDirty" indicates whether entries or hit counts changed since the store was last
+     * saved.
      */
-    size_t mObservedBlobValueSize = 20*1024;
+    bool mStoreDirty = false;
 
     /**
      *  The time in seconds to wait before saving newly inserted cache entries.
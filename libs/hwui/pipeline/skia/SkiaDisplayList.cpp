@@ -16,6 +16,7 @@
 
 #include "SkiaDisplayList.h"
 
+#include "ContentHashCanvas.h"
 #include "DumpOpsCanvas.h"
 #include "SkiaPipeline.h"
 #include "VectorDrawable.h"
@@ -45,6 +46,50 @@ bool SkiaDisplayList::reuseDisplayList(RenderNode* node, renderthread::CanvasCon
     return true;
 }
 
+bool SkiaDisplayList::computeContentHash(uint64_t* outHash) const {
+    if (!mContentHashValid) {
+        ContentHashCanvas canvas(*this);
+        const_cast<SkLiteDL&>(mDisplayList).draw(&canvas);
+        mContentHashable = canvas.isHashable();
+        mContentHash = canvas.hash();
+        mContentHashValid = true;
+    }
+    *outHash = mContentHash;
+    return mContentHashable;
+}
+
+bool SkiaDisplayList::hasSameContent(const DisplayList& other) const {
+    if (!other.isSkiaDL()) return false;
+    const SkiaDisplayList& otherList = static_cast<const SkiaDisplayList&>(other);
+
+    // Lists with content that carries its own state are always treated as changed, as are lists
+    // with ops that can't be compared.
+    for (const SkiaDisplayList* list : {this, &otherList}) {
+        if (list->mHasUncomparableContent || !list->mChildFunctors.empty() ||
+            !list->mVectorDrawables.empty() || !list->mAnimatedImages.empty() ||
+            !list->mMutableImages.empty()) {
+            return false;
+        }
+    }
+
+    if (projectionReceiveIndex != otherList.projectionReceiveIndex ||
+        mChildNodes.size() != otherList.mChildNodes.size() ||
+        mReorderBarriers.size() != otherList.mReorderBarriers.size()) {
+        return false;
+    }
+    for (auto it = mChildNodes.begin(), otherIt = otherList.mChildNodes.begin();
+         it != mChildNodes.end(); ++it, ++otherIt) {
+        if (it->getRenderNode() != otherIt->getRenderNode() ||
+            it->getRecordedMatrix() != otherIt->getRecordedMatrix()) {
+            return false;
+        }
+    }
+
+    uint64_t hash, otherHash;
+    return computeContentHash(&hash) && otherList.computeContentHash(&otherHash) &&
+           hash == otherHash;
+}
+
 void SkiaDisplayList::updateChildren(std::function<void(RenderNode*)> updateFn) {
     for (auto& child : mChildNodes) {
         updateFn(child.getRenderNode());
@@ -99,6 +144,12 @@ bool SkiaDisplayList::prepareListAndChildren(
             isDirty = true;
         }
 
+        nsecs_t decodeDuration;
+        int lateFrames;
+        animatedImage->takeDecodeStats(&decodeDuration, &lateFrames);
+        info.out.animatedImageDecodeDuration += decodeDuration;
+        info.out.animatedImageLateFrames += lateFrames;
+
         if (animatedImage->isRunning() &&
             timeTilNextFrame != TreeInfo::Out::kNoAnimatedImageDelay) {
             auto& delay = info.out.animatedImageDelay;
@@ -131,6 +182,10 @@ void SkiaDisplayList::reset() {
     mAnimatedImages.clear();
     mChildFunctors.clear();
     mChildNodes.clear();
+    mReorderBarriers.clear();
+    mHasUncomparableContent = false;
+    mHasTextureLayers = false;
+    mContentHashValid = false;
 
     projectionReceiveIndex = -1;
     allocator.~LinearAllocator();
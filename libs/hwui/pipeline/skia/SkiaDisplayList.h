@@ -85,6 +85,12 @@ public:
      */
     bool hasVectorDrawables() const override { return !mVectorDrawables.empty(); }
 
+    /**
+     * Compares child nodes structurally and the remaining ops by a content hash computed with
+     * ContentHashCanvas, which is cached until the list is reset.
+     */
+    bool hasSameContent(const DisplayList& other) const override;
+
     /**
      * Attempts to reset and reuse this DisplayList.
      *
@@ -148,6 +154,16 @@ public:
     std::vector<AnimatedImageDrawable*> mAnimatedImages;
     SkLiteDL mDisplayList;
 
+    // Reorder barrier drawables recorded into mDisplayList, so that they can be identified when
+    // comparing the content of two lists.
+    std::vector<SkDrawable*> mReorderBarriers;
+
+    // Set at record time for ops ContentHashCanvas can't see through, e.g. vertices.
+    bool mHasUncomparableContent = false;
+
+    // Set at record time for texture layers, which can only be drawn on the RenderThread.
+    bool mHasTextureLayers = false;
+
     // mProjectionReceiver points to a child node (stored in mChildNodes) that is as a projection
     // receiver. It is set at record time and used at both prepare and draw tree traversals to
     // make sure backward projected nodes are found and drawn immediately after mProjectionReceiver.
@@ -165,6 +181,13 @@ public:
     // the
     // outline of their parent.
     SkMatrix mProjectedReceiverParentMatrix;
+
+private:
+    bool computeContentHash(uint64_t* outHash) const;
+
+    mutable bool mContentHashValid = false;
+    mutable bool mContentHashable = false;
+    mutable uint64_t mContentHash = 0;
 };
 
 };  // namespace skiapipeline
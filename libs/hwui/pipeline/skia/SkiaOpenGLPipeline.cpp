@@ -66,6 +66,18 @@ bool SkiaOpenGLPipeline::draw(const Frame& frame, const SkRect& screenDirty, con
                               const BakedOpRenderer::LightInfo& lightInfo,
                               const std::vector<sp<RenderNode>>& renderNodes,
                               FrameInfoVisualizer* profiler) {
+    bool deferred = false;
+    if (CC_UNLIKELY(Properties::enableDeferredRecording)) {
+        if (mCharacterization.width() == frame.width() &&
+            mCharacterization.height() == frame.height() &&
+            mCharacterizationWideColorGamut == wideColorGamut) {
+            // the recording reads the light info, so it has to be set up front
+            SkiaPipeline::updateLighting(lightGeometry, lightInfo);
+            deferred = beginDeferredFrame(mCharacterization, *layerUpdateQueue, dirty,
+                                          renderNodes, opaque, wideColorGamut, contentDrawBounds);
+        }
+    }
+
     mEglManager.damageFrame(frame, dirty);
 
     // setup surface for fbo0
@@ -83,9 +95,17 @@ bool SkiaOpenGLPipeline::draw(const Frame& frame, const SkRect& screenDirty, con
     sk_sp<SkSurface> surface(SkSurface::MakeFromBackendRenderTarget(
             mRenderThread.getGrContext(), backendRT, kBottomLeft_GrSurfaceOrigin, nullptr, &props));
 
-    SkiaPipeline::updateLighting(lightGeometry, lightInfo);
-    renderFrame(*layerUpdateQueue, dirty, renderNodes, opaque, wideColorGamut, contentDrawBounds,
-                surface);
+    if (deferred) {
+        finishDeferredFrame(surface);
+    } else {
+        SkiaPipeline::updateLighting(lightGeometry, lightInfo);
+        renderFrame(*layerUpdateQueue, dirty, renderNodes, opaque, wideColorGamut,
+                    contentDrawBounds, surface);
+        if (CC_UNLIKELY(Properties::enableDeferredRecording)) {
+            surface->characterize(&mCharacterization);
+            mCharacterizationWideColorGamut = wideColorGamut;
+        }
+    }
     layerUpdateQueue->clear();
 
     // Draw visual debugging features
@@ -207,6 +227,7 @@ bool SkiaOpenGLPipeline::setSurface(Surface* surface, SwapBehavior swapBehavior,
         mEglManager.destroySurface(mEglSurface);
         mEglSurface = EGL_NO_SURFACE;
     }
+    mCharacterization = SkSurfaceCharacterization();
 
     if (surface) {
         const bool wideColorGamut = colorMode == ColorMode::WideColorGamut;
@@ -56,6 +56,11 @@ private:
     renderthread::EglManager& mEglManager;
     EGLSurface mEglSurface = EGL_NO_SURFACE;
     bool mBufferPreserved = false;
+
+    // Characterization of the last frame's surface, used to record the next frame on a worker
+    // thread before its surface exists. See Properties::enableDeferredRecording.
+    SkSurfaceCharacterization mCharacterization;
+    bool mCharacterizationWideColorGamut = false;
 };
 
 } /* namespace skiapipeline */
@@ -16,6 +16,8 @@
 
 #include "SkiaPipeline.h"
 
+#include <SkDeferredDisplayList.h>
+#include <SkDeferredDisplayListRecorder.h>
 #include <SkImageEncoder.h>
 #include <SkImagePriv.h>
 #include <SkOverdrawCanvas.h>
@@ -346,6 +348,105 @@ void SkiaPipeline::renderFrame(const LayerUpdateQueue& layers, const SkRect& cli
     surface->getCanvas()->flush();
 }
 
+class SkiaPipeline::DeferredFrameTask : public Task<bool> {
+public:
+    explicit DeferredFrameTask(const SkSurfaceCharacterization& characterization)
+            : recorder(characterization) {}
+
+    SkDeferredDisplayListRecorder recorder;
+    std::function<void(SkCanvas*)> record;
+    std::unique_ptr<SkDeferredDisplayList> displayList;
+};
+
+class SkiaPipeline::DeferredFrameProcessor : public TaskProcessor<bool> {
+public:
+    explicit DeferredFrameProcessor(TaskManager* taskManager)
+            : TaskProcessor<bool>(taskManager) {}
+
+    virtual void onProcess(const sp<Task<bool>>& task) override {
+        ATRACE_NAME("record deferred frame");
+        DeferredFrameTask* t = static_cast<DeferredFrameTask*>(task.get());
+        t->record(t->recorder.getCanvas());
+        t->displayList = t->recorder.detach();
+        task->setResult(t->displayList != nullptr);
+    }
+};
+
+// Returns true if drawing node and its subtree doesn't read any GPU resources, and so can be
+// recorded away from the RenderThread.
+static bool canRecordDeferred(const RenderNode* node) {
+    if (node->getLayerSurface()) {
+        return false;
+    }
+    const DisplayList* displayList = node->getDisplayList();
+    if (!displayList) {
+        return true;
+    }
+    if (!displayList->isSkiaDL()) {
+        return false;
+    }
+    const SkiaDisplayList* skiaDisplayList = static_cast<const SkiaDisplayList*>(displayList);
+    if (skiaDisplayList->hasFunctor() || skiaDisplayList->hasVectorDrawables() ||
+        skiaDisplayList->mHasTextureLayers) {
+        return false;
+    }
+    for (auto& child : skiaDisplayList->mChildNodes) {
+        if (!canRecordDeferred(child.getRenderNode())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SkiaPipeline::beginDeferredFrame(const SkSurfaceCharacterization& characterization,
+                                      const LayerUpdateQueue& layers, const SkRect& clip,
+                                      const std::vector<sp<RenderNode>>& nodes, bool opaque,
+                                      bool wideColorGamut, const Rect& contentDrawBounds) {
+    if (!characterization.isValid() || !layers.entries().empty() || !mVectorDrawables.empty() ||
+        Properties::skpCaptureEnabled || Properties::debugOverdraw) {
+        return false;
+    }
+    for (auto& node : nodes) {
+        if (!canRecordDeferred(node.get())) {
+            return false;
+        }
+    }
+
+    if (!mDeferredFrameProcessor.get()) {
+        TaskManager* taskManager = getTaskManager();
+        mDeferredFrameProcessor =
+                new DeferredFrameProcessor(taskManager->canRunTasks() ? taskManager : nullptr);
+    }
+    sp<DeferredFrameTask> task(new DeferredFrameTask(characterization));
+    // The RenderThread doesn't touch the tree until finishDeferredFrame returns, so the
+    // recording can read it without locking. The layer queue is known to be empty.
+    task->record = [this, &layers, clip, nodes, opaque, wideColorGamut,
+                    contentDrawBounds](SkCanvas* canvas) {
+        renderFrameImpl(layers, clip, nodes, opaque, wideColorGamut, contentDrawBounds, canvas);
+    };
+    mDeferredFrameProcessor->add(task);
+    mDeferredFrame = task;
+    return true;
+}
+
+void SkiaPipeline::finishDeferredFrame(sk_sp<SkSurface> surface) {
+    sp<DeferredFrameTask> task = std::move(mDeferredFrame);
+    bool recorded;
+    {
+        ATRACE_NAME("wait for deferred frame");
+        recorded = task->getResult();
+    }
+    if (recorded) {
+        ATRACE_NAME("replay deferred frame");
+        surface->draw(task->displayList.get());
+    } else {
+        task->record(surface->getCanvas());
+    }
+
+    ATRACE_NAME("flush commands");
+    surface->getCanvas()->flush();
+}
+
 namespace {
 static Rect nodeBounds(RenderNode& node) {
     auto& props = node.properties();
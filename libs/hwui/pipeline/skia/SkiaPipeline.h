@@ -17,6 +17,7 @@
 #pragma once
 
 #include <SkSurface.h>
+#include <SkSurfaceCharacterization.h>
 #include "FrameBuilder.h"
 #include "hwui/AnimatedImageDrawable.h"
 #include "renderthread/CanvasContext.h"
@@ -53,6 +54,22 @@ public:
                      const std::vector<sp<RenderNode>>& nodes, bool opaque, bool wideColorGamut,
                      const Rect& contentDrawBounds, sk_sp<SkSurface> surface);
 
+    /**
+     * Starts recording the frame into an SkDeferredDisplayList on a worker thread, for a surface
+     * matching characterization. Returns false, without recording anything, if the frame draws
+     * content that can only be touched on the RenderThread: layers, vector drawables, functors
+     * and texture layers all read GrContext owned surfaces.
+     */
+    bool beginDeferredFrame(const SkSurfaceCharacterization& characterization,
+                            const LayerUpdateQueue& layers, const SkRect& clip,
+                            const std::vector<sp<RenderNode>>& nodes, bool opaque,
+                            bool wideColorGamut, const Rect& contentDrawBounds);
+
+    /**
+     * Waits for the recording started by beginDeferredFrame and replays it into surface.
+     */
+    void finishDeferredFrame(sk_sp<SkSurface> surface);
+
     std::vector<VectorDrawableRoot*>* getVectorDrawables() { return &mVectorDrawables; }
 
     static void destroyLayer(RenderNode* node);
@@ -131,6 +148,11 @@ private:
     SkCanvas* tryCapture(SkSurface* surface);
     void endCapture(SkSurface* surface);
 
+    class DeferredFrameTask;
+    class DeferredFrameProcessor;
+    sp<DeferredFrameProcessor> mDeferredFrameProcessor;
+    sp<DeferredFrameTask> mDeferredFrame;
+
     std::vector<sk_sp<SkImage>> mPinnedImages;
 
     /**
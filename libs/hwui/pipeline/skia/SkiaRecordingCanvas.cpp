@@ -83,12 +83,14 @@ void SkiaRecordingCanvas::insertReorderBarrier(bool enableReorder) {
         SkDrawable* drawable =
                 mDisplayList->allocateDrawable<EndReorderBarrierDrawable>(mCurrentBarrier);
         mCurrentBarrier = nullptr;
+        mDisplayList->mReorderBarriers.push_back(drawable);
         drawDrawable(drawable);
     }
     if (enableReorder) {
         mCurrentBarrier = (StartReorderBarrierDrawable*)
                                   mDisplayList->allocateDrawable<StartReorderBarrierDrawable>(
                                           mDisplayList.get());
+        mDisplayList->mReorderBarriers.push_back(mCurrentBarrier);
         drawDrawable(mCurrentBarrier);
     }
 }
@@ -98,6 +100,7 @@ void SkiaRecordingCanvas::drawLayer(uirenderer::DeferredLayerUpdater* layerUpdat
         // Create a ref-counted drawable, which is kept alive by sk_sp in SkLiteDL.
         sk_sp<SkDrawable> drawable(new LayerDrawable(layerUpdater));
         drawDrawable(drawable.get());
+        mDisplayList->mHasTextureLayers = true;
     }
 }
 
@@ -144,6 +147,19 @@ void SkiaRecordingCanvas::drawVectorDrawable(VectorDrawableRoot* tree) {
     mDisplayList->mVectorDrawables.push_back(tree);
 }
 
+void SkiaRecordingCanvas::drawVertices(const SkVertices* vertices, SkBlendMode mode,
+                                       const SkPaint& paint) {
+    mDisplayList->mHasUncomparableContent = true;
+    SkiaCanvas::drawVertices(vertices, mode, paint);
+}
+
+void SkiaRecordingCanvas::drawBitmapMesh(Bitmap& bitmap, int meshWidth, int meshHeight,
+                                         const float* vertices, const int* colors,
+                                         const SkPaint* paint) {
+    mDisplayList->mHasUncomparableContent = true;
+    SkiaCanvas::drawBitmapMesh(bitmap, meshWidth, meshHeight, vertices, colors, paint);
+}
+
 // ----------------------------------------------------------------------------
 // Recording Canvas draw operations: Bitmaps
 // ----------------------------------------------------------------------------
@@ -45,6 +45,11 @@ public:
 
     virtual uirenderer::DisplayList* finishRecording() override;
 
+    virtual void drawVertices(const SkVertices*, SkBlendMode, const SkPaint& paint) override;
+    virtual void drawBitmapMesh(Bitmap& bitmap, int meshWidth, int meshHeight,
+                                const float* vertices, const int* colors,
+                                const SkPaint* paint) override;
+
     virtual void drawBitmap(Bitmap& bitmap, float left, float top, const SkPaint* paint) override;
     virtual void drawBitmap(Bitmap& bitmap, const SkMatrix& matrix, const SkPaint* paint) override;
     virtual void drawBitmap(Bitmap& bitmap, float srcLeft, float srcTop, float srcRight,
@@ -101,6 +101,8 @@ bool SkiaVulkanPipeline::swapBuffers(const Frame& frame, bool drew, const SkRect
     // Even if we decided to cancel the frame, from the perspective of jank
     // metrics the frame was swapped at this point
     currentFrameInfo->markSwapBuffers();
+    currentFrameInfo->set(FrameInfoIndex::GpuWaitDuration) = mVkSurface->lastGpuWaitDuration();
+    currentFrameInfo->set(FrameInfoIndex::FramesInFlight) = mVkSurface->lastFramesInFlight();
 
     if (*requireSwap) {
         mVkManager.swapBuffers(mVkSurface);
@@ -18,6 +18,7 @@
 
 #include <GrRectanizer_pow2.h>
 #include <SkCanvas.h>
+#include <algorithm>
 #include <cmath>
 #include "renderthread/RenderProxy.h"
 #include "renderthread/RenderThread.h"
@@ -27,9 +28,11 @@ namespace android {
 namespace uirenderer {
 namespace skiapipeline {
 
-VectorDrawableAtlas::VectorDrawableAtlas(size_t surfaceArea, StorageMode storageMode)
+VectorDrawableAtlas::VectorDrawableAtlas(size_t surfaceArea, StorageMode storageMode,
+                                         size_t maxSurfaceArea)
         : mWidth((int)std::sqrt(surfaceArea))
         , mHeight((int)std::sqrt(surfaceArea))
+        , mMaxSurfaceArea(std::max(maxSurfaceArea, (size_t)(mWidth * mHeight)))
         , mStorageMode(storageMode) {}
 
 void VectorDrawableAtlas::prepareForDraw(GrContext* context) {
@@ -42,9 +45,9 @@ void VectorDrawableAtlas::prepareForDraw(GrContext* context) {
             mConsecutiveFailures = 0;
             mFreeRects.clear();
         } else {
-            if (isFragmented()) {
+            if (mRepackInProgress || isFragmented() || shouldGrow()) {
                 // Invoke repack outside renderFrame to avoid jank.
-                renderthread::RenderProxy::repackVectorDrawableAtlas();
+                scheduleRepack();
             }
         }
     }
@@ -52,18 +55,48 @@ void VectorDrawableAtlas::prepareForDraw(GrContext* context) {
 
 #define MAX_CONSECUTIVE_FAILURES 5
 #define MAX_UNUSED_RATIO 2.0f
+#define GROWTH_FACTOR 2
+// A repack step moves at most 1 / REPACK_STEPS of the atlas area
+#define REPACK_STEPS 4
 
 bool VectorDrawableAtlas::isFragmented() {
-    return mConsecutiveFailures > MAX_CONSECUTIVE_FAILURES &&
+    return !mRepackInProgress && mConsecutiveFailures > MAX_CONSECUTIVE_FAILURES &&
            mPixelUsedByVDs * MAX_UNUSED_RATIO < mPixelAllocated;
 }
 
+bool VectorDrawableAtlas::shouldGrow() {
+    return !mRepackInProgress && mConsecutiveFailures > MAX_CONSECUTIVE_FAILURES &&
+           (size_t)(mWidth * mHeight) < mMaxSurfaceArea;
+}
+
+void VectorDrawableAtlas::scheduleRepack() {
+    if (!mRepackScheduled) {
+        mRepackScheduled = true;
+        renderthread::RenderProxy::repackVectorDrawableAtlas();
+    }
+}
+
 void VectorDrawableAtlas::repackIfNeeded(GrContext* context) {
-    // We repackage when atlas failed to allocate space MAX_CONSECUTIVE_FAILURES consecutive
-    // times and the atlas allocated pixels are at least MAX_UNUSED_RATIO times higher than pixels
-    // used by atlas VDs.
-    if (isFragmented() && mSurface) {
-        repack(context);
+    mRepackScheduled = false;
+    if (StorageMode::allowSharedSurface != mStorageMode || !mSurface) {
+        return;
+    }
+    if (!mRepackInProgress) {
+        // We repackage when atlas failed to allocate space MAX_CONSECUTIVE_FAILURES consecutive
+        // times and the atlas allocated pixels are at least MAX_UNUSED_RATIO times higher than
+        // pixels used by atlas VDs, or when the atlas can still grow.
+        if (!isFragmented() && !shouldGrow()) {
+            return;
+        }
+        startRepack(context);
+        if (!mRepackInProgress) {
+            return;
+        }
+    }
+    repackStep(context);
+    if (mRepackInProgress) {
+        // Continue on the next idle pass of the render thread.
+        scheduleRepack();
     }
 }
 
@@ -73,80 +106,133 @@ bool VectorDrawableAtlas::compareCacheEntry(const CacheEntry& first, const Cache
            second.VDrect.width() * second.VDrect.height();
 }
 
-void VectorDrawableAtlas::repack(GrContext* context) {
+void VectorDrawableAtlas::startRepack(GrContext* context) {
     ATRACE_CALL();
-    sk_sp<SkSurface> newSurface;
-    SkCanvas* canvas = nullptr;
-    if (StorageMode::allowSharedSurface == mStorageMode) {
-        newSurface = createSurface(mWidth, mHeight, context);
-        if (!newSurface) {
-            return;
+    int width = mWidth;
+    int height = mHeight;
+    if (shouldGrow()) {
+        // Grow only if the VDs would not fit comfortably in an atlas of the current size,
+        // otherwise the failures are caused by fragmentation.
+        size_t neededArea = mPixelUsedByVDs;
+        for (const CacheEntry& entry : mRects) {
+            if (entry.surface && fitInAtlas(entry.VDrect.width(), entry.VDrect.height())) {
+                neededArea += entry.VDrect.width() * entry.VDrect.height();
+            }
         }
-        canvas = newSurface->getCanvas();
-        canvas->clear(SK_ColorTRANSPARENT);
-        mRectanizer = std::make_unique<GrRectanizerPow2>(mWidth, mHeight);
-    } else {
-        if (!mSurface) {
-            return;  // nothing to repack
+        if (neededArea * MAX_UNUSED_RATIO > mWidth * mHeight) {
+            size_t area = std::min((size_t)(mWidth * mHeight * GROWTH_FACTOR), mMaxSurfaceArea);
+            width = (int)std::sqrt(area);
+            height = (int)std::sqrt(area);
         }
-        mRectanizer.reset();
     }
-    mFreeRects.clear();
-    SkImage* sourceImageAtlas = nullptr;
-    if (mSurface) {
-        sourceImageAtlas = mSurface->makeImageSnapshot().get();
+    sk_sp<SkSurface> newSurface = createSurface(width, height, context);
+    if (!newSurface && width != mWidth) {
+        // Don't try to grow again, the surface may be too big for the GPU.
+        mMaxSurfaceArea = mWidth * mHeight;
+        width = mWidth;
+        height = mHeight;
+        newSurface = createSurface(width, height, context);
     }
+    if (!newSurface) {
+        return;
+    }
+    if (width != mWidth) {
+        mGrowCount++;
+    }
+    mRepackCount++;
+    newSurface->getCanvas()->clear(SK_ColorTRANSPARENT);
+
+    // Until they are moved, VDs in the current atlas use it as if it was a standalone surface.
+    for (CacheEntry& entry : mRects) {
+        if (!entry.surface) {
+            entry.surface = mSurface;
+        }
+    }
+    mPreviousSurface = mSurface;
+    mSurface = newSurface;
+    mWidth = width;
+    mHeight = height;
+    mRectanizer = std::make_unique<GrRectanizerPow2>(mWidth, mHeight);
+    mFreeRects.clear();
+    mPixelUsedByVDs = 0;
+    mPixelAllocated = 0;
+    mConsecutiveFailures = 0;
 
     // Sort the list by VD size, which allows for the smallest VDs to get first in the atlas.
     // Sorting is safe, because it does not affect iterator validity.
     if (mRects.size() <= 100) {
         mRects.sort(compareCacheEntry);
     }
+    mRepackIt = mRects.begin();
+    mRepackInProgress = true;
+}
 
-    for (CacheEntry& entry : mRects) {
+void VectorDrawableAtlas::repackStep(GrContext* context) {
+    ATRACE_CALL();
+    SkCanvas* canvas = mSurface->getCanvas();
+    // Snapshots are taken per step, VDs may draw into the previous atlas between steps.
+    sk_sp<SkImage> previousImageAtlas;
+    if (mPreviousSurface) {
+        previousImageAtlas = mPreviousSurface->makeImageSnapshot();
+    }
+
+    const int maxMovedPixels = mWidth * mHeight / REPACK_STEPS;
+    int movedPixels = 0;
+    while (mRepackIt != mRects.end() && movedPixels < maxMovedPixels) {
+        CacheEntry& entry = *mRepackIt;
+        mRepackIt++;
+        if (!entry.surface) {
+            continue;  // allocated in the new atlas after the repack started
+        }
         SkRect currentVDRect = entry.VDrect;
-        SkImage* sourceImage;  // copy either from the atlas or from a standalone surface
-        if (entry.surface) {
-            if (!fitInAtlas(currentVDRect.width(), currentVDRect.height())) {
-                continue;  // don't even try to repack huge VD
-            }
-            sourceImage = entry.surface->makeImageSnapshot().get();
-        } else {
-            sourceImage = sourceImageAtlas;
+        const bool inPreviousAtlas = entry.surface == mPreviousSurface;
+        if (!inPreviousAtlas && !fitInAtlas(currentVDRect.width(), currentVDRect.height())) {
+            continue;  // don't even try to repack huge VD
         }
+        // copy either from the previous atlas or from a standalone surface
+        sk_sp<SkImage> sourceImage =
+                inPreviousAtlas ? previousImageAtlas : entry.surface->makeImageSnapshot();
         size_t VDRectArea = currentVDRect.width() * currentVDRect.height();
         SkIPoint16 pos;
-        if (canvas && mRectanizer->addRect(currentVDRect.width(), currentVDRect.height(), &pos)) {
+        if (mRectanizer->addRect(currentVDRect.width(), currentVDRect.height(), &pos)) {
             SkRect newRect =
                     SkRect::MakeXYWH(pos.fX, pos.fY, currentVDRect.width(), currentVDRect.height());
-            canvas->drawImageRect(sourceImage, currentVDRect, newRect, nullptr);
+            canvas->drawImageRect(sourceImage.get(), currentVDRect, newRect, nullptr);
             entry.VDrect = newRect;
             entry.rect = newRect;
-            if (entry.surface) {
-                // A rectangle moved from a standalone surface to the atlas.
-                entry.surface = nullptr;
-                mPixelUsedByVDs += VDRectArea;
-            }
-        } else {
-            // Repack failed for this item. If it is not already, store it in a standalone
-            // surface.
-            if (!entry.surface) {
-                // A rectangle moved from an atlas to a standalone surface.
-                mPixelUsedByVDs -= VDRectArea;
-                SkRect newRect = SkRect::MakeWH(currentVDRect.width(), currentVDRect.height());
-                entry.surface = createSurface(newRect.width(), newRect.height(), context);
-                auto tempCanvas = entry.surface->getCanvas();
+            entry.surface = nullptr;
+            mPixelUsedByVDs += VDRectArea;
+            mPixelAllocated += VDRectArea;
+            movedPixels += VDRectArea;
+            continue;
+        }
+        // Count VDs that don't fit anymore like failed requests, so that the atlas grows again
+        // once the repack is complete.
+        if (mConsecutiveFailures <= MAX_CONSECUTIVE_FAILURES) {
+            mConsecutiveFailures++;
+        }
+        if (inPreviousAtlas) {
+            // Repack failed for this item, store it in a standalone surface. If that fails too,
+            // the VD keeps the previous atlas alive until it is released.
+            SkRect newRect = SkRect::MakeWH(currentVDRect.width(), currentVDRect.height());
+            sk_sp<SkSurface> surface = createSurface(newRect.width(), newRect.height(), context);
+            if (surface) {
+                auto tempCanvas = surface->getCanvas();
                 tempCanvas->clear(SK_ColorTRANSPARENT);
-                tempCanvas->drawImageRect(sourceImageAtlas, currentVDRect, newRect, nullptr);
+                tempCanvas->drawImageRect(sourceImage.get(), currentVDRect, newRect, nullptr);
                 entry.VDrect = newRect;
                 entry.rect = newRect;
+                entry.surface = surface;
+                mFallbackSurfacesCreated++;
+                movedPixels += VDRectArea;
             }
         }
     }
-    mPixelAllocated = mPixelUsedByVDs;
     context->flush();
-    mSurface = newSurface;
-    mConsecutiveFailures = 0;
+    if (mRepackIt == mRects.end()) {
+        mPreviousSurface.reset();
+        mRepackInProgress = false;
+    }
 }
 
 AtlasEntry VectorDrawableAtlas::requestNewEntry(int width, int height, GrContext* context) {
@@ -202,6 +288,9 @@ AtlasEntry VectorDrawableAtlas::requestNewEntry(int width, int height, GrContext
     if (nullptr != context) {
         result.rect = SkRect::MakeWH(width, height);
         result.surface = createSurface(width, height, context);
+        if (result.surface) {
+            mFallbackSurfacesCreated++;
+        }
         auto eraseIt = mRects.emplace(mRects.end(), result.rect, result.rect, result.surface);
         CacheEntry* entry = &(*eraseIt);
         entry->eraseIt = eraseIt;
@@ -249,6 +338,9 @@ void VectorDrawableAtlas::releaseEntry(AtlasKey atlasKey) {
             mConsecutiveFailures = 0;
         }
         auto eraseIt = entry->eraseIt;
+        if (mRepackInProgress && mRepackIt == eraseIt) {
+            mRepackIt++;
+        }
         mRects.erase(eraseIt);
     }
 }
@@ -280,7 +372,34 @@ void VectorDrawableAtlas::setStorageMode(StorageMode mode) {
         mSurface.reset();
         mRectanizer.reset();
         mFreeRects.clear();
+        mPreviousSurface.reset();
+        mRepackInProgress = false;
+    }
+}
+
+bool VectorDrawableAtlas::isFallbackEntry(const CacheEntry& entry) const {
+    return entry.surface && entry.surface != mPreviousSurface;
+}
+
+VectorDrawableAtlas::Stats VectorDrawableAtlas::getStats() const {
+    Stats stats;
+    if (mSurface) {
+        stats.surfaceArea = mWidth * mHeight;
+    }
+    stats.maxSurfaceArea = mMaxSurfaceArea;
+    stats.usedArea = mPixelUsedByVDs;
+    stats.entries = mRects.size();
+    for (const CacheEntry& entry : mRects) {
+        if (isFallbackEntry(entry)) {
+            stats.fallbackSurfaces++;
+            stats.fallbackArea += entry.surface->width() * entry.surface->height();
+        }
     }
+    stats.fallbackSurfacesCreated = mFallbackSurfacesCreated;
+    stats.growCount = mGrowCount;
+    stats.repackCount = mRepackCount;
+    stats.repackInProgress = mRepackInProgress;
+    return stats;
 }
 
 } /* namespace skiapipeline */
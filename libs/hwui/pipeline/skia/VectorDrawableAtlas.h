@@ -54,6 +54,10 @@ struct AtlasEntry {
  * the atlas, VectorDrawableAtlas creates a standalone surface for each VD.
  * When a VectorDrawable is deleted, it invokes VectorDrawableAtlas::releaseEntry, which is keeping
  * track of free spaces and allow to reuse the surface for another VD.
+ * The atlas starts small and, when VDs keep falling back to standalone surfaces, grows one step
+ * at a time up to a maximum area. Growing and defragmenting are both done by a repack, which moves
+ * a bounded number of pixels per step, so that the copies are spread over several idle passes of
+ * the render thread instead of landing on a single frame.
  */
 // TODO: Check if not using atlas for AnimatedVD is more efficient.
 // TODO: For low memory situations, when there are no paint effects in VD, we may render without an
@@ -62,8 +66,44 @@ class VectorDrawableAtlas : public virtual RefBase {
 public:
     enum class StorageMode { allowSharedSurface, disallowSharedSurface };
 
+    struct Stats {
+        /**
+         * area of the shared surface and the maximum area it can grow to
+         */
+        size_t surfaceArea = 0;
+        size_t maxSurfaceArea = 0;
+
+        /**
+         * area of the shared surface used by VDs
+         */
+        size_t usedArea = 0;
+
+        size_t entries = 0;
+
+        /**
+         * VDs currently drawn in a standalone surface and the area of these surfaces
+         */
+        size_t fallbackSurfaces = 0;
+        size_t fallbackArea = 0;
+
+        /**
+         * standalone surfaces created since the atlas was created, because the atlas was full or
+         * the VD too big
+         */
+        uint64_t fallbackSurfacesCreated = 0;
+
+        uint32_t growCount = 0;
+        uint32_t repackCount = 0;
+        bool repackInProgress = false;
+    };
+
+    /**
+     * "surfaceArea" is the initial area of the shared surface, which may grow up to
+     * "maxSurfaceArea". A "maxSurfaceArea" smaller than "surfaceArea" disables growing.
+     */
     VectorDrawableAtlas(size_t surfaceArea,
-                        StorageMode storageMode = StorageMode::allowSharedSurface);
+                        StorageMode storageMode = StorageMode::allowSharedSurface,
+                        size_t maxSurfaceArea = 0);
 
     /**
      * "prepareForDraw" may allocate a new surface if needed. It may schedule to repack the
@@ -73,7 +113,9 @@ public:
 
     /**
      * Repack the atlas if needed, by moving used rectangles into a new atlas surface.
-     * The goal of repacking is to fix a fragmented atlas.
+     * The goal of repacking is to fix a fragmented atlas, or to grow an atlas that is too small.
+     * Each call moves a bounded number of pixels and schedules another call if the repack isn't
+     * complete.
      */
     void repackIfNeeded(GrContext* context);
 
@@ -108,6 +150,8 @@ public:
 
     void setStorageMode(StorageMode mode);
 
+    Stats getStats() const;
+
     /**
      * "delayedReleaseEntries" is indirectly invoked by "releaseEntry", when "releaseEntry" is
      * invoked from a non render thread.
@@ -147,8 +191,27 @@ private:
     sk_sp<SkSurface> mSurface;
 
     std::unique_ptr<GrRectanizer> mRectanizer;
-    const int mWidth;
-    const int mHeight;
+    int mWidth;
+    int mHeight;
+    size_t mMaxSurfaceArea;
+
+    /**
+     * While a repack is in progress, "mSurface" is the new atlas surface and "mPreviousSurface"
+     * the one being drained. VDs that have not been moved yet reference "mPreviousSurface" from
+     * their "surface" field, as if it was a standalone surface.
+     */
+    sk_sp<SkSurface> mPreviousSurface;
+    bool mRepackInProgress = false;
+
+    /**
+     * next entry to move by the repack in progress
+     */
+    std::list<CacheEntry>::iterator mRepackIt;
+
+    /**
+     * true if a call to "repackIfNeeded" is already posted to the render thread
+     */
+    bool mRepackScheduled = false;
 
     /**
      * "mRects" keeps records only for rectangles used by VDs. List has nice properties: constant
@@ -178,6 +241,10 @@ private:
      */
     int mConsecutiveFailures = 0;
 
+    uint64_t mFallbackSurfacesCreated = 0;
+    uint32_t mGrowCount = 0;
+    uint32_t mRepackCount = 0;
+
     /**
      * mStorageMode allows using a shared surface to store small vector drawables.
      * Using a shared surface can boost the performance by allowing GL ops to be batched, but may
@@ -202,7 +269,11 @@ private:
         return 2 * width < mWidth && 2 * height < mHeight;
     }
 
-    void repack(GrContext* context);
+    bool shouldGrow();
+    void scheduleRepack();
+    void startRepack(GrContext* context);
+    void repackStep(GrContext* context);
+    bool isFallbackEntry(const CacheEntry& entry) const;
 
     static bool compareCacheEntry(const CacheEntry& first, const CacheEntry& second);
 };
@@ -26,6 +26,8 @@
 
 #include <GLES2/gl2.h>
 
+#include <inttypes.h>
+
 namespace android {
 namespace uirenderer {
 
@@ -116,6 +118,23 @@ OffscreenBuffer::~OffscreenBuffer() {
 // OffscreenBufferPool
 ///////////////////////////////////////////////////////////////////////////////
 
+// Limits the allocations endFrame() may add to a frame
+static const uint32_t kMaxPrewarmPerFrame = 2;
+
+static uint32_t sizeBucket(uint32_t dimension) {
+    return dimension > 1 ? 32 - __builtin_clz(dimension - 1) : 0;
+}
+
+static uint32_t estimateSizeInBytes(uint32_t width, uint32_t height, bool wideColorGamut) {
+    return width * height * (wideColorGamut ? 8 : 4);
+}
+
+OffscreenBufferPool::BucketKey::BucketKey(uint32_t textureWidth, uint32_t textureHeight,
+                                          bool wideColorGamut)
+        : widthBucket(sizeBucket(textureWidth))
+        , heightBucket(sizeBucket(textureHeight))
+        , wideColorGamut(wideColorGamut) {}
+
 OffscreenBufferPool::OffscreenBufferPool()
         // 4 screen-sized RGBA_8888 textures
         : mMaxSize(DeviceInfo::multiplyByResolution(4 * 4)) {}
@@ -124,44 +143,108 @@ OffscreenBufferPool::~OffscreenBufferPool() {
     clear();  // TODO: unique_ptr?
 }
 
-int OffscreenBufferPool::Entry::compare(const Entry& lhs, const Entry& rhs) {
-    int deltaInt = int(lhs.width) - int(rhs.width);
-    if (deltaInt != 0) return deltaInt;
-
-    deltaInt = int(lhs.height) - int(rhs.height);
-    if (deltaInt != 0) return deltaInt;
-
-    return int(lhs.wideColorGamut) - int(rhs.wideColorGamut);
+void OffscreenBufferPool::deleteEntry(Bucket& bucket, std::list<Entry>::iterator entry) {
+    mSize -= entry->layer->getSizeInBytes();
+    mCount--;
+    delete entry->layer;
+    bucket.entries.erase(entry);
 }
 
 void OffscreenBufferPool::clear() {
-    for (auto& entry : mPool) {
-        delete entry.layer;
+    for (auto& it : mBuckets) {
+        Bucket& bucket = it.second;
+        for (auto& entry : bucket.entries) {
+            delete entry.layer;
+        }
+        bucket.entries.clear();
+        // layers still in use will be returned, but their size isn't worth keeping
+        bucket.framePeaks.fill(0);
     }
-    mPool.clear();
     mSize = 0;
+    mCount = 0;
+}
+
+void OffscreenBufferPool::trim() {
+    for (auto& it : mBuckets) {
+        Bucket& bucket = it.second;
+        const uint32_t recentPeak = bucket.recentPeak();
+        const uint32_t keep = recentPeak > bucket.inUse ? recentPeak - bucket.inUse : 0;
+        while (bucket.entries.size() > keep) {
+            deleteEntry(bucket, std::prev(bucket.entries.end()));
+        }
+    }
+}
+
+void OffscreenBufferPool::endFrame(RenderState& renderState) {
+    mFrameIndex = (mFrameIndex + 1) % kRecentFrames;
+    uint32_t prewarmed = 0;
+    for (auto& it : mBuckets) {
+        Bucket& bucket = it.second;
+        // layers kept across frames count as needed by the next frame
+        bucket.framePeaks[mFrameIndex] = bucket.inUse;
+
+        const uint32_t recentPeak = bucket.recentPeak();
+        if (!recentPeak) {
+            bucket.recentWidth = 0;
+            bucket.recentHeight = 0;
+            continue;
+        }
+        const uint32_t bytes = estimateSizeInBytes(bucket.recentWidth, bucket.recentHeight,
+                                                   it.first.wideColorGamut);
+        while (prewarmed < kMaxPrewarmPerFrame &&
+               bucket.inUse + bucket.entries.size() < recentPeak && mSize + bytes <= mMaxSize) {
+            OffscreenBuffer* layer =
+                    new OffscreenBuffer(renderState, Caches::getInstance(), bucket.recentWidth,
+                                        bucket.recentHeight, it.first.wideColorGamut);
+            insert(bucket, layer);
+            mStats.prewarmed++;
+            mStats.allocatedBytes += layer->getSizeInBytes();
+            prewarmed++;
+        }
+    }
 }
 
 OffscreenBuffer* OffscreenBufferPool::get(RenderState& renderState, const uint32_t width,
                                           const uint32_t height, bool wideColorGamut) {
     OffscreenBuffer* layer = nullptr;
 
-    Entry entry(width, height, wideColorGamut);
-    auto iter = mPool.find(entry);
+    const uint32_t textureWidth = OffscreenBuffer::computeIdealDimension(width);
+    const uint32_t textureHeight = OffscreenBuffer::computeIdealDimension(height);
+    Bucket& bucket = mBuckets[BucketKey(textureWidth, textureHeight, wideColorGamut)];
+
+    // smallest layer that fits, the most recently returned one among equals
+    auto best = bucket.entries.end();
+    for (auto it = bucket.entries.begin(); it != bucket.entries.end(); ++it) {
+        const Texture& texture = it->layer->texture;
+        if (texture.width() < textureWidth || texture.height() < textureHeight) continue;
+        if (best == bucket.entries.end() ||
+            texture.width() * texture.height() <
+                    best->layer->texture.width() * best->layer->texture.height()) {
+            best = it;
+        }
+    }
 
-    if (iter != mPool.end()) {
-        entry = *iter;
-        mPool.erase(iter);
+    if (best != bucket.entries.end()) {
+        layer = best->layer;
+        bucket.entries.erase(best);
+        mCount--;
 
-        layer = entry.layer;
         layer->viewportWidth = width;
         layer->viewportHeight = height;
         mSize -= layer->getSizeInBytes();
+        mStats.hits++;
+        mStats.reusedBytes += layer->getSizeInBytes();
     } else {
         layer = new OffscreenBuffer(renderState, Caches::getInstance(), width, height,
                                     wideColorGamut);
+        mStats.misses++;
+        mStats.allocatedBytes += layer->getSizeInBytes();
     }
 
+    bucket.inUse++;
+    bucket.framePeaks[mFrameIndex] = std::max(bucket.framePeaks[mFrameIndex], bucket.inUse);
+    bucket.recentWidth = std::max(bucket.recentWidth, textureWidth);
+    bucket.recentHeight = std::max(bucket.recentHeight, textureHeight);
     return layer;
 }
 
@@ -184,30 +267,66 @@ OffscreenBuffer* OffscreenBufferPool::resize(OffscreenBuffer* layer, const uint3
 }
 
 void OffscreenBufferPool::dump() {
-    for (auto entry : mPool) {
-        ALOGD("  Layer size %dx%d", entry.width, entry.height);
+    for (auto& it : mBuckets) {
+        for (auto& entry : it.second.entries) {
+            ALOGD("  Layer size %dx%d", entry.layer->texture.width(),
+                  entry.layer->texture.height());
+        }
+    }
+    ALOGD("  Hits %" PRIu64 ", misses %" PRIu64 ", prewarmed %" PRIu64, mStats.hits,
+          mStats.misses, mStats.prewarmed);
+}
+
+void OffscreenBufferPool::dumpMemoryUsage(String8& log) const {
+    log.appendFormat("  OffscreenBufferPool  %8d / %8d (layers = %zu)\n", mSize, mMaxSize,
+                     mCount);
+    log.appendFormat("    Hits: %" PRIu64 ", Misses: %" PRIu64 ", Prewarmed: %" PRIu64 "\n",
+                     mStats.hits, mStats.misses, mStats.prewarmed);
+    log.appendFormat("    Reused: %.2f kB, Allocated: %.2f kB, Evicted: %.2f kB\n",
+                     mStats.reusedBytes / 1024.0f, mStats.allocatedBytes / 1024.0f,
+                     mStats.evictedBytes / 1024.0f);
+}
+
+void OffscreenBufferPool::insert(Bucket& bucket, OffscreenBuffer* layer) {
+    bucket.entries.push_front({layer, ++mUseClock});
+    mSize += layer->getSizeInBytes();
+    mCount++;
+}
+
+void OffscreenBufferPool::evictOldest() {
+    Bucket* victimBucket = nullptr;
+    for (auto& it : mBuckets) {
+        Bucket& bucket = it.second;
+        if (!bucket.entries.empty() &&
+            (!victimBucket ||
+             bucket.entries.back().lastUse < victimBucket->entries.back().lastUse)) {
+            victimBucket = &bucket;
+        }
+    }
+    if (victimBucket) {
+        mStats.evictedBytes += victimBucket->entries.back().layer->getSizeInBytes();
+        deleteEntry(*victimBucket, std::prev(victimBucket->entries.end()));
     }
 }
 
 void OffscreenBufferPool::putOrDelete(OffscreenBuffer* layer) {
+    Bucket& bucket =
+            mBuckets[BucketKey(layer->texture.width(), layer->texture.height(),
+                               layer->wideColorGamut)];
+    // layers allocated outside of the pool may be handed to it as well
+    if (bucket.inUse) bucket.inUse--;
+
     const uint32_t size = layer->getSizeInBytes();
     // Don't even try to cache a layer that's bigger than the cache
     if (size < mMaxSize) {
-        // TODO: Use an LRU
         while (mSize + size > mMaxSize) {
-            OffscreenBuffer* victim = mPool.begin()->layer;
-            mSize -= victim->getSizeInBytes();
-            delete victim;
-            mPool.erase(mPool.begin());
+            evictOldest();
         }
 
         // clear region, since it's no longer valid
         layer->region.clear();
 
-        Entry entry(layer);
-
-        mPool.insert(entry);
-        mSize += size;
+        insert(bucket, layer);
     } else {
         delete layer;
     }
@@ -23,7 +23,12 @@
 #include "Texture.h"
 #include "utils/Macros.h"
 
-#include <set>
+#include <utils/String8.h>
+
+#include <algorithm>
+#include <array>
+#include <list>
+#include <map>
 
 namespace android {
 namespace uirenderer {
@@ -85,9 +90,28 @@ public:
 
 /**
  * Pool of OffscreenBuffers allocated, but not currently in use.
+ *
+ * Buffers are grouped in buckets by the power of two above each texture dimension, and a request
+ * can be served by any buffer of its bucket that is at least as large. Within a bucket, the most
+ * recently returned buffer is reused first, and when the pool is full the least recently
+ * returned buffer of any bucket is deleted.
+ *
+ * The pool also tracks how many buffers of each bucket were in use at once during the last
+ * frames. endFrame() uses that to allocate buffers that recent frames needed but the pool lost,
+ * and trim() to keep them while dropping the rest.
  */
 class OffscreenBufferPool {
 public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t prewarmed = 0;
+        // bytes of buffers served from the pool, and allocated on misses or by prewarming
+        uint64_t reusedBytes = 0;
+        uint64_t allocatedBytes = 0;
+        uint64_t evictedBytes = 0;
+    };
+
     OffscreenBufferPool();
     ~OffscreenBufferPool();
 
@@ -100,10 +124,22 @@ public:
     void putOrDelete(OffscreenBuffer* layer);
 
     /**
-     * Clears the pool. This causes all layers to be deleted.
+     * Clears the pool. This causes all layers to be deleted, and forgets which sizes recent
+     * frames used.
      */
     void clear();
 
+    /**
+     * Deletes the layers that recent frames didn't need.
+     */
+    void trim();
+
+    /**
+     * Marks the end of a frame. Allocates, within the size limit, the layers that recent frames
+     * needed at once and are no longer in the pool, so that the next frames find them.
+     */
+    void endFrame(RenderState& renderState);
+
     /**
      * Returns the maximum size of the pool in bytes.
      */
@@ -114,43 +150,65 @@ public:
      */
     uint32_t getSize() { return mSize; }
 
-    size_t getCount() { return mPool.size(); }
+    size_t getCount() { return mCount; }
+
+    const Stats& stats() const { return mStats; }
 
     /**
      * Prints out the content of the pool.
      */
     void dump();
 
-private:
-    struct Entry {
-        Entry() {}
-
-        Entry(const uint32_t layerWidth, const uint32_t layerHeight, bool wideColorGamut)
-                : width(OffscreenBuffer::computeIdealDimension(layerWidth))
-                , height(OffscreenBuffer::computeIdealDimension(layerHeight))
-                , wideColorGamut(wideColorGamut) {}
+    void dumpMemoryUsage(String8& log) const;
 
-        explicit Entry(OffscreenBuffer* layer)
-                : layer(layer)
-                , width(layer->texture.width())
-                , height(layer->texture.height())
-                , wideColorGamut(layer->wideColorGamut) {}
-
-        static int compare(const Entry& lhs, const Entry& rhs);
-
-        bool operator==(const Entry& other) const { return compare(*this, other) == 0; }
+private:
+    // Number of frames whose layer usage is remembered
+    static const uint32_t kRecentFrames = 8;
 
-        bool operator!=(const Entry& other) const { return compare(*this, other) != 0; }
+    struct BucketKey {
+        BucketKey(uint32_t textureWidth, uint32_t textureHeight, bool wideColorGamut);
 
-        bool operator<(const Entry& other) const { return Entry::compare(*this, other) < 0; }
+        bool operator<(const BucketKey& other) const {
+            if (widthBucket != other.widthBucket) return widthBucket < other.widthBucket;
+            if (heightBucket != other.heightBucket) return heightBucket < other.heightBucket;
+            return wideColorGamut < other.wideColorGamut;
+        }
 
-        OffscreenBuffer* layer = nullptr;
-        uint32_t width = 0;
-        uint32_t height = 0;
-        bool wideColorGamut = false;
-    };  // struct Entry
+        uint32_t widthBucket;
+        uint32_t heightBucket;
+        bool wideColorGamut;
+    };
 
-    std::multiset<Entry> mPool;
+    struct Entry {
+        OffscreenBuffer* layer;
+        uint64_t lastUse;
+    };
+
+    struct Bucket {
+        uint32_t recentPeak() const {
+            return *std::max_element(framePeaks.begin(), framePeaks.end());
+        }
+
+        // most recently returned first
+        std::list<Entry> entries;
+        // layers of this bucket currently handed out
+        uint32_t inUse = 0;
+        // most layers in use at once, in each of the recent frames
+        std::array<uint32_t, kRecentFrames> framePeaks{};
+        // largest layer requested recently, in texture dimensions
+        uint32_t recentWidth = 0;
+        uint32_t recentHeight = 0;
+    };
+
+    void insert(Bucket& bucket, OffscreenBuffer* layer);
+    void evictOldest();
+    void deleteEntry(Bucket& bucket, std::list<Entry>::iterator entry);
+
+    std::map<BucketKey, Bucket> mBuckets;
+    uint64_t mUseClock = 0;
+    uint32_t mFrameIndex = 0;
+    size_t mCount = 0;
+    Stats mStats;
 
     uint32_t mSize = 0;
     uint32_t mMaxSize;
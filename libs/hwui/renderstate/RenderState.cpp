@@ -116,10 +116,12 @@ void RenderState::flush(Caches::FlushMode mode) {
         case Caches::FlushMode::Full:
         // fall through
         case Caches::FlushMode::Moderate:
-        // fall through
-        case Caches::FlushMode::Layers:
             if (mLayerPool) mLayerPool->clear();
             break;
+        case Caches::FlushMode::Layers:
+            // other windows may still be drawing, keep the layers recent frames used
+            if (mLayerPool) mLayerPool->trim();
+            break;
     }
     if (mCaches) mCaches->flush(mode);
 }
@@ -465,6 +467,7 @@ void RenderState::dump() {
     meshState().dump();
     scissor().dump();
     stencil().dump();
+    if (mLayerPool) mLayerPool->dump();
 }
 
 } /* namespace uirenderer */
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CacheBudgetController.h"
+
+#include <algorithm>
+
+namespace android {
+namespace uirenderer {
+namespace renderthread {
+
+// Bounds of the budget, relative to the base budget
+#define MIN_BUDGET_RATIO (0.5f)
+#define MAX_BUDGET_RATIO (2.0f)
+
+#define GROW_STEP (1.25f)
+#define SHRINK_STEP (0.75f)
+
+// The cache counts as full, and is likely evicting resources that are still used, above this
+// ratio of the budget
+#define FULL_CACHE_RATIO (0.95f)
+
+// Grow when this many of the last THRASHING_WINDOW frames missed their deadline with a full cache
+#define THRASHING_WINDOW 32
+#define THRASHING_FRAMES 4
+
+// Give the cache time to settle after a change before growing it again
+#define MIN_GROW_INTERVAL ms2ns(2000)
+// Don't grow for a while after the app was asked to trim its memory
+#define MEMORY_PRESSURE_HOLDOFF s2ns(30)
+
+static const char* reasonName(CacheBudgetController::Reason reason) {
+    switch (reason) {
+        case CacheBudgetController::Reason::Base:
+            return "base";
+        case CacheBudgetController::Reason::Thrashing:
+            return "thrashing";
+        case CacheBudgetController::Reason::MemoryPressure:
+            return "memory pressure";
+    }
+    return "unknown";
+}
+
+void CacheBudgetController::setBaseBudget(size_t baseBytes, nsecs_t now) {
+    mBaseBudget = baseBytes;
+    setBudget(baseBytes, Reason::Base, now);
+}
+
+bool CacheBudgetController::frameCompleted(bool missedDeadline, size_t cacheBytesUsed,
+                                           nsecs_t now) {
+    bool thrashing = missedDeadline && cacheBytesUsed >= mBudget * FULL_CACHE_RATIO;
+    mThrashingFrames = (mThrashingFrames << 1) | (thrashing ? 1 : 0);
+    if (!thrashing || now - mLastChange < MIN_GROW_INTERVAL ||
+        (mLastMemoryPressure && now - mLastMemoryPressure < MEMORY_PRESSURE_HOLDOFF)) {
+        return false;
+    }
+    static_assert(THRASHING_WINDOW == 32, "mThrashingFrames holds 32 frames");
+    if (__builtin_popcount(mThrashingFrames) < THRASHING_FRAMES) {
+        return false;
+    }
+    return setBudget(mBudget * GROW_STEP, Reason::Thrashing, now);
+}
+
+bool CacheBudgetController::onMemoryPressure(nsecs_t now) {
+    mLastMemoryPressure = now;
+    return setBudget(mBudget * SHRINK_STEP, Reason::MemoryPressure, now);
+}
+
+bool CacheBudgetController::resetToBase(nsecs_t now) {
+    return setBudget(mBaseBudget, Reason::Base, now);
+}
+
+bool CacheBudgetController::setBudget(size_t bytes, Reason reason, nsecs_t now) {
+    bytes = std::max(static_cast<size_t>(mBaseBudget * MIN_BUDGET_RATIO),
+                     std::min(static_cast<size_t>(mBaseBudget * MAX_BUDGET_RATIO), bytes));
+    // the frames that led to the previous budget don't say anything about the new one
+    mThrashingFrames = 0;
+    mLastChange = now;
+    if (bytes == mBudget) {
+        return false;
+    }
+    Change& change = mHistory.next();
+    change.time = now;
+    change.fromBytes = mBudget;
+    change.toBytes = bytes;
+    change.reason = reason;
+    mBudget = bytes;
+    return true;
+}
+
+void CacheBudgetController::dump(String8& log, nsecs_t now) const {
+    log.appendFormat("  Resource cache budget %6.2f MB (base = %.2f MB, range = %.2f - %.2f MB)\n",
+                     mBudget / 1024.0f / 1024.0f, mBaseBudget / 1024.0f / 1024.0f,
+                     mBaseBudget * MIN_BUDGET_RATIO / 1024.0f / 1024.0f,
+                     mBaseBudget * MAX_BUDGET_RATIO / 1024.0f / 1024.0f);
+    for (size_t i = 0; i < mHistory.size(); i++) {
+        const Change& change = mHistory[i];
+        log.appendFormat("    %6.2f s ago: %.2f MB -> %.2f MB (%s)\n",
+                         (now - change.time) / 1000000000.0f, change.fromBytes / 1024.0f / 1024.0f,
+                         change.toBytes / 1024.0f / 1024.0f, reasonName(change.reason));
+    }
+}
+
+} /* namespace renderthread */
+} /* namespace uirenderer */
+} /* namespace android */
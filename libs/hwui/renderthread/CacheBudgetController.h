@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "utils/RingBuffer.h"
+
+#include <utils/String8.h>
+#include <utils/Timers.h>
+
+#include <cstdint>
+
+namespace android {
+namespace uirenderer {
+namespace renderthread {
+
+/**
+ * CacheBudgetController adapts the GrContext resource cache budget of the CacheManager to the
+ * device, instead of keeping one budget derived from the screen size. The budget grows when
+ * frames miss their deadline while the cache is full, which means resources are being evicted
+ * and uploaded again, and shrinks when the app is asked to trim its memory.
+ *
+ * The budget stays between half and twice the base budget, and each change is kept in a short
+ * history for dumpsys gfxinfo.
+ */
+class CacheBudgetController {
+public:
+    enum class Reason { Base, Thrashing, MemoryPressure };
+
+    /**
+     * Sets the base budget, derived from the screen size, and resets the budget to it.
+     */
+    void setBaseBudget(size_t baseBytes, nsecs_t now);
+
+    /**
+     * Returns true if the budget changed. cacheBytesUsed is the size of the GrContext resource
+     * cache at the end of the frame.
+     */
+    bool frameCompleted(bool missedDeadline, size_t cacheBytesUsed, nsecs_t now);
+
+    /**
+     * Shrinks the budget a step, and holds off growing it for a while. Returns true if the
+     * budget changed.
+     */
+    bool onMemoryPressure(nsecs_t now);
+
+    /**
+     * Returns to the base budget, returns true if the budget changed.
+     */
+    bool resetToBase(nsecs_t now);
+
+    size_t budget() const { return mBudget; }
+    size_t baseBudget() const { return mBaseBudget; }
+
+    void dump(String8& log, nsecs_t now) const;
+
+private:
+    struct Change {
+        nsecs_t time = 0;
+        size_t fromBytes = 0;
+        size_t toBytes = 0;
+        Reason reason = Reason::Base;
+    };
+
+    bool setBudget(size_t bytes, Reason reason, nsecs_t now);
+
+    size_t mBaseBudget = 0;
+    size_t mBudget = 0;
+    nsecs_t mLastChange = 0;
+    nsecs_t mLastMemoryPressure = 0;
+    // one bit per recent frame, the lowest for the latest, set if the frame missed its deadline
+    // with a full cache
+    uint32_t mThrashingFrames = 0;
+    RingBuffer<Change, 8> mHistory;
+};
+
+} /* namespace renderthread */
+} /* namespace uirenderer */
+} /* namespace android */
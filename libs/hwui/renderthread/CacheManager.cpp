@@ -22,11 +22,14 @@
 #include "pipeline/skia/ShaderCache.h"
 #include "pipeline/skia/SkiaMemoryTracer.h"
 #include "renderstate/RenderState.h"
+#include "utils/LinearAllocator.h"
 
 #include <GrContextOptions.h>
 #include <SkExecutor.h>
 #include <SkGraphics.h>
+#include <androidfw/NativeMemoryStats.h>
 #include <gui/Surface.h>
+#include <inttypes.h>
 #include <math.h>
 #include <set>
 
@@ -46,10 +49,15 @@ namespace renderthread {
 #define FONT_CACHE_MIN_MB (0.5f)
 #define FONT_CACHE_MAX_MB (4.0f)
 
+// The vector drawable atlas starts at a quarter of the screen area and grows, when it is too small
+// to hold the VDs on screen, up to the screen area.
+#define VD_ATLAS_INITIAL_AREA_RATIO (0.25f)
+
 CacheManager::CacheManager(const DisplayInfo& display) : mMaxSurfaceArea(display.w * display.h) {
     mVectorDrawableAtlas = new skiapipeline::VectorDrawableAtlas(
-            mMaxSurfaceArea / 2,
-            skiapipeline::VectorDrawableAtlas::StorageMode::disallowSharedSurface);
+            mMaxSurfaceArea * VD_ATLAS_INITIAL_AREA_RATIO,
+            skiapipeline::VectorDrawableAtlas::StorageMode::disallowSharedSurface,
+            mMaxSurfaceArea);
     if (Properties::isSkiaEnabled()) {
         skiapipeline::ShaderCache::get().initShaderDiskCache();
     }
@@ -70,18 +78,53 @@ void CacheManager::reset(sk_sp<GrContext> context) {
 void CacheManager::destroy() {
     // cleanup any caches here as the GrContext is about to go away...
     mGrContext.reset(nullptr);
+    NativeMemoryStats::Set(NativeMemoryCategory::kHwuiGpuResourceCache, 0, 0);
     mVectorDrawableAtlas = new skiapipeline::VectorDrawableAtlas(
-            mMaxSurfaceArea / 2,
-            skiapipeline::VectorDrawableAtlas::StorageMode::disallowSharedSurface);
+            mMaxSurfaceArea * VD_ATLAS_INITIAL_AREA_RATIO,
+            skiapipeline::VectorDrawableAtlas::StorageMode::disallowSharedSurface,
+            mMaxSurfaceArea);
 }
 
 void CacheManager::updateContextCacheSizes() {
-    mMaxResourceBytes = mMaxSurfaceArea * SURFACE_SIZE_MULTIPLIER;
+    mBudgetController.setBaseBudget(mMaxSurfaceArea * SURFACE_SIZE_MULTIPLIER,
+                                    systemTime(SYSTEM_TIME_MONOTONIC));
+    applyCacheBudget();
+}
+
+void CacheManager::applyCacheBudget() {
+    mMaxResourceBytes = mBudgetController.budget();
     mBackgroundResourceBytes = mMaxResourceBytes * BACKGROUND_RETENTION_PERCENTAGE;
 
     mGrContext->setResourceCacheLimits(mMaxResources, mMaxResourceBytes);
 }
 
+void CacheManager::frameCompleted(bool missedDeadline) {
+    if (!mGrContext) {
+        return;
+    }
+    int cacheResources = 0;
+    size_t cacheBytesUsed = 0;
+    mGrContext->getResourceCacheUsage(&cacheResources, &cacheBytesUsed);
+    NativeMemoryStats::Set(NativeMemoryCategory::kHwuiGpuResourceCache, cacheBytesUsed,
+                           cacheResources);
+    if (!Properties::enableAdaptiveCacheBudget) {
+        return;
+    }
+    if (mBudgetController.frameCompleted(missedDeadline, cacheBytesUsed,
+                                         systemTime(SYSTEM_TIME_MONOTONIC))) {
+        applyCacheBudget();
+    }
+}
+
+void CacheManager::onMemoryPressure() {
+    if (!Properties::enableAdaptiveCacheBudget || !mGrContext) {
+        return;
+    }
+    if (mBudgetController.onMemoryPressure(systemTime(SYSTEM_TIME_MONOTONIC))) {
+        applyCacheBudget();
+    }
+}
+
 class CacheManager::SkiaTaskProcessor : public TaskProcessor<bool>, public SkExecutor {
 public:
     explicit SkiaTaskProcessor(TaskManager* taskManager) : TaskProcessor<bool>(taskManager) {}
@@ -145,9 +188,17 @@ void CacheManager::trimMemory(TrimMemoryMode mode) {
 
     mGrContext->flush();
 
+    // A budget grown for the foreground UI isn't worth keeping once it's hidden
+    if (mBudgetController.resetToBase(systemTime(SYSTEM_TIME_MONOTONIC))) {
+        applyCacheBudget();
+    }
+
     switch (mode) {
         case TrimMemoryMode::Complete:
-            mVectorDrawableAtlas = new skiapipeline::VectorDrawableAtlas(mMaxSurfaceArea / 2);
+            mVectorDrawableAtlas = new skiapipeline::VectorDrawableAtlas(
+                    mMaxSurfaceArea * VD_ATLAS_INITIAL_AREA_RATIO,
+                    skiapipeline::VectorDrawableAtlas::StorageMode::allowSharedSurface,
+                    mMaxSurfaceArea);
             mGrContext->freeGpuResources();
             break;
         case TrimMemoryMode::UiHidden:
@@ -207,10 +258,28 @@ void CacheManager::dumpMemoryUsage(String8& log, const RenderState* renderState)
 
     log.appendFormat("Other Caches:\n");
     log.appendFormat("                         Current / Maximum\n");
-    log.appendFormat("  VectorDrawableAtlas  %6.2f kB / %6.2f KB (entries = %zu)\n", 0.0f, 0.0f,
-                     (size_t)0);
+    skiapipeline::VectorDrawableAtlas::Stats vdAtlas = mVectorDrawableAtlas->getStats();
+    log.appendFormat("  VectorDrawableAtlas  %6.2f kB / %6.2f KB (entries = %zu)\n",
+                     vdAtlas.surfaceArea * 4 / 1024.0f, vdAtlas.maxSurfaceArea * 4 / 1024.0f,
+                     vdAtlas.entries);
+    log.appendFormat("    Fallback surfaces  %6.2f kB (count = %zu, created = %" PRIu64
+                     ", grown = %u, repacked = %u)\n",
+                     vdAtlas.fallbackArea * 4 / 1024.0f, vdAtlas.fallbackSurfaces,
+                     vdAtlas.fallbackSurfacesCreated, vdAtlas.growCount, vdAtlas.repackCount);
+    skiapipeline::ShaderCache::get().dumpMemoryUsage(log);
+    if (Properties::enableAdaptiveCacheBudget) {
+        mBudgetController.dump(log, systemTime(SYSTEM_TIME_MONOTONIC));
+    }
+    LinearAllocator::PagePoolStats pagePool = LinearAllocator::getPagePoolStats();
+    log.appendFormat("  RecordingPagePool    %6.2f kB / %6.2f KB (reused = %" PRIu64
+                     ", allocated = %" PRIu64 ")\n",
+                     pagePool.pooledBytes / 1024.0f, pagePool.capacity / 1024.0f,
+                     pagePool.reusedPages, pagePool.allocatedPages);
 
     if (renderState) {
+        if (renderState->mLayerPool) {
+            renderState->mLayerPool->dumpMemoryUsage(log);
+        }
         if (renderState->mActiveLayers.size() > 0) {
             log.appendFormat("  Layer Info:\n");
         }
@@ -23,6 +23,7 @@
 #include <utils/String8.h>
 #include <vector>
 
+#include "CacheBudgetController.h"
 #include "pipeline/skia/VectorDrawableAtlas.h"
 #include "thread/TaskManager.h"
 #include "thread/TaskProcessor.h"
@@ -47,6 +48,13 @@ public:
     void configureContext(GrContextOptions* context);
     void trimMemory(TrimMemoryMode mode);
     void trimStaleResources();
+
+    /**
+     * Lets the adaptive resource cache budget, if enabled, grow when frames miss their deadline
+     * with a full cache, and shrink on memory pressure below the trimMemory() levels.
+     */
+    void frameCompleted(bool missedDeadline);
+    void onMemoryPressure();
     void dumpMemoryUsage(String8& log, const RenderState* renderState = nullptr);
 
     sp<skiapipeline::VectorDrawableAtlas> acquireVectorDrawableAtlas();
@@ -64,6 +72,7 @@ private:
     void reset(sk_sp<GrContext> grContext);
     void destroy();
     void updateContextCacheSizes();
+    void applyCacheBudget();
 
     const size_t mMaxSurfaceArea;
     sk_sp<GrContext> mGrContext;
@@ -71,6 +80,7 @@ private:
     int mMaxResources = 0;
     size_t mMaxResourceBytes = 0;
     size_t mBackgroundResourceBytes = 0;
+    CacheBudgetController mBudgetController;
 
     struct PipelineProps {
         const void* pipelineKey = nullptr;
@@ -25,6 +25,7 @@
 #include "OpenGLPipeline.h"
 #include "Properties.h"
 #include "RenderThread.h"
+#include "hwui/AnimatedImageFramePool.h"
 #include "hwui/Canvas.h"
 #include "pipeline/skia/SkiaOpenGLPipeline.h"
 #include "pipeline/skia/SkiaPipeline.h"
@@ -33,6 +34,7 @@
 #include "renderstate/RenderState.h"
 #include "renderstate/Stencil.h"
 #include "utils/GLUtils.h"
+#include "utils/LinearAllocator.h"
 #include "utils/TimeUtils.h"
 #include "../Properties.h"
 
@@ -50,6 +52,7 @@
 
 #define TRIM_MEMORY_COMPLETE 80
 #define TRIM_MEMORY_UI_HIDDEN 20
+#define TRIM_MEMORY_RUNNING_LOW 10
 
 #define ENABLE_RENDERNODE_SERIALIZATION false
 
@@ -340,6 +343,11 @@ void CanvasContext::prepareTree(TreeInfo& info, int64_t* uiFrameInfo, int64_t sy
     freePrefetchedLayers();
     GL_CHECKPOINT(MODERATE);
 
+    mCurrentFrameInfo->set(FrameInfoIndex::AnimatedImageDecodeDuration) =
+            info.out.animatedImageDecodeDuration;
+    mCurrentFrameInfo->set(FrameInfoIndex::AnimatedImageLateFrames) =
+            info.out.animatedImageLateFrames;
+
     mIsDirty = true;
 
     if (CC_UNLIKELY(!mNativeSurface.get())) {
@@ -390,6 +398,10 @@ void CanvasContext::prepareTree(TreeInfo& info, int64_t* uiFrameInfo, int64_t sy
         info.out.canDrawThisFrame = false;
     }
 
+    if (CC_UNLIKELY(Properties::enableDeadlineScheduling) && info.out.canDrawThisFrame) {
+        info.out.canDrawThisFrame = !shouldSkipForDeadline();
+    }
+
     if (!info.out.canDrawThisFrame) {
         mCurrentFrameInfo->addFlag(FrameInfoFlags::SkippedFrame);
     }
@@ -425,6 +437,25 @@ void CanvasContext::prepareTree(TreeInfo& info, int64_t* uiFrameInfo, int64_t sy
     }
 }
 
+bool CanvasContext::shouldSkipForDeadline() {
+    // Only RenderThread animation frames are skipped, the frame callback posted for the skipped
+    // frame draws the animations at the next vsync. Never skip two frames in a row.
+    bool skip = false;
+    if (!mSkippedForDeadline &&
+        ((*mCurrentFrameInfo)[FrameInfoIndex::Flags] & FrameInfoFlags::RTAnimation)) {
+        FrameDeadlinePredictor& predictor = mRenderThread.deadlinePredictor();
+        nsecs_t now = systemTime(CLOCK_MONOTONIC);
+        skip = predictor.isUnderPressure(now) &&
+               predictor.expectsDeadlineMiss((*mCurrentFrameInfo)[FrameInfoIndex::IntendedVsync],
+                                             now);
+    }
+    if (skip) {
+        ATRACE_NAME("deadline miss expected, skipping frame");
+    }
+    mSkippedForDeadline = skip;
+    return skip;
+}
+
 void CanvasContext::stopDrawing() {
     mRenderThread.removeFrameCallback(this);
     mAnimationContext->pauseAnimators();
@@ -447,15 +478,27 @@ void CanvasContext::draw() {
     //    }
 
     mCurrentFrameInfo->markIssueDrawCommandsStart();
+    // only pipelines that track frame pacing fill these in
+    mCurrentFrameInfo->set(FrameInfoIndex::GpuWaitDuration) = 0;
+    mCurrentFrameInfo->set(FrameInfoIndex::FramesInFlight) = 0;
 
     Frame frame = mRenderPipeline->getFrame();
 
     SkRect windowDirty = computeDirtyRect(frame, &dirty);
 
+    RenderNodeGpuProfiler* gpuProfiler = getGpuProfiler();
+    if (CC_UNLIKELY(gpuProfiler)) {
+        gpuProfiler->beginFrame(getFrameNumber());
+    }
+
     bool drew = mRenderPipeline->draw(frame, windowDirty, dirty, mLightGeometry, &mLayerUpdateQueue,
                                       mContentDrawBounds, mOpaque, mWideColorGamut, mLightInfo,
                                       mRenderNodes, &(profiler()));
 
+    if (CC_UNLIKELY(gpuProfiler)) {
+        gpuProfiler->endFrame();
+    }
+
     int64_t frameCompleteNr = mFrameCompleteCallbacks.size() ? getFrameNumber() : -1;
 
     waitOnFences();
@@ -526,9 +569,19 @@ void CanvasContext::draw() {
     }
 
     mJankTracker.finishFrame(*mCurrentFrameInfo);
+    mRenderThread.deadlinePredictor().frameCompleted(*mCurrentFrameInfo);
+    mRenderThread.cacheManager().frameCompleted(mCurrentFrameInfo->totalDuration() >
+                                                mRenderThread.timeLord().frameIntervalNanos());
     if (CC_UNLIKELY(mFrameMetricsReporter.get() != nullptr)) {
         mFrameMetricsReporter->reportFrameMetrics(mCurrentFrameInfo->data());
     }
+    if (CC_UNLIKELY(gpuProfiler)) {
+        std::vector<RenderNodeGpuTime> nodeTimes;
+        gpuProfiler->collectResults(&nodeTimes);
+        if (!nodeTimes.empty()) {
+            mFrameMetricsReporter->reportRenderNodeGpuTimes(nodeTimes);
+        }
+    }
 
     GpuMemoryTracker::onFrameCompleted();
 #ifdef BUGREPORT_FONT_CACHE_USAGE
@@ -540,6 +593,23 @@ void CanvasContext::draw() {
 #endif
 }
 
+RenderNodeGpuProfiler* CanvasContext::getGpuProfiler() {
+    if (CC_LIKELY(!Properties::profileRenderNodeGpu || !mFrameMetricsReporter)) {
+        mGpuProfiler.reset();
+        return nullptr;
+    }
+    if (!mGpuProfiler && !mGpuProfilerUnsupported) {
+        // Vulkan command buffers are recorded by Skia, there is no place to write timestamps
+        auto renderType = Properties::getRenderPipelineType();
+        if (renderType == RenderPipelineType::OpenGL ||
+            renderType == RenderPipelineType::SkiaGL) {
+            mGpuProfiler = RenderNodeGpuProfiler::create();
+        }
+        mGpuProfilerUnsupported = !mGpuProfiler;
+    }
+    return mGpuProfiler.get();
+}
+
 // Called by choreographer to do an RT-driven animation
 void CanvasContext::doFrame() {
     if (!mRenderPipeline->isSurfaceReady()) return;
@@ -622,6 +692,11 @@ void CanvasContext::destroyHardwareResources() {
 }
 
 void CanvasContext::trimMemory(RenderThread& thread, int level) {
+    // Recording pages are pooled per process, not per context, drop them in either pipeline
+    if (level >= TRIM_MEMORY_UI_HIDDEN) {
+        LinearAllocator::trimPagePool();
+        AnimatedImageFramePool::get().trim();
+    }
     auto renderType = Properties::getRenderPipelineType();
     switch (renderType) {
         case RenderPipelineType::OpenGL: {
@@ -647,6 +722,8 @@ void CanvasContext::trimMemory(RenderThread& thread, int level) {
                 thread.vulkanManager().destroy();
             } else if (level >= TRIM_MEMORY_UI_HIDDEN) {
                 thread.cacheManager().trimMemory(CacheManager::TrimMemoryMode::UiHidden);
+            } else if (level >= TRIM_MEMORY_RUNNING_LOW) {
+                thread.cacheManager().onMemoryPressure();
             }
             break;
         }
@@ -669,6 +746,10 @@ void CanvasContext::resetFrameStats() {
     mJankTracker.reset();
 }
 
+void CanvasContext::setFrameStatsRing(int ashmemfd) {
+    mJankTracker.setFrameStatsRing(ashmemfd);
+}
+
 void CanvasContext::setName(const std::string&& name) {
     mJankTracker.setDescription(JankTrackerType::Window, std::move(name));
 }
@@ -27,6 +27,7 @@
 #include "IRenderPipeline.h"
 #include "LayerUpdateQueue.h"
 #include "RenderNode.h"
+#include "RenderNodeGpuProfiler.h"
 #include "renderthread/RenderTask.h"
 #include "renderthread/RenderThread.h"
 #include "thread/Task.h"
@@ -152,6 +153,7 @@ public:
 
     void dumpFrames(int fd);
     void resetFrameStats();
+    void setFrameStatsRing(int ashmemfd);
 
     void setName(const std::string&& name);
 
@@ -206,6 +208,7 @@ private:
     void freePrefetchedLayers();
 
     bool isSwapChainStuffed();
+    bool shouldSkipForDeadline();
 
     SkRect computeDirtyRect(const Frame& frame, SkRect* dirty);
 
@@ -237,6 +240,8 @@ private:
 
     // last vsync for a dropped frame due to stuffed queue
     nsecs_t mLastDropVsync = 0;
+    // true if the last frame was skipped because it was expected to miss its deadline
+    bool mSkippedForDeadline = false;
 
     bool mOpaque;
     bool mWideColorGamut = false;
@@ -256,6 +261,11 @@ private:
     FrameInfoVisualizer mProfiler;
     std::unique_ptr<FrameMetricsReporter> mFrameMetricsReporter;
 
+    // Returns the profiler timing the RenderNodes of this frame, if enabled and supported
+    RenderNodeGpuProfiler* getGpuProfiler();
+    std::unique_ptr<RenderNodeGpuProfiler> mGpuProfiler;
+    bool mGpuProfilerUnsupported = false;
+
     std::set<RenderNode*> mPrefetchedLayers;
 
     // Stores the bounds of the main content.
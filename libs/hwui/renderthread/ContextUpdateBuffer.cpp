@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ContextUpdateBuffer.h"
+
+#include "CanvasContext.h"
+
+#include <utils/Trace.h>
+
+namespace android {
+namespace uirenderer {
+namespace renderthread {
+
+void ContextUpdateBuffer::apply(CanvasContext& context) {
+    if (!mDirty) return;
+    ATRACE_NAME("applyContextUpdates");
+    if (mDirty & kLightInfo) {
+        context.setup(mLightRadius, mAmbientShadowAlpha, mSpotShadowAlpha);
+    }
+    if (mDirty & kLightCenter) {
+        context.setLightCenter(mLightCenter);
+    }
+    if (mDirty & kOpaque) {
+        context.setOpaque(mOpaque);
+    }
+    if (mDirty & kWideGamut) {
+        context.setWideGamut(mWideGamut);
+    }
+    mDirty = 0;
+}
+
+} /* namespace renderthread */
+} /* namespace uirenderer */
+} /* namespace android */
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Vector.h"
+
+#include <stdint.h>
+
+namespace android {
+namespace uirenderer {
+namespace renderthread {
+
+class CanvasContext;
+
+/**
+ * Holds the CanvasContext properties RenderProxy has set since they were last applied, so that
+ * setting them doesn't post a task to the RenderThread each. Setters overwrite earlier pending
+ * values, only the latest value of each property is applied.
+ *
+ * Not locked: the buffer is written by the UI thread and only read by the RenderThread while the
+ * UI thread is blocked on it, as in DrawFrameTask::run(), or after being moved into a task.
+ */
+class ContextUpdateBuffer {
+public:
+    void setup(float lightRadius, uint8_t ambientShadowAlpha, uint8_t spotShadowAlpha) {
+        mLightRadius = lightRadius;
+        mAmbientShadowAlpha = ambientShadowAlpha;
+        mSpotShadowAlpha = spotShadowAlpha;
+        mDirty |= kLightInfo;
+    }
+
+    void setLightCenter(const Vector3& lightCenter) {
+        mLightCenter = lightCenter;
+        mDirty |= kLightCenter;
+    }
+
+    void setOpaque(bool opaque) {
+        mOpaque = opaque;
+        mDirty |= kOpaque;
+    }
+
+    void setWideGamut(bool wideGamut) {
+        mWideGamut = wideGamut;
+        mDirty |= kWideGamut;
+    }
+
+    bool isEmpty() const { return !mDirty; }
+
+    /**
+     * Returns the pending updates and clears them, for handing them over to a posted task.
+     */
+    ContextUpdateBuffer take() {
+        ContextUpdateBuffer updates = *this;
+        mDirty = 0;
+        return updates;
+    }
+
+    /**
+     * Sets the pending properties on context and clears them. Must run on the RenderThread.
+     */
+    void apply(CanvasContext& context);
+
+private:
+    enum {
+        kLightInfo = 1 << 0,
+        kLightCenter = 1 << 1,
+        kOpaque = 1 << 2,
+        kWideGamut = 1 << 3,
+    };
+
+    uint32_t mDirty = 0;
+    float mLightRadius = 0;
+    uint8_t mAmbientShadowAlpha = 0;
+    uint8_t mSpotShadowAlpha = 0;
+    Vector3 mLightCenter = {0, 0, 0};
+    bool mOpaque = false;
+    bool mWideGamut = false;
+};
+
+} /* namespace renderthread */
+} /* namespace uirenderer */
+} /* namespace android */
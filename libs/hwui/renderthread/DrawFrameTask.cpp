@@ -16,6 +16,7 @@
 
 #include "DrawFrameTask.h"
 
+#include <android/util/ScopeTimer.h>
 #include <utils/Log.h>
 #include <utils/Trace.h>
 
@@ -83,6 +84,9 @@ void DrawFrameTask::postAndWait() {
 
 void DrawFrameTask::run() {
     ATRACE_NAME("DrawFrame");
+    SCOPE_TIMER("hwui.DrawFrame");
+
+    mPendingUpdates.apply(*mContext);
 
     bool canUnblockUiThread;
     bool canDrawThisFrame;
@@ -22,6 +22,7 @@
 #include <utils/Mutex.h>
 #include <utils/StrongPointer.h>
 
+#include "ContextUpdateBuffer.h"
 #include "RenderTask.h"
 
 #include "../FrameInfo.h"
@@ -66,6 +67,9 @@ public:
         mContentDrawBounds.set(left, top, right, bottom);
     }
 
+    // Applied to the context at the start of the next frame, see ContextUpdateBuffer
+    ContextUpdateBuffer& pendingUpdates() { return mPendingUpdates; }
+
     void pushLayerUpdate(DeferredLayerUpdater* layer);
     void removeLayerUpdate(DeferredLayerUpdater* layer);
 
@@ -95,6 +99,7 @@ private:
     CanvasContext* mContext;
     RenderNode* mTargetNode = nullptr;
     Rect mContentDrawBounds;
+    ContextUpdateBuffer mPendingUpdates;
 
     /*********************************************
      *  Single frame data
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameDeadlinePredictor.h"
+
+#include "FrameInfo.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace android {
+namespace uirenderer {
+namespace renderthread {
+
+// Under pressure when this many of the last PRESSURE_WINDOW frames missed their deadline
+#define PRESSURE_WINDOW 4
+#define PRESSURE_MISSED_DEADLINES 2
+
+// Frames that completed more than this many frame intervals ago don't count, the thread
+// was idle since
+#define PRESSURE_TIMEOUT_FRAMES 8
+
+void FrameDeadlinePredictor::frameCompleted(const FrameInfo& frame) {
+    nsecs_t duration = frame.duration(FrameInfoIndex::SyncStart, FrameInfoIndex::FrameCompleted);
+    if (duration <= 0) {
+        return;
+    }
+    // A very long frame, which is most likely a stall, shouldn't dominate the model
+    duration = std::min(duration, 4 * mFrameIntervalNanos);
+    if (!mAverageDuration) {
+        mAverageDuration = duration;
+        mAverageDeviation = duration / 2;
+    } else {
+        // Same smoothing as the TCP round trip time estimator
+        nsecs_t error = duration - mAverageDuration;
+        mAverageDuration += error / 8;
+        mAverageDeviation += (std::abs(error) - mAverageDeviation) / 4;
+    }
+
+    bool missedDeadline = frame.totalDuration() > mFrameIntervalNanos;
+    mMissedDeadlines = (mMissedDeadlines << 1) | (missedDeadline ? 1 : 0);
+    mLastFrameCompleted = frame[FrameInfoIndex::FrameCompleted];
+}
+
+bool FrameDeadlinePredictor::expectsDeadlineMiss(nsecs_t intendedVsync, nsecs_t now) const {
+    return mAverageDuration && now + predictedDurationNanos() > intendedVsync + mFrameIntervalNanos;
+}
+
+bool FrameDeadlinePredictor::isUnderPressure(nsecs_t now) const {
+    if (now - mLastFrameCompleted > PRESSURE_TIMEOUT_FRAMES * mFrameIntervalNanos) {
+        return false;
+    }
+    uint32_t recentMisses = mMissedDeadlines & ((1u << PRESSURE_WINDOW) - 1);
+    return __builtin_popcount(recentMisses) >= PRESSURE_MISSED_DEADLINES;
+}
+
+void FrameDeadlinePredictor::reset() {
+    mAverageDuration = 0;
+    mAverageDeviation = 0;
+    mLastFrameCompleted = 0;
+    mMissedDeadlines = 0;
+}
+
+} /* namespace renderthread */
+} /* namespace uirenderer */
+} /* namespace android */
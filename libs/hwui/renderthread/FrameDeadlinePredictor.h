@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <utils/Timers.h>
+
+#include <cstdint>
+
+namespace android {
+namespace uirenderer {
+
+class FrameInfo;
+
+namespace renderthread {
+
+/**
+ * FrameDeadlinePredictor keeps a model of the duration of the recent RenderThread frames, from
+ * the start of the sync to the completion of the frame, and of the deadlines they missed. It is
+ * fed the same FrameInfo as the JankTracker, which uses the same definition of a missed deadline.
+ *
+ * The RenderThread uses it to skip frames that are expected to miss their deadline when frames
+ * are already late, instead of stacking late frames, and to postpone work the next frame doesn't
+ * need.
+ */
+class FrameDeadlinePredictor {
+public:
+    void setFrameInterval(nsecs_t frameIntervalNanos) { mFrameIntervalNanos = frameIntervalNanos; }
+
+    void frameCompleted(const FrameInfo& frame);
+
+    /**
+     * Returns the expected RenderThread duration of the next frame, the average duration plus
+     * the average deviation from it.
+     */
+    nsecs_t predictedDurationNanos() const { return mAverageDuration + mAverageDeviation; }
+
+    /**
+     * Returns true if a frame for "intendedVsync" starting its RenderThread work at "now" is
+     * expected to complete after its deadline.
+     */
+    bool expectsDeadlineMiss(nsecs_t intendedVsync, nsecs_t now) const;
+
+    /**
+     * Returns true if several of the recent frames missed their deadline. Frames completed long
+     * before "now" aren't considered.
+     */
+    bool isUnderPressure(nsecs_t now) const;
+
+    void reset();
+
+private:
+    nsecs_t mFrameIntervalNanos = 16666667;
+    nsecs_t mAverageDuration = 0;
+    nsecs_t mAverageDeviation = 0;
+    nsecs_t mLastFrameCompleted = 0;
+    // one bit per recent frame, the lowest for the latest, set if the frame missed its deadline
+    uint32_t mMissedDeadlines = 0;
+};
+
+} /* namespace renderthread */
+} /* namespace uirenderer */
+} /* namespace android */
@@ -110,6 +110,12 @@ bool OpenGLPipeline::swapBuffers(const Frame& frame, bool drew, const SkRect& sc
         return false;
     }
 
+    if (drew) {
+        // after the swap, so that refilling the layer pool doesn't delay the frame
+        RenderState& renderState = mRenderThread.renderState();
+        renderState.layerPool().endFrame(renderState);
+    }
+
     return *requireSwap;
 }
 
@@ -83,8 +83,12 @@ void RenderProxy::setName(const char* name) {
 }
 
 void RenderProxy::initialize(const sp<Surface>& surface) {
+    // The surface is set up according to opaque and wide gamut, hand pending updates over
     mRenderThread.queue().post(
-            [ this, surf = surface ]() mutable { mContext->setSurface(std::move(surf)); });
+            [ this, surf = surface, updates = mDrawFrameTask.pendingUpdates().take() ]() mutable {
+                updates.apply(*mContext);
+                mContext->setSurface(std::move(surf));
+            });
 }
 
 void RenderProxy::allocateBuffers(const sp<Surface>& surface) {
@@ -94,7 +98,10 @@ void RenderProxy::allocateBuffers(const sp<Surface>& surface) {
 
 void RenderProxy::updateSurface(const sp<Surface>& surface) {
     mRenderThread.queue().post(
-            [ this, surf = surface ]() mutable { mContext->setSurface(std::move(surf)); });
+            [ this, surf = surface, updates = mDrawFrameTask.pendingUpdates().take() ]() mutable {
+                updates.apply(*mContext);
+                mContext->setSurface(std::move(surf));
+            });
 }
 
 bool RenderProxy::pauseSurface(const sp<Surface>& surface) {
@@ -106,20 +113,19 @@ void RenderProxy::setStopped(bool stopped) {
 }
 
 void RenderProxy::setup(float lightRadius, uint8_t ambientShadowAlpha, uint8_t spotShadowAlpha) {
-    mRenderThread.queue().post(
-            [=]() { mContext->setup(lightRadius, ambientShadowAlpha, spotShadowAlpha); });
+    mDrawFrameTask.pendingUpdates().setup(lightRadius, ambientShadowAlpha, spotShadowAlpha);
 }
 
 void RenderProxy::setLightCenter(const Vector3& lightCenter) {
-    mRenderThread.queue().post([=]() { mContext->setLightCenter(lightCenter); });
+    mDrawFrameTask.pendingUpdates().setLightCenter(lightCenter);
 }
 
 void RenderProxy::setOpaque(bool opaque) {
-    mRenderThread.queue().post([=]() { mContext->setOpaque(opaque); });
+    mDrawFrameTask.pendingUpdates().setOpaque(opaque);
 }
 
 void RenderProxy::setWideGamut(bool wideGamut) {
-    mRenderThread.queue().post([=]() { mContext->setWideGamut(wideGamut); });
+    mDrawFrameTask.pendingUpdates().setWideGamut(wideGamut);
 }
 
 int64_t* RenderProxy::frameInfo() {
@@ -158,7 +164,10 @@ DeferredLayerUpdater* RenderProxy::createTextureLayer() {
 }
 
 void RenderProxy::buildLayer(RenderNode* node) {
-    mRenderThread.queue().runSync([&]() { mContext->buildLayer(node); });
+    mRenderThread.queue().runSync([&]() {
+        mDrawFrameTask.pendingUpdates().apply(*mContext);
+        mContext->buildLayer(node);
+    });
 }
 
 bool RenderProxy::copyLayerInto(DeferredLayerUpdater* layer, SkBitmap& bitmap) {
@@ -237,6 +246,13 @@ uint32_t RenderProxy::frameTimePercentile(int percentile) {
     });
 }
 
+void RenderProxy::setFrameStatsRing(int fd) {
+    mRenderThread.queue().post([ this, fd = dup(fd) ]() {
+        mContext->setFrameStatsRing(fd);
+        close(fd);
+    });
+}
+
 void RenderProxy::dumpGraphicsMemory(int fd) {
     auto& thread = RenderThread::getInstance();
     thread.queue().runSync([&]() { thread.dumpGraphicsMemory(fd); });
@@ -268,7 +284,10 @@ void RenderProxy::removeRenderNode(RenderNode* node) {
 }
 
 void RenderProxy::drawRenderNode(RenderNode* node) {
-    mRenderThread.queue().runSync([=]() { mContext->prepareAndDraw(node); });
+    mRenderThread.queue().runSync([=]() {
+        mDrawFrameTask.pendingUpdates().apply(*mContext);
+        mContext->prepareAndDraw(node);
+    });
 }
 
 void RenderProxy::setContentDrawBounds(int left, int top, int right, int bottom) {
@@ -362,15 +381,24 @@ void RenderProxy::disableVsync() {
     Properties::disableVsync = true;
 }
 
+static void repackVectorDrawableAtlasWhenIdle(RenderThread& thread) {
+    // The context may be null if trimMemory executed, but then the atlas was deleted too.
+    if (thread.getGrContext() == nullptr) {
+        return;
+    }
+    if (Properties::enableDeadlineScheduling &&
+        thread.deadlinePredictor().isUnderPressure(systemTime(CLOCK_MONOTONIC))) {
+        // Frames are missing their deadline, try again after the next frame.
+        thread.queue().postDelayed(thread.timeLord().frameIntervalNanos(),
+                                   [&thread]() { repackVectorDrawableAtlasWhenIdle(thread); });
+        return;
+    }
+    thread.cacheManager().acquireVectorDrawableAtlas()->repackIfNeeded(thread.getGrContext());
+}
+
 void RenderProxy::repackVectorDrawableAtlas() {
     RenderThread& thread = RenderThread::getInstance();
-    thread.queue().post([&thread]() {
-        // The context may be null if trimMemory executed, but then the atlas was deleted too.
-        if (thread.getGrContext() != nullptr) {
-            thread.cacheManager().acquireVectorDrawableAtlas()->repackIfNeeded(
-                    thread.getGrContext());
-        }
-    });
+    thread.queue().post([&thread]() { repackVectorDrawableAtlasWhenIdle(thread); });
 }
 
 void RenderProxy::releaseVDAtlasEntries() {
@@ -104,6 +104,8 @@ public:
     // Not exported, only used for testing
     void resetProfileInfo();
     uint32_t frameTimePercentile(int p);
+    // Streams the FrameInfo of every frame into an ashmem ring, see FrameStatsRing.h
+    ANDROID_API void setFrameStatsRing(int fd);
     ANDROID_API static void dumpGraphicsMemory(int fd);
 
     ANDROID_API static void rotateProcessStatsBuffer();
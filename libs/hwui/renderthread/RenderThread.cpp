@@ -32,6 +32,7 @@
 #include "utils/FatVector.h"
 #include "utils/TimeUtils.h"
 
+#include <android/util/ScopeTimer.h>
 #include <gui/DisplayEventReceiver.h>
 #include <sys/resource.h>
 #include <utils/Condition.h>
@@ -164,6 +165,7 @@ void RenderThread::initThreadLocals() {
     mDisplayInfo = DeviceInfo::queryDisplayInfo();
     nsecs_t frameIntervalNanos = static_cast<nsecs_t>(1000000000 / mDisplayInfo.fps);
     mTimeLord.setFrameInterval(frameIntervalNanos);
+    mDeadlinePredictor.setFrameInterval(frameIntervalNanos);
     initializeDisplayEventReceiver();
     mEglManager = new EglManager(*this);
     mRenderState = new RenderState(*this);
@@ -205,6 +207,8 @@ void RenderThread::dumpGraphicsMemory(int fd) {
 
     dprintf(fd, "\n%s\n", cachesOutput.string());
     dprintf(fd, "\nPipeline=%s\n", pipeline.string());
+    dprintf(fd, "\n");
+    android::util::ScopeTimer::dump(fd);
 }
 
 Readback& RenderThread::readback() {
@@ -21,6 +21,7 @@
 
 #include "../JankTracker.h"
 #include "CacheManager.h"
+#include "FrameDeadlinePredictor.h"
 #include "TimeLord.h"
 #include "thread/ThreadBase.h"
 
@@ -87,6 +88,7 @@ public:
     void pushBackFrameCallback(IFrameCallback* callback);
 
     TimeLord& timeLord() { return mTimeLord; }
+    FrameDeadlinePredictor& deadlinePredictor() { return mDeadlinePredictor; }
     RenderState& renderState() const { return *mRenderState; }
     EglManager& eglManager() const { return *mEglManager; }
     ProfileDataContainer& globalProfileData() { return mGlobalProfileData; }
@@ -146,6 +148,7 @@ private:
     bool mFrameCallbackTaskPending;
 
     TimeLord mTimeLord;
+    FrameDeadlinePredictor mDeadlinePredictor;
     RenderState* mRenderState;
     EglManager* mEglManager;
 
@@ -41,11 +41,6 @@ void VulkanManager::destroy() {
 
     mRenderThread.renderState().onVkContextDestroyed();
     mRenderThread.setGrContext(nullptr);
-
-    if (VK_NULL_HANDLE != mCommandPool) {
-        mDestroyCommandPool(mBackendContext->fDevice, mCommandPool, nullptr);
-        mCommandPool = VK_NULL_HANDLE;
-    }
     mBackendContext.reset();
 }
 
@@ -78,7 +73,7 @@ void VulkanManager::initialize() {
     GET_DEV_PROC(DestroyCommandPool);
     GET_DEV_PROC(AllocateCommandBuffers);
     GET_DEV_PROC(FreeCommandBuffers);
-    GET_DEV_PROC(ResetCommandBuffer);
+    GET_DEV_PROC(ResetCommandPool);
     GET_DEV_PROC(BeginCommandBuffer);
     GET_DEV_PROC(EndCommandBuffer);
     GET_DEV_PROC(CmdPipelineBarrier);
@@ -92,19 +87,7 @@ void VulkanManager::initialize() {
     GET_DEV_PROC(DestroyFence);
     GET_DEV_PROC(WaitForFences);
     GET_DEV_PROC(ResetFences);
-
-    // create the command pool for the command buffers
-    if (VK_NULL_HANDLE == mCommandPool) {
-        VkCommandPoolCreateInfo commandPoolInfo;
-        memset(&commandPoolInfo, 0, sizeof(VkCommandPoolCreateInfo));
-        commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-        // this needs to be on the render queue
-        commandPoolInfo.queueFamilyIndex = mBackendContext->fGraphicsQueueIndex;
-        commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-        SkDEBUGCODE(VkResult res =) mCreateCommandPool(mBackendContext->fDevice, &commandPoolInfo,
-                                                       nullptr, &mCommandPool);
-        SkASSERT(VK_SUCCESS == res);
-    }
+    GET_DEV_PROC(GetFenceStatus);
 
     mGetDeviceQueue(mBackendContext->fDevice, mPresentQueueIndex, 0, &mPresentQueue);
 
@@ -123,68 +106,100 @@ void VulkanManager::initialize() {
     mRenderThread.renderState().onVkContextCreated();
 }
 
-// Returns the next BackbufferInfo to use for the next draw. The function will make sure all
-// previous uses have finished before returning.
-VulkanSurface::BackbufferInfo* VulkanManager::getAvailableBackbuffer(VulkanSurface* surface) {
+VulkanSurface::BackbufferInfo* VulkanManager::getAvailableBackbuffer(VulkanSurface* surface,
+                                                                     uint64_t timeout) {
     SkASSERT(surface->mBackbuffers);
 
-    ++surface->mCurrentBackbufferIndex;
-    if (surface->mCurrentBackbufferIndex > surface->mImageCount) {
-        surface->mCurrentBackbufferIndex = 0;
+    uint32_t index = surface->mCurrentBackbufferIndex + 1;
+    if (index >= surface->mBackbufferCount) {
+        index = 0;
     }
 
-    VulkanSurface::BackbufferInfo* backbuffer =
-            surface->mBackbuffers + surface->mCurrentBackbufferIndex;
+    VulkanSurface::BackbufferInfo* backbuffer = surface->mBackbuffers + index;
 
     // Before we reuse a backbuffer, make sure its fences have all signaled so that we can safely
-    // reuse its commands buffers.
+    // reuse its commands buffers. This is what bounds the number of frames in flight.
     VkResult res =
-            mWaitForFences(mBackendContext->fDevice, 2, backbuffer->mUsageFences, true, UINT64_MAX);
+            mWaitForFences(mBackendContext->fDevice, 2, backbuffer->mUsageFences, true, timeout);
     if (res != VK_SUCCESS) {
         return nullptr;
     }
 
+    surface->mCurrentBackbufferIndex = index;
     return backbuffer;
 }
 
-SkSurface* VulkanManager::getBackbufferSurface(VulkanSurface* surface) {
-    VulkanSurface::BackbufferInfo* backbuffer = getAvailableBackbuffer(surface);
-    SkASSERT(backbuffer);
-
-    VkResult res;
+void VulkanManager::tryAcquireNextImage(VulkanSurface* surface) {
+    VulkanSurface::BackbufferInfo* backbuffer = getAvailableBackbuffer(surface, 0);
+    if (!backbuffer) {
+        return;
+    }
+    VkResult res = mAcquireNextImageKHR(mBackendContext->fDevice, surface->mSwapchain, 0,
+                                        backbuffer->mAcquireSemaphore, VK_NULL_HANDLE,
+                                        &backbuffer->mImageIndex);
+    surface->mNextImageAcquired = VK_SUCCESS == res || VK_SUBOPTIMAL_KHR == res;
+}
 
-    res = mResetFences(mBackendContext->fDevice, 2, backbuffer->mUsageFences);
-    SkASSERT(VK_SUCCESS == res);
+uint32_t VulkanManager::countFramesInFlight(VulkanSurface* surface) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < surface->mBackbufferCount; ++i) {
+        if (VK_NOT_READY ==
+            mGetFenceStatus(mBackendContext->fDevice, surface->mBackbuffers[i].mUsageFences[1])) {
+            count++;
+        }
+    }
+    return count;
+}
 
-    // The acquire will signal the attached mAcquireSemaphore. We use this to know the image has
-    // finished presenting and that it is safe to begin sending new commands to the returned image.
-    res = mAcquireNextImageKHR(mBackendContext->fDevice, surface->mSwapchain, UINT64_MAX,
-                               backbuffer->mAcquireSemaphore, VK_NULL_HANDLE,
-                               &backbuffer->mImageIndex);
+SkSurface* VulkanManager::getBackbufferSurface(VulkanSurface* surface) {
+    const nsecs_t waitStart = systemTime(CLOCK_MONOTONIC);
+    surface->mLastFramesInFlight = countFramesInFlight(surface);
 
-    if (VK_ERROR_SURFACE_LOST_KHR == res) {
-        // need to figure out how to create a new vkSurface without the platformData*
-        // maybe use attach somehow? but need a Window
-        return nullptr;
-    }
-    if (VK_ERROR_OUT_OF_DATE_KHR == res) {
-        // tear swapchain down and try again
-        if (!createSwapchain(surface)) {
-            return nullptr;
-        }
-        backbuffer = getAvailableBackbuffer(surface);
-        res = mResetFences(mBackendContext->fDevice, 2, backbuffer->mUsageFences);
-        SkASSERT(VK_SUCCESS == res);
+    VulkanSurface::BackbufferInfo* backbuffer;
+    VkResult res;
+    if (surface->mNextImageAcquired) {
+        surface->mNextImageAcquired = false;
+        backbuffer = surface->mBackbuffers + surface->mCurrentBackbufferIndex;
+    } else {
+        backbuffer = getAvailableBackbuffer(surface, UINT64_MAX);
+        SkASSERT(backbuffer);
 
-        // acquire the image
+        // The acquire will signal the attached mAcquireSemaphore. We use this to know the image
+        // has finished presenting and that it is safe to begin sending new commands to the
+        // returned image.
         res = mAcquireNextImageKHR(mBackendContext->fDevice, surface->mSwapchain, UINT64_MAX,
                                    backbuffer->mAcquireSemaphore, VK_NULL_HANDLE,
                                    &backbuffer->mImageIndex);
 
-        if (VK_SUCCESS != res) {
+        if (VK_ERROR_SURFACE_LOST_KHR == res) {
+            // need to figure out how to create a new vkSurface without the platformData*
+            // maybe use attach somehow? but need a Window
             return nullptr;
         }
+        if (VK_ERROR_OUT_OF_DATE_KHR == res) {
+            // tear swapchain down and try again
+            if (!createSwapchain(surface)) {
+                return nullptr;
+            }
+            backbuffer = getAvailableBackbuffer(surface, UINT64_MAX);
+
+            // acquire the image
+            res = mAcquireNextImageKHR(mBackendContext->fDevice, surface->mSwapchain, UINT64_MAX,
+                                       backbuffer->mAcquireSemaphore, VK_NULL_HANDLE,
+                                       &backbuffer->mImageIndex);
+
+            if (VK_SUCCESS != res) {
+                return nullptr;
+            }
+        }
     }
+    surface->mLastGpuWaitDuration = systemTime(CLOCK_MONOTONIC) - waitStart;
+
+    // Only reset once an image is acquired, a failed non blocking acquire leaves the fences
+    // signaled for the next attempt.
+    res = mResetFences(mBackendContext->fDevice, 2, backbuffer->mUsageFences);
+    SkASSERT(VK_SUCCESS == res);
+    mResetCommandPool(mBackendContext->fDevice, backbuffer->mCommandPool, 0);
 
     // set up layout transfer from initial to color attachment
     VkImageLayout layout = surface->mImageInfos[backbuffer->mImageIndex].mImageLayout;
@@ -209,7 +224,6 @@ SkSurface* VulkanManager::getBackbufferSurface(VulkanSurface* surface) {
             surface->mImages[backbuffer->mImageIndex],  // image
             {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}     // subresourceRange
     };
-    mResetCommandBuffer(backbuffer->mTransitionCmdBuffers[0], 0);
 
     VkCommandBufferBeginInfo info;
     memset(&info, 0, sizeof(VkCommandBufferBeginInfo));
@@ -251,7 +265,7 @@ SkSurface* VulkanManager::getBackbufferSurface(VulkanSurface* surface) {
 
 void VulkanManager::destroyBuffers(VulkanSurface* surface) {
     if (surface->mBackbuffers) {
-        for (uint32_t i = 0; i < surface->mImageCount + 1; ++i) {
+        for (uint32_t i = 0; i < surface->mBackbufferCount; ++i) {
             mWaitForFences(mBackendContext->fDevice, 2, surface->mBackbuffers[i].mUsageFences, true,
                            UINT64_MAX);
             surface->mBackbuffers[i].mImageIndex = -1;
@@ -259,8 +273,10 @@ void VulkanManager::destroyBuffers(VulkanSurface* surface) {
                               nullptr);
             mDestroySemaphore(mBackendContext->fDevice, surface->mBackbuffers[i].mRenderSemaphore,
                               nullptr);
-            mFreeCommandBuffers(mBackendContext->fDevice, mCommandPool, 2,
-                                surface->mBackbuffers[i].mTransitionCmdBuffers);
+            mFreeCommandBuffers(mBackendContext->fDevice, surface->mBackbuffers[i].mCommandPool,
+                                2, surface->mBackbuffers[i].mTransitionCmdBuffers);
+            mDestroyCommandPool(mBackendContext->fDevice, surface->mBackbuffers[i].mCommandPool,
+                                nullptr);
             mDestroyFence(mBackendContext->fDevice, surface->mBackbuffers[i].mUsageFences[0], 0);
             mDestroyFence(mBackendContext->fDevice, surface->mBackbuffers[i].mUsageFences[1], 0);
         }
@@ -268,6 +284,8 @@ void VulkanManager::destroyBuffers(VulkanSurface* surface) {
 
     delete[] surface->mBackbuffers;
     surface->mBackbuffers = nullptr;
+    surface->mBackbufferCount = 0;
+    surface->mNextImageAcquired = false;
     delete[] surface->mImageInfos;
     surface->mImageInfos = nullptr;
     delete[] surface->mImages;
@@ -323,8 +341,6 @@ void VulkanManager::createBuffers(VulkanSurface* surface, VkFormat format, VkExt
                 mRenderThread.getGrContext(), backendRT, kTopLeft_GrSurfaceOrigin, nullptr, &props);
     }
 
-    SkASSERT(mCommandPool != VK_NULL_HANDLE);
-
     // set up the backbuffers
     VkSemaphoreCreateInfo semaphoreInfo;
     memset(&semaphoreInfo, 0, sizeof(VkSemaphoreCreateInfo));
@@ -335,7 +351,6 @@ void VulkanManager::createBuffers(VulkanSurface* surface, VkFormat format, VkExt
     memset(&commandBuffersInfo, 0, sizeof(VkCommandBufferAllocateInfo));
     commandBuffersInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     commandBuffersInfo.pNext = nullptr;
-    commandBuffersInfo.commandPool = mCommandPool;
     commandBuffersInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
     commandBuffersInfo.commandBufferCount = 2;
     VkFenceCreateInfo fenceInfo;
@@ -344,12 +359,23 @@ void VulkanManager::createBuffers(VulkanSurface* surface, VkFormat format, VkExt
     fenceInfo.pNext = nullptr;
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    // we create one additional backbuffer structure here, because we want to
-    // give the command buffers they contain a chance to finish before we cycle back
-    surface->mBackbuffers = new VulkanSurface::BackbufferInfo[surface->mImageCount + 1];
-    for (uint32_t i = 0; i < surface->mImageCount + 1; ++i) {
+    VkCommandPoolCreateInfo commandPoolInfo;
+    memset(&commandPoolInfo, 0, sizeof(VkCommandPoolCreateInfo));
+    commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    // this needs to be on the render queue
+    commandPoolInfo.queueFamilyIndex = mBackendContext->fGraphicsQueueIndex;
+    commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    // The RenderThread only waits on the GPU once it wraps around to a backbuffer whose commands
+    // haven't finished yet, so the number of backbuffers is the number of frames in flight.
+    surface->mBackbufferCount = Properties::vulkanFramesInFlight;
+    surface->mBackbuffers = new VulkanSurface::BackbufferInfo[surface->mBackbufferCount];
+    for (uint32_t i = 0; i < surface->mBackbufferCount; ++i) {
         SkDEBUGCODE(VkResult res);
         surface->mBackbuffers[i].mImageIndex = -1;
+        SkDEBUGCODE(res =) mCreateCommandPool(mBackendContext->fDevice, &commandPoolInfo, nullptr,
+                                              &surface->mBackbuffers[i].mCommandPool);
+        commandBuffersInfo.commandPool = surface->mBackbuffers[i].mCommandPool;
         SkDEBUGCODE(res =) mCreateSemaphore(mBackendContext->fDevice, &semaphoreInfo, nullptr,
                                             &surface->mBackbuffers[i].mAcquireSemaphore);
         SkDEBUGCODE(res =) mCreateSemaphore(mBackendContext->fDevice, &semaphoreInfo, nullptr,
@@ -362,7 +388,8 @@ void VulkanManager::createBuffers(VulkanSurface* surface, VkFormat format, VkExt
                                         &surface->mBackbuffers[i].mUsageFences[1]);
         SkASSERT(VK_SUCCESS == res);
     }
-    surface->mCurrentBackbufferIndex = surface->mImageCount;
+    surface->mCurrentBackbufferIndex = surface->mBackbufferCount - 1;
+    surface->mNextImageAcquired = false;
 }
 
 bool VulkanManager::createSwapchain(VulkanSurface* surface) {
@@ -635,7 +662,6 @@ void VulkanManager::swapBuffers(VulkanSurface* surface) {
             {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}     // subresourceRange
     };
 
-    mResetCommandBuffer(backbuffer->mTransitionCmdBuffers[1], 0);
     VkCommandBufferBeginInfo info;
     memset(&info, 0, sizeof(VkCommandBufferBeginInfo));
     info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -683,6 +709,10 @@ void VulkanManager::swapBuffers(VulkanSurface* surface) {
     surface->mImageInfos[backbuffer->mImageIndex].mLastUsed = surface->mCurrentTime;
     surface->mImageInfos[backbuffer->mImageIndex].mInvalid = false;
     surface->mCurrentTime++;
+
+    // Get the next image while the RenderThread is idle, rather than blocking on it at the start
+    // of the next frame.
+    tryAcquireNextImage(surface);
 }
 
 int VulkanManager::getAge(VulkanSurface* surface) {
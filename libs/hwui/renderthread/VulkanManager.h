@@ -18,6 +18,7 @@
 #define VULKANMANAGER_H
 
 #include <SkSurface.h>
+#include <utils/Timers.h>
 #include <vk/GrVkBackendContext.h>
 
 #include <vulkan/vulkan.h>
@@ -34,12 +35,19 @@ public:
 
     sk_sp<SkSurface> getBackBufferSurface() { return mBackbuffer; }
 
+    // Frame pacing counters for the last backbuffer returned by getBackbufferSurface
+    nsecs_t lastGpuWaitDuration() const { return mLastGpuWaitDuration; }
+    uint32_t lastFramesInFlight() const { return mLastFramesInFlight; }
+
 private:
     friend class VulkanManager;
     struct BackbufferInfo {
         uint32_t mImageIndex;           // image this is associated with
         VkSemaphore mAcquireSemaphore;  // we signal on this for acquisition of image
         VkSemaphore mRenderSemaphore;   // we wait on this for rendering to be done
+        // Every backbuffer records into its own pool, which is reset as a whole once the
+        // fences below have signaled.
+        VkCommandPool mCommandPool;
         VkCommandBuffer
                 mTransitionCmdBuffers[2];  // to transition layout between present and render
         // We use these fences to make sure the above Command buffers have finished their work
@@ -59,8 +67,15 @@ private:
     VkSurfaceKHR mVkSurface = VK_NULL_HANDLE;
     VkSwapchainKHR mSwapchain = VK_NULL_HANDLE;
 
+    // One backbuffer per frame in flight, see Properties::vulkanFramesInFlight
     BackbufferInfo* mBackbuffers = nullptr;
+    uint32_t mBackbufferCount = 0;
     uint32_t mCurrentBackbufferIndex;
+    // Set when swapBuffers already acquired the image for the next frame
+    bool mNextImageAcquired = false;
+
+    nsecs_t mLastGpuWaitDuration = 0;
+    uint32_t mLastFramesInFlight = 0;
 
     uint32_t mImageCount;
     VkImage* mImages = nullptr;
@@ -116,7 +131,17 @@ private:
     bool createSwapchain(VulkanSurface* surface);
     void createBuffers(VulkanSurface* surface, VkFormat format, VkExtent2D extent);
 
-    VulkanSurface::BackbufferInfo* getAvailableBackbuffer(VulkanSurface* surface);
+    // Returns the next backbuffer once the frame that last used it has finished on the GPU, or
+    // nullptr if that didn't happen within timeout.
+    VulkanSurface::BackbufferInfo* getAvailableBackbuffer(VulkanSurface* surface,
+                                                          uint64_t timeout);
+
+    // Acquires the next swapchain image into the next backbuffer without blocking, so that the
+    // following frame can start drawing right away. Failing is harmless, getBackbufferSurface
+    // then acquires the image itself.
+    void tryAcquireNextImage(VulkanSurface* surface);
+
+    uint32_t countFramesInFlight(VulkanSurface* surface);
 
     // simple wrapper class that exists only to initialize a pointer to NULL
     template <typename FNPTR_TYPE>
@@ -153,7 +178,7 @@ private:
     VkPtr<PFN_vkDestroyCommandPool> mDestroyCommandPool;
     VkPtr<PFN_vkAllocateCommandBuffers> mAllocateCommandBuffers;
     VkPtr<PFN_vkFreeCommandBuffers> mFreeCommandBuffers;
-    VkPtr<PFN_vkResetCommandBuffer> mResetCommandBuffer;
+    VkPtr<PFN_vkResetCommandPool> mResetCommandPool;
     VkPtr<PFN_vkBeginCommandBuffer> mBeginCommandBuffer;
     VkPtr<PFN_vkEndCommandBuffer> mEndCommandBuffer;
     VkPtr<PFN_vkCmdPipelineBarrier> mCmdPipelineBarrier;
@@ -169,13 +194,13 @@ private:
     VkPtr<PFN_vkDestroyFence> mDestroyFence;
     VkPtr<PFN_vkWaitForFences> mWaitForFences;
     VkPtr<PFN_vkResetFences> mResetFences;
+    VkPtr<PFN_vkGetFenceStatus> mGetFenceStatus;
 
     RenderThread& mRenderThread;
 
     sk_sp<const GrVkBackendContext> mBackendContext;
     uint32_t mPresentQueueIndex;
     VkQueue mPresentQueue = VK_NULL_HANDLE;
-    VkCommandPool mCommandPool = VK_NULL_HANDLE;
 
     enum class SwapBehavior {
         Discard,
@@ -19,12 +19,14 @@
 #include "JankTracker.h"
 #include "protos/graphicsstats.pb.h"
 
+#include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 #include <log/log.h>
 
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <memory>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -35,11 +37,53 @@ namespace uirenderer {
 
 using namespace google::protobuf;
 
-constexpr int32_t sCurrentFileVersion = 1;
+// Version 1 files are a serialized GraphicsStatsProto, they are still read and are converted
+// to the mapped layout the first time they are saved to.
+constexpr int32_t sProtoFileVersion = 1;
+constexpr int32_t sMappedFileVersion = 2;
 constexpr int32_t sHeaderSize = 4;
-static_assert(sizeof(sCurrentFileVersion) == sHeaderSize, "Header size is wrong");
+static_assert(sizeof(sMappedFileVersion) == sHeaderSize, "Header size is wrong");
 
 constexpr int sHistogramSize = ProfileData::HistogramSize();
+constexpr uint32_t sMaxPackageNameLength = 256;
+
+// The field number of GraphicsStatsServiceDumpProto.stats
+constexpr int sDumpStatsFieldNumber = 1;
+
+/*
+ * The layout of a version 2 file. It has a fixed size for a given histogram size, so
+ * saveBuffer() maps it and adds the new counts in place instead of parsing and rewriting
+ * the whole file. The counters are only updated with atomic operations, a dump reading
+ * the file concurrently sees every counter either before or after the add.
+ */
+struct MappedStatsHeader {
+    uint32_t version;
+    uint32_t histogramSize;
+    int64_t versionCode;
+    int64_t statsStart;
+    int64_t statsEnd;
+    uint32_t totalFrames;
+    uint32_t jankyFrames;
+    uint32_t missedVsyncCount;
+    uint32_t highInputLatencyCount;
+    uint32_t slowUiThreadCount;
+    uint32_t slowBitmapUploadCount;
+    uint32_t slowDrawCount;
+    uint32_t missedDeadlineCount;
+    uint32_t packageNameLength;
+    char packageName[sMaxPackageNameLength];
+};
+
+struct MappedStatsBucket {
+    uint32_t renderMillis;
+    uint32_t frameCount;
+};
+
+static_assert(sizeof(MappedStatsHeader) % alignof(MappedStatsBucket) == 0,
+              "Histogram buckets are misaligned");
+
+constexpr size_t sMappedFileSize =
+        sizeof(MappedStatsHeader) + sHistogramSize * sizeof(MappedStatsBucket);
 
 static bool mergeProfileDataIntoProto(protos::GraphicsStatsProto* proto,
                                       const std::string& package, int64_t versionCode,
@@ -103,6 +147,239 @@ private:
     io::CopyingOutputStreamAdaptor mImpl;
 };
 
+static inline uint32_t atomicLoad(const uint32_t* value) {
+    return __atomic_load_n(value, __ATOMIC_RELAXED);
+}
+
+static inline int64_t atomicLoad(const int64_t* value) {
+    return __atomic_load_n(value, __ATOMIC_RELAXED);
+}
+
+static inline void atomicAdd(uint32_t* value, uint32_t amount) {
+    if (amount) {
+        __atomic_fetch_add(value, amount, __ATOMIC_RELAXED);
+    }
+}
+
+static void atomicMin(int64_t* value, int64_t other) {
+    int64_t current = atomicLoad(value);
+    while ((current == 0 || current > other) &&
+           !__atomic_compare_exchange_n(value, &current, other, true, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED)) {
+    }
+}
+
+static void atomicMax(int64_t* value, int64_t other) {
+    int64_t current = atomicLoad(value);
+    while ((current == 0 || current < other) &&
+           !__atomic_compare_exchange_n(value, &current, other, true, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED)) {
+    }
+}
+
+static inline MappedStatsBucket* mappedBuckets(MappedStatsHeader* header) {
+    return reinterpret_cast<MappedStatsBucket*>(header + 1);
+}
+
+static bool isValidMappedFile(const MappedStatsHeader* header, size_t size) {
+    return size >= sizeof(MappedStatsHeader) && header->version == sMappedFileVersion &&
+           header->packageNameLength > 0 && header->packageNameLength <= sMaxPackageNameLength &&
+           size >= sizeof(MappedStatsHeader) + header->histogramSize * sizeof(MappedStatsBucket);
+}
+
+/*
+ * Converts a version 2 file to a proto, reusing the histogram buckets already allocated in
+ * the output when it is cleared and filled again, as it is for every file of a dump.
+ */
+static void mappedFileToProto(MappedStatsHeader* header, protos::GraphicsStatsProto* output) {
+    output->set_package_name(header->packageName, header->packageNameLength);
+    output->set_version_code(header->versionCode);
+    output->set_stats_start(atomicLoad(&header->statsStart));
+    output->set_stats_end(atomicLoad(&header->statsEnd));
+    auto summary = output->mutable_summary();
+    summary->set_total_frames(atomicLoad(&header->totalFrames));
+    summary->set_janky_frames(atomicLoad(&header->jankyFrames));
+    summary->set_missed_vsync_count(atomicLoad(&header->missedVsyncCount));
+    summary->set_high_input_latency_count(atomicLoad(&header->highInputLatencyCount));
+    summary->set_slow_ui_thread_count(atomicLoad(&header->slowUiThreadCount));
+    summary->set_slow_bitmap_upload_count(atomicLoad(&header->slowBitmapUploadCount));
+    summary->set_slow_draw_count(atomicLoad(&header->slowDrawCount));
+    summary->set_missed_deadline_count(atomicLoad(&header->missedDeadlineCount));
+    const MappedStatsBucket* buckets = mappedBuckets(header);
+    output->mutable_histogram()->Reserve(header->histogramSize);
+    for (uint32_t i = 0; i < header->histogramSize; i++) {
+        auto bucket = output->add_histogram();
+        bucket->set_render_millis(buckets[i].renderMillis);
+        bucket->set_frame_count(atomicLoad(&buckets[i].frameCount));
+    }
+}
+
+/*
+ * A read-write mapping of a version 2 file, map() fails for any other file so the caller can
+ * create or convert it.
+ */
+class MappedStatsFile {
+public:
+    MappedStatsFile() {}
+    ~MappedStatsFile() {
+        if (mHeader) {
+            munmap(mHeader, mSize);
+        }
+    }
+
+    bool map(const std::string& path) {
+        FileDescriptor fd{open(path.c_str(), O_RDWR)};
+        if (!fd.valid()) {
+            return false;
+        }
+        struct stat sb;
+        if (fstat(fd, &sb) || sb.st_size < (off_t)sizeof(MappedStatsHeader)) {
+            return false;
+        }
+        void* addr = mmap(nullptr, sb.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            int err = errno;
+            ALOGW("Failed to mmap '%s', errno=%d (%s)", path.c_str(), err, strerror(err));
+            return false;
+        }
+        auto header = reinterpret_cast<MappedStatsHeader*>(addr);
+        if (!isValidMappedFile(header, sb.st_size)) {
+            munmap(addr, sb.st_size);
+            return false;
+        }
+        mHeader = header;
+        mSize = sb.st_size;
+        return true;
+    }
+
+    bool merge(int64_t startTime, int64_t endTime, const ProfileData* data) {
+        if (mHeader->histogramSize != sHistogramSize) {
+            ALOGE("Histogram size mismatch, file is %u expected %d", mHeader->histogramSize,
+                  sHistogramSize);
+            return false;
+        }
+        // Check the buckets before adding anything so a mismatch leaves the file untouched
+        MappedStatsBucket* buckets = mappedBuckets(mHeader);
+        int index = 0;
+        bool hitMergeError = false;
+        data->histogramForEach([&](ProfileData::HistogramEntry entry) {
+            if (hitMergeError) return;
+            if (buckets[index].renderMillis != entry.renderTimeMs) {
+                ALOGW("Frame time mistmatch %u vs. %u", buckets[index].renderMillis,
+                      entry.renderTimeMs);
+                hitMergeError = true;
+            }
+            index++;
+        });
+        if (hitMergeError) {
+            return false;
+        }
+        atomicMin(&mHeader->statsStart, startTime);
+        atomicMax(&mHeader->statsEnd, endTime);
+        atomicAdd(&mHeader->totalFrames, data->totalFrameCount());
+        atomicAdd(&mHeader->jankyFrames, data->jankFrameCount());
+        atomicAdd(&mHeader->missedVsyncCount, data->jankTypeCount(kMissedVsync));
+        atomicAdd(&mHeader->highInputLatencyCount, data->jankTypeCount(kHighInputLatency));
+        atomicAdd(&mHeader->slowUiThreadCount, data->jankTypeCount(kSlowUI));
+        atomicAdd(&mHeader->slowBitmapUploadCount, data->jankTypeCount(kSlowSync));
+        atomicAdd(&mHeader->slowDrawCount, data->jankTypeCount(kSlowRT));
+        atomicAdd(&mHeader->missedDeadlineCount, data->jankTypeCount(kMissedDeadline));
+        index = 0;
+        data->histogramForEach([&](ProfileData::HistogramEntry entry) {
+            atomicAdd(&buckets[index++].frameCount, entry.frameCount);
+        });
+        return true;
+    }
+
+private:
+    MappedStatsHeader* mHeader = nullptr;
+    size_t mSize = 0;
+};
+
+/*
+ * Writes a version 2 file holding the stats of existing, if any, with the buckets of data.
+ * The file is written next to path and renamed over it, so a concurrent dump never maps a
+ * partially written file.
+ */
+static bool createMappedFile(const std::string& path, const protos::GraphicsStatsProto* existing,
+                             const std::string& package, int64_t versionCode,
+                             const ProfileData* data) {
+    if (package.empty() || package.size() > sMaxPackageNameLength) {
+        ALOGE("Invalid package name '%s'", package.c_str());
+        return false;
+    }
+    if (existing && existing->histogram_size() != sHistogramSize) {
+        ALOGE("Histogram size mismatch, proto is %d expected %d", existing->histogram_size(),
+              sHistogramSize);
+        return false;
+    }
+    std::unique_ptr<uint8_t[]> buffer(new uint8_t[sMappedFileSize]());
+    auto header = reinterpret_cast<MappedStatsHeader*>(buffer.get());
+    header->version = sMappedFileVersion;
+    header->histogramSize = sHistogramSize;
+    header->versionCode = versionCode;
+    header->packageNameLength = package.size();
+    memcpy(header->packageName, package.data(), package.size());
+    MappedStatsBucket* buckets = mappedBuckets(header);
+    int index = 0;
+    data->histogramForEach([&](ProfileData::HistogramEntry entry) {
+        buckets[index++].renderMillis = entry.renderTimeMs;
+    });
+    if (existing) {
+        header->statsStart = existing->stats_start();
+        header->statsEnd = existing->stats_end();
+        const auto& summary = existing->summary();
+        header->totalFrames = summary.total_frames();
+        header->jankyFrames = summary.janky_frames();
+        header->missedVsyncCount = summary.missed_vsync_count();
+        header->highInputLatencyCount = summary.high_input_latency_count();
+        header->slowUiThreadCount = summary.slow_ui_thread_count();
+        header->slowBitmapUploadCount = summary.slow_bitmap_upload_count();
+        header->slowDrawCount = summary.slow_draw_count();
+        header->missedDeadlineCount = summary.missed_deadline_count();
+        for (int i = 0; i < sHistogramSize; i++) {
+            const auto& bucket = existing->histogram(i);
+            if (bucket.render_millis() != static_cast<int32_t>(buckets[i].renderMillis)) {
+                ALOGW("Frame time mistmatch %d vs. %u", bucket.render_millis(),
+                      buckets[i].renderMillis);
+                return false;
+            }
+            buckets[i].frameCount = bucket.frame_count();
+        }
+    }
+
+    std::string tmpPath = path + ".tmp";
+    {
+        FileDescriptor outFd{open(tmpPath.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0660)};
+        if (!outFd.valid()) {
+            int err = errno;
+            ALOGW("Failed to open '%s', error=%d (%s)", tmpPath.c_str(), err, strerror(err));
+            return false;
+        }
+        const uint8_t* pos = buffer.get();
+        size_t remaining = sMappedFileSize;
+        while (remaining) {
+            ssize_t wrote = TEMP_FAILURE_RETRY(write(outFd, pos, remaining));
+            if (wrote <= 0) {
+                int err = errno;
+                ALOGW("Failed to write '%s', returned=%zd errno=%d (%s)", tmpPath.c_str(), wrote,
+                      err, strerror(err));
+                unlink(tmpPath.c_str());
+                return false;
+            }
+            pos += wrote;
+            remaining -= wrote;
+        }
+    }
+    if (rename(tmpPath.c_str(), path.c_str())) {
+        int err = errno;
+        ALOGW("Failed to rename '%s', errno=%d (%s)", tmpPath.c_str(), err, strerror(err));
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
 bool GraphicsStatsService::parseFromFile(const std::string& path,
                                          protos::GraphicsStatsProto* output) {
     FileDescriptor fd{open(path.c_str(), O_RDONLY)};
@@ -137,8 +414,21 @@ bool GraphicsStatsService::parseFromFile(const std::string& path,
         return false;
     }
     uint32_t file_version = *reinterpret_cast<uint32_t*>(addr);
-    if (file_version != sCurrentFileVersion) {
-        ALOGW("file_version mismatch! expected %d got %d", sCurrentFileVersion, file_version);
+    if (file_version == sMappedFileVersion) {
+        auto header = reinterpret_cast<MappedStatsHeader*>(addr);
+        bool valid = isValidMappedFile(header, sb.st_size);
+        if (valid) {
+            output->Clear();
+            mappedFileToProto(header, output);
+        } else {
+            ALOGW("Invalid mapped stats file '%s' (st_size %d)", path.c_str(), (int)sb.st_size);
+        }
+        munmap(addr, sb.st_size);
+        return valid;
+    }
+    if (file_version != sProtoFileVersion) {
+        ALOGW("file_version mismatch! expected %d or %d got %d", sProtoFileVersion,
+              sMappedFileVersion, file_version);
         munmap(addr, sb.st_size);
         return false;
     }
@@ -261,63 +551,57 @@ void dumpAsTextToFd(protos::GraphicsStatsProto* proto, int fd) {
 void GraphicsStatsService::saveBuffer(const std::string& path, const std::string& package,
                                       int64_t versionCode, int64_t startTime, int64_t endTime,
                                       const ProfileData* data) {
-    protos::GraphicsStatsProto statsProto;
-    if (!parseFromFile(path, &statsProto)) {
-        statsProto.Clear();
-    }
-    if (!mergeProfileDataIntoProto(&statsProto, package, versionCode, startTime, endTime, data)) {
-        return;
-    }
-    // Although we might not have read any data from the file, merging the existing data
-    // should always fully-initialize the proto
-    if (!statsProto.IsInitialized()) {
-        ALOGE("proto initialization error %s", statsProto.InitializationErrorString().c_str());
-        return;
-    }
-    if (statsProto.package_name().empty() || !statsProto.has_summary()) {
-        ALOGE("missing package_name() '%s' summary %d", statsProto.package_name().c_str(),
-              statsProto.has_summary());
-        return;
-    }
-    int outFd = open(path.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0660);
-    if (outFd <= 0) {
-        int err = errno;
-        ALOGW("Failed to open '%s', error=%d (%s)", path.c_str(), err, strerror(err));
-        return;
-    }
-    int wrote = write(outFd, &sCurrentFileVersion, sHeaderSize);
-    if (wrote != sHeaderSize) {
-        int err = errno;
-        ALOGW("Failed to write header to '%s', returned=%d errno=%d (%s)", path.c_str(), wrote, err,
-              strerror(err));
-        close(outFd);
-        return;
-    }
-    {
-        FileOutputStreamLite output(outFd);
-        bool success = statsProto.SerializeToZeroCopyStream(&output) && output.Flush();
-        if (output.GetErrno() != 0) {
-            ALOGW("Error writing to fd=%d, path='%s' err=%d (%s)", outFd, path.c_str(),
-                  output.GetErrno(), strerror(output.GetErrno()));
-            success = false;
-        } else if (!success) {
-            ALOGW("Serialize failed on '%s' unknown error", path.c_str());
+    MappedStatsFile file;
+    if (!file.map(path)) {
+        // Either a new file or a version 1 file which is converted, keeping its stats
+        protos::GraphicsStatsProto existing;
+        bool hasExisting = parseFromFile(path, &existing);
+        if (hasExisting && (!existing.IsInitialized() || !existing.has_summary())) {
+            ALOGW("Dropping invalid stats in '%s'", path.c_str());
+            hasExisting = false;
+        }
+        if (!createMappedFile(path, hasExisting ? &existing : nullptr, package, versionCode,
+                              data)) {
+            return;
+        }
+        if (!file.map(path)) {
+            ALOGW("Failed to map '%s' after creating it", path.c_str());
+            return;
         }
     }
-    close(outFd);
+    file.merge(startTime, endTime, data);
 }
 
+/*
+ * Writes each entry out as it is added instead of collecting a GraphicsStatsServiceDumpProto,
+ * the protobuf output is the same since a repeated field may be written one element at a time.
+ * A single GraphicsStatsProto is reused for every entry so its storage is only allocated once.
+ */
 class GraphicsStatsService::Dump {
 public:
-    Dump(int outFd, DumpType type) : mFd(outFd), mType(type) {}
+    Dump(int outFd, DumpType type) : mFd(outFd), mType(type), mStream(outFd) {}
     int fd() { return mFd; }
     DumpType type() { return mType; }
-    protos::GraphicsStatsServiceDumpProto& proto() { return mProto; }
+    protos::GraphicsStatsProto& stats() { return mStats; }
+
+    void writeStats() {
+        if (mType == DumpType::Protobuf) {
+            io::CodedOutputStream output(&mStream);
+            output.WriteTag(sDumpStatsFieldNumber << 3 | 2 /* WIRETYPE_LENGTH_DELIMITED */);
+            output.WriteVarint32(mStats.ByteSize());
+            mStats.SerializeWithCachedSizes(&output);
+        } else {
+            dumpAsTextToFd(&mStats, mFd);
+        }
+    }
+
+    void flush() { mStream.Flush(); }
 
 private:
     int mFd;
     DumpType mType;
-    protos::GraphicsStatsServiceDumpProto mProto;
+    FileOutputStreamLite mStream;
+    protos::GraphicsStatsProto mStats;
 };
 
 GraphicsStatsService::Dump* GraphicsStatsService::createDump(int outFd, DumpType type) {
@@ -327,7 +611,8 @@ GraphicsStatsService::Dump* GraphicsStatsService::createDump(int outFd, DumpType
 void GraphicsStatsService::addToDump(Dump* dump, const std::string& path,
                                      const std::string& package, int64_t versionCode,
                                      int64_t startTime, int64_t endTime, const ProfileData* data) {
-    protos::GraphicsStatsProto statsProto;
+    protos::GraphicsStatsProto& statsProto = dump->stats();
+    statsProto.Clear();
     if (!path.empty() && !parseFromFile(path, &statsProto)) {
         statsProto.Clear();
     }
@@ -340,31 +625,19 @@ void GraphicsStatsService::addToDump(Dump* dump, const std::string& path,
               path.empty() ? "<empty>" : path.c_str(), data);
         return;
     }
-
-    if (dump->type() == DumpType::Protobuf) {
-        dump->proto().add_stats()->CopyFrom(statsProto);
-    } else {
-        dumpAsTextToFd(&statsProto, dump->fd());
-    }
+    dump->writeStats();
 }
 
 void GraphicsStatsService::addToDump(Dump* dump, const std::string& path) {
-    protos::GraphicsStatsProto statsProto;
+    protos::GraphicsStatsProto& statsProto = dump->stats();
     if (!parseFromFile(path, &statsProto)) {
         return;
     }
-    if (dump->type() == DumpType::Protobuf) {
-        dump->proto().add_stats()->CopyFrom(statsProto);
-    } else {
-        dumpAsTextToFd(&statsProto, dump->fd());
-    }
+    dump->writeStats();
 }
 
 void GraphicsStatsService::finishDump(Dump* dump) {
-    if (dump->type() == DumpType::Protobuf) {
-        FileOutputStreamLite stream(dump->fd());
-        dump->proto().SerializeToZeroCopyStream(&stream);
-    }
+    dump->flush();
     delete dump;
 }
 
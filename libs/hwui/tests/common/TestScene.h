@@ -37,6 +37,8 @@ public:
     struct Options {
         int count = 0;
         int reportFrametimeWeight = 0;
+        // 0 for the runner's default
+        int warmupCount = 0;
         bool renderOffscreen = true;
     };
 
@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SceneStats.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+namespace android {
+namespace uirenderer {
+namespace test {
+
+void SceneStats::Recorder::notify(const int64_t* buffer) {
+    if (buffer[static_cast<int>(FrameInfoIndex::Flags)] & FrameInfoFlags::SkippedFrame) {
+        return;
+    }
+    FrameRecord frame;
+    std::copy(buffer, buffer + frame.size(), frame.begin());
+    std::lock_guard<std::mutex> lock(mLock);
+    mFrames.push_back(frame);
+}
+
+// The UI thread stages aren't there, the runner sets them all to the vsync
+const std::vector<SceneStats::Stage>& SceneStats::stages() {
+    static const std::vector<Stage> sStages = {
+            {"Total", FrameInfoIndex::IntendedVsync, FrameInfoIndex::FrameCompleted},
+            {"Sync", FrameInfoIndex::SyncStart, FrameInfoIndex::IssueDrawCommandsStart},
+            {"Draw", FrameInfoIndex::IssueDrawCommandsStart, FrameInfoIndex::SwapBuffers},
+            {"Swap", FrameInfoIndex::SwapBuffers, FrameInfoIndex::FrameCompleted},
+            {"DequeueBuffer", FrameInfoIndex::DequeueBufferDuration, FrameInfoIndex::NumIndexes},
+            {"QueueBuffer", FrameInfoIndex::QueueBufferDuration, FrameInfoIndex::NumIndexes},
+            {"GpuWait", FrameInfoIndex::GpuWaitDuration, FrameInfoIndex::NumIndexes},
+    };
+    return sStages;
+}
+
+double SceneStats::stageMs(const Stage& stage, const FrameRecord& frame) {
+    if (stage.end == FrameInfoIndex::NumIndexes) {
+        return frame[static_cast<int>(stage.start)] / 1000000.0;
+    }
+    FrameInfo info;
+    for (size_t i = 0; i < frame.size(); i++) {
+        info.set(static_cast<FrameInfoIndex>(i)) = frame[i];
+    }
+    return info.duration(stage.start, stage.end) / 1000000.0;
+}
+
+void SceneStats::addRun(const std::string& scene, const std::vector<FrameRecord>& frames) {
+    auto& runs = mRuns[scene];
+    if (runs.empty()) {
+        mScenes.push_back(scene);
+    }
+    runs.push_back(frames);
+}
+
+// nearest rank, |values| must be sorted
+static double percentile(const std::vector<double>& values, int p) {
+    if (values.empty()) return 0;
+    size_t rank = static_cast<size_t>(ceil(p / 100.0 * values.size()));
+    return values[rank > 0 ? rank - 1 : 0];
+}
+
+std::vector<SceneStats::Summary> SceneStats::summarize(const std::string& scene) const {
+    const auto& runs = mRuns.at(scene);
+    std::vector<Summary> summaries;
+    for (const Stage& stage : stages()) {
+        Summary summary;
+        std::vector<double> all;
+        for (const auto& run : runs) {
+            std::vector<double> values;
+            for (const FrameRecord& frame : run) {
+                values.push_back(stageMs(stage, frame));
+            }
+            if (values.empty()) continue;
+            std::sort(values.begin(), values.end());
+            summary.runMedians.push_back(percentile(values, 50));
+            all.insert(all.end(), values.begin(), values.end());
+        }
+        std::sort(all.begin(), all.end());
+        summary.p50 = percentile(all, 50);
+        summary.p90 = percentile(all, 90);
+        summary.p99 = percentile(all, 99);
+        for (double value : all) {
+            summary.mean += value;
+        }
+        summary.mean = all.empty() ? 0 : summary.mean / all.size();
+        summaries.push_back(summary);
+    }
+    return summaries;
+}
+
+void SceneStats::print(FILE* out) const {
+    fprintf(out, "%-24s %-14s %9s %9s %9s %9s\n", "Scene", "Stage", "p50(ms)", "p90(ms)",
+            "p99(ms)", "mean(ms)");
+    for (const std::string& scene : mScenes) {
+        std::vector<Summary> summaries = summarize(scene);
+        for (size_t i = 0; i < summaries.size(); i++) {
+            const Summary& s = summaries[i];
+            fprintf(out, "%-24s %-14s %9.3f %9.3f %9.3f %9.3f\n", i == 0 ? scene.c_str() : "",
+                    stages()[i].name, s.p50, s.p90, s.p99, s.mean);
+        }
+    }
+}
+
+bool SceneStats::writeJson(const char* path) const {
+    FILE* file = fopen(path, "we");
+    if (!file) {
+        fprintf(stderr, "Failed to open '%s' for the frame stats\n", path);
+        return false;
+    }
+    fprintf(file, "{\n  \"scenes\": [");
+    for (size_t sceneIndex = 0; sceneIndex < mScenes.size(); sceneIndex++) {
+        const std::string& scene = mScenes[sceneIndex];
+        const auto& runs = mRuns.at(scene);
+        fprintf(file, "%s\n    {\n      \"name\": \"%s\",\n      \"runs\": %zu,\n",
+                sceneIndex ? "," : "", scene.c_str(), runs.size());
+
+        fprintf(file, "      \"stages\": [");
+        std::vector<Summary> summaries = summarize(scene);
+        for (size_t i = 0; i < summaries.size(); i++) {
+            const Summary& s = summaries[i];
+            fprintf(file,
+                    "%s\n        {\"stage\": \"%s\", \"p50\": %.4f, \"p90\": %.4f, "
+                    "\"p99\": %.4f, \"mean\": %.4f, \"runMedians\": [",
+                    i ? "," : "", stages()[i].name, s.p50, s.p90, s.p99, s.mean);
+            for (size_t j = 0; j < s.runMedians.size(); j++) {
+                fprintf(file, "%s%.4f", j ? ", " : "", s.runMedians[j]);
+            }
+            fprintf(file, "]}");
+        }
+        fprintf(file, "\n      ],\n");
+
+        // The raw FrameInfo of each frame of each run, in nanoseconds
+        fprintf(file, "      \"columns\": [");
+        for (int i = 0; i < static_cast<int>(FrameInfoIndex::NumIndexes); i++) {
+            fprintf(file, "%s\"%s\"", i ? ", " : "", FrameInfoNames[i].c_str());
+        }
+        fprintf(file, "],\n      \"frames\": [");
+        for (size_t run = 0; run < runs.size(); run++) {
+            fprintf(file, "%s\n        [", run ? "," : "");
+            for (size_t f = 0; f < runs[run].size(); f++) {
+                fprintf(file, "%s[", f ? ", " : "");
+                for (size_t i = 0; i < runs[run][f].size(); i++) {
+                    fprintf(file, "%s%" PRId64, i ? ", " : "", runs[run][f][i]);
+                }
+                fprintf(file, "]");
+            }
+            fprintf(file, "]");
+        }
+        fprintf(file, "\n      ]\n    }");
+    }
+    fprintf(file, "\n  ]\n}\n");
+    bool success = !ferror(file);
+    fclose(file);
+    return success;
+}
+
+// The run medians of the stages of the scenes of a file written by writeJson(). This isn't a
+// JSON parser, it only looks for the keys in the order they are written.
+typedef std::map<std::string, std::map<std::string, std::vector<double>>> Baseline;
+
+static bool readBaseline(const char* path, Baseline* baseline) {
+    FILE* file = fopen(path, "re");
+    if (!file) {
+        fprintf(stderr, "Failed to open the baseline '%s'\n", path);
+        return false;
+    }
+    std::string json;
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        json.append(buffer, read);
+    }
+    fclose(file);
+
+    static const std::string kName = "\"name\": \"";
+    static const std::string kStage = "\"stage\": \"";
+    static const std::string kRunMedians = "\"runMedians\": [";
+    size_t pos = json.find(kName);
+    while (pos != std::string::npos) {
+        pos += kName.size();
+        size_t nameEnd = json.find('"', pos);
+        if (nameEnd == std::string::npos) return false;
+        auto& scene = (*baseline)[json.substr(pos, nameEnd - pos)];
+        size_t nextScene = json.find(kName, nameEnd);
+
+        size_t stage = json.find(kStage, nameEnd);
+        while (stage != std::string::npos && stage < nextScene) {
+            stage += kStage.size();
+            size_t stageEnd = json.find('"', stage);
+            size_t medians = json.find(kRunMedians, stage);
+            if (stageEnd == std::string::npos || medians == std::string::npos) return false;
+            auto& values = scene[json.substr(stage, stageEnd - stage)];
+            const char* p = json.c_str() + medians + kRunMedians.size();
+            while (*p != ']' && *p != '\0') {
+                char* end;
+                double value = strtod(p, &end);
+                if (end == p) return false;
+                values.push_back(value);
+                p = end;
+                while (*p == ',' || *p == ' ') p++;
+            }
+            stage = json.find(kStage, stageEnd);
+        }
+        pos = nextScene;
+    }
+    return true;
+}
+
+static void meanAndVariance(const std::vector<double>& values, double* mean, double* variance) {
+    *mean = 0;
+    for (double value : values) {
+        *mean += value;
+    }
+    *mean /= values.size();
+    *variance = 0;
+    for (double value : values) {
+        *variance += (value - *mean) * (value - *mean);
+    }
+    *variance /= values.size() - 1;
+}
+
+// Two-sided 95% critical values of Student's t-distribution for 1 to 30 degrees of freedom
+static double tCritical(double df) {
+    static const double kCritical[] = {
+            12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+            2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+            2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+    };
+    int index = static_cast<int>(floor(df));
+    if (index < 1) index = 1;
+    if (index > 30) return 1.960;
+    return kCritical[index - 1];
+}
+
+int SceneStats::compareToBaseline(const char* path, FILE* out) const {
+    Baseline baseline;
+    if (!readBaseline(path, &baseline)) {
+        fprintf(stderr, "Malformed baseline '%s'\n", path);
+        return -1;
+    }
+
+    int regressions = 0;
+    fprintf(out, "%-24s %-14s %11s %11s %8s %7s\n", "Scene", "Stage", "base p50", "p50",
+            "change", "t");
+    for (const std::string& scene : mScenes) {
+        auto baseScene = baseline.find(scene);
+        if (baseScene == baseline.end()) {
+            fprintf(out, "%-24s not in the baseline\n", scene.c_str());
+            continue;
+        }
+        std::vector<Summary> summaries = summarize(scene);
+        for (size_t i = 0; i < summaries.size(); i++) {
+            auto baseStage = baseScene->second.find(stages()[i].name);
+            if (baseStage == baseScene->second.end()) continue;
+            const std::vector<double>& base = baseStage->second;
+            const std::vector<double>& current = summaries[i].runMedians;
+            if (base.size() < 2 || current.size() < 2) {
+                fprintf(out, "%-24s %-14s needs 2 runs or more on both sides, see --repeat\n",
+                        scene.c_str(), stages()[i].name);
+                continue;
+            }
+
+            double baseMean, baseVariance, mean, variance;
+            meanAndVariance(base, &baseMean, &baseVariance);
+            meanAndVariance(current, &mean, &variance);
+            double baseError = baseVariance / base.size();
+            double error = variance / current.size();
+            double diff = mean - baseMean;
+            double t, df;
+            if (baseError + error > 0) {
+                t = diff / sqrt(baseError + error);
+                // Welch-Satterthwaite
+                df = (baseError + error) * (baseError + error) /
+                     (baseError * baseError / (base.size() - 1) +
+                      error * error / (current.size() - 1));
+            } else {
+                t = diff > 0 ? INFINITY : (diff < 0 ? -INFINITY : 0);
+                df = base.size() + current.size() - 2;
+            }
+            bool regressed = t > tCritical(df);
+            bool improved = t < -tCritical(df);
+            if (regressed) regressions++;
+            fprintf(out, "%-24s %-14s %11.3f %11.3f %+7.1f%% %7.2f %s\n", scene.c_str(),
+                    stages()[i].name, baseMean, mean, baseMean > 0 ? diff / baseMean * 100 : 0,
+                    t, regressed ? "REGRESSED" : (improved ? "improved" : ""));
+        }
+    }
+    return regressions;
+}
+
+}  // namespace test
+}  // namespace uirenderer
+}  // namespace android
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "FrameInfo.h"
+#include "FrameMetricsObserver.h"
+
+#include <array>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace uirenderer {
+namespace test {
+
+typedef std::array<int64_t, static_cast<int>(FrameInfoIndex::NumIndexes)> FrameRecord;
+
+/**
+ * Collects the FrameInfo of every frame of the runs of the scenes, reports the
+ * percentiles of the stages of the frames and compares them to a baseline.
+ *
+ * A run records the frames through a FrameMetricsObserver, the frames of all
+ * the runs of a scene are pooled for the percentiles while the significance of
+ * a change is tested on the medians of the runs, as the frames of a run aren't
+ * independent of each other.
+ */
+class SceneStats {
+public:
+    class Recorder : public FrameMetricsObserver {
+    public:
+        virtual void notify(const int64_t* buffer) override;
+        // Only valid once the RenderProxy is fenced
+        const std::vector<FrameRecord>& frames() const { return mFrames; }
+
+    private:
+        std::mutex mLock;
+        std::vector<FrameRecord> mFrames;
+    };
+
+    void addRun(const std::string& scene, const std::vector<FrameRecord>& frames);
+
+    // Prints the percentiles of the stages of each scene
+    void print(FILE* out) const;
+    bool writeJson(const char* path) const;
+
+    /**
+     * Compares the scenes to the ones of a JSON file written by writeJson(), a
+     * stage regresses when its median got significantly longer with Welch's
+     * t-test on the medians of the runs. Returns the number of regressions.
+     */
+    int compareToBaseline(const char* path, FILE* out) const;
+
+private:
+    struct Stage {
+        const char* name;
+        FrameInfoIndex start;
+        // NumIndexes for the stages that are a duration in themselves
+        FrameInfoIndex end;
+    };
+    static const std::vector<Stage>& stages();
+    static double stageMs(const Stage& stage, const FrameRecord& frame);
+
+    struct Summary {
+        double p50 = 0;
+        double p90 = 0;
+        double p99 = 0;
+        double mean = 0;
+        std::vector<double> runMedians;
+    };
+    std::vector<Summary> summarize(const std::string& scene) const;
+
+    // in the order of the first run of each scene
+    std::vector<std::string> mScenes;
+    std::map<std::string, std::vector<std::vector<FrameRecord>>> mRuns;
+};
+
+}  // namespace test
+}  // namespace uirenderer
+}  // namespace android
@@ -21,6 +21,7 @@
 #include "tests/common/TestContext.h"
 #include "tests/common/TestScene.h"
 #include "tests/common/scenes/TestSceneBase.h"
+#include "tests/macrobench/SceneStats.h"
 
 #include <benchmark/benchmark.h>
 #include <gui/Surface.h>
@@ -107,7 +108,7 @@ void outputBenchmarkReport(const TestScene::Info& info, const TestScene::Options
 }
 
 void run(const TestScene::Info& info, const TestScene::Options& opts,
-         benchmark::BenchmarkReporter* reporter) {
+         benchmark::BenchmarkReporter* reporter, SceneStats* stats) {
     // Switch to the real display
     gDisplay = getBuiltInDisplay();
 
@@ -143,6 +144,9 @@ void run(const TestScene::Info& info, const TestScene::Options& opts,
         // Do a few more warmups to try and boost the clocks up
         warmupFrameCount = 10;
     }
+    if (opts.warmupCount) {
+        warmupFrameCount = opts.warmupCount;
+    }
     for (int i = 0; i < warmupFrameCount; i++) {
         testContext.waitForVsync();
         nsecs_t vsync = systemTime(CLOCK_MONOTONIC);
@@ -153,6 +157,12 @@ void run(const TestScene::Info& info, const TestScene::Options& opts,
     proxy->resetProfileInfo();
     proxy->fence();
 
+    sp<SceneStats::Recorder> recorder;
+    if (stats) {
+        recorder = new SceneStats::Recorder();
+        proxy->addFrameMetricsObserver(recorder.get());
+    }
+
     ModifiedMovingAverage<double> avgMs(opts.reportFrametimeWeight);
 
     nsecs_t start = systemTime(CLOCK_MONOTONIC);
@@ -177,6 +187,11 @@ void run(const TestScene::Info& info, const TestScene::Options& opts,
     proxy->fence();
     nsecs_t end = systemTime(CLOCK_MONOTONIC);
 
+    if (recorder) {
+        proxy->removeFrameMetricsObserver(recorder.get());
+        stats->addRun(info.name, recorder->frames());
+    }
+
     if (reporter) {
         outputBenchmarkReport(info, opts, reporter, proxy.get(), (end - start) / (double)s2ns(1));
     } else {
@@ -16,6 +16,7 @@
 
 #include "tests/common/LeakChecker.h"
 #include "tests/common/TestScene.h"
+#include "tests/macrobench/SceneStats.h"
 
 #include "Properties.h"
 #include "hwui/Typeface.h"
@@ -43,9 +44,12 @@ static int gRepeatCount = 1;
 static std::vector<TestScene::Info> gRunTests;
 static TestScene::Options gOpts;
 std::unique_ptr<benchmark::BenchmarkReporter> gBenchmarkReporter;
+static bool gFrameStats = false;
+static const char* gFrameStatsPath = nullptr;
+static const char* gBaselinePath = nullptr;
 
 void run(const TestScene::Info& info, const TestScene::Options& opts,
-         benchmark::BenchmarkReporter* reporter);
+         benchmark::BenchmarkReporter* reporter, SceneStats* stats);
 
 static void printHelp() {
     printf(R"(
@@ -68,6 +72,15 @@ OPTIONS:
                        are offscreen rendered
   --benchmark_format   Set output format. Possible values are tabular, json, csv
   --renderer=TYPE      Sets the render pipeline to use. May be opengl, skiagl, or skiavk
+  --warmup=NUM         NUM frames to draw before a run is measured
+  --frame-stats[=FILE] Records the FrameInfo of every frame and prints the 50th,
+                       90th and 99th percentiles of the stages of the frames of all
+                       the runs of each test. If FILE is set they are written to it
+                       as JSON, with the FrameInfo of every frame
+  --baseline=FILE      Compares the frame stats to the ones of FILE, written by an
+                       earlier --frame-stats=FILE. A stage regresses if the median
+                       of its runs is significantly slower (Welch's t-test, p < 0.05),
+                       which needs -r of 2 or more. Exits with 2 on regressions
 )");
 }
 
@@ -173,6 +186,9 @@ enum {
     Onscreen,
     Offscreen,
     Renderer,
+    Warmup,
+    FrameStats,
+    Baseline,
 };
 }
 
@@ -188,6 +204,9 @@ static const struct option LONG_OPTIONS[] = {
         {"onscreen", no_argument, nullptr, LongOpts::Onscreen},
         {"offscreen", no_argument, nullptr, LongOpts::Offscreen},
         {"renderer", required_argument, nullptr, LongOpts::Renderer},
+        {"warmup", required_argument, nullptr, LongOpts::Warmup},
+        {"frame-stats", optional_argument, nullptr, LongOpts::FrameStats},
+        {"baseline", required_argument, nullptr, LongOpts::Baseline},
         {0, 0, 0, 0}};
 
 static const char* SHORT_OPTIONS = "c:r:h";
@@ -278,6 +297,24 @@ void parseOptions(int argc, char* argv[]) {
                 }
                 break;
 
+            case LongOpts::Warmup:
+                gOpts.warmupCount = atoi(optarg);
+                if (gOpts.warmupCount <= 0) {
+                    fprintf(stderr, "Invalid warmup argument '%s'\n", optarg);
+                    error = true;
+                }
+                break;
+
+            case LongOpts::FrameStats:
+                gFrameStats = true;
+                gFrameStatsPath = optarg;
+                break;
+
+            case LongOpts::Baseline:
+                gFrameStats = true;
+                gBaselinePath = optarg;
+                break;
+
             case LongOpts::Onscreen:
                 gOpts.renderOffscreen = false;
                 break;
@@ -348,9 +385,14 @@ int main(int argc, char* argv[]) {
         gBenchmarkReporter->ReportContext(context);
     }
 
+    std::unique_ptr<SceneStats> stats;
+    if (gFrameStats) {
+        stats.reset(new SceneStats());
+    }
+
     for (int i = 0; i < gRepeatCount; i++) {
         for (auto&& test : gRunTests) {
-            run(test, gOpts, gBenchmarkReporter.get());
+            run(test, gOpts, gBenchmarkReporter.get(), stats.get());
         }
     }
 
@@ -358,6 +400,23 @@ int main(int argc, char* argv[]) {
         gBenchmarkReporter->Finalize();
     }
 
+    int result = 0;
+    if (stats) {
+        stats->print(stdout);
+        if (gFrameStatsPath && !stats->writeJson(gFrameStatsPath)) {
+            result = EXIT_FAILURE;
+        }
+        if (gBaselinePath) {
+            int regressions = stats->compareToBaseline(gBaselinePath, stdout);
+            if (regressions < 0) {
+                result = EXIT_FAILURE;
+            } else if (regressions > 0) {
+                printf("%d stage(s) regressed\n", regressions);
+                result = 2;
+            }
+        }
+    }
+
     LeakChecker::checkForLeaks();
-    return 0;
+    return result;
 }
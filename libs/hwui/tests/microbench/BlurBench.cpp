@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "utils/Blur.h"
+
+#include <stdlib.h>
+
+#include <vector>
+
+using namespace android;
+using namespace android::uirenderer;
+
+// About the size of the drop shadow of a line of launcher label text
+static const int32_t kWidth = 256;
+static const int32_t kHeight = 64;
+
+typedef void (*BlurPass)(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
+                         int32_t width, int32_t height);
+
+static void runBlur(benchmark::State& state, BlurPass horizontal, BlurPass vertical) {
+    const int32_t radius = state.range(0);
+    std::vector<float> weights(2 * radius + 1);
+    Blur::generateGaussianWeights(weights.data(), radius);
+    std::vector<uint8_t> image(kWidth * kHeight);
+    for (auto& pixel : image) {
+        pixel = rand() & 0xFF;
+    }
+    std::vector<uint8_t> scratch(image.size());
+
+    while (state.KeepRunning()) {
+        horizontal(weights.data(), radius, image.data(), scratch.data(), kWidth, kHeight);
+        vertical(weights.data(), radius, scratch.data(), image.data(), kWidth, kHeight);
+        benchmark::DoNotOptimize(image.data());
+    }
+    state.SetBytesProcessed(state.iterations() * image.size());
+}
+
+void BM_Blur_scalar(benchmark::State& state) {
+    runBlur(state, &Blur::horizontalScalar, &Blur::verticalScalar);
+}
+BENCHMARK(BM_Blur_scalar)->Arg(2)->Arg(5)->Arg(10)->Arg(25);
+
+void BM_Blur_vector(benchmark::State& state) {
+    runBlur(state, &Blur::horizontal, &Blur::vertical);
+}
+BENCHMARK(BM_Blur_vector)->Arg(2)->Arg(5)->Arg(10)->Arg(25);
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "ClipArea.h"
+#include "Matrix.h"
+#include "Rect.h"
+#include "utils/LinearAllocator.h"
+
+#include <SkPath.h>
+
+using namespace android;
+using namespace android::uirenderer;
+
+// The clips of the "clip" scene (ClippingAnimation), as a card translating across the frames
+static void BM_ClipArea_clippingAnimation(benchmark::State& state) {
+    SkPath clipCircle;
+    clipCircle.addCircle(100, 300, 100);
+    int frame = 0;
+    while (state.KeepRunning()) {
+        LinearAllocator allocator;
+        ClipArea area;
+        area.setViewportDimensions(1080, 1920);
+        Matrix4 card;
+        card.loadTranslate(frame % 150, frame % 150, 0);
+        area.clipRectWithTransform(Rect(200, 400), &card, SkRegion::kIntersect_Op);
+
+        Matrix4 transform(card);
+        area.clipRectWithTransform(Rect(200, 200), &transform, SkRegion::kIntersect_Op);
+        transform.translate(100, 100);
+        transform.rotate(45, 0, 0, 1);
+        transform.translate(-100, -100);
+        area.clipRectWithTransform(Rect(200, 200), &transform, SkRegion::kIntersect_Op);
+        benchmark::DoNotOptimize(area.serializeClip(allocator));
+
+        area.setClip(0, 0, 1080, 1920);
+        area.clipRectWithTransform(Rect(200, 400), &card, SkRegion::kIntersect_Op);
+        area.clipPathWithTransform(clipCircle, &card, SkRegion::kIntersect_Op);
+        benchmark::DoNotOptimize(area.serializeClip(allocator));
+        frame++;
+    }
+}
+BENCHMARK(BM_ClipArea_clippingAnimation);
+
+// Arg is the number of translated, axis aligned rects cut out of the clip
+static void BM_ClipArea_differenceRects(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        LinearAllocator allocator;
+        ClipArea area;
+        area.setViewportDimensions(1080, 1920);
+        area.setClip(0, 0, 1080, 1920);
+        for (int i = 0; i < state.range(0); i++) {
+            Matrix4 transform;
+            transform.loadTranslate(i * 20.5f, i * 30.5f, 0);
+            area.clipRectWithTransform(Rect(100, 100), &transform, SkRegion::kDifference_Op);
+        }
+        benchmark::DoNotOptimize(area.serializeClip(allocator));
+    }
+}
+BENCHMARK(BM_ClipArea_differenceRects)->Arg(1)->Arg(8)->Arg(32);
+
+// Arg is the number of translated, axis aligned rects intersected with a rotated clip
+static void BM_ClipArea_rectangleListIntersect(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        ClipArea area;
+        area.setViewportDimensions(1080, 1920);
+        Matrix4 rotate;
+        rotate.loadRotate(30);
+        area.clipRectWithTransform(Rect(500, 500), &rotate, SkRegion::kIntersect_Op);
+        for (int i = 0; i < state.range(0); i++) {
+            Matrix4 transform;
+            transform.loadTranslate(i, i, 0);
+            area.clipRectWithTransform(Rect(1000, 1000), &transform, SkRegion::kIntersect_Op);
+        }
+        benchmark::DoNotOptimize(area.getClipRect());
+    }
+}
+BENCHMARK(BM_ClipArea_rectangleListIntersect)->Arg(2)->Arg(8);
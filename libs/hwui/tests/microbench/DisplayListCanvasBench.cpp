@@ -19,6 +19,7 @@
 #include "DisplayList.h"
 #include "RecordingCanvas.h"
 #include "tests/common/TestUtils.h"
+#include "utils/LinearAllocator.h"
 
 using namespace android;
 using namespace android::uirenderer;
@@ -114,6 +115,33 @@ void BM_DisplayListCanvas_record_simpleBitmapView(benchmark::State& benchState)
 }
 BENCHMARK(BM_DisplayListCanvas_record_simpleBitmapView);
 
+/**
+ * Records a list large enough to grow through several allocator pages. Arg is whether the pages
+ * of deleted lists are returned to the LinearAllocator page pool.
+ */
+void BM_DisplayListCanvas_record_pagePool(benchmark::State& benchState) {
+    const size_t capacity = LinearAllocator::getPagePoolStats().capacity;
+    if (!benchState.range(0)) LinearAllocator::setPagePoolCapacity(0);
+    std::unique_ptr<Canvas> canvas(Canvas::create_recording_canvas(100, 100));
+    delete canvas->finishRecording();
+
+    SkPaint rectPaint;
+    const uint64_t allocatedPages = LinearAllocator::getPagePoolStats().allocatedPages;
+    while (benchState.KeepRunning()) {
+        canvas->resetRecording(100, 100);
+        for (int i = 0; i < 100; i++) {
+            canvas->drawRect(0, 0, 100, 100, rectPaint);
+        }
+        benchmark::DoNotOptimize(canvas.get());
+        delete canvas->finishRecording();
+    }
+    benchState.counters["mallocs_per_iter"] =
+            (LinearAllocator::getPagePoolStats().allocatedPages - allocatedPages) /
+            (double)benchState.iterations();
+    LinearAllocator::setPagePoolCapacity(capacity);
+}
+BENCHMARK(BM_DisplayListCanvas_record_pagePool)->Arg(0)->Arg(1);
+
 class NullClient : public CanvasStateClient {
     void onViewportInitialized() override {}
     void onSnapshotRestored(const Snapshot& removed, const Snapshot& restored) {}
@@ -147,3 +147,46 @@ void BM_FrameBuilder_deferAndRender_scene(benchmark::State& state) {
     });
 }
 BENCHMARK(BM_FrameBuilder_deferAndRender_scene)->DenseRange(0, SCENES.size() - 1);
+
+// Builds a tree of the given depth where each node has fanout children, with leaves drawing
+// a column of rects and bitmaps, so that deferral cost is dominated by independent subtrees.
+static sp<RenderNode> createTree(int depth, int fanout) {
+    if (depth == 0) return createTestNode();
+
+    std::vector<sp<RenderNode> > children;
+    for (int i = 0; i < fanout; i++) {
+        children.push_back(createTree(depth - 1, fanout));
+    }
+    auto node = TestUtils::createNode<RecordingCanvas>(
+            0, 0, 200, 200, [&children](RenderProperties& props, RecordingCanvas& canvas) {
+                for (auto& child : children) {
+                    canvas.drawRenderNode(child.get());
+                }
+            });
+    TestUtils::syncHierarchyPropertiesAndDisplayList(node);
+    return node;
+}
+
+// Args: depth, fanout, parallel deferral enabled
+void BM_FrameBuilder_defer_tree(benchmark::State& state) {
+    TestUtils::runOnRenderThread([&state](RenderThread& thread) {
+        bool prevParallelDeferral = Properties::enableParallelDeferral;
+        Properties::enableParallelDeferral = state.range(2);
+        state.SetLabel(state.range(2) ? "parallel" : "serial");
+        auto node = createTree(state.range(0), state.range(1));
+        while (state.KeepRunning()) {
+            FrameBuilder frameBuilder(SkRect::MakeWH(200, 200), 200, 200, sLightGeometry,
+                                      Caches::getInstance());
+            frameBuilder.deferRenderNode(*node);
+            benchmark::DoNotOptimize(&frameBuilder);
+        }
+        Properties::enableParallelDeferral = prevParallelDeferral;
+    });
+}
+BENCHMARK(BM_FrameBuilder_defer_tree)
+        ->Args({1, 32, 0})  // wide
+        ->Args({1, 32, 1})
+        ->Args({6, 2, 0})  // deep
+        ->Args({6, 2, 1})
+        ->Args({3, 6, 0})  // dense list-like
+        ->Args({3, 6, 1});
@@ -46,3 +46,21 @@ static void BM_LinearStdAllocator_vector(benchmark::State& state) {
     }
 }
 BENCHMARK(BM_LinearStdAllocator_vector);
+
+// Arg is whether destroyed allocators return their pages to the shared pool
+static void BM_LinearAllocator_pagePool(benchmark::State& state) {
+    const size_t capacity = LinearAllocator::getPagePoolStats().capacity;
+    if (!state.range(0)) LinearAllocator::setPagePoolCapacity(0);
+    const uint64_t allocatedPages = LinearAllocator::getPagePoolStats().allocatedPages;
+    while (state.KeepRunning()) {
+        LinearAllocator la;
+        for (int j = 0; j < 200; j++) {
+            benchmark::DoNotOptimize(la.alloc<char>(64));
+        }
+    }
+    state.counters["mallocs_per_iter"] =
+            (LinearAllocator::getPagePoolStats().allocatedPages - allocatedPages) /
+            (double)state.iterations();
+    LinearAllocator::setPagePoolCapacity(capacity);
+}
+BENCHMARK(BM_LinearAllocator_pagePool)->Arg(0)->Arg(1);
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "Properties.h"
+#include "pipeline/skia/ShaderBlobStore.h"
+#include "pipeline/skia/ShaderCache.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using namespace android;
+using namespace android::uirenderer;
+
+namespace android {
+namespace uirenderer {
+namespace skiapipeline {
+
+class ShaderCacheTestUtils {
+public:
+    static void setSaveDelay(ShaderCache& cache, unsigned int saveDelay) {
+        cache.mDeferredSaveDelay = saveDelay;
+    }
+
+    static void terminate(ShaderCache& cache, bool saveContent) {
+        std::lock_guard<std::mutex> lock(cache.mMutex);
+        if (cache.mInitialized && cache.mBlobStore && saveContent) {
+            cache.mBlobStore->writeToFile();
+        }
+        cache.mBlobStore = NULL;
+    }
+
+    static void waitForWarmUp(ShaderCache& cache) {
+        std::unique_lock<std::mutex> lock(cache.mMutex);
+        cache.mWarmUpCondition.wait(lock, [&cache]() { return !cache.mWarmUpPending; });
+    }
+};
+
+} /* namespace skiapipeline */
+} /* namespace uirenderer */
+} /* namespace android */
+
+using namespace android::uirenderer::skiapipeline;
+
+static const int kEntryCount = 64;
+static const int kFirstFrameEntryCount = 32;
+static const size_t kEntrySize = 6 * 1024;
+
+static sk_sp<SkData> makeKey(int index) {
+    std::string key = "GrProgramDesc" + std::to_string(index);
+    return SkData::MakeWithCopy(key.data(), key.size());
+}
+
+// Fills the cache file with kEntryCount programs, of which the first kFirstFrameEntryCount are
+// used by every previous run.
+static void populateCache(const std::string& filename) {
+    remove(filename.c_str());
+    ShaderCache& cache = ShaderCache::get();
+    cache.setFilename(filename.c_str());
+    ShaderCacheTestUtils::setSaveDelay(cache, 0);
+    cache.initShaderDiskCache();
+    std::vector<char> program(kEntrySize, 'p');
+    for (int i = 0; i < kEntryCount; i++) {
+        sk_sp<SkData> value = SkData::MakeWithCopy(program.data(), program.size());
+        cache.store(*makeKey(i), *value);
+    }
+    for (int run = 0; run < 3; run++) {
+        for (int i = 0; i < kFirstFrameEntryCount; i++) {
+            cache.load(*makeKey(i));
+        }
+    }
+    ShaderCacheTestUtils::terminate(cache, true);
+}
+
+// Measures the shader cache loads issued by the first frame after startup, with the warm up
+// (arg 1) having had time to run alongside the rest of startup, or without it (arg 0).
+void BM_ShaderCache_firstFrameLoads(benchmark::State& state) {
+    const bool warmUp = state.range(0);
+    const std::string filename = "/data/local/tmp/hwui_shader_cache_bench";
+    populateCache(filename);
+
+    ShaderCache& cache = ShaderCache::get();
+    const bool savedWarmUp = Properties::enableShaderCacheWarmUp;
+    std::vector<sk_sp<SkData>> keys;
+    for (int i = 0; i < kFirstFrameEntryCount; i++) {
+        keys.push_back(makeKey(i));
+    }
+
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        Properties::enableShaderCacheWarmUp = warmUp;
+        cache.initShaderDiskCache();
+        ShaderCacheTestUtils::waitForWarmUp(cache);
+        state.ResumeTiming();
+
+        for (auto& key : keys) {
+            benchmark::DoNotOptimize(cache.load(*key));
+        }
+
+        state.PauseTiming();
+        ShaderCacheTestUtils::terminate(cache, false);
+        state.ResumeTiming();
+    }
+
+    Properties::enableShaderCacheWarmUp = savedWarmUp;
+    remove(filename.c_str());
+    state.SetLabel(warmUp ? "warm up" : "no warm up");
+}
+BENCHMARK(BM_ShaderCache_firstFrameLoads)->Arg(0)->Arg(1);
@@ -21,6 +21,9 @@
 #include "thread/TaskProcessor.h"
 #include "thread/ThreadBase.h"
 
+#include <utils/Timers.h>
+
+#include <algorithm>
 #include <atomic>
 #include <vector>
 
@@ -39,6 +42,30 @@ public:
     }
 };
 
+// Task carrying a nominal amount of work and its enqueue
+// timestamp so that latency can be measured on completion
+class SizedTask : public Task<nsecs_t> {
+public:
+    explicit SizedTask(int spinIterations) : spinIterations(spinIterations), enqueueTime(0) {}
+
+    const int spinIterations;
+    nsecs_t enqueueTime;
+};
+
+class SizedProcessor : public TaskProcessor<nsecs_t> {
+public:
+    explicit SizedProcessor(TaskManager* manager) : TaskProcessor(manager) {}
+    virtual ~SizedProcessor() {}
+    virtual void onProcess(const sp<Task<nsecs_t>>& task) override {
+        SizedTask* t = static_cast<SizedTask*>(task.get());
+        volatile int sink = 0;
+        for (int i = 0; i < t->spinIterations; i++) {
+            sink = sink + i;
+        }
+        t->setResult(systemTime(SYSTEM_TIME_MONOTONIC) - t->enqueueTime);
+    }
+};
+
 class TestThread : public ThreadBase, public virtual RefBase {};
 
 void BM_TaskManager_allocateTask(benchmark::State& state) {
@@ -90,6 +117,41 @@ void BM_TaskManager_enqueueRunDeleteTask(benchmark::State& state) {
 }
 BENCHMARK(BM_TaskManager_enqueueRunDeleteTask);
 
+// Mimics a frame's worth of precache work: mostly small path/shadow
+// tessellations with an occasional large one that would otherwise block
+// every task queued behind it on the same worker.
+void BM_TaskManager_mixedTaskSizes(benchmark::State& state) {
+    const int kTasksPerFrame = state.range(0);
+    TaskManager taskManager;
+    sp<SizedProcessor> processor(new SizedProcessor(&taskManager));
+    std::vector<sp<SizedTask>> tasks;
+    std::vector<nsecs_t> latencies;
+    tasks.reserve(kTasksPerFrame);
+
+    while (state.KeepRunning()) {
+        tasks.clear();
+        for (int i = 0; i < kTasksPerFrame; i++) {
+            tasks.emplace_back(new SizedTask(i % 16 == 0 ? 200000 : 2000));
+        }
+        for (sp<SizedTask>& task : tasks) {
+            task->enqueueTime = systemTime(SYSTEM_TIME_MONOTONIC);
+            processor->add(task);
+        }
+        for (sp<SizedTask>& task : tasks) {
+            latencies.push_back(task->getResult());
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * kTasksPerFrame);
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        state.counters["p50_us"] = ns2us(latencies[latencies.size() / 2]);
+        state.counters["p99_us"] = ns2us(latencies[latencies.size() * 99 / 100]);
+        state.counters["max_us"] = ns2us(latencies.back());
+    }
+}
+BENCHMARK(BM_TaskManager_mixedTaskSizes)->Arg(16)->Arg(64)->Arg(256);
+
 void BM_Thread_enqueueTask(benchmark::State& state) {
     sp<TestThread> thread{new TestThread};
     thread->start();
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "hwui/AnimatedImageFramePool.h"
+
+#include <SkImage.h>
+#include <SkImagePriv.h>
+
+using namespace android;
+using namespace android::uirenderer;
+
+TEST(AnimatedImageFramePool, reusesFreeBuffers) {
+    AnimatedImageFramePool& pool = AnimatedImageFramePool::get();
+    pool.trim();
+    ASSERT_EQ(0u, pool.pooledBytes());
+
+    const SkImageInfo info = SkImageInfo::MakeN32Premul(64, 32);
+    SkBitmap first;
+    ASSERT_TRUE(pool.acquire(info, &first));
+    void* firstPixels = first.getPixels();
+    EXPECT_EQ(info, first.info());
+
+    // an image of the frame keeps it in use after the bitmap is gone
+    sk_sp<SkImage> image = SkMakeImageFromRasterBitmap(first, kNever_SkCopyPixelsMode);
+    first.reset();
+    SkBitmap second;
+    ASSERT_TRUE(pool.acquire(info, &second));
+    EXPECT_NE(firstPixels, second.getPixels());
+
+    // other sizes never share a buffer
+    SkBitmap other;
+    ASSERT_TRUE(pool.acquire(SkImageInfo::MakeN32Premul(32, 32), &other));
+    EXPECT_NE(firstPixels, other.getPixels());
+    other.reset();
+
+    image.reset();
+    SkBitmap third;
+    ASSERT_TRUE(pool.acquire(info, &third));
+    EXPECT_EQ(firstPixels, third.getPixels());
+    EXPECT_EQ(2 * info.computeMinByteSize() + 32 * 32 * 4, pool.pooledBytes());
+
+    // only the free buffers are dropped
+    pool.trim();
+    EXPECT_EQ(2 * info.computeMinByteSize(), pool.pooledBytes());
+    second.reset();
+    third.reset();
+    pool.trim();
+    EXPECT_EQ(0u, pool.pooledBytes());
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <hwui/Bitmap.h>
+
+using namespace android;
+
+TEST(Bitmap, heapPixelsAreReused) {
+    Bitmap::trimPixelBufferPool();
+    const SkImageInfo info = SkImageInfo::MakeN32Premul(300, 300);
+
+    sk_sp<Bitmap> first = Bitmap::allocateHeapBitmap(info);
+    ASSERT_TRUE(first);
+    EXPECT_GE(first->getAllocationByteCount(), info.computeMinByteSize());
+    void* pixels = first->pixels();
+    memset(pixels, 0xff, info.computeMinByteSize());
+    first.reset();
+
+    // A bitmap of the same size class gets the same, zeroed, pixels.
+    sk_sp<Bitmap> second = Bitmap::allocateHeapBitmap(SkImageInfo::MakeN32Premul(299, 300));
+    ASSERT_TRUE(second);
+    EXPECT_EQ(pixels, second->pixels());
+    EXPECT_EQ(0u, *static_cast<uint32_t*>(second->pixels()));
+}
+
+TEST(Bitmap, smallHeapPixelsAreExact) {
+    const SkImageInfo info = SkImageInfo::MakeN32Premul(10, 10);
+    sk_sp<Bitmap> bitmap = Bitmap::allocateHeapBitmap(info);
+    ASSERT_TRUE(bitmap);
+    EXPECT_EQ(info.computeMinByteSize(), bitmap->getAllocationByteCount());
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "utils/Blur.h"
+
+#include <stdlib.h>
+
+#include <vector>
+
+using namespace android::uirenderer;
+
+static void expectClose(const std::vector<uint8_t>& expected, const std::vector<uint8_t>& actual,
+                        int32_t radius, int32_t width, int32_t height) {
+    for (size_t i = 0; i < expected.size(); i++) {
+        ASSERT_LE(abs(expected[i] - actual[i]), 1)
+                << "radius " << radius << ", " << width << "x" << height << ", pixel " << i;
+    }
+}
+
+TEST(Blur, matchesScalar) {
+    srand(1);
+    for (int32_t radius : {1, 2, 5, 12, 25}) {
+        std::vector<float> weights(2 * radius + 1);
+        Blur::generateGaussianWeights(weights.data(), radius);
+        // sizes around the vector width, with and without an interior
+        for (int32_t width : {1, 7, 8, 9, 33, 130}) {
+            for (int32_t height : {1, 3, 40}) {
+                std::vector<uint8_t> source(width * height);
+                for (auto& pixel : source) {
+                    pixel = rand() & 0xFF;
+                }
+                std::vector<uint8_t> expected(source.size());
+                std::vector<uint8_t> actual(source.size());
+
+                Blur::horizontalScalar(weights.data(), radius, source.data(), expected.data(),
+                                       width, height);
+                Blur::horizontal(weights.data(), radius, source.data(), actual.data(), width,
+                                 height);
+                expectClose(expected, actual, radius, width, height);
+
+                Blur::verticalScalar(weights.data(), radius, source.data(), expected.data(),
+                                     width, height);
+                Blur::vertical(weights.data(), radius, source.data(), actual.data(), width,
+                               height);
+                expectClose(expected, actual, radius, width, height);
+            }
+        }
+    }
+}
+
+TEST(Blur, preservesFlatColor) {
+    const int32_t radius = 10;
+    const int32_t width = 64;
+    const int32_t height = 32;
+    std::vector<float> weights(2 * radius + 1);
+    Blur::generateGaussianWeights(weights.data(), radius);
+    std::vector<uint8_t> source(width * height, 200);
+    std::vector<uint8_t> scratch(source.size());
+    std::vector<uint8_t> dest(source.size());
+
+    Blur::horizontal(weights.data(), radius, source.data(), scratch.data(), width, height);
+    Blur::vertical(weights.data(), radius, scratch.data(), dest.data(), width, height);
+    for (uint8_t pixel : dest) {
+        // the weights add up to one, give or take the truncation
+        ASSERT_GE(pixel, 198);
+        ASSERT_LE(pixel, 200);
+    }
+}
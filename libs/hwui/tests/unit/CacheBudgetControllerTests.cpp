@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "renderthread/CacheBudgetController.h"
+#include "utils/TimeUtils.h"
+
+using namespace android;
+using namespace android::uirenderer;
+using namespace android::uirenderer::renderthread;
+
+static const size_t kBaseBudget = 64 * 1024 * 1024;
+static const nsecs_t kFrameInterval = 16_ms;
+
+// Feeds "count" frames, one per frame interval starting at "start", returns the time after them
+static nsecs_t feedFrames(CacheBudgetController& controller, nsecs_t start, int count,
+                          bool missedDeadline, size_t cacheBytesUsed) {
+    nsecs_t now = start;
+    for (int i = 0; i < count; i++, now += kFrameInterval) {
+        controller.frameCompleted(missedDeadline, cacheBytesUsed, now);
+    }
+    return now;
+}
+
+TEST(CacheBudgetController, growsWhenThrashing) {
+    CacheBudgetController controller;
+    controller.setBaseBudget(kBaseBudget, 1_s);
+    EXPECT_EQ(kBaseBudget, controller.budget());
+
+    // janky frames that don't fill the cache, or full caches without jank, don't grow it
+    nsecs_t now = feedFrames(controller, 5_s, 30, true, kBaseBudget / 2);
+    now = feedFrames(controller, now, 30, false, kBaseBudget);
+    EXPECT_EQ(kBaseBudget, controller.budget());
+
+    now = feedFrames(controller, now, 4, true, kBaseBudget);
+    EXPECT_EQ(kBaseBudget * 5 / 4, controller.budget());
+
+    // growing is rate limited, and bounded
+    feedFrames(controller, now, 4, true, controller.budget());
+    EXPECT_EQ(kBaseBudget * 5 / 4, controller.budget());
+    for (int i = 0; i < 10; i++) {
+        now = feedFrames(controller, now + 3_s, 4, true, controller.budget());
+    }
+    EXPECT_EQ(kBaseBudget * 2, controller.budget());
+}
+
+TEST(CacheBudgetController, shrinksOnMemoryPressure) {
+    CacheBudgetController controller;
+    controller.setBaseBudget(kBaseBudget, 1_s);
+
+    EXPECT_TRUE(controller.onMemoryPressure(5_s));
+    EXPECT_EQ(kBaseBudget * 3 / 4, controller.budget());
+    EXPECT_TRUE(controller.onMemoryPressure(6_s));
+    EXPECT_TRUE(controller.onMemoryPressure(7_s));
+    EXPECT_FALSE(controller.onMemoryPressure(8_s));
+    EXPECT_EQ(kBaseBudget / 2, controller.budget());
+
+    // no growth for a while after the pressure, even when thrashing
+    nsecs_t now = feedFrames(controller, 10_s, 8, true, kBaseBudget);
+    EXPECT_EQ(kBaseBudget / 2, controller.budget());
+    feedFrames(controller, now + 30_s, 8, true, kBaseBudget);
+    EXPECT_GT(controller.budget(), kBaseBudget / 2);
+
+    EXPECT_TRUE(controller.resetToBase(100_s));
+    EXPECT_EQ(kBaseBudget, controller.budget());
+    EXPECT_FALSE(controller.resetToBase(101_s));
+}
+
+TEST(CacheBudgetController, dumpHistory) {
+    CacheBudgetController controller;
+    controller.setBaseBudget(kBaseBudget, 1_s);
+    controller.onMemoryPressure(2_s);
+
+    String8 log;
+    controller.dump(log, 3_s);
+    EXPECT_NE(nullptr, strstr(log.string(), "base = 64.00 MB"));
+    EXPECT_NE(nullptr, strstr(log.string(), "64.00 MB -> 48.00 MB (memory pressure)"));
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "font/CacheTexture.h"
+#include "font/FontUtil.h"
+#include "tests/common/TestUtils.h"
+
+#include <vector>
+
+using namespace android::uirenderer;
+
+static SkGlyph makeGlyph(uint16_t width, uint16_t height) {
+    SkGlyph glyph;
+    glyph.fWidth = width;
+    glyph.fHeight = height;
+    glyph.fMaskFormat = SkMask::kA8_Format;
+    return glyph;
+}
+
+// Bounds of a packed glyph, including the border it owns
+static Rect glyphBounds(uint32_t x, uint32_t y, const SkGlyph& glyph) {
+    return Rect(x, y, x + glyph.fWidth + TEXTURE_BORDER_SIZE,
+                y + glyph.fHeight + TEXTURE_BORDER_SIZE);
+}
+
+RENDERTHREAD_OPENGL_PIPELINE_TEST(CacheTexture, fitBitmap_mixedSizes) {
+    CacheTexture texture(1024, 512, GL_ALPHA, 1);
+    ASSERT_EQ(2, texture.getRegionCount());
+
+    std::vector<Rect> packed;
+    const uint16_t sizes[][2] = {{12, 14}, {40, 44}, {7, 30}, {90, 20}, {25, 25}, {3, 3}};
+    for (int i = 0; i < 300; i++) {
+        SkGlyph glyph = makeGlyph(sizes[i % 6][0], sizes[i % 6][1]);
+        uint32_t x, y;
+        if (!texture.fitBitmap(glyph, &x, &y)) break;
+
+        Rect bounds = glyphBounds(x, y, glyph);
+        EXPECT_GE(bounds.left, TEXTURE_BORDER_SIZE);
+        EXPECT_GE(bounds.top, TEXTURE_BORDER_SIZE);
+        EXPECT_LE(bounds.right, texture.getWidth());
+        EXPECT_LE(bounds.bottom, texture.getHeight());
+        // glyphs never straddle two regions
+        EXPECT_EQ(texture.getRegionForX(bounds.left), texture.getRegionForX(bounds.right - 1));
+        for (auto& other : packed) {
+            EXPECT_FALSE(bounds.intersects(other));
+        }
+        packed.push_back(bounds);
+    }
+    EXPECT_EQ(packed.size(), texture.getGlyphCount());
+    EXPECT_GT(packed.size(), 200u);
+}
+
+RENDERTHREAD_OPENGL_PIPELINE_TEST(CacheTexture, evictRegion) {
+    CacheTexture texture(1024, 256, GL_ALPHA, 1);
+    ASSERT_EQ(2, texture.getRegionCount());
+
+    SkGlyph glyph = makeGlyph(60, 60);
+    uint32_t x, y;
+    uint32_t useClock = 0;
+    while (texture.fitBitmap(glyph, &x, &y)) {
+        texture.markUsed(x, ++useClock);
+    }
+
+    // the region that was filled first is used least recently
+    const uint32_t firstRegionUse = texture.getRegion(0).mLastUsed;
+    const uint32_t secondRegionUse = texture.getRegion(1).mLastUsed;
+    const int expected = firstRegionUse < secondRegionUse ? 0 : 1;
+    ASSERT_EQ(expected, texture.findEvictableRegion(glyph));
+
+    const uint16_t glyphCount = texture.getGlyphCount();
+    const uint16_t regionGlyphCount = texture.getRegion(expected).mNumGlyphs;
+    texture.evictRegion(expected);
+    EXPECT_EQ(glyphCount - regionGlyphCount, texture.getGlyphCount());
+
+    ASSERT_TRUE(texture.fitBitmap(glyph, &x, &y));
+    EXPECT_EQ(expected, texture.getRegionForX(x));
+
+    // too wide for any region
+    EXPECT_EQ(-1, texture.findEvictableRegion(makeGlyph(600, 10)));
+}
@@ -85,6 +85,24 @@ TEST(RectangleList, basics) {
     EXPECT_FALSE(rgn.isEmpty());
 }
 
+TEST(RectangleList, intersectWith_rectToRect) {
+    RectangleList list;
+    list.set(Rect(0, 0, 100, 100), Matrix4::identity());
+
+    Matrix4 m45;
+    m45.loadRotate(45);
+    list.intersectWith(Rect(0, 0, 100, 100), m45);
+    EXPECT_EQ(2, list.getTransformedRectanglesCount());
+
+    // axis aligned, so intersected with the untransformed rectangle
+    Matrix4 translateScale;
+    translateScale.loadTranslate(10, 20, 0);
+    translateScale.scale(2, 2, 1);
+    list.intersectWith(Rect(0, 0, 30, 30), translateScale);
+    EXPECT_EQ(2, list.getTransformedRectanglesCount());
+    EXPECT_EQ(Rect(10, 20, 70, 80), list.getTransformedRectangle(0).getBounds());
+}
+
 TEST(ClipArea, basics) {
     ClipArea area(createClipArea());
     EXPECT_FALSE(area.isEmpty());
@@ -119,6 +137,27 @@ TEST(ClipArea, replaceNegative) {
     EXPECT_EQ(expected, area.getClipRect());
 }
 
+TEST(ClipArea, differenceRect) {
+    ClipArea area(createClipArea());
+    area.setClip(0, 0, 100, 100);
+
+    Matrix4 translate;
+    translate.loadTranslate(50.4f, 0, 0);
+    area.clipRectWithTransform(Rect(0, 0, 100, 50), &translate, SkRegion::kDifference_Op);
+    ASSERT_FALSE(area.isSimple());
+    SkRegion expected;
+    expected.setRect(0, 0, 100, 100);
+    expected.op(SkIRect::MakeLTRB(50, 0, 100, 50), SkRegion::kDifference_Op);
+    EXPECT_EQ(expected, area.getClipRegion());
+    EXPECT_EQ(Rect(100, 100), area.getClipRect());
+
+    // collapses back to a rect once the difference is clipped out
+    area.clipRectWithTransform(Rect(0, 50, 100, 100), &Matrix4::identity(),
+                               SkRegion::kIntersect_Op);
+    EXPECT_TRUE(area.isSimple());
+    EXPECT_EQ(Rect(0, 50, 100, 100), area.getClipRect());
+}
+
 TEST(ClipArea, serializeClip) {
     ClipArea area(createClipArea());
     LinearAllocator allocator;
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "AnimationContext.h"
+#include "IContextFactory.h"
+#include "renderthread/CanvasContext.h"
+#include "renderthread/ContextUpdateBuffer.h"
+#include "tests/common/TestUtils.h"
+
+using namespace android;
+using namespace android::uirenderer;
+using namespace android::uirenderer::renderthread;
+
+namespace {
+class ContextFactory : public IContextFactory {
+public:
+    AnimationContext* createAnimationContext(renderthread::TimeLord& clock) override {
+        return new AnimationContext(clock);
+    }
+};
+}
+
+TEST(ContextUpdateBuffer, take) {
+    ContextUpdateBuffer buffer;
+    EXPECT_TRUE(buffer.isEmpty());
+    buffer.setOpaque(true);
+    buffer.setLightCenter({1, 2, 3});
+    buffer.setLightCenter({4, 5, 6});
+    EXPECT_FALSE(buffer.isEmpty());
+
+    ContextUpdateBuffer taken = buffer.take();
+    EXPECT_TRUE(buffer.isEmpty());
+    EXPECT_FALSE(taken.isEmpty());
+}
+
+RENDERTHREAD_TEST(ContextUpdateBuffer, apply) {
+    auto rootNode = TestUtils::createNode(0, 0, 200, 400, nullptr);
+    ContextFactory contextFactory;
+    std::unique_ptr<CanvasContext> canvasContext(
+            CanvasContext::create(renderThread, false, rootNode.get(), &contextFactory));
+
+    ContextUpdateBuffer buffer;
+    buffer.setup(800, 20, 40);
+    buffer.setWideGamut(false);
+    buffer.apply(*canvasContext);
+    EXPECT_TRUE(buffer.isEmpty());
+
+    canvasContext->destroy();
+}
@@ -854,6 +854,54 @@ RENDERTHREAD_OPENGL_PIPELINE_TEST(FrameBuilder, renderNode) {
     EXPECT_EQ(2, renderer.getIndex());
 }
 
+RENDERTHREAD_OPENGL_PIPELINE_TEST(FrameBuilder, parallelDeferralMatchesSerial) {
+    class ColorRecordingRenderer : public TestRendererBase {
+    public:
+        void onRectOp(const RectOp& op, const BakedOpState& state) override {
+            colors.push_back(op.paint->getColor());
+            mIndex++;
+        }
+        std::vector<SkColor> colors;
+    };
+
+    std::vector<sp<RenderNode>> children;
+    for (int i = 0; i < 8; i++) {
+        children.push_back(TestUtils::createNode<RecordingCanvas>(
+                0, 0, 200, 200, [i](RenderProperties& props, RecordingCanvas& canvas) {
+                    SkPaint paint;
+                    for (int j = 0; j < 40; j++) {
+                        // overlap the previous child, so that order matters
+                        paint.setColor(SkColorSetARGB(0xFF, i, j, 0));
+                        canvas.drawRect(j * 4, i * 10, j * 4 + 20, i * 10 + 20, paint);
+                    }
+                }));
+    }
+    auto parent = TestUtils::createNode<RecordingCanvas>(
+            0, 0, 200, 200, [&children](RenderProperties& props, RecordingCanvas& canvas) {
+                for (auto& child : children) {
+                    canvas.drawRenderNode(child.get());
+                }
+            });
+    TestUtils::syncHierarchyPropertiesAndDisplayList(parent);
+
+    auto deferAndReplay = [&parent](bool parallel) {
+        bool prevParallelDeferral = Properties::enableParallelDeferral;
+        Properties::enableParallelDeferral = parallel;
+        FrameBuilder frameBuilder(SkRect::MakeWH(200, 200), 200, 200, sLightGeometry,
+                                  Caches::getInstance());
+        frameBuilder.deferRenderNode(*parent);
+        Properties::enableParallelDeferral = prevParallelDeferral;
+
+        ColorRecordingRenderer renderer;
+        frameBuilder.replayBakedOps<TestDispatcher>(renderer);
+        return renderer.colors;
+    };
+
+    auto serialColors = deferAndReplay(false);
+    EXPECT_EQ(320u, serialColors.size());
+    EXPECT_EQ(serialColors, deferAndReplay(true));
+}
+
 RENDERTHREAD_OPENGL_PIPELINE_TEST(FrameBuilder, clipped) {
     class ClippedTestRenderer : public TestRendererBase {
     public:
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "FrameInfo.h"
+#include "renderthread/FrameDeadlinePredictor.h"
+#include "utils/TimeUtils.h"
+
+using namespace android;
+using namespace android::uirenderer;
+using namespace android::uirenderer::renderthread;
+
+static const nsecs_t kFrameInterval = 16_ms;
+
+static FrameInfo makeFrame(nsecs_t vsync, nsecs_t syncStart, nsecs_t completed) {
+    FrameInfo frame{};
+    frame.set(FrameInfoIndex::IntendedVsync) = vsync;
+    frame.set(FrameInfoIndex::Vsync) = vsync;
+    frame.set(FrameInfoIndex::SyncQueued) = syncStart;
+    frame.set(FrameInfoIndex::SyncStart) = syncStart;
+    frame.set(FrameInfoIndex::FrameCompleted) = completed;
+    return frame;
+}
+
+// Feeds "count" frames, one per frame interval starting at "start", that all take "duration"
+static nsecs_t feedFrames(FrameDeadlinePredictor& predictor, nsecs_t start, int count,
+                          nsecs_t duration) {
+    nsecs_t vsync = start;
+    for (int i = 0; i < count; i++, vsync += kFrameInterval) {
+        predictor.frameCompleted(makeFrame(vsync, vsync + 1_ms, vsync + 1_ms + duration));
+    }
+    return vsync;
+}
+
+TEST(FrameDeadlinePredictor, noFrames) {
+    FrameDeadlinePredictor predictor;
+    predictor.setFrameInterval(kFrameInterval);
+    EXPECT_EQ(0, predictor.predictedDurationNanos());
+    EXPECT_FALSE(predictor.expectsDeadlineMiss(100_ms, 200_ms));
+    EXPECT_FALSE(predictor.isUnderPressure(100_ms));
+}
+
+TEST(FrameDeadlinePredictor, predictedDuration) {
+    FrameDeadlinePredictor predictor;
+    predictor.setFrameInterval(kFrameInterval);
+    nsecs_t vsync = feedFrames(predictor, 1_s, 30, 8_ms);
+    EXPECT_GE(predictor.predictedDurationNanos(), 8_ms);
+    EXPECT_LT(predictor.predictedDurationNanos(), 10_ms);
+    EXPECT_FALSE(predictor.expectsDeadlineMiss(vsync, vsync + 2_ms));
+    EXPECT_TRUE(predictor.expectsDeadlineMiss(vsync, vsync + 10_ms));
+
+    // the prediction follows slower frames
+    vsync = feedFrames(predictor, vsync, 30, 14_ms);
+    EXPECT_GE(predictor.predictedDurationNanos(), 14_ms);
+    EXPECT_TRUE(predictor.expectsDeadlineMiss(vsync, vsync + 4_ms));
+
+    predictor.reset();
+    EXPECT_EQ(0, predictor.predictedDurationNanos());
+}
+
+TEST(FrameDeadlinePredictor, pressure) {
+    FrameDeadlinePredictor predictor;
+    predictor.setFrameInterval(kFrameInterval);
+    nsecs_t vsync = feedFrames(predictor, 1_s, 8, 8_ms);
+    EXPECT_FALSE(predictor.isUnderPressure(vsync));
+
+    // a single missed deadline isn't pressure
+    vsync = feedFrames(predictor, vsync, 1, 20_ms);
+    EXPECT_FALSE(predictor.isUnderPressure(vsync));
+    vsync = feedFrames(predictor, vsync, 1, 20_ms);
+    EXPECT_TRUE(predictor.isUnderPressure(vsync));
+
+    // nor are old misses, or misses long before now
+    EXPECT_FALSE(predictor.isUnderPressure(vsync + 1_s));
+    vsync = feedFrames(predictor, vsync, 3, 8_ms);
+    EXPECT_FALSE(predictor.isUnderPressure(vsync));
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "FrameStatsRing.h"
+
+#include <vector>
+
+using namespace android;
+using namespace android::uirenderer;
+
+static constexpr size_t kFieldCount = static_cast<size_t>(FrameInfoIndex::NumIndexes);
+
+static FrameInfo makeFrame(int64_t vsync) {
+    FrameInfo frame;
+    for (size_t i = 0; i < kFieldCount; i++) {
+        frame.set(static_cast<FrameInfoIndex>(i)) = vsync + i;
+    }
+    return frame;
+}
+
+TEST(FrameStatsRing, layout) {
+    std::vector<uint64_t> storage(
+            (sizeof(FrameStatsRingHeader) + 4 * sizeof(FrameStatsRingSlot)) / sizeof(uint64_t));
+    FrameStatsRing ring;
+    ASSERT_TRUE(ring.attach(storage.data(), storage.size() * sizeof(uint64_t)));
+
+    auto header = reinterpret_cast<const FrameStatsRingHeader*>(storage.data());
+    EXPECT_EQ(FrameStatsRingHeader::kMagic, header->magic);
+    EXPECT_EQ(FrameStatsRingHeader::kVersion, header->version);
+    EXPECT_EQ(4u, header->slotCount);
+    EXPECT_EQ(kFieldCount, header->fieldCount);
+    EXPECT_EQ(0u, header->framesWritten.load());
+}
+
+TEST(FrameStatsRing, tooSmall) {
+    std::vector<uint64_t> storage(sizeof(FrameStatsRingHeader) / sizeof(uint64_t));
+    FrameStatsRing ring;
+    EXPECT_FALSE(ring.attach(storage.data(), storage.size() * sizeof(uint64_t)));
+    EXPECT_FALSE(ring.isAttached());
+    // writing without storage is a no-op
+    ring.write(makeFrame(1));
+}
+
+TEST(FrameStatsRing, writeAndWrap) {
+    std::vector<uint64_t> storage(
+            (sizeof(FrameStatsRingHeader) + 4 * sizeof(FrameStatsRingSlot)) / sizeof(uint64_t));
+    const size_t regionSize = storage.size() * sizeof(uint64_t);
+    FrameStatsRing ring;
+    ASSERT_TRUE(ring.attach(storage.data(), regionSize));
+
+    int64_t out[kFieldCount];
+    EXPECT_FALSE(FrameStatsRing::readFrame(storage.data(), regionSize, 0, out, kFieldCount));
+
+    for (int i = 0; i < 6; i++) {
+        ring.write(makeFrame(i * 100));
+    }
+    auto header = reinterpret_cast<const FrameStatsRingHeader*>(storage.data());
+    EXPECT_EQ(6u, header->framesWritten.load());
+
+    // frames 0 and 1 have been overwritten by 4 and 5
+    EXPECT_FALSE(FrameStatsRing::readFrame(storage.data(), regionSize, 0, out, kFieldCount));
+    EXPECT_FALSE(FrameStatsRing::readFrame(storage.data(), regionSize, 1, out, kFieldCount));
+    for (int i = 2; i < 6; i++) {
+        ASSERT_TRUE(FrameStatsRing::readFrame(storage.data(), regionSize, i, out, kFieldCount));
+        for (size_t field = 0; field < kFieldCount; field++) {
+            EXPECT_EQ(i * 100 + static_cast<int64_t>(field), out[field]);
+        }
+    }
+    EXPECT_FALSE(FrameStatsRing::readFrame(storage.data(), regionSize, 6, out, kFieldCount));
+}
+
+TEST(FrameStatsRing, corruptedHeader) {
+    std::vector<uint64_t> storage(
+            (sizeof(FrameStatsRingHeader) + 4 * sizeof(FrameStatsRingSlot)) / sizeof(uint64_t));
+    const size_t regionSize = storage.size() * sizeof(uint64_t);
+    FrameStatsRing ring;
+    ASSERT_TRUE(ring.attach(storage.data(), regionSize));
+    ring.write(makeFrame(0));
+
+    // the writer keeps the layout it attached with
+    auto header = reinterpret_cast<FrameStatsRingHeader*>(storage.data());
+    header->slotCount = 0;
+    header->headerSize = 0xffffffff;
+    header->framesWritten.store(1000);
+    ring.write(makeFrame(100));
+
+    int64_t out[kFieldCount];
+    EXPECT_FALSE(FrameStatsRing::readFrame(storage.data(), regionSize, 1, out, kFieldCount));
+    header->slotCount = 4;
+    EXPECT_FALSE(FrameStatsRing::readFrame(storage.data(), regionSize, 1, out, kFieldCount));
+    header->headerSize = sizeof(FrameStatsRingHeader);
+    header->slotCount = 1000;
+    EXPECT_FALSE(FrameStatsRing::readFrame(storage.data(), regionSize, 1, out, kFieldCount));
+    header->slotCount = 4;
+    ASSERT_TRUE(FrameStatsRing::readFrame(storage.data(), regionSize, 1, out, kFieldCount));
+    EXPECT_EQ(100, out[0]);
+}
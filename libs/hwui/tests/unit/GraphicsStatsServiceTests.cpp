@@ -160,3 +160,70 @@ TEST(GraphicsStats, merge) {
         EXPECT_EQ(expectedBucket, loadedProto.histogram().Get(i).render_millis());
     }
 }
+
+TEST(GraphicsStats, convertProtoFile) {
+    std::string path = findRootPath() + "/test_convertProtoFile";
+    std::string packageName = "com.test.convertProtoFile";
+    MockProfileData mockData;
+    mockData.editJankFrameCount() = 20;
+    mockData.editTotalFrameCount() = 100;
+    for (size_t i = 0; i < mockData.editFrameCounts().size(); i++) {
+        mockData.editFrameCounts()[i] = (i % 5) + 1;
+    }
+
+    // Write a version 1 file, a header followed by the serialized proto
+    protos::GraphicsStatsProto oldProto;
+    oldProto.set_package_name(packageName);
+    oldProto.set_version_code(5);
+    oldProto.set_stats_start(3000);
+    oldProto.set_stats_end(7000);
+    oldProto.mutable_summary()->set_total_frames(10);
+    oldProto.mutable_summary()->set_janky_frames(2);
+    size_t index = 0;
+    mockData.histogramForEach([&](ProfileData::HistogramEntry entry) {
+        auto bucket = oldProto.add_histogram();
+        bucket->set_render_millis(entry.renderTimeMs);
+        bucket->set_frame_count(index++ % 3);
+    });
+    std::string serialized;
+    ASSERT_TRUE(oldProto.SerializeToString(&serialized));
+    int32_t version = 1;
+    FILE* file = fopen(path.c_str(), "w");
+    ASSERT_NE(nullptr, file);
+    fwrite(&version, sizeof(version), 1, file);
+    fwrite(serialized.data(), 1, serialized.size(), file);
+    fclose(file);
+
+    GraphicsStatsService::saveBuffer(path, packageName, 5, 2000, 8000, &mockData);
+    // A second save updates the converted file in place
+    GraphicsStatsService::saveBuffer(path, packageName, 5, 7050, 10000, &mockData);
+
+    file = fopen(path.c_str(), "r");
+    ASSERT_NE(nullptr, file);
+    EXPECT_EQ(1u, fread(&version, sizeof(version), 1, file));
+    fclose(file);
+    EXPECT_EQ(2, version);
+
+    protos::GraphicsStatsProto loadedProto;
+    EXPECT_TRUE(GraphicsStatsService::parseFromFile(path, &loadedProto));
+    // Clean up the file
+    unlink(path.c_str());
+
+    EXPECT_EQ(packageName, loadedProto.package_name());
+    EXPECT_EQ(5, loadedProto.version_code());
+    EXPECT_EQ(2000, loadedProto.stats_start());
+    EXPECT_EQ(10000, loadedProto.stats_end());
+    ASSERT_TRUE(loadedProto.has_summary());
+    EXPECT_EQ(2 + 20 * 2, loadedProto.summary().janky_frames());
+    EXPECT_EQ(10 + 100 * 2, loadedProto.summary().total_frames());
+    ASSERT_EQ(oldProto.histogram_size(), loadedProto.histogram_size());
+    for (size_t i = 0; i < (size_t)loadedProto.histogram_size(); i++) {
+        int expectedCount = i % 3;
+        if (i < mockData.editFrameCounts().size()) {
+            expectedCount += ((i % 5) + 1) * 2;
+        }
+        EXPECT_EQ(expectedCount, loadedProto.histogram().Get(i).frame_count());
+        EXPECT_EQ(oldProto.histogram().Get(i).render_millis(),
+                  loadedProto.histogram().Get(i).render_millis());
+    }
+}
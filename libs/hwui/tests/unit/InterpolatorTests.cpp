@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <Interpolator.h>
+
+#include <memory>
+
+using namespace android;
+using namespace android::uirenderer;
+
+static void expectBatchMatchesScalar(Interpolator& interpolator) {
+    const size_t count = 37;
+    float values[count];
+    for (size_t i = 0; i < count; i++) {
+        values[i] = i / (float)(count - 1);
+    }
+    interpolator.batchInterpolate(values, count);
+    for (size_t i = 0; i < count; i++) {
+        EXPECT_EQ(interpolator.interpolate(i / (float)(count - 1)), values[i]) << "input " << i;
+    }
+}
+
+static Interpolator* createLUT(float scale) {
+    float* values = new float[5];
+    for (int i = 0; i < 5; i++) {
+        values[i] = scale * i * i / 16.0f;
+    }
+    return new LUTInterpolator(values, 5);
+}
+
+TEST(Interpolator, batchInterpolate) {
+    std::unique_ptr<Interpolator> interpolators[] = {
+            std::unique_ptr<Interpolator>(new AccelerateDecelerateInterpolator()),
+            std::unique_ptr<Interpolator>(new AccelerateInterpolator(1.0f)),
+            std::unique_ptr<Interpolator>(new AccelerateInterpolator(1.5f)),
+            std::unique_ptr<Interpolator>(new AnticipateInterpolator(2.0f)),
+            std::unique_ptr<Interpolator>(new AnticipateOvershootInterpolator(2.0f)),
+            std::unique_ptr<Interpolator>(new BounceInterpolator()),
+            std::unique_ptr<Interpolator>(new CycleInterpolator(2.0f)),
+            std::unique_ptr<Interpolator>(new DecelerateInterpolator(1.0f)),
+            std::unique_ptr<Interpolator>(new DecelerateInterpolator(2.5f)),
+            std::unique_ptr<Interpolator>(new LinearInterpolator()),
+            std::unique_ptr<Interpolator>(new OvershootInterpolator(2.0f)),
+            std::unique_ptr<Interpolator>(
+                    new PathInterpolator({0.0f, 0.3f, 1.0f}, {0.0f, 0.6f, 1.0f})),
+            std::unique_ptr<Interpolator>(createLUT(1.0f)),
+    };
+    for (auto& interpolator : interpolators) {
+        expectBatchMatchesScalar(*interpolator);
+    }
+}
+
+TEST(Interpolator, isEquivalent) {
+    AccelerateDecelerateInterpolator accelerateDecelerate;
+    AccelerateInterpolator accelerate(1.0f);
+    EXPECT_TRUE(accelerateDecelerate.isEquivalent(AccelerateDecelerateInterpolator()));
+    EXPECT_FALSE(accelerateDecelerate.isEquivalent(accelerate));
+    EXPECT_FALSE(accelerate.isEquivalent(accelerateDecelerate));
+
+    // parameters are compared
+    EXPECT_TRUE(accelerate.isEquivalent(AccelerateInterpolator(1.0f)));
+    EXPECT_FALSE(accelerate.isEquivalent(AccelerateInterpolator(2.0f)));
+    EXPECT_FALSE(accelerate.isEquivalent(DecelerateInterpolator(1.0f)));
+    EXPECT_TRUE(OvershootInterpolator(2.0f).isEquivalent(OvershootInterpolator(2.0f)));
+    EXPECT_FALSE(OvershootInterpolator(2.0f).isEquivalent(AnticipateInterpolator(2.0f)));
+
+    // so are the curves of path and LUT interpolators
+    PathInterpolator path({0.0f, 0.3f, 1.0f}, {0.0f, 0.6f, 1.0f});
+    EXPECT_TRUE(path.isEquivalent(PathInterpolator({0.0f, 0.3f, 1.0f}, {0.0f, 0.6f, 1.0f})));
+    EXPECT_FALSE(path.isEquivalent(PathInterpolator({0.0f, 0.3f, 1.0f}, {0.0f, 0.7f, 1.0f})));
+    std::unique_ptr<Interpolator> lut(createLUT(1.0f));
+    std::unique_ptr<Interpolator> sameLut(createLUT(1.0f));
+    std::unique_ptr<Interpolator> otherLut(createLUT(2.0f));
+    EXPECT_TRUE(lut->isEquivalent(*sameLut));
+    EXPECT_FALSE(lut->isEquivalent(*otherLut));
+    EXPECT_FALSE(lut->isEquivalent(LinearInterpolator()));
+}
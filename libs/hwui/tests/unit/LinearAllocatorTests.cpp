@@ -130,3 +130,65 @@ TEST(LsaVector, dtorCheck) {
         EXPECT_EQ(size, destroyed);
     }
 }
+
+// Fills enough pages that the allocator grows through a few page sizes
+static void fillPages(LinearAllocator& la) {
+    for (int i = 0; i < 200; i++) {
+        la.alloc<char>(64);
+    }
+}
+
+TEST(LinearAllocator, pagePoolReusesPages) {
+    const size_t capacity = LinearAllocator::getPagePoolStats().capacity;
+    LinearAllocator::trimPagePool();
+    {
+        LinearAllocator la;
+        fillPages(la);
+    }
+    auto before = LinearAllocator::getPagePoolStats();
+    EXPECT_LT(0u, before.pooledPages);
+    EXPECT_GE(capacity, before.pooledBytes);
+
+    {
+        LinearAllocator la;
+        fillPages(la);
+    }
+    auto after = LinearAllocator::getPagePoolStats();
+    EXPECT_EQ(before.allocatedPages, after.allocatedPages);
+    EXPECT_EQ(before.reusedPages + before.pooledPages, after.reusedPages);
+    EXPECT_EQ(before.pooledPages, after.pooledPages);
+}
+
+TEST(LinearAllocator, pagePoolTrim) {
+    {
+        LinearAllocator la;
+        fillPages(la);
+    }
+    EXPECT_LT(0u, LinearAllocator::getPagePoolStats().pooledBytes);
+    LinearAllocator::trimPagePool();
+    auto stats = LinearAllocator::getPagePoolStats();
+    EXPECT_EQ(0u, stats.pooledBytes);
+    EXPECT_EQ(0u, stats.pooledPages);
+}
+
+TEST(LinearAllocator, pagePoolDisabled) {
+    const size_t capacity = LinearAllocator::getPagePoolStats().capacity;
+    {
+        LinearAllocator la;
+        fillPages(la);
+    }
+    LinearAllocator::setPagePoolCapacity(0);
+    EXPECT_EQ(0u, LinearAllocator::getPagePoolStats().pooledBytes);
+
+    auto before = LinearAllocator::getPagePoolStats();
+    {
+        LinearAllocator la;
+        fillPages(la);
+    }
+    auto after = LinearAllocator::getPagePoolStats();
+    EXPECT_LT(before.allocatedPages, after.allocatedPages);
+    EXPECT_EQ(before.reusedPages, after.reusedPages);
+    EXPECT_EQ(0u, after.pooledPages);
+
+    LinearAllocator::setPagePoolCapacity(capacity);
+}
@@ -242,3 +242,114 @@ RENDERTHREAD_OPENGL_PIPELINE_TEST(OffscreenBufferPool, clear) {
 
     EXPECT_EQ(0, GpuMemoryTracker::getInstanceCount(GpuObjectType::OffscreenBuffer));
 }
+
+RENDERTHREAD_OPENGL_PIPELINE_TEST(OffscreenBufferPool, reuseWithinBucket) {
+    OffscreenBufferPool pool;
+
+    auto layer = pool.get(renderThread.renderState(), 250u, 250u);
+    EXPECT_EQ(256u, layer->texture.width());
+    pool.putOrDelete(layer);
+
+    // 130 rounds up to 192, which is in the same power of two bucket as 256
+    auto layer2 = pool.get(renderThread.renderState(), 130u, 130u);
+    EXPECT_EQ(layer, layer2) << "larger layer of the same bucket should be recycled";
+    EXPECT_EQ(130u, layer2->viewportWidth);
+    EXPECT_EQ(130u, layer2->viewportHeight);
+    EXPECT_EQ(256u, layer2->texture.width());
+    pool.putOrDelete(layer2);
+
+    // 100 rounds up to 128, a smaller bucket
+    auto layer3 = pool.get(renderThread.renderState(), 100u, 100u);
+    EXPECT_NE(layer, layer3);
+    EXPECT_EQ(128u, layer3->texture.width());
+    pool.putOrDelete(layer3);
+
+    EXPECT_EQ(1u, pool.stats().hits);
+    EXPECT_EQ(2u, pool.stats().misses);
+    EXPECT_EQ(256u * 256u * 4u, pool.stats().reusedBytes);
+    pool.clear();
+}
+
+RENDERTHREAD_OPENGL_PIPELINE_TEST(OffscreenBufferPool, evictLeastRecentlyUsed) {
+    OffscreenBufferPool pool;
+
+    auto small = pool.get(renderThread.renderState(), 64u, 64u);
+    auto medium = pool.get(renderThread.renderState(), 128u, 128u);
+    pool.putOrDelete(small);
+    pool.putOrDelete(medium);
+    ASSERT_EQ(2u, pool.getCount());
+
+    // leaves just enough room for the medium layer, so that only the oldest layer has to go
+    const uint32_t hugeWidth =
+            (pool.getMaxSize() - medium->getSizeInBytes()) / (64u * 4u) / 64u * 64u;
+    auto huge = pool.get(renderThread.renderState(), hugeWidth, 64u);
+    ASSERT_LE(huge->getSizeInBytes() + medium->getSizeInBytes(), pool.getMaxSize());
+    ASSERT_GT(huge->getSizeInBytes() + medium->getSizeInBytes() + small->getSizeInBytes(),
+              pool.getMaxSize());
+    const uint32_t smallSize = small->getSizeInBytes();
+    pool.putOrDelete(huge);
+
+    EXPECT_EQ(2u, pool.getCount());
+    EXPECT_EQ(smallSize, pool.stats().evictedBytes);
+    EXPECT_EQ(medium, pool.get(renderThread.renderState(), 128u, 128u));
+    pool.putOrDelete(medium);
+    pool.clear();
+}
+
+RENDERTHREAD_OPENGL_PIPELINE_TEST(OffscreenBufferPool, trimKeepsRecentlyUsed) {
+    OffscreenBufferPool pool;
+
+    // a frame with two small layers in use at once, and one medium layer
+    auto small1 = pool.get(renderThread.renderState(), 64u, 64u);
+    auto small2 = pool.get(renderThread.renderState(), 64u, 64u);
+    auto medium = pool.get(renderThread.renderState(), 128u, 128u);
+    pool.putOrDelete(small1);
+    pool.putOrDelete(small2);
+    pool.putOrDelete(medium);
+    pool.endFrame(renderThread.renderState());
+    ASSERT_EQ(3u, pool.getCount());
+
+    // then many frames that only use one small layer
+    for (int i = 0; i < 10; i++) {
+        auto layer = pool.get(renderThread.renderState(), 64u, 64u);
+        pool.putOrDelete(layer);
+        pool.endFrame(renderThread.renderState());
+    }
+    EXPECT_EQ(3u, pool.getCount()) << "endFrame shouldn't drop anything";
+
+    pool.trim();
+    EXPECT_EQ(1u, pool.getCount()) << "only the layer recent frames used should be kept";
+    EXPECT_EQ(64u * 64u * 4u, pool.getSize());
+    pool.clear();
+}
+
+RENDERTHREAD_OPENGL_PIPELINE_TEST(OffscreenBufferPool, endFramePrewarms) {
+    OffscreenBufferPool pool;
+
+    // a frame with two layers in use at once
+    auto layer1 = pool.get(renderThread.renderState(), 128u, 128u);
+    auto layer2 = pool.get(renderThread.renderState(), 128u, 128u);
+    pool.putOrDelete(layer1);
+    pool.putOrDelete(layer2);
+    pool.endFrame(renderThread.renderState());
+
+    // a huge layer pushes both out of the pool, and is then used again
+    const uint32_t hugeWidth = (pool.getMaxSize() - 1) / (64u * 4u) / 64u * 64u;
+    auto huge = pool.get(renderThread.renderState(), hugeWidth, 64u);
+    ASSERT_GT(huge->getSizeInBytes() + layer1->getSizeInBytes(), pool.getMaxSize());
+    pool.putOrDelete(huge);
+    ASSERT_EQ(1u, pool.getCount());
+    ASSERT_EQ(huge, pool.get(renderThread.renderState(), hugeWidth, 64u));
+    EXPECT_EQ(0u, pool.getCount());
+
+    pool.endFrame(renderThread.renderState());
+    EXPECT_EQ(2u, pool.getCount()) << "layers recent frames needed should be allocated again";
+    EXPECT_EQ(2u, pool.stats().prewarmed);
+
+    const uint64_t hits = pool.stats().hits;
+    auto layer = pool.get(renderThread.renderState(), 128u, 128u);
+    EXPECT_EQ(hits + 1, pool.stats().hits);
+    pool.putOrDelete(layer);
+    pool.putOrDelete(huge);
+    pool.clear();
+}
@@ -153,6 +153,65 @@ OPENGL_PIPELINE_TEST(RecordingCanvas, drawRect) {
     EXPECT_EQ(Rect(10, 20, 90, 180), op.unmappedBounds);
 }
 
+OPENGL_PIPELINE_TEST(RecordingCanvas, drawRect_compacted) {
+    ScopedProperty<bool> prop(Properties::compactRecordedOps, true);
+    auto dl = TestUtils::createDisplayList<RecordingCanvas>(200, 200, [](RecordingCanvas& canvas) {
+        SkPaint paint;
+        paint.setColor(SK_ColorBLUE);
+        canvas.drawRect(0, 0, 10, 10, paint);
+        canvas.drawRect(20, 0, 30, 10, paint);
+        canvas.drawRect(40, 0, 50, 10, SkPaint(paint));
+
+        // transform change ends the run
+        canvas.translate(0, 100);
+        canvas.drawRect(0, 0, 10, 10, paint);
+
+        // as does any other op, and a run of one stays a RectOp
+        canvas.drawColor(SK_ColorWHITE, SkBlendMode::kSrcOver);
+        canvas.drawRect(0, 0, 10, 10, paint);
+        paint.setAntiAlias(true);
+        canvas.drawRect(20, 0, 30, 10, paint);
+        canvas.drawRect(40, 0, 50, 10, paint);
+    });
+
+    auto&& ops = dl->getOps();
+    ASSERT_EQ(6u, ops.size());
+    ASSERT_EQ(RecordedOpId::SimpleRectsOp, ops[0]->opId);
+    auto&& rectsOp = static_cast<const SimpleRectsOp&>(*ops[0]);
+    EXPECT_EQ(12u, rectsOp.vertexCount);
+    EXPECT_EQ(Rect(0, 0, 50, 10), rectsOp.unmappedBounds);
+    EXPECT_EQ(40, rectsOp.vertices[8].x);
+    EXPECT_EQ(SK_ColorBLUE, rectsOp.paint->getColor());
+    EXPECT_TRUE(rectsOp.localMatrix.isIdentity());
+
+    EXPECT_EQ(RecordedOpId::RectOp, ops[1]->opId);
+    EXPECT_EQ(100, ops[1]->localMatrix.getTranslateY());
+    EXPECT_EQ(RecordedOpId::ColorOp, ops[2]->opId);
+    EXPECT_EQ(RecordedOpId::RectOp, ops[3]->opId);
+    // antialiased rects aren't compacted
+    EXPECT_EQ(RecordedOpId::RectOp, ops[4]->opId);
+    EXPECT_EQ(RecordedOpId::RectOp, ops[5]->opId);
+}
+
+OPENGL_PIPELINE_TEST(RecordingCanvas, drawRect_compactedBeforeBarrier) {
+    ScopedProperty<bool> prop(Properties::compactRecordedOps, true);
+    auto dl = TestUtils::createDisplayList<RecordingCanvas>(200, 200, [](RecordingCanvas& canvas) {
+        canvas.drawRect(0, 0, 10, 10, SkPaint());
+        canvas.drawRect(20, 0, 30, 10, SkPaint());
+        canvas.insertReorderBarrier(true);
+        canvas.drawRect(40, 0, 50, 10, SkPaint());
+    });
+
+    auto&& chunks = dl->getChunks();
+    ASSERT_EQ(2u, chunks.size());
+    EXPECT_EQ(0u, chunks[0].beginOpIndex);
+    EXPECT_EQ(1u, chunks[0].endOpIndex);
+    EXPECT_EQ(RecordedOpId::SimpleRectsOp, dl->getOps()[0]->opId);
+    EXPECT_EQ(1u, chunks[1].beginOpIndex);
+    EXPECT_EQ(2u, chunks[1].endOpIndex);
+    EXPECT_EQ(RecordedOpId::RectOp, dl->getOps()[1]->opId);
+}
+
 OPENGL_PIPELINE_TEST(RecordingCanvas, drawRoundRect) {
     // Round case - stays rounded
     auto dl = TestUtils::createDisplayList<RecordingCanvas>(100, 200, [](RecordingCanvas& canvas) {
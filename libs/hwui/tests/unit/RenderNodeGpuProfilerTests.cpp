@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "RenderNodeGpuProfiler.h"
+#include "tests/common/TestUtils.h"
+
+#include <GLES2/gl2.h>
+
+using namespace android;
+using namespace android::uirenderer;
+
+RENDERTHREAD_OPENGL_PIPELINE_TEST(RenderNodeGpuProfiler, timesNestedNodes) {
+    std::unique_ptr<RenderNodeGpuProfiler> profiler = RenderNodeGpuProfiler::create();
+    if (!profiler) return;  // GPU timestamps aren't supported
+
+    auto parent = TestUtils::createNode(0, 0, 100, 100, nullptr);
+    parent->setName("parent");
+    auto child = TestUtils::createNode(0, 0, 50, 50, nullptr);
+    child->setName("child");
+
+    EXPECT_EQ(nullptr, RenderNodeGpuProfiler::active());
+    profiler->beginFrame(7);
+    EXPECT_EQ(profiler.get(), RenderNodeGpuProfiler::active());
+    ASSERT_TRUE(profiler->beginNode(*parent));
+    ASSERT_TRUE(profiler->beginNode(*child));
+    profiler->endNode();
+    profiler->endNode();
+    profiler->endFrame();
+    EXPECT_EQ(nullptr, RenderNodeGpuProfiler::active());
+
+    glFinish();
+    std::vector<RenderNodeGpuTime> times;
+    profiler->collectResults(&times);
+    if (times.empty()) return;  // the GPU timer was disjoint
+    ASSERT_EQ(2u, times.size());
+    EXPECT_EQ("parent", times[0].name);
+    EXPECT_EQ("child", times[1].name);
+    EXPECT_EQ(7, times[0].frameNumber);
+    EXPECT_EQ(reinterpret_cast<uint64_t>(parent.get()), times[0].nodeId);
+    EXPECT_GE(times[0].durationNanos, times[1].durationNanos);
+}
+
+RENDERTHREAD_OPENGL_PIPELINE_TEST(RenderNodeGpuProfiler, nodeLimit) {
+    std::unique_ptr<RenderNodeGpuProfiler> profiler = RenderNodeGpuProfiler::create();
+    if (!profiler) return;
+
+    auto node = TestUtils::createNode(0, 0, 100, 100, nullptr);
+    profiler->beginFrame(1);
+    int timed = 0;
+    for (int i = 0; i < 100; i++) {
+        if (profiler->beginNode(*node)) {
+            profiler->endNode();
+            timed++;
+        }
+    }
+    profiler->endFrame();
+    EXPECT_EQ(64, timed);
+}
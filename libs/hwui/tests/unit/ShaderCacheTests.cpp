@@ -24,7 +24,7 @@
 #include <sys/types.h>
 #include <utils/Log.h>
 #include "pipeline/skia/ShaderCache.h"
-#include "FileBlobCache.h"
+#include "pipeline/skia/ShaderBlobStore.h"
 
 using namespace android::uirenderer::skiapipeline;
 
@@ -48,10 +48,24 @@ public:
      */
     static void terminate(ShaderCache& cache, bool saveContent) {
         std::lock_guard<std::mutex> lock(cache.mMutex);
-        if (cache.mInitialized && cache.mBlobCache && saveContent) {
-            cache.mBlobCache->writeToFile();
+        if (cache.mInitialized && cache.mBlobStore && saveContent) {
+            cache.mBlobStore->writeToFile();
         }
-        cache.mBlobCache = NULL;
+        cache.mBlobStore = NULL;
+    }
+
+    /**
+     * "waitForWarmUp" blocks until the warm up started by "initShaderDiskCache" is done.
+     */
+    static void waitForWarmUp(ShaderCache& cache) {
+        std::unique_lock<std::mutex> lock(cache.mMutex);
+        cache.mWarmUpCondition.wait(lock, [&cache]() { return !cache.mWarmUpPending; });
+    }
+
+    static bool isWarm(ShaderCache& cache, const SkData& key) {
+        std::lock_guard<std::mutex> lock(cache.mMutex);
+        return cache.mBlobStore->isResident(
+                std::string(reinterpret_cast<const char*>(key.data()), key.size()));
     }
 };
 
@@ -173,4 +187,129 @@ TEST(ShaderCacheTest, testWriteAndRead) {
     remove(cacheFile1.c_str());
 }
 
+TEST(ShaderCacheTest, testWarmUp) {
+    if (!folderExist(getExternalStorageFolder())) {
+        //don't run the test if external storage folder is not available
+        return;
+    }
+    std::string cacheFile = getExternalStorageFolder() + "/shaderCacheTestWarmUp";
+    remove(cacheFile.c_str());
+
+    ShaderCache::get().setFilename(cacheFile.c_str());
+    ShaderCacheTestUtils::setSaveDelay(ShaderCache::get(), 0); //disable deferred save
+    ShaderCache::get().initShaderDiskCache();
+    ShaderCacheTestUtils::waitForWarmUp(ShaderCache::get());
+
+    //store more entries than warm up covers, and use the first few of them
+    sk_sp<SkData> inVS;
+    for (int i = 0; i < 40; i++) {
+        setShader(inVS, ("VS" + std::to_string(i)).c_str());
+        ShaderCache::get().store(*SkData::MakeWithCString(std::to_string(i).c_str()), *inVS);
+    }
+    for (int i = 0; i < 8; i++) {
+        for (int run = 0; run < 2; run++) {
+            ASSERT_NE(ShaderCache::get().load(*SkData::MakeWithCString(std::to_string(i).c_str())),
+                      sk_sp<SkData>());
+        }
+    }
+
+    //the used entries are warmed up by the next run, the least recently stored ones are not
+    ShaderCacheTestUtils::terminate(ShaderCache::get(), true);
+    ShaderCache::get().initShaderDiskCache();
+    ShaderCacheTestUtils::waitForWarmUp(ShaderCache::get());
+    for (int i = 0; i < 8; i++) {
+        ASSERT_TRUE(ShaderCacheTestUtils::isWarm(
+                ShaderCache::get(), *SkData::MakeWithCString(std::to_string(i).c_str())));
+    }
+    ASSERT_FALSE(ShaderCacheTestUtils::isWarm(ShaderCache::get(), *SkData::MakeWithCString("8")));
+
+    //warm entries load the same value
+    sk_sp<SkData> outVS;
+    ASSERT_NE((outVS = ShaderCache::get().load(*SkData::MakeWithCString("3"))), sk_sp<SkData>());
+    ASSERT_TRUE(checkShader(outVS, "VS3"));
+
+    ShaderCacheTestUtils::terminate(ShaderCache::get(), false);
+    remove(cacheFile.c_str());
+}
+
+TEST(ShaderBlobStoreTest, evictsFewestHitsPerByte) {
+    ShaderBlobStore store(1024, 64 * 1024, 8 * 1024, "");
+    std::vector<char> smallValue(256, 's');
+    std::vector<char> largeValue(4000, 'l');
+    std::vector<char> mediumValue(1024, 'm');
+
+    //small entries used by every frame
+    for (int i = 0; i < 10; i++) {
+        std::string key = "small" + std::to_string(i);
+        store.set(key.data(), key.size(), smallValue.data(), smallValue.size());
+        for (int hit = 0; hit < 5; hit++) {
+            ASSERT_NE(store.get(key.data(), key.size()), sk_sp<SkData>());
+        }
+    }
+    //a large entry used once
+    store.set("large", 5, largeValue.data(), largeValue.size());
+    ASSERT_EQ(0u, store.stats().evictions);
+
+    //new entries push out the large entry rather than many of the small ones
+    store.set("medium0", 7, mediumValue.data(), mediumValue.size());
+    store.set("medium1", 7, mediumValue.data(), mediumValue.size());
+    ASSERT_EQ(1u, store.stats().evictions);
+    ASSERT_EQ(store.get("large", 5), sk_sp<SkData>());
+    for (int i = 0; i < 10; i++) {
+        std::string key = "small" + std::to_string(i);
+        ASSERT_NE(store.get(key.data(), key.size()), sk_sp<SkData>());
+    }
+    ASSERT_NE(store.get("medium1", 7), sk_sp<SkData>());
+    ASSERT_LE(store.totalSize(), store.maxTotalSize());
+    ASSERT_EQ(1u, store.stats().misses);
+}
+
+TEST(ShaderBlobStoreTest, persistsHitCounts) {
+    if (!folderExist(getExternalStorageFolder())) {
+        //don't run the test if external storage folder is not available
+        return;
+    }
+    std::string cacheFile = getExternalStorageFolder() + "/shaderBlobStoreTest";
+    remove(cacheFile.c_str());
+
+    {
+        ShaderBlobStore store(1024, 64 * 1024, 512 * 1024, cacheFile);
+        store.set("cold", 4, "coldVS", 6);
+        store.set("hot", 3, "hotVS", 5);
+        for (int hit = 0; hit < 4; hit++) {
+            store.get("hot", 3);
+        }
+        store.writeToFile();
+    }
+
+    ShaderBlobStore store(1024, 64 * 1024, 512 * 1024, cacheFile);
+    ASSERT_EQ(2u, store.size());
+    std::vector<std::string> keys = store.mostUsedKeys(1);
+    ASSERT_EQ(1u, keys.size());
+    ASSERT_EQ("hot", keys[0]);
+    ASSERT_FALSE(store.isResident("hot"));
+    sk_sp<SkData> value = store.get("hot", 3);
+    ASSERT_NE(value, sk_sp<SkData>());
+    ASSERT_EQ(0, memcmp(value->data(), "hotVS", 5));
+
+    //a copy of a value that was replaced in the meantime is dropped
+    sk_sp<SkData> mapped = store.mappedValue("cold");
+    ASSERT_NE(mapped, sk_sp<SkData>());
+    sk_sp<SkData> copy = SkData::MakeWithCopy(mapped->data(), mapped->size());
+    store.set("cold", 4, "newVS", 5);
+    ASSERT_EQ(0u, store.makeResident("cold", mapped, copy));
+    value = store.get("cold", 4);
+    ASSERT_EQ(0, memcmp(value->data(), "newVS", 5));
+
+    //a copy of the current value is kept
+    mapped = store.mappedValue("hot");
+    ASSERT_NE(mapped, sk_sp<SkData>());
+    ASSERT_EQ(5u, store.makeResident("hot", mapped,
+                                     SkData::MakeWithCopy(mapped->data(), mapped->size())));
+    ASSERT_TRUE(store.isResident("hot"));
+    ASSERT_EQ(store.mappedValue("hot"), sk_sp<SkData>());
+
+    remove(cacheFile.c_str());
+}
+
 }  // namespace
@@ -173,3 +173,49 @@ TEST(SkiaDisplayList, updateChildren) {
     skiaDL.mChildNodes.emplace_back(renderNode.get(), &dummyCanvas);
     skiaDL.updateChildren([renderNode](RenderNode* n) { ASSERT_EQ(renderNode.get(), n); });
 }
+
+TEST(SkiaDisplayList, hasSameContent) {
+    SkPaint paint;
+    paint.setColor(SK_ColorRED);
+    SkCanvas dummyCanvas;
+    sp<RenderNode> renderNode = new RenderNode();
+
+    SkiaDisplayList first;
+    first.mDisplayList.drawRect(SkRect::MakeWH(200, 200), paint);
+    first.mChildNodes.emplace_back(renderNode.get(), &dummyCanvas);
+    first.mDisplayList.drawDrawable(&first.mChildNodes.back(), nullptr);
+
+    SkiaDisplayList second;
+    second.mDisplayList.drawRect(SkRect::MakeWH(200, 200), paint);
+    second.mChildNodes.emplace_back(renderNode.get(), &dummyCanvas);
+    second.mDisplayList.drawDrawable(&second.mChildNodes.back(), nullptr);
+
+    ASSERT_TRUE(first.hasSameContent(second));
+    ASSERT_TRUE(second.hasSameContent(first));
+
+    // different ops
+    second.reset();
+    paint.setColor(SK_ColorBLUE);
+    second.mDisplayList.drawRect(SkRect::MakeWH(200, 200), paint);
+    second.mChildNodes.emplace_back(renderNode.get(), &dummyCanvas);
+    second.mDisplayList.drawDrawable(&second.mChildNodes.back(), nullptr);
+    ASSERT_FALSE(first.hasSameContent(second));
+
+    // different child
+    sp<RenderNode> otherNode = new RenderNode();
+    second.reset();
+    paint.setColor(SK_ColorRED);
+    second.mDisplayList.drawRect(SkRect::MakeWH(200, 200), paint);
+    second.mChildNodes.emplace_back(otherNode.get(), &dummyCanvas);
+    second.mDisplayList.drawDrawable(&second.mChildNodes.back(), nullptr);
+    ASSERT_FALSE(first.hasSameContent(second));
+
+    // content with its own state never compares equal
+    second.reset();
+    second.mDisplayList.drawRect(SkRect::MakeWH(200, 200), paint);
+    second.mChildNodes.emplace_back(renderNode.get(), &dummyCanvas);
+    second.mDisplayList.drawDrawable(&second.mChildNodes.back(), nullptr);
+    ASSERT_TRUE(first.hasSameContent(second));
+    second.mChildFunctors.emplace_back(nullptr, nullptr, &dummyCanvas);
+    ASSERT_FALSE(first.hasSameContent(second));
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "PathTessellator.h"
+#include "TessellationCache.h"
+#include "VertexBuffer.h"
+#include "tests/common/TestUtils.h"
+
+#include <SkPath.h>
+
+using namespace android;
+using namespace android::uirenderer;
+
+RENDERTHREAD_OPENGL_PIPELINE_TEST(TessellationCache, rectMatchesPathTessellation) {
+    TessellationCache cache;
+    SkPaint paint;
+    paint.setAntiAlias(true);
+    Matrix4 transform;
+    transform.loadRotate(30);
+
+    SkPath path;
+    path.addRect(SkRect::MakeWH(100, 50));
+    VertexBuffer expected;
+    PathTessellator::tessellatePath(path, &paint, transform, expected);
+
+    const VertexBuffer* buffer = cache.getRect(transform, paint, 100, 50);
+    ASSERT_NE(nullptr, buffer);
+    ASSERT_EQ(expected.getVertexCount(), buffer->getVertexCount());
+    EXPECT_EQ(expected.getBounds(), buffer->getBounds());
+    EXPECT_EQ(0, memcmp(expected.getBuffer(), buffer->getBuffer(),
+                        expected.getVertexCount() * sizeof(AlphaVertex)));
+
+    // the translation of the transform doesn't matter, only the size and the scale do
+    Matrix4 translated(transform);
+    translated.translate(20, 40);
+    EXPECT_EQ(buffer, cache.getRect(translated, paint, 100, 50));
+    EXPECT_NE(buffer, cache.getRect(transform, paint, 100, 60));
+    EXPECT_NE(buffer, cache.getOval(transform, paint, 100, 50));
+}
+
+RENDERTHREAD_OPENGL_PIPELINE_TEST(TessellationCache, strokeAndFillOutset) {
+    TessellationCache cache;
+    SkPaint paint;
+    paint.setStyle(SkPaint::kStrokeAndFill_Style);
+    paint.setStrokeWidth(10);
+
+    // the fill is outset by half the stroke width, like BakedOpDispatcher's getBoundsOfFill()
+    SkPath path;
+    path.addOval(SkRect::MakeLTRB(-5, -5, 105, 55));
+    VertexBuffer expected;
+    PathTessellator::tessellatePath(path, &paint, Matrix4::identity(), expected);
+
+    const VertexBuffer* buffer = cache.getOval(Matrix4::identity(), paint, 100, 50);
+    ASSERT_NE(nullptr, buffer);
+    EXPECT_EQ(expected.getVertexCount(), buffer->getVertexCount());
+    EXPECT_EQ(expected.getBounds(), buffer->getBounds());
+}
+
+RENDERTHREAD_OPENGL_PIPELINE_TEST(TessellationCache, precacheArc) {
+    TessellationCache cache;
+    SkPaint paint;
+    paint.setStyle(SkPaint::kStroke_Style);
+    paint.setStrokeWidth(4);
+
+    cache.precacheArc(Matrix4::identity(), paint, 100, 100, 0, 90);
+    const VertexBuffer* buffer = cache.getArc(Matrix4::identity(), paint, 100, 100, 0, 90);
+    ASSERT_NE(nullptr, buffer);
+    EXPECT_GT(buffer->getVertexCount(), 0u);
+    EXPECT_EQ(buffer, cache.getArc(Matrix4::identity(), paint, 100, 100, 0, 90));
+    EXPECT_NE(buffer, cache.getArc(Matrix4::identity(), paint, 100, 100, 0, 180));
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "PathTessellator.h"
+#include "TessellationDiskCache.h"
+#include "Vertex.h"
+#include "VertexBuffer.h"
+#include "pipeline/skia/ShaderBlobStore.h"
+
+#include <SkPath.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <memory>
+
+using namespace android;
+using namespace android::uirenderer;
+
+namespace android {
+namespace uirenderer {
+
+class TessellationDiskCacheTestUtils {
+public:
+    static void setSaveDelay(TessellationDiskCache& cache, unsigned int saveDelay) {
+        std::lock_guard<std::mutex> lock(cache.mMutex);
+        cache.mDeferredSaveDelay = saveDelay;
+    }
+
+    static void save(TessellationDiskCache& cache) {
+        std::lock_guard<std::mutex> lock(cache.mMutex);
+        if (cache.mStore) cache.mStore->writeToFile();
+    }
+};
+
+};  // namespace uirenderer
+};  // namespace android
+
+static bool sameBuffer(const VertexBuffer& lhs, const VertexBuffer& rhs, size_t vertexSize) {
+    if (lhs.getVertexCount() != rhs.getVertexCount() ||
+        lhs.getIndexCount() != rhs.getIndexCount() ||
+        lhs.getMeshFeatureFlags() != rhs.getMeshFeatureFlags() ||
+        lhs.getBounds() != rhs.getBounds()) {
+        return false;
+    }
+    if (memcmp(lhs.getBuffer(), rhs.getBuffer(), lhs.getVertexCount() * vertexSize)) {
+        return false;
+    }
+    return !lhs.getIndexCount() ||
+           !memcmp(lhs.getIndices(), rhs.getIndices(), lhs.getIndexCount() * sizeof(uint16_t));
+}
+
+class TessellationDiskCacheTest : public testing::Test {
+protected:
+    void SetUp() override {
+        const char* storage = getenv("EXTERNAL_STORAGE");
+        mCacheFile = std::string(storage ? storage : "/data/local/tmp") + "/tessellationCacheTest";
+        int deleteFile = remove(mCacheFile.c_str());
+        ASSERT_TRUE(0 == deleteFile || ENOENT == errno);
+        // saved explicitly below
+        TessellationDiskCacheTestUtils::setSaveDelay(TessellationDiskCache::get(), 0);
+        TessellationDiskCache::get().setFilename(mCacheFile.c_str());
+    }
+
+    void TearDown() override {
+        TessellationDiskCache::get().setFilename("");
+        remove(mCacheFile.c_str());
+    }
+
+    // Saves the cache and drops it, so that the next lookup loads it from the file
+    void reload() {
+        TessellationDiskCacheTestUtils::save(TessellationDiskCache::get());
+        TessellationDiskCache::get().setFilename(mCacheFile.c_str());
+    }
+
+    std::string mCacheFile;
+};
+
+TEST_F(TessellationDiskCacheTest, shape) {
+    SkPaint paint;
+    paint.setAntiAlias(true);
+    TessellationCache::Description description(TessellationCache::Description::Type::RoundRect,
+                                               Matrix4::identity(), paint);
+    description.shape.roundRect.width = 100;
+    description.shape.roundRect.height = 50;
+    description.shape.roundRect.rx = 8;
+    description.shape.roundRect.ry = 8;
+
+    SkPath path;
+    path.addRoundRect(SkRect::MakeWH(100, 50), 8, 8);
+    VertexBuffer expected;
+    PathTessellator::tessellatePath(path, &paint, Matrix4::identity(), expected);
+    ASSERT_TRUE(expected.getVertexCount());
+
+    TessellationDiskCache& cache = TessellationDiskCache::get();
+    EXPECT_EQ(nullptr, cache.loadShape(description));
+    cache.storeShape(description, expected);
+    reload();
+
+    std::unique_ptr<VertexBuffer> loaded(cache.loadShape(description));
+    ASSERT_NE(nullptr, loaded.get());
+    EXPECT_TRUE(sameBuffer(expected, *loaded, sizeof(AlphaVertex)));
+
+    // any other description is a miss
+    description.shape.roundRect.rx = 9;
+    EXPECT_EQ(nullptr, cache.loadShape(description));
+}
+
+TEST_F(TessellationDiskCacheTest, shadows) {
+    SkPath casterPerimeter;
+    casterPerimeter.addRoundRect(SkRect::MakeWH(200, 100), 10, 10);
+    Matrix4 drawTransform;
+    drawTransform.loadTranslate(20, 40, 0);
+    Matrix4 transformZ;
+    transformZ.loadTranslate(0, 0, 16);
+    const Rect localClip(-100, -100, 300, 200);
+    const Vector3 lightCenter = {540, -200, 600};
+
+    TessellationCache::ShadowTask expected(&drawTransform, localClip, true, &casterPerimeter,
+                                           &drawTransform, &transformZ, lightCenter, 800);
+    tessellateShadows(&drawTransform, &localClip, true, &casterPerimeter, &drawTransform,
+                      &transformZ, lightCenter, 800, expected.ambientBuffer, expected.spotBuffer);
+    ASSERT_TRUE(expected.ambientBuffer.getVertexCount());
+    ASSERT_TRUE(expected.spotBuffer.getVertexCount());
+
+    TessellationDiskCache& cache = TessellationDiskCache::get();
+    cache.storeShadows(expected);
+    reload();
+
+    TessellationCache::ShadowTask loaded(&drawTransform, localClip, true, &casterPerimeter,
+                                         &drawTransform, &transformZ, lightCenter, 800);
+    ASSERT_TRUE(cache.loadShadows(loaded));
+    EXPECT_TRUE(sameBuffer(expected.ambientBuffer, loaded.ambientBuffer, sizeof(AlphaVertex)));
+    EXPECT_TRUE(sameBuffer(expected.spotBuffer, loaded.spotBuffer, sizeof(AlphaVertex)));
+
+    // a different caster shape is a miss, and leaves the buffers alone
+    SkPath otherPerimeter;
+    otherPerimeter.addRect(SkRect::MakeWH(200, 100));
+    TessellationCache::ShadowTask other(&drawTransform, localClip, true, &otherPerimeter,
+                                        &drawTransform, &transformZ, lightCenter, 800);
+    EXPECT_FALSE(cache.loadShadows(other));
+    EXPECT_EQ(0u, other.ambientBuffer.getVertexCount());
+}
+
+TEST_F(TessellationDiskCacheTest, disabledWithoutFile) {
+    TessellationDiskCache& cache = TessellationDiskCache::get();
+    cache.setFilename("");
+
+    TessellationCache::Description description;
+    VertexBuffer buffer;
+    AlphaVertex::set(buffer.alloc<AlphaVertex>(1), 0, 0, 1);
+    buffer.setMeshFeatureFlags(VertexBuffer::kAlpha);
+    cache.storeShape(description, buffer);
+    EXPECT_EQ(nullptr, cache.loadShape(description));
+}
@@ -16,10 +16,15 @@
 
 #include <gtest/gtest.h>
 
+#include "Caches.h"
 #include "Extensions.h"
+#include "Properties.h"
+#include "Texture.h"
 #include "TextureCache.h"
 #include "tests/common/TestUtils.h"
 
+#include <unistd.h>
+
 using namespace android;
 using namespace android::uirenderer;
 
@@ -37,3 +42,66 @@ RENDERTHREAD_OPENGL_PIPELINE_TEST(TextureCache, clear) {
     cache.clear();
     ASSERT_EQ(GpuMemoryTracker::getInstanceCount(GpuObjectType::Texture), initialCount);
 }
+
+RENDERTHREAD_OPENGL_PIPELINE_TEST(TextureCache, asyncUpload) {
+    if (Caches::getInstance().extensions().getMajorGlVersion() < 3) return;
+    const bool prevAsyncUpload = Properties::enableAsyncTextureUpload;
+    Properties::enableAsyncTextureUpload = true;
+    {
+        TextureCache cache;
+        // large enough to be uploaded on the upload thread
+        sk_sp<Bitmap> bitmap = TestUtils::createBitmap(512, 512);
+        bitmap->setImmutable();
+        EXPECT_TRUE(cache.prefetch(bitmap.get()));
+
+        Texture* texture = nullptr;
+        for (int i = 0; !texture && i < 1000; i++) {
+            texture = cache.get(bitmap.get());
+            if (!texture) usleep(1000);
+        }
+        ASSERT_NE(nullptr, texture) << "Upload didn't finish within 1 second";
+        EXPECT_FALSE(texture->hasPendingUpload());
+        EXPECT_NE(0u, texture->id());
+        EXPECT_EQ(512u, texture->width());
+        EXPECT_EQ(512u, texture->height());
+
+        // small bitmaps are still uploaded right away
+        sk_sp<Bitmap> smallBitmap = TestUtils::createBitmap(16, 16);
+        Texture* smallTexture = cache.get(smallBitmap.get());
+        ASSERT_NE(nullptr, smallTexture);
+        EXPECT_FALSE(smallTexture->hasPendingUpload());
+
+        // mutable bitmaps may be drawn into during the upload, they are uploaded right away too
+        sk_sp<Bitmap> mutableBitmap = TestUtils::createBitmap(512, 512);
+        Texture* mutableTexture = cache.get(mutableBitmap.get());
+        ASSERT_NE(nullptr, mutableTexture);
+        EXPECT_FALSE(mutableTexture->hasPendingUpload());
+
+        cache.clear();
+        cache.destroyUploader();
+    }
+    Properties::enableAsyncTextureUpload = prevAsyncUpload;
+}
+
+RENDERTHREAD_OPENGL_PIPELINE_TEST(TextureCache, writableHardwareBitmap) {
+    SkBitmap skBitmap;
+    skBitmap.setInfo(SkImageInfo::Make(100, 100, kRGBA_8888_SkColorType, kPremul_SkAlphaType));
+    sk_sp<Bitmap> hwBitmap = Bitmap::allocateWritableHardwareBitmap(&skBitmap);
+    ASSERT_NE(nullptr, hwBitmap.get());
+    EXPECT_TRUE(hwBitmap->isHardware());
+    ASSERT_NE(nullptr, skBitmap.getPixels());
+    EXPECT_GE(skBitmap.rowBytes(), skBitmap.info().minRowBytes());
+    skBitmap.eraseColor(SK_ColorRED);
+    skBitmap.reset();
+    hwBitmap->unlockPixels();
+
+    TextureCache cache;
+    EXPECT_NE(nullptr, cache.get(hwBitmap.get()));
+    cache.clear();
+
+    // other color types are decoded into the heap and uploaded
+    SkBitmap rgb565Bitmap;
+    rgb565Bitmap.setInfo(SkImageInfo::Make(100, 100, kRGB_565_SkColorType, kOpaque_SkAlphaType));
+    EXPECT_EQ(nullptr, Bitmap::allocateWritableHardwareBitmap(&rgb565Bitmap).get());
+    EXPECT_EQ(nullptr, rgb565Bitmap.getPixels());
+}
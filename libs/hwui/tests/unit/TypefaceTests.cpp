@@ -342,6 +342,21 @@ TEST(TypefaceTest, createAbsolute) {
     EXPECT_EQ(Typeface::kBold, over1000->fAPIStyle);
 }
 
+TEST(TypefaceTest, createFromFamilies_SharesCollection) {
+    std::vector<std::shared_ptr<minikin::FontFamily>> families =
+            makeSingleFamlyVector(kRobotoRegular);
+    std::unique_ptr<Typeface> regular(Typeface::createFromFamilies(
+            std::vector<std::shared_ptr<minikin::FontFamily>>(families), 400, false));
+    std::unique_ptr<Typeface> bold(Typeface::createFromFamilies(
+            std::vector<std::shared_ptr<minikin::FontFamily>>(families), 700, false));
+    EXPECT_EQ(regular->fFontCollection, bold->fFontCollection);
+    EXPECT_EQ(700, bold->fBaseWeight);
+
+    std::unique_ptr<Typeface> other(
+            Typeface::createFromFamilies(makeSingleFamlyVector(kRobotoRegular), 400, false));
+    EXPECT_NE(regular->fFontCollection, other->fFontCollection);
+}
+
 TEST(TypefaceTest, createFromFamilies_Single) {
     // In Java, new
     // Typeface.Builder("Roboto-Regular.ttf").setWeight(400).setItalic(false).build();
@@ -160,4 +160,66 @@ RENDERTHREAD_SKIA_PIPELINE_TEST(VectorDrawableAtlas, repack) {
     atlas.repackIfNeeded(renderThread.getGrContext());
 
     ASSERT_FALSE(atlas.isFragmented());
-}
\ No newline at end of file
+}
+RENDERTHREAD_SKIA_PIPELINE_TEST(VectorDrawableAtlas, grow) {
+    VectorDrawableAtlas atlas(100 * 100, VectorDrawableAtlas::StorageMode::allowSharedSurface,
+                              400 * 400);
+    atlas.prepareForDraw(renderThread.getGrContext());
+    // create 150 rects 10x10, which won't fit in the initial atlas
+    const int MAX_RECTS = 150;
+    AtlasEntry VDRects[MAX_RECTS];
+    for (uint32_t i = 0; i < MAX_RECTS; i++) {
+        VDRects[i] = atlas.requestNewEntry(10, 10, renderThread.getGrContext());
+        ASSERT_TRUE(VDRects[i].key != INVALID_ATLAS_KEY);
+    }
+
+    VectorDrawableAtlas::Stats stats = atlas.getStats();
+    EXPECT_EQ(100u * 100u, stats.surfaceArea);
+    EXPECT_EQ(400u * 400u, stats.maxSurfaceArea);
+    EXPECT_EQ((size_t)MAX_RECTS, stats.entries);
+    EXPECT_GT(stats.fallbackSurfaces, 0u);
+    EXPECT_EQ(stats.fallbackSurfaces, stats.fallbackSurfacesCreated);
+    ASSERT_FALSE(atlas.isFragmented());
+
+    // the first step grows the atlas, but doesn't move all the rects
+    atlas.repackIfNeeded(renderThread.getGrContext());
+    stats = atlas.getStats();
+    EXPECT_TRUE(stats.repackInProgress);
+    EXPECT_EQ(1u, stats.growCount);
+    EXPECT_GT(stats.surfaceArea, 100u * 100u);
+
+    // entries stay valid while the repack is in progress
+    for (uint32_t i = 0; i < MAX_RECTS; i += 3) {
+        AtlasEntry entry = atlas.getEntry(VDRects[i].key);
+        ASSERT_TRUE(entry.surface.get() != nullptr);
+        atlas.releaseEntry(entry.key);
+        VDRects[i].key = INVALID_ATLAS_KEY;
+    }
+
+    for (int i = 0; i < 100 && (stats.repackInProgress || stats.fallbackSurfaces); i++) {
+        atlas.repackIfNeeded(renderThread.getGrContext());
+        stats = atlas.getStats();
+    }
+    EXPECT_FALSE(stats.repackInProgress);
+    EXPECT_EQ(0u, stats.fallbackSurfaces);
+    EXPECT_LE(stats.surfaceArea, 400u * 400u);
+
+    // all remaining rects are in the atlas and don't intersect
+    sk_sp<SkSurface> atlasSurface;
+    for (uint32_t i = 0; i < MAX_RECTS; i++) {
+        if (INVALID_ATLAS_KEY == VDRects[i].key) {
+            continue;
+        }
+        VDRects[i] = atlas.getEntry(VDRects[i].key);
+        if (!atlasSurface) {
+            atlasSurface = VDRects[i].surface;
+        }
+        ASSERT_EQ(atlasSurface.get(), VDRects[i].surface.get());
+        ASSERT_TRUE(VDRects[i].rect.width() == 10 && VDRects[i].rect.height() == 10);
+        for (uint32_t j = 0; j < i; j++) {
+            if (INVALID_ATLAS_KEY != VDRects[j].key) {
+                ASSERT_FALSE(VDRects[i].rect.intersect(VDRects[j].rect));
+            }
+        }
+    }
+}
@@ -17,6 +17,7 @@
 #include <gtest/gtest.h>
 
 #include "PathParser.h"
+#include "PropertyValuesHolder.h"
 #include "VectorDrawable.h"
 #include "utils/MathUtils.h"
 #include "utils/VectorDrawableUtils.h"
@@ -270,6 +271,31 @@ TEST(PathParser, parseStringForData) {
     }
 }
 
+TEST(PathParser, parseNumbers) {
+    // Mixes numbers parsed by the fast path with ones left to strtof: more digits than a double
+    // holds exactly, or exponents beyond the exact powers of ten.
+    const char* pathString = "M.5-1.25e1 L12345678901234567.0,3e30 l+7E+2 .1.2.3 h-0";
+    PathParser::ParseResult result;
+    PathData pathData;
+    PathParser::getPathDataFromAsciiString(&pathData, &result, pathString, strlen(pathString));
+    ASSERT_FALSE(result.failureOccurred) << result.failureMessage;
+    std::vector<float> expected = {0.5f, -12.5f, strtof("12345678901234567.0", nullptr), 3e30f,
+                                   700.0f, 0.1f, 0.2f, 0.3f, -0.0f};
+    ASSERT_EQ(expected.size(), pathData.points.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        EXPECT_EQ(expected[i], pathData.points[i]) << "point " << i;
+    }
+    EXPECT_EQ(std::vector<size_t>({2, 2, 4, 1}), pathData.verbSizes);
+
+    // A failed verb doesn't leave its floats behind
+    PathData failedData;
+    const char* invalidString = "M1,2 L3,4,5";
+    PathParser::getPathDataFromAsciiString(&failedData, &result, invalidString,
+                                           strlen(invalidString));
+    EXPECT_TRUE(result.failureOccurred);
+    EXPECT_EQ(std::vector<float>({1, 2}), failedData.points);
+}
+
 TEST(VectorDrawableUtils, createSkPathFromPathData) {
     for (TestData testData : sTestDataSet) {
         SkPath expectedPath;
@@ -406,5 +432,67 @@ TEST(VectorDrawable, drawPathWithoutIncrementingShaderRefCount) {
     EXPECT_TRUE(shader->unique());
 }
 
+static sp<VectorDrawable::Tree> createSquareTree(VectorDrawable::FullPath** outPath) {
+    VectorDrawable::Group* root = new VectorDrawable::Group();
+    VectorDrawable::FullPath* path = new VectorDrawable::FullPath("M0 0L10 0L10 10L0 10z", 21);
+    path->mutateProperties()->setFillColor(SK_ColorRED);
+    root->addChild(path);
+    sp<VectorDrawable::Tree> tree = new VectorDrawable::Tree(root);
+    tree->mutateProperties()->setViewportSize(10, 10);
+    tree->mutateProperties()->setScaledSize(10, 10);
+    if (outPath) *outPath = path;
+    return tree;
+}
+
+TEST(VectorDrawable, identicalTreesShareRasterCache) {
+    VectorDrawable::FullPath* path;
+    sp<VectorDrawable::Tree> tree1 = createSquareTree(nullptr);
+    sp<VectorDrawable::Tree> tree2 = createSquareTree(&path);
+
+    Bitmap* bitmap = &tree1->getBitmapUpdateIfDirty();
+    EXPECT_EQ(bitmap, &tree2->getBitmapUpdateIfDirty());
+
+    // Dirty without a content change keeps the raster
+    tree2->markDirty();
+    EXPECT_EQ(bitmap, &tree2->getBitmapUpdateIfDirty());
+
+    // The shared raster isn't drawn into when one of the trees changes
+    path->mutateProperties()->setFillColor(SK_ColorBLUE);
+    Bitmap& changed = tree2->getBitmapUpdateIfDirty();
+    EXPECT_NE(bitmap, &changed);
+    SkBitmap skBitmap;
+    changed.getSkBitmap(&skBitmap);
+    EXPECT_EQ(SK_ColorBLUE, skBitmap.getColor(5, 5));
+    bitmap->getSkBitmap(&skBitmap);
+    EXPECT_EQ(SK_ColorRED, skBitmap.getColor(5, 5));
+    EXPECT_EQ(bitmap, &tree1->getBitmapUpdateIfDirty());
+}
+
+TEST(PropertyValuesHolder, pathDataMorph) {
+    PathData from;
+    PathData to;
+    PathParser::ParseResult result;
+    PathParser::getPathDataFromAsciiString(&from, &result, "M0 0L10 0L10 10z", 16);
+    ASSERT_FALSE(result.failureOccurred);
+    PathParser::getPathDataFromAsciiString(&to, &result, "M2 4L20 0L10 30z", 16);
+    ASSERT_FALSE(result.failureOccurred);
+
+    VectorDrawable::ClipPath path("M0 0L10 0L10 10z", 16);
+    PathDataPropertyValuesHolder holder(&path, &from, &to);
+    for (float fraction : {0.0f, 0.25f, 0.5f, 1.0f}) {
+        PathData expected;
+        VectorDrawableUtils::interpolatePaths(&expected, from, to, fraction);
+        holder.setFraction(fraction);
+        const PathData& animated = path.mutateProperties()->getData();
+        EXPECT_EQ(expected.verbs, animated.verbs);
+        EXPECT_EQ(expected.verbSizes, animated.verbSizes);
+        ASSERT_EQ(expected.points.size(), animated.points.size());
+        for (size_t i = 0; i < expected.points.size(); i++) {
+            EXPECT_FLOAT_EQ(expected.points[i], animated.points[i]);
+        }
+    }
+    EXPECT_EQ(to.points, path.mutateProperties()->getData().points);
+}
+
 };  // namespace uirenderer
 };  // namespace android
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <android/util/ScopeTimer.h>
 #include <sys/resource.h>
 #include <sys/sysinfo.h>
 
@@ -33,20 +34,29 @@ TaskManager::TaskManager() {
     // Get the number of available CPUs. This value does not change over time.
     int cpuCount = sysconf(_SC_NPROCESSORS_CONF);
 
-    // Really no point in making more than 2 of these worker threads, but
-    // we do want to limit ourselves to 1 worker thread on dual-core devices.
-    int workerCount = cpuCount > 2 ? 2 : 1;
+    // Idle workers steal from busy ones, so extra threads help absorb
+    // uneven task sizes. Use half of the cores, capped at 4, and limit
+    // ourselves to 1 worker thread on dual-core devices.
+    int workerCount = cpuCount > 2 ? MathUtils::clamp(cpuCount / 2, 2, 4) : 1;
     for (int i = 0; i < workerCount; i++) {
         String8 name;
         name.appendFormat("hwuiTask%d", i + 1);
-        mThreads.push_back(new WorkerThread(name));
+        mThreads.push_back(new WorkerThread(this, i, name));
     }
 }
 
 TaskManager::~TaskManager() {
+    // Workers reference this manager when stealing, they must
+    // be gone before the queues are torn down
     for (size_t i = 0; i < mThreads.size(); i++) {
         mThreads[i]->exit();
     }
+    for (size_t i = 0; i < mThreads.size(); i++) {
+        mThreads[i]->join();
+        while (TaskWrapper* task = mThreads[i]->stealTask()) {
+            delete task;
+        }
+    }
 }
 
 bool TaskManager::canRunTasks() const {
@@ -61,23 +71,49 @@ void TaskManager::stop() {
 
 bool TaskManager::addTaskBase(const sp<TaskBase>& task, const sp<TaskProcessorBase>& processor) {
     if (mThreads.size() > 0) {
-        TaskWrapper wrapper(task, processor);
+        TaskWrapper* wrapper = new TaskWrapper(task, processor);
+
+        Mutex::Autolock l(mSubmitLock);
 
         size_t minQueueSize = INT_MAX;
         sp<WorkerThread> thread;
 
         for (size_t i = 0; i < mThreads.size(); i++) {
-            if (mThreads[i]->getTaskCount() < minQueueSize) {
+            size_t taskCount = mThreads[i]->getTaskCount();
+            if (taskCount < minQueueSize) {
                 thread = mThreads[i];
-                minQueueSize = mThreads[i]->getTaskCount();
+                minQueueSize = taskCount;
             }
         }
 
-        return thread->addTask(wrapper);
+        if (!thread->addTask(wrapper)) {
+            delete wrapper;
+            return false;
+        }
+
+        // The target may be busy with a long task, give an idle
+        // worker the chance to steal the new one
+        for (size_t i = 0; i < mThreads.size(); i++) {
+            if (mThreads[i] != thread && mThreads[i]->isIdle()) {
+                mThreads[i]->wake();
+                break;
+            }
+        }
+        return true;
     }
     return false;
 }
 
+TaskManager::TaskWrapper* TaskManager::findTask(size_t index) {
+    const size_t count = mThreads.size();
+    for (size_t i = 0; i < count; i++) {
+        if (TaskWrapper* task = mThreads[(index + i) % count]->stealTask()) {
+            return task;
+        }
+    }
+    return nullptr;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Thread
 ///////////////////////////////////////////////////////////////////////////////
@@ -88,42 +124,35 @@ status_t TaskManager::WorkerThread::readyToRun() {
 }
 
 bool TaskManager::WorkerThread::threadLoop() {
-    mSignal.wait();
-    std::vector<TaskWrapper> tasks;
-    {
-        Mutex::Autolock l(mLock);
-        tasks.swap(mTasks);
+    mIdle = false;
+    while (TaskWrapper* task = mManager->findTask(mIndex)) {
+        SCOPE_TIMER("hwui.TaskManager.process");
+        task->mProcessor->process(task->mTask);
+        delete task;
     }
 
-    for (size_t i = 0; i < tasks.size(); i++) {
-        const TaskWrapper& task = tasks[i];
-        task.mProcessor->process(task.mTask);
+    if (!exitPending()) {
+        mIdle = true;
+        mSignal.wait();
     }
-
     return true;
 }
 
-bool TaskManager::WorkerThread::addTask(const TaskWrapper& task) {
+bool TaskManager::WorkerThread::addTask(TaskWrapper* task) {
     if (!isRunning()) {
         run(mName.string(), PRIORITY_DEFAULT);
     } else if (exitPending()) {
         return false;
     }
 
-    {
-        Mutex::Autolock l(mLock);
-        mTasks.push_back(task);
+    if (!mTasks.push(task)) {
+        return false;
     }
     mSignal.signal();
 
     return true;
 }
 
-size_t TaskManager::WorkerThread::getTaskCount() const {
-    Mutex::Autolock l(mLock);
-    return mTasks.size();
-}
-
 void TaskManager::WorkerThread::exit() {
     requestExit();
     mSignal.signal();
@@ -22,7 +22,9 @@
 #include <utils/Thread.h>
 
 #include "Signal.h"
+#include "WorkStealingQueue.h"
 
+#include <atomic>
 #include <vector>
 
 namespace android {
@@ -75,29 +77,54 @@ private:
         sp<TaskProcessorBase> mProcessor;
     };
 
+    // Tasks that do not fit in the target worker's queue are run inline
+    // by TaskProcessor::add(), so this only bounds the backlog per worker.
+    typedef WorkStealingQueue<TaskWrapper, 256> TaskQueue;
+
     class WorkerThread : public Thread {
     public:
-        explicit WorkerThread(const String8& name) : mSignal(Condition::WAKE_UP_ONE), mName(name) {}
-
-        bool addTask(const TaskWrapper& task);
-        size_t getTaskCount() const;
+        WorkerThread(TaskManager* manager, size_t index, const String8& name)
+                : mManager(manager)
+                , mIndex(index)
+                , mSignal(Condition::WAKE_UP_ONE)
+                , mIdle(false)
+                , mName(name) {}
+
+        bool addTask(TaskWrapper* task);
+        TaskWrapper* stealTask() { return mTasks.steal(); }
+        size_t getTaskCount() const { return mTasks.size(); }
+        bool isIdle() const { return mIdle.load(std::memory_order_relaxed); }
+        void wake() { mSignal.signal(); }
         void exit();
 
     private:
         virtual status_t readyToRun() override;
         virtual bool threadLoop() override;
 
-        // Lock for the list of tasks
-        mutable Mutex mLock;
-        std::vector<TaskWrapper> mTasks;
+        TaskManager* const mManager;
+        const size_t mIndex;
+
+        // Tasks assigned to this worker. Other idle workers steal
+        // from the top of this queue while this worker is busy.
+        TaskQueue mTasks;
 
         // Signal used to wake up the thread when a new
-        // task is available in the list
+        // task is available in any of the queues
         mutable Signal mSignal;
+        std::atomic_bool mIdle;
 
         const String8 mName;
     };
 
+    /**
+     * Returns the next task for the worker at the specified index, looking
+     * at its own queue first and then stealing from the other workers.
+     */
+    TaskWrapper* findTask(size_t index);
+
+    // Serializes producers, the queues only support a single pusher
+    Mutex mSubmitLock;
+
     std::vector<sp<WorkerThread> > mThreads;
 };
 
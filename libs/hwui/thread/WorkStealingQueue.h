@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HWUI_WORK_STEALING_QUEUE_H
+#define HWUI_WORK_STEALING_QUEUE_H
+
+#include "utils/Macros.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace android::uirenderer {
+
+/**
+ * Bounded, lock-free deque of pointers in the style of Chase & Lev.
+ *
+ * Items are pushed at the bottom by a single producer at a time (callers
+ * must serialize push()) and taken from the top by any number of consumers,
+ * including other workers stealing from this queue. Capacity must be a
+ * power of two. push() fails instead of growing when the queue is full so
+ * that the caller can fall back to running the item inline.
+ */
+template <typename T, size_t Capacity>
+class WorkStealingQueue {
+    PREVENT_COPY_AND_ASSIGN(WorkStealingQueue);
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+public:
+    WorkStealingQueue() : mTop(0), mBottom(0) {
+        for (auto& slot : mSlots) {
+            slot.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    bool push(T* item) {
+        int64_t bottom = mBottom.load(std::memory_order_relaxed);
+        int64_t top = mTop.load(std::memory_order_acquire);
+        if (bottom - top >= static_cast<int64_t>(Capacity)) {
+            return false;
+        }
+        mSlots[bottom & kMask].store(item, std::memory_order_relaxed);
+        mBottom.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Takes the oldest item, or returns nullptr if the queue is empty or
+     * another consumer won the race for the same slot.
+     */
+    T* steal() {
+        int64_t top = mTop.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = mBottom.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return nullptr;
+        }
+        T* item = mSlots[top & kMask].load(std::memory_order_relaxed);
+        if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    size_t size() const {
+        int64_t bottom = mBottom.load(std::memory_order_acquire);
+        int64_t top = mTop.load(std::memory_order_acquire);
+        return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+private:
+    static constexpr int64_t kMask = Capacity - 1;
+
+    std::atomic<int64_t> mTop;
+    std::atomic<int64_t> mBottom;
+    std::atomic<T*> mSlots[Capacity];
+};
+
+}  // namespace android::uirenderer
+
+#endif  // HWUI_WORK_STEALING_QUEUE_H
@@ -19,6 +19,14 @@
 #include "Blur.h"
 #include "MathUtils.h"
 
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define BLUR_SIMD 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define BLUR_SIMD 1
+#endif
+
 namespace android {
 namespace uirenderer {
 
@@ -91,91 +99,195 @@ void Blur::generateGaussianWeights(float* weights, float radius) {
     }
 }
 
-void Blur::horizontal(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
-                      int32_t width, int32_t height) {
+// Blurs the pixel at x of a row, clamping to the row edges
+static inline uint8_t horizontalPixel(const float* weights, int32_t radius, const uint8_t* input,
+                                      int32_t width, int32_t x) {
     float blurredPixel = 0.0f;
-    float currentPixel = 0.0f;
+    const float* gPtr = weights;
+    // Optimization for non-border pixels
+    if (x > radius && x < (width - radius)) {
+        const uint8_t* i = input + (x - radius);
+        for (int r = -radius; r <= radius; r++) {
+            blurredPixel += (float)(*i) * gPtr[0];
+            gPtr++;
+            i++;
+        }
+    } else {
+        for (int32_t r = -radius; r <= radius; r++) {
+            // Stepping left and right away from the pixel
+            int validW = x + r;
+            if (validW < 0) {
+                validW = 0;
+            }
+            if (validW > width - 1) {
+                validW = width - 1;
+            }
+
+            blurredPixel += (float)input[validW] * gPtr[0];
+            gPtr++;
+        }
+    }
+    return (uint8_t)blurredPixel;
+}
+
+// Clamps a row index of the vertical pass to zero and height
+static inline int32_t clampRow(int32_t y, int32_t height) {
+    return y < 0 ? 0 : (y > height - 1 ? height - 1 : y);
+}
+
+static inline uint8_t verticalPixel(const float* weights, int32_t radius, const uint8_t* source,
+                                    int32_t width, int32_t height, int32_t x, int32_t y) {
+    float blurredPixel = 0.0f;
+    const float* gPtr = weights;
+    const uint8_t* input = source + x;
+    // Optimization for non-border pixels
+    if (y > radius && y < (height - radius)) {
+        const uint8_t* i = input + ((y - radius) * width);
+        for (int32_t r = -radius; r <= radius; r++) {
+            blurredPixel += (float)(*i) * gPtr[0];
+            gPtr++;
+            i += width;
+        }
+    } else {
+        for (int32_t r = -radius; r <= radius; r++) {
+            blurredPixel += (float)input[clampRow(y + r, height) * width] * gPtr[0];
+            gPtr++;
+        }
+    }
+    return (uint8_t)blurredPixel;
+}
 
+void Blur::horizontalScalar(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
+                            int32_t width, int32_t height) {
     for (int32_t y = 0; y < height; y++) {
         const uint8_t* input = source + y * width;
         uint8_t* output = dest + y * width;
+        for (int32_t x = 0; x < width; x++) {
+            output[x] = horizontalPixel(weights, radius, input, width, x);
+        }
+    }
+}
 
+void Blur::verticalScalar(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
+                          int32_t width, int32_t height) {
+    for (int32_t y = 0; y < height; y++) {
+        uint8_t* output = dest + y * width;
         for (int32_t x = 0; x < width; x++) {
-            blurredPixel = 0.0f;
-            const float* gPtr = weights;
-            // Optimization for non-border pixels
-            if (x > radius && x < (width - radius)) {
-                const uint8_t* i = input + (x - radius);
-                for (int r = -radius; r <= radius; r++) {
-                    currentPixel = (float)(*i);
-                    blurredPixel += currentPixel * gPtr[0];
-                    gPtr++;
-                    i++;
-                }
-            } else {
-                for (int32_t r = -radius; r <= radius; r++) {
-                    // Stepping left and right away from the pixel
-                    int validW = x + r;
-                    if (validW < 0) {
-                        validW = 0;
-                    }
-                    if (validW > width - 1) {
-                        validW = width - 1;
-                    }
-
-                    currentPixel = (float)input[validW];
-                    blurredPixel += currentPixel * gPtr[0];
-                    gPtr++;
-                }
+            output[x] = verticalPixel(weights, radius, source, width, height, x, y);
+        }
+    }
+}
+
+// The vector versions blur kBlurLanes adjacent pixels at once. Each lane adds up its products in
+// the same order as the scalar loops do.
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+
+static const int32_t kBlurLanes = 8;
+
+struct BlurLanes {
+    float32x4_t low;
+    float32x4_t high;
+};
+
+static inline BlurLanes zeroLanes() {
+    return {vdupq_n_f32(0.0f), vdupq_n_f32(0.0f)};
+}
+
+static inline void multiplyAdd(BlurLanes& sum, const uint8_t* input, float weight) {
+    uint16x8_t pixels = vmovl_u8(vld1_u8(input));
+    sum.low = vmlaq_n_f32(sum.low, vcvtq_f32_u32(vmovl_u16(vget_low_u16(pixels))), weight);
+    sum.high = vmlaq_n_f32(sum.high, vcvtq_f32_u32(vmovl_u16(vget_high_u16(pixels))), weight);
+}
+
+static inline void storeLanes(const BlurLanes& sum, uint8_t* output) {
+    uint16x8_t pixels = vcombine_u16(vqmovn_u32(vcvtq_u32_f32(sum.low)),
+                                     vqmovn_u32(vcvtq_u32_f32(sum.high)));
+    vst1_u8(output, vqmovn_u16(pixels));
+}
+
+#elif defined(__SSE2__)
+
+static const int32_t kBlurLanes = 8;
+
+struct BlurLanes {
+    __m128 low;
+    __m128 high;
+};
+
+static inline BlurLanes zeroLanes() {
+    return {_mm_setzero_ps(), _mm_setzero_ps()};
+}
+
+static inline void multiplyAdd(BlurLanes& sum, const uint8_t* input, float weight) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i pixels =
+            _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(input)), zero);
+    const __m128 weights = _mm_set1_ps(weight);
+    sum.low = _mm_add_ps(sum.low,
+                         _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(pixels, zero)), weights));
+    sum.high = _mm_add_ps(sum.high,
+                          _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(pixels, zero)), weights));
+}
+
+static inline void storeLanes(const BlurLanes& sum, uint8_t* output) {
+    __m128i pixels = _mm_packs_epi32(_mm_cvttps_epi32(sum.low), _mm_cvttps_epi32(sum.high));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(output), _mm_packus_epi16(pixels, pixels));
+}
+
+#endif
+
+void Blur::horizontal(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
+                      int32_t width, int32_t height) {
+#ifdef BLUR_SIMD
+    for (int32_t y = 0; y < height; y++) {
+        const uint8_t* input = source + y * width;
+        uint8_t* output = dest + y * width;
+
+        int32_t x = 0;
+        for (; x <= radius && x < width; x++) {
+            output[x] = horizontalPixel(weights, radius, input, width, x);
+        }
+        // every lane must be a non-border pixel
+        for (; x + kBlurLanes - 1 < width - radius; x += kBlurLanes) {
+            BlurLanes sum = zeroLanes();
+            const uint8_t* i = input + (x - radius);
+            for (int32_t r = 0; r <= 2 * radius; r++) {
+                multiplyAdd(sum, i + r, weights[r]);
             }
-            *output = (uint8_t)blurredPixel;
-            output++;
+            storeLanes(sum, output + x);
+        }
+        for (; x < width; x++) {
+            output[x] = horizontalPixel(weights, radius, input, width, x);
         }
     }
+#else
+    horizontalScalar(weights, radius, source, dest, width, height);
+#endif
 }
 
 void Blur::vertical(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
                     int32_t width, int32_t height) {
-    float blurredPixel = 0.0f;
-    float currentPixel = 0.0f;
-
+#ifdef BLUR_SIMD
     for (int32_t y = 0; y < height; y++) {
         uint8_t* output = dest + y * width;
 
-        for (int32_t x = 0; x < width; x++) {
-            blurredPixel = 0.0f;
-            const float* gPtr = weights;
-            const uint8_t* input = source + x;
-            // Optimization for non-border pixels
-            if (y > radius && y < (height - radius)) {
-                const uint8_t* i = input + ((y - radius) * width);
-                for (int32_t r = -radius; r <= radius; r++) {
-                    currentPixel = (float)(*i);
-                    blurredPixel += currentPixel * gPtr[0];
-                    gPtr++;
-                    i += width;
-                }
-            } else {
-                for (int32_t r = -radius; r <= radius; r++) {
-                    int validH = y + r;
-                    // Clamp to zero and width
-                    if (validH < 0) {
-                        validH = 0;
-                    }
-                    if (validH > height - 1) {
-                        validH = height - 1;
-                    }
-
-                    const uint8_t* i = input + validH * width;
-                    currentPixel = (float)(*i);
-                    blurredPixel += currentPixel * gPtr[0];
-                    gPtr++;
-                }
+        // rows are clamped per tap, so the border rows are vectorized as well
+        int32_t x = 0;
+        for (; x + kBlurLanes <= width; x += kBlurLanes) {
+            BlurLanes sum = zeroLanes();
+            for (int32_t r = -radius; r <= radius; r++) {
+                multiplyAdd(sum, source + clampRow(y + r, height) * width + x,
+                            weights[r + radius]);
             }
-            *output = (uint8_t)blurredPixel;
-            output++;
+            storeLanes(sum, output + x);
+        }
+        for (; x < width; x++) {
+            output[x] = verticalPixel(weights, radius, source, width, height, x, y);
         }
     }
+#else
+    verticalScalar(weights, radius, source, dest, width, height);
+#endif
 }
 
 };  // namespace uirenderer
@@ -35,10 +35,18 @@ public:
     static uint32_t convertRadiusToInt(float radius);
 
     static void generateGaussianWeights(float* weights, float radius);
+    // Use NEON or SSE2 when the target has them, which is always the case on arm64 and x86
     static void horizontal(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
                            int32_t width, int32_t height);
     static void vertical(float* weights, int32_t radius, const uint8_t* source, uint8_t* dest,
                          int32_t width, int32_t height);
+
+    // Scalar versions of horizontal() and vertical(), for comparison. The vector versions may
+    // differ by one in pixels where the sum is rounded differently.
+    static void horizontalScalar(float* weights, int32_t radius, const uint8_t* source,
+                                 uint8_t* dest, int32_t width, int32_t height);
+    static void verticalScalar(float* weights, int32_t radius, const uint8_t* source,
+                               uint8_t* dest, int32_t width, int32_t height);
 };
 
 };  // namespace uirenderer
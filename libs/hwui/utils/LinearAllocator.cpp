@@ -30,10 +30,16 @@
 #include <stdlib.h>
 #include <utils/Log.h>
 
+#include <mutex>
+#include <vector>
+
 // The ideal size of a page allocation (these need to be multiples of 8)
 #define INITIAL_PAGE_SIZE ((size_t)512)  // 512b
 #define MAX_PAGE_SIZE ((size_t)131072)   // 128kb
 
+// The pages of destroyed allocators kept for reuse, see PagePool
+#define DEFAULT_PAGE_POOL_CAPACITY ((size_t)524288)  // 512kb
+
 // The maximum amount of wasted space we can have per page
 // Allocations exceeding this will have their own dedicated page
 // If this is too low, we will malloc too much
@@ -88,7 +94,7 @@ public:
     Page* next() { return mNextPage; }
     void setNext(Page* next) { mNextPage = next; }
 
-    Page() : mNextPage(0) {}
+    explicit Page(size_t allocSize) : mNextPage(0), mAllocSize(allocSize) {}
 
     void* operator new(size_t /*size*/, void* buf) { return buf; }
 
@@ -96,9 +102,107 @@ public:
 
     void* end(int pageSize) { return (void*)(((size_t)start()) + pageSize); }
 
+    // Size of the allocation holding the page, including this header
+    size_t allocSize() const { return mAllocSize; }
+
 private:
     Page(const Page& /*other*/) {}
     Page* mNextPage;
+    size_t mAllocSize;
+};
+
+/**
+ * Free pages, by size. Only the page sizes LinearAllocator grows through are kept, dedicated
+ * pages of other sizes are freed right away.
+ */
+class LinearAllocator::PagePool {
+public:
+    static PagePool& get() {
+        // never destroyed, allocators may outlive static destructors
+        static PagePool* sPool = new PagePool();
+        return *sPool;
+    }
+
+    void* take(size_t allocSize) {
+        const int sizeClass = sizeClassFor(allocSize);
+        std::lock_guard<std::mutex> lock(mLock);
+        if (sizeClass >= 0 && !mFreePages[sizeClass].empty()) {
+            void* page = mFreePages[sizeClass].back();
+            mFreePages[sizeClass].pop_back();
+            mStats.pooledBytes -= allocSize;
+            mStats.pooledPages--;
+            mStats.reusedPages++;
+            return page;
+        }
+        mStats.allocatedPages++;
+        return nullptr;
+    }
+
+    // Returns false if the page should be freed instead
+    bool give(void* page, size_t allocSize) {
+        const int sizeClass = sizeClassFor(allocSize);
+        if (sizeClass < 0) return false;
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mStats.pooledBytes + allocSize > mStats.capacity) {
+            mStats.releasedPages++;
+            return false;
+        }
+        mFreePages[sizeClass].push_back(page);
+        mStats.pooledBytes += allocSize;
+        mStats.pooledPages++;
+        return true;
+    }
+
+    PagePoolStats stats() {
+        std::lock_guard<std::mutex> lock(mLock);
+        return mStats;
+    }
+
+    void setCapacity(size_t capacity) {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStats.capacity = capacity;
+        releaseLocked(capacity);
+    }
+
+    void trim() {
+        std::lock_guard<std::mutex> lock(mLock);
+        releaseLocked(0);
+    }
+
+private:
+    // INITIAL_PAGE_SIZE doubled until MAX_PAGE_SIZE
+    static const int kSizeClassCount = 9;
+
+    PagePool() { mStats.capacity = DEFAULT_PAGE_POOL_CAPACITY; }
+
+    static size_t pageAllocSize(int sizeClass) {
+        return ALIGN((INITIAL_PAGE_SIZE << sizeClass) + sizeof(Page));
+    }
+
+    // Frees pages until at most targetSize bytes are pooled, largest pages first
+    void releaseLocked(size_t targetSize) {
+        for (int sizeClass = kSizeClassCount - 1; sizeClass >= 0; sizeClass--) {
+            std::vector<void*>& pages = mFreePages[sizeClass];
+            while (mStats.pooledBytes > targetSize && !pages.empty()) {
+                free(pages.back());
+                pages.pop_back();
+                mStats.pooledBytes -= pageAllocSize(sizeClass);
+                mStats.pooledPages--;
+                mStats.releasedPages++;
+            }
+        }
+    }
+
+    static int sizeClassFor(size_t allocSize) {
+        for (int sizeClass = 0; sizeClass < kSizeClassCount; sizeClass++) {
+            if (allocSize == pageAllocSize(sizeClass)) return sizeClass;
+        }
+        return -1;
+    }
+
+    std::mutex mLock;
+    std::vector<void*> mFreePages[kSizeClassCount];
+    PagePoolStats mStats;
 };
 
 LinearAllocator::LinearAllocator()
@@ -121,9 +225,7 @@ LinearAllocator::~LinearAllocator(void) {
     Page* p = mPages;
     while (p) {
         Page* next = p->next();
-        p->~Page();
-        free(p);
-        RM_ALLOCATION();
+        releasePage(p);
         p = next;
     }
 }
@@ -226,11 +328,35 @@ void LinearAllocator::rewindIfLastAlloc(void* ptr, size_t allocSize) {
 
 LinearAllocator::Page* LinearAllocator::newPage(size_t pageSize) {
     pageSize = ALIGN(pageSize + sizeof(LinearAllocator::Page));
-    ADD_ALLOCATION();
     mTotalAllocated += pageSize;
     mPageCount++;
-    void* buf = malloc(pageSize);
-    return new (buf) Page();
+    void* buf = PagePool::get().take(pageSize);
+    if (!buf) {
+        ADD_ALLOCATION();
+        buf = malloc(pageSize);
+    }
+    return new (buf) Page(pageSize);
+}
+
+void LinearAllocator::releasePage(Page* page) {
+    const size_t allocSize = page->allocSize();
+    page->~Page();
+    if (!PagePool::get().give(page, allocSize)) {
+        free(page);
+        RM_ALLOCATION();
+    }
+}
+
+LinearAllocator::PagePoolStats LinearAllocator::getPagePoolStats() {
+    return PagePool::get().stats();
+}
+
+void LinearAllocator::setPagePoolCapacity(size_t capacity) {
+    PagePool::get().setCapacity(capacity);
+}
+
+void LinearAllocator::trimPagePool() {
+    PagePool::get().trim();
 }
 
 static const char* toSize(size_t value, float& result) {
@@ -27,6 +27,7 @@
 #define ANDROID_LINEARALLOCATOR_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <type_traits>
 
 #include <vector>
@@ -116,10 +117,40 @@ public:
      */
     size_t usedSize() const { return mTotalAllocated - mWastedSpace; }
 
+    struct PagePoolStats {
+        size_t capacity = 0;
+        size_t pooledBytes = 0;
+        size_t pooledPages = 0;
+        // pages handed out again, and pages that had to be malloc()ed
+        uint64_t reusedPages = 0;
+        uint64_t allocatedPages = 0;
+        // pages free()d because the pool was full
+        uint64_t releasedPages = 0;
+    };
+
+    /**
+     * Pages of destroyed LinearAllocators are kept in a pool shared by all threads, since
+     * display lists are usually recorded on the UI thread and destroyed on the RenderThread.
+     * New LinearAllocators take their pages from the pool before calling malloc().
+     */
+    static PagePoolStats getPagePoolStats();
+
+    /**
+     * Sets the number of bytes the page pool may hold, releasing pages if needed. 0 disables
+     * the pool.
+     */
+    static void setPagePoolCapacity(size_t capacity);
+
+    /**
+     * Releases every page the pool holds.
+     */
+    static void trimPagePool();
+
 private:
     LinearAllocator(const LinearAllocator& other);
 
     class Page;
+    class PagePool;
     typedef void (*Destructor)(void* addr);
     struct DestructorNode {
         Destructor dtor;
@@ -132,6 +163,7 @@ private:
     void addToDestructionList(Destructor, void* addr);
     void runDestructorFor(void* addr);
     Page* newPage(size_t pageSize);
+    void releasePage(Page* page);
     bool fitsInCurrentPage(size_t size);
     void ensureNext(size_t size);
     void* start(Page* p);
@@ -66,7 +66,9 @@ void VectorDrawableUtils::verbsToPath(SkPath* outPath, const PathData& data) {
     PathResolver resolver;
     char previousCommand = 'm';
     size_t start = 0;
-    outPath->reset();
+    // rewind rather than reset, so that paths that are parsed again keep their storage
+    outPath->rewind();
+    outPath->incReserve(data.points.size() / 2);
     for (unsigned int i = 0; i < data.verbs.size(); i++) {
         size_t verbSize = data.verbSizes[i];
         resolver.addCommand(outPath, previousCommand, data.verbs[i], &data.points, start,
@@ -36,18 +36,34 @@
 
 namespace android {
 
+// The number of events to be read at once for DisplayEventReceiver.
+static const int EVENT_BUFFER_SIZE = 100;
+
 // --- SpriteController ---
 
 SpriteController::SpriteController(const sp<Looper>& looper, int32_t overlayLayer) :
         mLooper(looper), mOverlayLayer(overlayLayer) {
     mHandler = new WeakMessageHandler(this);
+    mCallback = new WeakLooperCallback(this);
+
+    // Without vsync the sprites are updated as soon as they are invalidated.
+    if (mDisplayEventReceiver.initCheck() == NO_ERROR) {
+        mLooper->addFd(mDisplayEventReceiver.getFd(), Looper::POLL_CALLBACK,
+                       Looper::EVENT_INPUT, mCallback, nullptr);
+    } else {
+        ALOGE("Failed to initialize DisplayEventReceiver.");
+    }
 
     mLocked.transactionNestingCount = 0;
     mLocked.deferredSpriteUpdate = false;
+    mLocked.vsyncPending = false;
 }
 
 SpriteController::~SpriteController() {
     mLooper->removeMessages(mHandler);
+    if (mDisplayEventReceiver.initCheck() == NO_ERROR) {
+        mLooper->removeFd(mDisplayEventReceiver.getFd());
+    }
 
     if (mSurfaceComposerClient != NULL) {
         mSurfaceComposerClient->dispose();
@@ -74,7 +90,7 @@ void SpriteController::closeTransaction() {
     mLocked.transactionNestingCount -= 1;
     if (mLocked.transactionNestingCount == 0 && mLocked.deferredSpriteUpdate) {
         mLocked.deferredSpriteUpdate = false;
-        mLooper->sendMessage(mHandler, Message(MSG_UPDATE_SPRITES));
+        scheduleUpdateLocked();
     }
 }
 
@@ -85,11 +101,20 @@ void SpriteController::invalidateSpriteLocked(const sp<SpriteImpl>& sprite) {
         if (mLocked.transactionNestingCount != 0) {
             mLocked.deferredSpriteUpdate = true;
         } else {
-            mLooper->sendMessage(mHandler, Message(MSG_UPDATE_SPRITES));
+            scheduleUpdateLocked();
         }
     }
 }
 
+void SpriteController::scheduleUpdateLocked() {
+    if (mDisplayEventReceiver.initCheck() != NO_ERROR) {
+        mLooper->sendMessage(mHandler, Message(MSG_UPDATE_SPRITES));
+    } else if (!mLocked.vsyncPending) {
+        mLocked.vsyncPending = true;
+        mDisplayEventReceiver.requestNextVsync();
+    }
+}
+
 void SpriteController::disposeSurfaceLocked(const sp<SurfaceControl>& surfaceControl) {
     bool wasEmpty = mLocked.disposedSurfaces.isEmpty();
     mLocked.disposedSurfaces.push(surfaceControl);
@@ -98,6 +123,67 @@ void SpriteController::disposeSurfaceLocked(const sp<SurfaceControl>& surfaceCon
     }
 }
 
+SkBitmap SpriteController::getIconBitmapLocked(const SkBitmap& bitmap) {
+    uint32_t generationId = bitmap.getGenerationID();
+    size_t numCached = mLocked.cachedIconBitmaps.size();
+    for (size_t i = 0; i < numCached; i++) {
+        if (mLocked.cachedIconBitmaps.itemAt(i).generationId == generationId) {
+            CachedIconBitmap cached = mLocked.cachedIconBitmaps.itemAt(i);
+            mLocked.cachedIconBitmaps.removeAt(i);
+            mLocked.cachedIconBitmaps.push(cached);
+            return cached.bitmap;
+        }
+    }
+
+    CachedIconBitmap cached;
+    cached.generationId = generationId;
+    if (!cached.bitmap.tryAllocPixels(bitmap.info().makeColorType(kN32_SkColorType))) {
+        return cached.bitmap;
+    }
+    bitmap.readPixels(cached.bitmap.info(), cached.bitmap.getPixels(),
+            cached.bitmap.rowBytes(), 0, 0);
+    // The copy is shared by the sprites and their update states.
+    cached.bitmap.setImmutable();
+    if (numCached == MAX_CACHED_ICON_BITMAPS) {
+        mLocked.cachedIconBitmaps.removeAt(0);
+    }
+    mLocked.cachedIconBitmaps.push(cached);
+    return cached.bitmap;
+}
+
+int SpriteController::handleEvent(int /* fd */, int events, void* /* data */) {
+    if (events & (Looper::EVENT_ERROR | Looper::EVENT_HANGUP)) {
+        ALOGE("Display event receiver pipe was closed or an error occurred.  "
+              "events=0x%x", events);
+        return 0; // remove the callback
+    }
+
+    if (!(events & Looper::EVENT_INPUT)) {
+        ALOGW("Received spurious callback for unhandled poll event.  "
+              "events=0x%x", events);
+        return 1; // keep the callback
+    }
+
+    bool gotVsync = false;
+    ssize_t n;
+    DisplayEventReceiver::Event buf[EVENT_BUFFER_SIZE];
+    while ((n = mDisplayEventReceiver.getEvents(buf, EVENT_BUFFER_SIZE)) > 0) {
+        for (size_t i = 0; i < static_cast<size_t>(n); ++i) {
+            if (buf[i].header.type == DisplayEventReceiver::DISPLAY_EVENT_VSYNC) {
+                gotVsync = true;
+            }
+        }
+    }
+    if (gotVsync) {
+        { // acquire lock
+            AutoMutex _l(mLock);
+            mLocked.vsyncPending = false;
+        } // release lock
+        doUpdateSprites();
+    }
+    return 1;  // keep the callback
+}
+
 void SpriteController::handleMessage(const Message& message) {
     switch (message.what) {
     case MSG_UPDATE_SPRITES:
@@ -359,6 +445,7 @@ sp<SurfaceControl> SpriteController::obtainSurface(int32_t width, int32_t height
 
 SpriteController::SpriteImpl::SpriteImpl(const sp<SpriteController> controller) :
         mController(controller) {
+    mLocked.iconGenerationId = 0;
 }
 
 SpriteController::SpriteImpl::~SpriteImpl() {
@@ -377,20 +464,26 @@ void SpriteController::SpriteImpl::setIcon(const SpriteIcon& icon) {
 
     uint32_t dirty;
     if (icon.isValid()) {
-        SkBitmap* bitmapCopy = &mLocked.state.icon.bitmap;
-        if (bitmapCopy->tryAllocPixels(icon.bitmap.info().makeColorType(kN32_SkColorType))) {
-            icon.bitmap.readPixels(bitmapCopy->info(), bitmapCopy->getPixels(),
-                    bitmapCopy->rowBytes(), 0, 0);
+        bool wasValid = mLocked.state.icon.isValid();
+        uint32_t generationId = icon.bitmap.getGenerationID();
+        if (wasValid && mLocked.iconGenerationId == generationId) {
+            // Setting the icon again, the surface doesn't need to be redrawn.
+            dirty = 0;
+        } else {
+            mLocked.state.icon.bitmap = mController->getIconBitmapLocked(icon.bitmap);
+            mLocked.iconGenerationId = generationId;
+            dirty = DIRTY_BITMAP;
         }
 
-        if (!mLocked.state.icon.isValid()
+        if (!wasValid
                 || mLocked.state.icon.hotSpotX != icon.hotSpotX
                 || mLocked.state.icon.hotSpotY != icon.hotSpotY) {
             mLocked.state.icon.hotSpotX = icon.hotSpotX;
             mLocked.state.icon.hotSpotY = icon.hotSpotY;
-            dirty = DIRTY_BITMAP | DIRTY_HOTSPOT;
-        } else {
-            dirty = DIRTY_BITMAP;
+            dirty |= DIRTY_HOTSPOT;
+        }
+        if (!dirty) {
+            return;
         }
     } else if (mLocked.state.icon.isValid()) {
         mLocked.state.icon.bitmap.reset();
@@ -20,12 +20,38 @@
 #include <utils/RefBase.h>
 #include <utils/Looper.h>
 
+#include <gui/DisplayEventReceiver.h>
 #include <gui/SurfaceComposerClient.h>
 
 #include <SkBitmap.h>
 
 namespace android {
 
+/*
+ * Looper callback which forwards events to a callback only weakly referenced, so the looper
+ * doesn't keep the controllers registering their display event receiver alive.
+ */
+class WeakLooperCallback: public LooperCallback {
+protected:
+    virtual ~WeakLooperCallback() { }
+
+public:
+    WeakLooperCallback(const wp<LooperCallback>& callback) :
+        mCallback(callback) {
+    }
+
+    virtual int handleEvent(int fd, int events, void* data) {
+        sp<LooperCallback> callback = mCallback.promote();
+        if (callback != NULL) {
+            return callback->handleEvent(fd, events, data);
+        }
+        return 0; // the client is gone, remove the callback
+    }
+
+private:
+    wp<LooperCallback> mCallback;
+};
+
 /*
  * Transformation matrix for a sprite.
  */
@@ -135,10 +161,12 @@ public:
  * by other components.
  *
  * All sprite position updates and rendering is performed asynchronously.
+ * Updates are coalesced until the next vsync, so all the changes made to the sprites
+ * during a frame are applied with a single surface transaction.
  *
  * Clients are responsible for animating sprites by periodically updating their properties.
  */
-class SpriteController : public MessageHandler {
+class SpriteController : public MessageHandler, public LooperCallback {
 protected:
     virtual ~SpriteController();
 
@@ -248,6 +276,8 @@ private:
 
         struct Locked {
             SpriteState state;
+            // The generation ID of the bitmap the icon was copied from.
+            uint32_t iconGenerationId;
         } mLocked; // guarded by mController->mLock
 
         void invalidateLocked(uint32_t dirty);
@@ -271,19 +301,37 @@ private:
     const int32_t mOverlayLayer;
     sp<WeakMessageHandler> mHandler;
 
+    sp<LooperCallback> mCallback;
+    DisplayEventReceiver mDisplayEventReceiver;
+
     sp<SurfaceComposerClient> mSurfaceComposerClient;
 
+    /* An icon bitmap converted to the sprite surface color type. */
+    struct CachedIconBitmap {
+        uint32_t generationId;
+        SkBitmap bitmap;
+    };
+
+    // The icons that were set recently, most recently used last. Animated pointers cycle
+    // through a few icons, they are only copied and converted once.
+    static const size_t MAX_CACHED_ICON_BITMAPS = 32;
+
     struct Locked {
         Vector<sp<SpriteImpl> > invalidatedSprites;
         Vector<sp<SurfaceControl> > disposedSurfaces;
         uint32_t transactionNestingCount;
         bool deferredSpriteUpdate;
+        bool vsyncPending;
+        Vector<CachedIconBitmap> cachedIconBitmaps;
     } mLocked; // guarded by mLock
 
     void invalidateSpriteLocked(const sp<SpriteImpl>& sprite);
+    void scheduleUpdateLocked();
     void disposeSurfaceLocked(const sp<SurfaceControl>& surfaceControl);
+    SkBitmap getIconBitmapLocked(const SkBitmap& bitmap);
 
     void handleMessage(const Message& message);
+    virtual int handleEvent(int fd, int events, void* data);
     void doUpdateSprites();
     void doDisposeSurfaces();
 
@@ -37,8 +37,28 @@ namespace util {
 class EncodedBuffer
 {
 public:
+    /**
+     * Gives the buffers their chunks instead of malloc, e.g. from a pool shared by many buffers.
+     */
+    class Allocator {
+    public:
+        virtual ~Allocator() {}
+
+        /**
+         * Returns a chunk of chunkSize bytes, NULL if there is no memory for it.
+         */
+        virtual uint8_t* allocate(size_t chunkSize) = 0;
+
+        /**
+         * Takes back a chunk it allocated, when the buffer is destroyed.
+         */
+        virtual void release(uint8_t* chunk, size_t chunkSize) = 0;
+    };
+
     EncodedBuffer();
     EncodedBuffer(size_t chunkSize);
+    // The allocator must outlive the buffer, NULL uses malloc.
+    EncodedBuffer(size_t chunkSize, Allocator* allocator);
     ~EncodedBuffer();
 
     class Pointer {
@@ -216,6 +236,7 @@ public:
 private:
     size_t mChunkSize;
     std::vector<uint8_t*> mBuffers;
+    Allocator* mAllocator;
 
     Pointer mWp;
     Pointer mEp;
@@ -86,8 +86,13 @@ EncodedBuffer::EncodedBuffer() : EncodedBuffer(0)
 {
 }
 
-EncodedBuffer::EncodedBuffer(size_t chunkSize)
-        :mBuffers()
+EncodedBuffer::EncodedBuffer(size_t chunkSize) : EncodedBuffer(chunkSize, NULL)
+{
+}
+
+EncodedBuffer::EncodedBuffer(size_t chunkSize, Allocator* allocator)
+        :mBuffers(),
+         mAllocator(allocator)
 {
     mChunkSize = chunkSize == 0 ? BUFFER_SIZE : chunkSize;
     mWp = Pointer(mChunkSize);
@@ -98,7 +103,11 @@ EncodedBuffer::~EncodedBuffer()
 {
     for (size_t i=0; i<mBuffers.size(); i++) {
         uint8_t* buf = mBuffers[i];
-        free(buf);
+        if (mAllocator != NULL) {
+            mAllocator->release(buf, mChunkSize);
+        } else {
+            free(buf);
+        }
     }
 }
 
@@ -135,7 +144,8 @@ EncodedBuffer::writeBuffer()
     if (mWp.index() > mBuffers.size()) return NULL;
     uint8_t* buf = NULL;
     if (mWp.index() == mBuffers.size()) {
-        buf = (uint8_t*)malloc(mChunkSize);
+        buf = mAllocator != NULL ? mAllocator->allocate(mChunkSize)
+                                 : (uint8_t*)malloc(mChunkSize);
 
         if (buf == NULL) return NULL; // This indicates NO_MEMORY
 
@@ -23,3 +23,32 @@ TEST(EncodedBufferTest, ReadVarint) {
     buffer.writeRawVarint64(val);
     EXPECT_EQ(val, buffer.begin().readRawVarint());
 }
+
+class CountingAllocator : public EncodedBuffer::Allocator {
+public:
+    int allocated = 0;
+    int released = 0;
+    int limit = 2;
+
+    virtual uint8_t* allocate(size_t chunkSize) {
+        if (allocated - released >= limit) return NULL;
+        allocated++;
+        return (uint8_t*)malloc(chunkSize);
+    }
+
+    virtual void release(uint8_t* chunk, size_t) {
+        released++;
+        free(chunk);
+    }
+};
+
+TEST(EncodedBufferTest, UsesAllocator) {
+    CountingAllocator allocator;
+    {
+        EncodedBuffer buffer(4, &allocator);
+        buffer.writeRawFixed64(UINT64_C(0x0102030405060708));
+        EXPECT_EQ(2, allocator.allocated);
+        EXPECT_EQ(NULL, buffer.writeBuffer());
+    }
+    EXPECT_EQ(2, allocator.released);
+}
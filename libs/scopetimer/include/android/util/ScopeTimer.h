@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_UTIL_SCOPE_TIMER_H
+#define ANDROID_UTIL_SCOPE_TIMER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <atomic>
+
+#define SCOPE_TIMER_CONCAT_(a, b) a##b
+#define SCOPE_TIMER_CONCAT(a, b) SCOPE_TIMER_CONCAT_(a, b)
+
+/**
+ * Times the rest of the enclosing scope under name, which must be a string
+ * literal. Scopes with the same name are reported together.
+ */
+#define SCOPE_TIMER(name)                                                                    \
+    static const ::android::util::ScopeTimerSite SCOPE_TIMER_CONCAT(__scopeTimerSite,        \
+                                                                    __LINE__)(name);         \
+    ::android::util::ScopeTimer SCOPE_TIMER_CONCAT(__scopeTimer, __LINE__)(                  \
+            SCOPE_TIMER_CONCAT(__scopeTimerSite, __LINE__))
+
+namespace android {
+namespace util {
+
+/**
+ * A named scope timed by ScopeTimer, registered once per call site.
+ */
+class ScopeTimerSite {
+public:
+    explicit ScopeTimerSite(const char* name);
+
+    // -1 once all the sites are taken, the site isn't timed then
+    int id() const { return mId; }
+
+private:
+    int mId;
+};
+
+/**
+ * The count, total and maximum duration, and histogram of a scope.
+ */
+struct ScopeTimerStats {
+    // Bucket 0 counts the scopes shorter than 1us, bucket b > 0 the ones in
+    // [2^(b-1), 2^b) us, and the last one all the longer ones.
+    static const int kBucketCount = 16;
+
+    uint64_t count = 0;
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+    uint64_t buckets[kBucketCount] = {};
+
+    // Upper bound in us of the bucket holding the given percentile.
+    uint64_t percentileUs(int percentile) const;
+};
+
+/**
+ * Times a scope from its construction to its destruction, for production
+ * builds: the durations are recorded into counters owned by the calling
+ * thread, with no lock nor atomic read-modify-write, and summed only when
+ * the stats are read. The slot of a thread that exits is reused by the next
+ * new thread, so short lived threads don't grow the memory used.
+ */
+class ScopeTimer {
+public:
+    explicit ScopeTimer(const ScopeTimerSite& site)
+            : mId(sEnabled.load(std::memory_order_relaxed) ? site.id() : -1)
+            , mStart(mId >= 0 ? now() : 0) {}
+
+    ~ScopeTimer() {
+        if (mId >= 0) {
+            record(mId, now() - mStart);
+        }
+    }
+
+    static void setEnabled(bool enabled) { sEnabled.store(enabled, std::memory_order_relaxed); }
+    static bool isEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+    static void record(int id, int64_t durationNs);
+
+    // Sums the stats of the scopes named name over all the threads, returns
+    // false if no such scope was registered.
+    static bool getStats(const char* name, ScopeTimerStats* outStats);
+
+    // Writes a table of the scopes that ran at least once.
+    static void dump(int fd);
+    static void dump(FILE* out);
+
+private:
+    static int64_t now() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    }
+
+    static std::atomic<bool> sEnabled;
+
+    const int mId;
+    const int64_t mStart;
+
+    ScopeTimer(const ScopeTimer&) = delete;
+    ScopeTimer& operator=(const ScopeTimer&) = delete;
+};
+
+}  // namespace util
+}  // namespace android
+
+#endif  // ANDROID_UTIL_SCOPE_TIMER_H
@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define LOG_TAG "libscopetimer"
+
+#include <android/util/ScopeTimer.h>
+
+#include <inttypes.h>
+#include <log/log.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+namespace android {
+namespace util {
+
+const int kMaxSites = 64;
+
+std::atomic<bool> ScopeTimer::sEnabled(true);
+
+namespace {
+
+struct SiteCounters {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> totalNs{0};
+    std::atomic<uint64_t> maxNs{0};
+    std::atomic<uint64_t> buckets[ScopeTimerStats::kBucketCount] = {};
+};
+
+// Written only by the thread holding it, read by getStats() and dump().
+struct ThreadCounters {
+    // Never changes once the counters are published in gThreadCounters
+    ThreadCounters* next = nullptr;
+    std::atomic<bool> inUse{true};
+    SiteCounters sites[kMaxSites];
+};
+
+std::atomic<int> gSiteCount(0);
+std::atomic<const char*> gSiteNames[kMaxSites] = {};
+
+// The counters of all the threads that ever recorded a scope, most recent first.
+std::atomic<ThreadCounters*> gThreadCounters(nullptr);
+
+ThreadCounters* acquireThreadCounters() {
+    for (ThreadCounters* counters = gThreadCounters.load(std::memory_order_acquire);
+         counters != nullptr; counters = counters->next) {
+        bool inUse = false;
+        if (!counters->inUse.load(std::memory_order_relaxed) &&
+            counters->inUse.compare_exchange_strong(inUse, true, std::memory_order_acquire)) {
+            return counters;
+        }
+    }
+    ThreadCounters* counters = new ThreadCounters();
+    counters->next = gThreadCounters.load(std::memory_order_relaxed);
+    while (!gThreadCounters.compare_exchange_weak(counters->next, counters,
+                                                  std::memory_order_release,
+                                                  std::memory_order_relaxed)) {
+    }
+    return counters;
+}
+
+// Hands the counters of the thread over to the next new thread when it exits.
+struct ThreadSlot {
+    ThreadCounters* counters = nullptr;
+
+    ~ThreadSlot() {
+        if (counters != nullptr) {
+            counters->inUse.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadSlot tThreadSlot;
+
+// Only the owning thread writes, so plain load and store are enough.
+inline void add(std::atomic<uint64_t>* counter, uint64_t value) {
+    counter->store(counter->load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+int bucketFor(uint64_t durationNs) {
+    uint64_t us = durationNs / 1000;
+    if (us == 0) {
+        return 0;
+    }
+    int bucket = 64 - __builtin_clzll(us);
+    return bucket < ScopeTimerStats::kBucketCount ? bucket : ScopeTimerStats::kBucketCount - 1;
+}
+
+void sumSite(int id, ScopeTimerStats* stats) {
+    for (ThreadCounters* counters = gThreadCounters.load(std::memory_order_acquire);
+         counters != nullptr; counters = counters->next) {
+        const SiteCounters& site = counters->sites[id];
+        stats->count += site.count.load(std::memory_order_relaxed);
+        stats->totalNs += site.totalNs.load(std::memory_order_relaxed);
+        uint64_t maxNs = site.maxNs.load(std::memory_order_relaxed);
+        if (maxNs > stats->maxNs) {
+            stats->maxNs = maxNs;
+        }
+        for (int b = 0; b < ScopeTimerStats::kBucketCount; b++) {
+            stats->buckets[b] += site.buckets[b].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+int registeredSites() {
+    int count = gSiteCount.load(std::memory_order_acquire);
+    return count < kMaxSites ? count : kMaxSites;
+}
+
+std::string formatStats() {
+    // Sites with the same name are merged, in the order they registered
+    std::vector<std::pair<const char*, ScopeTimerStats>> scopes;
+    for (int id = 0; id < registeredSites(); id++) {
+        const char* name = gSiteNames[id].load(std::memory_order_acquire);
+        if (name == nullptr) {
+            continue;
+        }
+        bool merged = false;
+        for (auto& scope : scopes) {
+            if (strcmp(scope.first, name) == 0) {
+                sumSite(id, &scope.second);
+                merged = true;
+                break;
+            }
+        }
+        if (!merged) {
+            scopes.emplace_back(name, ScopeTimerStats());
+            sumSite(id, &scopes.back().second);
+        }
+    }
+
+    std::string result("Scope timers:\n");
+    char line[256];
+    snprintf(line, sizeof(line), "  %-40s %10s %12s %10s %10s %10s %10s %10s\n", "Scope", "Count",
+             "Total ms", "Avg us", "Max us", "50th us", "90th us", "99th us");
+    result.append(line);
+    for (const auto& scope : scopes) {
+        const ScopeTimerStats& stats = scope.second;
+        if (stats.count == 0) {
+            continue;
+        }
+        snprintf(line, sizeof(line),
+                 "  %-40s %10" PRIu64 " %12.2f %10.1f %10.1f %10" PRIu64 " %10" PRIu64
+                 " %10" PRIu64 "\n",
+                 scope.first, stats.count, stats.totalNs / 1000000.0,
+                 stats.totalNs / 1000.0 / stats.count, stats.maxNs / 1000.0,
+                 stats.percentileUs(50), stats.percentileUs(90), stats.percentileUs(99));
+        result.append(line);
+    }
+    return result;
+}
+
+}  // namespace
+
+ScopeTimerSite::ScopeTimerSite(const char* name) : mId(gSiteCount.fetch_add(1)) {
+    if (mId >= kMaxSites) {
+        ALOGW("Too many scope timers, not timing %s", name);
+        mId = -1;
+        return;
+    }
+    gSiteNames[mId].store(name, std::memory_order_release);
+}
+
+uint64_t ScopeTimerStats::percentileUs(int percentile) const {
+    uint64_t threshold = (count * percentile + 99) / 100;
+    uint64_t seen = 0;
+    for (int b = 0; b < kBucketCount; b++) {
+        seen += buckets[b];
+        if (seen >= threshold && seen > 0) {
+            return 1ULL << b;
+        }
+    }
+    return 0;
+}
+
+void ScopeTimer::record(int id, int64_t durationNs) {
+    if (id < 0 || id >= kMaxSites) {
+        return;
+    }
+    ThreadSlot& slot = tThreadSlot;
+    if (slot.counters == nullptr) {
+        slot.counters = acquireThreadCounters();
+    }
+    uint64_t duration = durationNs > 0 ? durationNs : 0;
+    SiteCounters& site = slot.counters->sites[id];
+    add(&site.count, 1);
+    add(&site.totalNs, duration);
+    if (duration > site.maxNs.load(std::memory_order_relaxed)) {
+        site.maxNs.store(duration, std::memory_order_relaxed);
+    }
+    add(&site.buckets[bucketFor(duration)], 1);
+}
+
+bool ScopeTimer::getStats(const char* name, ScopeTimerStats* outStats) {
+    *outStats = ScopeTimerStats();
+    bool found = false;
+    for (int id = 0; id < registeredSites(); id++) {
+        const char* siteName = gSiteNames[id].load(std::memory_order_acquire);
+        if (siteName != nullptr && strcmp(siteName, name) == 0) {
+            sumSite(id, outStats);
+            found = true;
+        }
+    }
+    return found;
+}
+
+void ScopeTimer::dump(int fd) {
+    std::string stats = formatStats();
+    const char* data = stats.data();
+    size_t remaining = stats.size();
+    while (remaining > 0) {
+        ssize_t written = TEMP_FAILURE_RETRY(write(fd, data, remaining));
+        if (written <= 0) {
+            return;
+        }
+        data += written;
+        remaining -= written;
+    }
+}
+
+void ScopeTimer::dump(FILE* out) {
+    fputs(formatStats().c_str(), out);
+}
+
+}  // namespace util
+}  // namespace android
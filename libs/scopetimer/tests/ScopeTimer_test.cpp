@@ -0,0 +1,85 @@
+// Copyright (C) 2018 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <android/util/ScopeTimer.h>
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+using namespace android::util;
+
+static void timedScope() {
+    SCOPE_TIMER("ScopeTimerTest.timedScope");
+}
+
+TEST(ScopeTimerTest, CountsAcrossThreads) {
+    ScopeTimerStats before;
+    timedScope();
+    ASSERT_TRUE(ScopeTimer::getStats("ScopeTimerTest.timedScope", &before));
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([]() {
+            for (int j = 0; j < 100; j++) {
+                timedScope();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ScopeTimerStats after;
+    ASSERT_TRUE(ScopeTimer::getStats("ScopeTimerTest.timedScope", &after));
+    EXPECT_EQ(before.count + 400, after.count);
+    uint64_t bucketed = 0;
+    for (int b = 0; b < ScopeTimerStats::kBucketCount; b++) {
+        bucketed += after.buckets[b];
+    }
+    EXPECT_EQ(after.count, bucketed);
+}
+
+TEST(ScopeTimerTest, MergesSitesWithTheSameName) {
+    {
+        SCOPE_TIMER("ScopeTimerTest.merged");
+    }
+    {
+        SCOPE_TIMER("ScopeTimerTest.merged");
+    }
+    ScopeTimerStats stats;
+    ASSERT_TRUE(ScopeTimer::getStats("ScopeTimerTest.merged", &stats));
+    EXPECT_EQ(2u, stats.count);
+    EXPECT_FALSE(ScopeTimer::getStats("ScopeTimerTest.unknown", &stats));
+}
+
+TEST(ScopeTimerTest, Disabled) {
+    ScopeTimer::setEnabled(false);
+    {
+        SCOPE_TIMER("ScopeTimerTest.disabled");
+    }
+    ScopeTimer::setEnabled(true);
+    ScopeTimerStats stats;
+    ASSERT_TRUE(ScopeTimer::getStats("ScopeTimerTest.disabled", &stats));
+    EXPECT_EQ(0u, stats.count);
+}
+
+TEST(ScopeTimerTest, Percentiles) {
+    ScopeTimerStats stats;
+    stats.count = 100;
+    stats.buckets[1] = 90;  // [1, 2) us
+    stats.buckets[5] = 10;  // [16, 32) us
+    EXPECT_EQ(2u, stats.percentileUs(50));
+    EXPECT_EQ(2u, stats.percentileUs(90));
+    EXPECT_EQ(32u, stats.percentileUs(99));
+}
@@ -25,6 +25,30 @@
 namespace android {
 namespace os {
 
+/*
+ * Instead of one wrapper per atom, a pull can be sent as a single wrapper
+ * whose bytes hold all the atoms by column, which saves a wrapper and a
+ * LogEvent buffer per atom. All values are little endian:
+ *
+ *   int32 magic (kColumnarPullMagic), int32 version (kColumnarPullVersion)
+ *   int32 row count, int32 field count, int32 string count
+ *   the string table: for each string, int32 length and the UTF-8 bytes
+ *   for each field, int32 type (ColumnType) and the values of all the rows:
+ *   int32 for INT, int64 for LONG, float for FLOAT, the int32 index of the
+ *   string in the table for STRING.
+ *
+ * Repeated strings, such as package names, are only sent once.
+ */
+static const int32_t kColumnarPullMagic = 0x4c4f4353;  // SCOL
+static const int32_t kColumnarPullVersion = 1;
+
+enum ColumnType : int32_t {
+  COLUMN_TYPE_INT = 0,
+  COLUMN_TYPE_LONG = 1,
+  COLUMN_TYPE_FLOAT = 2,
+  COLUMN_TYPE_STRING = 3,
+};
+
 // Represents a parcelable object. Only used to send data from Android OS to statsd.
 class StatsLogEventWrapper : public android::Parcelable {
  public:
@@ -36,6 +60,9 @@ class StatsLogEventWrapper : public android::Parcelable {
 
   android::status_t readFromParcel(const android::Parcel* in);
 
+  // Whether the bytes are a whole pull by column rather than a single atom.
+  bool isColumnarPull() const;
+
   // These are public for ease of conversion.
   std::vector<uint8_t> bytes;
 };
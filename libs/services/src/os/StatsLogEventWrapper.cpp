@@ -19,6 +19,7 @@
 #include <binder/Parcelable.h>
 #include <binder/Status.h>
 #include <utils/RefBase.h>
+#include <string.h>
 #include <vector>
 
 using android::Parcel;
@@ -41,5 +42,14 @@ status_t StatsLogEventWrapper::readFromParcel(const Parcel* in) {
     return ::android::NO_ERROR;
 };
 
+bool StatsLogEventWrapper::isColumnarPull() const {
+    int32_t magic;
+    if (bytes.size() < sizeof(magic)) {
+        return false;
+    }
+    memcpy(&magic, bytes.data(), sizeof(magic));
+    return magic == kColumnarPullMagic;
+}
+
 } // Namespace os
 } // Namespace android
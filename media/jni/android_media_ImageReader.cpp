@@ -20,10 +20,10 @@
 #include <cutils/atomic.h>
 #include <utils/Log.h>
 #include <utils/misc.h>
-#include <utils/List.h>
 #include <utils/String8.h>
 
 #include <cstdio>
+#include <vector>
 
 #include <gui/BufferItemConsumer.h>
 #include <gui/Surface.h>
@@ -86,6 +86,14 @@ static int32_t createProcessUniqueId() {
 
 // ----------------------------------------------------------------------------
 
+// The buffer of an image, which remembers how it was locked so that the planes of the image,
+// and the plane pointers, come from a single lock.
+struct ImageBufferItem : public BufferItem {
+    ImageBufferItem() : mLocked(false) {}
+    bool mLocked;
+    LockedImage mLockedImage;
+};
+
 class JNIImageReaderContext : public ConsumerBase::FrameAvailableListener
 {
 public:
@@ -95,8 +103,8 @@ public:
 
     virtual void onFrameAvailable(const BufferItem& item);
 
-    BufferItem* getBufferItem();
-    void returnBufferItem(BufferItem* buffer);
+    ImageBufferItem* getBufferItem();
+    void returnBufferItem(ImageBufferItem* buffer);
 
 
     void setBufferConsumer(const sp<BufferItemConsumer>& consumer) { mConsumer = consumer; }
@@ -121,7 +129,8 @@ private:
     static JNIEnv* getJNIEnv(bool* needsDetach);
     static void detachJNI();
 
-    List<BufferItem*> mBuffers;
+    // the free buffer items, reserved for maxImages so acquiring and releasing don't allocate
+    std::vector<ImageBufferItem*> mBuffers;
     sp<BufferItemConsumer> mConsumer;
     sp<IGraphicBufferProducer> mProducer;
     jobject mWeakThiz;
@@ -140,9 +149,9 @@ JNIImageReaderContext::JNIImageReaderContext(JNIEnv* env,
     mDataSpace(HAL_DATASPACE_UNKNOWN),
     mWidth(-1),
     mHeight(-1) {
+    mBuffers.reserve(maxImages);
     for (int i = 0; i < maxImages; i++) {
-        BufferItem* buffer = new BufferItem;
-        mBuffers.push_back(buffer);
+        mBuffers.push_back(new ImageBufferItem);
     }
 }
 
@@ -171,19 +180,19 @@ void JNIImageReaderContext::detachJNI() {
     }
 }
 
-BufferItem* JNIImageReaderContext::getBufferItem() {
+ImageBufferItem* JNIImageReaderContext::getBufferItem() {
     if (mBuffers.empty()) {
         return NULL;
     }
     // Return a BufferItem pointer and remove it from the list
-    List<BufferItem*>::iterator it = mBuffers.begin();
-    BufferItem* buffer = *it;
-    mBuffers.erase(it);
+    ImageBufferItem* buffer = mBuffers.back();
+    mBuffers.pop_back();
     return buffer;
 }
 
-void JNIImageReaderContext::returnBufferItem(BufferItem* buffer) {
+void JNIImageReaderContext::returnBufferItem(ImageBufferItem* buffer) {
     buffer->mGraphicBuffer = nullptr;
+    buffer->mLocked = false;
     mBuffers.push_back(buffer);
 }
 
@@ -201,9 +210,8 @@ JNIImageReaderContext::~JNIImageReaderContext() {
     }
 
     // Delete buffer items.
-    for (List<BufferItem *>::iterator it = mBuffers.begin();
-            it != mBuffers.end(); it++) {
-        delete *it;
+    for (ImageBufferItem* buffer : mBuffers) {
+        delete buffer;
     }
 
     if (mConsumer != 0) {
@@ -283,9 +291,9 @@ static void Image_setBufferItem(JNIEnv* env, jobject thiz,
     env->SetLongField(thiz, gSurfaceImageClassInfo.mNativeBuffer, reinterpret_cast<jlong>(buffer));
 }
 
-static BufferItem* Image_getBufferItem(JNIEnv* env, jobject image)
+static ImageBufferItem* Image_getBufferItem(JNIEnv* env, jobject image)
 {
-    return reinterpret_cast<BufferItem*>(
+    return reinterpret_cast<ImageBufferItem*>(
             env->GetLongField(image, gSurfaceImageClassInfo.mNativeBuffer));
 }
 
@@ -458,21 +466,17 @@ static void ImageReader_close(JNIEnv* env, jobject thiz)
 
 static sp<Fence> Image_unlockIfLocked(JNIEnv* env, jobject image) {
     ALOGV("%s", __FUNCTION__);
-    BufferItem* buffer = Image_getBufferItem(env, image);
+    ImageBufferItem* buffer = Image_getBufferItem(env, image);
     if (buffer == NULL) {
         jniThrowException(env, "java/lang/IllegalStateException",
                 "Image is not initialized");
         return Fence::NO_FENCE;
     }
 
-    // Is locked?
-    bool wasBufferLocked = false;
-    jobject planes = NULL;
-    if (!isFormatOpaque(buffer->mGraphicBuffer->getPixelFormat())) {
-        planes = env->GetObjectField(image, gSurfaceImageClassInfo.mPlanes);
-    }
-    wasBufferLocked = (planes != NULL);
+    // Is locked? Either for the planes or for the plane pointers.
+    bool wasBufferLocked = buffer->mLocked;
     if (wasBufferLocked) {
+        buffer->mLocked = false;
         status_t res = OK;
         int fenceFd = -1;
         if (wasBufferLocked) {
@@ -499,7 +503,7 @@ static void ImageReader_imageRelease(JNIEnv* env, jobject thiz, jobject image)
     }
 
     BufferItemConsumer* bufferConsumer = ctx->getBufferConsumer();
-    BufferItem* buffer = Image_getBufferItem(env, image);
+    ImageBufferItem* buffer = Image_getBufferItem(env, image);
     if (buffer == nullptr) {
         // Release an already closed image is harmless.
         return;
@@ -522,7 +526,7 @@ static jint ImageReader_imageSetup(JNIEnv* env, jobject thiz, jobject image) {
     }
 
     BufferItemConsumer* bufferConsumer = ctx->getBufferConsumer();
-    BufferItem* buffer = ctx->getBufferItem();
+    ImageBufferItem* buffer = ctx->getBufferItem();
     if (buffer == NULL) {
         ALOGW("Unable to acquire a buffer item, very likely client tried to acquire more than"
             " maxImages buffers");
@@ -685,23 +689,30 @@ static jobject ImageReader_getSurface(JNIEnv* env, jobject thiz)
     return android_view_Surface_createFromIGraphicBufferProducer(env, gbp);
 }
 
-static void Image_getLockedImage(JNIEnv* env, jobject thiz, LockedImage *image) {
+static LockedImage* Image_getLockedImage(JNIEnv* env, jobject thiz) {
     ALOGV("%s", __FUNCTION__);
-    BufferItem* buffer = Image_getBufferItem(env, thiz);
+    ImageBufferItem* buffer = Image_getBufferItem(env, thiz);
     if (buffer == NULL) {
         jniThrowException(env, "java/lang/IllegalStateException",
                 "Image is not initialized");
-        return;
+        return NULL;
+    }
+    if (buffer->mLocked) {
+        return &buffer->mLockedImage;
     }
 
+    LockedImage* image = &buffer->mLockedImage;
+    *image = LockedImage();
+
     status_t res = lockImageFromBuffer(buffer,
             GRALLOC_USAGE_SW_READ_OFTEN, buffer->mFence->dup(), image);
     if (res != OK) {
         jniThrowExceptionFmt(env, "java/lang/RuntimeException",
                 "lock buffer failed for format 0x%x",
                 buffer->mGraphicBuffer->getPixelFormat());
-        return;
+        return NULL;
     }
+    buffer->mLocked = true;
 
     // Carry over some fields from BufferItem.
     image->crop        = buffer->mCrop;
@@ -714,6 +725,7 @@ static void Image_getLockedImage(JNIEnv* env, jobject thiz, LockedImage *image)
     ALOGV("%s: Successfully locked the image", __FUNCTION__);
     // crop, transform, scalingMode, timestamp, and frameNumber should be set by producer,
     // and we don't set them here.
+    return image;
 }
 
 static void Image_getLockedImageInfo(JNIEnv* env, LockedImage* buffer, int idx,
@@ -762,14 +774,13 @@ static jobjectArray Image_createSurfacePlanes(JNIEnv* env, jobject thiz,
         return surfacePlanes;
     }
 
-    LockedImage lockedImg = LockedImage();
-    Image_getLockedImage(env, thiz, &lockedImg);
-    if (env->ExceptionCheck()) {
+    LockedImage* lockedImg = Image_getLockedImage(env, thiz);
+    if (lockedImg == NULL) {
         return NULL;
     }
     // Create all SurfacePlanes
     for (int i = 0; i < numPlanes; i++) {
-        Image_getLockedImageInfo(env, &lockedImg, i, halReaderFormat,
+        Image_getLockedImageInfo(env, lockedImg, i, halReaderFormat,
                 &pData, &dataSize, &pixelStride, &rowStride);
         byteBuffer = env->NewDirectByteBuffer(pData, dataSize);
         if ((byteBuffer == NULL) && (env->ExceptionCheck() == false)) {
@@ -787,6 +798,55 @@ static jobjectArray Image_createSurfacePlanes(JNIEnv* env, jobject thiz,
     return surfacePlanes;
 }
 
+// Locks the image like nativeCreatePlanes() but only writes the address, size, pixel stride and
+// row stride of each plane to planeInfo, without creating planes and ByteBuffers for them. The
+// addresses stay valid until the image is closed.
+static void Image_getPlanePointers(JNIEnv* env, jobject thiz,
+        int numPlanes, int readerFormat, jlongArray planeInfoArray)
+{
+    ALOGV("%s: get %d plane pointers", __FUNCTION__, numPlanes);
+    if (planeInfoArray == NULL || numPlanes < 0
+            || env->GetArrayLength(planeInfoArray) < numPlanes * 4) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "planeInfo must hold 4 values per plane");
+        return;
+    }
+
+    PublicFormat publicReaderFormat = static_cast<PublicFormat>(readerFormat);
+    int halReaderFormat = android_view_Surface_mapPublicFormatToHalFormat(
+        publicReaderFormat);
+    if (isFormatOpaque(halReaderFormat)) {
+        if (numPlanes > 0) {
+            jniThrowException(env, "java/lang/IllegalArgumentException",
+                    "Opaque images have no planes");
+        }
+        return;
+    }
+
+    LockedImage* lockedImg = Image_getLockedImage(env, thiz);
+    if (lockedImg == NULL) {
+        return;
+    }
+
+    std::vector<jlong> planeInfo(numPlanes * 4);
+    for (int i = 0; i < numPlanes; i++) {
+        uint8_t *pData = NULL;
+        uint32_t dataSize = 0;
+        int pixelStride = 0;
+        int rowStride = 0;
+        Image_getLockedImageInfo(env, lockedImg, i, halReaderFormat,
+                &pData, &dataSize, &pixelStride, &rowStride);
+        if (env->ExceptionCheck()) {
+            return;
+        }
+        planeInfo[i * 4] = reinterpret_cast<jlong>(pData);
+        planeInfo[i * 4 + 1] = dataSize;
+        planeInfo[i * 4 + 2] = pixelStride;
+        planeInfo[i * 4 + 3] = rowStride;
+    }
+    env->SetLongArrayRegion(planeInfoArray, 0, planeInfo.size(), planeInfo.data());
+}
+
 static jint Image_getWidth(JNIEnv* env, jobject thiz)
 {
     BufferItem* buffer = Image_getBufferItem(env, thiz);
@@ -850,6 +910,7 @@ static const JNINativeMethod gImageReaderMethods[] = {
 static const JNINativeMethod gImageMethods[] = {
     {"nativeCreatePlanes",      "(II)[Landroid/media/ImageReader$SurfaceImage$SurfacePlane;",
                                                              (void*)Image_createSurfacePlanes },
+    {"nativeGetPlanePointers",  "(II[J)V",                   (void*)Image_getPlanePointers },
     {"nativeGetWidth",          "()I",                       (void*)Image_getWidth },
     {"nativeGetHeight",         "()I",                       (void*)Image_getHeight },
     {"nativeGetFormat",         "(I)I",                      (void*)Image_getFormat },
@@ -121,6 +121,13 @@ struct fields_t {
     jfieldID patternSkipBlocksID;
 };
 
+static struct {
+    jclass clazz;
+    jmethodID ctorId;
+    jclass rectClazz;
+    jmethodID rectCtorId;
+} gMediaImageInfo;
+
 static fields_t gFields;
 static const void *sRefBaseOwner;
 
@@ -130,7 +137,8 @@ JMediaCodec::JMediaCodec(
         JNIEnv *env, jobject thiz,
         const char *name, bool nameIsType, bool encoder)
     : mClass(NULL),
-      mObject(NULL) {
+      mObject(NULL),
+      mPersistentBufferWrappers(false) {
     jclass clazz = env->GetObjectClass(thiz);
     CHECK(clazz != NULL);
 
@@ -192,6 +200,10 @@ void JMediaCodec::cacheJavaObjects(JNIEnv *env) {
     mByteBufferLimitMethodID = env->GetMethodID(
             mByteBufferClass, "limit", "(I)Ljava/nio/Buffer;");
     CHECK(mByteBufferLimitMethodID != NULL);
+
+    mByteBufferSetAccessibleMethodID = env->GetMethodID(
+            mByteBufferClass, "setAccessible", "(Z)V");
+    CHECK(mByteBufferSetAccessibleMethodID != NULL);
 }
 
 status_t JMediaCodec::initCheck() const {
@@ -203,6 +215,8 @@ void JMediaCodec::registerSelf() {
 }
 
 void JMediaCodec::release() {
+    clearBufferWrappers(AndroidRuntime::getJNIEnv());
+
     if (mCodec != NULL) {
         mCodec->release();
         mCodec.clear();
@@ -238,6 +252,7 @@ JMediaCodec::~JMediaCodec() {
     mObject = NULL;
     env->DeleteGlobalRef(mClass);
     mClass = NULL;
+    clearBufferWrappers(env);
     deleteJavaObjects(env);
 }
 
@@ -251,6 +266,7 @@ void JMediaCodec::deleteJavaObjects(JNIEnv *env) {
     mByteBufferAsReadOnlyBufferMethodID = NULL;
     mByteBufferPositionMethodID = NULL;
     mByteBufferLimitMethodID = NULL;
+    mByteBufferSetAccessibleMethodID = NULL;
 }
 
 status_t JMediaCodec::enableOnFrameRenderedListener(jboolean enable) {
@@ -325,6 +341,9 @@ status_t JMediaCodec::start() {
 status_t JMediaCodec::stop() {
     mSurfaceTextureClient.clear();
 
+    // the codec buffers are freed by stop()
+    clearBufferWrappers(AndroidRuntime::getJNIEnv());
+
     return mCodec->stop();
 }
 
@@ -333,6 +352,8 @@ status_t JMediaCodec::flush() {
 }
 
 status_t JMediaCodec::reset() {
+    clearBufferWrappers(AndroidRuntime::getJNIEnv());
+
     return mCodec->reset();
 }
 
@@ -444,8 +465,8 @@ status_t JMediaCodec::getBuffers(
         const sp<MediaCodecBuffer> &buffer = buffers.itemAt(i);
 
         jobject byteBuffer = NULL;
-        err = createByteBufferFromABuffer(
-                env, !input /* readOnly */, true /* clearBuffer */, buffer, &byteBuffer);
+        err = getWrappedBuffer(
+                env, input, i, true /* clearBuffer */, buffer, &byteBuffer);
         if (err != OK) {
             return err;
         }
@@ -490,6 +511,15 @@ status_t JMediaCodec::createByteBufferFromABuffer(
     if (byteBuffer == NULL) {
         return NO_MEMORY;
     }
+    resetByteBuffer(env, byteBuffer, clearBuffer, buffer);
+
+    *buf = byteBuffer;
+    return OK;
+}
+
+template <typename T>
+void JMediaCodec::resetByteBuffer(
+        JNIEnv *env, jobject byteBuffer, bool clearBuffer, const sp<T> &buffer) const {
     jobject me = env->CallObjectMethod(
             byteBuffer, mByteBufferOrderMethodID, mNativeByteOrderObj);
     env->DeleteLocalRef(me);
@@ -502,11 +532,70 @@ status_t JMediaCodec::createByteBufferFromABuffer(
             clearBuffer ? 0 : buffer->offset());
     env->DeleteLocalRef(me);
     me = NULL;
+}
 
-    *buf = byteBuffer;
+status_t JMediaCodec::getWrappedBuffer(
+        JNIEnv *env, bool input, size_t index, bool clearBuffer,
+        const sp<MediaCodecBuffer> &buffer, jobject *buf) const {
+    Mutex::Autolock autoLock(mBufferWrapperLock);
+    if (!mPersistentBufferWrappers || buffer == NULL || buffer->base() == NULL) {
+        return createByteBufferFromABuffer(
+                env, !input /* readOnly */, clearBuffer, buffer, buf);
+    }
+
+    std::vector<BufferWrapper> &wrappers = mBufferWrappers[input ? 0 : 1];
+    if (index >= wrappers.size()) {
+        wrappers.resize(index + 1, BufferWrapper{NULL, 0, NULL});
+    }
+    BufferWrapper &wrapper = wrappers[index];
+
+    // reuse the wrapper as long as the slot keeps the same memory, MediaCodec.java makes the
+    // ByteBuffers it hands out inaccessible once they go back to the codec
+    if (wrapper.mByteBuffer != NULL
+            && wrapper.mBase == buffer->base() && wrapper.mCapacity == buffer->capacity()) {
+        *buf = env->NewLocalRef(wrapper.mByteBuffer);
+        if (*buf == NULL) {
+            return NO_MEMORY;
+        }
+        env->CallVoidMethod(*buf, mByteBufferSetAccessibleMethodID, (jboolean)true);
+        resetByteBuffer(env, *buf, clearBuffer, buffer);
+        return OK;
+    }
+
+    status_t err = createByteBufferFromABuffer(
+            env, !input /* readOnly */, clearBuffer, buffer, buf);
+    if (err != OK || *buf == NULL) {
+        return err;
+    }
+    if (wrapper.mByteBuffer != NULL) {
+        env->DeleteGlobalRef(wrapper.mByteBuffer);
+    }
+    wrapper.mBase = buffer->base();
+    wrapper.mCapacity = buffer->capacity();
+    wrapper.mByteBuffer = env->NewGlobalRef(*buf);
     return OK;
 }
 
+void JMediaCodec::clearBufferWrappers(JNIEnv *env) {
+    Mutex::Autolock autoLock(mBufferWrapperLock);
+    for (std::vector<BufferWrapper> &wrappers : mBufferWrappers) {
+        for (const BufferWrapper &wrapper : wrappers) {
+            if (wrapper.mByteBuffer != NULL) {
+                env->DeleteGlobalRef(wrapper.mByteBuffer);
+            }
+        }
+        wrappers.clear();
+    }
+}
+
+void JMediaCodec::setPersistentBufferWrappers(JNIEnv *env, bool enable) {
+    if (!enable) {
+        clearBufferWrappers(env);
+    }
+    Mutex::Autolock autoLock(mBufferWrapperLock);
+    mPersistentBufferWrappers = enable;
+}
+
 status_t JMediaCodec::getBuffer(
         JNIEnv *env, bool input, size_t index, jobject *buf) const {
     sp<MediaCodecBuffer> buffer;
@@ -520,8 +609,7 @@ status_t JMediaCodec::getBuffer(
         return err;
     }
 
-    return createByteBufferFromABuffer(
-            env, !input /* readOnly */, input /* clearBuffer */, buffer, buf);
+    return getWrappedBuffer(env, input, index, input /* clearBuffer */, buffer, buf);
 }
 
 status_t JMediaCodec::getImage(
@@ -574,25 +662,11 @@ status_t JMediaCodec::getImage(
     jobject cropRect = NULL;
     int32_t left, top, right, bottom;
     if (buffer->meta()->findRect("crop-rect", &left, &top, &right, &bottom)) {
-        ScopedLocalRef<jclass> rectClazz(
-                env, env->FindClass("android/graphics/Rect"));
-        CHECK(rectClazz.get() != NULL);
-
-        jmethodID rectConstructID = env->GetMethodID(
-                rectClazz.get(), "<init>", "(IIII)V");
-
-        cropRect = env->NewObject(
-                rectClazz.get(), rectConstructID, left, top, right + 1, bottom + 1);
+        cropRect = env->NewObject(gMediaImageInfo.rectClazz, gMediaImageInfo.rectCtorId,
+                left, top, right + 1, bottom + 1);
     }
 
-    ScopedLocalRef<jclass> imageClazz(
-            env, env->FindClass("android/media/MediaCodec$MediaImage"));
-    CHECK(imageClazz.get() != NULL);
-
-    jmethodID imageConstructID = env->GetMethodID(imageClazz.get(), "<init>",
-            "(Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;ZJIILandroid/graphics/Rect;)V");
-
-    *buf = env->NewObject(imageClazz.get(), imageConstructID,
+    *buf = env->NewObject(gMediaImageInfo.clazz, gMediaImageInfo.ctorId,
             byteBuffer, infoBuffer,
             (jboolean)!input /* readOnly */,
             (jlong)timestamp,
@@ -1871,6 +1945,18 @@ static void android_media_MediaCodec_setVideoScalingMode(
     codec->setVideoScalingMode(mode);
 }
 
+static void android_media_MediaCodec_setPersistentBufferWrappers(
+        JNIEnv *env, jobject thiz, jboolean enable) {
+    sp<JMediaCodec> codec = getMediaCodec(env, thiz);
+
+    if (codec == NULL) {
+        throwExceptionAsNecessary(env, INVALID_OPERATION);
+        return;
+    }
+
+    codec->setPersistentBufferWrappers(env, enable);
+}
+
 static void android_media_MediaCodec_native_init(JNIEnv *env) {
     ScopedLocalRef<jclass> clazz(
             env, env->FindClass("android/media/MediaCodec"));
@@ -2037,6 +2123,24 @@ static void android_media_MediaCodec_native_init(JNIEnv *env) {
     field = env->GetFieldID(clazz.get(), "level", "I");
     CHECK(field != NULL);
     gCodecInfo.levelField = field;
+
+    // looked up once, getImage() creates an image for every frame
+    clazz.reset(env->FindClass("android/media/MediaCodec$MediaImage"));
+    CHECK(clazz.get() != NULL);
+    gMediaImageInfo.clazz = (jclass)env->NewGlobalRef(clazz.get());
+
+    method = env->GetMethodID(clazz.get(), "<init>",
+            "(Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;ZJIILandroid/graphics/Rect;)V");
+    CHECK(method != NULL);
+    gMediaImageInfo.ctorId = method;
+
+    clazz.reset(env->FindClass("android/graphics/Rect"));
+    CHECK(clazz.get() != NULL);
+    gMediaImageInfo.rectClazz = (jclass)env->NewGlobalRef(clazz.get());
+
+    method = env->GetMethodID(clazz.get(), "<init>", "(IIII)V");
+    CHECK(method != NULL);
+    gMediaImageInfo.rectCtorId = method;
 }
 
 static void android_media_MediaCodec_native_setup(
@@ -2159,6 +2263,9 @@ static const JNINativeMethod gMethods[] = {
     { "getImage", "(ZI)Landroid/media/Image;",
       (void *)android_media_MediaCodec_getImage },
 
+    { "native_setPersistentBufferWrappers", "(Z)V",
+      (void *)android_media_MediaCodec_setPersistentBufferWrappers },
+
     { "getName", "()Ljava/lang/String;",
       (void *)android_media_MediaCodec_getName },
 
@@ -24,6 +24,9 @@
 #include <media/stagefright/foundation/ABase.h>
 #include <media/stagefright/foundation/AHandler.h>
 #include <utils/Errors.h>
+#include <utils/Mutex.h>
+
+#include <vector>
 
 namespace android {
 
@@ -34,6 +37,7 @@ struct AString;
 struct ICrypto;
 class IGraphicBufferProducer;
 struct MediaCodec;
+class MediaCodecBuffer;
 struct PersistentSurface;
 class Surface;
 namespace hardware {
@@ -128,6 +132,10 @@ struct JMediaCodec : public AHandler {
 
     void setVideoScalingMode(int mode);
 
+    // Once enabled, getBuffer() and getBuffers() return the same ByteBuffer for a codec buffer
+    // every time it is dequeued instead of wrapping it again.
+    void setPersistentBufferWrappers(JNIEnv *env, bool enable);
+
 protected:
     virtual ~JMediaCodec();
 
@@ -150,6 +158,18 @@ private:
     jmethodID mByteBufferPositionMethodID;
     jmethodID mByteBufferLimitMethodID;
     jmethodID mByteBufferAsReadOnlyBufferMethodID;
+    jmethodID mByteBufferSetAccessibleMethodID;
+
+    // the ByteBuffer that persistently wraps the memory of an input or output buffer slot
+    struct BufferWrapper {
+        void *mBase;
+        size_t mCapacity;
+        jobject mByteBuffer;
+    };
+
+    mutable Mutex mBufferWrapperLock;
+    bool mPersistentBufferWrappers;
+    mutable std::vector<BufferWrapper> mBufferWrappers[2];
 
     sp<ALooper> mLooper;
     sp<MediaCodec> mCodec;
@@ -164,6 +184,15 @@ private:
             JNIEnv *env, bool readOnly, bool clearBuffer, const sp<T> &buffer,
             jobject *buf) const;
 
+    template <typename T>
+    void resetByteBuffer(
+            JNIEnv *env, jobject byteBuffer, bool clearBuffer, const sp<T> &buffer) const;
+
+    status_t getWrappedBuffer(
+            JNIEnv *env, bool input, size_t index, bool clearBuffer,
+            const sp<MediaCodecBuffer> &buffer, jobject *buf) const;
+    void clearBufferWrappers(JNIEnv *env);
+
     void cacheJavaObjects(JNIEnv *env);
     void deleteJavaObjects(JNIEnv *env);
     void handleCallback(const sp<AMessage> &msg);
@@ -44,6 +44,8 @@
 #include <media/stagefright/NuMediaExtractor.h>
 #include <nativehelper/ScopedLocalRef.h>
 
+#include <vector>
+
 namespace android {
 
 using namespace hardware::cas::V1_0;
@@ -53,13 +55,21 @@ struct fields_t {
 
     jmethodID cryptoInfoSetID;
     jmethodID cryptoInfoSetPatternID;
+
+    jmethodID byteBufferArrayID;
+    jmethodID byteBufferPositionID;
+    jmethodID byteBufferLimitID;
 };
 
 static fields_t gFields;
 
 JMediaExtractor::JMediaExtractor(JNIEnv *env, jobject thiz)
     : mClass(NULL),
-      mObject(NULL) {
+      mObject(NULL),
+      mPrefetchStatus(OK),
+      mPrefetchEnabled(false),
+      mPrefetching(false),
+      mPrefetchRunning(false) {
     jclass clazz = env->GetObjectClass(thiz);
     CHECK(clazz != NULL);
 
@@ -70,6 +80,8 @@ JMediaExtractor::JMediaExtractor(JNIEnv *env, jobject thiz)
 }
 
 JMediaExtractor::~JMediaExtractor() {
+    stopPrefetch(true /* clear */);
+
     JNIEnv *env = AndroidRuntime::getJNIEnv();
 
     env->DeleteWeakGlobalRef(mObject);
@@ -146,16 +158,31 @@ status_t JMediaExtractor::getFileFormat(jobject *format) const {
 }
 
 status_t JMediaExtractor::selectTrack(size_t index) {
-    return mImpl->selectTrack(index);
+    stopPrefetch(true /* clear */);
+    status_t err = mImpl->selectTrack(index);
+    if (mPrefetchEnabled) {
+        startPrefetch();
+    }
+    return err;
 }
 
 status_t JMediaExtractor::unselectTrack(size_t index) {
-    return mImpl->unselectTrack(index);
+    stopPrefetch(true /* clear */);
+    status_t err = mImpl->unselectTrack(index);
+    if (mPrefetchEnabled) {
+        startPrefetch();
+    }
+    return err;
 }
 
 status_t JMediaExtractor::seekTo(
         int64_t timeUs, MediaSource::ReadOptions::SeekMode mode) {
-    return mImpl->seekTo(timeUs, mode);
+    stopPrefetch(true /* clear */);
+    status_t err = mImpl->seekTo(timeUs, mode);
+    if (mPrefetchEnabled) {
+        startPrefetch();
+    }
+    return err;
 }
 
 status_t JMediaExtractor::advance() {
@@ -274,6 +301,212 @@ status_t JMediaExtractor::getSampleFlags(uint32_t *sampleFlags) {
     return OK;
 }
 
+status_t JMediaExtractor::getSampleInfo(Sample *sample) {
+    status_t err;
+    if ((err = mImpl->getSampleTime(&sample->mTimeUs)) != OK
+            || (err = getSampleFlags(&sample->mFlags)) != OK
+            || (err = mImpl->getSampleTrackIndex(&sample->mTrackIndex)) != OK) {
+        return err;
+    }
+    return OK;
+}
+
+status_t JMediaExtractor::readSample(Sample *sample) {
+    size_t size;
+    status_t err = mImpl->getSampleSize(&size);
+    if (err != OK) {
+        return err;
+    }
+
+    sample->mData = new ABuffer(size);
+    if ((err = mImpl->readSampleData(sample->mData)) != OK
+            || (err = getSampleInfo(sample)) != OK) {
+        return err;
+    }
+
+    // the end of the stream is reported by the next read
+    mImpl->advance();
+    return OK;
+}
+
+status_t JMediaExtractor::readSampleDataBatch(
+        jobject byteBuf, size_t offset, size_t maxSamples, int64_t *sampleInfo,
+        size_t *numSamples) {
+    JNIEnv *env = AndroidRuntime::getJNIEnv();
+    *numSamples = 0;
+
+    void *dst = env->GetDirectBufferAddress(byteBuf);
+
+    size_t dstSize;
+    jbyteArray byteArray = NULL;
+
+    if (dst == NULL) {
+        byteArray =
+            (jbyteArray)env->CallObjectMethod(byteBuf, gFields.byteBufferArrayID);
+
+        if (byteArray == NULL) {
+            return INVALID_OPERATION;
+        }
+
+        dst = env->GetByteArrayElements(byteArray, NULL);
+
+        dstSize = (size_t) env->GetArrayLength(byteArray);
+    } else {
+        dstSize = (size_t) env->GetDirectBufferCapacity(byteBuf);
+    }
+
+    if (dstSize < offset) {
+        if (byteArray != NULL) {
+            env->ReleaseByteArrayElements(byteArray, (jbyte *)dst, 0);
+        }
+
+        return -ERANGE;
+    }
+
+    uint8_t *out = (uint8_t *)dst + offset;
+    size_t available = dstSize - offset;
+    size_t used = 0;
+    status_t err = OK;
+
+    while (*numSamples < maxSamples) {
+        Sample sample;
+        size_t size;
+        bool prefetched = false;
+        {
+            Mutex::Autolock autoLock(mPrefetchLock);
+            while (mPrefetching && mPrefetched.empty() && mPrefetchStatus == OK) {
+                mPrefetchCondition.wait(mPrefetchLock);
+            }
+            if (!mPrefetched.empty()) {
+                sample = *mPrefetched.begin();
+                size = sample.mData->size();
+                if (size > available - used) {
+                    break;
+                }
+                mPrefetched.erase(mPrefetched.begin());
+                mPrefetchCondition.broadcast();
+                prefetched = true;
+            } else if (mPrefetching) {
+                err = mPrefetchStatus;
+                break;
+            }
+        }
+
+        if (prefetched) {
+            memcpy(out + used, sample.mData->data(), size);
+        } else {
+            // read straight into the caller's buffer
+            if ((err = mImpl->getSampleSize(&size)) != OK) {
+                break;
+            }
+            if (size > available - used) {
+                break;
+            }
+            sp<ABuffer> buffer = new ABuffer(out + used, size);
+            if ((err = mImpl->readSampleData(buffer)) != OK
+                    || (err = getSampleInfo(&sample)) != OK) {
+                break;
+            }
+            mImpl->advance();
+        }
+
+        int64_t *info = sampleInfo + *numSamples * kSampleInfoSize;
+        info[0] = size;
+        info[1] = sample.mTimeUs;
+        info[2] = sample.mFlags;
+        info[3] = sample.mTrackIndex;
+        used += size;
+        ++*numSamples;
+    }
+
+    if (byteArray != NULL) {
+        env->ReleaseByteArrayElements(byteArray, (jbyte *)dst, 0);
+    }
+
+    if (*numSamples == 0) {
+        // like readSampleData(), a sample that doesn't fit is an error
+        return err != OK ? err : -ENOMEM;
+    }
+
+    jobject me = env->CallObjectMethod(
+            byteBuf, gFields.byteBufferLimitID, offset + used);
+    env->DeleteLocalRef(me);
+    me = env->CallObjectMethod(
+            byteBuf, gFields.byteBufferPositionID, offset);
+    env->DeleteLocalRef(me);
+    me = NULL;
+
+    return OK;
+}
+
+void JMediaExtractor::setPrefetch(bool enable) {
+    mPrefetchEnabled = enable;
+    if (enable) {
+        startPrefetch();
+    } else {
+        // the samples already read are still returned by readSampleDataBatch()
+        stopPrefetch(false /* clear */);
+    }
+}
+
+void JMediaExtractor::startPrefetch() {
+    Mutex::Autolock autoLock(mPrefetchLock);
+    if (mPrefetchRunning) {
+        return;
+    }
+    mPrefetching = true;
+    mPrefetchRunning = true;
+    mPrefetchStatus = OK;
+    // a MediaDataSource is read through Java, so the thread is attached to the VM
+    AndroidRuntime::createJavaThread("MediaExtractorPrefetch", prefetchThread, this);
+}
+
+void JMediaExtractor::stopPrefetch(bool clear) {
+    Mutex::Autolock autoLock(mPrefetchLock);
+    mPrefetching = false;
+    mPrefetchCondition.broadcast();
+    while (mPrefetchRunning) {
+        mPrefetchCondition.wait(mPrefetchLock);
+    }
+    if (clear) {
+        mPrefetched.clear();
+    }
+    mPrefetchStatus = OK;
+}
+
+// static
+void JMediaExtractor::prefetchThread(void *arg) {
+    static_cast<JMediaExtractor *>(arg)->prefetchLoop();
+}
+
+void JMediaExtractor::prefetchLoop() {
+    Mutex::Autolock autoLock(mPrefetchLock);
+    size_t numPrefetched = mPrefetched.size();
+    while (mPrefetching) {
+        if (numPrefetched >= kMaxPrefetchedSamples || mPrefetchStatus != OK) {
+            mPrefetchCondition.wait(mPrefetchLock);
+            numPrefetched = mPrefetched.size();
+            continue;
+        }
+
+        mPrefetchLock.unlock();
+        Sample sample;
+        status_t err = readSample(&sample);
+        mPrefetchLock.lock();
+
+        // kept even when stopping, the extractor already advanced past it
+        if (err == OK) {
+            mPrefetched.push_back(sample);
+            ++numPrefetched;
+        } else {
+            mPrefetchStatus = err;
+        }
+        mPrefetchCondition.broadcast();
+    }
+    mPrefetchRunning = false;
+    mPrefetchCondition.broadcast();
+}
+
 status_t JMediaExtractor::getMetrics(Parcel *reply) const {
 
     status_t status = mImpl->getMetrics(reply);
@@ -466,6 +699,52 @@ static jint android_media_MediaExtractor_readSampleData(
     return (jint) sampleSize;
 }
 
+static jint android_media_MediaExtractor_readSampleDataBatch(
+        JNIEnv *env, jobject thiz, jobject byteBuf, jint offset, jlongArray sampleInfoArray) {
+    sp<JMediaExtractor> extractor = getMediaExtractor(env, thiz);
+
+    if (extractor == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", NULL);
+        return -1;
+    }
+
+    size_t maxSamples = sampleInfoArray != NULL
+            ? env->GetArrayLength(sampleInfoArray) / JMediaExtractor::kSampleInfoSize : 0;
+    if (byteBuf == NULL || maxSamples == 0) {
+        jniThrowException(env, "java/lang/IllegalArgumentException", NULL);
+        return -1;
+    }
+
+    std::vector<int64_t> sampleInfo(maxSamples * JMediaExtractor::kSampleInfoSize);
+    size_t numSamples;
+    status_t err = extractor->readSampleDataBatch(
+            byteBuf, offset, maxSamples, sampleInfo.data(), &numSamples);
+
+    if (err == ERROR_END_OF_STREAM) {
+        return -1;
+    } else if (err != OK) {
+        jniThrowException(env, "java/lang/IllegalArgumentException", NULL);
+        return -1;
+    }
+
+    env->SetLongArrayRegion(sampleInfoArray, 0, numSamples * JMediaExtractor::kSampleInfoSize,
+            reinterpret_cast<const jlong *>(sampleInfo.data()));
+
+    return (jint) numSamples;
+}
+
+static void android_media_MediaExtractor_setPrefetch(
+        JNIEnv *env, jobject thiz, jboolean enable) {
+    sp<JMediaExtractor> extractor = getMediaExtractor(env, thiz);
+
+    if (extractor == NULL) {
+        jniThrowException(env, "java/lang/IllegalStateException", NULL);
+        return;
+    }
+
+    extractor->setPrefetch(enable);
+}
+
 static jint android_media_MediaExtractor_getSampleTrackIndex(
         JNIEnv *env, jobject thiz) {
     sp<JMediaExtractor> extractor = getMediaExtractor(env, thiz);
@@ -683,6 +962,19 @@ static void android_media_MediaExtractor_native_init(JNIEnv *env) {
 
     gFields.cryptoInfoSetPatternID =
         env->GetMethodID(clazz, "setPattern", "(II)V");
+
+    clazz = env->FindClass("java/nio/ByteBuffer");
+    CHECK(clazz != NULL);
+
+    gFields.byteBufferArrayID = env->GetMethodID(clazz, "array", "()[B");
+    CHECK(gFields.byteBufferArrayID != NULL);
+
+    gFields.byteBufferPositionID =
+        env->GetMethodID(clazz, "position", "(I)Ljava/nio/Buffer;");
+    CHECK(gFields.byteBufferPositionID != NULL);
+
+    gFields.byteBufferLimitID = env->GetMethodID(clazz, "limit", "(I)Ljava/nio/Buffer;");
+    CHECK(gFields.byteBufferLimitID != NULL);
 }
 
 static void android_media_MediaExtractor_native_setup(
@@ -918,6 +1210,12 @@ static const JNINativeMethod gMethods[] = {
     { "readSampleData", "(Ljava/nio/ByteBuffer;I)I",
         (void *)android_media_MediaExtractor_readSampleData },
 
+    { "native_readSampleDataBatch", "(Ljava/nio/ByteBuffer;I[J)I",
+        (void *)android_media_MediaExtractor_readSampleDataBatch },
+
+    { "native_setPrefetch", "(Z)V",
+        (void *)android_media_MediaExtractor_setPrefetch },
+
     { "getSampleTrackIndex", "()I",
         (void *)android_media_MediaExtractor_getSampleTrackIndex },
 
@@ -22,13 +22,16 @@
 #include <media/DataSource.h>
 #include <utils/Errors.h>
 #include <utils/KeyedVector.h>
+#include <utils/List.h>
 #include <utils/RefBase.h>
 #include <utils/String8.h>
+#include <utils/threads.h>
 
 #include "jni.h"
 
 namespace android {
 
+struct ABuffer;
 struct IMediaHTTPService;
 class MetaData;
 struct NuMediaExtractor;
@@ -65,16 +68,55 @@ struct JMediaExtractor : public RefBase {
     status_t getSampleMeta(sp<MetaData> *sampleMeta);
     status_t getMetrics(Parcel *reply) const;
 
+    // The number of longs readSampleDataBatch() writes to sampleInfo for every sample: its size,
+    // time in us, flags and track index. The samples are stored back to back from offset.
+    enum { kSampleInfoSize = 4 };
+
+    // Reads up to maxSamples samples, as many as fit in byteBuf, and advances past them.
+    status_t readSampleDataBatch(
+            jobject byteBuf, size_t offset, size_t maxSamples, int64_t *sampleInfo,
+            size_t *numSamples);
+
+    // With prefetching on, a background thread reads ahead the samples that
+    // readSampleDataBatch() then copies out. The other sample getters report the sample
+    // after the prefetched ones, and seeking or changing the selected tracks drops them.
+    void setPrefetch(bool enable);
+
     bool getCachedDuration(int64_t *durationUs, bool *eos) const;
 
 protected:
     virtual ~JMediaExtractor();
 
 private:
+    struct Sample {
+        sp<ABuffer> mData;
+        int64_t mTimeUs;
+        uint32_t mFlags;
+        size_t mTrackIndex;
+    };
+
+    // the most samples the prefetch thread reads ahead
+    enum { kMaxPrefetchedSamples = 64 };
+
     jclass mClass;
     jweak mObject;
     sp<NuMediaExtractor> mImpl;
 
+    Mutex mPrefetchLock;
+    Condition mPrefetchCondition;
+    List<Sample> mPrefetched;
+    status_t mPrefetchStatus;
+    bool mPrefetchEnabled;
+    bool mPrefetching;
+    bool mPrefetchRunning;
+
+    status_t getSampleInfo(Sample *sample);
+    status_t readSample(Sample *sample);
+    void startPrefetch();
+    void stopPrefetch(bool clear);
+    static void prefetchThread(void *arg);
+    void prefetchLoop();
+
     DISALLOW_EVIL_CONSTRUCTORS(JMediaExtractor);
 };
 
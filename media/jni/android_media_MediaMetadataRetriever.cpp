@@ -19,6 +19,9 @@
 #define LOG_TAG "MediaMetadataRetrieverJNI"
 
 #include <assert.h>
+#include <algorithm>
+#include <numeric>
+#include <vector>
 #include <utils/Log.h>
 #include <utils/threads.h>
 #include <SkBitmap.h>
@@ -260,6 +263,34 @@ static void rotate(T *dst, const T *src, size_t width, size_t height, int angle)
     }
 }
 
+// Returns the size of the rotated frame, and the size of the bitmap for it in dst_width and
+// dst_height: the display size, or the display size scaled to fit them if both are positive.
+static void getVideoFrameBitmapSize(const VideoFrame *videoFrame, uint32_t *width,
+        uint32_t *height, jint *dst_width, jint *dst_height) {
+    uint32_t displayWidth, displayHeight;
+    if (videoFrame->mRotationAngle == 90 || videoFrame->mRotationAngle == 270) {
+        *width = videoFrame->mHeight;
+        *height = videoFrame->mWidth;
+        displayWidth = videoFrame->mDisplayHeight;
+        displayHeight = videoFrame->mDisplayWidth;
+    } else {
+        *width = videoFrame->mWidth;
+        *height = videoFrame->mHeight;
+        displayWidth = videoFrame->mDisplayWidth;
+        displayHeight = videoFrame->mDisplayHeight;
+    }
+
+    if (*dst_width <= 0 || *dst_height <= 0) {
+        *dst_width = displayWidth;
+        *dst_height = displayHeight;
+    } else {
+        float factor = std::min((float)*dst_width / (float)displayWidth,
+                (float)*dst_height / (float)displayHeight);
+        *dst_width = std::round(displayWidth * factor);
+        *dst_height = std::round(displayHeight * factor);
+    }
+}
+
 static jobject getBitmapFromVideoFrame(
         JNIEnv *env, VideoFrame *videoFrame, jint dst_width, jint dst_height,
         SkColorType outColorType) {
@@ -276,20 +307,8 @@ static jobject getBitmapFromVideoFrame(
                     fields.createConfigMethod,
                     GraphicsJNI::colorTypeToLegacyBitmapConfig(outColorType)));
 
-    uint32_t width, height, displayWidth, displayHeight;
-    bool swapWidthAndHeight = false;
-    if (videoFrame->mRotationAngle == 90 || videoFrame->mRotationAngle == 270) {
-        width = videoFrame->mHeight;
-        height = videoFrame->mWidth;
-        swapWidthAndHeight = true;
-        displayWidth = videoFrame->mDisplayHeight;
-        displayHeight = videoFrame->mDisplayWidth;
-    } else {
-        width = videoFrame->mWidth;
-        height = videoFrame->mHeight;
-        displayWidth = videoFrame->mDisplayWidth;
-        displayHeight = videoFrame->mDisplayHeight;
-    }
+    uint32_t width, height;
+    getVideoFrameBitmapSize(videoFrame, &width, &height, &dst_width, &dst_height);
 
     jobject jBitmap = env->CallStaticObjectMethod(
                             fields.bitmapClazz,
@@ -322,16 +341,6 @@ static jobject getBitmapFromVideoFrame(
                videoFrame->mRotationAngle);
     }
 
-    if (dst_width <= 0 || dst_height <= 0) {
-        dst_width = displayWidth;
-        dst_height = displayHeight;
-    } else {
-        float factor = std::min((float)dst_width / (float)displayWidth,
-                (float)dst_height / (float)displayHeight);
-        dst_width = std::round(displayWidth * factor);
-        dst_height = std::round(displayHeight * factor);
-    }
-
     if ((uint32_t)dst_width != width || (uint32_t)dst_height != height) {
         ALOGV("Bitmap dimension is scaled from %dx%d to %dx%d",
                 width, height, dst_width, dst_height);
@@ -349,6 +358,51 @@ static jobject getBitmapFromVideoFrame(
     return jBitmap;
 }
 
+// Rotates and scales an RGB_565 frame into pooledBitmap instead of a new bitmap. Only a mutable
+// RGB_565 bitmap of the size getBitmapFromVideoFrame() would return can be reused. A frame that
+// needs scaling is rotated into scratch first, which is kept for the next frames.
+static bool copyVideoFrameToBitmap(
+        JNIEnv *env, VideoFrame *videoFrame, jobject pooledBitmap, jint dst_width,
+        jint dst_height, SkBitmap *scratch) {
+    uint32_t width, height;
+    getVideoFrameBitmapSize(videoFrame, &width, &height, &dst_width, &dst_height);
+
+    SkBitmap bitmap;
+    GraphicsJNI::getSkBitmap(env, pooledBitmap, &bitmap);
+    if (bitmap.isImmutable() || bitmap.colorType() != kRGB_565_SkColorType
+            || bitmap.width() != dst_width || bitmap.height() != dst_height
+            || bitmap.rowBytes() != (size_t)dst_width * sizeof(uint16_t)) {
+        return false;
+    }
+
+    const uint16_t *src = (uint16_t*)((char*)videoFrame + sizeof(VideoFrame));
+    if ((uint32_t)dst_width == width && (uint32_t)dst_height == height) {
+        rotate((uint16_t*)bitmap.getPixels(), src,
+               videoFrame->mWidth,
+               videoFrame->mHeight,
+               videoFrame->mRotationAngle);
+    } else {
+        if (scratch->width() != (int)width || scratch->height() != (int)height) {
+            if (!scratch->tryAllocPixels(SkImageInfo::Make(
+                    width, height, kRGB_565_SkColorType, kOpaque_SkAlphaType))) {
+                return false;
+            }
+        }
+        rotate((uint16_t*)scratch->getPixels(), src,
+               videoFrame->mWidth,
+               videoFrame->mHeight,
+               videoFrame->mRotationAngle);
+
+        // filtered like createScaledBitmap()
+        SkPixmap dst;
+        if (!bitmap.peekPixels(&dst) || !scratch->pixmap().scalePixels(dst, kLow_SkFilterQuality)) {
+            return false;
+        }
+    }
+    bitmap.notifyPixelsChanged();
+    return true;
+}
+
 static int getColorFormat(JNIEnv *env, jobject options) {
     if (options == NULL) {
         return HAL_PIXEL_FORMAT_RGBA_8888;
@@ -406,6 +460,64 @@ static jobject android_media_MediaMetadataRetriever_getFrameAtTime(
     return getBitmapFromVideoFrame(env, videoFrame, dst_width, dst_height, kRGB_565_SkColorType);
 }
 
+static jobjectArray android_media_MediaMetadataRetriever_getFramesAtTimes(
+        JNIEnv *env, jobject thiz, jlongArray timesUsArray, jint option, jint dst_width,
+        jint dst_height, jobjectArray pooledBitmaps)
+{
+    sp<MediaMetadataRetriever> retriever = getRetriever(env, thiz);
+    if (retriever == 0) {
+        jniThrowException(env, "java/lang/IllegalStateException", "No retriever available");
+        return NULL;
+    }
+    if (timesUsArray == NULL) {
+        jniThrowException(env, "java/lang/IllegalArgumentException", "No frame times");
+        return NULL;
+    }
+
+    jsize count = env->GetArrayLength(timesUsArray);
+    jsize numPooled = pooledBitmaps != NULL ? env->GetArrayLength(pooledBitmaps) : 0;
+    ALOGV("getFramesAtTimes: %d frames option: %d dst width: %d heigh: %d, %d pooled bitmaps",
+            count, option, dst_width, dst_height, numPooled);
+
+    jobjectArray bitmaps = env->NewObjectArray(count, fields.bitmapClazz, NULL);
+    if (bitmaps == NULL) {
+        return NULL;
+    }
+
+    std::vector<jlong> timesUs(count);
+    env->GetLongArrayRegion(timesUsArray, 0, count, timesUs.data());
+
+    // retrieve the frames by increasing time, so the retriever only ever seeks forward
+    std::vector<jsize> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&timesUs](jsize a, jsize b) {
+        return timesUs[a] < timesUs[b];
+    });
+
+    SkBitmap scratch;
+    for (jsize i : order) {
+        VideoFrame *videoFrame = NULL;
+        sp<IMemory> frameMemory = retriever->getFrameAtTime(timesUs[i], option);
+        if (frameMemory != 0) {
+            videoFrame = static_cast<VideoFrame *>(frameMemory->pointer());
+        }
+        if (videoFrame == NULL) {
+            ALOGE("getFramesAtTimes: no video frame at %lld us", (long long)timesUs[i]);
+            continue;
+        }
+
+        ScopedLocalRef<jobject> bitmap(env,
+                i < numPooled ? env->GetObjectArrayElement(pooledBitmaps, i) : NULL);
+        if (bitmap.get() == NULL || !copyVideoFrameToBitmap(
+                env, videoFrame, bitmap.get(), dst_width, dst_height, &scratch)) {
+            bitmap.reset(getBitmapFromVideoFrame(
+                    env, videoFrame, dst_width, dst_height, kRGB_565_SkColorType));
+        }
+        env->SetObjectArrayElement(bitmaps, i, bitmap.get());
+    }
+    return bitmaps;
+}
+
 static jobject android_media_MediaMetadataRetriever_getImageAtIndex(
         JNIEnv *env, jobject thiz, jint index, jobject params)
 {
@@ -713,6 +825,12 @@ static const JNINativeMethod nativeMethods[] = {
                 (void *)android_media_MediaMetadataRetriever_setDataSourceCallback},
         {"_getFrameAtTime", "(JIII)Landroid/graphics/Bitmap;",
                 (void *)android_media_MediaMetadataRetriever_getFrameAtTime},
+        {
+            "_getFramesAtTimes",
+            "([JIII[Landroid/graphics/Bitmap;)[Landroid/graphics/Bitmap;",
+            (void *)android_media_MediaMetadataRetriever_getFramesAtTimes
+        },
+
         {
             "_getImageAtIndex",
             "(ILandroid/media/MediaMetadataRetriever$BitmapParams;)Landroid/graphics/Bitmap;",
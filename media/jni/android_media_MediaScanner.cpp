@@ -17,6 +17,20 @@
 
 //#define LOG_NDEBUG 0
 #define LOG_TAG "MediaScannerJNI"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include <utils/Log.h>
 #include <utils/threads.h>
 #include <media/mediascanner.h>
@@ -43,6 +57,13 @@ static const char* const kRunTimeException =
 static const char* const kIllegalArgumentException =
         "java/lang/IllegalArgumentException";
 
+// changed entries are handed to the client in batches of this size
+static const size_t kScanBatchSize = 256;
+static const int kMaxScanThreads = 8;
+static const uint32_t kJournalMagic = 0x324a534d; // "MSJ2"
+// set in JournalEntry::flags of an entry that was reported as no media
+static const uint64_t kJournalNoMedia = 1;
+
 struct fields_t {
     jfieldID    context;
 };
@@ -105,6 +126,272 @@ static bool isValidUtf8(const char* bytes) {
     return true;
 }
 
+// A file or directory found by an incremental scan.
+struct ScanEntry {
+    std::string path;
+    uint64_t inode;
+    int64_t mtimeNs;
+    int64_t size;
+    bool isDirectory;
+    bool noMedia;
+};
+
+// What the journal remembers of an entry the client was told about, an entry
+// with the same inode, mtime, size and no media state is not scanned again.
+// The no media state is part of it because adding or removing a .nomedia file
+// changes it for a whole tree without touching the entries in it.
+struct JournalEntry {
+    uint64_t inode;
+    int64_t mtimeNs;
+    int64_t size;
+    uint64_t flags;
+};
+
+typedef std::unordered_map<std::string, JournalEntry> Journal;
+
+static bool readJournal(const char* journalPath, Journal* journal)
+{
+    FILE* f = fopen(journalPath, "re");
+    if (f == NULL) {
+        return false;
+    }
+    bool ok = false;
+    uint32_t magic;
+    if (fread(&magic, sizeof(magic), 1, f) == 1 && magic == kJournalMagic) {
+        for (;;) {
+            JournalEntry entry;
+            uint32_t length;
+            if (fread(&entry, sizeof(entry), 1, f) != 1) {
+                ok = feof(f);
+                break;
+            }
+            if (fread(&length, sizeof(length), 1, f) != 1 || length > PATH_MAX) {
+                break;
+            }
+            std::string path(length, '\0');
+            if (length > 0 && fread(&path[0], length, 1, f) != 1) {
+                break;
+            }
+            (*journal)[path] = entry;
+        }
+    }
+    fclose(f);
+    if (!ok) {
+        ALOGW("Ignoring corrupt scan journal '%s'", journalPath);
+        journal->clear();
+    }
+    return ok;
+}
+
+// Written to a temporary file renamed over the journal, so an interrupted
+// write leaves the previous journal in place.
+static bool writeJournal(const char* journalPath, const std::vector<ScanEntry>& entries)
+{
+    std::string tmpPath = std::string(journalPath) + ".tmp";
+    FILE* f = fopen(tmpPath.c_str(), "we");
+    if (f == NULL) {
+        ALOGE("Can't create scan journal '%s': %s", tmpPath.c_str(), strerror(errno));
+        return false;
+    }
+    bool ok = fwrite(&kJournalMagic, sizeof(kJournalMagic), 1, f) == 1;
+    for (size_t i = 0; ok && i < entries.size(); ++i) {
+        const ScanEntry& e = entries[i];
+        JournalEntry entry = { e.inode, e.mtimeNs, e.size, e.noMedia ? kJournalNoMedia : 0 };
+        uint32_t length = e.path.size();
+        ok = fwrite(&entry, sizeof(entry), 1, f) == 1
+                && fwrite(&length, sizeof(length), 1, f) == 1
+                && fwrite(e.path.data(), 1, length, f) == length;
+    }
+    ok = fflush(f) == 0 && fsync(fileno(f)) == 0 && ok;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmpPath.c_str(), journalPath) != 0) {
+        ALOGE("Can't write scan journal '%s': %s", journalPath, strerror(errno));
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Walks a directory tree with a pool of threads sharing a queue of directories
+ * to read, and splits what it finds into the entries that changed since the
+ * journal was written and the ones that did not. The workers only make system
+ * calls, the client is called back on the scanning thread.
+ */
+class ParallelDirectoryWalker
+{
+public:
+    explicit ParallelDirectoryWalker(const Journal& journal)
+        :   mJournal(journal),
+            mBusy(0)
+    {
+    }
+
+    void walk(const char* root, int numThreads,
+            std::vector<ScanEntry>* changed, std::vector<ScanEntry>* unchanged)
+    {
+        std::string rootPath(root);
+        while (rootPath.size() > 1 && rootPath.back() == '/') {
+            rootPath.pop_back();
+        }
+        mPending.push_back(PendingDirectory{ rootPath, false });
+
+        std::vector<sp<Worker> > workers;
+        for (int i = 0; i < numThreads; ++i) {
+            sp<Worker> worker = new Worker(this);
+            if (worker->run("MediaScannerWalker", ANDROID_PRIORITY_BACKGROUND) != OK) {
+                break;
+            }
+            workers.push_back(worker);
+        }
+        if (workers.empty()) {
+            // no thread could be started, walk on this one
+            sp<Worker> worker = new Worker(this);
+            worker->walk();
+            worker->take(changed, unchanged);
+        }
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i]->join();
+            workers[i]->take(changed, unchanged);
+        }
+
+        // sorted, so a directory is reported before what it contains
+        auto byPath = [](const ScanEntry& a, const ScanEntry& b) { return a.path < b.path; };
+        std::sort(changed->begin(), changed->end(), byPath);
+    }
+
+private:
+    struct PendingDirectory {
+        std::string path;
+        bool noMedia;
+    };
+
+    class Worker : public Thread
+    {
+    public:
+        explicit Worker(ParallelDirectoryWalker* walker)
+            :   Thread(false /*canCallJava*/),
+                mWalker(walker)
+        {
+        }
+
+        void walk()
+        {
+            PendingDirectory dir;
+            std::vector<PendingDirectory> subdirs;
+            bool reading = false;
+            while (mWalker->next(reading, &dir, &subdirs)) {
+                reading = true;
+                subdirs.clear();
+                mWalker->readDirectory(dir, &subdirs, &mChanged, &mUnchanged);
+            }
+        }
+
+        void take(std::vector<ScanEntry>* changed, std::vector<ScanEntry>* unchanged)
+        {
+            changed->insert(changed->end(), mChanged.begin(), mChanged.end());
+            unchanged->insert(unchanged->end(), mUnchanged.begin(), mUnchanged.end());
+            mChanged.clear();
+            mUnchanged.clear();
+        }
+
+    private:
+        virtual bool threadLoop()
+        {
+            walk();
+            return false;
+        }
+
+        ParallelDirectoryWalker* mWalker;
+        std::vector<ScanEntry> mChanged;
+        std::vector<ScanEntry> mUnchanged;
+    };
+
+    // Queues the subdirectories found in the directory that was read, if any,
+    // and waits for the next one, returns false once every directory was read.
+    bool next(bool finishedOne, PendingDirectory* dir, std::vector<PendingDirectory>* subdirs)
+    {
+        Mutex::Autolock _l(mLock);
+        if (finishedOne) {
+            mBusy--;
+            mPending.insert(mPending.end(), subdirs->begin(), subdirs->end());
+            if (!subdirs->empty() || mBusy == 0) {
+                mCondition.broadcast();
+            }
+        }
+        while (mPending.empty() && mBusy > 0) {
+            mCondition.wait(mLock);
+        }
+        if (mPending.empty()) {
+            return false;
+        }
+        *dir = mPending.back();
+        mPending.pop_back();
+        mBusy++;
+        return true;
+    }
+
+    void readDirectory(const PendingDirectory& dir, std::vector<PendingDirectory>* subdirs,
+            std::vector<ScanEntry>* changed, std::vector<ScanEntry>* unchanged)
+    {
+        DIR* d = opendir(dir.path.c_str());
+        if (d == NULL) {
+            ALOGW("Error opening directory '%s', skipping: %s.", dir.path.c_str(),
+                    strerror(errno));
+            return;
+        }
+        int fd = dirfd(d);
+        bool noMedia = dir.noMedia || faccessat(fd, ".nomedia", F_OK, 0) == 0;
+
+        struct dirent* entry;
+        while ((entry = readdir(d)) != NULL) {
+            const char* name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+            struct stat st;
+            if (fstatat(fd, name, &st, 0) != 0) {
+                continue;
+            }
+            bool isDirectory = S_ISDIR(st.st_mode);
+            if (!isDirectory && !S_ISREG(st.st_mode)) {
+                continue;
+            }
+            ScanEntry e;
+            e.path = dir.path + "/" + name;
+            e.inode = st.st_ino;
+            e.mtimeNs = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+            e.size = isDirectory ? 0 : st.st_size;
+            e.isDirectory = isDirectory;
+            // hidden entries are scanned as no media, like by processDirectory
+            e.noMedia = noMedia || name[0] == '.';
+
+            // symbolic links to directories are not followed, they may loop
+            if (isDirectory && entry->d_type != DT_LNK) {
+                subdirs->push_back(PendingDirectory{ e.path, e.noMedia });
+            }
+
+            Journal::const_iterator it = mJournal.find(e.path);
+            if (it != mJournal.end() && it->second.inode == e.inode
+                    && it->second.mtimeNs == e.mtimeNs && it->second.size == e.size
+                    && ((it->second.flags & kJournalNoMedia) != 0) == e.noMedia) {
+                unchanged->push_back(std::move(e));
+            } else {
+                changed->push_back(std::move(e));
+            }
+        }
+        closedir(d);
+    }
+
+    // read only while walking
+    const Journal& mJournal;
+    Mutex mLock;
+    Condition mCondition;
+    std::vector<PendingDirectory> mPending;
+    // the number of directories being read
+    int mBusy;
+};
+
 class MyMediaScannerClient : public MediaScannerClient
 {
 public:
@@ -113,7 +400,8 @@ public:
             mClient(env->NewGlobalRef(client)),
             mScanFileMethodID(0),
             mHandleStringTagMethodID(0),
-            mSetMimeTypeMethodID(0)
+            mSetMimeTypeMethodID(0),
+            mScanFilesMethodID(0)
     {
         ALOGV("MyMediaScannerClient constructor");
         jclass mediaScannerClientInterface =
@@ -136,6 +424,15 @@ public:
                                     mediaScannerClientInterface,
                                     "setMimeType",
                                     "(Ljava/lang/String;)V");
+
+            // optional, the entries are passed to scanFile one by one without it
+            mScanFilesMethodID = env->GetMethodID(
+                                    mediaScannerClientInterface,
+                                    "scanFiles",
+                                    "([Ljava/lang/String;[J[J[Z[Z)V");
+            if (mScanFilesMethodID == NULL) {
+                env->ExceptionClear();
+            }
         }
     }
 
@@ -216,12 +513,91 @@ public:
         return checkAndClearExceptionFromCallback(mEnv, "setMimeType");
     }
 
+    // Reports the entries of an incremental scan, in batches when the client
+    // implements scanFiles.
+    status_t scanEntries(const std::vector<ScanEntry>& entries)
+    {
+        for (size_t begin = 0; begin < entries.size(); begin += kScanBatchSize) {
+            size_t end = std::min(begin + kScanBatchSize, entries.size());
+            status_t status;
+            if (mScanFilesMethodID != NULL) {
+                status = scanBatch(entries, begin, end);
+            } else {
+                status = OK;
+                for (size_t i = begin; i < end && status == OK; ++i) {
+                    const ScanEntry& e = entries[i];
+                    status = scanFile(e.path.c_str(), e.mtimeNs / 1000000000LL, e.size,
+                            e.isDirectory, e.noMedia);
+                }
+            }
+            if (status != OK) {
+                return status;
+            }
+        }
+        return OK;
+    }
+
 private:
+    status_t scanBatch(const std::vector<ScanEntry>& entries, size_t begin, size_t end)
+    {
+        const jsize count = end - begin;
+        jlong lastModified[kScanBatchSize];
+        jlong fileSize[kScanBatchSize];
+        jboolean isDirectory[kScanBatchSize];
+        jboolean noMedia[kScanBatchSize];
+
+        jclass stringClass = mEnv->FindClass("java/lang/String");
+        jobjectArray paths = mEnv->NewObjectArray(count, stringClass, NULL);
+        jlongArray lastModifiedArray = mEnv->NewLongArray(count);
+        jlongArray fileSizeArray = mEnv->NewLongArray(count);
+        jbooleanArray isDirectoryArray = mEnv->NewBooleanArray(count);
+        jbooleanArray noMediaArray = mEnv->NewBooleanArray(count);
+        status_t status = OK;
+        if (paths == NULL || lastModifiedArray == NULL || fileSizeArray == NULL
+                || isDirectoryArray == NULL || noMediaArray == NULL) {
+            status = NO_MEMORY;
+        }
+        for (jsize i = 0; i < count && status == OK; ++i) {
+            const ScanEntry& e = entries[begin + i];
+            jstring pathStr = mEnv->NewStringUTF(e.path.c_str());
+            if (pathStr == NULL) {
+                status = NO_MEMORY;
+                break;
+            }
+            mEnv->SetObjectArrayElement(paths, i, pathStr);
+            mEnv->DeleteLocalRef(pathStr);
+            lastModified[i] = e.mtimeNs / 1000000000LL;
+            fileSize[i] = e.size;
+            isDirectory[i] = e.isDirectory;
+            noMedia[i] = e.noMedia;
+        }
+        if (status == OK) {
+            mEnv->SetLongArrayRegion(lastModifiedArray, 0, count, lastModified);
+            mEnv->SetLongArrayRegion(fileSizeArray, 0, count, fileSize);
+            mEnv->SetBooleanArrayRegion(isDirectoryArray, 0, count, isDirectory);
+            mEnv->SetBooleanArrayRegion(noMediaArray, 0, count, noMedia);
+            mEnv->CallVoidMethod(mClient, mScanFilesMethodID, paths, lastModifiedArray,
+                    fileSizeArray, isDirectoryArray, noMediaArray);
+            status = checkAndClearExceptionFromCallback(mEnv, "scanFiles");
+        } else {
+            mEnv->ExceptionClear();
+        }
+
+        mEnv->DeleteLocalRef(stringClass);
+        mEnv->DeleteLocalRef(paths);
+        mEnv->DeleteLocalRef(lastModifiedArray);
+        mEnv->DeleteLocalRef(fileSizeArray);
+        mEnv->DeleteLocalRef(isDirectoryArray);
+        mEnv->DeleteLocalRef(noMediaArray);
+        return status;
+    }
+
     JNIEnv *mEnv;
     jobject mClient;
     jmethodID mScanFileMethodID;
     jmethodID mHandleStringTagMethodID;
     jmethodID mSetMimeTypeMethodID;
+    jmethodID mScanFilesMethodID;
 };
 
 
@@ -264,6 +640,63 @@ android_media_MediaScanner_processDirectory(
     env->ReleaseStringUTFChars(path, pathStr);
 }
 
+// Only reports the entries that changed since the last scan with the same
+// journal, the directory tree is walked by numThreads threads. The journal is
+// rewritten once the client took every changed entry. Returns the number of
+// changed entries, or -1 on error.
+static jint
+android_media_MediaScanner_processDirectoryIncremental(
+        JNIEnv *env, jobject thiz, jstring path, jstring journalPath,
+        jint numThreads, jobject client)
+{
+    ALOGV("processDirectoryIncremental");
+    MediaScanner *mp = getNativeScanner_l(env, thiz);
+    if (mp == NULL) {
+        jniThrowException(env, kRunTimeException, "No scanner available");
+        return -1;
+    }
+
+    if (path == NULL || journalPath == NULL) {
+        jniThrowException(env, kIllegalArgumentException, NULL);
+        return -1;
+    }
+
+    const char *pathStr = env->GetStringUTFChars(path, NULL);
+    if (pathStr == NULL) {  // Out of memory
+        return -1;
+    }
+    const char *journalPathStr = env->GetStringUTFChars(journalPath, NULL);
+    if (journalPathStr == NULL) {  // Out of memory
+        env->ReleaseStringUTFChars(path, pathStr);
+        return -1;
+    }
+
+    Journal journal;
+    readJournal(journalPathStr, &journal);
+
+    std::vector<ScanEntry> changed;
+    std::vector<ScanEntry> unchanged;
+    ParallelDirectoryWalker walker(journal);
+    walker.walk(pathStr, std::max(1, std::min(int(numThreads), kMaxScanThreads)),
+            &changed, &unchanged);
+    ALOGV("'%s': %zu changed, %zu unchanged entries", pathStr, changed.size(),
+            unchanged.size());
+
+    jint result = changed.size();
+    MyMediaScannerClient myClient(env, client);
+    if (myClient.scanEntries(changed) != OK) {
+        // keep the previous journal so the next scan reports these again
+        ALOGE("An error occurred while scanning directory '%s'.", pathStr);
+        result = -1;
+    } else {
+        changed.insert(changed.end(), unchanged.begin(), unchanged.end());
+        writeJournal(journalPathStr, changed);
+    }
+    env->ReleaseStringUTFChars(journalPath, journalPathStr);
+    env->ReleaseStringUTFChars(path, pathStr);
+    return result;
+}
+
 static jboolean
 android_media_MediaScanner_processFile(
         JNIEnv *env, jobject thiz, jstring path,
@@ -420,6 +853,12 @@ static const JNINativeMethod gMethods[] = {
         (void *)android_media_MediaScanner_processDirectory
     },
 
+    {
+        "processDirectoryIncremental",
+        "(Ljava/lang/String;Ljava/lang/String;ILandroid/media/MediaScannerClient;)I",
+        (void *)android_media_MediaScanner_processDirectoryIncremental
+    },
+
     {
         "processFile",
         "(Ljava/lang/String;Ljava/lang/String;Landroid/media/MediaScannerClient;)Z",
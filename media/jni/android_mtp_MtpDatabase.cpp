@@ -17,6 +17,7 @@
 #define LOG_TAG "MtpDatabaseJNI"
 #include "utils/Log.h"
 #include "utils/String8.h"
+#include "utils/threads.h"
 
 #include "android_media_Utils.h"
 #include "mtp.h"
@@ -51,6 +52,13 @@ extern "C" {
 #include <stdio.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
 using namespace android;
 
 // ----------------------------------------------------------------------------
@@ -78,6 +86,8 @@ static jmethodID method_beginCopyObject;
 static jmethodID method_endCopyObject;
 static jmethodID method_getObjectReferences;
 static jmethodID method_setObjectReferences;
+// optional, object infos are fetched one by one without it
+static jmethodID method_getObjectInfos;
 
 static jfieldID field_context;
 
@@ -90,6 +100,12 @@ static jmethodID method_getDataTypes;
 static jmethodID method_getLongValues;
 static jmethodID method_getStringValues;
 
+// the most objects whose infos are fetched from Java in one call
+static const size_t kObjectInfoBatchSize = 256;
+// the cache is dropped when it grows past this many objects
+static const size_t kMaxCachedObjects = 16384;
+// the property code a host asks for to get every property of an object
+static const uint32_t kAllProperties = 0xFFFFFFFF;
 
 IMtpDatabase* getMtpDatabase(JNIEnv *env, jobject database) {
     return (IMtpDatabase *)env->GetLongField(database, field_context);
@@ -97,18 +113,92 @@ IMtpDatabase* getMtpDatabase(JNIEnv *env, jobject database) {
 
 // ----------------------------------------------------------------------------
 
+// A property value of an object, as found in an MtpPropertyList.
+struct PropertyValue {
+    MtpObjectProperty   property;
+    int                 type;
+    int64_t             longValue;
+    bool                hasString;
+    std::string         stringValue;
+};
+
 class MtpDatabase : public IMtpDatabase {
 private:
+    // What getObjectFilePath and getObjectInfo return for an object.
+    struct CachedObjectInfo {
+        MtpResponseCode     result;
+        MtpStorageID        storageID;
+        MtpObjectFormat     format;
+        MtpObjectHandle     parent;
+        time_t              dateCreated;
+        time_t              dateModified;
+        int64_t             length;
+        std::string         name;
+        std::string         path;
+        // read from the file the first time the info is asked for
+        bool                hasImageInfo;
+        uint32_t            thumbCompressedSize;
+        MtpObjectFormat     thumbFormat;
+        uint32_t            imagePixWidth;
+        uint32_t            imagePixHeight;
+    };
+
+    // format, property and group code of a GetObjectPropList request
+    typedef std::tuple<uint32_t, uint32_t, int> PropertyQuery;
+
+    struct CachedObject {
+        CachedObject() : hasInfo(false) {}
+        bool                hasInfo;
+        CachedObjectInfo    info;
+        std::map<PropertyQuery, std::vector<PropertyValue> > properties;
+    };
+
     jobject         mDatabase;
     jintArray       mIntBuffer;
     jlongArray      mLongBuffer;
     jcharArray      mStringBuffer;
 
+    // The responses for objects, kept while the Java database has the cache
+    // enabled, usually for the duration of a session, so browsing a folder
+    // doesn't call into Java for each object and property. Accessed on the
+    // server thread and invalidated from Java when objects change.
+    Mutex           mCacheLock;
+    bool            mCacheEnabled;
+    // bumped on invalidation, so a response fetched meanwhile isn't cached
+    uint32_t        mCacheGeneration;
+    std::unordered_map<MtpObjectHandle, CachedObject> mCachedObjects;
+    // The handles of the last listed folder, fetched together on a cache miss
+    // as a host usually asks for each object of the folder after listing it.
+    MtpObjectHandle mListedParent;
+    std::vector<MtpObjectHandle> mListedHandles;
+
+    MtpResponseCode                 fetchObjectFilePath(MtpObjectHandle handle,
+                                            MtpStringBuffer& outFilePath,
+                                            int64_t& outFileLength,
+                                            MtpObjectFormat& outFormat);
+    MtpResponseCode                 fetchObjectInfo(MtpObjectHandle handle,
+                                            CachedObjectInfo& info);
+    void                            fetchObjectInfos(const std::vector<MtpObjectHandle>& handles,
+                                            std::vector<CachedObjectInfo>& infos);
+    MtpResponseCode                 getCachedObjectInfo(MtpObjectHandle handle,
+                                            CachedObjectInfo& info);
+    bool                            getCachedProperties(MtpObjectHandle handle,
+                                            const PropertyQuery& query,
+                                            std::vector<PropertyValue>& values);
+    MtpResponseCode                 fetchProperties(MtpObjectHandle handle,
+                                            const PropertyQuery& query,
+                                            std::vector<PropertyValue>& values);
+    CachedObject&                   cachedObject_l(MtpObjectHandle handle);
+
 public:
                                     MtpDatabase(JNIEnv *env, jobject client);
     virtual                         ~MtpDatabase();
     void                            cleanup(JNIEnv *env);
 
+    void                            setObjectCacheEnabled(bool enabled);
+    // drops the cached responses for the object, or for all of them for handle 0
+    void                            invalidateObjectCache(MtpObjectHandle handle);
+
     virtual MtpObjectHandle         beginSendObject(const char* path,
                                             MtpObjectFormat format,
                                             MtpObjectHandle parent,
@@ -210,7 +300,10 @@ MtpDatabase::MtpDatabase(JNIEnv *env, jobject client)
     :   mDatabase(env->NewGlobalRef(client)),
         mIntBuffer(NULL),
         mLongBuffer(NULL),
-        mStringBuffer(NULL)
+        mStringBuffer(NULL),
+        mCacheEnabled(false),
+        mCacheGeneration(0),
+        mListedParent(0)
 {
     // create buffers for out arguments
     // we don't need to be thread-safe so this is OK
@@ -242,6 +335,33 @@ void MtpDatabase::cleanup(JNIEnv *env) {
 MtpDatabase::~MtpDatabase() {
 }
 
+void MtpDatabase::setObjectCacheEnabled(bool enabled) {
+    Mutex::Autolock autoLock(mCacheLock);
+    mCacheEnabled = enabled;
+    mCacheGeneration++;
+    mCachedObjects.clear();
+    mListedHandles.clear();
+}
+
+void MtpDatabase::invalidateObjectCache(MtpObjectHandle handle) {
+    Mutex::Autolock autoLock(mCacheLock);
+    mCacheGeneration++;
+    if (handle == 0) {
+        mCachedObjects.clear();
+        mListedHandles.clear();
+    } else {
+        mCachedObjects.erase(handle);
+    }
+}
+
+MtpDatabase::CachedObject& MtpDatabase::cachedObject_l(MtpObjectHandle handle) {
+    if (mCachedObjects.size() >= kMaxCachedObjects
+            && mCachedObjects.find(handle) == mCachedObjects.end()) {
+        mCachedObjects.clear();
+    }
+    return mCachedObjects[handle];
+}
+
 MtpObjectHandle MtpDatabase::beginSendObject(const char* path,
                                                MtpObjectFormat format,
                                                MtpObjectHandle parent,
@@ -260,6 +380,7 @@ MtpObjectHandle MtpDatabase::beginSendObject(const char* path,
 void MtpDatabase::endSendObject(MtpObjectHandle handle, bool succeeded) {
     JNIEnv* env = AndroidRuntime::getJNIEnv();
     env->CallVoidMethod(mDatabase, method_endSendObject, (jint)handle, (jboolean)succeeded);
+    invalidateObjectCache(0);
 
     checkAndClearExceptionFromCallback(env, __FUNCTION__);
 }
@@ -270,6 +391,7 @@ void MtpDatabase::rescanFile(const char* path, MtpObjectHandle handle,
     jstring pathStr = env->NewStringUTF(path);
     env->CallVoidMethod(mDatabase, method_rescanFile, pathStr,
                         (jint)handle, (jint)format);
+    invalidateObjectCache(handle);
 
     if (pathStr)
         env->DeleteLocalRef(pathStr);
@@ -292,6 +414,15 @@ MtpObjectHandleList* MtpDatabase::getObjectList(MtpStorageID storageID,
     env->ReleaseIntArrayElements(array, handles, 0);
     env->DeleteLocalRef(array);
 
+    // only a complete listing of a folder is used to prefetch its objects
+    if (format == 0 && parent != 0 && parent != MTP_PARENT_ROOT) {
+        Mutex::Autolock autoLock(mCacheLock);
+        if (mCacheEnabled) {
+            mListedParent = parent;
+            mListedHandles.assign(list->begin(), list->end());
+        }
+    }
+
     checkAndClearExceptionFromCallback(env, __FUNCTION__);
     return list;
 }
@@ -379,9 +510,208 @@ MtpDevicePropertyList* MtpDatabase::getSupportedDeviceProperties() {
     return list;
 }
 
+static bool putLongValue(int type, jlong longValue, MtpDataPacket& packet) {
+    switch (type) {
+        case MTP_TYPE_INT8:
+            packet.putInt8(longValue);
+            break;
+        case MTP_TYPE_UINT8:
+            packet.putUInt8(longValue);
+            break;
+        case MTP_TYPE_INT16:
+            packet.putInt16(longValue);
+            break;
+        case MTP_TYPE_UINT16:
+            packet.putUInt16(longValue);
+            break;
+        case MTP_TYPE_INT32:
+            packet.putInt32(longValue);
+            break;
+        case MTP_TYPE_UINT32:
+            packet.putUInt32(longValue);
+            break;
+        case MTP_TYPE_INT64:
+            packet.putInt64(longValue);
+            break;
+        case MTP_TYPE_UINT64:
+            packet.putUInt64(longValue);
+            break;
+        case MTP_TYPE_INT128:
+            packet.putInt128(longValue);
+            break;
+        case MTP_TYPE_UINT128:
+            packet.putUInt128(longValue);
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+static void putPropertyValue(const PropertyValue& value, MtpDataPacket& packet) {
+    if (value.type == MTP_TYPE_STR) {
+        if (value.hasString) {
+            packet.putString(value.stringValue.c_str());
+        } else {
+            packet.putEmptyString();
+        }
+    } else if (!putLongValue(value.type, value.longValue, packet)) {
+        ALOGE("bad or unsupported data type in MtpDatabase::getObjectPropertyList");
+    }
+}
+
+// Copies the entries of an MtpPropertyList, so they can be cached.
+static MtpResponseCode readPropertyList(JNIEnv* env, jobject list,
+                                        std::vector<MtpObjectHandle>& handles,
+                                        std::vector<PropertyValue>& values) {
+    MtpResponseCode result = env->CallIntMethod(list, method_getCode);
+    jint count = env->CallIntMethod(list, method_getCount);
+    if (result != MTP_RESPONSE_OK || count <= 0) {
+        return result;
+    }
+
+    jintArray objectHandlesArray = (jintArray)env->CallObjectMethod(list, method_getObjectHandles);
+    jintArray propertyCodesArray = (jintArray)env->CallObjectMethod(list, method_getPropertyCodes);
+    jintArray dataTypesArray = (jintArray)env->CallObjectMethod(list, method_getDataTypes);
+    jlongArray longValuesArray = (jlongArray)env->CallObjectMethod(list, method_getLongValues);
+    jobjectArray stringValuesArray = (jobjectArray)env->CallObjectMethod(list, method_getStringValues);
+
+    jint* objectHandles = env->GetIntArrayElements(objectHandlesArray, 0);
+    jint* propertyCodes = env->GetIntArrayElements(propertyCodesArray, 0);
+    jint* dataTypes = env->GetIntArrayElements(dataTypesArray, 0);
+    jlong* longValues = (longValuesArray ? env->GetLongArrayElements(longValuesArray, 0) : NULL);
+
+    handles.resize(count);
+    values.resize(count);
+    for (int i = 0; i < count; i++) {
+        PropertyValue& value = values[i];
+        handles[i] = objectHandles[i];
+        value.property = propertyCodes[i];
+        value.type = dataTypes[i];
+        value.longValue = (longValues ? longValues[i] : 0);
+        value.hasString = false;
+        if (value.type == MTP_TYPE_STR) {
+            jstring string = (jstring)env->GetObjectArrayElement(stringValuesArray, i);
+            const char *str = (string ? env->GetStringUTFChars(string, NULL) : NULL);
+            if (str) {
+                value.hasString = true;
+                value.stringValue = str;
+                env->ReleaseStringUTFChars(string, str);
+            }
+            env->DeleteLocalRef(string);
+        }
+    }
+
+    env->ReleaseIntArrayElements(objectHandlesArray, objectHandles, 0);
+    env->ReleaseIntArrayElements(propertyCodesArray, propertyCodes, 0);
+    env->ReleaseIntArrayElements(dataTypesArray, dataTypes, 0);
+    if (longValues) {
+        env->ReleaseLongArrayElements(longValuesArray, longValues, 0);
+    }
+
+    env->DeleteLocalRef(objectHandlesArray);
+    env->DeleteLocalRef(propertyCodesArray);
+    env->DeleteLocalRef(dataTypesArray);
+    env->DeleteLocalRef(longValuesArray);
+    env->DeleteLocalRef(stringValuesArray);
+    return result;
+}
+
+bool MtpDatabase::getCachedProperties(MtpObjectHandle handle, const PropertyQuery& query,
+                                      std::vector<PropertyValue>& values) {
+    Mutex::Autolock autoLock(mCacheLock);
+    if (!mCacheEnabled) {
+        return false;
+    }
+    auto object = mCachedObjects.find(handle);
+    if (object == mCachedObjects.end()) {
+        return false;
+    }
+    auto properties = object->second.properties.find(query);
+    if (properties == object->second.properties.end()) {
+        return false;
+    }
+    values = properties->second;
+    return true;
+}
+
+// Fetches the properties of the object, and of the other objects of the last
+// listed folder with the same query if the object is in it.
+MtpResponseCode MtpDatabase::fetchProperties(MtpObjectHandle handle, const PropertyQuery& query,
+                                             std::vector<PropertyValue>& values) {
+    MtpObjectHandle parent = 0;
+    uint32_t generation;
+    std::vector<MtpObjectHandle> listed;
+    {
+        Mutex::Autolock autoLock(mCacheLock);
+        generation = mCacheGeneration;
+        for (MtpObjectHandle listedHandle : mListedHandles) {
+            if (listedHandle == handle) {
+                parent = mListedParent;
+                listed = mListedHandles;
+                break;
+            }
+        }
+    }
+
+    JNIEnv* env = AndroidRuntime::getJNIEnv();
+    std::vector<MtpObjectHandle> handles;
+    std::vector<PropertyValue> allValues;
+    jobject list = env->CallObjectMethod(
+            mDatabase,
+            method_getObjectPropertyList,
+            static_cast<jint>(parent != 0 ? parent : handle),
+            static_cast<jint>(std::get<0>(query)),
+            static_cast<jint>(std::get<1>(query)),
+            static_cast<jint>(std::get<2>(query)),
+            parent != 0 ? 1 : 0);
+    checkAndClearExceptionFromCallback(env, __FUNCTION__);
+    if (!list)
+        return MTP_RESPONSE_GENERAL_ERROR;
+    MtpResponseCode result = readPropertyList(env, list, handles, allValues);
+    env->DeleteLocalRef(list);
+    checkAndClearExceptionFromCallback(env, __FUNCTION__);
+    if (result != MTP_RESPONSE_OK) {
+        return result;
+    }
+
+    std::unordered_map<MtpObjectHandle, std::vector<PropertyValue> > byHandle;
+    byHandle[handle];
+    for (MtpObjectHandle listedHandle : listed) {
+        byHandle[listedHandle];
+    }
+    for (size_t i = 0; i < handles.size(); i++) {
+        auto entry = byHandle.find(handles[i]);
+        if (entry != byHandle.end()) {
+            entry->second.push_back(std::move(allValues[i]));
+        }
+    }
+    values = byHandle[handle];
+
+    Mutex::Autolock autoLock(mCacheLock);
+    if (mCacheEnabled && generation == mCacheGeneration) {
+        for (auto& entry : byHandle) {
+            cachedObject_l(entry.first).properties[query] = std::move(entry.second);
+        }
+    }
+    return result;
+}
+
 MtpResponseCode MtpDatabase::getObjectPropertyValue(MtpObjectHandle handle,
                                                       MtpObjectProperty property,
                                                       MtpDataPacket& packet) {
+    // answered from the properties a GetObjectPropList for the object returned
+    std::vector<PropertyValue> values;
+    if (getCachedProperties(handle, PropertyQuery(0, property, 0), values)
+            || getCachedProperties(handle, PropertyQuery(0, kAllProperties, 0), values)) {
+        for (const PropertyValue& value : values) {
+            if (value.property == property) {
+                putPropertyValue(value, packet);
+                return MTP_RESPONSE_OK;
+            }
+        }
+    }
+
     static_assert(sizeof(jint) >= sizeof(MtpObjectHandle),
                   "Casting MtpObjectHandle to jint loses a value");
     static_assert(sizeof(jint) >= sizeof(MtpObjectProperty),
@@ -560,6 +890,8 @@ MtpResponseCode MtpDatabase::setObjectPropertyValue(MtpObjectHandle handle,
 
     result = env->CallIntMethod(mDatabase, method_setObjectProperty,
                 (jint)handle, (jint)property, longValue, stringValue);
+    // a new name also changes the path of the objects below
+    invalidateObjectCache(0);
     if (stringValue)
         env->DeleteLocalRef(stringValue);
 
@@ -674,6 +1006,30 @@ MtpResponseCode MtpDatabase::getObjectPropertyList(MtpObjectHandle handle,
                                                      MtpDataPacket& packet) {
     static_assert(sizeof(jint) >= sizeof(MtpObjectHandle),
                   "Casting MtpObjectHandle to jint loses a value");
+    bool cacheEnabled;
+    {
+        Mutex::Autolock autoLock(mCacheLock);
+        cacheEnabled = mCacheEnabled;
+    }
+    if (cacheEnabled && depth == 0 && handle != 0 && handle != MTP_PARENT_ROOT) {
+        PropertyQuery query(format, property, groupCode);
+        std::vector<PropertyValue> values;
+        MtpResponseCode result = MTP_RESPONSE_OK;
+        if (!getCachedProperties(handle, query, values)) {
+            result = fetchProperties(handle, query, values);
+        }
+        if (result == MTP_RESPONSE_OK) {
+            packet.putUInt32(values.size());
+            for (const PropertyValue& value : values) {
+                packet.putUInt32(handle);
+                packet.putUInt16(value.property);
+                packet.putUInt16(value.type);
+                putPropertyValue(value, packet);
+            }
+            return result;
+        }
+    }
+
     JNIEnv* env = AndroidRuntime::getJNIEnv();
     jobject list = env->CallObjectMethod(
             mDatabase,
@@ -831,47 +1187,191 @@ static ExifData *getExifFromExtractor(const char *path) {
     return exifdata;
 }
 
-MtpResponseCode MtpDatabase::getObjectInfo(MtpObjectHandle handle,
-                                             MtpObjectInfo& info) {
+MtpResponseCode MtpDatabase::fetchObjectInfo(MtpObjectHandle handle,
+                                             CachedObjectInfo& info) {
     MtpStringBuffer path;
     int64_t         length;
     MtpObjectFormat format;
 
-    MtpResponseCode result = getObjectFilePath(handle, path, length, format);
-    if (result != MTP_RESPONSE_OK) {
-        return result;
+    info.hasImageInfo = false;
+    info.result = fetchObjectFilePath(handle, path, length, format);
+    if (info.result != MTP_RESPONSE_OK) {
+        return info.result;
     }
-    info.mCompressedSize = (length > 0xFFFFFFFFLL ? 0xFFFFFFFF : (uint32_t)length);
+    info.path = (const char *)path;
+    info.length = length;
+    info.format = format;
 
     JNIEnv* env = AndroidRuntime::getJNIEnv();
     if (!env->CallBooleanMethod(mDatabase, method_getObjectInfo,
                 (jint)handle, mIntBuffer, mStringBuffer, mLongBuffer)) {
-        return MTP_RESPONSE_INVALID_OBJECT_HANDLE;
+        checkAndClearExceptionFromCallback(env, __FUNCTION__);
+        info.result = MTP_RESPONSE_INVALID_OBJECT_HANDLE;
+        return info.result;
     }
 
     jint* intValues = env->GetIntArrayElements(mIntBuffer, 0);
-    info.mStorageID = intValues[0];
-    info.mFormat = intValues[1];
-    info.mParent = intValues[2];
+    info.storageID = intValues[0];
+    info.format = intValues[1];
+    info.parent = intValues[2];
     env->ReleaseIntArrayElements(mIntBuffer, intValues, 0);
 
     jlong* longValues = env->GetLongArrayElements(mLongBuffer, 0);
-    info.mDateCreated = longValues[0];
-    info.mDateModified = longValues[1];
+    info.dateCreated = longValues[0];
+    info.dateModified = longValues[1];
     env->ReleaseLongArrayElements(mLongBuffer, longValues, 0);
 
-    if ((false)) {
-        info.mAssociationType = (format == MTP_FORMAT_ASSOCIATION ?
-                                MTP_ASSOCIATION_TYPE_GENERIC_FOLDER :
-                                MTP_ASSOCIATION_TYPE_UNDEFINED);
-    }
-    info.mAssociationType = MTP_ASSOCIATION_TYPE_UNDEFINED;
-
     jchar* str = env->GetCharArrayElements(mStringBuffer, 0);
     MtpStringBuffer temp(str);
-    info.mName = strdup(temp);
+    info.name = (const char *)temp;
     env->ReleaseCharArrayElements(mStringBuffer, str, 0);
 
+    checkAndClearExceptionFromCallback(env, __FUNCTION__);
+    return info.result;
+}
+
+// Fetches the infos with a single call into Java when it implements
+// getObjectInfos, it fills 4 ints (response code, storage ID, format and
+// parent), 3 longs (date created, date modified and size) and the name and
+// path of each object.
+void MtpDatabase::fetchObjectInfos(const std::vector<MtpObjectHandle>& handles,
+                                   std::vector<CachedObjectInfo>& infos) {
+    infos.resize(handles.size());
+    JNIEnv* env = AndroidRuntime::getJNIEnv();
+    const jsize count = handles.size();
+    jintArray handlesArray = NULL;
+    jintArray intsArray = NULL;
+    jlongArray longsArray = NULL;
+    jobjectArray namesArray = NULL;
+    jobjectArray pathsArray = NULL;
+    bool fetched = false;
+
+    if (method_getObjectInfos != NULL && count > 1) {
+        ScopedLocalRef<jclass> stringClass(env, env->FindClass("java/lang/String"));
+        handlesArray = env->NewIntArray(count);
+        intsArray = env->NewIntArray(count * 4);
+        longsArray = env->NewLongArray(count * 3);
+        namesArray = env->NewObjectArray(count, stringClass.get(), NULL);
+        pathsArray = env->NewObjectArray(count, stringClass.get(), NULL);
+        if (handlesArray && intsArray && longsArray && namesArray && pathsArray) {
+            static_assert(sizeof(jint) == sizeof(MtpObjectHandle),
+                          "MtpObjectHandle and jint have different sizes");
+            env->SetIntArrayRegion(handlesArray, 0, count,
+                    reinterpret_cast<const jint*>(handles.data()));
+            env->CallVoidMethod(mDatabase, method_getObjectInfos, handlesArray, intsArray,
+                    longsArray, namesArray, pathsArray);
+            fetched = !env->ExceptionCheck();
+        }
+        checkAndClearExceptionFromCallback(env, __FUNCTION__);
+    }
+
+    if (fetched) {
+        std::vector<jint> ints(count * 4);
+        std::vector<jlong> longs(count * 3);
+        env->GetIntArrayRegion(intsArray, 0, count * 4, ints.data());
+        env->GetLongArrayRegion(longsArray, 0, count * 3, longs.data());
+        for (jsize i = 0; i < count; i++) {
+            CachedObjectInfo& info = infos[i];
+            info.hasImageInfo = false;
+            info.result = ints[i * 4];
+            if (info.result != MTP_RESPONSE_OK) {
+                continue;
+            }
+            info.storageID = ints[i * 4 + 1];
+            info.format = ints[i * 4 + 2];
+            info.parent = ints[i * 4 + 3];
+            info.dateCreated = longs[i * 3];
+            info.dateModified = longs[i * 3 + 1];
+            info.length = longs[i * 3 + 2];
+
+            ScopedLocalRef<jstring> name(env, (jstring)env->GetObjectArrayElement(namesArray, i));
+            ScopedLocalRef<jstring> path(env, (jstring)env->GetObjectArrayElement(pathsArray, i));
+            const char* nameStr = (name.get() ? env->GetStringUTFChars(name.get(), NULL) : NULL);
+            const char* pathStr = (path.get() ? env->GetStringUTFChars(path.get(), NULL) : NULL);
+            if (nameStr && pathStr) {
+                info.name = nameStr;
+                info.path = pathStr;
+            } else {
+                info.result = MTP_RESPONSE_GENERAL_ERROR;
+            }
+            if (nameStr)
+                env->ReleaseStringUTFChars(name.get(), nameStr);
+            if (pathStr)
+                env->ReleaseStringUTFChars(path.get(), pathStr);
+        }
+    }
+
+    if (handlesArray)
+        env->DeleteLocalRef(handlesArray);
+    if (intsArray)
+        env->DeleteLocalRef(intsArray);
+    if (longsArray)
+        env->DeleteLocalRef(longsArray);
+    if (namesArray)
+        env->DeleteLocalRef(namesArray);
+    if (pathsArray)
+        env->DeleteLocalRef(pathsArray);
+    checkAndClearExceptionFromCallback(env, __FUNCTION__);
+
+    if (!fetched) {
+        for (jsize i = 0; i < count; i++) {
+            fetchObjectInfo(handles[i], infos[i]);
+        }
+    }
+}
+
+// Fetches the info of the object on a cache miss, along with the infos of the
+// objects listed after it in its folder.
+MtpResponseCode MtpDatabase::getCachedObjectInfo(MtpObjectHandle handle,
+                                                 CachedObjectInfo& info) {
+    std::vector<MtpObjectHandle> handles;
+    uint32_t generation = 0;
+    {
+        Mutex::Autolock autoLock(mCacheLock);
+        if (mCacheEnabled) {
+            auto object = mCachedObjects.find(handle);
+            if (object != mCachedObjects.end() && object->second.hasInfo) {
+                info = object->second.info;
+                return info.result;
+            }
+            generation = mCacheGeneration;
+            handles.push_back(handle);
+            auto listed = std::find(mListedHandles.begin(), mListedHandles.end(), handle);
+            if (method_getObjectInfos != NULL && listed != mListedHandles.end()) {
+                for (++listed; listed != mListedHandles.end()
+                        && handles.size() < kObjectInfoBatchSize; ++listed) {
+                    auto cached = mCachedObjects.find(*listed);
+                    if (cached == mCachedObjects.end() || !cached->second.hasInfo) {
+                        handles.push_back(*listed);
+                    }
+                }
+            }
+        }
+    }
+    if (handles.empty()) {
+        return fetchObjectInfo(handle, info);
+    }
+
+    std::vector<CachedObjectInfo> infos;
+    fetchObjectInfos(handles, infos);
+    info = infos[0];
+
+    Mutex::Autolock autoLock(mCacheLock);
+    if (mCacheEnabled && generation == mCacheGeneration) {
+        // failures aren't cached, the object may be added later
+        for (size_t i = 0; i < handles.size(); i++) {
+            if (infos[i].result == MTP_RESPONSE_OK) {
+                CachedObject& object = cachedObject_l(handles[i]);
+                object.hasInfo = true;
+                object.info = std::move(infos[i]);
+            }
+        }
+    }
+    return info.result;
+}
+
+// Reads the thumbnail information from the file.
+static void readImageInfo(const char* path, MtpObjectInfo& info) {
     // read EXIF data for thumbnail information
     switch (info.mFormat) {
         case MTP_FORMAT_EXIF_JPEG:
@@ -924,8 +1424,50 @@ MtpResponseCode MtpDatabase::getObjectInfo(MtpObjectHandle handle,
             break;
         }
     }
+}
 
-    checkAndClearExceptionFromCallback(env, __FUNCTION__);
+MtpResponseCode MtpDatabase::getObjectInfo(MtpObjectHandle handle,
+                                             MtpObjectInfo& info) {
+    CachedObjectInfo cached;
+    MtpResponseCode result = getCachedObjectInfo(handle, cached);
+    if (result != MTP_RESPONSE_OK) {
+        return result;
+    }
+    info.mCompressedSize = (cached.length > 0xFFFFFFFFLL ? 0xFFFFFFFF : (uint32_t)cached.length);
+    info.mStorageID = cached.storageID;
+    info.mFormat = cached.format;
+    info.mParent = cached.parent;
+    info.mDateCreated = cached.dateCreated;
+    info.mDateModified = cached.dateModified;
+
+    if ((false)) {
+        info.mAssociationType = (cached.format == MTP_FORMAT_ASSOCIATION ?
+                                MTP_ASSOCIATION_TYPE_GENERIC_FOLDER :
+                                MTP_ASSOCIATION_TYPE_UNDEFINED);
+    }
+    info.mAssociationType = MTP_ASSOCIATION_TYPE_UNDEFINED;
+    info.mName = strdup(cached.name.c_str());
+
+    if (cached.hasImageInfo) {
+        info.mThumbCompressedSize = cached.thumbCompressedSize;
+        info.mThumbFormat = cached.thumbFormat;
+        info.mImagePixWidth = cached.imagePixWidth;
+        info.mImagePixHeight = cached.imagePixHeight;
+        return MTP_RESPONSE_OK;
+    }
+
+    readImageInfo(cached.path.c_str(), info);
+
+    Mutex::Autolock autoLock(mCacheLock);
+    auto object = mCachedObjects.find(handle);
+    if (object != mCachedObjects.end() && object->second.hasInfo) {
+        CachedObjectInfo& entry = object->second.info;
+        entry.hasImageInfo = true;
+        entry.thumbCompressedSize = info.mThumbCompressedSize;
+        entry.thumbFormat = info.mThumbFormat;
+        entry.imagePixWidth = info.mImagePixWidth;
+        entry.imagePixHeight = info.mImagePixHeight;
+    }
     return MTP_RESPONSE_OK;
 }
 
@@ -960,7 +1502,7 @@ void* MtpDatabase::getThumbnail(MtpObjectHandle handle, size_t& outThumbSize) {
                 break;
             }
 
-            // See the above comment on getObjectInfo() method.
+            // See the above comment on readImageInfo() method.
             case MTP_FORMAT_DNG:
             case MTP_FORMAT_TIFF:
             case MTP_FORMAT_TIFF_EP:
@@ -1004,6 +1546,24 @@ MtpResponseCode MtpDatabase::getObjectFilePath(MtpObjectHandle handle,
                                                  MtpStringBuffer& outFilePath,
                                                  int64_t& outFileLength,
                                                  MtpObjectFormat& outFormat) {
+    {
+        Mutex::Autolock autoLock(mCacheLock);
+        auto object = mCachedObjects.find(handle);
+        if (mCacheEnabled && object != mCachedObjects.end() && object->second.hasInfo) {
+            const CachedObjectInfo& info = object->second.info;
+            outFilePath.set(info.path.c_str());
+            outFileLength = info.length;
+            outFormat = info.format;
+            return MTP_RESPONSE_OK;
+        }
+    }
+    return fetchObjectFilePath(handle, outFilePath, outFileLength, outFormat);
+}
+
+MtpResponseCode MtpDatabase::fetchObjectFilePath(MtpObjectHandle handle,
+                                                 MtpStringBuffer& outFilePath,
+                                                 int64_t& outFileLength,
+                                                 MtpObjectFormat& outFormat) {
     JNIEnv* env = AndroidRuntime::getJNIEnv();
     jint result = env->CallIntMethod(mDatabase, method_getObjectFilePath,
                 (jint)handle, mStringBuffer, mLongBuffer);
@@ -1036,6 +1596,7 @@ MtpResponseCode MtpDatabase::beginDeleteObject(MtpObjectHandle handle) {
 void MtpDatabase::endDeleteObject(MtpObjectHandle handle, bool succeeded) {
     JNIEnv* env = AndroidRuntime::getJNIEnv();
     env->CallVoidMethod(mDatabase, method_endDeleteObject, (jint)handle, (jboolean) succeeded);
+    invalidateObjectCache(0);
 
     checkAndClearExceptionFromCallback(env, __FUNCTION__);
 }
@@ -1057,6 +1618,7 @@ void MtpDatabase::endMoveObject(MtpObjectHandle oldParent, MtpObjectHandle newPa
     env->CallVoidMethod(mDatabase, method_endMoveObject,
                 (jint)oldParent, (jint) newParent, (jint) oldStorage, (jint) newStorage,
                 (jint) handle, (jboolean) succeeded);
+    invalidateObjectCache(0);
 
     checkAndClearExceptionFromCallback(env, __FUNCTION__);
 }
@@ -1074,6 +1636,7 @@ MtpResponseCode MtpDatabase::beginCopyObject(MtpObjectHandle handle, MtpObjectHa
 void MtpDatabase::endCopyObject(MtpObjectHandle handle, bool succeeded) {
     JNIEnv* env = AndroidRuntime::getJNIEnv();
     env->CallVoidMethod(mDatabase, method_endCopyObject, (jint)handle, (jboolean)succeeded);
+    invalidateObjectCache(0);
 
     checkAndClearExceptionFromCallback(env, __FUNCTION__);
 }
@@ -1337,6 +1900,22 @@ android_mtp_MtpDatabase_finalize(JNIEnv *env, jobject thiz)
     checkAndClearExceptionFromCallback(env, __FUNCTION__);
 }
 
+static void
+android_mtp_MtpDatabase_set_object_cache_enabled(JNIEnv *env, jobject thiz, jboolean enabled)
+{
+    MtpDatabase* database = (MtpDatabase *)env->GetLongField(thiz, field_context);
+    if (database)
+        database->setObjectCacheEnabled(enabled);
+}
+
+static void
+android_mtp_MtpDatabase_invalidate_object_cache(JNIEnv *env, jobject thiz, jint handle)
+{
+    MtpDatabase* database = (MtpDatabase *)env->GetLongField(thiz, field_context);
+    if (database)
+        database->invalidateObjectCache(handle);
+}
+
 static jstring
 android_mtp_MtpPropertyGroup_format_date_time(JNIEnv *env, jobject /*thiz*/, jlong seconds)
 {
@@ -1350,6 +1929,10 @@ android_mtp_MtpPropertyGroup_format_date_time(JNIEnv *env, jobject /*thiz*/, jlo
 static const JNINativeMethod gMtpDatabaseMethods[] = {
     {"native_setup",            "()V",  (void *)android_mtp_MtpDatabase_setup},
     {"native_finalize",         "()V",  (void *)android_mtp_MtpDatabase_finalize},
+    {"native_set_object_cache_enabled", "(Z)V",
+                                        (void *)android_mtp_MtpDatabase_set_object_cache_enabled},
+    {"native_invalidate_object_cache",  "(I)V",
+                                        (void *)android_mtp_MtpDatabase_invalidate_object_cache},
 };
 
 static const JNINativeMethod gMtpPropertyGroupMethods[] = {
@@ -1396,6 +1979,11 @@ int register_android_mtp_MtpDatabase(JNIEnv *env)
     GET_METHOD_ID(endCopyObject, clazz, "(IZ)V");
     GET_METHOD_ID(getObjectReferences, clazz, "(I)[I");
     GET_METHOD_ID(setObjectReferences, clazz, "(I[I)I");
+    method_getObjectInfos = env->GetMethodID(clazz, "getObjectInfos",
+            "([I[I[J[Ljava/lang/String;[Ljava/lang/String;)V");
+    if (method_getObjectInfos == NULL) {
+        env->ExceptionClear();
+    }
 
     field_context = env->GetFieldID(clazz, "mNativeContext", "J");
     if (field_context == NULL) {
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <math.h>
 #include <stdio.h>
 
 //#define LOG_NDEBUG 0
@@ -28,6 +29,10 @@
 
 #include <nativehelper/ScopedUtfChars.h>
 
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 using namespace android;
 
 #define VISUALIZER_SUCCESS                      0
@@ -42,6 +47,19 @@ using namespace android;
 #define NATIVE_EVENT_PCM_CAPTURE                0
 #define NATIVE_EVENT_FFT_CAPTURE                1
 #define NATIVE_EVENT_SERVER_DIED                2
+// a capture was written to the capture buffer, arg2 is its sequence number
+#define NATIVE_EVENT_BUFFER_CAPTURE             3
+
+// The capture buffer is a ring of slots, each holding one waveform or FFT
+// capture, after a header with the sequence number of the last capture written,
+// the number of slots and the data size of a slot. A slot starts with the
+// sequence number of its capture, 0 while it is written, its type, sampling
+// rate and data size. The sequence numbers are written last, so a reader sees
+// a consistent slot if they match before and after reading it.
+#define CAPTURE_BUFFER_HEADER_SIZE              16
+#define CAPTURE_SLOT_HEADER_SIZE                16
+#define CAPTURE_TYPE_WAVEFORM                   0
+#define CAPTURE_TYPE_FFT                        1
 
 // ----------------------------------------------------------------------------
 static const char* const kClassPathName = "android/media/audiofx/Visualizer";
@@ -74,13 +92,39 @@ struct visualizer_callback_cookie {
     jbyteArray  waveform_data;
     jbyteArray  fft_data;
 
+    // The direct buffer registered with native_setCaptureBuffer, the captures
+    // are written to it instead of the arrays above when it is set.
+    jobject     capture_buffer;
+    uint8_t*    capture_ring;
+    uint32_t    capture_slots;
+    uint32_t    capture_sequence;
+    // the number of FFT magnitude bands written to the buffer, 0 for raw FFTs
+    uint32_t    fft_resolution;
+    uint32_t    fft_power[VISUALIZER_CAPTURE_SIZE_MAX / 2];
+
     visualizer_callback_cookie() {
         waveform_data = NULL;
         fft_data = NULL;
+        capture_buffer = NULL;
+        capture_ring = NULL;
+        capture_slots = 0;
+        capture_sequence = 0;
+        fft_resolution = 0;
     }
 
     ~visualizer_callback_cookie() {
         cleanupBuffers();
+        cleanupCaptureBuffer();
+    }
+
+    void cleanupCaptureBuffer() {
+        AutoMutex lock(&callback_data_lock);
+        if (capture_buffer) {
+            AndroidRuntime::getJNIEnv()->DeleteGlobalRef(capture_buffer);
+            capture_buffer = NULL;
+            capture_ring = NULL;
+            capture_slots = 0;
+        }
     }
 
     void cleanupBuffers() {
@@ -158,6 +202,93 @@ static void ensureArraySize(JNIEnv *env, jbyteArray *array, uint32_t size) {
     }
 }
 
+// Writes the power of the first size / 2 bins of an FFT capture, the capture
+// holds the real parts of DC and nyquist followed by the real and imaginary
+// parts of the other bins. Nyquist is left out.
+static void computeFftPower(const uint8_t* fft, uint32_t size, uint32_t* power) {
+    const int8_t* in = reinterpret_cast<const int8_t*>(fft);
+    const uint32_t bins = size / 2;
+    power[0] = in[0] * in[0];
+    uint32_t k = 1;
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+    for (; k + 16 <= bins; k += 16) {
+        int8x16x2_t ri = vld2q_s8(in + 2 * k);
+        int16x8_t rLo = vmovl_s8(vget_low_s8(ri.val[0]));
+        int16x8_t rHi = vmovl_s8(vget_high_s8(ri.val[0]));
+        int16x8_t iLo = vmovl_s8(vget_low_s8(ri.val[1]));
+        int16x8_t iHi = vmovl_s8(vget_high_s8(ri.val[1]));
+        int32x4_t p0 = vmull_s16(vget_low_s16(rLo), vget_low_s16(rLo));
+        int32x4_t p1 = vmull_s16(vget_high_s16(rLo), vget_high_s16(rLo));
+        int32x4_t p2 = vmull_s16(vget_low_s16(rHi), vget_low_s16(rHi));
+        int32x4_t p3 = vmull_s16(vget_high_s16(rHi), vget_high_s16(rHi));
+        p0 = vmlal_s16(p0, vget_low_s16(iLo), vget_low_s16(iLo));
+        p1 = vmlal_s16(p1, vget_high_s16(iLo), vget_high_s16(iLo));
+        p2 = vmlal_s16(p2, vget_low_s16(iHi), vget_low_s16(iHi));
+        p3 = vmlal_s16(p3, vget_high_s16(iHi), vget_high_s16(iHi));
+        vst1q_u32(power + k, vreinterpretq_u32_s32(p0));
+        vst1q_u32(power + k + 4, vreinterpretq_u32_s32(p1));
+        vst1q_u32(power + k + 8, vreinterpretq_u32_s32(p2));
+        vst1q_u32(power + k + 12, vreinterpretq_u32_s32(p3));
+    }
+#endif
+    for (; k < bins; k++) {
+        int r = in[2 * k];
+        int i = in[2 * k + 1];
+        power[k] = r * r + i * i;
+    }
+}
+
+// Reduces an FFT capture to the RMS magnitudes of resolution bands of bins.
+static void computeFftMagnitudes(const uint8_t* fft, uint32_t size, uint32_t resolution,
+        uint32_t* power, uint8_t* magnitudes) {
+    const uint32_t bins = size / 2;
+    computeFftPower(fft, size, power);
+    for (uint32_t band = 0; band < resolution; band++) {
+        uint32_t first = band * bins / resolution;
+        uint32_t last = (band + 1) * bins / resolution;
+        if (last <= first) {
+            last = first + 1;
+        }
+        uint32_t sum = 0;
+        for (uint32_t k = first; k < last; k++) {
+            sum += power[k];
+        }
+        float magnitude = sqrtf((float)sum / (last - first));
+        magnitudes[band] = magnitude > 255.0f ? 255 : (uint8_t)magnitude;
+    }
+}
+
+// Writes a capture to the next slot of the capture buffer, returns its sequence
+// number. Called with callback_data_lock held.
+static uint32_t writeCapture_l(visualizer_callback_cookie* callbackInfo, uint32_t type,
+        const uint8_t* data, uint32_t size, uint32_t samplingRate) {
+    const uint32_t slotSize = CAPTURE_SLOT_HEADER_SIZE + VISUALIZER_CAPTURE_SIZE_MAX;
+    const uint32_t sequence = ++callbackInfo->capture_sequence;
+    uint8_t* slot = callbackInfo->capture_ring + CAPTURE_BUFFER_HEADER_SIZE
+            + ((sequence - 1) % callbackInfo->capture_slots) * slotSize;
+    uint32_t* slotHeader = reinterpret_cast<uint32_t*>(slot);
+    uint32_t* header = reinterpret_cast<uint32_t*>(callbackInfo->capture_ring);
+
+    __atomic_store_n(&slotHeader[0], 0, __ATOMIC_RELEASE);
+    slotHeader[1] = type;
+    slotHeader[2] = samplingRate;
+    uint8_t* out = slot + CAPTURE_SLOT_HEADER_SIZE;
+    if (type == CAPTURE_TYPE_FFT && callbackInfo->fft_resolution != 0) {
+        uint32_t resolution = callbackInfo->fft_resolution;
+        if (resolution > size / 2) {
+            resolution = size / 2;
+        }
+        computeFftMagnitudes(data, size, resolution, callbackInfo->fft_power, out);
+        size = resolution;
+    } else {
+        memcpy(out, data, size);
+    }
+    slotHeader[3] = size;
+    __atomic_store_n(&slotHeader[0], sequence, __ATOMIC_RELEASE);
+    __atomic_store_n(&header[0], sequence, __ATOMIC_RELEASE);
+    return sequence;
+}
+
 static void captureCallback(void* user,
         uint32_t waveformSize,
         uint8_t *waveform,
@@ -180,6 +311,39 @@ static void captureCallback(void* user,
 
     AutoMutex lock(&callbackInfo->callback_data_lock);
 
+    if (callbackInfo->capture_ring != NULL) {
+        // written to the capture buffer, Java is only told the sequence number
+        if (waveformSize != 0 && waveform != NULL) {
+            uint32_t sequence = writeCapture_l(callbackInfo, CAPTURE_TYPE_WAVEFORM,
+                    waveform, waveformSize, samplingrate);
+            env->CallStaticVoidMethod(
+                callbackInfo->visualizer_class,
+                fields.midPostNativeEvent,
+                callbackInfo->visualizer_ref,
+                NATIVE_EVENT_BUFFER_CAPTURE,
+                samplingrate,
+                sequence,
+                NULL);
+        }
+        if (fftSize != 0 && fft != NULL) {
+            uint32_t sequence = writeCapture_l(callbackInfo, CAPTURE_TYPE_FFT,
+                    fft, fftSize, samplingrate);
+            env->CallStaticVoidMethod(
+                callbackInfo->visualizer_class,
+                fields.midPostNativeEvent,
+                callbackInfo->visualizer_ref,
+                NATIVE_EVENT_BUFFER_CAPTURE,
+                samplingrate,
+                sequence,
+                NULL);
+        }
+        if (env->ExceptionCheck()) {
+            env->ExceptionDescribe();
+            env->ExceptionClear();
+        }
+        return;
+    }
+
     if (waveformSize != 0 && waveform != NULL) {
         jbyteArray jArray;
 
@@ -627,6 +791,100 @@ android_media_visualizer_native_getFft(JNIEnv *env, jobject thiz, jbyteArray jFf
     return status;
 }
 
+// Registers a direct buffer the captures are written to, see
+// CAPTURE_BUFFER_HEADER_SIZE, or unregisters it if buffer is null. FFTs are
+// written as fftResolution magnitude bands, or raw if it is 0.
+static jint
+android_media_visualizer_native_setCaptureBuffer(JNIEnv *env, jobject thiz, jobject buffer,
+        jint fftResolution)
+{
+    VisualizerJniStorage* lpJniStorage = (VisualizerJniStorage *)env->GetLongField(thiz,
+            fields.fidJniData);
+    if (lpJniStorage == NULL) {
+        return VISUALIZER_ERROR_NO_INIT;
+    }
+    visualizer_callback_cookie* callbackInfo = &lpJniStorage->mCallbackData;
+    callbackInfo->cleanupCaptureBuffer();
+    if (buffer == NULL) {
+        return VISUALIZER_SUCCESS;
+    }
+
+    uint8_t* ring = (uint8_t *)env->GetDirectBufferAddress(buffer);
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    const jlong slotSize = CAPTURE_SLOT_HEADER_SIZE + VISUALIZER_CAPTURE_SIZE_MAX;
+    if (ring == NULL || ((uintptr_t)ring & 3) != 0 || fftResolution < 0
+            || fftResolution > VISUALIZER_CAPTURE_SIZE_MAX / 2
+            || capacity < CAPTURE_BUFFER_HEADER_SIZE + 2 * slotSize) {
+        ALOGE("setCaptureBuffer: bad buffer %p capacity %lld", ring, (long long)capacity);
+        return VISUALIZER_ERROR_BAD_VALUE;
+    }
+
+    AutoMutex lock(&callbackInfo->callback_data_lock);
+    callbackInfo->capture_buffer = env->NewGlobalRef(buffer);
+    callbackInfo->capture_slots = (capacity - CAPTURE_BUFFER_HEADER_SIZE) / slotSize;
+    callbackInfo->capture_sequence = 0;
+    callbackInfo->fft_resolution = fftResolution;
+    memset(ring, 0, CAPTURE_BUFFER_HEADER_SIZE + callbackInfo->capture_slots * slotSize);
+    uint32_t* header = reinterpret_cast<uint32_t*>(ring);
+    header[1] = callbackInfo->capture_slots;
+    header[2] = VISUALIZER_CAPTURE_SIZE_MAX;
+    callbackInfo->capture_ring = ring;
+    return VISUALIZER_SUCCESS;
+}
+
+// Polls the waveform and FFT into the capture buffer without a callback,
+// returns the sequence number of the last capture written or an error.
+static jint
+android_media_visualizer_native_captureToBuffer(JNIEnv *env, jobject thiz, jboolean jWaveform,
+        jboolean jFft)
+{
+    sp<Visualizer> lpVisualizer = getVisualizer(env, thiz);
+    if (lpVisualizer == 0) {
+        return VISUALIZER_ERROR_NO_INIT;
+    }
+    VisualizerJniStorage* lpJniStorage = (VisualizerJniStorage *)env->GetLongField(thiz,
+            fields.fidJniData);
+    if (lpJniStorage == NULL) {
+        return VISUALIZER_ERROR_NO_INIT;
+    }
+    visualizer_callback_cookie* callbackInfo = &lpJniStorage->mCallbackData;
+
+    uint8_t waveform[VISUALIZER_CAPTURE_SIZE_MAX];
+    uint8_t fft[VISUALIZER_CAPTURE_SIZE_MAX];
+    const uint32_t size = lpVisualizer->getCaptureSize();
+    const uint32_t samplingRate = lpVisualizer->getSamplingRate();
+    if (size > VISUALIZER_CAPTURE_SIZE_MAX) {
+        return VISUALIZER_ERROR_BAD_VALUE;
+    }
+    if (jWaveform) {
+        jint status = translateError(lpVisualizer->getWaveForm(waveform));
+        if (status != VISUALIZER_SUCCESS) {
+            return status;
+        }
+    }
+    if (jFft) {
+        jint status = translateError(lpVisualizer->getFft(fft));
+        if (status != VISUALIZER_SUCCESS) {
+            return status;
+        }
+    }
+
+    AutoMutex lock(&callbackInfo->callback_data_lock);
+    if (callbackInfo->capture_ring == NULL) {
+        return VISUALIZER_ERROR_INVALID_OPERATION;
+    }
+    jint sequence = callbackInfo->capture_sequence;
+    if (jWaveform) {
+        sequence = writeCapture_l(callbackInfo, CAPTURE_TYPE_WAVEFORM, waveform, size,
+                samplingRate);
+    }
+    if (jFft) {
+        sequence = writeCapture_l(callbackInfo, CAPTURE_TYPE_FFT, fft, size, samplingRate);
+    }
+    // masked so a sequence number is never taken for an error
+    return sequence & 0x7fffffff;
+}
+
 static jint
 android_media_visualizer_native_getPeakRms(JNIEnv *env, jobject thiz, jobject jPeakRmsObj)
 {
@@ -701,6 +959,9 @@ static const JNINativeMethod gMethods[] = {
     {"native_getPeakRms",      "(Landroid/media/audiofx/Visualizer$MeasurementPeakRms;)I",
                                           (void *)android_media_visualizer_native_getPeakRms},
     {"native_setPeriodicCapture","(IZZ)I",(void *)android_media_setPeriodicCapture},
+    {"native_setCaptureBuffer",  "(Ljava/nio/ByteBuffer;I)I",
+                                          (void *)android_media_visualizer_native_setCaptureBuffer},
+    {"native_captureToBuffer",   "(ZZ)I", (void *)android_media_visualizer_native_captureToBuffer},
 };
 
 // ----------------------------------------------------------------------------
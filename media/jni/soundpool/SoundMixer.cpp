@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#define LOG_TAG "SoundMixer"
+#include "utils/Log.h"
+
+#include <math.h>
+
+#include <media/AudioPolicyHelper.h>
+
+#include "SoundMixer.h"
+
+namespace android {
+
+static const uint64_t kUnityStep = 1ULL << 32;
+static const float kFracScale = 1.0f / 4294967296.0f;
+static const float kSampleScale = 1.0f / 32768.0f;
+static const uint32_t kMixerSampleRate = 48000;
+static const int kMixerChannels = 2;
+
+SoundMixer::PiMutex::PiMutex()
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&mMutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+SoundMixer::PiMutex::~PiMutex()
+{
+    pthread_mutex_destroy(&mMutex);
+}
+
+SoundMixer::SoundMixer(SoundPool* soundPool, int maxVoices) :
+    mSoundPool(soundPool), mSampleRate(kMixerSampleRate), mStarted(false)
+{
+    if (maxVoices > MAX_MIXER_VOICES) {
+        maxVoices = MAX_MIXER_VOICES;
+    }
+    mVoices.insertAt(Voice(), 0, maxVoices);
+
+    // mix at the rate of the output so the track can use the fast path
+    audio_stream_type_t streamType = audio_attributes_to_stream_type(soundPool->attributes());
+    if (AudioSystem::getOutputSamplingRate(&mSampleRate, streamType) != NO_ERROR) {
+        mSampleRate = kMixerSampleRate;
+    }
+    mAudioTrack = new AudioTrack(streamType, mSampleRate, AUDIO_FORMAT_PCM_FLOAT,
+            AUDIO_CHANNEL_OUT_STEREO, 0 /*default frame count*/, AUDIO_OUTPUT_FLAG_FAST,
+            callback, this, 0 /*default notification frames*/, AUDIO_SESSION_ALLOCATE,
+            AudioTrack::TRANSFER_CALLBACK,
+            NULL /*offloadInfo*/, -1 /*uid*/, -1 /*pid*/, soundPool->attributes());
+    mStatus = mAudioTrack->initCheck();
+    if (mStatus != NO_ERROR) {
+        ALOGE("Error creating mixer AudioTrack");
+        mAudioTrack.clear();
+    } else {
+        ALOGV("mixing %d voices at %u Hz, %zu frames", maxVoices, mSampleRate,
+                mAudioTrack->frameCount());
+    }
+}
+
+SoundMixer::~SoundMixer()
+{
+    // the destructor waits for the callback thread, which may need mLock
+    if (mAudioTrack != 0) {
+        mAudioTrack->stop();
+        mAudioTrack.clear();
+    }
+}
+
+uint64_t SoundMixer::step(const sp<Sample>& sample, float rate) const
+{
+    uint64_t step = uint64_t(double(sample->sampleRate()) * rate / mSampleRate * kUnityStep);
+    return step != 0 ? step : 1;
+}
+
+bool SoundMixer::play(int voice, SoundChannel* channel, const sp<Sample>& sample,
+        float leftVolume, float rightVolume, int loop, float rate)
+{
+    if (sample->format() != AUDIO_FORMAT_PCM_16_BIT || sample->numChannels() < 1) {
+        ALOGW("can't mix sample %d with format %#x", sample->sampleID(), sample->format());
+        return false;
+    }
+    size_t frames = sample->size() / (sample->numChannels() * sizeof(int16_t));
+    if (frames == 0) {
+        return false;
+    }
+
+    bool start;
+    sp<Sample> oldSample;
+    {
+        PiMutex::Autolock lock(&mLock);
+        Voice& v = mVoices.editItemAt(voice);
+        oldSample = v.sample;
+        v.channel = channel;
+        v.sample = sample;
+        v.frames = frames;
+        v.numChannels = sample->numChannels();
+        v.position = 0;
+        v.step = step(sample, rate);
+        v.leftVolume = leftVolume;
+        v.rightVolume = rightVolume;
+        v.loop = loop;
+        v.paused = false;
+        v.active = true;
+        start = !mStarted;
+        mStarted = true;
+    }
+    if (start) {
+        mAudioTrack->start();
+    }
+    return true;
+}
+
+bool SoundMixer::idle_l()
+{
+    for (size_t i = 0; i < mVoices.size(); ++i) {
+        const Voice& v = mVoices[i];
+        if (v.active && !v.paused) {
+            return false;
+        }
+    }
+    bool started = mStarted;
+    mStarted = false;
+    return started;
+}
+
+void SoundMixer::stop(int voice)
+{
+    // released after the lock
+    sp<Sample> oldSample;
+    bool idle;
+    {
+        PiMutex::Autolock lock(&mLock);
+        Voice& v = mVoices.editItemAt(voice);
+        v.active = false;
+        v.channel = NULL;
+        oldSample = v.sample;
+        v.sample.clear();
+        idle = idle_l();
+    }
+    // a running fast track keeps its slot and the output out of standby even when mixing
+    // silence, stopping lets the end of the last sound play out first
+    if (idle) {
+        mAudioTrack->stop();
+    }
+}
+
+void SoundMixer::pause(int voice, bool paused)
+{
+    bool start = false;
+    bool idle = false;
+    {
+        PiMutex::Autolock lock(&mLock);
+        mVoices.editItemAt(voice).paused = paused;
+        if (!paused) {
+            start = !mStarted;
+            mStarted = true;
+        } else {
+            idle = idle_l();
+        }
+    }
+    if (start) {
+        mAudioTrack->start();
+    } else if (idle) {
+        mAudioTrack->pause();
+    }
+}
+
+void SoundMixer::pauseOutput()
+{
+    bool pause;
+    {
+        PiMutex::Autolock lock(&mLock);
+        pause = mStarted;
+        mStarted = false;
+    }
+    if (pause) {
+        mAudioTrack->pause();
+    }
+}
+
+void SoundMixer::setVolume(int voice, float leftVolume, float rightVolume)
+{
+    PiMutex::Autolock lock(&mLock);
+    Voice& v = mVoices.editItemAt(voice);
+    v.leftVolume = leftVolume;
+    v.rightVolume = rightVolume;
+}
+
+void SoundMixer::setRate(int voice, float rate)
+{
+    PiMutex::Autolock lock(&mLock);
+    Voice& v = mVoices.editItemAt(voice);
+    if (v.sample != 0) {
+        v.step = step(v.sample, rate);
+    }
+}
+
+void SoundMixer::setLoop(int voice, int loop)
+{
+    PiMutex::Autolock lock(&mLock);
+    mVoices.editItemAt(voice).loop = loop;
+}
+
+void SoundMixer::callback(int event, void* user, void *info)
+{
+    static_cast<SoundMixer*>(user)->process(event, info);
+}
+
+void SoundMixer::process(int event, void *info)
+{
+    if (event == AudioTrack::EVENT_MORE_DATA) {
+        AudioTrack::Buffer* b = static_cast<AudioTrack::Buffer *>(info);
+        size_t frameCount = b->size / (kMixerChannels * sizeof(float));
+        mix(static_cast<float*>(b->raw), frameCount);
+        b->size = frameCount * kMixerChannels * sizeof(float);
+    } else if (event == AudioTrack::EVENT_UNDERRUN) {
+        ALOGV("mixer underrun");
+    } else if (event == AudioTrack::EVENT_NEW_IAUDIOTRACK) {
+        ALOGV("mixer NEW_IAUDIOTRACK");
+    }
+}
+
+// mixes the playing voices into frameCount interleaved stereo frames
+void SoundMixer::mix(float* out, size_t frameCount)
+{
+    SoundChannel* finished[MAX_MIXER_VOICES];
+    size_t numFinished = 0;
+
+    memset(out, 0, frameCount * kMixerChannels * sizeof(float));
+    {
+        PiMutex::Autolock lock(&mLock);
+        for (size_t i = 0; i < mVoices.size(); ++i) {
+            Voice& v = mVoices.editItemAt(i);
+            if (!v.active || v.paused) {
+                continue;
+            }
+            if (!mixVoice_l(v, out, frameCount)) {
+                // the sample is only released when the channel stops the voice
+                v.active = false;
+                finished[numFinished++] = v.channel;
+            }
+        }
+    }
+
+    const size_t sampleCount = frameCount * kMixerChannels;
+    for (size_t i = 0; i < sampleCount; ++i) {
+        out[i] = fminf(fmaxf(out[i], -1.0f), 1.0f);
+    }
+
+    // the stop list is handled on the SoundPool thread, like the end of a channel's track
+    for (size_t i = 0; i < numFinished; ++i) {
+        mSoundPool->addToStopList(finished[i]);
+    }
+}
+
+// returns false once the voice played the end of its last loop
+bool SoundMixer::mixVoice_l(Voice& v, float* out, size_t frameCount)
+{
+    const int16_t* data = reinterpret_cast<const int16_t*>(v.sample->data());
+    const int channels = v.numChannels;
+    // the right channel is the left one for mono samples
+    const int right = channels > 1 ? 1 : 0;
+    const float leftGain = v.leftVolume * kSampleScale;
+    const float rightGain = v.rightVolume * kSampleScale;
+    const uint64_t end = uint64_t(v.frames) << 32;
+
+    size_t i = 0;
+    while (i < frameCount) {
+        if (v.position >= end) {
+            if (v.loop == 0) {
+                return false;
+            }
+            if (v.loop > 0) {
+                v.loop--;
+            }
+            v.position %= end;
+            continue;
+        }
+
+        // the frames left before the end of the sample
+        size_t count = (end - v.position + v.step - 1) / v.step;
+        if (count > frameCount - i) {
+            count = frameCount - i;
+        }
+        float* q = out + i * kMixerChannels;
+
+        if (v.step == kUnityStep) {
+            // same rate as the output, a plain multiply-add the compiler vectorizes
+            const int16_t* p = data + (v.position >> 32) * channels;
+            if (channels == 1) {
+                for (size_t k = 0; k < count; ++k) {
+                    q[2 * k] += p[k] * leftGain;
+                    q[2 * k + 1] += p[k] * rightGain;
+                }
+            } else {
+                for (size_t k = 0; k < count; ++k) {
+                    q[2 * k] += p[k * channels] * leftGain;
+                    q[2 * k + 1] += p[k * channels + 1] * rightGain;
+                }
+            }
+            v.position += uint64_t(count) << 32;
+        } else {
+            // linear interpolation, wrapping to the first frame when looping
+            uint64_t position = v.position;
+            for (size_t k = 0; k < count; ++k) {
+                size_t index = position >> 32;
+                size_t next = index + 1 < v.frames ? index + 1 : (v.loop != 0 ? 0 : index);
+                float frac = (position & 0xffffffff) * kFracScale;
+                const int16_t* p0 = data + index * channels;
+                const int16_t* p1 = data + next * channels;
+                float l = p0[0] + (p1[0] - p0[0]) * frac;
+                float r = p0[right] + (p1[right] - p0[right]) * frac;
+                q[2 * k] += l * leftGain;
+                q[2 * k + 1] += r * rightGain;
+                position += v.step;
+            }
+            v.position = position;
+        }
+        i += count;
+    }
+    return true;
+}
+
+} // end namespace android
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SOUNDMIXER_H_
+#define SOUNDMIXER_H_
+
+#include <pthread.h>
+
+#include <utils/threads.h>
+#include <utils/Vector.h>
+#include <media/AudioTrack.h>
+
+#include "SoundPool.h"
+
+namespace android {
+
+// the most voices a mixer has, as many as a SoundPool has channels
+static const int MAX_MIXER_VOICES = 32;
+
+/*
+ * Mixes the channels of a SoundPool into a single fast AudioTrack, so playing
+ * a sound only changes the state of a voice instead of creating and starting
+ * a track for it. Used when the pool is created with AUDIO_FLAG_LOW_LATENCY.
+ *
+ * Each SoundChannel owns the voice with its index in the channel pool. The
+ * voices are mixed on the AudioTrack callback thread, a voice reaching the end
+ * of its sample puts its channel on the SoundPool stop list like a track does.
+ */
+class SoundMixer {
+public:
+    SoundMixer(SoundPool* soundPool, int maxVoices);
+    ~SoundMixer();
+    status_t initCheck() const { return mStatus; }
+
+    // returns false if the sample can't be mixed
+    bool play(int voice, SoundChannel* channel, const sp<Sample>& sample,
+            float leftVolume, float rightVolume, int loop, float rate);
+    void stop(int voice);
+    void pause(int voice, bool paused);
+    void setVolume(int voice, float leftVolume, float rightVolume);
+    void setRate(int voice, float rate);
+    void setLoop(int voice, int loop);
+    // pauses the track until a voice plays or resumes
+    void pauseOutput();
+
+private:
+    // Taken on the callback thread, which runs at audio priority. Priority inheritance keeps a
+    // lower priority thread holding the lock from delaying the callback.
+    class PiMutex {
+    public:
+        PiMutex();
+        ~PiMutex();
+        void lock() { pthread_mutex_lock(&mMutex); }
+        void unlock() { pthread_mutex_unlock(&mMutex); }
+
+        class Autolock {
+        public:
+            explicit Autolock(PiMutex* mutex) : mMutex(*mutex) { mMutex.lock(); }
+            ~Autolock() { mMutex.unlock(); }
+        private:
+            PiMutex& mMutex;
+        };
+
+    private:
+        pthread_mutex_t mMutex;
+    };
+
+    struct Voice {
+        Voice() : channel(NULL), frames(0), numChannels(0), position(0), step(0),
+                leftVolume(0), rightVolume(0), loop(0), active(false), paused(false) {}
+        SoundChannel*   channel;
+        // kept until the voice is stopped, so the sample memory is never freed on the
+        // callback thread
+        sp<Sample>      sample;
+        size_t          frames;
+        int             numChannels;
+        // position and step in sample frames, in 32.32 fixed point
+        uint64_t        position;
+        uint64_t        step;
+        float           leftVolume;
+        float           rightVolume;
+        int             loop;
+        bool            active;
+        bool            paused;
+    };
+
+    static void callback(int event, void* user, void *info);
+    void process(int event, void *info);
+    void mix(float* out, size_t frameCount);
+    bool mixVoice_l(Voice& voice, float* out, size_t frameCount);
+    uint64_t step(const sp<Sample>& sample, float rate) const;
+    // returns true if the output was started and no voice is left playing, the caller then
+    // stops or pauses the track once the lock is released
+    bool idle_l();
+
+    SoundPool*          mSoundPool;
+    sp<AudioTrack>      mAudioTrack;
+    PiMutex             mLock;
+    Vector<Voice>       mVoices;
+    uint32_t            mSampleRate;
+    bool                mStarted;
+    status_t            mStatus;
+};
+
+} // end namespace android
+
+#endif /*SOUNDMIXER_H_*/
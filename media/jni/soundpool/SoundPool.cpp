@@ -18,6 +18,10 @@
 #define LOG_TAG "SoundPool"
 
 #include <inttypes.h>
+#include <sys/stat.h>
+
+#include <map>
+#include <tuple>
 
 #include <utils/Log.h>
 
@@ -25,6 +29,7 @@
 
 #include <media/AudioTrack.h>
 #include "SoundPool.h"
+#include "SoundMixer.h"
 #include "SoundPoolThread.h"
 #include <media/AudioPolicyHelper.h>
 #include <media/NdkMediaCodec.h>
@@ -41,7 +46,7 @@ uint32_t kDefaultFrameCount = 1200;
 size_t kDefaultHeapSize = 1024 * 1024; // 1MB
 
 
-SoundPool::SoundPool(int maxChannels, const audio_attributes_t* pAttributes)
+SoundPool::SoundPool(int maxChannels, const audio_attributes_t* pAttributes, int decodeThreads)
 {
     ALOGV("SoundPool constructor: maxChannels=%d, attr.usage=%d, attr.flags=0x%x, attr.tags=%s",
             maxChannels, pAttributes->usage, pAttributes->flags, pAttributes->tags);
@@ -73,8 +78,23 @@ SoundPool::SoundPool(int maxChannels, const audio_attributes_t* pAttributes)
         mChannels.push_back(&mChannelPool[i]);
     }
 
-    // start decode thread
-    startThreads();
+    // a low latency pool plays its sounds on the voices of a single mixed track instead of
+    // creating a track for every sound it plays
+    mMixer = NULL;
+    if (mAttributes.flags & AUDIO_FLAG_LOW_LATENCY) {
+        mMixer = new SoundMixer(this, mMaxChannels);
+        if (mMixer->initCheck() != NO_ERROR) {
+            ALOGW("Error creating mixer, using a track per channel");
+            delete mMixer;
+            mMixer = NULL;
+        }
+    }
+
+    // start decode threads
+    if (decodeThreads < 1) {
+        decodeThreads = 1;
+    }
+    startThreads(decodeThreads);
 }
 
 SoundPool::~SoundPool()
@@ -83,6 +103,10 @@ SoundPool::~SoundPool()
     mDecodeThread->quit();
     quit();
 
+    // stop mixing before the channels go away
+    delete mMixer;
+    mMixer = NULL;
+
     Mutex::Autolock lock(&mLock);
 
     mChannels.clear();
@@ -177,11 +201,11 @@ void SoundPool::quit()
     mRestartLock.unlock();
 }
 
-bool SoundPool::startThreads()
+bool SoundPool::startThreads(int decodeThreads)
 {
     createThreadEtc(beginThread, this, "SoundPool");
     if (mDecodeThread == NULL)
-        mDecodeThread = new SoundPoolThread(this);
+        mDecodeThread = new SoundPoolThread(this, decodeThreads);
     return mDecodeThread != NULL;
 }
 
@@ -352,6 +376,9 @@ void SoundPool::autoPause()
         SoundChannel* channel = &mChannelPool[i];
         channel->autoPause();
     }
+    if (mMixer != NULL) {
+        mMixer->pauseOutput();
+    }
 }
 
 void SoundPool::resume(int channelID)
@@ -511,6 +538,75 @@ Sample::~Sample()
     }
 }
 
+// Identifies what a sample was decoded from: the file, its version and the range in it.
+struct DecodedSampleKey {
+    dev_t dev;
+    ino_t ino;
+    int64_t mtimeNs;
+    int64_t offset;
+    int64_t length;
+
+    bool operator<(const DecodedSampleKey& other) const {
+        return std::tie(dev, ino, mtimeNs, offset, length) <
+                std::tie(other.dev, other.ino, other.mtimeNs, other.offset, other.length);
+    }
+};
+
+struct DecodedSample {
+    wp<MemoryHeapBase> heap;
+    size_t size;
+    uint32_t sampleRate;
+    int numChannels;
+    audio_format_t format;
+};
+
+// The decoded samples of all the SoundPools of the process, so loading the same sound in
+// several pools, or twice in one, decodes it once and holds a single copy of its PCM. An entry
+// only lives as long as some Sample holds its heap.
+static Mutex gDecodedSamplesLock;
+static std::map<DecodedSampleKey, DecodedSample> gDecodedSamples;
+
+static bool getDecodedSampleKey(int fd, int64_t offset, int64_t length, DecodedSampleKey* key) {
+    struct stat st;
+    // only a regular file is known to have the same contents the next time it's loaded
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    key->dev = st.st_dev;
+    key->ino = st.st_ino;
+    key->mtimeNs = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    key->offset = offset;
+    key->length = length;
+    return true;
+}
+
+static sp<MemoryHeapBase> findDecodedSample(const DecodedSampleKey& key, DecodedSample* out) {
+    Mutex::Autolock lock(&gDecodedSamplesLock);
+    auto it = gDecodedSamples.find(key);
+    if (it == gDecodedSamples.end()) {
+        return nullptr;
+    }
+    sp<MemoryHeapBase> heap = it->second.heap.promote();
+    if (heap == nullptr) {
+        gDecodedSamples.erase(it);
+        return nullptr;
+    }
+    *out = it->second;
+    return heap;
+}
+
+static void addDecodedSample(const DecodedSampleKey& key, const DecodedSample& sample) {
+    Mutex::Autolock lock(&gDecodedSamplesLock);
+    for (auto it = gDecodedSamples.begin(); it != gDecodedSamples.end();) {
+        if (it->second.heap.promote() == nullptr) {
+            it = gDecodedSamples.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    gDecodedSamples[key] = sample;
+}
+
 static status_t decode(int fd, int64_t offset, int64_t length,
         uint32_t *rate, int *numChannels, audio_format_t *audioFormat,
         sp<MemoryHeapBase> heap, size_t *memsize) {
@@ -666,6 +762,23 @@ status_t Sample::doLoad()
     int numChannels;
     audio_format_t format;
     status_t status;
+
+    DecodedSampleKey key;
+    bool shareable = getDecodedSampleKey(mFd, mOffset, mLength, &key);
+    DecodedSample decoded;
+    if (shareable && (mHeap = findDecodedSample(key, &decoded)) != nullptr) {
+        ALOGV("Reusing the decoded sample of another load");
+        ::close(mFd);
+        mFd = -1;
+        mSize = decoded.size;
+        mData = new MemoryBase(mHeap, 0, mSize);
+        mSampleRate = decoded.sampleRate;
+        mNumChannels = decoded.numChannels;
+        mFormat = decoded.format;
+        mState = READY;
+        return NO_ERROR;
+    }
+
     mHeap = new MemoryHeapBase(kDefaultHeapSize);
 
     ALOGV("Start decode");
@@ -698,6 +811,9 @@ status_t Sample::doLoad()
     mNumChannels = numChannels;
     mFormat = format;
     mState = READY;
+    if (shareable) {
+        addDecodedSample(key, {mHeap, mSize, sampleRate, numChannels, format});
+    }
     return NO_ERROR;
 
 error:
@@ -736,6 +852,13 @@ void SoundChannel::play(const sp<Sample>& sample, int nextChannelID, float leftV
             return;
         }
 
+        // samples the mixer can't mix play on a track of their own
+        if (mixer() != NULL &&
+                playMixed_l(sample, nextChannelID, leftVolume, rightVolume, priority, loop, rate)) {
+            return;
+        }
+        mMixed = false;
+
         // initialize track
         size_t afFrameCount;
         uint32_t afSampleRate;
@@ -837,6 +960,39 @@ exit:
     }
 }
 
+SoundMixer* SoundChannel::mixer()
+{
+    return mSoundPool->mMixer;
+}
+
+int SoundChannel::voice()
+{
+    return this - mSoundPool->mChannelPool;
+}
+
+// call with lock held, starts the sample on the voice of the channel
+bool SoundChannel::playMixed_l(const sp<Sample>& sample, int nextChannelID, float leftVolume,
+        float rightVolume, int priority, int loop, float rate)
+{
+    if (!mixer()->play(voice(), this, sample, mMuted ? 0.0f : leftVolume,
+            mMuted ? 0.0f : rightVolume, loop, rate)) {
+        return false;
+    }
+    mPos = 0;
+    mSample = sample;
+    mChannelID = nextChannelID;
+    mPriority = priority;
+    mLoop = loop;
+    mLeftVolume = leftVolume;
+    mRightVolume = rightVolume;
+    mNumChannels = sample->numChannels();
+    mRate = rate;
+    mMixed = true;
+    clearNextEvent();
+    mState = PLAYING;
+    return true;
+}
+
 void SoundChannel::nextEvent()
 {
     sp<Sample> sample;
@@ -956,7 +1112,11 @@ bool SoundChannel::doStop_l()
     if (mState != IDLE) {
         setVolume_l(0, 0);
         ALOGV("stop");
-        mAudioTrack->stop();
+        if (mMixed) {
+            mixer()->stop(voice());
+        } else if (mAudioTrack != 0) {
+            mAudioTrack->stop();
+        }
         mPrevSampleID = mSample->sampleID();
         mSample.clear();
         mState = IDLE;
@@ -988,6 +1148,18 @@ void SoundChannel::stop()
     }
 }
 
+// call with lock held
+void SoundChannel::pauseOutput_l(bool paused)
+{
+    if (mMixed) {
+        mixer()->pause(voice(), paused);
+    } else if (paused) {
+        mAudioTrack->pause();
+    } else {
+        mAudioTrack->start();
+    }
+}
+
 //FIXME: Pause is a little broken right now
 void SoundChannel::pause()
 {
@@ -995,7 +1167,7 @@ void SoundChannel::pause()
     if (mState == PLAYING) {
         ALOGV("pause track");
         mState = PAUSED;
-        mAudioTrack->pause();
+        pauseOutput_l(true);
     }
 }
 
@@ -1006,7 +1178,7 @@ void SoundChannel::autoPause()
         ALOGV("pause track");
         mState = PAUSED;
         mAutoPaused = true;
-        mAudioTrack->pause();
+        pauseOutput_l(true);
     }
 }
 
@@ -1017,7 +1189,7 @@ void SoundChannel::resume()
         ALOGV("resume track");
         mState = PLAYING;
         mAutoPaused = false;
-        mAudioTrack->start();
+        pauseOutput_l(false);
     }
 }
 
@@ -1028,14 +1200,17 @@ void SoundChannel::autoResume()
         ALOGV("resume track");
         mState = PLAYING;
         mAutoPaused = false;
-        mAudioTrack->start();
+        pauseOutput_l(false);
     }
 }
 
 void SoundChannel::setRate(float rate)
 {
     Mutex::Autolock lock(&mLock);
-    if (mAudioTrack != NULL && mSample != 0) {
+    if (mMixed && mSample != 0) {
+        mixer()->setRate(voice(), rate);
+        mRate = rate;
+    } else if (mAudioTrack != NULL && mSample != 0) {
         uint32_t sampleRate = uint32_t(float(mSample->sampleRate()) * rate + 0.5);
         mAudioTrack->setSampleRate(sampleRate);
         mRate = rate;
@@ -1047,7 +1222,9 @@ void SoundChannel::setVolume_l(float leftVolume, float rightVolume)
 {
     mLeftVolume = leftVolume;
     mRightVolume = rightVolume;
-    if (mAudioTrack != NULL && !mMuted)
+    if (mMixed && !mMuted)
+        mixer()->setVolume(voice(), leftVolume, rightVolume);
+    else if (mAudioTrack != NULL && !mMuted)
         mAudioTrack->setVolume(leftVolume, rightVolume);
 }
 
@@ -1061,7 +1238,13 @@ void SoundChannel::mute(bool muting)
 {
     Mutex::Autolock lock(&mLock);
     mMuted = muting;
-    if (mAudioTrack != NULL) {
+    if (mMixed) {
+        if (mMuted) {
+            mixer()->setVolume(voice(), 0.0f, 0.0f);
+        } else {
+            mixer()->setVolume(voice(), mLeftVolume, mRightVolume);
+        }
+    } else if (mAudioTrack != NULL) {
         if (mMuted) {
             mAudioTrack->setVolume(0.0f, 0.0f);
         } else {
@@ -1073,7 +1256,10 @@ void SoundChannel::mute(bool muting)
 void SoundChannel::setLoop(int loop)
 {
     Mutex::Autolock lock(&mLock);
-    if (mAudioTrack != NULL && mSample != 0) {
+    if (mMixed && mSample != 0) {
+        mixer()->setLoop(voice(), loop);
+        mLoop = loop;
+    } else if (mAudioTrack != NULL && mSample != 0) {
         uint32_t loopEnd = mSample->size()/mNumChannels/
             ((mSample->format() == AUDIO_FORMAT_PCM_16_BIT) ? sizeof(int16_t) : sizeof(uint8_t));
         mAudioTrack->setLoop(0, loopEnd, loop);
@@ -29,10 +29,14 @@ namespace android {
 
 static const int IDLE_PRIORITY = -1;
 
+// the number of threads samples are decoded on by default
+static const int DEFAULT_DECODE_THREADS = 4;
+
 // forward declarations
 class SoundEvent;
 class SoundPoolThread;
 class SoundPool;
+class SoundMixer;
 
 // for queued events
 class SoundPoolEvent {
@@ -114,7 +118,8 @@ class SoundChannel : public SoundEvent {
 public:
     enum state { IDLE, RESUMING, STOPPING, PAUSED, PLAYING };
     SoundChannel() : mState(IDLE), mNumChannels(1),
-            mPos(0), mToggle(0), mAutoPaused(false), mMuted(false) {}
+            mPos(0), mToggle(0), mAutoPaused(false), mMuted(false),
+            mMixed(false) {}
     ~SoundChannel();
     void init(SoundPool* soundPool);
     void play(const sp<Sample>& sample, int channelID, float leftVolume, float rightVolume,
@@ -143,6 +148,11 @@ private:
     static void callback(int event, void* user, void *info);
     void process(int event, void *info, unsigned long toggle);
     bool doStop_l();
+    bool playMixed_l(const sp<Sample>& sample, int nextChannelID, float leftVolume,
+            float rightVolume, int priority, int loop, float rate);
+    void pauseOutput_l(bool paused);
+    SoundMixer* mixer();
+    int voice();
 
     SoundPool*          mSoundPool;
     sp<AudioTrack>      mAudioTrack;
@@ -156,14 +166,18 @@ private:
     bool                mAutoPaused;
     int                 mPrevSampleID;
     bool                mMuted;
+    // whether the sample plays on the mixer voice rather than on mAudioTrack
+    bool                mMixed;
 };
 
 // application object for managing a pool of sounds
 class SoundPool {
     friend class SoundPoolThread;
     friend class SoundChannel;
+    friend class SoundMixer;
 public:
-    SoundPool(int maxChannels, const audio_attributes_t* pAttributes);
+    SoundPool(int maxChannels, const audio_attributes_t* pAttributes,
+            int decodeThreads = DEFAULT_DECODE_THREADS);
     ~SoundPool();
     int load(int fd, int64_t offset, int64_t length, int priority);
     bool unload(int sampleID);
@@ -194,7 +208,7 @@ public:
 
 private:
     SoundPool() {} // no default constructor
-    bool startThreads();
+    bool startThreads(int decodeThreads);
     sp<Sample> findSample_l(int sampleID);
     SoundChannel* findChannel (int channelID);
     SoundChannel* findNextChannel (int channelID);
@@ -214,6 +228,8 @@ private:
     Mutex                   mRestartLock;
     Condition               mCondition;
     SoundPoolThread*        mDecodeThread;
+    // mixes all the channels into one track with AUDIO_FLAG_LOW_LATENCY, or NULL
+    SoundMixer*             mMixer;
     SoundChannel*           mChannelPool;
     List<SoundChannel*>     mChannels;
     List<SoundChannel*>     mRestart;
@@ -24,14 +24,14 @@ namespace android {
 
 void SoundPoolThread::write(SoundPoolMsg msg) {
     Mutex::Autolock lock(&mLock);
-    while (mMsgQueue.size() >= maxMessages) {
+    while (mRunning && mMsgQueue.size() >= maxMessages) {
         mCondition.wait(mLock);
     }
 
     // if thread is quitting, don't add to queue
     if (mRunning) {
         mMsgQueue.push(msg);
-        mCondition.signal();
+        mCondition.broadcast();
     }
 }
 
@@ -41,8 +41,14 @@ const SoundPoolMsg SoundPoolThread::read() {
         mCondition.wait(mLock);
     }
     SoundPoolMsg msg = mMsgQueue[0];
+    if (msg.mMessageType == SoundPoolMsg::KILL) {
+        // left in the queue for the other threads, the last one out wakes up quit()
+        mNumThreads--;
+        mCondition.broadcast();
+        return msg;
+    }
     mMsgQueue.removeAt(0);
-    mCondition.signal();
+    mCondition.broadcast();
     return msg;
 }
 
@@ -52,19 +58,26 @@ void SoundPoolThread::quit() {
         mRunning = false;
         mMsgQueue.clear();
         mMsgQueue.push(SoundPoolMsg(SoundPoolMsg::KILL, 0));
-        mCondition.signal();
-        mCondition.wait(mLock);
+        mCondition.broadcast();
+        while (mNumThreads > 0) {
+            mCondition.wait(mLock);
+        }
     }
     ALOGV("return from quit");
 }
 
-SoundPoolThread::SoundPoolThread(SoundPool* soundPool) :
-    mSoundPool(soundPool)
+SoundPoolThread::SoundPoolThread(SoundPool* soundPool, int numThreads) :
+    mSoundPool(soundPool), mRunning(false), mNumThreads(0)
 {
     mMsgQueue.setCapacity(maxMessages);
-    if (createThreadEtc(beginThread, this, "SoundPoolThread")) {
-        mRunning = true;
+    Mutex::Autolock lock(&mLock);
+    for (int i = 0; i < numThreads; i++) {
+        if (!createThreadEtc(beginThread, this, "SoundPoolThread")) {
+            break;
+        }
+        mNumThreads++;
     }
+    mRunning = mNumThreads > 0;
 }
 
 SoundPoolThread::~SoundPoolThread()
@@ -36,11 +36,12 @@ public:
 };
 
 /*
- * This class handles background requests from the SoundPool
+ * This class handles background requests from the SoundPool, on one or more
+ * threads that each take the next request, so samples decode in parallel.
  */
 class SoundPoolThread {
 public:
-    explicit SoundPoolThread(SoundPool* SoundPool);
+    SoundPoolThread(SoundPool* SoundPool, int numThreads);
     ~SoundPoolThread();
     void loadSample(int sampleID);
     void quit();
@@ -59,6 +60,7 @@ private:
     Vector<SoundPoolMsg>    mMsgQueue;
     SoundPool*              mSoundPool;
     bool                    mRunning;
+    int                     mNumThreads;
 };
 
 } // end namespace android
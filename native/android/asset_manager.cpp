@@ -172,6 +172,35 @@ const void* AAsset_getBuffer(AAsset* asset)
     return asset->mAsset->getBuffer(false);
 }
 
+/**
+ * Returns the data of an asset stored uncompressed, mapped straight from the APK without
+ * inflating or copying it, e.g. to load a large model in place. The data is only returned if
+ * it starts on an "alignment" byte boundary (a power of two), so page aligned entries (see
+ * zipalign -p) can be handed to code that needs page aligned memory. Returns NULL for
+ * compressed or unaligned assets, in which case the length is left untouched.
+ */
+const void* AAsset_getMappedBuffer(AAsset* asset, size_t alignment, off64_t* outLength)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        return NULL;
+    }
+    const void* data = asset->mAsset->getMappedBuffer(alignment);
+    if (data != NULL && outLength != NULL) {
+        *outLength = asset->mAsset->getLength();
+    }
+    return data;
+}
+
+/**
+ * Same as AAsset_read, but compressed assets are inflated directly into "buf" whatever the
+ * size of the request, instead of being expanded into a buffer of the asset or staged in the
+ * inflater's output chunk first.
+ */
+int AAsset_readDirect(AAsset* asset, void* buf, size_t count)
+{
+    return asset->mAsset->readDirect(buf, count);
+}
+
 off_t AAsset_getLength(AAsset* asset)
 {
     return asset->mAsset->getLength();
@@ -24,18 +24,42 @@
 #include <android/choreographer.h>
 #include <androidfw/DisplayEventDispatcher.h>
 #include <gui/ISurfaceComposer.h>
+#include <gui/SurfaceComposerClient.h>
+#include <ui/DisplayInfo.h>
 #include <utils/Looper.h>
 #include <utils/Mutex.h>
 #include <utils/Timers.h>
 
+/*
+ * The timeline of a frame, handed to AChoreographer_frameInfoCallback.
+ *
+ * The expected presentation time is the vsync the frame is displayed at when its buffer is
+ * queued before the deadline; past it, the frame misses that vsync and stuffs the pipeline.
+ */
+struct AChoreographerFrameInfo {
+    // the time of the vsync the frame starts at, as given to AChoreographer_frameCallback
+    int64_t frameTimeNanos;
+    int64_t expectedPresentTimeNanos;
+    int64_t deadlineNanos;
+    int64_t frameIntervalNanos;
+};
+
+typedef void (*AChoreographer_frameInfoCallback)(const AChoreographerFrameInfo* info,
+        void* data);
+
 namespace android {
 
 static inline const char* toString(bool value) {
     return value ? "true" : "false";
 }
 
+// Used when the display info can't be read.
+static const nsecs_t kDefaultFrameInterval = 16666667;
+
 struct FrameCallback {
+    // only one of the callbacks is set
     AChoreographer_frameCallback callback;
+    AChoreographer_frameInfoCallback infoCallback;
     void* data;
     nsecs_t dueTime;
 
@@ -51,6 +75,9 @@ class Choreographer : public DisplayEventDispatcher, public MessageHandler {
 public:
     void postFrameCallback(AChoreographer_frameCallback cb, void* data);
     void postFrameCallbackDelayed(AChoreographer_frameCallback cb, void* data, nsecs_t delay);
+    // all the callbacks are serviced by the same vsync dispatch
+    void postFrameInfoCallbacks(const AChoreographer_frameInfoCallback* cbs, void* const* data,
+            size_t count);
 
     enum {
         MSG_SCHEDULE_CALLBACKS = 0,
@@ -70,7 +97,15 @@ private:
     virtual void dispatchVsync(nsecs_t timestamp, int32_t id, uint32_t count);
     virtual void dispatchHotplug(nsecs_t timestamp, int32_t id, bool connected);
 
+    void postCallbacks(const FrameCallback* callbacks, size_t count, nsecs_t delay);
     void scheduleCallbacks();
+    void loadDisplayTimings();
+    AChoreographerFrameInfo getFrameInfo(nsecs_t timestamp) const;
+
+    // Timings of the main display, read by the looper thread only
+    nsecs_t mFrameInterval;
+    nsecs_t mAppVsyncOffset;
+    nsecs_t mPresentationDeadline;
 
     // Protected by mLock
     std::priority_queue<FrameCallback> mCallbacks;
@@ -96,12 +131,42 @@ Choreographer* Choreographer::getForThread() {
             ALOGW("Failed to initialize");
             return nullptr;
         }
+        gChoreographer->loadDisplayTimings();
     }
     return gChoreographer;
 }
 
 Choreographer::Choreographer(const sp<Looper>& looper) :
-    DisplayEventDispatcher(looper), mLooper(looper), mThreadId(std::this_thread::get_id()) {
+    DisplayEventDispatcher(looper), mFrameInterval(kDefaultFrameInterval), mAppVsyncOffset(0),
+    mPresentationDeadline(kDefaultFrameInterval), mLooper(looper),
+    mThreadId(std::this_thread::get_id()) {
+}
+
+void Choreographer::loadDisplayTimings() {
+    sp<IBinder> dtoken(SurfaceComposerClient::getBuiltInDisplay(
+            ISurfaceComposer::eDisplayIdMain));
+    DisplayInfo info;
+    if (dtoken == nullptr || SurfaceComposerClient::getDisplayInfo(dtoken, &info) != OK
+            || info.fps <= 0) {
+        ALOGW("choreographer %p ~ no display info, assuming 60 fps", this);
+        return;
+    }
+    mFrameInterval = nsecs_t(1000000000 / info.fps);
+    mAppVsyncOffset = info.appVsyncOffset;
+    mPresentationDeadline = info.presentationDeadline;
+}
+
+AChoreographerFrameInfo Choreographer::getFrameInfo(nsecs_t timestamp) const {
+    // The app vsync fires mAppVsyncOffset after the display vsync. The frame is composed on
+    // the next vsync and presented on the one after, provided it is queued at least
+    // mPresentationDeadline before that.
+    nsecs_t expectedPresentTime = timestamp - mAppVsyncOffset + 2 * mFrameInterval;
+    AChoreographerFrameInfo info;
+    info.frameTimeNanos = timestamp;
+    info.expectedPresentTimeNanos = expectedPresentTime;
+    info.deadlineNanos = expectedPresentTime - mPresentationDeadline;
+    info.frameIntervalNanos = mFrameInterval;
+    return info;
 }
 
 void Choreographer::postFrameCallback(AChoreographer_frameCallback cb, void* data) {
@@ -111,12 +176,31 @@ void Choreographer::postFrameCallback(AChoreographer_frameCallback cb, void* dat
 void Choreographer::postFrameCallbackDelayed(
         AChoreographer_frameCallback cb, void* data, nsecs_t delay) {
     nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
-    FrameCallback callback{cb, data, now + delay};
+    FrameCallback callback{cb, nullptr, data, now + delay};
+    postCallbacks(&callback, 1, delay);
+}
+
+void Choreographer::postFrameInfoCallbacks(
+        const AChoreographer_frameInfoCallback* cbs, void* const* data, size_t count) {
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    std::vector<FrameCallback> callbacks;
+    callbacks.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        callbacks.push_back(FrameCallback{nullptr, cbs[i], data != nullptr ? data[i] : nullptr,
+                now});
+    }
+    postCallbacks(callbacks.data(), callbacks.size(), 0);
+}
+
+void Choreographer::postCallbacks(
+        const FrameCallback* callbacks, size_t count, nsecs_t delay) {
     {
         AutoMutex _l{mLock};
-        mCallbacks.push(callback);
+        for (size_t i = 0; i < count; i++) {
+            mCallbacks.push(callbacks[i]);
+        }
     }
-    if (callback.dueTime <= now) {
+    if (delay <= 0) {
         if (std::this_thread::get_id() != mThreadId) {
             Message m{MSG_SCHEDULE_VSYNC};
             mLooper->sendMessage(this, m);
@@ -155,8 +239,16 @@ void Choreographer::dispatchVsync(nsecs_t timestamp, int32_t id, uint32_t) {
             mCallbacks.pop();
         }
     }
+    if (callbacks.empty()) {
+        return;
+    }
+    const AChoreographerFrameInfo info = getFrameInfo(timestamp);
     for (const auto& cb : callbacks) {
-        cb.callback(timestamp, cb.data);
+        if (cb.infoCallback != nullptr) {
+            cb.infoCallback(&info, cb.data);
+        } else {
+            cb.callback(timestamp, cb.data);
+        }
     }
 }
 
@@ -203,3 +295,25 @@ void AChoreographer_postFrameCallbackDelayed(AChoreographer* choreographer,
     AChoreographer_to_Choreographer(choreographer)->postFrameCallbackDelayed(
             callback, data, ms2ns(delayMillis));
 }
+
+/**
+ * Posts a callback run on the next frame with the frame's timeline, so the caller can pace its
+ * work against the deadline.
+ */
+void AChoreographer_postFrameInfoCallback(AChoreographer* choreographer,
+        AChoreographer_frameInfoCallback callback, void* data) {
+    AChoreographer_to_Choreographer(choreographer)->postFrameInfoCallbacks(&callback, &data, 1);
+}
+
+/**
+ * Posts count callbacks at once, each with its entry of data, which may be NULL. They are all
+ * run by the same dispatch on the next frame.
+ */
+void AChoreographer_postFrameInfoCallbacks(AChoreographer* choreographer,
+        const AChoreographer_frameInfoCallback* callbacks, void* const* data, size_t count) {
+    if (callbacks == nullptr || count == 0) {
+        return;
+    }
+    AChoreographer_to_Choreographer(choreographer)->postFrameInfoCallbacks(
+            callbacks, data, count);
+}
@@ -29,7 +29,12 @@
 #include <utils/Timers.h>
 #include <vndk/hardware_buffer.h>
 
+#include <errno.h>
 #include <poll.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
 
 using android::sp;
 using android::Sensor;
@@ -205,6 +210,195 @@ int ASensorManager_configureDirectReport(
 
 /*****************************************************************************/
 
+/*
+ * Consumer side of a shared memory direct channel.
+ *
+ * The sensor HAL writes the events of the channel round robin into the memory, each slot
+ * being a whole ASensorEvent whose reserved0 field holds an atomic counter that is written
+ * last: 1 for the first event of the channel, incremented for every event. Rather than
+ * reading the slots on a Looper callback per event batch, the reader wakes up once per batch
+ * period and hands out the new events as pointers into the ring, so the events are never
+ * copied and a high rate sensor costs one wake up per batch. The counter wrapping around
+ * after 2^32 events, months at the highest rates, isn't handled.
+ */
+typedef int (*ASensorDirectChannelReader_callbackFunc)(
+        const ASensorEvent* events, size_t count, void* data);
+
+struct ASensorDirectChannelReader {
+    ASensorEvent* ring;
+    size_t size;
+    size_t capacity;
+    // counter of the next event to deliver
+    uint32_t nextCounter;
+    uint64_t droppedCount;
+
+    // for looper driven consumption
+    ALooper* looper;
+    int timerFd;
+    ASensorDirectChannelReader_callbackFunc callback;
+    void* data;
+};
+
+static uint32_t loadCounter(const ASensorEvent* event) {
+    return __atomic_load_n(reinterpret_cast<const uint32_t*>(&event->reserved0),
+            __ATOMIC_ACQUIRE);
+}
+
+ASensorDirectChannelReader* ASensorDirectChannelReader_create(int fd, size_t size) {
+    if (fd < 0) {
+        ERROR_INVALID_PARAMETER("fd is invalid.");
+        return nullptr;
+    }
+    if (size < sizeof(ASensorEvent)) {
+        ERROR_INVALID_PARAMETER("size has to be greater or equal to sizeof(ASensorEvent).");
+        return nullptr;
+    }
+
+    void* ring = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (ring == MAP_FAILED) {
+        ALOGE("%s: mmap failed: %s", __func__, strerror(errno));
+        return nullptr;
+    }
+
+    ASensorDirectChannelReader* reader = new ASensorDirectChannelReader();
+    reader->ring = static_cast<ASensorEvent*>(ring);
+    reader->size = size;
+    reader->capacity = size / sizeof(ASensorEvent);
+    reader->timerFd = -1;
+
+    // only deliver what is written after the reader is created
+    uint32_t newest = 0;
+    for (size_t i = 0; i < reader->capacity; i++) {
+        uint32_t counter = loadCounter(&reader->ring[i]);
+        if (counter != 0 && int32_t(counter - newest) > 0) {
+            newest = counter;
+        }
+    }
+    reader->nextCounter = newest + 1;
+    return reader;
+}
+
+/*
+ * Calls the callback with the events written since the last call, at most twice when the
+ * new events wrap around the end of the ring. The events point into the shared memory and
+ * are only valid during the callback, until the writer laps the ring; size the memory for
+ * at least two batch periods. Returns the number of events delivered, or a negative error.
+ */
+ssize_t ASensorDirectChannelReader_consume(ASensorDirectChannelReader* reader,
+        ASensorDirectChannelReader_callbackFunc callback, void* data) {
+    if (reader == nullptr || callback == nullptr) {
+        ERROR_INVALID_PARAMETER("reader and callback cannot be NULL");
+        return android::BAD_VALUE;
+    }
+
+    size_t delivered = 0;
+    // don't chase a writer faster than the callbacks for ever
+    while (delivered < reader->capacity) {
+        size_t start = (reader->nextCounter - 1) % reader->capacity;
+        uint32_t counter = loadCounter(&reader->ring[start]);
+        if (int32_t(counter - reader->nextCounter) < 0) {
+            // an event of the previous lap, nothing new
+            break;
+        }
+        if (counter != reader->nextCounter) {
+            // the writer lapped the reader, resume from the oldest event still there
+            reader->droppedCount += counter - reader->nextCounter;
+            reader->nextCounter = counter;
+        }
+
+        size_t count = 1;
+        while (start + count < reader->capacity && delivered + count < reader->capacity
+                && loadCounter(&reader->ring[start + count]) == counter + count) {
+            count++;
+        }
+        reader->nextCounter = counter + count;
+        delivered += count;
+        if (callback(&reader->ring[start], count, data) == 0) {
+            break;
+        }
+    }
+    return delivered;
+}
+
+uint64_t ASensorDirectChannelReader_getDroppedCount(ASensorDirectChannelReader* reader) {
+    return reader != nullptr ? reader->droppedCount : 0;
+}
+
+static int onDirectChannelTimer(int fd, int /*events*/, void* data) {
+    ASensorDirectChannelReader* reader = static_cast<ASensorDirectChannelReader*>(data);
+    uint64_t expirations;
+    if (read(fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+        ALOGE("%s: failed to read the timer: %s", __func__, strerror(errno));
+    }
+    ASensorDirectChannelReader_consume(reader, reader->callback, reader->data);
+    return 1;
+}
+
+/*
+ * Consumes the channel on the looper every batchPeriodNs, matching the batch period to the
+ * sample rate (e.g. 20ms for 8 events at 400Hz) coalesces the wake ups.
+ */
+int ASensorDirectChannelReader_attachLooper(ASensorDirectChannelReader* reader, ALooper* looper,
+        int64_t batchPeriodNs, ASensorDirectChannelReader_callbackFunc callback, void* data) {
+    if (reader == nullptr || looper == nullptr || callback == nullptr) {
+        ERROR_INVALID_PARAMETER("reader, looper and callback cannot be NULL");
+        return android::BAD_VALUE;
+    }
+    if (batchPeriodNs <= 0) {
+        ERROR_INVALID_PARAMETER("batchPeriodNs has to be positive");
+        return android::BAD_VALUE;
+    }
+    if (reader->looper != nullptr) {
+        ERROR_INVALID_PARAMETER("reader is already attached to a looper");
+        return android::INVALID_OPERATION;
+    }
+
+    int timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timerFd < 0) {
+        return -errno;
+    }
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = batchPeriodNs / 1000000000;
+    spec.it_interval.tv_nsec = batchPeriodNs % 1000000000;
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime(timerFd, 0, &spec, nullptr) < 0) {
+        int err = -errno;
+        close(timerFd);
+        return err;
+    }
+
+    reader->looper = looper;
+    reader->timerFd = timerFd;
+    reader->callback = callback;
+    reader->data = data;
+    ALooper_addFd(looper, timerFd, ALOOPER_POLL_CALLBACK, ALOOPER_EVENT_INPUT,
+            onDirectChannelTimer, reader);
+    return 0;
+}
+
+void ASensorDirectChannelReader_detachLooper(ASensorDirectChannelReader* reader) {
+    if (reader == nullptr || reader->looper == nullptr) {
+        return;
+    }
+    ALooper_removeFd(reader->looper, reader->timerFd);
+    close(reader->timerFd);
+    reader->looper = nullptr;
+    reader->timerFd = -1;
+    reader->callback = nullptr;
+    reader->data = nullptr;
+}
+
+void ASensorDirectChannelReader_destroy(ASensorDirectChannelReader* reader) {
+    if (reader == nullptr) {
+        return;
+    }
+    ASensorDirectChannelReader_detachLooper(reader);
+    munmap(reader->ring, reader->size);
+    delete reader;
+}
+
+/*****************************************************************************/
+
 int ASensorEventQueue_registerSensor(ASensorEventQueue* queue, ASensor const* sensor,
         int32_t samplingPeriodUs, int64_t maxBatchReportLatencyUs) {
     RETURN_IF_QUEUE_IS_NULL(android::BAD_VALUE);
@@ -16,10 +16,18 @@
 
 #define LOG_TAG "PacProcessor"
 
+#include <utils/Condition.h>
 #include <utils/Log.h>
 #include <utils/Mutex.h>
+#include <utils/Timers.h>
 #include "android_runtime/AndroidRuntime.h"
 
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include "jni.h"
 #include <nativehelper/JNIHelp.h>
 
@@ -42,9 +50,96 @@ public:
     }
 };
 
-net::ProxyResolverV8* proxyResolver = NULL;
-ProxyErrorLogger* logger = NULL;
-bool pacSet = false;
+// The number of V8 contexts the script is loaded in, so that that many lookups can run at once
+static const size_t kNumResolvers = 4;
+// How long a result is reused for; scripts may resolve hosts, so results can't be kept forever
+static const nsecs_t kResultCacheTtl = s2ns(60);
+static const size_t kResultCacheSize = 256;
+
+/*
+ * The results of the lookups by (url, host), most recently used first. The key is the whole
+ * request, as scripts can match on the path as well as on the host.
+ */
+class ResultCache {
+public:
+    bool get(const std::string& key, nsecs_t now, String16* outResult) {
+        auto it = mEntries.find(key);
+        if (it == mEntries.end()) {
+            return false;
+        }
+        if (it->second->expiry <= now) {
+            mLru.erase(it->second);
+            mEntries.erase(it);
+            return false;
+        }
+        mLru.splice(mLru.begin(), mLru, it->second);
+        *outResult = it->second->result;
+        return true;
+    }
+
+    void put(const std::string& key, const String16& result, nsecs_t now) {
+        auto it = mEntries.find(key);
+        if (it != mEntries.end()) {
+            mLru.erase(it->second);
+            mEntries.erase(it);
+        } else if (mEntries.size() >= kResultCacheSize) {
+            mEntries.erase(mLru.back().key);
+            mLru.pop_back();
+        }
+        mLru.push_front(Entry{key, result, now + kResultCacheTtl});
+        mEntries[key] = mLru.begin();
+    }
+
+    void clear() {
+        mEntries.clear();
+        mLru.clear();
+    }
+
+private:
+    struct Entry {
+        std::string key;
+        String16 result;
+        nsecs_t expiry;
+    };
+    std::list<Entry> mLru;
+    std::unordered_map<std::string, std::list<Entry>::iterator> mEntries;
+};
+
+// Protects all of the below. Lookups only hold it to take a resolver and to use the cache,
+// so they run in parallel on the resolvers.
+static Mutex gLock;
+static Condition gResolverAvailable;
+static std::vector<net::ProxyResolverV8*> gResolvers;
+static std::vector<net::ProxyResolverV8*> gIdleResolvers;
+static ProxyErrorLogger* logger = NULL;
+static bool pacSet = false;
+static ResultCache gResultCache;
+
+// Takes an idle resolver, waiting for one if they are all busy. Returns NULL if the parser is
+// destroyed meanwhile.
+static net::ProxyResolverV8* acquireResolverLocked() {
+    while (gIdleResolvers.empty() && !gResolvers.empty()) {
+        gResolverAvailable.wait(gLock);
+    }
+    if (gIdleResolvers.empty()) {
+        return NULL;
+    }
+    net::ProxyResolverV8* resolver = gIdleResolvers.back();
+    gIdleResolvers.pop_back();
+    return resolver;
+}
+
+static void releaseResolverLocked(net::ProxyResolverV8* resolver) {
+    gIdleResolvers.push_back(resolver);
+    gResolverAvailable.broadcast();
+}
+
+// Waits for the lookups in progress to give their resolvers back.
+static void waitForIdleResolversLocked() {
+    while (gIdleResolvers.size() != gResolvers.size()) {
+        gResolverAvailable.wait(gLock);
+    }
+}
 
 String16 jstringToString16(JNIEnv* env, jstring jstr) {
     const jchar* str = env->GetStringCritical(jstr, 0);
@@ -63,11 +158,16 @@ jstring string16ToJstring(JNIEnv* env, String16 string) {
 
 static jboolean com_android_pacprocessor_PacNative_createV8ParserNativeLocked(JNIEnv* /* env */,
         jobject) {
-    if (proxyResolver == NULL) {
+    Mutex::Autolock _l(gLock);
+    if (gResolvers.empty()) {
         logger = new ProxyErrorLogger();
-        proxyResolver = new net::ProxyResolverV8(net::ProxyResolverJSBindings::CreateDefault(),
-                logger);
+        for (size_t i = 0; i < kNumResolvers; i++) {
+            gResolvers.push_back(new net::ProxyResolverV8(
+                    net::ProxyResolverJSBindings::CreateDefault(), logger));
+        }
+        gIdleResolvers = gResolvers;
         pacSet = false;
+        gResultCache.clear();
         return JNI_FALSE;
     }
     return JNI_TRUE;
@@ -75,11 +175,19 @@ static jboolean com_android_pacprocessor_PacNative_createV8ParserNativeLocked(JN
 
 static jboolean com_android_pacprocessor_PacNative_destroyV8ParserNativeLocked(JNIEnv* /* env */,
         jobject) {
-    if (proxyResolver != NULL) {
+    Mutex::Autolock _l(gLock);
+    if (!gResolvers.empty()) {
+        waitForIdleResolversLocked();
+        for (net::ProxyResolverV8* resolver : gResolvers) {
+            delete resolver;
+        }
+        gResolvers.clear();
+        gIdleResolvers.clear();
         delete logger;
-        delete proxyResolver;
         logger = NULL;
-        proxyResolver = NULL;
+        gResultCache.clear();
+        // wake up the lookups waiting for a resolver
+        gResolverAvailable.broadcast();
         return JNI_FALSE;
     }
     return JNI_TRUE;
@@ -89,14 +197,21 @@ static jboolean com_android_pacprocessor_PacNative_setProxyScriptNativeLocked(JN
         jstring script) {
     String16 script16 = jstringToString16(env, script);
 
-    if (proxyResolver == NULL) {
+    Mutex::Autolock _l(gLock);
+    if (gResolvers.empty()) {
         ALOGE("V8 Parser not started when setting PAC script");
         return JNI_TRUE;
     }
 
-    if (proxyResolver->SetPacScript(script16) != OK) {
-        ALOGE("Unable to set PAC script");
-        return JNI_TRUE;
+    // every context runs the same script
+    waitForIdleResolversLocked();
+    gResultCache.clear();
+    pacSet = false;
+    for (net::ProxyResolverV8* resolver : gResolvers) {
+        if (resolver->SetPacScript(script16) != OK) {
+            ALOGE("Unable to set PAC script");
+            return JNI_TRUE;
+        }
     }
     pacSet = true;
 
@@ -109,17 +224,45 @@ static jstring com_android_pacprocessor_PacNative_makeProxyRequestNativeLocked(J
     String16 host16 = jstringToString16(env, host);
     String16 ret;
 
-    if (proxyResolver == NULL) {
-        ALOGE("V8 Parser not initialized when running PAC script");
-        return NULL;
+    std::string key(String8(url16).string());
+    key += '\n';
+    key += String8(host16).string();
+
+    net::ProxyResolverV8* resolver;
+    {
+        Mutex::Autolock _l(gLock);
+        if (gResolvers.empty()) {
+            ALOGE("V8 Parser not initialized when running PAC script");
+            return NULL;
+        }
+
+        if (!pacSet) {
+            ALOGW("Attempting to run PAC with no script set");
+            return NULL;
+        }
+
+        if (gResultCache.get(key, systemTime(SYSTEM_TIME_MONOTONIC), &ret)) {
+            return string16ToJstring(env, ret);
+        }
+
+        resolver = acquireResolverLocked();
+        if (resolver == NULL) {
+            ALOGE("V8 Parser destroyed while running PAC script");
+            return NULL;
+        }
     }
 
-    if (!pacSet) {
-        ALOGW("Attempting to run PAC with no script set");
-        return NULL;
+    // the script runs without the lock, each resolver has a context of its own
+    bool success = resolver->GetProxyForURL(url16, host16, &ret) == OK;
+    {
+        Mutex::Autolock _l(gLock);
+        releaseResolverLocked(resolver);
+        if (success) {
+            gResultCache.put(key, ret, systemTime(SYSTEM_TIME_MONOTONIC));
+        }
     }
 
-    if (proxyResolver->GetProxyForURL(url16, host16, &ret) != OK) {
+    if (!success) {
         String8 ret8(ret);
         ALOGE("Error Running PAC: %s", ret8.string());
         return NULL;
@@ -24,6 +24,11 @@
 #include <utils/misc.h>
 #include <inttypes.h>
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 #include <android-base/macros.h>
 #include <androidfw/Asset.h>
 #include <androidfw/AssetManager2.h>
@@ -50,6 +55,34 @@ static constexpr bool kLogApi = false;
 
 using namespace android;
 
+static JavaVM* gJavaVM = nullptr;
+
+// The size of the elements of the Java array holding the data of an RS type, 0 if unknown.
+static size_t arrayTypeBytes(jint dataType) {
+    switch (dataType) {
+    case RS_TYPE_SIGNED_8:
+    case RS_TYPE_UNSIGNED_8:
+        return 1;
+    case RS_TYPE_SIGNED_16:
+    case RS_TYPE_UNSIGNED_16:
+    case RS_TYPE_FLOAT_16:
+        return 2;
+    case RS_TYPE_FLOAT_32:
+    case RS_TYPE_SIGNED_32:
+    case RS_TYPE_UNSIGNED_32:
+        return 4;
+    case RS_TYPE_FLOAT_64:
+    case RS_TYPE_SIGNED_64:
+    case RS_TYPE_UNSIGNED_64:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+// Without padding the RS call reads or writes the Java array in place, from a critical
+// region so the array isn't copied by the VM either. The RS calls are synchronous for
+// the caller and don't call back into Java, so the region is short and safe.
 #define PER_ARRAY_TYPE(flag, fnc, readonly, ...) {                                      \
     jint len = 0;                                                                       \
     void *ptr = nullptr;                                                                \
@@ -61,6 +94,18 @@ using namespace android;
         /* readonly = true, also indicates we are copying to the allocation   . */      \
         relFlag = JNI_ABORT;                                                            \
     }                                                                                   \
+    if (!usePadding && arrayTypeBytes(dataType) != 0) {                                 \
+        typeBytes = arrayTypeBytes(dataType);                                           \
+        len = _env->GetArrayLength((jarray)data);                                       \
+        ptr = _env->GetPrimitiveArrayCritical((jarray)data, flag);                      \
+        if (ptr == nullptr) {                                                           \
+            ALOGE("Failed to get Java array elements.");                                \
+            return;                                                                     \
+        }                                                                               \
+        fnc(__VA_ARGS__);                                                               \
+        _env->ReleasePrimitiveArrayCritical((jarray)data, ptr, relFlag);                \
+        return;                                                                         \
+    }                                                                                   \
     switch(dataType) {                                                                  \
     case RS_TYPE_FLOAT_32:                                                              \
         len = _env->GetArrayLength((jfloatArray)data);                                  \
@@ -1600,6 +1645,234 @@ nAllocationRead3D(JNIEnv *_env, jobject _this, jlong con, jlong _alloc, jint xof
                    (RsContext)con, alloc, xoff, yoff, zoff, lod, w, h, d, ptr, sizeBytes, 0);
 }
 
+// Returns the address of the direct ByteBuffer data, throwing if it isn't direct or is
+// smaller than sizeBytes.
+static void*
+getDirectBufferData(JNIEnv *_env, jobject data, jint sizeBytes)
+{
+    void *ptr = _env->GetDirectBufferAddress(data);
+    if (ptr == nullptr) {
+        jniThrowException(_env, "java/lang/IllegalArgumentException",
+                          "the ByteBuffer isn't direct");
+        return nullptr;
+    }
+    if (sizeBytes < 0 || _env->GetDirectBufferCapacity(data) < sizeBytes) {
+        jniThrowException(_env, "java/lang/IllegalArgumentException",
+                          "the ByteBuffer is too small");
+        return nullptr;
+    }
+    return ptr;
+}
+
+// Copies from the direct ByteBuffer data into the Allocation pointed to by _alloc.
+static void
+nAllocationData1DBuffer(JNIEnv *_env, jobject _this, jlong con, jlong _alloc, jint offset,
+                        jint lod, jint count, jobject data, jint sizeBytes)
+{
+    if (kLogApi) {
+        ALOGD("nAllocationData1DBuffer, con(%p), alloc(%p), offset(%i), count(%i), "
+              "sizeBytes(%i)", (RsContext)con, (RsAllocation)_alloc, offset, count, sizeBytes);
+    }
+    void *ptr = getDirectBufferData(_env, data, sizeBytes);
+    if (ptr != nullptr) {
+        rsAllocation1DData((RsContext)con, (RsAllocation)_alloc, offset, lod, count, ptr,
+                           sizeBytes);
+    }
+}
+
+// Copies from the direct ByteBuffer data into the Allocation pointed to by _alloc.
+static void
+nAllocationData2DBuffer(JNIEnv *_env, jobject _this, jlong con, jlong _alloc, jint xoff,
+                        jint yoff, jint lod, jint _face, jint w, jint h, jobject data,
+                        jint sizeBytes)
+{
+    if (kLogApi) {
+        ALOGD("nAllocationData2DBuffer, con(%p), alloc(%p), xoff(%i), yoff(%i), w(%i), h(%i), "
+              "sizeBytes(%i)", (RsContext)con, (RsAllocation)_alloc, xoff, yoff, w, h, sizeBytes);
+    }
+    void *ptr = getDirectBufferData(_env, data, sizeBytes);
+    if (ptr != nullptr) {
+        rsAllocation2DData((RsContext)con, (RsAllocation)_alloc, xoff, yoff, lod,
+                           (RsAllocationCubemapFace)_face, w, h, ptr, sizeBytes, 0);
+    }
+}
+
+// Copies from the Allocation pointed to by _alloc into the direct ByteBuffer data.
+static void
+nAllocationRead1DBuffer(JNIEnv *_env, jobject _this, jlong con, jlong _alloc, jint offset,
+                        jint lod, jint count, jobject data, jint sizeBytes)
+{
+    if (kLogApi) {
+        ALOGD("nAllocationRead1DBuffer, con(%p), alloc(%p), offset(%i), count(%i), "
+              "sizeBytes(%i)", (RsContext)con, (RsAllocation)_alloc, offset, count, sizeBytes);
+    }
+    void *ptr = getDirectBufferData(_env, data, sizeBytes);
+    if (ptr != nullptr) {
+        rsAllocation1DRead((RsContext)con, (RsAllocation)_alloc, offset, lod, count, ptr,
+                           sizeBytes);
+    }
+}
+
+// Copies from the Allocation pointed to by _alloc into the direct ByteBuffer data.
+static void
+nAllocationRead2DBuffer(JNIEnv *_env, jobject _this, jlong con, jlong _alloc, jint xoff,
+                        jint yoff, jint lod, jint _face, jint w, jint h, jobject data,
+                        jint sizeBytes)
+{
+    if (kLogApi) {
+        ALOGD("nAllocationRead2DBuffer, con(%p), alloc(%p), xoff(%i), yoff(%i), w(%i), h(%i), "
+              "sizeBytes(%i)", (RsContext)con, (RsAllocation)_alloc, xoff, yoff, w, h, sizeBytes);
+    }
+    void *ptr = getDirectBufferData(_env, data, sizeBytes);
+    if (ptr != nullptr) {
+        rsAllocation2DRead((RsContext)con, (RsAllocation)_alloc, xoff, yoff, lod,
+                           (RsAllocationCubemapFace)_face, w, h, ptr, sizeBytes, 0);
+    }
+}
+
+// Reads back allocations into direct ByteBuffers off the calling thread, then runs the
+// Runnable of the read on the reader thread. The Java methods calling into a context are
+// synchronized on the RenderScript object, the reader holds its monitor for the RS call
+// so it never races with them.
+class AsyncAllocationReader {
+public:
+    struct Read {
+        jobject rs;        // global refs
+        jobject buffer;
+        jobject callback;
+        RsContext con;
+        RsAllocation alloc;
+        bool is2D;
+        int xoff, yoff, lod, face, w, h;
+        void *ptr;
+        size_t sizeBytes;
+    };
+
+    static AsyncAllocationReader& getInstance() {
+        static AsyncAllocationReader* reader = new AsyncAllocationReader();
+        return *reader;
+    }
+
+    void post(const Read& read) {
+        std::lock_guard<std::mutex> lock(mLock);
+        mReads.push_back(read);
+        if (!mThreadStarted) {
+            mThreadStarted = true;
+            std::thread([this]() { run(); }).detach();
+        }
+        mCondition.notify_one();
+    }
+
+private:
+    void run() {
+        JNIEnv *env = nullptr;
+        JavaVMAttachArgs args = { JNI_VERSION_1_4, "RSAsyncRead", nullptr };
+        if (gJavaVM->AttachCurrentThread(&env, &args) != JNI_OK) {
+            ALOGE("Failed to attach the allocation reader thread");
+            return;
+        }
+        jclass runnableClass = env->FindClass("java/lang/Runnable");
+        jmethodID runMethod = env->GetMethodID(runnableClass, "run", "()V");
+        env->DeleteLocalRef(runnableClass);
+
+        std::unique_lock<std::mutex> lock(mLock);
+        while (true) {
+            mCondition.wait(lock, [this] { return !mReads.empty(); });
+            Read read = mReads.front();
+            mReads.pop_front();
+            lock.unlock();
+
+            env->MonitorEnter(read.rs);
+            if (read.is2D) {
+                rsAllocation2DRead(read.con, read.alloc, read.xoff, read.yoff, read.lod,
+                                   (RsAllocationCubemapFace)read.face, read.w, read.h,
+                                   read.ptr, read.sizeBytes, 0);
+            } else {
+                rsAllocation1DRead(read.con, read.alloc, read.xoff, read.lod, read.w,
+                                   read.ptr, read.sizeBytes);
+            }
+            env->MonitorExit(read.rs);
+
+            if (read.callback != nullptr) {
+                env->CallVoidMethod(read.callback, runMethod);
+                if (env->ExceptionCheck()) {
+                    ALOGE("Exception in the callback of an allocation read");
+                    env->ExceptionDescribe();
+                    env->ExceptionClear();
+                }
+                env->DeleteGlobalRef(read.callback);
+            }
+            env->DeleteGlobalRef(read.buffer);
+            env->DeleteGlobalRef(read.rs);
+            lock.lock();
+        }
+    }
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::deque<Read> mReads;
+    bool mThreadStarted = false;
+};
+
+static void
+postAllocationRead(JNIEnv *_env, jobject _this, AsyncAllocationReader::Read& read,
+                   jobject data, jint sizeBytes, jobject callback)
+{
+    read.ptr = getDirectBufferData(_env, data, sizeBytes);
+    if (read.ptr == nullptr) {
+        return;
+    }
+    read.sizeBytes = sizeBytes;
+    read.rs = _env->NewGlobalRef(_this);
+    read.buffer = _env->NewGlobalRef(data);
+    read.callback = callback != nullptr ? _env->NewGlobalRef(callback) : nullptr;
+    AsyncAllocationReader::getInstance().post(read);
+}
+
+// Copies from the Allocation pointed to by _alloc into the direct ByteBuffer data
+// asynchronously, callback is run once the data is there.
+static void
+nAllocationRead1DAsync(JNIEnv *_env, jobject _this, jlong con, jlong _alloc, jint offset,
+                       jint lod, jint count, jobject data, jint sizeBytes, jobject callback)
+{
+    if (kLogApi) {
+        ALOGD("nAllocationRead1DAsync, con(%p), alloc(%p), offset(%i), count(%i), "
+              "sizeBytes(%i)", (RsContext)con, (RsAllocation)_alloc, offset, count, sizeBytes);
+    }
+    AsyncAllocationReader::Read read = {};
+    read.con = (RsContext)con;
+    read.alloc = (RsAllocation)_alloc;
+    read.is2D = false;
+    read.xoff = offset;
+    read.lod = lod;
+    read.w = count;
+    postAllocationRead(_env, _this, read, data, sizeBytes, callback);
+}
+
+// Copies from the Allocation pointed to by _alloc into the direct ByteBuffer data
+// asynchronously, callback is run once the data is there.
+static void
+nAllocationRead2DAsync(JNIEnv *_env, jobject _this, jlong con, jlong _alloc, jint xoff,
+                       jint yoff, jint lod, jint _face, jint w, jint h, jobject data,
+                       jint sizeBytes, jobject callback)
+{
+    if (kLogApi) {
+        ALOGD("nAllocationRead2DAsync, con(%p), alloc(%p), xoff(%i), yoff(%i), w(%i), h(%i), "
+              "sizeBytes(%i)", (RsContext)con, (RsAllocation)_alloc, xoff, yoff, w, h, sizeBytes);
+    }
+    AsyncAllocationReader::Read read = {};
+    read.con = (RsContext)con;
+    read.alloc = (RsAllocation)_alloc;
+    read.is2D = true;
+    read.xoff = xoff;
+    read.yoff = yoff;
+    read.lod = lod;
+    read.face = _face;
+    read.w = w;
+    read.h = h;
+    postAllocationRead(_env, _this, read, data, sizeBytes, callback);
+}
+
 static jlong
 nAllocationGetType(JNIEnv *_env, jobject _this, jlong con, jlong a)
 {
@@ -2892,6 +3165,12 @@ static const JNINativeMethod methods[] = {
 {"rsnAllocationElementRead",         "(JJIIIII[BI)V",                         (void*)nAllocationElementRead },
 {"rsnAllocationRead2D",              "(JJIIIIIILjava/lang/Object;IIIZ)V",     (void*)nAllocationRead2D },
 {"rsnAllocationRead3D",              "(JJIIIIIIILjava/lang/Object;IIIZ)V",    (void*)nAllocationRead3D },
+{"rsnAllocationData1DBuffer",        "(JJIIILjava/nio/ByteBuffer;I)V",        (void*)nAllocationData1DBuffer },
+{"rsnAllocationData2DBuffer",        "(JJIIIIIILjava/nio/ByteBuffer;I)V",     (void*)nAllocationData2DBuffer },
+{"rsnAllocationRead1DBuffer",        "(JJIIILjava/nio/ByteBuffer;I)V",        (void*)nAllocationRead1DBuffer },
+{"rsnAllocationRead2DBuffer",        "(JJIIIIIILjava/nio/ByteBuffer;I)V",     (void*)nAllocationRead2DBuffer },
+{"rsnAllocationRead1DAsync",         "(JJIIILjava/nio/ByteBuffer;ILjava/lang/Runnable;)V",    (void*)nAllocationRead1DAsync },
+{"rsnAllocationRead2DAsync",         "(JJIIIIIILjava/nio/ByteBuffer;ILjava/lang/Runnable;)V", (void*)nAllocationRead2DAsync },
 {"rsnAllocationGetType",             "(JJ)J",                                 (void*)nAllocationGetType},
 {"rsnAllocationResize1D",            "(JJI)V",                                (void*)nAllocationResize1D },
 {"rsnAllocationGenerateMipmaps",     "(JJ)V",                                 (void*)nAllocationGenerateMipmaps },
@@ -2986,6 +3265,7 @@ jint JNI_OnLoad(JavaVM* vm, void* reserved)
         goto bail;
     }
     assert(env != nullptr);
+    gJavaVM = vm;
 
     if (registerFuncs(env) < 0) {
         ALOGE("ERROR: Renderscript native registration failed\n");
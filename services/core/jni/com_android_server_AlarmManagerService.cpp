@@ -18,6 +18,7 @@
 #define LOG_TAG "AlarmManagerService"
 
 #include <nativehelper/JNIHelp.h>
+#include <nativehelper/ScopedPrimitiveArray.h>
 #include "jni.h"
 #include <utils/Log.h>
 #include <utils/misc.h>
@@ -39,8 +40,10 @@
 #include <linux/ioctl.h>
 #include <linux/rtc.h>
 
+#include <algorithm>
 #include <array>
 #include <memory>
+#include <mutex>
 
 namespace android {
 
@@ -71,6 +74,40 @@ static const clockid_t android_alarm_to_clockid[N_ANDROID_TIMERFDS] = {
 
 typedef std::array<int, N_ANDROID_TIMERFDS> TimerFds;
 
+// The wakeup types, which setBatch() can fire from the same kernel timer
+static const int ANDROID_ALARM_RTC_WAKEUP = 0;
+static const int ANDROID_ALARM_ELAPSED_REALTIME_WAKEUP = 2;
+
+static const int64_t NSEC_PER_SEC = 1000000000LL;
+
+static int64_t timespec_to_ns(const struct timespec& ts)
+{
+    return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static struct timespec ns_to_timespec(int64_t ns)
+{
+    struct timespec ts;
+    ts.tv_sec = ns / NSEC_PER_SEC;
+    ts.tv_nsec = ns % NSEC_PER_SEC;
+    return ts;
+}
+
+/*
+ * Finds the earliest time both of the windows [start, start + slack] contain, so two alarms can
+ * be delivered by a single wakeup without either firing early or later than its slack allows.
+ */
+static bool coalesce_windows(int64_t start_a, int64_t slack_a, int64_t start_b, int64_t slack_b,
+        int64_t *out)
+{
+    const int64_t start = std::max(start_a, start_b);
+    if (start > std::min(start_a + slack_a, start_b + slack_b)) {
+        return false;
+    }
+    *out = start;
+    return true;
+}
+
 class AlarmImpl
 {
 public:
@@ -79,13 +116,26 @@ public:
     ~AlarmImpl();
 
     int set(int type, struct timespec *ts);
+    /* Sets the alarm types with a deadline >= 0, in ns of their clock, and fires the
+       RTC_WAKEUP and ELAPSED_REALTIME_WAKEUP alarms with one kernel timer when their
+       slacks overlap. */
+    int setBatch(const int64_t *deadlines, const int64_t *slacks);
     int setTime(struct timeval *tv);
     int waitForAlarm();
 
 private:
+    int setLocked(int type, struct timespec *ts);
+    int uncoalesceLocked();
+
     const TimerFds fds;
     const int epollfd;
     const int rtc_id;
+
+    std::mutex lock;
+    // While set, the RTC_WAKEUP alarm is disarmed and reported along with the
+    // ELAPSED_REALTIME_WAKEUP one, since that fires at a time within both their slacks.
+    bool rtc_wakeup_coalesced = false;
+    struct timespec rtc_wakeup_deadline;
 };
 
 AlarmImpl::~AlarmImpl()
@@ -99,6 +149,80 @@ AlarmImpl::~AlarmImpl()
 }
 
 int AlarmImpl::set(int type, struct timespec *ts)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if ((type == ANDROID_ALARM_RTC_WAKEUP || type == ANDROID_ALARM_ELAPSED_REALTIME_WAKEUP)
+            && uncoalesceLocked() < 0) {
+        return -1;
+    }
+    return setLocked(type, ts);
+}
+
+/* Arms the RTC_WAKEUP alarm again, since the kernel timer that fired it along with
+   ELAPSED_REALTIME_WAKEUP is about to be reprogrammed. */
+int AlarmImpl::uncoalesceLocked()
+{
+    if (!rtc_wakeup_coalesced) {
+        return 0;
+    }
+    rtc_wakeup_coalesced = false;
+    return setLocked(ANDROID_ALARM_RTC_WAKEUP, &rtc_wakeup_deadline);
+}
+
+int AlarmImpl::setBatch(const int64_t *deadlines, const int64_t *slacks)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    const int64_t rtc = deadlines[ANDROID_ALARM_RTC_WAKEUP];
+    const int64_t elapsed = deadlines[ANDROID_ALARM_ELAPSED_REALTIME_WAKEUP];
+    if (rtc < 0 || elapsed < 0) {
+        // the alarm left as it is may be the coalesced one
+        if (uncoalesceLocked() < 0) {
+            return -1;
+        }
+    }
+    rtc_wakeup_coalesced = false;
+
+    int64_t coalesced = -1;
+    if (rtc >= 0 && elapsed >= 0) {
+        // RTC deadlines move to the boot time base, the RTC to boot time offset only changes
+        // when the time is set, which cancels the TIME_CHANGE timerfd and has every alarm set again
+        struct timespec realtime, boottime;
+        clock_gettime(CLOCK_REALTIME, &realtime);
+        clock_gettime(CLOCK_BOOTTIME, &boottime);
+        const int64_t rtc_in_boottime =
+                rtc - (timespec_to_ns(realtime) - timespec_to_ns(boottime));
+        if (!coalesce_windows(rtc_in_boottime, slacks[ANDROID_ALARM_RTC_WAKEUP], elapsed,
+                slacks[ANDROID_ALARM_ELAPSED_REALTIME_WAKEUP], &coalesced)) {
+            coalesced = -1;
+        }
+    }
+
+    for (size_t type = 0; type < ANDROID_ALARM_TYPE_COUNT; type++) {
+        if (deadlines[type] < 0) {
+            continue;
+        }
+        struct timespec ts = ns_to_timespec(deadlines[type]);
+        int err;
+        if (coalesced >= 0 && type == ANDROID_ALARM_RTC_WAKEUP) {
+            struct itimerspec disarm;
+            memset(&disarm, 0, sizeof(disarm));
+            err = timerfd_settime(fds[type], TFD_TIMER_ABSTIME, &disarm, NULL);
+            rtc_wakeup_deadline = ts;
+        } else if (coalesced >= 0 && type == ANDROID_ALARM_ELAPSED_REALTIME_WAKEUP) {
+            ts = ns_to_timespec(coalesced);
+            err = setLocked(type, &ts);
+        } else {
+            err = setLocked(type, &ts);
+        }
+        if (err < 0) {
+            return err;
+        }
+    }
+    rtc_wakeup_coalesced = coalesced >= 0;
+    return 0;
+}
+
+int AlarmImpl::setLocked(int type, struct timespec *ts)
 {
     if (static_cast<size_t>(type) > ANDROID_ALARM_TYPE_COUNT) {
         errno = EINVAL;
@@ -194,6 +318,13 @@ int AlarmImpl::waitForAlarm()
         }
     }
 
+    if (result & (1 << ANDROID_ALARM_ELAPSED_REALTIME_WAKEUP)) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (rtc_wakeup_coalesced) {
+            rtc_wakeup_coalesced = false;
+            result |= (1 << ANDROID_ALARM_RTC_WAKEUP);
+        }
+    }
     return result;
 }
 
@@ -402,6 +533,29 @@ static jint android_server_AlarmManagerService_set(JNIEnv*, jobject, jlong nativ
     return result >= 0 ? 0 : errno;
 }
 
+static jint android_server_AlarmManagerService_setBatch(JNIEnv* env, jobject, jlong nativeData,
+        jlongArray deadlinesArray, jlongArray slacksArray)
+{
+    AlarmImpl *impl = reinterpret_cast<AlarmImpl *>(nativeData);
+    ScopedLongArrayRO deadlines(env, deadlinesArray);
+    ScopedLongArrayRO slacks(env, slacksArray);
+    if (deadlines.get() == NULL || slacks.get() == NULL
+            || deadlines.size() != ANDROID_ALARM_TYPE_COUNT
+            || slacks.size() != ANDROID_ALARM_TYPE_COUNT) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "deadlines and slacks must have one entry per alarm type");
+        return EINVAL;
+    }
+
+    const int result = impl->setBatch(reinterpret_cast<const int64_t *>(deadlines.get()),
+            reinterpret_cast<const int64_t *>(slacks.get()));
+    if (result < 0)
+    {
+        ALOGE("Unable to set alarms: %s\n", strerror(errno));
+    }
+    return result >= 0 ? 0 : errno;
+}
+
 static jint android_server_AlarmManagerService_waitForAlarm(JNIEnv*, jobject, jlong nativeData)
 {
     AlarmImpl *impl = reinterpret_cast<AlarmImpl *>(nativeData);
@@ -426,6 +580,7 @@ static const JNINativeMethod sMethods[] = {
     {"init", "()J", (void*)android_server_AlarmManagerService_init},
     {"close", "(J)V", (void*)android_server_AlarmManagerService_close},
     {"set", "(JIJJ)I", (void*)android_server_AlarmManagerService_set},
+    {"setBatch", "(J[J[J)I", (void*)android_server_AlarmManagerService_setBatch},
     {"waitForAlarm", "(J)I", (void*)android_server_AlarmManagerService_waitForAlarm},
     {"setKernelTime", "(JJ)I", (void*)android_server_AlarmManagerService_setKernelTime},
     {"setKernelTimezone", "(JI)I", (void*)android_server_AlarmManagerService_setKernelTimezone},
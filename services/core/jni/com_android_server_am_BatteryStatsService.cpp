@@ -28,6 +28,11 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include <android/hardware/power/1.0/IPower.h>
 #include <android/hardware/power/1.1/IPower.h>
 #include <android_runtime/AndroidRuntime.h>
@@ -56,8 +61,59 @@ namespace android
 {
 
 #define LAST_RESUME_REASON "/sys/kernel/wakeup_reasons/last_resume_reason"
+#define WAKEUP_SOURCES "/d/wakeup_sources"
 #define MAX_REASON_SIZE 512
 
+/*
+ * A kernel stats file kept open across reads. Each read is a pread from the start into a buffer
+ * that is reused, so a read costs neither an open nor any allocation once the buffer has grown
+ * to the size of the file. sysfs and debugfs regenerate the contents on a read at offset 0.
+ */
+class KernelStatsFile {
+public:
+    explicit KernelStatsFile(const char* path) : mPath(path), mFd(-1), mBuffer(4096) {}
+
+    // Returns the NUL terminated contents, which the caller may modify, or NULL on error.
+    char* read(size_t* outLength) {
+        if (mFd < 0) {
+            mFd = open(mPath, O_RDONLY | O_CLOEXEC);
+            if (mFd < 0) {
+                ALOGE("Failed to open %s: %s", mPath, strerror(errno));
+                return NULL;
+            }
+        }
+        size_t length = 0;
+        while (true) {
+            if (length + 1 >= mBuffer.size()) {
+                mBuffer.resize(mBuffer.size() * 2);
+            }
+            ssize_t count = TEMP_FAILURE_RETRY(pread(mFd, mBuffer.data() + length,
+                    mBuffer.size() - length - 1, length));
+            if (count < 0) {
+                ALOGE("Failed to read %s: %s", mPath, strerror(errno));
+                // reopened on the next read, in case the file was replaced
+                close(mFd);
+                mFd = -1;
+                return NULL;
+            }
+            if (count == 0) {
+                break;
+            }
+            length += count;
+        }
+        mBuffer[length] = 0;
+        *outLength = length;
+        return mBuffer.data();
+    }
+
+private:
+    const char* const mPath;
+    int mFd;
+    std::vector<char> mBuffer;
+};
+
+static KernelStatsFile gLastResumeReason(LAST_RESUME_REASON);
+
 static bool wakeup_init = false;
 static sem_t wakeup_sem;
 extern sp<IPowerV1_0> getPowerHalV1_0();
@@ -115,9 +171,9 @@ static jint nativeWaitWakeup(JNIEnv *env, jobject clazz, jobject outBuf)
         return 0;
     }
 
-    FILE *fp = fopen(LAST_RESUME_REASON, "r");
-    if (fp == NULL) {
-        ALOGE("Failed to open %s", LAST_RESUME_REASON);
+    size_t reasonslen;
+    char* reasons = gLastResumeReason.read(&reasonslen);
+    if (reasons == NULL) {
         return -1;
     }
 
@@ -126,9 +182,15 @@ static jint nativeWaitWakeup(JNIEnv *env, jobject clazz, jobject outBuf)
 
     ALOGV("Reading wakeup reasons");
     char* mergedreasonpos = mergedreason;
-    char reasonline[128];
     int i = 0;
-    while (fgets(reasonline, sizeof(reasonline), fp) != NULL) {
+    for (char* reasonline = reasons; *reasonline != 0;) {
+        // Terminate the line in place, the buffer is ours until the next read.
+        char* nextline = strchr(reasonline, '\n');
+        if (nextline != NULL) {
+            *nextline++ = 0;
+        } else {
+            nextline = reasonline + strlen(reasonline);
+        }
         char* pos = reasonline;
         char* endPos;
         int len;
@@ -143,6 +205,7 @@ static jint nativeWaitWakeup(JNIEnv *env, jobject clazz, jobject outBuf)
             if (strncmp(pos, "Abort:", abortPrefixLen) != 0) {
                 // Ooops.
                 ALOGE("Bad reason line: %s", reasonline);
+                reasonline = nextline;
                 continue;
             }
 
@@ -162,34 +225,121 @@ static jint nativeWaitWakeup(JNIEnv *env, jobject clazz, jobject outBuf)
             pos++;
         }
 
-        // Chop newline at end.
-        char* endpos = pos;
-        while (*endpos != 0) {
-            if (*endpos == '\n') {
-                *endpos = 0;
-                break;
-            }
-            endpos++;
-        }
-
         len = snprintf(mergedreasonpos, remainreasonlen, ":%s", pos);
         if (len >= 0 && len < remainreasonlen) {
             mergedreasonpos += len;
             remainreasonlen -= len;
         }
         i++;
+        reasonline = nextline;
     }
 
     ALOGV("Got %d reasons", i);
     if (i > 0) {
         *mergedreasonpos = 0;
     }
+    return mergedreasonpos - mergedreason;
+}
+
+static std::mutex gWakeupSourcesLock;
+static KernelStatsFile gWakeupSources(WAKEUP_SOURCES);
+
+struct WakeupSourceStats {
+    int32_t activeCount;
+    int64_t totalTimeMs;
+};
+
+// The stats last reported for each wakeup source.
+static std::unordered_map<std::string, WakeupSourceStats> gReportedWakeupSources;
+
+/*
+ * Writes the kernel wakelocks whose active count or total time changed since the last call, or
+ * all of them, to outBuf as records of an int name length, the UTF-8 name, an int active count
+ * and a long total time in ms, in native byte order. Returns the number of records, or -1 if
+ * the wakeup sources can't be read. The wakelocks that don't fit are reported by the next call.
+ */
+static jint nativeReadKernelWakelocks(JNIEnv* env, jobject clazz, jobject outBuf, jboolean all)
+{
+    char* out = outBuf != NULL ? (char*)env->GetDirectBufferAddress(outBuf) : NULL;
+    if (out == NULL) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "outBuf must be a direct buffer");
+        return -1;
+    }
+    const size_t capacity = env->GetDirectBufferCapacity(outBuf);
 
-    if (fclose(fp) != 0) {
-        ALOGE("Failed to close %s", LAST_RESUME_REASON);
+    std::lock_guard<std::mutex> lock(gWakeupSourcesLock);
+    size_t length;
+    char* sources = gWakeupSources.read(&length);
+    if (sources == NULL) {
         return -1;
     }
-    return mergedreasonpos - mergedreason;
+
+    // The first line names the columns: name, active_count, event_count, wakeup_count,
+    // expire_count, active_since, total_time, max_time, last_change and prevent_suspend_time.
+    char* line = strchr(sources, '\n');
+    size_t used = 0;
+    jint records = 0;
+    while (line != NULL && *++line != 0) {
+        char* name = line;
+        // Terminate the line in place, so the columns are only parsed up to its end.
+        line = strchr(line, '\n');
+        if (line != NULL) {
+            *line = 0;
+        }
+        char* pos = strchr(name, '\t');
+        if (pos == NULL || pos == name) {
+            continue;
+        }
+        const size_t nameLength = pos - name;
+        int64_t columns[6];
+        size_t column = 0;
+        for (; column < 6; column++) {
+            char* end;
+            columns[column] = strtoll(pos, &end, 10);
+            if (end == pos) {
+                break;
+            }
+            pos = end;
+        }
+        if (column < 6) {
+            ALOGW("Bad wakeup source line: %.*s", (int)nameLength, name);
+            continue;
+        }
+
+        WakeupSourceStats stats = { (int32_t)columns[0], columns[5] };
+        std::string key(name, nameLength);
+        auto reported = gReportedWakeupSources.find(key);
+        if (!all && reported != gReportedWakeupSources.end()
+                && reported->second.activeCount == stats.activeCount
+                && reported->second.totalTimeMs == stats.totalTimeMs) {
+            continue;
+        }
+
+        const int32_t nameLength32 = nameLength;
+        const size_t recordSize = sizeof(nameLength32) + nameLength + sizeof(stats.activeCount)
+                + sizeof(stats.totalTimeMs);
+        if (used + recordSize > capacity) {
+            // not remembered as reported, so it's written by the next call
+            continue;
+        }
+        memcpy(out + used, &nameLength32, sizeof(nameLength32));
+        used += sizeof(nameLength32);
+        memcpy(out + used, name, nameLength);
+        used += nameLength;
+        memcpy(out + used, &stats.activeCount, sizeof(stats.activeCount));
+        used += sizeof(stats.activeCount);
+        memcpy(out + used, &stats.totalTimeMs, sizeof(stats.totalTimeMs));
+        used += sizeof(stats.totalTimeMs);
+        records++;
+
+        if (reported != gReportedWakeupSources.end()) {
+            reported->second = stats;
+        } else {
+            gReportedWakeupSources.emplace(std::move(key), stats);
+        }
+    }
+    return records;
 }
 
 static void getLowPowerStats(JNIEnv* env, jobject /* clazz */, jobject jrpmStats) {
@@ -450,6 +600,8 @@ static jint getSubsystemLowPowerStats(JNIEnv* env, jobject /* clazz */, jobject
 
 static const JNINativeMethod method_table[] = {
     { "nativeWaitWakeup", "(Ljava/nio/ByteBuffer;)I", (void*)nativeWaitWakeup },
+    { "nativeReadKernelWakelocks", "(Ljava/nio/ByteBuffer;Z)I",
+            (void*)nativeReadKernelWakelocks },
     { "getLowPowerStats", "(Lcom/android/internal/os/RpmStats;)V", (void*)getLowPowerStats },
     { "getPlatformLowPowerStats", "(Ljava/nio/ByteBuffer;)I", (void*)getPlatformLowPowerStats },
     { "getSubsystemLowPowerStats", "(Ljava/nio/ByteBuffer;)I", (void*)getSubsystemLowPowerStats },
@@ -225,6 +225,8 @@ public:
     status_t unregisterInputChannel(JNIEnv* env, const sp<InputChannel>& inputChannel);
 
     void setInputWindows(JNIEnv* env, jobjectArray windowHandleObjArray);
+    void updateInputWindows(JNIEnv* env, jobjectArray changedHandleObjArray,
+            jbyteArray bufferArray);
     void setFocusedApplication(JNIEnv* env, jobject applicationHandleObj);
     void setInputDispatchMode(bool enabled, bool frozen);
     void setSystemUiVisibility(int32_t visibility);
@@ -326,6 +328,12 @@ private:
 
     std::atomic<bool> mInteractive;
 
+    // The windows last given to the dispatcher, which an update buffer refers to by index.
+    // Only used by the window manager thread setting the windows.
+    Vector<sp<InputWindowHandle> > mWindowHandles;
+
+    void applyInputWindows(const Vector<sp<InputWindowHandle> >& windowHandles);
+
     void updateInactivityTimeoutLocked(const sp<PointerController>& controller);
     void handleInterceptActions(jint wmActions, nsecs_t when, uint32_t& policyFlags);
     void ensureSpriteControllerLocked();
@@ -767,16 +775,108 @@ void NativeInputManager::setInputWindows(JNIEnv* env, jobjectArray windowHandleO
                 break; // found null element indicating end of used portion of the array
             }
 
-            sp<InputWindowHandle> windowHandle =
+            sp<NativeInputWindowHandle> windowHandle =
                     android_server_InputWindowHandle_getHandle(env, windowHandleObj);
             if (windowHandle != NULL) {
+                windowHandle->setInfoCached(false);
                 windowHandles.push(windowHandle);
             }
             env->DeleteLocalRef(windowHandleObj);
         }
     }
 
+    applyInputWindows(windowHandles);
+}
+
+static bool readUpdateInt(const uint8_t** pos, const uint8_t* end, int32_t* outValue) {
+    if (end - *pos < (ptrdiff_t) sizeof(int32_t)) {
+        return false;
+    }
+    memcpy(outValue, *pos, sizeof(int32_t));
+    *pos += sizeof(int32_t);
+    return true;
+}
+
+/*
+ * Updates the windows from a buffer holding only the windows which changed since the last
+ * update, so the fields of the other windows aren't read again. The buffer holds, in native
+ * byte order:
+ *   int32 windowCount, int32 changedCount,
+ *   windowCount int32 entries, in the order of the new windows. An entry n >= 0 is the window
+ *     at index n of the previous windows, an entry ~k is the handle at index k of
+ *     changedHandleObjArray,
+ *   changedCount window records, in the order of changedHandleObjArray, see
+ *     NativeInputWindowHandle::setPendingInfoFromRecord().
+ */
+void NativeInputManager::updateInputWindows(JNIEnv* env, jobjectArray changedHandleObjArray,
+        jbyteArray bufferArray) {
+    ScopedByteArrayRO buffer(env, bufferArray);
+    if (buffer.get() == NULL) {
+        return;
+    }
+    const uint8_t* pos = reinterpret_cast<const uint8_t*>(buffer.get());
+    const uint8_t* end = pos + buffer.size();
+
+    int32_t windowCount, changedCount;
+    jsize changedHandleCount = changedHandleObjArray ?
+            env->GetArrayLength(changedHandleObjArray) : 0;
+    if (!readUpdateInt(&pos, end, &windowCount) || !readUpdateInt(&pos, end, &changedCount)
+            || windowCount < 0 || changedCount < 0 || changedCount > changedHandleCount
+            || (end - pos) / (ptrdiff_t) sizeof(int32_t) < windowCount) {
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "Invalid input window update header");
+        return;
+    }
+    const uint8_t* order = pos;
+    pos += windowCount * sizeof(int32_t);
+
+    Vector<sp<NativeInputWindowHandle> > changedHandles;
+    changedHandles.setCapacity(changedCount);
+    bool valid = true;
+    for (int32_t i = 0; i < changedCount && valid; i++) {
+        ScopedLocalRef<jobject> windowHandleObj(env,
+                env->GetObjectArrayElement(changedHandleObjArray, i));
+        sp<NativeInputWindowHandle> windowHandle =
+                android_server_InputWindowHandle_getHandle(env, windowHandleObj.get());
+        if (windowHandle == NULL) {
+            valid = false;
+            break;
+        }
+        valid = windowHandle->setPendingInfoFromRecord(env, windowHandleObj.get(), &pos, end);
+        changedHandles.push(windowHandle);
+    }
+
+    Vector<sp<InputWindowHandle> > windowHandles;
+    windowHandles.setCapacity(windowCount);
+    for (int32_t i = 0; i < windowCount && valid; i++) {
+        int32_t index;
+        readUpdateInt(&order, end, &index);
+        if (index >= 0 && size_t(index) < mWindowHandles.size()) {
+            const sp<InputWindowHandle>& windowHandle = mWindowHandles.itemAt(index);
+            static_cast<NativeInputWindowHandle*>(windowHandle.get())->setInfoCached(true);
+            windowHandles.push(windowHandle);
+        } else if (index < 0 && ~index < changedCount) {
+            changedHandles.itemAt(~index)->setInfoCached(true);
+            windowHandles.push(changedHandles.itemAt(~index));
+        } else {
+            valid = false;
+        }
+    }
+
+    if (!valid) {
+        for (size_t i = 0; i < changedHandles.size(); i++) {
+            changedHandles.itemAt(i)->discardPendingInfo();
+        }
+        jniThrowException(env, "java/lang/IllegalArgumentException",
+                "Invalid input window update");
+        return;
+    }
+    applyInputWindows(windowHandles);
+}
+
+void NativeInputManager::applyInputWindows(const Vector<sp<InputWindowHandle> >& windowHandles) {
     mInputManager->getDispatcher()->setInputWindows(windowHandles);
+    mWindowHandles = windowHandles;
 
     // Do this after the dispatcher has updated the window handle state.
     bool newPointerGesturesEnabled = true;
@@ -1488,6 +1588,13 @@ static void nativeSetInputWindows(JNIEnv* env, jclass /* clazz */,
     im->setInputWindows(env, windowHandleObjArray);
 }
 
+static void nativeUpdateInputWindows(JNIEnv* env, jclass /* clazz */,
+        jlong ptr, jobjectArray changedHandleObjArray, jbyteArray buffer) {
+    NativeInputManager* im = reinterpret_cast<NativeInputManager*>(ptr);
+
+    im->updateInputWindows(env, changedHandleObjArray, buffer);
+}
+
 static void nativeSetFocusedApplication(JNIEnv* env, jclass /* clazz */,
         jlong ptr, jobject applicationHandleObj) {
     NativeInputManager* im = reinterpret_cast<NativeInputManager*>(ptr);
@@ -1730,6 +1837,8 @@ static const JNINativeMethod gInputManagerMethods[] = {
             (void*) nativeToggleCapsLock },
     { "nativeSetInputWindows", "(J[Lcom/android/server/input/InputWindowHandle;)V",
             (void*) nativeSetInputWindows },
+    { "nativeUpdateInputWindows", "(J[Lcom/android/server/input/InputWindowHandle;[B)V",
+            (void*) nativeUpdateInputWindows },
     { "nativeSetFocusedApplication", "(JLcom/android/server/input/InputApplicationHandle;)V",
             (void*) nativeSetFocusedApplication },
     { "nativeSetPointerCapture", "(JZ)V",
@@ -20,6 +20,7 @@
 #include "jni.h"
 #include <android_runtime/AndroidRuntime.h>
 #include <utils/threads.h>
+#include <string.h>
 
 #include <android_view_InputChannel.h>
 #include <android/graphics/Region.h>
@@ -58,13 +59,54 @@ static struct {
 
 static Mutex gHandleMutex;
 
+// Flags of a window record, must match InputWindowHandle.java
+enum {
+    RECORD_FLAG_CHANNEL_CHANGED = 1 << 0,
+    RECORD_FLAG_NAME_CHANGED = 1 << 1,
+};
+
+// Booleans of a window record, must match InputWindowHandle.java
+enum {
+    RECORD_STATE_VISIBLE = 1 << 0,
+    RECORD_STATE_CAN_RECEIVE_KEYS = 1 << 1,
+    RECORD_STATE_HAS_FOCUS = 1 << 2,
+    RECORD_STATE_HAS_WALLPAPER = 1 << 3,
+    RECORD_STATE_PAUSED = 1 << 4,
+};
+
+// Reads the native endian values of a window record, which are not necessarily aligned.
+class RecordReader {
+public:
+    RecordReader(const uint8_t* pos, const uint8_t* end) : mPos(pos), mEnd(end), mError(false) {}
+
+    template <typename T>
+    T read() {
+        T value = T();
+        if (mEnd - mPos < (ptrdiff_t) sizeof(T)) {
+            mError = true;
+        } else {
+            memcpy(&value, mPos, sizeof(T));
+            mPos += sizeof(T);
+        }
+        return value;
+    }
+
+    const uint8_t* pos() const { return mPos; }
+    bool error() const { return mError; }
+
+private:
+    const uint8_t* mPos;
+    const uint8_t* mEnd;
+    bool mError;
+};
+
 
 // --- NativeInputWindowHandle ---
 
 NativeInputWindowHandle::NativeInputWindowHandle(
         const sp<InputApplicationHandle>& inputApplicationHandle, jweak objWeak) :
         InputWindowHandle(inputApplicationHandle),
-        mObjWeak(objWeak) {
+        mObjWeak(objWeak), mInfoCached(false), mHasPendingInfo(false) {
 }
 
 NativeInputWindowHandle::~NativeInputWindowHandle() {
@@ -76,40 +118,65 @@ jobject NativeInputWindowHandle::getInputWindowHandleObjLocalRef(JNIEnv* env) {
     return env->NewLocalRef(mObjWeak);
 }
 
-bool NativeInputWindowHandle::updateInfo() {
-    JNIEnv* env = AndroidRuntime::getJNIEnv();
-    jobject obj = env->NewLocalRef(mObjWeak);
-    if (!obj) {
-        releaseInfo();
-        return false;
-    }
-
-    if (!mInfo) {
-        mInfo = new InputWindowInfo();
-    } else {
-        mInfo->touchableRegion.clear();
-    }
-
+void NativeInputWindowHandle::readChannelAndName(JNIEnv* env, jobject obj,
+        InputWindowInfo* info) {
     jobject inputChannelObj = env->GetObjectField(obj,
             gInputWindowHandleClassInfo.inputChannel);
     if (inputChannelObj) {
-        mInfo->inputChannel = android_view_InputChannel_getInputChannel(env, inputChannelObj);
+        info->inputChannel = android_view_InputChannel_getInputChannel(env, inputChannelObj);
         env->DeleteLocalRef(inputChannelObj);
     } else {
-        mInfo->inputChannel.clear();
+        info->inputChannel.clear();
     }
 
     jstring nameObj = jstring(env->GetObjectField(obj,
             gInputWindowHandleClassInfo.name));
     if (nameObj) {
         const char* nameStr = env->GetStringUTFChars(nameObj, NULL);
-        mInfo->name = nameStr;
+        info->name = nameStr;
         env->ReleaseStringUTFChars(nameObj, nameStr);
         env->DeleteLocalRef(nameObj);
     } else {
-        mInfo->name = "<null>";
+        info->name = "<null>";
+    }
+}
+
+bool NativeInputWindowHandle::updateInfo() {
+    JNIEnv* env = AndroidRuntime::getJNIEnv();
+    if (mHasPendingInfo) {
+        mHasPendingInfo = false;
+        if (env->IsSameObject(mObjWeak, NULL)) {
+            releaseInfo();
+            return false;
+        }
+        if (!mInfo) {
+            mInfo = new InputWindowInfo();
+        }
+        *mInfo = mPendingInfo;
+        return true;
+    }
+    if (mInfoCached && mInfo) {
+        if (env->IsSameObject(mObjWeak, NULL)) {
+            releaseInfo();
+            return false;
+        }
+        return true;
+    }
+
+    jobject obj = env->NewLocalRef(mObjWeak);
+    if (!obj) {
+        releaseInfo();
+        return false;
+    }
+
+    if (!mInfo) {
+        mInfo = new InputWindowInfo();
+    } else {
+        mInfo->touchableRegion.clear();
     }
 
+    readChannelAndName(env, obj, mInfo);
+
     mInfo->layoutParamsFlags = env->GetIntField(obj,
             gInputWindowHandleClassInfo.layoutParamsFlags);
     mInfo->layoutParamsType = env->GetIntField(obj,
@@ -163,6 +230,72 @@ bool NativeInputWindowHandle::updateInfo() {
     return true;
 }
 
+/*
+ * A window record holds, in native byte order:
+ *   int32 flags, int32 layoutParamsFlags, int32 layoutParamsType,
+ *   int64 dispatchingTimeoutNanos, int32 frameLeft, frameTop, frameRight, frameBottom,
+ *   float scaleFactor, int32 state, int32 layer, ownerPid, ownerUid, inputFeatures, displayId,
+ *   int32 touchableRectCount followed by left, top, right, bottom int32 for each rect.
+ */
+bool NativeInputWindowHandle::setPendingInfoFromRecord(JNIEnv* env, jobject obj,
+        const uint8_t** pos, const uint8_t* end) {
+    RecordReader reader(*pos, end);
+    int32_t flags = reader.read<int32_t>();
+
+    // The dispatcher may be using mInfo, it is only read here and replaced in updateInfo()
+    InputWindowInfo* info = &mPendingInfo;
+    if (mInfo && !(flags & (RECORD_FLAG_CHANNEL_CHANGED | RECORD_FLAG_NAME_CHANGED))) {
+        info->inputChannel = mInfo->inputChannel;
+        info->name = mInfo->name;
+    } else {
+        readChannelAndName(env, obj, info);
+    }
+    info->touchableRegion.clear();
+
+    info->layoutParamsFlags = reader.read<int32_t>();
+    info->layoutParamsType = reader.read<int32_t>();
+    info->dispatchingTimeout = reader.read<int64_t>();
+    info->frameLeft = reader.read<int32_t>();
+    info->frameTop = reader.read<int32_t>();
+    info->frameRight = reader.read<int32_t>();
+    info->frameBottom = reader.read<int32_t>();
+    info->scaleFactor = reader.read<float>();
+    int32_t state = reader.read<int32_t>();
+    info->visible = state & RECORD_STATE_VISIBLE;
+    info->canReceiveKeys = state & RECORD_STATE_CAN_RECEIVE_KEYS;
+    info->hasFocus = state & RECORD_STATE_HAS_FOCUS;
+    info->hasWallpaper = state & RECORD_STATE_HAS_WALLPAPER;
+    info->paused = state & RECORD_STATE_PAUSED;
+    info->layer = reader.read<int32_t>();
+    info->ownerPid = reader.read<int32_t>();
+    info->ownerUid = reader.read<int32_t>();
+    info->inputFeatures = reader.read<int32_t>();
+    info->displayId = reader.read<int32_t>();
+
+    int32_t rectCount = reader.read<int32_t>();
+    if (rectCount < 0 || (end - reader.pos()) / (4 * (ptrdiff_t) sizeof(int32_t)) < rectCount) {
+        ALOGE("Invalid touchable rect count %d in the record of %s", rectCount,
+                info->name.c_str());
+        mHasPendingInfo = false;
+        return false;
+    }
+    for (int32_t i = 0; i < rectCount; i++) {
+        int32_t left = reader.read<int32_t>();
+        int32_t top = reader.read<int32_t>();
+        int32_t right = reader.read<int32_t>();
+        int32_t bottom = reader.read<int32_t>();
+        info->addTouchableRegion(Rect(left, top, right, bottom));
+    }
+    if (reader.error()) {
+        ALOGE("Truncated window record of %s", info->name.c_str());
+        mHasPendingInfo = false;
+        return false;
+    }
+    mHasPendingInfo = true;
+    *pos = reader.pos();
+    return true;
+}
+
 
 // --- Global functions ---
 
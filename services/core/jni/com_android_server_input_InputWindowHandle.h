@@ -34,8 +34,26 @@ public:
 
     virtual bool updateInfo();
 
+    /* Decodes the next window record of an input window update buffer into the pending info,
+     * which updateInfo() applies once the dispatcher takes the new windows. The channel and
+     * name are only read from the object when the record flags them as changed.
+     * Advances pos past the record, returns false if the record is malformed. */
+    bool setPendingInfoFromRecord(JNIEnv* env, jobject obj, const uint8_t** pos,
+            const uint8_t* end);
+
+    void discardPendingInfo() { mHasPendingInfo = false; }
+
+    /* While set, updateInfo() keeps the current info rather than reading every field of the
+     * object again, for windows which the window manager reports as unchanged. */
+    void setInfoCached(bool cached) { mInfoCached = cached; }
+
 private:
     jweak mObjWeak;
+    bool mInfoCached;
+    bool mHasPendingInfo;
+    InputWindowInfo mPendingInfo;
+
+    static void readChannelAndName(JNIEnv* env, jobject obj, InputWindowInfo* info);
 };
 
 
@@ -39,6 +39,7 @@
 #include <string.h>
 #include <cinttypes>
 #include <iomanip>
+#include <vector>
 
 static jobject mCallbacksObj = NULL;
 
@@ -64,6 +65,9 @@ static jmethodID method_reportGeofencePauseStatus;
 static jmethodID method_reportGeofenceResumeStatus;
 static jmethodID method_reportMeasurementData;
 static jmethodID method_reportNavigationMessages;
+// Optional, the measurements and navigation messages are marshalled into objects without them
+static jmethodID method_reportPackedMeasurementData;
+static jmethodID method_reportPackedNavigationMessage;
 static jmethodID method_reportLocationBatch;
 static jmethodID method_reportGnssServiceDied;
 
@@ -696,6 +700,72 @@ Return<void> GnssGeofenceCallback::gnssGeofenceResumeCb(int32_t geofenceId,
     return Void();
 }
 
+/*
+ * The packed formats of the measurements and navigation messages, passed to Java as a byte[] in
+ * native byte order when it implements the reportPacked* upcalls, which saves a JNI call per
+ * field. The layouts are fixed, keep them in sync with the decoder in GnssLocationProvider.
+ * The flags tell which of the optional fields are valid, like the HAL's.
+ */
+static const int32_t kPackedGnssVersion = 1;
+
+struct PackedGnssClock {
+    int64_t timeNs;
+    int64_t fullBiasNs;
+    double timeUncertaintyNs;
+    double biasNs;
+    double biasUncertaintyNs;
+    double driftNsps;
+    double driftUncertaintyNsps;
+    int32_t flags;
+    int32_t leapSecond;
+    int32_t hwClockDiscontinuityCount;
+    int32_t reserved;
+};
+static_assert(sizeof(PackedGnssClock) == 72, "PackedGnssClock layout changed");
+
+struct PackedGnssMeasurement {
+    int64_t receivedSvTimeNs;
+    int64_t receivedSvTimeUncertaintyNs;
+    double timeOffsetNs;
+    double cN0DbHz;
+    double pseudorangeRateMps;
+    double pseudorangeRateUncertaintyMps;
+    double accumulatedDeltaRangeM;
+    double accumulatedDeltaRangeUncertaintyM;
+    double snrDb;
+    double agcLevelDb;
+    float carrierFrequencyHz;
+    int32_t flags;
+    int32_t svid;
+    int32_t constellation;
+    int32_t state;
+    int32_t accumulatedDeltaRangeState;
+    int32_t multipathIndicator;
+    int32_t reserved;
+};
+static_assert(sizeof(PackedGnssMeasurement) == 112, "PackedGnssMeasurement layout changed");
+
+// Followed by measurementCount PackedGnssMeasurements.
+struct PackedGnssDataHeader {
+    int32_t version;
+    int32_t measurementCount;
+    PackedGnssClock clock;
+};
+static_assert(sizeof(PackedGnssDataHeader) == 80, "PackedGnssDataHeader layout changed");
+
+// Followed by dataLength bytes of navigation data.
+struct PackedGnssNavigationMessageHeader {
+    int32_t version;
+    int32_t type;
+    int32_t svid;
+    int32_t messageId;
+    int32_t submessageId;
+    int32_t status;
+    int32_t dataLength;
+};
+static_assert(sizeof(PackedGnssNavigationMessageHeader) == 28,
+              "PackedGnssNavigationMessageHeader layout changed");
+
 /*
  * GnssNavigationMessageCallback interface implements the callback methods
  * required by the IGnssNavigationMessage interface.
@@ -723,6 +793,30 @@ Return<void> GnssNavigationMessageCallback::gnssNavigationMessageCb(
       return Void();
     }
 
+    if (method_reportPackedNavigationMessage != nullptr) {
+        PackedGnssNavigationMessageHeader header = {};
+        header.version = kPackedGnssVersion;
+        header.type = static_cast<int32_t>(message.type);
+        header.svid = static_cast<int32_t>(message.svid);
+        header.messageId = static_cast<int32_t>(message.messageId);
+        header.submessageId = static_cast<int32_t>(message.submessageId);
+        header.status = static_cast<int32_t>(message.status);
+        header.dataLength = static_cast<int32_t>(dataLength);
+
+        jbyteArray packed = env->NewByteArray(sizeof(header) + dataLength);
+        if (packed == nullptr) {
+            checkAndClearExceptionFromCallback(env, __FUNCTION__);
+            return Void();
+        }
+        env->SetByteArrayRegion(packed, 0, sizeof(header), reinterpret_cast<jbyte*>(&header));
+        env->SetByteArrayRegion(packed, sizeof(header), dataLength,
+                                reinterpret_cast<jbyte*>(data));
+        env->CallVoidMethod(mCallbacksObj, method_reportPackedNavigationMessage, packed);
+        checkAndClearExceptionFromCallback(env, __FUNCTION__);
+        env->DeleteLocalRef(packed);
+        return Void();
+    }
+
     JavaObject object(env, "android/location/GnssNavigationMessage");
     SET(Type, static_cast<int32_t>(message.type));
     SET(Svid, static_cast<int32_t>(message.svid));
@@ -759,13 +853,37 @@ struct GnssMeasurementCallback : public IGnssMeasurementCallback_V1_1 {
     jobject translateGnssClock(
             JNIEnv* env, const IGnssMeasurementCallback_V1_0::GnssClock* clock);
     void setMeasurementData(JNIEnv* env, jobject clock, jobjectArray measurementArray);
+
+    static void packGnssMeasurement_V1_0(
+            const IGnssMeasurementCallback_V1_0::GnssMeasurement& measurement,
+            PackedGnssMeasurement* packed);
+    // Passes the clock and the measurements to Java in a single byte[]
+    void reportPackedMeasurementData(JNIEnv* env,
+            const IGnssMeasurementCallback_V1_0::GnssClock& clock,
+            const IGnssMeasurementCallback_V1_1::GnssMeasurement* measurements_v1_1,
+            const IGnssMeasurementCallback_V1_0::GnssMeasurement* measurements_v1_0,
+            size_t count);
 };
 
+// The ADR state of a V1_0 measurement as reported to Java, the V1_0 HAL doesn't report the half
+// cycle state.
+static int32_t accumulatedDeltaRangeState_V1_0(
+        const IGnssMeasurementCallback_V1_0::GnssMeasurement& measurement) {
+    return static_cast<int32_t>(measurement.accumulatedDeltaRangeState) &
+            !ADR_STATE_HALF_CYCLE_REPORTED;
+}
+
 
 Return<void> GnssMeasurementCallback::gnssMeasurementCb(
         const IGnssMeasurementCallback_V1_1::GnssData& data) {
     JNIEnv* env = getJniEnv();
 
+    if (method_reportPackedMeasurementData != nullptr) {
+        reportPackedMeasurementData(env, data.clock, data.measurements.data(), NULL,
+                                    data.measurements.size());
+        return Void();
+    }
+
     jobject clock;
     jobjectArray measurementArray;
 
@@ -784,6 +902,12 @@ Return<void> GnssMeasurementCallback::GnssMeasurementCb(
         const IGnssMeasurementCallback_V1_0::GnssData& data) {
     JNIEnv* env = getJniEnv();
 
+    if (method_reportPackedMeasurementData != nullptr) {
+        reportPackedMeasurementData(env, data.clock, NULL, data.measurements.data(),
+                                    data.measurementCount);
+        return Void();
+    }
+
     jobject clock;
     jobjectArray measurementArray;
 
@@ -814,9 +938,7 @@ void GnssMeasurementCallback::translateGnssMeasurement_V1_0(
     SET(PseudorangeRateMetersPerSecond, measurement->pseudorangeRateMps);
     SET(PseudorangeRateUncertaintyMetersPerSecond,
         measurement->pseudorangeRateUncertaintyMps);
-    SET(AccumulatedDeltaRangeState,
-        (static_cast<int32_t>(measurement->accumulatedDeltaRangeState) &
-        !ADR_STATE_HALF_CYCLE_REPORTED)); // Half Cycle state not reported from Hardware in V1_0
+    SET(AccumulatedDeltaRangeState, accumulatedDeltaRangeState_V1_0(*measurement));
     SET(AccumulatedDeltaRangeMeters, measurement->accumulatedDeltaRangeM);
     SET(AccumulatedDeltaRangeUncertaintyMeters,
         measurement->accumulatedDeltaRangeUncertaintyM);
@@ -934,6 +1056,74 @@ void GnssMeasurementCallback::setMeasurementData(JNIEnv* env, jobject clock,
     env->DeleteLocalRef(gnssMeasurementsEvent);
 }
 
+void GnssMeasurementCallback::packGnssMeasurement_V1_0(
+        const IGnssMeasurementCallback_V1_0::GnssMeasurement& measurement,
+        PackedGnssMeasurement* packed) {
+    packed->receivedSvTimeNs = measurement.receivedSvTimeInNs;
+    packed->receivedSvTimeUncertaintyNs = measurement.receivedSvTimeUncertaintyInNs;
+    packed->timeOffsetNs = measurement.timeOffsetNs;
+    packed->cN0DbHz = measurement.cN0DbHz;
+    packed->pseudorangeRateMps = measurement.pseudorangeRateMps;
+    packed->pseudorangeRateUncertaintyMps = measurement.pseudorangeRateUncertaintyMps;
+    packed->accumulatedDeltaRangeM = measurement.accumulatedDeltaRangeM;
+    packed->accumulatedDeltaRangeUncertaintyM = measurement.accumulatedDeltaRangeUncertaintyM;
+    packed->snrDb = measurement.snrDb;
+    packed->agcLevelDb = measurement.agcLevelDb;
+    packed->carrierFrequencyHz = measurement.carrierFrequencyHz;
+    packed->flags = static_cast<int32_t>(measurement.flags);
+    packed->svid = static_cast<int32_t>(measurement.svid);
+    packed->constellation = static_cast<int32_t>(measurement.constellation);
+    packed->state = static_cast<int32_t>(measurement.state);
+    packed->accumulatedDeltaRangeState = accumulatedDeltaRangeState_V1_0(measurement);
+    packed->multipathIndicator = static_cast<int32_t>(measurement.multipathIndicator);
+}
+
+void GnssMeasurementCallback::reportPackedMeasurementData(JNIEnv* env,
+        const IGnssMeasurementCallback_V1_0::GnssClock& clock,
+        const IGnssMeasurementCallback_V1_1::GnssMeasurement* measurements_v1_1,
+        const IGnssMeasurementCallback_V1_0::GnssMeasurement* measurements_v1_0,
+        size_t count) {
+    std::vector<uint8_t> buffer(sizeof(PackedGnssDataHeader) +
+                                count * sizeof(PackedGnssMeasurement));
+    PackedGnssDataHeader* header = reinterpret_cast<PackedGnssDataHeader*>(buffer.data());
+    header->version = kPackedGnssVersion;
+    header->measurementCount = static_cast<int32_t>(count);
+    header->clock.timeNs = clock.timeNs;
+    header->clock.fullBiasNs = clock.fullBiasNs;
+    header->clock.timeUncertaintyNs = clock.timeUncertaintyNs;
+    header->clock.biasNs = clock.biasNs;
+    header->clock.biasUncertaintyNs = clock.biasUncertaintyNs;
+    header->clock.driftNsps = clock.driftNsps;
+    header->clock.driftUncertaintyNsps = clock.driftUncertaintyNsps;
+    header->clock.flags = static_cast<int32_t>(clock.gnssClockFlags);
+    header->clock.leapSecond = static_cast<int32_t>(clock.leapSecond);
+    header->clock.hwClockDiscontinuityCount =
+            static_cast<int32_t>(clock.hwClockDiscontinuityCount);
+
+    PackedGnssMeasurement* packed =
+            reinterpret_cast<PackedGnssMeasurement*>(buffer.data() + sizeof(*header));
+    for (size_t i = 0; i < count; ++i) {
+        if (measurements_v1_1 != NULL) {
+            packGnssMeasurement_V1_0(measurements_v1_1[i].v1_0, &packed[i]);
+            packed[i].accumulatedDeltaRangeState =
+                    static_cast<int32_t>(measurements_v1_1[i].accumulatedDeltaRangeState) |
+                    ADR_STATE_HALF_CYCLE_REPORTED;
+        } else {
+            packGnssMeasurement_V1_0(measurements_v1_0[i], &packed[i]);
+        }
+    }
+
+    jbyteArray data = env->NewByteArray(buffer.size());
+    if (data == nullptr) {
+        checkAndClearExceptionFromCallback(env, __FUNCTION__);
+        return;
+    }
+    env->SetByteArrayRegion(data, 0, buffer.size(), reinterpret_cast<jbyte*>(buffer.data()));
+    env->CallVoidMethod(mCallbacksObj, method_reportPackedMeasurementData, data);
+    checkAndClearExceptionFromCallback(env, __FUNCTION__);
+    env->DeleteLocalRef(data);
+}
+
 /*
  * GnssNiCallback implements callback methods required by the IGnssNi interface.
  */
@@ -1175,6 +1365,19 @@ static void android_location_GnssLocationProvider_init_once(JNIEnv* env, jclass
             clazz,
             "reportNavigationMessage",
             "(Landroid/location/GnssNavigationMessage;)V");
+    method_reportPackedMeasurementData = env->GetMethodID(
+            clazz,
+            "reportPackedMeasurementData",
+            "([B)V");
+    method_reportPackedNavigationMessage = env->GetMethodID(
+            clazz,
+            "reportPackedNavigationMessage",
+            "([B)V");
+    if (method_reportPackedMeasurementData == nullptr ||
+            method_reportPackedNavigationMessage == nullptr) {
+        // Not implemented by the Java side, the missing method isn't an error
+        env->ExceptionClear();
+    }
     method_reportLocationBatch = env->GetMethodID(
             clazz,
             "reportLocationBatch",
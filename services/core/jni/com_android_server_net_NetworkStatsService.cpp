@@ -23,8 +23,13 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "core_jni_helpers.h"
 #include <jni.h>
+#include <nativehelper/ScopedLocalRef.h>
 #include <nativehelper/ScopedUtfChars.h>
 #include <utils/misc.h>
 #include <utils/Log.h>
@@ -37,6 +42,9 @@ using android::bpf::Stats;
 using android::bpf::hasBpfSupport;
 using android::bpf::bpfGetUidStats;
 using android::bpf::bpfGetIfaceStats;
+using android::bpf::parseBpfNetworkStatsDetail;
+using android::bpf::parseBpfNetworkStatsDev;
+using android::bpf::stats_line;
 
 namespace android {
 
@@ -150,6 +158,187 @@ static int parseUidStats(const uint32_t uid, struct Stats* stats) {
     return 0;
 }
 
+// A snapshot of all the stats, with each interface name stored once. The rows
+// are flat in the order of the *_COLUMN constants below.
+struct StatsSnapshot {
+    std::vector<std::string> ifaces;
+    std::unordered_map<std::string, int64_t> ifaceIndex;
+    std::vector<int64_t> rows;
+
+    int64_t indexOf(const char* iface) {
+        auto it = ifaceIndex.find(iface);
+        if (it != ifaceIndex.end()) {
+            return it->second;
+        }
+        int64_t index = ifaces.size();
+        ifaces.push_back(iface);
+        ifaceIndex.emplace(iface, index);
+        return index;
+    }
+};
+
+// NOTE: keep these in sync with NetworkStatsService.java
+// uid snapshot rows: iface index, uid, set, tag, then the byte and packet counts
+static const int UID_SNAPSHOT_COLUMNS = 8;
+// iface snapshot rows: iface index, then the byte and packet counts
+static const int IFACE_SNAPSHOT_COLUMNS = 7;
+
+static void addUidRow(StatsSnapshot* snapshot, const char* iface, uint32_t uid, uint32_t set,
+                      uint32_t tag, uint64_t rxBytes, uint64_t rxPackets, uint64_t txBytes,
+                      uint64_t txPackets) {
+    int64_t row[UID_SNAPSHOT_COLUMNS] = {
+        snapshot->indexOf(iface), uid, set, tag,
+        (int64_t) rxBytes, (int64_t) rxPackets, (int64_t) txBytes, (int64_t) txPackets,
+    };
+    snapshot->rows.insert(snapshot->rows.end(), row, row + UID_SNAPSHOT_COLUMNS);
+}
+
+static void addIfaceRow(StatsSnapshot* snapshot, const char* iface, uint64_t rxBytes,
+                        uint64_t rxPackets, uint64_t txBytes, uint64_t txPackets,
+                        uint64_t tcpRxPackets, uint64_t tcpTxPackets) {
+    int64_t row[IFACE_SNAPSHOT_COLUMNS] = {
+        snapshot->indexOf(iface),
+        (int64_t) rxBytes, (int64_t) rxPackets, (int64_t) txBytes, (int64_t) txPackets,
+        (int64_t) tcpRxPackets, (int64_t) tcpTxPackets,
+    };
+    snapshot->rows.insert(snapshot->rows.end(), row, row + IFACE_SNAPSHOT_COLUMNS);
+}
+
+// Reads the qtaguid stats of every uid, set and tag in a single pass.
+static int parseUidStatsSnapshot(StatsSnapshot* snapshot) {
+    FILE *fp = fopen(QTAGUID_UID_STATS, "r");
+    if (fp == NULL) {
+        return -1;
+    }
+
+    char buffer[384];
+    char iface[32];
+    uint32_t idx, uid, set;
+    uint64_t tag, rxBytes, rxPackets, txBytes, txPackets;
+
+    while (fgets(buffer, sizeof(buffer), fp) != NULL) {
+        if (sscanf(buffer,
+                "%" SCNu32 " %31s 0x%" SCNx64 " %u %u %" SCNu64 " %" SCNu64
+                " %" SCNu64 " %" SCNu64 "",
+                &idx, iface, &tag, &uid, &set, &rxBytes, &rxPackets,
+                &txBytes, &txPackets) == 9) {
+            addUidRow(snapshot, iface, uid, set, tag >> 32, rxBytes, rxPackets, txBytes,
+                      txPackets);
+        }
+    }
+
+    if (fclose(fp) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static int parseIfaceStatsSnapshot(StatsSnapshot* snapshot) {
+    FILE *fp = fopen(QTAGUID_IFACE_STATS, "r");
+    if (fp == NULL) {
+        return -1;
+    }
+
+    char buffer[384];
+    char iface[32];
+    uint64_t rxBytes, rxPackets, txBytes, txPackets, tcpRxPackets, tcpTxPackets;
+
+    while (fgets(buffer, sizeof(buffer), fp) != NULL) {
+        int matched = sscanf(buffer, "%31s %" SCNu64 " %" SCNu64 " %" SCNu64
+                " %" SCNu64 " " "%*u %" SCNu64 " %*u %*u %*u %*u "
+                "%*u %" SCNu64 " %*u %*u %*u %*u", iface, &rxBytes,
+                &rxPackets, &txBytes, &txPackets, &tcpRxPackets, &tcpTxPackets);
+        if (matched >= 5) {
+            if (matched != 7) {
+                tcpRxPackets = UNKNOWN;
+                tcpTxPackets = UNKNOWN;
+            }
+            addIfaceRow(snapshot, iface, rxBytes, rxPackets, txBytes, txPackets,
+                        tcpRxPackets, tcpTxPackets);
+        }
+    }
+
+    if (fclose(fp) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Returns the snapshot as an array holding the interface names, a String[],
+// and the rows, a long[].
+static jobjectArray snapshotToJava(JNIEnv* env, const StatsSnapshot& snapshot) {
+    ScopedLocalRef<jclass> stringClass(env, env->FindClass("java/lang/String"));
+    ScopedLocalRef<jobjectArray> ifaces(env,
+            env->NewObjectArray(snapshot.ifaces.size(), stringClass.get(), NULL));
+    if (ifaces.get() == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < snapshot.ifaces.size(); i++) {
+        ScopedLocalRef<jstring> iface(env, env->NewStringUTF(snapshot.ifaces[i].c_str()));
+        if (iface.get() == NULL) {
+            return NULL;
+        }
+        env->SetObjectArrayElement(ifaces.get(), i, iface.get());
+    }
+
+    ScopedLocalRef<jlongArray> rows(env, env->NewLongArray(snapshot.rows.size()));
+    if (rows.get() == NULL) {
+        return NULL;
+    }
+    static_assert(sizeof(jlong) == sizeof(int64_t), "jlong and int64_t have different sizes");
+    env->SetLongArrayRegion(rows.get(), 0, snapshot.rows.size(),
+            reinterpret_cast<const jlong*>(snapshot.rows.data()));
+
+    ScopedLocalRef<jclass> objectClass(env, env->FindClass("java/lang/Object"));
+    jobjectArray result = env->NewObjectArray(2, objectClass.get(), NULL);
+    if (result != NULL) {
+        env->SetObjectArrayElement(result, 0, ifaces.get());
+        env->SetObjectArrayElement(result, 1, rows.get());
+    }
+    return result;
+}
+
+static jobjectArray getUidStatsSnapshot(JNIEnv* env, jclass clazz, jboolean useBpfStats) {
+    StatsSnapshot snapshot;
+
+    if (useBpfStats) {
+        std::vector<stats_line> lines;
+        if (parseBpfNetworkStatsDetail(&lines, std::vector<std::string>(), -1, -1) < 0) {
+            return NULL;
+        }
+        snapshot.rows.reserve(lines.size() * UID_SNAPSHOT_COLUMNS);
+        for (const stats_line& line : lines) {
+            addUidRow(&snapshot, line.iface, line.uid, line.set, line.tag, line.rxBytes,
+                      line.rxPackets, line.txBytes, line.txPackets);
+        }
+    } else if (parseUidStatsSnapshot(&snapshot) < 0) {
+        return NULL;
+    }
+
+    return snapshotToJava(env, snapshot);
+}
+
+static jobjectArray getIfaceStatsSnapshot(JNIEnv* env, jclass clazz, jboolean useBpfStats) {
+    StatsSnapshot snapshot;
+
+    if (useBpfStats) {
+        std::vector<stats_line> lines;
+        if (parseBpfNetworkStatsDev(&lines) < 0) {
+            return NULL;
+        }
+        snapshot.rows.reserve(lines.size() * IFACE_SNAPSHOT_COLUMNS);
+        for (const stats_line& line : lines) {
+            // the bpf maps don't count tcp packets
+            addIfaceRow(&snapshot, line.iface, line.rxBytes, line.rxPackets, line.txBytes,
+                        line.txPackets, UNKNOWN, UNKNOWN);
+        }
+    } else if (parseIfaceStatsSnapshot(&snapshot) < 0) {
+        return NULL;
+    }
+
+    return snapshotToJava(env, snapshot);
+}
+
 static jlong getTotalStat(JNIEnv* env, jclass clazz, jint type, jboolean useBpfStats) {
     struct Stats stats;
     memset(&stats, 0, sizeof(Stats));
@@ -217,6 +406,8 @@ static const JNINativeMethod gMethods[] = {
     {"nativeGetTotalStat", "(IZ)J", (void*) getTotalStat},
     {"nativeGetIfaceStat", "(Ljava/lang/String;IZ)J", (void*) getIfaceStat},
     {"nativeGetUidStat", "(IIZ)J", (void*) getUidStat},
+    {"nativeGetUidStatsSnapshot", "(Z)[Ljava/lang/Object;", (void*) getUidStatsSnapshot},
+    {"nativeGetIfaceStatsSnapshot", "(Z)[Ljava/lang/Object;", (void*) getIfaceStatsSnapshot},
 };
 
 int register_android_server_net_NetworkStatsService(JNIEnv* env) {
@@ -25,9 +25,16 @@
 #include <libappfuse/FuseBuffer.h>
 #include <nativehelper/JNIHelp.h>
 
+#include <sys/socket.h>
+
 namespace android {
 namespace {
 
+// The socket buffers of a proxy fd hold several maximal FUSE read or write messages, so the
+// app can have requests in flight while the loop forwards the previous ones, instead of each
+// request waiting for the reply to the one before it to drain.
+constexpr int kProxySocketBufferSize = 1024 * 1024;
+
 constexpr const char* CLASS_NAME = "com/android/server/storage/AppFuseBridge";
 static jclass gAppFuseClass;
 static jmethodID gAppFuseOnMount;
@@ -115,6 +122,15 @@ jint com_android_server_storage_AppFuseBridge_add_bridge(
     if (!fuse::SetupMessageSockets(&proxyFd)) {
         return -1;
     }
+    for (const base::unique_fd& fd : proxyFd) {
+        // Best effort, the buffers SetupMessageSockets() sized still work.
+        if (setsockopt(fd.get(), SOL_SOCKET, SO_SNDBUF, &kProxySocketBufferSize,
+                       sizeof(kProxySocketBufferSize)) != 0 ||
+            setsockopt(fd.get(), SOL_SOCKET, SO_RCVBUF, &kProxySocketBufferSize,
+                       sizeof(kProxySocketBufferSize)) != 0) {
+            PLOG(WARNING) << "Failed to enlarge the proxy socket buffers";
+        }
+    }
 
     if (!loop->AddBridge(mountId, std::move(devFd), std::move(proxyFd[0]))) {
         return -1;
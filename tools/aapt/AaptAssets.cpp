@@ -7,6 +7,7 @@
 #include "AaptUtil.h"
 #include "Main.h"
 #include "ResourceFilter.h"
+#include "ResourceIdCache.h"
 
 #include <utils/misc.h>
 #include <utils/SortedVector.h>
@@ -1556,6 +1557,14 @@ status_t AaptAssets::buildIncludedResources(Bundle* bundle)
 
     mHaveIncludedAssets = true;
 
+    if (bundle->getResourceIdCacheFile() != NULL) {
+        Vector<String8> cacheIncludes(includes);
+        if (!featureOfBase.isEmpty()) {
+            cacheIncludes.add(featureOfBase);
+        }
+        ResourceIdCache::load(bundle->getResourceIdCacheFile(), cacheIncludes);
+    }
+
     return NO_ERROR;
 }
 
@@ -65,6 +65,7 @@ public:
           mSkipSymbolsWithoutDefaultLocalization(false),
           mProduct(NULL), mUseCrunchCache(false), mErrorOnFailedInsert(false),
           mErrorOnMissingConfigEntry(false), mOutputTextSymbols(NULL),
+          mResourceIdCacheFile(NULL),
           mSingleCrunchInputFile(NULL), mSingleCrunchOutputFile(NULL),
           mBuildSharedLibrary(false),
           mBuildAppAsSharedLibrary(false),
@@ -215,6 +216,8 @@ public:
     bool getUseCrunchCache() const { return mUseCrunchCache; }
     const char* getOutputTextSymbols() const { return mOutputTextSymbols; }
     void setOutputTextSymbols(const char* val) { mOutputTextSymbols = val; }
+    const char* getResourceIdCacheFile() const { return mResourceIdCacheFile; }
+    void setResourceIdCacheFile(const char* val) { mResourceIdCacheFile = val; }
     const char* getSingleCrunchInputFile() const { return mSingleCrunchInputFile; }
     void setSingleCrunchInputFile(const char* val) { mSingleCrunchInputFile = val; }
     const char* getSingleCrunchOutputFile() const { return mSingleCrunchOutputFile; }
@@ -345,6 +348,7 @@ private:
     bool        mErrorOnFailedInsert;
     bool        mErrorOnMissingConfigEntry;
     const char* mOutputTextSymbols;
+    const char* mResourceIdCacheFile;
     const char* mSingleCrunchInputFile;
     const char* mSingleCrunchOutputFile;
     bool        mBuildSharedLibrary;
@@ -38,7 +38,8 @@ public:
     // Delete a file
     virtual void deleteFile(String8 path) = 0;
 
-    // Process an image from source out to dest
+    // Process an image from source out to dest. May be called from several
+    // threads at once, see CrunchCache::crunch.
     virtual void processImage(String8 source, String8 dest) = 0;
 private:
 };
@@ -100,7 +101,9 @@ public:
     // Process an image from source out to dest
     virtual void processImage(String8 source, String8 dest)
     {
-        // Make sure we're trying to write to a directory that is extant
+        // Make sure we're trying to write to a directory that is extant.
+        // Other threads may be creating the same directories, it's fine if
+        // some mkdir calls fail because the directory already exists.
         ensureDirectoriesExist(dest.getPathDir());
 
         preProcessImageToCache(bundle, source, dest);
@@ -9,6 +9,7 @@
 #include "Images.h"
 #include "Main.h"
 #include "ResourceFilter.h"
+#include "ResourceIdCache.h"
 #include "ResourceTable.h"
 #include "XMLNode.h"
 
@@ -2655,6 +2656,9 @@ int doPackage(Bundle* bundle)
         if (err != 0) {
             goto bail;
         }
+        if (bundle->getResourceIdCacheFile() != NULL) {
+            ResourceIdCache::save(bundle->getResourceIdCacheFile());
+        }
     }
 
     // At this point we've read everything and processed everything.  From here
@@ -9,13 +9,66 @@
 #include <utils/Vector.h>
 #include <utils/String8.h>
 
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
 #include "DirectoryWalker.h"
 #include "FileFinder.h"
 #include "CacheUpdater.h"
 #include "CrunchCache.h"
+#include "WorkQueue.h"
 
 using namespace android;
 
+// The hash index, in the root of the cache.
+static const char* kHashIndexName = ".crunch_hashes";
+
+// Returns the size and the 64-bit FNV-1a hash of the content of a file, or
+// an empty string if it can't be read.
+static String8 hashFile(const String8& path)
+{
+    FILE* fp = fopen(path.string(), "rb");
+    if (fp == NULL) {
+        return String8();
+    }
+
+    uint64_t hash = 14695981039346656037ULL;
+    uint64_t size = 0;
+    unsigned char buf[32768];
+    size_t count;
+    while ((count = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            hash = (hash ^ buf[i]) * 1099511628211ULL;
+        }
+        size += count;
+    }
+    bool failed = ferror(fp) != 0;
+    fclose(fp);
+    if (failed) {
+        return String8();
+    }
+    return String8::format("%llx-%016llx", (unsigned long long) size,
+            (unsigned long long) hash);
+}
+
+class CrunchWorkUnit : public WorkQueue::WorkUnit {
+public:
+    CrunchWorkUnit(CacheUpdater* cu, const String8& source, const String8& dest) :
+            mCacheUpdater(cu), mSource(source), mDest(dest) {
+    }
+
+    virtual bool run() {
+        mCacheUpdater->processImage(mSource, mDest);
+        return true;
+    }
+
+private:
+    CacheUpdater* mCacheUpdater;
+    String8 mSource;
+    String8 mDest;
+};
+
 CrunchCache::CrunchCache(String8 sourcePath, String8 destPath, FileFinder* ff)
     : mSourcePath(sourcePath), mDestPath(destPath), mSourceFiles(0), mDestFiles(0), mFileFinder(ff)
 {
@@ -29,9 +82,11 @@ CrunchCache::CrunchCache(String8 sourcePath, String8 destPath, FileFinder* ff)
     loadFiles();
 }
 
-size_t CrunchCache::crunch(CacheUpdater* cu, bool forceOverwrite)
+size_t CrunchCache::crunch(CacheUpdater* cu, bool forceOverwrite, size_t maxThreads)
 {
     size_t numFilesUpdated = 0;
+    KeyedVector<String8,String8> hashes;
+    WorkQueue wq(maxThreads, false);
 
     // Iterate through the source files and compare to cache.
     // After processing a file, remove it from the source files and
@@ -51,11 +106,19 @@ size_t CrunchCache::crunch(CacheUpdater* cu, bool forceOverwrite)
             offset = 1;
         relativePath = String8(rPathPtr + offset);
 
-        if (forceOverwrite || needsUpdating(relativePath)) {
-            cu->processImage(mSourcePath.appendPathCopy(relativePath),
-                             mDestPath.appendPathCopy(relativePath));
+        String8 sourceHash = hashFile(mSourceFiles.keyAt(0));
+        if (forceOverwrite || needsUpdating(relativePath, sourceHash)) {
+            CrunchWorkUnit* w = new CrunchWorkUnit(cu, mSourcePath.appendPathCopy(relativePath),
+                    mDestPath.appendPathCopy(relativePath));
+            if (wq.schedule(w) != NO_ERROR) {
+                // Crunch it here instead.
+                w->run();
+                delete w;
+            }
             numFilesUpdated++;
-            // crunchFile(relativePath);
+        }
+        if (sourceHash.length() > 0) {
+            hashes.add(relativePath, sourceHash);
         }
         // Delete this file from the source files and (if it exists) from the
         // dest files.
@@ -63,12 +126,17 @@ size_t CrunchCache::crunch(CacheUpdater* cu, bool forceOverwrite)
         mDestFiles.removeItem(mDestPath.appendPathCopy(relativePath));
     }
 
+    // Wait for the files to be crunched.
+    wq.finish();
+
     // Iterate through what's left of destFiles and delete leftovers
     while (mDestFiles.size() > 0) {
         cu->deleteFile(mDestFiles.keyAt(0));
         mDestFiles.removeItemsAt(0);
     }
 
+    saveHashes(hashes);
+
     // Update our knowledge of the files cache
     // both source and dest should be empty by now.
     loadFiles();
@@ -92,14 +160,70 @@ void CrunchCache::loadFiles()
     mFileFinder->findFiles(mDestPath,mExtensions,mDestFiles,dw);
 
     delete dw;
+
+    loadHashes();
 }
 
-bool CrunchCache::needsUpdating(const String8& relativePath) const
+void CrunchCache::loadHashes()
+{
+    mHashes.clear();
+
+    FILE* fp = fopen(mDestPath.appendPathCopy(String8(kHashIndexName)).string(), "r");
+    if (fp == NULL) {
+        // No index yet, the timestamps are compared.
+        return;
+    }
+
+    char line[PATH_MAX + 64];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        size_t len = strlen(line);
+        if (len > 0 && line[len - 1] == '\n') {
+            line[--len] = '\0';
+        }
+        // The path may contain spaces, it's everything after the first one.
+        char* separator = strchr(line, ' ');
+        if (separator == NULL) {
+            continue;
+        }
+        *separator = '\0';
+        mHashes.add(String8(separator + 1), String8(line));
+    }
+    fclose(fp);
+}
+
+void CrunchCache::saveHashes(const KeyedVector<String8,String8>& hashes) const
+{
+    String8 path = mDestPath.appendPathCopy(String8(kHashIndexName));
+    FILE* fp = fopen(path.string(), "w");
+    if (fp == NULL) {
+        if (hashes.size() > 0) {
+            fprintf(stderr, "WARNING: unable to write crunch cache index %s\n", path.string());
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < hashes.size(); i++) {
+        fprintf(fp, "%s %s\n", hashes.valueAt(i).string(), hashes.keyAt(i).string());
+    }
+    fclose(fp);
+}
+
+bool CrunchCache::needsUpdating(const String8& relativePath, const String8& sourceHash) const
 {
     // Retrieve modification dates for this file entry under the source and
     // cache directory trees. The vectors will return a modification date of 0
     // if the file doesn't exist.
     time_t sourceDate = mSourceFiles.valueFor(mSourcePath.appendPathCopy(relativePath));
     time_t destDate = mDestFiles.valueFor(mDestPath.appendPathCopy(relativePath));
+    if (destDate == 0) {
+        return true;
+    }
+
+    // Touching a file, or checking it out again, doesn't invalidate its
+    // cached version as long as its content is the same.
+    ssize_t index = mHashes.indexOfKey(relativePath);
+    if (index >= 0 && sourceHash.length() > 0) {
+        return mHashes.valueAt(index) != sourceHash;
+    }
     return sourceDate > destDate;
 }
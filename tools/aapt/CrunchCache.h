@@ -41,9 +41,12 @@ public:
      * them to the cached versions in the destPath. If the optional
      * argument forceOverwrite is set to true, then all source files are
      * re-crunched even if they have not been modified recently. Otherwise,
-     * source files are only crunched when they needUpdating. Afterwards,
-     * we delete any leftover files in the cache that are no longer present
-     * in source.
+     * source files are only crunched when they needUpdating. The files are
+     * crunched on up to maxThreads threads, so the CacheUpdater must allow
+     * processImage to be called from several threads at once when maxThreads
+     * is more than 1. Afterwards, we delete any leftover files in the cache
+     * that are no longer present in source, and record the content hash of
+     * every source file in the cache.
      *
      * PRECONDITIONS:
      *      No setup besides construction is needed
@@ -52,7 +55,7 @@ public:
      *      The function then returns the number of files changed in cache
      *      (counting deletions).
      */
-    size_t crunch(CacheUpdater* cu, bool forceOverwrite=false);
+    size_t crunch(CacheUpdater* cu, bool forceOverwrite=false, size_t maxThreads=1);
 
 private:
     /** loadFiles is a wrapper to the FileFinder that places matching
@@ -61,27 +64,39 @@ private:
      *  POSTCONDITIONS
      *      mDestFiles and mSourceFiles are refreshed to reflect the current
      *      state of the files in the source and dest directories.
-     *      Any previous contents of mSourceFiles and mDestFiles are cleared.
+     *      mHashes is refreshed from the hash index of the cache.
+     *      Any previous contents of mSourceFiles, mDestFiles and mHashes are
+     *      cleared.
      */
     void loadFiles();
 
-    /** needsUpdating takes a file path
-     * and returns true if the file represented by this path is newer in the
-     * sourceFiles than in the cache (mDestFiles).
+    /** Reads and writes the hash index of the cache, which holds one line
+     * per cached file: the content hash of its source file, then the
+     * relative path of the file.
+     */
+    void loadHashes();
+    void saveHashes(const KeyedVector<String8,String8>& hashes) const;
+
+    /** needsUpdating takes a file path and the content hash of its source
+     * file, and returns true if the file represented by this path isn't
+     * cached, or if its source has changed since it was cached.
      *
      * PRECONDITIONS:
-     *      mSourceFiles and mDestFiles must be initialized and filled.
+     *      mSourceFiles, mDestFiles and mHashes must be initialized and filled.
      * POSTCONDITIONS:
-     *      returns true if and only if source file's modification time
-     *      is greater than the cached file's mod-time. Otherwise returns false.
+     *      returns true if and only if the cached file is missing, or its
+     *      recorded hash differs from sourceHash. When no hash was recorded
+     *      for the file, or the source couldn't be hashed, returns true if and
+     *      only if source file's modification time is greater than the cached
+     *      file's mod-time. Otherwise returns false.
      *
      * USAGE:
      *      Should be used something like the following:
-     *      if (needsUpdating(filePath))
+     *      if (needsUpdating(filePath, hashFile(sourcePath)))
      *          // Recrunch sourceFile out to destFile.
      *
      */
-    bool needsUpdating(const String8& relativePath) const;
+    bool needsUpdating(const String8& relativePath, const String8& sourceHash) const;
 
     // DATA MEMBERS ====================================================
 
@@ -95,6 +110,10 @@ private:
     DefaultKeyedVector<String8,time_t> mSourceFiles;
     DefaultKeyedVector<String8,time_t> mDestFiles;
 
+    // The content hashes of the source files when they were last crunched,
+    // by relative path, as recorded in the hash index of the cache.
+    KeyedVector<String8,String8> mHashes;
+
     // Pointer to a FileFinder to use
     FileFinder* mFileFinder;
 };
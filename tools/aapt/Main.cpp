@@ -92,7 +92,7 @@ void usage(void)
         "        [--split CONFIGS [--split CONFIGS]] \\\n"
         "        [--feature-of package [--feature-after package]] \\\n"
         "        [raw-files-dir [raw-files-dir] ...] \\\n"
-        "        [--output-text-symbols DIR]\n"
+        "        [--output-text-symbols DIR] [--resource-id-cache FILE]\n"
         "\n"
         "   Package the android resources.  It will read assets and resources that are\n"
         "   supplied with the -M -A -S or raw-files-dir arguments.  The -J -P -F and -R\n"
@@ -232,6 +232,9 @@ void usage(void)
         "   --output-text-symbols\n"
         "       Generates a text file containing the resource symbols of the R class in the\n"
         "       specified folder.\n"
+        "   --resource-id-cache\n"
+        "       Saves the IDs of the resources looked up in the included packages to the\n"
+        "       specified file, and reads them back while the includes are unchanged.\n"
         "   --ignore-assets\n"
         "       Assets to be ignored. Default pattern is:\n"
         "       %s\n"
@@ -692,6 +695,15 @@ int main(int argc, char* const argv[])
                         goto bail;
                     }
                     bundle.setOutputTextSymbols(argv[0]);
+                } else if (strcmp(cp, "-resource-id-cache") == 0) {
+                    argc--;
+                    argv++;
+                    if (!argc) {
+                        fprintf(stderr, "ERROR: No argument supplied for '--resource-id-cache' option\n");
+                        wantUsage = true;
+                        goto bail;
+                    }
+                    bundle.setResourceIdCacheFile(argv[0]);
                 } else if (strcmp(cp, "-product") == 0) {
                     argc--;
                     argv++;
@@ -8,6 +8,7 @@
 #include "OutputSet.h"
 #include "ResourceTable.h"
 #include "ResourceFilter.h"
+#include "WorkQueue.h"
 
 #include <androidfw/misc.h>
 
@@ -22,10 +23,16 @@
 #include <ctype.h>
 #include <errno.h>
 
+#include <vector>
+
 using namespace android;
 
 static const char* kExcludeExtension = ".EXCLUDE";
 
+// The assets are compressed on up to this many threads, this many files at a time.
+static const size_t kMaxDeflateThreads = 4;
+static const size_t kDeflateBatchSize = 64;
+
 /* these formats are already compressed, or don't compress well */
 static const char* kNoCompressExt[] = {
     ".jpg", ".jpeg", ".png", ".gif",
@@ -36,9 +43,24 @@ static const char* kNoCompressExt[] = {
     ".amr", ".awb", ".wma", ".wmv", ".webm", ".mkv"
 };
 
+/*
+ * A file read and compressed ahead of time on a work thread, so that
+ * processFile() only has to append it to the archive.
+ */
+struct DeflatedFile {
+    DeflatedFile() : ready(false), deflated(false), crc(0), uncompressedLen(0) { }
+
+    bool ready;             // false if the file has to be read by processFile()
+    bool deflated;          // false if it didn't compress enough, "data" is the file
+    std::vector<unsigned char> data;
+    unsigned long crc;
+    long uncompressedLen;
+};
+
 /* fwd decls, so I can write this downward */
 ssize_t processAssets(Bundle* bundle, ZipFile* zip, const sp<const OutputSet>& outputSet);
-bool processFile(Bundle* bundle, ZipFile* zip, String8 storageName, const sp<const AaptFile>& file);
+bool processFile(Bundle* bundle, ZipFile* zip, String8 storageName, const sp<const AaptFile>& file,
+                 const DeflatedFile* deflatedFile = NULL);
 bool okayToCompress(Bundle* bundle, const String8& pathName);
 ssize_t processJarFiles(Bundle* bundle, ZipFile* zip);
 
@@ -215,22 +237,108 @@ bail:
     return result;
 }
 
+class DeflateFileWorkUnit : public WorkQueue::WorkUnit {
+public:
+    DeflateFileWorkUnit(const String8& sourceFile, DeflatedFile* deflatedFile) :
+            mSourceFile(sourceFile), mDeflatedFile(deflatedFile) {
+    }
+
+    virtual bool run() {
+        FILE* fp = fopen(mSourceFile.string(), "rb");
+        if (fp == NULL) {
+            return true; // processFile() reports it
+        }
+        std::vector<unsigned char> contents;
+        unsigned char buf[32768];
+        size_t count;
+        while ((count = fread(buf, 1, sizeof(buf), fp)) > 0) {
+            contents.insert(contents.end(), buf, buf + count);
+        }
+        bool failed = ferror(fp) != 0;
+        fclose(fp);
+        // Empty files are left to processFile(), there is nothing to gain.
+        if (failed || contents.empty() || ZipFile::deflateData(contents.data(), contents.size(),
+                &mDeflatedFile->data, &mDeflatedFile->crc) != NO_ERROR) {
+            return true;
+        }
+
+        // Store it if it doesn't compress "enough", like ZipFile::add().
+        long src = contents.size();
+        long dst = mDeflatedFile->data.size();
+        mDeflatedFile->deflated = dst + (dst / 10) <= src;
+        if (!mDeflatedFile->deflated) {
+            mDeflatedFile->data.swap(contents);
+        }
+        mDeflatedFile->uncompressedLen = src;
+        mDeflatedFile->ready = true;
+        return true;
+    }
+
+private:
+    String8 mSourceFile;
+    DeflatedFile* mDeflatedFile;
+};
+
+/*
+ * Whether processFile() would compress "file" from its source file, which
+ * can then be done ahead of time. In update mode the file may not be added
+ * at all, so it's left to processFile().
+ */
+static bool canDeflateAhead(Bundle* bundle, const String8& storagePath,
+                            const sp<const AaptFile>& file)
+{
+    return !bundle->getUpdate() && !file->hasData()
+            && bundle->getCompressionMethod() == ZipEntry::kCompressDeflated
+            && strcasecmp(storagePath.getPathExtension().string(), ".gz") != 0
+            && okayToCompress(bundle, storagePath);
+}
+
 ssize_t processAssets(Bundle* bundle, ZipFile* zip, const sp<const OutputSet>& outputSet)
 {
     ssize_t count = 0;
     const std::set<OutputEntry>& entries = outputSet->getEntries();
     std::set<OutputEntry>::const_iterator iter = entries.begin();
-    for (; iter != entries.end(); iter++) {
-        const OutputEntry& entry = *iter;
-        if (entry.getFile() == NULL) {
-            fprintf(stderr, "warning: null file being processed.\n");
-        } else {
-            String8 storagePath(entry.getPath());
-            storagePath.convertToResPath();
-            if (!processFile(bundle, zip, storagePath, entry.getFile())) {
-                return UNKNOWN_ERROR;
+    while (iter != entries.end()) {
+        // Compress the next batch of files on the work threads, then add them in order, so that
+        // the archive doesn't depend on the scheduling.
+        std::vector<const OutputEntry*> batch;
+        for (; iter != entries.end() && batch.size() < kDeflateBatchSize; iter++) {
+            batch.push_back(&*iter);
+        }
+        std::vector<DeflatedFile> deflatedFiles(batch.size());
+        std::vector<String8> storagePaths(batch.size());
+        {
+            WorkQueue wq(kMaxDeflateThreads, false);
+            for (size_t i = 0; i < batch.size(); i++) {
+                const sp<const AaptFile>& file = batch[i]->getFile();
+                if (file == NULL) {
+                    continue;
+                }
+                storagePaths[i] = batch[i]->getPath();
+                storagePaths[i].convertToResPath();
+                if (canDeflateAhead(bundle, storagePaths[i], file)) {
+                    DeflateFileWorkUnit* w = new DeflateFileWorkUnit(file->getSourceFile(),
+                            &deflatedFiles[i]);
+                    if (wq.schedule(w) != NO_ERROR) {
+                        // processFile() compresses it instead.
+                        delete w;
+                    }
+                }
+            }
+            wq.finish();
+        }
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            const OutputEntry& entry = *batch[i];
+            if (entry.getFile() == NULL) {
+                fprintf(stderr, "warning: null file being processed.\n");
+            } else {
+                if (!processFile(bundle, zip, storagePaths[i], entry.getFile(),
+                                 &deflatedFiles[i])) {
+                    return UNKNOWN_ERROR;
+                }
+                count++;
             }
-            count++;
         }
     }
     return count;
@@ -243,7 +351,8 @@ ssize_t processAssets(Bundle* bundle, ZipFile* zip, const sp<const OutputSet>& o
  * delete the existing entry before adding the new one.
  */
 bool processFile(Bundle* bundle, ZipFile* zip,
-                 String8 storageName, const sp<const AaptFile>& file)
+                 String8 storageName, const sp<const AaptFile>& file,
+                 const DeflatedFile* deflatedFile)
 {
     const bool hasData = file->hasData();
 
@@ -322,6 +431,16 @@ bool processFile(Bundle* bundle, ZipFile* zip,
 
     if (fromGzip) {
         result = zip->addGzip(file->getSourceFile().string(), storageName.string(), &entry);
+    } else if (deflatedFile != NULL && deflatedFile->ready) {
+        /* already read, and compressed if it was worth it */
+        if (deflatedFile->deflated) {
+            result = zip->addDeflated(deflatedFile->data.data(), deflatedFile->data.size(),
+                                      deflatedFile->crc, deflatedFile->uncompressedLen,
+                                      storageName.string(), &entry);
+        } else {
+            result = zip->add(deflatedFile->data.data(), deflatedFile->data.size(),
+                              storageName.string(), ZipEntry::kCompressStored, &entry);
+        }
     } else if (!hasData) {
         /* don't compress certain files, e.g. PNGs */
         int compressionMethod = bundle->getCompressionMethod();
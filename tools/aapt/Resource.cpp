@@ -1181,7 +1181,7 @@ status_t updatePreProcessedCache(Bundle* bundle)
     CrunchCache cc(source,dest,ff);
 
     CacheUpdater* cu = new SystemCacheUpdater(bundle);
-    size_t numFiles = cc.crunch(cu);
+    size_t numFiles = cc.crunch(cu, false, MAX_THREADS);
 
     if (bundle->getVerbose())
         fprintf(stdout, "Crunched %d PNG files to update cache\n", (int)numFiles);
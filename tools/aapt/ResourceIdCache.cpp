@@ -8,27 +8,21 @@
 #include <utils/String16.h>
 #include <utils/Log.h>
 #include "ResourceIdCache.h"
-#include <map>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
 
 static size_t mHits = 0;
 static size_t mMisses = 0;
-static size_t mCollisions = 0;
-
-static const size_t MAX_CACHE_ENTRIES = 2048;
-static const android::String16 TRUE16("1");
-static const android::String16 FALSE16("0");
-
-struct CacheEntry {
-    // concatenation of the relevant strings into a single instance
-    android::String16 hashedName;
-    uint32_t id;
-
-    CacheEntry() {}
-    CacheEntry(const android::String16& name, uint32_t resId) : hashedName(name), id(resId) { }
-};
-
-static std::map< uint32_t, CacheEntry > mIdMap;
+static size_t mLoaded = 0;
 
+static const size_t MAX_CACHE_ENTRIES = 1 << 18;
+static const char CACHE_FILE_MAGIC[] = "aapt-resource-id-cache 1";
 
 // djb2; reasonable choice for strings when collisions aren't particularly important
 static inline uint32_t hashround(uint32_t hash, int c) {
@@ -42,16 +36,35 @@ static uint32_t hash(const android::String16& hashableString) {
     return hash;
 }
 
+struct HashableNameHash {
+    size_t operator()(const android::String16& name) const { return hash(name); }
+};
+
+struct CacheEntry {
+    uint32_t id;
+    bool persistent;
+};
+
+// The key is a single string, so the names are only compared once per lookup
+// and every entry is kept, unlike with a map of hashes.
+static std::unordered_map<android::String16, CacheEntry, HashableNameHash> mIdMap;
+
+// The included packages the persistent IDs were resolved against.
+static android::String8 mIncludesFingerprint;
+
 namespace android {
 
+// ':' and '/' can't be in a package or type, so the key is unambiguous
 static inline String16 makeHashableName(const android::String16& package,
         const android::String16& type,
         const android::String16& name,
         bool onlyPublic) {
-    String16 hashable = String16(name);
+    String16 hashable = String16(package);
+    hashable += String16(":");
     hashable += type;
-    hashable += package;
-    hashable += (onlyPublic ? TRUE16 : FALSE16);
+    hashable += String16("/");
+    hashable += name;
+    hashable += String16(onlyPublic ? "/1" : "/0");
     return hashable;
 }
 
@@ -59,25 +72,14 @@ uint32_t ResourceIdCache::lookup(const android::String16& package,
         const android::String16& type,
         const android::String16& name,
         bool onlyPublic) {
-    const String16 hashedName = makeHashableName(package, type, name, onlyPublic);
-    const uint32_t hashcode = hash(hashedName);
-    std::map<uint32_t, CacheEntry>::iterator item = mIdMap.find(hashcode);
+    auto item = mIdMap.find(makeHashableName(package, type, name, onlyPublic));
     if (item == mIdMap.end()) {
         // cache miss
         mMisses++;
         return 0;
     }
-
-    // legit match?
-    if (hashedName == (*item).second.hashedName) {
-        mHits++;
-        return (*item).second.id;
-    }
-
-    // collision
-    mCollisions++;
-    mIdMap.erase(hashcode);
-    return 0;
+    mHits++;
+    return item->second.id;
 }
 
 // returns the resource ID being stored, for callsite convenience
@@ -85,21 +87,95 @@ uint32_t ResourceIdCache::store(const android::String16& package,
         const android::String16& type,
         const android::String16& name,
         bool onlyPublic,
-        uint32_t resId) {
+        uint32_t resId,
+        bool persistent) {
     if (mIdMap.size() < MAX_CACHE_ENTRIES) {
-        const String16 hashedName = makeHashableName(package, type, name, onlyPublic);
-        const uint32_t hashcode = hash(hashedName);
-        mIdMap[hashcode] = CacheEntry(hashedName, resId);
+        mIdMap[makeHashableName(package, type, name, onlyPublic)] = CacheEntry{resId, persistent};
     }
     return resId;
 }
 
+// The paths, sizes and modification times of the included packages
+static String8 fingerprintIncludes(const Vector<String8>& includes) {
+    String8 fingerprint;
+    for (size_t i = 0; i < includes.size(); i++) {
+        struct stat st;
+        if (stat(includes[i].string(), &st) != 0) {
+            return String8();
+        }
+        fingerprint.appendFormat("%s %" PRId64 " %" PRId64 ";", includes[i].string(),
+                (int64_t) st.st_size, (int64_t) st.st_mtime);
+    }
+    return fingerprint;
+}
+
+void ResourceIdCache::load(const char* path, const Vector<String8>& includes) {
+    mIncludesFingerprint = fingerprintIncludes(includes);
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL) {
+        return;
+    }
+
+    char line[4096];
+    bool valid = fgets(line, sizeof(line), fp) != NULL
+            && strncmp(line, CACHE_FILE_MAGIC, strlen(CACHE_FILE_MAGIC)) == 0
+            && fgets(line, sizeof(line), fp) != NULL;
+    if (valid) {
+        line[strcspn(line, "\n")] = '\0';
+        // the IDs may have changed with the includes
+        valid = !mIncludesFingerprint.isEmpty() && mIncludesFingerprint == line;
+    }
+    while (valid && fgets(line, sizeof(line), fp) != NULL) {
+        uint32_t id;
+        int consumed = 0;
+        line[strcspn(line, "\n")] = '\0';
+        if (sscanf(line, "%" SCNx32 " %n", &id, &consumed) != 1 || consumed == 0) {
+            continue;
+        }
+        String16 key(line + consumed);
+        if (mIdMap.size() < MAX_CACHE_ENTRIES && mIdMap.find(key) == mIdMap.end()) {
+            mIdMap[key] = CacheEntry{id, true};
+            mLoaded++;
+        }
+    }
+    fclose(fp);
+}
+
+status_t ResourceIdCache::save(const char* path) {
+    if (mIncludesFingerprint.isEmpty()) {
+        return NO_ERROR;
+    }
+    String8 tmpPath(path);
+    tmpPath.append(".tmp");
+    FILE* fp = fopen(tmpPath.string(), "w");
+    if (fp == NULL) {
+        fprintf(stderr, "WARNING: unable to write resource ID cache '%s': %s\n",
+                tmpPath.string(), strerror(errno));
+        return UNKNOWN_ERROR;
+    }
+    fprintf(fp, "%s\n%s\n", CACHE_FILE_MAGIC, mIncludesFingerprint.string());
+    for (const auto& item : mIdMap) {
+        if (item.second.persistent) {
+            fprintf(fp, "%08x %s\n", item.second.id, String8(item.first).string());
+        }
+    }
+    bool failed = ferror(fp) != 0;
+    failed = fclose(fp) != 0 || failed;
+    // renamed so a concurrent build never reads a partial cache
+    if (failed || rename(tmpPath.string(), path) != 0) {
+        fprintf(stderr, "WARNING: unable to write resource ID cache '%s'\n", path);
+        unlink(tmpPath.string());
+        return UNKNOWN_ERROR;
+    }
+    return NO_ERROR;
+}
+
 void ResourceIdCache::dump() {
     printf("ResourceIdCache dump:\n");
     printf("Size: %zd\n", mIdMap.size());
+    printf("Loaded: %zd\n", mLoaded);
     printf("Hits:   %zd\n", mHits);
     printf("Misses: %zd\n", mMisses);
-    printf("(Collisions: %zd)\n", mCollisions);
 }
 
 }
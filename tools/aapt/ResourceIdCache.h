@@ -7,6 +7,8 @@
 #define RESOURCE_ID_CACHE_H
 
 #include <utils/String16.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
 
 namespace android {
 
@@ -17,11 +19,19 @@ public:
             const String16& name,
             bool onlyPublic);
 
+    // The IDs of the included resources are persistent, they can be saved
+    // and reused by the next invocation with the same includes.
     static uint32_t store(const String16& package,
             const String16& type,
             const String16& name,
             bool onlyPublic,
-            uint32_t resId);
+            uint32_t resId,
+            bool persistent = false);
+
+    // Loads the persistent IDs saved to path, if they were resolved against
+    // the same included packages.
+    static void load(const char* path, const Vector<String8>& includes);
+    static status_t save(const char* path);
 
     static void dump(void);
 };
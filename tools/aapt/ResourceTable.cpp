@@ -2239,7 +2239,7 @@ uint32_t ResourceTable::getResId(const String16& package,
             }
         }
         
-        return ResourceIdCache::store(package, type, name, onlyPublic, rid);
+        return ResourceIdCache::store(package, type, name, onlyPublic, rid, true);
     }
 
     sp<Package> p = mPackages.valueFor(package);
@@ -528,6 +528,115 @@ bail:
     return result;
 }
 
+/*
+ * Add an entry from data that was already deflated.
+ */
+status_t ZipFile::addDeflated(const void* data, size_t size, unsigned long crc,
+    long uncompressedLen, const char* storageName, ZipEntry** ppEntry)
+{
+    ZipEntry* pEntry = NULL;
+    status_t result = NO_ERROR;
+    long lfhPosn, endPosn;
+
+    if (mReadOnly)
+        return INVALID_OPERATION;
+
+    /* make sure we're in a reasonable state */
+    assert(mZipFp != NULL);
+    assert(mEntries.size() == mEOCD.mTotalNumEntries);
+
+    /* make sure it doesn't already exist */
+    if (getEntryByName(storageName) != NULL)
+        return ALREADY_EXISTS;
+
+    if (fseek(mZipFp, mEOCD.mCentralDirOffset, SEEK_SET) != 0)
+        return UNKNOWN_ERROR;
+
+    pEntry = new ZipEntry;
+    pEntry->initNew(storageName, NULL);
+
+    mNeedCDRewrite = true;
+
+    /* write a place-holder LFH, then the data, as addCommon() does */
+    lfhPosn = ftell(mZipFp);
+    pEntry->mLFH.write(mZipFp);
+    if (size > 0 && fwrite(data, 1, size, mZipFp) != size) {
+        // don't need to truncate; happens in CDE rewrite
+        ALOGD("fwrite %d bytes failed\n", (int) size);
+        result = UNKNOWN_ERROR;
+        goto bail;
+    }
+    endPosn = ftell(mZipFp);
+
+    pEntry->setDataInfo(uncompressedLen, size, crc, ZipEntry::kCompressDeflated);
+    pEntry->setModWhen(0);
+    pEntry->setLFHOffset(lfhPosn);
+    mEOCD.mNumEntries++;
+    mEOCD.mTotalNumEntries++;
+    mEOCD.mCentralDirSize = 0;      // mark invalid; set by flush()
+    mEOCD.mCentralDirOffset = endPosn;
+
+    /*
+     * Go back and write the LFH.
+     */
+    if (fseek(mZipFp, lfhPosn, SEEK_SET) != 0) {
+        result = UNKNOWN_ERROR;
+        goto bail;
+    }
+    pEntry->mLFH.write(mZipFp);
+
+    mEntries.add(pEntry);
+    if (ppEntry != NULL)
+        *ppEntry = pEntry;
+    pEntry = NULL;
+
+bail:
+    delete pEntry;
+    return result;
+}
+
+/*
+ * Compress "data" into "*pOut" using Deflate, with the same settings as
+ * compressFpToFp().
+ */
+/*static*/ status_t ZipFile::deflateData(const void* data, size_t size,
+    std::vector<unsigned char>* pOut, unsigned long* pCRC32)
+{
+    z_stream zstream;
+    int zerr;
+
+    memset(&zstream, 0, sizeof(zstream));
+    zstream.zalloc = Z_NULL;
+    zstream.zfree = Z_NULL;
+    zstream.opaque = Z_NULL;
+    zstream.data_type = Z_UNKNOWN;
+
+    zerr = deflateInit2(&zstream, Z_BEST_COMPRESSION,
+        Z_DEFLATED, -MAX_WBITS, DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+    if (zerr != Z_OK) {
+        ALOGD("Call to deflateInit2 failed (zerr=%d)\n", zerr);
+        return UNKNOWN_ERROR;
+    }
+
+    // Large enough for the whole output, so that one call does it all.
+    pOut->resize(deflateBound(&zstream, size));
+    zstream.next_in = (Bytef*) data;
+    zstream.avail_in = size;
+    zstream.next_out = pOut->data();
+    zstream.avail_out = pOut->size();
+    zerr = deflate(&zstream, Z_FINISH);
+    if (zerr != Z_STREAM_END) {
+        ALOGD("zlib deflate call failed (zerr=%d)\n", zerr);
+        deflateEnd(&zstream);
+        return UNKNOWN_ERROR;
+    }
+    pOut->resize(zstream.total_out);
+    deflateEnd(&zstream);
+
+    *pCRC32 = crc32(crc32(0L, Z_NULL, 0), (const unsigned char*) data, size);
+    return NO_ERROR;
+}
+
 /*
  * Add an entry by copying it from another zip file.  If "padding" is
  * nonzero, the specified number of bytes will be added to the "extra"
@@ -25,6 +25,8 @@
 #include <utils/Errors.h>
 #include <stdio.h>
 
+#include <vector>
+
 #include "ZipEntry.h"
 
 namespace android {
@@ -116,6 +118,24 @@ public:
                          compressionMethod, ppEntry);
     }
 
+    /*
+     * Add an entry from data that was already compressed by deflateData().
+     * "crc" and "uncompressedLen" describe the data before it was
+     * compressed.
+     *
+     * If "ppEntry" is non-NULL, a pointer to the new entry will be returned.
+     */
+    status_t addDeflated(const void* data, size_t size, unsigned long crc,
+        long uncompressedLen, const char* storageName, ZipEntry** ppEntry);
+
+    /*
+     * Compress "data" with Deflate the way add() does, into "*pOut", and
+     * compute its CRC.  Doesn't touch any archive, so that files can be
+     * compressed on several threads and then added in order.
+     */
+    static status_t deflateData(const void* data, size_t size,
+        std::vector<unsigned char>* pOut, unsigned long* pCRC32);
+
     /*
      * Add an entry by copying it from another zip file.  If "padding" is
      * nonzero, the specified number of bytes will be added to the "extra"
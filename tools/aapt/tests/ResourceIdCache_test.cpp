@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <string>
+
+#include "ResourceIdCache.h"
+
+using android::ResourceIdCache;
+using android::String16;
+using android::String8;
+using android::Vector;
+
+static std::string readFile(const char* path) {
+    std::string content;
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL) return content;
+    char buf[256];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) content.append(buf, n);
+    fclose(fp);
+    return content;
+}
+
+TEST(ResourceIdCacheTest, namesDontRunTogether) {
+    ResourceIdCache::store(String16("a"), String16("bc"), String16("d"), true, 0x7f010001);
+    EXPECT_EQ(0x7f010001u,
+            ResourceIdCache::lookup(String16("a"), String16("bc"), String16("d"), true));
+    EXPECT_EQ(0u, ResourceIdCache::lookup(String16("a"), String16("b"), String16("cd"), true));
+    EXPECT_EQ(0u, ResourceIdCache::lookup(String16("a"), String16("bc"), String16("d"), false));
+}
+
+TEST(ResourceIdCacheTest, onlySavesPersistentIds) {
+    char include[] = "/tmp/aapt_include_XXXXXX";
+    int fd = mkstemp(include);
+    ASSERT_NE(-1, fd);
+    close(fd);
+    char cache[] = "/tmp/aapt_cache_XXXXXX";
+    fd = mkstemp(cache);
+    ASSERT_NE(-1, fd);
+    close(fd);
+
+    Vector<String8> includes;
+    includes.add(String8(include));
+    ResourceIdCache::load(cache, includes);
+
+    ResourceIdCache::store(String16("android"), String16("attr"), String16("text"), true,
+            0x0101014f, true);
+    ResourceIdCache::store(String16("com.app"), String16("string"), String16("name"), false,
+            0x7f020000);
+    ASSERT_EQ(android::NO_ERROR, ResourceIdCache::save(cache));
+
+    std::string content = readFile(cache);
+    EXPECT_NE(std::string::npos, content.find("0101014f android:attr/text/1\n"));
+    EXPECT_EQ(std::string::npos, content.find("com.app"));
+
+    unlink(include);
+    unlink(cache);
+}
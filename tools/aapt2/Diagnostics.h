@@ -20,6 +20,8 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "android-base/macros.h"
 #include "androidfw/StringPiece.h"
@@ -142,6 +144,30 @@ class SourcePathDiagnostics : public IDiagnostics {
   DISALLOW_COPY_AND_ASSIGN(SourcePathDiagnostics);
 };
 
+// Holds the diagnostics of work done on another thread, so that they can be logged in a
+// deterministic order once it's done.
+class BufferedDiagnostics : public IDiagnostics {
+ public:
+  BufferedDiagnostics() = default;
+
+  void Log(Level level, DiagMessageActual& actual_msg) override {
+    messages_.push_back(std::make_pair(level, actual_msg));
+  }
+
+  // Logs the diagnostics held so far to `diag`, in the order they were logged here.
+  void Replay(IDiagnostics* diag) {
+    for (auto& message : messages_) {
+      diag->Log(message.first, message.second);
+    }
+    messages_.clear();
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(BufferedDiagnostics);
+
+  std::vector<std::pair<Level, DiagMessageActual>> messages_;
+};
+
 }  // namespace aapt
 
 #endif /* AAPT_DIAGNOSTICS_H */
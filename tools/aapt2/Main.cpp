@@ -24,29 +24,20 @@
 #include <iostream>
 #include <vector>
 
-#include "android-base/stringprintf.h"
 #include "android-base/utf8.h"
 #include "androidfw/StringPiece.h"
 
 #include "Diagnostics.h"
+#include "process/SymbolTable.h"
 #include "util/Files.h"
 #include "util/Util.h"
 
 using ::android::StringPiece;
-using ::android::base::StringPrintf;
 
 namespace aapt {
 
-// DO NOT UPDATE, this is more of a marketing version.
-static const char* sMajorVersion = "2";
-
-// Update minor version whenever a feature or flag is added.
-static const char* sMinorVersion = "19";
-
 static void PrintVersion() {
-  std::cerr << StringPrintf("Android Asset Packaging Tool (aapt) %s:%s", sMajorVersion,
-                            sMinorVersion)
-            << std::endl;
+  std::cerr << "Android Asset Packaging Tool (aapt) " << util::GetToolFingerprint() << std::endl;
 }
 
 static void PrintUsage() {
@@ -83,6 +74,9 @@ static int ExecuteCommand(const StringPiece& command, const std::vector<StringPi
 }
 
 static void RunDaemon(IDiagnostics* diagnostics) {
+  // Every command parses the framework again otherwise.
+  AssetManagerSymbolSource::SetKeepFirstTableLoaded(true);
+
   std::cout << "Ready" << std::endl;
 
   // Run in daemon mode. The first line of input is the command. This can be 'quit' which ends
@@ -28,6 +28,7 @@
 #include "Resource.h"
 #include "ResourceUtils.h"
 #include "ValueVisitor.h"
+#include "util/SmallObjectAllocator.h"
 #include "util/Util.h"
 
 using ::aapt::text::Printer;
@@ -36,6 +37,14 @@ using ::android::base::StringPrintf;
 
 namespace aapt {
 
+void* Value::operator new(size_t size) {
+  return util::AllocateSmallObject(size);
+}
+
+void Value::operator delete(void* ptr, size_t size) {
+  util::FreeSmallObject(ptr, size);
+}
+
 void Value::PrettyPrint(Printer* printer) const {
   std::ostringstream str_stream;
   Print(&str_stream);
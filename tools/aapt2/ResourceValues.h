@@ -113,6 +113,16 @@ class Value {
 
   friend std::ostream& operator<<(std::ostream& out, const Value& value);
 
+  // Values are small and a table holds a lot of them, so they're allocated with
+  // util::AllocateSmallObject() instead of one by one from the heap.
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+
+  // For Maybe<T> and the like, which construct values in their own storage.
+  static void* operator new(size_t size, void* ptr) {
+    return ptr;
+  }
+
  protected:
   Source source_;
   std::string comment_;
@@ -23,32 +23,35 @@
 #include "android-base/stringprintf.h"
 #include "androidfw/StringPiece.h"
 
+#include "util/InternedString.h"
 #include "util/Maybe.h"
 
 namespace aapt {
 
 // Represents a file on disk. Used for logging and showing errors.
 struct Source {
-  std::string path;
+  // Interned, every value parsed from a file has a Source with the same path.
+  InternedString path;
   Maybe<size_t> line;
 
   Source() = default;
 
-  inline Source(const android::StringPiece& path) : path(path.to_string()) {  // NOLINT(implicit)
+  inline Source(const android::StringPiece& path) : path(path) {  // NOLINT(implicit)
   }
 
-  inline Source(const android::StringPiece& path, size_t line)
-      : path(path.to_string()), line(line) {}
+  inline Source(const android::StringPiece& path, size_t line) : path(path), line(line) {}
 
   inline Source WithLine(size_t line) const {
-    return Source(path, line);
+    Source source = *this;
+    source.line = line;
+    return source;
   }
 
   std::string to_string() const {
     if (line) {
       return ::android::base::StringPrintf("%s:%zd", path.c_str(), line.value());
     }
-    return path;
+    return path.str();
   }
 };
 
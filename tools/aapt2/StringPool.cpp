@@ -17,14 +17,17 @@
 #include "StringPool.h"
 
 #include <algorithm>
+#include <map>
 #include <memory>
 #include <string>
+#include <thread>
 
 #include "android-base/logging.h"
 #include "androidfw/ResourceTypes.h"
 #include "androidfw/StringPiece.h"
 
 #include "util/BigBuffer.h"
+#include "util/Parallel.h"
 #include "util/Util.h"
 
 using ::android::StringPiece;
@@ -295,24 +298,128 @@ void StringPool::Prune() {
   ReAssignIndices();
 }
 
+// Pools with fewer strings than this are sorted and flattened on the calling thread.
+constexpr static const size_t kParallelMinStrings = 16u * 1024u;
+
+// The smallest number of strings sorted or encoded by one task.
+constexpr static const size_t kParallelChunkSize = 4u * 1024u;
+
+// Splits [0, count) into chunks of at least `chunk_size` and calls produce(chunk, begin, end) for
+// each of them, on several threads if there are enough, and consume(chunk, begin, end) on the
+// calling thread in order.
+template <typename Produce, typename Consume>
+static void ForEachChunk(size_t count, size_t chunk_size, Produce produce, Consume consume) {
+  chunk_size = std::max(chunk_size, kParallelChunkSize);
+  const size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+  auto range = [&](size_t chunk, const auto& f) {
+    f(chunk, chunk * chunk_size, std::min(count, (chunk + 1) * chunk_size));
+  };
+
+  if (count < kParallelMinStrings || chunk_count < 2) {
+    for (size_t i = 0; i < chunk_count; i++) {
+      range(i, produce);
+      range(i, consume);
+    }
+    return;
+  }
+
+  util::ParallelForInOrder(chunk_count, std::thread::hardware_concurrency(),
+                           [&](size_t i) { range(i, produce); },
+                           [&](size_t i) {
+                             range(i, consume);
+                             return true;
+                           });
+}
+
+// What the entries are sorted by. The context is reduced to its rank among the contexts of the
+// pool, so that comparing two entries doesn't call the context comparison function.
+struct SortKey {
+  uint32_t context_rank;
+  const std::string* value;
+
+  // Makes the order deterministic, whichever way the entries were sorted.
+  size_t index;
+};
+
+static bool SortKeyLess(const SortKey& a, const SortKey& b) {
+  if (a.context_rank != b.context_rank) {
+    return a.context_rank < b.context_rank;
+  }
+  const int r = a.value->compare(*b.value);
+  return r != 0 ? r < 0 : a.index < b.index;
+}
+
+// Returns the rank of the context of each entry, such that entries compare with `cmp` the way
+// their ranks compare. `cmp` is only called on the distinct contexts.
+template <typename E>
+static std::vector<uint32_t> RankContexts(
+    const std::vector<std::unique_ptr<E>>& entries,
+    const std::function<int(const StringPool::Context&, const StringPool::Context&)>& cmp) {
+  std::vector<uint32_t> ranks(entries.size(), 0u);
+  if (cmp == nullptr) {
+    return ranks;
+  }
+
+  auto context_less = [](const StringPool::Context* a, const StringPool::Context* b) -> bool {
+    return a->priority != b->priority ? a->priority < b->priority : a->config < b->config;
+  };
+  std::map<const StringPool::Context*, uint32_t, decltype(context_less)> ranks_by_context(
+      context_less);
+  for (const std::unique_ptr<E>& entry : entries) {
+    ranks_by_context.insert({&entry->context, 0u});
+  }
+
+  std::vector<const StringPool::Context*> contexts;
+  for (const auto& pair : ranks_by_context) {
+    contexts.push_back(pair.first);
+  }
+  std::stable_sort(contexts.begin(), contexts.end(),
+                   [&cmp](const StringPool::Context* a, const StringPool::Context* b) -> bool {
+                     return cmp(*a, *b) < 0;
+                   });
+
+  uint32_t rank = 0u;
+  for (size_t i = 0; i < contexts.size(); i++) {
+    if (i != 0 && cmp(*contexts[i - 1], *contexts[i]) != 0) {
+      rank++;
+    }
+    ranks_by_context[contexts[i]] = rank;
+  }
+
+  for (size_t i = 0; i < entries.size(); i++) {
+    ranks[i] = ranks_by_context.find(&entries[i]->context)->second;
+  }
+  return ranks;
+}
+
 template <typename E>
 static void SortEntries(
     std::vector<std::unique_ptr<E>>& entries,
     const std::function<int(const StringPool::Context&, const StringPool::Context&)>& cmp) {
-  using UEntry = std::unique_ptr<E>;
+  const std::vector<uint32_t> ranks = RankContexts(entries, cmp);
+  std::vector<SortKey> keys;
+  keys.reserve(entries.size());
+  for (size_t i = 0; i < entries.size(); i++) {
+    keys.push_back(SortKey{ranks[i], &entries[i]->value, i});
+  }
 
-  if (cmp != nullptr) {
-    std::sort(entries.begin(), entries.end(), [&cmp](const UEntry& a, const UEntry& b) -> bool {
-      int r = cmp(a->context, b->context);
-      if (r == 0) {
-        r = a->value.compare(b->value);
-      }
-      return r < 0;
-    });
-  } else {
-    std::sort(entries.begin(), entries.end(),
-              [](const UEntry& a, const UEntry& b) -> bool { return a->value < b->value; });
+  // Sorts one chunk per thread, and merges each chunk into the ones before it as they're done.
+  const size_t jobs = std::max(std::thread::hardware_concurrency(), 1u);
+  ForEachChunk(keys.size(), (keys.size() + jobs - 1) / jobs,
+               [&](size_t, size_t begin, size_t end) {
+                 std::sort(keys.begin() + begin, keys.begin() + end, SortKeyLess);
+               },
+               [&](size_t, size_t begin, size_t end) {
+                 std::inplace_merge(keys.begin(), keys.begin() + begin, keys.begin() + end,
+                                    SortKeyLess);
+               });
+
+  std::vector<std::unique_ptr<E>> sorted;
+  sorted.reserve(entries.size());
+  for (const SortKey& key : keys) {
+    sorted.push_back(std::move(entries[key.index]));
   }
+  entries = std::move(sorted);
 }
 
 void StringPool::Sort(const std::function<int(const Context&, const Context&)>& cmp) {
@@ -452,15 +559,42 @@ bool StringPool::Flatten(BigBuffer* out, const StringPool& pool, bool utf8,
   header->stringsStart = before_strings_index - start_index;
 
   // Styles always come first.
-  for (const std::unique_ptr<StyleEntry>& entry : pool.styles_) {
-    *indices++ = out->size() - before_strings_index;
-    no_error = EncodeString(entry->value, utf8, out, diag) && no_error;
-  }
-
-  for (const std::unique_ptr<Entry>& entry : pool.strings_) {
-    *indices++ = out->size() - before_strings_index;
-    no_error = EncodeString(entry->value, utf8, out, diag) && no_error;
-  }
+  const size_t style_count = pool.styles_.size();
+  auto string_at = [&](size_t i) -> const std::string& {
+    return i < style_count ? pool.styles_[i]->value : pool.strings_[i - style_count]->value;
+  };
+
+  // The strings are encoded in chunks, on several threads for large pools, and the chunks are
+  // then appended in order.
+  struct EncodedChunk {
+    BigBuffer buffer{32u * 1024u};
+    std::vector<uint32_t> offsets;
+    BufferedDiagnostics diag;
+    bool no_error = true;
+  };
+  std::vector<std::unique_ptr<EncodedChunk>> chunks(
+      (style_count + pool.strings_.size() + kParallelChunkSize - 1) / kParallelChunkSize);
+  ForEachChunk(style_count + pool.strings_.size(), kParallelChunkSize,
+               [&](size_t chunk_index, size_t begin, size_t end) {
+                 std::unique_ptr<EncodedChunk> chunk = util::make_unique<EncodedChunk>();
+                 for (size_t i = begin; i < end; i++) {
+                   chunk->offsets.push_back(chunk->buffer.size());
+                   chunk->no_error =
+                       EncodeString(string_at(i), utf8, &chunk->buffer, &chunk->diag) &&
+                       chunk->no_error;
+                 }
+                 chunks[chunk_index] = std::move(chunk);
+               },
+               [&](size_t chunk_index, size_t, size_t) {
+                 std::unique_ptr<EncodedChunk> chunk = std::move(chunks[chunk_index]);
+                 const size_t chunk_start = out->size() - before_strings_index;
+                 for (uint32_t offset : chunk->offsets) {
+                   *indices++ = chunk_start + offset;
+                 }
+                 chunk->diag.Replay(diag);
+                 no_error = chunk->no_error && no_error;
+                 out->AppendBuffer(std::move(chunk->buffer));
+               });
 
   out->Align4();
 
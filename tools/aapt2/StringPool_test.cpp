@@ -352,4 +352,44 @@ TEST(StringPoolTest, MaxEncodingLength) {
   EXPECT_THAT(util::GetString16(test, 0), Eq(longStr16));
 }
 
+TEST(StringPoolTest, SortAndFlattenLargePool) {
+  using namespace android;  // For NO_ERROR on Windows.
+  StdErrDiagnostics diag;
+
+  // Enough strings to be sorted and flattened in several chunks.
+  constexpr size_t kCount = 50000u;
+  StringPool pool;
+  std::vector<StringPool::Ref> refs;
+  for (size_t i = 0; i < kCount; i++) {
+    const uint32_t priority =
+        i % 2 == 0 ? StringPool::Context::kHighPriority : StringPool::Context::kLowPriority;
+    refs.push_back(
+        pool.MakeRef(std::to_string((i * 7919u) % kCount), StringPool::Context(priority)));
+  }
+
+  pool.Sort([](const StringPool::Context& a, const StringPool::Context& b) -> int {
+    return util::compare(a.priority, b.priority);
+  });
+
+  for (size_t i = 1; i < kCount; i++) {
+    const StringPool::Entry& prev = *pool.strings()[i - 1];
+    const StringPool::Entry& entry = *pool.strings()[i];
+    ASSERT_TRUE(prev.context.priority < entry.context.priority ||
+                (prev.context.priority == entry.context.priority && prev.value < entry.value));
+  }
+  for (const StringPool::Ref& ref : refs) {
+    ASSERT_THAT(pool.strings()[ref.index()]->value, Eq(*ref));
+  }
+
+  BigBuffer buffer(1024);
+  ASSERT_TRUE(StringPool::FlattenUtf8(&buffer, pool, &diag));
+  std::unique_ptr<uint8_t[]> data = util::Copy(buffer);
+  ResStringPool test;
+  ASSERT_EQ(test.setTo(data.get(), buffer.size()), NO_ERROR);
+  ASSERT_THAT(test.size(), Eq(kCount));
+  for (const StringPool::Ref& ref : refs) {
+    ASSERT_THAT(util::GetString(test, ref.index()), Eq(*ref));
+  }
+}
+
 }  // namespace aapt
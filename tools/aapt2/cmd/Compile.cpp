@@ -16,6 +16,8 @@
 
 #include <dirent.h>
 
+#include <deque>
+#include <fstream>
 #include <string>
 
 #include "android-base/errors.h"
@@ -30,9 +32,12 @@
 #include "Flags.h"
 #include "ResourceParser.h"
 #include "ResourceTable.h"
+#include "ResourceUtils.h"
+#include "cmd/Util.h"
 #include "compile/IdAssigner.h"
 #include "compile/InlineXmlFormatParser.h"
 #include "compile/Png.h"
+#include "compile/PngCache.h"
 #include "compile/PseudolocaleGenerator.h"
 #include "compile/XmlIdCollector.h"
 #include "format/Archive.h"
@@ -42,8 +47,10 @@
 #include "io/FileStream.h"
 #include "io/StringStream.h"
 #include "io/Util.h"
+#include "trace/TraceBuffer.h"
 #include "util/Files.h"
 #include "util/Maybe.h"
+#include "util/Parallel.h"
 #include "util/Util.h"
 #include "xml/XmlDom.h"
 #include "xml/XmlPullParser.h"
@@ -124,10 +131,12 @@ struct CompileOptions {
   std::string output_path;
   Maybe<std::string> res_dir;
   Maybe<std::string> generate_text_symbols_path;
+  Maybe<std::string> png_cache_dir;
   bool pseudolocalize = false;
   bool no_png_crunch = false;
   bool legacy_mode = false;
   bool verbose = false;
+  size_t jobs = 1;
 };
 
 static std::string BuildIntermediateContainerFilename(const ResourcePathData& data) {
@@ -500,6 +509,90 @@ static bool CompileXml(IAaptContext* context, const CompileOptions& options,
   return true;
 }
 
+// Crunches the PNG `content` into `buffer`, or filters it if crunching doesn't make it smaller.
+static bool CrunchPng(IAaptContext* context, const ResourcePathData& path_data,
+                      const std::string& content, BigBuffer* buffer) {
+  BigBuffer crunched_png_buffer(4096);
+  io::BigBufferOutputStream crunched_png_buffer_out(&crunched_png_buffer);
+
+  // Ensure that we only keep the chunks we care about if we end up
+  // using the original PNG instead of the crunched one.
+  PngChunkFilter png_chunk_filter(content);
+  std::unique_ptr<Image> image = ReadPng(context, path_data.source, &png_chunk_filter);
+  if (!image) {
+    return false;
+  }
+
+  std::unique_ptr<NinePatch> nine_patch;
+  if (path_data.extension == "9.png") {
+    std::string err;
+    nine_patch = NinePatch::Create(image->rows.get(), image->width, image->height, &err);
+    if (!nine_patch) {
+      context->GetDiagnostics()->Error(DiagMessage() << err);
+      return false;
+    }
+
+    // Remove the 1px border around the NinePatch.
+    // Basically the row array is shifted up by 1, and the length is treated
+    // as height - 2.
+    // For each row, shift the array to the left by 1, and treat the length as
+    // width - 2.
+    image->width -= 2;
+    image->height -= 2;
+    memmove(image->rows.get(), image->rows.get() + 1, image->height * sizeof(uint8_t**));
+    for (int32_t h = 0; h < image->height; h++) {
+      memmove(image->rows[h], image->rows[h] + 4, image->width * 4);
+    }
+
+    if (context->IsVerbose()) {
+      context->GetDiagnostics()->Note(DiagMessage(path_data.source) << "9-patch: "
+                                                                    << *nine_patch);
+    }
+  }
+
+  // Write the crunched PNG.
+  if (!WritePng(context, image.get(), nine_patch.get(), &crunched_png_buffer_out, {})) {
+    return false;
+  }
+
+  if (nine_patch != nullptr ||
+      crunched_png_buffer_out.ByteCount() <= png_chunk_filter.ByteCount()) {
+    // No matter what, we must use the re-encoded PNG, even if it is larger.
+    // 9-patch images must be re-encoded since their borders are stripped.
+    buffer->AppendBuffer(std::move(crunched_png_buffer));
+  } else {
+    // The re-encoded PNG is larger than the original, and there is
+    // no mandatory transformation. Use the original.
+    if (context->IsVerbose()) {
+      context->GetDiagnostics()->Note(DiagMessage(path_data.source)
+                                      << "original PNG is smaller than crunched PNG"
+                                      << ", using original");
+    }
+
+    png_chunk_filter.Rewind();
+    BigBuffer filtered_png_buffer(4096);
+    io::BigBufferOutputStream filtered_png_buffer_out(&filtered_png_buffer);
+    io::Copy(&filtered_png_buffer_out, &png_chunk_filter);
+    buffer->AppendBuffer(std::move(filtered_png_buffer));
+  }
+
+  if (context->IsVerbose()) {
+    // For debugging only, use the legacy PNG cruncher and compare the resulting file sizes.
+    // This will help catch exotic cases where the new code may generate larger PNGs.
+    std::stringstream legacy_stream(content);
+    BigBuffer legacy_buffer(4096);
+    Png png(context->GetDiagnostics());
+    if (!png.process(path_data.source, &legacy_stream, &legacy_buffer, {})) {
+      return false;
+    }
+
+    context->GetDiagnostics()->Note(DiagMessage(path_data.source)
+                                    << "legacy=" << legacy_buffer.size()
+                                    << " new=" << buffer->size());
+  }
+  return true;
+}
+
 static bool CompilePng(IAaptContext* context, const CompileOptions& options,
                        const ResourcePathData& path_data, IArchiveWriter* writer,
                        const std::string& output_path) {
@@ -524,83 +617,27 @@ static bool CompilePng(IAaptContext* context, const CompileOptions& options,
       return false;
     }
 
-    BigBuffer crunched_png_buffer(4096);
-    io::BigBufferOutputStream crunched_png_buffer_out(&crunched_png_buffer);
-
-    // Ensure that we only keep the chunks we care about if we end up
-    // using the original PNG instead of the crunched one.
-    PngChunkFilter png_chunk_filter(content);
-    std::unique_ptr<Image> image = ReadPng(context, path_data.source, &png_chunk_filter);
-    if (!image) {
-      return false;
-    }
-
-    std::unique_ptr<NinePatch> nine_patch;
-    if (path_data.extension == "9.png") {
-      std::string err;
-      nine_patch = NinePatch::Create(image->rows.get(), image->width, image->height, &err);
-      if (!nine_patch) {
-        context->GetDiagnostics()->Error(DiagMessage() << err);
+    if (!options.png_cache_dir) {
+      if (!CrunchPng(context, path_data, content, &buffer)) {
         return false;
       }
-
-      // Remove the 1px border around the NinePatch.
-      // Basically the row array is shifted up by 1, and the length is treated
-      // as height - 2.
-      // For each row, shift the array to the left by 1, and treat the length as
-      // width - 2.
-      image->width -= 2;
-      image->height -= 2;
-      memmove(image->rows.get(), image->rows.get() + 1, image->height * sizeof(uint8_t**));
-      for (int32_t h = 0; h < image->height; h++) {
-        memmove(image->rows[h], image->rows[h] + 4, image->width * 4);
-      }
-
-      if (context->IsVerbose()) {
-        context->GetDiagnostics()->Note(DiagMessage(path_data.source) << "9-patch: "
-                                                                      << *nine_patch);
-      }
-    }
-
-    // Write the crunched PNG.
-    if (!WritePng(context, image.get(), nine_patch.get(), &crunched_png_buffer_out, {})) {
-      return false;
-    }
-
-    if (nine_patch != nullptr ||
-        crunched_png_buffer_out.ByteCount() <= png_chunk_filter.ByteCount()) {
-      // No matter what, we must use the re-encoded PNG, even if it is larger.
-      // 9-patch images must be re-encoded since their borders are stripped.
-      buffer.AppendBuffer(std::move(crunched_png_buffer));
     } else {
-      // The re-encoded PNG is larger than the original, and there is
-      // no mandatory transformation. Use the original.
-      if (context->IsVerbose()) {
-        context->GetDiagnostics()->Note(DiagMessage(path_data.source)
-                                        << "original PNG is smaller than crunched PNG"
-                                        << ", using original");
-      }
-
-      png_chunk_filter.Rewind();
-      BigBuffer filtered_png_buffer(4096);
-      io::BigBufferOutputStream filtered_png_buffer_out(&filtered_png_buffer);
-      io::Copy(&filtered_png_buffer_out, &png_chunk_filter);
-      buffer.AppendBuffer(std::move(filtered_png_buffer));
-    }
-
-    if (context->IsVerbose()) {
-      // For debugging only, use the legacy PNG cruncher and compare the resulting file sizes.
-      // This will help catch exotic cases where the new code may generate larger PNGs.
-      std::stringstream legacy_stream(content);
-      BigBuffer legacy_buffer(4096);
-      Png png(context->GetDiagnostics());
-      if (!png.process(path_data.source, &legacy_stream, &legacy_buffer, {})) {
-        return false;
+      // 9-patches are crunched differently, their borders are stripped.
+      const PngCache png_cache(options.png_cache_dir.value());
+      const std::string key = PngCache::Key(content, path_data.extension);
+      if (png_cache.Get(key, &buffer)) {
+        if (context->IsVerbose()) {
+          context->GetDiagnostics()->Note(DiagMessage(path_data.source) << "using cached PNG");
+        }
+      } else {
+        if (!CrunchPng(context, path_data, content, &buffer)) {
+          return false;
+        }
+        if (!png_cache.Put(key, buffer)) {
+          context->GetDiagnostics()->Warn(DiagMessage(path_data.source)
+                                          << "failed to store crunched PNG in the cache");
+        }
       }
-
-      context->GetDiagnostics()->Note(DiagMessage(path_data.source)
-                                      << "legacy=" << legacy_buffer.size()
-                                      << " new=" << buffer.size());
     }
   }
 
@@ -694,12 +731,221 @@ class CompileContext : public IAaptContext {
   bool verbose_ = false;
 };
 
+// Compiles one input file into the writer, picking how from its path.
+static bool CompileInput(IAaptContext* context, const CompileOptions& options,
+                         ResourcePathData* path_data, IArchiveWriter* writer) {
+  if (options.verbose) {
+    context->GetDiagnostics()->Note(DiagMessage(path_data->source) << "processing");
+  }
+
+  if (!IsValidFile(context, path_data->source.path)) {
+    return false;
+  }
+
+  // Determine how to compile the file based on its type.
+  auto compile_func = &CompileFile;
+  const char* trace_name = "Compile: file";
+  if (path_data->resource_dir == "values" && path_data->extension == "xml") {
+    compile_func = &CompileTable;
+    trace_name = "Compile: values";
+    // We use a different extension (not necessary anymore, but avoids altering the existing
+    // build system logic).
+    path_data->extension = "arsc";
+
+  } else if (const ResourceType* type = ParseResourceType(path_data->resource_dir)) {
+    if (*type != ResourceType::kRaw) {
+      if (path_data->extension == "xml") {
+        compile_func = &CompileXml;
+        trace_name = "Compile: XML";
+      } else if ((!options.no_png_crunch && path_data->extension == "png")
+          || path_data->extension == "9.png") {
+        compile_func = &CompilePng;
+        trace_name = "Compile: PNG";
+      }
+    }
+  } else {
+    context->GetDiagnostics()->Error(DiagMessage()
+                                     << "invalid file path '" << path_data->source << "'");
+    return false;
+  }
+
+  // Treat periods as a reserved character that should not be present in a file name
+  // Legacy support for AAPT which did not reserve periods
+  if (compile_func != &CompileFile && !options.legacy_mode
+      && std::count(path_data->name.begin(), path_data->name.end(), '.') != 0) {
+    context->GetDiagnostics()->Error(DiagMessage() << "resource file '" << path_data->source.path
+                                                   << "' name cannot contain '.' other than for"
+                                                   << "specifying the extension");
+    return false;
+  }
+
+  // Compile the file.
+  tracebuffer::Trace trace(trace_name, path_data->source.path);
+  if (tracebuffer::IsEnabled()) {
+    std::ifstream in(path_data->source.path, std::ios::binary | std::ios::ate);
+    trace.SetBytes(in ? static_cast<uint64_t>(in.tellg()) : 0u);
+  }
+  const std::string out_path = BuildIntermediateContainerFilename(*path_data);
+  return compile_func(context, options, *path_data, writer, out_path);
+}
+
+// Holds the entries of a file compiled on a worker thread in memory, so that they can be written
+// to the archive in input order and the archive is the same whatever the number of jobs.
+class BufferedArchiveWriter : public IArchiveWriter {
+ public:
+  BufferedArchiveWriter() = default;
+
+  bool WriteFile(const StringPiece& path, uint32_t flags, io::InputStream* in) override {
+    if (!StartEntry(path, flags)) {
+      return false;
+    }
+
+    const void* data = nullptr;
+    size_t len = 0;
+    while (in->Next(&data, &len)) {
+      Write(data, static_cast<int>(len));
+    }
+    if (in->HadError()) {
+      entries_.pop_back();
+      current_ = nullptr;
+      return false;
+    }
+    current_->whole_file = true;
+    return FinishEntry();
+  }
+
+  bool StartEntry(const StringPiece& path, uint32_t flags) override {
+    if (current_) {
+      return false;
+    }
+    entries_.push_back(Entry{path.to_string(), flags, util::make_unique<BigBuffer>(4096u)});
+    current_ = &entries_.back();
+    return true;
+  }
+
+  bool Write(const void* data, int len) override {
+    if (!current_) {
+      return false;
+    }
+    memcpy(current_->buffer->NextBlock<uint8_t>(len), data, len);
+    return true;
+  }
+
+  bool FinishEntry() override {
+    if (!current_) {
+      return false;
+    }
+    current_->finished = true;
+    current_ = nullptr;
+    return true;
+  }
+
+  bool HadError() const override {
+    return false;
+  }
+
+  std::string GetError() const override {
+    return {};
+  }
+
+  // Writes the finished entries to the writer, in the order they were written here.
+  bool WriteTo(IArchiveWriter* writer, IDiagnostics* diag) {
+    for (const Entry& entry : entries_) {
+      if (!entry.finished) {
+        continue;
+      }
+
+      if (entry.whole_file) {
+        io::BigBufferInputStream in(entry.buffer.get());
+        if (!writer->WriteFile(entry.path, entry.flags, &in)) {
+          diag->Error(DiagMessage(entry.path) << "failed to write file");
+          return false;
+        }
+        continue;
+      }
+
+      if (!writer->StartEntry(entry.path, entry.flags)) {
+        diag->Error(DiagMessage(entry.path) << "failed to open file");
+        return false;
+      }
+      for (const BigBuffer::Block& block : *entry.buffer) {
+        if (!writer->Write(block.buffer.get(), static_cast<int>(block.size))) {
+          diag->Error(DiagMessage(entry.path) << "failed to write entry data");
+          return false;
+        }
+      }
+      if (!writer->FinishEntry()) {
+        diag->Error(DiagMessage(entry.path) << "failed to finish writing data");
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(BufferedArchiveWriter);
+
+  struct Entry {
+    std::string path;
+    uint32_t flags;
+    std::unique_ptr<BigBuffer> buffer;
+    // Written with WriteFile() rather than StartEntry(), the writer may store it differently.
+    bool whole_file = false;
+    bool finished = false;
+  };
+
+  // A deque so that current_ stays valid as entries are added.
+  std::deque<Entry> entries_;
+  Entry* current_ = nullptr;
+};
+
+// The result of compiling one input file on a worker thread.
+struct CompileJob {
+  BufferedDiagnostics diagnostics;
+  BufferedArchiveWriter writer;
+  bool success = false;
+};
+
+// Compiles the input files on options.jobs threads. Each file is compiled with its own context
+// into memory, then its diagnostics and entries are passed on in input order, so that the output
+// doesn't depend on the scheduling.
+static bool CompileInputsInParallel(CompileContext* context, const CompileOptions& options,
+                                    std::vector<ResourcePathData>* input_data,
+                                    IArchiveWriter* writer) {
+  std::vector<std::unique_ptr<CompileJob>> jobs(input_data->size());
+  for (std::unique_ptr<CompileJob>& job : jobs) {
+    job = util::make_unique<CompileJob>();
+  }
+
+  bool error = false;
+  util::ParallelForInOrder(
+      input_data->size(), options.jobs,
+      [&](size_t i) {
+        CompileJob* job = jobs[i].get();
+        CompileContext job_context(&job->diagnostics);
+        job_context.SetVerbose(context->IsVerbose());
+        job->success = CompileInput(&job_context, options, &(*input_data)[i], &job->writer);
+      },
+      [&](size_t i) {
+        jobs[i]->diagnostics.Replay(context->GetDiagnostics());
+        error |= !jobs[i]->success;
+        error |= !jobs[i]->writer.WriteTo(writer, context->GetDiagnostics());
+        // The worker threads are done with it, free its entries.
+        jobs[i].reset();
+        return true;
+      });
+  return !error;
+}
+
 // Entry point for compilation phase. Parses arguments and dispatches to the correct steps.
 int Compile(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
   CompileContext context(diagnostics);
   CompileOptions options;
 
   bool verbose = false;
+  Maybe<std::string> jobs;
+  Maybe<std::string> trace_file;
+  bool print_stats = false;
   Flags flags =
       Flags()
           .RequiredFlag("-o", "Output path", &options.output_path)
@@ -713,14 +959,52 @@ int Compile(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
                           "(en-XA and ar-XB)",
                           &options.pseudolocalize)
           .OptionalSwitch("--no-crunch", "Disables PNG processing", &options.no_png_crunch)
+          .OptionalFlag("--png-cache",
+                        "Directory where crunched PNGs are kept, keyed by their content,\n"
+                        "so that unchanged PNGs aren't crunched again",
+                        &options.png_cache_dir)
           .OptionalSwitch("--legacy", "Treat errors that used to be valid in AAPT as warnings",
                           &options.legacy_mode)
+          .OptionalFlag("-j",
+                        "Number of files to compile in parallel. Diagnostics and outputs\n"
+                        "are in the same order as with one job. Defaults to 1",
+                        &jobs)
+          .OptionalFlag("--trace-file",
+                        "Writes the time spent in each phase and on each file to this\n"
+                        "file, in the Chrome trace event JSON format",
+                        &trace_file)
+          .OptionalSwitch("--stats", "Prints the time spent in each phase", &print_stats)
           .OptionalSwitch("-v", "Enables verbose logging", &verbose);
   if (!flags.Parse("aapt2 compile", args, &std::cerr)) {
     return 1;
   }
 
   context.SetVerbose(verbose);
+  if (trace_file || print_stats) {
+    tracebuffer::Enable();
+  }
+
+  if (jobs) {
+    const Maybe<uint32_t> maybe_jobs = ResourceUtils::ParseInt(jobs.value());
+    if (!maybe_jobs || maybe_jobs.value() == 0) {
+      context.GetDiagnostics()->Error(DiagMessage() << "-j '" << jobs.value()
+                                                    << "' is not a valid number of jobs");
+      return 1;
+    }
+    options.jobs = maybe_jobs.value();
+
+    // Every file overwrites the text symbols, they would race.
+    if (options.generate_text_symbols_path) {
+      options.jobs = 1;
+    }
+  }
+
+  if (options.png_cache_dir && !file::mkdirs(options.png_cache_dir.value())) {
+    context.GetDiagnostics()->Error(DiagMessage(options.png_cache_dir.value())
+                                    << "failed to create directory: "
+                                    << SystemErrorCodeToString(errno));
+    return 1;
+  }
 
   std::unique_ptr<IArchiveWriter> archive_writer;
 
@@ -760,56 +1044,16 @@ int Compile(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
     return 1;
   }
 
-  bool error = false;
-  for (ResourcePathData& path_data : input_data) {
-    if (options.verbose) {
-      context.GetDiagnostics()->Note(DiagMessage(path_data.source) << "processing");
-    }
-
-    if (!IsValidFile(&context, path_data.source.path)) {
-      error = true;
-      continue;
-    }
-
-    // Determine how to compile the file based on its type.
-    auto compile_func = &CompileFile;
-    if (path_data.resource_dir == "values" && path_data.extension == "xml") {
-      compile_func = &CompileTable;
-      // We use a different extension (not necessary anymore, but avoids altering the existing
-      // build system logic).
-      path_data.extension = "arsc";
-
-    } else if (const ResourceType* type = ParseResourceType(path_data.resource_dir)) {
-      if (*type != ResourceType::kRaw) {
-        if (path_data.extension == "xml") {
-          compile_func = &CompileXml;
-        } else if ((!options.no_png_crunch && path_data.extension == "png")
-            || path_data.extension == "9.png") {
-          compile_func = &CompilePng;
-        }
-      }
-    } else {
-      context.GetDiagnostics()->Error(DiagMessage()
-                                      << "invalid file path '" << path_data.source << "'");
-      error = true;
-      continue;
-    }
-
-    // Treat periods as a reserved character that should not be present in a file name
-    // Legacy support for AAPT which did not reserve periods
-    if (compile_func != &CompileFile && !options.legacy_mode
-        && std::count(path_data.name.begin(), path_data.name.end(), '.') != 0) {
-      error = true;
-      context.GetDiagnostics()->Error(DiagMessage() << "resource file '" << path_data.source.path
-                                                    << "' name cannot contain '.' other than for"
-                                                    << "specifying the extension");
-      continue;
+  bool error;
+  if (options.jobs > 1 && input_data.size() > 1) {
+    error = !CompileInputsInParallel(&context, options, &input_data, archive_writer.get());
+  } else {
+    error = false;
+    for (ResourcePathData& path_data : input_data) {
+      error |= !CompileInput(&context, options, &path_data, archive_writer.get());
     }
-
-    // Compile the file.
-    const std::string out_path = BuildIntermediateContainerFilename(path_data);
-    error |= !compile_func(&context, options, path_data, archive_writer.get(), out_path);
   }
+  error |= !FinishTrace(trace_file, print_stats, context.GetDiagnostics());
   return error ? 1 : 0;
 }
 
@@ -17,6 +17,7 @@
 #include "Compile.h"
 
 #include "android-base/file.h"
+#include "android-base/test_utils.h"
 #include "io/StringStream.h"
 #include "java/AnnotationProcessor.h"
 #include "test/Test.h"
@@ -91,6 +92,45 @@ TEST(CompilerTest, MultiplePeriods) {
   ASSERT_NE(remove(path5_out.c_str()), 0);
   ASSERT_EQ(TestCompile(path5, kResDir, /** legacy */ true, diag), 0);
   ASSERT_EQ(remove(path5_out.c_str()), 0);
+TEST(CompilerTest, ParallelCompileMatchesSerial) {
+  StdErrDiagnostics diag;
+  const std::string kResDir = android::base::Dirname(android::base::GetExecutablePath())
+      + "/integration-tests/CompileTest/res";
+  const std::vector<std::string> kOutputs = {"values_values.arsc.flat",
+                                             "drawable_image.png.flat",
+                                             "drawable_image.9.png.flat"};
+
+  auto compile = [&](const std::string& out_dir, const char* jobs) {
+    const std::vector<std::string> paths = {kResDir + "/values/values.xml",
+                                            kResDir + "/drawable/image.png",
+                                            kResDir + "/drawable/image.9.png"};
+    std::vector<android::StringPiece> args(paths.begin(), paths.end());
+    args.push_back("-o");
+    args.push_back(out_dir);
+    args.push_back("-j");
+    args.push_back(jobs);
+    return aapt::Compile(args, &diag);
+  };
+
+  TemporaryDir serial_dir;
+  TemporaryDir parallel_dir;
+  ASSERT_EQ(compile(serial_dir.path, "1"), 0);
+  ASSERT_EQ(compile(parallel_dir.path, "3"), 0);
+  for (const std::string& output : kOutputs) {
+    std::string serial;
+    std::string parallel;
+    ASSERT_TRUE(android::base::ReadFileToString(std::string(serial_dir.path) + "/" + output,
+                                                &serial));
+    ASSERT_TRUE(android::base::ReadFileToString(std::string(parallel_dir.path) + "/" + output,
+                                                &parallel));
+    EXPECT_EQ(serial, parallel) << output;
+  }
+
+  const std::string path = kResDir + "/values/values.xml";
+  std::vector<android::StringPiece> args = {path, "-o", serial_dir.path, "-j", "0"};
+  EXPECT_NE(aapt::Compile(args, &diag), 0);
+}
+
 }
 
 }
\ No newline at end of file
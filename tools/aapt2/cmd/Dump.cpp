@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <cinttypes>
 #include <vector>
 
@@ -43,6 +44,9 @@ struct DumpOptions {
 
   // The path to a file within an APK to dump.
   Maybe<std::string> file_to_dump_path;
+
+  // When set, only the resources of this type are dumped.
+  Maybe<ResourceType> type_to_dump;
 };
 
 static const char* ResourceFileTypeToString(const ResourceFile::Type& type) {
@@ -130,11 +134,21 @@ static bool TryDumpFile(IAaptContext* context, const std::string& file_path,
   std::string err;
   std::unique_ptr<io::ZipFileCollection> zip = io::ZipFileCollection::Create(file_path, &err);
   if (zip) {
+    const bool proto = zip->FindFile("resources.pb") != nullptr;
+    if (options.file_to_dump_path) {
+      // The table isn't needed to dump a file, don't load it.
+      io::IFile* file = zip->FindFile(options.file_to_dump_path.value());
+      if (file == nullptr) {
+        context->GetDiagnostics()->Error(DiagMessage(file_path)
+                                         << "file '" << options.file_to_dump_path.value()
+                                         << "' not found in APK");
+        return false;
+      }
+      return DumpXmlFile(context, file, proto, &printer);
+    }
+
     ResourceTable table;
-    bool proto = false;
     if (io::IFile* file = zip->FindFile("resources.pb")) {
-      proto = true;
-
       std::unique_ptr<io::IData> data = file->OpenAsData();
       if (data == nullptr) {
         context->GetDiagnostics()->Error(DiagMessage(file_path) << "failed to open resources.pb");
@@ -152,6 +166,17 @@ static bool TryDumpFile(IAaptContext* context, const std::string& file_path,
                                          << "failed to parse table: " << err);
         return false;
       }
+
+      if (options.type_to_dump) {
+        for (auto& package : table.packages) {
+          package->types.erase(
+              std::remove_if(package->types.begin(), package->types.end(),
+                             [&](const std::unique_ptr<ResourceTableType>& type) {
+                               return type->type != options.type_to_dump.value();
+                             }),
+              package->types.end());
+        }
+      }
     } else if (io::IFile* file = zip->FindFile("resources.arsc")) {
       std::unique_ptr<io::IData> data = file->OpenAsData();
       if (!data) {
@@ -161,29 +186,22 @@ static bool TryDumpFile(IAaptContext* context, const std::string& file_path,
 
       BinaryResourceParser parser(context->GetDiagnostics(), &table, Source(file_path),
                                   data->data(), data->size());
+      if (options.type_to_dump) {
+        // Skips parsing the values of the other types.
+        parser.SetOnlyType(options.type_to_dump.value());
+      }
       if (!parser.Parse()) {
         return false;
       }
     }
 
-    if (!options.file_to_dump_path) {
-      if (proto) {
-        printer.Println("Proto APK");
-      } else {
-        printer.Println("Binary APK");
-      }
-      Debug::PrintTable(table, options.print_options, &printer);
-      return true;
-    }
-
-    io::IFile* file = zip->FindFile(options.file_to_dump_path.value());
-    if (file == nullptr) {
-      context->GetDiagnostics()->Error(DiagMessage(file_path)
-                                       << "file '" << options.file_to_dump_path.value()
-                                       << "' not found in APK");
-      return false;
+    if (proto) {
+      printer.Println("Proto APK");
+    } else {
+      printer.Println("Binary APK");
     }
-    return DumpXmlFile(context, file, proto, &printer);
+    Debug::PrintTable(table, options.print_options, &printer);
+    return true;
   }
 
   err.clear();
@@ -309,6 +327,7 @@ class DumpContext : public IAaptContext {
 int Dump(const std::vector<StringPiece>& args) {
   bool verbose = false;
   bool no_values = false;
+  Maybe<std::string> type;
   DumpOptions options;
   Flags flags = Flags()
                     .OptionalSwitch("--no-values",
@@ -316,6 +335,10 @@ int Dump(const std::vector<StringPiece>& args) {
                                     &no_values)
                     .OptionalFlag("--file", "Dumps the specified file from the APK passed as arg.",
                                   &options.file_to_dump_path)
+                    .OptionalFlag("--type",
+                                  "Only dumps the resources of this type, e.g. string. The values "
+                                  "of the other types aren't loaded.",
+                                  &type)
                     .OptionalSwitch("-v", "increase verbosity of output", &verbose);
   if (!flags.Parse("aapt2 dump", args, &std::cerr)) {
     return 1;
@@ -324,6 +347,16 @@ int Dump(const std::vector<StringPiece>& args) {
   DumpContext context;
   context.SetVerbose(verbose);
 
+  if (type) {
+    const ResourceType* parsed_type = ParseResourceType(type.value());
+    if (parsed_type == nullptr) {
+      context.GetDiagnostics()->Error(DiagMessage()
+                                      << "invalid resource type '" << type.value() << "'");
+      return 1;
+    }
+    options.type_to_dump = *parsed_type;
+  }
+
   options.print_options.show_sources = true;
   options.print_options.show_values = !no_values;
   for (const std::string& arg : flags.GetArgs()) {
@@ -48,6 +48,7 @@
 #include "io/BigBufferStream.h"
 #include "io/FileStream.h"
 #include "io/FileSystem.h"
+#include "io/StringStream.h"
 #include "io/Util.h"
 #include "io/ZipArchive.h"
 #include "java/JavaClassGenerator.h"
@@ -64,7 +65,9 @@
 #include "process/IResourceTableConsumer.h"
 #include "process/SymbolTable.h"
 #include "split/TableSplitter.h"
+#include "trace/TraceBuffer.h"
 #include "util/Files.h"
+#include "util/Parallel.h"
 #include "xml/XmlDom.h"
 
 using ::aapt::io::FileInputStream;
@@ -130,11 +133,17 @@ struct LinkOptions {
   std::unordered_map<ResourceName, ResourceId> stable_id_map;
   Maybe<std::string> resource_id_map_path;
 
+  // Where --link-state keeps the IDs assigned by the last link, in the --emit-ids format.
+  Maybe<std::string> link_state_id_map_path;
+
   // When 'true', allow reserved package IDs to be used for applications. Pre-O, the platform
   // treats negative resource IDs [those with a package ID of 0x80 or higher] as invalid.
   // In order to work around this limitation, we allow the use of traditionally reserved
   // resource IDs [those between 0x02 and 0x7E].
   bool allow_reserved_package_id = false;
+
+  // The number of compiled files loaded in parallel.
+  size_t jobs = 1;
 };
 
 class LinkContext : public IAaptContext {
@@ -481,9 +490,12 @@ std::vector<std::unique_ptr<xml::XmlResource>> ResourceFileFlattener::LinkAndVer
   // that existing projects have out-of-date references which pass compilation.
   xml::StripAndroidStudioAttributes(doc->root.get());
 
-  XmlReferenceLinker xml_linker;
-  if (!xml_linker.Consume(context_, doc)) {
-    return {};
+  {
+    tracebuffer::Trace trace("Link: XmlReferenceLinker", src.path);
+    XmlReferenceLinker xml_linker;
+    if (!xml_linker.Consume(context_, doc)) {
+      return {};
+    }
   }
 
   if (options_.update_proguard_spec && !proguard::CollectProguardRules(doc, keep_set_)) {
@@ -747,6 +759,98 @@ static bool LoadStableIdMap(IDiagnostics* diag, const std::string& path,
   return true;
 }
 
+// Returns what a link depends on: its arguments and the content of the files it reads. Two links
+// with the same fingerprint produce the same output.
+static Maybe<std::string> GetLinkFingerprint(IDiagnostics* diag,
+                                             const std::vector<StringPiece>& args,
+                                             const LinkOptions& options,
+                                             const std::vector<std::string>& input_files,
+                                             const Maybe<std::string>& stable_id_file_path) {
+  std::vector<std::string> paths = {options.manifest_path};
+  paths.insert(paths.end(), input_files.begin(), input_files.end());
+  paths.insert(paths.end(), options.overlay_files.begin(), options.overlay_files.end());
+  paths.insert(paths.end(), options.include_paths.begin(), options.include_paths.end());
+  if (stable_id_file_path) {
+    paths.push_back(stable_id_file_path.value());
+  }
+  for (const std::string& assets_dir : options.assets_dirs) {
+    Maybe<std::vector<std::string>> files = file::FindFiles(assets_dir, diag, nullptr);
+    if (!files) {
+      return {};
+    }
+    for (const std::string& file : files.value()) {
+      std::string full_path = assets_dir;
+      file::AppendPath(&full_path, file);
+      paths.push_back(std::move(full_path));
+    }
+  }
+
+  std::stringstream fingerprint;
+  fingerprint << "version " << util::GetToolFingerprint() << "\n";
+  // A rebuilt aapt2 may link differently with the same version.
+  struct stat tool_stat;
+  const std::string tool_path = android::base::GetExecutablePath();
+  if (!tool_path.empty() && stat(tool_path.c_str(), &tool_stat) == 0) {
+    fingerprint << "tool " << tool_path << " " << tool_stat.st_size << " "
+                << static_cast<int64_t>(tool_stat.st_mtime) << "\n";
+  }
+  for (const StringPiece& arg : args) {
+    fingerprint << "arg " << arg << "\n";
+  }
+  std::hash<std::string> hasher;
+  for (const std::string& path : paths) {
+    std::string content;
+    if (!android::base::ReadFileToString(path, &content, true /*follow_symlinks*/)) {
+      // Let the link report it.
+      return {};
+    }
+    fingerprint << "file " << path << " " << content.size() << " "
+                << StringPrintf("%016" PRIx64, static_cast<uint64_t>(hasher(content))) << "\n";
+  }
+  return fingerprint.str();
+}
+
+// Returns the size and time of every file a link writes, or nothing if one of them is missing.
+// Recorded after the link, so that outputs deleted or changed since then are relinked.
+static Maybe<std::string> GetLinkOutputsFingerprint(IDiagnostics* diag,
+                                                    const LinkOptions& options) {
+  std::vector<std::string> paths = {options.output_path};
+  paths.insert(paths.end(), options.split_paths.begin(), options.split_paths.end());
+  for (const Maybe<std::string>& path :
+       {options.generate_text_symbols_path, options.generate_proguard_rules_path,
+        options.generate_main_dex_proguard_rules_path, options.resource_id_map_path}) {
+    if (path) {
+      paths.push_back(path.value());
+    }
+  }
+  if (options.generate_java_class_path) {
+    const std::string& java_dir = options.generate_java_class_path.value();
+    if (file::GetFileType(java_dir) != file::FileType::kDirectory) {
+      return {};
+    }
+    Maybe<std::vector<std::string>> files = file::FindFiles(java_dir, diag, nullptr);
+    if (!files || files.value().empty()) {
+      return {};
+    }
+    for (const std::string& file : files.value()) {
+      std::string full_path = java_dir;
+      file::AppendPath(&full_path, file);
+      paths.push_back(std::move(full_path));
+    }
+  }
+
+  std::stringstream fingerprint;
+  for (const std::string& path : paths) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+      return {};
+    }
+    fingerprint << "output " << path << " " << st.st_size << " "
+                << static_cast<int64_t>(st.st_mtime) << "\n";
+  }
+  return fingerprint.str();
+}
+
 static int32_t FindFrameworkAssetManagerCookie(const android::AssetManager& assets) {
   using namespace android;
 
@@ -1091,55 +1195,99 @@ class LinkCommand {
     return false;
   }
 
-  bool WriteJavaFile(ResourceTable* table, const StringPiece& package_name_to_generate,
-                     const StringPiece& out_package, const JavaClassGeneratorOptions& java_options,
-                     const Maybe<std::string>& out_text_symbols_path = {}) {
-    if (!options_.generate_java_class_path && !out_text_symbols_path) {
+  // An R class to generate, and optionally its R.txt.
+  struct JavaFile {
+    std::string package_name_to_generate;
+    std::string out_package;
+    JavaClassGeneratorOptions options;
+    Maybe<std::string> out_text_symbols_path;
+
+    // Filled in by GenerateJavaFile().
+    bool generated = false;
+    std::string java;
+    std::string text_symbols;
+    std::string error;
+  };
+
+  // Generates the R class of `java_file` in memory. Only reads the table, so that several can be
+  // generated at once.
+  void GenerateJavaFile(JavaFile* java_file) {
+    std::unique_ptr<io::StringOutputStream> out;
+    if (options_.generate_java_class_path) {
+      out = util::make_unique<io::StringOutputStream>(&java_file->java);
+    }
+
+    std::unique_ptr<io::StringOutputStream> out_text;
+    if (java_file->out_text_symbols_path) {
+      out_text = util::make_unique<io::StringOutputStream>(&java_file->text_symbols);
+    }
+
+    JavaClassGenerator generator(context_, &final_table_, java_file->options);
+    java_file->generated = generator.Generate(java_file->package_name_to_generate,
+                                              java_file->out_package, out.get(), out_text.get());
+    if (!java_file->generated) {
+      java_file->error = generator.GetError();
+    }
+    if (out) {
+      out->Flush();
+    }
+    if (out_text) {
+      out_text->Flush();
+    }
+  }
+
+  // Writes `content` to `path`, unless the file already has this content. Leaving unchanged R
+  // classes untouched keeps their timestamps, so that they aren't compiled again.
+  bool WriteFileIfChanged(const std::string& path, const std::string& content) {
+    std::string current_content;
+    if (android::base::ReadFileToString(path, &current_content) && current_content == content) {
       return true;
     }
 
+    if (!android::base::WriteStringToFile(content, path)) {
+      context_->GetDiagnostics()->Error(DiagMessage()
+                                        << "failed writing to '" << path
+                                        << "': " << android::base::SystemErrorCodeToString(errno));
+      return false;
+    }
+    return true;
+  }
+
+  bool WriteJavaFile(const JavaFile& java_file) {
     std::string out_path;
-    std::unique_ptr<io::FileOutputStream> fout;
     if (options_.generate_java_class_path) {
       out_path = options_.generate_java_class_path.value();
-      file::AppendPath(&out_path, file::PackageToPath(out_package));
-      if (!file::mkdirs(out_path)) {
-        context_->GetDiagnostics()->Error(DiagMessage()
-                                          << "failed to create directory '" << out_path << "'");
-        return false;
-      }
-
+      file::AppendPath(&out_path, file::PackageToPath(java_file.out_package));
       file::AppendPath(&out_path, "R.java");
+    }
 
-      fout = util::make_unique<io::FileOutputStream>(out_path);
-      if (fout->HadError()) {
-        context_->GetDiagnostics()->Error(DiagMessage() << "failed writing to '" << out_path
-                                                        << "': " << fout->GetError());
-        return false;
-      }
+    if (!java_file.generated) {
+      context_->GetDiagnostics()->Error(DiagMessage(out_path) << java_file.error);
+      return false;
     }
 
-    std::unique_ptr<io::FileOutputStream> fout_text;
-    if (out_text_symbols_path) {
-      fout_text = util::make_unique<io::FileOutputStream>(out_text_symbols_path.value());
-      if (fout_text->HadError()) {
+    if (options_.generate_java_class_path) {
+      const std::string out_dir = file::GetStem(out_path).to_string();
+      if (!file::mkdirs(out_dir)) {
         context_->GetDiagnostics()->Error(DiagMessage()
-                                          << "failed writing to '" << out_text_symbols_path.value()
-                                          << "': " << fout_text->GetError());
+                                          << "failed to create directory '" << out_dir << "'");
+        return false;
+      }
+
+      if (!WriteFileIfChanged(out_path, java_file.java)) {
         return false;
       }
     }
 
-    JavaClassGenerator generator(context_, table, java_options);
-    if (!generator.Generate(package_name_to_generate, out_package, fout.get(), fout_text.get())) {
-      context_->GetDiagnostics()->Error(DiagMessage(out_path) << generator.GetError());
+    if (java_file.out_text_symbols_path &&
+        !WriteFileIfChanged(java_file.out_text_symbols_path.value(), java_file.text_symbols)) {
       return false;
     }
-
     return true;
   }
 
   bool GenerateJavaClasses() {
+    tracebuffer::Trace trace("Link: JavaClassGenerator");
     // The set of packages whose R class to call in the main classes onResourcesLoaded callback.
     std::vector<std::string> packages_to_callback;
 
@@ -1163,6 +1311,17 @@ class LinkCommand {
       output_package = options_.custom_java_package.value();
     }
 
+    std::vector<std::unique_ptr<JavaFile>> java_files;
+    auto add_java_file = [&](const StringPiece& package_name_to_generate,
+                             const StringPiece& out_package,
+                             const JavaClassGeneratorOptions& options) {
+      std::unique_ptr<JavaFile> java_file = util::make_unique<JavaFile>();
+      java_file->package_name_to_generate = package_name_to_generate.to_string();
+      java_file->out_package = out_package.to_string();
+      java_file->options = options;
+      java_files.push_back(std::move(java_file));
+    };
+
     // Generate the private symbols if required.
     if (options_.private_symbols) {
       packages_to_callback.push_back(options_.private_symbols.value());
@@ -1171,10 +1330,7 @@ class LinkCommand {
       // to the original package, and private and public symbols to the private package.
       JavaClassGeneratorOptions options = template_options;
       options.types = JavaClassGeneratorOptions::SymbolTypes::kPublicPrivate;
-      if (!WriteJavaFile(&final_table_, actual_package, options_.private_symbols.value(),
-                         options)) {
-        return false;
-      }
+      add_java_file(actual_package, options_.private_symbols.value(), options);
     }
 
     // Generate copies of the original package R class but with different package names.
@@ -1184,9 +1340,7 @@ class LinkCommand {
 
       JavaClassGeneratorOptions options = template_options;
       options.types = JavaClassGeneratorOptions::SymbolTypes::kAll;
-      if (!WriteJavaFile(&final_table_, actual_package, extra_package, options)) {
-        return false;
-      }
+      add_java_file(actual_package, extra_package, options);
     }
 
     // Generate R classes for each package that was merged (static library).
@@ -1196,9 +1350,7 @@ class LinkCommand {
 
       JavaClassGeneratorOptions options = template_options;
       options.types = JavaClassGeneratorOptions::SymbolTypes::kAll;
-      if (!WriteJavaFile(&final_table_, package, package, options)) {
-        return false;
-      }
+      add_java_file(package, package, options);
     }
 
     // Generate the main public R class.
@@ -1214,12 +1366,17 @@ class LinkCommand {
           std::move(packages_to_callback);
     }
 
-    if (!WriteJavaFile(&final_table_, actual_package, output_package, options,
-                       options_.generate_text_symbols_path)) {
-      return false;
-    }
+    add_java_file(actual_package, output_package, options);
+    java_files.back()->out_text_symbols_path = options_.generate_text_symbols_path;
 
-    return true;
+    // The R classes are generated on up to options_.jobs threads and written in order.
+    return util::ParallelForInOrder(
+        java_files.size(), options_.jobs,
+        [&](size_t i) { GenerateJavaFile(java_files[i].get()); },
+        [&](size_t i) {
+          std::unique_ptr<JavaFile> java_file = std::move(java_files[i]);
+          return WriteJavaFile(*java_file);
+        });
   }
 
   bool WriteManifestJavaFile(xml::XmlResource* manifest_xml) {
@@ -1284,6 +1441,8 @@ class LinkCommand {
       return true;
     }
 
+    tracebuffer::Trace trace("Link: ProguardRules", out.value());
+
     const std::string& out_path = out.value();
     io::FileOutputStream fout(out_path);
     if (fout.HadError()) {
@@ -1421,14 +1580,18 @@ class LinkCommand {
     return !error;
   }
 
+  static bool IsArchive(const std::string& path) {
+    return util::EndsWith(path, ".flata") || util::EndsWith(path, ".jar") ||
+           util::EndsWith(path, ".jack") || util::EndsWith(path, ".zip");
+  }
+
   // Takes a path to load and merge into the master ResourceTable. If override is true,
   // conflicting resources are allowed to override each other, in order of last seen.
   // If the file path ends with .flata, .jar, .jack, or .zip the file is treated
   // as ZIP archive and the files within are merged individually.
   // Otherwise the file is processed on its own.
   bool MergePath(const std::string& path, bool override) {
-    if (util::EndsWith(path, ".flata") || util::EndsWith(path, ".jar") ||
-        util::EndsWith(path, ".jack") || util::EndsWith(path, ".zip")) {
+    if (IsArchive(path)) {
       return MergeArchive(path, override);
     } else if (util::EndsWith(path, ".apk")) {
       return MergeStaticLibrary(path, override);
@@ -1438,47 +1601,123 @@ class LinkCommand {
     return MergeFile(file, override);
   }
 
+  // Merges the paths in order, as MergePath() would. The compiled files among them are loaded
+  // and deserialized on options_.jobs threads while the files before them are merged.
+  bool MergePaths(const std::vector<std::string>& paths, bool override) {
+    if (options_.jobs <= 1) {
+      for (const std::string& path : paths) {
+        if (!MergePath(path, override)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // Archives and static libraries are opened and merged on this thread, only the compiled
+    // files are loaded on the others. Those are inserted in the collection up front since it
+    // isn't thread-safe. A file that is given twice is loaded again when it's merged, after its
+    // first load is done, so that only one thread at a time creates segments of it.
+    struct Job {
+      io::IFile* file = nullptr;
+      bool load_on_merge = false;
+      BufferedDiagnostics diagnostics;
+      LoadedFile loaded;
+      bool success = false;
+    };
+    std::vector<std::unique_ptr<Job>> jobs(paths.size());
+    for (size_t i = 0; i < paths.size(); i++) {
+      jobs[i] = util::make_unique<Job>();
+      if (!IsArchive(paths[i]) && !util::EndsWith(paths[i], ".apk")) {
+        jobs[i]->file = file_collection_->FindFile(paths[i]);
+        if (jobs[i]->file != nullptr) {
+          jobs[i]->load_on_merge = true;
+        } else {
+          jobs[i]->file = file_collection_->InsertFile(paths[i]);
+        }
+      }
+    }
+
+    return util::ParallelForInOrder(
+        paths.size(), options_.jobs,
+        [&](size_t i) {
+          Job* job = jobs[i].get();
+          if (job->file != nullptr && !job->load_on_merge) {
+            job->success = LoadFile(job->file, &job->diagnostics, &job->loaded);
+          }
+        },
+        [&](size_t i) {
+          std::unique_ptr<Job> job = std::move(jobs[i]);
+          if (job->file == nullptr) {
+            return MergePath(paths[i], override);
+          } else if (job->load_on_merge) {
+            return MergeFile(job->file, override);
+          }
+          job->diagnostics.Replay(context_->GetDiagnostics());
+          return job->success && MergeLoadedFile(job->file->GetSource(), &job->loaded, override);
+        });
+  }
+
+  // The entries of an AAPT Container file (.apc/.flat), deserialized but not merged yet.
+  struct LoadedFile {
+    struct Entry {
+      // Set for a resource table entry, the other fields are for a resource file entry.
+      std::unique_ptr<ResourceTable> table;
+      ResourceFile compiled_file;
+      io::IFile* file = nullptr;
+    };
+    std::vector<Entry> entries;
+  };
+
   // Takes an AAPT Container file (.apc/.flat) to load and merge into the master ResourceTable.
   // If override is true, conflicting resources are allowed to override each other, in order of last
   // seen.
   // All other file types are ignored. This is because these files could be coming from a zip,
   // where we could have other files like classes.dex.
   bool MergeFile(io::IFile* file, bool override) {
+    LoadedFile loaded;
+    if (!LoadFile(file, context_->GetDiagnostics(), &loaded)) {
+      return false;
+    }
+    return MergeLoadedFile(file->GetSource(), &loaded, override);
+  }
+
+  // Reads and deserializes the entries of an AAPT Container file (.apc/.flat). This only reads
+  // `file` and logs to `diag`, so files can be loaded on different threads.
+  bool LoadFile(io::IFile* file, IDiagnostics* diag, LoadedFile* out_loaded) {
     const Source& src = file->GetSource();
 
     if (util::EndsWith(src.path, ".xml") || util::EndsWith(src.path, ".png")) {
       // Since AAPT compiles these file types and appends .flat to them, seeing
       // their raw extensions is a sign that they weren't compiled.
       const StringPiece file_type = util::EndsWith(src.path, ".xml") ? "XML" : "PNG";
-      context_->GetDiagnostics()->Error(DiagMessage(src) << "uncompiled " << file_type
-                                                         << " file passed as argument. Must be "
-                                                            "compiled first into .flat file.");
+      diag->Error(DiagMessage(src) << "uncompiled " << file_type
+                                   << " file passed as argument. Must be "
+                                      "compiled first into .flat file.");
       return false;
     } else if (!util::EndsWith(src.path, ".apc") && !util::EndsWith(src.path, ".flat")) {
       if (context_->IsVerbose()) {
-        context_->GetDiagnostics()->Warn(DiagMessage(src) << "ignoring unrecognized file");
+        diag->Warn(DiagMessage(src) << "ignoring unrecognized file");
         return true;
       }
     }
 
     std::unique_ptr<io::InputStream> input_stream = file->OpenInputStream();
     if (input_stream == nullptr) {
-      context_->GetDiagnostics()->Error(DiagMessage(src) << "failed to open file");
+      diag->Error(DiagMessage(src) << "failed to open file");
       return false;
     }
 
     if (input_stream->HadError()) {
-      context_->GetDiagnostics()->Error(DiagMessage(src)
-                                        << "failed to open file: " << input_stream->GetError());
+      diag->Error(DiagMessage(src) << "failed to open file: " << input_stream->GetError());
       return false;
     }
 
+    tracebuffer::Trace trace("Link: load", src.path);
     ContainerReaderEntry* entry;
     ContainerReader reader(input_stream.get());
 
     if (reader.HadError()) {
-      context_->GetDiagnostics()->Error(DiagMessage(src)
-                                        << "failed to read file: " << reader.GetError());
+      diag->Error(DiagMessage(src) << "failed to read file: " << reader.GetError());
       return false;
     }
 
@@ -1486,44 +1725,57 @@ class LinkCommand {
       if (entry->Type() == ContainerEntryType::kResTable) {
         pb::ResourceTable pb_table;
         if (!entry->GetResTable(&pb_table)) {
-          context_->GetDiagnostics()->Error(DiagMessage(src) << "failed to read resource table: "
-                                                             << entry->GetError());
+          diag->Error(DiagMessage(src) << "failed to read resource table: " << entry->GetError());
           return false;
         }
 
-        ResourceTable table;
+        std::unique_ptr<ResourceTable> table = util::make_unique<ResourceTable>();
         std::string error;
-        if (!DeserializeTableFromPb(pb_table, nullptr /*files*/, &table, &error)) {
-          context_->GetDiagnostics()->Error(DiagMessage(src)
-                                            << "failed to deserialize resource table: " << error);
+        if (!DeserializeTableFromPb(pb_table, nullptr /*files*/, table.get(), &error)) {
+          diag->Error(DiagMessage(src) << "failed to deserialize resource table: " << error);
           return false;
         }
 
-        if (!table_merger_->Merge(src, &table, override)) {
-          context_->GetDiagnostics()->Error(DiagMessage(src) << "failed to merge resource table");
-          return false;
-        }
+        LoadedFile::Entry loaded_entry;
+        loaded_entry.table = std::move(table);
+        out_loaded->entries.push_back(std::move(loaded_entry));
       } else if (entry->Type() == ContainerEntryType::kResFile) {
         pb::internal::CompiledFile pb_compiled_file;
         off64_t offset;
         size_t len;
         if (!entry->GetResFileOffsets(&pb_compiled_file, &offset, &len)) {
-          context_->GetDiagnostics()->Error(DiagMessage(src) << "failed to get resource file: "
-                                                             << entry->GetError());
+          diag->Error(DiagMessage(src) << "failed to get resource file: " << entry->GetError());
           return false;
         }
 
-        ResourceFile resource_file;
+        LoadedFile::Entry loaded_entry;
         std::string error;
-        if (!DeserializeCompiledFileFromPb(pb_compiled_file, &resource_file, &error)) {
-          context_->GetDiagnostics()->Error(DiagMessage(src)
-                                            << "failed to read compiled header: " << error);
+        if (!DeserializeCompiledFileFromPb(pb_compiled_file, &loaded_entry.compiled_file,
+                                           &error)) {
+          diag->Error(DiagMessage(src) << "failed to read compiled header: " << error);
           return false;
         }
 
-        if (!MergeCompiledFile(resource_file, file->CreateFileSegment(offset, len), override)) {
+        loaded_entry.file = file->CreateFileSegment(offset, len);
+        out_loaded->entries.push_back(std::move(loaded_entry));
+      }
+    }
+    trace.SetBytes(input_stream->ByteCount());
+    return true;
+  }
+
+  // Merges the entries loaded by LoadFile() into the master ResourceTable, in the order they were
+  // in the file. The merger copies what it keeps, so each table is freed once it's merged.
+  bool MergeLoadedFile(const Source& src, LoadedFile* loaded, bool override) {
+    for (LoadedFile::Entry& entry : loaded->entries) {
+      if (entry.table) {
+        if (!table_merger_->Merge(src, entry.table.get(), override)) {
+          context_->GetDiagnostics()->Error(DiagMessage(src) << "failed to merge resource table");
           return false;
         }
+        entry.table.reset();
+      } else if (!MergeCompiledFile(entry.compiled_file, entry.file, override)) {
+        return false;
       }
     }
     return true;
@@ -1573,6 +1825,7 @@ class LinkCommand {
   // to the IArchiveWriter.
   bool WriteApk(IArchiveWriter* writer, proguard::KeepSet* keep_set, xml::XmlResource* manifest,
                 ResourceTable* table) {
+    tracebuffer::Trace trace("Link: write APK");
     const bool keep_raw_values = context_->GetPackageType() == PackageType::kStaticLib;
     bool result = FlattenXml(context_, *manifest, "AndroidManifest.xml", keep_raw_values,
                              true /*utf16*/, options_.output_format, writer);
@@ -1724,15 +1977,14 @@ class LinkCommand {
       }
     }
 
-    for (const std::string& input : input_files) {
-      if (!MergePath(input, false)) {
+    {
+      tracebuffer::Trace trace("Link: TableMerger");
+      if (!MergePaths(input_files, false)) {
         context_->GetDiagnostics()->Error(DiagMessage() << "failed parsing input");
         return 1;
       }
-    }
 
-    for (const std::string& input : options_.overlay_files) {
-      if (!MergePath(input, true)) {
+      if (!MergePaths(options_.overlay_files, true)) {
         context_->GetDiagnostics()->Error(DiagMessage() << "failed parsing overlays");
         return 1;
       }
@@ -1757,7 +2009,7 @@ class LinkCommand {
       }
 
       // Now grab each ID and emit it as a file.
-      if (options_.resource_id_map_path) {
+      if (options_.resource_id_map_path || options_.link_state_id_map_path) {
         for (auto& package : final_table_.packages) {
           for (auto& type : package->types) {
             for (auto& entry : type->entries) {
@@ -1769,10 +2021,16 @@ class LinkCommand {
           }
         }
 
-        if (!WriteStableIdMapToPath(context_->GetDiagnostics(), options_.stable_id_map,
+        if (options_.resource_id_map_path &&
+            !WriteStableIdMapToPath(context_->GetDiagnostics(), options_.stable_id_map,
                                     options_.resource_id_map_path.value())) {
           return 1;
         }
+        if (options_.link_state_id_map_path &&
+            !WriteStableIdMapToPath(context_->GetDiagnostics(), options_.stable_id_map,
+                                    options_.link_state_id_map_path.value())) {
+          return 1;
+        }
       }
     } else {
       // Static libs are merged with other apps, and ID collisions are bad, so
@@ -1812,10 +2070,13 @@ class LinkCommand {
       return 1;
     }
 
-    ReferenceLinker linker;
-    if (!linker.Consume(context_, &final_table_)) {
-      context_->GetDiagnostics()->Error(DiagMessage() << "failed linking references");
-      return 1;
+    {
+      tracebuffer::Trace trace("Link: ReferenceLinker");
+      ReferenceLinker linker;
+      if (!linker.Consume(context_, &final_table_)) {
+        context_->GetDiagnostics()->Error(DiagMessage() << "failed linking references");
+        return 1;
+      }
     }
 
     if (context_->GetPackageType() == PackageType::kStaticLib) {
@@ -1846,14 +2107,14 @@ class LinkCommand {
                                          << context_->GetMinSdkVersion());
       }
 
-      VersionCollapser collapser;
+      VersionCollapser collapser(options_.jobs);
       if (!collapser.Consume(context_, &final_table_)) {
         return 1;
       }
     }
 
     if (!options_.no_resource_deduping) {
-      ResourceDeduper deduper;
+      ResourceDeduper deduper(options_.jobs);
       if (!deduper.Consume(context_, &final_table_)) {
         context_->GetDiagnostics()->Error(DiagMessage() << "failed deduping resources");
         return 1;
@@ -2042,6 +2303,10 @@ int Link(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
   bool proto_format = false;
   Maybe<std::string> stable_id_file_path;
   std::vector<std::string> split_args;
+  Maybe<std::string> jobs;
+  Maybe<std::string> link_state_dir;
+  Maybe<std::string> trace_file;
+  bool print_stats = false;
   Flags flags =
       Flags()
           .RequiredFlag("-o", "Output path.", &options.output_path)
@@ -2147,6 +2412,12 @@ int Link(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
                         "Emit a file at the given path with a list of name to ID mappings,\n"
                         "suitable for use with --stable-ids.",
                         &options.resource_id_map_path)
+          .OptionalFlag("--link-state",
+                        "Directory where the state of the last link is kept. The IDs it\n"
+                        "assigned are kept stable, like with --stable-ids, and the link is\n"
+                        "skipped if aapt2, its arguments and inputs didn't change and its\n"
+                        "outputs are still those it wrote.",
+                        &link_state_dir)
           .OptionalFlag("--private-symbols",
                         "Package name to use when generating R.java for private symbols.\n"
                         "If not specified, public and private symbols will use the application's\n"
@@ -2188,6 +2459,15 @@ int Link(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
                             "Syntax: path/to/output.apk:<config>[,<config>[...]].\n"
                             "On Windows, use a semicolon ';' separator instead.",
                             &split_args)
+          .OptionalFlag("-j",
+                        "Number of compiled files to load in parallel. They are still merged\n"
+                        "in order, the output is the same as with one job. Defaults to 1.",
+                        &jobs)
+          .OptionalFlag("--trace-file",
+                        "Writes the time spent in each phase and on each file to this\n"
+                        "file, in the Chrome trace event JSON format.",
+                        &trace_file)
+          .OptionalSwitch("--stats", "Prints the time spent in each phase.", &print_stats)
           .OptionalSwitch("-v", "Enables verbose logging.", &verbose)
           .OptionalSwitch("--debug-mode",
                           "Inserts android:debuggable=\"true\" in to the application node of the\n"
@@ -2198,6 +2478,10 @@ int Link(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
     return 1;
   }
 
+  if (trace_file || print_stats) {
+    tracebuffer::Enable();
+  }
+
   // Expand all argument-files passed into the command line. These start with '@'.
   std::vector<std::string> arg_list;
   for (const std::string& arg : flags.GetArgs()) {
@@ -2231,6 +2515,16 @@ int Link(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
     context.SetVerbose(verbose);
   }
 
+  if (jobs) {
+    const Maybe<uint32_t> maybe_jobs = ResourceUtils::ParseInt(jobs.value());
+    if (!maybe_jobs || maybe_jobs.value() == 0) {
+      context.GetDiagnostics()->Error(DiagMessage() << "-j '" << jobs.value()
+                                                    << "' is not a valid number of jobs");
+      return 1;
+    }
+    options.jobs = maybe_jobs.value();
+  }
+
   if (int{shared_lib} + int{static_lib} + int{proto_format} > 1) {
     context.GetDiagnostics()->Error(
         DiagMessage()
@@ -2343,8 +2637,71 @@ int Link(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
     options.no_version_transitions = true;
   }
 
+  Maybe<std::string> fingerprint;
+  std::string fingerprint_path;
+  if (link_state_dir) {
+    if (!file::mkdirs(link_state_dir.value())) {
+      context.GetDiagnostics()->Error(DiagMessage(link_state_dir.value())
+                                      << "failed to create directory: "
+                                      << android::base::SystemErrorCodeToString(errno));
+      return 1;
+    }
+
+    fingerprint_path = link_state_dir.value();
+    file::AppendPath(&fingerprint_path, "inputs");
+    fingerprint = GetLinkFingerprint(context.GetDiagnostics(), args, options, arg_list,
+                                     stable_id_file_path);
+    std::string last_fingerprint;
+    if (fingerprint && android::base::ReadFileToString(fingerprint_path, &last_fingerprint)) {
+      Maybe<std::string> outputs = GetLinkOutputsFingerprint(context.GetDiagnostics(), options);
+      if (outputs && last_fingerprint == fingerprint.value() + outputs.value()) {
+        if (context.IsVerbose()) {
+          context.GetDiagnostics()->Note(DiagMessage(options.output_path) << "up to date");
+        }
+        return 0;
+      }
+    }
+
+    // Keep the IDs of the last link for the resources that --stable-ids doesn't assign.
+    if (context.GetPackageType() != PackageType::kStaticLib) {
+      std::string id_map_path = link_state_dir.value();
+      file::AppendPath(&id_map_path, "ids");
+      if (file::GetFileType(id_map_path) != file::FileType::kNonexistant) {
+        std::unordered_map<ResourceName, ResourceId> last_id_map;
+        if (!LoadStableIdMap(context.GetDiagnostics(), id_map_path, &last_id_map)) {
+          return 1;
+        }
+        std::set<ResourceId> stable_ids;
+        for (const auto& entry : options.stable_id_map) {
+          stable_ids.insert(entry.second);
+        }
+        for (auto& entry : last_id_map) {
+          if (stable_ids.count(entry.second) == 0) {
+            options.stable_id_map.insert(std::move(entry));
+          }
+        }
+      }
+      options.link_state_id_map_path = std::move(id_map_path);
+    }
+
+    // The inputs are only recorded once the link succeeded.
+    remove(fingerprint_path.c_str());
+  }
+
   LinkCommand cmd(&context, options);
-  return cmd.Run(arg_list);
+  int result = cmd.Run(arg_list);
+  if (!FinishTrace(trace_file, print_stats, context.GetDiagnostics())) {
+    result = 1;
+  }
+  if (result == 0 && fingerprint) {
+    Maybe<std::string> outputs = GetLinkOutputsFingerprint(context.GetDiagnostics(), options);
+    if (!outputs || !android::base::WriteStringToFile(fingerprint.value() + outputs.value(),
+                                                      fingerprint_path)) {
+      context.GetDiagnostics()->Warn(DiagMessage(fingerprint_path)
+                                     << "failed to write link state");
+    }
+  }
+  return result;
 }
 
 }  // namespace aapt
@@ -78,6 +78,9 @@ struct OptimizeOptions {
   // Set of artifacts to keep when generating multi-APK splits. If the list is empty, all artifacts
   // are kept and will be written as output.
   std::unordered_set<std::string> kept_artifacts;
+
+  // Number of multi-APK artifacts generated in parallel.
+  size_t jobs = 1;
 };
 
 class OptimizeContext : public IAaptContext {
@@ -148,12 +151,12 @@ class OptimizeCommand {
       context_->GetDiagnostics()->Note(DiagMessage() << "Optimizing APK...");
     }
 
-    VersionCollapser collapser;
+    VersionCollapser collapser(options_.jobs);
     if (!collapser.Consume(context_, apk->GetResourceTable())) {
       return 1;
     }
 
-    ResourceDeduper deduper;
+    ResourceDeduper deduper(options_.jobs);
     if (!deduper.Consume(context_, apk->GetResourceTable())) {
       context_->GetDiagnostics()->Error(DiagMessage() << "failed deduping resources");
       return 1;
@@ -202,7 +205,7 @@ class OptimizeCommand {
       MultiApkGenerator generator{apk.get(), context_};
       MultiApkGeneratorOptions generator_options = {
           options_.output_dir.value(), options_.apk_artifacts.value(),
-          options_.table_flattener_options, options_.kept_artifacts};
+          options_.table_flattener_options, options_.kept_artifacts, options_.jobs};
       if (!generator.FromBaseApk(generator_options)) {
         return 1;
       }
@@ -326,6 +329,7 @@ int Optimize(const std::vector<StringPiece>& args) {
   std::vector<std::string> configs;
   std::vector<std::string> split_args;
   std::unordered_set<std::string> kept_artifacts;
+  Maybe<std::string> jobs;
   bool verbose = false;
   bool print_only = false;
   Flags flags =
@@ -364,6 +368,10 @@ int Optimize(const std::vector<StringPiece>& args) {
           .OptionalSwitch("--enable-resource-obfuscation",
                           "Enables obfuscation of key string pool to single value",
                           &options.table_flattener_options.collapse_key_stringpool)
+          .OptionalFlag("-j",
+                        "Number of multi-APK artifacts to generate in parallel. Each one\n"
+                        "holds its own copy of the resource table. Defaults to 1",
+                        &jobs)
           .OptionalSwitch("-v", "Enables verbose logging", &verbose);
 
   if (!flags.Parse("aapt2 optimize", args, &std::cerr)) {
@@ -381,6 +389,15 @@ int Optimize(const std::vector<StringPiece>& args) {
   context.SetVerbose(verbose);
   IDiagnostics* diag = context.GetDiagnostics();
 
+  if (jobs) {
+    const Maybe<uint32_t> maybe_jobs = ResourceUtils::ParseInt(jobs.value());
+    if (!maybe_jobs || maybe_jobs.value() == 0) {
+      diag->Error(DiagMessage() << "-j '" << jobs.value() << "' is not a valid number of jobs");
+      return 1;
+    }
+    options.jobs = maybe_jobs.value();
+  }
+
   if (config_path) {
     std::string& path = config_path.value();
     Maybe<ConfigurationParser> for_path = ConfigurationParser::ForPath(path);
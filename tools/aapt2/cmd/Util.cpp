@@ -16,6 +16,7 @@
 
 #include "cmd/Util.h"
 
+#include <iostream>
 #include <vector>
 
 #include "android-base/logging.h"
@@ -25,6 +26,7 @@
 #include "ResourceUtils.h"
 #include "ValueVisitor.h"
 #include "split/TableSplitter.h"
+#include "trace/TraceBuffer.h"
 #include "util/Maybe.h"
 #include "util/Util.h"
 
@@ -391,4 +393,19 @@ Maybe<AppInfo> ExtractAppInfoFromBinaryManifest(const xml::XmlResource& xml_res,
   return app_info;
 }
 
+bool FinishTrace(const Maybe<std::string>& trace_file, bool print_stats, IDiagnostics* diag) {
+  if (print_stats) {
+    tracebuffer::PrintStats(&std::cerr);
+  }
+
+  if (trace_file) {
+    std::string error;
+    if (!tracebuffer::WriteTraceFile(trace_file.value(), &error)) {
+      diag->Error(DiagMessage(trace_file.value()) << error);
+      return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace aapt
@@ -60,6 +60,11 @@ std::unique_ptr<xml::XmlResource> GenerateSplitManifest(const AppInfo& app_info,
 Maybe<AppInfo> ExtractAppInfoFromBinaryManifest(const xml::XmlResource& xml_res,
                                                 IDiagnostics* diag);
 
+// Writes the trace of the command to `trace_file` if set, and prints the time spent in each phase
+// to stderr if `print_stats` is set. Returns false and logs an error if the trace couldn't be
+// written.
+bool FinishTrace(const Maybe<std::string>& trace_file, bool print_stats, IDiagnostics* diag);
+
 }  // namespace aapt
 
 #endif /* AAPT_SPLIT_UTIL_H */
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "compile/PngCache.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+
+#include "android-base/file.h"
+#include "android-base/stringprintf.h"
+#include "zlib.h"
+
+#include "util/Files.h"
+
+using ::android::StringPiece;
+using ::android::base::StringPrintf;
+
+namespace aapt {
+
+// Bump when the PNG crunching changes, so that PNGs crunched the old way aren't reused.
+constexpr const char* kCrunchVersion = "1";
+
+static uint64_t Fnv1a64(const StringPiece& data, uint64_t hash = 0xcbf29ce484222325ull) {
+  for (char c : data) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+PngCache::PngCache(const StringPiece& dir) : dir_(dir.to_string()) {
+}
+
+std::string PngCache::Key(const StringPiece& content, const StringPiece& options) {
+  // Two unrelated hashes and the size, so that two different PNGs practically never share a key.
+  const uint64_t fnv = Fnv1a64(content);
+  const uLong crc = crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(content.data()),
+                          static_cast<uInt>(content.size()));
+  const uint64_t options_hash = Fnv1a64(options, Fnv1a64(kCrunchVersion));
+  return StringPrintf("%016llx%08lx%llx-%016llx", static_cast<unsigned long long>(fnv),
+                      static_cast<unsigned long>(crc),
+                      static_cast<unsigned long long>(content.size()),
+                      static_cast<unsigned long long>(options_hash));
+}
+
+bool PngCache::Get(const std::string& key, BigBuffer* out) const {
+  std::string path = dir_;
+  file::AppendPath(&path, key + ".png");
+  std::string crunched;
+  if (!android::base::ReadFileToString(path, &crunched)) {
+    return false;
+  }
+  memcpy(out->NextBlock<uint8_t>(crunched.size()), crunched.data(), crunched.size());
+  return true;
+}
+
+bool PngCache::Put(const std::string& key, const BigBuffer& crunched) const {
+  std::string crunched_str;
+  crunched_str.reserve(crunched.size());
+  for (const BigBuffer::Block& block : crunched) {
+    crunched_str.append(reinterpret_cast<const char*>(block.buffer.get()), block.size);
+  }
+
+  // Written to a file only this writer uses, then renamed so that readers never see part of it.
+  static std::atomic<uint32_t> sTempCount(0);
+  std::string path = dir_;
+  file::AppendPath(&path, key + ".png");
+  const std::string temp_path = StringPrintf("%s.%d.%u.tmp", path.c_str(), getpid(),
+                                             static_cast<unsigned>(sTempCount++));
+  if (!android::base::WriteStringToFile(crunched_str, temp_path)) {
+    unlink(temp_path.c_str());
+    return false;
+  }
+  if (rename(temp_path.c_str(), path.c_str()) != 0) {
+    // Another writer may have stored it first, on platforms that don't replace files.
+    unlink(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+}  // namespace aapt
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_COMPILE_PNGCACHE_H
+#define AAPT_COMPILE_PNGCACHE_H
+
+#include <string>
+
+#include "android-base/macros.h"
+#include "androidfw/StringPiece.h"
+
+#include "util/BigBuffer.h"
+
+namespace aapt {
+
+/**
+ * A directory of crunched PNGs, keyed by the content of the original PNG and by how it was
+ * crunched. It can be shared by the builds and the processes that crunch the same images, an
+ * entry is only visible once it's completely written.
+ */
+class PngCache {
+ public:
+  explicit PngCache(const android::StringPiece& dir);
+
+  /**
+   * Returns the key of the PNG `content` crunched with `options`, anything that changes the
+   * crunched PNG such as the extension of a 9-patch.
+   */
+  static std::string Key(const android::StringPiece& content, const android::StringPiece& options);
+
+  /**
+   * Appends the crunched PNG stored for `key` to `out`. Returns false if there's none.
+   */
+  bool Get(const std::string& key, BigBuffer* out) const;
+
+  /**
+   * Stores `crunched` for `key`. Returns false if it couldn't be written, the cache is then
+   * left as it was.
+   */
+  bool Put(const std::string& key, const BigBuffer& crunched) const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(PngCache);
+
+  std::string dir_;
+};
+
+}  // namespace aapt
+
+#endif  // AAPT_COMPILE_PNGCACHE_H
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "compile/PngCache.h"
+
+#include "android-base/test_utils.h"
+
+#include "test/Test.h"
+
+namespace aapt {
+
+static std::string ToString(const BigBuffer& buffer) {
+  std::string str;
+  for (const BigBuffer::Block& block : buffer) {
+    str.append(reinterpret_cast<const char*>(block.buffer.get()), block.size);
+  }
+  return str;
+}
+
+TEST(PngCacheTest, KeyDependsOnContentAndOptions) {
+  const std::string key = PngCache::Key("\x89PNG abc", "png");
+  EXPECT_EQ(key, PngCache::Key("\x89PNG abc", "png"));
+  EXPECT_NE(key, PngCache::Key("\x89PNG abd", "png"));
+  EXPECT_NE(key, PngCache::Key("\x89PNG abc ", "png"));
+  EXPECT_NE(key, PngCache::Key("\x89PNG abc", "9.png"));
+}
+
+TEST(PngCacheTest, PutThenGet) {
+  TemporaryDir dir;
+  PngCache cache(dir.path);
+  const std::string key = PngCache::Key("original", "png");
+
+  BigBuffer out(16);
+  EXPECT_FALSE(cache.Get(key, &out));
+  EXPECT_EQ(0u, out.size());
+
+  // Bigger than a block, so it's split over many.
+  const std::string crunched(100, 'c');
+  BigBuffer in(16);
+  memcpy(in.NextBlock<char>(60), crunched.data(), 60);
+  memcpy(in.NextBlock<char>(40), crunched.data() + 60, 40);
+  ASSERT_TRUE(cache.Put(key, in));
+
+  ASSERT_TRUE(cache.Get(key, &out));
+  EXPECT_EQ(crunched, ToString(out));
+
+  // Another cache on the same directory, as used by the next build.
+  BigBuffer out2(16);
+  ASSERT_TRUE(PngCache(dir.path).Get(key, &out2));
+  EXPECT_EQ(crunched, ToString(out2));
+  EXPECT_FALSE(cache.Get(PngCache::Key("original", "9.png"), &out2));
+}
+
+}  // namespace aapt
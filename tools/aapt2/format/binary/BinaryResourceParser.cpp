@@ -357,6 +357,12 @@ bool BinaryResourceParser::ParseType(const ResourceTablePackage* package,
 
     const ResourceId res_id(package->id.value(), type->id, static_cast<uint16_t>(it.index()));
 
+    if (only_type_ && only_type_.value() != *parsed_type) {
+      // The name is still needed to resolve the references to it.
+      id_index_.insert({res_id, name});
+      continue;
+    }
+
     std::unique_ptr<Value> resource_value;
     if (entry->flags & ResTable_entry::FLAG_COMPLEX) {
       const ResTable_map_entry* mapEntry = static_cast<const ResTable_map_entry*>(entry);
@@ -42,6 +42,11 @@ class BinaryResourceParser {
   BinaryResourceParser(IDiagnostics* diag, ResourceTable* table, const Source& source,
                        const void* data, size_t data_len, io::IFileCollection* files = nullptr);
 
+  // Only adds the resources of `type` to the table, the values of the others aren't parsed.
+  void SetOnlyType(ResourceType type) {
+    only_type_ = type;
+  }
+
   // Parses the binary resource table and returns true if successful.
   bool Parse();
 
@@ -91,6 +96,9 @@ class BinaryResourceParser {
   // Optional file collection from which to create io::IFile objects.
   io::IFileCollection* files_;
 
+  // When set, the only type of resources to add to the table.
+  Maybe<ResourceType> only_type_;
+
   // The standard value string pool for resource values.
   android::ResStringPool value_pool_;
 
@@ -77,6 +77,27 @@ struct FlatEntry {
   uint32_t entry_key;
 };
 
+// Returns an upper bound of the size of the flattened entry of `value`, so that the values of a
+// type can be flattened into a buffer of the right size.
+static size_t MaxFlattenedSize(const Value* value) {
+  size_t map_entry_count = 0;
+  if (ValueCast<Item>(value)) {
+    return sizeof(ResTable_entry) + sizeof(Res_value);
+  } else if (const Attribute* attr = ValueCast<Attribute>(value)) {
+    // The type mask, min and max, then the symbols.
+    map_entry_count = 3 + attr->symbols.size();
+  } else if (const Style* style = ValueCast<Style>(value)) {
+    map_entry_count = style->entries.size();
+  } else if (const Styleable* styleable = ValueCast<Styleable>(value)) {
+    map_entry_count = styleable->entries.size();
+  } else if (const Array* array = ValueCast<Array>(value)) {
+    map_entry_count = array->elements.size();
+  } else if (ValueCast<Plural>(value)) {
+    map_entry_count = Plural::Count;
+  }
+  return sizeof(ResTable_entry_ext) + map_entry_count * sizeof(ResTable_map);
+}
+
 class MapFlattenVisitor : public ValueVisitor {
  public:
   using ValueVisitor::Visit;
@@ -331,7 +352,14 @@ class PackageFlattener {
     std::vector<uint32_t> offsets;
     offsets.resize(num_total_entries, 0xffffffffu);
 
+    // Flatten the values in a single block rather than in many blocks of 512 bytes.
     BigBuffer values_buffer(512);
+    size_t max_values_size = 0;
+    for (const FlatEntry& flat_entry : *entries) {
+      max_values_size += MaxFlattenedSize(flat_entry.value);
+    }
+    values_buffer.Reserve(max_values_size);
+
     for (FlatEntry& flat_entry : *entries) {
       CHECK(static_cast<size_t>(flat_entry.entry->id.value()) < num_total_entries);
       offsets[flat_entry.entry->id.value()] = values_buffer.size();
@@ -359,6 +387,9 @@ class PackageFlattener {
     sparse_encode =
         sparse_encode && ((100 * entries->size()) / num_total_entries) < kSparseEncodingThreshold;
 
+    type_writer.buffer()->Reserve(
+        sparse_encode ? entries->size() * sizeof(ResTable_sparseTypeEntry)
+                      : num_total_entries * sizeof(uint32_t));
     if (sparse_encode) {
       type_header->entryCount = util::HostToDevice32(entries->size());
       type_header->flags |= ResTable_type::FLAG_SPARSE;
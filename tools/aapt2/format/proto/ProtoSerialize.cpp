@@ -582,7 +582,7 @@ void SerializeItemToPb(const Item& item, pb::Item* out_item) {
 
 void SerializeCompiledFileToPb(const ResourceFile& file, pb::internal::CompiledFile* out_file) {
   out_file->set_resource_name(file.name.to_string());
-  out_file->set_source_path(file.source.path);
+  out_file->set_source_path(file.source.path.str());
   out_file->set_type(SerializeFileReferenceTypeToPb(file.type));
   SerializeConfig(file.config, out_file->mutable_config());
 
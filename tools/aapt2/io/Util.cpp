@@ -50,8 +50,19 @@ bool CopyFileToArchive(IAaptContext* context, io::IFile* file, const std::string
 
 bool CopyFileToArchivePreserveCompression(IAaptContext* context, io::IFile* file,
                                           const std::string& out_path, IArchiveWriter* writer) {
-  uint32_t compression_flags = file->WasCompressed() ? ArchiveEntry::kCompress : 0u;
-  return CopyFileToArchive(context, file, out_path, compression_flags, writer);
+  if (!file->WasCompressed()) {
+    return CopyFileToArchive(context, file, out_path, 0u, writer);
+  }
+
+  // The file is already known to compress well, so it's inflated as it's written instead of
+  // being extracted whole, and the archive doesn't compress it a second time to check whether it
+  // should be stored instead, which a rewindable input would make it do.
+  std::unique_ptr<io::InputStream> in = file->OpenInputStream();
+  if (in == nullptr || in->HadError()) {
+    context->GetDiagnostics()->Error(DiagMessage(file->GetSource()) << "failed to open file");
+    return false;
+  }
+  return CopyInputStreamToArchive(context, in.get(), out_path, ArchiveEntry::kCompress, writer);
 }
 
 bool CopyProtoToArchive(IAaptContext* context, ::google::protobuf::MessageLite* proto_msg,
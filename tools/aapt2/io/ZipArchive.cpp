@@ -16,6 +16,12 @@
 
 #include "io/ZipArchive.h"
 
+#include <zlib.h>
+
+#include <algorithm>
+
+#include "android-base/file.h"
+#include "android-base/macros.h"
 #include "utils/FileMap.h"
 #include "ziparchive/zip_archive.h"
 
@@ -27,6 +33,126 @@ using ::android::StringPiece;
 namespace aapt {
 namespace io {
 
+namespace {
+
+// Inflates a compressed ZIP entry as it is read, a window at a time, so that the whole entry is
+// never held in memory.
+class ZipEntryInputStream : public InputStream {
+ public:
+  ZipEntryInputStream(int fd, const ZipEntry& entry)
+      : fd_(fd),
+        entry_(entry),
+        in_buffer_(new uint8_t[kBufferSize]),
+        out_buffer_(new uint8_t[kBufferSize]) {
+    stream_ = {};
+    if (inflateInit2(&stream_, -MAX_WBITS) != Z_OK) {
+      error_ = "failed to initialize zlib";
+    } else {
+      initialized_ = true;
+    }
+  }
+
+  ~ZipEntryInputStream() override {
+    if (initialized_) {
+      inflateEnd(&stream_);
+    }
+  }
+
+  bool Next(const void** data, size_t* size) override {
+    if (HadError()) {
+      return false;
+    }
+
+    if (backup_count_ > 0) {
+      *data = out_buffer_.get() + out_size_ - backup_count_;
+      *size = backup_count_;
+      backup_count_ = 0;
+      return true;
+    }
+
+    out_size_ = 0;
+    while (out_size_ == 0) {
+      if (finished_) {
+        return false;
+      }
+
+      if (stream_.avail_in == 0 && compressed_read_ < entry_.compressed_length) {
+        const size_t len = std::min<size_t>(kBufferSize,
+                                            entry_.compressed_length - compressed_read_);
+        if (!android::base::ReadFullyAtOffset(fd_, in_buffer_.get(), len,
+                                              entry_.offset + compressed_read_)) {
+          error_ = "failed to read compressed data";
+          return false;
+        }
+        compressed_read_ += len;
+        stream_.next_in = in_buffer_.get();
+        stream_.avail_in = static_cast<uInt>(len);
+      }
+
+      stream_.next_out = out_buffer_.get();
+      stream_.avail_out = static_cast<uInt>(kBufferSize);
+      const int result = inflate(&stream_, Z_NO_FLUSH);
+      if (result != Z_OK && result != Z_STREAM_END) {
+        error_ = stream_.msg != nullptr ? stream_.msg : "failed to inflate data";
+        return false;
+      }
+
+      out_size_ = kBufferSize - stream_.avail_out;
+      crc_ = crc32(crc_, out_buffer_.get(), static_cast<uInt>(out_size_));
+      total_size_ += out_size_;
+
+      if (result == Z_STREAM_END) {
+        finished_ = true;
+        if (total_size_ != entry_.uncompressed_length || crc_ != entry_.crc32) {
+          error_ = "corrupt compressed data";
+          return false;
+        }
+      }
+    }
+
+    *data = out_buffer_.get();
+    *size = out_size_;
+    return true;
+  }
+
+  void BackUp(size_t count) override {
+    backup_count_ = std::min(count, out_size_);
+  }
+
+  size_t ByteCount() const override {
+    return total_size_ - backup_count_;
+  }
+
+  std::string GetError() const override {
+    return error_;
+  }
+
+  bool HadError() const override {
+    return !error_.empty();
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ZipEntryInputStream);
+
+  static constexpr size_t kBufferSize = 32 * 1024;
+
+  int fd_;
+  ZipEntry entry_;
+  std::unique_ptr<uint8_t[]> in_buffer_;
+  std::unique_ptr<uint8_t[]> out_buffer_;
+  z_stream stream_;
+  bool initialized_ = false;
+  bool finished_ = false;
+  size_t compressed_read_ = 0u;
+  size_t out_size_ = 0u;
+  size_t backup_count_ = 0u;
+  size_t total_size_ = 0u;
+  uLong crc_ = 0u;
+  std::string error_;
+};
+
+}  // namespace
+
 ZipFile::ZipFile(ZipArchiveHandle handle, const ZipEntry& entry,
                  const Source& source)
     : zip_handle_(handle), zip_entry_(entry), source_(source) {}
@@ -58,7 +184,10 @@ std::unique_ptr<IData> ZipFile::OpenAsData() {
 }
 
 std::unique_ptr<io::InputStream> ZipFile::OpenInputStream() {
-  return OpenAsData();
+  if (zip_entry_.method == kCompressStored) {
+    return OpenAsData();
+  }
+  return util::make_unique<ZipEntryInputStream>(GetFileDescriptor(zip_handle_), zip_entry_);
 }
 
 const Source& ZipFile::GetSource() const {
@@ -34,6 +34,7 @@
 #include "process/IResourceTableConsumer.h"
 #include "split/TableSplitter.h"
 #include "util/Files.h"
+#include "util/Parallel.h"
 #include "xml/XmlDom.h"
 #include "xml/XmlUtil.h"
 
@@ -46,12 +47,16 @@ using ::aapt::xml::XmlResource;
 using ::android::StringPiece;
 
 /**
- * Context wrapper that allows the min Android SDK value to be overridden.
+ * Context wrapper that allows the min Android SDK value and the diagnostics to be overridden.
  */
 class ContextWrapper : public IAaptContext {
  public:
   explicit ContextWrapper(IAaptContext* context)
-      : context_(context), min_sdk_(context_->GetMinSdkVersion()) {
+      : ContextWrapper(context, context->GetDiagnostics()) {
+  }
+
+  ContextWrapper(IAaptContext* context, IDiagnostics* diag)
+      : context_(context), diag_(diag), min_sdk_(context_->GetMinSdkVersion()) {
   }
 
   PackageType GetPackageType() override {
@@ -66,7 +71,7 @@ class ContextWrapper : public IAaptContext {
     if (source_diag_) {
       return source_diag_.get();
     }
-    return context_->GetDiagnostics();
+    return diag_;
   }
 
   const std::string& GetCompilationPackage() override {
@@ -94,12 +99,12 @@ class ContextWrapper : public IAaptContext {
   }
 
   void SetSource(const std::string& source) {
-    source_diag_ =
-        util::make_unique<SourcePathDiagnostics>(Source{source}, context_->GetDiagnostics());
+    source_diag_ = util::make_unique<SourcePathDiagnostics>(Source{source}, diag_);
   }
 
  private:
   IAaptContext* context_;
+  IDiagnostics* diag_;
   std::unique_ptr<SourcePathDiagnostics> source_diag_;
 
   int min_sdk_ = -1;
@@ -124,13 +129,8 @@ bool MultiApkGenerator::FromBaseApk(const MultiApkGeneratorOptions& options) {
   std::unordered_set<std::string> filtered_artifacts;
   std::unordered_set<std::string> kept_artifacts;
 
-  // For now, just write out the stripped APK since ABI splitting doesn't modify anything else.
+  std::vector<const OutputArtifact*> artifacts;
   for (const OutputArtifact& artifact : options.apk_artifacts) {
-    FilterChain filters;
-
-    ContextWrapper wrapped_context{context_};
-    wrapped_context.SetSource(artifact.name);
-
     if (!options.kept_artifacts.empty()) {
       const auto& it = artifacts_to_keep.find(artifact.name);
       if (it == artifacts_to_keep.end()) {
@@ -144,42 +144,31 @@ bool MultiApkGenerator::FromBaseApk(const MultiApkGeneratorOptions& options) {
         kept_artifacts.insert(artifact.name);
       }
     }
+    artifacts.push_back(&artifact);
+  }
 
-    std::unique_ptr<ResourceTable> table =
-        FilterTable(context_, artifact, *apk_->GetResourceTable(), &filters);
-    if (!table) {
-      return false;
-    }
-
-    IDiagnostics* diag = wrapped_context.GetDiagnostics();
-
-    std::unique_ptr<XmlResource> manifest;
-    if (!UpdateManifest(artifact, &manifest, diag)) {
-      diag->Error(DiagMessage() << "could not update AndroidManifest.xml for output artifact");
-      return false;
-    }
-
-    std::string out = options.out_dir;
-    if (!file::mkdirs(out)) {
-      diag->Warn(DiagMessage() << "could not create out dir: " << out);
-    }
-    file::AppendPath(&out, artifact.name);
-
-    if (context_->IsVerbose()) {
-      diag->Note(DiagMessage() << "Generating split: " << out);
-    }
-
-    std::unique_ptr<IArchiveWriter> writer = CreateZipFileArchiveWriter(diag, out);
-
-    if (context_->IsVerbose()) {
-      diag->Note(DiagMessage() << "Writing output: " << out);
-    }
+  if (!artifacts.empty() && !file::mkdirs(options.out_dir)) {
+    context_->GetDiagnostics()->Warn(DiagMessage() << "could not create out dir: "
+                                                   << options.out_dir);
+  }
 
-    filters.AddFilter(util::make_unique<SignatureFilter>());
-    if (!apk_->WriteToArchive(&wrapped_context, table.get(), options.table_flattener_options,
-                              &filters, writer.get(), manifest.get())) {
-      return false;
-    }
+  // The artifacts only read the base APK, so they are generated on up to options.jobs threads,
+  // each with its own copy of the table. Their diagnostics are logged in the artifact order.
+  std::vector<std::unique_ptr<BufferedDiagnostics>> diagnostics(artifacts.size());
+  std::unique_ptr<bool[]> generated(new bool[artifacts.size()]());
+  const bool success = util::ParallelForInOrder(
+      artifacts.size(), options.jobs,
+      [&](size_t i) {
+        diagnostics[i] = util::make_unique<BufferedDiagnostics>();
+        generated[i] = WriteArtifact(*artifacts[i], options, diagnostics[i].get());
+      },
+      [&](size_t i) {
+        diagnostics[i]->Replay(context_->GetDiagnostics());
+        diagnostics[i].reset();
+        return generated[i];
+      });
+  if (!success) {
+    return false;
   }
 
   // Make sure all of the requested artifacts were valid. If there are any kept artifacts left,
@@ -209,6 +198,48 @@ bool MultiApkGenerator::FromBaseApk(const MultiApkGeneratorOptions& options) {
   return true;
 }
 
+bool MultiApkGenerator::WriteArtifact(const OutputArtifact& artifact,
+                                      const MultiApkGeneratorOptions& options,
+                                      IDiagnostics* diagnostics) {
+  FilterChain filters;
+
+  ContextWrapper artifact_context{context_, diagnostics};
+  ContextWrapper wrapped_context{context_, diagnostics};
+  wrapped_context.SetSource(artifact.name);
+
+  // For now, just write out the stripped APK since ABI splitting doesn't modify anything else.
+  std::unique_ptr<ResourceTable> table =
+      FilterTable(&artifact_context, artifact, *apk_->GetResourceTable(), &filters);
+  if (!table) {
+    return false;
+  }
+
+  IDiagnostics* diag = wrapped_context.GetDiagnostics();
+
+  std::unique_ptr<XmlResource> manifest;
+  if (!UpdateManifest(artifact, &manifest, diag)) {
+    diag->Error(DiagMessage() << "could not update AndroidManifest.xml for output artifact");
+    return false;
+  }
+
+  std::string out = options.out_dir;
+  file::AppendPath(&out, artifact.name);
+
+  if (context_->IsVerbose()) {
+    diag->Note(DiagMessage() << "Generating split: " << out);
+  }
+
+  std::unique_ptr<IArchiveWriter> writer = CreateZipFileArchiveWriter(diag, out);
+
+  if (context_->IsVerbose()) {
+    diag->Note(DiagMessage() << "Writing output: " << out);
+  }
+
+  filters.AddFilter(util::make_unique<SignatureFilter>());
+  return apk_->WriteToArchive(&wrapped_context, table.get(), options.table_flattener_options,
+                              &filters, writer.get(), manifest.get());
+}
+
 std::unique_ptr<ResourceTable> MultiApkGenerator::FilterTable(IAaptContext* context,
                                                               const OutputArtifact& artifact,
                                                               const ResourceTable& old_table,
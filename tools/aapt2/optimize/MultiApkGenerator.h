@@ -33,6 +33,8 @@ struct MultiApkGeneratorOptions {
   std::vector<configuration::OutputArtifact> apk_artifacts;
   TableFlattenerOptions table_flattener_options;
   std::unordered_set<std::string> kept_artifacts;
+  // The number of artifacts generated at the same time. Each holds its own copy of the table.
+  size_t jobs = 1;
 };
 
 /**
@@ -60,6 +62,13 @@ class MultiApkGenerator {
     return context_->GetDiagnostics();
   }
 
+  /**
+   * Filters the table and the manifest for the artifact and writes its APK. Only reads the base
+   * APK and logs to `diagnostics`, so several artifacts can be written at once.
+   */
+  bool WriteArtifact(const configuration::OutputArtifact& artifact,
+                     const MultiApkGeneratorOptions& options, IDiagnostics* diagnostics);
+
   bool UpdateManifest(const configuration::OutputArtifact& artifact,
                       std::unique_ptr<xml::XmlResource>* updated_manifest, IDiagnostics* diag);
 
@@ -17,14 +17,134 @@
 #include "optimize/ResourceDeduper.h"
 
 #include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/JenkinsHash.h"
 
 #include "DominatorTree.h"
 #include "ResourceTable.h"
+#include "ResourceValues.h"
+#include "ValueVisitor.h"
+#include "util/Parallel.h"
 
 namespace aapt {
 
 namespace {
 
+/**
+ * Computes a structural hash of a value: values for which Value::Equals is true have the same
+ * hash, so that values with different hashes don't need to be compared. Only hashes the fields
+ * that are cheap to get at, the collisions are resolved by Value::Equals.
+ */
+class ValueHasher : public ConstValueVisitor {
+ public:
+  using ConstValueVisitor::Visit;
+
+  static uint32_t Hash(const Value* value) {
+    ValueHasher hasher;
+    value->Accept(&hasher);
+    return hasher.hash_;
+  }
+
+  void Visit(const Reference* ref) override {
+    Mix(1);
+    Mix(HashReference(*ref));
+  }
+
+  void Visit(const Id* /*id*/) override {
+    Mix(2);
+  }
+
+  void Visit(const RawString* str) override {
+    Mix(3);
+    Mix(HashString(*str->value));
+  }
+
+  void Visit(const String* str) override {
+    Mix(4);
+    Mix(HashString(*str->value));
+  }
+
+  void Visit(const StyledString* str) override {
+    Mix(5);
+    Mix(HashString(str->value->value));
+  }
+
+  void Visit(const FileReference* file) override {
+    Mix(6);
+    Mix(HashString(*file->path));
+  }
+
+  void Visit(const BinaryPrimitive* prim) override {
+    Mix(7);
+    Mix(prim->value.dataType);
+    Mix(prim->value.data);
+  }
+
+  void Visit(const Attribute* attr) override {
+    // The symbols are compared in any order, only their count is hashed.
+    Mix(8);
+    Mix(attr->type_mask);
+    Mix(static_cast<uint32_t>(attr->min_int));
+    Mix(static_cast<uint32_t>(attr->max_int));
+    Mix(attr->symbols.size());
+  }
+
+  void Visit(const Style* style) override {
+    // The entries are compared in any order, so their hashes are summed.
+    Mix(9);
+    Mix(style->parent ? HashReference(style->parent.value()) : 0u);
+    uint32_t entries_hash = 0;
+    for (const Style::Entry& entry : style->entries) {
+      entries_hash += android::JenkinsHashMix(HashReference(entry.key), Hash(entry.value.get()));
+    }
+    Mix(entries_hash);
+  }
+
+  void Visit(const Array* array) override {
+    Mix(10);
+    for (const std::unique_ptr<Item>& element : array->elements) {
+      Mix(Hash(element.get()));
+    }
+  }
+
+  void Visit(const Plural* plural) override {
+    Mix(11);
+    for (const std::unique_ptr<Item>& item : plural->values) {
+      Mix(item ? Hash(item.get()) : 0u);
+    }
+  }
+
+  void Visit(const Styleable* styleable) override {
+    Mix(12);
+    for (const Reference& entry : styleable->entries) {
+      Mix(HashReference(entry));
+    }
+  }
+
+ private:
+  static uint32_t HashString(const std::string& str) {
+    return static_cast<uint32_t>(std::hash<std::string>()(str));
+  }
+
+  static uint32_t HashReference(const Reference& ref) {
+    uint32_t hash = static_cast<uint32_t>(ref.reference_type);
+    hash = android::JenkinsHashMix(hash, ref.private_reference);
+    hash = android::JenkinsHashMix(hash, ref.id ? ref.id.value().id : 0u);
+    hash = android::JenkinsHashMix(
+        hash, ref.name ? static_cast<uint32_t>(std::hash<ResourceName>()(ref.name.value())) : 0u);
+    return hash;
+  }
+
+  void Mix(uint32_t data) {
+    hash_ = android::JenkinsHashMix(hash_, data);
+  }
+
+  uint32_t hash_ = 0;
+};
+
 /**
  * Remove duplicated key-value entries from dominated resources.
  *
@@ -40,8 +160,13 @@ class DominatedKeyValueRemover : public DominatorTree::BottomUpVisitor {
  public:
   using Node = DominatorTree::Node;
 
-  explicit DominatedKeyValueRemover(IAaptContext* context, ResourceEntry* entry)
-      : context_(context), entry_(entry) {}
+  DominatedKeyValueRemover(IAaptContext* context, IDiagnostics* diag, ResourceEntry* entry,
+                           std::vector<std::unique_ptr<Value>>* removed)
+      : context_(context), diag_(diag), entry_(entry), removed_(removed) {
+    for (const auto& config_value : entry->values) {
+      hashes_[config_value.get()] = ValueHasher::Hash(config_value->value.get());
+    }
+  }
 
   void VisitConfig(Node* node) {
     Node* parent = node->parent();
@@ -53,7 +178,9 @@ class DominatedKeyValueRemover : public DominatorTree::BottomUpVisitor {
     if (!node_value || !parent_value) {
       return;
     }
-    if (!node_value->value->Equals(parent_value->value.get())) {
+    const uint32_t node_hash = hashes_[node_value];
+    if (node_hash != hashes_[parent_value] ||
+        !node_value->value->Equals(parent_value->value.get())) {
       return;
     }
 
@@ -66,33 +193,45 @@ class DominatedKeyValueRemover : public DominatorTree::BottomUpVisitor {
         continue;
       }
       if (node_configuration.IsCompatibleWith(sibling->config) &&
-          !node_value->value->Equals(sibling->value.get())) {
+          (node_hash != hashes_[sibling.get()] ||
+           !node_value->value->Equals(sibling->value.get()))) {
         // The configurations are compatible, but the value is
         // different, so we can't remove this value.
         return;
       }
     }
     if (context_->IsVerbose()) {
-      context_->GetDiagnostics()->Note(
-          DiagMessage(node_value->value->GetSource())
-          << "removing dominated duplicate resource with name \""
-          << entry_->name << "\"");
-      context_->GetDiagnostics()->Note(
-          DiagMessage(parent_value->value->GetSource()) << "dominated here");
+      diag_->Note(DiagMessage(node_value->value->GetSource())
+                  << "removing dominated duplicate resource with name \"" << entry_->name
+                  << "\"");
+      diag_->Note(DiagMessage(parent_value->value->GetSource()) << "dominated here");
     }
-    node_value->value = {};
+    removed_->push_back(std::move(node_value->value));
   }
 
  private:
   DISALLOW_COPY_AND_ASSIGN(DominatedKeyValueRemover);
 
   IAaptContext* context_;
+  IDiagnostics* diag_;
   ResourceEntry* entry_;
+  std::vector<std::unique_ptr<Value>>* removed_;
+
+  // The structural hash of the value of each config.
+  std::unordered_map<const ResourceConfigValue*, uint32_t> hashes_;
 };
 
-static void DedupeEntry(IAaptContext* context, ResourceEntry* entry) {
+// The removed values are moved to `removed` rather than destroyed: destroying a value releases its
+// StringPool references, whose counts aren't thread safe.
+static void DedupeEntry(IAaptContext* context, IDiagnostics* diag, ResourceEntry* entry,
+                        std::vector<std::unique_ptr<Value>>* removed) {
+  if (entry->values.size() < 2) {
+    // Nothing to dedupe.
+    return;
+  }
+
   DominatorTree tree(entry->values);
-  DominatedKeyValueRemover remover(context, entry);
+  DominatedKeyValueRemover remover(context, diag, entry, removed);
   tree.Accept(&remover);
 
   // Erase the values that were removed.
@@ -108,14 +247,31 @@ static void DedupeEntry(IAaptContext* context, ResourceEntry* entry) {
 }  // namespace
 
 bool ResourceDeduper::Consume(IAaptContext* context, ResourceTable* table) {
+  std::vector<ResourceTableType*> types;
   for (auto& package : table->packages) {
     for (auto& type : package->types) {
-      for (auto& entry : type->entries) {
-        DedupeEntry(context, entry.get());
-      }
+      types.push_back(type.get());
     }
   }
-  return true;
+
+  // The types are independent, the notes of each are logged in order once it is deduped.
+  // The removed values of each are destroyed on this thread too.
+  std::vector<std::unique_ptr<BufferedDiagnostics>> diags(types.size());
+  std::vector<std::vector<std::unique_ptr<Value>>> removed(types.size());
+  return util::ParallelForInOrder(
+      types.size(), jobs_,
+      [&](size_t i) {
+        diags[i] = util::make_unique<BufferedDiagnostics>();
+        for (auto& entry : types[i]->entries) {
+          DedupeEntry(context, diags[i].get(), entry.get(), &removed[i]);
+        }
+      },
+      [&](size_t i) {
+        diags[i]->Replay(context->GetDiagnostics());
+        diags[i].reset();
+        removed[i].clear();
+        return true;
+      });
 }
 
 }  // namespace aapt
@@ -28,12 +28,16 @@ class ResourceTable;
 // Removes duplicated key-value entries from dominated resources.
 class ResourceDeduper : public IResourceTableConsumer {
  public:
-  ResourceDeduper() = default;
+  // Processes the types of the table on up to `jobs` threads.
+  explicit ResourceDeduper(size_t jobs = 1) : jobs_(jobs) {
+  }
 
   bool Consume(IAaptContext* context, ResourceTable* table) override;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(ResourceDeduper);
+
+  size_t jobs_;
 };
 
 } // namespace aapt
@@ -17,6 +17,7 @@
 #include "optimize/ResourceDeduper.h"
 
 #include "ResourceTable.h"
+#include "ResourceUtils.h"
 #include "test/Test.h"
 
 using ::aapt::test::HasValue;
@@ -103,4 +104,42 @@ TEST(ResourceDeduperTest, LocalesValuesAreKept) {
   EXPECT_THAT(table, HasValue("android:string/keep", fr_rCA_config));
 }
 
+TEST(ResourceDeduperTest, StylesWithEntriesInAnyOrderAreDeduped) {
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder().Build();
+  const ConfigDescription default_config = {};
+  const ConfigDescription land_config = test::ParseConfigOrDie("land");
+  const ConfigDescription port_config = test::ParseConfigOrDie("port");
+
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder()
+          .AddValue("android:style/dedupe", default_config, ResourceId{},
+                    test::StyleBuilder()
+                        .AddItem("android:attr/foo", ResourceUtils::TryParseBool("true"))
+                        .AddItem("android:attr/bar", ResourceUtils::TryParseInt("1"))
+                        .Build())
+          .AddValue("android:style/dedupe", land_config, ResourceId{},
+                    test::StyleBuilder()
+                        .AddItem("android:attr/bar", ResourceUtils::TryParseInt("1"))
+                        .AddItem("android:attr/foo", ResourceUtils::TryParseBool("true"))
+                        .Build())
+          .AddValue("android:style/keep", default_config, ResourceId{},
+                    test::StyleBuilder()
+                        .AddItem("android:attr/foo", ResourceUtils::TryParseBool("true"))
+                        .Build())
+          .AddValue("android:style/keep", port_config, ResourceId{},
+                    test::StyleBuilder()
+                        .AddItem("android:attr/foo", ResourceUtils::TryParseBool("false"))
+                        .Build())
+          .AddString("android:string/dedupe", ResourceId{}, default_config, "dedupe")
+          .AddString("android:string/dedupe", ResourceId{}, land_config, "dedupe")
+          .Build();
+
+  // The types are deduped on their own threads.
+  ASSERT_TRUE(ResourceDeduper(2).Consume(context.get(), table.get()));
+  EXPECT_THAT(table, Not(HasValue("android:style/dedupe", land_config)));
+  EXPECT_THAT(table, HasValue("android:style/keep", default_config));
+  EXPECT_THAT(table, HasValue("android:style/keep", port_config));
+  EXPECT_THAT(table, Not(HasValue("android:string/dedupe", land_config)));
+}
+
 }  // namespace aapt
@@ -17,90 +17,34 @@
 #include "optimize/VersionCollapser.h"
 
 #include <algorithm>
+#include <set>
 #include <vector>
 
 #include "ResourceTable.h"
+#include "util/Parallel.h"
 
 namespace aapt {
 
-template <typename Iterator, typename Pred>
-class FilterIterator {
- public:
-  FilterIterator(Iterator begin, Iterator end, Pred pred = Pred())
-      : current_(begin), end_(end), pred_(pred) {
-    Advance();
-  }
-
-  bool HasNext() { return current_ != end_; }
-
-  Iterator NextIter() {
-    Iterator iter = current_;
-    ++current_;
-    Advance();
-    return iter;
-  }
-
-  typename Iterator::reference Next() { return *NextIter(); }
-
- private:
-  void Advance() {
-    for (; current_ != end_; ++current_) {
-      if (pred_(*current_)) {
-        return;
-      }
-    }
-  }
-
-  Iterator current_, end_;
-  Pred pred_;
-};
-
-template <typename Iterator, typename Pred>
-FilterIterator<Iterator, Pred> make_filter_iterator(Iterator begin,
-                                                    Iterator end = Iterator(),
-                                                    Pred pred = Pred()) {
-  return FilterIterator<Iterator, Pred>(begin, end, pred);
-}
-
 /**
  * Every Configuration with an SDK version specified that is less than minSdk will be removed. The
  * exception is when there is no exact matching resource for the minSdk. The next smallest one will
  * be kept.
  */
-static void CollapseVersions(int min_sdk, ResourceEntry* entry) {
-  // First look for all sdks less than minSdk.
-  for (auto iter = entry->values.rbegin(); iter != entry->values.rend();
-       ++iter) {
-    // Check if the item was already marked for removal.
-    if (!(*iter)) {
-      continue;
-    }
-
+// The removed values are moved to `removed` rather than destroyed: destroying a value releases its
+// StringPool references, whose counts aren't thread safe.
+static void CollapseVersions(int min_sdk, ResourceEntry* entry,
+                             std::vector<std::unique_ptr<ResourceConfigValue>>* removed) {
+  // Walk from the highest configuration down. The first configuration found with an SDK level
+  // smaller or equal to the minimum MUST be kept, and overrides all the others that only differ
+  // from it by a smaller SDK level, so they are removed. The configurations kept so far are looked
+  // up by their configuration without SDK version, instead of scanning the rest of the entry for
+  // each of them.
+  std::set<ConfigDescription> kept_configs_without_sdk;
+  for (auto iter = entry->values.rbegin(); iter != entry->values.rend(); ++iter) {
     const ConfigDescription& config = (*iter)->config;
-    if (config.sdkVersion <= min_sdk) {
-      // This is the first configuration we've found with a smaller or equal SDK level to the
-      // minimum. We MUST keep this one, but remove all others we find, which get overridden by this
-      // one.
-
-      ConfigDescription config_without_sdk = config.CopyWithoutSdkVersion();
-      auto pred = [&](const std::unique_ptr<ResourceConfigValue>& val) -> bool {
-        // Check that the value hasn't already been marked for removal.
-        if (!val) {
-          return false;
-        }
-
-        // Only return Configs that differ in SDK version.
-        config_without_sdk.sdkVersion = val->config.sdkVersion;
-        return config_without_sdk == val->config &&
-               val->config.sdkVersion <= min_sdk;
-      };
-
-      // Remove the rest that match.
-      auto filter_iter =
-          make_filter_iterator(iter + 1, entry->values.rend(), pred);
-      while (filter_iter.HasNext()) {
-        filter_iter.Next() = {};
-      }
+    if (config.sdkVersion <= min_sdk &&
+        !kept_configs_without_sdk.insert(config.CopyWithoutSdkVersion()).second) {
+      removed->push_back(std::move(*iter));
     }
   }
 
@@ -143,14 +87,26 @@ static void CollapseVersions(int min_sdk, ResourceEntry* entry) {
 
 bool VersionCollapser::Consume(IAaptContext* context, ResourceTable* table) {
   const int min_sdk = context->GetMinSdkVersion();
+  std::vector<ResourceTableType*> types;
   for (auto& package : table->packages) {
     for (auto& type : package->types) {
-      for (auto& entry : type->entries) {
-        CollapseVersions(min_sdk, entry.get());
-      }
+      types.push_back(type.get());
     }
   }
-  return true;
+
+  // The removed values are destroyed in order on this thread, once each type is collapsed.
+  std::vector<std::vector<std::unique_ptr<ResourceConfigValue>>> removed(types.size());
+  return util::ParallelForInOrder(
+      types.size(), jobs_,
+      [&](size_t i) {
+        for (auto& entry : types[i]->entries) {
+          CollapseVersions(min_sdk, entry.get(), &removed[i]);
+        }
+      },
+      [&](size_t i) {
+        removed[i].clear();
+        return true;
+      });
 }
 
 }  // namespace aapt
@@ -27,12 +27,16 @@ class ResourceTable;
 
 class VersionCollapser : public IResourceTableConsumer {
  public:
-  VersionCollapser() = default;
+  // Processes the types of the table on up to `jobs` threads.
+  explicit VersionCollapser(size_t jobs = 1) : jobs_(jobs) {
+  }
 
   bool Consume(IAaptContext* context, ResourceTable* table) override;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(VersionCollapser);
+
+  size_t jobs_;
 };
 
 } // namespace aapt
@@ -16,7 +16,11 @@
 
 #include "process/SymbolTable.h"
 
+#include <sys/stat.h>
+
 #include <iostream>
+#include <map>
+#include <mutex>
 
 #include "android-base/logging.h"
 #include "android-base/stringprintf.h"
@@ -35,22 +39,73 @@ using ::android::StringPiece16;
 
 namespace aapt {
 
+template <typename TKey>
+SymbolTable::SharedCache<TKey>::SharedCache(uint32_t max_capacity_per_shard) {
+  for (std::unique_ptr<Shard>& shard : shards_) {
+    shard = util::make_unique<Shard>(max_capacity_per_shard);
+  }
+}
+
+template <typename TKey>
+typename SymbolTable::SharedCache<TKey>::Shard& SymbolTable::SharedCache<TKey>::ShardFor(
+    const TKey& key) {
+  return *shards_[hash_type(key) % kShardCount];
+}
+
+template <typename TKey>
+std::shared_ptr<SymbolTable::Symbol> SymbolTable::SharedCache<TKey>::get(const TKey& key) {
+  Shard& shard = ShardFor(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return shard.cache.get(key);
+}
+
+template <typename TKey>
+void SymbolTable::SharedCache<TKey>::put(const TKey& key, const std::shared_ptr<Symbol>& symbol) {
+  Shard& shard = ShardFor(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  shard.cache.put(key, symbol);
+}
+
+template <typename TKey>
+void SymbolTable::SharedCache<TKey>::clear() {
+  for (std::unique_ptr<Shard>& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    shard->cache.clear();
+  }
+}
+
+// The cache is shared between threads, so a symbol returned to one thread may be evicted by
+// another before the caller is done with it. Each thread keeps its last few results alive, which
+// covers callers that hold on to a result while doing one more lookup.
+static const SymbolTable::Symbol* KeepAlive(const std::shared_ptr<SymbolTable::Symbol>& symbol) {
+  constexpr size_t kKeptCount = 4;
+  static thread_local std::shared_ptr<SymbolTable::Symbol> sKept[kKeptCount];
+  static thread_local size_t sNextKept = 0;
+  sKept[sNextKept] = symbol;
+  sNextKept = (sNextKept + 1) % kKeptCount;
+  return symbol.get();
+}
+
 SymbolTable::SymbolTable(NameMangler* mangler)
     : mangler_(mangler),
       delegate_(util::make_unique<DefaultSymbolTableDelegate>()),
-      cache_(200),
-      id_cache_(200) {
+      cache_(32),
+      id_cache_(32) {
 }
 
 void SymbolTable::SetDelegate(std::unique_ptr<ISymbolTableDelegate> delegate) {
   CHECK(delegate != nullptr) << "can't set a nullptr delegate";
-  delegate_ = std::move(delegate);
+  {
+    std::lock_guard<std::mutex> lock(sources_mutex_);
+    delegate_ = std::move(delegate);
+  }
 
   // Clear the cache in case this delegate changes the order of lookup.
   cache_.clear();
 }
 
 void SymbolTable::AppendSource(std::unique_ptr<ISymbolSource> source) {
+  std::lock_guard<std::mutex> lock(sources_mutex_);
   sources_.push_back(std::move(source));
 
   // We do not clear the cache, because sources earlier in the list take
@@ -58,7 +113,10 @@ void SymbolTable::AppendSource(std::unique_ptr<ISymbolSource> source) {
 }
 
 void SymbolTable::PrependSource(std::unique_ptr<ISymbolSource> source) {
-  sources_.insert(sources_.begin(), std::move(source));
+  {
+    std::lock_guard<std::mutex> lock(sources_mutex_);
+    sources_.insert(sources_.begin(), std::move(source));
+  }
 
   // We must clear the cache in case we did a lookup before adding this
   // resource.
@@ -78,8 +136,8 @@ const SymbolTable::Symbol* SymbolTable::FindByName(const ResourceName& name) {
   }
 
   // We store the name unmangled in the cache, so look it up as-is.
-  if (const std::shared_ptr<Symbol>& s = cache_.get(*name_with_package)) {
-    return s.get();
+  if (std::shared_ptr<Symbol> s = cache_.get(*name_with_package)) {
+    return KeepAlive(s);
   }
 
   // The name was not found in the cache. Mangle it (if necessary) and find it in our sources.
@@ -91,7 +149,11 @@ const SymbolTable::Symbol* SymbolTable::FindByName(const ResourceName& name) {
     mangled_name = &mangled_name_impl.value();
   }
 
-  std::unique_ptr<Symbol> symbol = delegate_->FindByName(*mangled_name, sources_);
+  std::unique_ptr<Symbol> symbol;
+  {
+    std::lock_guard<std::mutex> lock(sources_mutex_);
+    symbol = delegate_->FindByName(*mangled_name, sources_);
+  }
   if (symbol == nullptr) {
     return nullptr;
   }
@@ -111,16 +173,20 @@ const SymbolTable::Symbol* SymbolTable::FindByName(const ResourceName& name) {
 
   // Returns the raw pointer. Callers are not expected to hold on to this
   // between calls to Find*.
-  return shared_symbol.get();
+  return KeepAlive(shared_symbol);
 }
 
 const SymbolTable::Symbol* SymbolTable::FindById(const ResourceId& id) {
-  if (const std::shared_ptr<Symbol>& s = id_cache_.get(id)) {
-    return s.get();
+  if (std::shared_ptr<Symbol> s = id_cache_.get(id)) {
+    return KeepAlive(s);
   }
 
   // We did not find it in the cache, so look through the sources.
-  std::unique_ptr<Symbol> symbol = delegate_->FindById(id, sources_);
+  std::unique_ptr<Symbol> symbol;
+  {
+    std::lock_guard<std::mutex> lock(sources_mutex_);
+    symbol = delegate_->FindById(id, sources_);
+  }
   if (symbol == nullptr) {
     return nullptr;
   }
@@ -132,7 +198,7 @@ const SymbolTable::Symbol* SymbolTable::FindById(const ResourceId& id) {
 
   // Returns the raw pointer. Callers are not expected to hold on to this
   // between calls to Find*.
-  return shared_symbol.get();
+  return KeepAlive(shared_symbol);
 }
 
 const SymbolTable::Symbol* SymbolTable::FindByReference(const Reference& ref) {
@@ -211,7 +277,65 @@ std::unique_ptr<SymbolTable::Symbol> ResourceTableSymbolSource::FindByName(
   return symbol;
 }
 
+namespace {
+
+// An AssetManager kept around with a table loaded, which keeps the table shared by the
+// AssetManagers whose first asset path is the same file.
+struct LoadedFirstTable {
+  std::unique_ptr<android::AssetManager> assets;
+  time_t mtime;
+};
+
+std::mutex sLoadedFirstTablesMutex;
+bool sKeepFirstTableLoaded = false;
+std::map<std::string, LoadedFirstTable> sLoadedFirstTables;
+
+}  // namespace
+
+void AssetManagerSymbolSource::SetKeepFirstTableLoaded(bool keep) {
+  std::lock_guard<std::mutex> lock(sLoadedFirstTablesMutex);
+  sKeepFirstTableLoaded = keep;
+  if (!keep) {
+    sLoadedFirstTables.clear();
+  }
+}
+
+// Loads the table of `path` in an AssetManager that is kept until the file changes.
+static void KeepFirstTableLoaded(const std::string& path) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(sLoadedFirstTablesMutex);
+  if (!sKeepFirstTableLoaded) {
+    return;
+  }
+
+  LoadedFirstTable& loaded = sLoadedFirstTables[path];
+  if (loaded.assets != nullptr && loaded.mtime == st.st_mtime) {
+    return;
+  }
+
+  loaded.assets = util::make_unique<android::AssetManager>();
+  loaded.mtime = st.st_mtime;
+  int32_t cookie = 0;
+  if (!loaded.assets->addAssetPath(android::String8(path.data(), path.size()), &cookie)) {
+    sLoadedFirstTables.erase(path);
+    return;
+  }
+
+  // Parses the table, which the AssetManager shares with the next ones for this path.
+  loaded.assets->getResources(false);
+}
+
 bool AssetManagerSymbolSource::AddAssetPath(const StringPiece& path) {
+  if (!has_asset_path_) {
+    // Only the table of the first path of an AssetManager is shared.
+    KeepFirstTableLoaded(path.to_string());
+  }
+  has_asset_path_ = true;
+
   int32_t cookie = 0;
   return assets_.addAssetPath(android::String8(path.data(), path.size()), &cookie);
 }
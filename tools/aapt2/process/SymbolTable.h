@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include "android-base/macros.h"
@@ -85,6 +86,9 @@ class SymbolTable {
   // cause the existing cache to be cleared.
   void PrependSource(std::unique_ptr<ISymbolSource> source);
 
+  // The FindByXXX methods can be called from many threads at once, the sources must not change
+  // meanwhile. Lookups that hit the cache only lock a shard of it, the others are serialized.
+
   // NOTE: Never hold on to the result between calls to FindByXXX. The
   // results are stored in a cache which may evict entries on subsequent calls.
   const Symbol* FindByName(const ResourceName& name);
@@ -104,10 +108,41 @@ class SymbolTable {
   std::unique_ptr<ISymbolTableDelegate> delegate_;
   std::vector<std::unique_ptr<ISymbolSource>> sources_;
 
+  // An LruCache split in shards that each have their own lock, keys go to a shard by hash.
   // We use shared_ptr because unique_ptr is not supported and
   // we need automatic deletion.
-  android::LruCache<ResourceName, std::shared_ptr<Symbol>> cache_;
-  android::LruCache<ResourceId, std::shared_ptr<Symbol>> id_cache_;
+  template <typename TKey>
+  class SharedCache {
+   public:
+    explicit SharedCache(uint32_t max_capacity_per_shard);
+
+    std::shared_ptr<Symbol> get(const TKey& key);
+    void put(const TKey& key, const std::shared_ptr<Symbol>& symbol);
+    void clear();
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(SharedCache);
+
+    struct Shard {
+      explicit Shard(uint32_t max_capacity) : cache(max_capacity) {
+      }
+
+      std::mutex mutex;
+      android::LruCache<TKey, std::shared_ptr<Symbol>> cache;
+    };
+
+    static constexpr size_t kShardCount = 8;
+
+    Shard& ShardFor(const TKey& key);
+
+    std::unique_ptr<Shard> shards_[kShardCount];
+  };
+
+  // Guards the delegate and the sources, which aren't thread-safe, on a cache miss.
+  std::mutex sources_mutex_;
+
+  SharedCache<ResourceName> cache_;
+  SharedCache<ResourceId> id_cache_;
 
   DISALLOW_COPY_AND_ASSIGN(SymbolTable);
 };
@@ -191,6 +226,12 @@ class AssetManagerSymbolSource : public ISymbolSource {
  public:
   AssetManagerSymbolSource() = default;
 
+  // When set, the resource table of the first asset path of an AssetManagerSymbolSource, usually
+  // the framework, stays loaded after the source is destroyed, until that file changes. The
+  // sources created afterwards with the same first path then share it instead of parsing it
+  // again. For the daemon, which runs many commands in one process.
+  static void SetKeepFirstTableLoaded(bool keep);
+
   bool AddAssetPath(const android::StringPiece& path);
   std::map<size_t, std::string> GetAssignedPackageIds() const;
   bool IsPackageDynamic(uint32_t packageId) const;
@@ -207,6 +248,7 @@ class AssetManagerSymbolSource : public ISymbolSource {
 
  private:
   android::AssetManager assets_;
+  bool has_asset_path_ = false;
 
   DISALLOW_COPY_AND_ASSIGN(AssetManagerSymbolSource);
 };
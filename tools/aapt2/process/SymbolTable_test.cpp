@@ -16,6 +16,9 @@
 
 #include "process/SymbolTable.h"
 
+#include <atomic>
+#include <thread>
+
 #include "SdkConstants.h"
 #include "format/binary/TableFlattener.h"
 #include "test/Test.h"
@@ -120,4 +123,43 @@ TEST(SymbolTableTest, FindByNameWhenSymbolIsMangledInResTable) {
   EXPECT_THAT(symbol_table.FindByName(test::ParseNameOrDie("com.android.other:id/foo")), IsNull());
 }
 
+TEST(SymbolTableTest, ConcurrentLookups) {
+  // More symbols than the cache holds, so that the threads evict each other's entries.
+  const uint32_t kSymbolCount = 1000u;
+  test::ResourceTableBuilder builder;
+  for (uint32_t i = 0; i < kSymbolCount; i++) {
+    builder.AddSimple("com.android.app:id/foo" + std::to_string(i), ResourceId(0x7f010000 + i));
+  }
+  std::unique_ptr<ResourceTable> table = builder.Build();
+
+  NameMangler mangler(NameManglerPolicy{"com.android.app"});
+  SymbolTable symbol_table(&mangler);
+  symbol_table.AppendSource(util::make_unique<ResourceTableSymbolSource>(table.get()));
+
+  std::atomic<uint32_t> failures(0);
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < 4u; t++) {
+    threads.emplace_back([&, t]() {
+      for (uint32_t n = 0; n < 3u * kSymbolCount; n++) {
+        const uint32_t i = (n * 7u + t) % kSymbolCount;
+        const SymbolTable::Symbol* s =
+            symbol_table.FindByName(test::ParseNameOrDie("id/foo" + std::to_string(i)));
+        if (s == nullptr || !s->id || s->id.value() != ResourceId(0x7f010000 + i)) {
+          failures++;
+          continue;
+        }
+        // Found by name, so it's also cached by ID.
+        s = symbol_table.FindById(ResourceId(0x7f010000 + i));
+        if (s != nullptr && s->id.value() != ResourceId(0x7f010000 + i)) {
+          failures++;
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_THAT(failures.load(), Eq(0u));
+}
+
 }  // namespace aapt
@@ -31,6 +31,13 @@ Utf8Iterator::Utf8Iterator(const StringPiece& str)
 
 void Utf8Iterator::DoNext() {
   current_pos_ = next_pos_;
+  if (current_pos_ < str_.size() && static_cast<uint8_t>(str_.data()[current_pos_]) < 0x80) {
+    // ASCII needs no decoding.
+    current_codepoint_ = static_cast<char32_t>(str_.data()[current_pos_]);
+    next_pos_ = current_pos_ + 1;
+    return;
+  }
+
   int32_t result = utf32_from_utf8_at(str_.data(), str_.size(), current_pos_, &next_pos_);
   if (result == -1) {
     current_codepoint_ = 0u;
@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "trace/TraceBuffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "android-base/file.h"
+#include "android-base/stringprintf.h"
+
+using ::android::StringPiece;
+using ::android::base::StringPrintf;
+
+namespace aapt {
+namespace tracebuffer {
+
+namespace {
+
+struct Event {
+  std::string name;
+  std::string detail;
+  uint64_t start_us;
+  uint64_t duration_us;
+  uint64_t bytes;
+  uint32_t thread_id;
+};
+
+struct TraceState {
+  std::atomic<bool> enabled{false};
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::atomic<uint32_t> next_thread_id{1u};
+
+  std::mutex mutex;
+  std::vector<Event> events;
+};
+
+TraceState* GetState() {
+  // Never destroyed, spans may end during static destruction.
+  static TraceState* const sState = new TraceState();
+  return sState;
+}
+
+uint64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                               GetState()->start)
+      .count();
+}
+
+// Small ids that stay the same for a thread, which is how the trace viewer groups spans.
+uint32_t CurrentThreadId() {
+  thread_local uint32_t thread_id = GetState()->next_thread_id++;
+  return thread_id;
+}
+
+std::string EscapeJson(const StringPiece& str) {
+  std::string escaped;
+  escaped.reserve(str.size());
+  for (const char c : str) {
+    switch (c) {
+      case '"':
+        escaped += "\\\"";
+        break;
+      case '\\':
+        escaped += "\\\\";
+        break;
+      case '\n':
+        escaped += "\\n";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20u) {
+          escaped += StringPrintf("\\u%04x", static_cast<unsigned int>(c));
+        } else {
+          escaped += c;
+        }
+        break;
+    }
+  }
+  return escaped;
+}
+
+}  // namespace
+
+void Enable() {
+  GetState()->enabled = true;
+}
+
+bool IsEnabled() {
+  return GetState()->enabled;
+}
+
+Trace::Trace(const StringPiece& name, const StringPiece& detail) : enabled_(IsEnabled()) {
+  if (enabled_) {
+    name_ = name.to_string();
+    detail_ = detail.to_string();
+    start_us_ = NowUs();
+  }
+}
+
+Trace::~Trace() {
+  if (!enabled_) {
+    return;
+  }
+
+  Event event{std::move(name_), std::move(detail_), start_us_, NowUs() - start_us_, bytes_,
+              CurrentThreadId()};
+  TraceState* state = GetState();
+  std::lock_guard<std::mutex> lock(state->mutex);
+  state->events.push_back(std::move(event));
+}
+
+bool WriteTraceFile(const std::string& path, std::string* out_error) {
+  std::string json = "{\"traceEvents\":[\n";
+  {
+    TraceState* state = GetState();
+    std::lock_guard<std::mutex> lock(state->mutex);
+    for (size_t i = 0; i < state->events.size(); i++) {
+      const Event& event = state->events[i];
+      json += StringPrintf(
+          "{\"name\":\"%s\",\"cat\":\"aapt2\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+          "\"ts\":%llu,\"dur\":%llu,\"args\":{",
+          EscapeJson(event.name).c_str(), event.thread_id,
+          static_cast<unsigned long long>(event.start_us),
+          static_cast<unsigned long long>(event.duration_us));
+      if (!event.detail.empty()) {
+        json += StringPrintf("\"detail\":\"%s\",", EscapeJson(event.detail).c_str());
+      }
+      json += StringPrintf("\"bytes\":%llu}}%s\n", static_cast<unsigned long long>(event.bytes),
+                           i + 1 < state->events.size() ? "," : "");
+    }
+  }
+  json += "],\"displayTimeUnit\":\"ms\"}\n";
+
+  if (!android::base::WriteStringToFile(json, path)) {
+    if (out_error) *out_error = "failed to write trace file";
+    return false;
+  }
+  return true;
+}
+
+void PrintStats(std::ostream* out) {
+  struct Stats {
+    size_t count = 0u;
+    uint64_t duration_us = 0u;
+    uint64_t bytes = 0u;
+  };
+
+  std::map<std::string, Stats> stats_by_name;
+  {
+    TraceState* state = GetState();
+    std::lock_guard<std::mutex> lock(state->mutex);
+    for (const Event& event : state->events) {
+      Stats& stats = stats_by_name[event.name];
+      stats.count++;
+      stats.duration_us += event.duration_us;
+      stats.bytes += event.bytes;
+    }
+  }
+
+  // Slowest phases first. Spans of one phase may overlap when they ran on several threads.
+  std::vector<std::pair<std::string, Stats>> sorted(stats_by_name.begin(), stats_by_name.end());
+  std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) -> bool {
+    return a.second.duration_us > b.second.duration_us;
+  });
+
+  *out << StringPrintf("%-40s %8s %12s %14s\n", "phase", "count", "total ms", "bytes");
+  for (const auto& entry : sorted) {
+    *out << StringPrintf("%-40s %8zu %12.3f %14llu\n", entry.first.c_str(), entry.second.count,
+                         entry.second.duration_us / 1000.0,
+                         static_cast<unsigned long long>(entry.second.bytes));
+  }
+}
+
+}  // namespace tracebuffer
+}  // namespace aapt
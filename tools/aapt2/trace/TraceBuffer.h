@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_TRACE_TRACEBUFFER_H
+#define AAPT_TRACE_TRACEBUFFER_H
+
+#include <stdint.h>
+
+#include <ostream>
+#include <string>
+
+#include "android-base/macros.h"
+#include "androidfw/StringPiece.h"
+
+namespace aapt {
+namespace tracebuffer {
+
+// Starts recording the spans of the process. Until then, Trace objects do nothing.
+void Enable();
+bool IsEnabled();
+
+// Records the span from its construction to its destruction, on the calling thread. `name` is
+// the phase, like "Link: ReferenceLinker", and `detail` what it worked on, like an input file.
+class Trace {
+ public:
+  explicit Trace(const android::StringPiece& name, const android::StringPiece& detail = {});
+  ~Trace();
+
+  // The number of bytes processed during the span.
+  void SetBytes(uint64_t bytes) {
+    bytes_ = bytes;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(Trace);
+
+  bool enabled_;
+  std::string name_;
+  std::string detail_;
+  uint64_t start_us_ = 0u;
+  uint64_t bytes_ = 0u;
+};
+
+// Writes the spans recorded so far to `path` in the Chrome trace event format, which
+// chrome://tracing and Perfetto open.
+bool WriteTraceFile(const std::string& path, std::string* out_error);
+
+// Prints, for each phase, how many spans there were, their total time and their total bytes.
+void PrintStats(std::ostream* out);
+
+}  // namespace tracebuffer
+}  // namespace aapt
+
+#endif  // AAPT_TRACE_TRACEBUFFER_H
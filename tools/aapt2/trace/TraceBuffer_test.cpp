@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "trace/TraceBuffer.h"
+
+#include <sstream>
+#include <string>
+
+#include "android-base/file.h"
+#include "android-base/test_utils.h"
+
+#include "test/Test.h"
+
+using ::testing::HasSubstr;
+
+namespace aapt {
+namespace tracebuffer {
+
+TEST(TraceBufferTest, WritesSpansAndStats) {
+  Enable();
+  {
+    Trace trace("Test: phase", "res/layout/\"main\".xml");
+    trace.SetBytes(1234u);
+  }
+  { Trace trace("Test: phase"); }
+
+  TemporaryDir dir;
+  const std::string path = std::string(dir.path) + "/trace.json";
+  std::string error;
+  ASSERT_TRUE(WriteTraceFile(path, &error)) << error;
+
+  std::string json;
+  ASSERT_TRUE(android::base::ReadFileToString(path, &json));
+  EXPECT_THAT(json, HasSubstr("{\"traceEvents\":["));
+  EXPECT_THAT(json, HasSubstr("\"name\":\"Test: phase\",\"cat\":\"aapt2\",\"ph\":\"X\""));
+  EXPECT_THAT(json, HasSubstr("\"detail\":\"res/layout/\\\"main\\\".xml\",\"bytes\":1234}"));
+
+  std::stringstream stats;
+  PrintStats(&stats);
+  EXPECT_THAT(stats.str(), HasSubstr("Test: phase"));
+  EXPECT_THAT(stats.str(), HasSubstr(" 1234\n"));
+}
+
+}  // namespace tracebuffer
+}  // namespace aapt
@@ -96,6 +96,13 @@ class BigBuffer {
    */
   void BackUp(size_t count);
 
+  /**
+   * Makes sure that the next `size` bytes fit in the last block and at
+   * most one more, so that a payload of a known size isn't spread over many
+   * blocks of block_size() bytes.
+   */
+  void Reserve(size_t size);
+
   /**
    * Moves the specified BigBuffer into this one. When this method
    * returns, buffer is empty.
@@ -131,15 +138,19 @@ class BigBuffer {
   size_t block_size_;
   size_t size_;
   std::vector<Block> blocks_;
+
+  // The minimum size of the next block to allocate, set by Reserve().
+  size_t next_block_size_;
 };
 
 inline BigBuffer::BigBuffer(size_t block_size)
-    : block_size_(block_size), size_(0) {}
+    : block_size_(block_size), size_(0), next_block_size_(0) {}
 
 inline BigBuffer::BigBuffer(BigBuffer&& rhs)
     : block_size_(rhs.block_size_),
       size_(rhs.size_),
-      blocks_(std::move(rhs.blocks_)) {}
+      blocks_(std::move(rhs.blocks_)),
+      next_block_size_(rhs.next_block_size_) {}
 
 inline size_t BigBuffer::size() const { return size_; }
 
@@ -48,6 +48,26 @@ TEST(BigBufferTest, AllocateExactSizeBlockIfLargerThanBlockSize) {
   EXPECT_EQ(32u, buffer.size());
 }
 
+TEST(BigBufferTest, ReserveAllocatesOneBlockForTheReservedSize) {
+  BigBuffer buffer(16);
+
+  char* b1 = buffer.NextBlock<char>(8);
+  ASSERT_THAT(b1, NotNull());
+
+  // Fits in the current block, nothing to do.
+  buffer.Reserve(8);
+  EXPECT_EQ(b1 + 8, buffer.NextBlock<char>(8));
+
+  buffer.Reserve(64);
+  char* b2 = buffer.NextBlock<char>(4);
+  ASSERT_THAT(b2, NotNull());
+  for (int i = 0; i < 15; i++) {
+    EXPECT_EQ(b2 + 4 * (i + 1), buffer.NextBlock<char>(4));
+  }
+  EXPECT_EQ(80u, buffer.size());
+  EXPECT_EQ(2, std::distance(buffer.begin(), buffer.end()));
+}
+
 TEST(BigBufferTest, AppendAndMoveBlock) {
   BigBuffer buffer(16);
 
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/InternedString.h"
+
+#include <mutex>
+#include <unordered_set>
+
+using ::android::StringPiece;
+
+namespace aapt {
+
+static const std::string* Intern(const StringPiece& str) {
+  // Never destroyed, so that strings can be interned and held by static objects. The nodes of an
+  // unordered_set don't move, so the pointers to its strings stay valid.
+  static std::mutex* const sMutex = new std::mutex();
+  static std::unordered_set<std::string>* const sStrings = new std::unordered_set<std::string>();
+  static const std::string* const sEmpty = new std::string();
+  if (str.empty()) {
+    return sEmpty;
+  }
+
+  std::string key = str.to_string();
+  std::lock_guard<std::mutex> lock(*sMutex);
+  return &*sStrings->insert(std::move(key)).first;
+}
+
+InternedString::InternedString() : str_(Intern({})) {
+}
+
+InternedString::InternedString(const StringPiece& str) : str_(Intern(str)) {
+}
+
+InternedString::InternedString(const std::string& str) : str_(Intern(str)) {
+}
+
+InternedString::InternedString(const char* str) : str_(Intern(str)) {
+}
+
+}  // namespace aapt
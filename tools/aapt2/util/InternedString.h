@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_UTIL_INTERNEDSTRING_H
+#define AAPT_UTIL_INTERNEDSTRING_H
+
+#include <ostream>
+#include <string>
+
+#include "androidfw/StringPiece.h"
+
+namespace aapt {
+
+// A string that is stored once for the whole process however many copies of it are held, so
+// that copying and comparing it is as cheap as a pointer. Meant for the few strings that are
+// repeated a lot, like the path of a Source which every resource value of a file holds. The
+// strings are never freed. It can be used from many threads.
+class InternedString {
+ public:
+  InternedString();
+  InternedString(const android::StringPiece& str);  // NOLINT(implicit)
+  InternedString(const std::string& str);           // NOLINT(implicit)
+  InternedString(const char* str);                  // NOLINT(implicit)
+
+  const std::string& str() const {
+    return *str_;
+  }
+
+  operator const std::string&() const {  // NOLINT(implicit)
+    return *str_;
+  }
+
+  operator android::StringPiece() const {  // NOLINT(implicit)
+    return *str_;
+  }
+
+  const char* c_str() const {
+    return str_->c_str();
+  }
+
+  const char* data() const {
+    return str_->data();
+  }
+
+  size_t size() const {
+    return str_->size();
+  }
+
+  bool empty() const {
+    return str_->empty();
+  }
+
+  int compare(const InternedString& rhs) const {
+    return str_ == rhs.str_ ? 0 : str_->compare(*rhs.str_);
+  }
+
+  friend bool operator==(const InternedString& lhs, const InternedString& rhs) {
+    return lhs.str_ == rhs.str_;
+  }
+
+  friend bool operator!=(const InternedString& lhs, const InternedString& rhs) {
+    return lhs.str_ != rhs.str_;
+  }
+
+ private:
+  // Points to the only copy of the string.
+  const std::string* str_;
+};
+
+inline ::std::ostream& operator<<(::std::ostream& out, const InternedString& str) {
+  return out << str.str();
+}
+
+}  // namespace aapt
+
+#endif  // AAPT_UTIL_INTERNEDSTRING_H
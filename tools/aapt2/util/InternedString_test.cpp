@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/InternedString.h"
+
+#include "test/Test.h"
+
+using ::android::StringPiece;
+
+namespace aapt {
+
+TEST(InternedStringTest, EqualStringsAreStoredOnce) {
+  std::string path = "res/values/strings.xml";
+  InternedString a(path);
+  InternedString b(StringPiece("res/values/strings.xml"));
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(a.c_str(), b.c_str());
+  EXPECT_EQ(path, a.str());
+
+  InternedString c("res/values/colors.xml");
+  EXPECT_NE(a, c);
+  EXPECT_GT(a.compare(c), 0);
+  EXPECT_LT(c.compare(a), 0);
+  EXPECT_EQ(0, a.compare(b));
+}
+
+TEST(InternedStringTest, Empty) {
+  InternedString a;
+  InternedString b("");
+  EXPECT_TRUE(a.empty());
+  EXPECT_EQ(0u, a.size());
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a, InternedString("a"));
+}
+
+}  // namespace aapt
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_UTIL_PARALLEL_H
+#define AAPT_UTIL_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aapt {
+namespace util {
+
+// Calls produce(i) for every i in [0, count) on up to `jobs` threads, and consume(i) on the
+// calling thread in increasing order of i, each as soon as produce(i) has returned. The work that
+// has to be ordered, like logging or writing the output, goes in consume so that the result
+// doesn't depend on the scheduling.
+//
+// Stops as soon as consume returns false: the produce calls that haven't started yet are skipped
+// and false is returned.
+template <typename Produce, typename Consume>
+bool ParallelForInOrder(size_t count, size_t jobs, Produce produce, Consume consume) {
+  std::unique_ptr<bool[]> produced(new bool[count]());
+  std::mutex mutex;
+  std::condition_variable produced_cond;
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    size_t i;
+    while ((i = next++) < count) {
+      produce(i);
+
+      std::lock_guard<std::mutex> lock(mutex);
+      produced[i] = true;
+      produced_cond.notify_all();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  const size_t thread_count = std::min(std::max<size_t>(jobs, 1u), count);
+  for (size_t i = 0; i < thread_count; i++) {
+    threads.emplace_back(worker);
+  }
+
+  bool result = true;
+  for (size_t i = 0; i < count; i++) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      produced_cond.wait(lock, [&]() { return produced[i]; });
+    }
+    if (!consume(i)) {
+      next = count;
+      result = false;
+      break;
+    }
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  return result;
+}
+
+}  // namespace util
+}  // namespace aapt
+
+#endif  // AAPT_UTIL_PARALLEL_H
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/Parallel.h"
+
+#include <string>
+
+#include "test/Test.h"
+
+namespace aapt {
+
+TEST(ParallelTest, ConsumesInOrder) {
+  const size_t kCount = 100;
+  std::vector<size_t> produced(kCount);
+  std::string consumed;
+  ASSERT_TRUE(util::ParallelForInOrder(
+      kCount, 4u,
+      [&](size_t i) {
+        // Later items tend to finish first.
+        std::this_thread::sleep_for(std::chrono::microseconds((kCount - i) * 10));
+        produced[i] = i * 2;
+      },
+      [&](size_t i) {
+        EXPECT_EQ(i * 2, produced[i]);
+        consumed += std::to_string(i) + ",";
+        return true;
+      }));
+
+  std::string expected;
+  for (size_t i = 0; i < kCount; i++) {
+    expected += std::to_string(i) + ",";
+  }
+  EXPECT_EQ(expected, consumed);
+}
+
+TEST(ParallelTest, StopsWhenConsumeFails) {
+  std::atomic<size_t> produce_count(0);
+  size_t consume_count = 0;
+  EXPECT_FALSE(util::ParallelForInOrder(
+      1000u, 2u,
+      [&](size_t) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        produce_count++;
+      },
+      [&](size_t i) {
+        consume_count++;
+        return i != 3;
+      }));
+  EXPECT_EQ(4u, consume_count);
+  EXPECT_LT(produce_count.load(), 1000u);
+}
+
+TEST(ParallelTest, NoItemsOrJobs) {
+  EXPECT_TRUE(util::ParallelForInOrder(0u, 4u, [](size_t) {}, [](size_t) { return false; }));
+
+  size_t consume_count = 0;
+  EXPECT_TRUE(util::ParallelForInOrder(3u, 0u, [](size_t) {}, [&](size_t) {
+    consume_count++;
+    return true;
+  }));
+  EXPECT_EQ(3u, consume_count);
+}
+
+}  // namespace aapt
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/SmallObjectAllocator.h"
+
+#include <mutex>
+#include <new>
+
+namespace aapt {
+namespace util {
+
+namespace {
+
+// Hands out fixed sized slots from large blocks, and keeps the freed slots for later.
+class SmallObjectAllocator {
+ public:
+  static constexpr size_t kAlignment = alignof(std::max_align_t);
+  static constexpr size_t kMaxSize = 256;
+  static constexpr size_t kBlockSize = 64 * 1024;
+
+  static SmallObjectAllocator* Get() {
+    // Never destroyed, objects owned by static objects may be freed after it would have been.
+    static SmallObjectAllocator* const sAllocator = new SmallObjectAllocator();
+    return sAllocator;
+  }
+
+  static size_t SizeClass(size_t size) {
+    return (size + kAlignment - 1) / kAlignment;
+  }
+
+  void* Allocate(size_t size) {
+    SizeClassPool& pool = pools_[SizeClass(size)];
+    const size_t slot_size = SizeClass(size) * kAlignment;
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    if (pool.free_list != nullptr) {
+      FreeSlot* slot = pool.free_list;
+      pool.free_list = slot->next;
+      return slot;
+    }
+
+    if (pool.block_remaining < slot_size) {
+      pool.block = static_cast<char*>(::operator new(kBlockSize));
+      pool.block_remaining = kBlockSize;
+    }
+    void* ptr = pool.block;
+    pool.block += slot_size;
+    pool.block_remaining -= slot_size;
+    return ptr;
+  }
+
+  void Free(void* ptr, size_t size) {
+    SizeClassPool& pool = pools_[SizeClass(size)];
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    FreeSlot* slot = static_cast<FreeSlot*>(ptr);
+    slot->next = pool.free_list;
+    pool.free_list = slot;
+  }
+
+ private:
+  struct FreeSlot {
+    FreeSlot* next;
+  };
+
+  struct SizeClassPool {
+    std::mutex mutex;
+    FreeSlot* free_list = nullptr;
+    char* block = nullptr;
+    size_t block_remaining = 0;
+  };
+
+  SizeClassPool pools_[kMaxSize / kAlignment + 1];
+};
+
+}  // namespace
+
+void* AllocateSmallObject(size_t size) {
+  if (size > SmallObjectAllocator::kMaxSize) {
+    return ::operator new(size);
+  }
+  return SmallObjectAllocator::Get()->Allocate(size);
+}
+
+void FreeSmallObject(void* ptr, size_t size) {
+  if (ptr == nullptr) {
+    return;
+  }
+
+  if (size > SmallObjectAllocator::kMaxSize) {
+    ::operator delete(ptr);
+    return;
+  }
+  SmallObjectAllocator::Get()->Free(ptr, size);
+}
+
+}  // namespace util
+}  // namespace aapt
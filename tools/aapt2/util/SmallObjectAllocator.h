@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_UTIL_SMALLOBJECTALLOCATOR_H
+#define AAPT_UTIL_SMALLOBJECTALLOCATOR_H
+
+#include <cstddef>
+
+namespace aapt {
+namespace util {
+
+// Allocates small objects, like resource values and XML nodes, from per-size free lists carved out
+// of large blocks instead of one by one from the heap. The memory of freed objects is reused for
+// new ones but never given back. Larger objects come from the heap. Can be used from many threads.
+//
+// A class uses it by defining its operator new and operator delete with these. The size given to
+// FreeSmallObject() must be the one given to AllocateSmallObject(), which the sized operator
+// delete of a class with a virtual destructor guarantees.
+void* AllocateSmallObject(size_t size);
+void FreeSmallObject(void* ptr, size_t size);
+
+}  // namespace util
+}  // namespace aapt
+
+#endif  // AAPT_UTIL_SMALLOBJECTALLOCATOR_H
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/SmallObjectAllocator.h"
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "test/Test.h"
+
+namespace aapt {
+namespace util {
+
+TEST(SmallObjectAllocatorTest, ReusesFreedMemory) {
+  void* a = AllocateSmallObject(40u);
+  ASSERT_NE(nullptr, a);
+  std::memset(a, 0xff, 40u);
+  FreeSmallObject(a, 40u);
+
+  // Same size class.
+  void* b = AllocateSmallObject(33u);
+  EXPECT_EQ(a, b);
+  FreeSmallObject(b, 33u);
+}
+
+TEST(SmallObjectAllocatorTest, AlignsAndSeparatesObjects) {
+  std::vector<uint8_t*> objects;
+  for (size_t size = 1u; size <= 1024u; size += 7u) {
+    uint8_t* object = static_cast<uint8_t*>(AllocateSmallObject(size));
+    ASSERT_NE(nullptr, object);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(object) % alignof(std::max_align_t));
+    std::memset(object, static_cast<int>(size & 0xff), size);
+    objects.push_back(object);
+  }
+
+  size_t size = 1u;
+  for (uint8_t* object : objects) {
+    EXPECT_EQ(static_cast<uint8_t>(size & 0xff), object[size - 1]);
+    FreeSmallObject(object, size);
+    size += 7u;
+  }
+}
+
+TEST(SmallObjectAllocatorTest, ConcurrentAllocations) {
+  auto worker = []() {
+    std::vector<void*> objects;
+    for (size_t i = 0; i < 10000u; i++) {
+      objects.push_back(AllocateSmallObject(64u));
+      if (i % 3 == 0) {
+        FreeSmallObject(objects.back(), 64u);
+        objects.pop_back();
+      }
+    }
+    for (void* object : objects) {
+      FreeSmallObject(object, 64u);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < 4u; i++) {
+    threads.emplace_back(worker);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace util
+}  // namespace aapt
@@ -17,6 +17,7 @@
 #include "util/Util.h"
 
 #include <algorithm>
+#include <cstring>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -36,6 +37,16 @@ using ::android::StringPiece16;
 namespace aapt {
 namespace util {
 
+// DO NOT UPDATE, this is more of a marketing version.
+static const char* sMajorVersion = "2";
+
+// Update minor version whenever a feature or flag is added.
+static const char* sMinorVersion = "19";
+
+std::string GetToolFingerprint() {
+  return std::string(sMajorVersion) + ":" + sMinorVersion;
+}
+
 static std::vector<std::string> SplitAndTransform(
     const StringPiece& str, char sep, const std::function<char(char)>& f) {
   std::vector<std::string> parts;
@@ -297,29 +308,82 @@ bool VerifyJavaStringFormat(const StringPiece& str) {
   return true;
 }
 
+// Returns the length of the ASCII prefix of the `len` bytes at `str`. Checks a word at a time
+// while the bytes are ASCII, which most resource strings are.
+static size_t AsciiPrefixLength(const char* str, size_t len) {
+  constexpr uint64_t kHighBits = 0x8080808080808080ull;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, str + i, sizeof(word));
+    if ((word & kHighBits) != 0) {
+      break;
+    }
+  }
+  while (i < len && static_cast<uint8_t>(str[i]) < 0x80) {
+    i++;
+  }
+  return i;
+}
+
+static size_t AsciiPrefixLength(const char16_t* str, size_t len) {
+  constexpr uint64_t kNonAsciiBits = 0xff80ff80ff80ff80ull;
+  constexpr size_t kCharsPerWord = sizeof(uint64_t) / sizeof(char16_t);
+  size_t i = 0;
+  for (; i + kCharsPerWord <= len; i += kCharsPerWord) {
+    uint64_t word;
+    memcpy(&word, str + i, sizeof(word));
+    if ((word & kNonAsciiBits) != 0) {
+      break;
+    }
+  }
+  while (i < len && str[i] < 0x80) {
+    i++;
+  }
+  return i;
+}
+
 std::u16string Utf8ToUtf16(const StringPiece& utf8) {
-  ssize_t utf16_length = utf8_to_utf16_length(
-      reinterpret_cast<const uint8_t*>(utf8.data()), utf8.length());
-  if (utf16_length <= 0) {
-    return {};
+  // The ASCII prefix is widened directly, only the rest needs decoding.
+  const size_t ascii_length = AsciiPrefixLength(utf8.data(), utf8.length());
+  const uint8_t* rest = reinterpret_cast<const uint8_t*>(utf8.data()) + ascii_length;
+  const size_t rest_length = utf8.length() - ascii_length;
+  ssize_t rest_utf16_length = 0;
+  if (rest_length > 0) {
+    rest_utf16_length = utf8_to_utf16_length(rest, rest_length);
+    if (rest_utf16_length <= 0) {
+      return {};
+    }
   }
 
   std::u16string utf16;
-  utf16.resize(utf16_length);
-  utf8_to_utf16(reinterpret_cast<const uint8_t*>(utf8.data()), utf8.length(),
-                &*utf16.begin(), utf16_length + 1);
+  utf16.resize(ascii_length + rest_utf16_length);
+  std::copy(utf8.data(), utf8.data() + ascii_length, utf16.begin());
+  if (rest_length > 0) {
+    utf8_to_utf16(rest, rest_length, &utf16[ascii_length], rest_utf16_length + 1);
+  }
   return utf16;
 }
 
 std::string Utf16ToUtf8(const StringPiece16& utf16) {
-  ssize_t utf8_length = utf16_to_utf8_length(utf16.data(), utf16.length());
-  if (utf8_length <= 0) {
-    return {};
+  const size_t ascii_length = AsciiPrefixLength(utf16.data(), utf16.length());
+  const char16_t* rest = utf16.data() + ascii_length;
+  const size_t rest_length = utf16.length() - ascii_length;
+  ssize_t rest_utf8_length = 0;
+  if (rest_length > 0) {
+    rest_utf8_length = utf16_to_utf8_length(rest, rest_length);
+    if (rest_utf8_length <= 0) {
+      return {};
+    }
   }
 
   std::string utf8;
-  utf8.resize(utf8_length);
-  utf16_to_utf8(utf16.data(), utf16.length(), &*utf8.begin(), utf8_length + 1);
+  utf8.resize(ascii_length + rest_utf8_length);
+  std::transform(utf16.data(), utf16.data() + ascii_length, utf8.begin(),
+                 [](char16_t c) { return static_cast<char>(c); });
+  if (rest_length > 0) {
+    utf16_to_utf8(rest, rest_length, &utf8[ascii_length], rest_utf8_length + 1);
+  }
   return utf8;
 }
 
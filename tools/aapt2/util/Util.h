@@ -44,6 +44,9 @@
 namespace aapt {
 namespace util {
 
+// Returns the version of aapt2, as printed by `aapt2 version`.
+std::string GetToolFingerprint();
+
 template <typename T>
 struct Range {
   T start;
@@ -157,4 +157,19 @@ TEST(UtilTest, VerifyJavaStringFormat) {
   ASSERT_FALSE(util::VerifyJavaStringFormat("%09f %08s"));
 }
 
+TEST(UtilTest, Utf8ToUtf16) {
+  EXPECT_EQ(u"", util::Utf8ToUtf16(""));
+  EXPECT_EQ(u"hello", util::Utf8ToUtf16("hello"));
+  EXPECT_EQ(u"a longer ascii string", util::Utf8ToUtf16("a longer ascii string"));
+  EXPECT_EQ(u"ascii prefix \u00e9t\u00e9 \U0001f600",
+            util::Utf8ToUtf16("ascii prefix \u00e9t\u00e9 \U0001f600"));
+}
+
+TEST(UtilTest, Utf16ToUtf8) {
+  EXPECT_EQ("", util::Utf16ToUtf8(u""));
+  EXPECT_EQ("a longer ascii string", util::Utf16ToUtf8(u"a longer ascii string"));
+  EXPECT_EQ("ascii prefix \u00e9t\u00e9 \U0001f600",
+            util::Utf16ToUtf8(u"ascii prefix \u00e9t\u00e9 \U0001f600"));
+}
+
 }  // namespace aapt
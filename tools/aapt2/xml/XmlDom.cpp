@@ -27,6 +27,7 @@
 
 #include "ResourceUtils.h"
 #include "XmlPullParser.h"
+#include "util/SmallObjectAllocator.h"
 #include "util/Util.h"
 
 using ::aapt::io::InputStream;
@@ -38,6 +39,14 @@ namespace xml {
 
 constexpr char kXmlNamespaceSep = 1;
 
+void* Node::operator new(size_t size) {
+  return util::AllocateSmallObject(size);
+}
+
+void Node::operator delete(void* ptr, size_t size) {
+  util::FreeSmallObject(ptr, size);
+}
+
 struct Stack {
   std::unique_ptr<xml::Element> root;
   std::stack<xml::Element*> node_stack;
@@ -120,6 +129,12 @@ static void XMLCALL StartElementHandler(void* user_data, const char* name, const
 
   SplitName(name, &el->namespace_uri, &el->name);
 
+  size_t attr_count = 0u;
+  while (attrs[attr_count] != nullptr) {
+    attr_count += 2u;
+  }
+  el->attributes.reserve(attr_count / 2u);
+
   while (*attrs) {
     Attribute attribute;
     SplitName(*attrs++, &attribute.namespace_uri, &attribute.name);
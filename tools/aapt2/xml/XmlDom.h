@@ -54,6 +54,15 @@ class Node {
 
   // Clones the Node subtree, using the given function to decide how to clone an Element.
   virtual std::unique_ptr<Node> Clone(const ElementCloneFunc& el_cloner) const = 0;
+
+  // Every element and text of every XML file is a Node, so they're allocated with
+  // util::AllocateSmallObject() instead of one by one from the heap.
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+
+  static void* operator new(size_t size, void* ptr) {
+    return ptr;
+  }
 };
 
 // A namespace declaration (xmlns:prefix="uri").
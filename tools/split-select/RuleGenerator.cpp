@@ -95,7 +95,29 @@ sp<Rule> RuleGenerator::generateAbi(const Vector<abi::Variant>& splitAbis, size_
     return abiRule;
 }
 
+RuleGenerator::GroupInfo RuleGenerator::analyzeGroup(
+        const SortedVector<SplitDescription>& group) {
+    GroupInfo info;
+    info.densitiesDiffer = false;
+    info.abisDiffer = false;
+    const size_t groupSize = group.size();
+    for (size_t i = 0; i < groupSize; i++) {
+        info.allDensities.add(group[i].config.density);
+        info.allVariants.add(group[i].abi);
+        if (i > 0) {
+            info.densitiesDiffer |= group[i].config.density != group[0].config.density;
+            info.abisDiffer |= group[i].abi != group[0].abi;
+        }
+    }
+    return info;
+}
+
 sp<Rule> RuleGenerator::generate(const SortedVector<SplitDescription>& group, size_t index) {
+    return generate(group, index, analyzeGroup(group));
+}
+
+sp<Rule> RuleGenerator::generate(const SortedVector<SplitDescription>& group, size_t index,
+        const GroupInfo& info) {
     sp<Rule> rootRule = new Rule();
     rootRule->op = Rule::AND_SUBRULES;
 
@@ -118,43 +140,25 @@ sp<Rule> RuleGenerator::generate(const SortedVector<SplitDescription>& group, si
     }
 
     if (group[index].config.density != 0) {
-        size_t densityIndex = 0;
-        Vector<int> allDensities;
-        allDensities.add(group[index].config.density);
-
-        const size_t groupSize = group.size();
-        for (size_t i = 0; i < groupSize; i++) {
-            if (group[i].config.density != group[index].config.density) {
-                // This group differs by density.
-                allDensities.clear();
-                for (size_t j = 0; j < groupSize; j++) {
-                    allDensities.add(group[j].config.density);
-                }
-                densityIndex = index;
-                break;
-            }
+        if (info.densitiesDiffer) {
+            // This group differs by density.
+            rootRule->subrules.add(generateDensity(info.allDensities, index));
+        } else {
+            Vector<int> allDensities;
+            allDensities.add(group[index].config.density);
+            rootRule->subrules.add(generateDensity(allDensities, 0));
         }
-        rootRule->subrules.add(generateDensity(allDensities, densityIndex));
     }
 
     if (group[index].abi != abi::Variant_none) {
-        size_t abiIndex = 0;
-        Vector<abi::Variant> allVariants;
-        allVariants.add(group[index].abi);
-
-        const size_t groupSize = group.size();
-        for (size_t i = 0; i < groupSize; i++) {
-            if (group[i].abi != group[index].abi) {
-                // This group differs by ABI.
-                allVariants.clear();
-                for (size_t j = 0; j < groupSize; j++) {
-                    allVariants.add(group[j].abi);
-                }
-                abiIndex = index;
-                break;
-            }
+        if (info.abisDiffer) {
+            // This group differs by ABI.
+            rootRule->subrules.add(generateAbi(info.allVariants, index));
+        } else {
+            Vector<abi::Variant> allVariants;
+            allVariants.add(group[index].abi);
+            rootRule->subrules.add(generateAbi(allVariants, 0));
         }
-        rootRule->subrules.add(generateAbi(allVariants, abiIndex));
     }
 
     return rootRule;
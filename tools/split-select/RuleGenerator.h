@@ -27,9 +27,27 @@
 namespace split {
 
 struct RuleGenerator {
+    // The densities and ABIs of a group of mutually exclusive splits, which the rules of all the
+    // splits of the group are generated from.
+    struct GroupInfo {
+        // The densities and ABIs of the splits, in order.
+        android::Vector<int> allDensities;
+        android::Vector<abi::Variant> allVariants;
+
+        // Whether the splits differ by density, by ABI.
+        bool densitiesDiffer;
+        bool abisDiffer;
+    };
+
+    static GroupInfo analyzeGroup(const android::SortedVector<SplitDescription>& group);
+
     // Generate rules for a Split given the group of mutually exclusive splits it belongs to
     static android::sp<Rule> generate(const android::SortedVector<SplitDescription>& group, size_t index);
 
+    // Same, with the GroupInfo of the group, so that it's only computed once for all its splits.
+    static android::sp<Rule> generate(const android::SortedVector<SplitDescription>& group,
+            size_t index, const GroupInfo& info);
+
     static android::sp<Rule> generateAbi(const android::Vector<abi::Variant>& allVariants, size_t index);
     static android::sp<Rule> generateDensity(const android::Vector<int>& allDensities, size_t index);
 };
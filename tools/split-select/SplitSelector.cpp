@@ -65,15 +65,35 @@ Vector<SplitDescription> SplitSelector::getBestSplits(const SplitDescription& ta
     return bestSplits;
 }
 
+Vector<Vector<SplitDescription> > SplitSelector::getBestSplits(
+        const Vector<SplitDescription>& targets) const {
+    // Device profiles repeat a lot, select for each distinct target once.
+    KeyedVector<SplitDescription, size_t> distinctTargets;
+    Vector<Vector<SplitDescription> > distinctBestSplits;
+    Vector<Vector<SplitDescription> > bestSplits;
+    const size_t targetCount = targets.size();
+    bestSplits.setCapacity(targetCount);
+    for (size_t i = 0; i < targetCount; i++) {
+        ssize_t index = distinctTargets.indexOfKey(targets[i]);
+        if (index < 0) {
+            index = distinctTargets.add(targets[i], distinctBestSplits.size());
+            distinctBestSplits.add(getBestSplits(targets[i]));
+        }
+        bestSplits.add(distinctBestSplits[distinctTargets.valueAt(index)]);
+    }
+    return bestSplits;
+}
+
 KeyedVector<SplitDescription, sp<Rule> > SplitSelector::getRules() const {
     KeyedVector<SplitDescription, sp<Rule> > rules;
 
     const size_t groupCount = mGroups.size();
     for (size_t i = 0; i < groupCount; i++) {
         const SortedVector<SplitDescription>& splits = mGroups[i];
+        const RuleGenerator::GroupInfo info = RuleGenerator::analyzeGroup(splits);
         const size_t splitCount = splits.size();
         for (size_t j = 0; j < splitCount; j++) {
-            sp<Rule> rule = Rule::simplify(RuleGenerator::generate(splits, j));
+            sp<Rule> rule = Rule::simplify(RuleGenerator::generate(splits, j, info));
             if (rule != NULL) {
                 rules.add(splits[j], rule);
             }
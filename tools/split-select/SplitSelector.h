@@ -33,6 +33,11 @@ public:
 
     android::Vector<SplitDescription> getBestSplits(const SplitDescription& target) const;
 
+    // Selects the best splits for each of many targets at once, in the order of the targets.
+    // Targets that are the same are only selected for once.
+    android::Vector<android::Vector<SplitDescription> > getBestSplits(
+            const android::Vector<SplitDescription>& targets) const;
+
     android::KeyedVector<SplitDescription, android::sp<Rule> > getRules() const;
 
 private:
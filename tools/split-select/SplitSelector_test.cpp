@@ -69,4 +69,32 @@ TEST(SplitSelectorTest, rulesShouldMatchSelection) {
     EXPECT_RULES_EQ(rule, expectedRule);
 }
 
+TEST(SplitSelectorTest, batchSelectionMatchesSingleSelection) {
+    Vector<SplitDescription> splits;
+    ASSERT_TRUE(addSplit(splits, "hdpi"));
+    ASSERT_TRUE(addSplit(splits, "xhdpi"));
+    ASSERT_TRUE(addSplit(splits, "de"));
+    ASSERT_TRUE(addSplit(splits, "fr"));
+
+    Vector<SplitDescription> targets;
+    ASSERT_TRUE(addSplit(targets, "de-hdpi"));
+    ASSERT_TRUE(addSplit(targets, "fr-xhdpi"));
+    ASSERT_TRUE(addSplit(targets, "de-hdpi"));
+
+    SplitSelector selector(splits);
+    Vector<Vector<SplitDescription> > bestSplits = selector.getBestSplits(targets);
+    ASSERT_EQ(targets.size(), bestSplits.size());
+    for (size_t i = 0; i < targets.size(); i++) {
+        SortedVector<SplitDescription> expected;
+        expected.merge(selector.getBestSplits(targets[i]));
+        SortedVector<SplitDescription> actual;
+        actual.merge(bestSplits[i]);
+        ASSERT_EQ(expected.size(), actual.size());
+        for (size_t j = 0; j < expected.size(); j++) {
+            EXPECT_EQ(expected[j], actual[j]);
+        }
+    }
+    EXPECT_EQ(2u, bestSplits[0].size());
+}
+
 } // namespace split